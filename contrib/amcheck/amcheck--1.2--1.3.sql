@@ -0,0 +1,16 @@
+/* contrib/amcheck/amcheck--1.2--1.3.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "ALTER EXTENSION amcheck UPDATE TO '1.3'" to load this file. \quit
+
+--
+-- bt_index_check_range()
+--
+CREATE FUNCTION bt_index_check_range(index regclass,
+    startblock bigint, npages bigint)
+RETURNS bigint
+AS 'MODULE_PATHNAME', 'bt_index_check_range'
+LANGUAGE C STRICT PARALLEL RESTRICTED;
+
+-- Don't want this to be available to public
+REVOKE ALL ON FUNCTION bt_index_check_range(regclass, bigint, bigint) FROM PUBLIC;
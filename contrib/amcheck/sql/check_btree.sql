@@ -58,6 +58,21 @@ SELECT bt_index_check('bttest_a_idx');
 SELECT bt_index_check('bttest_a_idx', true);
 SELECT bt_index_parent_check('bttest_b_idx', true);
 
+-- incremental verification
+SELECT bt_index_check_range('bttest_b_idx', 0, 10);
+SELECT bt_index_check_range('bttest_b_idx', 10, 1000000);
+WITH RECURSIVE steps(nextblock) AS (
+    SELECT 0::bigint
+  UNION ALL
+    SELECT bt_index_check_range('bttest_b_idx', nextblock, 50)
+    FROM steps WHERE nextblock IS NOT NULL
+)
+SELECT count(*) > 2 FROM steps;
+SELECT bt_index_check_range('bttest_b_idx', 1000000, 10);
+-- invalid ranges (error)
+SELECT bt_index_check_range('bttest_b_idx', -1, 10);
+SELECT bt_index_check_range('bttest_b_idx', 0, 0);
+
 BEGIN;
 SELECT bt_index_check('bttest_a_idx');
 SELECT bt_index_parent_check('bttest_b_idx');
@@ -13,6 +13,11 @@
  * verify its structure.  A heap scan later uses Bloom filter probes to verify
  * that every visible heap tuple has a matching index tuple.
  *
+ * The checks that involve a single page and its right sibling can also be
+ * run on a range of blocks in physical order, so that a large index can be
+ * verified a bounded number of pages at a time, and by several sessions at
+ * once.
+ *
  *
  * Copyright (c) 2017-2020, PostgreSQL Global Development Group
  *
@@ -135,14 +140,19 @@ typedef struct BtreeLevel
 
 PG_FUNCTION_INFO_V1(bt_index_check);
 PG_FUNCTION_INFO_V1(bt_index_parent_check);
+PG_FUNCTION_INFO_V1(bt_index_check_range);
 
-static void bt_index_check_internal(Oid indrelid, bool parentcheck,
-									bool heapallindexed, bool rootdescend);
+static BlockNumber bt_index_check_internal(Oid indrelid, bool parentcheck,
+										   bool heapallindexed, bool rootdescend,
+										   BlockNumber startblock,
+										   BlockNumber npages);
 static inline void btree_index_checkable(Relation rel);
 static inline bool btree_index_mainfork_expected(Relation rel);
 static void bt_check_every_level(Relation rel, Relation heaprel,
 								 bool heapkeyspace, bool readonly, bool heapallindexed,
 								 bool rootdescend);
+static BlockNumber bt_check_range(Relation rel, bool heapkeyspace,
+								  BlockNumber startblock, BlockNumber npages);
 static BtreeLevel bt_check_level_from_leftmost(BtreeCheckState *state,
 											   BtreeLevel level);
 static void bt_recheck_sibling_links(BtreeCheckState *state,
@@ -206,7 +216,8 @@ bt_index_check(PG_FUNCTION_ARGS)
 	if (PG_NARGS() == 2)
 		heapallindexed = PG_GETARG_BOOL(1);
 
-	bt_index_check_internal(indrelid, false, heapallindexed, false);
+	bt_index_check_internal(indrelid, false, heapallindexed, false,
+							0, InvalidBlockNumber);
 
 	PG_RETURN_VOID();
 }
@@ -232,22 +243,73 @@ bt_index_parent_check(PG_FUNCTION_ARGS)
 	if (PG_NARGS() == 3)
 		rootdescend = PG_GETARG_BOOL(2);
 
-	bt_index_check_internal(indrelid, true, heapallindexed, rootdescend);
+	bt_index_check_internal(indrelid, true, heapallindexed, rootdescend,
+							0, InvalidBlockNumber);
 
 	PG_RETURN_VOID();
 }
 
 /*
- * Helper for bt_index_[parent_]check, coordinating the bulk of the work.
+ * bt_index_check_range(index regclass, startblock bigint, npages bigint)
+ *
+ * Verify integrity of up to npages blocks of B-Tree index, starting with
+ * startblock, in physical order.
+ *
+ * Acquires AccessShareLock on heap & index relations, and performs the same
+ * checks as bt_index_check, except for the ones that need to walk a whole
+ * level of the tree.  Returns the block to start from on the next call, or
+ * NULL once the end of the index has been reached.  Calling this repeatedly
+ * keeps the work done by each call bounded, and disjoint ranges can be
+ * verified concurrently from several sessions.
  */
-static void
+Datum
+bt_index_check_range(PG_FUNCTION_ARGS)
+{
+	Oid			indrelid = PG_GETARG_OID(0);
+	int64		startblock = PG_GETARG_INT64(1);
+	int64		npages = PG_GETARG_INT64(2);
+	BlockNumber nextblock;
+
+	if (startblock < 0 || startblock > MaxBlockNumber)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid start block number " INT64_FORMAT,
+						startblock)));
+	if (npages <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of pages must be greater than zero")));
+
+	/* Ranges can't extend past the last possible block anyway */
+	npages = Min(npages, (int64) MaxBlockNumber + 1 - startblock);
+
+	nextblock = bt_index_check_internal(indrelid, false, false, false,
+										(BlockNumber) startblock,
+										(BlockNumber) npages);
+
+	if (nextblock == InvalidBlockNumber)
+		PG_RETURN_NULL();
+	PG_RETURN_INT64((int64) nextblock);
+}
+
+/*
+ * Helper for bt_index_[parent_]check and bt_index_check_range, coordinating
+ * the bulk of the work.
+ *
+ * If npages is InvalidBlockNumber, the whole index is verified.  Otherwise,
+ * only npages blocks starting with startblock are, and the block following
+ * them is returned, or InvalidBlockNumber if there are no more blocks.
+ */
+static BlockNumber
 bt_index_check_internal(Oid indrelid, bool parentcheck, bool heapallindexed,
-						bool rootdescend)
+						bool rootdescend, BlockNumber startblock,
+						BlockNumber npages)
 {
 	Oid			heapid;
 	Relation	indrel;
 	Relation	heaprel;
 	LOCKMODE	lockmode;
+	BlockNumber nextblock = InvalidBlockNumber;
 
 	if (parentcheck)
 		lockmode = ShareLock;
@@ -322,8 +384,12 @@ bt_index_check_internal(Oid indrelid, bool parentcheck, bool heapallindexed,
 							RelationGetRelationName(indrel))));
 
 		/* Check index, possibly against table it is an index on */
-		bt_check_every_level(indrel, heaprel, heapkeyspace, parentcheck,
-							 heapallindexed, rootdescend);
+		if (npages == InvalidBlockNumber)
+			bt_check_every_level(indrel, heaprel, heapkeyspace, parentcheck,
+								 heapallindexed, rootdescend);
+		else
+			nextblock = bt_check_range(indrel, heapkeyspace, startblock,
+									   npages);
 	}
 
 	/*
@@ -334,6 +400,8 @@ bt_index_check_internal(Oid indrelid, bool parentcheck, bool heapallindexed,
 	index_close(indrel, lockmode);
 	if (heaprel)
 		table_close(heaprel, lockmode);
+
+	return nextblock;
 }
 
 /*
@@ -635,6 +703,97 @@ bt_check_every_level(Relation rel, Relation heaprel, bool heapkeyspace,
 	MemoryContextDelete(state->targetcontext);
 }
 
+/*
+ * Entry point for bt_index_check_range().  Verifies up to npages blocks
+ * starting with startblock, in physical order, rather than walking the tree
+ * level by level.  The caller must hold AccessShareLock on the index, so all
+ * checks are those done by bt_check_every_level() in !readonly mode, except
+ * that sibling links aren't checked against the previous page on the level,
+ * which is generally not the previous block.
+ *
+ * Returns the block following the range, or InvalidBlockNumber if the range
+ * extends to the end of the index.
+ */
+static BlockNumber
+bt_check_range(Relation rel, bool heapkeyspace, BlockNumber startblock,
+			   BlockNumber npages)
+{
+	BtreeCheckState *state;
+	BlockNumber nblocks;
+	BlockNumber endblock;
+	BlockNumber blkno;
+	MemoryContext oldcontext;
+
+	elog(DEBUG1, "verifying blocks %u to %u of index \"%s\"",
+		 startblock, startblock + npages - 1, RelationGetRelationName(rel));
+
+	state = palloc0(sizeof(BtreeCheckState));
+	state->rel = rel;
+	state->heapkeyspace = heapkeyspace;
+	state->targetcontext = AllocSetContextCreate(CurrentMemoryContext,
+												 "amcheck context",
+												 ALLOCSET_DEFAULT_SIZES);
+	state->checkstrategy = GetAccessStrategy(BAS_BULKREAD);
+
+	nblocks = RelationGetNumberOfBlocks(rel);
+	if (startblock >= nblocks)
+		endblock = startblock;
+	else
+		endblock = startblock + Min(npages, nblocks - startblock);
+
+	oldcontext = MemoryContextSwitchTo(state->targetcontext);
+
+	for (blkno = startblock; blkno < endblock; blkno++)
+	{
+		Buffer		buffer;
+		bool		isnew;
+		BTPageOpaque opaque;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* palloc_btree_page() verifies the metapage, we need do no more */
+		if (blkno == BTREE_METAPAGE)
+		{
+			(void) palloc_btree_page(state, blkno);
+			MemoryContextReset(state->targetcontext);
+			continue;
+		}
+
+		/*
+		 * Unlike a walk of the tree, a physical scan may find new pages,
+		 * left behind by a crash while extending the index.  These are fine;
+		 * VACUUM takes care of them.
+		 */
+		buffer = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+									state->checkstrategy);
+		LockBuffer(buffer, BT_READ);
+		isnew = PageIsNew(BufferGetPage(buffer));
+		UnlockReleaseBuffer(buffer);
+		if (isnew)
+			continue;
+
+		state->targetblock = blkno;
+		state->target = palloc_btree_page(state, blkno);
+		state->targetlsn = PageGetLSN(state->target);
+
+		opaque = (BTPageOpaque) PageGetSpecialPointer(state->target);
+		if (P_IGNORE(opaque))
+			ereport(DEBUG1,
+					(errcode(ERRCODE_NO_DATA),
+					 errmsg("block %u of index \"%s\" ignored",
+							blkno, RelationGetRelationName(rel))));
+		else
+			bt_target_page_check(state);
+
+		MemoryContextReset(state->targetcontext);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextDelete(state->targetcontext);
+
+	return (endblock >= nblocks) ? InvalidBlockNumber : endblock;
+}
+
 /*
  * Given a left-most block at some level, move right, verifying each page
  * individually (with more verification across pages for "readonly"
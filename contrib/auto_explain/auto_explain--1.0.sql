@@ -0,0 +1,35 @@
+/* contrib/auto_explain/auto_explain--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION auto_explain" to load this file. \quit
+
+-- Register functions.
+CREATE FUNCTION auto_explain_plans(
+    OUT captured_at timestamptz,
+    OUT pid int4,
+    OUT userid oid,
+    OUT dbid oid,
+    OUT queryid int8,
+    OUT duration float8,
+    OUT plan text
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'auto_explain_plans'
+LANGUAGE C STRICT VOLATILE PARALLEL SAFE;
+
+CREATE FUNCTION auto_explain_plans_reset()
+RETURNS void
+AS 'MODULE_PATHNAME', 'auto_explain_plans_reset'
+LANGUAGE C PARALLEL SAFE;
+
+-- Register a view on the function for ease of use.
+CREATE VIEW auto_explain_plans AS
+  SELECT * FROM auto_explain_plans();
+
+-- Don't want these to be available to public.
+REVOKE ALL ON FUNCTION auto_explain_plans() FROM PUBLIC;
+REVOKE ALL ON FUNCTION auto_explain_plans_reset() FROM PUBLIC;
+REVOKE ALL ON auto_explain_plans FROM PUBLIC;
+
+GRANT EXECUTE ON FUNCTION auto_explain_plans() TO pg_read_all_stats;
+GRANT SELECT ON auto_explain_plans TO pg_read_all_stats;
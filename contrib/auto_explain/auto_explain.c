@@ -15,13 +15,75 @@
 #include <limits.h>
 
 #include "access/parallel.h"
+#include "access/xact.h"
 #include "commands/explain.h"
+#include "common/hashfn.h"
 #include "executor/instrument.h"
+#include "funcapi.h"
 #include "jit/jit.h"
+#include "mb/pg_wchar.h"
+#include "miscadmin.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
 #include "utils/guc.h"
+#include "utils/timestamp.h"
 
 PG_MODULE_MAGIC;
 
+/* Where explained plans go */
+typedef enum
+{
+	AUTO_EXPLAIN_DEST_LOG,		/* server log */
+	AUTO_EXPLAIN_DEST_MEMORY,	/* shared memory ring */
+	AUTO_EXPLAIN_DEST_BOTH
+} AutoExplainDestination;
+
+/* Number of per-query rate limiting entries */
+#define AUTO_EXPLAIN_RATE_SLOTS	1024
+
+/* Maximum length of a plan kept in shared memory, including terminator */
+#define AUTO_EXPLAIN_STORED_PLAN_LEN	16384
+
+/*
+ * Number of plans explained within the current minute for a query.  Queries
+ * are mapped to entries by their identifier; when two queries collide, the
+ * newer one takes the entry over, so the limit is sometimes exceeded, but
+ * never enforced too strictly.
+ */
+typedef struct AutoExplainRateEntry
+{
+	uint64		queryid;
+	TimestampTz window_start;	/* start of the current minute */
+	int			count;			/* plans explained since then */
+} AutoExplainRateEntry;
+
+/* A plan in the shared memory ring */
+typedef struct AutoExplainStoredPlan
+{
+	TimestampTz captured_at;
+	int			pid;
+	Oid			userid;
+	Oid			dbid;
+	uint64		queryid;
+	double		duration;		/* in msec */
+	char		plan[AUTO_EXPLAIN_STORED_PLAN_LEN];	/* empty if slot unused */
+} AutoExplainStoredPlan;
+
+/*
+ * Shared state, present only when loaded via shared_preload_libraries.  The
+ * lock protects both the rate limiting entries and the ring of plans.
+ */
+typedef struct AutoExplainSharedState
+{
+	LWLock	   *lock;
+	uint64		next_plan;		/* number of plans stored so far */
+	int			num_plans;		/* size of the ring */
+	AutoExplainRateEntry rates[AUTO_EXPLAIN_RATE_SLOTS];
+	AutoExplainStoredPlan plans[FLEXIBLE_ARRAY_MEMBER];
+} AutoExplainSharedState;
+
 /* GUC variables */
 static int	auto_explain_log_min_duration = -1; /* msec or -1 */
 static bool auto_explain_log_analyze = false;
@@ -30,11 +92,15 @@ static bool auto_explain_log_buffers = false;
 static bool auto_explain_log_wal = false;
 static bool auto_explain_log_triggers = false;
 static bool auto_explain_log_timing = true;
+static int	auto_explain_log_timing_sample = 1;
 static bool auto_explain_log_settings = false;
 static int	auto_explain_log_format = EXPLAIN_FORMAT_TEXT;
 static int	auto_explain_log_level = LOG;
 static bool auto_explain_log_nested_statements = false;
 static double auto_explain_sample_rate = 1;
+static int	auto_explain_log_rate_limit = 0;	/* per minute or 0 */
+static int	auto_explain_destination = AUTO_EXPLAIN_DEST_LOG;
+static int	auto_explain_max_stored_plans = 100;
 
 static const struct config_enum_entry format_options[] = {
 	{"text", EXPLAIN_FORMAT_TEXT, false},
@@ -44,6 +110,13 @@ static const struct config_enum_entry format_options[] = {
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry destination_options[] = {
+	{"log", AUTO_EXPLAIN_DEST_LOG, false},
+	{"memory", AUTO_EXPLAIN_DEST_MEMORY, false},
+	{"both", AUTO_EXPLAIN_DEST_BOTH, false},
+	{NULL, 0, false}
+};
+
 static const struct config_enum_entry loglevel_options[] = {
 	{"debug5", DEBUG5, false},
 	{"debug4", DEBUG4, false},
@@ -69,7 +142,15 @@ static bool current_query_sampled = false;
 	 (nesting_level == 0 || auto_explain_log_nested_statements) && \
 	 current_query_sampled)
 
+/*
+ * Shared state, or NULL.  Without it, plans can't be kept in memory, and
+ * rate limiting is done per backend with local_rates.
+ */
+static AutoExplainSharedState *ae_state = NULL;
+static AutoExplainRateEntry local_rates[AUTO_EXPLAIN_RATE_SLOTS];
+
 /* Saved hook values in case of unload */
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
 static ExecutorStart_hook_type prev_ExecutorStart = NULL;
 static ExecutorRun_hook_type prev_ExecutorRun = NULL;
 static ExecutorFinish_hook_type prev_ExecutorFinish = NULL;
@@ -78,6 +159,14 @@ static ExecutorEnd_hook_type prev_ExecutorEnd = NULL;
 void		_PG_init(void);
 void		_PG_fini(void);
 
+PG_FUNCTION_INFO_V1(auto_explain_plans);
+PG_FUNCTION_INFO_V1(auto_explain_plans_reset);
+
+static Size ae_memsize(void);
+static void ae_shmem_startup(void);
+static uint64 ae_query_key(QueryDesc *queryDesc);
+static bool ae_rate_limit(uint64 key, bool consume);
+static void ae_store_plan(uint64 key, double msec, const char *plan);
 static void explain_ExecutorStart(QueryDesc *queryDesc, int eflags);
 static void explain_ExecutorRun(QueryDesc *queryDesc,
 								ScanDirection direction,
@@ -217,6 +306,18 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomIntVariable("auto_explain.log_timing_sample",
+							"Time only every Nth execution of each plan node.",
+							"1 times every execution.",
+							&auto_explain_log_timing_sample,
+							1,
+							1, INSTRUMENT_SAMPLE_MAX,
+							PGC_SUSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
 	DefineCustomRealVariable("auto_explain.sample_rate",
 							 "Fraction of queries to process.",
 							 NULL,
@@ -230,8 +331,57 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomIntVariable("auto_explain.log_rate_limit",
+							"Sets the maximum number of plans explained per minute for each query.",
+							"Zero means no limit.",
+							&auto_explain_log_rate_limit,
+							0,
+							0, INT_MAX,
+							PGC_SUSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomEnumVariable("auto_explain.destination",
+							 "Where to send explained plans.",
+							 NULL,
+							 &auto_explain_destination,
+							 AUTO_EXPLAIN_DEST_LOG,
+							 destination_options,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("auto_explain.max_stored_plans",
+							"Sets the number of plans kept in shared memory.",
+							NULL,
+							&auto_explain_max_stored_plans,
+							100,
+							0, INT_MAX / 2,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
 	EmitWarningsOnPlaceholders("auto_explain");
 
+	/*
+	 * Request the shared state, if we're being loaded via
+	 * shared_preload_libraries.
+	 */
+	if (process_shared_preload_libraries_in_progress)
+	{
+		RequestAddinShmemSpace(ae_memsize());
+		RequestNamedLWLockTranche("auto_explain", 1);
+
+		prev_shmem_startup_hook = shmem_startup_hook;
+		shmem_startup_hook = ae_shmem_startup;
+	}
+
 	/* Install hooks. */
 	prev_ExecutorStart = ExecutorStart_hook;
 	ExecutorStart_hook = explain_ExecutorStart;
@@ -250,18 +400,153 @@ void
 _PG_fini(void)
 {
 	/* Uninstall hooks. */
+	shmem_startup_hook = prev_shmem_startup_hook;
 	ExecutorStart_hook = prev_ExecutorStart;
 	ExecutorRun_hook = prev_ExecutorRun;
 	ExecutorFinish_hook = prev_ExecutorFinish;
 	ExecutorEnd_hook = prev_ExecutorEnd;
 }
 
+/*
+ * Estimate shared memory space needed.
+ */
+static Size
+ae_memsize(void)
+{
+	return add_size(offsetof(AutoExplainSharedState, plans),
+					mul_size(auto_explain_max_stored_plans,
+							 sizeof(AutoExplainStoredPlan)));
+}
+
+/*
+ * shmem_startup hook: allocate or attach to shared memory.
+ */
+static void
+ae_shmem_startup(void)
+{
+	bool		found;
+
+	if (prev_shmem_startup_hook)
+		prev_shmem_startup_hook();
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	ae_state = ShmemInitStruct("auto_explain", ae_memsize(), &found);
+	if (!found)
+	{
+		int			i;
+
+		ae_state->lock = &(GetNamedLWLockTranche("auto_explain"))->lock;
+		ae_state->next_plan = 0;
+		ae_state->num_plans = auto_explain_max_stored_plans;
+		memset(ae_state->rates, 0, sizeof(ae_state->rates));
+		for (i = 0; i < ae_state->num_plans; i++)
+			ae_state->plans[i].plan[0] = '\0';
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+/*
+ * Identify the query for rate limiting.  That's the query identifier if some
+ * module computes them, like pg_stat_statements, or else a hash of the query
+ * text.
+ */
+static uint64
+ae_query_key(QueryDesc *queryDesc)
+{
+	if (queryDesc->plannedstmt->queryId != UINT64CONST(0))
+		return queryDesc->plannedstmt->queryId;
+	if (queryDesc->sourceText == NULL)
+		return UINT64CONST(0);
+	return DatumGetUInt64(hash_any_extended((const unsigned char *) queryDesc->sourceText,
+											strlen(queryDesc->sourceText), 0));
+}
+
+/*
+ * Check whether a plan may still be explained this minute for the query
+ * identified by key, and if consume is true, count one.
+ */
+static bool
+ae_rate_limit(uint64 key, bool consume)
+{
+	AutoExplainRateEntry *entry;
+	TimestampTz now;
+	bool		result = true;
+
+	if (auto_explain_log_rate_limit <= 0)
+		return true;
+
+	/* The statement start time is good enough, and costs no system call */
+	now = GetCurrentStatementStartTimestamp();
+
+	if (ae_state)
+	{
+		LWLockAcquire(ae_state->lock, consume ? LW_EXCLUSIVE : LW_SHARED);
+		entry = &ae_state->rates[key % AUTO_EXPLAIN_RATE_SLOTS];
+	}
+	else
+		entry = &local_rates[key % AUTO_EXPLAIN_RATE_SLOTS];
+
+	if (entry->queryid != key ||
+		now - entry->window_start >= USECS_PER_MINUTE ||
+		now < entry->window_start)
+	{
+		/* Start a new minute for this query */
+		if (consume)
+		{
+			entry->queryid = key;
+			entry->window_start = now;
+			entry->count = 1;
+		}
+	}
+	else if (entry->count >= auto_explain_log_rate_limit)
+		result = false;
+	else if (consume)
+		entry->count++;
+
+	if (ae_state)
+		LWLockRelease(ae_state->lock);
+
+	return result;
+}
+
+/*
+ * Keep a plan in the shared memory ring, replacing the oldest one.
+ */
+static void
+ae_store_plan(uint64 key, double msec, const char *plan)
+{
+	AutoExplainStoredPlan *slot;
+	int			len;
+
+	Assert(ae_state && ae_state->num_plans > 0);
+
+	len = strlen(plan);
+	if (len >= AUTO_EXPLAIN_STORED_PLAN_LEN)
+		len = pg_mbcliplen(plan, len, AUTO_EXPLAIN_STORED_PLAN_LEN - 1);
+
+	LWLockAcquire(ae_state->lock, LW_EXCLUSIVE);
+	slot = &ae_state->plans[ae_state->next_plan++ % ae_state->num_plans];
+	slot->captured_at = GetCurrentTimestamp();
+	slot->pid = MyProcPid;
+	slot->userid = GetUserId();
+	slot->dbid = MyDatabaseId;
+	slot->queryid = key;
+	slot->duration = msec;
+	memcpy(slot->plan, plan, len);
+	slot->plan[len] = '\0';
+	LWLockRelease(ae_state->lock);
+}
+
 /*
  * ExecutorStart hook: start up logging if needed
  */
 static void
 explain_ExecutorStart(QueryDesc *queryDesc, int eflags)
 {
+	bool		explain;
+
 	/*
 	 * At the beginning of each top-level statement, decide whether we'll
 	 * sample this statement.  If nested-statement explaining is enabled,
@@ -281,13 +566,22 @@ explain_ExecutorStart(QueryDesc *queryDesc, int eflags)
 			current_query_sampled = false;
 	}
 
-	if (auto_explain_enabled())
+	/*
+	 * Don't bother instrumenting a query whose plans have been explained as
+	 * many times as allowed this minute.  Whether this one counts toward the
+	 * limit is only known at the end, if it runs long enough.
+	 */
+	explain = auto_explain_enabled() &&
+		ae_rate_limit(ae_query_key(queryDesc), false);
+
+	if (explain)
 	{
 		/* Enable per-node instrumentation iff log_analyze is required. */
 		if (auto_explain_log_analyze && (eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0)
 		{
 			if (auto_explain_log_timing)
-				queryDesc->instrument_options |= INSTRUMENT_TIMER;
+				queryDesc->instrument_options |= INSTRUMENT_TIMER |
+					INSTRUMENT_SAMPLE(auto_explain_log_timing_sample);
 			else
 				queryDesc->instrument_options |= INSTRUMENT_ROWS;
 			if (auto_explain_log_buffers)
@@ -302,7 +596,7 @@ explain_ExecutorStart(QueryDesc *queryDesc, int eflags)
 	else
 		standard_ExecutorStart(queryDesc, eflags);
 
-	if (auto_explain_enabled())
+	if (explain)
 	{
 		/*
 		 * Set up to track total elapsed time in ExecutorRun.  Make sure the
@@ -372,6 +666,7 @@ explain_ExecutorEnd(QueryDesc *queryDesc)
 	if (queryDesc->totaltime && auto_explain_enabled())
 	{
 		double		msec;
+		uint64		key;
 
 		/*
 		 * Make sure stats accumulation is done.  (Note: it's okay if several
@@ -381,7 +676,9 @@ explain_ExecutorEnd(QueryDesc *queryDesc)
 
 		/* Log plan if duration is exceeded. */
 		msec = queryDesc->totaltime->total * 1000.0;
-		if (msec >= auto_explain_log_min_duration)
+		key = ae_query_key(queryDesc);
+		if (msec >= auto_explain_log_min_duration &&
+			ae_rate_limit(key, true))
 		{
 			ExplainState *es = NewExplainState();
 
@@ -390,6 +687,7 @@ explain_ExecutorEnd(QueryDesc *queryDesc)
 			es->buffers = (es->analyze && auto_explain_log_buffers);
 			es->wal = (es->analyze && auto_explain_log_wal);
 			es->timing = (es->analyze && auto_explain_log_timing);
+			es->timing_sample = auto_explain_log_timing_sample;
 			es->summary = es->analyze;
 			es->format = auto_explain_log_format;
 			es->settings = auto_explain_log_settings;
@@ -414,16 +712,23 @@ explain_ExecutorEnd(QueryDesc *queryDesc)
 				es->str->data[es->str->len - 1] = '}';
 			}
 
+			/* Keep the plan in memory if asked to, and if we can. */
+			if (auto_explain_destination != AUTO_EXPLAIN_DEST_LOG &&
+				ae_state && ae_state->num_plans > 0)
+				ae_store_plan(key, msec, es->str->data);
+
 			/*
 			 * Note: we rely on the existing logging of context or
 			 * debug_query_string to identify just which statement is being
 			 * reported.  This isn't ideal but trying to do it here would
 			 * often result in duplication.
 			 */
-			ereport(auto_explain_log_level,
-					(errmsg("duration: %.3f ms  plan:\n%s",
-							msec, es->str->data),
-					 errhidestmt(true)));
+			if (auto_explain_destination != AUTO_EXPLAIN_DEST_MEMORY ||
+				ae_state == NULL || ae_state->num_plans == 0)
+				ereport(auto_explain_log_level,
+						(errmsg("duration: %.3f ms  plan:\n%s",
+								msec, es->str->data),
+						 errhidestmt(true)));
 
 			pfree(es->str->data);
 		}
@@ -434,3 +739,105 @@ explain_ExecutorEnd(QueryDesc *queryDesc)
 	else
 		standard_ExecutorEnd(queryDesc);
 }
+
+/*
+ * Return the plans kept in shared memory, oldest first.
+ */
+Datum
+auto_explain_plans(PG_FUNCTION_ARGS)
+{
+#define AUTO_EXPLAIN_PLANS_COLS	7
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	uint64		i;
+	uint64		first;
+
+	if (!ae_state)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("auto_explain must be loaded via shared_preload_libraries")));
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+	if (tupdesc->natts != AUTO_EXPLAIN_PLANS_COLS)
+		elog(ERROR, "incorrect number of output arguments");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	LWLockAcquire(ae_state->lock, LW_SHARED);
+
+	if (ae_state->next_plan > ae_state->num_plans)
+		first = ae_state->next_plan - ae_state->num_plans;
+	else
+		first = 0;
+
+	for (i = first; i < ae_state->next_plan; i++)
+	{
+		AutoExplainStoredPlan *slot = &ae_state->plans[i % ae_state->num_plans];
+		Datum		values[AUTO_EXPLAIN_PLANS_COLS];
+		bool		nulls[AUTO_EXPLAIN_PLANS_COLS];
+
+		/* Skip slots emptied by auto_explain_plans_reset() */
+		if (slot->plan[0] == '\0')
+			continue;
+
+		memset(nulls, 0, sizeof(nulls));
+		values[0] = TimestampTzGetDatum(slot->captured_at);
+		values[1] = Int32GetDatum(slot->pid);
+		values[2] = ObjectIdGetDatum(slot->userid);
+		values[3] = ObjectIdGetDatum(slot->dbid);
+		values[4] = Int64GetDatumFast((int64) slot->queryid);
+		values[5] = Float8GetDatumFast(slot->duration);
+		values[6] = CStringGetTextDatum(slot->plan);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	LWLockRelease(ae_state->lock);
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Discard the plans kept in shared memory.
+ */
+Datum
+auto_explain_plans_reset(PG_FUNCTION_ARGS)
+{
+	int			i;
+
+	if (!ae_state)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("auto_explain must be loaded via shared_preload_libraries")));
+
+	LWLockAcquire(ae_state->lock, LW_EXCLUSIVE);
+	for (i = 0; i < ae_state->num_plans; i++)
+		ae_state->plans[i].plan[0] = '\0';
+	LWLockRelease(ae_state->lock);
+
+	PG_RETURN_VOID();
+}
@@ -14,18 +14,116 @@
 
 #include "access/genam.h"
 #include "access/generic_xlog.h"
+#include "access/parallel.h"
+#include "access/table.h"
 #include "access/tableam.h"
+#include "access/xact.h"
 #include "bloom.h"
 #include "catalog/index.h"
+#include "executor/instrument.h"
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "storage/bufmgr.h"
+#include "storage/condition_variable.h"
 #include "storage/indexfsm.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"		/* pgrminclude ignore */
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/sharedtuplestore.h"
+#include "utils/snapmgr.h"
 
 PG_MODULE_MAGIC;
 
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_BLOOM_SHARED		UINT64CONST(0xB100000000000001)
+#define PARALLEL_KEY_BLOOM_STS			UINT64CONST(0xB100000000000002)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xB100000000000003)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xB100000000000004)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xB100000000000005)
+
+/*
+ * Status for index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment.
+ *
+ * In a parallel build, every participant scans part of the heap and fills
+ * pages with index tuples as in a serial build, but sends each full page to
+ * the leader through a shared tuplestore rather than writing it.  The leader
+ * then writes all the pages.  So the computation of signatures, which is
+ * what takes time with many columns, is parallel, while the index itself is
+ * only ever written by the leader.
+ */
+typedef struct BloomShared
+{
+	/* Immutable state */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+	int			nparticipants;	/* as planned, including the leader */
+
+	/*
+	 * workersdonecv is used to monitor the progress of workers.  All parallel
+	 * participants must indicate that they are done before the leader can
+	 * read the shared tuplestore.
+	 */
+	ConditionVariable workersdonecv;
+
+	/* mutex protects the mutable state below */
+	slock_t		mutex;
+
+	int			nparticipantsdone;
+	double		reltuples;
+	double		indtuples;
+	bool		brokenhotchain;
+
+	/* backing files of the shared tuplestore */
+	SharedFileSet fileset;
+
+	/*
+	 * ParallelTableScanDescData data follows. Can't directly embed here, as
+	 * implementations of the parallel table scan desc interface might need
+	 * stronger alignment.
+	 */
+} BloomShared;
+
+/*
+ * Return pointer to a BloomShared's parallel table scan.
+ *
+ * c.f. shm_toc_allocate as to why BUFFERALIGN is used, rather than just
+ * MAXALIGN.
+ */
+#define ParallelTableScanFromBloomShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(BloomShared)))
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct BloomLeader
+{
+	ParallelContext *pcxt;
+
+	/* number of workers launched, plus one if the leader participates */
+	int			nparticipants;
+
+	BloomShared *blshared;
+	SharedTuplestoreAccessor *sts;	/* leader's accessor */
+	Snapshot	snapshot;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+} BloomLeader;
+
+/*
+ * A page sent by a parallel participant to the leader.  As far as
+ * sharedtuplestore.c is concerned this is a MinimalTuple, which works as
+ * long as it begins with the length.
+ */
+typedef struct BloomBuildPage
+{
+	uint32		t_len;			/* total size of the chunk */
+	char		data[BLCKSZ];
+} BloomBuildPage;
+
 /*
  * State of bloom index build.  We accumulate one page data here before
  * flushing it to buffer manager.
@@ -38,18 +136,49 @@ typedef struct
 								 * tuple */
 	PGAlignedBlock data;		/* cached page */
 	int			count;			/* number of tuples in cached page */
+
+	/*
+	 * sts is where a parallel participant sends its pages; NULL if they go
+	 * straight into the index.  blleader is set in the leader of a parallel
+	 * build.
+	 */
+	SharedTuplestoreAccessor *sts;
+	BloomLeader *blleader;
 } BloomBuildState;
 
+static void _bloom_begin_parallel(BloomBuildState *buildstate, Relation heap,
+								  Relation index, bool isconcurrent,
+								  int request);
+static void _bloom_end_parallel(BloomLeader *blleader);
+static double _bloom_parallel_merge(BloomBuildState *buildstate,
+									Relation index, IndexInfo *indexInfo);
+static void _bloom_parallel_scan_and_build(BloomShared *blshared,
+										   SharedTuplestoreAccessor *sts,
+										   Relation heap, Relation index,
+										   bool progress);
+
 /*
- * Flush page cached in BloomBuildState.
+ * Flush page cached in BloomBuildState, or send it to the leader in a
+ * parallel build.
  */
 static void
 flushCachedPage(Relation index, BloomBuildState *buildstate)
 {
 	Page		page;
-	Buffer		buffer = BloomNewBuffer(index);
+	Buffer		buffer;
 	GenericXLogState *state;
 
+	if (buildstate->sts)
+	{
+		BloomBuildPage chunk;
+
+		chunk.t_len = sizeof(BloomBuildPage);
+		memcpy(chunk.data, buildstate->data.data, BLCKSZ);
+		sts_puttuple(buildstate->sts, NULL, (MinimalTuple) &chunk);
+		return;
+	}
+
+	buffer = BloomNewBuffer(index);
 	state = GenericXLogStart(index);
 	page = GenericXLogRegisterBuffer(state, buffer, GENERIC_XLOG_FULL_IMAGE);
 	memcpy(page, buildstate->data.data, BLCKSZ);
@@ -139,15 +268,31 @@ blbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 											  "Bloom build temporary context",
 											  ALLOCSET_DEFAULT_SIZES);
 	initCachedPage(&buildstate);
+	buildstate.sts = NULL;
+	buildstate.blleader = NULL;
 
-	/* Do the heap scan */
-	reltuples = table_index_build_scan(heap, index, indexInfo, true, true,
-									   bloomBuildCallback, (void *) &buildstate,
-									   NULL);
+	/* Attempt to launch parallel worker scan when required */
+	if (indexInfo->ii_ParallelWorkers > 0)
+		_bloom_begin_parallel(&buildstate, heap, index,
+							  indexInfo->ii_Concurrent,
+							  indexInfo->ii_ParallelWorkers);
 
-	/* Flush last page if needed (it will be, unless heap was empty) */
-	if (buildstate.count > 0)
-		flushCachedPage(index, &buildstate);
+	if (buildstate.blleader == NULL)
+	{
+		/* Do the heap scan */
+		reltuples = table_index_build_scan(heap, index, indexInfo, true, true,
+										   bloomBuildCallback, (void *) &buildstate,
+										   NULL);
+
+		/* Flush last page if needed (it will be, unless heap was empty) */
+		if (buildstate.count > 0)
+			flushCachedPage(index, &buildstate);
+	}
+	else
+	{
+		reltuples = _bloom_parallel_merge(&buildstate, index, indexInfo);
+		_bloom_end_parallel(buildstate.blleader);
+	}
 
 	MemoryContextDelete(buildstate.tmpCtx);
 
@@ -364,3 +509,359 @@ blinsert(Relation index, Datum *values, bool *isnull,
 
 	return false;
 }
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Sets buildstate's BloomLeader, which caller must use to shut down parallel
+ * mode by passing it to _bloom_end_parallel() at the very end of its index
+ * build.  If not even a single worker process can be launched, this is
+ * never set, and caller should proceed with a serial index build.
+ */
+static void
+_bloom_begin_parallel(BloomBuildState *buildstate, Relation heap,
+					  Relation index, bool isconcurrent, int request)
+{
+	ParallelContext *pcxt;
+	int			nparticipants;
+	Snapshot	snapshot;
+	Size		estblshared;
+	Size		eststs;
+	BloomShared *blshared;
+	SharedTuplestore *sts;
+	BloomLeader *blleader = (BloomLeader *) palloc0(sizeof(BloomLeader));
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	char	   *sharedquery;
+	int			querylen;
+
+	/*
+	 * Enter parallel mode, and create context for parallel build of bloom
+	 * index
+	 */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("bloom", "_bloom_parallel_build_main",
+								 request);
+
+	nparticipants = request + 1;
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time
+	 * qual checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_BLOOM_SHARED workspace, and the
+	 * PARALLEL_KEY_BLOOM_STS shared tuplestore
+	 */
+	estblshared = add_size(BUFFERALIGN(sizeof(BloomShared)),
+						   table_parallelscan_estimate(heap, snapshot));
+	shm_toc_estimate_chunk(&pcxt->estimator, estblshared);
+	eststs = sts_estimate(nparticipants);
+	shm_toc_estimate_chunk(&pcxt->estimator, eststs);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	/*
+	 * Estimate space for WalUsage and BufferUsage -- PARALLEL_KEY_WAL_USAGE
+	 * and PARALLEL_KEY_BUFFER_USAGE.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	querylen = strlen(debug_query_string);
+	shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+	{
+		if (IsMVCCSnapshot(snapshot))
+			UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return;
+	}
+
+	/* Store shared build state, for which we reserved space */
+	blshared = (BloomShared *) shm_toc_allocate(pcxt->toc, estblshared);
+	blshared->heaprelid = RelationGetRelid(heap);
+	blshared->indexrelid = RelationGetRelid(index);
+	blshared->isconcurrent = isconcurrent;
+	blshared->nparticipants = nparticipants;
+	ConditionVariableInit(&blshared->workersdonecv);
+	SpinLockInit(&blshared->mutex);
+	blshared->nparticipantsdone = 0;
+	blshared->reltuples = 0.0;
+	blshared->indtuples = 0.0;
+	blshared->brokenhotchain = false;
+	SharedFileSetInit(&blshared->fileset, pcxt->seg);
+	table_parallelscan_initialize(heap,
+								  ParallelTableScanFromBloomShared(blshared),
+								  snapshot);
+
+	/* The leader is participant 0 of the shared tuplestore */
+	sts = (SharedTuplestore *) shm_toc_allocate(pcxt->toc, eststs);
+	blleader->sts = sts_initialize(sts, nparticipants, 0, 0,
+								   SHARED_TUPLESTORE_SINGLE_PASS,
+								   &blshared->fileset, "bloom");
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BLOOM_SHARED, blshared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BLOOM_STS, sts);
+
+	/* Store query string for workers */
+	sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+	memcpy(sharedquery, debug_query_string, querylen + 1);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+
+	/*
+	 * Allocate space for each worker's WalUsage and BufferUsage; no need to
+	 * initialize.
+	 */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+	blleader->pcxt = pcxt;
+	blleader->nparticipants = pcxt->nworkers_launched + 1;
+	blleader->blshared = blshared;
+	blleader->snapshot = snapshot;
+	blleader->walusage = walusage;
+	blleader->bufferusage = bufferusage;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		_bloom_end_parallel(blleader);
+		return;
+	}
+
+	/* Save leader state now that it's clear build will be parallel */
+	buildstate->blleader = blleader;
+
+	/* Join heap scan ourselves */
+	_bloom_parallel_scan_and_build(blshared, blleader->sts, heap, index, true);
+
+	/*
+	 * Caller needs to wait for all launched workers when we return.  Make
+	 * sure that the failure-to-start case will not hang forever.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ */
+static void
+_bloom_end_parallel(BloomLeader *blleader)
+{
+	int			i;
+
+	/* Shutdown worker processes */
+	WaitForParallelWorkersToFinish(blleader->pcxt);
+
+	/*
+	 * Next, accumulate WAL usage.  (This must wait for the workers to finish,
+	 * or we might get incomplete data.)
+	 */
+	for (i = 0; i < blleader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&blleader->bufferusage[i], &blleader->walusage[i]);
+
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(blleader->snapshot))
+		UnregisterSnapshot(blleader->snapshot);
+	DestroyParallelContext(blleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Within leader, wait for the end of the heap scan, then write all the pages
+ * the participants filled into the index.
+ *
+ * Returns the total number of heap tuples scanned.
+ */
+static double
+_bloom_parallel_merge(BloomBuildState *buildstate, Relation index,
+					  IndexInfo *indexInfo)
+{
+	BloomLeader *blleader = buildstate->blleader;
+	BloomShared *blshared = blleader->blshared;
+	BloomBuildPage *chunk;
+	double		reltuples;
+
+	for (;;)
+	{
+		SpinLockAcquire(&blshared->mutex);
+		if (blshared->nparticipantsdone == blleader->nparticipants)
+		{
+			buildstate->indtuples = blshared->indtuples;
+			if (blshared->brokenhotchain)
+				indexInfo->ii_BrokenHotChain = true;
+			reltuples = blshared->reltuples;
+			SpinLockRelease(&blshared->mutex);
+			break;
+		}
+		SpinLockRelease(&blshared->mutex);
+
+		ConditionVariableSleep(&blshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+
+	/*
+	 * Write the pages out.  Each participant's last page is generally not
+	 * full, which leaves a little free space that later insertions will use.
+	 */
+	buildstate->sts = NULL;
+	sts_begin_parallel_scan(blleader->sts);
+	while ((chunk = (BloomBuildPage *) sts_parallel_scan_next(blleader->sts,
+															   NULL)) != NULL)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		memcpy(buildstate->data.data, chunk->data, BLCKSZ);
+		flushCachedPage(index, buildstate);
+	}
+	sts_end_parallel_scan(blleader->sts);
+
+	return reltuples;
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_bloom_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	BloomShared *blshared;
+	SharedTuplestore *sts;
+	SharedTuplestoreAccessor *accessor;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, false);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Look up bloom shared state */
+	blshared = shm_toc_lookup(toc, PARALLEL_KEY_BLOOM_SHARED, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!blshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = table_open(blshared->heaprelid, heapLockmode);
+	indexRel = index_open(blshared->indexrelid, indexLockmode);
+
+	/* Attach to the shared tuplestore; the leader is participant 0 */
+	SharedFileSetAttach(&blshared->fileset, seg);
+	sts = shm_toc_lookup(toc, PARALLEL_KEY_BLOOM_STS, false);
+	accessor = sts_attach(sts, ParallelWorkerNumber + 1, &blshared->fileset);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	_bloom_parallel_scan_and_build(blshared, accessor, heapRel, indexRel,
+								   false);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	index_close(indexRel, indexLockmode);
+	table_close(heapRel, heapLockmode);
+}
+
+/*
+ * Perform a participant's portion of a parallel build: scan its share of the
+ * heap, and send the pages filled to the leader through sts.
+ */
+static void
+_bloom_parallel_scan_and_build(BloomShared *blshared,
+							   SharedTuplestoreAccessor *sts,
+							   Relation heap, Relation index, bool progress)
+{
+	BloomBuildState buildstate;
+	TableScanDesc scan;
+	double		reltuples;
+	IndexInfo  *indexInfo;
+
+	memset(&buildstate, 0, sizeof(buildstate));
+	initBloomState(&buildstate.blstate, index);
+	buildstate.tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+											  "Bloom build temporary context",
+											  ALLOCSET_DEFAULT_SIZES);
+	initCachedPage(&buildstate);
+	buildstate.sts = sts;
+	buildstate.blleader = NULL;
+
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = blshared->isconcurrent;
+	scan = table_beginscan_parallel(heap,
+									ParallelTableScanFromBloomShared(blshared));
+	reltuples = table_index_build_scan(heap, index, indexInfo, true, progress,
+									   bloomBuildCallback, (void *) &buildstate,
+									   scan);
+
+	/* send the last page */
+	if (buildstate.count > 0)
+		flushCachedPage(index, &buildstate);
+	sts_end_write(sts);
+
+	MemoryContextDelete(buildstate.tmpCtx);
+
+	/* Record ambuild statistics, and whether we found a broken HOT chain */
+	SpinLockAcquire(&blshared->mutex);
+	blshared->nparticipantsdone++;
+	blshared->reltuples += reltuples;
+	blshared->indtuples += buildstate.indtuples;
+	if (indexInfo->ii_BrokenHotChain)
+		blshared->brokenhotchain = true;
+	SpinLockRelease(&blshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&blshared->workersdonecv);
+}
@@ -19,6 +19,7 @@
 #include "access/xlog.h"
 #include "fmgr.h"
 #include "nodes/pathnodes.h"
+#include "storage/shm_toc.h"
 
 /* Support procedures numbers */
 #define BLOOM_HASH_PROC			1
@@ -169,6 +170,8 @@ typedef struct BloomTuple
 typedef struct BloomScanOpaqueData
 {
 	BloomSignatureWord *sign;	/* Scan signature */
+	int		   *signwords;		/* Indexes of nonzero words of sign */
+	int			nsignwords;		/* Number of them */
 	BloomState	state;
 } BloomScanOpaqueData;
 
@@ -201,6 +204,8 @@ extern void blendscan(IndexScanDesc scan);
 extern IndexBuildResult *blbuild(Relation heap, Relation index,
 								 struct IndexInfo *indexInfo);
 extern void blbuildempty(Relation index);
+extern PGDLLEXPORT void _bloom_parallel_build_main(dsm_segment *seg,
+												   shm_toc *toc);
 extern IndexBulkDeleteResult *blbulkdelete(IndexVacuumInfo *info,
 										   IndexBulkDeleteResult *stats, IndexBulkDeleteCallback callback,
 										   void *callback_state);
@@ -16,6 +16,7 @@
 #include "bloom.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/simd.h"
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
 #include "utils/memutils.h"
@@ -35,6 +36,7 @@ blbeginscan(Relation r, int nkeys, int norderbys)
 	so = (BloomScanOpaque) palloc(sizeof(BloomScanOpaqueData));
 	initBloomState(&so->state, scan->indexRelation);
 	so->sign = NULL;
+	so->signwords = NULL;
 
 	scan->opaque = so;
 
@@ -53,6 +55,9 @@ blrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
 	if (so->sign)
 		pfree(so->sign);
 	so->sign = NULL;
+	if (so->signwords)
+		pfree(so->signwords);
+	so->signwords = NULL;
 
 	if (scankey && scan->numberOfKeys > 0)
 	{
@@ -72,6 +77,62 @@ blendscan(IndexScanDesc scan)
 	if (so->sign)
 		pfree(so->sign);
 	so->sign = NULL;
+	if (so->signwords)
+		pfree(so->signwords);
+	so->signwords = NULL;
+}
+
+/*
+ * Does the signature of an index tuple have all the bits of the scan
+ * signature set?
+ *
+ * A scan typically involves a few columns of the index, setting only a few
+ * bits in the scan signature.  Then we only look at the words of the tuple
+ * signature where those bits are.  Otherwise, we compare whole signatures, a
+ * vector at a time when possible.
+ */
+static inline bool
+signatureMatches(BloomScanOpaque so, const BloomSignatureWord *sign)
+{
+	int			i;
+
+	if (so->nsignwords * 4 <= so->state.opts.bloomLength)
+	{
+		for (i = 0; i < so->nsignwords; i++)
+		{
+			int			w = so->signwords[i];
+
+			if ((sign[w] & so->sign[w]) != so->sign[w])
+				return false;
+		}
+	}
+	else
+	{
+		const uint8 *s = (const uint8 *) so->sign;
+		const uint8 *t = (const uint8 *) sign;
+		int			nbytes = so->state.opts.bloomLength * sizeof(BloomSignatureWord);
+
+		i = 0;
+#ifndef USE_NO_SIMD
+		for (; i + sizeof(Vector8) <= nbytes; i += sizeof(Vector8))
+		{
+			Vector8		vs;
+			Vector8		vt;
+
+			vector8_load(&vs, s + i);
+			vector8_load(&vt, t + i);
+			if (vector8_highbit_mask(vector8_eq(vector8_and(vt, vs), vs)) != 0xFFFF)
+				return false;
+		}
+#endif
+		for (; i < nbytes; i++)
+		{
+			if ((t[i] & s[i]) != s[i])
+				return false;
+		}
+	}
+
+	return true;
 }
 
 /*
@@ -113,6 +174,15 @@ blgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 
 			skey++;
 		}
+
+		/* Remember which words of the signature we need to look at */
+		so->signwords = palloc(sizeof(int) * so->state.opts.bloomLength);
+		so->nsignwords = 0;
+		for (i = 0; i < so->state.opts.bloomLength; i++)
+		{
+			if (so->sign[i] != 0)
+				so->signwords[so->nsignwords++] = i;
+		}
 	}
 
 	/*
@@ -142,20 +212,9 @@ blgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 			for (offset = 1; offset <= maxOffset; offset++)
 			{
 				BloomTuple *itup = BloomPageGetTuple(&so->state, page, offset);
-				bool		res = true;
-
-				/* Check index signature with scan signature */
-				for (i = 0; i < so->state.opts.bloomLength; i++)
-				{
-					if ((itup->sign[i] & so->sign[i]) != so->sign[i])
-					{
-						res = false;
-						break;
-					}
-				}
 
-				/* Add matching tuples to bitmap */
-				if (res)
+				/* Add tuples matching the scan signature to bitmap */
+				if (signatureMatches(so, itup->sign))
 				{
 					tbm_add_tuples(tbm, &itup->heapPtr, 1, true);
 					ntids++;
@@ -93,3 +93,18 @@ SELECT reloptions FROM pg_class WHERE oid = 'bloomidx'::regclass;
 \set VERBOSITY terse
 CREATE INDEX bloomidx2 ON tst USING bloom (i, t) WITH (length=0);
 CREATE INDEX bloomidx2 ON tst USING bloom (i, t) WITH (col1=0);
+
+-- Test parallel build, and scans with long signatures
+CREATE TABLE tstp (a int4, b int4, c int4) WITH (parallel_workers = 2);
+INSERT INTO tstp SELECT g % 10, g % 7, g % 13 FROM generate_series(1, 30000) g;
+SET max_parallel_maintenance_workers = 2;
+CREATE INDEX bloomidxp ON tstp USING bloom (a, b, c)
+	WITH (length = 512, col1 = 16, col2 = 16, col3 = 16);
+RESET max_parallel_maintenance_workers;
+
+SET enable_seqscan = off;
+SELECT count(*) FROM tstp WHERE a = 3;
+SELECT count(*) FROM tstp WHERE b = 5 AND c = 0;
+SELECT count(*) FROM tstp WHERE a = 3 AND b = 5 AND c = 0;
+RESET enable_seqscan;
+DROP TABLE tstp;
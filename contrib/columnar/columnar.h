@@ -0,0 +1,197 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar.h
+ *	  Header for the columnar table access method.
+ *
+ * Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/columnar/columnar.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _COLUMNAR_H_
+#define _COLUMNAR_H_
+
+#include "access/htup_details.h"
+#include "access/relscan.h"
+#include "executor/tuptable.h"
+#include "storage/block.h"
+#include "storage/bufpage.h"
+#include "utils/rel.h"
+#include "utils/snapshot.h"
+
+/*
+ * A columnar table is a metapage followed by a chain of stripes.  A stripe
+ * holds up to COLUMNAR_STRIPE_ROWS rows inserted by one command, stored one
+ * column after the other, each column split into chunks of
+ * COLUMNAR_CHUNK_ROWS rows that are compressed separately.  A stripe is
+ * written once, as a run of consecutive pages, and its inserting transaction
+ * decides the visibility of all its rows.
+ *
+ * The stripe's pages are just a byte stream: each page holds
+ * COLUMNAR_PAGE_DATA_SIZE bytes of it after the page header.  The stream
+ * starts with a ColumnarStripeHeader, followed by a ColumnarChunkDesc for
+ * every chunk of every column, followed by the chunks' data.
+ */
+#define COLUMNAR_MAGIC			0x434F4C31	/* "COL1" */
+#define COLUMNAR_VERSION		1
+
+#define COLUMNAR_METAPAGE_BLKNO	0
+
+#define COLUMNAR_CHUNK_ROWS		10000
+#define COLUMNAR_STRIPE_ROWS	150000
+
+/* stop adding rows to a stripe once they take up this much memory */
+#define COLUMNAR_STRIPE_MEMORY	(64 * 1024 * 1024)
+
+#define COLUMNAR_PAGE_DATA_SIZE	(BLCKSZ - MAXALIGN(SizeOfPageHeaderData))
+
+/* Contents of the metapage */
+typedef struct ColumnarMetaPageData
+{
+	uint32		magic;
+	uint32		version;
+	BlockNumber first_stripe;	/* first stripe, or InvalidBlockNumber */
+	BlockNumber last_stripe;	/* last stripe, or InvalidBlockNumber */
+	uint64		next_row;		/* first row number not reserved yet */
+} ColumnarMetaPageData;
+
+/* Start of the stripe's first page */
+typedef struct ColumnarStripeHeader
+{
+	uint32		magic;
+	BlockNumber next_stripe;	/* next in chain, or InvalidBlockNumber */
+	BlockNumber nblocks;		/* # of pages of the stripe */
+	TransactionId xmin;			/* inserting transaction; invalid if the
+								 * stripe is known to be dead */
+	CommandId	cid;			/* inserting command */
+	uint32		nrows;			/* # of rows in the stripe */
+	uint64		first_row;		/* row number of its first row */
+	uint32		datalen;		/* length of the stream, including this */
+	uint16		natts;			/* # of columns, at the time of writing */
+	uint16		nchunks;		/* # of chunks per column */
+} ColumnarStripeHeader;
+
+/* Where to find one column's data for one chunk of rows */
+typedef struct ColumnarChunkDesc
+{
+	uint32		offset;			/* in the stream */
+	uint32		len;			/* stored length */
+	uint32		rawlen;			/* length when decompressed */
+	uint32		flags;			/* see below */
+} ColumnarChunkDesc;
+
+#define COLUMNAR_CHUNK_COMPRESSED	0x0001	/* data is pglz-compressed */
+#define COLUMNAR_CHUNK_HAS_NULLS	0x0002	/* data starts with a null bitmap */
+#define COLUMNAR_CHUNK_ALL_NULL		0x0004	/* no data, all values are null */
+
+#define ColumnarStripeDescsOffset \
+	MAXALIGN(sizeof(ColumnarStripeHeader))
+#define ColumnarStripeDataOffset(natts, nchunks) \
+	(ColumnarStripeDescsOffset + (natts) * (nchunks) * sizeof(ColumnarChunkDesc))
+
+/*
+ * Rows are identified by their row number, which TIDs encode the same way as
+ * the heap numbers its tuples, so that nothing mistakes them for invalid.
+ */
+#define COLUMNAR_ROWS_PER_TID_BLOCK	MaxHeapTuplesPerPage
+
+static inline void
+columnar_row_to_tid(uint64 rownum, ItemPointer tid)
+{
+	ItemPointerSet(tid,
+				   (BlockNumber) (rownum / COLUMNAR_ROWS_PER_TID_BLOCK),
+				   (OffsetNumber) (rownum % COLUMNAR_ROWS_PER_TID_BLOCK + 1));
+}
+
+static inline uint64
+columnar_tid_to_row(ItemPointer tid)
+{
+	return (uint64) ItemPointerGetBlockNumber(tid) * COLUMNAR_ROWS_PER_TID_BLOCK +
+		ItemPointerGetOffsetNumber(tid) - 1;
+}
+
+/* A stripe found in the chain */
+typedef struct ColumnarStripe
+{
+	BlockNumber blkno;			/* its first page */
+	ColumnarStripeHeader hdr;
+} ColumnarStripe;
+
+/*
+ * Decoded values of one chunk of rows, for the columns that were asked for.
+ */
+typedef struct ColumnarChunk
+{
+	int			stripe;			/* index into the reader's stripes[] */
+	int			chunkno;		/* chunk within the stripe, or -1 */
+	uint32		first;			/* its first row within the stripe */
+	uint32		nrows;
+	Datum	  **values;			/* per column, NULL if not loaded */
+	bool	  **isnull;
+	MemoryContext context;		/* holds the chunk's data */
+} ColumnarChunk;
+
+/*
+ * State for reading a columnar table: the stripes a snapshot can see, and
+ * the chunk decoded last.
+ */
+typedef struct ColumnarReader
+{
+	Relation	rel;
+	BufferAccessStrategy strategy;
+	int			nstripes;
+	ColumnarStripe *stripes;	/* in block order */
+	bool	   *needed;			/* per column, do we need it? */
+
+	/* chunk descriptors of the stripe of "chunk" */
+	int			desc_stripe;
+	ColumnarChunkDesc *descs;
+
+	ColumnarChunk chunk;
+
+	/*
+	 * Memory of chunks we moved away from.  Tuples returned from them may
+	 * still be around, e.g. in a TupleBatch, so they're only freed once
+	 * enough rows have been returned since.
+	 */
+	List	   *retired;
+	uint64		nreturned;
+
+	MemoryContext context;		/* holds everything above */
+} ColumnarReader;
+
+/* columnar_storage.c */
+extern bool columnar_read_metapage(Relation rel, ColumnarMetaPageData *meta);
+extern uint64 columnar_reserve_rows(Relation rel, uint32 nrows);
+extern void columnar_write_stripe(Relation rel, char *data, uint32 len);
+extern ColumnarStripe *columnar_read_stripes(Relation rel,
+											 BufferAccessStrategy strategy,
+											 int *nstripes);
+extern void columnar_read_data(Relation rel, BufferAccessStrategy strategy,
+							   BlockNumber start, uint32 offset, uint32 len,
+							   char *dest);
+extern void columnar_set_stripe_xmin(Relation rel, BlockNumber blkno,
+									 TransactionId xmin);
+extern bool columnar_stripe_visible(ColumnarStripeHeader *hdr,
+									Snapshot snapshot);
+
+/* columnar_read.c */
+extern ColumnarReader *columnar_begin_read(Relation rel, Snapshot snapshot,
+										   BufferAccessStrategy strategy);
+extern void columnar_end_read(ColumnarReader *reader);
+extern void columnar_load_chunk(ColumnarReader *reader, int stripe,
+								int chunkno);
+extern void columnar_store_row(ColumnarReader *reader, uint32 row,
+							   TupleTableSlot *slot);
+extern bool columnar_fetch_row(ColumnarReader *reader, uint64 rownum,
+							   TupleTableSlot *slot);
+
+/* columnar_write.c */
+extern void columnar_insert(Relation rel, TupleTableSlot *slot, CommandId cid);
+extern void columnar_flush_pending(Relation rel);
+extern void columnar_discard_pending(Relation rel);
+extern void columnar_init_write(void);
+
+#endif
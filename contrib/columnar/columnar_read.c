@@ -0,0 +1,367 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_read.c
+ *		Decoding the rows of columnar tables.
+ *
+ * Rows are decoded a chunk at a time, and only for the columns the reader
+ * needs, which is the point of storing them by column.
+ *
+ * Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/columnar/columnar_read.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/tupmacs.h"
+#include "columnar.h"
+#include "common/pg_lzcompress.h"
+#include "executor/tuptable.h"
+#include "utils/memutils.h"
+
+/*
+ * Chunks we moved away from are kept until this many rows have been returned
+ * since, as tuples pointing into them may still be in use.  This covers the
+ * largest executor_batch_size.
+ */
+#define COLUMNAR_RETIRE_ROWS	1024
+
+typedef struct ColumnarRetiredChunk
+{
+	MemoryContext context;
+	uint64		retired_at;		/* reader->nreturned when retired */
+} ColumnarRetiredChunk;
+
+/*
+ * Start reading rel, as seen by snapshot.
+ */
+ColumnarReader *
+columnar_begin_read(Relation rel, Snapshot snapshot,
+					BufferAccessStrategy strategy)
+{
+	MemoryContext context;
+	MemoryContext oldcontext;
+	ColumnarReader *reader;
+	ColumnarStripe *stripes;
+	int			nstripes;
+	int			natts = RelationGetDescr(rel)->natts;
+	int			i;
+
+	context = AllocSetContextCreate(CurrentMemoryContext,
+									"columnar reader",
+									ALLOCSET_DEFAULT_SIZES);
+	oldcontext = MemoryContextSwitchTo(context);
+
+	reader = palloc0(sizeof(ColumnarReader));
+	reader->rel = rel;
+	reader->strategy = strategy;
+	reader->context = context;
+
+	/* keep only the stripes we can see */
+	stripes = columnar_read_stripes(rel, strategy, &nstripes);
+	reader->stripes = stripes;
+	for (i = 0; i < nstripes; i++)
+	{
+		if (columnar_stripe_visible(&stripes[i].hdr, snapshot) &&
+			stripes[i].hdr.nrows > 0)
+			stripes[reader->nstripes++] = stripes[i];
+	}
+
+	reader->needed = palloc(natts * sizeof(bool));
+	memset(reader->needed, true, natts * sizeof(bool));
+
+	reader->desc_stripe = -1;
+	reader->chunk.stripe = -1;
+	reader->chunk.chunkno = -1;
+	reader->chunk.values = palloc0(natts * sizeof(Datum *));
+	reader->chunk.isnull = palloc0(natts * sizeof(bool *));
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return reader;
+}
+
+/*
+ * Done reading.
+ */
+void
+columnar_end_read(ColumnarReader *reader)
+{
+	MemoryContextDelete(reader->context);
+}
+
+/*
+ * Free the memory of retired chunks that nothing can point into any more.
+ */
+static void
+columnar_free_retired(ColumnarReader *reader)
+{
+	while (reader->retired != NIL)
+	{
+		ColumnarRetiredChunk *r = linitial(reader->retired);
+
+		if (reader->nreturned - r->retired_at < COLUMNAR_RETIRE_ROWS)
+			break;
+		MemoryContextDelete(r->context);
+		pfree(r);
+		reader->retired = list_delete_first(reader->retired);
+	}
+}
+
+/*
+ * Make the chunk descriptors of a stripe available.
+ */
+static void
+columnar_load_descs(ColumnarReader *reader, int stripe)
+{
+	ColumnarStripeHeader *hdr = &reader->stripes[stripe].hdr;
+	uint32		len;
+
+	if (reader->desc_stripe == stripe)
+		return;
+
+	if (reader->descs != NULL)
+		pfree(reader->descs);
+	reader->descs = NULL;
+	reader->desc_stripe = -1;
+
+	len = hdr->natts * hdr->nchunks * sizeof(ColumnarChunkDesc);
+	reader->descs = MemoryContextAlloc(reader->context, Max(len, 1));
+	columnar_read_data(reader->rel, reader->strategy,
+					   reader->stripes[stripe].blkno,
+					   ColumnarStripeDescsOffset, len, (char *) reader->descs);
+	reader->desc_stripe = stripe;
+}
+
+/*
+ * Fill values[] and isnull[] with one column of a chunk of nrows rows.
+ */
+static void
+columnar_decode_column(ColumnarReader *reader, ColumnarStripe *stripe,
+					   ColumnarChunkDesc *desc, Form_pg_attribute att,
+					   uint32 nrows, Datum *values, bool *isnull)
+{
+	char	   *raw;
+	char	   *ptr;
+	bits8	   *bitmap = NULL;
+	uint32		off = 0;
+	uint32		i;
+
+	if (desc->flags & COLUMNAR_CHUNK_ALL_NULL)
+	{
+		memset(values, 0, nrows * sizeof(Datum));
+		memset(isnull, true, nrows * sizeof(bool));
+		return;
+	}
+
+	raw = palloc(desc->rawlen);
+	if (desc->flags & COLUMNAR_CHUNK_COMPRESSED)
+	{
+		char	   *compressed = palloc(desc->len);
+
+		columnar_read_data(reader->rel, reader->strategy, stripe->blkno,
+						   desc->offset, desc->len, compressed);
+		if (pglz_decompress(compressed, desc->len, raw, desc->rawlen,
+							true) != desc->rawlen)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg_internal("compressed columnar data is corrupt")));
+		pfree(compressed);
+	}
+	else
+		columnar_read_data(reader->rel, reader->strategy, stripe->blkno,
+						   desc->offset, desc->len, raw);
+
+	if (desc->flags & COLUMNAR_CHUNK_HAS_NULLS)
+	{
+		bitmap = (bits8 *) raw;
+		off = MAXALIGN(BITMAPLEN(nrows));
+	}
+
+	/*
+	 * Fixed-width values are stored for every row, nulls included, so that
+	 * they form a plain array.  Others are stored only for non-null rows.
+	 * Keep this in sync with columnar_encode_column().
+	 */
+	for (i = 0; i < nrows; i++)
+	{
+		bool		null = bitmap != NULL && att_isnull(i, bitmap);
+
+		isnull[i] = null;
+		if (att->attlen > 0)
+		{
+			off = att_align_nominal(off, att->attalign);
+			ptr = raw + off;
+			values[i] = null ? (Datum) 0 : fetchatt(att, ptr);
+			off += att->attlen;
+		}
+		else if (null)
+			values[i] = (Datum) 0;
+		else
+		{
+			off = att_align_nominal(off, att->attalign);
+			if (off >= desc->rawlen)
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg_internal("columnar data of column \"%s\" is corrupt",
+										 NameStr(att->attname))));
+			ptr = raw + off;
+			values[i] = PointerGetDatum(ptr);
+			off = att_addlength_pointer(off, att->attlen, ptr);
+		}
+
+		if (off > desc->rawlen)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg_internal("columnar data of column \"%s\" is corrupt",
+									 NameStr(att->attname))));
+	}
+}
+
+/*
+ * Decode the needed columns of a chunk of a stripe, unless that's the chunk
+ * we have already.
+ */
+void
+columnar_load_chunk(ColumnarReader *reader, int stripe, int chunkno)
+{
+	ColumnarChunk *chunk = &reader->chunk;
+	ColumnarStripe *s = &reader->stripes[stripe];
+	TupleDesc	tupdesc = RelationGetDescr(reader->rel);
+	MemoryContext oldcontext;
+	int			attno;
+
+	if (chunk->stripe == stripe && chunk->chunkno == chunkno)
+		return;
+
+	/* retire the previous chunk's memory */
+	if (chunk->context != NULL)
+	{
+		ColumnarRetiredChunk *r;
+
+		r = MemoryContextAlloc(reader->context, sizeof(ColumnarRetiredChunk));
+		r->context = chunk->context;
+		r->retired_at = reader->nreturned;
+		oldcontext = MemoryContextSwitchTo(reader->context);
+		reader->retired = lappend(reader->retired, r);
+		MemoryContextSwitchTo(oldcontext);
+		chunk->context = NULL;
+	}
+	columnar_free_retired(reader);
+
+	chunk->stripe = -1;
+	chunk->chunkno = -1;
+	chunk->context = AllocSetContextCreate(reader->context,
+										   "columnar chunk",
+										   ALLOCSET_DEFAULT_SIZES);
+
+	columnar_load_descs(reader, stripe);
+
+	chunk->first = chunkno * COLUMNAR_CHUNK_ROWS;
+	chunk->nrows = Min(s->hdr.nrows - chunk->first, COLUMNAR_CHUNK_ROWS);
+
+	oldcontext = MemoryContextSwitchTo(chunk->context);
+	for (attno = 0; attno < tupdesc->natts; attno++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, attno);
+		Datum	   *values;
+		bool	   *isnull;
+
+		chunk->values[attno] = NULL;
+		chunk->isnull[attno] = NULL;
+		if (!reader->needed[attno] || att->attisdropped)
+			continue;
+
+		values = palloc(chunk->nrows * sizeof(Datum));
+		isnull = palloc(chunk->nrows * sizeof(bool));
+
+		if (attno < s->hdr.natts)
+			columnar_decode_column(reader, s,
+								   &reader->descs[attno * s->hdr.nchunks + chunkno],
+								   att, chunk->nrows, values, isnull);
+		else
+		{
+			/* column added after the stripe was written */
+			Datum		missing;
+			bool		missingnull;
+			uint32		i;
+
+			missing = getmissingattr(tupdesc, attno + 1, &missingnull);
+			for (i = 0; i < chunk->nrows; i++)
+			{
+				values[i] = missing;
+				isnull[i] = missingnull;
+			}
+		}
+
+		chunk->values[attno] = values;
+		chunk->isnull[attno] = isnull;
+	}
+	MemoryContextSwitchTo(oldcontext);
+
+	chunk->stripe = stripe;
+	chunk->chunkno = chunkno;
+}
+
+/*
+ * Store row "row" of the current chunk in slot.  Columns we didn't decode
+ * are set to null.
+ */
+void
+columnar_store_row(ColumnarReader *reader, uint32 row, TupleTableSlot *slot)
+{
+	ColumnarChunk *chunk = &reader->chunk;
+	int			natts = slot->tts_tupleDescriptor->natts;
+	int			attno;
+
+	Assert(row < chunk->nrows);
+
+	ExecClearTuple(slot);
+	for (attno = 0; attno < natts; attno++)
+	{
+		if (chunk->values[attno] != NULL)
+		{
+			slot->tts_values[attno] = chunk->values[attno][row];
+			slot->tts_isnull[attno] = chunk->isnull[attno][row];
+		}
+		else
+		{
+			slot->tts_values[attno] = (Datum) 0;
+			slot->tts_isnull[attno] = true;
+		}
+	}
+	ExecStoreVirtualTuple(slot);
+
+	columnar_row_to_tid(reader->stripes[chunk->stripe].hdr.first_row +
+						chunk->first + row,
+						&slot->tts_tid);
+	reader->nreturned++;
+}
+
+/*
+ * Look up a row by its row number, and store it in slot if the reader can
+ * see it.
+ */
+bool
+columnar_fetch_row(ColumnarReader *reader, uint64 rownum, TupleTableSlot *slot)
+{
+	int			i;
+
+	for (i = 0; i < reader->nstripes; i++)
+	{
+		ColumnarStripeHeader *hdr = &reader->stripes[i].hdr;
+		uint32		row;
+
+		if (rownum < hdr->first_row || rownum >= hdr->first_row + hdr->nrows)
+			continue;
+
+		row = (uint32) (rownum - hdr->first_row);
+		columnar_load_chunk(reader, i, row / COLUMNAR_CHUNK_ROWS);
+		columnar_store_row(reader, row % COLUMNAR_CHUNK_ROWS, slot);
+		return true;
+	}
+
+	return false;
+}
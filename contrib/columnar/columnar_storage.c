@@ -0,0 +1,394 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_storage.c
+ *		Page-level storage of columnar tables.
+ *
+ * All pages are WAL-logged with generic WAL records.  A stripe's pages are
+ * written first and only then linked into the chain, together with the
+ * update of the metapage, so a crash in between just leaves some unused
+ * pages behind.
+ *
+ * Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/columnar/columnar_storage.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/generic_xlog.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "columnar.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "storage/lmgr.h"
+#include "storage/procarray.h"
+#include "utils/snapmgr.h"
+
+#define ColumnarPageGetMeta(page) \
+	((ColumnarMetaPageData *) PageGetContents(page))
+#define ColumnarPageGetStripeHeader(page) \
+	((ColumnarStripeHeader *) PageGetContents(page))
+
+/*
+ * Initialize a page to hold "len" bytes of contents.  pd_lower is set past
+ * them, so that a full-page image keeps them.
+ */
+static void
+columnar_init_page(Page page, Size len)
+{
+	Assert(len <= COLUMNAR_PAGE_DATA_SIZE);
+
+	PageInit(page, BLCKSZ, 0);
+	((PageHeader) page)->pd_lower = MAXALIGN(SizeOfPageHeaderData) + len;
+}
+
+/*
+ * Create the metapage of an empty relation.  Caller must hold the relation
+ * extension lock.
+ */
+static void
+columnar_create_metapage(Relation rel)
+{
+	Buffer		buffer;
+	GenericXLogState *state;
+	Page		page;
+	ColumnarMetaPageData *meta;
+
+	buffer = ReadBuffer(rel, P_NEW);
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+	Assert(BufferGetBlockNumber(buffer) == COLUMNAR_METAPAGE_BLKNO);
+
+	state = GenericXLogStart(rel);
+	page = GenericXLogRegisterBuffer(state, buffer, GENERIC_XLOG_FULL_IMAGE);
+	columnar_init_page(page, sizeof(ColumnarMetaPageData));
+	meta = ColumnarPageGetMeta(page);
+	meta->magic = COLUMNAR_MAGIC;
+	meta->version = COLUMNAR_VERSION;
+	meta->first_stripe = InvalidBlockNumber;
+	meta->last_stripe = InvalidBlockNumber;
+	meta->next_row = 0;
+	GenericXLogFinish(state);
+
+	UnlockReleaseBuffer(buffer);
+}
+
+/*
+ * Read and lock the metapage, creating it first if the relation is empty.
+ */
+static Buffer
+columnar_lock_metapage(Relation rel, int mode)
+{
+	Buffer		buffer;
+	ColumnarMetaPageData *meta;
+
+	if (RelationGetNumberOfBlocks(rel) == 0)
+	{
+		LockRelationForExtension(rel, ExclusiveLock);
+		if (RelationGetNumberOfBlocks(rel) == 0)
+			columnar_create_metapage(rel);
+		UnlockRelationForExtension(rel, ExclusiveLock);
+	}
+
+	buffer = ReadBuffer(rel, COLUMNAR_METAPAGE_BLKNO);
+	LockBuffer(buffer, mode);
+
+	meta = ColumnarPageGetMeta(BufferGetPage(buffer));
+	if (meta->magic != COLUMNAR_MAGIC)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("\"%s\" is not a columnar table",
+						RelationGetRelationName(rel))));
+	if (meta->version != COLUMNAR_VERSION)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("columnar table \"%s\" has wrong version %u, expected %u",
+						RelationGetRelationName(rel),
+						meta->version, COLUMNAR_VERSION)));
+
+	return buffer;
+}
+
+/*
+ * Read the metapage into *meta.  Returns false if the relation is empty and
+ * so has no metapage yet.
+ */
+bool
+columnar_read_metapage(Relation rel, ColumnarMetaPageData *meta)
+{
+	Buffer		buffer;
+
+	if (RelationGetNumberOfBlocks(rel) == 0)
+		return false;
+
+	buffer = columnar_lock_metapage(rel, BUFFER_LOCK_SHARE);
+	memcpy(meta, ColumnarPageGetMeta(BufferGetPage(buffer)),
+		   sizeof(ColumnarMetaPageData));
+	UnlockReleaseBuffer(buffer);
+
+	return true;
+}
+
+/*
+ * Reserve row numbers for a stripe of up to nrows rows, and return the first.
+ *
+ * Reserving them up front lets the inserts hand out TIDs before the stripe
+ * is written.  Numbers of rows that don't make it into the stripe are just
+ * never used.
+ */
+uint64
+columnar_reserve_rows(Relation rel, uint32 nrows)
+{
+	Buffer		buffer;
+	GenericXLogState *state;
+	ColumnarMetaPageData *meta;
+	uint64		first_row;
+
+	buffer = columnar_lock_metapage(rel, BUFFER_LOCK_EXCLUSIVE);
+
+	state = GenericXLogStart(rel);
+	meta = ColumnarPageGetMeta(GenericXLogRegisterBuffer(state, buffer, 0));
+	first_row = meta->next_row;
+	meta->next_row += nrows;
+	GenericXLogFinish(state);
+
+	UnlockReleaseBuffer(buffer);
+
+	return first_row;
+}
+
+/*
+ * Append a stripe to the relation.  "data" is the stripe's whole stream,
+ * starting with its ColumnarStripeHeader; its next_stripe and nblocks are
+ * filled in here.
+ */
+void
+columnar_write_stripe(Relation rel, char *data, uint32 len)
+{
+	ColumnarStripeHeader *hdr = (ColumnarStripeHeader *) data;
+	BlockNumber nblocks;
+	BlockNumber start = InvalidBlockNumber;
+	BlockNumber i;
+	Buffer		metabuf;
+	Buffer		lastbuf = InvalidBuffer;
+	GenericXLogState *state;
+	ColumnarMetaPageData *meta;
+
+	Assert(len >= ColumnarStripeDescsOffset);
+
+	nblocks = (len + COLUMNAR_PAGE_DATA_SIZE - 1) / COLUMNAR_PAGE_DATA_SIZE;
+	hdr->magic = COLUMNAR_MAGIC;
+	hdr->next_stripe = InvalidBlockNumber;
+	hdr->nblocks = nblocks;
+	hdr->datalen = len;
+
+	/* make sure there's a metapage before we add anything after it */
+	metabuf = columnar_lock_metapage(rel, BUFFER_LOCK_SHARE);
+	UnlockReleaseBuffer(metabuf);
+
+	/*
+	 * Holding the extension lock until the stripe is linked in keeps
+	 * concurrent writers from interleaving their pages with ours, and keeps
+	 * the chain in block order.
+	 */
+	LockRelationForExtension(rel, ExclusiveLock);
+
+	for (i = 0; i < nblocks;)
+	{
+		Buffer		buffers[MAX_GENERIC_XLOG_PAGES];
+		int			nbuffers = 0;
+		int			j;
+
+		state = GenericXLogStart(rel);
+		while (nbuffers < MAX_GENERIC_XLOG_PAGES && i < nblocks)
+		{
+			uint32		offset = i * COLUMNAR_PAGE_DATA_SIZE;
+			uint32		n = Min(len - offset, COLUMNAR_PAGE_DATA_SIZE);
+			Buffer		buffer;
+			Page		page;
+
+			buffer = ReadBuffer(rel, P_NEW);
+			LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+			if (i == 0)
+				start = BufferGetBlockNumber(buffer);
+			Assert(BufferGetBlockNumber(buffer) == start + i);
+
+			page = GenericXLogRegisterBuffer(state, buffer,
+											 GENERIC_XLOG_FULL_IMAGE);
+			columnar_init_page(page, n);
+			memcpy(PageGetContents(page), data + offset, n);
+
+			buffers[nbuffers++] = buffer;
+			i++;
+		}
+		GenericXLogFinish(state);
+
+		for (j = 0; j < nbuffers; j++)
+			UnlockReleaseBuffer(buffers[j]);
+	}
+
+	/* link it in */
+	metabuf = columnar_lock_metapage(rel, BUFFER_LOCK_EXCLUSIVE);
+	state = GenericXLogStart(rel);
+	meta = ColumnarPageGetMeta(GenericXLogRegisterBuffer(state, metabuf, 0));
+	if (meta->last_stripe != InvalidBlockNumber)
+	{
+		Page		lastpage;
+
+		lastbuf = ReadBuffer(rel, meta->last_stripe);
+		LockBuffer(lastbuf, BUFFER_LOCK_EXCLUSIVE);
+		lastpage = GenericXLogRegisterBuffer(state, lastbuf, 0);
+		ColumnarPageGetStripeHeader(lastpage)->next_stripe = start;
+	}
+	else
+		meta->first_stripe = start;
+	meta->last_stripe = start;
+	GenericXLogFinish(state);
+
+	if (BufferIsValid(lastbuf))
+		UnlockReleaseBuffer(lastbuf);
+	UnlockReleaseBuffer(metabuf);
+
+	UnlockRelationForExtension(rel, ExclusiveLock);
+}
+
+/*
+ * Return the headers of all stripes in the chain, in block order.
+ */
+ColumnarStripe *
+columnar_read_stripes(Relation rel, BufferAccessStrategy strategy,
+					  int *nstripes)
+{
+	ColumnarMetaPageData meta;
+	ColumnarStripe *stripes;
+	int			n = 0;
+	int			maxstripes = 16;
+	BlockNumber blkno;
+
+	*nstripes = 0;
+	if (!columnar_read_metapage(rel, &meta))
+		return NULL;
+
+	stripes = palloc(maxstripes * sizeof(ColumnarStripe));
+	for (blkno = meta.first_stripe; blkno != InvalidBlockNumber;)
+	{
+		Buffer		buffer;
+		ColumnarStripeHeader *hdr;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (n >= maxstripes)
+		{
+			maxstripes *= 2;
+			stripes = repalloc(stripes, maxstripes * sizeof(ColumnarStripe));
+		}
+
+		buffer = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+									strategy);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		hdr = ColumnarPageGetStripeHeader(BufferGetPage(buffer));
+		if (hdr->magic != COLUMNAR_MAGIC)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("invalid stripe header in block %u of columnar table \"%s\"",
+							blkno, RelationGetRelationName(rel))));
+		stripes[n].blkno = blkno;
+		memcpy(&stripes[n].hdr, hdr, sizeof(ColumnarStripeHeader));
+		UnlockReleaseBuffer(buffer);
+
+		blkno = stripes[n].hdr.next_stripe;
+		n++;
+	}
+
+	*nstripes = n;
+	return stripes;
+}
+
+/*
+ * Copy len bytes at offset in the stream of the stripe starting at block
+ * start to dest.
+ */
+void
+columnar_read_data(Relation rel, BufferAccessStrategy strategy,
+				   BlockNumber start, uint32 offset, uint32 len, char *dest)
+{
+	while (len > 0)
+	{
+		BlockNumber blkno = start + offset / COLUMNAR_PAGE_DATA_SIZE;
+		uint32		pageoff = offset % COLUMNAR_PAGE_DATA_SIZE;
+		uint32		n = Min(len, COLUMNAR_PAGE_DATA_SIZE - pageoff);
+		Buffer		buffer;
+
+		buffer = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+									strategy);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		memcpy(dest, PageGetContents(BufferGetPage(buffer)) + pageoff, n);
+		UnlockReleaseBuffer(buffer);
+
+		dest += n;
+		offset += n;
+		len -= n;
+	}
+}
+
+/*
+ * Change the xmin of a stripe, for VACUUM.
+ */
+void
+columnar_set_stripe_xmin(Relation rel, BlockNumber blkno, TransactionId xmin)
+{
+	Buffer		buffer;
+	GenericXLogState *state;
+	Page		page;
+
+	buffer = ReadBuffer(rel, blkno);
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+	state = GenericXLogStart(rel);
+	page = GenericXLogRegisterBuffer(state, buffer, 0);
+	ColumnarPageGetStripeHeader(page)->xmin = xmin;
+	GenericXLogFinish(state);
+
+	UnlockReleaseBuffer(buffer);
+}
+
+/*
+ * Can the rows of a stripe be seen with the given snapshot?
+ *
+ * This is HeapTupleSatisfiesVisibility() for a tuple that's never updated
+ * nor deleted.  A NULL snapshot, as ANALYZE uses, sees whatever's committed
+ * or inserted by our own transaction.
+ */
+bool
+columnar_stripe_visible(ColumnarStripeHeader *hdr, Snapshot snapshot)
+{
+	TransactionId xmin = hdr->xmin;
+
+	if (xmin == FrozenTransactionId)
+		return true;
+	if (!TransactionIdIsNormal(xmin))
+		return false;
+
+	if (snapshot != NULL && snapshot->snapshot_type == SNAPSHOT_ANY)
+		return true;
+
+	if (TransactionIdIsCurrentTransactionId(xmin))
+	{
+		if (snapshot != NULL && IsMVCCSnapshot(snapshot))
+			return hdr->cid < snapshot->curcid;
+		return true;
+	}
+
+	if (snapshot != NULL && IsMVCCSnapshot(snapshot))
+	{
+		if (XidInMVCCSnapshot(xmin, snapshot))
+			return false;
+		return TransactionIdDidCommit(xmin);
+	}
+
+	if (TransactionIdIsInProgress(xmin))
+		return false;
+	return TransactionIdDidCommit(xmin);
+}
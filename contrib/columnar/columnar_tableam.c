@@ -0,0 +1,899 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_tableam.c
+ *		Table access method for column-oriented storage.
+ *
+ * Rows can be inserted (INSERT, COPY, CREATE TABLE AS) and scanned; scans
+ * only decode the columns the executor asks for via scan_set_projection.
+ * Rows can't be updated, deleted or locked, and indexes aren't supported.
+ *
+ * Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/columnar/columnar_tableam.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/multixact.h"
+#include "access/tableam.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "catalog/index.h"
+#include "catalog/storage.h"
+#include "catalog/storage_xlog.h"
+#include "columnar.h"
+#include "commands/vacuum.h"
+#include "executor/tuptable.h"
+#include "miscadmin.h"
+#include "nodes/bitmapset.h"
+#include "pgstat.h"
+#include "storage/bufmgr.h"
+#include "storage/procarray.h"
+#include "storage/smgr.h"
+#include "utils/builtins.h"
+#include "utils/snapmgr.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(columnar_tableam_handler);
+
+void		_PG_init(void);
+
+typedef struct ColumnarScanDescData
+{
+	TableScanDescData rs_base;	/* AM independent part of the descriptor */
+
+	ColumnarReader *reader;
+	BufferAccessStrategy strategy;	/* access strategy for reads */
+
+	int			cur_stripe;		/* index into reader->stripes, or -1 */
+	int			cur_chunk;		/* chunk within that stripe */
+	uint32		cur_row;		/* next row within the chunk */
+
+	/* rows [analyze_row, analyze_end) of analyze_stripe are left to ANALYZE */
+	int			analyze_stripe;
+	uint32		analyze_row;
+	uint32		analyze_end;
+} ColumnarScanDescData;
+typedef struct ColumnarScanDescData *ColumnarScanDesc;
+
+static const TableAmRoutine columnar_methods;
+
+
+void
+_PG_init(void)
+{
+	columnar_init_write();
+}
+
+Datum
+columnar_tableam_handler(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_POINTER(&columnar_methods);
+}
+
+
+/* ------------------------------------------------------------------------
+ * Slot related callbacks
+ * ------------------------------------------------------------------------
+ */
+
+static const TupleTableSlotOps *
+columnar_slot_callbacks(Relation relation)
+{
+	/* the values point into the decoded chunks */
+	return &TTSOpsVirtual;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Scan callbacks
+ * ------------------------------------------------------------------------
+ */
+
+static TableScanDesc
+columnar_beginscan(Relation relation, Snapshot snapshot,
+				   int nkeys, ScanKey key,
+				   ParallelTableScanDesc parallel_scan,
+				   uint32 flags)
+{
+	ColumnarScanDesc scan;
+
+	if (nkeys > 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("scan keys are not supported on columnar tables")));
+
+	/* we have to see our own insertions */
+	columnar_flush_pending(relation);
+
+	RelationIncrementReferenceCount(relation);
+
+	scan = (ColumnarScanDesc) palloc0(sizeof(ColumnarScanDescData));
+	scan->rs_base.rs_rd = relation;
+	scan->rs_base.rs_snapshot = snapshot;
+	scan->rs_base.rs_nkeys = 0;
+	scan->rs_base.rs_flags = flags;
+	scan->rs_base.rs_parallel = parallel_scan;
+	if (parallel_scan != NULL)
+		scan->rs_base.rs_private =
+			palloc0(sizeof(ParallelBlockTableScanWorkerData));
+
+	/* like the heap, use a ring buffer for tables that wouldn't fit anyway */
+	if ((flags & SO_ALLOW_STRAT) &&
+		RelationGetNumberOfBlocks(relation) > NBuffers / 4)
+		scan->strategy = GetAccessStrategy(BAS_BULKREAD);
+
+	scan->reader = columnar_begin_read(relation, snapshot, scan->strategy);
+	scan->cur_stripe = -1;
+	scan->analyze_stripe = -1;
+
+	return (TableScanDesc) scan;
+}
+
+static void
+columnar_endscan(TableScanDesc sscan)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	columnar_end_read(scan->reader);
+
+	if (scan->strategy != NULL)
+		FreeAccessStrategy(scan->strategy);
+
+	RelationDecrementReferenceCount(scan->rs_base.rs_rd);
+
+	if (scan->rs_base.rs_flags & SO_TEMP_SNAPSHOT)
+		UnregisterSnapshot(scan->rs_base.rs_snapshot);
+
+	if (scan->rs_base.rs_private != NULL)
+		pfree(scan->rs_base.rs_private);
+	pfree(scan);
+}
+
+static void
+columnar_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
+				bool allow_strat, bool allow_sync, bool allow_pagemode)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	if (set_params)
+	{
+		if (allow_strat)
+			scan->rs_base.rs_flags |= SO_ALLOW_STRAT;
+		else
+			scan->rs_base.rs_flags &= ~SO_ALLOW_STRAT;
+	}
+
+	scan->cur_stripe = -1;
+	scan->cur_chunk = 0;
+	scan->cur_row = 0;
+}
+
+/*
+ * Find the stripe starting at blkno among the stripes we can see.
+ */
+static int
+columnar_find_stripe(ColumnarReader *reader, BlockNumber blkno, bool start)
+{
+	int			lo = 0;
+	int			hi = reader->nstripes - 1;
+
+	/* find the last stripe starting at or before blkno */
+	while (lo <= hi)
+	{
+		int			mid = lo + (hi - lo) / 2;
+
+		if (reader->stripes[mid].blkno <= blkno)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	if (hi < 0)
+		return -1;
+
+	if (start)
+		return reader->stripes[hi].blkno == blkno ? hi : -1;
+	return blkno < reader->stripes[hi].blkno + reader->stripes[hi].hdr.nblocks ?
+		hi : -1;
+}
+
+/*
+ * Move on to the next stripe to scan, or return -1 if there's none left.
+ * Parallel scans hand out blocks; whoever gets a stripe's first block scans
+ * the stripe.
+ */
+static int
+columnar_next_stripe(ColumnarScanDesc scan)
+{
+	ParallelBlockTableScanDesc pbscan;
+	ParallelBlockTableScanWorker pbscanwork;
+	Relation	rel = scan->rs_base.rs_rd;
+
+	if (scan->rs_base.rs_parallel == NULL)
+	{
+		if (scan->cur_stripe + 1 < scan->reader->nstripes)
+			return scan->cur_stripe + 1;
+		return -1;
+	}
+
+	pbscan = (ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
+	pbscanwork = (ParallelBlockTableScanWorker) scan->rs_base.rs_private;
+	if (scan->cur_stripe == -1)
+		table_block_parallelscan_startblock_init(rel, pbscanwork, pbscan);
+
+	for (;;)
+	{
+		BlockNumber blkno;
+		int			stripe;
+
+		blkno = table_block_parallelscan_nextpage(rel, pbscanwork, pbscan);
+		if (blkno == InvalidBlockNumber)
+			return -1;
+		stripe = columnar_find_stripe(scan->reader, blkno, true);
+		if (stripe >= 0)
+			return stripe;
+	}
+}
+
+static bool
+columnar_getnextslot(TableScanDesc sscan, ScanDirection direction,
+					 TupleTableSlot *slot)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	ColumnarReader *reader = scan->reader;
+
+	if (ScanDirectionIsBackward(direction))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("backward scans are not supported on columnar tables")));
+
+	for (;;)
+	{
+		int			stripe;
+
+		if (scan->cur_stripe >= 0)
+		{
+			if (scan->cur_row < reader->chunk.nrows)
+			{
+				columnar_store_row(reader, scan->cur_row++, slot);
+				return true;
+			}
+			if (scan->cur_chunk + 1 < reader->stripes[scan->cur_stripe].hdr.nchunks)
+			{
+				columnar_load_chunk(reader, scan->cur_stripe, ++scan->cur_chunk);
+				scan->cur_row = 0;
+				continue;
+			}
+		}
+
+		CHECK_FOR_INTERRUPTS();
+
+		stripe = columnar_next_stripe(scan);
+		if (stripe < 0)
+		{
+			ExecClearTuple(slot);
+			return false;
+		}
+		scan->cur_stripe = stripe;
+		scan->cur_chunk = 0;
+		scan->cur_row = 0;
+		columnar_load_chunk(reader, stripe, 0);
+	}
+}
+
+static void
+columnar_scan_set_projection(TableScanDesc sscan, Bitmapset *attrs)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	int			natts = RelationGetDescr(scan->rs_base.rs_rd)->natts;
+	int			attno;
+
+	for (attno = 0; attno < natts; attno++)
+		scan->reader->needed[attno] =
+			bms_is_member(attno + 1 - FirstLowInvalidHeapAttributeNumber, attrs);
+}
+
+
+/* ------------------------------------------------------------------------
+ * Parallel scan callbacks
+ * ------------------------------------------------------------------------
+ */
+
+static Size
+columnar_parallelscan_initialize(Relation rel, ParallelTableScanDesc pscan)
+{
+	/* the block count has to include our own insertions, see beginscan */
+	columnar_flush_pending(rel);
+
+	return table_block_parallelscan_initialize(rel, pscan);
+}
+
+
+/* ------------------------------------------------------------------------
+ * Index scan callbacks
+ * ------------------------------------------------------------------------
+ */
+
+static IndexFetchTableData *
+columnar_index_fetch_begin(Relation rel)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("indexes are not supported on columnar tables")));
+	return NULL;				/* keep compiler quiet */
+}
+
+static void
+columnar_index_fetch_reset(IndexFetchTableData *scan)
+{
+	elog(ERROR, "columnar_index_fetch_reset not implemented");
+}
+
+static void
+columnar_index_fetch_end(IndexFetchTableData *scan)
+{
+	elog(ERROR, "columnar_index_fetch_end not implemented");
+}
+
+static bool
+columnar_index_fetch_tuple(IndexFetchTableData *scan, ItemPointer tid,
+						   Snapshot snapshot, TupleTableSlot *slot,
+						   bool *call_again, bool *all_dead)
+{
+	elog(ERROR, "columnar_index_fetch_tuple not implemented");
+	return false;				/* keep compiler quiet */
+}
+
+
+/* ------------------------------------------------------------------------
+ * Callbacks for non-modifying operations on individual tuples
+ * ------------------------------------------------------------------------
+ */
+
+static bool
+columnar_fetch_row_version(Relation relation, ItemPointer tid,
+						   Snapshot snapshot, TupleTableSlot *slot)
+{
+	ColumnarReader *reader;
+	bool		found;
+
+	columnar_flush_pending(relation);
+
+	reader = columnar_begin_read(relation, snapshot, NULL);
+	found = columnar_fetch_row(reader, columnar_tid_to_row(tid), slot);
+	if (found)
+	{
+		/* the reader's memory is going away */
+		ExecMaterializeSlot(slot);
+		slot->tts_tableOid = RelationGetRelid(relation);
+	}
+	columnar_end_read(reader);
+
+	return found;
+}
+
+static bool
+columnar_tuple_tid_valid(TableScanDesc scan, ItemPointer tid)
+{
+	return ItemPointerIsValid(tid);
+}
+
+static void
+columnar_get_latest_tid(TableScanDesc sscan, ItemPointer tid)
+{
+	/* rows are never updated */
+}
+
+static bool
+columnar_tuple_satisfies_snapshot(Relation rel, TupleTableSlot *slot,
+								  Snapshot snapshot)
+{
+	uint64		rownum = columnar_tid_to_row(&slot->tts_tid);
+	ColumnarStripe *stripes;
+	int			nstripes;
+	int			i;
+
+	stripes = columnar_read_stripes(rel, NULL, &nstripes);
+	for (i = 0; i < nstripes; i++)
+	{
+		ColumnarStripeHeader *hdr = &stripes[i].hdr;
+
+		if (rownum >= hdr->first_row && rownum < hdr->first_row + hdr->nrows)
+			return columnar_stripe_visible(hdr, snapshot);
+	}
+	return false;
+}
+
+static TransactionId
+columnar_compute_xid_horizon_for_tuples(Relation rel,
+										ItemPointerData *tids,
+										int nitems)
+{
+	elog(ERROR, "columnar_compute_xid_horizon_for_tuples not implemented");
+	return InvalidTransactionId;	/* keep compiler quiet */
+}
+
+
+/* ----------------------------------------------------------------------------
+ *  Functions for manipulations of physical tuples
+ * ----------------------------------------------------------------------------
+ */
+
+static void
+columnar_tuple_insert(Relation relation, TupleTableSlot *slot, CommandId cid,
+					  int options, BulkInsertState bistate)
+{
+	slot->tts_tableOid = RelationGetRelid(relation);
+	columnar_insert(relation, slot, cid);
+}
+
+static void
+columnar_tuple_insert_speculative(Relation relation, TupleTableSlot *slot,
+								  CommandId cid, int options,
+								  BulkInsertState bistate, uint32 specToken)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("ON CONFLICT is not supported on columnar tables")));
+}
+
+static void
+columnar_tuple_complete_speculative(Relation relation, TupleTableSlot *slot,
+									uint32 specToken, bool succeeded)
+{
+	elog(ERROR, "columnar_tuple_complete_speculative not implemented");
+}
+
+static void
+columnar_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
+					  CommandId cid, int options, BulkInsertState bistate)
+{
+	int			i;
+
+	for (i = 0; i < ntuples; i++)
+	{
+		slots[i]->tts_tableOid = RelationGetRelid(relation);
+		columnar_insert(relation, slots[i], cid);
+	}
+}
+
+static TM_Result
+columnar_tuple_delete(Relation relation, ItemPointer tid, CommandId cid,
+					  Snapshot snapshot, Snapshot crosscheck, bool wait,
+					  TM_FailureData *tmfd, bool changingPart)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("UPDATE and DELETE are not supported on columnar tables")));
+	return TM_Ok;				/* keep compiler quiet */
+}
+
+static TM_Result
+columnar_tuple_update(Relation relation, ItemPointer otid, TupleTableSlot *slot,
+					  CommandId cid, Snapshot snapshot, Snapshot crosscheck,
+					  bool wait, TM_FailureData *tmfd,
+					  LockTupleMode *lockmode, TU_UpdateIndexes *update_indexes)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("UPDATE and DELETE are not supported on columnar tables")));
+	return TM_Ok;				/* keep compiler quiet */
+}
+
+static TM_Result
+columnar_tuple_lock(Relation relation, ItemPointer tid, Snapshot snapshot,
+					TupleTableSlot *slot, CommandId cid, LockTupleMode mode,
+					LockWaitPolicy wait_policy, uint8 flags,
+					TM_FailureData *tmfd)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("row-level locks are not supported on columnar tables")));
+	return TM_Ok;				/* keep compiler quiet */
+}
+
+static void
+columnar_finish_bulk_insert(Relation relation, int options)
+{
+	columnar_flush_pending(relation);
+}
+
+
+/* ------------------------------------------------------------------------
+ * DDL related callbacks
+ * ------------------------------------------------------------------------
+ */
+
+static void
+columnar_relation_set_new_filenode(Relation rel,
+								   const RelFileNode *newrnode,
+								   char persistence,
+								   TransactionId *freezeXid,
+								   MultiXactId *minmulti)
+{
+	SMgrRelation srel;
+
+	/*
+	 * Rows buffered for a TRUNCATE'd table still belong in the old
+	 * relfilenode, in case the TRUNCATE is rolled back.
+	 */
+	columnar_flush_pending(rel);
+
+	/* see heapam_relation_set_new_filenode() */
+	*freezeXid = RecentXmin;
+	*minmulti = GetOldestMultiXactId();
+
+	srel = RelationCreateStorage(*newrnode, persistence);
+
+	/* an empty init fork resets an unlogged table to empty, as for heaps */
+	if (persistence == RELPERSISTENCE_UNLOGGED)
+	{
+		smgrcreate(srel, INIT_FORKNUM, false);
+		log_smgrcreate(newrnode, INIT_FORKNUM);
+		smgrimmedsync(srel, INIT_FORKNUM);
+	}
+
+	smgrclose(srel);
+}
+
+static void
+columnar_relation_nontransactional_truncate(Relation rel)
+{
+	columnar_discard_pending(rel);
+	RelationTruncate(rel, 0);
+}
+
+static void
+columnar_relation_copy_data(Relation rel, const RelFileNode *newrnode)
+{
+	SMgrRelation dstrel;
+
+	columnar_flush_pending(rel);
+
+	/* see heapam_relation_copy_data() */
+	dstrel = smgropen(*newrnode, rel->rd_backend);
+	RelationOpenSmgr(rel);
+
+	FlushRelationBuffers(rel);
+
+	RelationCreateStorage(*newrnode, rel->rd_rel->relpersistence);
+
+	RelationCopyStorage(rel->rd_smgr, dstrel, MAIN_FORKNUM,
+						rel->rd_rel->relpersistence);
+
+	for (ForkNumber forkNum = MAIN_FORKNUM + 1;
+		 forkNum <= MAX_FORKNUM; forkNum++)
+	{
+		if (smgrexists(rel->rd_smgr, forkNum))
+		{
+			smgrcreate(dstrel, forkNum, false);
+			if (rel->rd_rel->relpersistence == RELPERSISTENCE_PERMANENT ||
+				(rel->rd_rel->relpersistence == RELPERSISTENCE_UNLOGGED &&
+				 forkNum == INIT_FORKNUM))
+				log_smgrcreate(newrnode, forkNum);
+			RelationCopyStorage(rel->rd_smgr, dstrel, forkNum,
+								rel->rd_rel->relpersistence);
+		}
+	}
+
+	RelationDropStorage(rel);
+	smgrclose(dstrel);
+}
+
+static void
+columnar_relation_copy_for_cluster(Relation OldTable, Relation NewTable,
+								   Relation OldIndex, bool use_sort,
+								   TransactionId OldestXmin,
+								   TransactionId *xid_cutoff,
+								   MultiXactId *multi_cutoff,
+								   double *num_tuples,
+								   double *tups_vacuumed,
+								   double *tups_recently_dead)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("CLUSTER and VACUUM FULL are not supported on columnar tables")));
+}
+
+/*
+ * VACUUM freezes the stripes old enough, and marks those of aborted
+ * transactions dead, so that the XIDs in the stripe headers can be
+ * forgotten.  The space of dead stripes isn't reclaimed.
+ */
+static void
+columnar_relation_vacuum(Relation rel, VacuumParams *params,
+						 BufferAccessStrategy bstrategy)
+{
+	TransactionId OldestXmin;
+	TransactionId FreezeLimit;
+	TransactionId xidFullScanLimit;
+	MultiXactId MultiXactCutoff;
+	MultiXactId mxactFullScanLimit;
+	ColumnarStripe *stripes;
+	int			nstripes;
+	double		live_rows = 0;
+	double		dead_rows = 0;
+	int			i;
+
+	vacuum_set_xid_limits(rel,
+						  params->freeze_min_age,
+						  params->freeze_table_age,
+						  params->multixact_freeze_min_age,
+						  params->multixact_freeze_table_age,
+						  &OldestXmin, &FreezeLimit, &xidFullScanLimit,
+						  &MultiXactCutoff, &mxactFullScanLimit);
+
+	stripes = columnar_read_stripes(rel, bstrategy, &nstripes);
+	for (i = 0; i < nstripes; i++)
+	{
+		ColumnarStripeHeader *hdr = &stripes[i].hdr;
+		TransactionId xmin = hdr->xmin;
+
+		vacuum_delay_point();
+
+		if (xmin == FrozenTransactionId)
+			live_rows += hdr->nrows;
+		else if (!TransactionIdIsNormal(xmin))
+			continue;
+		else if (TransactionIdPrecedes(xmin, OldestXmin))
+		{
+			if (TransactionIdDidCommit(xmin))
+			{
+				if (TransactionIdPrecedes(xmin, FreezeLimit))
+					columnar_set_stripe_xmin(rel, stripes[i].blkno,
+											 FrozenTransactionId);
+				live_rows += hdr->nrows;
+			}
+			else
+			{
+				columnar_set_stripe_xmin(rel, stripes[i].blkno,
+										 InvalidTransactionId);
+				dead_rows += hdr->nrows;
+			}
+		}
+		else if (!TransactionIdIsInProgress(xmin) &&
+				 TransactionIdDidCommit(xmin))
+			live_rows += hdr->nrows;
+	}
+
+	/* everything older than FreezeLimit is frozen or gone now */
+	vac_update_relstats(rel,
+						RelationGetNumberOfBlocks(rel),
+						live_rows,
+						0,
+						rel->rd_rel->relhasindex,
+						FreezeLimit,
+						MultiXactCutoff,
+						false);
+
+	pgstat_report_vacuum(RelationGetRelid(rel),
+						 rel->rd_rel->relisshared,
+						 live_rows, dead_rows);
+}
+
+/*
+ * ANALYZE samples blocks, so give it the rows of each stripe spread evenly
+ * over the stripe's blocks.
+ */
+static bool
+columnar_scan_analyze_next_block(TableScanDesc sscan, BlockNumber blockno,
+								 BufferAccessStrategy bstrategy)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	ColumnarStripe *stripe;
+	int			i;
+	uint64		nrows;
+	BlockNumber nblocks;
+	BlockNumber n;
+
+	i = columnar_find_stripe(scan->reader, blockno, false);
+	if (i < 0)
+		return false;
+
+	stripe = &scan->reader->stripes[i];
+	nrows = stripe->hdr.nrows;
+	nblocks = stripe->hdr.nblocks;
+	n = blockno - stripe->blkno;
+
+	scan->analyze_stripe = i;
+	scan->analyze_row = (uint32) (nrows * n / nblocks);
+	scan->analyze_end = (uint32) (nrows * (n + 1) / nblocks);
+
+	return true;
+}
+
+static bool
+columnar_scan_analyze_next_tuple(TableScanDesc sscan, TransactionId OldestXmin,
+								 double *liverows, double *deadrows,
+								 TupleTableSlot *slot)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	uint32		row;
+
+	if (scan->analyze_stripe < 0 || scan->analyze_row >= scan->analyze_end)
+		return false;
+
+	row = scan->analyze_row++;
+	columnar_load_chunk(scan->reader, scan->analyze_stripe,
+						row / COLUMNAR_CHUNK_ROWS);
+	columnar_store_row(scan->reader, row % COLUMNAR_CHUNK_ROWS, slot);
+	*liverows += 1;
+
+	return true;
+}
+
+static double
+columnar_index_build_range_scan(Relation tableRelation,
+								Relation indexRelation,
+								IndexInfo *indexInfo,
+								bool allow_sync,
+								bool anyvisible,
+								bool progress,
+								BlockNumber start_blockno,
+								BlockNumber numblocks,
+								IndexBuildCallback callback,
+								void *callback_state,
+								TableScanDesc scan)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("indexes are not supported on columnar tables")));
+	return 0;					/* keep compiler quiet */
+}
+
+static void
+columnar_index_validate_scan(Relation tableRelation,
+							 Relation indexRelation,
+							 IndexInfo *indexInfo,
+							 Snapshot snapshot,
+							 ValidateIndexState *state)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("indexes are not supported on columnar tables")));
+}
+
+
+/* ------------------------------------------------------------------------
+ * Miscellaneous callbacks
+ * ------------------------------------------------------------------------
+ */
+
+static bool
+columnar_relation_needs_toast_table(Relation rel)
+{
+	/* large values are stored inline, compressed with the rest */
+	return false;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Planner related callbacks
+ * ------------------------------------------------------------------------
+ */
+
+static void
+columnar_estimate_rel_size(Relation rel, int32 *attr_widths,
+						   BlockNumber *pages, double *tuples,
+						   double *allvisfrac)
+{
+	BlockNumber curpages = RelationGetNumberOfBlocks(rel);
+	BlockNumber relpages = (BlockNumber) rel->rd_rel->relpages;
+	double		reltuples = rel->rd_rel->reltuples;
+
+	*pages = curpages;
+	*allvisfrac = 0;
+
+	if (reltuples >= 0 && relpages > 0)
+	{
+		/* scale by the growth since the last VACUUM or ANALYZE */
+		*tuples = rint(reltuples / relpages * curpages);
+	}
+	else
+	{
+		ColumnarStripe *stripes;
+		int			nstripes;
+		int			i;
+
+		/* never analyzed; the stripe headers have the row counts */
+		*tuples = 0;
+		stripes = columnar_read_stripes(rel, NULL, &nstripes);
+		for (i = 0; i < nstripes; i++)
+		{
+			if (stripes[i].hdr.xmin != InvalidTransactionId)
+				*tuples += stripes[i].hdr.nrows;
+		}
+		if (stripes != NULL)
+			pfree(stripes);
+	}
+}
+
+
+/* ------------------------------------------------------------------------
+ * Executor related callbacks
+ * ------------------------------------------------------------------------
+ */
+
+static bool
+columnar_scan_sample_next_block(TableScanDesc scan, SampleScanState *scanstate)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("TABLESAMPLE is not supported on columnar tables")));
+	return false;				/* keep compiler quiet */
+}
+
+static bool
+columnar_scan_sample_next_tuple(TableScanDesc scan, SampleScanState *scanstate,
+								TupleTableSlot *slot)
+{
+	elog(ERROR, "columnar_scan_sample_next_tuple not implemented");
+	return false;				/* keep compiler quiet */
+}
+
+
+/* ------------------------------------------------------------------------
+ * Definition of the columnar table access method.
+ * ------------------------------------------------------------------------
+ */
+
+static const TableAmRoutine columnar_methods = {
+	.type = T_TableAmRoutine,
+
+	.slot_callbacks = columnar_slot_callbacks,
+
+	.scan_begin = columnar_beginscan,
+	.scan_end = columnar_endscan,
+	.scan_rescan = columnar_rescan,
+	.scan_getnextslot = columnar_getnextslot,
+	.scan_set_projection = columnar_scan_set_projection,
+
+	.parallelscan_estimate = table_block_parallelscan_estimate,
+	.parallelscan_initialize = columnar_parallelscan_initialize,
+	.parallelscan_reinitialize = table_block_parallelscan_reinitialize,
+
+	.index_fetch_begin = columnar_index_fetch_begin,
+	.index_fetch_reset = columnar_index_fetch_reset,
+	.index_fetch_end = columnar_index_fetch_end,
+	.index_fetch_tuple = columnar_index_fetch_tuple,
+
+	.tuple_insert = columnar_tuple_insert,
+	.tuple_insert_speculative = columnar_tuple_insert_speculative,
+	.tuple_complete_speculative = columnar_tuple_complete_speculative,
+	.multi_insert = columnar_multi_insert,
+	.tuple_delete = columnar_tuple_delete,
+	.tuple_update = columnar_tuple_update,
+	.tuple_lock = columnar_tuple_lock,
+	.finish_bulk_insert = columnar_finish_bulk_insert,
+
+	.tuple_fetch_row_version = columnar_fetch_row_version,
+	.tuple_get_latest_tid = columnar_get_latest_tid,
+	.tuple_tid_valid = columnar_tuple_tid_valid,
+	.tuple_satisfies_snapshot = columnar_tuple_satisfies_snapshot,
+	.compute_xid_horizon_for_tuples = columnar_compute_xid_horizon_for_tuples,
+
+	.relation_set_new_filenode = columnar_relation_set_new_filenode,
+	.relation_nontransactional_truncate = columnar_relation_nontransactional_truncate,
+	.relation_copy_data = columnar_relation_copy_data,
+	.relation_copy_for_cluster = columnar_relation_copy_for_cluster,
+	.relation_vacuum = columnar_relation_vacuum,
+	.scan_analyze_next_block = columnar_scan_analyze_next_block,
+	.scan_analyze_next_tuple = columnar_scan_analyze_next_tuple,
+	.index_build_range_scan = columnar_index_build_range_scan,
+	.index_validate_scan = columnar_index_validate_scan,
+
+	.relation_size = table_block_relation_size,
+	.relation_needs_toast_table = columnar_relation_needs_toast_table,
+
+	.relation_estimate_size = columnar_estimate_rel_size,
+
+	.scan_sample_next_block = columnar_scan_sample_next_block,
+	.scan_sample_next_tuple = columnar_scan_sample_next_tuple
+};
@@ -0,0 +1,478 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_write.c
+ *		Buffering and encoding of rows inserted into columnar tables.
+ *
+ * Inserted rows are collected in memory, per table, until there are enough
+ * for a stripe, the inserting command or subtransaction changes, somebody
+ * wants to read the table, or the transaction commits.  Then they're
+ * written out as one stripe.  Buffered rows of an aborted (sub)transaction
+ * are simply forgotten.
+ *
+ * Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/columnar/columnar_write.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/detoast.h"
+#include "access/relation.h"
+#include "access/table.h"
+#include "access/tupmacs.h"
+#include "access/xact.h"
+#include "columnar.h"
+#include "common/pg_lzcompress.h"
+#include "executor/tuptable.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "utils/datum.h"
+#include "utils/memutils.h"
+
+/* Rows buffered for one table */
+typedef struct ColumnarWriteState
+{
+	Oid			relid;
+	SubTransactionId subxid;	/* subtransaction that inserted them */
+	TransactionId xid;			/* and its XID */
+	CommandId	cid;			/* inserting command */
+	uint64		first_row;		/* first of the reserved row numbers */
+	uint32		nrows;
+	uint32		maxrows;		/* allocated length of the arrays */
+	TupleDesc	tupdesc;
+	Datum	  **values;			/* values[attno][row] */
+	bool	  **isnull;
+	MemoryContext context;		/* holds all of the above */
+} ColumnarWriteState;
+
+/* List of ColumnarWriteState, in TopTransactionContext */
+static List *pending_writes = NIL;
+
+static void columnar_flush(Relation rel, ColumnarWriteState *state);
+static void columnar_xact_callback(XactEvent event, void *arg);
+static void columnar_subxact_callback(SubXactEvent event,
+									  SubTransactionId mySubid,
+									  SubTransactionId parentSubid,
+									  void *arg);
+
+static ColumnarWriteState *
+columnar_find_pending(Oid relid)
+{
+	ListCell   *lc;
+
+	foreach(lc, pending_writes)
+	{
+		ColumnarWriteState *state = lfirst(lc);
+
+		if (state->relid == relid)
+			return state;
+	}
+	return NULL;
+}
+
+static void
+columnar_forget_pending(ColumnarWriteState *state)
+{
+	pending_writes = list_delete_ptr(pending_writes, state);
+	MemoryContextDelete(state->context);
+}
+
+/*
+ * Start buffering rows for rel.
+ */
+static ColumnarWriteState *
+columnar_start_pending(Relation rel, CommandId cid)
+{
+	MemoryContext context;
+	MemoryContext oldcontext;
+	ColumnarWriteState *state;
+	int			natts = RelationGetDescr(rel)->natts;
+
+	context = AllocSetContextCreate(TopTransactionContext,
+									"columnar write buffer",
+									ALLOCSET_DEFAULT_SIZES);
+	oldcontext = MemoryContextSwitchTo(context);
+
+	state = palloc0(sizeof(ColumnarWriteState));
+	state->relid = RelationGetRelid(rel);
+	state->subxid = GetCurrentSubTransactionId();
+	state->xid = GetCurrentTransactionId();
+	state->cid = cid;
+	state->first_row = columnar_reserve_rows(rel, COLUMNAR_STRIPE_ROWS);
+	state->tupdesc = CreateTupleDescCopy(RelationGetDescr(rel));
+	state->values = palloc0(natts * sizeof(Datum *));
+	state->isnull = palloc0(natts * sizeof(bool *));
+	state->context = context;
+
+	MemoryContextSwitchTo(TopTransactionContext);
+	pending_writes = lappend(pending_writes, state);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
+/*
+ * Add the row in slot to the rows buffered for rel, and set the slot's TID.
+ */
+void
+columnar_insert(Relation rel, TupleTableSlot *slot, CommandId cid)
+{
+	ColumnarWriteState *state = columnar_find_pending(RelationGetRelid(rel));
+	MemoryContext oldcontext;
+	int			natts;
+	int			attno;
+
+	if (state != NULL &&
+		(state->cid != cid ||
+		 state->subxid != GetCurrentSubTransactionId() ||
+		 state->nrows >= COLUMNAR_STRIPE_ROWS ||
+		 state->tupdesc->natts != RelationGetDescr(rel)->natts ||
+		 MemoryContextMemAllocated(state->context, true) >= COLUMNAR_STRIPE_MEMORY))
+	{
+		columnar_flush(rel, state);
+		state = NULL;
+	}
+	if (state == NULL)
+		state = columnar_start_pending(rel, cid);
+
+	natts = state->tupdesc->natts;
+	slot_getallattrs(slot);
+
+	oldcontext = MemoryContextSwitchTo(state->context);
+
+	if (state->nrows >= state->maxrows)
+	{
+		uint32		maxrows = Max(state->maxrows * 2, 64);
+
+		maxrows = Min(maxrows, COLUMNAR_STRIPE_ROWS);
+		for (attno = 0; attno < natts; attno++)
+		{
+			if (state->maxrows == 0)
+			{
+				state->values[attno] = palloc(maxrows * sizeof(Datum));
+				state->isnull[attno] = palloc(maxrows * sizeof(bool));
+			}
+			else
+			{
+				state->values[attno] = repalloc(state->values[attno],
+												maxrows * sizeof(Datum));
+				state->isnull[attno] = repalloc(state->isnull[attno],
+												maxrows * sizeof(bool));
+			}
+		}
+		state->maxrows = maxrows;
+	}
+
+	for (attno = 0; attno < natts; attno++)
+	{
+		Form_pg_attribute att = TupleDescAttr(state->tupdesc, attno);
+		Datum		value = slot->tts_values[attno];
+		bool		isnull = slot->tts_isnull[attno] || att->attisdropped;
+
+		if (isnull)
+			value = (Datum) 0;
+		else if (att->attlen == -1 &&
+				 VARATT_IS_EXTENDED(DatumGetPointer(value)))
+		{
+			/* we store varlenas plain, with a 4-byte header */
+			value = PointerGetDatum(detoast_attr((struct varlena *)
+												 DatumGetPointer(value)));
+		}
+		else
+			value = datumCopy(value, att->attbyval, att->attlen);
+
+		state->values[attno][state->nrows] = value;
+		state->isnull[attno][state->nrows] = isnull;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	columnar_row_to_tid(state->first_row + state->nrows, &slot->tts_tid);
+	state->nrows++;
+}
+
+/*
+ * Append one column of rows [first, first + nrows) to buf, as
+ * columnar_decode_column() expects them, and fill in desc.
+ */
+static void
+columnar_encode_column(StringInfo buf, ColumnarWriteState *state, int attno,
+					   uint32 first, uint32 nrows, ColumnarChunkDesc *desc)
+{
+	Form_pg_attribute att = TupleDescAttr(state->tupdesc, attno);
+	Datum	   *values = state->values[attno] + first;
+	bool	   *isnull = state->isnull[attno] + first;
+	StringInfoData raw;
+	bool		hasnulls = false;
+	bool		allnull = true;
+	char	   *compressed;
+	int32		clen;
+	uint32		i;
+
+	desc->offset = buf->len;
+	desc->len = 0;
+	desc->rawlen = 0;
+	desc->flags = 0;
+
+	for (i = 0; i < nrows; i++)
+	{
+		if (isnull[i])
+			hasnulls = true;
+		else
+			allnull = false;
+	}
+	if (allnull)
+	{
+		desc->flags = COLUMNAR_CHUNK_ALL_NULL;
+		return;
+	}
+
+	initStringInfo(&raw);
+
+	if (hasnulls)
+	{
+		bits8	   *bitmap;
+
+		desc->flags |= COLUMNAR_CHUNK_HAS_NULLS;
+		enlargeStringInfo(&raw, MAXALIGN(BITMAPLEN(nrows)));
+		bitmap = (bits8 *) raw.data;
+		memset(bitmap, 0, MAXALIGN(BITMAPLEN(nrows)));
+		for (i = 0; i < nrows; i++)
+		{
+			if (!isnull[i])
+				bitmap[i / 8] |= 1 << (i % 8);
+		}
+		raw.len = MAXALIGN(BITMAPLEN(nrows));
+	}
+
+	for (i = 0; i < nrows; i++)
+	{
+		uint32		off;
+		Size		len;
+
+		/* fixed-width values are stored even for nulls */
+		if (isnull[i] && att->attlen < 0)
+			continue;
+
+		off = att_align_nominal(raw.len, att->attalign);
+		if (att->attlen > 0)
+			len = att->attlen;
+		else if (att->attlen == -1)
+			len = VARSIZE(DatumGetPointer(values[i]));
+		else
+			len = strlen(DatumGetCString(values[i])) + 1;
+
+		enlargeStringInfo(&raw, off - raw.len + len);
+		memset(raw.data + raw.len, 0, off - raw.len);
+		if (isnull[i])
+			memset(raw.data + off, 0, len);
+		else if (att->attbyval)
+			store_att_byval(raw.data + off, values[i], att->attlen);
+		else
+			memcpy(raw.data + off, DatumGetPointer(values[i]), len);
+		raw.len = off + len;
+	}
+
+	desc->rawlen = raw.len;
+
+	compressed = palloc(PGLZ_MAX_OUTPUT(raw.len));
+	clen = pglz_compress(raw.data, raw.len, compressed,
+						 PGLZ_strategy_default);
+	if (clen >= 0)
+	{
+		desc->flags |= COLUMNAR_CHUNK_COMPRESSED;
+		desc->len = clen;
+		appendBinaryStringInfo(buf, compressed, clen);
+	}
+	else
+	{
+		desc->len = raw.len;
+		appendBinaryStringInfo(buf, raw.data, raw.len);
+	}
+
+	pfree(compressed);
+	pfree(raw.data);
+}
+
+/*
+ * Write the rows buffered in state as a stripe of rel, and forget them.
+ */
+static void
+columnar_flush(Relation rel, ColumnarWriteState *state)
+{
+	TupleDesc	tupdesc = state->tupdesc;
+	int			natts = tupdesc->natts;
+	int			nchunks;
+	StringInfoData buf;
+	ColumnarStripeHeader *hdr;
+	ColumnarChunkDesc *descs;
+	MemoryContext oldcontext;
+	int			attno;
+	int			chunkno;
+
+	if (state->nrows == 0)
+	{
+		columnar_forget_pending(state);
+		return;
+	}
+
+	oldcontext = MemoryContextSwitchTo(state->context);
+
+	nchunks = (state->nrows + COLUMNAR_CHUNK_ROWS - 1) / COLUMNAR_CHUNK_ROWS;
+	descs = palloc(natts * nchunks * sizeof(ColumnarChunkDesc));
+
+	initStringInfo(&buf);
+	enlargeStringInfo(&buf, ColumnarStripeDataOffset(natts, nchunks));
+	memset(buf.data, 0, ColumnarStripeDataOffset(natts, nchunks));
+	buf.len = ColumnarStripeDataOffset(natts, nchunks);
+
+	for (attno = 0; attno < natts; attno++)
+	{
+		for (chunkno = 0; chunkno < nchunks; chunkno++)
+		{
+			uint32		first = chunkno * COLUMNAR_CHUNK_ROWS;
+
+			CHECK_FOR_INTERRUPTS();
+			columnar_encode_column(&buf, state, attno, first,
+								   Min(state->nrows - first, COLUMNAR_CHUNK_ROWS),
+								   &descs[attno * nchunks + chunkno]);
+		}
+	}
+
+	memcpy(buf.data + ColumnarStripeDescsOffset, descs,
+		   natts * nchunks * sizeof(ColumnarChunkDesc));
+	hdr = (ColumnarStripeHeader *) buf.data;
+	hdr->xmin = state->xid;
+	hdr->cid = state->cid;
+	hdr->nrows = state->nrows;
+	hdr->first_row = state->first_row;
+	hdr->natts = natts;
+	hdr->nchunks = nchunks;
+
+	columnar_write_stripe(rel, buf.data, buf.len);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	columnar_forget_pending(state);
+}
+
+/*
+ * Write out the rows buffered for rel, as they must be before anybody reads
+ * rel.
+ */
+void
+columnar_flush_pending(Relation rel)
+{
+	ColumnarWriteState *state = columnar_find_pending(RelationGetRelid(rel));
+
+	if (state != NULL)
+		columnar_flush(rel, state);
+}
+
+/*
+ * Forget the rows buffered for rel, because they were all removed anyway.
+ */
+void
+columnar_discard_pending(Relation rel)
+{
+	ColumnarWriteState *state = columnar_find_pending(RelationGetRelid(rel));
+
+	if (state != NULL)
+		columnar_forget_pending(state);
+}
+
+/*
+ * Write out what's buffered for all tables.
+ */
+static void
+columnar_flush_all(void)
+{
+	while (pending_writes != NIL)
+	{
+		ColumnarWriteState *state = linitial(pending_writes);
+		Relation	rel;
+
+		/* the table might have been dropped since */
+		rel = try_relation_open(state->relid, NoLock);
+		if (rel == NULL)
+		{
+			columnar_forget_pending(state);
+			continue;
+		}
+		columnar_flush(rel, state);
+		relation_close(rel, NoLock);
+	}
+}
+
+static void
+columnar_xact_callback(XactEvent event, void *arg)
+{
+	switch (event)
+	{
+		case XACT_EVENT_PRE_COMMIT:
+		case XACT_EVENT_PARALLEL_PRE_COMMIT:
+		case XACT_EVENT_PRE_PREPARE:
+			columnar_flush_all();
+			break;
+
+		case XACT_EVENT_COMMIT:
+		case XACT_EVENT_PARALLEL_COMMIT:
+		case XACT_EVENT_ABORT:
+		case XACT_EVENT_PARALLEL_ABORT:
+		case XACT_EVENT_PREPARE:
+			/* the buffers go away with TopTransactionContext */
+			pending_writes = NIL;
+			break;
+	}
+}
+
+static void
+columnar_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+						  SubTransactionId parentSubid, void *arg)
+{
+	ListCell   *lc;
+
+	switch (event)
+	{
+		case SUBXACT_EVENT_START_SUB:
+		case SUBXACT_EVENT_PRE_COMMIT_SUB:
+			break;
+
+		case SUBXACT_EVENT_COMMIT_SUB:
+			/* the rows are the parent's now */
+			foreach(lc, pending_writes)
+			{
+				ColumnarWriteState *state = lfirst(lc);
+
+				if (state->subxid == mySubid)
+					state->subxid = parentSubid;
+			}
+			break;
+
+		case SUBXACT_EVENT_ABORT_SUB:
+			foreach(lc, pending_writes)
+			{
+				ColumnarWriteState *state = lfirst(lc);
+
+				if (state->subxid == mySubid)
+				{
+					pending_writes = foreach_delete_current(pending_writes, lc);
+					MemoryContextDelete(state->context);
+				}
+			}
+			break;
+	}
+}
+
+/*
+ * Called at module load.
+ */
+void
+columnar_init_write(void)
+{
+	RegisterXactCallback(columnar_xact_callback, NULL);
+	RegisterSubXactCallback(columnar_subxact_callback, NULL);
+}
@@ -0,0 +1,60 @@
+CREATE EXTENSION columnar;
+
+CREATE TABLE tst (
+	i	int4,
+	t	text,
+	n	numeric
+) USING columnar;
+
+INSERT INTO tst SELECT i, 'row ' || i, i / 7.0 FROM generate_series(1, 25000) i;
+SELECT count(*), sum(i), count(DISTINCT t) FROM tst;
+SELECT i, t, round(n, 2) FROM tst WHERE i IN (1, 10000, 10001, 25000) ORDER BY i;
+
+-- nulls, and chunks that are all null
+INSERT INTO tst SELECT NULL, CASE WHEN i % 2 = 0 THEN 'even' END, NULL
+	FROM generate_series(1, 12000) i;
+SELECT count(*), count(i), count(t), count(n) FROM tst;
+
+-- rows of an aborted transaction or subtransaction are not visible
+BEGIN;
+INSERT INTO tst VALUES (-1, 'aborted', 0);
+ROLLBACK;
+BEGIN;
+INSERT INTO tst VALUES (-2, 'kept', 0);
+SAVEPOINT s1;
+INSERT INTO tst VALUES (-3, 'rolled back', 0);
+ROLLBACK TO s1;
+SELECT i, t FROM tst WHERE i < 0 ORDER BY i;
+COMMIT;
+SELECT i, t FROM tst WHERE i < 0 ORDER BY i;
+
+-- the buffered rows of an open transaction are visible to it
+BEGIN;
+INSERT INTO tst VALUES (-4, 'pending', 0);
+SELECT count(*) FROM tst WHERE i = -4;
+COMMIT;
+
+-- columns added later
+ALTER TABLE tst ADD COLUMN d int4 DEFAULT 42;
+SELECT count(*), min(d), max(d) FROM tst;
+
+-- COPY and CREATE TABLE AS
+CREATE TABLE tst2 USING columnar AS SELECT i, t FROM tst WHERE i <= 100;
+COPY tst2 FROM stdin;
+101	copied
+\N	\N
+\.
+SELECT count(*), count(i), max(i) FROM tst2;
+
+VACUUM tst;
+SELECT count(*) FROM tst;
+
+TRUNCATE tst2;
+SELECT count(*) FROM tst2;
+
+-- unsupported operations
+UPDATE tst SET i = 0 WHERE i = 1;
+DELETE FROM tst WHERE i = 1;
+CREATE INDEX ON tst (i);
+
+DROP TABLE tst, tst2;
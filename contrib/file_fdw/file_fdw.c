@@ -16,6 +16,7 @@
 #include <unistd.h>
 
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/reloptions.h"
 #include "access/sysattr.h"
 #include "access/table.h"
@@ -27,12 +28,16 @@
 #include "commands/vacuum.h"
 #include "foreign/fdwapi.h"
 #include "foreign/foreign.h"
+#include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
+#include "optimizer/cost.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
 #include "optimizer/planmain.h"
 #include "optimizer/restrictinfo.h"
+#include "port/atomics.h"
 #include "utils/acl.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
@@ -75,6 +80,9 @@ static const struct FileFdwOption valid_options[] = {
 	{"force_not_null", AttributeRelationId},
 	{"force_null", AttributeRelationId},
 
+	/* Parallel scan options */
+	{"quoted_newlines", ForeignTableRelationId},
+
 	/*
 	 * force_quote is not supported by file_fdw because it's for COPY TO.
 	 */
@@ -96,6 +104,21 @@ typedef struct FileFdwPlanState
 	double		ntuples;		/* estimate of number of data rows */
 } FileFdwPlanState;
 
+/*
+ * Shared state of a parallel scan, in the DSM segment.
+ *
+ * The processes taking part in the scan claim chunks of PARALLEL_CHUNK_SIZE
+ * bytes of the file in turn, and read the lines that start in them; see
+ * CopyFromSetRange.
+ */
+#define PARALLEL_CHUNK_SIZE		(1024 * 1024)
+
+typedef struct FileFdwParallelState
+{
+	off_t		file_size;		/* size of the file when the scan started */
+	pg_atomic_uint64 next_chunk;	/* offset of the next chunk to claim */
+} FileFdwParallelState;
+
 /*
  * FDW-specific information for ForeignScanState.fdw_state.
  */
@@ -106,6 +129,8 @@ typedef struct FileFdwExecutionState
 	List	   *options;		/* merged COPY options, excluding filename and
 								 * is_program */
 	CopyState	cstate;			/* COPY execution state */
+	FileFdwParallelState *pstate;	/* shared state, if scanning in parallel */
+	bool		in_chunk;		/* reading a chunk claimed from pstate? */
 } FileFdwExecutionState;
 
 /*
@@ -140,6 +165,17 @@ static bool fileAnalyzeForeignTable(Relation relation,
 									BlockNumber *totalpages);
 static bool fileIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
 										  RangeTblEntry *rte);
+static Size fileEstimateDSMForeignScan(ForeignScanState *node,
+									   ParallelContext *pcxt);
+static void fileInitializeDSMForeignScan(ForeignScanState *node,
+										 ParallelContext *pcxt,
+										 void *coordinate);
+static void fileReInitializeDSMForeignScan(ForeignScanState *node,
+										   ParallelContext *pcxt,
+										   void *coordinate);
+static void fileInitializeWorkerForeignScan(ForeignScanState *node,
+											shm_toc *toc,
+											void *coordinate);
 
 /*
  * Helper functions
@@ -157,7 +193,11 @@ static void estimate_size(PlannerInfo *root, RelOptInfo *baserel,
 						  FileFdwPlanState *fdw_private);
 static void estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 						   FileFdwPlanState *fdw_private,
+						   double parallel_divisor,
 						   Cost *startup_cost, Cost *total_cost);
+static bool file_is_splittable(Oid foreigntableid,
+							   FileFdwPlanState *fdw_private);
+static bool file_next_chunk(FileFdwExecutionState *festate);
 static int	file_acquire_sample_rows(Relation onerel, int elevel,
 									 HeapTuple *rows, int targrows,
 									 double *totalrows, double *totaldeadrows);
@@ -182,6 +222,10 @@ file_fdw_handler(PG_FUNCTION_ARGS)
 	fdwroutine->EndForeignScan = fileEndForeignScan;
 	fdwroutine->AnalyzeForeignTable = fileAnalyzeForeignTable;
 	fdwroutine->IsForeignScanParallelSafe = fileIsForeignScanParallelSafe;
+	fdwroutine->EstimateDSMForeignScan = fileEstimateDSMForeignScan;
+	fdwroutine->InitializeDSMForeignScan = fileInitializeDSMForeignScan;
+	fdwroutine->ReInitializeDSMForeignScan = fileReInitializeDSMForeignScan;
+	fdwroutine->InitializeWorkerForeignScan = fileInitializeWorkerForeignScan;
 
 	PG_RETURN_POINTER(fdwroutine);
 }
@@ -309,6 +353,9 @@ file_fdw_validator(PG_FUNCTION_ARGS)
 			force_null = def;
 			(void) defGetBoolean(def);
 		}
+		/* quoted_newlines is only for planning, see file_is_splittable() */
+		else if (strcmp(def->defname, "quoted_newlines") == 0)
+			(void) defGetBoolean(def);
 		else
 			other_options = lappend(other_options, def);
 	}
@@ -406,6 +453,15 @@ fileGetOptions(Oid foreigntableid,
 		}
 	}
 
+	/* quoted_newlines is not a COPY option, either */
+	foreach(lc, options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "quoted_newlines") == 0)
+			options = foreach_delete_current(options, lc);
+	}
+
 	/*
 	 * The validator should have checked that filename or program was included
 	 * in the options, but check again, just in case.
@@ -526,7 +582,8 @@ fileGetForeignRelSize(PlannerInfo *root,
  *
  *		Currently we don't support any push-down feature, so there is only one
  *		possible access path, which simply returns all records in the order in
- *		the data file.
+ *		the data file; or two, if the file can also be split among parallel
+ *		workers.
  */
 static void
 fileGetForeignPaths(PlannerInfo *root,
@@ -547,7 +604,7 @@ fileGetForeignPaths(PlannerInfo *root,
 										  (Node *) columns, -1));
 
 	/* Estimate costs */
-	estimate_costs(root, baserel, fdw_private,
+	estimate_costs(root, baserel, fdw_private, 1.0,
 				   &startup_cost, &total_cost);
 
 	/*
@@ -570,6 +627,53 @@ fileGetForeignPaths(PlannerInfo *root,
 									 NULL,	/* no extra plan */
 									 coptions));
 
+	/*
+	 * If the file can be split at line boundaries, also offer a partial path
+	 * whose workers each read the lines in some chunks of the file.  We size
+	 * the number of workers on the file just like a heap of the same size.
+	 */
+	if (baserel->consider_parallel &&
+		file_is_splittable(foreigntableid, fdw_private))
+	{
+		int			parallel_workers;
+
+		parallel_workers = compute_parallel_worker(baserel,
+												   fdw_private->pages, -1,
+												   max_parallel_workers_per_gather);
+		if (parallel_workers > 0)
+		{
+			ForeignPath *path;
+			double		parallel_divisor = parallel_workers;
+
+			/* Same leader contribution as get_parallel_divisor() assumes */
+			if (parallel_leader_participation)
+			{
+				double		leader_contribution;
+
+				leader_contribution = 1.0 - (0.3 * parallel_workers);
+				if (leader_contribution > 0)
+					parallel_divisor += leader_contribution;
+			}
+
+			estimate_costs(root, baserel, fdw_private, parallel_divisor,
+						   &startup_cost, &total_cost);
+
+			path = create_foreignscan_path(root, baserel,
+										   NULL,	/* default pathtarget */
+										   clamp_row_est(baserel->rows /
+														 parallel_divisor),
+										   startup_cost,
+										   total_cost,
+										   NIL, /* no pathkeys */
+										   baserel->lateral_relids,
+										   NULL,	/* no extra plan */
+										   coptions);
+			path->path.parallel_aware = true;
+			path->path.parallel_workers = parallel_workers;
+			add_partial_path(baserel, (Path *) path);
+		}
+	}
+
 	/*
 	 * If data file was sorted, and we knew it somehow, we could insert
 	 * appropriate pathkeys into the ForeignPath node to tell the planner
@@ -692,6 +796,8 @@ fileBeginForeignScan(ForeignScanState *node, int eflags)
 	festate->is_program = is_program;
 	festate->options = options;
 	festate->cstate = cstate;
+	festate->pstate = NULL;
+	festate->in_chunk = false;
 
 	node->fdw_state = (void *) festate;
 }
@@ -728,8 +834,22 @@ fileIterateForeignScan(ForeignScanState *node)
 	 * foreign tables.
 	 */
 	ExecClearTuple(slot);
-	found = NextCopyFrom(festate->cstate, NULL,
-						 slot->tts_values, slot->tts_isnull);
+	for (;;)
+	{
+		/* In a parallel scan, move on to the next chunk when needed */
+		if (festate->pstate && !festate->in_chunk &&
+			!file_next_chunk(festate))
+		{
+			found = false;
+			break;
+		}
+
+		found = NextCopyFrom(festate->cstate, NULL,
+							 slot->tts_values, slot->tts_isnull);
+		if (found || festate->pstate == NULL)
+			break;
+		festate->in_chunk = false;
+	}
 	if (found)
 		ExecStoreVirtualTuple(slot);
 
@@ -757,6 +877,7 @@ fileReScanForeignScan(ForeignScanState *node)
 									NULL,
 									NIL,
 									festate->options);
+	festate->in_chunk = false;
 }
 
 /*
@@ -835,6 +956,105 @@ fileIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
 	return true;
 }
 
+/*
+ * fileEstimateDSMForeignScan
+ *		Estimate the size of the shared state of a parallel scan
+ */
+static Size
+fileEstimateDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt)
+{
+	return sizeof(FileFdwParallelState);
+}
+
+/*
+ * fileInitializeDSMForeignScan
+ *		Set up the shared state of a parallel scan
+ */
+static void
+fileInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+							 void *coordinate)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+	FileFdwParallelState *pstate = (FileFdwParallelState *) coordinate;
+	struct stat stat_buf;
+
+	/*
+	 * Chunks are only handed out up to the size the file has now.  A line
+	 * that is being appended at the end is still read whole, by whoever
+	 * gets the last chunk.
+	 */
+	if (stat(festate->filename, &stat_buf) < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m",
+						festate->filename)));
+
+	pstate->file_size = stat_buf.st_size;
+	pg_atomic_init_u64(&pstate->next_chunk, 0);
+	festate->pstate = pstate;
+}
+
+/*
+ * fileReInitializeDSMForeignScan
+ *		Reset the shared state of a parallel scan before a rescan
+ */
+static void
+fileReInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+							   void *coordinate)
+{
+	FileFdwParallelState *pstate = (FileFdwParallelState *) coordinate;
+
+	pg_atomic_write_u64(&pstate->next_chunk, 0);
+}
+
+/*
+ * fileInitializeWorkerForeignScan
+ *		Attach a parallel worker to the shared state of a parallel scan
+ */
+static void
+fileInitializeWorkerForeignScan(ForeignScanState *node, shm_toc *toc,
+								void *coordinate)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+
+	festate->pstate = (FileFdwParallelState *) coordinate;
+}
+
+/*
+ * file_next_chunk
+ *		Claim the next chunk of the file in a parallel scan, and set up the
+ *		CopyState to read the lines that start in it
+ *
+ * Returns false if there are no chunks left.
+ */
+static bool
+file_next_chunk(FileFdwExecutionState *festate)
+{
+	FileFdwParallelState *pstate = festate->pstate;
+	uint64		start;
+	uint64		end;
+
+	start = pg_atomic_fetch_add_u64(&pstate->next_chunk, PARALLEL_CHUNK_SIZE);
+	if (start >= (uint64) pstate->file_size)
+		return false;
+	end = Min(start + PARALLEL_CHUNK_SIZE, (uint64) pstate->file_size);
+
+	/*
+	 * If the input turns out not to be splittable after all, say because the
+	 * client encoding has changed since planning, whoever claims the first
+	 * chunk reads the whole file and the others read nothing.
+	 */
+	if (!CopyFromSetRange(festate->cstate, (off_t) start, (off_t) end))
+	{
+		if (start != 0)
+			return false;
+		festate->pstate = NULL;
+	}
+
+	festate->in_chunk = true;
+	return true;
+}
+
 /*
  * check_selective_binary_conversion
  *
@@ -1047,11 +1267,15 @@ estimate_size(PlannerInfo *root, RelOptInfo *baserel,
 /*
  * Estimate costs of scanning a foreign table.
  *
+ * For a parallel scan, parallel_divisor is the share of the rows each
+ * process is expected to handle; it is 1.0 otherwise.
+ *
  * Results are returned in *startup_cost and *total_cost.
  */
 static void
 estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 			   FileFdwPlanState *fdw_private,
+			   double parallel_divisor,
 			   Cost *startup_cost, Cost *total_cost)
 {
 	BlockNumber pages = fdw_private->pages;
@@ -1069,15 +1293,70 @@ estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 	 * from reality, but we have no good alternative; and it's not clear that
 	 * the numbers we produce here matter much anyway, since there's only one
 	 * access path for the rel.
+	 *
+	 * As in cost_seqscan(), a parallel scan divides the CPU costs among the
+	 * processes, but not the I/O costs.
 	 */
 	run_cost += seq_page_cost * pages;
 
 	*startup_cost = baserel->baserestrictcost.startup;
 	cpu_per_tuple = cpu_tuple_cost * 10 + baserel->baserestrictcost.per_tuple;
-	run_cost += cpu_per_tuple * ntuples;
+	run_cost += cpu_per_tuple * ntuples / parallel_divisor;
 	*total_cost = *startup_cost + run_cost;
 }
 
+/*
+ * Check whether the file can be split at line boundaries for a parallel
+ * scan; see CopyFromSetRange.
+ *
+ * That takes a plain file in text or CSV format, with a character encoding
+ * in which newlines and backslashes are always single-byte characters.  In
+ * CSV format, quoted fields could contain newlines too, unless the user has
+ * told us otherwise with the quoted_newlines option.
+ */
+static bool
+file_is_splittable(Oid foreigntableid, FileFdwPlanState *fdw_private)
+{
+	ForeignTable *table;
+	bool		csv_mode = false;
+	bool		quoted_newlines = true;
+	int			file_encoding = pg_get_client_encoding();
+	ListCell   *lc;
+
+	if (fdw_private->is_program)
+		return false;
+
+	foreach(lc, fdw_private->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "format") == 0)
+		{
+			char	   *format = defGetString(def);
+
+			if (strcmp(format, "binary") == 0)
+				return false;
+			csv_mode = (strcmp(format, "csv") == 0);
+		}
+		else if (strcmp(def->defname, "encoding") == 0)
+			file_encoding = pg_char_to_encoding(defGetString(def));
+	}
+
+	if (file_encoding < 0 || PG_ENCODING_IS_CLIENT_ONLY(file_encoding))
+		return false;
+
+	table = GetForeignTable(foreigntableid);
+	foreach(lc, table->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "quoted_newlines") == 0)
+			quoted_newlines = defGetBoolean(def);
+	}
+
+	return !csv_mode || !quoted_newlines;
+}
+
 /*
  * file_acquire_sample_rows -- acquire a random sample of rows from the table
  *
@@ -11,12 +11,18 @@
 #include "access/htup_details.h"
 #include "catalog/pg_type.h"
 #include "funcapi.h"
+#include "miscadmin.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "utils/array.h"
+#include "utils/hsearch.h"
 
 
 #define NUM_BUFFERCACHE_PAGES_MIN_ELEM	8
 #define NUM_BUFFERCACHE_PAGES_ELEM	9
+#define NUM_BUFFERCACHE_SUMMARY_ELEM	5
+#define NUM_BUFFERCACHE_USAGE_COUNTS_ELEM	4
+#define NUM_BUFFERCACHE_RELATIONS_ELEM	8
 
 PG_MODULE_MAGIC;
 
@@ -44,6 +50,19 @@ typedef struct
 } BufferCachePagesRec;
 
 
+/*
+ * Per-relation-fork counters of pg_buffercache_relations().
+ */
+typedef struct
+{
+	BufferTag	key;			/* blockNum is always InvalidBlockNumber */
+	int32		buffers;
+	int32		buffers_dirty;
+	int32		buffers_pinned;
+	int32		usage_counts[BM_MAX_USAGE_COUNT + 1];
+} BufferCacheRelationEntry;
+
+
 /*
  * Function context for data persisting over repeated calls.
  */
@@ -237,3 +256,265 @@ pg_buffercache_pages(PG_FUNCTION_ARGS)
 	else
 		SRF_RETURN_DONE(funcctx);
 }
+
+
+/*
+ * The functions below aggregate over the whole buffer cache in a single pass,
+ * without materializing a row per buffer.  Unlike pg_buffercache_pages, they
+ * don't take the buffer header locks either: each buffer's state is read
+ * atomically, but its tag may change concurrently, so the results are only
+ * approximate.  That's fine for getting an overview, and it keeps the
+ * functions cheap enough to run regularly on very large caches.
+ */
+
+/*
+ * Read the state of a buffer, and if it's in use, its tag, without locking
+ * the buffer header.  Returns false if the buffer is unused.
+ */
+static bool
+read_buffer_unlocked(BufferDesc *bufHdr, uint32 *buf_state, BufferTag *tag)
+{
+	*buf_state = pg_atomic_read_u32(&bufHdr->state);
+	if (!((*buf_state & BM_VALID) && (*buf_state & BM_TAG_VALID)))
+		return false;
+	if (tag)
+		*tag = bufHdr->tag;
+	return true;
+}
+
+/*
+ * Set up a tuplestore to return a set of rows into, and check that the
+ * caller expects natts columns.
+ */
+static Tuplestorestate *
+begin_materialized_result(FunctionCallInfo fcinfo, int natts,
+						  TupleDesc *tupdesc)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	MemoryContext oldcontext;
+	Tuplestorestate *tupstore;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+
+	if (get_call_result_type(fcinfo, NULL, tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+	if ((*tupdesc)->natts != natts)
+		elog(ERROR, "incorrect number of output arguments");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = *tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return tupstore;
+}
+
+/*
+ * Return a single row summarizing the whole buffer cache.
+ */
+PG_FUNCTION_INFO_V1(pg_buffercache_summary);
+
+Datum
+pg_buffercache_summary(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupledesc;
+	Datum		values[NUM_BUFFERCACHE_SUMMARY_ELEM];
+	bool		nulls[NUM_BUFFERCACHE_SUMMARY_ELEM];
+	int32		buffers_used = 0;
+	int32		buffers_unused = 0;
+	int32		buffers_dirty = 0;
+	int32		buffers_pinned = 0;
+	int64		usagecount_total = 0;
+	int			i;
+
+	if (get_call_result_type(fcinfo, NULL, &tupledesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+	if (tupledesc->natts != NUM_BUFFERCACHE_SUMMARY_ELEM)
+		elog(ERROR, "incorrect number of output arguments");
+
+	for (i = 0; i < NBuffers; i++)
+	{
+		uint32		buf_state;
+
+		if (!read_buffer_unlocked(GetBufferDescriptor(i), &buf_state, NULL))
+		{
+			buffers_unused++;
+			continue;
+		}
+
+		buffers_used++;
+		usagecount_total += BUF_STATE_GET_USAGECOUNT(buf_state);
+		if (buf_state & BM_DIRTY)
+			buffers_dirty++;
+		if (BUF_STATE_GET_REFCOUNT(buf_state) > 0)
+			buffers_pinned++;
+	}
+
+	memset(nulls, 0, sizeof(nulls));
+	values[0] = Int32GetDatum(buffers_used);
+	values[1] = Int32GetDatum(buffers_unused);
+	values[2] = Int32GetDatum(buffers_dirty);
+	values[3] = Int32GetDatum(buffers_pinned);
+	if (buffers_used > 0)
+		values[4] = Float8GetDatum((double) usagecount_total / buffers_used);
+	else
+		nulls[4] = true;
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(BlessTupleDesc(tupledesc),
+													  values, nulls)));
+}
+
+/*
+ * Return the distribution of the usage counts of the buffers in use, one row
+ * per usage count.
+ */
+PG_FUNCTION_INFO_V1(pg_buffercache_usage_counts);
+
+Datum
+pg_buffercache_usage_counts(PG_FUNCTION_ARGS)
+{
+	Tuplestorestate *tupstore;
+	TupleDesc	tupdesc;
+	int32		buffers[BM_MAX_USAGE_COUNT + 1] = {0};
+	int32		dirty[BM_MAX_USAGE_COUNT + 1] = {0};
+	int32		pinned[BM_MAX_USAGE_COUNT + 1] = {0};
+	int			i;
+
+	tupstore = begin_materialized_result(fcinfo,
+										 NUM_BUFFERCACHE_USAGE_COUNTS_ELEM,
+										 &tupdesc);
+
+	for (i = 0; i < NBuffers; i++)
+	{
+		uint32		buf_state;
+		int			usage_count;
+
+		if (!read_buffer_unlocked(GetBufferDescriptor(i), &buf_state, NULL))
+			continue;
+
+		usage_count = BUF_STATE_GET_USAGECOUNT(buf_state);
+		buffers[usage_count]++;
+		if (buf_state & BM_DIRTY)
+			dirty[usage_count]++;
+		if (BUF_STATE_GET_REFCOUNT(buf_state) > 0)
+			pinned[usage_count]++;
+	}
+
+	for (i = 0; i <= BM_MAX_USAGE_COUNT; i++)
+	{
+		Datum		values[NUM_BUFFERCACHE_USAGE_COUNTS_ELEM];
+		bool		nulls[NUM_BUFFERCACHE_USAGE_COUNTS_ELEM];
+
+		memset(nulls, 0, sizeof(nulls));
+		values[0] = Int32GetDatum(i);
+		values[1] = Int32GetDatum(buffers[i]);
+		values[2] = Int32GetDatum(dirty[i]);
+		values[3] = Int32GetDatum(pinned[i]);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Return one row per relation fork with buffers in the cache, with the
+ * number of its buffers and their usage count distribution.
+ */
+PG_FUNCTION_INFO_V1(pg_buffercache_relations);
+
+Datum
+pg_buffercache_relations(PG_FUNCTION_ARGS)
+{
+	Tuplestorestate *tupstore;
+	TupleDesc	tupdesc;
+	HASHCTL		ctl;
+	HTAB	   *relations;
+	HASH_SEQ_STATUS status;
+	BufferCacheRelationEntry *entry;
+	int			i;
+
+	tupstore = begin_materialized_result(fcinfo,
+										 NUM_BUFFERCACHE_RELATIONS_ELEM,
+										 &tupdesc);
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(BufferTag);
+	ctl.entrysize = sizeof(BufferCacheRelationEntry);
+	ctl.hcxt = CurrentMemoryContext;
+	relations = hash_create("pg_buffercache relations", 1024, &ctl,
+							HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	for (i = 0; i < NBuffers; i++)
+	{
+		uint32		buf_state;
+		BufferTag	tag;
+		bool		found;
+
+		if (!read_buffer_unlocked(GetBufferDescriptor(i), &buf_state, &tag))
+			continue;
+
+		tag.blockNum = InvalidBlockNumber;
+		entry = (BufferCacheRelationEntry *)
+			hash_search(relations, &tag, HASH_ENTER, &found);
+		if (!found)
+		{
+			entry->buffers = 0;
+			entry->buffers_dirty = 0;
+			entry->buffers_pinned = 0;
+			memset(entry->usage_counts, 0, sizeof(entry->usage_counts));
+		}
+
+		entry->buffers++;
+		if (buf_state & BM_DIRTY)
+			entry->buffers_dirty++;
+		if (BUF_STATE_GET_REFCOUNT(buf_state) > 0)
+			entry->buffers_pinned++;
+		entry->usage_counts[BUF_STATE_GET_USAGECOUNT(buf_state)]++;
+	}
+
+	hash_seq_init(&status, relations);
+	while ((entry = (BufferCacheRelationEntry *) hash_seq_search(&status)) != NULL)
+	{
+		Datum		values[NUM_BUFFERCACHE_RELATIONS_ELEM];
+		bool		nulls[NUM_BUFFERCACHE_RELATIONS_ELEM];
+		Datum		counts[BM_MAX_USAGE_COUNT + 1];
+
+		for (i = 0; i <= BM_MAX_USAGE_COUNT; i++)
+			counts[i] = Int32GetDatum(entry->usage_counts[i]);
+
+		memset(nulls, 0, sizeof(nulls));
+		values[0] = ObjectIdGetDatum(entry->key.rnode.relNode);
+		values[1] = ObjectIdGetDatum(entry->key.rnode.spcNode);
+		values[2] = ObjectIdGetDatum(entry->key.rnode.dbNode);
+		values[3] = Int16GetDatum(entry->key.forkNum);
+		values[4] = Int32GetDatum(entry->buffers);
+		values[5] = Int32GetDatum(entry->buffers_dirty);
+		values[6] = Int32GetDatum(entry->buffers_pinned);
+		values[7] = PointerGetDatum(construct_array(counts,
+													BM_MAX_USAGE_COUNT + 1,
+													INT4OID, sizeof(int32),
+													true, TYPALIGN_INT));
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	hash_destroy(relations);
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
@@ -0,0 +1,59 @@
+CREATE EXTENSION pg_buffercache;
+
+select count(*) = (select setting::bigint
+                   from pg_settings
+                   where name = 'shared_buffers')
+from pg_buffercache;
+
+-- The summary functions don't lock the buffer headers, but without
+-- concurrent activity their results match each other
+select buffers_used + buffers_unused = (select count(*) from pg_buffercache),
+       buffers_used = (select count(*) from pg_buffercache
+                       where relfilenode is not null),
+       buffers_dirty <= buffers_used,
+       buffers_pinned <= buffers_used,
+       usagecount_avg between 0 and 5
+from pg_buffercache_summary();
+
+select array_agg(usage_count order by usage_count) as usage_counts,
+       sum(buffers) = (select buffers_used from pg_buffercache_summary()),
+       sum(dirty) = (select buffers_dirty from pg_buffercache_summary())
+from pg_buffercache_usage_counts();
+
+create table bufc (a int);
+insert into bufc select generate_series(1, 1000);
+
+select r.buffers > 0,
+       r.buffers = (select count(*) from pg_buffercache b
+                    where b.relfilenode = r.relfilenode and
+                          b.reldatabase = r.reldatabase and
+                          b.relforknumber = r.relforknumber),
+       r.buffers_dirty <= r.buffers,
+       cardinality(r.usage_counts),
+       (select sum(c) from unnest(r.usage_counts) c) = r.buffers
+from pg_buffercache_relations() r
+where r.relfilenode = pg_relation_filenode('bufc') and
+      r.reldatabase = (select oid from pg_database
+                       where datname = current_database()) and
+      r.relforknumber = 0;
+
+-- Check that the functions / views can't be accessed by default.
+create role regress_buffercache_user;
+set role regress_buffercache_user;
+select count(*) > 0 from pg_buffercache;
+select buffers_used > 0 from pg_buffercache_summary();
+select count(*) > 0 from pg_buffercache_usage_counts();
+select count(*) > 0 from pg_buffercache_relations();
+reset role;
+
+-- pg_monitor is allowed access.
+grant pg_monitor to regress_buffercache_user;
+set role regress_buffercache_user;
+select count(*) > 0 from pg_buffercache;
+select buffers_used > 0 from pg_buffercache_summary();
+select count(*) > 0 from pg_buffercache_usage_counts();
+select count(*) > 0 from pg_buffercache_relations();
+reset role;
+
+drop table bufc;
+drop role regress_buffercache_user;
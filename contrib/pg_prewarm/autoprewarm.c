@@ -10,11 +10,16 @@
  *		and we need to lock the relations so that we don't try to prewarm
  *		pages from a relation that is in the process of being dropped.
  *
- *		While prewarming, autoprewarm will use two workers.  There's a
- *		leader worker that reads and sorts the list of blocks to be
- *		prewarmed and then launches a per-database worker for each
- *		relevant database in turn.  The former keeps running after the
- *		initial prewarm is complete to update the dump file periodically.
+ *		While prewarming, there's a leader worker that reads and sorts the
+ *		list of blocks to be prewarmed and then, for each relevant database
+ *		in turn, launches up to autoprewarm_workers per-database workers.
+ *		Those divide the ranges of consecutive blocks to be read among
+ *		themselves, and read each range with as few large reads as
+ *		possible.  Optionally, the workers first go through the list for
+ *		the blocks of indexes, starting with the internal pages of btree
+ *		indexes, so that index scans get fast as early as possible.  The
+ *		leader keeps running after the initial prewarm is complete to
+ *		update the dump file periodically.
  *
  *	Copyright (c) 2016-2020, PostgreSQL Global Development Group
  *
@@ -28,14 +33,18 @@
 
 #include <unistd.h>
 
+#include "access/nbtree.h"
 #include "access/relation.h"
 #include "access/xact.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_class.h"
 #include "catalog/pg_type.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/atomics.h"
 #include "postmaster/bgworker.h"
 #include "storage/buf_internals.h"
+#include "storage/bufmgr.h"
 #include "storage/dsm.h"
 #include "storage/ipc.h"
 #include "storage/latch.h"
@@ -55,7 +64,18 @@
 
 #define AUTOPREWARM_FILE "autoprewarm.blocks"
 
-/* Metadata for each block we dump. */
+/* Identifies the binary dump file format, see apw_dump_now */
+#define AUTOPREWARM_FILE_MAGIC		0x57525041	/* "APRW" */
+#define AUTOPREWARM_FILE_VERSION	1
+
+/*
+ * Largest number of blocks a per-database worker prewarms as one unit of
+ * work.  Longer ranges are split, so that the workers can share the work of
+ * prewarming a large relation.
+ */
+#define AUTOPREWARM_CHUNK_BLOCKS	1024
+
+/* Metadata for each block in shared buffers. */
 typedef struct BlockInfoRecord
 {
 	Oid			database;
@@ -65,6 +85,26 @@ typedef struct BlockInfoRecord
 	BlockNumber blocknum;
 } BlockInfoRecord;
 
+/* A range of consecutive blocks of one relation fork, as we dump them. */
+typedef struct BlockRangeRecord
+{
+	Oid			database;
+	Oid			tablespace;
+	Oid			filenode;
+	uint32		forknum;
+	BlockNumber blocknum;		/* first block of the range */
+	BlockNumber nblocks;		/* number of blocks in the range */
+} BlockRangeRecord;
+
+/* Header of the dump file, followed by nranges BlockRangeRecords. */
+typedef struct AutoPrewarmFileHeader
+{
+	uint32		magic;
+	uint32		version;
+	uint32		nranges;
+	uint32		nblocks;		/* total number of blocks in the ranges */
+} AutoPrewarmFileHeader;
+
 /* Shared state information for autoprewarm bgworker. */
 typedef struct AutoPrewarmSharedState
 {
@@ -72,12 +112,16 @@ typedef struct AutoPrewarmSharedState
 	pid_t		bgworker_pid;	/* for main bgworker */
 	pid_t		pid_using_dumpfile; /* for autoprewarm or block dump */
 
-	/* Following items are for communication with per-database worker */
+	/* Following items are for communication with per-database workers */
 	dsm_handle	block_info_handle;
 	Oid			database;
 	int			prewarm_start_idx;
 	int			prewarm_stop_idx;
-	int			prewarmed_blocks;
+	bool		prewarm_indexes_first;	/* do a pass for indexes first? */
+	pg_atomic_uint32 prewarm_next_index_idx;	/* next range to take, in
+												 * that pass */
+	pg_atomic_uint32 prewarm_next_idx;	/* next range for a worker to take */
+	pg_atomic_uint32 prewarmed_blocks;
 } AutoPrewarmSharedState;
 
 void		_PG_init(void);
@@ -88,12 +132,18 @@ PG_FUNCTION_INFO_V1(autoprewarm_start_worker);
 PG_FUNCTION_INFO_V1(autoprewarm_dump_now);
 
 static void apw_load_buffers(void);
+static BlockRangeRecord *apw_read_dump_file(FILE *file, int *nranges,
+											int *nblocks);
+static int	apw_compress_blocks(BlockInfoRecord *blkinfo, int num_blocks,
+								BlockRangeRecord *ranges);
+static void apw_prewarm_btree_upper(Relation rel);
 static int	apw_dump_now(bool is_bgworker, bool dump_unlogged);
 static void apw_start_leader_worker(void);
-static void apw_start_database_worker(void);
+static void apw_start_database_workers(int nworkers);
 static bool apw_init_shmem(void);
 static void apw_detach_shmem(int code, Datum arg);
 static int	apw_compare_blockinfo(const void *p, const void *q);
+static int	apw_compare_blockrange(const void *p, const void *q);
 static void apw_sigterm_handler(SIGNAL_ARGS);
 static void apw_sighup_handler(SIGNAL_ARGS);
 
@@ -107,6 +157,8 @@ static AutoPrewarmSharedState *apw_state = NULL;
 /* GUC variables. */
 static bool autoprewarm = true; /* start worker? */
 static int	autoprewarm_interval;	/* dump interval */
+static int	autoprewarm_workers;	/* per-database workers to use */
+static bool autoprewarm_indexes_first;	/* prewarm indexes before tables? */
 
 /*
  * Module load callback.
@@ -126,6 +178,29 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomIntVariable("pg_prewarm.autoprewarm_workers",
+							"Sets the number of workers to prewarm each database with",
+							NULL,
+							&autoprewarm_workers,
+							4,
+							1, 64,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("pg_prewarm.autoprewarm_indexes_first",
+							 "Prewarms the blocks of indexes before those of tables.",
+							 NULL,
+							 &autoprewarm_indexes_first,
+							 false,
+							 PGC_SIGHUP,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	if (!process_shared_preload_libraries_in_progress)
 		return;
 
@@ -265,16 +340,19 @@ autoprewarm_main(Datum main_arg)
 }
 
 /*
- * Read the dump file and launch per-database workers one at a time to
- * prewarm the buffers found there.
+ * Read the dump file and launch per-database workers, one database at a
+ * time, to prewarm the buffers found there.
  */
 static void
 apw_load_buffers(void)
 {
 	FILE	   *file = NULL;
-	int			num_elements,
+	int			num_ranges,
+				num_blocks,
+				num_chunks,
 				i;
-	BlockInfoRecord *blkinfo;
+	BlockRangeRecord *ranges;
+	BlockRangeRecord *blkinfo;
 	dsm_segment *seg;
 
 	/*
@@ -298,7 +376,7 @@ apw_load_buffers(void)
 	 * Open the block dump file.  Exit quietly if it doesn't exist, but report
 	 * any other error.
 	 */
-	file = AllocateFile(AUTOPREWARM_FILE, "r");
+	file = AllocateFile(AUTOPREWARM_FILE, PG_BINARY_R);
 	if (!file)
 	{
 		if (errno == ENOENT)
@@ -314,59 +392,67 @@ apw_load_buffers(void)
 						AUTOPREWARM_FILE)));
 	}
 
-	/* First line of the file is a record count. */
-	if (fscanf(file, "<<%d>>\n", &num_elements) != 1)
-		ereport(ERROR,
-				(errcode_for_file_access(),
-				 errmsg("could not read from file \"%s\": %m",
-						AUTOPREWARM_FILE)));
+	ranges = apw_read_dump_file(file, &num_ranges, &num_blocks);
 
-	/* Allocate a dynamic shared memory segment to store the record data. */
-	seg = dsm_create(sizeof(BlockInfoRecord) * num_elements, 0);
-	blkinfo = (BlockInfoRecord *) dsm_segment_address(seg);
+	FreeFile(file);
 
-	/* Read records, one per line. */
-	for (i = 0; i < num_elements; i++)
+	/* Sort the ranges to be loaded. */
+	pg_qsort(ranges, num_ranges, sizeof(BlockRangeRecord),
+			 apw_compare_blockrange);
+
+	/*
+	 * Allocate a dynamic shared memory segment to store the ranges, split
+	 * into chunks of at most AUTOPREWARM_CHUNK_BLOCKS blocks.
+	 */
+	num_chunks = 0;
+	for (i = 0; i < num_ranges; i++)
+		num_chunks += (ranges[i].nblocks + AUTOPREWARM_CHUNK_BLOCKS - 1) /
+			AUTOPREWARM_CHUNK_BLOCKS;
+
+	seg = dsm_create(sizeof(BlockRangeRecord) * Max(num_chunks, 1), 0);
+	blkinfo = (BlockRangeRecord *) dsm_segment_address(seg);
+
+	num_chunks = 0;
+	for (i = 0; i < num_ranges; i++)
 	{
-		unsigned	forknum;
+		BlockNumber done;
 
-		if (fscanf(file, "%u,%u,%u,%u,%u\n", &blkinfo[i].database,
-				   &blkinfo[i].tablespace, &blkinfo[i].filenode,
-				   &forknum, &blkinfo[i].blocknum) != 5)
-			ereport(ERROR,
-					(errmsg("autoprewarm block dump file is corrupted at line %d",
-							i + 1)));
-		blkinfo[i].forknum = forknum;
+		for (done = 0; done < ranges[i].nblocks;
+			 done += AUTOPREWARM_CHUNK_BLOCKS)
+		{
+			blkinfo[num_chunks] = ranges[i];
+			blkinfo[num_chunks].blocknum += done;
+			blkinfo[num_chunks].nblocks =
+				Min(ranges[i].nblocks - done, AUTOPREWARM_CHUNK_BLOCKS);
+			num_chunks++;
+		}
 	}
 
-	FreeFile(file);
-
-	/* Sort the blocks to be loaded. */
-	pg_qsort(blkinfo, num_elements, sizeof(BlockInfoRecord),
-			 apw_compare_blockinfo);
+	pfree(ranges);
 
 	/* Populate shared memory state. */
 	apw_state->block_info_handle = dsm_segment_handle(seg);
 	apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx = 0;
-	apw_state->prewarmed_blocks = 0;
+	apw_state->prewarm_indexes_first = autoprewarm_indexes_first;
+	pg_atomic_write_u32(&apw_state->prewarmed_blocks, 0);
 
 	/* Get the info position of the first block of the next database. */
-	while (apw_state->prewarm_start_idx < num_elements)
+	while (apw_state->prewarm_start_idx < num_chunks)
 	{
 		int			j = apw_state->prewarm_start_idx;
 		Oid			current_db = blkinfo[j].database;
 
 		/*
-		 * Advance the prewarm_stop_idx to the first BlockInfoRecord that does
-		 * not belong to this database.
+		 * Advance the prewarm_stop_idx to the first BlockRangeRecord that
+		 * does not belong to this database.
 		 */
 		j++;
-		while (j < num_elements)
+		while (j < num_chunks)
 		{
 			if (current_db != blkinfo[j].database)
 			{
 				/*
-				 * Combine BlockInfoRecords for global objects with those of
+				 * Combine BlockRangeRecords for global objects with those of
 				 * the database.
 				 */
 				if (current_db != InvalidOid)
@@ -379,26 +465,33 @@ apw_load_buffers(void)
 
 		/*
 		 * If we reach this point with current_db == InvalidOid, then only
-		 * BlockInfoRecords belonging to global objects exist.  We can't
+		 * BlockRangeRecords belonging to global objects exist.  We can't
 		 * prewarm without a database connection, so just bail out.
 		 */
 		if (current_db == InvalidOid)
 			break;
 
-		/* Configure stop point and database for next per-database worker. */
+		/* Configure stop point and database for next per-database workers. */
 		apw_state->prewarm_stop_idx = j;
 		apw_state->database = current_db;
+		pg_atomic_write_u32(&apw_state->prewarm_next_index_idx,
+							apw_state->prewarm_start_idx);
+		pg_atomic_write_u32(&apw_state->prewarm_next_idx,
+							apw_state->prewarm_start_idx);
 		Assert(apw_state->prewarm_start_idx < apw_state->prewarm_stop_idx);
 
-		/* If we've run out of free buffers, don't launch another worker. */
+		/* If we've run out of free buffers, don't launch more workers. */
 		if (!have_free_buffer())
 			break;
 
 		/*
-		 * Start a per-database worker to load blocks for this database; this
-		 * function will return once the per-database worker exits.
+		 * Start per-database workers to load blocks for this database; this
+		 * function will return once they have all exited.  There's no point
+		 * in having more workers than chunks.
 		 */
-		apw_start_database_worker();
+		apw_start_database_workers(Min(autoprewarm_workers,
+									   apw_state->prewarm_stop_idx -
+									   apw_state->prewarm_start_idx));
 
 		/* Prepare for next database. */
 		apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx;
@@ -413,23 +506,160 @@ apw_load_buffers(void)
 
 	/* Report our success. */
 	ereport(LOG,
-			(errmsg("autoprewarm successfully prewarmed %d of %d previously-loaded blocks",
-					apw_state->prewarmed_blocks, num_elements)));
+			(errmsg("autoprewarm successfully prewarmed %u of %d previously-loaded blocks",
+					pg_atomic_read_u32(&apw_state->prewarmed_blocks),
+					num_blocks)));
+}
+
+/*
+ * Read the block ranges from the dump file.
+ *
+ * Returns a palloc'd array of the ranges, and sets *nranges to their number
+ * and *nblocks to the number of blocks in them.  Dump files written in the
+ * text format used by older versions, which list block by block, are
+ * understood, too.
+ */
+static BlockRangeRecord *
+apw_read_dump_file(FILE *file, int *nranges, int *nblocks)
+{
+	AutoPrewarmFileHeader header;
+	BlockRangeRecord *ranges;
+	BlockInfoRecord *blkinfo;
+	int			num_elements;
+	int			i;
+
+	if (fread(&header, sizeof(header), 1, file) == 1 &&
+		header.magic == AUTOPREWARM_FILE_MAGIC)
+	{
+		if (header.version != AUTOPREWARM_FILE_VERSION)
+			ereport(ERROR,
+					(errmsg("autoprewarm block dump file has unsupported version %u",
+							header.version)));
+
+		ranges = (BlockRangeRecord *)
+			palloc(sizeof(BlockRangeRecord) * Max(header.nranges, 1));
+		if (fread(ranges, sizeof(BlockRangeRecord), header.nranges,
+				  file) != header.nranges)
+			ereport(ERROR,
+					(errmsg("autoprewarm block dump file is corrupted")));
+
+		*nblocks = 0;
+		for (i = 0; i < header.nranges; i++)
+		{
+			if (ranges[i].nblocks == 0 ||
+				ranges[i].nblocks > header.nblocks - *nblocks)
+				ereport(ERROR,
+						(errmsg("autoprewarm block dump file is corrupted at range %d",
+								i + 1)));
+			*nblocks += ranges[i].nblocks;
+		}
+		*nranges = header.nranges;
+		return ranges;
+	}
+
+	/* Not a binary dump, so try the old text format. */
+	rewind(file);
+
+	/* First line of the file is a record count. */
+	if (fscanf(file, "<<%d>>\n", &num_elements) != 1)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from file \"%s\": %m",
+						AUTOPREWARM_FILE)));
+
+	/* Read records, one per line. */
+	blkinfo = (BlockInfoRecord *)
+		palloc(sizeof(BlockInfoRecord) * Max(num_elements, 1));
+	for (i = 0; i < num_elements; i++)
+	{
+		unsigned	forknum;
+
+		if (fscanf(file, "%u,%u,%u,%u,%u\n", &blkinfo[i].database,
+				   &blkinfo[i].tablespace, &blkinfo[i].filenode,
+				   &forknum, &blkinfo[i].blocknum) != 5)
+			ereport(ERROR,
+					(errmsg("autoprewarm block dump file is corrupted at line %d",
+							i + 1)));
+		blkinfo[i].forknum = forknum;
+	}
+
+	ranges = (BlockRangeRecord *)
+		palloc(sizeof(BlockRangeRecord) * Max(num_elements, 1));
+	*nranges = apw_compress_blocks(blkinfo, num_elements, ranges);
+	*nblocks = num_elements;
+	pfree(blkinfo);
+
+	return ranges;
+}
+
+/*
+ * Sort the given blocks, and turn them into ranges of consecutive blocks.
+ *
+ * ranges must have room for num_blocks entries.  Returns the number of
+ * ranges.
+ */
+static int
+apw_compress_blocks(BlockInfoRecord *blkinfo, int num_blocks,
+					BlockRangeRecord *ranges)
+{
+	int			nranges = 0;
+	int			i;
+
+	pg_qsort(blkinfo, num_blocks, sizeof(BlockInfoRecord),
+			 apw_compare_blockinfo);
+
+	for (i = 0; i < num_blocks; i++)
+	{
+		BlockInfoRecord *blk = &blkinfo[i];
+		BlockRangeRecord *last = nranges > 0 ? &ranges[nranges - 1] : NULL;
+
+		if (last != NULL &&
+			last->database == blk->database &&
+			last->tablespace == blk->tablespace &&
+			last->filenode == blk->filenode &&
+			last->forknum == (uint32) blk->forknum &&
+			last->blocknum + last->nblocks == blk->blocknum)
+		{
+			last->nblocks++;
+			continue;
+		}
+
+		/* a block can appear twice in a hand-edited old-format file */
+		if (last != NULL &&
+			last->database == blk->database &&
+			last->tablespace == blk->tablespace &&
+			last->filenode == blk->filenode &&
+			last->forknum == (uint32) blk->forknum &&
+			last->blocknum + last->nblocks > blk->blocknum)
+			continue;
+
+		ranges[nranges].database = blk->database;
+		ranges[nranges].tablespace = blk->tablespace;
+		ranges[nranges].filenode = blk->filenode;
+		ranges[nranges].forknum = (uint32) blk->forknum;
+		ranges[nranges].blocknum = blk->blocknum;
+		ranges[nranges].nblocks = 1;
+		nranges++;
+	}
+
+	return nranges;
 }
 
 /*
  * Prewarm all blocks for one database (and possibly also global objects, if
- * those got grouped with this database).
+ * those got grouped with this database), or rather, this worker's share of
+ * them.  Each worker takes chunks of blocks from the shared list until none
+ * are left.
  */
 void
 autoprewarm_database_main(Datum main_arg)
 {
-	int			pos;
-	BlockInfoRecord *block_info;
+	BlockRangeRecord *block_info;
 	Relation	rel = NULL;
 	BlockNumber nblocks = 0;
-	BlockInfoRecord *old_blk = NULL;
+	BlockRangeRecord *old_blk = NULL;
 	dsm_segment *seg;
+	int			pass;
 
 	/* Establish signal handlers; once that's done, unblock signals. */
 	pqsignal(SIGTERM, die);
@@ -443,101 +673,131 @@ autoprewarm_database_main(Datum main_arg)
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("could not map dynamic shared memory segment")));
 	BackgroundWorkerInitializeConnectionByOid(apw_state->database, InvalidOid, 0);
-	block_info = (BlockInfoRecord *) dsm_segment_address(seg);
-	pos = apw_state->prewarm_start_idx;
+	block_info = (BlockRangeRecord *) dsm_segment_address(seg);
 
 	/*
-	 * Loop until we run out of blocks to prewarm or until we run out of free
+	 * With autoprewarm_indexes_first, we go through the list twice, first
+	 * prewarming only the blocks of indexes, then the rest.  In each pass,
+	 * loop until we run out of blocks to prewarm or until we run out of free
 	 * buffers.
 	 */
-	while (pos < apw_state->prewarm_stop_idx && have_free_buffer())
+	for (pass = apw_state->prewarm_indexes_first ? 0 : 1; pass < 2; pass++)
 	{
-		BlockInfoRecord *blk = &block_info[pos++];
-		Buffer		buf;
+		pg_atomic_uint32 *next_idx = (pass == 0) ?
+		&apw_state->prewarm_next_index_idx : &apw_state->prewarm_next_idx;
 
-		CHECK_FOR_INTERRUPTS();
-
-		/*
-		 * Quit if we've reached records for another database. If previous
-		 * blocks are of some global objects, then continue pre-warming.
-		 */
-		if (old_blk != NULL && old_blk->database != blk->database &&
-			old_blk->database != 0)
-			break;
-
-		/*
-		 * As soon as we encounter a block of a new relation, close the old
-		 * relation. Note that rel will be NULL if try_relation_open failed
-		 * previously; in that case, there is nothing to close.
-		 */
-		if (old_blk != NULL && old_blk->filenode != blk->filenode &&
-			rel != NULL)
+		while (have_free_buffer())
 		{
-			relation_close(rel, AccessShareLock);
-			rel = NULL;
-			CommitTransactionCommand();
-		}
+			uint32		pos;
+			BlockRangeRecord *blk;
+			BlockNumber blocknum;
+			BlockNumber endblock;
 
-		/*
-		 * Try to open each new relation, but only once, when we first
-		 * encounter it. If it's been dropped, skip the associated blocks.
-		 */
-		if (old_blk == NULL || old_blk->filenode != blk->filenode)
-		{
-			Oid			reloid;
+			CHECK_FOR_INTERRUPTS();
 
-			Assert(rel == NULL);
-			StartTransactionCommand();
-			reloid = RelidByRelfilenode(blk->tablespace, blk->filenode);
-			if (OidIsValid(reloid))
-				rel = try_relation_open(reloid, AccessShareLock);
+			pos = pg_atomic_fetch_add_u32(next_idx, 1);
+			if (pos >= apw_state->prewarm_stop_idx)
+				break;
+			blk = &block_info[pos];
 
-			if (!rel)
+			/*
+			 * As soon as we encounter a block of a new relation, close the
+			 * old relation. Note that rel will be NULL if try_relation_open
+			 * failed previously; in that case, there is nothing to close.
+			 */
+			if (old_blk != NULL && old_blk->filenode != blk->filenode &&
+				rel != NULL)
+			{
+				relation_close(rel, AccessShareLock);
+				rel = NULL;
 				CommitTransactionCommand();
-		}
-		if (!rel)
-		{
-			old_blk = blk;
-			continue;
-		}
+			}
 
-		/* Once per fork, check for fork existence and size. */
-		if (old_blk == NULL ||
-			old_blk->filenode != blk->filenode ||
-			old_blk->forknum != blk->forknum)
-		{
-			RelationOpenSmgr(rel);
+			/*
+			 * Try to open each new relation, but only once, when we first
+			 * encounter it. If it's been dropped, skip the associated blocks.
+			 */
+			if (old_blk == NULL || old_blk->filenode != blk->filenode)
+			{
+				Oid			reloid;
+
+				Assert(rel == NULL);
+				StartTransactionCommand();
+				reloid = RelidByRelfilenode(blk->tablespace, blk->filenode);
+				if (OidIsValid(reloid))
+					rel = try_relation_open(reloid, AccessShareLock);
+
+				if (!rel)
+					CommitTransactionCommand();
+				else if (pass == 0 && rel->rd_rel->relam == BTREE_AM_OID &&
+						 rel->rd_rel->relkind == RELKIND_INDEX)
+					apw_prewarm_btree_upper(rel);
+			}
+			if (!rel)
+			{
+				old_blk = blk;
+				continue;
+			}
 
 			/*
-			 * smgrexists is not safe for illegal forknum, hence check whether
-			 * the passed forknum is valid before using it in smgrexists.
+			 * With two passes, indexes are left for the first one, and
+			 * everything else for the second.
 			 */
-			if (blk->forknum > InvalidForkNumber &&
-				blk->forknum <= MAX_FORKNUM &&
-				smgrexists(rel->rd_smgr, blk->forknum))
-				nblocks = RelationGetNumberOfBlocksInFork(rel, blk->forknum);
-			else
-				nblocks = 0;
-		}
+			if (apw_state->prewarm_indexes_first &&
+				(rel->rd_rel->relkind == RELKIND_INDEX) != (pass == 0))
+			{
+				old_blk = blk;
+				continue;
+			}
 
-		/* Check whether blocknum is valid and within fork file size. */
-		if (blk->blocknum >= nblocks)
-		{
-			/* Move to next forknum. */
+			/* Once per fork, check for fork existence and size. */
+			if (old_blk == NULL ||
+				old_blk->filenode != blk->filenode ||
+				old_blk->forknum != blk->forknum)
+			{
+				RelationOpenSmgr(rel);
+
+				/*
+				 * smgrexists is not safe for illegal forknum, hence check
+				 * whether the passed forknum is valid before using it in
+				 * smgrexists.  (It is unsigned here, so this catches negative
+				 * values too.)
+				 */
+				if (blk->forknum <= MAX_FORKNUM &&
+					smgrexists(rel->rd_smgr, blk->forknum))
+					nblocks = RelationGetNumberOfBlocksInFork(rel, blk->forknum);
+				else
+					nblocks = 0;
+			}
 			old_blk = blk;
-			continue;
+
+			/* Prewarm the part of the range within the fork's current size. */
+			endblock = Min(blk->blocknum + blk->nblocks, nblocks);
+			for (blocknum = blk->blocknum; blocknum < endblock;
+				 blocknum += MAX_BUFFERS_PER_READ)
+			{
+				Buffer		buffers[MAX_BUFFERS_PER_READ];
+				int			n = Min(endblock - blocknum, MAX_BUFFERS_PER_READ);
+				int			i;
+
+				if (!have_free_buffer())
+					break;
+
+				ReadBuffers(rel, blk->forknum, blocknum, n, buffers, NULL);
+				for (i = 0; i < n; i++)
+					ReleaseBuffer(buffers[i]);
+				pg_atomic_fetch_add_u32(&apw_state->prewarmed_blocks, n);
+			}
 		}
 
-		/* Prewarm buffer. */
-		buf = ReadBufferExtended(rel, blk->forknum, blk->blocknum, RBM_NORMAL,
-								 NULL);
-		if (BufferIsValid(buf))
+		/* Start the next pass afresh. */
+		if (rel)
 		{
-			apw_state->prewarmed_blocks++;
-			ReleaseBuffer(buf);
+			relation_close(rel, AccessShareLock);
+			rel = NULL;
+			CommitTransactionCommand();
 		}
-
-		old_blk = blk;
+		old_blk = NULL;
 	}
 
 	dsm_detach(seg);
@@ -551,18 +811,131 @@ autoprewarm_database_main(Datum main_arg)
 }
 
 /*
- * Dump information on blocks in shared buffers.  We use a text format here
- * so that it's easy to understand and even change the file contents if
- * necessary.
+ * Prewarm the internal pages of a btree index, level by level from the root
+ * down.  Every index scan goes through them, and there are few of them, so
+ * loading them first pays off before the leaf pages come in with the rest of
+ * the index's blocks.  These pages need not be in the dump file, and they
+ * aren't counted in prewarmed_blocks.
+ */
+static void
+apw_prewarm_btree_upper(Relation rel)
+{
+	BlockNumber nblocks = RelationGetNumberOfBlocks(rel);
+	Buffer		buf;
+	Page		page;
+	BTMetaPageData *metad;
+	BlockNumber *blocks;
+	int			nlevel;
+	int			maxchildren = 64;
+	uint32		level;
+
+	if (nblocks <= BTREE_METAPAGE)
+		return;
+
+	buf = ReadBuffer(rel, BTREE_METAPAGE);
+	LockBuffer(buf, BT_READ);
+	page = BufferGetPage(buf);
+	metad = BTPageGetMeta(page);
+	if (PageIsNew(page) || metad->btm_magic != BTREE_MAGIC ||
+		metad->btm_root == P_NONE || metad->btm_root >= nblocks)
+	{
+		UnlockReleaseBuffer(buf);
+		return;
+	}
+	blocks = (BlockNumber *) palloc(maxchildren * sizeof(BlockNumber));
+	blocks[0] = metad->btm_root;
+	nlevel = 1;
+	level = metad->btm_level;
+	UnlockReleaseBuffer(buf);
+
+	/* Leaf pages are left for the regular prewarm of the index. */
+	while (level > 0 && nlevel > 0)
+	{
+		BlockNumber *children;
+		int			nchildren = 0;
+		int			i;
+
+		children = (BlockNumber *) palloc(maxchildren * sizeof(BlockNumber));
+		for (i = 0; i < nlevel && have_free_buffer(); i++)
+		{
+			BTPageOpaque opaque;
+			OffsetNumber offnum;
+			OffsetNumber maxoff;
+
+			CHECK_FOR_INTERRUPTS();
+
+			buf = ReadBuffer(rel, blocks[i]);
+
+			/* No need to look at the items of the pages just above leaves. */
+			if (level == 1)
+			{
+				ReleaseBuffer(buf);
+				continue;
+			}
+
+			LockBuffer(buf, BT_READ);
+			page = BufferGetPage(buf);
+			if (PageIsNew(page) ||
+				PageGetSpecialSize(page) != MAXALIGN(sizeof(BTPageOpaqueData)))
+			{
+				UnlockReleaseBuffer(buf);
+				continue;
+			}
+			opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+			if (P_IGNORE(opaque) || P_ISLEAF(opaque))
+			{
+				UnlockReleaseBuffer(buf);
+				continue;
+			}
+
+			maxoff = PageGetMaxOffsetNumber(page);
+			for (offnum = P_FIRSTDATAKEY(opaque); offnum <= maxoff;
+				 offnum = OffsetNumberNext(offnum))
+			{
+				IndexTuple	itup;
+				BlockNumber child;
+
+				itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+				child = BTreeTupleGetDownLink(itup);
+				if (child >= nblocks)
+					continue;
+				if (nchildren >= maxchildren)
+				{
+					maxchildren *= 2;
+					children = (BlockNumber *)
+						repalloc(children, maxchildren * sizeof(BlockNumber));
+				}
+				children[nchildren++] = child;
+			}
+			UnlockReleaseBuffer(buf);
+		}
+
+		pfree(blocks);
+		blocks = children;
+		nlevel = nchildren;
+		level--;
+	}
+
+	pfree(blocks);
+}
+
+/*
+ * Dump information on blocks in shared buffers.  The blocks are sorted and
+ * written as ranges of consecutive blocks, which keeps the file small even
+ * with very large shared_buffers, and lets the blocks be reloaded with large
+ * sequential reads.  See AutoPrewarmFileHeader for the format.
  * Returns the number of blocks dumped.
  */
 static int
 apw_dump_now(bool is_bgworker, bool dump_unlogged)
 {
 	int			num_blocks;
+	int			num_ranges;
 	int			i;
 	int			ret;
 	BlockInfoRecord *block_info_array;
+	BlockRangeRecord *ranges;
+	AutoPrewarmFileHeader header;
 	BufferDesc *bufHdr;
 	FILE	   *file;
 	char		transient_dump_file_path[MAXPGPATH];
@@ -620,16 +993,27 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 		UnlockBufHdr(bufHdr, buf_state);
 	}
 
+	ranges = (BlockRangeRecord *)
+		palloc(sizeof(BlockRangeRecord) * Max(num_blocks, 1));
+	num_ranges = apw_compress_blocks(block_info_array, num_blocks, ranges);
+	pfree(block_info_array);
+
 	snprintf(transient_dump_file_path, MAXPGPATH, "%s.tmp", AUTOPREWARM_FILE);
-	file = AllocateFile(transient_dump_file_path, "w");
+	file = AllocateFile(transient_dump_file_path, PG_BINARY_W);
 	if (!file)
 		ereport(ERROR,
 				(errcode_for_file_access(),
 				 errmsg("could not open file \"%s\": %m",
 						transient_dump_file_path)));
 
-	ret = fprintf(file, "<<%d>>\n", num_blocks);
-	if (ret < 0)
+	header.magic = AUTOPREWARM_FILE_MAGIC;
+	header.version = AUTOPREWARM_FILE_VERSION;
+	header.nranges = num_ranges;
+	header.nblocks = num_blocks;
+
+	if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+		fwrite(ranges, sizeof(BlockRangeRecord), num_ranges,
+			   file) != num_ranges)
 	{
 		int			save_errno = errno;
 
@@ -642,31 +1026,7 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 						transient_dump_file_path)));
 	}
 
-	for (i = 0; i < num_blocks; i++)
-	{
-		CHECK_FOR_INTERRUPTS();
-
-		ret = fprintf(file, "%u,%u,%u,%u,%u\n",
-					  block_info_array[i].database,
-					  block_info_array[i].tablespace,
-					  block_info_array[i].filenode,
-					  (uint32) block_info_array[i].forknum,
-					  block_info_array[i].blocknum);
-		if (ret < 0)
-		{
-			int			save_errno = errno;
-
-			FreeFile(file);
-			unlink(transient_dump_file_path);
-			errno = save_errno;
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not write to file \"%s\": %m",
-							transient_dump_file_path)));
-		}
-	}
-
-	pfree(block_info_array);
+	pfree(ranges);
 
 	/*
 	 * Rename transient_dump_file_path to AUTOPREWARM_FILE to make things
@@ -689,7 +1049,8 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 	apw_state->pid_using_dumpfile = InvalidPid;
 
 	ereport(DEBUG1,
-			(errmsg("wrote block details for %d blocks", num_blocks)));
+			(errmsg("wrote block details for %d blocks in %d ranges",
+					num_blocks, num_ranges)));
 	return num_blocks;
 }
 
@@ -764,6 +1125,9 @@ apw_init_shmem(void)
 		LWLockInitialize(&apw_state->lock, LWLockNewTrancheId());
 		apw_state->bgworker_pid = InvalidPid;
 		apw_state->pid_using_dumpfile = InvalidPid;
+		pg_atomic_init_u32(&apw_state->prewarm_next_index_idx, 0);
+		pg_atomic_init_u32(&apw_state->prewarm_next_idx, 0);
+		pg_atomic_init_u32(&apw_state->prewarmed_blocks, 0);
 	}
 	LWLockRelease(AddinShmemInitLock);
 
@@ -829,13 +1193,18 @@ apw_start_leader_worker(void)
 }
 
 /*
- * Start autoprewarm per-database worker process.
+ * Start autoprewarm per-database worker processes, and wait for them to exit.
+ *
+ * If fewer than nworkers can be registered, the ones that could do all the
+ * work; only failing to register any at all is an error.
  */
 static void
-apw_start_database_worker(void)
+apw_start_database_workers(int nworkers)
 {
 	BackgroundWorker worker;
-	BackgroundWorkerHandle *handle;
+	BackgroundWorkerHandle **handles;
+	int			nstarted;
+	int			i;
 
 	MemSet(&worker, 0, sizeof(BackgroundWorker));
 	worker.bgw_flags =
@@ -850,17 +1219,29 @@ apw_start_database_worker(void)
 	/* must set notify PID to wait for shutdown */
 	worker.bgw_notify_pid = MyProcPid;
 
-	if (!RegisterDynamicBackgroundWorker(&worker, &handle))
+	handles = palloc(sizeof(BackgroundWorkerHandle *) * nworkers);
+	for (nstarted = 0; nstarted < nworkers; nstarted++)
+	{
+		if (!RegisterDynamicBackgroundWorker(&worker, &handles[nstarted]))
+			break;
+	}
+
+	if (nstarted == 0)
 		ereport(ERROR,
 				(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
 				 errmsg("registering dynamic bgworker autoprewarm failed"),
 				 errhint("Consider increasing configuration parameter \"max_worker_processes\".")));
 
 	/*
-	 * Ignore return value; if it fails, postmaster has died, but we have
+	 * Ignore return values; if it fails, postmaster has died, but we have
 	 * checks for that elsewhere.
 	 */
-	WaitForBackgroundWorkerShutdown(handle);
+	for (i = 0; i < nstarted; i++)
+	{
+		WaitForBackgroundWorkerShutdown(handles[i]);
+		pfree(handles[i]);
+	}
+	pfree(handles);
 }
 
 /* Compare member elements to check whether they are not equal. */
@@ -876,10 +1257,11 @@ do { \
  * apw_compare_blockinfo
  *
  * We depend on all records for a particular database being consecutive
- * in the dump file; each per-database worker will preload blocks until
- * it sees a block for some other database.  Sorting by tablespace,
- * filenode, forknum, and blocknum isn't critical for correctness, but
- * helps us get a sequential I/O pattern.
+ * after sorting; the per-database workers for a database are only given
+ * the records for that database (and for global objects).  Sorting by
+ * tablespace, filenode, forknum, and blocknum isn't critical for
+ * correctness, but lets us merge blocks into ranges, and helps us get a
+ * sequential I/O pattern.
  */
 static int
 apw_compare_blockinfo(const void *p, const void *q)
@@ -896,6 +1278,26 @@ apw_compare_blockinfo(const void *p, const void *q)
 	return 0;
 }
 
+/*
+ * apw_compare_blockrange
+ *
+ * Like apw_compare_blockinfo, but for ranges of blocks.
+ */
+static int
+apw_compare_blockrange(const void *p, const void *q)
+{
+	const BlockRangeRecord *a = (const BlockRangeRecord *) p;
+	const BlockRangeRecord *b = (const BlockRangeRecord *) q;
+
+	cmp_member_elem(database);
+	cmp_member_elem(tablespace);
+	cmp_member_elem(filenode);
+	cmp_member_elem(forknum);
+	cmp_member_elem(blocknum);
+
+	return 0;
+}
+
 /*
  * Signal handler for SIGTERM
  */
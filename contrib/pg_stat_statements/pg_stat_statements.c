@@ -48,6 +48,19 @@
  * requires holding pgss->lock exclusively; this allows individual entries
  * in the file to be read or written while holding only shared lock.
  *
+ * To keep pgss->lock and the entry mutexes out of the way of frequently
+ * executed statements, each backend has a slot in shared memory where it
+ * accumulates the counts of the statements it has already executed once.
+ * Those counts are added to the hashtable entries by pgss_flush_pending(),
+ * at most every PGSS_FLUSH_INTERVAL msec, when the slot is full, and at
+ * backend exit.  Only the owning backend writes to its slot, without any
+ * lock, following the st_changecount protocol of pgstat.h.  A flush holds
+ * pgss->lock exclusively, so that readers holding it shared can add the
+ * pending counts of all slots to the counters in the hashtable without
+ * counting anything twice.  Pending counts carry the serial number of the
+ * entry they belong to, so that they are dropped, rather than added to a
+ * new entry with the same key, if the entry is removed in the meantime.
+ *
  *
  * Copyright (c) 2008-2020, PostgreSQL Global Development Group
  *
@@ -62,7 +75,9 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include "access/xact.h"
 #include "catalog/pg_authid.h"
+#include "catalog/pg_type.h"
 #include "common/hashfn.h"
 #include "executor/instrument.h"
 #include "funcapi.h"
@@ -74,13 +89,18 @@
 #include "parser/scanner.h"
 #include "parser/scansup.h"
 #include "pgstat.h"
+#include "port/pg_bitutils.h"
+#include "postmaster/autovacuum.h"
+#include "replication/walsender.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/spin.h"
 #include "tcop/utility.h"
 #include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/memutils.h"
+#include "utils/timestamp.h"
 
 PG_MODULE_MAGIC;
 
@@ -98,7 +118,7 @@ PG_MODULE_MAGIC;
 #define PGSS_TEXT_FILE	PG_STAT_TMP_DIR "/pgss_query_texts.stat"
 
 /* Magic number identifying the stats file format */
-static const uint32 PGSS_FILE_HEADER = 0x20171004;
+static const uint32 PGSS_FILE_HEADER = 0x20200915;
 
 /* PostgreSQL major version number, changes in which invalidate all entries */
 static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
@@ -112,6 +132,16 @@ static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
 #define STICKY_DECREASE_FACTOR	(0.50)	/* factor for sticky entries */
 #define USAGE_DEALLOC_PERCENT	5	/* free this % of entries at once */
 #define IS_STICKY(c)	((c.calls[PGSS_PLAN] + c.calls[PGSS_EXEC]) == 0)
+#define PGSS_PENDING_ENTRIES	16	/* # of pending statements per backend */
+#define PGSS_FLUSH_INTERVAL		1000	/* msec between flushes of pending
+										 * counts */
+
+/*
+ * Number of buckets of the planning and execution time histograms.  Bucket
+ * 0 counts durations under 1 usec, bucket i > 0 those from 2^(i-1) up to
+ * 2^i usec, and the last bucket all longer ones, from about 67 sec.
+ */
+#define PGSS_HIST_BUCKETS		28
 
 #define JUMBLE_SIZE				1024	/* query serialization buffer size */
 
@@ -124,7 +154,8 @@ typedef enum pgssVersion
 	PGSS_V1_1,
 	PGSS_V1_2,
 	PGSS_V1_3,
-	PGSS_V1_8
+	PGSS_V1_8,
+	PGSS_V1_9
 } pgssVersion;
 
 typedef enum pgssStoreKind
@@ -145,6 +176,8 @@ typedef enum pgssStoreKind
 /*
  * Hashtable key that defines the identity of a hashtable entry.  We separate
  * queries by user and by database even if they are otherwise identical.
+ * With pg_stat_statements.track_plans, we also separate them by plan;
+ * otherwise, planid is 0.
  *
  * Right now, this structure contains no padding.  If you add any, make sure
  * to teach pgss_store() to zero the padding bytes.  Otherwise, things will
@@ -156,6 +189,7 @@ typedef struct pgssHashKey
 	Oid			userid;			/* user OID */
 	Oid			dbid;			/* database OID */
 	uint64		queryid;		/* query identifier */
+	uint64		planid;			/* plan identifier, or 0 */
 } pgssHashKey;
 
 /*
@@ -191,6 +225,8 @@ typedef struct Counters
 	int64		wal_records;	/* # of WAL records generated */
 	int64		wal_fpi;		/* # of WAL full page images generated */
 	uint64		wal_bytes;		/* total amount of WAL bytes generated */
+	/* # of plannings/executions by duration, see PGSS_HIST_BUCKETS */
+	int64		histogram[PGSS_NUMKIND][PGSS_HIST_BUCKETS];
 } Counters;
 
 /*
@@ -207,6 +243,7 @@ typedef struct pgssEntry
 	Size		query_offset;	/* query text offset in external file */
 	int			query_len;		/* # of valid bytes in query string, or -1 */
 	int			encoding;		/* query text encoding */
+	uint64		serial;			/* distinguishes entries with the same key */
 	slock_t		mutex;			/* protects the counters only */
 } pgssEntry;
 
@@ -218,12 +255,55 @@ typedef struct pgssSharedState
 	LWLock	   *lock;			/* protects hashtable search/modification */
 	double		cur_median_usage;	/* current median usage in hashtable */
 	Size		mean_query_len; /* current mean entry text length */
+	uint64		next_serial;	/* serial number of next new entry */
+	int			num_slots;		/* number of backend slots */
+	pg_atomic_uint32 removals;	/* bumped whenever entries are removed */
 	slock_t		mutex;			/* protects following fields only: */
 	Size		extent;			/* current extent of query file */
 	int			n_writers;		/* number of active writers to query file */
 	int			gc_count;		/* query file garbage collection cycle count */
+	bool		dealloc_in_progress;	/* is someone choosing victims? */
 } pgssSharedState;
 
+/*
+ * Key of pending counts: the entry's hash key and serial number
+ */
+typedef struct pgssPendingKey
+{
+	pgssHashKey key;			/* hash key of entry */
+	uint64		serial;			/* serial number of entry */
+} pgssPendingKey;
+
+/*
+ * Counts of a statement not yet added to its hashtable entry
+ */
+typedef struct pgssPendingEntry
+{
+	pgssPendingKey pkey;		/* MUST BE FIRST */
+	Counters	counters;		/* counts since the last flush */
+} pgssPendingEntry;
+
+/*
+ * Pending counts of one backend.  See the notes about locking at the head
+ * of the file.
+ */
+typedef struct pgssBackendSlot
+{
+	int			st_changecount; /* see PGSTAT_BEGIN_WRITE_ACTIVITY() */
+	uint32		removals;		/* pgss->removals at last flush */
+	int			nentries;		/* # of valid entries */
+	pgssPendingEntry entries[PGSS_PENDING_ENTRIES];
+} pgssBackendSlot;
+
+/*
+ * Candidate for deallocation, see entry_dealloc_choose()
+ */
+typedef struct pgssDeallocItem
+{
+	pgssHashKey key;			/* hash key of entry */
+	double		usage;			/* usage factor of entry */
+} pgssDeallocItem;
+
 /*
  * Struct for tracking locations/lengths of constants during normalization
  */
@@ -279,6 +359,13 @@ static ProcessUtility_hook_type prev_ProcessUtility = NULL;
 /* Links to shared memory state */
 static pgssSharedState *pgss = NULL;
 static HTAB *pgss_hash = NULL;
+static pgssBackendSlot *pgss_slots = NULL;
+
+/* This backend's slot of pending counts, once it has one */
+static pgssBackendSlot *MySlot = NULL;
+
+/* Time of this backend's last flush of pending counts */
+static TimestampTz pgss_last_flush = 0;
 
 /*---- GUC variables ----*/
 
@@ -301,6 +388,7 @@ static int	pgss_max;			/* max # statements to track */
 static int	pgss_track;			/* tracking level */
 static bool pgss_track_utility; /* whether to track utility commands */
 static bool pgss_track_planning;	/* whether to track planning duration */
+static bool pgss_track_plans;	/* whether to separate entries by plan */
 static bool pgss_save;			/* whether to save stats across shutdown */
 
 
@@ -326,6 +414,7 @@ PG_FUNCTION_INFO_V1(pg_stat_statements_reset_1_7);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_2);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_3);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_8);
+PG_FUNCTION_INFO_V1(pg_stat_statements_1_9);
 PG_FUNCTION_INFO_V1(pg_stat_statements);
 
 static void pgss_shmem_startup(void);
@@ -346,7 +435,8 @@ static void pgss_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
 								QueryEnvironment *queryEnv,
 								DestReceiver *dest, QueryCompletion *qc);
 static uint64 pgss_hash_string(const char *str, int len);
-static void pgss_store(const char *query, uint64 queryId,
+static uint64 pgss_plan_id(PlannedStmt *stmt);
+static void pgss_store(const char *query, uint64 queryId, uint64 planId,
 					   int query_location, int query_len,
 					   pgssStoreKind kind,
 					   double total_time, uint64 rows,
@@ -357,9 +447,28 @@ static void pg_stat_statements_internal(FunctionCallInfo fcinfo,
 										pgssVersion api_version,
 										bool showtext);
 static Size pgss_memsize(void);
+static int	pgss_num_slots(void);
+static void counters_add(Counters *counters, pgssStoreKind kind,
+						 double total_time, uint64 rows,
+						 const BufferUsage *bufusage,
+						 const WalUsage *walusage);
+static void counters_merge(Counters *dst, const Counters *src);
+static bool pgss_pending_count(pgssHashKey *key, pgssStoreKind kind,
+							   double total_time, uint64 rows,
+							   const BufferUsage *bufusage,
+							   const WalUsage *walusage);
+static bool pgss_pending_register(pgssEntry *entry);
+static void pgss_flush_pending(bool keep);
+static void pgss_backend_shutdown(int code, Datum arg);
+static HTAB *pgss_collect_pending(void);
 static pgssEntry *entry_alloc(pgssHashKey *key, Size query_offset, int query_len,
 							  int encoding, bool sticky);
 static void entry_dealloc(void);
+static pgssDeallocItem *entry_dealloc_choose(int *nvictims,
+											 double *median_usage,
+											 Size *mean_query_len);
+static void entry_dealloc_remove(pgssDeallocItem *victims, int nvictims,
+								 double median_usage, Size mean_query_len);
 static bool qtext_store(const char *query, int query_len,
 						Size *query_offset, int *gc_count);
 static char *qtext_load_file(Size *buffer_size);
@@ -374,6 +483,8 @@ static void JumbleQuery(pgssJumbleState *jstate, Query *query);
 static void JumbleRangeTable(pgssJumbleState *jstate, List *rtable);
 static void JumbleRowMarks(pgssJumbleState *jstate, List *rowMarks);
 static void JumbleExpr(pgssJumbleState *jstate, Node *node);
+static void JumblePlan(pgssJumbleState *jstate, PlannedStmt *stmt,
+					   Plan *plan);
 static void RecordConstLocation(pgssJumbleState *jstate, int location);
 static char *generate_normalized_query(pgssJumbleState *jstate, const char *query,
 									   int query_loc, int *query_len_p, int encoding);
@@ -449,6 +560,17 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable("pg_stat_statements.track_plans",
+							 "Selects whether pg_stat_statements keeps separate statistics for each plan of a statement.",
+							 NULL,
+							 &pgss_track_plans,
+							 false,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomBoolVariable("pg_stat_statements.save",
 							 "Save pg_stat_statements statistics across server shutdowns.",
 							 NULL,
@@ -534,6 +656,7 @@ pgss_shmem_startup(void)
 	/* reset in case this is a restart within the postmaster */
 	pgss = NULL;
 	pgss_hash = NULL;
+	pgss_slots = NULL;
 
 	/*
 	 * Create or attach to the shared memory state, including hash table
@@ -550,12 +673,23 @@ pgss_shmem_startup(void)
 		pgss->lock = &(GetNamedLWLockTranche("pg_stat_statements"))->lock;
 		pgss->cur_median_usage = ASSUMED_MEDIAN_INIT;
 		pgss->mean_query_len = ASSUMED_LENGTH_INIT;
+		pgss->next_serial = 0;
+		pgss->num_slots = pgss_num_slots();
+		pg_atomic_init_u32(&pgss->removals, 0);
 		SpinLockInit(&pgss->mutex);
 		pgss->extent = 0;
 		pgss->n_writers = 0;
 		pgss->gc_count = 0;
+		pgss->dealloc_in_progress = false;
 	}
 
+	pgss_slots = ShmemInitStruct("pg_stat_statements pending counts",
+								 mul_size(pgss->num_slots,
+										  sizeof(pgssBackendSlot)),
+								 &found);
+	if (!found)
+		memset(pgss_slots, 0, pgss->num_slots * sizeof(pgssBackendSlot));
+
 	memset(&info, 0, sizeof(info));
 	info.keysize = sizeof(pgssHashKey);
 	info.entrysize = sizeof(pgssEntry);
@@ -889,6 +1023,7 @@ pgss_post_parse_analyze(ParseState *pstate, Query *query)
 	if (jstate.clocations_count > 0)
 		pgss_store(pstate->p_sourcetext,
 				   query->queryId,
+				   UINT64CONST(0),
 				   query->stmt_location,
 				   query->stmt_len,
 				   PGSS_INVALID,
@@ -973,6 +1108,7 @@ pgss_planner(Query *parse,
 
 		pgss_store(query_string,
 				   parse->queryId,
+				   pgss_track_plans ? pgss_plan_id(result) : UINT64CONST(0),
 				   parse->stmt_location,
 				   parse->stmt_len,
 				   PGSS_PLAN,
@@ -1091,6 +1227,8 @@ pgss_ExecutorEnd(QueryDesc *queryDesc)
 
 		pgss_store(queryDesc->sourceText,
 				   queryId,
+				   pgss_track_plans ?
+				   pgss_plan_id(queryDesc->plannedstmt) : UINT64CONST(0),
 				   queryDesc->plannedstmt->stmt_location,
 				   queryDesc->plannedstmt->stmt_len,
 				   PGSS_EXEC,
@@ -1190,6 +1328,7 @@ pgss_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
 
 		pgss_store(queryString,
 				   0,			/* signal that it's a utility stmt */
+				   UINT64CONST(0),
 				   pstmt->stmt_location,
 				   pstmt->stmt_len,
 				   PGSS_EXEC,
@@ -1224,12 +1363,49 @@ pgss_hash_string(const char *str, int len)
 											len, 0));
 }
 
+/*
+ * Compute an identifier for the shape of a plan, for
+ * pg_stat_statements.track_plans.  See JumblePlan() for what's included.
+ */
+static uint64
+pgss_plan_id(PlannedStmt *stmt)
+{
+	pgssJumbleState jstate;
+	ListCell   *lc;
+	uint64		planId;
+
+	/* Set up workspace for plan jumbling; no constants are recorded */
+	jstate.jumble = (unsigned char *) palloc(JUMBLE_SIZE);
+	jstate.jumble_len = 0;
+	jstate.clocations_buf_size = 0;
+	jstate.clocations = NULL;
+	jstate.clocations_count = 0;
+	jstate.highest_extern_param_id = 0;
+
+	JumblePlan(&jstate, stmt, stmt->planTree);
+	foreach(lc, stmt->subplans)
+		JumblePlan(&jstate, stmt, (Plan *) lfirst(lc));
+
+	planId = DatumGetUInt64(hash_any_extended(jstate.jumble,
+											  jstate.jumble_len, 0));
+	pfree(jstate.jumble);
+
+	/* 0 means "not tracking plans" */
+	if (planId == UINT64CONST(0))
+		planId = UINT64CONST(1);
+
+	return planId;
+}
+
 /*
  * Store some statistics for a statement.
  *
  * If queryId is 0 then this is a utility statement and we should compute
  * a suitable queryId internally.
  *
+ * planId identifies the plan if pg_stat_statements.track_plans is on, and is
+ * 0 otherwise.
+ *
  * If jstate is not NULL then we're trying to create an entry for which
  * we have no statistics as yet; we just want to record the normalized
  * query string.  total_time, rows, bufusage and walusage are ignored in this
@@ -1239,7 +1415,7 @@ pgss_hash_string(const char *str, int len)
  * for the arrays in the Counters field.
  */
 static void
-pgss_store(const char *query, uint64 queryId,
+pgss_store(const char *query, uint64 queryId, uint64 planId,
 		   int query_location, int query_len,
 		   pgssStoreKind kind,
 		   double total_time, uint64 rows,
@@ -1251,6 +1427,7 @@ pgss_store(const char *query, uint64 queryId,
 	pgssEntry  *entry;
 	char	   *norm_query = NULL;
 	int			encoding = GetDatabaseEncoding();
+	bool		need_flush = false;
 
 	Assert(query != NULL);
 
@@ -1310,6 +1487,15 @@ pgss_store(const char *query, uint64 queryId,
 	key.userid = GetUserId();
 	key.dbid = MyDatabaseId;
 	key.queryid = queryId;
+	key.planid = planId;
+
+	/*
+	 * If we have executed the statement before, just add to our pending
+	 * counts, without taking any lock.
+	 */
+	if (!jstate &&
+		pgss_pending_count(&key, kind, total_time, rows, bufusage, walusage))
+		return;
 
 	/* Lookup the hash table entry with shared lock. */
 	LWLockAcquire(pgss->lock, LW_SHARED);
@@ -1319,10 +1505,16 @@ pgss_store(const char *query, uint64 queryId,
 	/* Create new entry, if not present */
 	if (!entry)
 	{
-		Size		query_offset;
-		int			gc_count;
-		bool		stored;
+		Size		query_offset = 0;
+		int			gc_count = 0;
+		bool		stored = false;
 		bool		do_gc;
+		pgssHashKey text_key;
+		pgssEntry  *text_entry = NULL;
+		pgssDeallocItem *victims = NULL;
+		int			nvictims = 0;
+		double		median_usage = 0.0;
+		Size		mean_query_len = 0;
 
 		/*
 		 * Create a new, normalized query string if caller asked.  We don't
@@ -1341,9 +1533,24 @@ pgss_store(const char *query, uint64 queryId,
 			LWLockAcquire(pgss->lock, LW_SHARED);
 		}
 
+		/*
+		 * For a new plan of a statement whose constants were normalized
+		 * away, parse analysis made an entry with planid 0 to hold the
+		 * normalized query text.  Share that text rather than storing the
+		 * text of this execution, with the constants.
+		 */
+		if (planId != UINT64CONST(0))
+		{
+			text_key = key;
+			text_key.planid = UINT64CONST(0);
+			text_entry = (pgssEntry *) hash_search(pgss_hash, &text_key,
+												   HASH_FIND, NULL);
+		}
+
 		/* Append new query text to file with only shared lock held */
-		stored = qtext_store(norm_query ? norm_query : query, query_len,
-							 &query_offset, &gc_count);
+		if (text_entry == NULL)
+			stored = qtext_store(norm_query ? norm_query : query, query_len,
+								 &query_offset, &gc_count);
 
 		/*
 		 * Determine whether we need to garbage collect external query texts
@@ -1352,18 +1559,52 @@ pgss_store(const char *query, uint64 queryId,
 		 */
 		do_gc = need_gc_qtexts();
 
+		/*
+		 * Likewise, if the hashtable is full, choose the entries to
+		 * deallocate while still holding shared lock.  With a large
+		 * hashtable, that takes long enough that we don't want to block
+		 * everyone else meanwhile.
+		 */
+		if (hash_get_num_entries(pgss_hash) >= pgss_max)
+			victims = entry_dealloc_choose(&nvictims, &median_usage,
+										   &mean_query_len);
+
 		/* Need exclusive lock to make a new hashtable entry - promote */
 		LWLockRelease(pgss->lock);
 		LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
 
+		if (victims)
+		{
+			entry_dealloc_remove(victims, nvictims, median_usage,
+								 mean_query_len);
+			pfree(victims);
+		}
+
+		/*
+		 * Look up the entry holding the text again, since it may have gone
+		 * away or its text may have moved while we weren't holding the lock.
+		 */
+		if (text_entry != NULL)
+			text_entry = (pgssEntry *) hash_search(pgss_hash, &text_key,
+												   HASH_FIND, NULL);
+
+		if (text_entry != NULL && text_entry->query_len >= 0)
+		{
+			query_offset = text_entry->query_offset;
+			query_len = text_entry->query_len;
+			encoding = text_entry->encoding;
+			stored = true;
+		}
+
 		/*
 		 * A garbage collection may have occurred while we weren't holding the
 		 * lock.  In the unlikely event that this happens, the query text we
 		 * stored above will have been garbage collected, so write it again.
 		 * This should be infrequent enough that doing it while holding
-		 * exclusive lock isn't a performance problem.
+		 * exclusive lock isn't a performance problem.  Likewise if we meant
+		 * to share another entry's text, but can't.
 		 */
-		if (!stored || pgss->gc_count != gc_count)
+		else if (!stored || pgss->gc_count != gc_count)
 			stored = qtext_store(norm_query ? norm_query : query, query_len,
 								 &query_offset, NULL);
 
@@ -1383,75 +1624,403 @@ pgss_store(const char *query, uint64 queryId,
 	/* Increment the counts, except when jstate is not NULL */
 	if (!jstate)
 	{
+		Assert(kind == PGSS_PLAN || kind == PGSS_EXEC);
+
 		/*
 		 * Grab the spinlock while updating the counters (see comment about
 		 * locking rules at the head of the file)
 		 */
-		volatile pgssEntry *e = (volatile pgssEntry *) entry;
+		SpinLockAcquire(&entry->mutex);
 
-		Assert(kind == PGSS_PLAN || kind == PGSS_EXEC);
+		/* "Unstick" entry if it was previously sticky */
+		if (IS_STICKY(entry->counters))
+			entry->counters.usage = USAGE_INIT;
 
-		SpinLockAcquire(&e->mutex);
+		counters_add(&entry->counters, kind, total_time, rows, bufusage,
+					 walusage);
 
-		/* "Unstick" entry if it was previously sticky */
-		if (IS_STICKY(e->counters))
-			e->counters.usage = USAGE_INIT;
+		SpinLockRelease(&entry->mutex);
+
+		/* Count further executions in our slot */
+		need_flush = !pgss_pending_register(entry);
+	}
+
+done:
+	LWLockRelease(pgss->lock);
+
+	/* Make room in our slot if it was full */
+	if (need_flush)
+		pgss_flush_pending(false);
+
+	/* We postpone this clean-up until we're out of the lock */
+	if (norm_query)
+		pfree(norm_query);
+}
+
+/*
+ * Add the counts of one planning or execution to *counters
+ */
+static void
+counters_add(Counters *counters, pgssStoreKind kind,
+			 double total_time, uint64 rows,
+			 const BufferUsage *bufusage,
+			 const WalUsage *walusage)
+{
+	uint64		usecs = total_time > 0 ? (uint64) (total_time * 1000.0) : 0;
+	int			bucket;
+
+	counters->calls[kind] += 1;
+	counters->total_time[kind] += total_time;
+
+	if (usecs == 0)
+		bucket = 0;
+	else
+		bucket = Min(pg_leftmost_one_pos64(usecs) + 1,
+					 PGSS_HIST_BUCKETS - 1);
+	counters->histogram[kind][bucket] += 1;
+
+	if (counters->calls[kind] == 1)
+	{
+		counters->min_time[kind] = total_time;
+		counters->max_time[kind] = total_time;
+		counters->mean_time[kind] = total_time;
+	}
+	else
+	{
+		/*
+		 * Welford's method for accurately computing variance. See
+		 * <http://www.johndcook.com/blog/standard_deviation/>
+		 */
+		double		old_mean = counters->mean_time[kind];
+
+		counters->mean_time[kind] +=
+			(total_time - old_mean) / counters->calls[kind];
+		counters->sum_var_time[kind] +=
+			(total_time - old_mean) * (total_time - counters->mean_time[kind]);
+
+		/* calculate min and max time */
+		if (counters->min_time[kind] > total_time)
+			counters->min_time[kind] = total_time;
+		if (counters->max_time[kind] < total_time)
+			counters->max_time[kind] = total_time;
+	}
+	counters->rows += rows;
+	counters->shared_blks_hit += bufusage->shared_blks_hit;
+	counters->shared_blks_read += bufusage->shared_blks_read;
+	counters->shared_blks_dirtied += bufusage->shared_blks_dirtied;
+	counters->shared_blks_written += bufusage->shared_blks_written;
+	counters->local_blks_hit += bufusage->local_blks_hit;
+	counters->local_blks_read += bufusage->local_blks_read;
+	counters->local_blks_dirtied += bufusage->local_blks_dirtied;
+	counters->local_blks_written += bufusage->local_blks_written;
+	counters->temp_blks_read += bufusage->temp_blks_read;
+	counters->temp_blks_written += bufusage->temp_blks_written;
+	counters->blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_read_time);
+	counters->blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_write_time);
+	counters->usage += USAGE_EXEC(total_time);
+	counters->wal_records += walusage->wal_records;
+	counters->wal_fpi += walusage->wal_fpi;
+	counters->wal_bytes += walusage->wal_bytes;
+}
+
+/*
+ * Add the counts in *src to *dst
+ */
+static void
+counters_merge(Counters *dst, const Counters *src)
+{
+	for (int kind = 0; kind < PGSS_NUMKIND; kind++)
+	{
+		int64		n1 = dst->calls[kind];
+		int64		n2 = src->calls[kind];
 
-		e->counters.calls[kind] += 1;
-		e->counters.total_time[kind] += total_time;
+		if (n2 == 0)
+			continue;
 
-		if (e->counters.calls[kind] == 1)
+		if (n1 == 0)
 		{
-			e->counters.min_time[kind] = total_time;
-			e->counters.max_time[kind] = total_time;
-			e->counters.mean_time[kind] = total_time;
+			dst->min_time[kind] = src->min_time[kind];
+			dst->max_time[kind] = src->max_time[kind];
+			dst->mean_time[kind] = src->mean_time[kind];
+			dst->sum_var_time[kind] = src->sum_var_time[kind];
 		}
 		else
 		{
 			/*
-			 * Welford's method for accurately computing variance. See
-			 * <http://www.johndcook.com/blog/standard_deviation/>
+			 * Combine the means and sums of variances of the two sets, see
+			 * Chan et al., "Updating Formulae and a Pairwise Algorithm for
+			 * Computing Sample Variances".
 			 */
-			double		old_mean = e->counters.mean_time[kind];
-
-			e->counters.mean_time[kind] +=
-				(total_time - old_mean) / e->counters.calls[kind];
-			e->counters.sum_var_time[kind] +=
-				(total_time - old_mean) * (total_time - e->counters.mean_time[kind]);
-
-			/* calculate min and max time */
-			if (e->counters.min_time[kind] > total_time)
-				e->counters.min_time[kind] = total_time;
-			if (e->counters.max_time[kind] < total_time)
-				e->counters.max_time[kind] = total_time;
+			double		delta = src->mean_time[kind] - dst->mean_time[kind];
+			double		n = (double) (n1 + n2);
+
+			dst->mean_time[kind] += delta * n2 / n;
+			dst->sum_var_time[kind] += src->sum_var_time[kind] +
+				delta * delta * n1 * n2 / n;
+
+			if (dst->min_time[kind] > src->min_time[kind])
+				dst->min_time[kind] = src->min_time[kind];
+			if (dst->max_time[kind] < src->max_time[kind])
+				dst->max_time[kind] = src->max_time[kind];
 		}
-		e->counters.rows += rows;
-		e->counters.shared_blks_hit += bufusage->shared_blks_hit;
-		e->counters.shared_blks_read += bufusage->shared_blks_read;
-		e->counters.shared_blks_dirtied += bufusage->shared_blks_dirtied;
-		e->counters.shared_blks_written += bufusage->shared_blks_written;
-		e->counters.local_blks_hit += bufusage->local_blks_hit;
-		e->counters.local_blks_read += bufusage->local_blks_read;
-		e->counters.local_blks_dirtied += bufusage->local_blks_dirtied;
-		e->counters.local_blks_written += bufusage->local_blks_written;
-		e->counters.temp_blks_read += bufusage->temp_blks_read;
-		e->counters.temp_blks_written += bufusage->temp_blks_written;
-		e->counters.blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_read_time);
-		e->counters.blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_write_time);
-		e->counters.usage += USAGE_EXEC(total_time);
-		e->counters.wal_records += walusage->wal_records;
-		e->counters.wal_fpi += walusage->wal_fpi;
-		e->counters.wal_bytes += walusage->wal_bytes;
-
-		SpinLockRelease(&e->mutex);
+		dst->calls[kind] += n2;
+		dst->total_time[kind] += src->total_time[kind];
+		for (int bucket = 0; bucket < PGSS_HIST_BUCKETS; bucket++)
+			dst->histogram[kind][bucket] += src->histogram[kind][bucket];
 	}
+	dst->rows += src->rows;
+	dst->shared_blks_hit += src->shared_blks_hit;
+	dst->shared_blks_read += src->shared_blks_read;
+	dst->shared_blks_dirtied += src->shared_blks_dirtied;
+	dst->shared_blks_written += src->shared_blks_written;
+	dst->local_blks_hit += src->local_blks_hit;
+	dst->local_blks_read += src->local_blks_read;
+	dst->local_blks_dirtied += src->local_blks_dirtied;
+	dst->local_blks_written += src->local_blks_written;
+	dst->temp_blks_read += src->temp_blks_read;
+	dst->temp_blks_written += src->temp_blks_written;
+	dst->blk_read_time += src->blk_read_time;
+	dst->blk_write_time += src->blk_write_time;
+	dst->usage += src->usage;
+	dst->wal_records += src->wal_records;
+	dst->wal_fpi += src->wal_fpi;
+	dst->wal_bytes += src->wal_bytes;
+}
+
+/*
+ * Add the counts of one planning or execution to our pending counts, if we
+ * have an entry for the statement in our slot.  Returns false if not; the
+ * caller must then count it in the hashtable.
+ */
+static bool
+pgss_pending_count(pgssHashKey *key, pgssStoreKind kind,
+				   double total_time, uint64 rows,
+				   const BufferUsage *bufusage,
+				   const WalUsage *walusage)
+{
+	pgssBackendSlot *slot = MySlot;
+	int			i;
+
+	if (slot == NULL)
+		return false;
+
+	/*
+	 * If entries have been removed since our last flush, some of ours may
+	 * be gone.  Flush, to find out which.
+	 */
+	if (slot->removals != pg_atomic_read_u32(&pgss->removals))
+	{
+		pgss_flush_pending(true);
+		return false;
+	}
+
+	for (i = 0; i < slot->nentries; i++)
+	{
+		pgssPendingEntry *pentry = &slot->entries[i];
+
+		if (pentry->pkey.key.queryid == key->queryid &&
+			pentry->pkey.key.planid == key->planid &&
+			pentry->pkey.key.userid == key->userid &&
+			pentry->pkey.key.dbid == key->dbid)
+		{
+			PGSTAT_BEGIN_WRITE_ACTIVITY(slot);
+			counters_add(&pentry->counters, kind, total_time, rows,
+						 bufusage, walusage);
+			PGSTAT_END_WRITE_ACTIVITY(slot);
+
+			if (TimestampDifferenceExceeds(pgss_last_flush,
+										   GetCurrentStatementStartTimestamp(),
+										   PGSS_FLUSH_INTERVAL))
+				pgss_flush_pending(true);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Make an entry for the given hashtable entry in our slot, so that further
+ * executions of the statement are counted there.  Returns false if the slot
+ * has to be flushed first.
+ *
+ * Caller must hold pgss->lock.
+ */
+static bool
+pgss_pending_register(pgssEntry *entry)
+{
+	pgssBackendSlot *slot;
+	pgssPendingEntry *pentry;
+
+	/* Take our slot on first use */
+	if (MySlot == NULL)
+	{
+		if (MyBackendId == InvalidBackendId || MyBackendId > pgss->num_slots)
+			return true;		/* no slot, count everything directly */
+
+		MySlot = &pgss_slots[MyBackendId - 1];
+		before_shmem_exit(pgss_backend_shutdown, (Datum) 0);
+
+		/*
+		 * Whatever the previous owner of the slot left in it is still
+		 * valid, and is flushed along with our own counts.
+		 */
+	}
+	slot = MySlot;
+
+	if (slot->nentries >= PGSS_PENDING_ENTRIES ||
+		slot->removals != pg_atomic_read_u32(&pgss->removals))
+		return false;
+
+	PGSTAT_BEGIN_WRITE_ACTIVITY(slot);
+	pentry = &slot->entries[slot->nentries];
+	pentry->pkey.key = entry->key;
+	pentry->pkey.serial = entry->serial;
+	memset(&pentry->counters, 0, sizeof(Counters));
+	slot->nentries++;
+	PGSTAT_END_WRITE_ACTIVITY(slot);
+
+	return true;
+}
+
+/*
+ * Add our pending counts to the hashtable entries.
+ *
+ * If keep is true, the entries in our slot are kept for further counting,
+ * except those whose hashtable entry is gone; otherwise the slot is emptied.
+ */
+static void
+pgss_flush_pending(bool keep)
+{
+	pgssBackendSlot *slot = MySlot;
+	int			i;
+	int			nkept = 0;
+
+	if (slot == NULL)
+		return;
+
+	LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
+
+	PGSTAT_BEGIN_WRITE_ACTIVITY(slot);
+	for (i = 0; i < slot->nentries; i++)
+	{
+		pgssPendingEntry *pentry = &slot->entries[i];
+		pgssEntry  *entry;
+
+		entry = (pgssEntry *) hash_search(pgss_hash, &pentry->pkey.key,
+										  HASH_FIND, NULL);
+
+		/* Drop the counts if the entry has been removed */
+		if (entry == NULL || entry->serial != pentry->pkey.serial)
+			continue;
+
+		/* no need for the spinlock, since we hold the lock exclusively */
+		counters_merge(&entry->counters, &pentry->counters);
+
+		if (keep)
+		{
+			if (nkept != i)
+				slot->entries[nkept].pkey = pentry->pkey;
+			memset(&slot->entries[nkept].counters, 0, sizeof(Counters));
+			nkept++;
+		}
+	}
+	slot->nentries = nkept;
+	slot->removals = pg_atomic_read_u32(&pgss->removals);
+	PGSTAT_END_WRITE_ACTIVITY(slot);
 
-done:
 	LWLockRelease(pgss->lock);
 
-	/* We postpone this clean-up until we're out of the lock */
-	if (norm_query)
-		pfree(norm_query);
+	pgss_last_flush = GetCurrentStatementStartTimestamp();
+}
+
+/*
+ * Flush our pending counts at backend exit
+ */
+static void
+pgss_backend_shutdown(int code, Datum arg)
+{
+	/*
+	 * If we're exiting because of an error while holding the lock, leave the
+	 * counts for the next owner of the slot to flush.  Readers see them in
+	 * the meantime.
+	 */
+	if (LWLockHeldByMe(pgss->lock))
+		return;
+
+	pgss_flush_pending(false);
+	MySlot = NULL;
+}
+
+/*
+ * Sum up the pending counts of all backends, in a hashtable keyed by
+ * pgssPendingKey allocated in the current memory context.
+ *
+ * Caller must hold pgss->lock shared, so that no counts can be moved from
+ * the slots to the hashtable entries until it is done.
+ */
+static HTAB *
+pgss_collect_pending(void)
+{
+	HASHCTL		ctl;
+	HTAB	   *htab;
+	pgssBackendSlot *copy;
+	int			s;
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(pgssPendingKey);
+	ctl.entrysize = sizeof(pgssPendingEntry);
+	ctl.hcxt = CurrentMemoryContext;
+	htab = hash_create("pg_stat_statements pending counts", 256, &ctl,
+					   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	copy = (pgssBackendSlot *) palloc(sizeof(pgssBackendSlot));
+
+	for (s = 0; s < pgss->num_slots; s++)
+	{
+		volatile pgssBackendSlot *slot = &pgss_slots[s];
+		int			i;
+
+		/* Quick exit for empty slots; a racy check is good enough */
+		if (slot->nentries == 0)
+			continue;
+
+		for (;;)
+		{
+			int			before_changecount;
+			int			after_changecount;
+
+			pgstat_begin_read_activity(slot, before_changecount);
+			memcpy(copy, unvolatize(pgssBackendSlot *, slot),
+				   sizeof(pgssBackendSlot));
+			pgstat_end_read_activity(slot, after_changecount);
+
+			if (pgstat_read_activity_complete(before_changecount,
+											  after_changecount))
+				break;
+
+			/* Make sure we can break out of loop if stuck... */
+			CHECK_FOR_INTERRUPTS();
+		}
+
+		for (i = 0; i < copy->nentries; i++)
+		{
+			pgssPendingEntry *pentry = &copy->entries[i];
+			pgssPendingEntry *sum;
+			bool		found;
+
+			sum = (pgssPendingEntry *) hash_search(htab, &pentry->pkey,
+												   HASH_ENTER, &found);
+			if (!found)
+				memset(&sum->counters, 0, sizeof(Counters));
+			counters_merge(&sum->counters, &pentry->counters);
+		}
+	}
+
+	pfree(copy);
+
+	return htab;
 }
 
 /*
@@ -1490,7 +2059,8 @@ pg_stat_statements_reset(PG_FUNCTION_ARGS)
 #define PG_STAT_STATEMENTS_COLS_V1_2	19
 #define PG_STAT_STATEMENTS_COLS_V1_3	23
 #define PG_STAT_STATEMENTS_COLS_V1_8	32
-#define PG_STAT_STATEMENTS_COLS			32	/* maximum of above */
+#define PG_STAT_STATEMENTS_COLS_V1_9	35
+#define PG_STAT_STATEMENTS_COLS			35	/* maximum of above */
 
 /*
  * Retrieve statement statistics.
@@ -1502,6 +2072,16 @@ pg_stat_statements_reset(PG_FUNCTION_ARGS)
  * expected API version is identified by embedding it in the C name of the
  * function.  Unfortunately we weren't bright enough to do that for 1.1.
  */
+Datum
+pg_stat_statements_1_9(PG_FUNCTION_ARGS)
+{
+	bool		showtext = PG_GETARG_BOOL(0);
+
+	pg_stat_statements_internal(fcinfo, PGSS_V1_9, showtext);
+
+	return (Datum) 0;
+}
+
 Datum
 pg_stat_statements_1_8(PG_FUNCTION_ARGS)
 {
@@ -1564,6 +2144,7 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 	int			gc_count = 0;
 	HASH_SEQ_STATUS hash_seq;
 	pgssEntry  *entry;
+	HTAB	   *pending;
 
 	/* Superusers or members of pg_read_all_stats members are allowed */
 	is_allowed_role = is_member_of_role(GetUserId(), DEFAULT_ROLE_READ_ALL_STATS);
@@ -1621,6 +2202,10 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 			if (api_version != PGSS_V1_8)
 				elog(ERROR, "incorrect number of output arguments");
 			break;
+		case PG_STAT_STATEMENTS_COLS_V1_9:
+			if (api_version != PGSS_V1_9)
+				elog(ERROR, "incorrect number of output arguments");
+			break;
 		default:
 			elog(ERROR, "incorrect number of output arguments");
 	}
@@ -1697,6 +2282,9 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 		}
 	}
 
+	/* Gather the counts not yet flushed by backends */
+	pending = pgss_collect_pending();
+
 	hash_seq_init(&hash_seq, pgss_hash);
 	while ((entry = hash_seq_search(&hash_seq)) != NULL)
 	{
@@ -1706,6 +2294,9 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 		Counters	tmp;
 		double		stddev;
 		int64		queryid = entry->key.queryid;
+		int64		planid = entry->key.planid;
+		pgssPendingKey pkey;
+		pgssPendingEntry *pentry;
 
 		memset(values, 0, sizeof(values));
 		memset(nulls, 0, sizeof(nulls));
@@ -1717,6 +2308,8 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 		{
 			if (api_version >= PGSS_V1_2)
 				values[i++] = Int64GetDatumFast(queryid);
+			if (api_version >= PGSS_V1_9)
+				values[i++] = Int64GetDatumFast(planid);
 
 			if (showtext)
 			{
@@ -1752,9 +2345,11 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 		}
 		else
 		{
-			/* Don't show queryid */
+			/* Don't show queryid and planid */
 			if (api_version >= PGSS_V1_2)
 				nulls[i++] = true;
+			if (api_version >= PGSS_V1_9)
+				nulls[i++] = true;
 
 			/*
 			 * Don't show query text, but hint as to the reason for not doing
@@ -1775,6 +2370,15 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 			SpinLockRelease(&e->mutex);
 		}
 
+		/* add the counts still pending in backends */
+		memset(&pkey, 0, sizeof(pkey));
+		pkey.key = entry->key;
+		pkey.serial = entry->serial;
+		pentry = (pgssPendingEntry *) hash_search(pending, &pkey,
+												  HASH_FIND, NULL);
+		if (pentry)
+			counters_merge(&tmp, &pentry->counters);
+
 		/* Skip entry if unexecuted (ie, it's a pending "sticky" entry) */
 		if (IS_STICKY(tmp))
 			continue;
@@ -1843,12 +2447,28 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 											Int32GetDatum(-1));
 			values[i++] = wal_bytes;
 		}
+		if (api_version >= PGSS_V1_9)
+		{
+			for (int kind = 0; kind < PGSS_NUMKIND; kind++)
+			{
+				Datum		buckets[PGSS_HIST_BUCKETS];
+
+				for (int bucket = 0; bucket < PGSS_HIST_BUCKETS; bucket++)
+					buckets[bucket] = Int64GetDatum(tmp.histogram[kind][bucket]);
+				values[i++] = PointerGetDatum(construct_array(buckets,
+															  PGSS_HIST_BUCKETS,
+															  INT8OID, 8,
+															  FLOAT8PASSBYVAL,
+															  TYPALIGN_DOUBLE));
+			}
+		}
 
 		Assert(i == (api_version == PGSS_V1_0 ? PG_STAT_STATEMENTS_COLS_V1_0 :
 					 api_version == PGSS_V1_1 ? PG_STAT_STATEMENTS_COLS_V1_1 :
 					 api_version == PGSS_V1_2 ? PG_STAT_STATEMENTS_COLS_V1_2 :
 					 api_version == PGSS_V1_3 ? PG_STAT_STATEMENTS_COLS_V1_3 :
 					 api_version == PGSS_V1_8 ? PG_STAT_STATEMENTS_COLS_V1_8 :
+					 api_version == PGSS_V1_9 ? PG_STAT_STATEMENTS_COLS_V1_9 :
 					 -1 /* fail if you forget to update this assert */ ));
 
 		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
@@ -1857,6 +2477,8 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 	/* clean up and return the tuplestore */
 	LWLockRelease(pgss->lock);
 
+	hash_destroy(pending);
+
 	if (qbuffer)
 		free(qbuffer);
 
@@ -1873,10 +2495,25 @@ pgss_memsize(void)
 
 	size = MAXALIGN(sizeof(pgssSharedState));
 	size = add_size(size, hash_estimate_size(pgss_max, sizeof(pgssEntry)));
+	size = add_size(size, mul_size(pgss_num_slots(),
+								   sizeof(pgssBackendSlot)));
 
 	return size;
 }
 
+/*
+ * Number of backend slots for pending counts: one per backend.
+ *
+ * MaxBackends isn't computed yet when _PG_init() requests shared memory, so
+ * compute it the same way as InitializeMaxBackends().
+ */
+static int
+pgss_num_slots(void)
+{
+	return MaxConnections + autovacuum_max_workers + 1 +
+		max_worker_processes + max_wal_senders;
+}
+
 /*
  * Allocate a new hashtable entry.
  * caller must hold an exclusive lock on pgss->lock
@@ -1916,6 +2553,8 @@ entry_alloc(pgssHashKey *key, Size query_offset, int query_len, int encoding,
 		memset(&entry->counters, 0, sizeof(Counters));
 		/* set the appropriate initial usage count */
 		entry->counters.usage = sticky ? pgss->cur_median_usage : USAGE_INIT;
+		/* pending counts for previous entries with this key don't apply */
+		entry->serial = pgss->next_serial++;
 		/* re-initialize the mutex each time ... we assume no one using it */
 		SpinLockInit(&entry->mutex);
 		/* ... and don't forget the query text metadata */
@@ -1934,8 +2573,8 @@ entry_alloc(pgssHashKey *key, Size query_offset, int query_len, int encoding,
 static int
 entry_cmp(const void *lhs, const void *rhs)
 {
-	double		l_usage = (*(pgssEntry *const *) lhs)->counters.usage;
-	double		r_usage = (*(pgssEntry *const *) rhs)->counters.usage;
+	double		l_usage = ((const pgssDeallocItem *) lhs)->usage;
+	double		r_usage = ((const pgssDeallocItem *) rhs)->usage;
 
 	if (l_usage < r_usage)
 		return -1;
@@ -1953,27 +2592,82 @@ entry_cmp(const void *lhs, const void *rhs)
 static void
 entry_dealloc(void)
 {
+	pgssDeallocItem *victims;
+	int			nvictims;
+	double		median_usage;
+	Size		mean_query_len;
+
+	victims = entry_dealloc_choose(&nvictims, &median_usage, &mean_query_len);
+
+	/*
+	 * If some other backend has chosen victims, it must be waiting for
+	 * exclusive lock to remove them, since we hold it.  We can't wait for
+	 * it, so choose our own; the only harm is that the usage values decay
+	 * twice, and that a few more entries get deallocated.
+	 */
+	if (victims == NULL)
+	{
+		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
+
+		SpinLockAcquire(&s->mutex);
+		s->dealloc_in_progress = false;
+		SpinLockRelease(&s->mutex);
+
+		victims = entry_dealloc_choose(&nvictims, &median_usage,
+									   &mean_query_len);
+		Assert(victims != NULL);
+	}
+
+	entry_dealloc_remove(victims, nvictims, median_usage, mean_query_len);
+	pfree(victims);
+}
+
+/*
+ * Choose the least-used entries to deallocate, the first step of
+ * entry_dealloc().
+ *
+ * Sort entries by usage and pick USAGE_DEALLOC_PERCENT of them.  While we're
+ * scanning the table, apply the decay factor to the usage values, and
+ * compute the median usage and mean query length.  Returns a palloc'd array
+ * of the victims, which entry_dealloc_remove() must then be called with, or
+ * NULL if another backend is already choosing victims.
+ *
+ * Note that the mean query length is almost immediately obsolete, since
+ * we compute it before not after discarding the least-used entries.
+ * Hopefully, that doesn't affect the mean too much; it doesn't seem worth
+ * making two passes to get a more current result.  Likewise, the new
+ * cur_median_usage includes the entries we're about to zap.
+ *
+ * Caller must hold pgss->lock, but a shared lock is enough, so that this
+ * doesn't block other backends even with a large hashtable.  The usage
+ * values are updated under the entries' spinlocks.
+ */
+static pgssDeallocItem *
+entry_dealloc_choose(int *nvictims, double *median_usage,
+					 Size *mean_query_len)
+{
+	volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
 	HASH_SEQ_STATUS hash_seq;
-	pgssEntry **entries;
+	pgssDeallocItem *items;
 	pgssEntry  *entry;
-	int			nvictims;
+	long		max_items;
 	int			i;
 	Size		tottextlen;
 	int			nvalidtexts;
 
-	/*
-	 * Sort entries by usage and deallocate USAGE_DEALLOC_PERCENT of them.
-	 * While we're scanning the table, apply the decay factor to the usage
-	 * values, and update the mean query length.
-	 *
-	 * Note that the mean query length is almost immediately obsolete, since
-	 * we compute it before not after discarding the least-used entries.
-	 * Hopefully, that doesn't affect the mean too much; it doesn't seem worth
-	 * making two passes to get a more current result.  Likewise, the new
-	 * cur_median_usage includes the entries we're about to zap.
-	 */
+	/* allocate before announcing ourselves, in case it fails */
+	max_items = hash_get_num_entries(pgss_hash);
+	items = palloc(Max(max_items, 1) * sizeof(pgssDeallocItem));
 
-	entries = palloc(hash_get_num_entries(pgss_hash) * sizeof(pgssEntry *));
+	SpinLockAcquire(&s->mutex);
+	if (s->dealloc_in_progress)
+	{
+		SpinLockRelease(&s->mutex);
+		pfree(items);
+		return NULL;
+	}
+	s->dealloc_in_progress = true;
+	SpinLockRelease(&s->mutex);
 
 	i = 0;
 	tottextlen = 0;
@@ -1982,12 +2676,25 @@ entry_dealloc(void)
 	hash_seq_init(&hash_seq, pgss_hash);
 	while ((entry = hash_seq_search(&hash_seq)) != NULL)
 	{
-		entries[i++] = entry;
+		/* with only shared lock, entries may have been added meanwhile */
+		if (i >= max_items)
+		{
+			hash_seq_term(&hash_seq);
+			break;
+		}
+
+		SpinLockAcquire(&entry->mutex);
 		/* "Sticky" entries get a different usage decay rate. */
 		if (IS_STICKY(entry->counters))
 			entry->counters.usage *= STICKY_DECREASE_FACTOR;
 		else
 			entry->counters.usage *= USAGE_DECREASE_FACTOR;
+		items[i].usage = entry->counters.usage;
+		SpinLockRelease(&entry->mutex);
+
+		items[i].key = entry->key;
+		i++;
+
 		/* In the mean length computation, ignore dropped texts. */
 		if (entry->query_len >= 0)
 		{
@@ -1997,27 +2704,53 @@ entry_dealloc(void)
 	}
 
 	/* Sort into increasing order by usage */
-	qsort(entries, i, sizeof(pgssEntry *), entry_cmp);
+	qsort(items, i, sizeof(pgssDeallocItem), entry_cmp);
 
 	/* Record the (approximate) median usage */
 	if (i > 0)
-		pgss->cur_median_usage = entries[i / 2]->counters.usage;
+		*median_usage = items[i / 2].usage;
+	else
+		*median_usage = pgss->cur_median_usage;
 	/* Record the mean query length */
 	if (nvalidtexts > 0)
-		pgss->mean_query_len = tottextlen / nvalidtexts;
+		*mean_query_len = tottextlen / nvalidtexts;
 	else
-		pgss->mean_query_len = ASSUMED_LENGTH_INIT;
+		*mean_query_len = ASSUMED_LENGTH_INIT;
 
-	/* Now zap an appropriate fraction of lowest-usage entries */
-	nvictims = Max(10, i * USAGE_DEALLOC_PERCENT / 100);
-	nvictims = Min(nvictims, i);
+	/* Now pick an appropriate fraction of lowest-usage entries */
+	*nvictims = Max(10, i * USAGE_DEALLOC_PERCENT / 100);
+	*nvictims = Min(*nvictims, i);
+
+	return items;
+}
+
+/*
+ * Remove the entries chosen by entry_dealloc_choose(), the second step of
+ * entry_dealloc().  Victims that are gone already are ignored.
+ *
+ * Caller must hold an exclusive lock on pgss->lock.
+ */
+static void
+entry_dealloc_remove(pgssDeallocItem *victims, int nvictims,
+					 double median_usage, Size mean_query_len)
+{
+	volatile pgssSharedState *s = (volatile pgssSharedState *) pgss;
+	int			i;
+
+	pgss->cur_median_usage = median_usage;
+	pgss->mean_query_len = mean_query_len;
 
 	for (i = 0; i < nvictims; i++)
 	{
-		hash_search(pgss_hash, &entries[i]->key, HASH_REMOVE, NULL);
+		hash_search(pgss_hash, &victims[i].key, HASH_REMOVE, NULL);
 	}
 
-	pfree(entries);
+	/* make backends check which of their pending counts are still wanted */
+	pg_atomic_fetch_add_u32(&pgss->removals, 1);
+
+	SpinLockAcquire(&s->mutex);
+	s->dealloc_in_progress = false;
+	SpinLockRelease(&s->mutex);
 }
 
 /*
@@ -2458,7 +3191,6 @@ entry_reset(Oid userid, Oid dbid, uint64 queryid)
 	FILE	   *qfile;
 	long		num_entries;
 	long		num_remove = 0;
-	pgssHashKey key;
 
 	if (!pgss || !pgss_hash)
 		ereport(ERROR,
@@ -2468,20 +3200,12 @@ entry_reset(Oid userid, Oid dbid, uint64 queryid)
 	LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
 	num_entries = hash_get_num_entries(pgss_hash);
 
-	if (userid != 0 && dbid != 0 && queryid != UINT64CONST(0))
-	{
-		/* If all the parameters are available, use the fast path. */
-		key.userid = userid;
-		key.dbid = dbid;
-		key.queryid = queryid;
-
-		/* Remove the key if exists */
-		entry = (pgssEntry *) hash_search(pgss_hash, &key, HASH_REMOVE, NULL);
-		if (entry)				/* found */
-			num_remove++;
-	}
-	else if (userid != 0 || dbid != 0 || queryid != UINT64CONST(0))
+	if (userid != 0 || dbid != 0 || queryid != UINT64CONST(0))
 	{
+		/*
+		 * There is no fast path for all parameters given, since there may
+		 * be an entry for each plan of the query.
+		 */
 		/* Remove entries corresponding to valid parameters. */
 		hash_seq_init(&hash_seq, pgss_hash);
 		while ((entry = hash_seq_search(&hash_seq)) != NULL)
@@ -2506,6 +3230,10 @@ entry_reset(Oid userid, Oid dbid, uint64 queryid)
 		}
 	}
 
+	/* make backends check which of their pending counts are still wanted */
+	if (num_remove > 0)
+		pg_atomic_fetch_add_u32(&pgss->removals, 1);
+
 	/* All entries are removed? */
 	if (num_entries != num_remove)
 		goto release_lock;
@@ -3188,6 +3916,125 @@ JumbleExpr(pgssJumbleState *jstate, Node *node)
 	}
 }
 
+/*
+ * Jumble a plan tree, for pgss_plan_id().
+ *
+ * Only the shape of the plan is included: the node types, the relations and
+ * indexes scanned, and the strategies of joins, aggregation and the like.
+ * Costs, row estimates and expressions are left out, so that the same plan
+ * gets the same identifier whatever constants it was made for.  Subplans are
+ * jumbled separately by the caller.
+ */
+static void
+JumblePlan(pgssJumbleState *jstate, PlannedStmt *stmt, Plan *plan)
+{
+	NodeTag		tag;
+	ListCell   *lc;
+
+	/* mark missing children too, so that different shapes don't collide */
+	tag = plan ? nodeTag(plan) : T_Invalid;
+	APP_JUMB(tag);
+	if (plan == NULL)
+		return;
+
+	switch (tag)
+	{
+		case T_SeqScan:
+		case T_SampleScan:
+		case T_BitmapHeapScan:
+		case T_TidScan:
+		case T_ForeignScan:
+			{
+				Scan	   *scan = (Scan *) plan;
+
+				/* a foreign join has no scan relation */
+				if (scan->scanrelid > 0)
+				{
+					RangeTblEntry *rte = rt_fetch(scan->scanrelid,
+												  stmt->rtable);
+
+					APP_JUMB(rte->relid);
+				}
+			}
+			break;
+		case T_IndexScan:
+			{
+				IndexScan  *scan = (IndexScan *) plan;
+				RangeTblEntry *rte = rt_fetch(scan->scan.scanrelid,
+											  stmt->rtable);
+
+				APP_JUMB(rte->relid);
+				APP_JUMB(scan->indexid);
+				APP_JUMB(scan->indexorderdir);
+			}
+			break;
+		case T_IndexOnlyScan:
+			{
+				IndexOnlyScan *scan = (IndexOnlyScan *) plan;
+				RangeTblEntry *rte = rt_fetch(scan->scan.scanrelid,
+											  stmt->rtable);
+
+				APP_JUMB(rte->relid);
+				APP_JUMB(scan->indexid);
+				APP_JUMB(scan->indexorderdir);
+			}
+			break;
+		case T_BitmapIndexScan:
+			{
+				BitmapIndexScan *scan = (BitmapIndexScan *) plan;
+
+				APP_JUMB(scan->indexid);
+			}
+			break;
+		case T_SubqueryScan:
+			JumblePlan(jstate, stmt, ((SubqueryScan *) plan)->subplan);
+			break;
+		case T_CustomScan:
+			foreach(lc, ((CustomScan *) plan)->custom_plans)
+				JumblePlan(jstate, stmt, (Plan *) lfirst(lc));
+			break;
+		case T_NestLoop:
+		case T_MergeJoin:
+		case T_HashJoin:
+			APP_JUMB(((Join *) plan)->jointype);
+			break;
+		case T_Agg:
+			APP_JUMB(((Agg *) plan)->aggstrategy);
+			APP_JUMB(((Agg *) plan)->aggsplit);
+			break;
+		case T_SetOp:
+			APP_JUMB(((SetOp *) plan)->cmd);
+			APP_JUMB(((SetOp *) plan)->strategy);
+			break;
+		case T_ModifyTable:
+			APP_JUMB(((ModifyTable *) plan)->operation);
+			foreach(lc, ((ModifyTable *) plan)->plans)
+				JumblePlan(jstate, stmt, (Plan *) lfirst(lc));
+			break;
+		case T_Append:
+			foreach(lc, ((Append *) plan)->appendplans)
+				JumblePlan(jstate, stmt, (Plan *) lfirst(lc));
+			break;
+		case T_MergeAppend:
+			foreach(lc, ((MergeAppend *) plan)->mergeplans)
+				JumblePlan(jstate, stmt, (Plan *) lfirst(lc));
+			break;
+		case T_BitmapAnd:
+			foreach(lc, ((BitmapAnd *) plan)->bitmapplans)
+				JumblePlan(jstate, stmt, (Plan *) lfirst(lc));
+			break;
+		case T_BitmapOr:
+			foreach(lc, ((BitmapOr *) plan)->bitmapplans)
+				JumblePlan(jstate, stmt, (Plan *) lfirst(lc));
+			break;
+		default:
+			break;
+	}
+
+	JumblePlan(jstate, stmt, plan->lefttree);
+	JumblePlan(jstate, stmt, plan->righttree);
+}
+
 /*
  * Record location of constant within query string of query tree
  * that is currently being walked.
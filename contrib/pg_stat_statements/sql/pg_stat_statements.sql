@@ -357,4 +357,26 @@ SELECT 42;
 SELECT 42;
 SELECT query, plans, calls, rows FROM pg_stat_statements ORDER BY query COLLATE "C";
 
+--
+-- plan-level statistics and histograms
+--
+SELECT pg_stat_statements_reset();
+SET pg_stat_statements.track_plans = on;
+CREATE TABLE pgss_plans (a int PRIMARY KEY);
+SET enable_seqscan = off;
+SELECT count(*) FROM pgss_plans WHERE a = 1;
+RESET enable_seqscan;
+SET enable_indexscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*) FROM pgss_plans WHERE a = 2;
+RESET enable_indexscan;
+RESET enable_bitmapscan;
+SET pg_stat_statements.track_plans = off;
+SELECT query, plans, calls, planid <> 0 AS has_planid,
+       (SELECT sum(h) FROM unnest(exec_time_histogram) h) = calls AS exec_hist_ok,
+       (SELECT sum(h) FROM unnest(plan_time_histogram) h) = plans AS plan_hist_ok
+  FROM pg_stat_statements WHERE query LIKE 'SELECT count(*) FROM pgss_plans%'
+  ORDER BY planid;
+DROP TABLE pgss_plans;
+
 DROP EXTENSION pg_stat_statements;
@@ -41,8 +41,19 @@
 typedef char trgm[3];
 
 #define CMPCHAR(a,b) ( ((a)==(b)) ? 0 : ( ((a)<(b)) ? -1 : 1 ) )
-#define CMPPCHAR(a,b,i)  CMPCHAR( *(((const char*)(a))+i), *(((const char*)(b))+i) )
-#define CMPTRGM(a,b) ( CMPPCHAR(a,b,0) ? CMPPCHAR(a,b,0) : ( CMPPCHAR(a,b,1) ? CMPPCHAR(a,b,1) : CMPPCHAR(a,b,2) ) )
+
+/*
+ * Trigrams are ordered by comparing their bytes as chars.  TRGMINT packs a
+ * trigram into an integer that sorts the same way, each byte being offset
+ * by CHAR_MIN so that this holds whether char is signed or not; comparing
+ * those takes a single branch instead of up to three.  The order must not
+ * change, as sorted trigram arrays are stored in GiST indexes.
+ */
+#define TRGMINT(a) \
+	( (((uint32) (((const char *) (a))[0] - CHAR_MIN)) << 16) | \
+	  (((uint32) (((const char *) (a))[1] - CHAR_MIN)) << 8) | \
+	  ((uint32) (((const char *) (a))[2] - CHAR_MIN)) )
+#define CMPTRGM(a,b) CMPCHAR(TRGMINT(a), TRGMINT(b))
 
 #define CPTRGM(a,b) do {				\
 	*(((char*)(a))+0) = *(((char*)(b))+0);	\
@@ -1000,6 +1000,8 @@ cnt_sml(TRGM *trg1, TRGM *trg2, bool inexact)
 	int			count = 0;
 	int			len1,
 				len2;
+	int			i = 0,
+				j = 0;
 
 	ptr1 = GETARR(trg1);
 	ptr2 = GETARR(trg2);
@@ -1011,18 +1013,20 @@ cnt_sml(TRGM *trg1, TRGM *trg2, bool inexact)
 	if (len1 <= 0 || len2 <= 0)
 		return (float4) 0.0;
 
-	while (ptr1 - GETARR(trg1) < len1 && ptr2 - GETARR(trg2) < len2)
+	/* merge the two sorted arrays, comparing the trigrams as integers */
+	while (i < len1 && j < len2)
 	{
-		int			res = CMPTRGM(ptr1, ptr2);
+		uint32		t1 = TRGMINT(ptr1 + i);
+		uint32		t2 = TRGMINT(ptr2 + j);
 
-		if (res < 0)
-			ptr1++;
-		else if (res > 0)
-			ptr2++;
+		if (t1 < t2)
+			i++;
+		else if (t1 > t2)
+			j++;
 		else
 		{
-			ptr1++;
-			ptr2++;
+			i++;
+			j++;
 			count++;
 		}
 	}
@@ -1118,26 +1122,93 @@ trgm_presence_map(TRGM *query, TRGM *key)
 	return result;
 }
 
-Datum
-similarity(PG_FUNCTION_ARGS)
+/*
+ * Get the trigrams of argument 'argno' of similarity() or its operators.
+ *
+ * An argument that stays the same from call to call, like the query string
+ * in "col % 'query'", has its trigrams kept in fn_extra, because trigram
+ * extraction is relatively CPU-expensive; the column values don't, as
+ * copying each of them into the cache would just be wasted work.  As in
+ * gtrgm_distance(), each cache entry is a single palloc chunk holding the
+ * argument (4-byte length word, uncompressed), then its trigrams at a
+ * MAXALIGN boundary.  *cached is set to tell the caller not to pfree the
+ * result.
+ */
+static TRGM *
+similarity_arg_trgm(FunctionCallInfo fcinfo, int argno, text *in,
+					bool *cached)
+{
+	FmgrInfo   *flinfo = fcinfo->flinfo;
+	char	  **cache;
+	Size		len = VARSIZE_ANY_EXHDR(in);
+
+	if (flinfo == NULL || !get_fn_expr_arg_stable(flinfo, argno))
+	{
+		*cached = false;
+		return generate_trgm(VARDATA_ANY(in), len);
+	}
+
+	if (flinfo->fn_extra == NULL)
+		flinfo->fn_extra = MemoryContextAllocZero(flinfo->fn_mcxt,
+												  2 * sizeof(char *));
+	cache = (char **) flinfo->fn_extra;
+
+	if (cache[argno] == NULL ||
+		VARSIZE(cache[argno]) != len + VARHDRSZ ||
+		memcmp(VARDATA(cache[argno]), VARDATA_ANY(in), len) != 0)
+	{
+		Size		insize = len + VARHDRSZ;
+		TRGM	   *trg;
+		char	   *newcache;
+
+		trg = generate_trgm(VARDATA_ANY(in), len);
+
+		newcache = MemoryContextAlloc(flinfo->fn_mcxt,
+									  MAXALIGN(insize) + VARSIZE(trg));
+		SET_VARSIZE(newcache, insize);
+		memcpy(VARDATA(newcache), VARDATA_ANY(in), len);
+		memcpy(newcache + MAXALIGN(insize), trg, VARSIZE(trg));
+
+		pfree(trg);
+		if (cache[argno])
+			pfree(cache[argno]);
+		cache[argno] = newcache;
+	}
+
+	*cached = true;
+	return (TRGM *) (cache[argno] + MAXALIGN(VARSIZE(cache[argno])));
+}
+
+static float4
+calc_similarity(FunctionCallInfo fcinfo)
 {
 	text	   *in1 = PG_GETARG_TEXT_PP(0);
 	text	   *in2 = PG_GETARG_TEXT_PP(1);
 	TRGM	   *trg1,
 			   *trg2;
+	bool		cached1,
+				cached2;
 	float4		res;
 
-	trg1 = generate_trgm(VARDATA_ANY(in1), VARSIZE_ANY_EXHDR(in1));
-	trg2 = generate_trgm(VARDATA_ANY(in2), VARSIZE_ANY_EXHDR(in2));
+	trg1 = similarity_arg_trgm(fcinfo, 0, in1, &cached1);
+	trg2 = similarity_arg_trgm(fcinfo, 1, in2, &cached2);
 
 	res = cnt_sml(trg1, trg2, false);
 
-	pfree(trg1);
-	pfree(trg2);
+	if (!cached1)
+		pfree(trg1);
+	if (!cached2)
+		pfree(trg2);
 	PG_FREE_IF_COPY(in1, 0);
 	PG_FREE_IF_COPY(in2, 1);
 
-	PG_RETURN_FLOAT4(res);
+	return res;
+}
+
+Datum
+similarity(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_FLOAT4(calc_similarity(fcinfo));
 }
 
 Datum
@@ -1175,9 +1246,7 @@ strict_word_similarity(PG_FUNCTION_ARGS)
 Datum
 similarity_dist(PG_FUNCTION_ARGS)
 {
-	float4		res = DatumGetFloat4(DirectFunctionCall2(similarity,
-														 PG_GETARG_DATUM(0),
-														 PG_GETARG_DATUM(1)));
+	float4		res = calc_similarity(fcinfo);
 
 	PG_RETURN_FLOAT4(1.0 - res);
 }
@@ -1185,9 +1254,7 @@ similarity_dist(PG_FUNCTION_ARGS)
 Datum
 similarity_op(PG_FUNCTION_ARGS)
 {
-	float4		res = DatumGetFloat4(DirectFunctionCall2(similarity,
-														 PG_GETARG_DATUM(0),
-														 PG_GETARG_DATUM(1)));
+	float4		res = calc_similarity(fcinfo);
 
 	PG_RETURN_BOOL(res >= similarity_threshold);
 }
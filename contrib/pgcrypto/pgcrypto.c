@@ -47,6 +47,58 @@ PG_MODULE_MAGIC;
 typedef int (*PFN) (const char *name, void **res);
 static void *find_provider(text *name, PFN pf, const char *desc, int silent);
 
+/*
+ * With the built-in digest implementations, digest() keeps the digest
+ * context it looked up in fn_extra, and only resets it on the next call for
+ * the same algorithm, rather than looking it up and allocating it again for
+ * every value hashed.  OpenSSL digest contexts are tied to the current
+ * resource owner, so they cannot outlive the call.
+ */
+#ifndef USE_OPENSSL
+typedef struct DigestCache
+{
+	char	   *name;			/* algorithm name, as given */
+	int			namelen;
+	PX_MD	   *md;
+} DigestCache;
+
+static PX_MD *
+get_cached_digest(FunctionCallInfo fcinfo, text *name)
+{
+	DigestCache *cache = (DigestCache *) fcinfo->flinfo->fn_extra;
+	int			namelen = VARSIZE_ANY_EXHDR(name);
+	MemoryContext oldcontext;
+
+	if (cache != NULL && cache->namelen == namelen &&
+		memcmp(cache->name, VARDATA_ANY(name), namelen) == 0)
+	{
+		px_md_reset(cache->md);
+		return cache->md;
+	}
+
+	oldcontext = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+	if (cache == NULL)
+		cache = palloc0(sizeof(DigestCache));
+	else
+	{
+		px_md_free(cache->md);
+		pfree(cache->name);
+		cache->md = NULL;
+	}
+	fcinfo->flinfo->fn_extra = NULL;
+
+	/* will give error if fails */
+	cache->md = find_provider(name, (PFN) px_find_digest, "Digest", 0);
+	cache->name = palloc(namelen);
+	memcpy(cache->name, VARDATA_ANY(name), namelen);
+	cache->namelen = namelen;
+	fcinfo->flinfo->fn_extra = cache;
+	MemoryContextSwitchTo(oldcontext);
+
+	return cache->md;
+}
+#endif
+
 /* SQL function: hash(bytea, text) returns bytea */
 PG_FUNCTION_INFO_V1(pg_digest);
 
@@ -62,8 +114,12 @@ pg_digest(PG_FUNCTION_ARGS)
 
 	name = PG_GETARG_TEXT_PP(1);
 
+#ifndef USE_OPENSSL
+	md = get_cached_digest(fcinfo, name);
+#else
 	/* will give error if fails */
 	md = find_provider(name, (PFN) px_find_digest, "Digest", 0);
+#endif
 
 	hlen = px_md_result_size(md);
 
@@ -75,7 +131,9 @@ pg_digest(PG_FUNCTION_ARGS)
 
 	px_md_update(md, (uint8 *) VARDATA_ANY(arg), len);
 	px_md_finish(md, (uint8 *) VARDATA(res));
+#ifdef USE_OPENSSL
 	px_md_free(md);
+#endif
 
 	PG_FREE_IF_COPY(arg, 0);
 	PG_FREE_IF_COPY(name, 1);
@@ -59,6 +59,9 @@ typedef struct ConnCacheEntry
 	bool		invalidated;	/* true if reconnect is pending */
 	uint32		server_hashvalue;	/* hash value of foreign server OID */
 	uint32		mapping_hashvalue;	/* hash value of user mapping OID */
+	List	   *pipeline_queries;	/* SQL of the commands pipelined in batch
+									 * mode whose results are still pending */
+	PgFdwConnState state;		/* extra per-connection state */
 } ConnCacheEntry;
 
 /*
@@ -73,6 +76,9 @@ static unsigned int prep_stmt_number = 0;
 /* tracks whether any work is needed in callback functions */
 static bool xact_got_connection = false;
 
+/* tracks whether we have modified remote data in this transaction */
+static bool xact_modified_remote = false;
+
 /* prototypes of private functions */
 static PGconn *connect_pg_server(ForeignServer *server, UserMapping *user);
 static void disconnect_pg_server(ConnCacheEntry *entry);
@@ -93,6 +99,7 @@ static bool pgfdw_exec_cleanup_query(PGconn *conn, const char *query,
 static bool pgfdw_get_cleanup_result(PGconn *conn, TimestampTz endtime,
 									 PGresult **result);
 static bool UserMappingPasswordRequired(UserMapping *user);
+static ConnCacheEntry *pgfdw_find_entry(PGconn *conn);
 
 /*
  * Get a PGconn which can be used to execute queries on the remote PostgreSQL
@@ -103,9 +110,12 @@ static bool UserMappingPasswordRequired(UserMapping *user);
  * will_prep_stmt must be true if caller intends to create any prepared
  * statements.  Since those don't go away automatically at transaction end
  * (not even on error), we need this flag to cue manual cleanup.
+ *
+ * If state is not NULL, *state receives the per-connection state associated
+ * with the PGconn.
  */
 PGconn *
-GetConnection(UserMapping *user, bool will_prep_stmt)
+GetConnection(UserMapping *user, bool will_prep_stmt, PgFdwConnState **state)
 {
 	bool		found;
 	ConnCacheEntry *entry;
@@ -191,6 +201,8 @@ GetConnection(UserMapping *user, bool will_prep_stmt)
 		entry->have_error = false;
 		entry->changing_xact_state = false;
 		entry->invalidated = false;
+		entry->pipeline_queries = NIL;
+		memset(&entry->state, 0, sizeof(entry->state));
 		entry->server_hashvalue =
 			GetSysCacheHashValue1(FOREIGNSERVEROID,
 								  ObjectIdGetDatum(server->serverid));
@@ -213,6 +225,10 @@ GetConnection(UserMapping *user, bool will_prep_stmt)
 	/* Remember if caller will prepare statements */
 	entry->have_prep_stmt |= will_prep_stmt;
 
+	/* If caller needs access to the per-connection state, return it. */
+	if (state)
+		*state = &entry->state;
+
 	return entry->conn;
 }
 
@@ -455,6 +471,9 @@ do_sql_command(PGconn *conn, const char *sql)
 {
 	PGresult   *res;
 
+	/* Complete any pipelined commands first */
+	pgfdw_pipeline_flush(conn);
+
 	if (!PQsendQuery(conn, sql))
 		pgfdw_report_error(ERROR, NULL, conn, false, sql);
 	res = pgfdw_get_result(conn, sql);
@@ -565,8 +584,15 @@ GetPrepStmtNumber(PGconn *conn)
  * Caller is responsible for the error handling on the result.
  */
 PGresult *
-pgfdw_exec_query(PGconn *conn, const char *query)
+pgfdw_exec_query(PGconn *conn, const char *query, PgFdwConnState *state)
 {
+	/* First, process a pending asynchronous request, if any. */
+	if (state && state->pendingAreq)
+		process_pending_request(state->pendingAreq);
+
+	/* Complete any pipelined commands first */
+	pgfdw_pipeline_flush(conn);
+
 	/*
 	 * Submit a query.  Since we don't use non-blocking mode, this also can
 	 * block.  But its risk is relatively small, so we ignore that for now.
@@ -640,6 +666,154 @@ pgfdw_get_result(PGconn *conn, const char *query)
 	return last_res;
 }
 
+/*
+ * Find the connection cache entry owning the given connection.
+ */
+static ConnCacheEntry *
+pgfdw_find_entry(PGconn *conn)
+{
+	HASH_SEQ_STATUS scan;
+	ConnCacheEntry *entry;
+
+	hash_seq_init(&scan, ConnectionHash);
+	while ((entry = (ConnCacheEntry *) hash_seq_search(&scan)))
+	{
+		if (entry->conn == conn)
+		{
+			hash_seq_term(&scan);
+			return entry;
+		}
+	}
+
+	elog(ERROR, "could not find postgres_fdw connection %p", conn);
+	return NULL;				/* keep compiler quiet */
+}
+
+/*
+ * Put the connection in batch mode, so that commands can be pipelined on it.
+ *
+ * The caller then submits a command, which must not return tuples, and
+ * reports it with pgfdw_pipeline_queued().  Any other use of the connection
+ * must be preceded by pgfdw_pipeline_flush().
+ */
+void
+pgfdw_pipeline_begin(PGconn *conn)
+{
+	if (PQbatchStatus(conn) != PQBATCH_MODE_OFF)
+		return;
+
+	if (!PQenterBatchMode(conn))
+		pgfdw_report_error(ERROR, NULL, conn, false, NULL);
+}
+
+/*
+ * Record that a command has been pipelined on the connection, and flush the
+ * pipeline if that makes max_pending commands awaiting their results.
+ *
+ * query is the text of the command, used for error reporting; it must stay
+ * valid until the pipeline is flushed.
+ */
+void
+pgfdw_pipeline_queued(PGconn *conn, const char *query, int max_pending)
+{
+	ConnCacheEntry *entry = pgfdw_find_entry(conn);
+	MemoryContext oldcontext;
+
+	Assert(PQbatchStatus(conn) != PQBATCH_MODE_OFF);
+
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+	entry->pipeline_queries = lappend(entry->pipeline_queries,
+									  unconstify(char *, query));
+	MemoryContextSwitchTo(oldcontext);
+
+	if (list_length(entry->pipeline_queries) >= max_pending)
+		pgfdw_pipeline_flush(conn);
+}
+
+/*
+ * Complete all the commands pipelined on the connection, if any, and take it
+ * out of batch mode.
+ *
+ * All the results are consumed before reporting the error of the first
+ * command that failed, if any, so that the connection is left usable.
+ *
+ * This function is interruptible by signals.
+ */
+void
+pgfdw_pipeline_flush(PGconn *conn)
+{
+	ConnCacheEntry *entry;
+	PGresult   *volatile failed_res = NULL;
+	const char *volatile failed_query = NULL;
+
+	/* Quick exit if no commands are pipelined */
+	if (PQbatchStatus(conn) == PQBATCH_MODE_OFF)
+		return;
+
+	entry = pgfdw_find_entry(conn);
+
+	/* Send a sync to end the batch */
+	if (!PQbatchSendQueue(conn))
+		pgfdw_report_error(ERROR, NULL, conn, false, NULL);
+
+	/* In what follows, do not leak any PGresults on an error. */
+	PG_TRY();
+	{
+		ListCell   *lc;
+		PGresult   *res;
+
+		foreach(lc, entry->pipeline_queries)
+		{
+			const char *query = (const char *) lfirst(lc);
+
+			if (!PQbatchProcessQueue(conn))
+				pgfdw_report_error(ERROR, NULL, conn, false, query);
+
+			res = pgfdw_get_result(conn, query);
+			if (failed_res == NULL &&
+				PQresultStatus(res) != PGRES_COMMAND_OK)
+			{
+				failed_res = res;
+				failed_query = query;
+			}
+			else
+				PQclear(res);
+		}
+
+		/* Read the result of the sync */
+		if (!PQbatchProcessQueue(conn))
+			pgfdw_report_error(ERROR, NULL, conn, false, NULL);
+		res = pgfdw_get_result(conn, NULL);
+		if (PQresultStatus(res) != PGRES_BATCH_END)
+		{
+			if (failed_res == NULL)
+			{
+				failed_res = res;
+				failed_query = NULL;
+			}
+			else
+				PQclear(res);
+		}
+		else
+			PQclear(res);
+
+		list_free(entry->pipeline_queries);
+		entry->pipeline_queries = NIL;
+
+		if (!PQexitBatchMode(conn))
+			pgfdw_report_error(ERROR, NULL, conn, false, NULL);
+	}
+	PG_CATCH();
+	{
+		PQclear(failed_res);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	if (failed_res != NULL)
+		pgfdw_report_error(ERROR, failed_res, conn, true, failed_query);
+}
+
 /*
  * Report an error we got from the remote server.
  *
@@ -701,6 +875,27 @@ pgfdw_report_error(int elevel, PGresult *res, PGconn *conn,
 	PG_END_TRY();
 }
 
+/*
+ * Remember that the current transaction has modified remote data.
+ *
+ * Parallel workers scan foreign tables through connections of their own, so
+ * they cannot see such changes; see postgresIsForeignScanParallelSafe.
+ */
+void
+pgfdw_mark_xact_modified_remote(void)
+{
+	xact_modified_remote = true;
+}
+
+/*
+ * Has the current transaction modified remote data?
+ */
+bool
+pgfdw_xact_modified_remote(void)
+{
+	return xact_modified_remote;
+}
+
 /*
  * pgfdw_xact_callback --- cleanup at main-transaction end.
  */
@@ -827,9 +1022,17 @@ pgfdw_xact_callback(XactEvent event, void *arg)
 					 * might not have yet completed.  Check to see if a
 					 * command is still being processed by the remote server,
 					 * and if so, request cancellation of the command.
+					 *
+					 * Commands still pipelined in batch mode can't be
+					 * canceled one by one, so give up on the connection.
 					 */
-					if (PQtransactionStatus(entry->conn) == PQTRANS_ACTIVE &&
-						!pgfdw_cancel_query(entry->conn))
+					if (PQbatchStatus(entry->conn) != PQBATCH_MODE_OFF)
+					{
+						/* Unable to clean up pipelined commands. */
+						abort_cleanup_failure = true;
+					}
+					else if (PQtransactionStatus(entry->conn) == PQTRANS_ACTIVE &&
+							 !pgfdw_cancel_query(entry->conn))
 					{
 						/* Unable to cancel running query. */
 						abort_cleanup_failure = true;
@@ -863,6 +1066,8 @@ pgfdw_xact_callback(XactEvent event, void *arg)
 
 		/* Reset state to show we're out of a transaction */
 		entry->xact_depth = 0;
+		entry->pipeline_queries = NIL;
+		entry->state.pendingAreq = NULL;
 
 		/*
 		 * If the connection isn't in a good idle state, discard it to
@@ -883,6 +1088,7 @@ pgfdw_xact_callback(XactEvent event, void *arg)
 	 * this saves a useless scan of the hashtable during COMMIT or PREPARE.)
 	 */
 	xact_got_connection = false;
+	xact_modified_remote = false;
 
 	/* Also reset cursor numbering for next transaction */
 	cursor_number = 0;
@@ -966,10 +1172,13 @@ pgfdw_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
 			 * an asynchronous execution function, the command might not have
 			 * yet completed.  Check to see if a command is still being
 			 * processed by the remote server, and if so, request cancellation
-			 * of the command.
+			 * of the command.  Commands still pipelined in batch mode can't
+			 * be canceled one by one, so give up on the connection.
 			 */
-			if (PQtransactionStatus(entry->conn) == PQTRANS_ACTIVE &&
-				!pgfdw_cancel_query(entry->conn))
+			if (PQbatchStatus(entry->conn) != PQBATCH_MODE_OFF)
+				abort_cleanup_failure = true;
+			else if (PQtransactionStatus(entry->conn) == PQTRANS_ACTIVE &&
+					 !pgfdw_cancel_query(entry->conn))
 				abort_cleanup_failure = true;
 			else
 			{
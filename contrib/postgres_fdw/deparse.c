@@ -52,6 +52,7 @@
 #include "parser/parsetree.h"
 #include "postgres_fdw.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 #include "utils/syscache.h"
@@ -178,6 +179,9 @@ static void deparseRangeTblRef(StringInfo buf, PlannerInfo *root,
 							   RelOptInfo *foreignrel, bool make_subquery,
 							   Index ignore_rel, List **ignore_conds, List **params_list);
 static void deparseAggref(Aggref *node, deparse_expr_cxt *context);
+static void deparseAggrefCall(Aggref *node, const char *funcname,
+							  deparse_expr_cxt *context);
+static bool partial_agg_ok(Aggref *agg, bool *int_avg);
 static void appendGroupByClause(List *tlist, deparse_expr_cxt *context);
 static void appendAggOrderBy(List *orderList, List *targetList,
 							 deparse_expr_cxt *context);
@@ -699,8 +703,12 @@ foreign_expr_walker(Node *node,
 				if (!IS_UPPER_REL(glob_cxt->foreignrel))
 					return false;
 
-				/* Only non-split aggregates are pushable. */
-				if (agg->aggsplit != AGGSPLIT_SIMPLE)
+				/*
+				 * Only non-split aggregates are pushable, and partial ones if
+				 * the remote server can compute their transition state.
+				 */
+				if (agg->aggsplit != AGGSPLIT_SIMPLE &&
+					!partial_agg_ok(agg, NULL))
 					return false;
 
 				/* As usual, it must be shippable. */
@@ -1700,13 +1708,16 @@ deparseRangeTblRef(StringInfo buf, PlannerInfo *root, RelOptInfo *foreignrel,
  * The statement text is appended to buf, and we also create an integer List
  * of the columns being retrieved by WITH CHECK OPTION or RETURNING (if any),
  * which is returned to *retrieved_attrs.
+ *
+ * This also stores end position of the VALUES clause, so that we can rebuild
+ * an INSERT for a batch of rows later.
  */
 void
 deparseInsertSql(StringInfo buf, RangeTblEntry *rte,
 				 Index rtindex, Relation rel,
 				 List *targetAttrs, bool doNothing,
 				 List *withCheckOptionList, List *returningList,
-				 List **retrieved_attrs)
+				 List **retrieved_attrs, int *values_end_len)
 {
 	AttrNumber	pindex;
 	bool		first;
@@ -1749,6 +1760,7 @@ deparseInsertSql(StringInfo buf, RangeTblEntry *rte,
 	}
 	else
 		appendStringInfoString(buf, " DEFAULT VALUES");
+	*values_end_len = buf->len;
 
 	if (doNothing)
 		appendStringInfoString(buf, " ON CONFLICT DO NOTHING");
@@ -1758,6 +1770,57 @@ deparseInsertSql(StringInfo buf, RangeTblEntry *rte,
 						 withCheckOptionList, returningList, retrieved_attrs);
 }
 
+/*
+ * rebuild remote INSERT statement
+ *
+ * Provided a number of rows in a batch, builds INSERT statement with the
+ * right number of parameters: the VALUES clause of orig_query, which ends
+ * at values_end_len and holds num_cols parameters, is repeated num_rows
+ * times, followed by the rest of orig_query.
+ */
+void
+rebuildInsertSql(StringInfo buf, char *orig_query,
+				 int values_end_len, int num_cols,
+				 int num_rows)
+{
+	int			i,
+				j;
+	int			pindex;
+	bool		first;
+
+	/* Make sure the values_end_len is sensible */
+	Assert((values_end_len > 0) && (values_end_len <= strlen(orig_query)));
+
+	/* Copy up to the end of the first record from the original query */
+	appendBinaryStringInfo(buf, orig_query, values_end_len);
+
+	/*
+	 * Add records to VALUES clause (we already have parameters for the first
+	 * row, so start at the right offset).
+	 */
+	pindex = num_cols + 1;
+	for (i = 1; i < num_rows; i++)
+	{
+		appendStringInfoString(buf, ", (");
+
+		first = true;
+		for (j = 0; j < num_cols; j++)
+		{
+			if (!first)
+				appendStringInfoString(buf, ", ");
+			first = false;
+
+			appendStringInfo(buf, "$%d", pindex);
+			pindex++;
+		}
+
+		appendStringInfoChar(buf, ')');
+	}
+
+	/* Copy stuff after VALUES clause from the original query */
+	appendStringInfoString(buf, orig_query + values_end_len);
+}
+
 /*
  * deparse remote UPDATE statement
  *
@@ -2948,6 +3011,53 @@ deparseArrayExpr(ArrayExpr *node, deparse_expr_cxt *context)
 						 deparse_type_name(node->array_typeid, -1));
 }
 
+/*
+ * Check whether the remote server can compute the transition state of a
+ * partial aggregate, that is one computed for partitionwise aggregation, to
+ * be combined with other partial results and finalized locally.
+ *
+ * We can only fetch aggregate results from the remote server, so this works
+ * if the result of the aggregate over some rows is its transition state:
+ * there is no final function, and the transition type is the result type.
+ * This covers count(), min(), max() and sum() of integers and floats, among
+ * others.  As a special case, the transition state of avg() of int2 or int4
+ * is an int8 array of the count and the sum of the inputs, which we compute
+ * from count() and sum(); *int_avg is set if that's the case.
+ */
+static bool
+partial_agg_ok(Aggref *agg, bool *int_avg)
+{
+	HeapTuple	aggtup;
+	Form_pg_aggregate aggform;
+	bool		result;
+	bool		is_int_avg;
+
+	if (agg->aggsplit != AGGSPLIT_INITIAL_SERIAL)
+		return false;
+
+	aggtup = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(agg->aggfnoid));
+	if (!HeapTupleIsValid(aggtup))
+		elog(ERROR, "cache lookup failed for aggregate %u", agg->aggfnoid);
+	aggform = (Form_pg_aggregate) GETSTRUCT(aggtup);
+
+	is_int_avg = ((aggform->aggtransfn == F_INT2_AVG_ACCUM ||
+				   aggform->aggtransfn == F_INT4_AVG_ACCUM) &&
+				  aggform->aggfinalfn == F_INT8_AVG &&
+				  aggform->aggcombinefn == F_INT4_AVG_COMBINE);
+
+	result = (OidIsValid(aggform->aggcombinefn) &&
+			  (is_int_avg ||
+			   (!OidIsValid(aggform->aggfinalfn) &&
+				aggform->aggtranstype != INTERNALOID &&
+				aggform->aggtranstype == get_func_rettype(agg->aggfnoid))));
+
+	ReleaseSysCache(aggtup);
+
+	if (int_avg)
+		*int_avg = is_int_avg;
+	return result;
+}
+
 /*
  * Deparse an Aggref node.
  */
@@ -2955,16 +3065,48 @@ static void
 deparseAggref(Aggref *node, deparse_expr_cxt *context)
 {
 	StringInfo	buf = context->buf;
-	bool		use_variadic;
+	bool		int_avg;
 
-	/* Only basic, non-split aggregation accepted. */
-	Assert(node->aggsplit == AGGSPLIT_SIMPLE);
+	/* Only basic aggregation accepted, or partial one per partial_agg_ok() */
+	if (node->aggsplit == AGGSPLIT_SIMPLE ||
+		!partial_agg_ok(node, &int_avg))
+	{
+		Assert(node->aggsplit == AGGSPLIT_SIMPLE);
+		int_avg = false;
+	}
+
+	if (int_avg)
+	{
+		/* Build the transition state of avg(int2) or avg(int4) */
+		appendStringInfoString(buf, "ARRAY[");
+		deparseAggrefCall(node, "count", context);
+		appendStringInfoString(buf, ", COALESCE(");
+		deparseAggrefCall(node, "sum", context);
+		appendStringInfoString(buf, ", 0)]");
+	}
+	else
+		deparseAggrefCall(node, NULL, context);
+}
+
+/*
+ * Deparse a call of the aggregate of an Aggref node, or of the given
+ * built-in aggregate with the same arguments.
+ */
+static void
+deparseAggrefCall(Aggref *node, const char *funcname,
+				  deparse_expr_cxt *context)
+{
+	StringInfo	buf = context->buf;
+	bool		use_variadic;
 
 	/* Check if need to print VARIADIC (cf. ruleutils.c) */
 	use_variadic = node->aggvariadic;
 
 	/* Find aggregate name from aggfnoid which is a pg_proc entry */
-	appendFunctionName(node->aggfnoid, context);
+	if (funcname)
+		appendStringInfoString(buf, funcname);
+	else
+		appendFunctionName(node->aggfnoid, context);
 	appendStringInfoChar(buf, '(');
 
 	/* Add DISTINCT */
@@ -2523,8 +2523,10 @@ SELECT a, count(t1) FROM pagg_tab t1 GROUP BY a HAVING avg(b) < 22 ORDER BY 1;
 SELECT a, count(t1) FROM pagg_tab t1 GROUP BY a HAVING avg(b) < 22 ORDER BY 1;
 
 -- When GROUP BY clause does not match with PARTITION KEY.
+-- The partial aggregates are computed remotely
 EXPLAIN (COSTS OFF)
 SELECT b, avg(a), max(a), count(*) FROM pagg_tab GROUP BY b HAVING sum(a) < 700 ORDER BY 1;
+SELECT b, avg(a), max(a), count(*) FROM pagg_tab GROUP BY b HAVING sum(a) < 700 ORDER BY 1;
 
 -- ===================================================================
 -- access rights and superuser
@@ -2634,3 +2636,109 @@ SELECT count(*) FROM ft1;
 -- error here
 PREPARE TRANSACTION 'fdw_tpc';
 ROLLBACK;
+
+-- ===================================================================
+-- test pipelined inserts
+-- ===================================================================
+CREATE TABLE pipe_local (a int CHECK (a < 30), b text);
+CREATE FOREIGN TABLE pipe_ft (a int, b text)
+  SERVER loopback OPTIONS (table_name 'pipe_local', pipeline_depth '3');
+INSERT INTO pipe_ft SELECT i, 'row' || i FROM generate_series(1, 10) i;
+SELECT count(*), sum(a) FROM pipe_local;
+-- a scan on the same connection completes the pipelined inserts first
+INSERT INTO pipe_ft SELECT a + 10, b FROM pipe_ft;
+SELECT count(*), sum(a) FROM pipe_local;
+-- errors are reported when the pipeline is flushed
+INSERT INTO pipe_ft SELECT i, 'row' || i FROM generate_series(25, 35) i;
+SELECT count(*) FROM pipe_local;
+ALTER FOREIGN TABLE pipe_ft OPTIONS (SET pipeline_depth '0');
+DROP FOREIGN TABLE pipe_ft;
+DROP TABLE pipe_local;
+
+-- ===================================================================
+-- test batch insert
+-- ===================================================================
+CREATE TABLE batch_local (x int CHECK (x < 100));
+CREATE FOREIGN TABLE batch_ft (x int)
+  SERVER loopback OPTIONS (table_name 'batch_local', batch_size '10');
+EXPLAIN (VERBOSE, COSTS OFF) INSERT INTO batch_ft SELECT * FROM generate_series(1, 25) i;
+INSERT INTO batch_ft SELECT * FROM generate_series(1, 25) i;
+SELECT count(*), sum(x) FROM batch_local;
+-- batching is not used with RETURNING
+EXPLAIN (VERBOSE, COSTS OFF) INSERT INTO batch_ft VALUES (26), (27) RETURNING *;
+INSERT INTO batch_ft VALUES (26), (27) RETURNING *;
+-- errors raised by a batch are reported
+INSERT INTO batch_ft SELECT * FROM generate_series(95, 105) i;
+SELECT count(*) FROM batch_local;
+-- tuple routing to a foreign partition
+CREATE TABLE batch_table (x int) PARTITION BY HASH (x);
+CREATE TABLE batch_table_p0 (LIKE batch_table);
+CREATE FOREIGN TABLE batch_table_p0f
+  PARTITION OF batch_table
+  FOR VALUES WITH (MODULUS 2, REMAINDER 0)
+  SERVER loopback
+  OPTIONS (table_name 'batch_table_p0', batch_size '10');
+CREATE TABLE batch_table_p1
+  PARTITION OF batch_table
+  FOR VALUES WITH (MODULUS 2, REMAINDER 1);
+INSERT INTO batch_table SELECT * FROM generate_series(1, 66) i;
+SELECT count(*) FROM batch_table;
+ALTER FOREIGN TABLE batch_ft OPTIONS (SET batch_size '0');
+DROP TABLE batch_table;
+DROP TABLE batch_table_p0;
+DROP FOREIGN TABLE batch_ft;
+DROP TABLE batch_local;
+
+-- ===================================================================
+-- test asynchronous execution
+-- ===================================================================
+ALTER SERVER loopback OPTIONS (ADD async_capable 'true');
+ALTER SERVER loopback2 OPTIONS (ADD async_capable 'true');
+CREATE TABLE async_pt (a int, b int, c text) PARTITION BY RANGE (a);
+CREATE TABLE base_tbl1 (a int, b int, c text);
+CREATE TABLE base_tbl2 (a int, b int, c text);
+CREATE FOREIGN TABLE async_p1 PARTITION OF async_pt FOR VALUES FROM (1000) TO (2000)
+  SERVER loopback OPTIONS (table_name 'base_tbl1');
+CREATE FOREIGN TABLE async_p2 PARTITION OF async_pt FOR VALUES FROM (2000) TO (3000)
+  SERVER loopback2 OPTIONS (table_name 'base_tbl2');
+CREATE TABLE async_p3 PARTITION OF async_pt FOR VALUES FROM (3000) TO (4000);
+INSERT INTO async_pt SELECT 1000 + i, i, to_char(i, 'FM0000') FROM generate_series(0, 999, 5) i;
+INSERT INTO async_pt SELECT 2000 + i, i, to_char(i, 'FM0000') FROM generate_series(0, 999, 5) i;
+INSERT INTO async_pt SELECT 3000 + i, i, to_char(i, 'FM0000') FROM generate_series(0, 999, 5) i;
+ANALYZE async_pt;
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT count(*), sum(a) FROM async_pt WHERE b % 100 = 0;
+SELECT count(*), sum(a) FROM async_pt WHERE b % 100 = 0;
+-- async execution is not used when disabled
+SET enable_async_append TO false;
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT count(*), sum(a) FROM async_pt WHERE b % 100 = 0;
+RESET enable_async_append;
+DROP TABLE async_pt;
+DROP TABLE base_tbl1;
+DROP TABLE base_tbl2;
+ALTER SERVER loopback OPTIONS (DROP async_capable);
+ALTER SERVER loopback2 OPTIONS (DROP async_capable);
+
+-- ===================================================================
+-- test parallel-safe foreign scans
+-- ===================================================================
+CREATE TABLE par_local (a int, b text);
+CREATE FOREIGN TABLE par_ft (a int, b text)
+  SERVER loopback OPTIONS (table_name 'par_local');
+INSERT INTO par_local SELECT i, to_char(i, 'FM0000') FROM generate_series(1, 100) i;
+SET force_parallel_mode = on;
+-- foreign scans are not parallel safe by default
+EXPLAIN (COSTS OFF) SELECT * FROM par_ft;
+ALTER FOREIGN TABLE par_ft OPTIONS (ADD parallel_safe 'true');
+EXPLAIN (COSTS OFF) SELECT * FROM par_ft;
+SELECT count(*), sum(a) FROM par_ft;
+-- not once the transaction has modified remote data
+BEGIN;
+INSERT INTO par_ft VALUES (101, '0101');
+EXPLAIN (COSTS OFF) SELECT * FROM par_ft;
+SELECT count(*), sum(a) FROM par_ft;
+ROLLBACK;
+RESET force_parallel_mode;
+DROP FOREIGN TABLE par_ft;
+DROP TABLE par_local;
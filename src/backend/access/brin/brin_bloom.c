@@ -0,0 +1,472 @@
+/*
+ * brin_bloom.c
+ *		Implementation of Bloom opclass for BRIN
+ *
+ * The bloom opclass summarizes each page range by a bloom filter built from
+ * the hashes of all the values in the range.  Unlike minmax, the summary
+ * does not depend on the values being correlated with their physical
+ * position, which makes it useful for equality searches on columns such as
+ * UUIDs, where a range typically contains values from all over the domain.
+ * The price is that only equality searches are supported, and that the
+ * filter can produce false positives (but never false negatives).
+ *
+ * The filter is sized from the number of distinct values expected in a page
+ * range and the desired false positive rate, both of which may be set as
+ * opclass parameters.  All filters of an index column have the same size, so
+ * merging two summaries is simply a matter of OR-ing their bits.
+ *
+ * The opclass needs a hash function for the data type (support procedure
+ * BLOOM_PROCNUM_HASH), which is normally the type's hash opclass function.
+ * Each bit position is derived from that hash value by double hashing,
+ * i.e. position i is (h1 + i * h2) mod nbits for two independent hashes h1
+ * and h2 of the value's hash.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/brin/brin_bloom.c
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/brin.h"
+#include "access/brin_internal.h"
+#include "access/brin_page.h"
+#include "access/brin_tuple.h"
+#include "access/genam.h"
+#include "access/htup_details.h"
+#include "access/reloptions.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_type.h"
+#include "common/hashfn.h"
+#include "utils/builtins.h"
+#include "utils/rel.h"
+
+/* the only strategy supported by bloom opclasses */
+#define BloomEqualStrategyNumber	1
+
+/* support procedure returning the hash of a value */
+#define BLOOM_PROCNUM_HASH			11
+
+/*
+ * Seeds of the two hashes the bit positions are derived from.  Any two
+ * distinct values would do, but they must never change, as that would make
+ * existing indexes return wrong results.
+ */
+#define BLOOM_SEED_1	0x71d924af
+#define BLOOM_SEED_2	0xba48b314
+
+/*
+ * Default and allowed values of the opclass parameters.  A negative
+ * n_distinct_per_range is a fraction of the maximum number of tuples in a
+ * page range, like pg_statistic's stadistinct.
+ */
+#define BLOOM_DEFAULT_NDISTINCT_PER_RANGE	-0.1
+#define BLOOM_MIN_NDISTINCT_PER_RANGE		16
+#define BLOOM_DEFAULT_FALSE_POSITIVE_RATE	0.01
+#define BLOOM_MIN_FALSE_POSITIVE_RATE		0.0001
+#define BLOOM_MAX_FALSE_POSITIVE_RATE		0.25
+
+/*
+ * A filter must fit into an index tuple on an otherwise empty page.  Other
+ * columns of the index may need space too, so this is only a hard limit.
+ */
+#define BloomMaxFilterSize \
+	MAXALIGN_DOWN(BLCKSZ - \
+				  (MAXALIGN(SizeOfPageHeaderData + \
+							sizeof(ItemIdData)) + \
+				   MAXALIGN(sizeof(BrinSpecialSpace)) + \
+				   SizeOfBrinTuple))
+
+/* bloom opclass options */
+typedef struct BloomOptions
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	double		nDistinctPerRange;	/* number of distinct values per range */
+	double		falsePositiveRate;	/* false positive rate for the filter */
+} BloomOptions;
+
+#define BloomGetNDistinctPerRange(opts) \
+	((opts) ? (((BloomOptions *) (opts))->nDistinctPerRange) : \
+	 BLOOM_DEFAULT_NDISTINCT_PER_RANGE)
+
+#define BloomGetFalsePositiveRate(opts) \
+	((opts) ? (((BloomOptions *) (opts))->falsePositiveRate) : \
+	 BLOOM_DEFAULT_FALSE_POSITIVE_RATE)
+
+/*
+ * The bloom filter, as stored in the index tuple (as a bytea).
+ */
+typedef struct BloomFilter
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	uint16		nhashes;		/* number of hash functions */
+	uint32		nbits;			/* number of bits in the bitmap */
+	char		data[FLEXIBLE_ARRAY_MEMBER];	/* the bitmap */
+} BloomFilter;
+
+static BloomFilter *bloom_init(int ndistinct, double false_positive_rate);
+static bool bloom_add_value(BloomFilter *filter, uint32 value);
+static bool bloom_contains_value(BloomFilter *filter, uint32 value);
+static BloomFilter *bloom_get_filter(BrinValues *column);
+static int	brin_bloom_get_ndistinct(BrinDesc *bdesc, double ndistinct);
+
+
+Datum
+brin_bloom_opcinfo(PG_FUNCTION_ARGS)
+{
+	BrinOpcInfo *result;
+
+	/*
+	 * We store the bloom filter as a single bytea value, whatever the type
+	 * of the indexed column.
+	 */
+	result = palloc0(SizeofBrinOpcInfo(1));
+	result->oi_nstored = 1;
+	result->oi_opaque = NULL;
+	result->oi_typcache[0] = lookup_type_cache(BYTEAOID, 0);
+
+	PG_RETURN_POINTER(result);
+}
+
+/*
+ * Examine the given index tuple (which contains partial status of a certain
+ * page range) by comparing it to the given value that comes from another heap
+ * tuple.  If the new value is not yet represented in the bloom filter, add it
+ * and return true.  Otherwise, return false and do not modify in this case.
+ */
+Datum
+brin_bloom_add_value(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	Datum		newval = PG_GETARG_DATUM(2);
+	bool		isnull = PG_GETARG_DATUM(3);
+	Oid			colloid = PG_GET_COLLATION();
+	void	   *opts = PG_HAS_OPCLASS_OPTIONS() ? PG_GET_OPCLASS_OPTIONS() : NULL;
+	FmgrInfo   *hashFn;
+	uint32		hashValue;
+	BloomFilter *filter;
+	bool		updated = false;
+
+	/*
+	 * If the new value is null, we record that we saw it if it's the first
+	 * one; otherwise, there's nothing to do.
+	 */
+	if (isnull)
+	{
+		if (column->bv_hasnulls)
+			PG_RETURN_BOOL(false);
+
+		column->bv_hasnulls = true;
+		PG_RETURN_BOOL(true);
+	}
+
+	/*
+	 * If this is the first non-null value, we need to initialize the bloom
+	 * filter.  Otherwise just fetch the existing one.
+	 */
+	if (column->bv_allnulls)
+	{
+		filter = bloom_init(brin_bloom_get_ndistinct(bdesc,
+													 BloomGetNDistinctPerRange(opts)),
+							BloomGetFalsePositiveRate(opts));
+		column->bv_values[0] = PointerGetDatum(filter);
+		column->bv_allnulls = false;
+		updated = true;
+	}
+	else
+		filter = bloom_get_filter(column);
+
+	hashFn = index_getprocinfo(bdesc->bd_index, column->bv_attno,
+							   BLOOM_PROCNUM_HASH);
+	hashValue = DatumGetUInt32(FunctionCall1Coll(hashFn, colloid, newval));
+
+	updated |= bloom_add_value(filter, hashValue);
+
+	PG_RETURN_BOOL(updated);
+}
+
+/*
+ * Given an index tuple corresponding to a certain page range and a scan key,
+ * return whether the scan key may match a value of the range, according to
+ * its bloom filter.  Return true if so, false otherwise.
+ */
+Datum
+brin_bloom_consistent(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	ScanKey		key = (ScanKey) PG_GETARG_POINTER(2);
+	Oid			colloid = PG_GET_COLLATION();
+	FmgrInfo   *hashFn;
+	uint32		hashValue;
+	BloomFilter *filter;
+
+	Assert(key->sk_attno == column->bv_attno);
+
+	/* handle IS NULL/IS NOT NULL tests */
+	if (key->sk_flags & SK_ISNULL)
+	{
+		if (key->sk_flags & SK_SEARCHNULL)
+		{
+			if (column->bv_allnulls || column->bv_hasnulls)
+				PG_RETURN_BOOL(true);
+			PG_RETURN_BOOL(false);
+		}
+
+		/*
+		 * For IS NOT NULL, we can only skip ranges that are known to have
+		 * only nulls.
+		 */
+		if (key->sk_flags & SK_SEARCHNOTNULL)
+			PG_RETURN_BOOL(!column->bv_allnulls);
+
+		/*
+		 * Neither IS NULL nor IS NOT NULL was used; assume all indexable
+		 * operators are strict and return false.
+		 */
+		PG_RETURN_BOOL(false);
+	}
+
+	/* if the range is all empty, it cannot possibly be consistent */
+	if (column->bv_allnulls)
+		PG_RETURN_BOOL(false);
+
+	if (key->sk_strategy != BloomEqualStrategyNumber)
+		elog(ERROR, "invalid strategy number %d", key->sk_strategy);
+
+	filter = (BloomFilter *) PG_DETOAST_DATUM(column->bv_values[0]);
+
+	hashFn = index_getprocinfo(bdesc->bd_index, key->sk_attno,
+							   BLOOM_PROCNUM_HASH);
+	hashValue = DatumGetUInt32(FunctionCall1Coll(hashFn, colloid,
+												 key->sk_argument));
+
+	PG_RETURN_BOOL(bloom_contains_value(filter, hashValue));
+}
+
+/*
+ * Given two BrinValues, update the first of them as a union of the summary
+ * values contained in both.  The second one is untouched.
+ */
+Datum
+brin_bloom_union(PG_FUNCTION_ARGS)
+{
+	BrinValues *col_a = (BrinValues *) PG_GETARG_POINTER(1);
+	BrinValues *col_b = (BrinValues *) PG_GETARG_POINTER(2);
+	BloomFilter *filter_a;
+	BloomFilter *filter_b;
+	uint32		nbytes;
+	uint32		i;
+
+	Assert(col_a->bv_attno == col_b->bv_attno);
+
+	/* Adjust "hasnulls" */
+	if (!col_a->bv_hasnulls && col_b->bv_hasnulls)
+		col_a->bv_hasnulls = true;
+
+	/* If there are no values in B, there's nothing left to do */
+	if (col_b->bv_allnulls)
+		PG_RETURN_VOID();
+
+	filter_b = (BloomFilter *) PG_DETOAST_DATUM(col_b->bv_values[0]);
+
+	/*
+	 * Adjust "allnulls".  If A doesn't have values, just copy the filter
+	 * from B into A, and we're done.
+	 */
+	if (col_a->bv_allnulls)
+	{
+		filter_a = (BloomFilter *) palloc(VARSIZE(filter_b));
+		memcpy(filter_a, filter_b, VARSIZE(filter_b));
+		col_a->bv_allnulls = false;
+		col_a->bv_values[0] = PointerGetDatum(filter_a);
+		PG_RETURN_VOID();
+	}
+
+	filter_a = bloom_get_filter(col_a);
+
+	/* all filters of an index column are built with the same parameters */
+	if (filter_a->nbits != filter_b->nbits ||
+		filter_a->nhashes != filter_b->nhashes)
+		elog(ERROR, "cannot merge bloom filters of different sizes");
+
+	nbytes = filter_a->nbits / BITS_PER_BYTE;
+	for (i = 0; i < nbytes; i++)
+		filter_a->data[i] |= filter_b->data[i];
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Define the opclass parameters.
+ */
+Datum
+brin_bloom_options(PG_FUNCTION_ARGS)
+{
+	local_relopts *relopts = (local_relopts *) PG_GETARG_POINTER(0);
+
+	init_local_reloptions(relopts, sizeof(BloomOptions));
+
+	add_local_real_reloption(relopts, "n_distinct_per_range",
+							 "number of distinct items expected in a BRIN page range",
+							 BLOOM_DEFAULT_NDISTINCT_PER_RANGE,
+							 -1.0, INT_MAX,
+							 offsetof(BloomOptions, nDistinctPerRange));
+
+	add_local_real_reloption(relopts, "false_positive_rate",
+							 "desired false-positive rate for the bloom filters",
+							 BLOOM_DEFAULT_FALSE_POSITIVE_RATE,
+							 BLOOM_MIN_FALSE_POSITIVE_RATE,
+							 BLOOM_MAX_FALSE_POSITIVE_RATE,
+							 offsetof(BloomOptions, falsePositiveRate));
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Compute the number of distinct values the filter of a page range has to
+ * be sized for, from the n_distinct_per_range parameter.
+ */
+static int
+brin_bloom_get_ndistinct(BrinDesc *bdesc, double ndistinct)
+{
+	double		maxtuples;
+
+	maxtuples = (double) MaxHeapTuplesPerPage *
+		BrinGetPagesPerRange(bdesc->bd_index);
+
+	/* a negative value is a fraction of the tuples that fit in the range */
+	if (ndistinct < 0)
+		ndistinct = -ndistinct * maxtuples;
+
+	/*
+	 * There's no point in sizing the filter for more values than can be in
+	 * the range, while sizing it for very few makes it saturate as soon as
+	 * the guess is a bit off.
+	 */
+	ndistinct = Min(ndistinct, maxtuples);
+	ndistinct = Max(ndistinct, BLOOM_MIN_NDISTINCT_PER_RANGE);
+
+	return (int) ndistinct;
+}
+
+/*
+ * Create an empty bloom filter able to hold ndistinct values with the given
+ * false positive rate.
+ *
+ * The optimal number of bits is -(n * ln(p)) / (ln(2)^2), and the optimal
+ * number of hash functions is (nbits / n) * ln(2).  We round the number of
+ * bits up to whole bytes.
+ */
+static BloomFilter *
+bloom_init(int ndistinct, double false_positive_rate)
+{
+	BloomFilter *filter;
+	double		nbits;
+	int			nhashes;
+	Size		nbytes;
+	Size		len;
+
+	Assert(ndistinct > 0);
+	Assert(false_positive_rate > 0 && false_positive_rate < 1);
+
+	nbits = ceil(-(ndistinct * log(false_positive_rate)) / pow(log(2.0), 2));
+	nbytes = (Size) ceil(nbits / BITS_PER_BYTE);
+	nbits = nbytes * BITS_PER_BYTE;
+
+	nhashes = (int) rint(nbits / ndistinct * log(2.0));
+	nhashes = Max(nhashes, 1);
+
+	len = offsetof(BloomFilter, data) + nbytes;
+	if (len > BloomMaxFilterSize)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("bloom filter of %zu bytes is too large, maximum size is %zu",
+						len, (Size) BloomMaxFilterSize),
+				 errhint("Decrease n_distinct_per_range or pages_per_range, or increase false_positive_rate.")));
+
+	filter = (BloomFilter *) palloc0(len);
+	SET_VARSIZE(filter, len);
+	filter->nhashes = nhashes;
+	filter->nbits = (uint32) nbits;
+
+	return filter;
+}
+
+/*
+ * Set the bits of the filter for the given hash value.  Returns true if any
+ * bit was not set before, i.e. if the filter was modified.
+ */
+static bool
+bloom_add_value(BloomFilter *filter, uint32 value)
+{
+	uint64		h1,
+				h2;
+	bool		updated = false;
+	int			i;
+
+	h1 = hash_bytes_uint32_extended(value, BLOOM_SEED_1) % filter->nbits;
+	h2 = hash_bytes_uint32_extended(value, BLOOM_SEED_2) % filter->nbits;
+
+	for (i = 0; i < filter->nhashes; i++)
+	{
+		uint32		h = (h1 + i * h2) % filter->nbits;
+		uint32		byte = h / BITS_PER_BYTE;
+		uint32		bit = h % BITS_PER_BYTE;
+
+		if (!(filter->data[byte] & (0x01 << bit)))
+		{
+			filter->data[byte] |= (0x01 << bit);
+			updated = true;
+		}
+	}
+
+	return updated;
+}
+
+/*
+ * Check whether all the bits of the given hash value are set in the filter.
+ */
+static bool
+bloom_contains_value(BloomFilter *filter, uint32 value)
+{
+	uint64		h1,
+				h2;
+	int			i;
+
+	h1 = hash_bytes_uint32_extended(value, BLOOM_SEED_1) % filter->nbits;
+	h2 = hash_bytes_uint32_extended(value, BLOOM_SEED_2) % filter->nbits;
+
+	for (i = 0; i < filter->nhashes; i++)
+	{
+		uint32		h = (h1 + i * h2) % filter->nbits;
+		uint32		byte = h / BITS_PER_BYTE;
+		uint32		bit = h % BITS_PER_BYTE;
+
+		if (!(filter->data[byte] & (0x01 << bit)))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Return the filter of a column, in a form that can be modified in place.
+ *
+ * The value we get from brin_deform_tuple is a private copy, but it may have
+ * a short varlena header; if so, replace it by a regular copy.
+ */
+static BloomFilter *
+bloom_get_filter(BrinValues *column)
+{
+	BloomFilter *filter;
+
+	filter = (BloomFilter *) PG_DETOAST_DATUM(column->bv_values[0]);
+	column->bv_values[0] = PointerGetDatum(filter);
+
+	return filter;
+}
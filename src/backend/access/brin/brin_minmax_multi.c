@@ -0,0 +1,966 @@
+/*
+ * brin_minmax_multi.c
+ *		Implementation of Multi Min/Max opclass for BRIN
+ *
+ * The minmax opclass summarizes each page range by a single [min, max]
+ * interval.  That works well as long as the values are well correlated with
+ * their physical position, but a handful of outliers (or rows updated long
+ * after the table was loaded) widen the interval until it matches nearly any
+ * query.  This opclass instead keeps a short sorted list of disjoint
+ * intervals per page range; a value falling between two of the intervals
+ * lets the range be skipped.
+ *
+ * When a value not covered by any interval is added, it becomes a new
+ * single-point interval.  Once there are more intervals than allowed by the
+ * values_per_range opclass parameter, the two adjacent intervals closest to
+ * each other are merged.  Telling how close two values are requires a
+ * "distance" support procedure for the data type (MINMAX_MULTI_PROCNUM_DISTANCE),
+ * returning the distance between two values as a float8.  The distance need
+ * not be exact; it's only used to decide which intervals to merge.
+ *
+ * The intervals are stored in the index tuple as a single bytea value.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/brin/brin_minmax_multi.c
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/brin_internal.h"
+#include "access/brin_tuple.h"
+#include "access/genam.h"
+#include "access/reloptions.h"
+#include "access/stratnum.h"
+#include "access/tupmacs.h"
+#include "catalog/pg_amop.h"
+#include "catalog/pg_type.h"
+#include "utils/builtins.h"
+#include "utils/date.h"
+#include "utils/datum.h"
+#include "utils/float.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/pg_lsn.h"
+#include "utils/rel.h"
+#include "utils/syscache.h"
+#include "utils/timestamp.h"
+#include "utils/uuid.h"
+
+/* support procedure returning the distance between two values */
+#define MINMAX_MULTI_PROCNUM_DISTANCE		11
+
+/*
+ * Each interval is stored as its two boundary values (which are the same
+ * for a single-point interval), so a summary holds up to values_per_range / 2
+ * intervals.
+ */
+#define MINMAX_MULTI_DEFAULT_VALUES_PER_RANGE	32
+#define MINMAX_MULTI_MIN_VALUES_PER_RANGE		8
+#define MINMAX_MULTI_MAX_VALUES_PER_RANGE		256
+
+typedef struct MinmaxMultiOpaque
+{
+	Oid			cached_subtype;
+	FmgrInfo	strategy_procinfos[BTMaxStrategyNumber];
+	MemoryContext tmpcxt;		/* for the unpacked intervals */
+} MinmaxMultiOpaque;
+
+/* minmax-multi opclass options */
+typedef struct MinmaxMultiOptions
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	int			valuesPerRange; /* number of values per range */
+} MinmaxMultiOptions;
+
+#define MinmaxMultiGetMaxRanges(opts) \
+	(((opts) ? ((MinmaxMultiOptions *) (opts))->valuesPerRange : \
+	  MINMAX_MULTI_DEFAULT_VALUES_PER_RANGE) / 2)
+
+/*
+ * The intervals as stored in the index tuple.  The 2 * nranges boundary
+ * values follow, ordered by value and packed without alignment: fixed-length
+ * values as their attlen bytes, varlena values preceded by their length.
+ */
+typedef struct SerializedRanges
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	int32		nranges;		/* number of intervals */
+	char		data[FLEXIBLE_ARRAY_MEMBER];
+} SerializedRanges;
+
+/*
+ * The intervals in memory.  values[2 * i] and values[2 * i + 1] are the
+ * minimum and maximum of interval i; the intervals are sorted and disjoint.
+ */
+typedef struct Ranges
+{
+	int			nranges;		/* number of intervals */
+	int			capacity;		/* number of intervals there's room for */
+	Datum		values[FLEXIBLE_ARRAY_MEMBER];
+} Ranges;
+
+#define RangeMin(r, i)	((r)->values[2 * (i)])
+#define RangeMax(r, i)	((r)->values[2 * (i) + 1])
+
+/* state of compare_ranges */
+typedef struct compare_context
+{
+	FmgrInfo   *ltFn;
+	Oid			colloid;
+} compare_context;
+
+static Ranges *ranges_init(int capacity);
+static Ranges *ranges_deserialize(Datum value, Form_pg_attribute attr,
+								  int extra);
+static Datum ranges_serialize(Ranges *ranges, Form_pg_attribute attr);
+static void ranges_reduce(BrinDesc *bdesc, AttrNumber attno, Oid colloid,
+						  Ranges *ranges, int maxranges);
+static int	compare_ranges(const void *a, const void *b, void *arg);
+static MemoryContext minmax_multi_get_tmpcxt(BrinDesc *bdesc, uint16 attno);
+static FmgrInfo *minmax_multi_get_strategy_procinfo(BrinDesc *bdesc,
+													uint16 attno,
+													Oid subtype,
+													uint16 strategynum);
+
+
+Datum
+brin_minmax_multi_opcinfo(PG_FUNCTION_ARGS)
+{
+	BrinOpcInfo *result;
+
+	/*
+	 * opaque->strategy_procinfos is initialized lazily; here it is set to
+	 * all-uninitialized by palloc0 which sets fn_oid to InvalidOid.
+	 *
+	 * The intervals are stored as a single bytea value, whatever the type of
+	 * the indexed column.
+	 */
+	result = palloc0(MAXALIGN(SizeofBrinOpcInfo(1)) +
+					 sizeof(MinmaxMultiOpaque));
+	result->oi_nstored = 1;
+	result->oi_opaque = (MinmaxMultiOpaque *)
+		MAXALIGN((char *) result + SizeofBrinOpcInfo(1));
+	result->oi_typcache[0] = lookup_type_cache(BYTEAOID, 0);
+
+	PG_RETURN_POINTER(result);
+}
+
+/*
+ * Examine the given index tuple (which contains partial status of a certain
+ * page range) by comparing it to the given value that comes from another heap
+ * tuple.  If the new value is not covered by any of the intervals of the
+ * existing tuple, add it as a new interval (merging the two closest ones, if
+ * that makes too many of them) and return true.  Otherwise, return false and
+ * do not modify in this case.
+ */
+Datum
+brin_minmax_multi_add_value(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	Datum		newval = PG_GETARG_DATUM(2);
+	bool		isnull = PG_GETARG_DATUM(3);
+	Oid			colloid = PG_GET_COLLATION();
+	void	   *opts = PG_HAS_OPCLASS_OPTIONS() ? PG_GET_OPCLASS_OPTIONS() : NULL;
+	FmgrInfo   *cmpFn;
+	Form_pg_attribute attr;
+	AttrNumber	attno;
+	Ranges	   *ranges;
+	MemoryContext tmpcxt;
+	MemoryContext oldcxt;
+	Datum		newsummary;
+	int			lo,
+				hi;
+
+	/*
+	 * If the new value is null, we record that we saw it if it's the first
+	 * one; otherwise, there's nothing to do.
+	 */
+	if (isnull)
+	{
+		if (column->bv_hasnulls)
+			PG_RETURN_BOOL(false);
+
+		column->bv_hasnulls = true;
+		PG_RETURN_BOOL(true);
+	}
+
+	attno = column->bv_attno;
+	attr = TupleDescAttr(bdesc->bd_tupdesc, attno - 1);
+
+	/*
+	 * If the recorded value is null, store the new value (which we know to be
+	 * not null) as the only interval, and we're done.
+	 */
+	if (column->bv_allnulls)
+	{
+		if (attr->attlen == -1)
+			newval = PointerGetDatum(PG_DETOAST_DATUM_PACKED(newval));
+		ranges = ranges_init(1);
+		ranges->nranges = 1;
+		RangeMin(ranges, 0) = RangeMax(ranges, 0) = newval;
+		column->bv_values[0] = ranges_serialize(ranges, attr);
+		column->bv_allnulls = false;
+		PG_RETURN_BOOL(true);
+	}
+
+	/*
+	 * The intervals are unpacked in a temporary context, which is reset once
+	 * we're done, as this is called for every row during a build.
+	 */
+	tmpcxt = minmax_multi_get_tmpcxt(bdesc, attno);
+	oldcxt = MemoryContextSwitchTo(tmpcxt);
+
+	if (attr->attlen == -1)
+		newval = PointerGetDatum(PG_DETOAST_DATUM_PACKED(newval));
+	ranges = ranges_deserialize(column->bv_values[0], attr, 1);
+
+	/*
+	 * Find the first interval whose maximum is not less than the new value.
+	 * If its minimum is not greater than the new value either, the value is
+	 * already covered and there's nothing to do.
+	 */
+	cmpFn = minmax_multi_get_strategy_procinfo(bdesc, attno, attr->atttypid,
+											   BTLessStrategyNumber);
+	lo = 0;
+	hi = ranges->nranges;
+	while (lo < hi)
+	{
+		int			mid = (lo + hi) / 2;
+
+		if (DatumGetBool(FunctionCall2Coll(cmpFn, colloid,
+										   RangeMax(ranges, mid), newval)))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < ranges->nranges &&
+		!DatumGetBool(FunctionCall2Coll(cmpFn, colloid,
+										newval, RangeMin(ranges, lo))))
+	{
+		MemoryContextSwitchTo(oldcxt);
+		MemoryContextReset(tmpcxt);
+		PG_RETURN_BOOL(false);
+	}
+
+	/* insert a single-point interval for the value before interval lo */
+	memmove(&RangeMin(ranges, lo + 1), &RangeMin(ranges, lo),
+			2 * (ranges->nranges - lo) * sizeof(Datum));
+	RangeMin(ranges, lo) = RangeMax(ranges, lo) = newval;
+	ranges->nranges++;
+
+	ranges_reduce(bdesc, attno, colloid, ranges, MinmaxMultiGetMaxRanges(opts));
+
+	MemoryContextSwitchTo(oldcxt);
+	newsummary = ranges_serialize(ranges, attr);
+	MemoryContextReset(tmpcxt);
+
+	pfree(DatumGetPointer(column->bv_values[0]));
+	column->bv_values[0] = newsummary;
+
+	PG_RETURN_BOOL(true);
+}
+
+/*
+ * Given an index tuple corresponding to a certain page range and a scan key,
+ * return whether the scan key is consistent with the index tuple's intervals.
+ * Return true if so, false otherwise.
+ */
+Datum
+brin_minmax_multi_consistent(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	ScanKey		key = (ScanKey) PG_GETARG_POINTER(2);
+	Oid			colloid = PG_GET_COLLATION(),
+				subtype;
+	AttrNumber	attno;
+	Datum		value;
+	Datum		matches;
+	FmgrInfo   *finfo;
+	Ranges	   *ranges;
+	int			i;
+
+	Assert(key->sk_attno == column->bv_attno);
+
+	/* handle IS NULL/IS NOT NULL tests */
+	if (key->sk_flags & SK_ISNULL)
+	{
+		if (key->sk_flags & SK_SEARCHNULL)
+		{
+			if (column->bv_allnulls || column->bv_hasnulls)
+				PG_RETURN_BOOL(true);
+			PG_RETURN_BOOL(false);
+		}
+
+		/*
+		 * For IS NOT NULL, we can only skip ranges that are known to have
+		 * only nulls.
+		 */
+		if (key->sk_flags & SK_SEARCHNOTNULL)
+			PG_RETURN_BOOL(!column->bv_allnulls);
+
+		/*
+		 * Neither IS NULL nor IS NOT NULL was used; assume all indexable
+		 * operators are strict and return false.
+		 */
+		PG_RETURN_BOOL(false);
+	}
+
+	/* if the range is all empty, it cannot possibly be consistent */
+	if (column->bv_allnulls)
+		PG_RETURN_BOOL(false);
+
+	attno = key->sk_attno;
+	ranges = ranges_deserialize(column->bv_values[0],
+								TupleDescAttr(bdesc->bd_tupdesc, attno - 1), 0);
+
+	subtype = key->sk_subtype;
+	value = key->sk_argument;
+	switch (key->sk_strategy)
+	{
+		case BTLessStrategyNumber:
+		case BTLessEqualStrategyNumber:
+			/* only the overall minimum matters */
+			finfo = minmax_multi_get_strategy_procinfo(bdesc, attno, subtype,
+													   key->sk_strategy);
+			matches = FunctionCall2Coll(finfo, colloid, RangeMin(ranges, 0),
+										value);
+			break;
+		case BTEqualStrategyNumber:
+			{
+				FmgrInfo   *leFn,
+						   *geFn;
+
+				/*
+				 * In the equality case (WHERE col = someval), we want to
+				 * return the current page range if some interval has its
+				 * minimum <= scan key and its maximum >= scan key.
+				 */
+				leFn = minmax_multi_get_strategy_procinfo(bdesc, attno, subtype,
+														  BTLessEqualStrategyNumber);
+				geFn = minmax_multi_get_strategy_procinfo(bdesc, attno, subtype,
+														  BTGreaterEqualStrategyNumber);
+				matches = BoolGetDatum(false);
+				for (i = 0; i < ranges->nranges; i++)
+				{
+					/* the intervals are sorted, so stop at the first above */
+					if (!DatumGetBool(FunctionCall2Coll(leFn, colloid,
+														RangeMin(ranges, i),
+														value)))
+						break;
+					if (DatumGetBool(FunctionCall2Coll(geFn, colloid,
+													   RangeMax(ranges, i),
+													   value)))
+					{
+						matches = BoolGetDatum(true);
+						break;
+					}
+				}
+			}
+			break;
+		case BTGreaterEqualStrategyNumber:
+		case BTGreaterStrategyNumber:
+			/* only the overall maximum matters */
+			finfo = minmax_multi_get_strategy_procinfo(bdesc, attno, subtype,
+													   key->sk_strategy);
+			matches = FunctionCall2Coll(finfo, colloid,
+										RangeMax(ranges, ranges->nranges - 1),
+										value);
+			break;
+		default:
+			/* shouldn't happen */
+			elog(ERROR, "invalid strategy number %d", key->sk_strategy);
+			matches = 0;
+			break;
+	}
+
+	PG_RETURN_DATUM(matches);
+}
+
+/*
+ * Given two BrinValues, update the first of them as a union of the summary
+ * values contained in both.  The second one is untouched.
+ */
+Datum
+brin_minmax_multi_union(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *col_a = (BrinValues *) PG_GETARG_POINTER(1);
+	BrinValues *col_b = (BrinValues *) PG_GETARG_POINTER(2);
+	Oid			colloid = PG_GET_COLLATION();
+	void	   *opts = PG_HAS_OPCLASS_OPTIONS() ? PG_GET_OPCLASS_OPTIONS() : NULL;
+	AttrNumber	attno;
+	Form_pg_attribute attr;
+	Ranges	   *ranges_a;
+	Ranges	   *ranges_b;
+	compare_context cxt;
+	MemoryContext tmpcxt;
+	MemoryContext oldcxt;
+	Datum		newsummary;
+	int			nranges;
+	int			i;
+
+	Assert(col_a->bv_attno == col_b->bv_attno);
+
+	/* Adjust "hasnulls" */
+	if (!col_a->bv_hasnulls && col_b->bv_hasnulls)
+		col_a->bv_hasnulls = true;
+
+	/* If there are no values in B, there's nothing left to do */
+	if (col_b->bv_allnulls)
+		PG_RETURN_VOID();
+
+	attno = col_a->bv_attno;
+	attr = TupleDescAttr(bdesc->bd_tupdesc, attno - 1);
+
+	/*
+	 * Adjust "allnulls".  If A doesn't have values, just copy the values from
+	 * B into A, and we're done.  Note we already established that B contains
+	 * values.
+	 */
+	if (col_a->bv_allnulls)
+	{
+		col_a->bv_allnulls = false;
+		col_a->bv_values[0] = datumCopy(col_b->bv_values[0], false, -1);
+		PG_RETURN_VOID();
+	}
+
+	tmpcxt = minmax_multi_get_tmpcxt(bdesc, attno);
+	oldcxt = MemoryContextSwitchTo(tmpcxt);
+
+	ranges_b = ranges_deserialize(col_b->bv_values[0], attr, 0);
+	ranges_a = ranges_deserialize(col_a->bv_values[0], attr,
+								  ranges_b->nranges);
+
+	/* put all the intervals together, and sort them by their minimum */
+	memcpy(&RangeMin(ranges_a, ranges_a->nranges), ranges_b->values,
+		   2 * ranges_b->nranges * sizeof(Datum));
+	ranges_a->nranges += ranges_b->nranges;
+
+	cxt.ltFn = minmax_multi_get_strategy_procinfo(bdesc, attno, attr->atttypid,
+												  BTLessStrategyNumber);
+	cxt.colloid = colloid;
+	qsort_arg(ranges_a->values, ranges_a->nranges, 2 * sizeof(Datum),
+			  compare_ranges, &cxt);
+
+	/* merge the overlapping intervals, which may now be adjacent */
+	nranges = 0;
+	for (i = 1; i < ranges_a->nranges; i++)
+	{
+		if (DatumGetBool(FunctionCall2Coll(cxt.ltFn, colloid,
+										   RangeMax(ranges_a, nranges),
+										   RangeMin(ranges_a, i))))
+		{
+			/* disjoint, keep it as a separate interval */
+			nranges++;
+			RangeMin(ranges_a, nranges) = RangeMin(ranges_a, i);
+			RangeMax(ranges_a, nranges) = RangeMax(ranges_a, i);
+		}
+		else if (DatumGetBool(FunctionCall2Coll(cxt.ltFn, colloid,
+												RangeMax(ranges_a, nranges),
+												RangeMax(ranges_a, i))))
+			RangeMax(ranges_a, nranges) = RangeMax(ranges_a, i);
+	}
+	ranges_a->nranges = nranges + 1;
+
+	ranges_reduce(bdesc, attno, colloid, ranges_a,
+				  MinmaxMultiGetMaxRanges(opts));
+
+	MemoryContextSwitchTo(oldcxt);
+	newsummary = ranges_serialize(ranges_a, attr);
+	MemoryContextReset(tmpcxt);
+
+	pfree(DatumGetPointer(col_a->bv_values[0]));
+	col_a->bv_values[0] = newsummary;
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Define the opclass parameters.
+ */
+Datum
+brin_minmax_multi_options(PG_FUNCTION_ARGS)
+{
+	local_relopts *relopts = (local_relopts *) PG_GETARG_POINTER(0);
+
+	init_local_reloptions(relopts, sizeof(MinmaxMultiOptions));
+
+	add_local_int_reloption(relopts, "values_per_range",
+							"number of values stored per BRIN page range",
+							MINMAX_MULTI_DEFAULT_VALUES_PER_RANGE,
+							MINMAX_MULTI_MIN_VALUES_PER_RANGE,
+							MINMAX_MULTI_MAX_VALUES_PER_RANGE,
+							offsetof(MinmaxMultiOptions, valuesPerRange));
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Allocate an empty set of intervals, with room for capacity of them.
+ */
+static Ranges *
+ranges_init(int capacity)
+{
+	Ranges	   *ranges;
+
+	ranges = palloc(offsetof(Ranges, values) + 2 * capacity * sizeof(Datum));
+	ranges->nranges = 0;
+	ranges->capacity = capacity;
+
+	return ranges;
+}
+
+/*
+ * Unpack the intervals stored in an index tuple, leaving room for extra
+ * more.  By-reference values are newly allocated.
+ */
+static Ranges *
+ranges_deserialize(Datum value, Form_pg_attribute attr, int extra)
+{
+	SerializedRanges *serialized;
+	Ranges	   *ranges;
+	char	   *ptr;
+	int			i;
+
+	serialized = (SerializedRanges *) PG_DETOAST_DATUM(value);
+
+	ranges = ranges_init(serialized->nranges + extra);
+	ranges->nranges = serialized->nranges;
+
+	ptr = serialized->data;
+	for (i = 0; i < 2 * serialized->nranges; i++)
+	{
+		if (attr->attbyval)
+		{
+			Datum		tmp;
+
+			/* copy to an aligned place first */
+			memcpy(&tmp, ptr, attr->attlen);
+			ranges->values[i] = fetch_att(&tmp, true, attr->attlen);
+			ptr += attr->attlen;
+		}
+		else if (attr->attlen > 0)
+		{
+			char	   *copy = palloc(attr->attlen);
+
+			memcpy(copy, ptr, attr->attlen);
+			ranges->values[i] = PointerGetDatum(copy);
+			ptr += attr->attlen;
+		}
+		else
+		{
+			uint32		len;
+			char	   *copy;
+
+			Assert(attr->attlen == -1);
+			memcpy(&len, ptr, sizeof(uint32));
+			ptr += sizeof(uint32);
+			copy = palloc(len);
+			memcpy(copy, ptr, len);
+			ranges->values[i] = PointerGetDatum(copy);
+			ptr += len;
+		}
+	}
+	Assert(ptr == (char *) serialized + VARSIZE(serialized));
+
+	return ranges;
+}
+
+/*
+ * Pack the intervals into a value to be stored in the index tuple.  Varlena
+ * values must not be toasted.
+ */
+static Datum
+ranges_serialize(Ranges *ranges, Form_pg_attribute attr)
+{
+	SerializedRanges *serialized;
+	Datum	   *values = ranges->values;
+	int			nvalues = 2 * ranges->nranges;
+	Size		len;
+	char	   *ptr;
+	int			i;
+
+	Assert(ranges->nranges > 0);
+	Assert(attr->attlen > 0 || attr->attlen == -1);
+
+	len = offsetof(SerializedRanges, data);
+	for (i = 0; i < nvalues; i++)
+	{
+		if (attr->attlen > 0)
+			len += attr->attlen;
+		else
+			len += sizeof(uint32) + VARSIZE_ANY(DatumGetPointer(values[i]));
+	}
+
+	serialized = (SerializedRanges *) palloc(len);
+	SET_VARSIZE(serialized, len);
+	serialized->nranges = ranges->nranges;
+
+	ptr = serialized->data;
+	for (i = 0; i < nvalues; i++)
+	{
+		if (attr->attbyval)
+		{
+			Datum		tmp;
+
+			store_att_byval(&tmp, values[i], attr->attlen);
+			memcpy(ptr, &tmp, attr->attlen);
+			ptr += attr->attlen;
+		}
+		else if (attr->attlen > 0)
+		{
+			memcpy(ptr, DatumGetPointer(values[i]), attr->attlen);
+			ptr += attr->attlen;
+		}
+		else
+		{
+			uint32		vlen = VARSIZE_ANY(DatumGetPointer(values[i]));
+
+			memcpy(ptr, &vlen, sizeof(uint32));
+			ptr += sizeof(uint32);
+			memcpy(ptr, DatumGetPointer(values[i]), vlen);
+			ptr += vlen;
+		}
+	}
+	Assert(ptr == (char *) serialized + len);
+
+	return PointerGetDatum(serialized);
+}
+
+/*
+ * Merge the closest adjacent intervals until there are no more than
+ * maxranges of them.
+ */
+static void
+ranges_reduce(BrinDesc *bdesc, AttrNumber attno, Oid colloid,
+			  Ranges *ranges, int maxranges)
+{
+	FmgrInfo   *distanceFn;
+
+	if (ranges->nranges <= maxranges)
+		return;
+
+	distanceFn = index_getprocinfo(bdesc->bd_index, attno,
+								   MINMAX_MULTI_PROCNUM_DISTANCE);
+
+	while (ranges->nranges > maxranges)
+	{
+		double		mindistance = 0;
+		int			best = -1;
+		int			i;
+
+		for (i = 0; i < ranges->nranges - 1; i++)
+		{
+			double		distance;
+
+			distance = DatumGetFloat8(FunctionCall2Coll(distanceFn, colloid,
+														RangeMax(ranges, i),
+														RangeMin(ranges, i + 1)));
+			if (best < 0 || distance < mindistance)
+			{
+				best = i;
+				mindistance = distance;
+			}
+		}
+
+		RangeMax(ranges, best) = RangeMax(ranges, best + 1);
+		memmove(&RangeMin(ranges, best + 1), &RangeMin(ranges, best + 2),
+				2 * (ranges->nranges - best - 2) * sizeof(Datum));
+		ranges->nranges--;
+	}
+}
+
+/*
+ * Return the temporary memory context of an index column, creating it the
+ * first time through.
+ */
+static MemoryContext
+minmax_multi_get_tmpcxt(BrinDesc *bdesc, uint16 attno)
+{
+	MinmaxMultiOpaque *opaque;
+
+	opaque = (MinmaxMultiOpaque *) bdesc->bd_info[attno - 1]->oi_opaque;
+	if (opaque->tmpcxt == NULL)
+		opaque->tmpcxt = AllocSetContextCreate(bdesc->bd_context,
+											   "minmax multi temporary context",
+											   ALLOCSET_DEFAULT_SIZES);
+
+	return opaque->tmpcxt;
+}
+
+/*
+ * qsort_arg comparator, ordering intervals by their minimum.
+ */
+static int
+compare_ranges(const void *a, const void *b, void *arg)
+{
+	Datum		mina = *(const Datum *) a;
+	Datum		minb = *(const Datum *) b;
+	compare_context *cxt = (compare_context *) arg;
+
+	if (DatumGetBool(FunctionCall2Coll(cxt->ltFn, cxt->colloid, mina, minb)))
+		return -1;
+	if (DatumGetBool(FunctionCall2Coll(cxt->ltFn, cxt->colloid, minb, mina)))
+		return 1;
+	return 0;
+}
+
+/*
+ * Cache and return the procedure for the given strategy.
+ *
+ * Note: this function mirrors minmax_get_strategy_procinfo; see notes
+ * there.  If changes are made here, see that function too.
+ */
+static FmgrInfo *
+minmax_multi_get_strategy_procinfo(BrinDesc *bdesc, uint16 attno, Oid subtype,
+								   uint16 strategynum)
+{
+	MinmaxMultiOpaque *opaque;
+
+	Assert(strategynum >= 1 &&
+		   strategynum <= BTMaxStrategyNumber);
+
+	opaque = (MinmaxMultiOpaque *) bdesc->bd_info[attno - 1]->oi_opaque;
+
+	/*
+	 * We cache the procedures for the previous subtype in the opaque struct,
+	 * to avoid repetitive syscache lookups.  If the subtype changed,
+	 * invalidate all the cached entries.
+	 */
+	if (opaque->cached_subtype != subtype)
+	{
+		uint16		i;
+
+		for (i = 1; i <= BTMaxStrategyNumber; i++)
+			opaque->strategy_procinfos[i - 1].fn_oid = InvalidOid;
+		opaque->cached_subtype = subtype;
+	}
+
+	if (opaque->strategy_procinfos[strategynum - 1].fn_oid == InvalidOid)
+	{
+		Form_pg_attribute attr;
+		HeapTuple	tuple;
+		Oid			opfamily,
+					oprid;
+		bool		isNull;
+
+		opfamily = bdesc->bd_index->rd_opfamily[attno - 1];
+		attr = TupleDescAttr(bdesc->bd_tupdesc, attno - 1);
+		tuple = SearchSysCache4(AMOPSTRATEGY, ObjectIdGetDatum(opfamily),
+								ObjectIdGetDatum(attr->atttypid),
+								ObjectIdGetDatum(subtype),
+								Int16GetDatum(strategynum));
+
+		if (!HeapTupleIsValid(tuple))
+			elog(ERROR, "missing operator %d(%u,%u) in opfamily %u",
+				 strategynum, attr->atttypid, subtype, opfamily);
+
+		oprid = DatumGetObjectId(SysCacheGetAttr(AMOPSTRATEGY, tuple,
+												 Anum_pg_amop_amopopr, &isNull));
+		ReleaseSysCache(tuple);
+		Assert(!isNull && RegProcedureIsValid(oprid));
+
+		fmgr_info_cxt(get_opcode(oprid),
+					  &opaque->strategy_procinfos[strategynum - 1],
+					  bdesc->bd_context);
+	}
+
+	return &opaque->strategy_procinfos[strategynum - 1];
+}
+
+/*
+ * Distance functions, returning the distance between two values a <= b of
+ * a data type.  The result only needs to be good enough to tell which of
+ * two pairs of values is closer.
+ */
+
+Datum
+brin_minmax_multi_distance_int2(PG_FUNCTION_ARGS)
+{
+	int16		a = PG_GETARG_INT16(0);
+	int16		b = PG_GETARG_INT16(1);
+
+	Assert(a <= b);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+Datum
+brin_minmax_multi_distance_int4(PG_FUNCTION_ARGS)
+{
+	int32		a = PG_GETARG_INT32(0);
+	int32		b = PG_GETARG_INT32(1);
+
+	Assert(a <= b);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+Datum
+brin_minmax_multi_distance_int8(PG_FUNCTION_ARGS)
+{
+	int64		a = PG_GETARG_INT64(0);
+	int64		b = PG_GETARG_INT64(1);
+
+	Assert(a <= b);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+Datum
+brin_minmax_multi_distance_float4(PG_FUNCTION_ARGS)
+{
+	float4		a = PG_GETARG_FLOAT4(0);
+	float4		b = PG_GETARG_FLOAT4(1);
+
+	/* equal values (including two infinities) are not apart at all */
+	if (a == b)
+		PG_RETURN_FLOAT8(0.0);
+
+	/* NaN sorts above everything else, treat it as infinitely far */
+	if (isnan(a) || isnan(b))
+		PG_RETURN_FLOAT8(get_float8_infinity());
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+Datum
+brin_minmax_multi_distance_float8(PG_FUNCTION_ARGS)
+{
+	float8		a = PG_GETARG_FLOAT8(0);
+	float8		b = PG_GETARG_FLOAT8(1);
+
+	/* equal values (including two infinities) are not apart at all */
+	if (a == b)
+		PG_RETURN_FLOAT8(0.0);
+
+	/* NaN sorts above everything else, treat it as infinitely far */
+	if (isnan(a) || isnan(b))
+		PG_RETURN_FLOAT8(get_float8_infinity());
+
+	PG_RETURN_FLOAT8(b - a);
+}
+
+Datum
+brin_minmax_multi_distance_numeric(PG_FUNCTION_ARGS)
+{
+	Datum		a = PG_GETARG_DATUM(0);
+	Datum		b = PG_GETARG_DATUM(1);
+	Datum		d;
+	float8		distance;
+
+	d = DirectFunctionCall2(numeric_sub, b, a);
+	distance = DatumGetFloat8(DirectFunctionCall1(numeric_float8_no_overflow,
+												  d));
+
+	/* b - a is NaN if b is NaN, which sorts above everything else */
+	if (isnan(distance))
+		PG_RETURN_FLOAT8(get_float8_infinity());
+
+	PG_RETURN_FLOAT8(distance);
+}
+
+Datum
+brin_minmax_multi_distance_date(PG_FUNCTION_ARGS)
+{
+	DateADT		a = PG_GETARG_DATEADT(0);
+	DateADT		b = PG_GETARG_DATEADT(1);
+
+	Assert(a <= b);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+Datum
+brin_minmax_multi_distance_time(PG_FUNCTION_ARGS)
+{
+	TimeADT		a = PG_GETARG_TIMEADT(0);
+	TimeADT		b = PG_GETARG_TIMEADT(1);
+
+	Assert(a <= b);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+/*
+ * Also used for timestamptz, which has the same representation.
+ */
+Datum
+brin_minmax_multi_distance_timestamp(PG_FUNCTION_ARGS)
+{
+	Timestamp	a = PG_GETARG_TIMESTAMP(0);
+	Timestamp	b = PG_GETARG_TIMESTAMP(1);
+
+	Assert(a <= b);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+Datum
+brin_minmax_multi_distance_interval(PG_FUNCTION_ARGS)
+{
+	Interval   *ia = PG_GETARG_INTERVAL_P(0);
+	Interval   *ib = PG_GETARG_INTERVAL_P(1);
+	double		a,
+				b;
+
+	/* the same approximation as interval_cmp_value, in microseconds */
+	a = ia->time +
+		((double) ia->month * DAYS_PER_MONTH + ia->day) * USECS_PER_DAY;
+	b = ib->time +
+		((double) ib->month * DAYS_PER_MONTH + ib->day) * USECS_PER_DAY;
+
+	PG_RETURN_FLOAT8(fabs(b - a));
+}
+
+Datum
+brin_minmax_multi_distance_uuid(PG_FUNCTION_ARGS)
+{
+	pg_uuid_t  *ua = PG_GETARG_UUID_P(0);
+	pg_uuid_t  *ub = PG_GETARG_UUID_P(1);
+	double		delta = 0;
+	int			i;
+
+	/*
+	 * Treat the UUIDs as big-endian 128-bit numbers, scaled down so that the
+	 * difference of the first bytes counts as a unit.
+	 */
+	for (i = UUID_LEN - 1; i >= 0; i--)
+	{
+		delta += (int) ub->data[i] - (int) ua->data[i];
+		delta /= 256;
+	}
+
+	Assert(delta >= 0);
+
+	PG_RETURN_FLOAT8(delta * 256);
+}
+
+Datum
+brin_minmax_multi_distance_pg_lsn(PG_FUNCTION_ARGS)
+{
+	XLogRecPtr	a = PG_GETARG_LSN(0);
+	XLogRecPtr	b = PG_GETARG_LSN(1);
+
+	Assert(a <= b);
+
+	PG_RETURN_FLOAT8((double) (b - a));
+}
+
+Datum
+brin_minmax_multi_distance_oid(PG_FUNCTION_ARGS)
+{
+	Oid			a = PG_GETARG_OID(0);
+	Oid			b = PG_GETARG_OID(1);
+
+	Assert(a <= b);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
@@ -41,12 +41,34 @@
  *
  *		This shouldn't perform external table access provided caller
  *		does not pass values that are stored EXTERNAL.
+ *
+ *		Same as index_form_tuple_context, but allocates the returned tuple in
+ *		the CurrentMemoryContext.
  * ----------------
  */
 IndexTuple
 index_form_tuple(TupleDesc tupleDescriptor,
 				 Datum *values,
 				 bool *isnull)
+{
+	return index_form_tuple_context(tupleDescriptor, values, isnull,
+									CurrentMemoryContext);
+}
+
+/* ----------------
+ *		index_form_tuple_context
+ *
+ *		As index_form_tuple, but the returned tuple is allocated in the given
+ *		memory context.  Any working memory, such as detoasted values, is
+ *		allocated and released in the CurrentMemoryContext, so the tuple can
+ *		be built in a context that doesn't support pfree().
+ * ----------------
+ */
+IndexTuple
+index_form_tuple_context(TupleDesc tupleDescriptor,
+						 Datum *values,
+						 bool *isnull,
+						 MemoryContext context)
 {
 	char	   *tp;				/* tuple pointer */
 	IndexTuple	tuple;			/* return tuple */
@@ -103,7 +125,10 @@ index_form_tuple(TupleDesc tupleDescriptor,
 			(att->attstorage == TYPSTORAGE_EXTENDED ||
 			 att->attstorage == TYPSTORAGE_MAIN))
 		{
-			Datum		cvalue = toast_compress_datum(untoasted_values[i]);
+			Datum		cvalue;
+
+			cvalue = toast_compress_datum(untoasted_values[i],
+										  att->attcompression);
 
 			if (DatumGetPointer(cvalue) != NULL)
 			{
@@ -140,7 +165,7 @@ index_form_tuple(TupleDesc tupleDescriptor,
 	size = hoff + data_size;
 	size = MAXALIGN(size);		/* be conservative */
 
-	tp = (char *) palloc0(size);
+	tp = (char *) MemoryContextAllocZero(context, size);
 	tuple = (IndexTuple) tp;
 
 	heap_fill_tuple(tupleDescriptor,
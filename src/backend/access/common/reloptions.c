@@ -122,6 +122,15 @@ static relopt_bool boolRelOpts[] =
 		},
 		false
 	},
+	{
+		{
+			"incremental",
+			"Maintains the materialized view incrementally as its base tables change",
+			RELOPT_KIND_MATVIEW,
+			AccessExclusiveLock
+		},
+		false
+	},
 	{
 		{
 			"fastupdate",
@@ -1859,7 +1868,9 @@ default_reloptions(Datum reloptions, bool validate, relopt_kind kind)
 		{"vacuum_index_cleanup", RELOPT_TYPE_BOOL,
 		offsetof(StdRdOptions, vacuum_index_cleanup)},
 		{"vacuum_truncate", RELOPT_TYPE_BOOL,
-		offsetof(StdRdOptions, vacuum_truncate)}
+		offsetof(StdRdOptions, vacuum_truncate)},
+		{"incremental", RELOPT_TYPE_BOOL,
+		offsetof(StdRdOptions, incremental)}
 	};
 
 	return (bytea *) build_reloptions(reloptions, validate, kind,
@@ -2011,8 +2022,10 @@ heap_reloptions(char relkind, Datum reloptions, bool validate)
 			}
 			return (bytea *) rdopts;
 		case RELKIND_RELATION:
-		case RELKIND_MATVIEW:
 			return default_reloptions(reloptions, validate, RELOPT_KIND_HEAP);
+		case RELKIND_MATVIEW:
+			return default_reloptions(reloptions, validate,
+									  RELOPT_KIND_HEAP | RELOPT_KIND_MATVIEW);
 		default:
 			/* other relkinds are not supported */
 			return NULL;
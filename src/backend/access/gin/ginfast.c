@@ -38,6 +38,12 @@
 /* GUC parameter */
 int			gin_pending_list_limit = 0;
 
+/*
+ * How far past its limit the pending list may grow while an insert that
+ * overflowed it leaves the cleanup to autovacuum, as a multiple of the limit.
+ */
+#define GIN_PENDING_LIST_BACKPRESSURE	2
+
 #define GIN_PAGE_FREESIZE \
 	( BLCKSZ - MAXALIGN(SizeOfPageHeaderData) - MAXALIGN(sizeof(GinPageOpaqueData)) )
 
@@ -227,6 +233,7 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	ginxlogUpdateMeta data;
 	bool		separateList = false;
 	bool		needCleanup = false;
+	bool		deferCleanup = false;
 	int			cleanupSize;
 	bool		needWal;
 
@@ -448,17 +455,36 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	 */
 	cleanupSize = GinGetPendingListCleanupSize(index);
 	if (metadata->nPendingPages * GIN_PAGE_FREESIZE > cleanupSize * 1024L)
+	{
 		needCleanup = true;
+		deferCleanup = metadata->nPendingPages * GIN_PAGE_FREESIZE <=
+			GIN_PENDING_LIST_BACKPRESSURE * cleanupSize * 1024L;
+	}
 
 	UnlockReleaseBuffer(metabuffer);
 
 	END_CRIT_SECTION();
 
+	/*
+	 * Rather than have this insert wait for the cleanup, ask autovacuum to do
+	 * it, as long as the list hasn't grown too far past its limit since we
+	 * last did so.  That bounds how long searches are slowed down by a long
+	 * pending list if autovacuum is slow to get to it, or if the request
+	 * didn't fit in autovacuum's work item queue.  Autovacuum can't see
+	 * temporary indexes.
+	 */
+	if (deferCleanup &&
+		(!IsUnderPostmaster || !AutoVacuumingActive() ||
+		 index->rd_rel->relpersistence == RELPERSISTENCE_TEMP ||
+		 !AutoVacuumRequestWork(AVW_GinCleanPendingList,
+								RelationGetRelid(index), InvalidBlockNumber)))
+		deferCleanup = false;
+
 	/*
 	 * Since it could contend with concurrent cleanup process we cleanup
 	 * pending list not forcibly.
 	 */
-	if (needCleanup)
+	if (needCleanup && !deferCleanup)
 		ginInsertCleanup(ginstate, false, true, false, NULL);
 }
 
@@ -16,16 +16,124 @@
 
 #include "access/gin_private.h"
 #include "access/ginxlog.h"
+#include "access/parallel.h"
+#include "access/table.h"
 #include "access/tableam.h"
+#include "access/xact.h"
 #include "access/xloginsert.h"
 #include "catalog/index.h"
+#include "executor/instrument.h"
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "storage/bufmgr.h"
+#include "storage/condition_variable.h"
 #include "storage/indexfsm.h"
 #include "storage/predicate.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"		/* pgrminclude ignore */
+#include "utils/datum.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/sharedtuplestore.h"
+
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_GIN_SHARED			UINT64CONST(0xB000000000000001)
+#define PARALLEL_KEY_GIN_STS			UINT64CONST(0xB000000000000002)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xB000000000000003)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xB000000000000004)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xB000000000000005)
+
+/*
+ * DISABLE_LEADER_PARTICIPATION disables the leader's participation in
+ * parallel index builds.  This may be useful as a debugging aid.
+#undef DISABLE_LEADER_PARTICIPATION
+ */
+
+/*
+ * Status for index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment.
+ *
+ * In a parallel build, every participant scans part of the heap and
+ * accumulates entries as in a serial build, but instead of inserting them
+ * into the index when its memory fills up, it writes them to a shared
+ * tuplestore.  The leader then inserts all of them.  So the extraction of
+ * keys, which is what makes GIN builds slow, is parallel, while the index
+ * itself is only ever written by the leader.
+ */
+typedef struct GinShared
+{
+	/* Immutable state */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+	int			nparticipants;	/* as planned, including the leader */
+
+	/*
+	 * workersdonecv is used to monitor the progress of workers.  All parallel
+	 * participants must indicate that they are done before the leader can
+	 * read the shared tuplestore.
+	 */
+	ConditionVariable workersdonecv;
+
+	/* mutex protects the mutable state below */
+	slock_t		mutex;
+
+	int			nparticipantsdone;
+	double		reltuples;
+	double		indtuples;
+	bool		brokenhotchain;
+
+	/* backing files of the shared tuplestore */
+	SharedFileSet fileset;
+
+	/*
+	 * ParallelTableScanDescData data follows. Can't directly embed here, as
+	 * implementations of the parallel table scan desc interface might need
+	 * stronger alignment.
+	 */
+} GinShared;
+
+/*
+ * Return pointer to a GinShared's parallel table scan.
+ *
+ * c.f. shm_toc_allocate as to why BUFFERALIGN is used, rather than just
+ * MAXALIGN.
+ */
+#define ParallelTableScanFromGinShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(GinShared)))
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct GinLeader
+{
+	ParallelContext *pcxt;
+
+	/* number of workers launched, plus one if the leader participates */
+	int			nparticipants;
+
+	GinShared  *ginshared;
+	SharedTuplestoreAccessor *sts;	/* leader's accessor */
+	Snapshot	snapshot;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+} GinLeader;
+
+/*
+ * What a parallel participant sends the leader: the heap TIDs it found for
+ * one key.  Each chunk is followed by the TIDs, then the key in
+ * datumSerialize() format.  As far as sharedtuplestore.c is concerned this is
+ * a MinimalTuple, which works as long as it begins with the length.
+ */
+typedef struct GinBuildChunk
+{
+	uint32		t_len;			/* total size of the chunk */
+	OffsetNumber attnum;
+	GinNullCategory category;
+	uint32		nitems;
+	ItemPointerData items[FLEXIBLE_ARRAY_MEMBER];
+} GinBuildChunk;
 
 typedef struct
 {
@@ -35,8 +143,29 @@ typedef struct
 	MemoryContext tmpCtx;
 	MemoryContext funcCtx;
 	BuildAccumulator accum;
+	int			accum_mem;		/* memory for accum, in kB */
+
+	/*
+	 * sts is where a parallel participant sends its entries; NULL if they go
+	 * straight into the index.  ginleader is set in the leader of a parallel
+	 * build.
+	 */
+	SharedTuplestoreAccessor *sts;
+	GinLeader  *ginleader;
 } GinBuildState;
 
+static void ginFlushBuildState(GinBuildState *buildstate);
+static void _gin_begin_parallel(GinBuildState *buildstate, Relation heap,
+								Relation index, bool isconcurrent,
+								int request);
+static void _gin_end_parallel(GinLeader *ginleader);
+static double _gin_parallel_merge(GinBuildState *buildstate,
+								  IndexInfo *indexInfo);
+static void _gin_parallel_scan_and_build(GinShared *ginshared,
+										 SharedTuplestoreAccessor *sts,
+										 Relation heap, Relation index,
+										 int accum_mem, bool progress);
+
 
 /*
  * Adds array of item pointers to tuple's posting list, or
@@ -291,29 +420,80 @@ ginBuildCallback(Relation index, ItemPointer tid, Datum *values,
 							   values[i], isnull[i], tid);
 
 	/* If we've maxed out our available memory, dump everything to the index */
-	if (buildstate->accum.allocatedMemory >= (Size) maintenance_work_mem * 1024L)
-	{
-		ItemPointerData *list;
-		Datum		key;
-		GinNullCategory category;
-		uint32		nlist;
-		OffsetNumber attnum;
+	if (buildstate->accum.allocatedMemory >= (Size) buildstate->accum_mem * 1024L)
+		ginFlushBuildState(buildstate);
 
-		ginBeginBAScan(&buildstate->accum);
-		while ((list = ginGetBAEntry(&buildstate->accum,
-									 &attnum, &key, &category, &nlist)) != NULL)
-		{
-			/* there could be many entries, so be willing to abort here */
-			CHECK_FOR_INTERRUPTS();
+	MemoryContextSwitchTo(oldCtx);
+}
+
+/*
+ * Send the heap TIDs of one key to the leader of a parallel build.
+ */
+static void
+ginSendBuildChunk(GinBuildState *buildstate, OffsetNumber attnum, Datum key,
+				  GinNullCategory category, ItemPointerData *items,
+				  uint32 nitems)
+{
+	Form_pg_attribute attr = TupleDescAttr(buildstate->ginstate.origTupdesc,
+										   attnum - 1);
+	bool		isnull = (category != GIN_CAT_NORM_KEY);
+	Size		keysize;
+	Size		size;
+	GinBuildChunk *chunk;
+	char	   *ptr;
+	MemoryContext oldCtx;
+
+	keysize = datumEstimateSpace(key, isnull, attr->attbyval, attr->attlen);
+	size = offsetof(GinBuildChunk, items) +
+		nitems * sizeof(ItemPointerData) + keysize;
+
+	chunk = palloc(size);
+	chunk->t_len = size;
+	chunk->attnum = attnum;
+	chunk->category = category;
+	chunk->nitems = nitems;
+	memcpy(chunk->items, items, nitems * sizeof(ItemPointerData));
+	ptr = (char *) &chunk->items[nitems];
+	datumSerialize(key, isnull, attr->attbyval, attr->attlen, &ptr);
+
+	/*
+	 * The first sts_puttuple() creates our file in the current memory
+	 * context, which mustn't be tmpCtx: that is reset after every flush.
+	 */
+	oldCtx = MemoryContextSwitchTo(MemoryContextGetParent(buildstate->tmpCtx));
+	sts_puttuple(buildstate->sts, NULL, (MinimalTuple) chunk);
+	MemoryContextSwitchTo(oldCtx);
+	pfree(chunk);
+}
+
+/*
+ * Insert everything accumulated so far into the index, or send it to the
+ * leader in a parallel build, and start over.
+ */
+static void
+ginFlushBuildState(GinBuildState *buildstate)
+{
+	ItemPointerData *list;
+	Datum		key;
+	GinNullCategory category;
+	uint32		nlist;
+	OffsetNumber attnum;
+
+	ginBeginBAScan(&buildstate->accum);
+	while ((list = ginGetBAEntry(&buildstate->accum,
+								 &attnum, &key, &category, &nlist)) != NULL)
+	{
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+		if (buildstate->sts)
+			ginSendBuildChunk(buildstate, attnum, key, category, list, nlist);
+		else
 			ginEntryInsert(&buildstate->ginstate, attnum, key, category,
 						   list, nlist, &buildstate->buildStats);
-		}
-
-		MemoryContextReset(buildstate->tmpCtx);
-		ginInitBA(&buildstate->accum);
 	}
 
-	MemoryContextSwitchTo(oldCtx);
+	MemoryContextReset(buildstate->tmpCtx);
+	ginInitBA(&buildstate->accum);
 }
 
 IndexBuildResult *
@@ -324,12 +504,7 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	GinBuildState buildstate;
 	Buffer		RootBuffer,
 				MetaBuffer;
-	ItemPointerData *list;
-	Datum		key;
-	GinNullCategory category;
-	uint32		nlist;
 	MemoryContext oldCtx;
-	OffsetNumber attnum;
 
 	if (RelationGetNumberOfBlocks(index) != 0)
 		elog(ERROR, "index \"%s\" already contains data",
@@ -377,27 +552,35 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 
 	buildstate.accum.ginstate = &buildstate.ginstate;
 	ginInitBA(&buildstate.accum);
+	buildstate.accum_mem = maintenance_work_mem;
+	buildstate.sts = NULL;
+	buildstate.ginleader = NULL;
 
-	/*
-	 * Do the heap scan.  We disallow sync scan here because dataPlaceToPage
-	 * prefers to receive tuples in TID order.
-	 */
-	reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
-									   ginBuildCallback, (void *) &buildstate,
-									   NULL);
+	/* Attempt to launch parallel worker scan when required */
+	if (indexInfo->ii_ParallelWorkers > 0)
+		_gin_begin_parallel(&buildstate, heap, index, indexInfo->ii_Concurrent,
+							indexInfo->ii_ParallelWorkers);
 
-	/* dump remaining entries to the index */
-	oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
-	ginBeginBAScan(&buildstate.accum);
-	while ((list = ginGetBAEntry(&buildstate.accum,
-								 &attnum, &key, &category, &nlist)) != NULL)
+	if (buildstate.ginleader == NULL)
 	{
-		/* there could be many entries, so be willing to abort here */
-		CHECK_FOR_INTERRUPTS();
-		ginEntryInsert(&buildstate.ginstate, attnum, key, category,
-					   list, nlist, &buildstate.buildStats);
+		/*
+		 * Do the heap scan.  We disallow sync scan here because
+		 * dataPlaceToPage prefers to receive tuples in TID order.
+		 */
+		reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
+										   ginBuildCallback, (void *) &buildstate,
+										   NULL);
+
+		/* dump remaining entries to the index */
+		oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
+		ginFlushBuildState(&buildstate);
+		MemoryContextSwitchTo(oldCtx);
+	}
+	else
+	{
+		reltuples = _gin_parallel_merge(&buildstate, indexInfo);
+		_gin_end_parallel(buildstate.ginleader);
 	}
-	MemoryContextSwitchTo(oldCtx);
 
 	MemoryContextDelete(buildstate.funcCtx);
 	MemoryContextDelete(buildstate.tmpCtx);
@@ -538,3 +721,401 @@ gininsert(Relation index, Datum *values, bool *isnull,
 
 	return false;
 }
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Sets buildstate's GinLeader, which caller must use to shut down parallel
+ * mode by passing it to _gin_end_parallel() at the very end of its index
+ * build.  If not even a single worker process can be launched, this is
+ * never set, and caller should proceed with a serial index build.
+ */
+static void
+_gin_begin_parallel(GinBuildState *buildstate, Relation heap, Relation index,
+					bool isconcurrent, int request)
+{
+	ParallelContext *pcxt;
+	int			nparticipants;
+	Snapshot	snapshot;
+	Size		estginshared;
+	Size		eststs;
+	GinShared  *ginshared;
+	SharedTuplestore *sts;
+	GinLeader  *ginleader = (GinLeader *) palloc0(sizeof(GinLeader));
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	bool		leaderparticipates = true;
+	char	   *sharedquery;
+	int			querylen;
+
+#ifdef DISABLE_LEADER_PARTICIPATION
+	leaderparticipates = false;
+#endif
+
+	/*
+	 * Enter parallel mode, and create context for parallel build of gin
+	 * index
+	 */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_gin_parallel_build_main",
+								 request);
+
+	nparticipants = request + 1;
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time
+	 * qual checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_GIN_SHARED workspace, and the
+	 * PARALLEL_KEY_GIN_STS shared tuplestore
+	 */
+	estginshared = add_size(BUFFERALIGN(sizeof(GinShared)),
+							table_parallelscan_estimate(heap, snapshot));
+	shm_toc_estimate_chunk(&pcxt->estimator, estginshared);
+	eststs = sts_estimate(nparticipants);
+	shm_toc_estimate_chunk(&pcxt->estimator, eststs);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	/*
+	 * Estimate space for WalUsage and BufferUsage -- PARALLEL_KEY_WAL_USAGE
+	 * and PARALLEL_KEY_BUFFER_USAGE.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	querylen = strlen(debug_query_string);
+	shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+	{
+		if (IsMVCCSnapshot(snapshot))
+			UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return;
+	}
+
+	/* Store shared build state, for which we reserved space */
+	ginshared = (GinShared *) shm_toc_allocate(pcxt->toc, estginshared);
+	ginshared->heaprelid = RelationGetRelid(heap);
+	ginshared->indexrelid = RelationGetRelid(index);
+	ginshared->isconcurrent = isconcurrent;
+	ginshared->nparticipants = nparticipants;
+	ConditionVariableInit(&ginshared->workersdonecv);
+	SpinLockInit(&ginshared->mutex);
+	ginshared->nparticipantsdone = 0;
+	ginshared->reltuples = 0.0;
+	ginshared->indtuples = 0.0;
+	ginshared->brokenhotchain = false;
+	SharedFileSetInit(&ginshared->fileset, pcxt->seg);
+	table_parallelscan_initialize(heap,
+								  ParallelTableScanFromGinShared(ginshared),
+								  snapshot);
+
+	/* The leader is participant 0 of the shared tuplestore */
+	sts = (SharedTuplestore *) shm_toc_allocate(pcxt->toc, eststs);
+	ginleader->sts = sts_initialize(sts, nparticipants, 0, 0,
+									SHARED_TUPLESTORE_SINGLE_PASS,
+									&ginshared->fileset, "gin");
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_GIN_SHARED, ginshared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_GIN_STS, sts);
+
+	/* Store query string for workers */
+	sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+	memcpy(sharedquery, debug_query_string, querylen + 1);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+
+	/*
+	 * Allocate space for each worker's WalUsage and BufferUsage; no need to
+	 * initialize.
+	 */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+	ginleader->pcxt = pcxt;
+	ginleader->nparticipants = pcxt->nworkers_launched;
+	if (leaderparticipates)
+		ginleader->nparticipants++;
+	ginleader->ginshared = ginshared;
+	ginleader->snapshot = snapshot;
+	ginleader->walusage = walusage;
+	ginleader->bufferusage = bufferusage;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		_gin_end_parallel(ginleader);
+		return;
+	}
+
+	/* Save leader state now that it's clear build will be parallel */
+	buildstate->ginleader = ginleader;
+
+	/*
+	 * Join heap scan ourselves.  Might as well use reliable figure when
+	 * doling out maintenance_work_mem (when requested number of workers were
+	 * not launched, this will be somewhat higher than it is for other
+	 * workers).
+	 */
+	if (leaderparticipates)
+		_gin_parallel_scan_and_build(ginshared, ginleader->sts, heap, index,
+									 maintenance_work_mem / ginleader->nparticipants,
+									 true);
+	else
+		sts_end_write(ginleader->sts);
+
+	/*
+	 * Caller needs to wait for all launched workers when we return.  Make
+	 * sure that the failure-to-start case will not hang forever.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ */
+static void
+_gin_end_parallel(GinLeader *ginleader)
+{
+	int			i;
+
+	/* Shutdown worker processes */
+	WaitForParallelWorkersToFinish(ginleader->pcxt);
+
+	/*
+	 * Next, accumulate WAL usage.  (This must wait for the workers to finish,
+	 * or we might get incomplete data.)
+	 */
+	for (i = 0; i < ginleader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&ginleader->bufferusage[i], &ginleader->walusage[i]);
+
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(ginleader->snapshot))
+		UnregisterSnapshot(ginleader->snapshot);
+	DestroyParallelContext(ginleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Within leader, wait for the end of the heap scan, then insert everything
+ * the participants found into the index.
+ *
+ * Returns the total number of heap tuples scanned.
+ */
+static double
+_gin_parallel_merge(GinBuildState *buildstate, IndexInfo *indexInfo)
+{
+	GinLeader  *ginleader = buildstate->ginleader;
+	GinShared  *ginshared = ginleader->ginshared;
+	GinBuildChunk *chunk;
+	double		reltuples;
+	MemoryContext oldCtx;
+
+	for (;;)
+	{
+		SpinLockAcquire(&ginshared->mutex);
+		if (ginshared->nparticipantsdone == ginleader->nparticipants)
+		{
+			buildstate->indtuples = ginshared->indtuples;
+			if (ginshared->brokenhotchain)
+				indexInfo->ii_BrokenHotChain = true;
+			reltuples = ginshared->reltuples;
+			SpinLockRelease(&ginshared->mutex);
+			break;
+		}
+		SpinLockRelease(&ginshared->mutex);
+
+		ConditionVariableSleep(&ginshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+
+	/*
+	 * Each participant sent the TIDs of a key in ascending order, once per
+	 * time its memory filled up, so ginEntryInsert() gets to merge them into
+	 * the same entry just as in a serial build that ran out of memory that
+	 * many times.  The files being read are opened in the current memory
+	 * context, so only the insertions themselves are done in tmpCtx.
+	 */
+	sts_begin_parallel_scan(ginleader->sts);
+	while ((chunk = (GinBuildChunk *) sts_parallel_scan_next(ginleader->sts,
+															 NULL)) != NULL)
+	{
+		char	   *ptr = (char *) &chunk->items[chunk->nitems];
+		Datum		key;
+		bool		isnull;
+
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+
+		oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+		key = datumRestore(&ptr, &isnull);
+		ginEntryInsert(&buildstate->ginstate, chunk->attnum, key,
+					   chunk->category, chunk->items, chunk->nitems,
+					   &buildstate->buildStats);
+		MemoryContextSwitchTo(oldCtx);
+		MemoryContextReset(buildstate->tmpCtx);
+	}
+	sts_end_parallel_scan(ginleader->sts);
+
+	return reltuples;
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_gin_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	GinShared  *ginshared;
+	SharedTuplestore *sts;
+	SharedTuplestoreAccessor *accessor;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, false);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Look up gin shared state */
+	ginshared = shm_toc_lookup(toc, PARALLEL_KEY_GIN_SHARED, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!ginshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = table_open(ginshared->heaprelid, heapLockmode);
+	indexRel = index_open(ginshared->indexrelid, indexLockmode);
+
+	/* Attach to the shared tuplestore; the leader is participant 0 */
+	SharedFileSetAttach(&ginshared->fileset, seg);
+	sts = shm_toc_lookup(toc, PARALLEL_KEY_GIN_STS, false);
+	accessor = sts_attach(sts, ParallelWorkerNumber + 1, &ginshared->fileset);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	_gin_parallel_scan_and_build(ginshared, accessor, heapRel, indexRel,
+								 maintenance_work_mem / ginshared->nparticipants,
+								 false);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	index_close(indexRel, indexLockmode);
+	table_close(heapRel, heapLockmode);
+}
+
+/*
+ * Perform a participant's portion of a parallel build: scan its share of the
+ * heap, and send the entries found to the leader through sts.
+ *
+ * accum_mem is the amount of memory to accumulate entries in, in kB.
+ */
+static void
+_gin_parallel_scan_and_build(GinShared *ginshared,
+							 SharedTuplestoreAccessor *sts,
+							 Relation heap, Relation index,
+							 int accum_mem, bool progress)
+{
+	GinBuildState buildstate;
+	TableScanDesc scan;
+	double		reltuples;
+	IndexInfo  *indexInfo;
+	MemoryContext oldCtx;
+
+	initGinState(&buildstate.ginstate, index);
+	buildstate.indtuples = 0;
+	memset(&buildstate.buildStats, 0, sizeof(GinStatsData));
+	buildstate.tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+											  "Gin build temporary context",
+											  ALLOCSET_DEFAULT_SIZES);
+	buildstate.funcCtx = AllocSetContextCreate(CurrentMemoryContext,
+											   "Gin build temporary context for user-defined function",
+											   ALLOCSET_DEFAULT_SIZES);
+	buildstate.accum.ginstate = &buildstate.ginstate;
+	ginInitBA(&buildstate.accum);
+	buildstate.accum_mem = Max(accum_mem, 64);
+	buildstate.sts = sts;
+	buildstate.ginleader = NULL;
+
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = ginshared->isconcurrent;
+	scan = table_beginscan_parallel(heap,
+									ParallelTableScanFromGinShared(ginshared));
+	reltuples = table_index_build_scan(heap, index, indexInfo, true, progress,
+									   ginBuildCallback, (void *) &buildstate,
+									   scan);
+
+	/* send the remaining entries */
+	oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
+	ginFlushBuildState(&buildstate);
+	MemoryContextSwitchTo(oldCtx);
+	sts_end_write(sts);
+
+	MemoryContextDelete(buildstate.funcCtx);
+	MemoryContextDelete(buildstate.tmpCtx);
+
+	/* Record ambuild statistics, and whether we found a broken HOT chain */
+	SpinLockAcquire(&ginshared->mutex);
+	ginshared->nparticipantsdone++;
+	ginshared->reltuples += reltuples;
+	ginshared->indtuples += buildstate.indtuples;
+	if (indexInfo->ii_BrokenHotChain)
+		ginshared->brokenhotchain = true;
+	SpinLockRelease(&ginshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&ginshared->workersdonecv);
+}
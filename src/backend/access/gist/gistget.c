@@ -113,7 +113,8 @@ gistkillitems(IndexScanDesc scan)
  * need to be rechecked, and it is also ignored for non-leaf entries.
  *
  * If we are doing an ordered scan, so->distances[] is filled with distance
- * data from the distance() functions before returning success.
+ * data from the distance() functions before returning success, unless the
+ * distances are computed for the whole page at once (see gistScanPage).
  *
  * We must decompress the key in the IndexTuple before passing it to the
  * sk_funcs (which actually are the opclass Consistent or Distance methods).
@@ -237,6 +238,9 @@ gistindex_keytest(IndexScanDesc scan,
 	}
 
 	/* OK, it passes --- now let's compute the distances */
+	if (so->batch)
+		return true;
+
 	key = scan->orderByData;
 	distance_p = so->distances;
 	keySize = scan->numberOfOrderBys;
@@ -303,6 +307,168 @@ gistindex_keytest(IndexScanDesc scan,
 	return true;
 }
 
+/*
+ * gistComputeBatchDistances() -- compute the distances of all the matching
+ * tuples on a page, so->batch->matches[], with the batch Distance methods
+ *
+ * This does what gistindex_keytest does for each tuple, but calls each
+ * ORDER BY key's function once for the whole page, with an array of
+ * entries, instead of once per tuple.  The results are stored in
+ * so->batch->distances[] and so->batch->recheckDistances[].
+ */
+static void
+gistComputeBatchDistances(IndexScanDesc scan, Page page)
+{
+	GISTScanOpaque so = (GISTScanOpaque) scan->opaque;
+	GISTBatchDistanceState *batch = so->batch;
+	GISTSTATE  *giststate = so->giststate;
+	Relation	r = scan->indexRelation;
+	int			nOrderBys = scan->numberOfOrderBys;
+	MemoryContext oldcxt;
+	int			i;
+	int			j;
+
+	oldcxt = MemoryContextSwitchTo(giststate->tempCxt);
+
+	memset(batch->recheckDistances, 0, sizeof(bool) * batch->nmatches);
+
+	for (i = 0; i < nOrderBys; i++)
+	{
+		ScanKey		key = &scan->orderByData[i];
+		int			nentries = 0;
+
+		for (j = 0; j < batch->nmatches; j++)
+		{
+			IndexOrderByDistance *distance = &batch->distances[j * nOrderBys + i];
+			OffsetNumber offset = batch->matches[j];
+			IndexTuple	it;
+			Datum		datum;
+			bool		isNull;
+
+			it = (IndexTuple) PageGetItem(page, PageGetItemId(page, offset));
+
+			/* Same as in gistindex_keytest */
+			if (GistTupleIsInvalid(it))
+			{
+				distance->value = -get_float8_infinity();
+				distance->isnull = false;
+				continue;
+			}
+
+			datum = index_getattr(it,
+								  key->sk_attno,
+								  giststate->leafTupdesc,
+								  &isNull);
+
+			if ((key->sk_flags & SK_ISNULL) || isNull)
+			{
+				/* Assume distance computes as null */
+				distance->value = 0.0;
+				distance->isnull = true;
+				continue;
+			}
+
+			gistdentryinit(giststate, key->sk_attno - 1,
+						   &batch->entries[nentries],
+						   datum, r, page, offset,
+						   false, isNull);
+			batch->entryMatch[nentries] = j;
+			batch->entryRecheck[nentries] = false;
+			nentries++;
+		}
+
+		if (nentries == 0)
+			continue;
+
+		/*
+		 * Call the batch Distance function.  The arguments are the array of
+		 * index data (as GISTENTRYs), their number, the comparison datum,
+		 * the ordering operator's strategy number and subtype from pg_amop,
+		 * and the output arrays for the distances and recheck flags, like
+		 * those of the Distance function.
+		 */
+		FunctionCall7Coll(&batch->fns[i],
+						  key->sk_collation,
+						  PointerGetDatum(batch->entries),
+						  Int32GetDatum(nentries),
+						  key->sk_argument,
+						  Int16GetDatum(key->sk_strategy),
+						  ObjectIdGetDatum(key->sk_subtype),
+						  PointerGetDatum(batch->entryDistances),
+						  PointerGetDatum(batch->entryRecheck));
+
+		for (j = 0; j < nentries; j++)
+		{
+			int			match = batch->entryMatch[j];
+			IndexOrderByDistance *distance = &batch->distances[match * nOrderBys + i];
+
+			distance->value = batch->entryDistances[j];
+			distance->isnull = false;
+			batch->recheckDistances[match] |= batch->entryRecheck[j];
+		}
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextReset(giststate->tempCxt);
+}
+
+/*
+ * Push an item for a matching index tuple into the search queue.  We get
+ * here for any lower index page, and also for heap tuples if doing an
+ * ordered search.
+ */
+static void
+gistPushSearchItem(IndexScanDesc scan, Page page, Buffer buffer,
+				   IndexTuple it, bool recheck, bool recheck_distances,
+				   IndexOrderByDistance *distances)
+{
+	GISTScanOpaque so = (GISTScanOpaque) scan->opaque;
+	GISTSearchItem *item;
+	int			nOrderBys = scan->numberOfOrderBys;
+	MemoryContext oldcxt;
+
+	oldcxt = MemoryContextSwitchTo(so->queueCxt);
+
+	/* Create new GISTSearchItem for this item */
+	item = palloc(SizeOfGISTSearchItem(scan->numberOfOrderBys));
+
+	if (GistPageIsLeaf(page))
+	{
+		/* Creating heap-tuple GISTSearchItem */
+		item->blkno = InvalidBlockNumber;
+		item->data.heap.heapPtr = it->t_tid;
+		item->data.heap.recheck = recheck;
+		item->data.heap.recheckDistances = recheck_distances;
+
+		/*
+		 * In an index-only scan, also fetch the data from the tuple.
+		 */
+		if (scan->xs_want_itup)
+			item->data.heap.recontup = gistFetchTuple(so->giststate,
+													  scan->indexRelation,
+													  it);
+	}
+	else
+	{
+		/* Creating index-page GISTSearchItem */
+		item->blkno = ItemPointerGetBlockNumber(&it->t_tid);
+
+		/*
+		 * LSN of current page is lsn of parent page for child. We only have
+		 * a shared lock, so we need to get the LSN atomically.
+		 */
+		item->data.parentlsn = BufferGetLSNAtomic(buffer);
+	}
+
+	/* Insert it into the queue using new distance data */
+	memcpy(item->distances, distances,
+		   sizeof(item->distances[0]) * nOrderBys);
+
+	pairingheap_add(so->queue, &item->phNode);
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
 /*
  * Scan all items on the GiST index page identified by *pageItem, and insert
  * them into the queue (or directly to output areas)
@@ -321,6 +487,12 @@ gistindex_keytest(IndexScanDesc scan,
  * index-only scan, reconstructed index tuples are returned along with the
  * TIDs.
  *
+ * If the opclasses provide batch Distance methods, an ordered indexscan first
+ * collects the matching tuples of the page, computes their distances with
+ * one call per ORDER BY key, and only then pushes them into the queue.  That
+ * saves a function call per tuple and key, and lets the opclass compute
+ * distances in a tight loop.
+ *
  * If we detect that the index page has split since we saw its downlink
  * in the parent, we push its new right sibling onto the queue so the
  * sibling will be processed next.
@@ -408,6 +580,9 @@ gistScanPage(IndexScanDesc scan, GISTSearchItem *pageItem,
 	 */
 	so->curPageLSN = BufferGetLSNAtomic(buffer);
 
+	if (so->batch)
+		so->batch->nmatches = 0;
+
 	/*
 	 * check all tuples on page
 	 */
@@ -445,7 +620,14 @@ gistScanPage(IndexScanDesc scan, GISTSearchItem *pageItem,
 		if (!match)
 			continue;
 
-		if (tbm && GistPageIsLeaf(page))
+		if (so->batch)
+		{
+			/* Remember it, to compute the distances of all matches at once */
+			so->batch->matches[so->batch->nmatches] = i;
+			so->batch->recheck[so->batch->nmatches] = recheck;
+			so->batch->nmatches++;
+		}
+		else if (tbm && GistPageIsLeaf(page))
 		{
 			/*
 			 * getbitmap scan, so just push heap tuple TIDs into the bitmap
@@ -478,53 +660,29 @@ gistScanPage(IndexScanDesc scan, GISTSearchItem *pageItem,
 		}
 		else
 		{
-			/*
-			 * Must push item into search queue.  We get here for any lower
-			 * index page, and also for heap tuples if doing an ordered
-			 * search.
-			 */
-			GISTSearchItem *item;
-			int			nOrderBys = scan->numberOfOrderBys;
-
-			oldcxt = MemoryContextSwitchTo(so->queueCxt);
-
-			/* Create new GISTSearchItem for this item */
-			item = palloc(SizeOfGISTSearchItem(scan->numberOfOrderBys));
-
-			if (GistPageIsLeaf(page))
-			{
-				/* Creating heap-tuple GISTSearchItem */
-				item->blkno = InvalidBlockNumber;
-				item->data.heap.heapPtr = it->t_tid;
-				item->data.heap.recheck = recheck;
-				item->data.heap.recheckDistances = recheck_distances;
-
-				/*
-				 * In an index-only scan, also fetch the data from the tuple.
-				 */
-				if (scan->xs_want_itup)
-					item->data.heap.recontup = gistFetchTuple(giststate, r, it);
-			}
-			else
-			{
-				/* Creating index-page GISTSearchItem */
-				item->blkno = ItemPointerGetBlockNumber(&it->t_tid);
+			/* Must push item into search queue */
+			gistPushSearchItem(scan, page, buffer, it,
+							   recheck, recheck_distances, so->distances);
+		}
+	}
 
-				/*
-				 * LSN of current page is lsn of parent page for child. We
-				 * only have a shared lock, so we need to get the LSN
-				 * atomically.
-				 */
-				item->data.parentlsn = BufferGetLSNAtomic(buffer);
-			}
+	/* In batch mode, compute the distances and push the matches now */
+	if (so->batch && so->batch->nmatches > 0)
+	{
+		GISTBatchDistanceState *batch = so->batch;
+		int			j;
 
-			/* Insert it into the queue using new distance data */
-			memcpy(item->distances, so->distances,
-				   sizeof(item->distances[0]) * nOrderBys);
+		gistComputeBatchDistances(scan, page);
 
-			pairingheap_add(so->queue, &item->phNode);
+		for (j = 0; j < batch->nmatches; j++)
+		{
+			IndexTuple	it;
 
-			MemoryContextSwitchTo(oldcxt);
+			it = (IndexTuple) PageGetItem(page,
+										  PageGetItemId(page, batch->matches[j]));
+			gistPushSearchItem(scan, page, buffer, it,
+							   batch->recheck[j], batch->recheckDistances[j],
+							   &batch->distances[j * scan->numberOfOrderBys]);
 		}
 	}
 
@@ -24,6 +24,7 @@
 #include "utils/builtins.h"
 #include "utils/float.h"
 #include "utils/geo_decls.h"
+#include "utils/sortsupport.h"
 
 
 static bool gist_box_leaf_consistent(BOX *key, BOX *query,
@@ -1460,6 +1461,34 @@ gist_point_distance(PG_FUNCTION_ARGS)
 	PG_RETURN_FLOAT8(distance);
 }
 
+/*
+ * The batch Distance method for point_ops: like gist_point_distance, but
+ * computes the distances of an array of entries in one call.
+ */
+Datum
+gist_point_batch_distance(PG_FUNCTION_ARGS)
+{
+	GISTENTRY  *entries = (GISTENTRY *) PG_GETARG_POINTER(0);
+	int32		nentries = PG_GETARG_INT32(1);
+	Point	   *query = PG_GETARG_POINT_P(2);
+	StrategyNumber strategy = (StrategyNumber) PG_GETARG_UINT16(3);
+	float8	   *distances = (float8 *) PG_GETARG_POINTER(5);
+	StrategyNumber strategyGroup = strategy / GeoStrategyNumberOffset;
+	int			i;
+
+	/* The recheck flags, argument 6, are left alone: results are exact */
+
+	if (strategyGroup != PointStrategyNumberGroup)
+		elog(ERROR, "unrecognized strategy number: %d", strategy);
+
+	for (i = 0; i < nentries; i++)
+		distances[i] = computeDistance(GIST_LEAF(&entries[i]),
+									   DatumGetBoxP(entries[i].key),
+									   query);
+
+	PG_RETURN_VOID();
+}
+
 static float8
 gist_bbox_distance(GISTENTRY *entry, Datum query, StrategyNumber strategy)
 {
@@ -1540,3 +1569,194 @@ gist_poly_distance(PG_FUNCTION_ARGS)
 
 	PG_RETURN_FLOAT8(distance);
 }
+
+/*
+ * Z-order routines for fast index build
+ */
+
+/*
+ * Interleave the bits of a 32-bit value with zeroes
+ */
+static uint64
+part_bits32_by2(uint32 x)
+{
+	uint64		n = x;
+
+	n = (n | (n << 16)) & UINT64CONST(0x0000FFFF0000FFFF);
+	n = (n | (n << 8)) & UINT64CONST(0x00FF00FF00FF00FF);
+	n = (n | (n << 4)) & UINT64CONST(0x0F0F0F0F0F0F0F0F);
+	n = (n | (n << 2)) & UINT64CONST(0x3333333333333333);
+	n = (n | (n << 1)) & UINT64CONST(0x5555555555555555);
+
+	return n;
+}
+
+/*
+ * Convert a 32-bit IEEE float to uint32 in a way that preserves the ordering
+ *
+ * Interpreted as an integer, the bit pattern of an IEEE float sorts like the
+ * float itself, except that negative values sort backwards and after the
+ * positive ones.  So we flip all the bits of negative values, and just the
+ * sign bit of positive ones, which maps negative values to 0-7FFFFFFF and
+ * positive values to 80000000-FFFFFFFF, infinities included.  All NaNs are
+ * mapped to FFFFFFFF, which no other value maps to.
+ */
+static uint32
+ieee_float32_to_uint32(float f)
+{
+	union
+	{
+		float		f;
+		uint32		i;
+	}			u;
+
+	if (isnan(f))
+		return 0xFFFFFFFF;
+
+	u.f = f;
+	if ((u.i & 0x80000000) != 0)
+		u.i ^= 0xFFFFFFFF;
+	else
+		u.i |= 0x80000000;
+
+	return u.i;
+}
+
+/*
+ * Compute the Z-value of a point
+ *
+ * Z-order (also known as Morton code) maps a two-dimensional point to a
+ * single integer by interleaving the bits of its coordinates, so that points
+ * that are close in space mostly map to integers that are close too.  It's
+ * only defined for integers, so we first map the coordinates to uint32s,
+ * which loses precision but keeps them in order.
+ */
+static uint64
+point_zorder_internal(float4 x, float4 y)
+{
+	uint32		ix = ieee_float32_to_uint32(x);
+	uint32		iy = ieee_float32_to_uint32(y);
+
+	/* Interleave the bits */
+	return part_bits32_by2(ix) | (part_bits32_by2(iy) << 1);
+}
+
+/*
+ * Z-value of the center of a bounding box.  For the boxes that point_ops
+ * stores for points, that's the point itself.
+ */
+static uint64
+gist_bbox_zorder(BOX *box)
+{
+	return point_zorder_internal((box->low.x + box->high.x) / 2.0,
+								 (box->low.y + box->high.y) / 2.0);
+}
+
+static int
+gist_bbox_zorder_cmp(Datum a, Datum b, SortSupport ssup)
+{
+	BOX		   *b1 = DatumGetBoxP(a);
+	BOX		   *b2 = DatumGetBoxP(b);
+	uint64		z1;
+	uint64		z2;
+
+	/*
+	 * Do a quick check for equality first.  That's common when this is used
+	 * as tie-breaker with abbreviated keys.
+	 */
+	if (memcmp(b1, b2, sizeof(BOX)) == 0)
+		return 0;
+
+	z1 = gist_bbox_zorder(b1);
+	z2 = gist_bbox_zorder(b2);
+	if (z1 > z2)
+		return 1;
+	else if (z1 < z2)
+		return -1;
+	else
+		return 0;
+}
+
+/*
+ * Abbreviated version of Z-order comparison
+ *
+ * The abbreviated format is a Z-order value computed from the two 32-bit
+ * floats.  If SIZEOF_DATUM == 8, the 64-bit Z-order value fits fully in the
+ * abbreviated Datum, otherwise use its most significant bits.
+ */
+static Datum
+gist_bbox_zorder_abbrev_convert(Datum original, SortSupport ssup)
+{
+	uint64		z = gist_bbox_zorder(DatumGetBoxP(original));
+
+#if SIZEOF_DATUM == 8
+	return (Datum) z;
+#else
+	return (Datum) (z >> 32);
+#endif
+}
+
+static int
+gist_bbox_zorder_cmp_abbrev(Datum z1, Datum z2, SortSupport ssup)
+{
+	/*
+	 * Compare the pre-computed Z-orders as unsigned integers.  Datum is a
+	 * typedef for 'uintptr_t', so no casting is required.
+	 */
+	if (z1 > z2)
+		return 1;
+	else if (z1 < z2)
+		return -1;
+	else
+		return 0;
+}
+
+/*
+ * We never consider aborting the abbreviation.
+ *
+ * On 64-bit systems, the abbreviation is not lossy so it is always
+ * worthwhile.  (Perhaps it's not on 32-bit systems, but we don't bother
+ * with logic to decide.)
+ */
+static bool
+gist_bbox_zorder_abbrev_abort(int memtupcount, SortSupport ssup)
+{
+	return false;
+}
+
+static void
+gist_bbox_zorder_sortsupport(SortSupport ssup)
+{
+	if (ssup->abbreviate)
+	{
+		ssup->comparator = gist_bbox_zorder_cmp_abbrev;
+		ssup->abbrev_converter = gist_bbox_zorder_abbrev_convert;
+		ssup->abbrev_abort = gist_bbox_zorder_abbrev_abort;
+		ssup->abbrev_full_comparator = gist_bbox_zorder_cmp;
+	}
+	else
+		ssup->comparator = gist_bbox_zorder_cmp;
+}
+
+/*
+ * Sort support routine for sorted GiST index build of points
+ */
+Datum
+gist_point_sortsupport(PG_FUNCTION_ARGS)
+{
+	gist_bbox_zorder_sortsupport((SortSupport) PG_GETARG_POINTER(0));
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Sort support routine for sorted GiST index build of boxes, by the
+ * Z-value of their centers
+ */
+Datum
+gist_box_sortsupport(PG_FUNCTION_ARGS)
+{
+	gist_bbox_zorder_sortsupport((SortSupport) PG_GETARG_POINTER(0));
+
+	PG_RETURN_VOID();
+}
@@ -339,6 +339,44 @@ gistrescan(IndexScanDesc scan, ScanKey key, int nkeys,
 
 		if (!first_time)
 			pfree(fn_extras);
+
+		/*
+		 * If all the ORDER BY columns have batch Distance methods, set up the
+		 * workspace for computing the distances of a whole page at once.  The
+		 * order-by keys refer to the same columns in every rescan, so this
+		 * only needs to be done once.
+		 */
+		if (first_time)
+		{
+			bool		batch = true;
+
+			for (i = 0; i < scan->numberOfOrderBys; i++)
+			{
+				ScanKey		skey = scan->orderByData + i;
+
+				if (!OidIsValid(so->giststate->batchDistanceFn[skey->sk_attno - 1].fn_oid))
+					batch = false;
+			}
+
+			if (batch)
+			{
+				oldCxt = MemoryContextSwitchTo(so->giststate->scanCxt);
+				so->batch = palloc(sizeof(GISTBatchDistanceState));
+				so->batch->fns = palloc(sizeof(FmgrInfo) * scan->numberOfOrderBys);
+				for (i = 0; i < scan->numberOfOrderBys; i++)
+				{
+					ScanKey		skey = scan->orderByData + i;
+
+					fmgr_info_copy(&so->batch->fns[i],
+								   &so->giststate->batchDistanceFn[skey->sk_attno - 1],
+								   so->giststate->scanCxt);
+				}
+				so->batch->distances =
+					palloc(sizeof(IndexOrderByDistance) *
+						   MaxIndexTuplesPerPage * scan->numberOfOrderBys);
+				MemoryContextSwitchTo(oldCxt);
+			}
+		}
 	}
 
 	/* any previous xs_hitup will have been pfree'd in context resets above */
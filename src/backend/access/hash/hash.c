@@ -38,6 +38,7 @@ typedef struct
 	HSpool	   *spool;			/* NULL if not using spooling */
 	double		indtuples;		/* # tuples accepted into index */
 	Relation	heapRel;		/* heap relation descriptor */
+	IndexInfo  *indexInfo;		/* info about the index being built */
 } HashBuildState;
 
 static void hashbuildCallback(Relation index,
@@ -63,8 +64,8 @@ hashhandler(PG_FUNCTION_ARGS)
 	amroutine->amcanorder = false;
 	amroutine->amcanorderbyop = false;
 	amroutine->amcanbackward = true;
-	amroutine->amcanunique = false;
-	amroutine->amcanmulticol = false;
+	amroutine->amcanunique = true;
+	amroutine->amcanmulticol = true;
 	amroutine->amoptionalkey = false;
 	amroutine->amsearcharray = false;
 	amroutine->amsearchnulls = false;
@@ -72,8 +73,10 @@ hashhandler(PG_FUNCTION_ARGS)
 	amroutine->amclusterable = false;
 	amroutine->ampredlocks = true;
 	amroutine->amcanparallel = false;
+	amroutine->amcanbuildparallel = false;
 	amroutine->amcaninclude = false;
 	amroutine->amusemaintenanceworkmem = false;
+	amroutine->amsummarizing = false;
 	amroutine->amparallelvacuumoptions =
 		VACUUM_OPTION_PARALLEL_BULKDEL;
 	amroutine->amkeytype = INT4OID;
@@ -81,6 +84,7 @@ hashhandler(PG_FUNCTION_ARGS)
 	amroutine->ambuild = hashbuild;
 	amroutine->ambuildempty = hashbuildempty;
 	amroutine->aminsert = hashinsert;
+	amroutine->aminsertmulti = NULL;
 	amroutine->ambulkdelete = hashbulkdelete;
 	amroutine->amvacuumcleanup = hashvacuumcleanup;
 	amroutine->amcanreturn = NULL;
@@ -149,6 +153,9 @@ hashbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	 * NOTE: this test will need adjustment if a bucket is ever different from
 	 * one page.  Also, "initial index size" accounting does not include the
 	 * metapage, nor the first bitmap page.
+	 *
+	 * A unique index is never built by sorting, because each tuple has to be
+	 * checked against the ones already in the index as it's inserted.
 	 */
 	sort_threshold = (maintenance_work_mem * 1024L) / BLCKSZ;
 	if (index->rd_rel->relpersistence != RELPERSISTENCE_TEMP)
@@ -156,7 +163,7 @@ hashbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	else
 		sort_threshold = Min(sort_threshold, NLocBuffer);
 
-	if (num_buckets >= (uint32) sort_threshold)
+	if (num_buckets >= (uint32) sort_threshold && !indexInfo->ii_Unique)
 		buildstate.spool = _h_spoolinit(heap, index, num_buckets);
 	else
 		buildstate.spool = NULL;
@@ -164,6 +171,7 @@ hashbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	/* prepare to build the index */
 	buildstate.indtuples = 0;
 	buildstate.heapRel = heap;
+	buildstate.indexInfo = indexInfo;
 
 	/* do the heap scan */
 	reltuples = table_index_build_scan(heap, index, indexInfo, true, true,
@@ -211,8 +219,8 @@ hashbuildCallback(Relation index,
 				  void *state)
 {
 	HashBuildState *buildstate = (HashBuildState *) state;
-	Datum		index_values[1];
-	bool		index_isnull[1];
+	Datum		index_values[INDEX_MAX_KEYS];
+	bool		index_isnull[INDEX_MAX_KEYS];
 	IndexTuple	itup;
 
 	/* convert data to a hash key; on failure, do not insert anything */
@@ -230,7 +238,18 @@ hashbuildCallback(Relation index,
 		itup = index_form_tuple(RelationGetDescr(index),
 								index_values, index_isnull);
 		itup->t_tid = *tid;
-		_hash_doinsert(index, itup, buildstate->heapRel);
+
+		/*
+		 * Dead tuples are put into the index too, but can't conflict with
+		 * anything.
+		 */
+		if (buildstate->indexInfo->ii_Unique && tupleIsAlive)
+			(void) _hash_doinsert_unique(index, itup, values, isnull,
+										 buildstate->heapRel,
+										 buildstate->indexInfo,
+										 UNIQUE_CHECK_YES);
+		else
+			_hash_doinsert(index, itup, buildstate->heapRel);
 		pfree(itup);
 	}
 
@@ -242,6 +261,9 @@ hashbuildCallback(Relation index,
  *
  *	Hash on the heap tuple's key, form an index tuple with hash code.
  *	Find the appropriate location for the new tuple, and put it there.
+ *
+ *	For a unique index, the result is as for btinsert: false only if
+ *	checkUnique is UNIQUE_CHECK_PARTIAL and there may be a conflict.
  */
 bool
 hashinsert(Relation rel, Datum *values, bool *isnull,
@@ -249,25 +271,33 @@ hashinsert(Relation rel, Datum *values, bool *isnull,
 		   IndexUniqueCheck checkUnique,
 		   IndexInfo *indexInfo)
 {
-	Datum		index_values[1];
-	bool		index_isnull[1];
+	Datum		index_values[INDEX_MAX_KEYS];
+	bool		index_isnull[INDEX_MAX_KEYS];
 	IndexTuple	itup;
+	bool		result = false;
 
-	/* convert data to a hash key; on failure, do not insert anything */
+	/*
+	 * convert data to a hash key; on failure, do not insert anything.  A
+	 * tuple with a null first column can't conflict with anything.
+	 */
 	if (!_hash_convert_tuple(rel,
 							 values, isnull,
 							 index_values, index_isnull))
-		return false;
+		return checkUnique != UNIQUE_CHECK_NO;
 
 	/* form an index tuple and point it at the heap tuple */
 	itup = index_form_tuple(RelationGetDescr(rel), index_values, index_isnull);
 	itup->t_tid = *ht_ctid;
 
-	_hash_doinsert(rel, itup, heapRel);
+	if (checkUnique != UNIQUE_CHECK_NO)
+		result = _hash_doinsert_unique(rel, itup, values, isnull, heapRel,
+									   indexInfo, checkUnique);
+	else
+		_hash_doinsert(rel, itup, heapRel);
 
 	pfree(itup);
 
-	return false;
+	return result;
 }
 
 
@@ -377,6 +407,9 @@ hashbeginscan(Relation rel, int nkeys, int norderbys)
 	so->hashso_buc_populated = false;
 	so->hashso_buc_split = false;
 
+	so->hashso_key_hashes = (uint32 *) palloc(Max(nkeys, 1) * sizeof(uint32));
+	so->hashso_unique_check = false;
+
 	so->killedItems = NULL;
 	so->numKilled = 0;
 
@@ -439,6 +472,7 @@ hashendscan(IndexScanDesc scan)
 
 	if (so->killedItems != NULL)
 		pfree(so->killedItems);
+	pfree(so->hashso_key_hashes);
 	pfree(so);
 	scan->opaque = NULL;
 }
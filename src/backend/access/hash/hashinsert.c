@@ -15,14 +15,31 @@
 
 #include "postgres.h"
 
+#include "access/genam.h"
 #include "access/hash.h"
 #include "access/hash_xlog.h"
+#include "access/relscan.h"
+#include "access/tableam.h"
+#include "catalog/index.h"
+#include "executor/executor.h"
 #include "miscadmin.h"
 #include "storage/buf_internals.h"
+#include "storage/lmgr.h"
 #include "storage/lwlock.h"
 #include "storage/predicate.h"
+#include "utils/lsyscache.h"
 #include "utils/rel.h"
-
+#include "utils/snapmgr.h"
+
+static TransactionId _hash_check_unique(Relation rel, IndexTuple itup,
+										Datum *values, bool *isnull,
+										Relation heapRel, IndexInfo *indexInfo,
+										IndexUniqueCheck checkUnique,
+										bool *is_unique,
+										uint32 *speculativeToken);
+static bool _hash_keys_equal(Relation rel, FmgrInfo *eqprocs,
+							 Datum *values1, bool *isnull1,
+							 Datum *values2, bool *isnull2);
 static void _hash_vacuum_one_page(Relation rel, Relation hrel,
 								  Buffer metabuf, Buffer buf);
 
@@ -253,6 +270,306 @@ restart_insert:
 	_hash_dropbuf(rel, metabuf);
 }
 
+/*
+ *	_hash_doinsert_unique() -- Insert into a unique index.
+ *
+ *		Like _hash_doinsert, but first check that no live heap tuple has the
+ *		same key values (see _hash_check_unique).  values and isnull are the
+ *		user data the index tuple was formed from.
+ *
+ *		With UNIQUE_CHECK_EXISTING, only do the check, without inserting
+ *		anything.  The result is meaningful only for UNIQUE_CHECK_PARTIAL:
+ *		false if there may be a conflict.
+ *
+ *		Two backends inserting the same key must not both miss each other's
+ *		entry, so for UNIQUE_CHECK_YES we hold a heavyweight lock on the
+ *		first column's hash code, via the tuple lock tag with the hash code
+ *		as block number, from the check until the entry is in.  The lock
+ *		can't be on the bucket: a split may move the key to another bucket,
+ *		and the insertion itself gives up the bucket's buffer lock when it
+ *		has to add an overflow page.  Later inserters of the key see our
+ *		entry, and wait for our transaction to finish.
+ */
+bool
+_hash_doinsert_unique(Relation rel, IndexTuple itup,
+					  Datum *values, bool *isnull,
+					  Relation heapRel, IndexInfo *indexInfo,
+					  IndexUniqueCheck checkUnique)
+{
+	ItemPointerData locktid;
+	bool		is_unique = true;
+
+	Assert(checkUnique != UNIQUE_CHECK_NO);
+
+	ItemPointerSet(&locktid, _hash_get_indextuple_hashkey(itup),
+				   FirstOffsetNumber);
+
+	for (;;)
+	{
+		TransactionId xwait;
+		uint32		speculativeToken = 0;
+
+		if (checkUnique == UNIQUE_CHECK_YES)
+			LockTuple(rel, &locktid, ExclusiveLock);
+
+		xwait = _hash_check_unique(rel, itup, values, isnull, heapRel,
+								   indexInfo, checkUnique, &is_unique,
+								   &speculativeToken);
+		if (!TransactionIdIsValid(xwait))
+			break;
+
+		/* Have to wait for the other guy ... */
+		if (checkUnique == UNIQUE_CHECK_YES)
+			UnlockTuple(rel, &locktid, ExclusiveLock);
+
+		/*
+		 * If it's a speculative insertion, wait for it to finish (ie. to go
+		 * ahead with the insertion, or kill the tuple).  Otherwise wait for
+		 * the transaction to finish as usual.
+		 */
+		if (speculativeToken)
+			SpeculativeInsertionWait(xwait, speculativeToken);
+		else
+			XactLockTableWait(xwait, rel, &itup->t_tid, XLTW_InsertIndex);
+
+		/* start over... */
+	}
+
+	if (checkUnique != UNIQUE_CHECK_EXISTING)
+		_hash_doinsert(rel, itup, heapRel);
+
+	if (checkUnique == UNIQUE_CHECK_YES)
+		UnlockTuple(rel, &locktid, ExclusiveLock);
+
+	return is_unique;
+}
+
+/*
+ *	_hash_check_unique() -- Check for violation of unique index constraint
+ *
+ * Hash index entries hold only hash codes, so any entry whose hash codes all
+ * equal those of the new tuple is a possible duplicate.  We find them with an
+ * index scan on the new tuple's key, and for each one fetch the heap tuple it
+ * points to (if any version of it is live according to SnapshotDirty),
+ * compute its key values, and compare them with the new ones using the
+ * equality operators of the index's opfamilies.
+ *
+ * Returns InvalidTransactionId if there is no conflict, else an xact ID we
+ * must wait for to see if it commits a conflicting tuple.  If an actual
+ * conflict is detected, no return --- just ereport().  If an xact ID is
+ * returned, and the conflicting tuple still has a speculative insertion in
+ * progress, *speculativeToken is set to non-zero, and the caller can wait for
+ * the verdict on the insertion using SpeculativeInsertionWait().
+ *
+ * However, if checkUnique == UNIQUE_CHECK_PARTIAL, we always return
+ * InvalidTransactionId because we don't want to wait.  In this case we set
+ * *is_unique to false if there is a potential conflict, and the core code
+ * must redo the uniqueness check later.
+ */
+static TransactionId
+_hash_check_unique(Relation rel, IndexTuple itup,
+				   Datum *values, bool *isnull,
+				   Relation heapRel, IndexInfo *indexInfo,
+				   IndexUniqueCheck checkUnique,
+				   bool *is_unique, uint32 *speculativeToken)
+{
+	int			nkeys = IndexRelationGetNumberOfKeyAttributes(rel);
+	ScanKeyData scankeys[INDEX_MAX_KEYS];
+	SnapshotData SnapshotDirty;
+	IndexScanDesc scan;
+	IndexFetchTableData *fetch = NULL;
+	TupleTableSlot *slot = NULL;
+	EState	   *estate = NULL;
+	FmgrInfo	eqprocs[INDEX_MAX_KEYS];
+	FmgrInfo	nofunc;
+	TransactionId xwait = InvalidTransactionId;
+	bool		conflict = false;
+	int			i;
+
+	/* Assume unique until we find a duplicate */
+	*is_unique = true;
+
+	/* A null is never equal to anything, assuming strict operators */
+	for (i = 0; i < nkeys; i++)
+	{
+		if (isnull[i])
+			return InvalidTransactionId;
+	}
+
+	/*
+	 * The scan only looks at the keys' arguments and hash codes, never at
+	 * sk_func, so don't bother looking up the equality operators yet.
+	 * ScanKeyEntryInitialize() insists on a procedure for a key that isn't
+	 * an IS NULL test, so hand it an empty FmgrInfo instead.
+	 */
+	MemSet(&nofunc, 0, sizeof(nofunc));
+	for (i = 0; i < nkeys; i++)
+		ScanKeyEntryInitializeWithInfo(&scankeys[i], 0, i + 1,
+									   HTEqualStrategyNumber,
+									   rel->rd_opcintype[i],
+									   rel->rd_indcollation[i],
+									   &nofunc,
+									   values[i]);
+
+	InitDirtySnapshot(SnapshotDirty);
+
+	scan = hashbeginscan(rel, nkeys, 0);
+	scan->heapRelation = heapRel;
+	scan->xs_snapshot = &SnapshotDirty;
+	((HashScanOpaque) scan->opaque)->hashso_unique_check = true;
+	hashrescan(scan, scankeys, nkeys, NULL, 0);
+
+	while (hashgettuple(scan, ForwardScanDirection))
+	{
+		ItemPointerData htid = scan->xs_heaptid;
+		bool		call_again = false;
+		bool		all_dead = false;
+		Datum		existing_values[INDEX_MAX_KEYS];
+		bool		existing_isnull[INDEX_MAX_KEYS];
+
+		/*
+		 * If we are doing a recheck, we expect to find the tuple we are
+		 * rechecking.  It's not a duplicate.
+		 */
+		if (checkUnique == UNIQUE_CHECK_EXISTING &&
+			ItemPointerEquals(&htid, &itup->t_tid))
+			continue;
+
+		if (fetch == NULL)
+		{
+			fetch = table_index_fetch_begin(heapRel);
+			slot = table_slot_create(heapRel, NULL);
+			estate = CreateExecutorState();
+			GetPerTupleExprContext(estate)->ecxt_scantuple = slot;
+
+			for (i = 0; i < nkeys; i++)
+			{
+				Oid			eqop;
+
+				eqop = get_opfamily_member(rel->rd_opfamily[i],
+										   rel->rd_opcintype[i],
+										   rel->rd_opcintype[i],
+										   HTEqualStrategyNumber);
+				if (!OidIsValid(eqop))
+					elog(ERROR, "missing operator %d(%u,%u) in opfamily %u",
+						 HTEqualStrategyNumber, rel->rd_opcintype[i],
+						 rel->rd_opcintype[i], rel->rd_opfamily[i]);
+				fmgr_info(get_opcode(eqop), &eqprocs[i]);
+			}
+		}
+
+		/*
+		 * Fetch the live version of the heap tuple, if any.  With heap's HOT,
+		 * there's one index entry for the whole chain, but its members all
+		 * have the same key, so the first one satisfying SnapshotDirty will
+		 * do.
+		 */
+		if (!table_index_fetch_tuple(fetch, &htid, &SnapshotDirty, slot,
+									 &call_again, &all_dead))
+			continue;
+
+		/*
+		 * The caller formed the new tuple's values with FormIndexDatum, so
+		 * any index expressions are prepared already, in a longer-lived
+		 * context than our EState.
+		 */
+		Assert(indexInfo->ii_Expressions == NIL ||
+			   indexInfo->ii_ExpressionsState != NIL);
+		ResetPerTupleExprContext(estate);
+		FormIndexDatum(indexInfo, slot, estate,
+					   existing_values, existing_isnull);
+		if (!_hash_keys_equal(rel, eqprocs, values, isnull,
+							  existing_values, existing_isnull))
+			continue;
+
+		/*
+		 * It is a duplicate. If we are only doing a partial check, then don't
+		 * bother checking if the tuple is being updated in another
+		 * transaction. Just report the fact that it is a potential conflict
+		 * and leave the full check till later.
+		 */
+		if (checkUnique == UNIQUE_CHECK_PARTIAL)
+		{
+			*is_unique = false;
+			break;
+		}
+
+		/*
+		 * If this tuple is being updated by other transaction then we have
+		 * to wait for its commit/abort.
+		 */
+		xwait = (TransactionIdIsValid(SnapshotDirty.xmin)) ?
+			SnapshotDirty.xmin : SnapshotDirty.xmax;
+		if (TransactionIdIsValid(xwait))
+		{
+			*speculativeToken = SnapshotDirty.speculativeToken;
+			break;
+		}
+
+		/*
+		 * Otherwise we have a definite conflict.  But before complaining,
+		 * look to see if the tuple we want to insert is itself now committed
+		 * dead --- if so, don't complain.  This is a waste of time in normal
+		 * scenarios but we must do it to support CREATE INDEX CONCURRENTLY.
+		 */
+		htid = itup->t_tid;
+		if (table_index_fetch_tuple_check(heapRel, &htid, SnapshotSelf, NULL))
+			conflict = true;
+		break;
+	}
+
+	hashendscan(scan);
+	IndexScanEnd(scan);
+	if (fetch != NULL)
+	{
+		table_index_fetch_end(fetch);
+		ExecDropSingleTupleTableSlot(slot);
+		FreeExecutorState(estate);
+	}
+
+	if (conflict)
+	{
+		char	   *key_desc;
+
+		key_desc = BuildIndexValueDescription(rel, values, isnull);
+
+		ereport(ERROR,
+				(errcode(ERRCODE_UNIQUE_VIOLATION),
+				 errmsg("duplicate key value violates unique constraint \"%s\"",
+						RelationGetRelationName(rel)),
+				 key_desc ? errdetail("Key %s already exists.",
+									  key_desc) : 0,
+				 errtableconstraint(heapRel,
+									RelationGetRelationName(rel))));
+	}
+
+	return xwait;
+}
+
+/*
+ * _hash_keys_equal() -- are two sets of key values equal per the index?
+ */
+static bool
+_hash_keys_equal(Relation rel, FmgrInfo *eqprocs,
+				 Datum *values1, bool *isnull1,
+				 Datum *values2, bool *isnull2)
+{
+	int			nkeys = IndexRelationGetNumberOfKeyAttributes(rel);
+	int			i;
+
+	for (i = 0; i < nkeys; i++)
+	{
+		if (isnull1[i] || isnull2[i])
+			return false;
+		if (!DatumGetBool(FunctionCall2Coll(&eqprocs[i],
+											rel->rd_indcollation[i],
+											values1[i], values2[i])))
+			return false;
+	}
+
+	return true;
+}
+
 /*
  *	_hash_pgaddtup() -- add a tuple to a particular page in the index.
  *
@@ -293,15 +293,16 @@ _hash_first(IndexScanDesc scan, ScanDirection dir)
 {
 	Relation	rel = scan->indexRelation;
 	HashScanOpaque so = (HashScanOpaque) scan->opaque;
-	ScanKey		cur;
 	uint32		hashkey;
 	Bucket		bucket;
 	Buffer		buf;
 	Page		page;
 	HashPageOpaque opaque;
 	HashScanPosItem *currItem;
+	int			i;
 
-	pgstat_count_index_scan(rel);
+	if (!so->hashso_unique_check)
+		pgstat_count_index_scan(rel);
 
 	/*
 	 * We do not support hash scans with no index qualification, because we
@@ -314,24 +315,21 @@ _hash_first(IndexScanDesc scan, ScanDirection dir)
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("hash indexes do not support whole-index scans")));
 
-	/* There may be more than one index qual, but we hash only the first */
-	cur = &scan->keyData[0];
-
-	/* We support only single-column hash indexes */
-	Assert(cur->sk_attno == 1);
-	/* And there's only one operator strategy, too */
-	Assert(cur->sk_strategy == HTEqualStrategyNumber);
-
 	/*
-	 * If the constant in the index qual is NULL, assume it cannot match any
-	 * items in the index.
+	 * There may be more than one index qual, but we hash only the first to
+	 * find the bucket.  The planner puts a qual on the first column first,
+	 * and requires there to be one.
 	 */
-	if (cur->sk_flags & SK_ISNULL)
-		return false;
+	Assert(scan->keyData[0].sk_attno == 1);
 
 	/*
-	 * Okay to compute the hash key.  We want to do this before acquiring any
-	 * locks, in case a user-defined hash function happens to be slow.
+	 * Compute the hash codes of all the scan keys, which _hash_checkqual
+	 * compares with those in the index entries.  We want to do this before
+	 * acquiring any locks, in case a user-defined hash function happens to be
+	 * slow.
+	 *
+	 * If the constant in an index qual is NULL, assume it cannot match any
+	 * items in the index.
 	 *
 	 * If scankey operator is not a cross-type comparison, we can use the
 	 * cached hash function; otherwise gotta look it up in the catalogs.
@@ -339,13 +337,28 @@ _hash_first(IndexScanDesc scan, ScanDirection dir)
 	 * We support the convention that sk_subtype == InvalidOid means the
 	 * opclass input type; this is a hack to simplify life for ScanKeyInit().
 	 */
-	if (cur->sk_subtype == rel->rd_opcintype[0] ||
-		cur->sk_subtype == InvalidOid)
-		hashkey = _hash_datum2hashkey(rel, cur->sk_argument);
-	else
-		hashkey = _hash_datum2hashkey_type(rel, cur->sk_argument,
-										   cur->sk_subtype);
+	for (i = 0; i < scan->numberOfKeys; i++)
+	{
+		ScanKey		key = &scan->keyData[i];
+		AttrNumber	attno = key->sk_attno;
 
+		/* There's only one operator strategy */
+		Assert(key->sk_strategy == HTEqualStrategyNumber);
+
+		if (key->sk_flags & SK_ISNULL)
+			return false;
+
+		if (key->sk_subtype == rel->rd_opcintype[attno - 1] ||
+			key->sk_subtype == InvalidOid)
+			so->hashso_key_hashes[i] = _hash_datum2hashkey(rel, attno,
+														   key->sk_argument);
+		else
+			so->hashso_key_hashes[i] = _hash_datum2hashkey_type(rel, attno,
+																key->sk_argument,
+																key->sk_subtype);
+	}
+
+	hashkey = so->hashso_key_hashes[0];
 	so->hashso_sk_hash = hashkey;
 
 	buf = _hash_getbucketbuf_from_hashkey(rel, hashkey, HASH_READ, NULL);
@@ -639,12 +652,19 @@ _hash_load_qualified_items(IndexScanDesc scan, Page page,
 				continue;
 			}
 
-			if (so->hashso_sk_hash == _hash_get_indextuple_hashkey(itup) &&
-				_hash_checkqual(scan, itup))
+			if (so->hashso_sk_hash == _hash_get_indextuple_hashkey(itup))
 			{
-				/* tuple is qualified, so remember it */
-				_hash_saveitem(so, itemIndex, offnum, itup);
-				itemIndex++;
+				/*
+				 * The entries are ordered by the first column's hash code
+				 * only, so one failing the other columns' doesn't end the
+				 * run.
+				 */
+				if (_hash_checkqual(scan, itup))
+				{
+					/* tuple is qualified, so remember it */
+					_hash_saveitem(so, itemIndex, offnum, itup);
+					itemIndex++;
+				}
 			}
 			else
 			{
@@ -685,12 +705,15 @@ _hash_load_qualified_items(IndexScanDesc scan, Page page,
 				continue;
 			}
 
-			if (so->hashso_sk_hash == _hash_get_indextuple_hashkey(itup) &&
-				_hash_checkqual(scan, itup))
+			if (so->hashso_sk_hash == _hash_get_indextuple_hashkey(itup))
 			{
-				itemIndex--;
-				/* tuple is qualified, so remember it */
-				_hash_saveitem(so, itemIndex, offnum, itup);
+				/* see above */
+				if (_hash_checkqual(scan, itup))
+				{
+					itemIndex--;
+					/* tuple is qualified, so remember it */
+					_hash_saveitem(so, itemIndex, offnum, itup);
+				}
 			}
 			else
 			{
@@ -27,48 +27,36 @@
 
 /*
  * _hash_checkqual -- does the index tuple satisfy the scan conditions?
+ *
+ * We can't check the scan conditions proper, since we do not have the
+ * original index entry values to supply to the sk_func; we expect that
+ * hashgettuple already set the recheck flag to make the main indexscan code
+ * do it.  But the entry has the hash code of each column's value, so we can
+ * reject entries whose hash codes differ from those of the scan keys, which
+ * _hash_first computed.
  */
 bool
 _hash_checkqual(IndexScanDesc scan, IndexTuple itup)
 {
-	/*
-	 * Currently, we can't check any of the scan conditions since we do not
-	 * have the original index entry value to supply to the sk_func. Always
-	 * return true; we expect that hashgettuple already set the recheck flag
-	 * to make the main indexscan code do it.
-	 */
-#ifdef NOT_USED
+	HashScanOpaque so = (HashScanOpaque) scan->opaque;
 	TupleDesc	tupdesc = RelationGetDescr(scan->indexRelation);
 	ScanKey		key = scan->keyData;
-	int			scanKeySize = scan->numberOfKeys;
+	int			i;
 
-	while (scanKeySize > 0)
+	for (i = 0; i < scan->numberOfKeys; i++, key++)
 	{
 		Datum		datum;
 		bool		isNull;
-		Datum		test;
 
-		datum = index_getattr(itup,
-							  key->sk_attno,
-							  tupdesc,
-							  &isNull);
+		datum = index_getattr(itup, key->sk_attno, tupdesc, &isNull);
 
 		/* assume sk_func is strict */
 		if (isNull)
 			return false;
-		if (key->sk_flags & SK_ISNULL)
-			return false;
 
-		test = FunctionCall2Coll(&key->sk_func, key->sk_collation,
-								 datum, key->sk_argument);
-
-		if (!DatumGetBool(test))
+		if (DatumGetUInt32(datum) != so->hashso_key_hashes[i])
 			return false;
-
-		key++;
-		scanKeySize--;
 	}
-#endif
 
 	return true;
 }
@@ -76,37 +64,37 @@ _hash_checkqual(IndexScanDesc scan, IndexTuple itup)
 /*
  * _hash_datum2hashkey -- given a Datum, call the index's hash function
  *
- * The Datum is assumed to be of the index's column type, so we can use the
- * "primary" hash function that's tracked for us by the generic index code.
+ * The Datum is assumed to be of the type of index column attno, so we can
+ * use the "primary" hash function that's tracked for us by the generic index
+ * code.
  */
 uint32
-_hash_datum2hashkey(Relation rel, Datum key)
+_hash_datum2hashkey(Relation rel, AttrNumber attno, Datum key)
 {
 	FmgrInfo   *procinfo;
 	Oid			collation;
 
-	/* XXX assumes index has only one attribute */
-	procinfo = index_getprocinfo(rel, 1, HASHSTANDARD_PROC);
-	collation = rel->rd_indcollation[0];
+	procinfo = index_getprocinfo(rel, attno, HASHSTANDARD_PROC);
+	collation = rel->rd_indcollation[attno - 1];
 
 	return DatumGetUInt32(FunctionCall1Coll(procinfo, collation, key));
 }
 
 /*
  * _hash_datum2hashkey_type -- given a Datum of a specified type,
- *			hash it in a fashion compatible with this index
+ *			hash it in a fashion compatible with index column attno
  *
  * This is much more expensive than _hash_datum2hashkey, so use it only in
  * cross-type situations.
  */
 uint32
-_hash_datum2hashkey_type(Relation rel, Datum key, Oid keytype)
+_hash_datum2hashkey_type(Relation rel, AttrNumber attno, Datum key,
+						 Oid keytype)
 {
 	RegProcedure hash_proc;
 	Oid			collation;
 
-	/* XXX assumes index has only one attribute */
-	hash_proc = get_opfamily_proc(rel->rd_opfamily[0],
+	hash_proc = get_opfamily_proc(rel->rd_opfamily[attno - 1],
 								  keytype,
 								  keytype,
 								  HASHSTANDARD_PROC);
@@ -114,7 +102,7 @@ _hash_datum2hashkey_type(Relation rel, Datum key, Oid keytype)
 		elog(ERROR, "missing support function %d(%u,%u) for index \"%s\"",
 			 HASHSTANDARD_PROC, keytype, keytype,
 			 RelationGetRelationName(rel));
-	collation = rel->rd_indcollation[0];
+	collation = rel->rd_indcollation[attno - 1];
 
 	return DatumGetUInt32(OidFunctionCall1Coll(hash_proc, collation, key));
 }
@@ -302,36 +290,52 @@ _hash_get_indextuple_hashkey(IndexTuple itup)
 }
 
 /*
- * _hash_convert_tuple - convert raw index data to hash key
+ * _hash_convert_tuple - convert raw index data to hash keys
  *
  * Inputs: values and isnull arrays for the user data column(s)
  * Outputs: values and isnull arrays for the index tuple, suitable for
  *		passing to index_form_tuple().
  *
- * Returns true if successful, false if not (because there are null values).
- * On a false result, the given data need not be indexed.
+ * Each index column holds the hash code of the corresponding user column.
+ * The first column's hash code is the one that determines the bucket, and
+ * that entries are sorted by within a page; the others only serve to filter
+ * out entries in _hash_checkqual and in uniqueness checks.
  *
- * Note: callers know that the index-column arrays are always of length 1.
- * In principle, there could be more than one input column, though we do not
- * currently support that.
+ * Returns true if successful, false if not (because the first column is
+ * null).  On a false result, the given data need not be indexed.
  */
 bool
 _hash_convert_tuple(Relation index,
 					Datum *user_values, bool *user_isnull,
 					Datum *index_values, bool *index_isnull)
 {
-	uint32		hashkey;
+	int			nkeys = IndexRelationGetNumberOfKeyAttributes(index);
+	int			i;
 
 	/*
-	 * We do not insert null values into hash indexes.  This is okay because
-	 * the only supported search operator is '=', and we assume it is strict.
+	 * We do not insert entries with a null first column into hash indexes.
+	 * This is okay because the only supported search operator is '=', we
+	 * assume it is strict, and every scan must constrain the first column.
+	 * Nulls in the other columns have to be indexed, though, as scans need
+	 * not constrain those.
 	 */
 	if (user_isnull[0])
 		return false;
 
-	hashkey = _hash_datum2hashkey(index, user_values[0]);
-	index_values[0] = UInt32GetDatum(hashkey);
-	index_isnull[0] = false;
+	for (i = 0; i < nkeys; i++)
+	{
+		if (user_isnull[i])
+		{
+			index_values[i] = (Datum) 0;
+			index_isnull[i] = true;
+		}
+		else
+		{
+			index_values[i] = UInt32GetDatum(_hash_datum2hashkey(index, i + 1,
+																 user_values[i]));
+			index_isnull[i] = false;
+		}
+	}
 	return true;
 }
 
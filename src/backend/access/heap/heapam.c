@@ -60,6 +60,7 @@
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
 #include "storage/procarray.h"
+#include "storage/readahead.h"
 #include "storage/smgr.h"
 #include "storage/spin.h"
 #include "storage/standby.h"
@@ -73,6 +74,8 @@
 
 static HeapTuple heap_prepare_insert(Relation relation, HeapTuple tup,
 									 TransactionId xid, CommandId cid, int options);
+static bool heap_use_bulk_write(Relation relation, int options,
+								BulkInsertState bistate);
 static XLogRecPtr log_heap_update(Relation reln, Buffer oldbuf,
 								  Buffer newbuf, HeapTuple oldtup,
 								  HeapTuple newtup, HeapTuple old_key_tuple,
@@ -342,6 +345,81 @@ heap_setscanlimits(TableScanDesc sscan, BlockNumber startBlk, BlockNumber numBlk
 	scan->rs_numblocks = numBlks;
 }
 
+/*
+ * heap_readahead_next - ReadAheadCallback for seqscans
+ *
+ * Predicts the blocks of a forward scan, wrapping around at the end of the
+ * relation like heapgettup does.
+ */
+static BlockNumber
+heap_readahead_next(void *callback_arg)
+{
+	HeapScanDesc scan = (HeapScanDesc) callback_arg;
+	BlockNumber blkno;
+
+	if (scan->rs_ra_remaining == 0)
+		return InvalidBlockNumber;
+
+	blkno = scan->rs_ra_next;
+	scan->rs_ra_next = (blkno + 1 < scan->rs_nblocks) ? blkno + 1 : 0;
+	scan->rs_ra_remaining--;
+
+	return blkno;
+}
+
+/*
+ * heap_release_batch - unpin the pages of the current batch not handed out
+ */
+static void
+heap_release_batch(HeapScanDesc scan)
+{
+	while (scan->rs_batch_next < scan->rs_nbatch)
+		ReleaseBuffer(scan->rs_batch[scan->rs_batch_next++]);
+	scan->rs_nbatch = 0;
+	scan->rs_batch_next = 0;
+}
+
+/*
+ * heap_batch_getpage - read a seqscan page through the scan's batch
+ *
+ * Forward scans read up to rs_batch_max pages at a time with ReadBuffers, so
+ * that runs of pages not in shared buffers yet take one read each.  The
+ * pages after the requested one stay pinned until the scan gets to them.  A
+ * request for any other page drops the rest of the batch, and a new batch is
+ * only started at the beginning of a scan or on a step forward, so that a
+ * backward scan still reads a single page at a time.  A batch never extends
+ * past the end of the relation or of the scan.
+ */
+static Buffer
+heap_batch_getpage(HeapScanDesc scan, BlockNumber page)
+{
+	int			nblocks;
+
+	if (scan->rs_batch_next < scan->rs_nbatch &&
+		scan->rs_batch_start + scan->rs_batch_next == page)
+		return scan->rs_batch[scan->rs_batch_next++];
+
+	heap_release_batch(scan);
+
+	if (scan->rs_inited && page != (scan->rs_cblock + 1) % scan->rs_nblocks)
+		return ReadBufferExtended(scan->rs_base.rs_rd, MAIN_FORKNUM, page,
+								  RBM_NORMAL, scan->rs_strategy);
+
+	nblocks = Min(scan->rs_batch_max, scan->rs_nblocks - page);
+	if (page < scan->rs_startblock)
+		nblocks = Min(nblocks, scan->rs_startblock - page);
+	if (BlockNumberIsValid(scan->rs_numblocks))
+		nblocks = Min(nblocks, scan->rs_numblocks);
+
+	ReadBuffers(scan->rs_base.rs_rd, MAIN_FORKNUM, page, nblocks,
+				scan->rs_batch, scan->rs_strategy);
+	scan->rs_batch_start = page;
+	scan->rs_nbatch = nblocks;
+	scan->rs_batch_next = 1;
+
+	return scan->rs_batch[0];
+}
+
 /*
  * heapgetpage - subroutine for heapgettup()
  *
@@ -378,9 +456,36 @@ heapgetpage(TableScanDesc sscan, BlockNumber page)
 	 */
 	CHECK_FOR_INTERRUPTS();
 
+	/*
+	 * Keep prefetches going ahead of the scan, if enabled.  The predictions
+	 * start over with the first page of the scan, and are only made for
+	 * forward scans; backward scans just don't match any of them.
+	 */
+	if (scan->rs_readahead)
+	{
+		if (!scan->rs_inited)
+		{
+			ReadAheadReset(scan->rs_readahead);
+			if (page == scan->rs_startblock)
+			{
+				scan->rs_ra_next = page;
+				scan->rs_ra_remaining =
+					BlockNumberIsValid(scan->rs_numblocks) ?
+					scan->rs_numblocks : scan->rs_nblocks;
+			}
+			else
+				scan->rs_ra_remaining = 0;
+		}
+		ReadAheadAdvance(scan->rs_readahead, page);
+	}
+
 	/* read page using selected strategy */
-	scan->rs_cbuf = ReadBufferExtended(scan->rs_base.rs_rd, MAIN_FORKNUM, page,
-									   RBM_NORMAL, scan->rs_strategy);
+	if (scan->rs_batch)
+		scan->rs_cbuf = heap_batch_getpage(scan, page);
+	else
+		scan->rs_cbuf = ReadBufferExtended(scan->rs_base.rs_rd, MAIN_FORKNUM,
+										   page, RBM_NORMAL,
+										   scan->rs_strategy);
 	scan->rs_cblock = page;
 
 	if (!(scan->rs_base.rs_flags & SO_ALLOW_PAGEMODE))
@@ -1168,6 +1273,45 @@ heap_beginscan(Relation relation, Snapshot snapshot,
 		palloc(sizeof(ParallelBlockTableScanWorkerData));
 	scan->rs_strategy = NULL;	/* set in initscan */
 
+	/*
+	 * Prefetch ahead of non-parallel seqscans.  Parallel workers are handed
+	 * blocks one chunk at a time, so their blocks can't be predicted here.
+	 * Catalogs are skipped: they are small, and looking up the tablespace's
+	 * io_concurrency may itself need a seqscan of pg_tablespace (e.g. in
+	 * bootstrap mode, where system indexes are ignored), which would recurse.
+	 */
+	scan->rs_readahead = NULL;
+	if ((flags & SO_TYPE_SEQSCAN) && parallel_scan == NULL &&
+		!IsCatalogRelation(relation))
+	{
+		int			io_concurrency;
+
+		io_concurrency =
+			get_tablespace_io_concurrency(relation->rd_rel->reltablespace);
+		if (io_concurrency > 0)
+			scan->rs_readahead = ReadAheadBegin(relation, MAIN_FORKNUM,
+												io_concurrency,
+												heap_readahead_next,
+												scan);
+	}
+
+	/*
+	 * Non-parallel seqscans of shared-buffer relations also read several
+	 * pages at a time.  Each batch stays pinned until the scan has moved past
+	 * it, so don't make it so large that a few scans could pin a noticeable
+	 * part of a small buffer pool.
+	 */
+	scan->rs_batch = NULL;
+	scan->rs_nbatch = 0;
+	scan->rs_batch_next = 0;
+	if ((flags & SO_TYPE_SEQSCAN) && parallel_scan == NULL &&
+		!RelationUsesLocalBuffers(relation))
+	{
+		scan->rs_batch_max = Min(MAX_BUFFERS_PER_READ, NBuffers / MaxBackends);
+		if (scan->rs_batch_max > 1)
+			scan->rs_batch = palloc(sizeof(Buffer) * scan->rs_batch_max);
+	}
+
 	/*
 	 * Disable page-at-a-time mode if it's not a MVCC-safe snapshot.
 	 */
@@ -1245,6 +1389,8 @@ heap_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
 	 */
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
+	if (scan->rs_batch)
+		heap_release_batch(scan);
 
 	/*
 	 * reinitialize scan descriptor
@@ -1264,6 +1410,11 @@ heap_endscan(TableScanDesc sscan)
 	 */
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
+	if (scan->rs_batch)
+	{
+		heap_release_batch(scan);
+		pfree(scan->rs_batch);
+	}
 
 	/*
 	 * decrement relation reference count and free scan descriptor storage
@@ -1276,6 +1427,9 @@ heap_endscan(TableScanDesc sscan)
 	if (scan->rs_strategy != NULL)
 		FreeAccessStrategy(scan->rs_strategy);
 
+	if (scan->rs_readahead != NULL)
+		ReadAheadEnd(scan->rs_readahead);
+
 	if (scan->rs_base.rs_flags & SO_TEMP_SNAPSHOT)
 		UnregisterSnapshot(scan->rs_base.rs_snapshot);
 
@@ -1335,6 +1489,7 @@ bool
 heap_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableSlot *slot)
 {
 	HeapScanDesc scan = (HeapScanDesc) sscan;
+	BufferHeapTupleTableSlot *bslot = (BufferHeapTupleTableSlot *) slot;
 
 	/* Note: no locking manipulations needed */
 
@@ -1356,7 +1511,15 @@ heap_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableSlot *s
 
 	pgstat_count_heap_getnext(scan->rs_base.rs_rd);
 
-	ExecStoreBufferHeapTuple(&scan->rs_ctup, slot,
+	/*
+	 * Store a copy of the tuple header in the slot's own workspace rather
+	 * than pointing the slot at rs_ctup, so that the slot's contents stay
+	 * valid while we fetch further tuples into other slots (see
+	 * execBatch.c).
+	 */
+	Assert(TTS_IS_BUFFERTUPLE(slot));
+	bslot->base.tupdata = scan->rs_ctup;
+	ExecStoreBufferHeapTuple(&bslot->base.tupdata, slot,
 							 scan->rs_cbuf);
 	return true;
 }
@@ -1810,6 +1973,10 @@ GetBulkInsertState(void)
 	bistate = (BulkInsertState) palloc(sizeof(BulkInsertStateData));
 	bistate->strategy = GetAccessStrategy(BAS_BULKWRITE);
 	bistate->current_buf = InvalidBuffer;
+	bistate->bulk_rel = NULL;
+	bistate->bulk_nextblk = InvalidBlockNumber;
+	bistate->bulk_npages = 0;
+	bistate->bulk_pages = NULL;
 	return bistate;
 }
 
@@ -1821,6 +1988,28 @@ FreeBulkInsertState(BulkInsertState bistate)
 {
 	if (bistate->current_buf != InvalidBuffer)
 		ReleaseBuffer(bistate->current_buf);
+
+	/*
+	 * Write out any pages still pending from HEAP_INSERT_BULK_WRITE.  Those
+	 * pages never went through shared buffers, so a checkpoint that started
+	 * after they were WAL-logged won't have flushed them; sync the relation
+	 * ourselves, as index builds do.  Without WAL, the relation is synced at
+	 * commit anyway.
+	 */
+	if (bistate->bulk_rel != NULL)
+	{
+		Relation	relation = bistate->bulk_rel;
+
+		RelationFlushBulkPages(bistate);
+		if (RelationNeedsWAL(relation))
+		{
+			RelationOpenSmgr(relation);
+			smgrimmedsync(relation->rd_smgr, MAIN_FORKNUM);
+		}
+	}
+	if (bistate->bulk_pages != NULL)
+		pfree(bistate->bulk_pages);
+
 	FreeAccessStrategy(bistate->strategy);
 	pfree(bistate);
 }
@@ -1873,6 +2062,26 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 	 */
 	heaptup = heap_prepare_insert(relation, tup, xid, cid, options);
 
+	/*
+	 * With HEAP_INSERT_BULK_WRITE, the tuple goes onto a private page that's
+	 * written out later, without any WAL record of its own.
+	 */
+	if (heap_use_bulk_write(relation, options, bistate))
+	{
+		CheckForSerializableConflictIn(relation, NULL, InvalidBlockNumber);
+
+		RelationPutHeapTupleBulk(relation, bistate, heaptup);
+
+		pgstat_count_heap_insert(relation, 1);
+
+		if (heaptup != tup)
+		{
+			tup->t_self = heaptup->t_self;
+			heap_freetuple(heaptup);
+		}
+		return;
+	}
+
 	/*
 	 * Find buffer to insert this tuple into.  If the page is all visible,
 	 * this will also pin the requisite visibility map page.
@@ -2033,6 +2242,33 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 	}
 }
 
+/*
+ * Subroutine for heap_insert() and heap_multi_insert().  Decides whether the
+ * HEAP_INSERT_BULK_WRITE path can be taken.
+ *
+ * The private pages are written out at the end of the relation without any
+ * locking, and the tuples on them are invisible to anyone reading through
+ * shared buffers until they are, so this is only safe for a relfilenode
+ * created in the current transaction.  Logical decoding needs the regular
+ * per-tuple WAL records, and frozen loads are left to the regular path so
+ * that they get their visibility map bits set.
+ */
+static bool
+heap_use_bulk_write(Relation relation, int options, BulkInsertState bistate)
+{
+	if (!(options & HEAP_INSERT_BULK_WRITE) || bistate == NULL)
+		return false;
+	if (options & (HEAP_INSERT_FROZEN | HEAP_INSERT_SPECULATIVE))
+		return false;
+	if (relation->rd_createSubid == InvalidSubTransactionId &&
+		relation->rd_firstRelfilenodeSubid == InvalidSubTransactionId)
+		return false;
+	if (RelationIsLogicallyLogged(relation) ||
+		RelationIsAccessibleInLogicalDecoding(relation))
+		return false;
+	return true;
+}
+
 /*
  * Subroutine for heap_insert(). Prepares a tuple for insertion. This sets the
  * tuple header fields and toasts the tuple if necessary.  Returns a toasted
@@ -2050,8 +2286,11 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
 	 * relation extension or GIN page locks will not conflict between members
 	 * of a lock group, but we don't prohibit that case here because there are
 	 * useful special cases that we can safely allow, such as CREATE TABLE AS.
+	 * Relation extension and page locks do conflict within a lock group
+	 * nowadays, so a worker may insert when the caller has vouched that it
+	 * is otherwise safe, as parallel COPY FROM does.
 	 */
-	if (IsParallelWorker())
+	if (IsParallelWorker() && !(options & HEAP_INSERT_PARALLEL))
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
 				 errmsg("cannot insert tuples in a parallel worker")));
@@ -2156,11 +2395,21 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 	CheckForSerializableConflictIn(relation, NULL, InvalidBlockNumber);
 
 	ndone = 0;
+
+	/* See heap_insert() */
+	if (heap_use_bulk_write(relation, options, bistate))
+	{
+		for (i = 0; i < ntuples; i++)
+			RelationPutHeapTupleBulk(relation, bistate, heaptuples[i]);
+		ndone = ntuples;
+	}
+
 	while (ndone < ntuples)
 	{
 		Buffer		buffer;
 		Buffer		vmbuffer = InvalidBuffer;
 		bool		all_visible_cleared = false;
+		bool		all_frozen_set = false;
 		int			nthispage;
 
 		CHECK_FOR_INTERRUPTS();
@@ -2168,12 +2417,24 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 		/*
 		 * Find buffer where at least the next tuple will fit.  If the page is
 		 * all-visible, this will also pin the requisite visibility map page.
+		 * So it will for an empty page with HEAP_INSERT_FROZEN; see below.
 		 */
 		buffer = RelationGetBufferForTuple(relation, heaptuples[ndone]->t_len,
 										   InvalidBuffer, options, bistate,
 										   &vmbuffer, NULL);
 		page = BufferGetPage(buffer);
 
+		/*
+		 * If we're filling a page that was empty with frozen tuples, it will
+		 * be both all-visible and all-frozen once we're done, so we can mark
+		 * it as such right away instead of leaving that to the next VACUUM,
+		 * which would otherwise have to dirty and WAL-log every page loaded
+		 * by COPY FREEZE once more.
+		 */
+		if ((options & HEAP_INSERT_FROZEN) &&
+			PageGetMaxOffsetNumber(page) == 0)
+			all_frozen_set = true;
+
 		/* NO EREPORT(ERROR) from here till changes are logged */
 		START_CRIT_SECTION();
 
@@ -2207,7 +2468,14 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 				log_heap_new_cid(relation, heaptup);
 		}
 
-		if (PageIsAllVisible(page))
+		/*
+		 * Adding more frozen tuples to a page we already marked that way
+		 * earlier keeps it all-visible and all-frozen, since the table can
+		 * only contain our own tuples when HEAP_INSERT_FROZEN is allowed.
+		 */
+		if (all_frozen_set)
+			PageSetAllVisible(page);
+		else if (PageIsAllVisible(page) && !(options & HEAP_INSERT_FROZEN))
 		{
 			all_visible_cleared = true;
 			PageClearAllVisible(page);
@@ -2257,7 +2525,11 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 			/* the rest of the scratch space is used for tuple data */
 			tupledata = scratchptr;
 
-			xlrec->flags = all_visible_cleared ? XLH_INSERT_ALL_VISIBLE_CLEARED : 0;
+			xlrec->flags = 0;
+			if (all_visible_cleared)
+				xlrec->flags |= XLH_INSERT_ALL_VISIBLE_CLEARED;
+			if (all_frozen_set)
+				xlrec->flags |= XLH_INSERT_ALL_FROZEN_SET;
 			xlrec->ntuples = nthispage;
 
 			/*
@@ -2331,6 +2603,22 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 
 		END_CRIT_SECTION();
 
+		/*
+		 * Now set the visibility map bits to match.  This emits a record of
+		 * its own, as VACUUM would, but only once per page.  InvalidXid as
+		 * the cutoff is fine: the tuples were frozen from the start, which
+		 * is only allowed when nobody else can see the table yet.
+		 */
+		if (all_frozen_set)
+		{
+			Assert(PageIsAllVisible(page));
+			Assert(visibilitymap_pin_ok(BufferGetBlockNumber(buffer), vmbuffer));
+			visibilitymap_set(relation, BufferGetBlockNumber(buffer), buffer,
+							  InvalidXLogRecPtr, vmbuffer,
+							  InvalidTransactionId,
+							  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
+		}
+
 		UnlockReleaseBuffer(buffer);
 		if (vmbuffer != InvalidBuffer)
 			ReleaseBuffer(vmbuffer);
@@ -2884,7 +3172,9 @@ simple_heap_delete(Relation relation, ItemPointer tid)
  *	heap_update - replace a tuple
  *
  * See table_tuple_update() for an explanation of the parameters, except that
- * this routine directly takes a tuple rather than a slot.
+ * this routine directly takes a tuple rather than a slot.  A HOT update is
+ * still possible when only columns of summarizing indexes were modified;
+ * *update_indexes tells the caller to insert into those indexes then.
  *
  * In the failure cases, the routine fills *tmfd with the tuple's t_ctid,
  * t_xmax (resolving a possible MultiXact, if necessary), and t_cmax (the last
@@ -2894,11 +3184,13 @@ simple_heap_delete(Relation relation, ItemPointer tid)
 TM_Result
 heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 			CommandId cid, Snapshot crosscheck, bool wait,
-			TM_FailureData *tmfd, LockTupleMode *lockmode)
+			TM_FailureData *tmfd, LockTupleMode *lockmode,
+			TU_UpdateIndexes *update_indexes)
 {
 	TM_Result	result;
 	TransactionId xid = GetCurrentTransactionId();
 	Bitmapset  *hot_attrs;
+	Bitmapset  *sum_attrs;
 	Bitmapset  *key_attrs;
 	Bitmapset  *id_attrs;
 	Bitmapset  *interesting_attrs;
@@ -2921,6 +3213,7 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	bool		have_tuple_lock = false;
 	bool		iscombo;
 	bool		use_hot_update = false;
+	bool		summarized_update = false;
 	bool		hot_attrs_checked = false;
 	bool		key_intact;
 	bool		all_visible_cleared = false;
@@ -2959,10 +3252,17 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	 * We also need columns used by the replica identity and columns that are
 	 * considered the "key" of rows in the table.
 	 *
+	 * Columns of summarizing indexes, like BRIN, don't prevent a HOT update,
+	 * but if any of them changes we must still tell the caller to insert
+	 * into those indexes, so that their summaries cover the new value.
+	 *
 	 * Note that we get copies of each bitmap, so we need not worry about
 	 * relcache flush happening midway through.
 	 */
-	hot_attrs = RelationGetIndexAttrBitmap(relation, INDEX_ATTR_BITMAP_ALL);
+	hot_attrs = RelationGetIndexAttrBitmap(relation,
+										   INDEX_ATTR_BITMAP_HOT_BLOCKING);
+	sum_attrs = RelationGetIndexAttrBitmap(relation,
+										   INDEX_ATTR_BITMAP_SUMMARIZED);
 	key_attrs = RelationGetIndexAttrBitmap(relation, INDEX_ATTR_BITMAP_KEY);
 	id_attrs = RelationGetIndexAttrBitmap(relation,
 										  INDEX_ATTR_BITMAP_IDENTITY_KEY);
@@ -2987,6 +3287,7 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	if (!PageIsFull(page))
 	{
 		interesting_attrs = bms_add_members(interesting_attrs, hot_attrs);
+		interesting_attrs = bms_add_members(interesting_attrs, sum_attrs);
 		hot_attrs_checked = true;
 	}
 	interesting_attrs = bms_add_members(interesting_attrs, key_attrs);
@@ -3288,6 +3589,7 @@ l2:
 		if (vmbuffer != InvalidBuffer)
 			ReleaseBuffer(vmbuffer);
 		bms_free(hot_attrs);
+		bms_free(sum_attrs);
 		bms_free(key_attrs);
 		bms_free(id_attrs);
 		bms_free(modified_attrs);
@@ -3599,7 +3901,16 @@ l2:
 		 * for index columns, and also can't do a HOT update.
 		 */
 		if (hot_attrs_checked && !bms_overlap(modified_attrs, hot_attrs))
+		{
 			use_hot_update = true;
+
+			/*
+			 * The summarizing indexes still need to hear about the new
+			 * value, or e.g. a BRIN minmax summary would not cover it.
+			 */
+			if (bms_overlap(modified_attrs, sum_attrs))
+				summarized_update = true;
+		}
 	}
 	else
 	{
@@ -3747,6 +4058,13 @@ l2:
 
 	pgstat_count_heap_update(relation, use_hot_update);
 
+	if (!use_hot_update)
+		*update_indexes = TU_All;
+	else if (summarized_update)
+		*update_indexes = TU_Summarizing;
+	else
+		*update_indexes = TU_None;
+
 	/*
 	 * If heaptup is a private copy, release it.  Don't forget to copy t_self
 	 * back to the caller's image, too.
@@ -3761,6 +4079,7 @@ l2:
 		heap_freetuple(old_key_tuple);
 
 	bms_free(hot_attrs);
+	bms_free(sum_attrs);
 	bms_free(key_attrs);
 	bms_free(id_attrs);
 	bms_free(modified_attrs);
@@ -3889,11 +4208,17 @@ simple_heap_update(Relation relation, ItemPointer otid, HeapTuple tup)
 	TM_Result	result;
 	TM_FailureData tmfd;
 	LockTupleMode lockmode;
+	TU_UpdateIndexes update_indexes;
 
+	/*
+	 * This is only used for system catalogs, which don't have summarizing
+	 * indexes, so callers can keep checking HeapTupleIsHeapOnly().
+	 */
 	result = heap_update(relation, otid, tup,
 						 GetCurrentCommandId(true), InvalidSnapshot,
 						 true /* wait for commit */ ,
-						 &tmfd, &lockmode);
+						 &tmfd, &lockmode, &update_indexes);
+	Assert(update_indexes != TU_Summarizing);
 	switch (result)
 	{
 		case TM_SelfModified:
@@ -8330,6 +8655,8 @@ heap_xlog_multi_insert(XLogReaderState *record)
 
 		if (xlrec->flags & XLH_INSERT_ALL_VISIBLE_CLEARED)
 			PageClearAllVisible(page);
+		if (xlrec->flags & XLH_INSERT_ALL_FROZEN_SET)
+			PageSetAllVisible(page);
 
 		MarkBufferDirty(buffer);
 	}
@@ -19,10 +19,18 @@
 #include "access/hio.h"
 #include "access/htup_details.h"
 #include "access/visibilitymap.h"
+#include "access/xloginsert.h"
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
 #include "storage/smgr.h"
+#include "utils/memutils.h"
+
+/*
+ * How many pages RelationGetBufferForTuple may pass over because another
+ * backend holds their buffer lock, before it waits for the lock.
+ */
+#define MAX_BUSY_PAGE_SKIPS		3
 
 
 /*
@@ -73,6 +81,147 @@ RelationPutHeapTuple(Relation relation,
 	}
 }
 
+/*
+ * RelationPutHeapTupleBulk - place tuple on a private bulk-write page
+ *
+ * This is the HEAP_INSERT_BULK_WRITE counterpart of RelationGetBufferForTuple
+ * plus RelationPutHeapTuple.  The tuple goes onto the last page in
+ * bistate->bulk_pages, or a fresh one if it doesn't fit there; the pages
+ * don't go through shared buffers at all, and are written out directly at
+ * the end of the relation by RelationFlushBulkPages once the batch is full.
+ *
+ * The caller must make sure the relfilenode was created in the current
+ * transaction, so that nobody else can extend it or look at its pages.
+ */
+void
+RelationPutHeapTupleBulk(Relation relation,
+						 BulkInsertStateData *bistate,
+						 HeapTuple tuple)
+{
+	Size		len = MAXALIGN(tuple->t_len);
+	Size		saveFreeSpace;
+	Page		page = NULL;
+	OffsetNumber offnum;
+
+	if (len > MaxHeapTupleSize)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("row is too big: size %zu, maximum size %zu",
+						len, MaxHeapTupleSize)));
+
+	saveFreeSpace = RelationGetTargetPageFreeSpace(relation,
+												   HEAP_DEFAULT_FILLFACTOR);
+	if (len + saveFreeSpace > MaxHeapTupleSize)
+		saveFreeSpace = 0;
+
+	/* Write out pages built for another relation first */
+	if (bistate->bulk_rel != relation)
+	{
+		if (bistate->bulk_rel != NULL)
+			RelationFlushBulkPages(bistate);
+		bistate->bulk_rel = relation;
+	}
+
+	/*
+	 * We may be called in a short-lived context, so allocate the pages next
+	 * to the BulkInsertState, which lives as long as they're needed.
+	 */
+	if (bistate->bulk_pages == NULL)
+		bistate->bulk_pages = (PGAlignedBlock *)
+			MemoryContextAlloc(GetMemoryChunkContext(bistate),
+							   HEAP_BULK_WRITE_PAGES * sizeof(PGAlignedBlock));
+
+	if (bistate->bulk_npages > 0)
+	{
+		page = (Page) bistate->bulk_pages[bistate->bulk_npages - 1].data;
+		if (PageGetHeapFreeSpace(page) < len + saveFreeSpace)
+			page = NULL;
+	}
+
+	if (page == NULL)
+	{
+		if (bistate->bulk_npages >= HEAP_BULK_WRITE_PAGES)
+			RelationFlushBulkPages(bistate);
+
+		if (bistate->bulk_npages == 0)
+			bistate->bulk_nextblk = RelationGetNumberOfBlocks(relation);
+
+		page = (Page) bistate->bulk_pages[bistate->bulk_npages++].data;
+		PageInit(page, BLCKSZ, 0);
+	}
+
+	offnum = PageAddItem(page, (Item) tuple->t_data,
+						 tuple->t_len, InvalidOffsetNumber, false, true);
+
+	if (offnum == InvalidOffsetNumber)
+		elog(ERROR, "failed to add tuple to page");
+
+	ItemPointerSet(&(tuple->t_self),
+				   bistate->bulk_nextblk + bistate->bulk_npages - 1, offnum);
+
+	{
+		ItemId		itemId = PageGetItemId(page, offnum);
+		HeapTupleHeader item = (HeapTupleHeader) PageGetItem(page, itemId);
+
+		item->t_ctid = tuple->t_self;
+	}
+}
+
+/*
+ * RelationFlushBulkPages - write out the pages built by
+ * RelationPutHeapTupleBulk
+ *
+ * The pages are WAL-logged as full-page images if the relation needs WAL,
+ * and then appended to the relation with smgrextend().  They are not fsync'd
+ * here; FreeBulkInsertState takes care of that.
+ */
+void
+RelationFlushBulkPages(BulkInsertStateData *bistate)
+{
+	Relation	relation = bistate->bulk_rel;
+	BlockNumber blknos[HEAP_BULK_WRITE_PAGES];
+	Page		pages[HEAP_BULK_WRITE_PAGES];
+	int			npages = bistate->bulk_npages;
+	int			i;
+
+	if (npages == 0)
+		return;
+
+	/*
+	 * Nobody else can extend the relation, but check that nothing in this
+	 * backend did so behind our back either.  Otherwise we'd overwrite its
+	 * pages.
+	 */
+	RelationOpenSmgr(relation);
+	if (smgrnblocks(relation->rd_smgr, MAIN_FORKNUM) != bistate->bulk_nextblk)
+		elog(ERROR, "relation \"%s\" was extended during bulk write",
+			 RelationGetRelationName(relation));
+
+	for (i = 0; i < npages; i++)
+	{
+		blknos[i] = bistate->bulk_nextblk + i;
+		pages[i] = (Page) bistate->bulk_pages[i].data;
+	}
+
+	if (RelationNeedsWAL(relation))
+		log_newpages(&relation->rd_node, MAIN_FORKNUM, npages,
+					 blknos, pages, true);
+
+	for (i = 0; i < npages; i++)
+	{
+		PageSetChecksumInplace(pages[i], blknos[i]);
+		smgrextend(relation->rd_smgr, MAIN_FORKNUM, blknos[i],
+				   (char *) pages[i], true);
+	}
+
+	/* Let later inserts use the space left on the last page */
+	RecordPageWithFreeSpace(relation, blknos[npages - 1],
+							PageGetHeapFreeSpace(pages[npages - 1]));
+
+	bistate->bulk_nextblk += npages;
+	bistate->bulk_npages = 0;
+}
+
 /*
  * Read in a buffer in mode, using bulk-insert strategy if bistate isn't NULL.
  */
@@ -183,12 +332,13 @@ GetVisibilityMapPins(Relation relation, Buffer buffer1, Buffer buffer2,
  * the result to some sane overall value.
  */
 static void
-RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
+RelationAddExtraBlocks(Relation relation)
 {
 	BlockNumber blockNum,
-				firstBlock = InvalidBlockNumber;
+				firstBlock;
 	int			extraBlocks;
 	int			lockWaiters;
+	Size		freespace;
 
 	/* Use the length of the lock wait queue to judge how much to extend. */
 	lockWaiters = RelationExtensionLockWaiterCount(relation);
@@ -203,45 +353,27 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 	 */
 	extraBlocks = Min(512, lockWaiters * 20);
 
-	do
-	{
-		Buffer		buffer;
-		Page		page;
-		Size		freespace;
-
-		/*
-		 * Extend by one page.  This should generally match the main-line
-		 * extension code in RelationGetBufferForTuple, except that we hold
-		 * the relation extension lock throughout, and we don't immediately
-		 * initialize the page (see below).
-		 */
-		buffer = ReadBufferBI(relation, P_NEW, RBM_ZERO_AND_LOCK, bistate);
-		page = BufferGetPage(buffer);
-
-		if (!PageIsNew(page))
-			elog(ERROR, "page %u of relation \"%s\" should be empty but is not",
-				 BufferGetBlockNumber(buffer),
-				 RelationGetRelationName(relation));
-
-		/*
-		 * Add the page to the FSM without initializing. If we were to
-		 * initialize here, the page would potentially get flushed out to disk
-		 * before we add any useful content. There's no guarantee that that'd
-		 * happen before a potential crash, so we need to deal with
-		 * uninitialized pages anyway, thus avoid the potential for
-		 * unnecessary writes.
-		 */
-
-		/* we'll need this info below */
-		blockNum = BufferGetBlockNumber(buffer);
-		freespace = BufferGetPageSize(buffer) - SizeOfPageHeaderData;
-
-		UnlockReleaseBuffer(buffer);
-
-		/* Remember first block number thus added. */
-		if (firstBlock == InvalidBlockNumber)
-			firstBlock = blockNum;
+	/*
+	 * Extend by all the pages at once.  The new pages read back as zeroes,
+	 * so there's no need to go through shared buffers for them; the
+	 * main-line extension code in RelationGetBufferForTuple, which we still
+	 * run afterwards, uses P_NEW and so places its page after these.
+	 *
+	 * We don't initialize the pages, but add them to the FSM as they are.
+	 * If we were to initialize here, the page would potentially get flushed
+	 * out to disk before we add any useful content. There's no guarantee
+	 * that that'd happen before a potential crash, so we need to deal with
+	 * uninitialized pages anyway, thus avoid the potential for unnecessary
+	 * writes.
+	 */
+	firstBlock = RelationGetNumberOfBlocks(relation);
+	RelationOpenSmgr(relation);
+	smgrzeroextend(relation->rd_smgr, MAIN_FORKNUM, firstBlock, extraBlocks,
+				   false);
 
+	freespace = BLCKSZ - SizeOfPageHeaderData;
+	for (blockNum = firstBlock; blockNum < firstBlock + extraBlocks; blockNum++)
+	{
 		/*
 		 * Immediately update the bottom level of the FSM.  This has a good
 		 * chance of making this page visible to other concurrently inserting
@@ -249,7 +381,6 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 		 */
 		RecordPageWithFreeSpace(relation, blockNum, freespace);
 	}
-	while (--extraBlocks > 0);
 
 	/*
 	 * Updating the upper levels of the free space map is too expensive to do
@@ -257,7 +388,7 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 	 * subsequent insertion activity sees all of those nifty free pages we
 	 * just inserted.
 	 */
-	FreeSpaceMapVacuumRange(relation, firstBlock, blockNum + 1);
+	FreeSpaceMapVacuumRange(relation, firstBlock, blockNum);
 }
 
 /*
@@ -313,6 +444,15 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
  *	keeping it on the same page, which is the scenario fillfactor is meant
  *	to reserve space for.
  *
+ *	When inserting (not updating) and using the FSM, we don't wait for the
+ *	lock on a page that another backend has locked.  That backend is most
+ *	likely inserting into the same page, and if we queued up behind it, all
+ *	concurrent inserters would end up taking turns on a single page.
+ *	Instead we ask the FSM for another page, which hands out a different
+ *	one to each consecutive searcher, and we then keep inserting into
+ *	whichever page we got as our cached target.  After MAX_BUSY_PAGE_SKIPS
+ *	tries, or when the FSM offers the same page again, we wait after all.
+ *
  *	ereport(ERROR) is allowed here, so this routine *must* be called
  *	before any (unlogged) changes are made in buffer pool.
  */
@@ -330,6 +470,7 @@ RelationGetBufferForTuple(Relation relation, Size len,
 	BlockNumber targetBlock,
 				otherBlock;
 	bool		needLock;
+	int			nbusyskips = 0;
 
 	len = MAXALIGN(len);		/* be conservative */
 
@@ -422,7 +563,25 @@ loop:
 			buffer = ReadBufferBI(relation, targetBlock, RBM_NORMAL, bistate);
 			if (PageIsAllVisible(BufferGetPage(buffer)))
 				visibilitymap_pin(relation, targetBlock, vmbuffer);
-			LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+			if (!use_fsm || nbusyskips >= MAX_BUSY_PAGE_SKIPS)
+				LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+			else if (!ConditionalLockBuffer(buffer))
+			{
+				BlockNumber nextBlock;
+
+				/* Somebody else is busy with this page; try another one */
+				nbusyskips++;
+				nextBlock = GetPageWithFreeSpace(relation,
+												 len + saveFreeSpace);
+				if (nextBlock != InvalidBlockNumber &&
+					nextBlock != targetBlock)
+				{
+					ReleaseBuffer(buffer);
+					targetBlock = nextBlock;
+					continue;
+				}
+				LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+			}
 		}
 		else if (otherBlock == targetBlock)
 		{
@@ -481,6 +640,14 @@ loop:
 								 otherBlock, targetBlock, vmbuffer_other,
 								 vmbuffer);
 
+		/*
+		 * heap_multi_insert marks an empty page that it fills with frozen
+		 * tuples all-visible, so it needs the visibility map page, too.
+		 */
+		if ((options & HEAP_INSERT_FROZEN) &&
+			PageGetMaxOffsetNumber(BufferGetPage(buffer)) == 0)
+			visibilitymap_pin(relation, targetBlock, vmbuffer);
+
 		/*
 		 * Now we can check to see if there's enough free space here. If so,
 		 * we're done.
@@ -578,7 +745,7 @@ loop:
 			}
 
 			/* Time to bulk-extend. */
-			RelationAddExtraBlocks(relation, bistate);
+			RelationAddExtraBlocks(relation);
 		}
 	}
 
@@ -608,6 +775,10 @@ loop:
 	PageInit(page, BufferGetPageSize(buffer), 0);
 	MarkBufferDirty(buffer);
 
+	/* As above, the new page will need its visibility map page pinned */
+	if (options & HEAP_INSERT_FROZEN)
+		visibilitymap_pin(relation, BufferGetBlockNumber(buffer), vmbuffer);
+
 	/*
 	 * Release the file-extension lock; it's now OK for someone else to extend
 	 * the relation some more.
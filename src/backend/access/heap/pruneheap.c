@@ -101,6 +101,13 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
 	if (RecoveryInProgress())
 		return;
 
+	/*
+	 * Nor can we change the pages of a temporary relation while parallel
+	 * workers may be reading them from disk (see ShareLocalBuffers).
+	 */
+	if (RelationUsesLocalBuffers(relation) && LocalBuffersShared())
+		return;
+
 	/*
 	 * XXX: Magic to keep old_snapshot_threshold tests appear "working". They
 	 * currently are broken, and discussion of what to do about them is
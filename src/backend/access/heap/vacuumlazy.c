@@ -4,23 +4,25 @@
  *	  Concurrent ("lazy") vacuuming.
  *
  *
- * The major space usage for LAZY VACUUM is storage for the array of dead tuple
- * TIDs.  We want to ensure we can vacuum even the very largest relations with
+ * The major space usage for LAZY VACUUM is storage for the dead tuple TIDs.
+ * We want to ensure we can vacuum even the very largest relations with
  * finite memory space usage.  To do that, we set upper bounds on the number of
  * tuples we will keep track of at once.
  *
  * We are willing to use at most maintenance_work_mem (or perhaps
  * autovacuum_work_mem) memory space to keep track of dead tuples.  We
- * initially allocate an array of TIDs of that size, with an upper limit that
- * depends on table size (this limit ensures we don't allocate a huge area
- * uselessly for vacuuming small tables).  If the array threatens to overflow,
- * we suspend the heap scan phase and perform a pass of index cleanup and page
- * compaction, then resume the heap scan with an empty TID array.
+ * initially allocate a dead tuple space of that size, with an upper limit
+ * that depends on table size (this limit ensures we don't allocate a huge
+ * area uselessly for vacuuming small tables).  If the space threatens to
+ * overflow, we suspend the heap scan phase and perform a pass of index
+ * cleanup and page compaction, then resume the heap scan with an empty space.
+ * The TIDs are stored per heap block, as a bitmap or an array of offsets
+ * whichever is smaller, so pages with many dead tuples take little space.
  *
  * If we're processing a table with no indexes, we can just vacuum each page
  * as we go; there's no need to save up multiple tuples to minimize the number
  * of index scans performed.  So we don't use maintenance_work_mem memory for
- * the TID array, just enough to hold as many heap tuples as fit on one page.
+ * the dead tuples, just enough to hold the dead tuples of one page.
  *
  * Lazy vacuum supports parallel execution with parallel worker processes.  In
  * a parallel vacuum, we perform both index vacuum and index cleanup with
@@ -74,10 +76,13 @@
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
+#include "storage/procarray.h"
+#include "storage/readahead.h"
 #include "tcop/tcopprot.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
+#include "utils/spccache.h"
 #include "utils/timestamp.h"
 
 
@@ -112,11 +117,20 @@
 	((BlockNumber) (((uint64) 8 * 1024 * 1024 * 1024) / BLCKSZ))
 
 /*
- * Guesstimation of number of dead tuples per page.  This is used to
- * provide an upper limit to memory allocated when vacuuming small
- * tables.
+ * Check the wraparound failsafe after every 4GB of heap scanned,
+ * approximately.
  */
-#define LAZY_ALLOC_TUPLES		MaxHeapTuplesPerPage
+#define FAILSAFE_EVERY_PAGES \
+	((BlockNumber) (((uint64) 4 * 1024 * 1024 * 1024) / BLCKSZ))
+
+/*
+ * Index vacuuming is bypassed when a single pass would remove dead tuples
+ * from fewer than this fraction of the table's pages, and from no more than
+ * this many tuples (what 32MB of TIDs once held).  The dead tuples are left
+ * as LP_DEAD stubs, for a later VACUUM to remove.
+ */
+#define BYPASS_THRESHOLD_PAGES	0.02
+#define BYPASS_MAX_DEAD_TUPLES	((32L * 1024L * 1024L) / sizeof(ItemPointerData))
 
 /*
  * Before we consider skipping a page that's marked as clean in
@@ -141,6 +155,12 @@
 #define PARALLEL_VACUUM_KEY_BUFFER_USAGE	4
 #define PARALLEL_VACUUM_KEY_WAL_USAGE		5
 
+/*
+ * Number of blocks of the dead tuple space a process takes at a time in a
+ * parallel heap vacuum, so that each reads runs of nearby blocks.
+ */
+#define PARALLEL_VACUUM_HEAP_CHUNK	32
+
 /*
  * Macro to check if we are in a parallel vacuum.  If true, we are in the
  * parallel mode and the DSM segment is initialized.
@@ -162,23 +182,59 @@ typedef enum
  * LVDeadTuples stores the dead tuple TIDs collected during the heap scan.
  * This is allocated in the DSM segment in parallel mode and in local memory
  * in non-parallel mode.
+ *
+ * The TIDs are grouped by heap block.  The space after the fixed part holds
+ * an array of LVDeadBlock, ordered by block number, growing from the start,
+ * and the dead offsets of those blocks, growing from the end.  The offsets
+ * of a block are either a sorted array of OffsetNumbers or a bitmap with bit
+ * (offnum - 1) set for each dead offset, whichever takes fewer words.  They
+ * run up to the start of the previous block's offsets, or the end of the
+ * space for the first block.
  */
+typedef struct LVDeadBlock
+{
+	BlockNumber blkno;			/* heap block number */
+	uint32		offsets;		/* first word of its offsets, and flag */
+} LVDeadBlock;
+
+#define LVDB_BITMAP				0x80000000	/* offsets are a bitmap */
+#define LVDB_OFFSETS_MASK		0x7FFFFFFF
+
 typedef struct LVDeadTuples
 {
-	int			max_tuples;		/* # slots allocated in array */
-	int			num_tuples;		/* current # of entries */
-	/* List of TIDs of tuples we intend to delete */
-	/* NB: this list is ordered by TID address */
-	ItemPointerData itemptrs[FLEXIBLE_ARRAY_MEMBER];	/* array of
-														 * ItemPointerData */
+	int			num_tuples;		/* # of TIDs stored */
+	int			num_blocks;		/* # of entries in blocks[] */
+	uint32		max_words;		/* size of the space, in uint16 words */
+	uint32		used_words;		/* # of words used by offsets */
+	/* NB: blocks[] is ordered by block number */
+	LVDeadBlock blocks[FLEXIBLE_ARRAY_MEMBER];
 } LVDeadTuples;
 
-/* The dead tuple space consists of LVDeadTuples and dead tuple TIDs */
-#define SizeOfDeadTuples(cnt) \
-	add_size(offsetof(LVDeadTuples, itemptrs), \
-			 mul_size(sizeof(ItemPointerData), cnt))
-#define MAXDEADTUPLES(max_size) \
-		(((max_size) - offsetof(LVDeadTuples, itemptrs)) / sizeof(ItemPointerData))
+/* Words taken by the offsets of a page, at most */
+#define DEAD_BITS_PER_WORD		(BITS_PER_BYTE * sizeof(uint16))
+#define DEAD_BLOCK_MAX_WORDS \
+	((MaxHeapTuplesPerPage + DEAD_BITS_PER_WORD - 1) / DEAD_BITS_PER_WORD)
+
+/* Bytes taken by the dead tuples of a page, at most */
+#define DEAD_BLOCK_MAX_SIZE \
+	(sizeof(LVDeadBlock) + DEAD_BLOCK_MAX_WORDS * sizeof(uint16))
+
+/* The dead tuple space consists of LVDeadTuples and the blocks and offsets */
+#define SizeOfDeadTuples(size) \
+	add_size(offsetof(LVDeadTuples, blocks), size)
+
+/* The dead tuple space as words, and the words free in it */
+#define DeadTuplesWords(dt)		((uint16 *) (dt)->blocks)
+#define DeadTuplesFreeWords(dt) \
+	((dt)->max_words - (dt)->used_words - \
+	 (dt)->num_blocks * (sizeof(LVDeadBlock) / sizeof(uint16)))
+
+/*
+ * Number of dead tuples that surely fit in the space, which is when they're
+ * all on different blocks.
+ */
+#define DeadTuplesMaxTuples(dt) \
+	((int64) (dt)->max_words / (sizeof(LVDeadBlock) / sizeof(uint16) + 1))
 
 /*
  * Shared information among parallel workers.  So this is allocated in the DSM
@@ -201,6 +257,21 @@ typedef struct LVShared
 	bool		for_cleanup;
 	bool		first_time;
 
+	/*
+	 * Fields for heap vacuum.  vacuum_heap is true when the workers are to
+	 * remove the dead tuples from the heap instead of working on the indexes.
+	 * They take the blocks of the dead tuple space in chunks, by advancing
+	 * heap_blockindex, and add up what they freed in heap_ntuples and
+	 * heap_npages.  oldest_xmin and latest_removed_xid are the leader's
+	 * OldestXmin and vacrelstats->latestRemovedXid.
+	 */
+	bool		vacuum_heap;
+	TransactionId oldest_xmin;
+	TransactionId latest_removed_xid;
+	pg_atomic_uint32 heap_blockindex;
+	pg_atomic_uint32 heap_ntuples;
+	pg_atomic_uint32 heap_npages;
+
 	/*
 	 * Fields for both index vacuum and cleanup.
 	 *
@@ -313,6 +384,10 @@ typedef struct LVRelStats
 	int			num_index_scans;
 	TransactionId latestRemovedXid;
 	bool		lock_waiter_detected;
+	/* dead tuples recorded with their storage, not just LP_DEAD stubs? */
+	bool		has_tupgone;
+	/* wraparound failsafe triggered, so no index vacuuming or truncation? */
+	bool		failsafe_active;
 
 	/* Used for error callback */
 	char	   *indname;
@@ -329,6 +404,17 @@ typedef struct LVSavedErrInfo
 	VacErrPhase phase;
 } LVSavedErrInfo;
 
+/* State of the prefetch predictions for the heap scan; see lazy_readahead_next */
+typedef struct LVReadAheadState
+{
+	Relation	onerel;
+	BlockNumber next_block;		/* next block to consider */
+	BlockNumber nblocks;		/* # of blocks to scan */
+	bool		skip_pages;		/* page skipping not disabled? */
+	bool		aggressive;
+	Buffer		vmbuffer;		/* our own visibility map pin, if any */
+} LVReadAheadState;
+
 /* A few variables that don't seem worth passing around as parameters */
 static int	elevel = -1;
 
@@ -343,9 +429,22 @@ static BufferAccessStrategy vac_strategy;
 static void lazy_scan_heap(Relation onerel, VacuumParams *params,
 						   LVRelStats *vacrelstats, Relation *Irel, int nindexes,
 						   bool aggressive);
-static void lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats);
+static void lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats,
+							 LVParallelState *lps);
+static void lazy_parallel_vacuum_heap(Relation onerel, LVRelStats *vacrelstats,
+									  LVParallelState *lps,
+									  int *ntuples, int *npages);
+static void lazy_vacuum_heap_blocks(Relation onerel, LVRelStats *vacrelstats,
+									LVShared *lvshared,
+									int *ntuples, int *npages);
 static bool lazy_check_needs_freeze(Buffer buf, bool *hastup,
 									LVRelStats *vacrelstats);
+static bool lazy_check_wraparound_failsafe(Relation onerel,
+										   LVRelStats *vacrelstats);
+static void lazy_vacuum(Relation onerel, Relation *Irel,
+						IndexBulkDeleteResult **stats,
+						LVRelStats *vacrelstats, LVParallelState *lps,
+						int nindexes, bool onlypass);
 static void lazy_vacuum_all_indexes(Relation onerel, Relation *Irel,
 									IndexBulkDeleteResult **stats,
 									LVRelStats *vacrelstats, LVParallelState *lps,
@@ -356,17 +455,21 @@ static void lazy_cleanup_index(Relation indrel,
 							   IndexBulkDeleteResult **stats,
 							   double reltuples, bool estimated_count, LVRelStats *vacrelstats);
 static int	lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-							 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer);
+							 int blockindex, LVRelStats *vacrelstats, Buffer *vmbuffer);
 static bool should_attempt_truncation(VacuumParams *params,
 									  LVRelStats *vacrelstats);
 static void lazy_truncate_heap(Relation onerel, LVRelStats *vacrelstats);
 static BlockNumber count_nondeletable_pages(Relation onerel,
 											LVRelStats *vacrelstats);
 static void lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks);
-static void lazy_record_dead_tuple(LVDeadTuples *dead_tuples,
-								   ItemPointer itemptr);
+static void lazy_init_dead_tuples(LVDeadTuples *dead_tuples, Size size);
+static void lazy_reset_dead_tuples(LVDeadTuples *dead_tuples);
+static void lazy_record_dead_tuples(LVDeadTuples *dead_tuples,
+									BlockNumber blkno,
+									OffsetNumber *offsets, int noffsets);
+static int	lazy_get_dead_offsets(LVDeadTuples *dead_tuples, int blockindex,
+								  OffsetNumber *offsets);
 static bool lazy_tid_reaped(ItemPointer itemptr, void *state);
-static int	vac_cmp_itemptr(const void *left, const void *right);
 static bool heap_page_is_all_visible(Relation rel, Buffer buf,
 									 LVRelStats *vacrelstats,
 									 TransactionId *visibility_cutoff_xid, bool *all_frozen);
@@ -385,7 +488,7 @@ static void vacuum_one_index(Relation indrel, IndexBulkDeleteResult **stats,
 static void lazy_cleanup_all_indexes(Relation *Irel, IndexBulkDeleteResult **stats,
 									 LVRelStats *vacrelstats, LVParallelState *lps,
 									 int nindexes);
-static long compute_max_dead_tuples(BlockNumber relblocks, bool hasindex);
+static Size compute_dead_tuples_space(BlockNumber relblocks, bool useindex);
 static int	compute_parallel_vacuum_workers(Relation *Irel, int nindexes, int nrequested,
 											bool *can_parallel_vacuum);
 static void prepare_index_statistics(LVShared *lvshared, bool *can_parallel_vacuum,
@@ -398,6 +501,7 @@ static LVParallelState *begin_parallel_vacuum(Oid relid, Relation *Irel,
 static void end_parallel_vacuum(IndexBulkDeleteResult **stats,
 								LVParallelState *lps, int nindexes);
 static LVSharedIndStats *get_indstats(LVShared *lvshared, int n);
+static BlockNumber lazy_readahead_next(void *callback_arg);
 static bool skip_parallel_vacuum_index(Relation indrel, LVShared *lvshared);
 static void vacuum_error_callback(void *arg);
 static void update_vacuum_error_info(LVRelStats *errinfo, LVSavedErrInfo *saved_err_info,
@@ -498,6 +602,8 @@ heap_vacuum_rel(Relation onerel, VacuumParams *params,
 	vacrelstats->num_index_scans = 0;
 	vacrelstats->pages_removed = 0;
 	vacrelstats->lock_waiter_detected = false;
+	vacrelstats->has_tupgone = false;
+	vacrelstats->failsafe_active = false;
 
 	/* Open all indexes of the relation */
 	vac_open_indexes(onerel, RowExclusiveLock, &nindexes, &Irel);
@@ -784,6 +890,9 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	};
 	int64		initprog_val[3];
 	GlobalVisState *vistest;
+	LVReadAheadState readahead_state;
+	ReadAheadState *readahead = NULL;
+	int			io_concurrency;
 
 	pg_rusage_init(&ru0);
 
@@ -814,6 +923,12 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 
 	vistest = GlobalVisTestFor(onerel);
 
+	/*
+	 * Do the failsafe check before anything else, so that a table that is
+	 * already too old is vacuumed in a single pass from the start.
+	 */
+	lazy_check_wraparound_failsafe(onerel, vacrelstats);
+
 	/*
 	 * Initialize state for a parallel vacuum.  As of now, only one worker can
 	 * be used for an index, so we invoke parallelism only if there are at
@@ -855,7 +970,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	/* Report that we're scanning the heap, advertising total # of blocks */
 	initprog_val[0] = PROGRESS_VACUUM_PHASE_SCAN_HEAP;
 	initprog_val[1] = nblocks;
-	initprog_val[2] = dead_tuples->max_tuples;
+	initprog_val[2] = DeadTuplesMaxTuples(dead_tuples);
 	pgstat_progress_update_multi_param(3, initprog_index, initprog_val);
 
 	/*
@@ -931,6 +1046,25 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	else
 		skipping_blocks = false;
 
+	/*
+	 * Keep prefetches going ahead of the scan for the pages that the
+	 * visibility map says we can't skip.
+	 */
+	io_concurrency =
+		get_tablespace_maintenance_io_concurrency(onerel->rd_rel->reltablespace);
+	if (io_concurrency > 0)
+	{
+		readahead_state.onerel = onerel;
+		readahead_state.next_block = 0;
+		readahead_state.nblocks = nblocks;
+		readahead_state.skip_pages =
+			(params->options & VACOPT_DISABLE_PAGE_SKIPPING) == 0;
+		readahead_state.aggressive = aggressive;
+		readahead_state.vmbuffer = InvalidBuffer;
+		readahead = ReadAheadBegin(onerel, MAIN_FORKNUM, io_concurrency,
+								   lazy_readahead_next, &readahead_state);
+	}
+
 	for (blkno = 0; blkno < nblocks; blkno++)
 	{
 		Buffer		buf;
@@ -940,7 +1074,11 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		bool		tupgone,
 					hastup;
 		int			prev_dead_count;
+		OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
+		int			ndeadoffsets;
 		int			nfrozen;
+		TransactionId freeze_cutoff;
+		long		prune_fpi;
 		Size		freespace;
 		bool		all_visible_according_to_vm = false;
 		bool		all_visible;
@@ -957,6 +1095,17 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		update_vacuum_error_info(vacrelstats, NULL, VACUUM_ERRCB_PHASE_SCAN_HEAP,
 								 blkno, InvalidOffsetNumber);
 
+		/*
+		 * Recheck the wraparound failsafe now and then, since a long-running
+		 * VACUUM can fall behind.  Once it triggers, the dead tuples we have
+		 * collected so far are forgotten, just like when index cleanup is
+		 * disabled.
+		 */
+		if (blkno > 0 && blkno % FAILSAFE_EVERY_PAGES == 0 &&
+			!vacrelstats->failsafe_active &&
+			lazy_check_wraparound_failsafe(onerel, vacrelstats))
+			lazy_reset_dead_tuples(dead_tuples);
+
 		if (blkno == next_unskippable_block)
 		{
 			/* Time to advance next_unskippable_block */
@@ -1036,7 +1185,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		 * If we are close to overrunning the available space for dead-tuple
 		 * TIDs, pause and do a cycle of vacuuming before we tackle this page.
 		 */
-		if ((dead_tuples->max_tuples - dead_tuples->num_tuples) < MaxHeapTuplesPerPage &&
+		if (DeadTuplesFreeWords(dead_tuples) * sizeof(uint16) < DEAD_BLOCK_MAX_SIZE &&
 			dead_tuples->num_tuples > 0)
 		{
 			/*
@@ -1052,18 +1201,15 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			}
 
 			/* Work on all the indexes, then the heap */
-			lazy_vacuum_all_indexes(onerel, Irel, indstats,
-									vacrelstats, lps, nindexes);
-
-			/* Remove tuples from heap */
-			lazy_vacuum_heap(onerel, vacrelstats);
+			lazy_vacuum(onerel, Irel, indstats, vacrelstats, lps, nindexes,
+						false);
 
 			/*
 			 * Forget the now-vacuumed tuples, and press on, but be careful
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
-			dead_tuples->num_tuples = 0;
+			lazy_reset_dead_tuples(dead_tuples);
 
 			/*
 			 * Vacuum the Free Space Map to make newly-freed space visible on
@@ -1088,6 +1234,9 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		 */
 		visibilitymap_pin(onerel, blkno, &vmbuffer);
 
+		if (readahead)
+			ReadAheadAdvance(readahead, blkno);
+
 		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, blkno,
 								 RBM_NORMAL, vac_strategy);
 
@@ -1236,11 +1385,14 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		 * Prune all HOT-update chains in this page.
 		 *
 		 * We count tuples removed by the pruning step as removed by VACUUM.
+		 * Note whether it logged a full-page image, for eager freezing below.
 		 */
+		prune_fpi = pgWalUsage.wal_fpi;
 		tups_vacuumed += heap_page_prune(onerel, buf, vistest, false,
 										 InvalidTransactionId, 0,
 										 &vacrelstats->latestRemovedXid,
 										 &vacrelstats->offnum);
+		prune_fpi = pgWalUsage.wal_fpi - prune_fpi;
 
 		/*
 		 * Now scan the page to collect vacuumable items and check for tuples
@@ -1249,8 +1401,10 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		all_visible = true;
 		has_dead_tuples = false;
 		nfrozen = 0;
+		freeze_cutoff = FreezeLimit;
 		hastup = false;
 		prev_dead_count = dead_tuples->num_tuples;
+		ndeadoffsets = 0;
 		maxoff = PageGetMaxOffsetNumber(page);
 
 		/*
@@ -1294,7 +1448,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			 */
 			if (ItemIdIsDead(itemid))
 			{
-				lazy_record_dead_tuple(dead_tuples, &(tuple.t_self));
+				deadoffsets[ndeadoffsets++] = offnum;
 				all_visible = false;
 				continue;
 			}
@@ -1440,7 +1594,8 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 
 			if (tupgone)
 			{
-				lazy_record_dead_tuple(dead_tuples, &(tuple.t_self));
+				deadoffsets[ndeadoffsets++] = offnum;
+				vacrelstats->has_tupgone = true;
 				HeapTupleHeaderAdvanceLatestRemovedXid(tuple.t_data,
 													   &vacrelstats->latestRemovedXid);
 				tups_vacuumed += 1;
@@ -1475,6 +1630,53 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		 */
 		vacrelstats->offnum = InvalidOffsetNumber;
 
+		/*
+		 * If the page is about to become all-visible but not all-frozen, and
+		 * it's being WAL-logged anyway, freeze every tuple on it now instead
+		 * of waiting for them to reach vacuum_freeze_min_age.  Otherwise an
+		 * aggressive vacuum has to read, dirty and log the page all over
+		 * again later, which for tables that are mostly appended to is most
+		 * of the table.  We count the page as logged if pruning just emitted
+		 * a full-page image of it, or if some of its tuples must be frozen
+		 * already, in which case freezing the rest costs only a few bytes of
+		 * the same record.
+		 *
+		 * All the remaining tuples are visible to everyone, so OldestXmin
+		 * works as the cutoff.  heap_prepare_freeze_tuple is stateless, so
+		 * just redo it for the whole page.
+		 */
+		if (all_visible && !all_frozen && (prune_fpi > 0 || nfrozen > 0))
+		{
+			freeze_cutoff = OldestXmin;
+			nfrozen = 0;
+			all_frozen = true;
+			for (offnum = FirstOffsetNumber;
+				 offnum <= maxoff;
+				 offnum = OffsetNumberNext(offnum))
+			{
+				ItemId		itemid = PageGetItemId(page, offnum);
+				bool		tuple_totally_frozen;
+
+				if (!ItemIdIsNormal(itemid))
+					continue;
+
+				if (heap_prepare_freeze_tuple((HeapTupleHeader) PageGetItem(page, itemid),
+											  relfrozenxid, relminmxid,
+											  freeze_cutoff, MultiXactCutoff,
+											  &frozen[nfrozen],
+											  &tuple_totally_frozen))
+					frozen[nfrozen++].offset = offnum;
+
+				if (!tuple_totally_frozen)
+					all_frozen = false;
+			}
+		}
+
+		/* Remember the page's dead tuples */
+		if (ndeadoffsets > 0)
+			lazy_record_dead_tuples(dead_tuples, blkno,
+									deadoffsets, ndeadoffsets);
+
 		/*
 		 * If we froze any tuples, mark the buffer dirty, and write a WAL
 		 * record recording the changes.  We must log the changes to be
@@ -1503,7 +1705,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			{
 				XLogRecPtr	recptr;
 
-				recptr = log_heap_freeze(onerel, buf, FreezeLimit,
+				recptr = log_heap_freeze(onerel, buf, freeze_cutoff,
 										 frozen, nfrozen);
 				PageSetLSN(page, recptr);
 			}
@@ -1537,7 +1739,8 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 				 * We do not process them because it's a very rare condition,
 				 * and the next vacuum will process them anyway.
 				 */
-				Assert(params->index_cleanup == VACOPT_TERNARY_DISABLED);
+				Assert(params->index_cleanup == VACOPT_TERNARY_DISABLED ||
+					   vacrelstats->failsafe_active);
 			}
 
 			/*
@@ -1545,7 +1748,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
-			dead_tuples->num_tuples = 0;
+			lazy_reset_dead_tuples(dead_tuples);
 
 			/*
 			 * Periodically do incremental FSM vacuuming to make newly-freed
@@ -1700,18 +1903,21 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		vmbuffer = InvalidBuffer;
 	}
 
-	/* If any tuples need to be deleted, perform final vacuum cycle */
-	/* XXX put a threshold on min number of tuples here? */
-	if (dead_tuples->num_tuples > 0)
+	if (readahead)
 	{
-		/* Work on all the indexes, and then the heap */
-		lazy_vacuum_all_indexes(onerel, Irel, indstats, vacrelstats,
-								lps, nindexes);
-
-		/* Remove tuples from heap */
-		lazy_vacuum_heap(onerel, vacrelstats);
+		ReadAheadEnd(readahead);
+		if (BufferIsValid(readahead_state.vmbuffer))
+			ReleaseBuffer(readahead_state.vmbuffer);
 	}
 
+	/*
+	 * If any tuples need to be deleted, perform final vacuum cycle.  If it's
+	 * the only one, lazy_vacuum may find there are too few of them to bother.
+	 */
+	if (dead_tuples->num_tuples > 0)
+		lazy_vacuum(onerel, Irel, indstats, vacrelstats, lps, nindexes,
+					vacrelstats->num_index_scans == 0);
+
 	/*
 	 * Vacuum the remainder of the Free Space Map.  We must do this whether or
 	 * not there were indexes.
@@ -1776,6 +1982,51 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	pfree(buf.data);
 }
 
+/*
+ *	lazy_vacuum() -- remove the collected dead tuples from indexes and heap.
+ *
+ * onlypass says that this is the only round of index vacuuming this VACUUM
+ * will do.  In that case, if there are very few dead tuples we leave them
+ * alone as LP_DEAD stubs, as a whole pass over every index would cost far
+ * more than it saves.  That's only possible when all of the dead tuples are
+ * just stubs already: tuples that still have storage must be removed.
+ */
+static void
+lazy_vacuum(Relation onerel, Relation *Irel, IndexBulkDeleteResult **stats,
+			LVRelStats *vacrelstats, LVParallelState *lps, int nindexes,
+			bool onlypass)
+{
+	LVDeadTuples *dead_tuples = vacrelstats->dead_tuples;
+
+	Assert(vacrelstats->useindex);
+	Assert(dead_tuples->num_tuples > 0);
+
+	if (onlypass && !vacrelstats->has_tupgone &&
+		dead_tuples->num_blocks < vacrelstats->rel_pages * BYPASS_THRESHOLD_PAGES &&
+		dead_tuples->num_tuples < BYPASS_MAX_DEAD_TUPLES)
+	{
+		ereport(elevel,
+				(errmsg("\"%s\": index scan bypassed: %d pages from table (%.2f%% of total) have %d dead item identifiers",
+						vacrelstats->relname, dead_tuples->num_blocks,
+						100.0 * dead_tuples->num_blocks / vacrelstats->rel_pages,
+						dead_tuples->num_tuples)));
+		return;
+	}
+
+	/*
+	 * Check the failsafe before starting what may be a long pass over the
+	 * indexes.  If it triggers, skip both index and heap vacuuming.
+	 */
+	if (lazy_check_wraparound_failsafe(onerel, vacrelstats))
+		return;
+
+	/* Work on all the indexes, then the heap */
+	lazy_vacuum_all_indexes(onerel, Irel, stats, vacrelstats, lps, nindexes);
+
+	/* Remove tuples from heap */
+	lazy_vacuum_heap(onerel, vacrelstats, lps);
+}
+
 /*
  *	lazy_vacuum_all_indexes() -- vacuum all indexes of relation.
  *
@@ -1836,17 +2087,20 @@ lazy_vacuum_all_indexes(Relation onerel, Relation *Irel,
  *		space on their pages.  Pages not having dead tuples recorded from
  *		lazy_scan_heap are not visited at all.
  *
+ *		In a parallel vacuum, the parallel workers share the pages with us
+ *		when there are enough of them.
+ *
  * Note: the reason for doing this as a second pass is we cannot remove
  * the tuples until we've removed their index entries, and we want to
  * process index entry removal in batches as large as possible.
  */
 static void
-lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
+lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats,
+				 LVParallelState *lps)
 {
-	int			tupindex;
-	int			npages;
+	int			ntuples = 0;
+	int			npages = 0;
 	PGRUsage	ru0;
-	Buffer		vmbuffer = InvalidBuffer;
 	LVSavedErrInfo saved_err_info;
 
 	/* Report that we are now vacuuming the heap */
@@ -1858,30 +2112,155 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 							 InvalidBlockNumber, InvalidOffsetNumber);
 
 	pg_rusage_init(&ru0);
-	npages = 0;
 
-	tupindex = 0;
-	while (tupindex < vacrelstats->dead_tuples->num_tuples)
+	if (ParallelVacuumIsActive(lps) &&
+		vacrelstats->dead_tuples->num_blocks >= min_parallel_table_scan_size)
+		lazy_parallel_vacuum_heap(onerel, vacrelstats, lps,
+								  &ntuples, &npages);
+	else
+		lazy_vacuum_heap_blocks(onerel, vacrelstats, NULL,
+								&ntuples, &npages);
+
+	ereport(elevel,
+			(errmsg("\"%s\": removed %d row versions in %d pages",
+					vacrelstats->relname,
+					ntuples, npages),
+			 errdetail_internal("%s", pg_rusage_show(&ru0))));
+
+	/* Revert to the previous phase information for error traceback */
+	restore_vacuum_error_info(vacrelstats, &saved_err_info);
+}
+
+/*
+ * Remove the dead tuples from the heap with the help of the parallel vacuum
+ * workers.
+ */
+static void
+lazy_parallel_vacuum_heap(Relation onerel, LVRelStats *vacrelstats,
+						  LVParallelState *lps, int *ntuples, int *npages)
+{
+	LVShared   *lvshared = lps->lvshared;
+	int			nworkers = lps->pcxt->nworkers;
+	int			i;
+
+	Assert(!IsParallelWorker());
+
+	lvshared->vacuum_heap = true;
+	lvshared->oldest_xmin = OldestXmin;
+	lvshared->latest_removed_xid = vacrelstats->latestRemovedXid;
+	pg_atomic_write_u32(&(lvshared->heap_blockindex), 0);
+	pg_atomic_write_u32(&(lvshared->heap_ntuples), 0);
+	pg_atomic_write_u32(&(lvshared->heap_npages), 0);
+
+	/*
+	 * Reinitialize the parallel context to relaunch parallel workers; the
+	 * indexes have always been vacuumed before this.
+	 */
+	ReinitializeParallelDSM(lps->pcxt);
+
+	/* Setup the shared cost-based vacuum delay and launch workers */
+	pg_atomic_write_u32(&(lvshared->cost_balance), VacuumCostBalance);
+	pg_atomic_write_u32(&(lvshared->active_nworkers), 0);
+
+	ReinitializeParallelWorkers(lps->pcxt, nworkers);
+
+	LaunchParallelWorkers(lps->pcxt);
+
+	if (lps->pcxt->nworkers_launched > 0)
+	{
+		/* As for index vacuuming, see lazy_parallel_vacuum_indexes */
+		VacuumCostBalance = 0;
+		VacuumCostBalanceLocal = 0;
+		VacuumSharedCostBalance = &(lvshared->cost_balance);
+		VacuumActiveNWorkers = &(lvshared->active_nworkers);
+	}
+
+	ereport(elevel,
+			(errmsg(ngettext("launched %d parallel vacuum worker for heap vacuuming (planned: %d)",
+							 "launched %d parallel vacuum workers for heap vacuuming (planned: %d)",
+							 lps->pcxt->nworkers_launched),
+					lps->pcxt->nworkers_launched, nworkers)));
+
+	/* Join as a parallel worker */
+	lazy_vacuum_heap_blocks(onerel, vacrelstats, lvshared, ntuples, npages);
+
+	/* Wait for the workers to finish, and accumulate their buffer and WAL usage */
+	WaitForParallelWorkersToFinish(lps->pcxt);
+	for (i = 0; i < lps->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&lps->buffer_usage[i], &lps->wal_usage[i]);
+
+	*ntuples = pg_atomic_read_u32(&(lvshared->heap_ntuples));
+	*npages = pg_atomic_read_u32(&(lvshared->heap_npages));
+	lvshared->vacuum_heap = false;
+
+	/*
+	 * Carry the shared balance value to heap scan and disable shared costing
+	 */
+	if (VacuumSharedCostBalance)
+	{
+		VacuumCostBalance = pg_atomic_read_u32(VacuumSharedCostBalance);
+		VacuumSharedCostBalance = NULL;
+		VacuumActiveNWorkers = NULL;
+	}
+}
+
+/*
+ * Heap vacuum routine used by the leader process, alone or along with the
+ * parallel vacuum workers, and by the workers.
+ *
+ * Alone, we vacuum all the blocks of the dead tuple space.  Otherwise, we
+ * vacuum chunks of them while there are any left for the taking, and add
+ * what we did to the counts in lvshared.
+ */
+static void
+lazy_vacuum_heap_blocks(Relation onerel, LVRelStats *vacrelstats,
+						LVShared *lvshared, int *ntuples, int *npages)
+{
+	LVDeadTuples *dead_tuples = vacrelstats->dead_tuples;
+	Buffer		vmbuffer = InvalidBuffer;
+	int			blockindex = 0;
+	int			chunkend = dead_tuples->num_blocks;
+	int			mytuples = 0;
+	int			mypages = 0;
+
+	/*
+	 * Increment the active worker count if we are able to launch any worker.
+	 */
+	if (lvshared && VacuumActiveNWorkers)
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+
+	for (;;)
 	{
 		BlockNumber tblk;
 		Buffer		buf;
 		Page		page;
 		Size		freespace;
 
+		/* Take the next chunk of blocks if we're done with ours */
+		if (lvshared && blockindex >= chunkend)
+		{
+			blockindex = pg_atomic_fetch_add_u32(&(lvshared->heap_blockindex),
+												 PARALLEL_VACUUM_HEAP_CHUNK);
+			chunkend = Min(blockindex + PARALLEL_VACUUM_HEAP_CHUNK,
+						   dead_tuples->num_blocks);
+		}
+		if (blockindex >= chunkend)
+			break;
+
 		vacuum_delay_point();
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples->itemptrs[tupindex]);
+		tblk = dead_tuples->blocks[blockindex].blkno;
 		vacrelstats->blkno = tblk;
 		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, tblk, RBM_NORMAL,
 								 vac_strategy);
 		if (!ConditionalLockBufferForCleanup(buf))
 		{
 			ReleaseBuffer(buf);
-			++tupindex;
+			blockindex++;
 			continue;
 		}
-		tupindex = lazy_vacuum_page(onerel, tblk, buf, tupindex, vacrelstats,
-									&vmbuffer);
+		mytuples += lazy_vacuum_page(onerel, tblk, buf, blockindex,
+									 vacrelstats, &vmbuffer);
 
 		/* Now that we've compacted the page, record its available space */
 		page = BufferGetPage(buf);
@@ -1889,7 +2268,8 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 
 		UnlockReleaseBuffer(buf);
 		RecordPageWithFreeSpace(onerel, tblk, freespace);
-		npages++;
+		mypages++;
+		blockindex++;
 	}
 
 	/* Clear the block number information */
@@ -1901,14 +2281,21 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 		vmbuffer = InvalidBuffer;
 	}
 
-	ereport(elevel,
-			(errmsg("\"%s\": removed %d row versions in %d pages",
-					vacrelstats->relname,
-					tupindex, npages),
-			 errdetail_internal("%s", pg_rusage_show(&ru0))));
+	if (lvshared)
+	{
+		pg_atomic_add_fetch_u32(&(lvshared->heap_ntuples), mytuples);
+		pg_atomic_add_fetch_u32(&(lvshared->heap_npages), mypages);
 
-	/* Revert to the previous phase information for error traceback */
-	restore_vacuum_error_info(vacrelstats, &saved_err_info);
+		/*
+		 * We have completed the heap vacuum so decrement the active worker
+		 * count.
+		 */
+		if (VacuumActiveNWorkers)
+			pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+	}
+
+	*ntuples = mytuples;
+	*npages = mypages;
 }
 
 /*
@@ -1917,18 +2304,18 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
  *
  * Caller must hold pin and buffer cleanup lock on the buffer.
  *
- * tupindex is the index in vacrelstats->dead_tuples of the first dead
- * tuple for this page.  We assume the rest follow sequentially.
- * The return value is the first tupindex after the tuples of this page.
+ * blockindex is the index of this page in vacrelstats->dead_tuples->blocks.
+ * The return value is the number of dead tuples freed.
  */
 static int
 lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer)
+				 int blockindex, LVRelStats *vacrelstats, Buffer *vmbuffer)
 {
 	LVDeadTuples *dead_tuples = vacrelstats->dead_tuples;
 	Page		page = BufferGetPage(buffer);
 	OffsetNumber unused[MaxOffsetNumber];
-	int			uncnt = 0;
+	int			uncnt;
+	int			i;
 	TransactionId visibility_cutoff_xid;
 	bool		all_frozen;
 	LVSavedErrInfo saved_err_info;
@@ -1939,21 +2326,17 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 	update_vacuum_error_info(vacrelstats, &saved_err_info, VACUUM_ERRCB_PHASE_VACUUM_HEAP,
 							 blkno, InvalidOffsetNumber);
 
+	Assert(dead_tuples->blocks[blockindex].blkno == blkno);
+	uncnt = lazy_get_dead_offsets(dead_tuples, blockindex, unused);
+
 	START_CRIT_SECTION();
 
-	for (; tupindex < dead_tuples->num_tuples; tupindex++)
+	for (i = 0; i < uncnt; i++)
 	{
-		BlockNumber tblk;
-		OffsetNumber toff;
 		ItemId		itemid;
 
-		tblk = ItemPointerGetBlockNumber(&dead_tuples->itemptrs[tupindex]);
-		if (tblk != blkno)
-			break;				/* past end of tuples for this block */
-		toff = ItemPointerGetOffsetNumber(&dead_tuples->itemptrs[tupindex]);
-		itemid = PageGetItemId(page, toff);
+		itemid = PageGetItemId(page, unused[i]);
 		ItemIdSetUnused(itemid);
-		unused[uncnt++] = toff;
 	}
 
 	PageRepairFragmentation(page);
@@ -2018,7 +2401,46 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 
 	/* Revert to the previous phase information for error traceback */
 	restore_vacuum_error_info(vacrelstats, &saved_err_info);
-	return tupindex;
+	return uncnt;
+}
+
+/*
+ *	lazy_check_wraparound_failsafe() -- switch to the failsafe if the table
+ *		is in danger of wraparound
+ *
+ * In failsafe mode we do only what's needed to advance relfrozenxid and
+ * relminmxid as soon as possible: no more index vacuuming or cleanup, no
+ * truncation, and no cost-based delay.  Returns true if the failsafe is
+ * active.
+ */
+static bool
+lazy_check_wraparound_failsafe(Relation onerel, LVRelStats *vacrelstats)
+{
+	if (vacrelstats->failsafe_active)
+		return true;
+
+	if (!vacuum_xid_failsafe_check(onerel->rd_rel->relfrozenxid,
+								   onerel->rd_rel->relminmxid))
+		return false;
+
+	vacrelstats->failsafe_active = true;
+	vacrelstats->useindex = false;
+
+	/* Disable the cost-based delay for the rest of this VACUUM */
+	VacuumCostActive = false;
+	VacuumCostBalance = 0;
+
+	ereport(WARNING,
+			(errmsg("bypassing nonessential maintenance of table \"%s.%s.%s\" as a failsafe after %d index scans",
+					get_database_name(MyDatabaseId),
+					vacrelstats->relnamespace,
+					vacrelstats->relname,
+					vacrelstats->num_index_scans),
+			 errdetail("The table's relfrozenxid or relminmxid is too far in the past."),
+			 errhint("Consider increasing configuration parameter \"maintenance_work_mem\" or \"autovacuum_work_mem\".\n"
+					 "You might also need to consider other ways for VACUUM to keep up with the allocation of transaction IDs.")));
+
+	return true;
 }
 
 /*
@@ -2571,7 +2993,8 @@ should_attempt_truncation(VacuumParams *params, LVRelStats *vacrelstats)
 {
 	BlockNumber possibly_freeable;
 
-	if (params->truncate == VACOPT_TERNARY_DISABLED)
+	if (params->truncate == VACOPT_TERNARY_DISABLED ||
+		vacrelstats->failsafe_active)
 		return false;
 
 	possibly_freeable = vacrelstats->rel_pages - vacrelstats->nonempty_pages;
@@ -2854,33 +3277,32 @@ count_nondeletable_pages(Relation onerel, LVRelStats *vacrelstats)
 }
 
 /*
- * Return the maximum number of dead tuples we can record.
+ * Return the size of the dead tuple space, not counting its fixed part.
  */
-static long
-compute_max_dead_tuples(BlockNumber relblocks, bool useindex)
+static Size
+compute_dead_tuples_space(BlockNumber relblocks, bool useindex)
 {
-	long		maxtuples;
+	Size		size;
 	int			vac_work_mem = IsAutoVacuumWorkerProcess() &&
 	autovacuum_work_mem != -1 ?
 	autovacuum_work_mem : maintenance_work_mem;
 
 	if (useindex)
 	{
-		maxtuples = MAXDEADTUPLES(vac_work_mem * 1024L);
-		maxtuples = Min(maxtuples, INT_MAX);
-		maxtuples = Min(maxtuples, MAXDEADTUPLES(MaxAllocSize));
+		size = (Size) vac_work_mem * 1024;
+		size = Min(size, MaxAllocSize - offsetof(LVDeadTuples, blocks));
 
-		/* curious coding here to ensure the multiplication can't overflow */
-		if ((BlockNumber) (maxtuples / LAZY_ALLOC_TUPLES) > relblocks)
-			maxtuples = relblocks * LAZY_ALLOC_TUPLES;
+		/* no more than every page can need; careful of overflow */
+		if (size / DEAD_BLOCK_MAX_SIZE > relblocks)
+			size = (Size) relblocks * DEAD_BLOCK_MAX_SIZE;
 
 		/* stay sane if small maintenance_work_mem */
-		maxtuples = Max(maxtuples, MaxHeapTuplesPerPage);
+		size = Max(size, DEAD_BLOCK_MAX_SIZE);
 	}
 	else
-		maxtuples = MaxHeapTuplesPerPage;
+		size = DEAD_BLOCK_MAX_SIZE;
 
-	return maxtuples;
+	return size;
 }
 
 /*
@@ -2892,35 +3314,150 @@ static void
 lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks)
 {
 	LVDeadTuples *dead_tuples = NULL;
-	long		maxtuples;
+	Size		size;
 
-	maxtuples = compute_max_dead_tuples(relblocks, vacrelstats->useindex);
+	size = compute_dead_tuples_space(relblocks, vacrelstats->useindex);
 
-	dead_tuples = (LVDeadTuples *) palloc(SizeOfDeadTuples(maxtuples));
-	dead_tuples->num_tuples = 0;
-	dead_tuples->max_tuples = (int) maxtuples;
+	dead_tuples = (LVDeadTuples *) palloc(SizeOfDeadTuples(size));
+	lazy_init_dead_tuples(dead_tuples, size);
 
 	vacrelstats->dead_tuples = dead_tuples;
 }
 
 /*
- * lazy_record_dead_tuple - remember one deletable tuple
+ * lazy_init_dead_tuples - set up an empty dead tuple space of the given size
+ */
+static void
+lazy_init_dead_tuples(LVDeadTuples *dead_tuples, Size size)
+{
+	dead_tuples->max_words = size / sizeof(uint16);
+	lazy_reset_dead_tuples(dead_tuples);
+}
+
+/*
+ * lazy_reset_dead_tuples - forget all the dead tuples
+ */
+static void
+lazy_reset_dead_tuples(LVDeadTuples *dead_tuples)
+{
+	dead_tuples->num_tuples = 0;
+	dead_tuples->num_blocks = 0;
+	dead_tuples->used_words = 0;
+}
+
+/*
+ * Get the first word of the offsets of the blockindex'th block, and return
+ * how many words they take.
+ */
+static inline uint32
+lazy_dead_block_words(LVDeadTuples *dead_tuples, int blockindex,
+					  uint32 *start)
+{
+	uint32		end;
+
+	*start = dead_tuples->blocks[blockindex].offsets & LVDB_OFFSETS_MASK;
+	if (blockindex == 0)
+		end = dead_tuples->max_words;
+	else
+		end = dead_tuples->blocks[blockindex - 1].offsets & LVDB_OFFSETS_MASK;
+
+	return end - *start;
+}
+
+/*
+ * lazy_record_dead_tuples - remember the deletable tuples of a page
+ *
+ * offsets must be in ascending order, and blocks must be recorded in
+ * ascending order.
  */
 static void
-lazy_record_dead_tuple(LVDeadTuples *dead_tuples, ItemPointer itemptr)
+lazy_record_dead_tuples(LVDeadTuples *dead_tuples, BlockNumber blkno,
+						OffsetNumber *offsets, int noffsets)
 {
+	uint16	   *words = DeadTuplesWords(dead_tuples);
+	LVDeadBlock *block;
+	uint32		nbitmapwords;
+	uint32		nwords;
+	uint32		start;
+	int			i;
+
+	Assert(noffsets > 0);
+	Assert(dead_tuples->num_blocks == 0 ||
+		   dead_tuples->blocks[dead_tuples->num_blocks - 1].blkno < blkno);
+
+	/* Store a bitmap if that's smaller than the array */
+	nbitmapwords = (offsets[noffsets - 1] - 1) / DEAD_BITS_PER_WORD + 1;
+	nwords = Min((uint32) noffsets, nbitmapwords);
+
 	/*
-	 * The array shouldn't overflow under normal behavior, but perhaps it
-	 * could if we are given a really small maintenance_work_mem. In that
-	 * case, just forget the last few tuples (we'll get 'em next time).
+	 * The space shouldn't overflow under normal behavior, as the caller
+	 * leaves room for a page, but perhaps it could if we are given a really
+	 * small maintenance_work_mem.  In that case, just forget the tuples
+	 * (we'll get 'em next time).
 	 */
-	if (dead_tuples->num_tuples < dead_tuples->max_tuples)
+	if (DeadTuplesFreeWords(dead_tuples) <
+		sizeof(LVDeadBlock) / sizeof(uint16) + nwords)
+		return;
+
+	dead_tuples->used_words += nwords;
+	start = dead_tuples->max_words - dead_tuples->used_words;
+
+	block = &dead_tuples->blocks[dead_tuples->num_blocks++];
+	block->blkno = blkno;
+	block->offsets = start;
+	if (nwords < (uint32) noffsets)
 	{
-		dead_tuples->itemptrs[dead_tuples->num_tuples] = *itemptr;
-		dead_tuples->num_tuples++;
-		pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
-									 dead_tuples->num_tuples);
+		block->offsets |= LVDB_BITMAP;
+		memset(&words[start], 0, nwords * sizeof(uint16));
+		for (i = 0; i < noffsets; i++)
+			words[start + (offsets[i] - 1) / DEAD_BITS_PER_WORD] |=
+				1 << ((offsets[i] - 1) % DEAD_BITS_PER_WORD);
 	}
+	else
+		memcpy(&words[start], offsets, noffsets * sizeof(OffsetNumber));
+
+	dead_tuples->num_tuples += noffsets;
+	pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
+								 dead_tuples->num_tuples);
+}
+
+/*
+ * lazy_get_dead_offsets - get the dead offsets of the blockindex'th block
+ *
+ * They're stored in ascending order in offsets[], which must have room for
+ * MaxHeapTuplesPerPage of them, and their number is returned.
+ */
+static int
+lazy_get_dead_offsets(LVDeadTuples *dead_tuples, int blockindex,
+					  OffsetNumber *offsets)
+{
+	uint16	   *words = DeadTuplesWords(dead_tuples);
+	uint32		start;
+	uint32		nwords;
+	uint32		i;
+	int			noffsets = 0;
+
+	nwords = lazy_dead_block_words(dead_tuples, blockindex, &start);
+
+	if ((dead_tuples->blocks[blockindex].offsets & LVDB_BITMAP) == 0)
+	{
+		memcpy(offsets, &words[start], nwords * sizeof(OffsetNumber));
+		return nwords;
+	}
+
+	for (i = 0; i < nwords; i++)
+	{
+		uint16		word = words[start + i];
+		int			bit;
+
+		for (bit = 0; word != 0; bit++, word >>= 1)
+		{
+			if (word & 1)
+				offsets[noffsets++] = i * DEAD_BITS_PER_WORD + bit + 1;
+		}
+	}
+
+	return noffsets;
 }
 
 /*
@@ -2928,51 +3465,65 @@ lazy_record_dead_tuple(LVDeadTuples *dead_tuples, ItemPointer itemptr)
  *
  *		This has the right signature to be an IndexBulkDeleteCallback.
  *
- *		Assumes dead_tuples array is in sorted order.
+ *		Binary searches the blocks, then tests the bitmap or binary searches
+ *		the offsets of the block.
  */
 static bool
 lazy_tid_reaped(ItemPointer itemptr, void *state)
 {
 	LVDeadTuples *dead_tuples = (LVDeadTuples *) state;
-	ItemPointer res;
+	uint16	   *words = DeadTuplesWords(dead_tuples);
+	BlockNumber blkno = ItemPointerGetBlockNumber(itemptr);
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(itemptr);
+	int			lo,
+				hi;
+	uint32		start;
+	uint32		nwords;
+
+	/* Most index tuples point to blocks we have no dead tuples on */
+	if (dead_tuples->num_blocks == 0 ||
+		blkno < dead_tuples->blocks[0].blkno ||
+		blkno > dead_tuples->blocks[dead_tuples->num_blocks - 1].blkno)
+		return false;
 
-	res = (ItemPointer) bsearch((void *) itemptr,
-								(void *) dead_tuples->itemptrs,
-								dead_tuples->num_tuples,
-								sizeof(ItemPointerData),
-								vac_cmp_itemptr);
+	lo = 0;
+	hi = dead_tuples->num_blocks;
+	while (lo < hi)
+	{
+		int			mid = lo + (hi - lo) / 2;
 
-	return (res != NULL);
-}
+		if (dead_tuples->blocks[mid].blkno < blkno)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo >= dead_tuples->num_blocks ||
+		dead_tuples->blocks[lo].blkno != blkno)
+		return false;
 
-/*
- * Comparator routines for use with qsort() and bsearch().
- */
-static int
-vac_cmp_itemptr(const void *left, const void *right)
-{
-	BlockNumber lblk,
-				rblk;
-	OffsetNumber loff,
-				roff;
+	nwords = lazy_dead_block_words(dead_tuples, lo, &start);
 
-	lblk = ItemPointerGetBlockNumber((ItemPointer) left);
-	rblk = ItemPointerGetBlockNumber((ItemPointer) right);
+	if (dead_tuples->blocks[lo].offsets & LVDB_BITMAP)
+	{
+		uint32		word = (offnum - 1) / DEAD_BITS_PER_WORD;
 
-	if (lblk < rblk)
-		return -1;
-	if (lblk > rblk)
-		return 1;
+		return word < nwords &&
+			(words[start + word] & (1 << ((offnum - 1) % DEAD_BITS_PER_WORD))) != 0;
+	}
 
-	loff = ItemPointerGetOffsetNumber((ItemPointer) left);
-	roff = ItemPointerGetOffsetNumber((ItemPointer) right);
+	lo = 0;
+	hi = nwords;
+	while (lo < hi)
+	{
+		int			mid = lo + (hi - lo) / 2;
 
-	if (loff < roff)
-		return -1;
-	if (loff > roff)
-		return 1;
+		if (words[start + mid] < offnum)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
 
-	return 0;
+	return lo < nwords && words[start + lo] == offnum;
 }
 
 /*
@@ -3096,6 +3647,82 @@ heap_page_is_all_visible(Relation rel, Buffer buf,
 	return all_visible;
 }
 
+/*
+ *	heap_vacuum_set_visible() -- set visibility map bits on a range of pages
+ *
+ * This is a much lighter relative of lazy_scan_heap(), which autovacuum runs
+ * on request for pages that index-only scans had to visit.  It removes and
+ * freezes nothing; it only marks pages all-visible, and all-frozen if they
+ * happen to be, when every tuple on them is already visible to everyone.
+ * Pages that need any real vacuuming are left for VACUUM.  The caller must
+ * hold ShareUpdateExclusiveLock on the relation.
+ *
+ * Returns the number of pages marked all-visible.
+ */
+BlockNumber
+heap_vacuum_set_visible(Relation onerel, BlockNumber start, BlockNumber nblocks,
+						BufferAccessStrategy bstrategy)
+{
+	LVRelStats	vacrelstats;
+	Buffer		vmbuffer = InvalidBuffer;
+	BlockNumber relpages;
+	BlockNumber blkno;
+	BlockNumber nset = 0;
+
+	/* heap_page_is_all_visible only uses this to track the offset */
+	memset(&vacrelstats, 0, sizeof(vacrelstats));
+	OldestXmin = GetOldestNonRemovableTransactionId(onerel);
+
+	relpages = RelationGetNumberOfBlocks(onerel);
+	if (start >= relpages)
+		return 0;
+	nblocks = Min(nblocks, relpages - start);
+
+	for (blkno = start; blkno < start + nblocks; blkno++)
+	{
+		Buffer		buf;
+		Page		page;
+		TransactionId visibility_cutoff_xid;
+		bool		all_frozen;
+
+		vacuum_delay_point();
+
+		if (VM_ALL_VISIBLE(onerel, blkno, &vmbuffer))
+			continue;
+
+		/* pin the visibility map page before locking the heap page */
+		visibilitymap_pin(onerel, blkno, &vmbuffer);
+
+		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+								 bstrategy);
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buf);
+
+		if (!PageIsNew(page) && !PageIsEmpty(page) && !PageIsAllVisible(page) &&
+			heap_page_is_all_visible(onerel, buf, &vacrelstats,
+									 &visibility_cutoff_xid, &all_frozen))
+		{
+			uint8		flags = VISIBILITYMAP_ALL_VISIBLE;
+
+			if (all_frozen)
+				flags |= VISIBILITYMAP_ALL_FROZEN;
+
+			PageSetAllVisible(page);
+			MarkBufferDirty(buf);
+			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
+							  vmbuffer, visibility_cutoff_xid, flags);
+			nset++;
+		}
+
+		UnlockReleaseBuffer(buf);
+	}
+
+	if (BufferIsValid(vmbuffer))
+		ReleaseBuffer(vmbuffer);
+
+	return nset;
+}
+
 /*
  * Compute the number of parallel worker processes to request.  Both index
  * vacuum and index cleanup can be executed with parallel workers.  The index
@@ -3237,7 +3864,7 @@ begin_parallel_vacuum(Oid relid, Relation *Irel, LVRelStats *vacrelstats,
 	BufferUsage *buffer_usage;
 	WalUsage   *wal_usage;
 	bool	   *can_parallel_vacuum;
-	long		maxtuples;
+	Size		dead_space;
 	char	   *sharedquery;
 	Size		est_shared;
 	Size		est_deadtuples;
@@ -3314,8 +3941,8 @@ begin_parallel_vacuum(Oid relid, Relation *Irel, LVRelStats *vacrelstats,
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 
 	/* Estimate size for dead tuples -- PARALLEL_VACUUM_KEY_DEAD_TUPLES */
-	maxtuples = compute_max_dead_tuples(nblocks, true);
-	est_deadtuples = MAXALIGN(SizeOfDeadTuples(maxtuples));
+	dead_space = compute_dead_tuples_space(nblocks, true);
+	est_deadtuples = MAXALIGN(SizeOfDeadTuples(dead_space));
 	shm_toc_estimate_chunk(&pcxt->estimator, est_deadtuples);
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 
@@ -3354,6 +3981,9 @@ begin_parallel_vacuum(Oid relid, Relation *Irel, LVRelStats *vacrelstats,
 	pg_atomic_init_u32(&(shared->cost_balance), 0);
 	pg_atomic_init_u32(&(shared->active_nworkers), 0);
 	pg_atomic_init_u32(&(shared->idx), 0);
+	pg_atomic_init_u32(&(shared->heap_blockindex), 0);
+	pg_atomic_init_u32(&(shared->heap_ntuples), 0);
+	pg_atomic_init_u32(&(shared->heap_npages), 0);
 	shared->offset = MAXALIGN(add_size(SizeOfLVShared, BITMAPLEN(nindexes)));
 	prepare_index_statistics(shared, can_parallel_vacuum, nindexes);
 
@@ -3362,9 +3992,7 @@ begin_parallel_vacuum(Oid relid, Relation *Irel, LVRelStats *vacrelstats,
 
 	/* Prepare the dead tuple space */
 	dead_tuples = (LVDeadTuples *) shm_toc_allocate(pcxt->toc, est_deadtuples);
-	dead_tuples->max_tuples = maxtuples;
-	dead_tuples->num_tuples = 0;
-	MemSet(dead_tuples->itemptrs, 0, sizeof(ItemPointerData) * maxtuples);
+	lazy_init_dead_tuples(dead_tuples, dead_space);
 	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_DEAD_TUPLES, dead_tuples);
 	vacrelstats->dead_tuples = dead_tuples;
 
@@ -3524,6 +4152,7 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 
 	ereport(DEBUG1,
 			(errmsg("starting parallel vacuum worker for %s",
+					lvshared->vacuum_heap ? "heap vacuum" :
 					lvshared->for_cleanup ? "cleanup" : "bulk delete")));
 
 	/* Set debug_query_string for individual workers */
@@ -3584,9 +4213,28 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	/* Prepare to track buffer usage during parallel execution */
 	InstrStartParallelQuery();
 
-	/* Process indexes to perform vacuum/cleanup */
-	parallel_vacuum_index(indrels, stats, lvshared, dead_tuples, nindexes,
-						  &vacrelstats);
+	if (lvshared->vacuum_heap)
+	{
+		int			ntuples;
+		int			npages;
+
+		/* Remove dead tuples from the heap, as in the leader */
+		vac_strategy = GetAccessStrategy(BAS_VACUUM);
+		OldestXmin = lvshared->oldest_xmin;
+		vacrelstats.dead_tuples = dead_tuples;
+		vacrelstats.latestRemovedXid = lvshared->latest_removed_xid;
+		vacrelstats.blkno = InvalidBlockNumber;
+		vacrelstats.offnum = InvalidOffsetNumber;
+		vacrelstats.phase = VACUUM_ERRCB_PHASE_VACUUM_HEAP;
+		lazy_vacuum_heap_blocks(onerel, &vacrelstats, lvshared,
+								&ntuples, &npages);
+	}
+	else
+	{
+		/* Process indexes to perform vacuum/cleanup */
+		parallel_vacuum_index(indrels, stats, lvshared, dead_tuples, nindexes,
+							  &vacrelstats);
+	}
 
 	/* Report buffer/WAL usage during parallel execution */
 	buffer_usage = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_BUFFER_USAGE, false);
@@ -3695,3 +4343,42 @@ restore_vacuum_error_info(LVRelStats *errinfo, const LVSavedErrInfo *saved_err_i
 	errinfo->offnum = saved_err_info->offnum;
 	errinfo->phase = saved_err_info->phase;
 }
+
+/*
+ * lazy_readahead_next - ReadAheadCallback for lazy_scan_heap
+ *
+ * Predicts the pages that are not all-visible, or not all-frozen in an
+ * aggressive vacuum, according to the visibility map.  lazy_scan_heap reads
+ * those and may also read the pages of short all-visible runs; those just
+ * aren't prefetched.  Like lazy_scan_heap, we don't mind if the visibility
+ * map changes under us; the predictions are only hints.
+ */
+static BlockNumber
+lazy_readahead_next(void *callback_arg)
+{
+	LVReadAheadState *state = (LVReadAheadState *) callback_arg;
+
+	while (state->next_block < state->nblocks)
+	{
+		BlockNumber blkno = state->next_block++;
+		uint8		vmstatus;
+
+		if (!state->skip_pages)
+			return blkno;
+
+		vmstatus = visibilitymap_get_status(state->onerel, blkno,
+											&state->vmbuffer);
+		if (state->aggressive)
+		{
+			if ((vmstatus & VISIBILITYMAP_ALL_FROZEN) == 0)
+				return blkno;
+		}
+		else
+		{
+			if ((vmstatus & VISIBILITYMAP_ALL_VISIBLE) == 0)
+				return blkno;
+		}
+	}
+
+	return InvalidBlockNumber;
+}
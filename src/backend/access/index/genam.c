@@ -86,6 +86,9 @@ RelationGetIndexScan(Relation indexRelation, int nkeys, int norderbys)
 
 	scan->heapRelation = NULL;	/* may be set later */
 	scan->xs_heapfetch = NULL;
+	scan->xs_prefetch_distance = 0;	/* set by index_beginscan */
+	scan->xs_prefetch_maximum = 0;
+	scan->xs_prefetch_block = InvalidBlockNumber;
 	scan->indexRelation = indexRelation;
 	scan->xs_snapshot = InvalidSnapshot;	/* caller must initialize this */
 	scan->numberOfKeys = nkeys;
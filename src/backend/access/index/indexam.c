@@ -26,6 +26,7 @@
  *		index_beginscan_parallel - join parallel index scan
  *		index_getnext_tid	- get the next TID from a scan
  *		index_fetch_heap		- get the scan's next heap tuple
+ *		index_prefetch_heap	- prefetch a heap page the scan will visit
  *		index_getnext_slot	- get the next tuple from a scan
  *		index_getbitmap - get all tuples from a scan
  *		index_bulk_delete	- bulk deletion of index tuples
@@ -50,7 +51,9 @@
 #include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xlog.h"
+#include "catalog/catalog.h"
 #include "catalog/index.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_amproc.h"
 #include "catalog/pg_type.h"
 #include "commands/defrem.h"
@@ -61,6 +64,7 @@
 #include "storage/predicate.h"
 #include "utils/ruleutils.h"
 #include "utils/snapmgr.h"
+#include "utils/spccache.h"
 #include "utils/syscache.h"
 
 
@@ -107,6 +111,7 @@ do { \
 static IndexScanDesc index_beginscan_internal(Relation indexRelation,
 											  int nkeys, int norderbys, Snapshot snapshot,
 											  ParallelIndexScanDesc pscan, bool temp_snap);
+static void index_prefetch_begin(IndexScanDesc scan);
 
 
 /* ----------------------------------------------------------------
@@ -194,6 +199,36 @@ index_insert(Relation indexRelation,
 											 checkUnique, indexInfo);
 }
 
+/* ----------------
+ *		index_insert_multi - insert several index tuples into a relation
+ *
+ * Only for index AMs that provide aminsertmulti, and only when no
+ * uniqueness checking is needed.  values[i] and isnull[i] describe the
+ * index tuple for the heap tuple at heap_t_ctids[i].
+ * ----------------
+ */
+void
+index_insert_multi(Relation indexRelation,
+				   Datum **values,
+				   bool **isnull,
+				   ItemPointer heap_t_ctids,
+				   int ntuples,
+				   Relation heapRelation,
+				   IndexInfo *indexInfo)
+{
+	RELATION_CHECKS;
+	CHECK_REL_PROCEDURE(aminsertmulti);
+
+	if (!(indexRelation->rd_indam->ampredlocks))
+		CheckForSerializableConflictIn(indexRelation,
+									   (ItemPointer) NULL,
+									   InvalidBlockNumber);
+
+	indexRelation->rd_indam->aminsertmulti(indexRelation, values, isnull,
+										   heap_t_ctids, ntuples,
+										   heapRelation, indexInfo);
+}
+
 /*
  * index_beginscan - start a scan of an index with amgettuple
  *
@@ -218,6 +253,7 @@ index_beginscan(Relation heapRelation,
 
 	/* prepare to fetch index matches from table */
 	scan->xs_heapfetch = table_index_fetch_begin(heapRelation);
+	index_prefetch_begin(scan);
 
 	return scan;
 }
@@ -308,6 +344,7 @@ index_rescan(IndexScanDesc scan,
 
 	scan->kill_prior_tuple = false; /* for safety */
 	scan->xs_heap_continue = false;
+	scan->xs_prefetch_block = InvalidBlockNumber;
 
 	scan->indexRelation->rd_indam->amrescan(scan, keys, nkeys,
 											orderbys, norderbys);
@@ -500,6 +537,7 @@ index_beginscan_parallel(Relation heaprel, Relation indexrel, int nkeys,
 
 	/* prepare to fetch index matches from table */
 	scan->xs_heapfetch = table_index_fetch_begin(heaprel);
+	index_prefetch_begin(scan);
 
 	return scan;
 }
@@ -595,6 +633,66 @@ index_fetch_heap(IndexScanDesc scan, TupleTableSlot *slot)
 	return found;
 }
 
+/*
+ * index_prefetch_begin - set up heap prefetching for an index scan
+ *
+ * The prefetch distance is limited by the heap's effective_io_concurrency.
+ * Only heap tables are prefetched from, as other table AMs' TIDs need not
+ * be block numbers.  Catalogs are not prefetched from either: looking up
+ * the tablespace's io_concurrency may itself scan pg_tablespace, which
+ * would recurse back here.
+ */
+static void
+index_prefetch_begin(IndexScanDesc scan)
+{
+	scan->xs_prefetch_distance = 0;
+	scan->xs_prefetch_maximum = 0;
+	scan->xs_prefetch_block = InvalidBlockNumber;
+
+#ifdef USE_PREFETCH
+	if (scan->heapRelation->rd_rel->relam == HEAP_TABLE_AM_OID &&
+		!IsCatalogRelation(scan->heapRelation))
+	{
+		scan->xs_prefetch_maximum =
+			get_tablespace_io_concurrency(scan->heapRelation->rd_rel->reltablespace);
+		if (scan->xs_prefetch_maximum > 0)
+			scan->xs_prefetch_distance = 1;
+	}
+#endif
+}
+
+/* ----------------
+ *		index_prefetch_heap - prefetch a heap page the scan will visit
+ *
+ * Index AMs that have TIDs buffered ahead of the one they are returning can
+ * call this for the upcoming TIDs, in scan order, up to
+ * scan->xs_prefetch_distance TIDs ahead (zero means don't prefetch).
+ *
+ * The distance adapts to how often the pages are found in shared buffers
+ * already: it doubles, up to the maximum, whenever a prefetch has to start
+ * a read, and shrinks by one for each one that didn't.  A scan of cached
+ * data thus settles at looking one TID ahead.
+ * ----------------
+ */
+void
+index_prefetch_heap(IndexScanDesc scan, ItemPointer tid)
+{
+	BlockNumber blkno = ItemPointerGetBlockNumber(tid);
+	PrefetchBufferResult result;
+
+	/* consecutive TIDs are often on the same page */
+	if (blkno == scan->xs_prefetch_block)
+		return;
+	scan->xs_prefetch_block = blkno;
+
+	result = PrefetchBuffer(scan->heapRelation, MAIN_FORKNUM, blkno);
+	if (result.initiated_io)
+		scan->xs_prefetch_distance = Min(scan->xs_prefetch_distance * 2,
+										 scan->xs_prefetch_maximum);
+	else if (scan->xs_prefetch_distance > 1)
+		scan->xs_prefetch_distance--;
+}
+
 /* ----------------
  *		index_getnext_slot - get the next tuple from a scan
  *
@@ -28,7 +28,16 @@
 /* Minimum tree height for application of fastpath optimization */
 #define BTREE_FASTPATH_MIN_LEVEL	2
 
+/* State for _bt_sort_tuples_cmp */
+typedef struct BTSortTupleContext
+{
+	TupleDesc	itupdesc;
+	int			nkeyatts;
+	BTScanInsert sortkey;		/* provides the comparison procs */
+} BTSortTupleContext;
+
 
+static int	_bt_sort_tuples_cmp(const void *a, const void *b, void *arg);
 static BTStack _bt_search_insert(Relation rel, BTInsertState insertstate);
 static TransactionId _bt_check_unique(Relation rel, BTInsertState insertstate,
 									  Relation heapRel,
@@ -49,6 +58,8 @@ static void _bt_insertonpg(Relation rel, BTScanInsert itup_key,
 						   OffsetNumber newitemoff,
 						   int postingoff,
 						   bool split_only_page);
+static int	_bt_insertonpg_multi(Relation rel, BTInsertState insertstate,
+								 IndexTuple *itups, int nitups);
 static Buffer _bt_split(Relation rel, BTScanInsert itup_key, Buffer buf,
 						Buffer cbuf, OffsetNumber newitemoff, Size newitemsz,
 						IndexTuple newitem, IndexTuple orignewitem,
@@ -254,6 +265,150 @@ search:
 	return is_unique;
 }
 
+/*
+ *	_bt_doinsert_multi() -- Handle insertion of several index tuples.
+ *
+ *		This routine is called by the public interface routine,
+ *		btinsertmulti, when no uniqueness checking is needed.  By here, the
+ *		tuples are filled in, including their TIDs.
+ *
+ *		The tuples are sorted in index order first, so that each run of
+ *		tuples that belong on the same leaf page can be added to it at once
+ *		by _bt_insertonpg_multi, under a single buffer lock and with a
+ *		single WAL record.  Each run starts with a regular descent of the
+ *		tree.  A tuple that can't start a run, because its page is full or
+ *		it overlaps with a posting list, is inserted the same way as by
+ *		_bt_doinsert, which may involve deduplication or a page split.
+ */
+void
+_bt_doinsert_multi(Relation rel, IndexTuple *itups, int nitups,
+				   Relation heapRel)
+{
+	BTSortTupleContext cxt;
+	bool		heapkeyspace;
+	bool		allequalimage;
+	int			i;
+
+	/*
+	 * Without heapkeyspace, tuples with equal keys can go on any of several
+	 * leaf pages, and the run logic doesn't know how to choose between them.
+	 * Insert the tuples one by one instead.
+	 */
+	_bt_metaversion(rel, &heapkeyspace, &allequalimage);
+	if (!heapkeyspace)
+	{
+		for (i = 0; i < nitups; i++)
+			_bt_doinsert(rel, itups[i], UNIQUE_CHECK_NO, heapRel);
+		return;
+	}
+
+	cxt.itupdesc = RelationGetDescr(rel);
+	cxt.nkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
+	cxt.sortkey = _bt_mkscankey(rel, NULL);
+	qsort_arg(itups, nitups, sizeof(IndexTuple), _bt_sort_tuples_cmp, &cxt);
+	pfree(cxt.sortkey);
+
+	i = 0;
+	while (i < nitups)
+	{
+		BTInsertStateData insertstate;
+		BTStack		stack;
+		int			ninserted;
+
+		insertstate.itup = itups[i];
+		insertstate.itemsz = MAXALIGN(IndexTupleSize(itups[i]));
+		insertstate.itup_key = _bt_mkscankey(rel, itups[i]);
+		insertstate.bounds_valid = false;
+		insertstate.buf = InvalidBuffer;
+		insertstate.postingoff = 0;
+
+		stack = _bt_search_insert(rel, &insertstate);
+
+		/* see _bt_doinsert */
+		CheckForSerializableConflictIn(rel, NULL,
+									   BufferGetBlockNumber(insertstate.buf));
+
+		ninserted = _bt_insertonpg_multi(rel, &insertstate, itups + i,
+										 nitups - i);
+		if (ninserted == 0)
+		{
+			OffsetNumber newitemoff;
+
+			newitemoff = _bt_findinsertloc(rel, &insertstate, false, stack,
+										   heapRel);
+			_bt_insertonpg(rel, insertstate.itup_key, insertstate.buf,
+						   InvalidBuffer, stack, itups[i],
+						   insertstate.itemsz, newitemoff,
+						   insertstate.postingoff, false);
+			ninserted = 1;
+		}
+
+		if (stack)
+			_bt_freestack(stack);
+		pfree(insertstate.itup_key);
+
+		i += ninserted;
+	}
+}
+
+/*
+ * qsort_arg comparator for sorting index tuples in index order, keys first
+ * and heap TID as a tiebreaker, like _bt_compare would place them.
+ */
+static int
+_bt_sort_tuples_cmp(const void *a, const void *b, void *arg)
+{
+	IndexTuple	itup1 = *((const IndexTuple *) a);
+	IndexTuple	itup2 = *((const IndexTuple *) b);
+	BTSortTupleContext *cxt = (BTSortTupleContext *) arg;
+	ScanKey		scankey = cxt->sortkey->scankeys;
+	int			i;
+
+	for (i = 1; i <= cxt->nkeyatts; i++, scankey++)
+	{
+		Datum		datum1,
+					datum2;
+		bool		isNull1,
+					isNull2;
+		int32		result;
+
+		datum1 = index_getattr(itup1, i, cxt->itupdesc, &isNull1);
+		datum2 = index_getattr(itup2, i, cxt->itupdesc, &isNull2);
+
+		if (isNull1)
+		{
+			if (isNull2)
+				result = 0;		/* NULL "=" NULL */
+			else if (scankey->sk_flags & SK_BT_NULLS_FIRST)
+				result = -1;	/* NULL "<" NOT_NULL */
+			else
+				result = 1;		/* NULL ">" NOT_NULL */
+		}
+		else if (isNull2)
+		{
+			if (scankey->sk_flags & SK_BT_NULLS_FIRST)
+				result = 1;		/* NOT_NULL ">" NULL */
+			else
+				result = -1;	/* NOT_NULL "<" NULL */
+		}
+		else
+		{
+			result = DatumGetInt32(FunctionCall2Coll(&scankey->sk_func,
+													 scankey->sk_collation,
+													 datum1,
+													 datum2));
+
+			if (scankey->sk_flags & SK_BT_DESC)
+				INVERT_COMPARE_RESULT(result);
+		}
+
+		if (result != 0)
+			return result;
+	}
+
+	return ItemPointerCompare(&itup1->t_tid, &itup2->t_tid);
+}
+
 /*
  *	_bt_search_insert() -- _bt_search() wrapper for inserts
  *
@@ -1413,6 +1568,148 @@ _bt_insertonpg(Relation rel,
 	}
 }
 
+/*
+ *	_bt_insertonpg_multi() -- Insert a run of tuples on a leaf page.
+ *
+ *		insertstate->buf is the write-locked leaf page that the first of the
+ *		sorted tuples in itups belongs on, as located by _bt_search_insert.
+ *		Add the longest prefix of itups that belong on the same page and fit
+ *		on it without splitting it, deduplicating, or splitting a posting
+ *		list, and log them in a single XLOG_BTREE_INSERT_MULTI record.
+ *
+ *		Returns the number of tuples inserted.  If any, the buffer has been
+ *		released.  Otherwise nothing has been done, and caller must insert
+ *		the first tuple the regular way.  insertstate is left alone either
+ *		way.
+ */
+static int
+_bt_insertonpg_multi(Relation rel, BTInsertState insertstate,
+					 IndexTuple *itups, int nitups)
+{
+	Buffer		buf = insertstate->buf;
+	Page		page = BufferGetPage(buf);
+	BTPageOpaque lpageop = (BTPageOpaque) PageGetSpecialPointer(page);
+	OffsetNumber offsets[MaxIndexTuplesPerPage];
+	Size		freespace = PageGetFreeSpace(page);
+	Size		needed = 0;
+	OffsetNumber prevoff = InvalidOffsetNumber;
+	BlockNumber blockcache;
+	char	   *tupdata;
+	char	   *ptr;
+	int			ntups;
+	int			i;
+
+	Assert(P_ISLEAF(lpageop) && !P_INCOMPLETE_SPLIT(lpageop));
+
+	/*
+	 * Find out how many tuples go in, and where.  Since the tuples are in
+	 * index order, each one goes after the ones before it, so its final
+	 * offset is its offset on the page as it is now, plus the number of run
+	 * tuples before it.
+	 */
+	for (ntups = 0; ntups < nitups; ntups++)
+	{
+		BTInsertStateData state;
+		OffsetNumber off = InvalidOffsetNumber;
+
+		state.itup = itups[ntups];
+		state.itemsz = MAXALIGN(IndexTupleSize(itups[ntups]));
+		state.itup_key = (ntups == 0 ? insertstate->itup_key :
+						  _bt_mkscankey(rel, itups[ntups]));
+		state.bounds_valid = false;
+		state.buf = buf;
+		state.postingoff = 0;
+
+		/*
+		 * The descent established that the first tuple belongs here, and
+		 * later ones don't sort before it.  They belong here too unless they
+		 * sort after the high key.
+		 */
+		if (state.itemsz <= BTMaxItemSize(page) &&
+			needed + state.itemsz + ntups * sizeof(ItemIdData) <= freespace &&
+			(ntups == 0 || P_RIGHTMOST(lpageop) ||
+			 _bt_compare(rel, state.itup_key, page, P_HIKEY) <= 0))
+		{
+			off = _bt_binsrch_insert(rel, &state);
+			if (state.postingoff != 0 || off < prevoff)
+				off = InvalidOffsetNumber;
+		}
+
+		if (ntups > 0)
+			pfree(state.itup_key);
+		if (off == InvalidOffsetNumber)
+			break;
+
+		Assert(ntups < MaxIndexTuplesPerPage);
+		offsets[ntups] = off + ntups;
+		needed += state.itemsz;
+		prevoff = off;
+	}
+
+	if (ntups == 0)
+		return 0;
+
+	/* Gather the tuples for the WAL record, as for heap_multi_insert */
+	tupdata = palloc0(needed);
+	ptr = tupdata;
+	for (i = 0; i < ntups; i++)
+	{
+		memcpy(ptr, itups[i], IndexTupleSize(itups[i]));
+		ptr += MAXALIGN(IndexTupleSize(itups[i]));
+	}
+
+	/* Do the update.  No ereport(ERROR) until changes are logged */
+	START_CRIT_SECTION();
+
+	for (i = 0; i < ntups; i++)
+	{
+		if (PageAddItem(page, (Item) itups[i], IndexTupleSize(itups[i]),
+						offsets[i], false, false) == InvalidOffsetNumber)
+			elog(PANIC, "failed to add new item to block %u in index \"%s\"",
+				 BufferGetBlockNumber(buf), RelationGetRelationName(rel));
+	}
+
+	MarkBufferDirty(buf);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+	{
+		xl_btree_insert_multi xlrec;
+		XLogRecPtr	recptr;
+
+		xlrec.ntuples = ntups;
+
+		XLogBeginInsert();
+		XLogRegisterData((char *) &xlrec, SizeOfBtreeInsertMulti);
+
+		XLogRegisterBuffer(0, buf, REGBUF_STANDARD);
+		XLogRegisterBufData(0, tupdata, needed);
+		XLogRegisterBufData(0, (char *) offsets,
+							ntups * sizeof(OffsetNumber));
+
+		recptr = XLogInsert(RM_BTREE_ID, XLOG_BTREE_INSERT_MULTI);
+
+		PageSetLSN(page, recptr);
+	}
+
+	END_CRIT_SECTION();
+
+	pfree(tupdata);
+
+	/* Maintain the rightmost leaf page cache, like _bt_insertonpg */
+	blockcache = InvalidBlockNumber;
+	if (P_RIGHTMOST(lpageop) && !P_ISROOT(lpageop))
+		blockcache = BufferGetBlockNumber(buf);
+
+	_bt_relbuf(rel, buf);
+
+	if (BlockNumberIsValid(blockcache) &&
+		_bt_getrootheight(rel) >= BTREE_FASTPATH_MIN_LEVEL)
+		RelationSetTargetBlock(rel, blockcache);
+
+	return ntups;
+}
+
 /*
  *	_bt_split() -- split a page in the btree.
  *
@@ -124,8 +124,10 @@ bthandler(PG_FUNCTION_ARGS)
 	amroutine->amclusterable = true;
 	amroutine->ampredlocks = true;
 	amroutine->amcanparallel = true;
+	amroutine->amcanbuildparallel = true;
 	amroutine->amcaninclude = true;
 	amroutine->amusemaintenanceworkmem = false;
+	amroutine->amsummarizing = false;
 	amroutine->amparallelvacuumoptions =
 		VACUUM_OPTION_PARALLEL_BULKDEL | VACUUM_OPTION_PARALLEL_COND_CLEANUP;
 	amroutine->amkeytype = InvalidOid;
@@ -133,6 +135,7 @@ bthandler(PG_FUNCTION_ARGS)
 	amroutine->ambuild = btbuild;
 	amroutine->ambuildempty = btbuildempty;
 	amroutine->aminsert = btinsert;
+	amroutine->aminsertmulti = btinsertmulti;
 	amroutine->ambulkdelete = btbulkdelete;
 	amroutine->amvacuumcleanup = btvacuumcleanup;
 	amroutine->amcanreturn = btcanreturn;
@@ -215,6 +218,33 @@ btinsert(Relation rel, Datum *values, bool *isnull,
 	return result;
 }
 
+/*
+ *	btinsertmulti() -- insert several index tuples, without uniqueness checks
+ */
+void
+btinsertmulti(Relation rel, Datum **values, bool **isnull,
+			  ItemPointer ht_ctids, int ntuples, Relation heapRel,
+			  IndexInfo *indexInfo)
+{
+	IndexTuple *itups;
+	int			i;
+
+	/* generate the index tuples */
+	itups = palloc(ntuples * sizeof(IndexTuple));
+	for (i = 0; i < ntuples; i++)
+	{
+		itups[i] = index_form_tuple(RelationGetDescr(rel), values[i],
+									isnull[i]);
+		itups[i]->t_tid = ht_ctids[i];
+	}
+
+	_bt_doinsert_multi(rel, itups, ntuples, heapRel);
+
+	for (i = 0; i < ntuples; i++)
+		pfree(itups[i]);
+	pfree(itups);
+}
+
 /*
  *	btgettuple() -- Get the next tuple in the scan.
  */
@@ -241,7 +271,15 @@ btgettuple(IndexScanDesc scan, ScanDirection dir)
 		_bt_start_array_keys(scan, dir);
 	}
 
-	/* This loop handles advancing to the next array elements, if any */
+	/* Likewise, find the first column's first value for a skip scan */
+	if (so->skipKey && !BTScanPosIsValid(so->currPos) &&
+		!_bt_start_skip_key(scan, dir))
+		return false;
+
+	/*
+	 * This loop handles advancing to the next array elements, or to the next
+	 * value of the first column for a skip scan, if any
+	 */
 	do
 	{
 		/*
@@ -283,8 +321,9 @@ btgettuple(IndexScanDesc scan, ScanDirection dir)
 		/* If we have a tuple, return it ... */
 		if (res)
 			break;
-		/* ... otherwise see if we have more array keys to deal with */
-	} while (so->numArrayKeys && _bt_advance_array_keys(scan, dir));
+		/* ... otherwise see if we have more array or skip keys to deal with */
+	} while ((so->numArrayKeys && _bt_advance_array_keys(scan, dir)) ||
+			 (so->skipKey && _bt_advance_skip_key(scan, dir)));
 
 	return res;
 }
@@ -311,7 +350,13 @@ btgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 		_bt_start_array_keys(scan, ForwardScanDirection);
 	}
 
-	/* This loop handles advancing to the next array elements, if any */
+	if (so->skipKey && !_bt_start_skip_key(scan, ForwardScanDirection))
+		return ntids;
+
+	/*
+	 * This loop handles advancing to the next array elements, or to the next
+	 * value of the first column for a skip scan, if any
+	 */
 	do
 	{
 		/* Fetch the first page & tuple */
@@ -341,8 +386,11 @@ btgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 				ntids++;
 			}
 		}
-		/* Now see if we have more array keys to deal with */
-	} while (so->numArrayKeys && _bt_advance_array_keys(scan, ForwardScanDirection));
+		/* Now see if we have more array or skip keys to deal with */
+	} while ((so->numArrayKeys &&
+			  _bt_advance_array_keys(scan, ForwardScanDirection)) ||
+			 (so->skipKey &&
+			  _bt_advance_skip_key(scan, ForwardScanDirection)));
 
 	return ntids;
 }
@@ -366,8 +414,10 @@ btbeginscan(Relation rel, int nkeys, int norderbys)
 	so = (BTScanOpaque) palloc(sizeof(BTScanOpaqueData));
 	BTScanPosInvalidate(so->currPos);
 	BTScanPosInvalidate(so->markPos);
+	/* leave room for the key added by a skip scan */
 	if (scan->numberOfKeys > 0)
-		so->keyData = (ScanKey) palloc(scan->numberOfKeys * sizeof(ScanKeyData));
+		so->keyData = (ScanKey) palloc((scan->numberOfKeys + 1) *
+									   sizeof(ScanKeyData));
 	else
 		so->keyData = NULL;
 
@@ -376,6 +426,12 @@ btbeginscan(Relation rel, int nkeys, int norderbys)
 	so->arrayKeys = NULL;
 	so->arrayContext = NULL;
 
+	so->skipKeyData = NULL;		/* nor a skip scan */
+	so->skipKey = NULL;
+
+	so->lastLeafBlock = InvalidBlockNumber;
+	so->hintMisses = 0;
+
 	so->killedItems = NULL;		/* until needed */
 	so->numKilled = 0;
 
@@ -451,6 +507,9 @@ btrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
 
 	/* If any keys are SK_SEARCHARRAY type, set up array-key info */
 	_bt_preprocess_array_keys(scan);
+
+	/* See if it should be a skip scan */
+	_bt_preprocess_skip_key(scan);
 }
 
 /*
@@ -478,7 +537,7 @@ btendscan(IndexScanDesc scan)
 	/* Release storage */
 	if (so->keyData != NULL)
 		pfree(so->keyData);
-	/* so->arrayKeyData and so->arrayKeys are in arrayContext */
+	/* so->arrayKeyData, so->arrayKeys and skip key data are in arrayContext */
 	if (so->arrayContext != NULL)
 		MemoryContextDelete(so->arrayContext);
 	if (so->killedItems != NULL)
@@ -517,6 +576,8 @@ btmarkpos(IndexScanDesc scan)
 	/* Also record the current positions of any array keys */
 	if (so->numArrayKeys)
 		_bt_mark_array_keys(scan);
+	else if (so->skipKey)
+		_bt_mark_skip_key(scan);
 }
 
 /*
@@ -530,6 +591,8 @@ btrestrpos(IndexScanDesc scan)
 	/* Restore the marked positions of any array keys */
 	if (so->numArrayKeys)
 		_bt_restore_array_keys(scan);
+	else if (so->skipKey)
+		_bt_restore_skip_key(scan);
 
 	if (so->markItemIndex >= 0)
 	{
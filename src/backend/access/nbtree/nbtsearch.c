@@ -20,14 +20,21 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/predicate.h"
+#include "utils/datum.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 
 
 static void _bt_drop_lock_and_maybe_pin(IndexScanDesc scan, BTScanPos sp);
+static void _bt_prefetch_heap(IndexScanDesc scan, ScanDirection dir);
+static Buffer _bt_search_leaf(IndexScanDesc scan, BTScanInsert key);
+static Buffer _bt_search_hint(Relation rel, BTScanInsert key,
+							  BlockNumber blkno, Snapshot snapshot);
 static OffsetNumber _bt_binsrch(Relation rel, BTScanInsert key, Buffer buf);
 static int	_bt_binsrch_posting(BTScanInsert key, Page page,
 								OffsetNumber offnum);
+static int32 _bt_compare_prefix(Relation rel, BTScanInsert key, Page page,
+								OffsetNumber offnum, int *eqatts);
 static bool _bt_readpage(IndexScanDesc scan, ScanDirection dir,
 						 OffsetNumber offnum);
 static void _bt_saveitem(BTScanOpaque so, int itemIndex,
@@ -319,6 +326,115 @@ _bt_moveright(Relation rel,
 	return buf;
 }
 
+/*
+ * Give up on leaf page hints for the rest of the scan after this many
+ * consecutive misses, so that scans whose keys jump around the index don't
+ * pay for an extra page visit on every descent.
+ */
+#define BT_MAX_HINT_MISSES	8
+
+/*
+ *	_bt_search_leaf() -- Find the first leaf page a scan's key could be on.
+ *
+ * Scans that do many primitive index scans (one per array element, for skip
+ * scans, or one per rescan for the inner side of a nested loop) often look
+ * for keys that are close to each other, when the keys are sorted or the
+ * outer side of a join produces them in index order.  The leaf page the last
+ * primitive scan ended on is then likely to be the one the next needs too,
+ * or its right sibling, and checking its bounds is cheaper than descending
+ * from the root.  Otherwise this is just _bt_search(), without the stack.
+ *
+ * Returns the leaf-page buffer, pinned and read-locked, or InvalidBuffer if
+ * the index is empty.
+ */
+static Buffer
+_bt_search_leaf(IndexScanDesc scan, BTScanInsert key)
+{
+	Relation	rel = scan->indexRelation;
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	BTStack		stack;
+	Buffer		buf;
+
+	if (BlockNumberIsValid(so->lastLeafBlock) &&
+		so->hintMisses < BT_MAX_HINT_MISSES &&
+		scan->parallel_scan == NULL)
+	{
+		buf = _bt_search_hint(rel, key, so->lastLeafBlock, scan->xs_snapshot);
+		if (BufferIsValid(buf))
+		{
+			so->hintMisses = 0;
+			return buf;
+		}
+		so->hintMisses++;
+	}
+
+	stack = _bt_search(rel, key, &buf, BT_READ, scan->xs_snapshot);
+
+	/* don't need to keep the stack around... */
+	_bt_freestack(stack);
+
+	return buf;
+}
+
+/*
+ *	_bt_search_hint() -- Check whether a leaf page is where key belongs.
+ *
+ * The page must be a live leaf page whose first item is < scankey (<= if
+ * nextkey is true), so that nothing to its left can be what we're looking
+ * for, and scankey must not be beyond its high key.  We step right once if
+ * only the latter fails, as the key might be on the next page.  The block
+ * may have been deleted and even recycled since we last looked at it, but
+ * any page passing these checks is the right one no matter how we got to
+ * it, just like when _bt_moveright() follows a right link.
+ *
+ * Returns the buffer, pinned and read-locked, or InvalidBuffer if key
+ * doesn't belong on the page.
+ */
+static Buffer
+_bt_search_hint(Relation rel, BTScanInsert key, BlockNumber blkno,
+				Snapshot snapshot)
+{
+	Buffer		buf;
+	Page		page;
+	BTPageOpaque opaque;
+	int32		cmpval;
+
+	cmpval = key->nextkey ? 0 : 1;
+
+	buf = _bt_getbuf(rel, blkno, BT_READ);
+	page = BufferGetPage(buf);
+	TestForOldSnapshot(snapshot, rel, page);
+	opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+
+	if (P_IGNORE(opaque) || !P_ISLEAF(opaque) ||
+		P_FIRSTDATAKEY(opaque) > PageGetMaxOffsetNumber(page) ||
+		_bt_compare(rel, key, page, P_FIRSTDATAKEY(opaque)) < cmpval)
+	{
+		_bt_relbuf(rel, buf);
+		return InvalidBuffer;
+	}
+
+	if (!P_RIGHTMOST(opaque) &&
+		_bt_compare(rel, key, page, P_HIKEY) >= cmpval)
+	{
+		/* step right one page */
+		buf = _bt_relandgetbuf(rel, buf, opaque->btpo_next, BT_READ);
+		page = BufferGetPage(buf);
+		TestForOldSnapshot(snapshot, rel, page);
+		opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+
+		if (P_IGNORE(opaque) ||
+			(!P_RIGHTMOST(opaque) &&
+			 _bt_compare(rel, key, page, P_HIKEY) >= cmpval))
+		{
+			_bt_relbuf(rel, buf);
+			return InvalidBuffer;
+		}
+	}
+
+	return buf;
+}
+
 /*
  *	_bt_binsrch() -- Do a binary search for a key on a particular page.
  *
@@ -338,6 +454,12 @@ _bt_moveright(Relation rel,
  * This procedure is not responsible for walking right, it just examines
  * the given page.  _bt_binsrch() has no lock or refcount side effects
  * on the buffer.
+ *
+ * The search uses dynamic prefix truncation: once the tuples at both ends
+ * of the remaining range are known to have their first N key attributes
+ * equal to the scankey's, so must every tuple in between, and comparisons
+ * skip those attributes.  This saves most of the comparator calls when the
+ * leading columns of a multi-column index have few distinct values.
  */
 static OffsetNumber
 _bt_binsrch(Relation rel,
@@ -350,6 +472,8 @@ _bt_binsrch(Relation rel,
 				high;
 	int32		result,
 				cmpval;
+	int			loweqatts,
+				higheqatts;
 
 	page = BufferGetPage(buf);
 	opaque = (BTPageOpaque) PageGetSpecialPointer(page);
@@ -388,18 +512,28 @@ _bt_binsrch(Relation rel,
 
 	cmpval = key->nextkey ? 0 : 1;	/* select comparison value */
 
+	/* nothing is known about the (implied) tuples bounding the range yet */
+	loweqatts = higheqatts = 0;
+
 	while (high > low)
 	{
 		OffsetNumber mid = low + ((high - low) / 2);
+		int			eqatts = Min(loweqatts, higheqatts);
 
 		/* We have low <= mid < high, so mid points at a real slot */
 
-		result = _bt_compare(rel, key, page, mid);
+		result = _bt_compare_prefix(rel, key, page, mid, &eqatts);
 
 		if (result >= cmpval)
+		{
 			low = mid + 1;
+			loweqatts = eqatts;
+		}
 		else
+		{
 			high = mid;
+			higheqatts = eqatts;
+		}
 	}
 
 	/*
@@ -442,6 +576,9 @@ _bt_binsrch(Relation rel,
  * tuple matches (callers can use insertstate's postingoff field to
  * determine which existing heap TID will need to be replaced by a posting
  * list split).
+ *
+ * Dynamic prefix truncation is used as in _bt_binsrch(); it starts over
+ * when searching again within cached bounds.
  */
 OffsetNumber
 _bt_binsrch_insert(Relation rel, BTInsertState insertstate)
@@ -454,6 +591,8 @@ _bt_binsrch_insert(Relation rel, BTInsertState insertstate)
 				stricthigh;
 	int32		result,
 				cmpval;
+	int			loweqatts,
+				higheqatts;
 
 	page = BufferGetPage(insertstate->buf);
 	opaque = (BTPageOpaque) PageGetSpecialPointer(page);
@@ -501,19 +640,26 @@ _bt_binsrch_insert(Relation rel, BTInsertState insertstate)
 
 	cmpval = 1;					/* !nextkey comparison value */
 
+	loweqatts = higheqatts = 0;
+
 	while (high > low)
 	{
 		OffsetNumber mid = low + ((high - low) / 2);
+		int			eqatts = Min(loweqatts, higheqatts);
 
 		/* We have low <= mid < high, so mid points at a real slot */
 
-		result = _bt_compare(rel, key, page, mid);
+		result = _bt_compare_prefix(rel, key, page, mid, &eqatts);
 
 		if (result >= cmpval)
+		{
 			low = mid + 1;
+			loweqatts = eqatts;
+		}
 		else
 		{
 			high = mid;
+			higheqatts = eqatts;
 			if (result != 0)
 				stricthigh = high;
 		}
@@ -645,6 +791,26 @@ _bt_compare(Relation rel,
 			BTScanInsert key,
 			Page page,
 			OffsetNumber offnum)
+{
+	int			eqatts = 0;
+
+	return _bt_compare_prefix(rel, key, page, offnum, &eqatts);
+}
+
+/*
+ *	_bt_compare_prefix() -- _bt_compare(), skipping known-equal attributes.
+ *
+ * On entry, *eqatts is the number of leading key attributes of the tuple
+ * at offnum that caller knows to be equal to the scankey's; those are not
+ * compared again.  On exit, it is set to the number of leading key
+ * attributes that are known to be equal, for use in later calls.
+ */
+static int32
+_bt_compare_prefix(Relation rel,
+				   BTScanInsert key,
+				   Page page,
+				   OffsetNumber offnum,
+				   int *eqatts)
 {
 	TupleDesc	itupdesc = RelationGetDescr(rel);
 	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
@@ -661,10 +827,13 @@ _bt_compare(Relation rel,
 
 	/*
 	 * Force result ">" if target item is first data item on an internal page
-	 * --- see NOTE above.
+	 * --- see NOTE above.  Nothing is known about its attributes.
 	 */
 	if (!P_ISLEAF(opaque) && offnum == P_FIRSTDATAKEY(opaque))
+	{
+		*eqatts = 0;
 		return 1;
+	}
 
 	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
 	ntupatts = BTreeTupleGetNAtts(itup, rel);
@@ -684,8 +853,9 @@ _bt_compare(Relation rel,
 	ncmpkey = Min(ntupatts, key->keysz);
 	Assert(key->heapkeyspace || ncmpkey == key->keysz);
 	Assert(!BTreeTupleIsPosting(itup) || key->allequalimage);
-	scankey = key->scankeys;
-	for (int i = 1; i <= ncmpkey; i++)
+	Assert(*eqatts >= 0 && *eqatts <= ncmpkey);
+	scankey = key->scankeys + *eqatts;
+	for (int i = *eqatts + 1; i <= ncmpkey; i++)
 	{
 		Datum		datum;
 		bool		isNull;
@@ -729,10 +899,14 @@ _bt_compare(Relation rel,
 
 		/* if the keys are unequal, return the difference */
 		if (result != 0)
+		{
+			*eqatts = i - 1;
 			return result;
+		}
 
 		scankey++;
 	}
+	*eqatts = ncmpkey;
 
 	/*
 	 * All non-truncated attributes (other than heap TID) were found to be
@@ -850,7 +1024,6 @@ _bt_first(IndexScanDesc scan, ScanDirection dir)
 	Relation	rel = scan->indexRelation;
 	BTScanOpaque so = (BTScanOpaque) scan->opaque;
 	Buffer		buf;
-	BTStack		stack;
 	OffsetNumber offnum;
 	StrategyNumber strat;
 	bool		nextkey;
@@ -1347,10 +1520,7 @@ _bt_first(IndexScanDesc scan, ScanDirection dir)
 	 * Use the manufactured insertion scan key to descend the tree and
 	 * position ourselves on the target leaf page.
 	 */
-	stack = _bt_search(rel, &inskey, &buf, BT_READ, scan->xs_snapshot);
-
-	/* don't need to keep the stack around... */
-	_bt_freestack(stack);
+	buf = _bt_search_leaf(scan, &inskey);
 
 	if (!BufferIsValid(buf))
 	{
@@ -1428,6 +1598,8 @@ readcomplete:
 	scan->xs_heaptid = currItem->heapTid;
 	if (scan->xs_want_itup)
 		scan->xs_itup = (IndexTuple) (so->currTuples + currItem->tupleOffset);
+	else if (scan->xs_prefetch_distance > 0)
+		_bt_prefetch_heap(scan, dir);
 
 	return true;
 }
@@ -1478,10 +1650,57 @@ _bt_next(IndexScanDesc scan, ScanDirection dir)
 	scan->xs_heaptid = currItem->heapTid;
 	if (scan->xs_want_itup)
 		scan->xs_itup = (IndexTuple) (so->currTuples + currItem->tupleOffset);
+	else if (scan->xs_prefetch_distance > 0)
+		_bt_prefetch_heap(scan, dir);
 
 	return true;
 }
 
+/*
+ *	_bt_prefetch_heap() -- Prefetch heap pages for upcoming items.
+ *
+ * The caller is about to fetch the heap tuple of the current item.  Issue
+ * prefetches for the heap blocks of the items after it on the current page,
+ * up to the scan's prefetch distance.  The items are all there in currPos
+ * already, so this is a lookahead that costs nothing on the index side; we
+ * don't look past the current page.
+ *
+ * Not used for index-only scans, which usually don't visit the heap at all.
+ */
+static void
+_bt_prefetch_heap(IndexScanDesc scan, ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	int			target;
+
+	if (ScanDirectionIsForward(dir))
+	{
+		target = Min(so->currPos.itemIndex + scan->xs_prefetch_distance,
+					 so->currPos.lastItem);
+		if (so->currPos.prefetchItem < so->currPos.itemIndex)
+			so->currPos.prefetchItem = so->currPos.itemIndex;
+		while (so->currPos.prefetchItem < target)
+		{
+			so->currPos.prefetchItem++;
+			index_prefetch_heap(scan,
+								&so->currPos.items[so->currPos.prefetchItem].heapTid);
+		}
+	}
+	else
+	{
+		target = Max(so->currPos.itemIndex - scan->xs_prefetch_distance,
+					 so->currPos.firstItem);
+		if (so->currPos.prefetchItem > so->currPos.itemIndex)
+			so->currPos.prefetchItem = so->currPos.itemIndex;
+		while (so->currPos.prefetchItem > target)
+		{
+			so->currPos.prefetchItem--;
+			index_prefetch_heap(scan,
+								&so->currPos.items[so->currPos.prefetchItem].heapTid);
+		}
+	}
+}
+
 /*
  *	_bt_readpage() -- Load data from current index page into so->currPos
  *
@@ -1541,6 +1760,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 	 * This allows us to re-read the buffer if it is needed again for hinting.
 	 */
 	so->currPos.currPage = BufferGetBlockNumber(so->currPos.buf);
+	so->lastLeafBlock = so->currPos.currPage;
 
 	/*
 	 * We save the LSN of the page as we read it, so that we know whether it
@@ -1656,6 +1876,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 		so->currPos.firstItem = 0;
 		so->currPos.lastItem = itemIndex - 1;
 		so->currPos.itemIndex = 0;
+		so->currPos.prefetchItem = 0;
 	}
 	else
 	{
@@ -1751,6 +1972,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 		so->currPos.firstItem = itemIndex;
 		so->currPos.lastItem = MaxTIDsPerBTreePage - 1;
 		so->currPos.itemIndex = MaxTIDsPerBTreePage - 1;
+		so->currPos.prefetchItem = MaxTIDsPerBTreePage - 1;
 	}
 
 	return (so->currPos.firstItem <= so->currPos.lastItem);
@@ -2362,6 +2584,144 @@ _bt_get_endpoint(Relation rel, uint32 level, bool rightmost,
 	return buf;
 }
 
+/*
+ *	_bt_skip_findnext() -- Find the next value of the first index column
+ *
+ * Used by skip scans (see _bt_preprocess_skip_key).  Descends the index to
+ * the first tuple whose first column follows the skip key's current value in
+ * the given direction, or, if there's no current value yet, to the first
+ * tuple in that direction.  That column's value is copied into *value and
+ * *isnull in CurrentMemoryContext, and *blkno is set to the leaf page it was
+ * found on.  Returns false if there is no such tuple.
+ */
+bool
+_bt_skip_findnext(IndexScanDesc scan, ScanDirection dir,
+				  Datum *value, bool *isnull, BlockNumber *blkno)
+{
+	Relation	rel = scan->indexRelation;
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	BTSkipKeyInfo *skip = so->skipKey;
+	Buffer		buf;
+	Page		page;
+	BTPageOpaque opaque;
+	OffsetNumber offnum;
+	IndexTuple	itup;
+
+	if (!skip->cur_valid)
+	{
+		buf = _bt_get_endpoint(rel, 0, ScanDirectionIsBackward(dir),
+							   scan->xs_snapshot);
+		if (!BufferIsValid(buf))
+		{
+			/* empty index, see _bt_endpoint */
+			PredicateLockRelation(rel, scan->xs_snapshot);
+			return false;
+		}
+		page = BufferGetPage(buf);
+		opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+		if (ScanDirectionIsForward(dir))
+			offnum = P_FIRSTDATAKEY(opaque);
+		else
+			offnum = PageGetMaxOffsetNumber(page);
+	}
+	else
+	{
+		BTScanInsertData inskey;
+		int			flags;
+
+		/*
+		 * Search for the first tuple > the current value for a forward scan,
+		 * or the first one >= it for a backward scan, and step back one
+		 * tuple from there.
+		 */
+		flags = rel->rd_indoption[0] << SK_BT_INDOPTION_SHIFT;
+		if (skip->cur_isnull)
+			ScanKeyEntryInitialize(&inskey.scankeys[0],
+								   flags | SK_ISNULL | SK_SEARCHNULL, 1,
+								   InvalidStrategy, InvalidOid, InvalidOid,
+								   InvalidOid, (Datum) 0);
+		else
+			ScanKeyEntryInitializeWithInfo(&inskey.scankeys[0], flags, 1,
+										   InvalidStrategy, InvalidOid,
+										   rel->rd_indcollation[0],
+										   index_getprocinfo(rel, 1,
+															 BTORDER_PROC),
+										   skip->cur_value);
+
+		_bt_metaversion(rel, &inskey.heapkeyspace, &inskey.allequalimage);
+		inskey.anynullkeys = false; /* unused */
+		inskey.nextkey = ScanDirectionIsForward(dir);
+		inskey.pivotsearch = false;
+		inskey.scantid = NULL;
+		inskey.keysz = 1;
+
+		buf = _bt_search_leaf(scan, &inskey);
+
+		if (!BufferIsValid(buf))
+		{
+			PredicateLockRelation(rel, scan->xs_snapshot);
+			return false;
+		}
+
+		offnum = _bt_binsrch(rel, &inskey, buf);
+		if (ScanDirectionIsBackward(dir))
+			offnum = OffsetNumberPrev(offnum);
+		page = BufferGetPage(buf);
+		opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+	}
+
+	/* Step to the next page while we're not on a tuple, as in _bt_steppage */
+	for (;;)
+	{
+		if (!P_IGNORE(opaque))
+		{
+			PredicateLockPage(rel, BufferGetBlockNumber(buf),
+							  scan->xs_snapshot);
+			if (offnum >= P_FIRSTDATAKEY(opaque) &&
+				offnum <= PageGetMaxOffsetNumber(page))
+				break;
+		}
+
+		if (ScanDirectionIsForward(dir))
+		{
+			if (P_RIGHTMOST(opaque))
+			{
+				_bt_relbuf(rel, buf);
+				return false;
+			}
+			buf = _bt_relandgetbuf(rel, buf, opaque->btpo_next, BT_READ);
+			page = BufferGetPage(buf);
+			TestForOldSnapshot(scan->xs_snapshot, rel, page);
+			opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+			offnum = P_FIRSTDATAKEY(opaque);
+		}
+		else
+		{
+			if (P_LEFTMOST(opaque))
+			{
+				_bt_relbuf(rel, buf);
+				return false;
+			}
+			buf = _bt_walk_left(rel, buf, scan->xs_snapshot);
+			if (!BufferIsValid(buf))
+				return false;
+			page = BufferGetPage(buf);
+			opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+			offnum = PageGetMaxOffsetNumber(page);
+		}
+	}
+
+	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+	*value = index_getattr(itup, 1, RelationGetDescr(rel), isnull);
+	if (!*isnull)
+		*value = datumCopy(*value, skip->attbyval, skip->attlen);
+	*blkno = BufferGetBlockNumber(buf);
+
+	_bt_relbuf(rel, buf);
+
+	return true;
+}
+
 /*
  *	_bt_endpoint() -- Find the first or last page in the index, and scan
  * from there to the first key satisfying all the quals.
@@ -2453,6 +2813,8 @@ _bt_endpoint(IndexScanDesc scan, ScanDirection dir)
 	scan->xs_heaptid = currItem->heapTid;
 	if (scan->xs_want_itup)
 		scan->xs_itup = (IndexTuple) (so->currTuples + currItem->tupleOffset);
+	else if (scan->xs_prefetch_distance > 0)
+		_bt_prefetch_heap(scan, dir);
 
 	return true;
 }
@@ -31,6 +31,12 @@
 #include "utils/rel.h"
 
 
+/*
+ * A skip scan gives up skipping once this many successive values of the
+ * first column were found on the same leaf page
+ */
+#define BT_SKIP_MAX_SAME_PAGE	8
+
 typedef struct BTSortArrayContext
 {
 	FmgrInfo	flinfo;
@@ -45,6 +51,8 @@ static int	_bt_sort_array_elements(IndexScanDesc scan, ScanKey skey,
 									bool reverse,
 									Datum *elems, int nelems);
 static int	_bt_compare_array_elements(const void *a, const void *b, void *arg);
+static void _bt_update_skip_key(IndexScanDesc scan);
+static bool _bt_step_skip_key(IndexScanDesc scan, ScanDirection dir);
 static bool _bt_compare_scankey_args(IndexScanDesc scan, ScanKey op,
 									 ScanKey leftarg, ScanKey rightarg,
 									 bool *result);
@@ -654,13 +662,341 @@ _bt_restore_array_keys(IndexScanDesc scan)
 }
 
 
+/*
+ *	_bt_preprocess_skip_key() -- Set up a skip scan, if possible
+ *
+ * A scan with no keys on the first index column has to read the whole
+ * index, even if it has selective keys on the second column.  When the first
+ * column has few distinct values, it's much cheaper to do one primitive index
+ * scan per value, with an added "=" key on the first column: the keys on the
+ * second column then bound each primitive scan.  The values are found by
+ * descending the index (see _bt_skip_findnext).
+ *
+ * We don't try this with array keys, row comparisons or in parallel scans.
+ *
+ * Must be called after _bt_preprocess_array_keys, as it uses the same
+ * scan-lifespan context.
+ */
+void
+_bt_preprocess_skip_key(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	Form_pg_attribute attr;
+	BTSkipKeyInfo *skip;
+	bool		found = false;
+	Oid			eqop;
+	int			i;
+	MemoryContext oldContext;
+
+	so->skipKey = NULL;
+	so->skipKeyData = NULL;
+
+	if (so->numArrayKeys != 0 || scan->parallel_scan != NULL ||
+		IndexRelationGetNumberOfKeyAttributes(rel) < 2)
+		return;
+
+	/* Need a key on the second column other than IS NOT NULL, none on the first */
+	for (i = 0; i < scan->numberOfKeys; i++)
+	{
+		ScanKey		cur = &scan->keyData[i];
+
+		if (cur->sk_attno == 1 || (cur->sk_flags & SK_ROW_HEADER))
+			return;
+		if (cur->sk_attno == 2 && !(cur->sk_flags & SK_SEARCHNOTNULL))
+			found = true;
+	}
+	if (!found)
+		return;
+
+	eqop = get_opfamily_member(rel->rd_opfamily[0], rel->rd_opcintype[0],
+							   rel->rd_opcintype[0], BTEqualStrategyNumber);
+	if (!OidIsValid(eqop))
+		return;
+
+	/* Array keys don't use the context, so it's ours to reset */
+	if (so->arrayContext == NULL)
+		so->arrayContext = AllocSetContextCreate(CurrentMemoryContext,
+												 "BTree array context",
+												 ALLOCSET_SMALL_SIZES);
+	else
+		MemoryContextReset(so->arrayContext);
+
+	oldContext = MemoryContextSwitchTo(so->arrayContext);
+
+	skip = (BTSkipKeyInfo *) palloc0(sizeof(BTSkipKeyInfo));
+	attr = TupleDescAttr(RelationGetDescr(rel), 0);
+	skip->attlen = attr->attlen;
+	skip->attbyval = attr->attbyval;
+	fmgr_info(get_opcode(eqop), &skip->eq_proc);
+	skip->ge_proc.fn_oid = InvalidOid;
+	skip->le_proc.fn_oid = InvalidOid;
+	skip->cur_strategy = BTEqualStrategyNumber;
+
+	/* The skip key comes first, as keys must be ordered by attribute */
+	so->skipKeyData = (ScanKey) palloc((scan->numberOfKeys + 1) *
+									   sizeof(ScanKeyData));
+	memcpy(&so->skipKeyData[1], scan->keyData,
+		   scan->numberOfKeys * sizeof(ScanKeyData));
+	so->skipKey = skip;
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+/*
+ * Set up the skip key in so->skipKeyData from the current value.
+ */
+static void
+_bt_update_skip_key(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	BTSkipKeyInfo *skip = so->skipKey;
+	ScanKey		skey = &so->skipKeyData[0];
+	FmgrInfo   *finfo;
+
+	Assert(skip->cur_valid);
+
+	if (skip->cur_isnull)
+	{
+		/* this is "IS NULL", which is treated as equality */
+		Assert(skip->cur_strategy == BTEqualStrategyNumber);
+		ScanKeyEntryInitialize(skey, SK_ISNULL | SK_SEARCHNULL, 1,
+							   InvalidStrategy, InvalidOid, InvalidOid,
+							   InvalidOid, (Datum) 0);
+		return;
+	}
+
+	switch (skip->cur_strategy)
+	{
+		case BTEqualStrategyNumber:
+			finfo = &skip->eq_proc;
+			break;
+		case BTGreaterEqualStrategyNumber:
+			finfo = &skip->ge_proc;
+			break;
+		case BTLessEqualStrategyNumber:
+			finfo = &skip->le_proc;
+			break;
+		default:
+			elog(ERROR, "unrecognized StrategyNumber: %d",
+				 (int) skip->cur_strategy);
+			finfo = NULL;		/* keep compiler quiet */
+			break;
+	}
+
+	ScanKeyEntryInitializeWithInfo(skey, 0, 1, skip->cur_strategy,
+								   rel->rd_opcintype[0],
+								   rel->rd_indcollation[0],
+								   finfo, skip->cur_value);
+}
+
+/*
+ * Step the skip key to the first column's next value in the given
+ * direction.  Returns false if there is none.
+ */
+static bool
+_bt_step_skip_key(IndexScanDesc scan, ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	BTSkipKeyInfo *skip = so->skipKey;
+	Datum		value;
+	bool		isnull;
+	BlockNumber blkno;
+	bool		found;
+	MemoryContext oldContext;
+
+	oldContext = MemoryContextSwitchTo(so->arrayContext);
+	found = _bt_skip_findnext(scan, dir, &value, &isnull, &blkno);
+	MemoryContextSwitchTo(oldContext);
+
+	if (!found)
+		return false;
+
+	if (skip->cur_valid && blkno == skip->last_blkno)
+		skip->nsamepage++;
+	else
+		skip->nsamepage = 0;
+	skip->last_blkno = blkno;
+
+	if (skip->cur_valid && !skip->cur_isnull && !skip->attbyval)
+		pfree(DatumGetPointer(skip->cur_value));
+	skip->cur_valid = true;
+	skip->cur_isnull = isnull;
+	skip->cur_value = value;
+
+	/*
+	 * When successive values keep being found on the same leaf page, each
+	 * primitive scan reads no fewer pages than a plain scan would, and costs
+	 * two extra descents of the tree.  Give up on skipping, and scan the rest
+	 * of the index from the current value on in one go.  (Nulls are only
+	 * found at either end of the index, so we don't bother for them.)
+	 */
+	if (skip->nsamepage >= BT_SKIP_MAX_SAME_PAGE && !isnull)
+	{
+		bool		desc = (rel->rd_indoption[0] & INDOPTION_DESC) != 0;
+		StrategyNumber strat;
+		FmgrInfo   *finfo;
+
+		if (ScanDirectionIsForward(dir) != desc)
+		{
+			strat = BTGreaterEqualStrategyNumber;
+			finfo = &skip->ge_proc;
+		}
+		else
+		{
+			strat = BTLessEqualStrategyNumber;
+			finfo = &skip->le_proc;
+		}
+
+		if (!OidIsValid(finfo->fn_oid))
+		{
+			Oid			cmp_op;
+
+			cmp_op = get_opfamily_member(rel->rd_opfamily[0],
+										 rel->rd_opcintype[0],
+										 rel->rd_opcintype[0],
+										 strat);
+			if (!OidIsValid(cmp_op))
+				elog(ERROR, "missing operator %d(%u,%u) in opfamily %u",
+					 strat, rel->rd_opcintype[0], rel->rd_opcintype[0],
+					 rel->rd_opfamily[0]);
+			fmgr_info_cxt(get_opcode(cmp_op), finfo, so->arrayContext);
+		}
+		skip->cur_strategy = strat;
+	}
+
+	_bt_update_skip_key(scan);
+
+	return true;
+}
+
+/*
+ * _bt_start_skip_key() -- Initialize the skip key at start of a scan
+ *
+ * Finds the first value of the first column in the given direction.  Returns
+ * false if the index is empty.
+ */
+bool
+_bt_start_skip_key(IndexScanDesc scan, ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	BTSkipKeyInfo *skip = so->skipKey;
+
+	if (skip->cur_valid && !skip->cur_isnull && !skip->attbyval)
+		pfree(DatumGetPointer(skip->cur_value));
+	skip->cur_valid = false;
+	skip->cur_strategy = BTEqualStrategyNumber;
+	skip->last_blkno = InvalidBlockNumber;
+	skip->nsamepage = 0;
+
+	return _bt_step_skip_key(scan, dir);
+}
+
+/*
+ * _bt_advance_skip_key() -- Advance to the first column's next value
+ *
+ * Returns true if there is another primitive scan to do.
+ */
+bool
+_bt_advance_skip_key(IndexScanDesc scan, ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	BTSkipKeyInfo *skip = so->skipKey;
+
+	/* Nothing left to do if the other keys can never be satisfied */
+	if (!so->qual_ok)
+		return false;
+
+	/*
+	 * If we gave up on skipping, the last primitive scan covered the rest of
+	 * the index, except for any nulls at its end, which the ">=" or "<="
+	 * key can't match.  Do them as a last primitive scan.
+	 */
+	if (skip->cur_strategy != BTEqualStrategyNumber)
+	{
+		bool		nullsfirst;
+
+		nullsfirst = (rel->rd_indoption[0] & INDOPTION_NULLS_FIRST) != 0;
+		if (ScanDirectionIsForward(dir) == nullsfirst)
+			return false;
+
+		if (!skip->cur_isnull && !skip->attbyval)
+			pfree(DatumGetPointer(skip->cur_value));
+		skip->cur_isnull = true;
+		skip->cur_strategy = BTEqualStrategyNumber;
+		_bt_update_skip_key(scan);
+		return true;
+	}
+
+	return _bt_step_skip_key(scan, dir);
+}
+
+/*
+ * _bt_mark_skip_key() -- Handle the skip key during btmarkpos
+ */
+void
+_bt_mark_skip_key(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	BTSkipKeyInfo *skip = so->skipKey;
+
+	if (skip->mark_valid && !skip->mark_isnull && !skip->attbyval)
+		pfree(DatumGetPointer(skip->mark_value));
+
+	skip->mark_valid = skip->cur_valid;
+	skip->mark_isnull = skip->cur_isnull;
+	skip->mark_strategy = skip->cur_strategy;
+	if (skip->cur_valid && !skip->cur_isnull)
+		skip->mark_value = datumCopy(skip->cur_value, skip->attbyval,
+									 skip->attlen);
+}
+
+/*
+ * _bt_restore_skip_key() -- Handle the skip key during btrestrpos
+ */
+void
+_bt_restore_skip_key(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	BTSkipKeyInfo *skip = so->skipKey;
+	MemoryContext oldContext;
+
+	/* If the mark was set before the scan started, it will start over */
+	if (!skip->mark_valid)
+		return;
+
+	if (skip->cur_valid && !skip->cur_isnull && !skip->attbyval)
+		pfree(DatumGetPointer(skip->cur_value));
+
+	skip->cur_valid = true;
+	skip->cur_isnull = skip->mark_isnull;
+	skip->cur_strategy = skip->mark_strategy;
+	if (!skip->mark_isnull)
+	{
+		oldContext = MemoryContextSwitchTo(so->arrayContext);
+		skip->cur_value = datumCopy(skip->mark_value, skip->attbyval,
+									skip->attlen);
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	_bt_update_skip_key(scan);
+	_bt_preprocess_keys(scan);
+	/* The mark should have been set on a consistent set of keys... */
+	Assert(so->qual_ok);
+}
+
+
 /*
  *	_bt_preprocess_keys() -- Preprocess scan keys
  *
- * The given search-type keys (in scan->keyData[] or so->arrayKeyData[])
- * are copied to so->keyData[] with possible transformation.
- * scan->numberOfKeys is the number of input keys, so->numberOfKeys gets
- * the number of output keys (possibly less, never greater).
+ * The given search-type keys (in scan->keyData[], so->arrayKeyData[] or
+ * so->skipKeyData[]) are copied to so->keyData[] with possible
+ * transformation.  scan->numberOfKeys is the number of input keys (plus one
+ * for the skip key of a skip scan), so->numberOfKeys gets the number of
+ * output keys (possibly less, never greater).
  *
  * The output keys are marked with additional sk_flags bits beyond the
  * system-standard bits supplied by the caller.  The DESC and NULLS_FIRST
@@ -763,9 +1099,16 @@ _bt_preprocess_keys(IndexScanDesc scan)
 		return;					/* done if qual-less scan */
 
 	/*
-	 * Read so->arrayKeyData if array keys are present, else scan->keyData
+	 * Read so->skipKeyData for a skip scan, so->arrayKeyData if array keys
+	 * are present, else scan->keyData
 	 */
-	if (so->arrayKeyData != NULL)
+	if (so->skipKey != NULL)
+	{
+		Assert(so->skipKey->cur_valid);
+		inkeys = so->skipKeyData;
+		numberOfKeys++;
+	}
+	else if (so->arrayKeyData != NULL)
 		inkeys = so->arrayKeyData;
 	else
 		inkeys = scan->keyData;
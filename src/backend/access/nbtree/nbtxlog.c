@@ -250,6 +250,44 @@ btree_xlog_insert(bool isleaf, bool ismeta, bool posting,
 		_bt_restore_meta(record, 2);
 }
 
+static void
+btree_xlog_insert_multi(XLogReaderState *record)
+{
+	XLogRecPtr	lsn = record->EndRecPtr;
+	xl_btree_insert_multi *xlrec = (xl_btree_insert_multi *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+
+	if (XLogReadBufferForRedo(record, 0, &buffer) == BLK_NEEDS_REDO)
+	{
+		Size		datalen;
+		char	   *datapos = XLogRecGetBlockData(record, 0, &datalen);
+		OffsetNumber *offsets;
+
+		page = BufferGetPage(buffer);
+
+		/* the offset numbers come after the tuples, at the end */
+		offsets = (OffsetNumber *)
+			(datapos + datalen - xlrec->ntuples * sizeof(OffsetNumber));
+
+		for (int i = 0; i < xlrec->ntuples; i++)
+		{
+			IndexTuple	itup = (IndexTuple) datapos;
+			Size		itemsz = IndexTupleSize(itup);
+
+			if (PageAddItem(page, (Item) itup, itemsz, offsets[i],
+							false, false) == InvalidOffsetNumber)
+				elog(PANIC, "failed to add new item");
+			datapos += MAXALIGN(itemsz);
+		}
+
+		PageSetLSN(page, lsn);
+		MarkBufferDirty(buffer);
+	}
+	if (BufferIsValid(buffer))
+		UnlockReleaseBuffer(buffer);
+}
+
 static void
 btree_xlog_split(bool newitemonleft, XLogReaderState *record)
 {
@@ -988,6 +1026,9 @@ btree_redo(XLogReaderState *record)
 		case XLOG_BTREE_INSERT_POST:
 			btree_xlog_insert(true, false, true, record);
 			break;
+		case XLOG_BTREE_INSERT_MULTI:
+			btree_xlog_insert_multi(record);
+			break;
 		case XLOG_BTREE_DEDUP:
 			btree_xlog_dedup(record);
 			break;
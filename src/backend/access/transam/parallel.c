@@ -14,6 +14,7 @@
 
 #include "postgres.h"
 
+#include "access/gin_private.h"
 #include "access/heapam.h"
 #include "access/nbtree.h"
 #include "access/parallel.h"
@@ -25,6 +26,9 @@
 #include "catalog/pg_enum.h"
 #include "catalog/storage.h"
 #include "commands/async.h"
+#include "commands/copy.h"
+#include "commands/vacuum.h"
+#include "common/hashfn.h"
 #include "executor/execParallel.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
@@ -34,6 +38,9 @@
 #include "pgstat.h"
 #include "storage/ipc.h"
 #include "storage/predicate.h"
+#include "storage/proc.h"
+#include "storage/procarray.h"
+#include "storage/shmem.h"
 #include "storage/sinval.h"
 #include "storage/spin.h"
 #include "tcop/tcopprot.h"
@@ -43,6 +50,7 @@
 #include "utils/memutils.h"
 #include "utils/relmapper.h"
 #include "utils/snapmgr.h"
+#include "utils/timestamp.h"
 #include "utils/typcache.h"
 
 /*
@@ -126,6 +134,57 @@ static dlist_head pcxt_list = DLIST_STATIC_INIT(pcxt_list);
 /* Backend-local copy of data from FixedParallelState. */
 static pid_t ParallelLeaderPid;
 
+/*
+ * Pool of idle parallel workers.
+ *
+ * Rather than exiting once it's done with its parallel context, a parallel
+ * worker can wait in the pool until a leader connected to the same database
+ * as the same user, with the same libraries loaded, hands it another one.
+ * That saves the new context the process startup and InitPostgres() of a
+ * fresh worker.
+ *
+ * Each pooled worker has a slot.  A slot is free when pid is 0, and its
+ * worker is idle when leader_pid is 0.  A leader claims an idle worker by
+ * setting leader_pid and assigned_seg, and sets the worker's latch; the
+ * worker clears assigned_seg once it has picked up the assignment.  When the
+ * worker is done with the context, it clears leader_pid again and sets the
+ * leader's latch.  generation is advanced whenever a new worker takes the
+ * slot, so that a leader can tell its worker from a later occupant.
+ *
+ * ParallelWorkerPoolLock protects all the slots.
+ */
+typedef struct ParallelPoolSlot
+{
+	pid_t		pid;			/* worker's PID, or 0 if slot is free */
+	PGPROC	   *proc;			/* worker's PGPROC */
+	uint64		generation;		/* advanced when a worker takes the slot */
+	Oid			database_id;	/* database the worker is connected to */
+	Oid			authenticated_user_id;	/* ... and as which user */
+	uint32		library_hash;	/* hash of the libraries it has loaded */
+	pid_t		leader_pid;		/* leader being served, or 0 if idle */
+	dsm_handle	assigned_seg;	/* segment of context to serve next */
+	int			assigned_worker_number; /* worker number in that context */
+	bool		exit_requested; /* should the worker leave the pool? */
+} ParallelPoolSlot;
+
+typedef struct ParallelPoolData
+{
+	int			nslots;
+	ParallelPoolSlot slots[FLEXIBLE_ARRAY_MEMBER];
+} ParallelPoolData;
+
+static ParallelPoolData *ParallelPool = NULL;
+
+/* GUC variables */
+int			parallel_worker_pool_size = 0;
+int			parallel_worker_idle_timeout = 60000;
+
+/* In a pooled worker, our slot in the pool; -1 if none. */
+static int	MyPoolSlot = -1;
+
+/* In a parallel worker, hash of the library state we restored. */
+static uint32 MyLibraryStateHash;
+
 /*
  * List of internal parallel worker entry points.  We need this for
  * reasons explained in LookupParallelWorkerFunction(), below.
@@ -143,8 +202,20 @@ static const struct
 	{
 		"_bt_parallel_build_main", _bt_parallel_build_main
 	},
+	{
+		"_gin_parallel_build_main", _gin_parallel_build_main
+	},
 	{
 		"parallel_vacuum_main", parallel_vacuum_main
+	},
+	{
+		"parallel_analyze_main", parallel_analyze_main
+	},
+	{
+		"ParallelCopyMain", ParallelCopyMain
+	},
+	{
+		"ParallelCopyToMain", ParallelCopyToMain
 	}
 };
 
@@ -153,6 +224,20 @@ static void HandleParallelMessage(ParallelContext *pcxt, int i, StringInfo msg);
 static void WaitForParallelWorkersToExit(ParallelContext *pcxt);
 static parallel_worker_main_type LookupParallelWorkerFunction(const char *libraryname, const char *funcname);
 static void ParallelWorkerShutdown(int code, Datum arg);
+static bool ParallelWorkerRun(dsm_handle handle, int worker_number);
+static uint32 hash_library_state(const char *libraryspace);
+static bool ParallelPoolClaimWorker(ParallelContext *pcxt, int i);
+static void ParallelPoolShrink(void);
+static BgwHandleStatus GetParallelWorkerStatus(ParallelContext *pcxt, int i,
+											   pid_t *pidp);
+static bool ParallelWorkerReleased(ParallelContext *pcxt, int i);
+static void TerminateParallelWorker(ParallelContext *pcxt, int i);
+static BgwHandleStatus WaitForParallelWorkerShutdown(ParallelContext *pcxt,
+													 int i);
+static bool ParallelPoolReturnWorker(PGPROC *leader);
+static bool ParallelPoolWaitForWork(dsm_handle *handle, int *worker_number);
+static void ParallelPoolSetIdle(bool idle);
+static void ParallelPoolWorkerExit(int code, Datum arg);
 
 
 /*
@@ -412,6 +497,8 @@ InitializeParallelDSM(ParallelContext *pcxt)
 
 		/* Allocate space for worker information. */
 		pcxt->worker = palloc0(sizeof(ParallelWorkerInfo) * pcxt->nworkers);
+		for (i = 0; i < pcxt->nworkers; ++i)
+			pcxt->worker[i].pool_slot = -1;
 
 		/*
 		 * Establish error queues in dynamic shared memory.
@@ -570,9 +657,17 @@ LaunchParallelWorkers(ParallelContext *pcxt)
 	for (i = 0; i < pcxt->nworkers_to_launch; ++i)
 	{
 		memcpy(worker.bgw_extra, &i, sizeof(int));
+		pcxt->worker[i].pid = 0;
+		pcxt->worker[i].pool_slot = -1;
 		if (!any_registrations_failed &&
-			RegisterDynamicBackgroundWorker(&worker,
-											&pcxt->worker[i].bgwhandle))
+			ParallelPoolClaimWorker(pcxt, i))
+		{
+			/* An idle pooled worker will attach to our segment. */
+			pcxt->nworkers_launched++;
+		}
+		else if (!any_registrations_failed &&
+				 RegisterDynamicBackgroundWorker(&worker,
+												 &pcxt->worker[i].bgwhandle))
 		{
 			shm_mq_set_handle(pcxt->worker[i].error_mqh,
 							  pcxt->worker[i].bgwhandle);
@@ -588,7 +683,12 @@ LaunchParallelWorkers(ParallelContext *pcxt)
 			 * to make sure that we forget about the error queues we budgeted
 			 * for those workers.  Otherwise, we'll wait for them to start,
 			 * but they never will.
+			 *
+			 * Idle pooled workers count against the limits too, so ask one
+			 * of them to make room for the next parallel query.
 			 */
+			if (!any_registrations_failed)
+				ParallelPoolShrink();
 			any_registrations_failed = true;
 			pcxt->worker[i].bgwhandle = NULL;
 			shm_mq_detach(pcxt->worker[i].error_mqh);
@@ -681,7 +781,7 @@ WaitForParallelWorkersToAttach(ParallelContext *pcxt)
 				continue;
 			}
 
-			status = GetBackgroundWorkerPid(pcxt->worker[i].bgwhandle, &pid);
+			status = GetParallelWorkerStatus(pcxt, i, &pid);
 			if (status == BGWH_STARTED)
 			{
 				/* Has the worker attached to the error queue? */
@@ -805,9 +905,9 @@ WaitForParallelWorkersToFinish(ParallelContext *pcxt)
 				 * further investigation is needed.
 				 */
 				if (pcxt->worker[i].error_mqh == NULL ||
-					pcxt->worker[i].bgwhandle == NULL ||
-					GetBackgroundWorkerPid(pcxt->worker[i].bgwhandle,
-										   &pid) != BGWH_STOPPED)
+					(pcxt->worker[i].bgwhandle == NULL &&
+					 pcxt->worker[i].pool_slot < 0) ||
+					GetParallelWorkerStatus(pcxt, i, &pid) != BGWH_STOPPED)
 					continue;
 
 				/*
@@ -830,7 +930,7 @@ WaitForParallelWorkersToFinish(ParallelContext *pcxt)
 				 * Unless there's a bug somewhere, this will only happen when
 				 * the worker writes messages and terminates after the
 				 * CHECK_FOR_INTERRUPTS() near the top of this function and
-				 * before the call to GetBackgroundWorkerPid().  In that case,
+				 * before the call to GetParallelWorkerStatus().  In that case,
 				 * or latch should have been set as well and the right things
 				 * will happen on the next pass through the loop.
 				 */
@@ -859,6 +959,9 @@ WaitForParallelWorkersToFinish(ParallelContext *pcxt)
  * difference between WaitForParallelWorkersToFinish and this function is
  * that the former just ensures that last message sent by a worker backend is
  * received by the leader backend whereas this ensures the complete shutdown.
+ * A worker that returns to the pool instead of exiting has left our lock
+ * group and detached from our segment before it tells us so, which is as
+ * good as exiting for our purposes.
  */
 static void
 WaitForParallelWorkersToExit(ParallelContext *pcxt)
@@ -870,10 +973,12 @@ WaitForParallelWorkersToExit(ParallelContext *pcxt)
 	{
 		BgwHandleStatus status;
 
-		if (pcxt->worker == NULL || pcxt->worker[i].bgwhandle == NULL)
+		if (pcxt->worker == NULL ||
+			(pcxt->worker[i].bgwhandle == NULL &&
+			 pcxt->worker[i].pool_slot < 0))
 			continue;
 
-		status = WaitForBackgroundWorkerShutdown(pcxt->worker[i].bgwhandle);
+		status = WaitForParallelWorkerShutdown(pcxt, i);
 
 		/*
 		 * If the postmaster kicked the bucket, we have no chance of cleaning
@@ -887,8 +992,10 @@ WaitForParallelWorkersToExit(ParallelContext *pcxt)
 					 errmsg("postmaster exited during a parallel transaction")));
 
 		/* Release memory. */
-		pfree(pcxt->worker[i].bgwhandle);
+		if (pcxt->worker[i].bgwhandle != NULL)
+			pfree(pcxt->worker[i].bgwhandle);
 		pcxt->worker[i].bgwhandle = NULL;
+		pcxt->worker[i].pool_slot = -1;
 	}
 }
 
@@ -920,7 +1027,7 @@ DestroyParallelContext(ParallelContext *pcxt)
 		{
 			if (pcxt->worker[i].error_mqh != NULL)
 			{
-				TerminateBackgroundWorker(pcxt->worker[i].bgwhandle);
+				TerminateParallelWorker(pcxt, i);
 
 				shm_mq_detach(pcxt->worker[i].error_mqh);
 				pcxt->worker[i].error_mqh = NULL;
@@ -1238,6 +1345,49 @@ AtEOXact_Parallel(bool isCommit)
 void
 ParallelWorkerMain(Datum main_arg)
 {
+	dsm_handle	handle = DatumGetUInt32(main_arg);
+	int			worker_number;
+	MemoryContext workercxt;
+
+	/* Establish signal handlers. */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/* Determine our parallel worker number. */
+	memcpy(&worker_number, MyBgworkerEntry->bgw_extra, sizeof(int));
+
+	/* Set up a memory context to work in, just for cleanliness. */
+	workercxt = AllocSetContextCreate(TopMemoryContext,
+									  "Parallel worker",
+									  ALLOCSET_DEFAULT_SIZES);
+
+	/*
+	 * Serve the parallel context we were launched for, and then, if we may
+	 * stay in the pool of idle workers, whatever other contexts leaders hand
+	 * us before we time out.
+	 */
+	for (;;)
+	{
+		MemoryContextSwitchTo(workercxt);
+		if (!ParallelWorkerRun(handle, worker_number))
+			break;
+		MemoryContextReset(workercxt);
+		if (!ParallelPoolWaitForWork(&handle, &worker_number))
+			break;
+	}
+}
+
+/*
+ * Serve one parallel context, whose segment is given by 'handle', as its
+ * worker number 'worker_number'.
+ *
+ * Returns true if we're done with the context and have returned to the pool
+ * of idle workers, false if we should exit.
+ */
+static bool
+ParallelWorkerRun(dsm_handle handle, int worker_number)
+{
+	static bool shutdown_callback_registered = false;
 	dsm_segment *seg;
 	shm_toc    *toc;
 	FixedParallelState *fps;
@@ -1260,22 +1410,14 @@ ParallelWorkerMain(Datum main_arg)
 	char	   *enumblacklistspace;
 	StringInfoData msgbuf;
 	char	   *session_dsm_handle_space;
+	PGPROC	   *leader;
 
 	/* Set flag to indicate that we're initializing a parallel worker. */
 	InitializingParallelWorker = true;
 
-	/* Establish signal handlers. */
-	pqsignal(SIGTERM, die);
-	BackgroundWorkerUnblockSignals();
-
-	/* Determine and set our parallel worker number. */
+	/* Set our parallel worker number. */
 	Assert(ParallelWorkerNumber == -1);
-	memcpy(&ParallelWorkerNumber, MyBgworkerEntry->bgw_extra, sizeof(int));
-
-	/* Set up a memory context to work in, just for cleanliness. */
-	CurrentMemoryContext = AllocSetContextCreate(TopMemoryContext,
-												 "Parallel worker",
-												 ALLOCSET_DEFAULT_SIZES);
+	ParallelWorkerNumber = worker_number;
 
 	/*
 	 * Attach to the dynamic shared memory segment for the parallel query, and
@@ -1286,7 +1428,7 @@ ParallelWorkerMain(Datum main_arg)
 	 * exit, which is fine.  If there were a ResourceOwner, it would acquire
 	 * ownership of the mapping, but we have no need for that.
 	 */
-	seg = dsm_attach(DatumGetUInt32(main_arg));
+	seg = dsm_attach(handle);
 	if (seg == NULL)
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
@@ -1304,7 +1446,11 @@ ParallelWorkerMain(Datum main_arg)
 	/* Arrange to signal the leader if we exit. */
 	ParallelLeaderPid = fps->parallel_leader_pid;
 	ParallelLeaderBackendId = fps->parallel_leader_backend_id;
-	on_shmem_exit(ParallelWorkerShutdown, (Datum) 0);
+	if (!shutdown_callback_registered)
+	{
+		on_shmem_exit(ParallelWorkerShutdown, (Datum) 0);
+		shutdown_callback_registered = true;
+	}
 
 	/*
 	 * Now we can find and attach to the error queue provided for us.  That's
@@ -1349,7 +1495,7 @@ ParallelWorkerMain(Datum main_arg)
 	 */
 	if (!BecomeLockGroupMember(fps->parallel_leader_pgproc,
 							   fps->parallel_leader_pid))
-		return;
+		return false;
 
 	/*
 	 * Restore transaction and statement start-time timestamps.  This must
@@ -1369,16 +1515,25 @@ ParallelWorkerMain(Datum main_arg)
 
 	entrypt = LookupParallelWorkerFunction(library_name, function_name);
 
-	/* Restore database connection. */
-	BackgroundWorkerInitializeConnectionByOid(fps->database_id,
-											  fps->authenticated_user_id,
-											  0);
-
 	/*
-	 * Set the client encoding to the database encoding, since that is what
-	 * the leader will expect.
+	 * Restore database connection, unless we still have it from a previous
+	 * context.  Leaders only hand a pooled worker contexts for the same
+	 * database and user.
 	 */
-	SetClientEncoding(GetDatabaseEncoding());
+	if (!OidIsValid(MyDatabaseId))
+	{
+		BackgroundWorkerInitializeConnectionByOid(fps->database_id,
+												  fps->authenticated_user_id,
+												  0);
+
+		/*
+		 * Set the client encoding to the database encoding, since that is
+		 * what the leader will expect.
+		 */
+		SetClientEncoding(GetDatabaseEncoding());
+	}
+	Assert(MyDatabaseId == fps->database_id);
+	Assert(GetAuthenticatedUserId() == fps->authenticated_user_id);
 
 	/*
 	 * Load libraries that were loaded by original backend.  We want to do
@@ -1386,6 +1541,7 @@ ParallelWorkerMain(Datum main_arg)
 	 * variables.
 	 */
 	libraryspace = shm_toc_lookup(toc, PARALLEL_KEY_LIBRARY, false);
+	MyLibraryStateHash = hash_library_state(libraryspace);
 	StartTransactionCommand();
 	RestoreLibraryState(libraryspace);
 
@@ -1483,6 +1639,32 @@ ParallelWorkerMain(Datum main_arg)
 
 	/* Report success. */
 	pq_putmessage('X', NULL, 0);
+
+	/* Without a pool of idle workers, we're done. */
+	if (parallel_worker_pool_size <= 0)
+		return false;
+
+	/*
+	 * Forget about this context, so that we can serve another one.  The
+	 * per-context state restored above was reset at the end of the parallel
+	 * worker transaction or by DetachSession(), except for the reindex state.
+	 * Detaching from the segment also detaches us from our error queue, which
+	 * ends the redirection of our messages to it.
+	 */
+	leader = fps->parallel_leader_pgproc;
+	ResetReindexState(0);
+	LeaveLockGroup();
+	dsm_detach(seg);
+	MyFixedParallelState = NULL;
+	ParallelLeaderPid = 0;
+	ParallelLeaderBackendId = InvalidBackendId;
+	ParallelWorkerNumber = -1;
+
+	/* Send our statistics, as we would when exiting. */
+	pgstat_report_stat(true);
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	return ParallelPoolReturnWorker(leader);
 }
 
 /*
@@ -1510,6 +1692,10 @@ ParallelWorkerReportLastRecEnd(XLogRecPtr last_xlog_end)
 static void
 ParallelWorkerShutdown(int code, Datum arg)
 {
+	/* Nothing to do in a pooled worker not serving any leader */
+	if (ParallelLeaderPid == 0)
+		return;
+
 	SendProcSignal(ParallelLeaderPid,
 				   PROCSIG_PARALLEL_MESSAGE,
 				   ParallelLeaderBackendId);
@@ -1558,3 +1744,428 @@ LookupParallelWorkerFunction(const char *libraryname, const char *funcname)
 	return (parallel_worker_main_type)
 		load_external_function(libraryname, funcname, true, NULL);
 }
+
+/*
+ * Report shared-memory space needed by the pool of idle parallel workers.
+ *
+ * Every background worker process might be a parallel worker, so that's how
+ * many slots we need at most.
+ */
+Size
+ParallelWorkerPoolShmemSize(void)
+{
+	return add_size(offsetof(ParallelPoolData, slots),
+					mul_size(max_worker_processes, sizeof(ParallelPoolSlot)));
+}
+
+/*
+ * Initialize the pool of idle parallel workers during shared-memory setup.
+ */
+void
+ParallelWorkerPoolShmemInit(void)
+{
+	bool		found;
+
+	ParallelPool = ShmemInitStruct("Parallel Worker Pool",
+								   ParallelWorkerPoolShmemSize(),
+								   &found);
+	if (!found)
+	{
+		int			i;
+
+		ParallelPool->nslots = max_worker_processes;
+		for (i = 0; i < ParallelPool->nslots; i++)
+		{
+			ParallelPoolSlot *slot = &ParallelPool->slots[i];
+
+			memset(slot, 0, sizeof(ParallelPoolSlot));
+			slot->assigned_seg = DSM_HANDLE_INVALID;
+		}
+	}
+}
+
+/*
+ * Hash the serialized list of loaded libraries found at 'libraryspace'.
+ */
+static uint32
+hash_library_state(const char *libraryspace)
+{
+	const char *p = libraryspace;
+
+	/* The list ends with an empty name */
+	while (*p != '\0')
+		p += strlen(p) + 1;
+
+	return hash_bytes((const unsigned char *) libraryspace,
+					  p - libraryspace);
+}
+
+/*
+ * Try to hand the parallel context to an idle pooled worker, to become its
+ * worker number 'i'.  Returns false if there's no suitable idle worker.
+ */
+static bool
+ParallelPoolClaimWorker(ParallelContext *pcxt, int i)
+{
+	Oid			userid;
+	uint32		library_hash;
+	PGPROC	   *proc = NULL;
+	int			s;
+
+	if (parallel_worker_pool_size <= 0)
+		return false;
+
+	userid = GetAuthenticatedUserId();
+	library_hash =
+		hash_library_state(shm_toc_lookup(pcxt->toc, PARALLEL_KEY_LIBRARY,
+										  false));
+
+	LWLockAcquire(ParallelWorkerPoolLock, LW_EXCLUSIVE);
+	for (s = 0; s < ParallelPool->nslots; s++)
+	{
+		ParallelPoolSlot *slot = &ParallelPool->slots[s];
+
+		if (slot->pid == 0 || slot->leader_pid != 0 || slot->exit_requested)
+			continue;
+		if (slot->database_id != MyDatabaseId ||
+			slot->authenticated_user_id != userid ||
+			slot->library_hash != library_hash)
+			continue;
+
+		slot->leader_pid = MyProcPid;
+		slot->assigned_seg = dsm_segment_handle(pcxt->seg);
+		slot->assigned_worker_number = i;
+		pcxt->worker[i].pool_slot = s;
+		pcxt->worker[i].pool_generation = slot->generation;
+		proc = slot->proc;
+		break;
+	}
+	LWLockRelease(ParallelWorkerPoolLock);
+
+	if (proc == NULL)
+		return false;
+
+	SetLatch(&proc->procLatch);
+	return true;
+}
+
+/*
+ * Ask one idle pooled worker, for whatever database, to exit.
+ */
+static void
+ParallelPoolShrink(void)
+{
+	PGPROC	   *proc = NULL;
+	int			s;
+
+	LWLockAcquire(ParallelWorkerPoolLock, LW_EXCLUSIVE);
+	for (s = 0; s < ParallelPool->nslots; s++)
+	{
+		ParallelPoolSlot *slot = &ParallelPool->slots[s];
+
+		if (slot->pid != 0 && slot->leader_pid == 0 && !slot->exit_requested)
+		{
+			slot->exit_requested = true;
+			proc = slot->proc;
+			break;
+		}
+	}
+	LWLockRelease(ParallelWorkerPoolLock);
+
+	if (proc != NULL)
+		SetLatch(&proc->procLatch);
+}
+
+/*
+ * Like GetBackgroundWorkerPid(), for worker 'i' of the parallel context,
+ * whether we launched it or it came from the pool.
+ */
+static BgwHandleStatus
+GetParallelWorkerStatus(ParallelContext *pcxt, int i, pid_t *pidp)
+{
+	ParallelWorkerInfo *worker = &pcxt->worker[i];
+	ParallelPoolSlot *slot;
+	BgwHandleStatus status = BGWH_STOPPED;
+
+	if (worker->bgwhandle != NULL)
+		return GetBackgroundWorkerPid(worker->bgwhandle, pidp);
+
+	Assert(worker->pool_slot >= 0);
+	LWLockAcquire(ParallelWorkerPoolLock, LW_SHARED);
+	slot = &ParallelPool->slots[worker->pool_slot];
+	if (slot->pid != 0 && slot->generation == worker->pool_generation)
+	{
+		*pidp = slot->pid;
+		status = BGWH_STARTED;
+	}
+	LWLockRelease(ParallelWorkerPoolLock);
+
+	return status;
+}
+
+/*
+ * Has worker 'i' of the parallel context returned to the pool, or left it,
+ * so that it's done with this context?
+ */
+static bool
+ParallelWorkerReleased(ParallelContext *pcxt, int i)
+{
+	ParallelWorkerInfo *worker = &pcxt->worker[i];
+	bool		result = false;
+
+	/*
+	 * Workers we launched ourselves join the pool only if we have it
+	 * enabled, and we only know which slot they took by their PID.
+	 */
+	if (worker->pool_slot < 0 &&
+		(parallel_worker_pool_size <= 0 || worker->pid == 0))
+		return false;
+
+	LWLockAcquire(ParallelWorkerPoolLock, LW_SHARED);
+	if (worker->pool_slot >= 0)
+	{
+		ParallelPoolSlot *slot = &ParallelPool->slots[worker->pool_slot];
+
+		result = (slot->pid == 0 ||
+				  slot->generation != worker->pool_generation ||
+				  slot->leader_pid != MyProcPid);
+	}
+	else
+	{
+		int			s;
+
+		for (s = 0; s < ParallelPool->nslots; s++)
+		{
+			ParallelPoolSlot *slot = &ParallelPool->slots[s];
+
+			if (slot->pid == worker->pid && slot->leader_pid != MyProcPid)
+			{
+				result = true;
+				break;
+			}
+		}
+	}
+	LWLockRelease(ParallelWorkerPoolLock);
+
+	return result;
+}
+
+/*
+ * Like TerminateBackgroundWorker(), for worker 'i' of the parallel context.
+ */
+static void
+TerminateParallelWorker(ParallelContext *pcxt, int i)
+{
+	ParallelWorkerInfo *worker = &pcxt->worker[i];
+	ParallelPoolSlot *slot;
+	pid_t		pid = 0;
+
+	if (worker->bgwhandle != NULL)
+	{
+		TerminateBackgroundWorker(worker->bgwhandle);
+		return;
+	}
+
+	/* Don't kill the worker if it has moved on to another leader already */
+	Assert(worker->pool_slot >= 0);
+	LWLockAcquire(ParallelWorkerPoolLock, LW_SHARED);
+	slot = &ParallelPool->slots[worker->pool_slot];
+	if (slot->generation == worker->pool_generation &&
+		slot->leader_pid == MyProcPid)
+		pid = slot->pid;
+	LWLockRelease(ParallelWorkerPoolLock);
+
+	if (pid != 0)
+		(void) kill(pid, SIGTERM);
+}
+
+/*
+ * Like WaitForBackgroundWorkerShutdown(), for worker 'i' of the parallel
+ * context, except that a worker returning to the pool counts as shut down.
+ */
+static BgwHandleStatus
+WaitForParallelWorkerShutdown(ParallelContext *pcxt, int i)
+{
+	for (;;)
+	{
+		pid_t		pid;
+		int			rc;
+
+		if (GetParallelWorkerStatus(pcxt, i, &pid) == BGWH_STOPPED ||
+			ParallelWorkerReleased(pcxt, i))
+			return BGWH_STOPPED;
+
+		rc = WaitLatch(MyLatch,
+					   WL_LATCH_SET | WL_POSTMASTER_DEATH, 0,
+					   WAIT_EVENT_BGWORKER_SHUTDOWN);
+
+		if (rc & WL_POSTMASTER_DEATH)
+			return BGWH_POSTMASTER_DIED;
+
+		ResetLatch(MyLatch);
+	}
+}
+
+/*
+ * Return to the pool of idle workers after serving a parallel context, or
+ * join it if this was our first one.  Returns false if the pool is full, in
+ * which case we should exit.  Either way, we let the leader know that we're
+ * done with its context.
+ */
+static bool
+ParallelPoolReturnWorker(PGPROC *leader)
+{
+	static bool exit_callback_registered = false;
+	bool		result = true;
+	int			nused = 0;
+	int			freeslot = -1;
+	int			s;
+
+	LWLockAcquire(ParallelWorkerPoolLock, LW_EXCLUSIVE);
+	for (s = 0; s < ParallelPool->nslots; s++)
+	{
+		if (ParallelPool->slots[s].pid != 0)
+			nused++;
+		else if (freeslot < 0)
+			freeslot = s;
+	}
+
+	if (MyPoolSlot >= 0)
+	{
+		ParallelPoolSlot *slot = &ParallelPool->slots[MyPoolSlot];
+
+		/* Leave the pool if it has been made smaller meanwhile */
+		if (nused > parallel_worker_pool_size || slot->exit_requested)
+		{
+			slot->pid = 0;
+			slot->proc = NULL;
+			MyPoolSlot = -1;
+			result = false;
+		}
+		slot->leader_pid = 0;
+	}
+	else if (nused < parallel_worker_pool_size && freeslot >= 0)
+	{
+		ParallelPoolSlot *slot = &ParallelPool->slots[freeslot];
+
+		slot->pid = MyProcPid;
+		slot->proc = MyProc;
+		slot->generation++;
+		slot->database_id = MyDatabaseId;
+		slot->authenticated_user_id = GetAuthenticatedUserId();
+		slot->library_hash = MyLibraryStateHash;
+		slot->leader_pid = 0;
+		slot->assigned_seg = DSM_HANDLE_INVALID;
+		slot->exit_requested = false;
+		MyPoolSlot = freeslot;
+	}
+	else
+		result = false;
+	LWLockRelease(ParallelWorkerPoolLock);
+
+	if (MyPoolSlot >= 0 && !exit_callback_registered)
+	{
+		on_shmem_exit(ParallelPoolWorkerExit, (Datum) 0);
+		exit_callback_registered = true;
+	}
+
+	SetLatch(&leader->procLatch);
+
+	return result;
+}
+
+/*
+ * Wait in the pool of idle workers until a leader hands us a parallel
+ * context.  Returns false if we have been idle for longer than
+ * parallel_worker_idle_timeout or have been asked to exit; otherwise,
+ * *handle and *worker_number are set to the context's segment and our worker
+ * number in it.
+ */
+static bool
+ParallelPoolWaitForWork(dsm_handle *handle, int *worker_number)
+{
+	TimestampTz idle_start = GetCurrentTimestamp();
+	bool		result = false;
+
+	Assert(MyPoolSlot >= 0);
+	ParallelPoolSetIdle(true);
+
+	for (;;)
+	{
+		ParallelPoolSlot *slot;
+		long		timeout;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* Don't make the invalidation queue wait for us */
+		if (catchupInterruptPending)
+			ProcessCatchupInterrupt();
+
+		timeout = parallel_worker_idle_timeout -
+			(long) ((GetCurrentTimestamp() - idle_start) / 1000);
+
+		LWLockAcquire(ParallelWorkerPoolLock, LW_EXCLUSIVE);
+		slot = &ParallelPool->slots[MyPoolSlot];
+		if (slot->assigned_seg != DSM_HANDLE_INVALID)
+		{
+			Assert(slot->leader_pid != 0);
+			*handle = slot->assigned_seg;
+			*worker_number = slot->assigned_worker_number;
+			slot->assigned_seg = DSM_HANDLE_INVALID;
+			result = true;
+			break;
+		}
+		if (slot->exit_requested || timeout <= 0)
+		{
+			slot->pid = 0;
+			slot->proc = NULL;
+			MyPoolSlot = -1;
+			break;
+		}
+		LWLockRelease(ParallelWorkerPoolLock);
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 timeout, WAIT_EVENT_PARALLEL_WORKER_IDLE);
+		ResetLatch(MyLatch);
+	}
+	LWLockRelease(ParallelWorkerPoolLock);
+
+	ParallelPoolSetIdle(false);
+
+	return result;
+}
+
+/*
+ * Advertise in our PGPROC whether we're an idle pooled worker, so that
+ * commands like DROP DATABASE can make us exit rather than wait for us.
+ */
+static void
+ParallelPoolSetIdle(bool idle)
+{
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+	if (idle)
+		MyProc->vacuumFlags |= PROC_IS_IDLE_PARALLEL_WORKER;
+	else
+		MyProc->vacuumFlags &= ~PROC_IS_IDLE_PARALLEL_WORKER;
+	ProcGlobal->vacuumFlags[MyProc->pgxactoff] = MyProc->vacuumFlags;
+	LWLockRelease(ProcArrayLock);
+}
+
+/*
+ * Give up our slot in the pool at process exit.
+ */
+static void
+ParallelPoolWorkerExit(int code, Datum arg)
+{
+	if (MyPoolSlot < 0)
+		return;
+
+	LWLockAcquire(ParallelWorkerPoolLock, LW_EXCLUSIVE);
+	ParallelPool->slots[MyPoolSlot].pid = 0;
+	ParallelPool->slots[MyPoolSlot].proc = NULL;
+	ParallelPool->slots[MyPoolSlot].leader_pid = 0;
+	ParallelPool->slots[MyPoolSlot].assigned_seg = DSM_HANDLE_INVALID;
+	LWLockRelease(ParallelWorkerPoolLock);
+	MyPoolSlot = -1;
+}
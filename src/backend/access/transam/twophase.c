@@ -106,6 +106,8 @@
 #include "storage/smgr.h"
 #include "utils/builtins.h"
 #include "utils/memutils.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
 #include "utils/timestamp.h"
 
 /*
@@ -447,6 +449,8 @@ MarkAsPreparingGuts(GlobalTransaction gxact, TransactionId xid, const char *gid,
 					TimestampTz prepared_at, Oid owner, Oid databaseid)
 {
 	PGPROC	   *proc;
+	uint64	   *fpLockBits;
+	Oid		   *fpRelId;
 	int			i;
 
 	Assert(LWLockHeldByMeInMode(TwoPhaseStateLock, LW_EXCLUSIVE));
@@ -454,8 +458,12 @@ MarkAsPreparingGuts(GlobalTransaction gxact, TransactionId xid, const char *gid,
 	Assert(gxact != NULL);
 	proc = &ProcGlobal->allProcs[gxact->pgprocno];
 
-	/* Initialize the PGPROC entry */
+	/* Initialize the PGPROC entry, keeping its fast-path lock arrays */
+	fpLockBits = proc->fpLockBits;
+	fpRelId = proc->fpRelId;
 	MemSet(proc, 0, sizeof(PGPROC));
+	proc->fpLockBits = fpLockBits;
+	proc->fpRelId = fpRelId;
 	proc->pgprocno = gxact->pgprocno;
 	SHMQueueElemInit(&(proc->links));
 	proc->waitStatus = PROC_WAIT_STATUS_OK;
@@ -1512,6 +1520,10 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 	 */
 	if (hdr->initfileinval)
 		RelationCacheInitFilePreInvalidate();
+	if (shared_catcache_size > 0 && hdr->ninvalmsgs > 0)
+		SharedCatCacheInvalidate(invalmsgs, hdr->ninvalmsgs);
+	if (shared_plan_cache_size > 0 && hdr->ninvalmsgs > 0)
+		SharedPlanCacheInvalidate(invalmsgs, hdr->ninvalmsgs);
 	SendSharedInvalidMessages(invalmsgs, hdr->ninvalmsgs);
 	if (hdr->initfileinval)
 		RelationCacheInitFilePostInvalidate();
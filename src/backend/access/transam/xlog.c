@@ -35,6 +35,8 @@
 #include "access/xlog_internal.h"
 #include "access/xlogarchive.h"
 #include "access/xloginsert.h"
+#include "access/xlogparallel.h"
+#include "access/xlogprefetch.h"
 #include "access/xlogreader.h"
 #include "access/xlogutils.h"
 #include "catalog/catversion.h"
@@ -43,11 +45,13 @@
 #include "commands/progress.h"
 #include "commands/tablespace.h"
 #include "common/controldata_utils.h"
+#include "funcapi.h"
 #include "executor/instrument.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
 #include "port/atomics.h"
+#include "port/pg_bitutils.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/startup.h"
 #include "postmaster/walwriter.h"
@@ -59,6 +63,7 @@
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/large_object.h"
@@ -71,6 +76,7 @@
 #include "storage/smgr.h"
 #include "storage/spin.h"
 #include "storage/sync.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
@@ -96,7 +102,7 @@ char	   *XLogArchiveCommand = NULL;
 bool		EnableHotStandby = false;
 bool		fullPageWrites = true;
 bool		wal_log_hints = false;
-bool		wal_compression = false;
+int			wal_compression = WAL_COMPRESSION_NONE;
 char	   *wal_consistency_checking_string = NULL;
 bool	   *wal_consistency_checking = NULL;
 bool		wal_init_zero = true;
@@ -106,6 +112,7 @@ int			sync_method = DEFAULT_SYNC_METHOD;
 int			wal_level = WAL_LEVEL_MINIMAL;
 int			CommitDelay = 0;	/* precommit delay in microseconds */
 int			CommitSiblings = 5; /* # concurrent xacts needed to sleep */
+bool		adaptive_commit_delay = false;
 int			wal_retrieve_retry_interval = 5000;
 int			max_slot_wal_keep_size_mb = -1;
 
@@ -116,11 +123,12 @@ bool		XLOG_DEBUG = false;
 int			wal_segment_size = DEFAULT_XLOG_SEG_SIZE;
 
 /*
- * Number of WAL insertion locks to use. A higher value allows more insertions
- * to happen concurrently, but adds some CPU overhead to flushing the WAL,
- * which needs to iterate all the locks.
+ * Number of WAL insertion locks to use (wal_insert_locks). A higher value
+ * allows more insertions to happen concurrently, but adds some CPU overhead
+ * to flushing the WAL, which needs to iterate all the locks.  -1 means to
+ * choose a value based on the number of CPUs, in XLOGShmemSize().
  */
-#define NUM_XLOGINSERT_LOCKS  8
+int			NumXLogInsertLocks = -1;
 
 /*
  * Max distance from last checkpoint, before triggering a new xlog-based
@@ -382,6 +390,13 @@ static bool doPageWrites;
 /* Has the recovery code requested a walreceiver wakeup? */
 static bool doRequestWalReceiverReply;
 
+/*
+ * End+1 of the last record handed to a parallel redo worker, if the
+ * replay position hasn't been advanced past it yet, and its timeline.
+ */
+static XLogRecPtr parallelRedoEndRecPtr = InvalidXLogRecPtr;
+static TimeLineID parallelRedoTLI = 0;
+
 /*
  * RedoStartLSN points to the checkpoint's REDO location which is specified
  * in a backup label file, backup history file or control file. In standby
@@ -591,6 +606,37 @@ typedef struct XLogCtlInsert
 	WALInsertLockPadded *WALInsertLocks;
 } XLogCtlInsert;
 
+/*
+ * Number of buckets in the group size and flush time histograms shown by
+ * pg_stat_group_commit.
+ */
+#define GROUP_COMMIT_HISTOGRAM_BUCKETS 16
+
+/*
+ * Statistics about the WAL flushes done by XLogFlush, for the
+ * pg_stat_group_commit view.  Only updated while holding WALWriteLock, but
+ * can be read without it.  Times are in microseconds.
+ */
+typedef struct XLogGroupCommitStats
+{
+	pg_atomic_uint64 reset_time;	/* TimestampTz of last reset */
+	pg_atomic_uint64 flushes;	/* flushes done by XLogFlush */
+	pg_atomic_uint64 requests;	/* flush requests served by them */
+	pg_atomic_uint64 delays;	/* flushes that waited before starting */
+	pg_atomic_uint64 delay_time;	/* total time waited */
+	pg_atomic_uint64 flush_time;	/* total time spent writing and syncing */
+	pg_atomic_uint64 avg_flush_time;	/* current moving averages */
+	pg_atomic_uint64 avg_request_interval;
+
+	/*
+	 * group_size[i] counts flushes serving between 2^i and 2^(i+1) - 1
+	 * requests, flush_latency[i] flushes taking between 2^(i+3) and
+	 * 2^(i+4) - 1 microseconds.  The first and last buckets are open-ended.
+	 */
+	pg_atomic_uint64 group_size[GROUP_COMMIT_HISTOGRAM_BUCKETS];
+	pg_atomic_uint64 flush_latency[GROUP_COMMIT_HISTOGRAM_BUCKETS];
+} XLogGroupCommitStats;
+
 /*
  * Total shared-memory state for XLOG.
  */
@@ -615,6 +661,22 @@ typedef struct XLogCtlData
 	pg_time_t	lastSegSwitchTime;
 	XLogRecPtr	lastSegSwitchLSN;
 
+	/*
+	 * Group commit state.  flushRequests counts the calls to XLogFlush that
+	 * found the WAL not flushed far enough yet, and is advanced without a
+	 * lock.  The rest is protected by WALWriteLock and maintained by the
+	 * backends flushing in XLogFlush: the start time of the latest flush and
+	 * flushRequests at that time, and moving averages of the time a flush
+	 * takes and of the interval between requests, in microseconds, which
+	 * drive adaptive_commit_delay.
+	 */
+	pg_atomic_uint64 flushRequests;
+	uint64		lastFlushRequests;
+	instr_time	lastFlushStart;
+	double		avgFlushTime;
+	double		avgRequestInterval;
+	XLogGroupCommitStats groupCommitStats;
+
 	/*
 	 * Protected by info_lck and WALWriteLock (you must hold either lock to
 	 * read it, but both to update)
@@ -888,6 +950,7 @@ static bool recoveryStopsBefore(XLogReaderState *record);
 static bool recoveryStopsAfter(XLogReaderState *record);
 static void recoveryPausesHere(bool endOfRecovery);
 static bool recoveryApplyDelay(XLogReaderState *record);
+static void ParallelRedoCatchUp(void);
 static void SetLatestXTime(TimestampTz xtime);
 static void SetCurrentChunkStartTime(TimestampTz xtime);
 static void CheckRequiredParameterValues(void);
@@ -900,9 +963,12 @@ static void CheckPointGuts(XLogRecPtr checkPointRedo, int flags);
 static void KeepLogSeg(XLogRecPtr recptr, XLogSegNo *logSegNo);
 static XLogRecPtr XLogGetReplicationSlotMinimumLSN(void);
 
-static void AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic);
+static int	AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic);
 static bool XLogCheckpointNeeded(XLogSegNo new_segno);
 static void XLogWrite(XLogwrtRqst WriteRqst, bool flexible);
+static uint64 XLogGroupCommitDelay(void);
+static void XLogGroupCommitUpdate(uint64 requests, instr_time start,
+								  uint64 delay);
 static bool InstallXLogFileSegment(XLogSegNo *segno, char *tmppath,
 								   bool find_free, XLogSegNo max_segno,
 								   bool use_lock);
@@ -1036,7 +1102,7 @@ XLogInsertRecord(XLogRecData *rdata,
 	 * inserter acquires an insertion lock. In addition to just indicating that
 	 * an insertion is in progress, the lock tells others how far the inserter
 	 * has progressed. There is a small fixed number of insertion locks,
-	 * determined by NUM_XLOGINSERT_LOCKS. When an inserter crosses a page
+	 * determined by NumXLogInsertLocks. When an inserter crosses a page
 	 * boundary, it updates the value stored in the lock to the how far it has
 	 * inserted, to allow the previous buffer to be flushed.
 	 *
@@ -1667,7 +1733,7 @@ WALInsertLockAcquire(void)
 	static int	lockToTry = -1;
 
 	if (lockToTry == -1)
-		lockToTry = MyProc->pgprocno % NUM_XLOGINSERT_LOCKS;
+		lockToTry = MyProc->pgprocno % NumXLogInsertLocks;
 	MyLockNo = lockToTry;
 
 	/*
@@ -1685,7 +1751,7 @@ WALInsertLockAcquire(void)
 		 * than locks, it still helps to distribute the inserters evenly
 		 * across the locks.
 		 */
-		lockToTry = (lockToTry + 1) % NUM_XLOGINSERT_LOCKS;
+		lockToTry = (lockToTry + 1) % NumXLogInsertLocks;
 	}
 }
 
@@ -1703,7 +1769,7 @@ WALInsertLockAcquireExclusive(void)
 	 * indicator is set to 0xFFFFFFFFFFFFFFFF, which is higher than any real
 	 * XLogRecPtr value, to make sure that no-one blocks waiting on those.
 	 */
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS - 1; i++)
+	for (i = 0; i < NumXLogInsertLocks - 1; i++)
 	{
 		LWLockAcquire(&WALInsertLocks[i].l.lock, LW_EXCLUSIVE);
 		LWLockUpdateVar(&WALInsertLocks[i].l.lock,
@@ -1729,7 +1795,7 @@ WALInsertLockRelease(void)
 	{
 		int			i;
 
-		for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+		for (i = 0; i < NumXLogInsertLocks; i++)
 			LWLockReleaseClearVar(&WALInsertLocks[i].l.lock,
 								  &WALInsertLocks[i].l.insertingAt,
 								  0);
@@ -1757,8 +1823,8 @@ WALInsertLockUpdateInsertingAt(XLogRecPtr insertingAt)
 		 * We use the last lock to mark our actual position, see comments in
 		 * WALInsertLockAcquireExclusive.
 		 */
-		LWLockUpdateVar(&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.lock,
-						&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.insertingAt,
+		LWLockUpdateVar(&WALInsertLocks[NumXLogInsertLocks - 1].l.lock,
+						&WALInsertLocks[NumXLogInsertLocks - 1].l.insertingAt,
 						insertingAt);
 	}
 	else
@@ -1825,7 +1891,7 @@ WaitXLogInsertionsToFinish(XLogRecPtr upto)
 	 * out for any insertion that's still in progress.
 	 */
 	finishedUpto = reservedUpto;
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < NumXLogInsertLocks; i++)
 	{
 		XLogRecPtr	insertingat = InvalidXLogRecPtr;
 
@@ -1957,6 +2023,14 @@ GetXLogBuffer(XLogRecPtr ptr)
 
 		WALInsertLockUpdateInsertingAt(initializedUpto);
 
+		/*
+		 * The WAL writer is normally expected to have initialized the page
+		 * already.  Wake it up, so that it catches up with writing out and
+		 * initializing pages ahead of us.
+		 */
+		if (ProcGlobal->walwriterLatch)
+			SetLatch(ProcGlobal->walwriterLatch);
+
 		AdvanceXLInsertBuffer(ptr, false);
 		endptr = XLogCtl->xlblocks[idx];
 
@@ -1986,6 +2060,69 @@ GetXLogBuffer(XLogRecPtr ptr)
 	return cachedPos + ptr % XLOG_BLCKSZ;
 }
 
+/*
+ * Read WAL from the WAL buffers, instead of the WAL files.
+ *
+ * Copies 'count' bytes starting at 'startptr' into 'buf', for as long as the
+ * pages are still in the WAL buffers.  Returns the number of bytes copied,
+ * which is less than 'count' if the beginning of the range has already been
+ * evicted, or if a page got replaced while we were copying it; the rest has
+ * to be read from the WAL files.  The caller must make sure that the WAL
+ * in question has been written out, and is on the current timeline.
+ *
+ * This doesn't take any locks, so walsenders can use it without getting in
+ * the way of WAL insertion.
+ */
+Size
+XLogReadFromBuffers(char *buf, XLogRecPtr startptr, Size count)
+{
+	XLogRecPtr	ptr = startptr;
+	Size		nbytes = count;
+
+	/* During recovery, the WAL buffers are not in use */
+	if (RecoveryInProgress())
+		return 0;
+
+#ifndef PG_HAVE_8BYTE_SINGLE_COPY_ATOMICITY
+	/* can't read xlblocks safely without a lock on this platform */
+	return 0;
+#endif
+
+	while (nbytes > 0)
+	{
+		int			idx = XLogRecPtrToBufIdx(ptr);
+		XLogRecPtr	expectedEndPtr;
+		Size		offset;
+		Size		npagebytes;
+
+		expectedEndPtr = ptr + (XLOG_BLCKSZ - ptr % XLOG_BLCKSZ);
+
+		/* Is the page still in its buffer? */
+		if (*((volatile XLogRecPtr *) &XLogCtl->xlblocks[idx]) != expectedEndPtr)
+			break;
+		pg_read_barrier();
+
+		offset = ptr % XLOG_BLCKSZ;
+		npagebytes = Min(nbytes, XLOG_BLCKSZ - offset);
+		memcpy(buf, XLogCtl->pages + idx * (Size) XLOG_BLCKSZ + offset,
+			   npagebytes);
+
+		/*
+		 * AdvanceXLInsertBuffer() invalidates xlblocks before overwriting a
+		 * buffer, so if it's still the same, what we copied is good.
+		 */
+		pg_read_barrier();
+		if (*((volatile XLogRecPtr *) &XLogCtl->xlblocks[idx]) != expectedEndPtr)
+			break;
+
+		buf += npagebytes;
+		ptr += npagebytes;
+		nbytes -= npagebytes;
+	}
+
+	return count - nbytes;
+}
+
 /*
  * Converts a "usable byte position" to XLogRecPtr. A usable byte position
  * is the position starting from the beginning of WAL, excluding all WAL
@@ -2117,8 +2254,15 @@ XLogRecPtrToBytePos(XLogRecPtr ptr)
  * true, initialize as many pages as we can without having to write out
  * unwritten data. Any new pages are initialized to zeros, with pages headers
  * initialized properly.
+ *
+ * Opportunistic initialization happens ahead of demand, mostly in the WAL
+ * writer, so it never waits for WALBufMappingLock and lets go of it after
+ * every page.  Inserters needing a page are kept waiting for one page's
+ * initialization at most.
+ *
+ * Returns the number of pages initialized.
  */
-static void
+static int
 AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic)
 {
 	XLogCtlInsert *Insert = &XLogCtl->Insert;
@@ -2130,7 +2274,10 @@ AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic)
 	XLogPageHeader NewPage;
 	int			npages = 0;
 
-	LWLockAcquire(WALBufMappingLock, LW_EXCLUSIVE);
+	if (!opportunistic)
+		LWLockAcquire(WALBufMappingLock, LW_EXCLUSIVE);
+	else if (!LWLockConditionalAcquire(WALBufMappingLock, LW_EXCLUSIVE))
+		return 0;
 
 	/*
 	 * Now that we have the lock, check if someone initialized the page
@@ -2213,6 +2360,14 @@ AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic)
 
 		NewPage = (XLogPageHeader) (XLogCtl->pages + nextidx * (Size) XLOG_BLCKSZ);
 
+		/*
+		 * Mark the buffer as not holding the old page anymore before we
+		 * start overwriting it.  XLogReadFromBuffers() reads pages without
+		 * holding a lock, and checks xlblocks again after copying one.
+		 */
+		*((volatile XLogRecPtr *) &XLogCtl->xlblocks[nextidx]) = InvalidXLogRecPtr;
+		pg_write_barrier();
+
 		/*
 		 * Be sure to re-zero the buffer so that bytes beyond what we've
 		 * written will look like zeroes and not valid XLOG records...
@@ -2271,9 +2426,19 @@ AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic)
 		XLogCtl->InitializedUpTo = NewPageEndPtr;
 
 		npages++;
+
+		/* Give way to those who need a page now */
+		if (opportunistic)
+		{
+			LWLockRelease(WALBufMappingLock);
+			if (!LWLockConditionalAcquire(WALBufMappingLock, LW_EXCLUSIVE))
+				goto done;
+		}
 	}
 	LWLockRelease(WALBufMappingLock);
 
+done:
+
 #ifdef WAL_DEBUG
 	if (XLOG_DEBUG && npages > 0)
 	{
@@ -2281,6 +2446,8 @@ AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic)
 			 npages, (uint32) (NewPageEndPtr >> 32), (uint32) NewPageEndPtr);
 	}
 #endif
+
+	return npages;
 }
 
 /*
@@ -2863,6 +3030,9 @@ XLogFlush(XLogRecPtr record)
 	if (record <= LogwrtResult.Flush)
 		return;
 
+	/* count the request, for group commit */
+	pg_atomic_fetch_add_u64(&XLogCtl->flushRequests, 1);
+
 #ifdef WAL_DEBUG
 	if (XLOG_DEBUG)
 		elog(LOG, "xlog flush request %X/%X; write %X/%X; flush %X/%X",
@@ -2891,6 +3061,9 @@ XLogFlush(XLogRecPtr record)
 	for (;;)
 	{
 		XLogRecPtr	insertpos;
+		uint64		delay = 0;
+		uint64		requests;
+		instr_time	start;
 
 		/* read LogwrtResult and update local state */
 		SpinLockAcquire(&XLogCtl->info_lck);
@@ -2940,14 +3113,25 @@ XLogFlush(XLogRecPtr record)
 		 * followers; this can significantly improve transaction throughput,
 		 * at the risk of increasing transaction latency.
 		 *
-		 * We do not sleep if enableFsync is not turned on, nor if there are
-		 * fewer than CommitSiblings other backends with active transactions.
+		 * We do not sleep if enableFsync is not turned on.  With
+		 * adaptive_commit_delay, XLogGroupCommitDelay decides how long to
+		 * wait.  Otherwise we sleep for CommitDelay, unless there are fewer
+		 * than CommitSiblings other backends with active transactions.
 		 */
-		if (CommitDelay > 0 && enableFsync &&
-			MinimumActiveBackends(CommitSiblings))
+		if (enableFsync)
 		{
-			pg_usleep(CommitDelay);
+			if (adaptive_commit_delay)
+				delay = XLogGroupCommitDelay();
+			else if (CommitDelay > 0 &&
+					 MinimumActiveBackends(CommitSiblings))
+			{
+				pg_usleep(CommitDelay);
+				delay = CommitDelay;
+			}
+		}
 
+		if (delay > 0)
+		{
 			/*
 			 * Re-check how far we can now flush the WAL. It's generally not
 			 * safe to call WaitXLogInsertionsToFinish while holding
@@ -2965,8 +3149,13 @@ XLogFlush(XLogRecPtr record)
 		WriteRqst.Write = insertpos;
 		WriteRqst.Flush = insertpos;
 
+		requests = pg_atomic_read_u64(&XLogCtl->flushRequests);
+		INSTR_TIME_SET_CURRENT(start);
+
 		XLogWrite(WriteRqst, false);
 
+		XLogGroupCommitUpdate(requests, start, delay);
+
 		LWLockRelease(WALWriteLock);
 		/* done */
 		break;
@@ -3005,6 +3194,220 @@ XLogFlush(XLogRecPtr record)
 			 (uint32) (LogwrtResult.Flush >> 32), (uint32) LogwrtResult.Flush);
 }
 
+/*
+ * For adaptive_commit_delay, decide whether the backend about to flush WAL
+ * in XLogFlush should wait for more flush requests to join the group, and
+ * wait.  Caller holds WALWriteLock.  Returns the time waited, in
+ * microseconds.
+ *
+ * Requests arriving while a flush is in progress are served by the next
+ * one, so when flushing is the bottleneck, groups form by themselves, and
+ * when requests arrive more slowly than flushes complete, there is nobody to
+ * wait for.  In between, fewer requests may have queued up since the
+ * previous flush began than arrive during an average flush.  We then wait
+ * until that many have arrived, but no longer than half the average flush
+ * time, or commit_delay if that's set and shorter, so that waiting can't add
+ * more than half a flush to the latency of the group.
+ */
+static uint64
+XLogGroupCommitDelay(void)
+{
+	double		interval = XLogCtl->avgRequestInterval;
+	double		flush_time = XLogCtl->avgFlushTime;
+	uint64		expected;
+	uint64		max_delay;
+	uint64		waited = 0;
+	instr_time	start;
+	instr_time	now;
+
+	if (interval <= 0 || interval >= flush_time)
+		return 0;
+
+	expected = (uint64) (flush_time / interval);
+	max_delay = (uint64) (flush_time / 2);
+	if (CommitDelay > 0 && CommitDelay < max_delay)
+		max_delay = CommitDelay;
+
+	INSTR_TIME_SET_CURRENT(start);
+	while (pg_atomic_read_u64(&XLogCtl->flushRequests) -
+		   XLogCtl->lastFlushRequests < expected &&
+		   waited < max_delay)
+	{
+		/* sleep for about the time until the next request arrives */
+		pg_usleep(Max(1, (long) Min(interval, max_delay - waited)));
+
+		INSTR_TIME_SET_CURRENT(now);
+		INSTR_TIME_SUBTRACT(now, start);
+		waited = INSTR_TIME_GET_MICROSEC(now);
+	}
+
+	return waited;
+}
+
+/*
+ * Histogram bucket for a group size or a flush time, see
+ * XLogGroupCommitStats.
+ */
+static inline int
+XLogGroupCommitBucket(uint64 value, int shift)
+{
+	int			bucket;
+
+	value >>= shift;
+	if (value == 0)
+		return 0;
+	bucket = pg_leftmost_one_pos64(value);
+
+	return Min(bucket, GROUP_COMMIT_HISTOGRAM_BUCKETS - 1);
+}
+
+static inline void
+XLogGroupCommitIncrement(pg_atomic_uint64 *counter, uint64 value)
+{
+	pg_atomic_write_u64(counter, pg_atomic_read_u64(counter) + value);
+}
+
+/*
+ * Update the group commit state and statistics after XLogFlush has flushed
+ * WAL.  'requests' is the value of flushRequests when the flush started at
+ * 'start', after waiting for 'delay' microseconds.  Caller holds
+ * WALWriteLock.
+ *
+ * All the requests counted since the previous flush started are considered
+ * served by this one.  That's not exact, requests may also be served by the
+ * WAL writer or by flushes outside XLogFlush, but good enough for the
+ * statistics and for estimating how often requests arrive.
+ */
+static void
+XLogGroupCommitUpdate(uint64 requests, instr_time start, uint64 delay)
+{
+	XLogGroupCommitStats *stats = &XLogCtl->groupCommitStats;
+	uint64		group = requests - XLogCtl->lastFlushRequests;
+	uint64		flush_time;
+	instr_time	duration;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	flush_time = INSTR_TIME_GET_MICROSEC(duration);
+
+	/*
+	 * Update the moving averages, weighing the latest flush 1/8.  The first
+	 * flush only provides a starting point for measuring intervals.
+	 */
+	if (XLogCtl->avgFlushTime == 0)
+		XLogCtl->avgFlushTime = flush_time;
+	else
+		XLogCtl->avgFlushTime += (flush_time - XLogCtl->avgFlushTime) / 8;
+
+	if (!INSTR_TIME_IS_ZERO(XLogCtl->lastFlushStart) && group > 0)
+	{
+		instr_time	elapsed = start;
+		double		interval;
+
+		INSTR_TIME_SUBTRACT(elapsed, XLogCtl->lastFlushStart);
+		interval = (double) INSTR_TIME_GET_MICROSEC(elapsed) / group;
+
+		if (XLogCtl->avgRequestInterval == 0)
+			XLogCtl->avgRequestInterval = interval;
+		else
+			XLogCtl->avgRequestInterval +=
+				(interval - XLogCtl->avgRequestInterval) / 8;
+	}
+
+	XLogCtl->lastFlushStart = start;
+	XLogCtl->lastFlushRequests = requests;
+
+	XLogGroupCommitIncrement(&stats->flushes, 1);
+	XLogGroupCommitIncrement(&stats->requests, group);
+	if (delay > 0)
+	{
+		XLogGroupCommitIncrement(&stats->delays, 1);
+		XLogGroupCommitIncrement(&stats->delay_time, delay);
+	}
+	XLogGroupCommitIncrement(&stats->flush_time, flush_time);
+	pg_atomic_write_u64(&stats->avg_flush_time,
+						(uint64) XLogCtl->avgFlushTime);
+	pg_atomic_write_u64(&stats->avg_request_interval,
+						(uint64) XLogCtl->avgRequestInterval);
+	XLogGroupCommitIncrement(&stats->group_size[XLogGroupCommitBucket(group, 0)],
+							 1);
+	XLogGroupCommitIncrement(&stats->flush_latency[XLogGroupCommitBucket(flush_time, 3)],
+							 1);
+}
+
+/*
+ * Reset the counters, for pg_stat_reset_shared('group_commit').  Updates
+ * made concurrently by a flushing backend may be lost, which doesn't matter.
+ * The moving averages are left alone, as they drive adaptive_commit_delay.
+ */
+void
+XLogGroupCommitResetStats(void)
+{
+	XLogGroupCommitStats *stats = &XLogCtl->groupCommitStats;
+	int			i;
+
+	pg_atomic_write_u64(&stats->reset_time, GetCurrentTimestamp());
+	pg_atomic_write_u64(&stats->flushes, 0);
+	pg_atomic_write_u64(&stats->requests, 0);
+	pg_atomic_write_u64(&stats->delays, 0);
+	pg_atomic_write_u64(&stats->delay_time, 0);
+	pg_atomic_write_u64(&stats->flush_time, 0);
+	for (i = 0; i < GROUP_COMMIT_HISTOGRAM_BUCKETS; i++)
+	{
+		pg_atomic_write_u64(&stats->group_size[i], 0);
+		pg_atomic_write_u64(&stats->flush_latency[i], 0);
+	}
+}
+
+/*
+ * Build an int8 array from a histogram, for pg_stat_get_group_commit.
+ */
+static Datum
+XLogGroupCommitHistogram(pg_atomic_uint64 *buckets)
+{
+	Datum		elems[GROUP_COMMIT_HISTOGRAM_BUCKETS];
+	int			i;
+
+	for (i = 0; i < GROUP_COMMIT_HISTOGRAM_BUCKETS; i++)
+		elems[i] = Int64GetDatum(pg_atomic_read_u64(&buckets[i]));
+
+	return PointerGetDatum(construct_array(elems,
+										   GROUP_COMMIT_HISTOGRAM_BUCKETS,
+										   INT8OID, sizeof(int64),
+										   FLOAT8PASSBYVAL, TYPALIGN_DOUBLE));
+}
+
+/*
+ * SQL-callable function for the pg_stat_group_commit view.
+ */
+Datum
+pg_stat_get_group_commit(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_GROUP_COMMIT_COLS 10
+	XLogGroupCommitStats *stats = &XLogCtl->groupCommitStats;
+	TupleDesc	tupdesc;
+	Datum		values[PG_STAT_GET_GROUP_COMMIT_COLS];
+	bool		nulls[PG_STAT_GET_GROUP_COMMIT_COLS];
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	/* times are reported in milliseconds */
+	memset(nulls, 0, sizeof(nulls));
+	values[0] = TimestampTzGetDatum(pg_atomic_read_u64(&stats->reset_time));
+	values[1] = Int64GetDatum(pg_atomic_read_u64(&stats->flushes));
+	values[2] = Int64GetDatum(pg_atomic_read_u64(&stats->requests));
+	values[3] = Int64GetDatum(pg_atomic_read_u64(&stats->delays));
+	values[4] = Float8GetDatum(pg_atomic_read_u64(&stats->delay_time) / 1000.0);
+	values[5] = Float8GetDatum(pg_atomic_read_u64(&stats->flush_time) / 1000.0);
+	values[6] = Float8GetDatum(pg_atomic_read_u64(&stats->avg_flush_time) / 1000.0);
+	values[7] = Float8GetDatum(pg_atomic_read_u64(&stats->avg_request_interval) / 1000.0);
+	values[8] = XLogGroupCommitHistogram(stats->group_size);
+	values[9] = XLogGroupCommitHistogram(stats->flush_latency);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
 /*
  * Write & flush xlog, but without specifying exactly where to.
  *
@@ -3063,7 +3466,9 @@ XLogBackgroundFlush(void)
 	/*
 	 * If already known flushed, we're done. Just need to check if we are
 	 * holding an open file handle to a logfile that's no longer in use,
-	 * preventing the file from being deleted.
+	 * preventing the file from being deleted.  Backends may have written WAL
+	 * themselves, though, so initialize the buffers that became free, ahead
+	 * of the inserters needing them.
 	 */
 	if (WriteRqst.Write <= LogwrtResult.Flush)
 	{
@@ -3075,7 +3480,7 @@ XLogBackgroundFlush(void)
 				XLogFileClose();
 			}
 		}
-		return false;
+		return AdvanceXLInsertBuffer(InvalidXLogRecPtr, true) > 0;
 	}
 
 	/*
@@ -4979,6 +5384,53 @@ XLOGChooseNumBuffers(void)
 	return xbuffers;
 }
 
+/*
+ * Auto-tune the number of WAL insertion locks.
+ *
+ * One lock per CPU lets every CPU insert at the same time, but there's little
+ * point going beyond that, and the locks have to be scanned whenever WAL is
+ * flushed, so the number is kept between 8 (the value used before this was
+ * configurable) and 128.
+ */
+static int
+XLOGChooseNumInsertLocks(void)
+{
+	int			nlocks = 8;
+
+#ifdef _SC_NPROCESSORS_ONLN
+	long		ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (ncpus > nlocks)
+		nlocks = (int) Min(ncpus, 128);
+#endif
+
+	return nlocks;
+}
+
+/*
+ * GUC check_hook for wal_insert_locks
+ */
+bool
+check_wal_insert_locks(int *newval, void **extra, GucSource source)
+{
+	/*
+	 * -1 indicates a request for auto-tune.  As with wal_buffers, leave the
+	 * boot_val alone until XLOGShmemSize is called.
+	 */
+	if (*newval == -1)
+	{
+		if (NumXLogInsertLocks == -1)
+			return true;
+		*newval = XLOGChooseNumInsertLocks();
+	}
+
+	/* Zero is taken to mean the minimum, a single lock */
+	if (*newval < 1)
+		*newval = 1;
+
+	return true;
+}
+
 /*
  * GUC check_hook for wal_buffers
  */
@@ -5057,11 +5509,22 @@ XLOGShmemSize(void)
 	}
 	Assert(XLOGbuffers > 0);
 
+	/* Likewise for the number of WAL insertion locks */
+	if (NumXLogInsertLocks == -1)
+	{
+		char		buf[32];
+
+		snprintf(buf, sizeof(buf), "%d", XLOGChooseNumInsertLocks());
+		SetConfigOption("wal_insert_locks", buf, PGC_POSTMASTER,
+						PGC_S_OVERRIDE);
+	}
+	Assert(NumXLogInsertLocks > 0);
+
 	/* XLogCtl */
 	size = sizeof(XLogCtlData);
 
 	/* WAL insertion locks, plus alignment */
-	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), NUM_XLOGINSERT_LOCKS + 1));
+	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), NumXLogInsertLocks + 1));
 	/* xlblocks array */
 	size = add_size(size, mul_size(sizeof(XLogRecPtr), XLOGbuffers));
 	/* extra alignment padding for XLOG I/O buffers */
@@ -5151,9 +5614,9 @@ XLOGShmemInit(void)
 		((uintptr_t) allocptr) % sizeof(WALInsertLockPadded);
 	WALInsertLocks = XLogCtl->Insert.WALInsertLocks =
 		(WALInsertLockPadded *) allocptr;
-	allocptr += sizeof(WALInsertLockPadded) * NUM_XLOGINSERT_LOCKS;
+	allocptr += sizeof(WALInsertLockPadded) * NumXLogInsertLocks;
 
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < NumXLogInsertLocks; i++)
 	{
 		LWLockInitialize(&WALInsertLocks[i].l.lock, LWTRANCHE_WAL_INSERT);
 		WALInsertLocks[i].l.insertingAt = InvalidXLogRecPtr;
@@ -5183,6 +5646,22 @@ XLOGShmemInit(void)
 	SpinLockInit(&XLogCtl->info_lck);
 	SpinLockInit(&XLogCtl->ulsn_lck);
 	InitSharedLatch(&XLogCtl->recoveryWakeupLatch);
+
+	pg_atomic_init_u64(&XLogCtl->flushRequests, 0);
+	pg_atomic_init_u64(&XLogCtl->groupCommitStats.reset_time,
+					   GetCurrentTimestamp());
+	pg_atomic_init_u64(&XLogCtl->groupCommitStats.flushes, 0);
+	pg_atomic_init_u64(&XLogCtl->groupCommitStats.requests, 0);
+	pg_atomic_init_u64(&XLogCtl->groupCommitStats.delays, 0);
+	pg_atomic_init_u64(&XLogCtl->groupCommitStats.delay_time, 0);
+	pg_atomic_init_u64(&XLogCtl->groupCommitStats.flush_time, 0);
+	pg_atomic_init_u64(&XLogCtl->groupCommitStats.avg_flush_time, 0);
+	pg_atomic_init_u64(&XLogCtl->groupCommitStats.avg_request_interval, 0);
+	for (i = 0; i < GROUP_COMMIT_HISTOGRAM_BUCKETS; i++)
+	{
+		pg_atomic_init_u64(&XLogCtl->groupCommitStats.group_size[i], 0);
+		pg_atomic_init_u64(&XLogCtl->groupCommitStats.flush_latency[i], 0);
+	}
 }
 
 /*
@@ -6022,6 +6501,9 @@ recoveryPausesHere(bool endOfRecovery)
 				(errmsg("recovery has paused"),
 				 errhint("Execute pg_wal_replay_resume() to continue.")));
 
+	/* Let the records handed to parallel redo workers be replayed, too */
+	ParallelRedoCatchUp();
+
 	while (RecoveryIsPaused())
 	{
 		HandleStartupProcInterrupts();
@@ -6053,6 +6535,26 @@ SetRecoveryPause(bool recoveryPause)
 	SpinLockRelease(&XLogCtl->info_lck);
 }
 
+/*
+ * Wait for the parallel redo workers to replay the records handed to them,
+ * and advance the replay position past those records.
+ */
+static void
+ParallelRedoCatchUp(void)
+{
+	if (XLogRecPtrIsInvalid(parallelRedoEndRecPtr))
+		return;
+
+	ParallelRedoWaitForWorkers();
+
+	SpinLockAcquire(&XLogCtl->info_lck);
+	XLogCtl->lastReplayedEndRecPtr = parallelRedoEndRecPtr;
+	XLogCtl->lastReplayedTLI = parallelRedoTLI;
+	SpinLockRelease(&XLogCtl->info_lck);
+
+	parallelRedoEndRecPtr = InvalidXLogRecPtr;
+}
+
 /*
  * When recovery_min_apply_delay is set, we wait long enough to make sure
  * certain record types are applied at least that interval behind the primary.
@@ -6422,8 +6924,17 @@ StartupXLOG(void)
 	{
 		RemoveTempXlogFiles();
 		SyncDataDirectory();
+
+		/*
+		 * Repair any torn pages from the double-write file before replaying
+		 * WAL that may lack full-page images for them.
+		 */
+		DoubleWriteRecover();
 	}
 
+	/* Start over with an empty double-write file, if enabled */
+	DoubleWriteInitFile();
+
 	/*
 	 * Initialize on the assumption we want to recover to the latest timeline
 	 * that's active according to pg_control.
@@ -6874,6 +7385,14 @@ StartupXLOG(void)
 		InRecovery = true;
 	}
 
+	/*
+	 * Load the table statistics saved at the last shutdown, unless we're
+	 * going to perform recovery, in which case pgstat_reset_all() discards
+	 * them below.
+	 */
+	if (!InRecovery)
+		pgstat_tables_restore();
+
 	/* REDO */
 	if (InRecovery)
 	{
@@ -7169,6 +7688,7 @@ StartupXLOG(void)
 		{
 			ErrorContextCallback errcallback;
 			TimestampTz xtime;
+			XLogPrefetcher *xlogprefetcher;
 
 			InRedo = true;
 
@@ -7176,12 +7696,16 @@ StartupXLOG(void)
 					(errmsg("redo starts at %X/%X",
 							(uint32) (ReadRecPtr >> 32), (uint32) ReadRecPtr)));
 
+			/* Set up prefetching of the blocks ahead of replay */
+			xlogprefetcher = XLogPrefetcherAllocate();
+
 			/*
 			 * main redo apply loop
 			 */
 			do
 			{
 				bool		switchedTLI = false;
+				bool		dispatched;
 
 #ifdef WAL_DEBUG
 				if (XLOG_DEBUG ||
@@ -7319,8 +7843,24 @@ StartupXLOG(void)
 					TransactionIdIsValid(record->xl_xid))
 					RecordKnownAssignedTransactionIds(record->xl_xid);
 
-				/* Now apply the WAL record itself */
-				RmgrTable[record->xl_rmid].rm_redo(xlogreader);
+				/*
+				 * Start reading the blocks the next records need.  While
+				 * streaming, don't look at WAL the WAL receiver hasn't
+				 * flushed yet.
+				 */
+				XLogPrefetcherReadAhead(xlogprefetcher, xlogreader,
+										curFileTLI ? curFileTLI : ThisTimeLineID,
+										WalRcvStreaming() ?
+										GetWalRcvFlushRecPtr(NULL, NULL) :
+										InvalidXLogRecPtr);
+
+				/*
+				 * Now apply the WAL record itself, unless a parallel redo
+				 * worker does that for us
+				 */
+				dispatched = ParallelRedoDispatch(xlogreader);
+				if (!dispatched)
+					RmgrTable[record->xl_rmid].rm_redo(xlogreader);
 
 				/*
 				 * After redo, check whether the backup pages associated with
@@ -7336,12 +7876,24 @@ StartupXLOG(void)
 
 				/*
 				 * Update lastReplayedEndRecPtr after this record has been
-				 * successfully replayed.
+				 * successfully replayed.  A record handed to a parallel redo
+				 * worker may not have been replayed yet, so that waits until
+				 * ParallelRedoCatchUp().  Any other record was only replayed
+				 * after the workers caught up.
 				 */
-				SpinLockAcquire(&XLogCtl->info_lck);
-				XLogCtl->lastReplayedEndRecPtr = EndRecPtr;
-				XLogCtl->lastReplayedTLI = ThisTimeLineID;
-				SpinLockRelease(&XLogCtl->info_lck);
+				if (dispatched)
+				{
+					parallelRedoEndRecPtr = EndRecPtr;
+					parallelRedoTLI = ThisTimeLineID;
+				}
+				else
+				{
+					SpinLockAcquire(&XLogCtl->info_lck);
+					XLogCtl->lastReplayedEndRecPtr = EndRecPtr;
+					XLogCtl->lastReplayedTLI = ThisTimeLineID;
+					SpinLockRelease(&XLogCtl->info_lck);
+					parallelRedoEndRecPtr = InvalidXLogRecPtr;
+				}
 
 				/*
 				 * If rm_redo called XLogRequestWalReceiverReply, then we wake
@@ -7393,6 +7945,10 @@ StartupXLOG(void)
 			 * end of main redo apply loop
 			 */
 
+			ParallelRedoCatchUp();
+			ParallelRedoFinish();
+			XLogPrefetcherFree(xlogprefetcher);
+
 			if (reachedRecoveryTarget)
 			{
 				if (!reachedConsistency)
@@ -8441,7 +8997,7 @@ GetLastImportantRecPtr(void)
 	XLogRecPtr	res = InvalidXLogRecPtr;
 	int			i;
 
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < NumXLogInsertLocks; i++)
 	{
 		XLogRecPtr	last_important;
 
@@ -8522,6 +9078,14 @@ ShutdownXLOG(int code, Datum arg)
 			RequestXLogSwitch(false);
 
 		CreateCheckPoint(CHECKPOINT_IS_SHUTDOWN | CHECKPOINT_IMMEDIATE);
+
+		/*
+		 * Save the table statistics kept in shared memory.  There's no point
+		 * in doing so in recovery, as the next startup would discard them.
+		 * A standalone backend has done so already, see InitPostgres.
+		 */
+		if (IsUnderPostmaster)
+			pgstat_tables_write();
 	}
 	ShutdownCLOG();
 	ShutdownCommitTs();
@@ -9785,6 +10349,16 @@ UpdateFullPageWrites(void)
 {
 	XLogCtlInsert *Insert = &XLogCtl->Insert;
 	bool		recoveryInProgress;
+	bool		fpw;
+
+	/*
+	 * Full-page images are not needed for torn page protection while pages
+	 * go through the double-write file.  But with wal_level replica or
+	 * higher, the WAL may also be replayed onto a base backup or by a
+	 * standby, whose pages our double-write file doesn't protect, so keep
+	 * taking them then.
+	 */
+	fpw = fullPageWrites && (double_write_buffers <= 0 || XLogIsNeeded());
 
 	/*
 	 * Do nothing if full_page_writes has not been changed.
@@ -9793,7 +10367,7 @@ UpdateFullPageWrites(void)
 	 * because we assume that there is no concurrently running process which
 	 * can update it.
 	 */
-	if (fullPageWrites == Insert->fullPageWrites)
+	if (fpw == Insert->fullPageWrites)
 		return;
 
 	/*
@@ -9812,7 +10386,7 @@ UpdateFullPageWrites(void)
 	 * setting it to false, first write the WAL record and then set the global
 	 * flag.
 	 */
-	if (fullPageWrites)
+	if (fpw)
 	{
 		WALInsertLockAcquireExclusive();
 		Insert->fullPageWrites = true;
@@ -9826,12 +10400,12 @@ UpdateFullPageWrites(void)
 	if (XLogStandbyInfoActive() && !recoveryInProgress)
 	{
 		XLogBeginInsert();
-		XLogRegisterData((char *) (&fullPageWrites), sizeof(bool));
+		XLogRegisterData((char *) (&fpw), sizeof(bool));
 
 		XLogInsert(RM_XLOG_ID, XLOG_FPW_CHANGE);
 	}
 
-	if (!fullPageWrites)
+	if (!fpw)
 	{
 		WALInsertLockAcquireExclusive();
 		Insert->fullPageWrites = false;
@@ -10305,10 +10879,18 @@ static int
 get_sync_bit(int method)
 {
 	int			o_direct_flag = 0;
+	bool		io_direct_wal;
+
+	/*
+	 * If io_direct asks for it, use O_DIRECT with every sync method, except
+	 * in walreceiver for the reasons below.  XLogWrite always writes whole,
+	 * aligned WAL pages.
+	 */
+	io_direct_wal = (io_direct_flags & IO_DIRECT_WAL) && !AmWalReceiverProcess();
 
 	/* If fsync is disabled, never open in sync mode */
 	if (!enableFsync)
-		return 0;
+		return io_direct_wal ? PG_O_DIRECT : 0;
 
 	/*
 	 * Optimize writes by bypassing kernel cache with O_DIRECT when using
@@ -10324,7 +10906,7 @@ get_sync_bit(int method)
 	 * after its written. Also, walreceiver performs unaligned writes, which
 	 * don't work with O_DIRECT, so it is required for correctness too.
 	 */
-	if (!XLogIsNeeded() && !AmWalReceiverProcess())
+	if ((!XLogIsNeeded() && !AmWalReceiverProcess()) || io_direct_wal)
 		o_direct_flag = PG_O_DIRECT;
 
 	switch (method)
@@ -10338,7 +10920,7 @@ get_sync_bit(int method)
 		case SYNC_METHOD_FSYNC:
 		case SYNC_METHOD_FSYNC_WRITETHROUGH:
 		case SYNC_METHOD_FDATASYNC:
-			return 0;
+			return io_direct_wal ? PG_O_DIRECT : 0;
 #ifdef OPEN_SYNC_FLAG
 		case SYNC_METHOD_OPEN:
 			return OPEN_SYNC_FLAG | o_direct_flag;
@@ -12202,8 +12784,11 @@ WaitForWALToBecomeAvailable(XLogRecPtr RecPtr, bool randAccess,
 					 * obtaining the requested WAL. We're going to loop back
 					 * and retry from the archive, but if it hasn't been long
 					 * since last attempt, sleep wal_retrieve_retry_interval
-					 * milliseconds to avoid busy-waiting.
+					 * milliseconds to avoid busy-waiting.  Let the parallel
+					 * redo workers finish what they have first.
 					 */
+					ParallelRedoCatchUp();
+
 					now = GetCurrentTimestamp();
 					if (!TimestampDifferenceExceeds(last_fail_time, now,
 													wal_retrieve_retry_interval))
@@ -12454,6 +13039,12 @@ WaitForWALToBecomeAvailable(XLogRecPtr RecPtr, bool randAccess,
 						break;
 					}
 
+					/*
+					 * Let the parallel redo workers finish what they have,
+					 * so that queries see it while we wait.
+					 */
+					ParallelRedoCatchUp();
+
 					/*
 					 * Since we have replayed everything we have received so
 					 * far and are about to start waiting for more WAL, let's
@@ -12467,6 +13058,12 @@ WaitForWALToBecomeAvailable(XLogRecPtr RecPtr, bool randAccess,
 						streaming_reply_sent = true;
 					}
 
+					/*
+					 * We've caught up with the WAL available; a good time to
+					 * publish the I/O counts of the startup process.
+					 */
+					pgstat_flush_io(false);
+
 					/*
 					 * Wait for more WAL to arrive. Time out after 5 seconds
 					 * to react to a trigger file promptly and to check if the
@@ -0,0 +1,678 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogparallel.c
+ *		Parallel replay of WAL records.
+ *
+ * Redo normally runs entirely in the startup process.  With
+ * recovery_parallel_workers set, the startup process hands some records to
+ * background workers instead of replaying them itself: records that change
+ * a single block of the main fork of a relation, and that are of a few kinds
+ * whose redo does nothing but lock and change that block and the pages of
+ * the relation's visibility map and free space map.  All records of a
+ * relation go to the same worker, chosen by hashing its RelFileNode, so the
+ * blocks of a relation are changed in WAL order, and only one process at a
+ * time extends it.  (Hashing by block would spread the records better, but
+ * redo is not prepared for two processes extending a relation at once.)
+ *
+ * Every other record is a barrier: the startup process waits until the
+ * workers have replayed all records sent to them, and then replays the
+ * record itself.  That covers records touching several blocks, records that
+ * need a cleanup lock or may conflict with hot standby queries, and the
+ * records of all other resource managers, transaction commits among them,
+ * so that a commit becomes visible only after everything WAL-logged before
+ * it has been replayed.
+ *
+ * In hot standby, B-tree records are barriers too.  The heap record that an
+ * index entry points to may have gone to another worker, and a query must
+ * not find the entry before the heap tuple exists and the visibility map
+ * bit of its page has been cleared: an index-only scan would return the
+ * tuple without looking at the heap.
+ *
+ * The startup process doesn't advance the replay position past the records
+ * it has handed over until the workers have replayed them; see xlog.c.
+ *
+ * Workers are only used after recovery has reached a consistent state,
+ * because before that references to invalid pages are remembered by the
+ * process that replays them, to be checked later.  That also means they are
+ * only used in archive recovery and standby mode, which is when the
+ * postmaster starts background workers during recovery.
+ *
+ * In recovery, smgrnblocks() caches relation sizes, and another process may
+ * change them.  When the startup process waits for the workers, it forgets
+ * the sizes of the relations it has sent records of since the last time.
+ * When a worker gets a record after the startup process has replayed one
+ * that touches blocks itself, it forgets the sizes of all relations, and
+ * after one that may remove files, it closes all of them.
+ *
+ * The records are sent to the workers through shm_mq queues in a dynamic
+ * shared memory segment.  Each worker advertises the end of the last record
+ * it has replayed, and sets the startup process's latch after advancing it
+ * if the startup process is waiting.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/backend/access/transam/xlogparallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/heapam_xlog.h"
+#include "access/nbtxlog.h"
+#include "access/xact.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogparallel.h"
+#include "access/xlogreader.h"
+#include "common/hashfn.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/startup.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "storage/smgr.h"
+#include "tcop/tcopprot.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+
+/* GUCs */
+int			recovery_parallel_workers = 0;
+
+/* size of the queue through which each worker receives records */
+#define PARALLEL_REDO_QUEUE_SIZE	(1024 * 1024)
+
+/* state of a worker in the shared segment */
+typedef struct ParallelRedoWorkerShared
+{
+	pg_atomic_uint64 applied;	/* end of the last record replayed */
+} ParallelRedoWorkerShared;
+
+/* header of the shared segment; the queues follow */
+typedef struct ParallelRedoShared
+{
+	PGPROC	   *startup_proc;
+	pg_atomic_uint32 startup_waiting;	/* is the startup process waiting? */
+	pg_atomic_uint32 size_generation;	/* advanced when sizes may change */
+	pg_atomic_uint32 close_generation;	/* advanced when files may go away */
+	int			nworkers;		/* number of queues */
+	ParallelRedoWorkerShared workers[FLEXIBLE_ARRAY_MEMBER];
+} ParallelRedoShared;
+
+#define ParallelRedoQueue(shared, i) \
+	((shm_mq *) ((char *) (shared) + \
+				 MAXALIGN(offsetof(ParallelRedoShared, workers) + \
+						  sizeof(ParallelRedoWorkerShared) * (shared)->nworkers) + \
+				 (Size) (i) * PARALLEL_REDO_QUEUE_SIZE))
+
+/*
+ * Each message is this header followed by the WAL record.  The header's
+ * size is a multiple of MAXALIGN, so the record stays aligned.
+ */
+typedef struct ParallelRedoMessage
+{
+	XLogRecPtr	ReadRecPtr;
+	XLogRecPtr	EndRecPtr;
+} ParallelRedoMessage;
+
+/* the startup process's state */
+typedef struct ParallelRedoState
+{
+	dsm_segment *seg;
+	ParallelRedoShared *shared;
+	int			nworkers;		/* number of workers started */
+	bool		pending;		/* anything sent since the last wait? */
+	HTAB	   *sent_rels;		/* relations sent since the last wait */
+	BackgroundWorkerHandle *handles[MAX_PARALLEL_REDO_WORKERS];
+	shm_mq_handle *mqhs[MAX_PARALLEL_REDO_WORKERS];
+	XLogRecPtr	sent[MAX_PARALLEL_REDO_WORKERS];	/* end of last record sent */
+} ParallelRedoState;
+
+static ParallelRedoState *ParallelRedo = NULL;
+
+/* set when workers couldn't be started, so that we don't keep trying */
+static bool ParallelRedoFailed = false;
+
+static bool ParallelRedoStart(void);
+static bool ParallelRedoCanDispatch(XLogReaderState *record,
+									RelFileNode *rnode);
+static bool ParallelRedoMayRemoveFiles(XLogReaderState *record);
+static void ParallelRedoCheckWorker(int i);
+static void parallel_redo_error_callback(void *arg);
+
+/*
+ * Hand a record that is about to be replayed to a worker, if it can be
+ * replayed by one.  Otherwise, wait until the workers have replayed all
+ * the records sent to them, so that the caller can replay the record.
+ *
+ * Returns true if the record was handed over.
+ */
+bool
+ParallelRedoDispatch(XLogReaderState *record)
+{
+	RelFileNode rnode;
+	ParallelRedoMessage msg;
+	shm_mq_iovec iov[2];
+	int			i;
+
+	if (ParallelRedo == NULL &&
+		(recovery_parallel_workers == 0 || !reachedConsistency ||
+		 ParallelRedoFailed))
+		return false;
+
+	if (!ParallelRedoCanDispatch(record, &rnode))
+	{
+		if (ParallelRedo != NULL)
+		{
+			ParallelRedoShared *shared = ParallelRedo->shared;
+
+			ParallelRedoWaitForWorkers();
+
+			/* Have the workers notice what this record is going to do */
+			if (record->max_block_id >= 0)
+				pg_atomic_fetch_add_u32(&shared->size_generation, 1);
+			if (ParallelRedoMayRemoveFiles(record))
+				pg_atomic_fetch_add_u32(&shared->close_generation, 1);
+		}
+		return false;
+	}
+
+	if (ParallelRedo == NULL && !ParallelRedoStart())
+		return false;
+
+	i = hash_bytes((const unsigned char *) &rnode, sizeof(RelFileNode)) %
+		ParallelRedo->nworkers;
+
+	msg.ReadRecPtr = record->ReadRecPtr;
+	msg.EndRecPtr = record->EndRecPtr;
+	iov[0].data = (const char *) &msg;
+	iov[0].len = sizeof(msg);
+	iov[1].data = (const char *) record->decoded_record;
+	iov[1].len = XLogRecGetTotalLen(record);
+
+	if (shm_mq_sendv(ParallelRedo->mqhs[i], iov, 2, false, true) !=
+		SHM_MQ_SUCCESS)
+		ereport(FATAL,
+				(errmsg("parallel redo worker %d exited unexpectedly", i)));
+
+	ParallelRedo->sent[i] = record->EndRecPtr;
+	ParallelRedo->pending = true;
+	(void) hash_search(ParallelRedo->sent_rels, &rnode, HASH_ENTER, NULL);
+
+	return true;
+}
+
+/*
+ * Wait until the workers have replayed all records sent to them.
+ */
+void
+ParallelRedoWaitForWorkers(void)
+{
+	ParallelRedoShared *shared;
+	HASH_SEQ_STATUS status;
+	RelFileNode *rnode;
+
+	if (ParallelRedo == NULL || !ParallelRedo->pending)
+		return;
+
+	shared = ParallelRedo->shared;
+
+	/*
+	 * Announce that we are waiting before checking the workers' progress;
+	 * they advance it before checking whether we are waiting.
+	 */
+	pg_atomic_write_u32(&shared->startup_waiting, 1);
+	pg_memory_barrier();
+
+	for (;;)
+	{
+		int			i;
+
+		for (i = 0; i < ParallelRedo->nworkers; i++)
+		{
+			if (pg_atomic_read_u64(&shared->workers[i].applied) <
+				ParallelRedo->sent[i])
+				break;
+		}
+		if (i == ParallelRedo->nworkers)
+			break;
+
+		ParallelRedoCheckWorker(i);
+
+		(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, -1L,
+						 WAIT_EVENT_RECOVERY_PARALLEL_REDO);
+		ResetLatch(MyLatch);
+
+		HandleStartupProcInterrupts();
+	}
+
+	pg_atomic_write_u32(&shared->startup_waiting, 0);
+	ParallelRedo->pending = false;
+
+	/* The workers may have extended these relations */
+	hash_seq_init(&status, ParallelRedo->sent_rels);
+	while ((rnode = (RelFileNode *) hash_seq_search(&status)) != NULL)
+	{
+		smgrforgetnblocks(smgropen(*rnode, InvalidBackendId));
+		(void) hash_search(ParallelRedo->sent_rels, rnode, HASH_REMOVE, NULL);
+	}
+}
+
+/*
+ * Wait for the workers to replay all records sent to them, and stop them.
+ * Called at the end of redo.
+ */
+void
+ParallelRedoFinish(void)
+{
+	int			i;
+
+	if (ParallelRedo == NULL)
+		return;
+
+	ParallelRedoWaitForWorkers();
+
+	/* The workers exit once they see that we've detached */
+	for (i = 0; i < ParallelRedo->nworkers; i++)
+		shm_mq_detach(ParallelRedo->mqhs[i]);
+	for (i = 0; i < ParallelRedo->nworkers; i++)
+		(void) WaitForBackgroundWorkerShutdown(ParallelRedo->handles[i]);
+
+	dsm_detach(ParallelRedo->seg);
+	hash_destroy(ParallelRedo->sent_rels);
+	pfree(ParallelRedo);
+	ParallelRedo = NULL;
+}
+
+/*
+ * Set up the shared segment and start the workers.  Returns false if no
+ * worker could be registered; we then replay everything ourselves.
+ */
+static bool
+ParallelRedoStart(void)
+{
+	int			nworkers = recovery_parallel_workers;
+	MemoryContext oldcontext;
+	ParallelRedoState *state;
+	ParallelRedoShared *shared;
+	BackgroundWorker worker;
+	HASHCTL		ctl;
+	Size		size;
+	int			i;
+
+	size = add_size(MAXALIGN(offsetof(ParallelRedoShared, workers) +
+							 sizeof(ParallelRedoWorkerShared) * nworkers),
+					mul_size(nworkers, PARALLEL_REDO_QUEUE_SIZE));
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	state = palloc0(sizeof(ParallelRedoState));
+	state->seg = dsm_create(size, DSM_CREATE_NULL_IF_MAXSEGMENTS);
+	if (state->seg == NULL)
+	{
+		ereport(LOG,
+				(errmsg("could not create shared memory segment for parallel redo")));
+		pfree(state);
+		MemoryContextSwitchTo(oldcontext);
+		ParallelRedoFailed = true;
+		return false;
+	}
+	dsm_pin_mapping(state->seg);
+
+	shared = state->shared = dsm_segment_address(state->seg);
+	shared->startup_proc = MyProc;
+	pg_atomic_init_u32(&shared->startup_waiting, 0);
+	pg_atomic_init_u32(&shared->size_generation, 0);
+	pg_atomic_init_u32(&shared->close_generation, 0);
+	shared->nworkers = nworkers;
+	for (i = 0; i < nworkers; i++)
+		pg_atomic_init_u64(&shared->workers[i].applied, InvalidXLogRecPtr);
+
+	memset(&worker, 0, sizeof(worker));
+	snprintf(worker.bgw_type, BGW_MAXLEN, "parallel redo worker");
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	worker.bgw_start_time = BgWorkerStart_PostmasterStart;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	sprintf(worker.bgw_library_name, "postgres");
+	sprintf(worker.bgw_function_name, "ParallelRedoWorkerMain");
+	worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(state->seg));
+	worker.bgw_notify_pid = MyProcPid;
+
+	for (i = 0; i < nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(ParallelRedoQueue(shared, i),
+						   PARALLEL_REDO_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+
+		snprintf(worker.bgw_name, BGW_MAXLEN, "parallel redo worker %d", i);
+		memcpy(worker.bgw_extra, &i, sizeof(int));
+		if (!RegisterDynamicBackgroundWorker(&worker, &state->handles[i]))
+			break;
+
+		state->mqhs[i] = shm_mq_attach(mq, state->seg, state->handles[i]);
+	}
+	state->nworkers = i;
+
+	if (state->nworkers == 0)
+	{
+		ereport(LOG,
+				(errmsg("could not start parallel redo workers"),
+				 errhint("You might need to increase max_worker_processes.")));
+		dsm_detach(state->seg);
+		pfree(state);
+		MemoryContextSwitchTo(oldcontext);
+		ParallelRedoFailed = true;
+		return false;
+	}
+	if (state->nworkers < nworkers)
+		ereport(LOG,
+				(errmsg("started only %d of %d parallel redo workers",
+						state->nworkers, nworkers),
+				 errhint("You might need to increase max_worker_processes.")));
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(RelFileNode);
+	ctl.entrysize = sizeof(RelFileNode);
+	state->sent_rels = hash_create("parallel redo relations", 64, &ctl,
+								   HASH_ELEM | HASH_BLOBS);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	ParallelRedo = state;
+
+	return true;
+}
+
+/*
+ * Can the record be replayed by a worker?  If so, return the relation it
+ * changes in *rnode.
+ *
+ * The records allowed here must not touch more than one block of the main
+ * fork, apart from the visibility map and free space map of the same
+ * relation, and their redo must not need a cleanup lock, resolve conflicts
+ * with hot standby queries or use any other state of the startup process.
+ */
+static bool
+ParallelRedoCanDispatch(XLogReaderState *record, RelFileNode *rnode)
+{
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+	ForkNumber	forknum;
+	BlockNumber blkno;
+
+	if (record->max_block_id != 0)
+		return false;
+
+	/* wal_consistency_checking checks the page right after redo */
+	if ((XLogRecGetInfo(record) & XLR_CHECK_CONSISTENCY) != 0)
+		return false;
+
+	switch (XLogRecGetRmid(record))
+	{
+		case RM_HEAP_ID:
+			switch (info & XLOG_HEAP_OPMASK)
+			{
+				case XLOG_HEAP_INSERT:
+				case XLOG_HEAP_DELETE:
+				case XLOG_HEAP_UPDATE:
+				case XLOG_HEAP_HOT_UPDATE:
+				case XLOG_HEAP_CONFIRM:
+				case XLOG_HEAP_LOCK:
+				case XLOG_HEAP_INPLACE:
+					break;
+				default:
+					return false;
+			}
+			break;
+		case RM_HEAP2_ID:
+			switch (info & XLOG_HEAP_OPMASK)
+			{
+				case XLOG_HEAP2_MULTI_INSERT:
+				case XLOG_HEAP2_LOCK_UPDATED:
+					break;
+				default:
+					return false;
+			}
+			break;
+		case RM_BTREE_ID:
+			/* Queries must not see index entries before their heap tuples */
+			if (EnableHotStandby)
+				return false;
+			switch (info)
+			{
+				case XLOG_BTREE_INSERT_LEAF:
+				case XLOG_BTREE_INSERT_POST:
+				case XLOG_BTREE_INSERT_MULTI:
+				case XLOG_BTREE_DEDUP:
+					break;
+				default:
+					return false;
+			}
+			break;
+		default:
+			return false;
+	}
+
+	if (!XLogRecGetBlockTag(record, 0, rnode, &forknum, &blkno))
+		return false;
+
+	return forknum == MAIN_FORKNUM;
+}
+
+/*
+ * May replaying the record remove relation files?
+ */
+static bool
+ParallelRedoMayRemoveFiles(XLogReaderState *record)
+{
+	uint8		info = XLogRecGetInfo(record) & XLOG_XACT_OPMASK;
+
+	switch (XLogRecGetRmid(record))
+	{
+		case RM_SMGR_ID:
+		case RM_DBASE_ID:
+		case RM_TBLSPC_ID:
+			return true;
+		case RM_XACT_ID:
+			if (info == XLOG_XACT_COMMIT || info == XLOG_XACT_COMMIT_PREPARED)
+			{
+				xl_xact_parsed_commit parsed;
+
+				ParseCommitRecord(XLogRecGetInfo(record),
+								  (xl_xact_commit *) XLogRecGetData(record),
+								  &parsed);
+				return parsed.nrels > 0;
+			}
+			if (info == XLOG_XACT_ABORT || info == XLOG_XACT_ABORT_PREPARED)
+			{
+				xl_xact_parsed_abort parsed;
+
+				ParseAbortRecord(XLogRecGetInfo(record),
+								 (xl_xact_abort *) XLogRecGetData(record),
+								 &parsed);
+				return parsed.nrels > 0;
+			}
+			return false;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Error out if a worker we're waiting for has gone away.  Replaying the
+ * records it didn't get to is up to the next recovery attempt.
+ */
+static void
+ParallelRedoCheckWorker(int i)
+{
+	pid_t		pid;
+
+	if (GetBackgroundWorkerPid(ParallelRedo->handles[i], &pid) == BGWH_STOPPED)
+		ereport(FATAL,
+				(errmsg("parallel redo worker %d exited unexpectedly", i)));
+}
+
+/*
+ * Main entry point for parallel redo workers.
+ */
+void
+ParallelRedoWorkerMain(Datum main_arg)
+{
+	dsm_segment *seg;
+	ParallelRedoShared *shared;
+	ParallelRedoWorkerShared *me;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	XLogReaderState *reader;
+	MemoryContext redo_context;
+	uint32		size_generation;
+	uint32		close_generation;
+	int			workerno;
+	int			rmid;
+
+	/* Establish signal handlers. */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	memcpy(&workerno, MyBgworkerEntry->bgw_extra, sizeof(int));
+
+	/*
+	 * Attach to the startup process's segment and our queue.  As there is no
+	 * ResourceOwner yet, the mapping survives until we exit.
+	 */
+	seg = dsm_attach(DatumGetUInt32(main_arg));
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	shared = dsm_segment_address(seg);
+	me = &shared->workers[workerno];
+
+	mq = ParallelRedoQueue(shared, workerno);
+	shm_mq_set_receiver(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, "parallel redo worker");
+
+	/*
+	 * Replay as the startup process does.  We only get records once recovery
+	 * is consistent, so invalid page references are reported right away.
+	 */
+	InRecovery = true;
+	reachedConsistency = true;
+
+	reader = XLogReaderAllocate(wal_segment_size, NULL,
+								XL_ROUTINE(.page_read = NULL), NULL);
+	if (!reader)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+
+	redo_context = AllocSetContextCreate(TopMemoryContext,
+										 "parallel redo",
+										 ALLOCSET_DEFAULT_SIZES);
+
+	for (rmid = 0; rmid <= RM_MAX_ID; rmid++)
+	{
+		if (RmgrTable[rmid].rm_startup != NULL)
+			RmgrTable[rmid].rm_startup();
+	}
+
+	size_generation = pg_atomic_read_u32(&shared->size_generation);
+	close_generation = pg_atomic_read_u32(&shared->close_generation);
+
+	for (;;)
+	{
+		ParallelRedoMessage *msg;
+		XLogRecord *record;
+		Size		nbytes;
+		void	   *data;
+		char	   *errormsg;
+		uint32		generation;
+		ErrorContextCallback errcallback;
+		MemoryContext oldcontext;
+
+		/* Wait for a record; the startup process detaches when it's done */
+		if (shm_mq_receive(mqh, &nbytes, &data, false) != SHM_MQ_SUCCESS)
+			break;
+
+		msg = (ParallelRedoMessage *) data;
+		record = (XLogRecord *) ((char *) data + sizeof(ParallelRedoMessage));
+
+		/* Catch up with what the startup process replayed itself */
+		generation = pg_atomic_read_u32(&shared->close_generation);
+		if (generation != close_generation)
+		{
+			smgrcloseall();
+			close_generation = generation;
+		}
+		generation = pg_atomic_read_u32(&shared->size_generation);
+		if (generation != size_generation)
+		{
+			smgrforgetallnblocks();
+			size_generation = generation;
+		}
+
+		reader->ReadRecPtr = msg->ReadRecPtr;
+		reader->EndRecPtr = msg->EndRecPtr;
+		if (!DecodeXLogRecord(reader, record, &errormsg))
+			elog(ERROR, "could not decode WAL record at %X/%X: %s",
+				 (uint32) (msg->ReadRecPtr >> 32), (uint32) msg->ReadRecPtr,
+				 errormsg);
+
+		errcallback.callback = parallel_redo_error_callback;
+		errcallback.arg = (void *) reader;
+		errcallback.previous = error_context_stack;
+		error_context_stack = &errcallback;
+
+		oldcontext = MemoryContextSwitchTo(redo_context);
+		RmgrTable[record->xl_rmid].rm_redo(reader);
+		MemoryContextSwitchTo(oldcontext);
+		MemoryContextReset(redo_context);
+
+		error_context_stack = errcallback.previous;
+
+		/*
+		 * Advance our progress before checking whether the startup process
+		 * waits for it; it announces that it waits before checking progress.
+		 */
+		pg_atomic_write_u64(&me->applied, msg->EndRecPtr);
+		pg_memory_barrier();
+		if (pg_atomic_read_u32(&shared->startup_waiting) != 0)
+			SetLatch(&shared->startup_proc->procLatch);
+	}
+
+	for (rmid = 0; rmid <= RM_MAX_ID; rmid++)
+	{
+		if (RmgrTable[rmid].rm_cleanup != NULL)
+			RmgrTable[rmid].rm_cleanup();
+	}
+
+	proc_exit(0);
+}
+
+/*
+ * Error context callback for errors occurring during redo in a worker.
+ */
+static void
+parallel_redo_error_callback(void *arg)
+{
+	XLogReaderState *record = (XLogReaderState *) arg;
+	const RmgrData *rmgr = &RmgrTable[XLogRecGetRmid(record)];
+	const char *id = rmgr->rm_identify(XLogRecGetInfo(record));
+
+	errcontext("WAL redo at %X/%X for %s/%s",
+			   (uint32) (record->ReadRecPtr >> 32),
+			   (uint32) record->ReadRecPtr,
+			   rmgr->rm_name, id ? id : "UNKNOWN");
+}
@@ -0,0 +1,668 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogprefetch.c
+ *		Prefetching support for recovery.
+ *
+ * Redo reads the blocks referenced by each WAL record synchronously, just
+ * before replaying the record, so recovery normally has at most one random
+ * read in flight.  This module runs a second XLogReaderState a little way
+ * ahead of replay, decodes the records it finds there and issues
+ * PrefetchSharedBuffer() calls for the blocks they reference, so that the
+ * reads have often completed by the time redo gets to them.
+ *
+ * The prefetching reader reads WAL files from pg_wal directly, up to the
+ * limit given by the caller: during streaming replication, the point up to
+ * which the WAL receiver has flushed WAL.  WAL restored from the archive is
+ * not in pg_wal under its own name, so prefetching stops at segment
+ * boundaries while recovering from the archive, and that of each segment
+ * starts over once replay has reached it.  Anything the prefetching reader
+ * can't read or decode just makes it wait until replay catches up or more WAL
+ * is available; the results are only hints, so they never cause errors.
+ *
+ * A prefetch is considered to be in flight until replay reaches the record
+ * it was issued for.  The number of prefetches in flight is limited to
+ * maintenance_io_concurrency, and the distance in WAL between replay and the
+ * prefetching reader to recovery_prefetch_distance.
+ *
+ * Some blocks are not worth prefetching: blocks that are restored from a
+ * full page image or initialized by the record, blocks that were referenced
+ * just before, and blocks of relations that don't exist yet or that are
+ * shorter than that block, which WAL not yet replayed creates or extends.
+ * After a WAL record that creates or truncates a relation, or creates a
+ * database, prefetching for the blocks of that relation or database is
+ * suppressed until replay has passed the record.
+ *
+ * Counters of what was done with each referenced block are kept in shared
+ * memory and shown in the pg_stat_prefetch_recovery view.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/backend/access/transam/xlogprefetch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <unistd.h>
+
+#include "access/htup_details.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
+#include "access/xlogreader.h"
+#include "access/xlogutils.h"
+#include "catalog/storage_xlog.h"
+#include "commands/dbcommands_xlog.h"
+#include "funcapi.h"
+#include "lib/ilist.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "storage/bufmgr.h"
+#include "storage/fd.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/timestamp.h"
+
+/* GUCs */
+bool		recovery_prefetch = false;
+int			recovery_prefetch_distance = 256 * 1024;
+
+/*
+ * A relation or database whose blocks are not to be prefetched from
+ * filter_from_block on, until the record at filter_until_replayed has been
+ * replayed.  A database is represented by a RelFileNode with an invalid
+ * relNode.
+ */
+typedef struct XLogPrefetcherFilter
+{
+	RelFileNode rnode;			/* hash key; must be first */
+	XLogRecPtr	filter_until_replayed;
+	BlockNumber filter_from_block;
+	dlist_node	link;			/* in filter_queue */
+} XLogPrefetcherFilter;
+
+struct XLogPrefetcher
+{
+	/* reader running ahead of replay, and the timeline it reads */
+	XLogReaderState *reader;
+	TimeLineID	tli;
+
+	/* don't read WAL beyond this point, if valid */
+	XLogRecPtr	read_limit;
+
+	/* the reader has decoded a record whose blocks aren't all looked at */
+	bool		have_record;
+	int			next_block_id;
+
+	/*
+	 * The reader could not read the record at stalled_lsn.  Try again when
+	 * read_limit has moved past stalled_limit, or if there is no limit, when
+	 * replay has left stalled_segno.
+	 */
+	bool		stalled;
+	XLogRecPtr	stalled_lsn;
+	XLogRecPtr	stalled_limit;
+	XLogSegNo	stalled_segno;
+
+	/* the last block looked at, to skip repeated references */
+	RelFileNode last_rnode;
+	BlockNumber last_blkno;
+
+	/* relations and databases not to prefetch from, oldest first */
+	HTAB	   *filter_table;
+	dlist_head	filter_queue;
+
+	/* circular queue of the LSNs of the in-flight prefetches */
+	int			inflight_head;
+	int			inflight_count;
+	XLogRecPtr	inflight[MAX_IO_CONCURRENCY];
+};
+
+/*
+ * Counters shown by pg_stat_prefetch_recovery.  They are only incremented by
+ * the startup process, but may be reset by anyone, hence the atomics.
+ */
+typedef struct XLogPrefetchStats
+{
+	pg_atomic_uint64 reset_time;	/* TimestampTz of last reset */
+	pg_atomic_uint64 prefetch;	/* prefetches that initiated I/O */
+	pg_atomic_uint64 hit;		/* blocks already in shared buffers */
+	pg_atomic_uint64 skip_init; /* blocks initialized by the record */
+	pg_atomic_uint64 skip_new;	/* blocks not existing yet */
+	pg_atomic_uint64 skip_fpw;	/* blocks restored from a full page image */
+	pg_atomic_uint64 skip_rep;	/* blocks referenced just before */
+
+	/* current distance in bytes and number of prefetches in flight */
+	pg_atomic_uint32 distance;
+	pg_atomic_uint32 queue_depth;
+} XLogPrefetchStats;
+
+static XLogPrefetchStats *Stats = NULL;
+
+static int	XLogPrefetcherPageRead(XLogReaderState *reader,
+								   XLogRecPtr targetPagePtr, int reqLen,
+								   XLogRecPtr targetRecPtr, char *readBuf);
+static void XLogPrefetcherScanRecord(XLogPrefetcher *prefetcher);
+static bool XLogPrefetcherScanBlocks(XLogPrefetcher *prefetcher);
+static void XLogPrefetcherAddFilter(XLogPrefetcher *prefetcher,
+									RelFileNode rnode, BlockNumber blkno,
+									XLogRecPtr lsn);
+static bool XLogPrefetcherIsFiltered(XLogPrefetcher *prefetcher,
+									 RelFileNode rnode, BlockNumber blkno);
+static void XLogPrefetcherCompleteFilters(XLogPrefetcher *prefetcher,
+										  XLogRecPtr replaying_lsn);
+static void XLogPrefetcherRestart(XLogPrefetcher *prefetcher,
+								  XLogRecPtr lsn);
+
+static inline void
+XLogPrefetchIncrement(pg_atomic_uint64 *counter)
+{
+	pg_atomic_write_u64(counter, pg_atomic_read_u64(counter) + 1);
+}
+
+Size
+XLogPrefetchShmemSize(void)
+{
+	return sizeof(XLogPrefetchStats);
+}
+
+void
+XLogPrefetchShmemInit(void)
+{
+	bool		found;
+
+	Stats = (XLogPrefetchStats *)
+		ShmemInitStruct("XLogPrefetchStats", sizeof(XLogPrefetchStats),
+						&found);
+
+	if (!found)
+	{
+		pg_atomic_init_u64(&Stats->reset_time, GetCurrentTimestamp());
+		pg_atomic_init_u64(&Stats->prefetch, 0);
+		pg_atomic_init_u64(&Stats->hit, 0);
+		pg_atomic_init_u64(&Stats->skip_init, 0);
+		pg_atomic_init_u64(&Stats->skip_new, 0);
+		pg_atomic_init_u64(&Stats->skip_fpw, 0);
+		pg_atomic_init_u64(&Stats->skip_rep, 0);
+		pg_atomic_init_u32(&Stats->distance, 0);
+		pg_atomic_init_u32(&Stats->queue_depth, 0);
+	}
+}
+
+/*
+ * Reset the counters, for pg_stat_reset_shared('prefetch_recovery').  An
+ * increment done concurrently by the startup process may be lost, which
+ * doesn't matter.
+ */
+void
+XLogPrefetchResetStats(void)
+{
+	pg_atomic_write_u64(&Stats->reset_time, GetCurrentTimestamp());
+	pg_atomic_write_u64(&Stats->prefetch, 0);
+	pg_atomic_write_u64(&Stats->hit, 0);
+	pg_atomic_write_u64(&Stats->skip_init, 0);
+	pg_atomic_write_u64(&Stats->skip_new, 0);
+	pg_atomic_write_u64(&Stats->skip_fpw, 0);
+	pg_atomic_write_u64(&Stats->skip_rep, 0);
+}
+
+/*
+ * Create a prefetcher.  It does nothing while recovery_prefetch is off, so
+ * the startup process can always create one.
+ */
+XLogPrefetcher *
+XLogPrefetcherAllocate(void)
+{
+	XLogPrefetcher *prefetcher;
+	HASHCTL		hash_ctl;
+
+	prefetcher = palloc0(sizeof(XLogPrefetcher));
+	prefetcher->reader =
+		XLogReaderAllocate(wal_segment_size, NULL,
+						   XL_ROUTINE(.page_read = &XLogPrefetcherPageRead,
+									  .segment_open = NULL,
+									  .segment_close = wal_segment_close),
+						   prefetcher);
+	if (!prefetcher->reader)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+
+	memset(&hash_ctl, 0, sizeof(hash_ctl));
+	hash_ctl.keysize = sizeof(RelFileNode);
+	hash_ctl.entrysize = sizeof(XLogPrefetcherFilter);
+	prefetcher->filter_table = hash_create("XLogPrefetcherFilterTable", 1024,
+										   &hash_ctl,
+										   HASH_ELEM | HASH_BLOBS);
+	dlist_init(&prefetcher->filter_queue);
+
+	prefetcher->last_blkno = InvalidBlockNumber;
+
+	return prefetcher;
+}
+
+void
+XLogPrefetcherFree(XLogPrefetcher *prefetcher)
+{
+	pg_atomic_write_u32(&Stats->distance, 0);
+	pg_atomic_write_u32(&Stats->queue_depth, 0);
+
+	XLogReaderFree(prefetcher->reader);
+	hash_destroy(prefetcher->filter_table);
+	pfree(prefetcher);
+}
+
+/*
+ * Issue prefetches for the records following the one that replay is about
+ * to replay, which the replay reader has just read.
+ *
+ * tli is the timeline of the WAL file replay is reading, and read_limit the
+ * point up to which WAL can be read safely, or InvalidXLogRecPtr if all the
+ * WAL in pg_wal can be read.
+ */
+void
+XLogPrefetcherReadAhead(XLogPrefetcher *prefetcher, XLogReaderState *replay,
+						TimeLineID tli, XLogRecPtr read_limit)
+{
+	XLogReaderState *reader = prefetcher->reader;
+	XLogRecPtr	replaying_lsn = replay->ReadRecPtr;
+	XLogRecPtr	next_lsn = replay->EndRecPtr;
+	XLogRecPtr	reader_lsn;
+
+	/*
+	 * Redo is about to read the blocks of the record being replayed, so the
+	 * prefetches issued for it and for the records before it are done with.
+	 */
+	while (prefetcher->inflight_count > 0 &&
+		   prefetcher->inflight[prefetcher->inflight_head] <= replaying_lsn)
+	{
+		prefetcher->inflight_head =
+			(prefetcher->inflight_head + 1) % MAX_IO_CONCURRENCY;
+		prefetcher->inflight_count--;
+	}
+	XLogPrefetcherCompleteFilters(prefetcher, replaying_lsn);
+
+	if (!recovery_prefetch || maintenance_io_concurrency == 0)
+	{
+		pg_atomic_write_u32(&Stats->distance, 0);
+		pg_atomic_write_u32(&Stats->queue_depth, prefetcher->inflight_count);
+		return;
+	}
+
+	prefetcher->read_limit = read_limit;
+
+	/*
+	 * Start over from where replay is if it has caught up with us, or if it
+	 * has moved to another timeline.
+	 */
+	if (prefetcher->stalled)
+		reader_lsn = prefetcher->stalled_lsn;
+	else if (prefetcher->have_record)
+		reader_lsn = reader->ReadRecPtr;
+	else
+		reader_lsn = reader->EndRecPtr;
+	if (reader_lsn < next_lsn || tli != prefetcher->tli)
+	{
+		if (reader->seg.ws_file >= 0 && tli != prefetcher->tli)
+			wal_segment_close(reader);
+		prefetcher->tli = tli;
+		XLogPrefetcherRestart(prefetcher, next_lsn);
+	}
+
+	if (prefetcher->stalled)
+	{
+		XLogSegNo	segno;
+
+		XLByteToSeg(next_lsn, segno, wal_segment_size);
+		if (XLogRecPtrIsInvalid(read_limit) ?
+			segno == prefetcher->stalled_segno :
+			read_limit <= prefetcher->stalled_limit)
+			return;
+		XLogPrefetcherRestart(prefetcher, prefetcher->stalled_lsn);
+	}
+
+	while (prefetcher->inflight_count < maintenance_io_concurrency)
+	{
+		if (!prefetcher->have_record)
+		{
+			XLogRecPtr	read_lsn = reader->EndRecPtr;
+			XLogRecord *record;
+			char	   *errormsg;
+
+			if (read_lsn - next_lsn >= recovery_prefetch_distance)
+				break;
+
+			record = XLogReadRecord(reader, &errormsg);
+			if (record == NULL)
+			{
+				/* end of the WAL we can read for now, or invalid data */
+				prefetcher->stalled = true;
+				prefetcher->stalled_lsn = read_lsn;
+				prefetcher->stalled_limit = read_limit;
+				XLByteToSeg(next_lsn, prefetcher->stalled_segno,
+							wal_segment_size);
+				break;
+			}
+
+			XLogPrefetcherScanRecord(prefetcher);
+			prefetcher->have_record = true;
+			prefetcher->next_block_id = 0;
+		}
+
+		/* stop if that ran out of room for more prefetches */
+		if (!XLogPrefetcherScanBlocks(prefetcher))
+			break;
+		prefetcher->have_record = false;
+	}
+
+	if (prefetcher->stalled)
+		reader_lsn = prefetcher->stalled_lsn;
+	else
+		reader_lsn = reader->EndRecPtr;
+	pg_atomic_write_u32(&Stats->distance,
+						reader_lsn > next_lsn ? reader_lsn - next_lsn : 0);
+	pg_atomic_write_u32(&Stats->queue_depth, prefetcher->inflight_count);
+}
+
+/*
+ * Make the prefetching reader continue at the given record.
+ */
+static void
+XLogPrefetcherRestart(XLogPrefetcher *prefetcher, XLogRecPtr lsn)
+{
+	XLogBeginRead(prefetcher->reader, lsn);
+	prefetcher->have_record = false;
+	prefetcher->stalled = false;
+}
+
+/*
+ * XLogReaderRoutine->page_read callback of the prefetching reader.  Unlike
+ * the one used for replay, this doesn't wait for WAL to become available,
+ * and fails instead of raising an error.
+ */
+static int
+XLogPrefetcherPageRead(XLogReaderState *reader, XLogRecPtr targetPagePtr,
+					   int reqLen, XLogRecPtr targetRecPtr, char *readBuf)
+{
+	XLogPrefetcher *prefetcher = (XLogPrefetcher *) reader->private_data;
+	XLogRecPtr	read_limit = prefetcher->read_limit;
+	XLogSegNo	segno;
+	int			count = XLOG_BLCKSZ;
+
+	if (!XLogRecPtrIsInvalid(read_limit))
+	{
+		if (targetPagePtr + reqLen > read_limit)
+			return -1;
+		if (targetPagePtr + XLOG_BLCKSZ > read_limit)
+			count = read_limit - targetPagePtr;
+	}
+
+	XLByteToSeg(targetPagePtr, segno, wal_segment_size);
+	if (reader->seg.ws_file >= 0 && reader->seg.ws_segno != segno)
+		wal_segment_close(reader);
+	if (reader->seg.ws_file < 0)
+	{
+		char		path[MAXPGPATH];
+
+		XLogFilePath(path, prefetcher->tli, segno, wal_segment_size);
+		reader->seg.ws_file = BasicOpenFile(path, O_RDONLY | PG_BINARY);
+		if (reader->seg.ws_file < 0)
+			return -1;
+		reader->seg.ws_segno = segno;
+		reader->seg.ws_tli = prefetcher->tli;
+	}
+
+	pgstat_report_wait_start(WAIT_EVENT_WAL_READ);
+	if (pg_pread(reader->seg.ws_file, readBuf, XLOG_BLCKSZ,
+				 XLogSegmentOffset(targetPagePtr, wal_segment_size)) != XLOG_BLCKSZ)
+	{
+		pgstat_report_wait_end();
+		return -1;
+	}
+	pgstat_report_wait_end();
+
+	return count;
+}
+
+/*
+ * Look for records that create a relation or database before replay gets
+ * to them, or that truncate a relation.  Prefetching for the blocks they
+ * affect has to wait until replay has passed them.
+ */
+static void
+XLogPrefetcherScanRecord(XLogPrefetcher *prefetcher)
+{
+	XLogReaderState *reader = prefetcher->reader;
+	XLogRecPtr	lsn = reader->ReadRecPtr;
+	uint8		rmid = XLogRecGetRmid(reader);
+	uint8		info = XLogRecGetInfo(reader) & ~XLR_INFO_MASK;
+
+	if (rmid == RM_SMGR_ID && info == XLOG_SMGR_CREATE)
+	{
+		xl_smgr_create *xlrec = (xl_smgr_create *) XLogRecGetData(reader);
+
+		XLogPrefetcherAddFilter(prefetcher, xlrec->rnode, 0, lsn);
+	}
+	else if (rmid == RM_SMGR_ID && info == XLOG_SMGR_TRUNCATE)
+	{
+		xl_smgr_truncate *xlrec = (xl_smgr_truncate *) XLogRecGetData(reader);
+
+		XLogPrefetcherAddFilter(prefetcher, xlrec->rnode, xlrec->blkno, lsn);
+	}
+	else if (rmid == RM_DBASE_ID && info == XLOG_DBASE_CREATE)
+	{
+		xl_dbase_create_rec *xlrec =
+		(xl_dbase_create_rec *) XLogRecGetData(reader);
+		RelFileNode rnode;
+
+		rnode.spcNode = xlrec->tablespace_id;
+		rnode.dbNode = xlrec->db_id;
+		rnode.relNode = InvalidOid;
+		XLogPrefetcherAddFilter(prefetcher, rnode, 0, lsn);
+	}
+}
+
+/*
+ * Issue prefetches for the blocks of the record the prefetching reader has
+ * decoded, starting at next_block_id.  Returns false if there are blocks
+ * left because the number of prefetches in flight reached the limit.
+ */
+static bool
+XLogPrefetcherScanBlocks(XLogPrefetcher *prefetcher)
+{
+	XLogReaderState *reader = prefetcher->reader;
+
+	for (; prefetcher->next_block_id <= reader->max_block_id;
+		 prefetcher->next_block_id++)
+	{
+		DecodedBkpBlock *block = &reader->blocks[prefetcher->next_block_id];
+		SMgrRelation reln;
+		BlockNumber nblocks;
+		PrefetchBufferResult result;
+
+		if (!block->in_use)
+			continue;
+
+		/* only the main fork is worth the trouble */
+		if (block->forknum != MAIN_FORKNUM)
+			continue;
+
+		if (block->apply_image)
+		{
+			XLogPrefetchIncrement(&Stats->skip_fpw);
+			continue;
+		}
+		if (block->flags & BKPBLOCK_WILL_INIT)
+		{
+			XLogPrefetchIncrement(&Stats->skip_init);
+			continue;
+		}
+		if (RelFileNodeEquals(block->rnode, prefetcher->last_rnode) &&
+			block->blkno == prefetcher->last_blkno)
+		{
+			XLogPrefetchIncrement(&Stats->skip_rep);
+			continue;
+		}
+		if (XLogPrefetcherIsFiltered(prefetcher, block->rnode, block->blkno))
+		{
+			XLogPrefetchIncrement(&Stats->skip_new);
+			continue;
+		}
+
+		if (prefetcher->inflight_count >= maintenance_io_concurrency)
+			return false;
+
+		prefetcher->last_rnode = block->rnode;
+		prefetcher->last_blkno = block->blkno;
+
+		/*
+		 * If the relation doesn't exist or is too short, it is created or
+		 * extended by WAL that hasn't been replayed yet, or dropped or
+		 * truncated later on.  Don't look at it again until this record has
+		 * been replayed.
+		 */
+		reln = smgropen(block->rnode, InvalidBackendId);
+		if (!smgrexists(reln, MAIN_FORKNUM))
+		{
+			XLogPrefetcherAddFilter(prefetcher, block->rnode, 0,
+									reader->ReadRecPtr);
+			XLogPrefetchIncrement(&Stats->skip_new);
+			continue;
+		}
+		nblocks = smgrnblocks(reln, MAIN_FORKNUM);
+		if (block->blkno >= nblocks)
+		{
+			XLogPrefetcherAddFilter(prefetcher, block->rnode, nblocks,
+									reader->ReadRecPtr);
+			XLogPrefetchIncrement(&Stats->skip_new);
+			continue;
+		}
+
+		result = PrefetchSharedBuffer(reln, block->forknum, block->blkno);
+		if (BufferIsValid(result.recent_buffer))
+			XLogPrefetchIncrement(&Stats->hit);
+		else if (result.initiated_io)
+		{
+			int			slot;
+
+			slot = (prefetcher->inflight_head + prefetcher->inflight_count) %
+				MAX_IO_CONCURRENCY;
+			prefetcher->inflight[slot] = reader->ReadRecPtr;
+			prefetcher->inflight_count++;
+			XLogPrefetchIncrement(&Stats->prefetch);
+		}
+		else
+		{
+			/* the segment file of the block doesn't exist */
+			XLogPrefetchIncrement(&Stats->skip_new);
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Don't prefetch the blocks of a relation, or all relations of a database,
+ * from blkno on, until the record at lsn has been replayed.
+ */
+static void
+XLogPrefetcherAddFilter(XLogPrefetcher *prefetcher, RelFileNode rnode,
+						BlockNumber blkno, XLogRecPtr lsn)
+{
+	XLogPrefetcherFilter *filter;
+	bool		found;
+
+	filter = hash_search(prefetcher->filter_table, &rnode, HASH_ENTER, &found);
+	if (found)
+	{
+		/* keep the queue in LSN order */
+		dlist_delete(&filter->link);
+		filter->filter_from_block = Min(filter->filter_from_block, blkno);
+	}
+	else
+		filter->filter_from_block = blkno;
+	filter->filter_until_replayed = lsn;
+	dlist_push_tail(&prefetcher->filter_queue, &filter->link);
+}
+
+/*
+ * Forget the filters for the records replay has passed.
+ */
+static void
+XLogPrefetcherCompleteFilters(XLogPrefetcher *prefetcher,
+							  XLogRecPtr replaying_lsn)
+{
+	while (!dlist_is_empty(&prefetcher->filter_queue))
+	{
+		XLogPrefetcherFilter *filter;
+
+		filter = dlist_head_element(XLogPrefetcherFilter, link,
+									&prefetcher->filter_queue);
+		if (filter->filter_until_replayed >= replaying_lsn)
+			break;
+		dlist_delete(&filter->link);
+		hash_search(prefetcher->filter_table, &filter->rnode, HASH_REMOVE,
+					NULL);
+	}
+}
+
+/*
+ * Check whether a block is filtered out by XLogPrefetcherAddFilter.
+ */
+static bool
+XLogPrefetcherIsFiltered(XLogPrefetcher *prefetcher, RelFileNode rnode,
+						 BlockNumber blkno)
+{
+	XLogPrefetcherFilter *filter;
+	RelFileNode dbnode;
+
+	if (dlist_is_empty(&prefetcher->filter_queue))
+		return false;
+
+	filter = hash_search(prefetcher->filter_table, &rnode, HASH_FIND, NULL);
+	if (filter && filter->filter_from_block <= blkno)
+		return true;
+
+	dbnode = rnode;
+	dbnode.relNode = InvalidOid;
+	filter = hash_search(prefetcher->filter_table, &dbnode, HASH_FIND, NULL);
+	if (filter)
+		return true;
+
+	return false;
+}
+
+/*
+ * SQL-callable function for the pg_stat_prefetch_recovery view.
+ */
+Datum
+pg_stat_get_prefetch_recovery(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_PREFETCH_RECOVERY_COLS 9
+	TupleDesc	tupdesc;
+	Datum		values[PG_STAT_GET_PREFETCH_RECOVERY_COLS];
+	bool		nulls[PG_STAT_GET_PREFETCH_RECOVERY_COLS];
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	memset(nulls, 0, sizeof(nulls));
+	values[0] = TimestampTzGetDatum(pg_atomic_read_u64(&Stats->reset_time));
+	values[1] = Int64GetDatum(pg_atomic_read_u64(&Stats->prefetch));
+	values[2] = Int64GetDatum(pg_atomic_read_u64(&Stats->hit));
+	values[3] = Int64GetDatum(pg_atomic_read_u64(&Stats->skip_init));
+	values[4] = Int64GetDatum(pg_atomic_read_u64(&Stats->skip_new));
+	values[5] = Int64GetDatum(pg_atomic_read_u64(&Stats->skip_fpw));
+	values[6] = Int64GetDatum(pg_atomic_read_u64(&Stats->skip_rep));
+	values[7] = Int32GetDatum(pg_atomic_read_u32(&Stats->distance));
+	values[8] = Int32GetDatum(pg_atomic_read_u32(&Stats->queue_depth));
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
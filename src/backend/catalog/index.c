@@ -2511,6 +2511,7 @@ void
 BuildSpeculativeIndexInfo(Relation index, IndexInfo *ii)
 {
 	int			indnkeyatts;
+	uint16		eqstrat;
 	int			i;
 
 	indnkeyatts = IndexRelationGetNumberOfKeyAttributes(index);
@@ -2520,8 +2521,13 @@ BuildSpeculativeIndexInfo(Relation index, IndexInfo *ii)
 	 */
 	Assert(ii->ii_Unique);
 
-	if (index->rd_rel->relam != BTREE_AM_OID)
-		elog(ERROR, "unexpected non-btree speculative unique index");
+	if (index->rd_rel->relam == BTREE_AM_OID)
+		eqstrat = BTEqualStrategyNumber;
+	else if (index->rd_rel->relam == HASH_AM_OID)
+		eqstrat = HTEqualStrategyNumber;
+	else
+		elog(ERROR, "unexpected speculative unique index with access method %u",
+			 index->rd_rel->relam);
 
 	ii->ii_UniqueOps = (Oid *) palloc(sizeof(Oid) * indnkeyatts);
 	ii->ii_UniqueProcs = (Oid *) palloc(sizeof(Oid) * indnkeyatts);
@@ -2534,7 +2540,7 @@ BuildSpeculativeIndexInfo(Relation index, IndexInfo *ii)
 	/* We need the func OIDs and strategy numbers too */
 	for (i = 0; i < indnkeyatts; i++)
 	{
-		ii->ii_UniqueStrats[i] = BTEqualStrategyNumber;
+		ii->ii_UniqueStrats[i] = eqstrat;
 		ii->ii_UniqueOps[i] =
 			get_opfamily_member(index->rd_opfamily[i],
 								index->rd_opcintype[i],
@@ -2824,13 +2830,13 @@ index_build(Relation heapRelation,
 	Assert(PointerIsValid(indexRelation->rd_indam->ambuildempty));
 
 	/*
-	 * Determine worker process details for parallel CREATE INDEX.  Currently,
-	 * only btree has support for parallel builds.
+	 * Determine worker process details for parallel CREATE INDEX, if the
+	 * access method supports parallel builds.
 	 *
 	 * Note that planner considers parallel safety for us.
 	 */
 	if (parallel && IsNormalProcessingMode() &&
-		indexRelation->rd_rel->relam == BTREE_AM_OID)
+		indexRelation->rd_indam->amcanbuildparallel)
 		indexInfo->ii_ParallelWorkers =
 			plan_create_index_workers(RelationGetRelid(heapRelation),
 									  RelationGetRelid(indexRelation));
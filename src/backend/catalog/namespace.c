@@ -45,6 +45,7 @@
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "parser/parse_func.h"
+#include "postmaster/proxy.h"
 #include "storage/ipc.h"
 #include "storage/lmgr.h"
 #include "storage/sinvaladt.h"
@@ -3920,6 +3921,9 @@ AccessTempTableNamespace(bool force)
 	 */
 	MyXactFlags |= XACT_FLAGS_ACCESSEDTEMPNAMESPACE;
 
+	/* Temporary objects outlive the transaction */
+	MarkSessionUnpoolable("temporary objects");
+
 	/*
 	 * If the caller attempting to access a temporary schema expects the
 	 * creation of the namespace to be pending and should be enforced, then go
@@ -17,6 +17,7 @@
 #include "access/genam.h"
 #include "access/heapam.h"
 #include "access/htup_details.h"
+#include "access/sysattr.h"
 #include "access/tableam.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
@@ -33,6 +34,7 @@
 #include "catalog/pg_type.h"
 #include "funcapi.h"
 #include "miscadmin.h"
+#include "optimizer/optimizer.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/catcache.h"
@@ -137,20 +139,142 @@ pg_relation_is_publishable(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Translate a list of column names to a sorted array of attribute numbers,
+ * checking that the columns exist and can be published.
+ */
+static int
+publication_translate_columns(Relation targetrel, List *columns,
+							  AttrNumber **attnums)
+{
+	AttrNumber *attarray;
+	int			n = 0;
+	ListCell   *lc;
+
+	attarray = palloc(sizeof(AttrNumber) * list_length(columns));
+
+	foreach(lc, columns)
+	{
+		char	   *colname = strVal(lfirst(lc));
+		AttrNumber	attnum = get_attnum(RelationGetRelid(targetrel), colname);
+		int			i;
+
+		if (attnum == InvalidAttrNumber)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_COLUMN),
+					 errmsg("column \"%s\" of relation \"%s\" does not exist",
+							colname, RelationGetRelationName(targetrel))));
+
+		if (attnum < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+					 errmsg("cannot use system column \"%s\" in publication column list",
+							colname)));
+
+		if (TupleDescAttr(RelationGetDescr(targetrel), attnum - 1)->attgenerated)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+					 errmsg("cannot use generated column \"%s\" in publication column list",
+							colname)));
+
+		/* keep the array sorted, rejecting duplicates */
+		for (i = n; i > 0 && attarray[i - 1] >= attnum; i--)
+		{
+			if (attarray[i - 1] == attnum)
+				ereport(ERROR,
+						(errcode(ERRCODE_DUPLICATE_OBJECT),
+						 errmsg("duplicate column \"%s\" in publication column list",
+								colname)));
+			attarray[i] = attarray[i - 1];
+		}
+		attarray[i] = attnum;
+		n++;
+	}
+
+	*attnums = attarray;
+	return n;
+}
+
+/*
+ * Check that a column list and row filter leave enough of each row for
+ * UPDATE and DELETE to be applied on the subscriber: the column list must
+ * include the replica identity columns, and the row filter may only use
+ * them, since the old tuple of a DELETE carries nothing else.
+ */
+static void
+check_publication_rel_identity(Relation targetrel, Publication *pub,
+							   Node *whereClause,
+							   AttrNumber *attnums, int nattnums)
+{
+	Bitmapset  *idattrs;
+	int			i;
+
+	if (!pub->pubactions.pubupdate && !pub->pubactions.pubdelete)
+		return;
+
+	if (targetrel->rd_rel->relreplident == REPLICA_IDENTITY_FULL)
+	{
+		if (nattnums > 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+					 errmsg("cannot use a column list for table \"%s\" with REPLICA IDENTITY FULL in publication \"%s\"",
+							RelationGetRelationName(targetrel), pub->name),
+					 errdetail("The publication publishes UPDATE or DELETE operations.")));
+		return;
+	}
+
+	idattrs = RelationGetIndexAttrBitmap(targetrel,
+										 INDEX_ATTR_BITMAP_IDENTITY_KEY);
+
+	if (nattnums > 0)
+	{
+		Bitmapset  *listattrs = NULL;
+
+		for (i = 0; i < nattnums; i++)
+			listattrs = bms_add_member(listattrs,
+									   attnums[i] - FirstLowInvalidHeapAttributeNumber);
+
+		if (!bms_is_subset(idattrs, listattrs))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+					 errmsg("column list for table \"%s\" in publication \"%s\" must include the replica identity columns",
+							RelationGetRelationName(targetrel), pub->name),
+					 errdetail("The publication publishes UPDATE or DELETE operations.")));
+	}
+
+	if (whereClause)
+	{
+		Bitmapset  *qualattrs = NULL;
+
+		pull_varattnos(whereClause, 1, &qualattrs);
+
+		if (!bms_is_subset(qualattrs, idattrs))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+					 errmsg("row filter for table \"%s\" in publication \"%s\" may only reference replica identity columns",
+							RelationGetRelationName(targetrel), pub->name),
+					 errdetail("The publication publishes UPDATE or DELETE operations.")));
+	}
+}
+
 /*
  * Insert new publication / relation mapping.
  */
 ObjectAddress
-publication_add_relation(Oid pubid, Relation targetrel,
+publication_add_relation(Oid pubid, PublicationRelInfo *pri,
 						 bool if_not_exists)
 {
 	Relation	rel;
 	HeapTuple	tup;
 	Datum		values[Natts_pg_publication_rel];
 	bool		nulls[Natts_pg_publication_rel];
+	Relation	targetrel = pri->relation;
 	Oid			relid = RelationGetRelid(targetrel);
 	Oid			prrelid;
 	Publication *pub = GetPublication(pubid);
+	AttrNumber *attnums = NULL;
+	int			nattnums = 0;
+	int			i;
 	ObjectAddress myself,
 				referenced;
 
@@ -177,6 +301,13 @@ publication_add_relation(Oid pubid, Relation targetrel,
 
 	check_publication_add_relation(targetrel);
 
+	if (pri->columns != NIL)
+		nattnums = publication_translate_columns(targetrel, pri->columns,
+												 &attnums);
+
+	check_publication_rel_identity(targetrel, pub, pri->whereClause,
+								   attnums, nattnums);
+
 	/* Form a tuple. */
 	memset(values, 0, sizeof(values));
 	memset(nulls, false, sizeof(nulls));
@@ -189,6 +320,18 @@ publication_add_relation(Oid pubid, Relation targetrel,
 	values[Anum_pg_publication_rel_prrelid - 1] =
 		ObjectIdGetDatum(relid);
 
+	if (pri->whereClause)
+		values[Anum_pg_publication_rel_prqual - 1] =
+			CStringGetTextDatum(nodeToString(pri->whereClause));
+	else
+		nulls[Anum_pg_publication_rel_prqual - 1] = true;
+
+	if (nattnums > 0)
+		values[Anum_pg_publication_rel_prattrs - 1] =
+			PointerGetDatum(buildint2vector(attnums, nattnums));
+	else
+		nulls[Anum_pg_publication_rel_prattrs - 1] = true;
+
 	tup = heap_form_tuple(RelationGetDescr(rel), values, nulls);
 
 	/* Insert tuple into catalog. */
@@ -205,6 +348,18 @@ publication_add_relation(Oid pubid, Relation targetrel,
 	ObjectAddressSet(referenced, RelationRelationId, relid);
 	recordDependencyOn(&myself, &referenced, DEPENDENCY_AUTO);
 
+	/* Add dependencies on the columns of the column list and row filter */
+	for (i = 0; i < nattnums; i++)
+	{
+		ObjectAddressSubSet(referenced, RelationRelationId, relid, attnums[i]);
+		recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
+	}
+
+	if (pri->whereClause)
+		recordDependencyOnSingleRelExpr(&myself, pri->whereClause, relid,
+										DEPENDENCY_NORMAL, DEPENDENCY_NORMAL,
+										false);
+
 	/* Close the table. */
 	table_close(rel, RowExclusiveLock);
 
@@ -408,14 +408,20 @@ void
 RelationCopyStorage(SMgrRelation src, SMgrRelation dst,
 					ForkNumber forkNum, char relpersistence)
 {
-	PGAlignedBlock buf;
-	Page		page;
+	PGAlignedBlock *bufs;
+	Page		pages[XLR_MAX_BLOCK_ID];
+	BlockNumber blknos[XLR_MAX_BLOCK_ID];
 	bool		use_wal;
 	bool		copying_initfork;
 	BlockNumber nblocks;
 	BlockNumber blkno;
+	int			nbatch;
+	int			i;
 
-	page = (Page) buf.data;
+	/* We copy up to one WAL record's worth of pages at a time */
+	bufs = (PGAlignedBlock *) palloc(sizeof(PGAlignedBlock) * XLR_MAX_BLOCK_ID);
+	for (i = 0; i < XLR_MAX_BLOCK_ID; i++)
+		pages[i] = (Page) bufs[i].data;
 
 	/*
 	 * The init fork for an unlogged relation in many respects has to be
@@ -436,40 +442,52 @@ RelationCopyStorage(SMgrRelation src, SMgrRelation dst,
 
 	nblocks = smgrnblocks(src, forkNum);
 
-	for (blkno = 0; blkno < nblocks; blkno++)
+	for (blkno = 0; blkno < nblocks; blkno += nbatch)
 	{
-		/* If we got a cancel signal during the copy of the data, quit */
-		CHECK_FOR_INTERRUPTS();
+		nbatch = Min(XLR_MAX_BLOCK_ID, nblocks - blkno);
 
-		smgrread(src, forkNum, blkno, buf.data);
-
-		if (!PageIsVerified(page, blkno))
-			ereport(ERROR,
-					(errcode(ERRCODE_DATA_CORRUPTED),
-					 errmsg("invalid page in block %u of relation %s",
-							blkno,
-							relpathbackend(src->smgr_rnode.node,
-										   src->smgr_rnode.backend,
-										   forkNum))));
+		for (i = 0; i < nbatch; i++)
+		{
+			/* If we got a cancel signal during the copy of the data, quit */
+			CHECK_FOR_INTERRUPTS();
+
+			blknos[i] = blkno + i;
+			smgrread(src, forkNum, blknos[i], bufs[i].data);
+
+			if (!PageIsVerified(pages[i], blknos[i]))
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("invalid page in block %u of relation %s",
+								blknos[i],
+								relpathbackend(src->smgr_rnode.node,
+											   src->smgr_rnode.backend,
+											   forkNum))));
+		}
 
 		/*
-		 * WAL-log the copied page. Unfortunately we don't know what kind of a
-		 * page this is, so we have to log the full page including any unused
-		 * space.
+		 * WAL-log the copied pages, all in one record. Unfortunately we don't
+		 * know what kind of pages these are, so we have to log the full pages
+		 * including any unused space.
 		 */
 		if (use_wal)
-			log_newpage(&dst->smgr_rnode.node, forkNum, blkno, page, false);
+			log_newpages(&dst->smgr_rnode.node, forkNum, nbatch, blknos,
+						 pages, false);
 
-		PageSetChecksumInplace(page, blkno);
-
-		/*
-		 * Now write the page.  We say skipFsync = true because there's no
-		 * need for smgr to schedule an fsync for this write; we'll do it
-		 * ourselves below.
-		 */
-		smgrextend(dst, forkNum, blkno, buf.data, true);
+		for (i = 0; i < nbatch; i++)
+		{
+			PageSetChecksumInplace(pages[i], blknos[i]);
+
+			/*
+			 * Now write the page.  We say skipFsync = true because there's no
+			 * need for smgr to schedule an fsync for this write; we'll do it
+			 * ourselves below.
+			 */
+			smgrextend(dst, forkNum, blknos[i], bufs[i].data, true);
+		}
 	}
 
+	pfree(bufs);
+
 	/*
 	 * When we WAL-logged rel pages, we must nonetheless fsync them.  The
 	 * reason is that since we're copying outside shared buffers, a CHECKPOINT
@@ -554,6 +554,12 @@ CREATE VIEW pg_shmem_allocations AS
 REVOKE ALL ON pg_shmem_allocations FROM PUBLIC;
 REVOKE EXECUTE ON FUNCTION pg_get_shmem_allocations() FROM PUBLIC;
 
+CREATE VIEW pg_shmem_numa AS
+    SELECT * FROM pg_get_shmem_numa();
+
+REVOKE ALL ON pg_shmem_numa FROM PUBLIC;
+REVOKE EXECUTE ON FUNCTION pg_get_shmem_numa() FROM PUBLIC;
+
 CREATE VIEW pg_backend_memory_contexts AS
     SELECT * FROM pg_get_backend_memory_contexts();
 
@@ -572,6 +578,8 @@ CREATE VIEW pg_stat_all_tables AS
             sum(pg_stat_get_numscans(I.indexrelid))::bigint AS idx_scan,
             sum(pg_stat_get_tuples_fetched(I.indexrelid))::bigint +
             pg_stat_get_tuples_fetched(C.oid) AS idx_tup_fetch,
+            pg_stat_get_ios_heap_fetches(C.oid) AS ios_heap_fetch,
+            pg_stat_get_ios_heap_fetches_avoided(C.oid) AS ios_heap_fetch_avoided,
             pg_stat_get_tuples_inserted(C.oid) AS n_tup_ins,
             pg_stat_get_tuples_updated(C.oid) AS n_tup_upd,
             pg_stat_get_tuples_deleted(C.oid) AS n_tup_del,
@@ -765,7 +773,8 @@ CREATE VIEW pg_stat_activity AS
             S.backend_xid,
             s.backend_xmin,
             S.query,
-            S.backend_type
+            S.backend_type,
+            S.allocated_bytes
     FROM pg_stat_get_activity(NULL) AS S
         LEFT JOIN pg_database AS D ON (S.datid = D.oid)
         LEFT JOIN pg_authid AS U ON (S.usesysid = U.oid);
@@ -809,6 +818,83 @@ CREATE VIEW pg_stat_slru AS
             s.stats_reset
     FROM pg_stat_get_slru() s;
 
+CREATE VIEW pg_stat_io AS
+    SELECT
+            b.backend_type,
+            b.object,
+            b.context,
+            b.reads,
+            b.read_time,
+            b.writes,
+            b.write_time,
+            b.extends,
+            b.extend_time,
+            b.op_bytes,
+            b.hits,
+            b.evictions,
+            b.reuses,
+            b.fsyncs,
+            b.fsync_time,
+            b.stats_reset
+    FROM pg_stat_get_io() b;
+
+CREATE VIEW pg_stat_lwlocks AS
+    SELECT
+            l.name,
+            l.acquires,
+            l.waits,
+            l.wait_time,
+            l.stats_reset
+    FROM pg_stat_get_lwlocks() l;
+
+CREATE VIEW pg_stat_wait_events AS
+    SELECT
+            w.pid,
+            w.wait_event_type,
+            w.wait_event,
+            w.calls,
+            w.total_time,
+            w.histogram
+    FROM pg_stat_get_wait_events(NULL) w;
+
+CREATE VIEW pg_stat_proxies AS
+    SELECT
+            p.pid,
+            p.clients,
+            p.pools,
+            p.backends,
+            p.idle_backends,
+            p.dedicated_backends,
+            p.waiting_clients,
+            p.transactions
+    FROM pg_stat_get_proxies() p;
+
+CREATE VIEW pg_stat_buffer_relations AS
+    SELECT
+            b.datid,
+            b.relid,
+            b.reltablespace,
+            b.relfilenode,
+            b.hits,
+            b.reads,
+            b.evictions,
+            b.dirtied,
+            b.written_backend,
+            b.written_bgwriter,
+            b.written_checkpointer,
+            b.stats_reset
+    FROM pg_stat_get_buffer_relations() b;
+
+CREATE VIEW pg_stat_buffer_strategies AS
+    SELECT
+            b.strategy,
+            b.hits,
+            b.reads,
+            b.evictions,
+            b.written,
+            b.stats_reset
+    FROM pg_stat_get_buffer_strategies() b;
+
 CREATE VIEW pg_stat_wal_receiver AS
     SELECT
             s.pid,
@@ -965,6 +1051,33 @@ CREATE VIEW pg_stat_archiver AS
         s.stats_reset
     FROM pg_stat_get_archiver() s;
 
+CREATE VIEW pg_stat_prefetch_recovery AS
+    SELECT
+        s.stats_reset,
+        s.prefetch,
+        s.hit,
+        s.skip_init,
+        s.skip_new,
+        s.skip_fpw,
+        s.skip_rep,
+        s.distance,
+        s.queue_depth
+     FROM pg_stat_get_prefetch_recovery() s;
+
+CREATE VIEW pg_stat_group_commit AS
+    SELECT
+        s.flushes,
+        s.requests,
+        s.delays,
+        s.delay_time,
+        s.flush_time,
+        s.avg_flush_time,
+        s.avg_request_interval,
+        s.group_size_histogram,
+        s.flush_time_histogram,
+        s.stats_reset
+     FROM pg_stat_get_group_commit() s;
+
 CREATE VIEW pg_stat_bgwriter AS
     SELECT
         pg_stat_get_bgwriter_timed_checkpoints() AS checkpoints_timed,
@@ -1445,6 +1558,7 @@ REVOKE EXECUTE ON FUNCTION pg_promote(boolean, integer) FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset() FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_shared(text) FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_slru(text) FROM public;
+REVOKE EXECUTE ON FUNCTION pg_stat_reset_buffer_usage() FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_single_table_counters(oid) FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_single_function_counters(oid) FROM public;
 
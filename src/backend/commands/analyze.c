@@ -19,6 +19,7 @@
 #include "access/detoast.h"
 #include "access/genam.h"
 #include "access/multixact.h"
+#include "access/parallel.h"
 #include "access/relation.h"
 #include "access/sysattr.h"
 #include "access/table.h"
@@ -33,6 +34,7 @@
 #include "catalog/pg_collation.h"
 #include "catalog/pg_inherits.h"
 #include "catalog/pg_namespace.h"
+#include "catalog/pg_proc.h"
 #include "catalog/pg_statistic_ext.h"
 #include "commands/dbcommands.h"
 #include "commands/progress.h"
@@ -52,6 +54,8 @@
 #include "storage/lmgr.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
+#include "storage/shm_mq.h"
+#include "tcop/tcopprot.h"
 #include "utils/acl.h"
 #include "utils/attoptcache.h"
 #include "utils/builtins.h"
@@ -77,6 +81,66 @@ typedef struct AnlIndexData
 } AnlIndexData;
 
 
+/*
+ * Parallel ANALYZE.
+ *
+ * Once the sample has been acquired, the statistics of the table's columns
+ * can be computed independently of each other, and with wide tables and
+ * large statistics targets that's where most of the time goes.  So we copy
+ * the sample rows into a DSM segment, and the leader and the workers claim
+ * columns one at a time.  A worker sends the results for each column it
+ * computed through its own shm_mq, and the leader copies them into its
+ * VacAttrStats, as if it had computed them itself.  Index expressions and
+ * extended statistics are still done by the leader alone, afterwards.
+ */
+#define PARALLEL_ANALYZE_KEY_SHARED			1
+#define PARALLEL_ANALYZE_KEY_ROWS			2
+#define PARALLEL_ANALYZE_KEY_QUEUES			3
+#define PARALLEL_ANALYZE_KEY_QUERY_TEXT		4
+
+#define PARALLEL_ANALYZE_QUEUE_SIZE		(64 * 1024)
+
+/*
+ * Unless the number of workers is given explicitly, use one worker per this
+ * many columns, and none unless the sample holds at least this many values.
+ */
+#define PARALLEL_ANALYZE_COLUMNS_PER_WORKER	8
+#define PARALLEL_ANALYZE_MIN_VALUES			1000000
+
+/* Shared state for parallel ANALYZE, in the DSM segment */
+typedef struct ParallelAnalyzeShared
+{
+	Oid			relid;			/* table being analyzed */
+	int			numrows;		/* # of sample rows */
+	double		totalrows;		/* estimated # of rows in the table */
+	int			attr_cnt;		/* # of columns to analyze */
+	pg_atomic_uint32 nextcol;	/* index of next column to claim */
+	AttrNumber	attnums[FLEXIBLE_ARRAY_MEMBER]; /* columns to analyze */
+} ParallelAnalyzeShared;
+
+/*
+ * Statistics of one column, as sent by a worker to the leader.  This is
+ * followed by the stanumbers of each slot, then by its stavalues in the
+ * format of datumSerialize().
+ */
+typedef struct ParallelAnalyzeResult
+{
+	int			colidx;			/* index into the leader's vacattrstats */
+	bool		stats_valid;
+	float4		stanullfrac;
+	int32		stawidth;
+	float4		stadistinct;
+	int16		stakind[STATISTIC_NUM_SLOTS];
+	Oid			staop[STATISTIC_NUM_SLOTS];
+	Oid			stacoll[STATISTIC_NUM_SLOTS];
+	int			numnumbers[STATISTIC_NUM_SLOTS];
+	int			numvalues[STATISTIC_NUM_SLOTS];
+	Oid			statypid[STATISTIC_NUM_SLOTS];
+	int16		statyplen[STATISTIC_NUM_SLOTS];
+	bool		statypbyval[STATISTIC_NUM_SLOTS];
+	char		statypalign[STATISTIC_NUM_SLOTS];
+} ParallelAnalyzeResult;
+
 /* Default statistics target (GUC parameter) */
 int			default_statistics_target = 100;
 
@@ -89,6 +153,22 @@ static void do_analyze_rel(Relation onerel,
 						   VacuumParams *params, List *va_cols,
 						   AcquireSampleRowsFunc acquirefunc, BlockNumber relpages,
 						   bool inh, bool in_outer_xact, int elevel);
+static void compute_column_stats(VacAttrStats *stats, TupleDesc tupDesc,
+								 HeapTuple *rows, int numrows,
+								 double totalrows);
+static int	analyze_parallel_workers(Relation onerel, VacuumParams *params,
+									 bool inh, VacAttrStats **vacattrstats,
+									 int attr_cnt, int numrows);
+static bool compute_column_stats_parallel(Relation onerel,
+										  VacAttrStats **vacattrstats,
+										  int attr_cnt, HeapTuple *rows,
+										  int numrows, double totalrows,
+										  int nworkers, int elevel,
+										  MemoryContext col_context);
+static void serialize_column_stats(VacAttrStats *stats, int colidx,
+								   StringInfo buf);
+static void restore_column_stats(VacAttrStats **vacattrstats, int attr_cnt,
+								 bool *done, char *data, Size len);
 static void compute_index_stats(Relation onerel, double totalrows,
 								AnlIndexData *indexdata, int nindexes,
 								HeapTuple *rows, int numrows,
@@ -522,6 +602,7 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 	{
 		MemoryContext col_context,
 					old_context;
+		int			nworkers;
 
 		pgstat_progress_update_param(PROGRESS_ANALYZE_PHASE,
 									 PROGRESS_ANALYZE_PHASE_COMPUTE_STATS);
@@ -531,18 +612,26 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 											ALLOCSET_DEFAULT_SIZES);
 		old_context = MemoryContextSwitchTo(col_context);
 
+		nworkers = analyze_parallel_workers(onerel, params, inh,
+											vacattrstats, attr_cnt, numrows);
+		if (nworkers == 0 ||
+			!compute_column_stats_parallel(onerel, vacattrstats, attr_cnt,
+										   rows, numrows, totalrows,
+										   nworkers, elevel, col_context))
+		{
+			for (i = 0; i < attr_cnt; i++)
+			{
+				compute_column_stats(vacattrstats[i], onerel->rd_att,
+									 rows, numrows, totalrows);
+				MemoryContextResetAndDeleteChildren(col_context);
+			}
+		}
+
 		for (i = 0; i < attr_cnt; i++)
 		{
 			VacAttrStats *stats = vacattrstats[i];
 			AttributeOpts *aopt;
 
-			stats->rows = rows;
-			stats->tupDesc = onerel->rd_att;
-			stats->compute_stats(stats,
-								 std_fetch_func,
-								 numrows,
-								 totalrows);
-
 			/*
 			 * If the appropriate flavor of the n_distinct option is
 			 * specified, override with the corresponding value.
@@ -556,8 +645,6 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 				if (n_distinct != 0.0)
 					stats->stadistinct = n_distinct;
 			}
-
-			MemoryContextResetAndDeleteChildren(col_context);
 		}
 
 		if (hasindex)
@@ -705,6 +792,527 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 	anl_context = NULL;
 }
 
+/*
+ * Compute the statistics of one column from the sample rows
+ *
+ * The calc routine stores its results in the VacAttrStats, in anl_context;
+ * anything else it allocates is left in the current memory context.
+ */
+static void
+compute_column_stats(VacAttrStats *stats, TupleDesc tupDesc,
+					 HeapTuple *rows, int numrows, double totalrows)
+{
+	stats->rows = rows;
+	stats->tupDesc = tupDesc;
+	stats->compute_stats(stats,
+						 std_fetch_func,
+						 numrows,
+						 totalrows);
+}
+
+/*
+ * Decide how many parallel workers to use to compute column statistics
+ *
+ * Returns 0 if the statistics should be computed by this backend alone.
+ * The sample rows of a temporary table may contain TOAST pointers that
+ * workers couldn't follow, and so may those of an inheritance tree, whose
+ * children can be temporary even if the parent isn't.  Nor can we use
+ * workers if some column's typanalyze function isn't parallel safe; that
+ * is what sets up its compute_stats function.
+ */
+static int
+analyze_parallel_workers(Relation onerel, VacuumParams *params, bool inh,
+						 VacAttrStats **vacattrstats, int attr_cnt,
+						 int numrows)
+{
+	int			nworkers;
+	int			i;
+
+	if (params->nworkers < 0 || max_parallel_maintenance_workers == 0 ||
+		inh || attr_cnt < 2 ||
+		onerel->rd_rel->relpersistence == RELPERSISTENCE_TEMP ||
+		IsInParallelMode())
+		return 0;
+
+	if (params->nworkers > 0)
+		nworkers = params->nworkers;
+	else
+	{
+		/* Not worth the startup cost for small samples */
+		if ((double) numrows * attr_cnt < PARALLEL_ANALYZE_MIN_VALUES)
+			return 0;
+		nworkers = attr_cnt / PARALLEL_ANALYZE_COLUMNS_PER_WORKER;
+	}
+
+	/* The leader computes statistics too */
+	nworkers = Min(nworkers, attr_cnt - 1);
+	nworkers = Min(nworkers, max_parallel_maintenance_workers);
+	if (nworkers <= 0)
+		return 0;
+
+	for (i = 0; i < attr_cnt; i++)
+	{
+		Oid			typanalyze = vacattrstats[i]->attrtype->typanalyze;
+
+		if (OidIsValid(typanalyze) &&
+			func_parallel(typanalyze) != PROPARALLEL_SAFE)
+			return 0;
+	}
+
+	return nworkers;
+}
+
+/*
+ * Compute the statistics of the columns with the help of parallel workers;
+ * see "Parallel ANALYZE" near the top of the file.
+ *
+ * Returns false, having done nothing, if no workers could be launched.  The
+ * caller should then compute the statistics itself.
+ */
+static bool
+compute_column_stats_parallel(Relation onerel, VacAttrStats **vacattrstats,
+							  int attr_cnt, HeapTuple *rows, int numrows,
+							  double totalrows, int nworkers, int elevel,
+							  MemoryContext col_context)
+{
+	ParallelContext *pcxt;
+	ParallelAnalyzeShared *shared;
+	shm_mq_handle **mqh;
+	char	   *rowspace;
+	char	   *queuespace;
+	char	   *sharedquery;
+	const char *querytext;
+	Size		sharedlen;
+	Size		rowslen;
+	Size		querylen;
+	Size		offset;
+	bool	   *done;
+	bool		leader_done;
+	MemoryContext leader_context;
+	int			nactive;
+	int			i;
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "parallel_analyze_main",
+								 nworkers);
+
+	/*
+	 * The sample rows are stored as an array of their offsets, followed by
+	 * the tuples themselves, each preceded by its length.
+	 */
+	sharedlen = add_size(offsetof(ParallelAnalyzeShared, attnums),
+						 mul_size(sizeof(AttrNumber), attr_cnt));
+	rowslen = mul_size(sizeof(Size), numrows);
+	for (i = 0; i < numrows; i++)
+		rowslen = add_size(rowslen,
+						   sizeof(Size) + MAXALIGN(rows[i]->t_len));
+	querytext = debug_query_string ? debug_query_string : "";
+	querylen = strlen(querytext) + 1;
+
+	shm_toc_estimate_chunk(&pcxt->estimator, sharedlen);
+	shm_toc_estimate_chunk(&pcxt->estimator, rowslen);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_ANALYZE_QUEUE_SIZE, pcxt->nworkers));
+	shm_toc_estimate_chunk(&pcxt->estimator, querylen);
+	shm_toc_estimate_keys(&pcxt->estimator, 4);
+
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment could be created, there's nobody to hand work to */
+	if (pcxt->nworkers == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return false;
+	}
+
+	shared = (ParallelAnalyzeShared *) shm_toc_allocate(pcxt->toc, sharedlen);
+	shared->relid = RelationGetRelid(onerel);
+	shared->numrows = numrows;
+	shared->totalrows = totalrows;
+	shared->attr_cnt = attr_cnt;
+	pg_atomic_init_u32(&shared->nextcol, 0);
+	for (i = 0; i < attr_cnt; i++)
+		shared->attnums[i] = vacattrstats[i]->tupattnum;
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_SHARED, shared);
+
+	rowspace = (char *) shm_toc_allocate(pcxt->toc, rowslen);
+	offset = mul_size(sizeof(Size), numrows);
+	for (i = 0; i < numrows; i++)
+	{
+		((Size *) rowspace)[i] = offset;
+		*((Size *) (rowspace + offset)) = rows[i]->t_len;
+		offset += sizeof(Size);
+		memcpy(rowspace + offset, rows[i]->t_data, rows[i]->t_len);
+		offset += MAXALIGN(rows[i]->t_len);
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_ROWS, rowspace);
+
+	/* One queue per worker, with us as the receiver */
+	queuespace = (char *)
+		shm_toc_allocate(pcxt->toc,
+						 mul_size(PARALLEL_ANALYZE_QUEUE_SIZE, pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_QUEUES, queuespace);
+	mqh = (shm_mq_handle **) palloc(pcxt->nworkers * sizeof(shm_mq_handle *));
+	for (i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(queuespace + i * PARALLEL_ANALYZE_QUEUE_SIZE,
+						   PARALLEL_ANALYZE_QUEUE_SIZE);
+		shm_mq_set_receiver(mq, MyProc);
+		mqh[i] = shm_mq_attach(mq, pcxt->seg, NULL);
+	}
+
+	sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen);
+	memcpy(sharedquery, querytext, querylen);
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_QUERY_TEXT, sharedquery);
+
+	LaunchParallelWorkers(pcxt);
+
+	if (pcxt->nworkers_launched == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return false;
+	}
+
+	ereport(elevel,
+			(errmsg_plural("launched %d parallel worker to compute statistics (planned: %d)",
+						   "launched %d parallel workers to compute statistics (planned: %d)",
+						   pcxt->nworkers_launched,
+						   pcxt->nworkers_launched, nworkers)));
+
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+		shm_mq_set_handle(mqh[i], pcxt->worker[i].bgwhandle);
+	for (; i < pcxt->nworkers; i++)
+		shm_mq_detach(mqh[i]);
+
+	/*
+	 * Take columns for ourselves while there are any left, and collect the
+	 * results of the workers in between, until they have all finished and
+	 * detached from their queues.  The queue handles and everything else
+	 * set up here live in col_context, so compute our columns in a child of
+	 * it that can be reset after each one.
+	 */
+	leader_context = AllocSetContextCreate(col_context,
+										   "Analyze Column (leader)",
+										   ALLOCSET_DEFAULT_SIZES);
+	done = (bool *) palloc0(attr_cnt * sizeof(bool));
+	leader_done = false;
+	nactive = pcxt->nworkers_launched;
+	while (nactive > 0 || !leader_done)
+	{
+		bool		gotresult = false;
+
+		CHECK_FOR_INTERRUPTS();
+
+		for (i = 0; i < pcxt->nworkers_launched; i++)
+		{
+			shm_mq_result res;
+			Size		nbytes;
+			void	   *data;
+
+			if (mqh[i] == NULL)
+				continue;
+
+			res = shm_mq_receive(mqh[i], &nbytes, &data, true);
+			if (res == SHM_MQ_SUCCESS)
+			{
+				restore_column_stats(vacattrstats, attr_cnt, done,
+									 data, nbytes);
+				gotresult = true;
+			}
+			else if (res == SHM_MQ_DETACHED)
+			{
+				shm_mq_detach(mqh[i]);
+				mqh[i] = NULL;
+				nactive--;
+			}
+		}
+
+		if (!leader_done)
+		{
+			uint32		colidx = pg_atomic_fetch_add_u32(&shared->nextcol, 1);
+
+			if (colidx < attr_cnt)
+			{
+				MemoryContext old_context;
+
+				old_context = MemoryContextSwitchTo(leader_context);
+				compute_column_stats(vacattrstats[colidx], onerel->rd_att,
+									 rows, numrows, totalrows);
+				MemoryContextSwitchTo(old_context);
+				MemoryContextReset(leader_context);
+				done[colidx] = true;
+			}
+			else
+				leader_done = true;
+		}
+		else if (!gotresult && nactive > 0)
+		{
+			(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, 0,
+							 WAIT_EVENT_MQ_RECEIVE);
+			ResetLatch(MyLatch);
+		}
+	}
+
+	/* This also rethrows any error a worker ran into */
+	WaitForParallelWorkersToFinish(pcxt);
+
+	for (i = 0; i < attr_cnt; i++)
+	{
+		if (!done[i])
+			elog(ERROR, "parallel ANALYZE worker did not return statistics for column %d",
+				 vacattrstats[i]->tupattnum);
+	}
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	return true;
+}
+
+/*
+ * Append the statistics of a column computed by a parallel worker to buf,
+ * in the format expected by restore_column_stats().
+ */
+static void
+serialize_column_stats(VacAttrStats *stats, int colidx, StringInfo buf)
+{
+	ParallelAnalyzeResult result;
+	int			k;
+
+	memset(&result, 0, sizeof(result));
+	result.colidx = colidx;
+	result.stats_valid = stats->stats_valid;
+	result.stanullfrac = stats->stanullfrac;
+	result.stawidth = stats->stawidth;
+	result.stadistinct = stats->stadistinct;
+	for (k = 0; k < STATISTIC_NUM_SLOTS; k++)
+	{
+		result.stakind[k] = stats->stakind[k];
+		result.staop[k] = stats->staop[k];
+		result.stacoll[k] = stats->stacoll[k];
+		result.numnumbers[k] = stats->numnumbers[k];
+		result.numvalues[k] = stats->numvalues[k];
+		result.statypid[k] = stats->statypid[k];
+		result.statyplen[k] = stats->statyplen[k];
+		result.statypbyval[k] = stats->statypbyval[k];
+		result.statypalign[k] = stats->statypalign[k];
+	}
+	appendBinaryStringInfo(buf, (char *) &result, sizeof(result));
+
+	for (k = 0; k < STATISTIC_NUM_SLOTS; k++)
+	{
+		if (stats->numnumbers[k] > 0)
+			appendBinaryStringInfo(buf, (char *) stats->stanumbers[k],
+								   stats->numnumbers[k] * sizeof(float4));
+	}
+
+	for (k = 0; k < STATISTIC_NUM_SLOTS; k++)
+	{
+		int			n;
+
+		for (n = 0; n < stats->numvalues[k]; n++)
+		{
+			Datum		value = stats->stavalues[k][n];
+			Size		len;
+			char	   *ptr;
+
+			len = datumEstimateSpace(value, false, stats->statypbyval[k],
+									 stats->statyplen[k]);
+			enlargeStringInfo(buf, len);
+			ptr = buf->data + buf->len;
+			datumSerialize(value, false, stats->statypbyval[k],
+						   stats->statyplen[k], &ptr);
+			buf->len += len;
+		}
+	}
+}
+
+/*
+ * Copy the statistics of a column sent by a parallel worker into the
+ * leader's VacAttrStats, allocating the arrays in anl_context.
+ */
+static void
+restore_column_stats(VacAttrStats **vacattrstats, int attr_cnt, bool *done,
+					 char *data, Size len)
+{
+	ParallelAnalyzeResult result;
+	VacAttrStats *stats;
+	MemoryContext old_context;
+	char	   *ptr;
+	int			k;
+
+	if (len < sizeof(result))
+		elog(ERROR, "invalid parallel ANALYZE message length %zu", len);
+	memcpy(&result, data, sizeof(result));
+	ptr = data + sizeof(result);
+
+	if (result.colidx < 0 || result.colidx >= attr_cnt ||
+		done[result.colidx])
+		elog(ERROR, "unexpected statistics for column %d from parallel ANALYZE worker",
+			 result.colidx);
+	stats = vacattrstats[result.colidx];
+	done[result.colidx] = true;
+
+	old_context = MemoryContextSwitchTo(anl_context);
+
+	stats->stats_valid = result.stats_valid;
+	stats->stanullfrac = result.stanullfrac;
+	stats->stawidth = result.stawidth;
+	stats->stadistinct = result.stadistinct;
+	for (k = 0; k < STATISTIC_NUM_SLOTS; k++)
+	{
+		stats->stakind[k] = result.stakind[k];
+		stats->staop[k] = result.staop[k];
+		stats->stacoll[k] = result.stacoll[k];
+		stats->numnumbers[k] = result.numnumbers[k];
+		stats->numvalues[k] = result.numvalues[k];
+		stats->statypid[k] = result.statypid[k];
+		stats->statyplen[k] = result.statyplen[k];
+		stats->statypbyval[k] = result.statypbyval[k];
+		stats->statypalign[k] = result.statypalign[k];
+	}
+
+	for (k = 0; k < STATISTIC_NUM_SLOTS; k++)
+	{
+		Size		nbytes = stats->numnumbers[k] * sizeof(float4);
+
+		stats->stanumbers[k] = NULL;
+		if (stats->numnumbers[k] > 0)
+		{
+			stats->stanumbers[k] = (float4 *) palloc(nbytes);
+			memcpy(stats->stanumbers[k], ptr, nbytes);
+			ptr += nbytes;
+		}
+	}
+
+	for (k = 0; k < STATISTIC_NUM_SLOTS; k++)
+	{
+		int			n;
+
+		stats->stavalues[k] = NULL;
+		if (stats->numvalues[k] > 0)
+			stats->stavalues[k] = (Datum *)
+				palloc(stats->numvalues[k] * sizeof(Datum));
+		for (n = 0; n < stats->numvalues[k]; n++)
+		{
+			bool		isnull;
+
+			stats->stavalues[k][n] = datumRestore(&ptr, &isnull);
+			Assert(!isnull);
+		}
+	}
+
+	if (ptr != data + len)
+		elog(ERROR, "invalid parallel ANALYZE message length %zu", len);
+
+	MemoryContextSwitchTo(old_context);
+}
+
+/*
+ * Main entry point for parallel ANALYZE worker processes.
+ */
+void
+parallel_analyze_main(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelAnalyzeShared *shared;
+	char	   *rowspace;
+	char	   *queuespace;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	Relation	onerel;
+	HeapTupleData *tuples;
+	HeapTuple  *rows;
+	MemoryContext worker_context;
+	StringInfoData buf;
+	int			i;
+
+	shared = (ParallelAnalyzeShared *)
+		shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_SHARED, false);
+
+	/* Set debug_query_string for individual workers */
+	debug_query_string = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_QUERY_TEXT,
+										false);
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Attach to our queue as its sender */
+	queuespace = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_QUEUES, false);
+	mq = (shm_mq *) (queuespace +
+					 ParallelWorkerNumber * PARALLEL_ANALYZE_QUEUE_SIZE);
+	shm_mq_set_sender(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	/*
+	 * Open the table.  The lock mode is the same as the leader's, which
+	 * doesn't conflict within the lock group.
+	 */
+	onerel = table_open(shared->relid, ShareUpdateExclusiveLock);
+
+	/* The sample rows are used in place, in the DSM segment */
+	rowspace = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_ROWS, false);
+	tuples = (HeapTupleData *) palloc0(shared->numrows * sizeof(HeapTupleData));
+	rows = (HeapTuple *) palloc(shared->numrows * sizeof(HeapTuple));
+	for (i = 0; i < shared->numrows; i++)
+	{
+		char	   *ptr = rowspace + ((Size *) rowspace)[i];
+
+		tuples[i].t_len = *((Size *) ptr);
+		tuples[i].t_tableOid = shared->relid;
+		ItemPointerSetInvalid(&tuples[i].t_self);
+		tuples[i].t_data = (HeapTupleHeader) (ptr + sizeof(Size));
+		rows[i] = &tuples[i];
+	}
+
+	worker_context = CurrentMemoryContext;
+	initStringInfo(&buf);
+
+	for (;;)
+	{
+		uint32		colidx = pg_atomic_fetch_add_u32(&shared->nextcol, 1);
+		VacAttrStats *stats;
+		MemoryContext col_context;
+		shm_mq_result res;
+
+		if (colidx >= shared->attr_cnt)
+			break;
+
+		/* Everything for one column goes away once its results are sent */
+		anl_context = AllocSetContextCreate(worker_context,
+											"Analyze",
+											ALLOCSET_DEFAULT_SIZES);
+		col_context = AllocSetContextCreate(anl_context,
+											"Analyze Column",
+											ALLOCSET_DEFAULT_SIZES);
+
+		MemoryContextSwitchTo(anl_context);
+		stats = examine_attribute(onerel, shared->attnums[colidx], NULL);
+		if (stats == NULL)
+			elog(ERROR, "column %d of relation %u cannot be analyzed",
+				 shared->attnums[colidx], shared->relid);
+
+		MemoryContextSwitchTo(col_context);
+		compute_column_stats(stats, onerel->rd_att, rows, shared->numrows,
+							 shared->totalrows);
+
+		MemoryContextSwitchTo(worker_context);
+		resetStringInfo(&buf);
+		serialize_column_stats(stats, colidx, &buf);
+		res = shm_mq_send(mqh, buf.len, buf.data, false, true);
+
+		/* The leader only detaches when it's bailing out */
+		if (res != SHM_MQ_SUCCESS)
+			elog(ERROR, "parallel ANALYZE leader exited unexpectedly");
+
+		MemoryContextDelete(anl_context);
+		anl_context = NULL;
+	}
+
+	table_close(onerel, ShareUpdateExclusiveLock);
+}
+
 /*
  * Compute statistics about indexes of a relation
  */
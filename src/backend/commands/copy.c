@@ -17,21 +17,34 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 
+#include "access/genam.h"
 #include "access/heapam.h"
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/sysattr.h"
 #include "access/tableam.h"
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/dependency.h"
 #include "catalog/pg_authid.h"
+#include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "commands/copy.h"
 #include "commands/defrem.h"
 #include "commands/trigger.h"
 #include "executor/execPartition.h"
 #include "executor/executor.h"
+#include "executor/instrument.h"
 #include "executor/nodeModifyTable.h"
 #include "executor/tuptable.h"
 #include "foreign/fdwapi.h"
@@ -40,17 +53,25 @@
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
 #include "optimizer/optimizer.h"
 #include "parser/parse_coerce.h"
 #include "parser/parse_collate.h"
 #include "parser/parse_expr.h"
 #include "parser/parse_relation.h"
+#include "pgstat.h"
+#include "port/pg_bitutils.h"
 #include "port/pg_bswap.h"
+#include "port/simd.h"
+#include "postmaster/bgworker_internals.h"
 #include "rewrite/rewriteHandler.h"
 #include "storage/fd.h"
+#include "storage/shm_mq.h"
 #include "tcop/tcopprot.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/date.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/partcache.h"
@@ -58,6 +79,8 @@
 #include "utils/rel.h"
 #include "utils/rls.h"
 #include "utils/snapmgr.h"
+#include "utils/timestamp.h"
+#include "utils/uuid.h"
 
 #define ISOCTAL(c) (((c) >= '0') && ((c) <= '7'))
 #define OCTVALUE(c) ((c) - '0')
@@ -71,7 +94,8 @@ typedef enum CopyDest
 	COPY_FILE,					/* to/from file (or a piped program) */
 	COPY_OLD_FE,				/* to/from frontend (2.0 protocol) */
 	COPY_NEW_FE,				/* to/from frontend (3.0 protocol) */
-	COPY_CALLBACK				/* to/from callback function */
+	COPY_CALLBACK,				/* to/from callback function */
+	COPY_PARALLEL_LEADER		/* to the leader of a parallel COPY TO */
 } CopyDest;
 
 /*
@@ -85,6 +109,17 @@ typedef enum EolType
 	EOL_CRNL
 } EolType;
 
+/*
+ * Compression applied to the data as it is sent or received
+ */
+typedef enum CopyCompression
+{
+	COPY_COMPRESSION_NONE,
+	COPY_COMPRESSION_GZIP,
+	COPY_COMPRESSION_LZ4,
+	COPY_COMPRESSION_ZSTD
+} CopyCompression;
+
 /*
  * Represents the heap insert method to be used during COPY FROM.
  */
@@ -95,6 +130,43 @@ typedef enum CopyInsertMethod
 	CIM_MULTI_CONDITIONAL		/* use table_multi_insert only if valid */
 } CopyInsertMethod;
 
+/*
+ * Built-in fixed-width types whose binary COPY representation we convert
+ * ourselves, rather than calling the type's receive or send function for
+ * every field.  See CopyGetBinaryType.
+ */
+typedef enum CopyBinaryType
+{
+	COPY_BINARY_GENERIC = 0,	/* use the receive/send function */
+	COPY_BINARY_BOOL,
+	COPY_BINARY_INT2,
+	COPY_BINARY_INT4,
+	COPY_BINARY_OID,
+	COPY_BINARY_INT8,
+	COPY_BINARY_FLOAT4,
+	COPY_BINARY_FLOAT8,
+	COPY_BINARY_DATE,
+	COPY_BINARY_TIMESTAMP,		/* timestamp and timestamptz */
+	COPY_BINARY_UUID
+} CopyBinaryType;
+
+/* Size of each CopyBinaryType on the wire */
+static const int CopyBinaryTypeSize[] = {
+	0,							/* COPY_BINARY_GENERIC */
+	1,							/* COPY_BINARY_BOOL */
+	sizeof(int16),				/* COPY_BINARY_INT2 */
+	sizeof(int32),				/* COPY_BINARY_INT4 */
+	sizeof(Oid),				/* COPY_BINARY_OID */
+	sizeof(int64),				/* COPY_BINARY_INT8 */
+	sizeof(float4),				/* COPY_BINARY_FLOAT4 */
+	sizeof(float8),				/* COPY_BINARY_FLOAT8 */
+	sizeof(DateADT),			/* COPY_BINARY_DATE */
+	sizeof(Timestamp),			/* COPY_BINARY_TIMESTAMP */
+	UUID_LEN					/* COPY_BINARY_UUID */
+};
+
+#define MAX_COPY_BINARY_TYPE_SIZE	UUID_LEN
+
 /*
  * This struct contains all the state variables used throughout a COPY
  * operation. For simplicity, we use the same struct for all variants of COPY,
@@ -154,6 +226,9 @@ typedef struct CopyStateData
 	List	   *convert_select; /* list of column names (can be NIL) */
 	bool	   *convert_select_flags;	/* per-column CSV/TEXT CS flags */
 	Node	   *whereClause;	/* WHERE condition (or NULL) */
+	int			nworkers;		/* PARALLEL option, 0 if not given */
+	List	   *options;		/* COPY TO options, for parallel workers */
+	CopyCompression compression;	/* COMPRESSION option */
 
 	/* these are just for error messages, see CopyFromErrorCallback */
 	const char *cur_relname;	/* table name for error messages */
@@ -170,6 +245,8 @@ typedef struct CopyStateData
 	 * Working state for COPY TO
 	 */
 	FmgrInfo   *out_functions;	/* lookup info for output functions */
+	CopyBinaryType *binary_types;	/* per-attribute conversion in binary
+									 * mode, for both TO and FROM */
 	MemoryContext rowcontext;	/* per-row evaluation context */
 
 	/*
@@ -216,6 +293,51 @@ typedef struct CopyStateData
 	bool		line_buf_converted; /* converted to server encoding? */
 	bool		line_buf_valid; /* contains the row being processed? */
 
+	/*
+	 * In a parallel COPY FROM worker, lines arrive already split and
+	 * converted to server encoding, in batches sent by the leader through
+	 * pcopy_mqh.  pcopy_batch points to the current batch, which is valid
+	 * until the next message is received; see ParallelCopyReadLine.
+	 */
+	shm_mq_handle *pcopy_mqh;	/* NULL if not a parallel COPY worker */
+	char	   *pcopy_batch;	/* current batch of lines */
+	Size		pcopy_batch_len;	/* total # of bytes in batch */
+	Size		pcopy_batch_off;	/* next byte to process */
+
+	/*
+	 * A parallel COPY TO worker instead sends the rows it formats to the
+	 * leader through pcopy_mqh, with copy_dest set to COPY_PARALLEL_LEADER,
+	 * and scans its share of the table using pcopy_pscan.
+	 */
+	ParallelTableScanDesc pcopy_pscan;	/* NULL if not a parallel COPY TO
+										 * worker */
+	bool		pcopy_crlf;		/* end text rows with \r\n, not \n */
+
+	/*
+	 * With compression, data passes through the compressor of the chosen
+	 * method on its way between fe_msgbuf or raw_buf and the destination or
+	 * source, with zbuf holding the compressed side.  When reading, the
+	 * bytes of zbuf from zbuf_index up to zbuf_len are yet to be
+	 * decompressed.  See CopyCompressOutput and CopyReadCompressed.
+	 */
+#define COPY_ZBUF_SIZE 65536
+	char	   *zbuf;			/* NULL until first used */
+	int			zbuf_size;
+	int			zbuf_index;
+	int			zbuf_len;
+	bool		zstream_end;	/* at end of a gzip member or frame? */
+#ifdef HAVE_LIBZ
+	z_stream   *zstream;
+#endif
+#ifdef USE_LZ4
+	LZ4F_cctx  *lz4_cctx;
+	LZ4F_dctx  *lz4_dctx;
+#endif
+#ifdef USE_ZSTD
+	ZSTD_CStream *zstd_cstream;
+	ZSTD_DStream *zstd_dstream;
+#endif
+
 	/*
 	 * Finally, raw_buf holds raw data read from the data source (file or
 	 * client connection).  In text mode, CopyReadLine parses this data
@@ -230,8 +352,86 @@ typedef struct CopyStateData
 	int			raw_buf_len;	/* total # of bytes stored */
 	/* Shorthand for number of unconsumed bytes available in raw_buf */
 #define RAW_BUF_BYTES(cstate) ((cstate)->raw_buf_len - (cstate)->raw_buf_index)
+
+	/*
+	 * When reading only part of a file, see CopyFromSetRange, range_end is
+	 * the offset at which that part ends, and raw_file_pos is the offset of
+	 * raw_buf[raw_buf_len] in the file.  range_end is -1 otherwise.
+	 */
+	off_t		range_end;
+	off_t		raw_file_pos;
+	bool		range_header;	/* header_line, as given in the options */
 } CopyStateData;
 
+/*
+ * Parallel COPY FROM.
+ *
+ * The leader reads the input and splits it into lines with CopyReadLine,
+ * which takes care of encoding conversion, CSV quoting and the end-of-data
+ * marker, none of which can be done on an arbitrary chunk of the input.  It
+ * packs the lines into batches of roughly PARALLEL_COPY_BATCH_SIZE bytes and
+ * hands each batch to a worker through that worker's shm_mq.  The workers
+ * run the ordinary CopyFrom loop on the lines they receive, so they do all
+ * the field parsing, input function calls, default and constraint
+ * evaluation, and multi-inserts into the table and its indexes.
+ *
+ * Each line is sent as its line number, its length and then its bytes, so
+ * that errors raised in a worker can still report the line they come from.
+ */
+#define PARALLEL_COPY_KEY_SHARED		1
+#define PARALLEL_COPY_KEY_NODES			2
+#define PARALLEL_COPY_KEY_QUEUES		3
+#define PARALLEL_COPY_KEY_QUERY_TEXT	4
+#define PARALLEL_COPY_KEY_BUFFER_USAGE	5
+#define PARALLEL_COPY_KEY_WAL_USAGE		6
+
+#define PARALLEL_COPY_QUEUE_SIZE		(256 * 1024)
+#define PARALLEL_COPY_BATCH_SIZE		RAW_BUF_SIZE
+
+/* Shared state for parallel COPY FROM, in the DSM segment */
+typedef struct ParallelCopyShared
+{
+	Oid			relid;			/* target table */
+	pg_atomic_uint64 processed; /* # of tuples inserted by all workers */
+} ParallelCopyShared;
+
+/*
+ * Parallel COPY TO.
+ *
+ * The workers scan the table with a parallel scan, and format the rows into
+ * chunks of roughly PARALLEL_COPY_BATCH_SIZE bytes, which they send to the
+ * leader through their own shm_mq.  All the leader does is write out each
+ * chunk as it arrives, with the header and trailer around them, so the rows
+ * come out in no particular order.  Since any COPY TO output may be split
+ * at row boundaries, including into CopyData messages, that works for every
+ * destination and format.
+ */
+#define PARALLEL_COPY_TO_KEY_SHARED		1
+#define PARALLEL_COPY_TO_KEY_NODES		2
+#define PARALLEL_COPY_TO_KEY_SCAN		3
+#define PARALLEL_COPY_TO_KEY_QUEUES		4
+#define PARALLEL_COPY_TO_KEY_QUERY_TEXT	5
+#define PARALLEL_COPY_TO_KEY_BUFFER_USAGE	6
+#define PARALLEL_COPY_TO_KEY_WAL_USAGE	7
+
+/* Shared state for parallel COPY TO, in the DSM segment */
+typedef struct ParallelCopyToShared
+{
+	Oid			relid;			/* source table */
+	bool		crlf;			/* see pcopy_crlf */
+	pg_atomic_uint64 processed; /* # of rows sent by all workers */
+} ParallelCopyToShared;
+
+/* The leader's end of a parallel COPY FROM */
+typedef struct ParallelCopyLeader
+{
+	ParallelContext *pcxt;
+	int			nqueues;		/* # of workers launched */
+	shm_mq_handle **mqh;		/* queue to each worker */
+	StringInfoData *pending;	/* batch not yet fully sent, per queue */
+	int			next_queue;		/* where to start looking for a free queue */
+} ParallelCopyLeader;
+
 /* DestReceiver for COPY (query) TO */
 typedef struct
 {
@@ -370,13 +570,22 @@ static void EndCopyTo(CopyState cstate);
 static uint64 DoCopyTo(CopyState cstate);
 static uint64 CopyTo(CopyState cstate);
 static void CopyOneRowTo(CopyState cstate, TupleTableSlot *slot);
+static bool ParallelCopyTo(CopyState cstate, uint64 *processed);
+static void ParallelCopyToSend(CopyState cstate, const char *data, int len);
 static bool CopyReadLine(CopyState cstate);
 static bool CopyReadLineText(CopyState cstate);
+static inline int CopySkipPlainBytes(const char *s, int len, char c1, char c2,
+									 char c3, char c4, bool highbit);
 static int	CopyReadAttributesText(CopyState cstate);
 static int	CopyReadAttributesCSV(CopyState cstate);
+static CopyBinaryType CopyGetBinaryType(Oid func_oid, int32 typmod);
+static bool CopyBinaryToDatum(CopyBinaryType btype, const char *buf,
+							  Datum *result);
+static void CopySendBinaryDatum(CopyState cstate, CopyBinaryType btype,
+								Datum value);
 static Datum CopyReadBinaryAttribute(CopyState cstate, FmgrInfo *flinfo,
 									 Oid typioparam, int32 typmod,
-									 bool *isnull);
+									 CopyBinaryType btype, bool *isnull);
 static void CopyAttributeOutText(CopyState cstate, char *string);
 static void CopyAttributeOutCSV(CopyState cstate, char *string,
 								bool use_quote, bool single_attr);
@@ -392,14 +601,43 @@ static void CopySendData(CopyState cstate, const void *databuf, int datasize);
 static void CopySendString(CopyState cstate, const char *str);
 static void CopySendChar(CopyState cstate, char c);
 static void CopySendEndOfRow(CopyState cstate);
+static void CopyFlushOutput(CopyState cstate);
+static void CopyWriteOutput(CopyState cstate, const char *data, int len);
 static int	CopyGetData(CopyState cstate, void *databuf,
 						int minread, int maxread);
 static void CopySendInt32(CopyState cstate, int32 val);
 static bool CopyGetInt32(CopyState cstate, int32 *val);
 static void CopySendInt16(CopyState cstate, int16 val);
 static bool CopyGetInt16(CopyState cstate, int16 *val);
+static void CopyInitCompression(CopyState cstate);
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+static void CopyRegisterFreeCompression(CopyState cstate);
+static void CopyFreeCompression(void *arg);
+#endif
+static void CopyCompressOutput(CopyState cstate, const char *data, int len,
+							   bool finish);
+static int	CopyReadCompressed(CopyState cstate, char *databuf,
+							   int minread, int maxread);
+#ifdef HAVE_LIBZ
+static voidpf copy_zalloc(voidpf opaque, uInt items, uInt size);
+static void copy_zfree(voidpf opaque, voidpf address);
+#endif
 static bool CopyLoadRawBuf(CopyState cstate);
 static int	CopyReadBinaryData(CopyState cstate, char *dest, int nbytes);
+static off_t CopyFindLineStart(CopyState cstate, off_t offset);
+
+static bool ParallelCopyFrom(CopyState cstate, const CopyStmt *stmt,
+							 uint64 *processed);
+static bool CopyFromParallelSafe(CopyState cstate);
+static bool CopyExprParallelUnsafe(Node *node);
+static bool copy_parallel_unsafe_checker(Oid func_id, void *context);
+static bool copy_parallel_unsafe_walker(Node *node, void *context);
+static bool ParallelCopySendPending(ParallelCopyLeader *leader, int i,
+									bool nowait);
+static void ParallelCopySendBatch(ParallelCopyLeader *leader,
+								  StringInfo batch);
+static bool ParallelCopyReadLine(CopyState cstate);
+static int	ParallelCopyNoData(void *outbuf, int minread, int maxread);
 
 
 /*
@@ -415,10 +653,14 @@ SendCopyBegin(CopyState cstate)
 		StringInfoData buf;
 		int			natts = list_length(cstate->attnumlist);
 		int16		format = (cstate->binary ? 1 : 0);
+		int16		overall_format;
 		int			i;
 
 		pq_beginmessage(&buf, 'H');
-		pq_sendbyte(&buf, format);	/* overall format */
+		/* compressed data has to be passed through as is, too */
+		overall_format = (cstate->compression != COPY_COMPRESSION_NONE) ?
+			1 : format;
+		pq_sendbyte(&buf, overall_format);	/* overall format */
 		pq_sendint16(&buf, natts);
 		for (i = 0; i < natts; i++)
 			pq_sendint16(&buf, format); /* per-column formats */
@@ -432,6 +674,10 @@ SendCopyBegin(CopyState cstate)
 			ereport(ERROR,
 					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 					 errmsg("COPY BINARY is not supported to stdout or from stdin")));
+		if (cstate->compression != COPY_COMPRESSION_NONE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("COPY COMPRESSION is not supported to stdout or from stdin")));
 		pq_putemptymessage('H');
 		/* grottiness needed for old COPY OUT protocol */
 		pq_startcopyout();
@@ -448,10 +694,14 @@ ReceiveCopyBegin(CopyState cstate)
 		StringInfoData buf;
 		int			natts = list_length(cstate->attnumlist);
 		int16		format = (cstate->binary ? 1 : 0);
+		int16		overall_format;
 		int			i;
 
 		pq_beginmessage(&buf, 'G');
-		pq_sendbyte(&buf, format);	/* overall format */
+		/* compressed data has to be passed through as is, too */
+		overall_format = (cstate->compression != COPY_COMPRESSION_NONE) ?
+			1 : format;
+		pq_sendbyte(&buf, overall_format);	/* overall format */
 		pq_sendint16(&buf, natts);
 		for (i = 0; i < natts; i++)
 			pq_sendint16(&buf, format); /* per-column formats */
@@ -466,6 +716,10 @@ ReceiveCopyBegin(CopyState cstate)
 			ereport(ERROR,
 					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 					 errmsg("COPY BINARY is not supported to stdout or from stdin")));
+		if (cstate->compression != COPY_COMPRESSION_NONE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("COPY COMPRESSION is not supported to stdout or from stdin")));
 		pq_putemptymessage('G');
 		/* any error in old protocol will make us lose sync */
 		pq_startmsgread();
@@ -525,8 +779,6 @@ CopySendChar(CopyState cstate, char c)
 static void
 CopySendEndOfRow(CopyState cstate)
 {
-	StringInfo	fe_msgbuf = cstate->fe_msgbuf;
-
 	switch (cstate->copy_dest)
 	{
 		case COPY_FILE:
@@ -539,9 +791,61 @@ CopySendEndOfRow(CopyState cstate)
 				CopySendString(cstate, "\r\n");
 #endif
 			}
+			break;
+		case COPY_OLD_FE:
+		case COPY_NEW_FE:
+			/* The FE/BE protocol uses \n as newline for all platforms */
+			if (!cstate->binary)
+				CopySendChar(cstate, '\n');
+			break;
+		case COPY_CALLBACK:
+			Assert(false);		/* Not yet supported. */
+			break;
+		case COPY_PARALLEL_LEADER:
+			/* End the row the way the leader's destination would */
+			if (!cstate->binary)
+			{
+				if (cstate->pcopy_crlf)
+					CopySendChar(cstate, '\r');
+				CopySendChar(cstate, '\n');
+			}
+
+			/* Let rows accumulate into a chunk for the leader */
+			if (cstate->fe_msgbuf->len < PARALLEL_COPY_BATCH_SIZE)
+				return;
+			break;
+	}
 
-			if (fwrite(fe_msgbuf->data, fe_msgbuf->len, 1,
-					   cstate->copy_file) != 1 ||
+	CopyFlushOutput(cstate);
+}
+
+/*
+ * Write out whatever has been accumulated in fe_msgbuf, compressing it
+ * first if requested.
+ */
+static void
+CopyFlushOutput(CopyState cstate)
+{
+	StringInfo	fe_msgbuf = cstate->fe_msgbuf;
+
+	if (cstate->compression != COPY_COMPRESSION_NONE)
+		CopyCompressOutput(cstate, fe_msgbuf->data, fe_msgbuf->len, false);
+	else
+		CopyWriteOutput(cstate, fe_msgbuf->data, fe_msgbuf->len);
+
+	resetStringInfo(fe_msgbuf);
+}
+
+/*
+ * Write data to the destination, as is.
+ */
+static void
+CopyWriteOutput(CopyState cstate, const char *data, int len)
+{
+	switch (cstate->copy_dest)
+	{
+		case COPY_FILE:
+			if (fwrite(data, len, 1, cstate->copy_file) != 1 ||
 				ferror(cstate->copy_file))
 			{
 				if (cstate->is_program)
@@ -574,11 +878,7 @@ CopySendEndOfRow(CopyState cstate)
 			}
 			break;
 		case COPY_OLD_FE:
-			/* The FE/BE protocol uses \n as newline for all platforms */
-			if (!cstate->binary)
-				CopySendChar(cstate, '\n');
-
-			if (pq_putbytes(fe_msgbuf->data, fe_msgbuf->len))
+			if (pq_putbytes(data, len))
 			{
 				/* no hope of recovering connection sync, so FATAL */
 				ereport(FATAL,
@@ -587,19 +887,16 @@ CopySendEndOfRow(CopyState cstate)
 			}
 			break;
 		case COPY_NEW_FE:
-			/* The FE/BE protocol uses \n as newline for all platforms */
-			if (!cstate->binary)
-				CopySendChar(cstate, '\n');
-
-			/* Dump the accumulated row as one CopyData message */
-			(void) pq_putmessage('d', fe_msgbuf->data, fe_msgbuf->len);
+			/* Dump the accumulated row(s) as one CopyData message */
+			(void) pq_putmessage('d', data, len);
 			break;
 		case COPY_CALLBACK:
 			Assert(false);		/* Not yet supported. */
 			break;
+		case COPY_PARALLEL_LEADER:
+			ParallelCopyToSend(cstate, data, len);
+			break;
 	}
-
-	resetStringInfo(fe_msgbuf);
 }
 
 /*
@@ -716,6 +1013,9 @@ CopyGetData(CopyState cstate, void *databuf, int minread, int maxread)
 		case COPY_CALLBACK:
 			bytesread = cstate->data_source_cb(databuf, minread, maxread);
 			break;
+		case COPY_PARALLEL_LEADER:
+			Assert(false);		/* only used for COPY TO */
+			break;
 	}
 
 	return bytesread;
@@ -787,6 +1087,384 @@ CopyGetInt16(CopyState cstate, int16 *val)
 }
 
 
+/*
+ * Set up the compressor (for COPY TO) or decompressor (COPY FROM) of the
+ * chosen method, and zbuf to go with it.  gzip decompression also accepts
+ * zlib framing.
+ *
+ * All of zlib's memory comes out of copycontext, so there's no need to
+ * call deflateEnd or inflateEnd, even on error.  LZ4 and Zstandard
+ * allocate with malloc, so their state is freed by CopyFreeCompression
+ * when copycontext goes away.
+ */
+static void
+CopyInitCompression(CopyState cstate)
+{
+	cstate->zbuf_size = COPY_ZBUF_SIZE;
+
+	switch (cstate->compression)
+	{
+#ifdef HAVE_LIBZ
+		case COPY_COMPRESSION_GZIP:
+			{
+				z_stream   *zs;
+				int			rc;
+
+				zs = (z_stream *) MemoryContextAllocZero(cstate->copycontext,
+														 sizeof(z_stream));
+				zs->zalloc = copy_zalloc;
+				zs->zfree = copy_zfree;
+				zs->opaque = (voidpf) cstate->copycontext;
+
+				if (cstate->is_copy_from)
+					rc = inflateInit2(zs, 15 + 32);
+				else
+					rc = deflateInit2(zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+									  15 + 16, 8, Z_DEFAULT_STRATEGY);
+				if (rc != Z_OK)
+					elog(ERROR, "could not initialize compression library: %s",
+						 zs->msg ? zs->msg : "unknown error");
+				cstate->zstream = zs;
+				break;
+			}
+#endif
+#ifdef USE_LZ4
+		case COPY_COMPRESSION_LZ4:
+			{
+				LZ4F_errorCode_t rc;
+
+				CopyRegisterFreeCompression(cstate);
+				if (cstate->is_copy_from)
+					rc = LZ4F_createDecompressionContext(&cstate->lz4_dctx,
+														 LZ4F_VERSION);
+				else
+				{
+					rc = LZ4F_createCompressionContext(&cstate->lz4_cctx,
+													   LZ4F_VERSION);
+					/* big enough for the output of COPY_ZBUF_SIZE input */
+					cstate->zbuf_size = LZ4F_compressBound(COPY_ZBUF_SIZE, NULL);
+				}
+				if (LZ4F_isError(rc))
+					elog(ERROR, "could not initialize compression library: %s",
+						 LZ4F_getErrorName(rc));
+				break;
+			}
+#endif
+#ifdef USE_ZSTD
+		case COPY_COMPRESSION_ZSTD:
+			CopyRegisterFreeCompression(cstate);
+			if (cstate->is_copy_from)
+				cstate->zstd_dstream = ZSTD_createDStream();
+			else
+				cstate->zstd_cstream = ZSTD_createCStream();
+			if (cstate->zstd_dstream == NULL && cstate->zstd_cstream == NULL)
+				elog(ERROR, "could not initialize compression library");
+			break;
+#endif
+		default:
+			elog(ERROR, "unrecognized COPY compression method: %d",
+				 (int) cstate->compression);
+	}
+
+	cstate->zbuf = MemoryContextAlloc(cstate->copycontext, cstate->zbuf_size);
+}
+
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+/*
+ * Arrange for CopyFreeCompression to be called when copycontext is reset or
+ * deleted, which also happens on error.
+ */
+static void
+CopyRegisterFreeCompression(CopyState cstate)
+{
+	MemoryContextCallback *cb;
+
+	cb = MemoryContextAlloc(cstate->copycontext, sizeof(MemoryContextCallback));
+	cb->func = CopyFreeCompression;
+	cb->arg = cstate;
+	MemoryContextRegisterResetCallback(cstate->copycontext, cb);
+}
+
+/*
+ * Release the malloc'd state of the LZ4 or Zstandard (de)compressor.
+ */
+static void
+CopyFreeCompression(void *arg)
+{
+	CopyState	cstate = (CopyState) arg;
+
+#ifdef USE_LZ4
+	if (cstate->lz4_cctx)
+		LZ4F_freeCompressionContext(cstate->lz4_cctx);
+	if (cstate->lz4_dctx)
+		LZ4F_freeDecompressionContext(cstate->lz4_dctx);
+	cstate->lz4_cctx = NULL;
+	cstate->lz4_dctx = NULL;
+#endif
+#ifdef USE_ZSTD
+	ZSTD_freeCStream(cstate->zstd_cstream);
+	ZSTD_freeDStream(cstate->zstd_dstream);
+	cstate->zstd_cstream = NULL;
+	cstate->zstd_dstream = NULL;
+#endif
+}
+#endif							/* USE_LZ4 || USE_ZSTD */
+
+/*
+ * Compress data and write whatever the compressor produces to the
+ * destination.  With 'finish', this also ends the compressed stream.
+ */
+static void
+CopyCompressOutput(CopyState cstate, const char *data, int len, bool finish)
+{
+	if (cstate->zbuf == NULL)
+	{
+		CopyInitCompression(cstate);
+
+#ifdef USE_LZ4
+		/* an LZ4 frame starts with a header of its own */
+		if (cstate->compression == COPY_COMPRESSION_LZ4)
+		{
+			size_t		outlen;
+
+			outlen = LZ4F_compressBegin(cstate->lz4_cctx, cstate->zbuf,
+										cstate->zbuf_size, NULL);
+			if (LZ4F_isError(outlen))
+				elog(ERROR, "could not compress COPY data: %s",
+					 LZ4F_getErrorName(outlen));
+			CopyWriteOutput(cstate, cstate->zbuf, outlen);
+		}
+#endif
+	}
+
+	switch (cstate->compression)
+	{
+#ifdef HAVE_LIBZ
+		case COPY_COMPRESSION_GZIP:
+			{
+				z_stream   *zs = cstate->zstream;
+				int			rc;
+
+				zs->next_in = (Bytef *) data;
+				zs->avail_in = len;
+				do
+				{
+					zs->next_out = (Bytef *) cstate->zbuf;
+					zs->avail_out = cstate->zbuf_size;
+
+					rc = deflate(zs, finish ? Z_FINISH : Z_NO_FLUSH);
+					if (rc == Z_STREAM_ERROR)
+						elog(ERROR, "could not compress COPY data: %s",
+							 zs->msg ? zs->msg : "unknown error");
+
+					if (zs->avail_out < cstate->zbuf_size)
+						CopyWriteOutput(cstate, cstate->zbuf,
+										cstate->zbuf_size - zs->avail_out);
+				} while (zs->avail_out == 0 || (finish && rc != Z_STREAM_END));
+				break;
+			}
+#endif
+#ifdef USE_LZ4
+		case COPY_COMPRESSION_LZ4:
+			{
+				size_t		outlen;
+
+				/* zbuf only has room for the output of so much input */
+				while (len > 0)
+				{
+					int			chunk = Min(len, COPY_ZBUF_SIZE);
+
+					outlen = LZ4F_compressUpdate(cstate->lz4_cctx,
+												 cstate->zbuf, cstate->zbuf_size,
+												 data, chunk, NULL);
+					if (LZ4F_isError(outlen))
+						elog(ERROR, "could not compress COPY data: %s",
+							 LZ4F_getErrorName(outlen));
+					if (outlen > 0)
+						CopyWriteOutput(cstate, cstate->zbuf, outlen);
+					data += chunk;
+					len -= chunk;
+				}
+
+				if (finish)
+				{
+					outlen = LZ4F_compressEnd(cstate->lz4_cctx, cstate->zbuf,
+											  cstate->zbuf_size, NULL);
+					if (LZ4F_isError(outlen))
+						elog(ERROR, "could not compress COPY data: %s",
+							 LZ4F_getErrorName(outlen));
+					CopyWriteOutput(cstate, cstate->zbuf, outlen);
+				}
+				break;
+			}
+#endif
+#ifdef USE_ZSTD
+		case COPY_COMPRESSION_ZSTD:
+			{
+				ZSTD_inBuffer input = {data, len, 0};
+				size_t		remaining;
+
+				do
+				{
+					ZSTD_outBuffer output = {cstate->zbuf, cstate->zbuf_size, 0};
+
+					remaining = ZSTD_compressStream2(cstate->zstd_cstream,
+													 &output, &input,
+													 finish ? ZSTD_e_end : ZSTD_e_continue);
+					if (ZSTD_isError(remaining))
+						elog(ERROR, "could not compress COPY data: %s",
+							 ZSTD_getErrorName(remaining));
+
+					if (output.pos > 0)
+						CopyWriteOutput(cstate, cstate->zbuf, output.pos);
+				} while (input.pos < input.size || (finish && remaining > 0));
+				break;
+			}
+#endif
+		default:
+			elog(ERROR, "unrecognized COPY compression method: %d",
+				 (int) cstate->compression);
+	}
+}
+
+/*
+ * Like CopyGetData, but decompresses the data read from the source.
+ *
+ * Several gzip members or LZ4 or Zstandard frames in a row, as produced by
+ * concatenating compressed files, are read as one stream.
+ */
+static int
+CopyReadCompressed(CopyState cstate, char *databuf, int minread, int maxread)
+{
+	int			bytesread = 0;
+
+	if (cstate->zbuf == NULL)
+		CopyInitCompression(cstate);
+
+	while (bytesread < minread)
+	{
+		char	   *in;
+		char	   *out = databuf + bytesread;
+		size_t		inlen;
+		size_t		outlen = maxread - bytesread;
+
+		if (cstate->zbuf_index >= cstate->zbuf_len)
+		{
+			int			nread;
+
+			nread = CopyGetData(cstate, cstate->zbuf, 1, cstate->zbuf_size);
+			if (nread == 0)
+			{
+				if (!cstate->zstream_end)
+					ereport(ERROR,
+							(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+							 errmsg("unexpected end of compressed COPY data")));
+				break;
+			}
+			cstate->zbuf_index = 0;
+			cstate->zbuf_len = nread;
+		}
+		in = cstate->zbuf + cstate->zbuf_index;
+		inlen = cstate->zbuf_len - cstate->zbuf_index;
+
+		/* Each case sets inlen and outlen to the bytes consumed and produced */
+		switch (cstate->compression)
+		{
+#ifdef HAVE_LIBZ
+			case COPY_COMPRESSION_GZIP:
+				{
+					z_stream   *zs = cstate->zstream;
+					int			rc;
+
+					/* more input after the end of a member starts another one */
+					if (cstate->zstream_end)
+					{
+						if (inflateReset(zs) != Z_OK)
+							elog(ERROR, "could not reset decompression state");
+						cstate->zstream_end = false;
+					}
+
+					zs->next_in = (Bytef *) in;
+					zs->avail_in = inlen;
+					zs->next_out = (Bytef *) out;
+					zs->avail_out = outlen;
+					rc = inflate(zs, Z_NO_FLUSH);
+					if (rc == Z_STREAM_END)
+						cstate->zstream_end = true;
+					else if (rc != Z_OK && rc != Z_BUF_ERROR)
+						ereport(ERROR,
+								(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+								 errmsg("could not decompress COPY data: %s",
+										zs->msg ? zs->msg : "unknown error")));
+					inlen -= zs->avail_in;
+					outlen -= zs->avail_out;
+					break;
+				}
+#endif
+#ifdef USE_LZ4
+			case COPY_COMPRESSION_LZ4:
+				{
+					size_t		rc;
+
+					rc = LZ4F_decompress(cstate->lz4_dctx, out, &outlen,
+										 in, &inlen, NULL);
+					if (LZ4F_isError(rc))
+						ereport(ERROR,
+								(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+								 errmsg("could not decompress COPY data: %s",
+										LZ4F_getErrorName(rc))));
+					/* zero means the frame is done; more input starts another */
+					cstate->zstream_end = (rc == 0);
+					break;
+				}
+#endif
+#ifdef USE_ZSTD
+			case COPY_COMPRESSION_ZSTD:
+				{
+					ZSTD_inBuffer input = {in, inlen, 0};
+					ZSTD_outBuffer output = {out, outlen, 0};
+					size_t		rc;
+
+					rc = ZSTD_decompressStream(cstate->zstd_dstream,
+											   &output, &input);
+					if (ZSTD_isError(rc))
+						ereport(ERROR,
+								(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+								 errmsg("could not decompress COPY data: %s",
+										ZSTD_getErrorName(rc))));
+					/* zero means the frame is done; more input starts another */
+					cstate->zstream_end = (rc == 0);
+					inlen = input.pos;
+					outlen = output.pos;
+					break;
+				}
+#endif
+			default:
+				elog(ERROR, "unrecognized COPY compression method: %d",
+					 (int) cstate->compression);
+		}
+
+		cstate->zbuf_index += inlen;
+		bytesread += outlen;
+	}
+
+	return bytesread;
+}
+
+#ifdef HAVE_LIBZ
+static voidpf
+copy_zalloc(voidpf opaque, uInt items, uInt size)
+{
+	return MemoryContextAlloc((MemoryContext) opaque, (Size) items * size);
+}
+
+static void
+copy_zfree(voidpf opaque, voidpf address)
+{
+	pfree(address);
+}
+#endif							/* HAVE_LIBZ */
+
 /*
  * CopyLoadRawBuf loads some more data into raw_buf
  *
@@ -807,12 +1485,17 @@ CopyLoadRawBuf(CopyState cstate)
 		memmove(cstate->raw_buf, cstate->raw_buf + cstate->raw_buf_index,
 				nbytes);
 
-	inbytes = CopyGetData(cstate, cstate->raw_buf + nbytes,
-						  1, RAW_BUF_SIZE - nbytes);
+	if (cstate->compression != COPY_COMPRESSION_NONE)
+		inbytes = CopyReadCompressed(cstate, cstate->raw_buf + nbytes,
+									 1, RAW_BUF_SIZE - nbytes);
+	else
+		inbytes = CopyGetData(cstate, cstate->raw_buf + nbytes,
+							  1, RAW_BUF_SIZE - nbytes);
 	nbytes += inbytes;
 	cstate->raw_buf[nbytes] = '\0';
 	cstate->raw_buf_index = 0;
 	cstate->raw_buf_len = nbytes;
+	cstate->raw_file_pos += inbytes;
 	return (inbytes > 0);
 }
 
@@ -1119,7 +1802,8 @@ DoCopy(ParseState *pstate, const CopyStmt *stmt,
 		cstate = BeginCopyFrom(pstate, rel, stmt->filename, stmt->is_program,
 							   NULL, stmt->attlist, stmt->options);
 		cstate->whereClause = whereClause;
-		*processed = CopyFrom(cstate);	/* copy from file to database */
+		if (cstate->nworkers == 0 || !ParallelCopyFrom(cstate, stmt, processed))
+			*processed = CopyFrom(cstate);	/* copy from file to database */
 		EndCopyFrom(cstate);
 	}
 	else
@@ -1159,6 +1843,7 @@ ProcessCopyOptions(ParseState *pstate,
 				   List *options)
 {
 	bool		format_specified = false;
+	bool		compression_specified = false;
 	ListCell   *option;
 
 	/* Support external use for option sanity checking */
@@ -1336,24 +2021,87 @@ ProcessCopyOptions(ParseState *pstate,
 								defel->defname),
 						 parser_errposition(pstate, defel->location)));
 		}
-		else
-			ereport(ERROR,
-					(errcode(ERRCODE_SYNTAX_ERROR),
-					 errmsg("option \"%s\" not recognized",
-							defel->defname),
-					 parser_errposition(pstate, defel->location)));
-	}
-
-	/*
-	 * Check for incompatible options (must do these two before inserting
-	 * defaults)
-	 */
-	if (cstate->binary && cstate->delim)
-		ereport(ERROR,
-				(errcode(ERRCODE_SYNTAX_ERROR),
-				 errmsg("cannot specify DELIMITER in BINARY mode")));
+		else if (strcmp(defel->defname, "compression") == 0)
+		{
+			char	   *method = defGetString(defel);
+			bool		supported = true;
 
-	if (cstate->binary && cstate->null_print)
+			if (compression_specified)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options"),
+						 parser_errposition(pstate, defel->location)));
+			compression_specified = true;
+			if (strcmp(method, "none") == 0)
+				cstate->compression = COPY_COMPRESSION_NONE;
+			else if (strcmp(method, "gzip") == 0)
+			{
+				cstate->compression = COPY_COMPRESSION_GZIP;
+#ifndef HAVE_LIBZ
+				supported = false;
+#endif
+			}
+			else if (strcmp(method, "lz4") == 0)
+			{
+				cstate->compression = COPY_COMPRESSION_LZ4;
+#ifndef USE_LZ4
+				supported = false;
+#endif
+			}
+			else if (strcmp(method, "zstd") == 0)
+			{
+				cstate->compression = COPY_COMPRESSION_ZSTD;
+#ifndef USE_ZSTD
+				supported = false;
+#endif
+			}
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("COPY compression method \"%s\" not recognized",
+								method),
+						 parser_errposition(pstate, defel->location)));
+			if (!supported)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("COPY compression method \"%s\" is not supported by this build",
+								method),
+						 parser_errposition(pstate, defel->location)));
+		}
+		else if (strcmp(defel->defname, "parallel") == 0)
+		{
+			if (cstate->nworkers > 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options"),
+						 parser_errposition(pstate, defel->location)));
+			cstate->nworkers = defGetInt32(defel);
+			if (cstate->nworkers < 1 ||
+				cstate->nworkers > MAX_PARALLEL_WORKER_LIMIT)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("argument to option \"%s\" must be between 1 and %d",
+								defel->defname, MAX_PARALLEL_WORKER_LIMIT),
+						 parser_errposition(pstate, defel->location)));
+		}
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("option \"%s\" not recognized",
+							defel->defname),
+					 parser_errposition(pstate, defel->location)));
+	}
+
+	/*
+	 * Check for incompatible options (must do these two before inserting
+	 * defaults)
+	 */
+	if (cstate->binary && cstate->delim)
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("cannot specify DELIMITER in BINARY mode")));
+
+	if (cstate->binary && cstate->null_print)
 		ereport(ERROR,
 				(errcode(ERRCODE_SYNTAX_ERROR),
 				 errmsg("cannot specify NULL in BINARY mode")));
@@ -1474,6 +2222,12 @@ ProcessCopyOptions(ParseState *pstate,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("COPY force null only available using COPY FROM")));
 
+	/* Check parallel */
+	if (cstate->nworkers > 0 && cstate->binary && is_from)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot specify PARALLEL in BINARY mode")));
+
 	/* Don't allow the delimiter to appear in the null string. */
 	if (strchr(cstate->null_print, cstate->delim[0]) != NULL)
 		ereport(ERROR,
@@ -1922,6 +2676,7 @@ BeginCopyTo(ParseState *pstate,
 
 	cstate = BeginCopy(pstate, false, rel, query, queryRelId, attnamelist,
 					   options);
+	cstate->options = options;
 	oldcontext = MemoryContextSwitchTo(cstate->copycontext);
 
 	if (pipe)
@@ -2078,6 +2833,8 @@ CopyTo(CopyState cstate)
 
 	/* Get info about the columns we need to process. */
 	cstate->out_functions = (FmgrInfo *) palloc(num_phys_attrs * sizeof(FmgrInfo));
+	cstate->binary_types = (CopyBinaryType *)
+		palloc0(num_phys_attrs * sizeof(CopyBinaryType));
 	foreach(cur, cstate->attnumlist)
 	{
 		int			attnum = lfirst_int(cur);
@@ -2086,9 +2843,13 @@ CopyTo(CopyState cstate)
 		Form_pg_attribute attr = TupleDescAttr(tupDesc, attnum - 1);
 
 		if (cstate->binary)
+		{
 			getTypeBinaryOutputInfo(attr->atttypid,
 									&out_func_oid,
 									&isvarlena);
+			cstate->binary_types[attnum - 1] =
+				CopyGetBinaryType(out_func_oid, attr->atttypmod);
+		}
 		else
 			getTypeOutputInfo(attr->atttypid,
 							  &out_func_oid,
@@ -2108,17 +2869,20 @@ CopyTo(CopyState cstate)
 
 	if (cstate->binary)
 	{
-		/* Generate header for a binary copy */
+		/* Generate header for a binary copy, unless a parallel worker */
 		int32		tmp;
 
-		/* Signature */
-		CopySendData(cstate, BinarySignature, 11);
-		/* Flags field */
-		tmp = 0;
-		CopySendInt32(cstate, tmp);
-		/* No header extension */
-		tmp = 0;
-		CopySendInt32(cstate, tmp);
+		if (cstate->copy_dest != COPY_PARALLEL_LEADER)
+		{
+			/* Signature */
+			CopySendData(cstate, BinarySignature, 11);
+			/* Flags field */
+			tmp = 0;
+			CopySendInt32(cstate, tmp);
+			/* No header extension */
+			tmp = 0;
+			CopySendInt32(cstate, tmp);
+		}
 	}
 	else
 	{
@@ -2155,12 +2919,22 @@ CopyTo(CopyState cstate)
 		}
 	}
 
-	if (cstate->rel)
+	if (cstate->rel && cstate->nworkers > 0 &&
+		ParallelCopyTo(cstate, &processed))
+	{
+		/* the workers scanned the table, and we wrote out their rows */
+	}
+	else if (cstate->rel)
 	{
 		TupleTableSlot *slot;
 		TableScanDesc scandesc;
 
-		scandesc = table_beginscan(cstate->rel, GetActiveSnapshot(), 0, NULL);
+		if (cstate->pcopy_pscan != NULL)
+			scandesc = table_beginscan_parallel(cstate->rel,
+												cstate->pcopy_pscan);
+		else
+			scandesc = table_beginscan(cstate->rel, GetActiveSnapshot(),
+									   0, NULL);
 		slot = table_slot_create(cstate->rel, NULL);
 
 		processed = 0;
@@ -2186,7 +2960,7 @@ CopyTo(CopyState cstate)
 		processed = ((DR_copy *) cstate->queryDesc->dest)->processed;
 	}
 
-	if (cstate->binary)
+	if (cstate->binary && cstate->copy_dest != COPY_PARALLEL_LEADER)
 	{
 		/* Generate trailer for a binary copy */
 		CopySendInt16(cstate, -1);
@@ -2194,6 +2968,10 @@ CopyTo(CopyState cstate)
 		CopySendEndOfRow(cstate);
 	}
 
+	/* Flush out what the compressor is still holding on to */
+	if (cstate->compression != COPY_COMPRESSION_NONE)
+		CopyCompressOutput(cstate, NULL, 0, true);
+
 	MemoryContextDelete(cstate->rowcontext);
 
 	return processed;
@@ -2256,6 +3034,9 @@ CopyOneRowTo(CopyState cstate, TupleTableSlot *slot)
 				else
 					CopyAttributeOutText(cstate, string);
 			}
+			else if (cstate->binary_types[attnum - 1] != COPY_BINARY_GENERIC)
+				CopySendBinaryDatum(cstate, cstate->binary_types[attnum - 1],
+									value);
 			else
 			{
 				bytea	   *outputbytes;
@@ -2275,6 +3056,296 @@ CopyOneRowTo(CopyState cstate, TupleTableSlot *slot)
 }
 
 
+/*
+ * Scan the table for a COPY TO with the help of parallel workers, and write
+ * out the rows they send; see "Parallel COPY TO" near the top of the file.
+ *
+ * Returns false, having done nothing, if the table can't be scanned in
+ * parallel or no workers could be launched.  The caller should then scan
+ * the table itself.
+ */
+static bool
+ParallelCopyTo(CopyState cstate, uint64 *processed)
+{
+	Relation	rel = cstate->rel;
+	ParallelContext *pcxt;
+	ParallelCopyToShared *shared;
+	ParallelTableScanDesc pscan;
+	shm_mq_handle **mqh;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	ListCell   *cur;
+	char	   *nodes;
+	char	   *sharednodes;
+	char	   *queuespace;
+	char	   *sharedquery;
+	const char *querytext;
+	Size		nodeslen;
+	Size		querylen;
+	Size		pscanlen;
+	int			nactive;
+	int			i;
+
+	/* Workers can't read temporary tables */
+	if (rel->rd_rel->relpersistence == RELPERSISTENCE_TEMP)
+		return false;
+
+	foreach(cur, cstate->attnumlist)
+	{
+		int			attnum = lfirst_int(cur);
+
+		if (func_parallel(cstate->out_functions[attnum - 1].fn_oid) != PROPARALLEL_SAFE)
+			return false;
+	}
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "ParallelCopyToMain",
+								 cstate->nworkers);
+
+	/* The workers redo BeginCopyTo with the same options and columns */
+	nodes = nodeToString(list_make2(cstate->options, cstate->attnumlist));
+	nodeslen = strlen(nodes) + 1;
+	querytext = debug_query_string ? debug_query_string : "";
+	querylen = strlen(querytext) + 1;
+	pscanlen = table_parallelscan_estimate(rel, GetActiveSnapshot());
+
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelCopyToShared));
+	shm_toc_estimate_chunk(&pcxt->estimator, nodeslen);
+	shm_toc_estimate_chunk(&pcxt->estimator, pscanlen);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_COPY_QUEUE_SIZE, pcxt->nworkers));
+	shm_toc_estimate_chunk(&pcxt->estimator, querylen);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 7);
+
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment could be created, there's nobody to hand work to */
+	if (pcxt->nworkers == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return false;
+	}
+
+	shared = (ParallelCopyToShared *)
+		shm_toc_allocate(pcxt->toc, sizeof(ParallelCopyToShared));
+	shared->relid = RelationGetRelid(rel);
+#ifdef WIN32
+	shared->crlf = (cstate->copy_dest == COPY_FILE);
+#else
+	shared->crlf = false;
+#endif
+	pg_atomic_init_u64(&shared->processed, 0);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_SHARED, shared);
+
+	sharednodes = (char *) shm_toc_allocate(pcxt->toc, nodeslen);
+	memcpy(sharednodes, nodes, nodeslen);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_NODES, sharednodes);
+
+	pscan = (ParallelTableScanDesc) shm_toc_allocate(pcxt->toc, pscanlen);
+	table_parallelscan_initialize(rel, pscan, GetActiveSnapshot());
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_SCAN, pscan);
+
+	/* One queue per worker, with us as the receiver */
+	queuespace = (char *)
+		shm_toc_allocate(pcxt->toc,
+						 mul_size(PARALLEL_COPY_QUEUE_SIZE, pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_QUEUES, queuespace);
+	mqh = (shm_mq_handle **) palloc(pcxt->nworkers * sizeof(shm_mq_handle *));
+	for (i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(queuespace + i * PARALLEL_COPY_QUEUE_SIZE,
+						   PARALLEL_COPY_QUEUE_SIZE);
+		shm_mq_set_receiver(mq, MyProc);
+		mqh[i] = shm_mq_attach(mq, pcxt->seg, NULL);
+	}
+
+	sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen);
+	memcpy(sharedquery, querytext, querylen);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_QUERY_TEXT, sharedquery);
+
+	/* Space for each worker's BufferUsage and WalUsage */
+	buffer_usage = shm_toc_allocate(pcxt->toc,
+									mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_BUFFER_USAGE, buffer_usage);
+	wal_usage = shm_toc_allocate(pcxt->toc,
+								 mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_WAL_USAGE, wal_usage);
+
+	LaunchParallelWorkers(pcxt);
+
+	if (pcxt->nworkers_launched == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return false;
+	}
+
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+		shm_mq_set_handle(mqh[i], pcxt->worker[i].bgwhandle);
+	for (; i < pcxt->nworkers; i++)
+		shm_mq_detach(mqh[i]);
+
+	/*
+	 * Write out chunks from whichever workers have one ready, until they
+	 * have all finished and detached from their queues.
+	 */
+	nactive = pcxt->nworkers_launched;
+	while (nactive > 0)
+	{
+		bool		gotchunk = false;
+
+		CHECK_FOR_INTERRUPTS();
+
+		for (i = 0; i < pcxt->nworkers_launched; i++)
+		{
+			shm_mq_result res;
+			Size		nbytes;
+			void	   *data;
+
+			if (mqh[i] == NULL)
+				continue;
+
+			res = shm_mq_receive(mqh[i], &nbytes, &data, true);
+			if (res == SHM_MQ_SUCCESS)
+			{
+				appendBinaryStringInfo(cstate->fe_msgbuf, data, nbytes);
+				CopyFlushOutput(cstate);
+				gotchunk = true;
+			}
+			else if (res == SHM_MQ_DETACHED)
+			{
+				shm_mq_detach(mqh[i]);
+				mqh[i] = NULL;
+				nactive--;
+			}
+		}
+
+		if (!gotchunk && nactive > 0)
+		{
+			(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, 0,
+							 WAIT_EVENT_MQ_RECEIVE);
+			ResetLatch(MyLatch);
+		}
+	}
+
+	/* This also rethrows any error a worker ran into */
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/* Accumulate the workers' buffer and WAL usage */
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&buffer_usage[i], &wal_usage[i]);
+
+	*processed = pg_atomic_read_u64(&shared->processed);
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	return true;
+}
+
+/*
+ * Send a chunk of rows formatted by a parallel COPY TO worker to the leader.
+ */
+static void
+ParallelCopyToSend(CopyState cstate, const char *data, int len)
+{
+	shm_mq_result res;
+
+	if (len == 0)
+		return;
+
+	/* Chunks are flushed in bulk; ParallelCopyToMain flushes the rest */
+	res = shm_mq_send(cstate->pcopy_mqh, len, data, false, false);
+
+	/* The leader only detaches when it's bailing out */
+	if (res != SHM_MQ_SUCCESS)
+		elog(ERROR, "parallel COPY leader exited unexpectedly");
+}
+
+/*
+ * Main entry point for parallel COPY TO worker processes.
+ */
+void
+ParallelCopyToMain(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelCopyToShared *shared;
+	List	   *nodes;
+	char	   *queuespace;
+	shm_mq	   *mq;
+	Relation	rel;
+	CopyState	cstate;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	uint64		processed;
+
+	shared = (ParallelCopyToShared *)
+		shm_toc_lookup(toc, PARALLEL_COPY_TO_KEY_SHARED, false);
+
+	/* Set debug_query_string for individual workers */
+	debug_query_string = shm_toc_lookup(toc, PARALLEL_COPY_TO_KEY_QUERY_TEXT,
+										false);
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	nodes = (List *) stringToNode(shm_toc_lookup(toc,
+												 PARALLEL_COPY_TO_KEY_NODES,
+												 false));
+
+	/* Attach to our queue as its sender */
+	queuespace = shm_toc_lookup(toc, PARALLEL_COPY_TO_KEY_QUEUES, false);
+	mq = (shm_mq *) (queuespace +
+					 ParallelWorkerNumber * PARALLEL_COPY_QUEUE_SIZE);
+	shm_mq_set_sender(mq, MyProc);
+
+	/* Open the table with the same lock mode as the leader */
+	rel = table_open(shared->relid, AccessShareLock);
+
+	/*
+	 * Set up as the leader did, except that the output goes to the leader,
+	 * which also takes care of the header and trailer, and of compression.  The column list was
+	 * already resolved by the leader.
+	 */
+	cstate = BeginCopyTo(NULL, rel, NULL, InvalidOid, NULL, false, NIL,
+						 (List *) linitial(nodes));
+	cstate->attnumlist = (List *) lsecond(nodes);
+	cstate->nworkers = 0;
+	cstate->header_line = false;
+	cstate->compression = COPY_COMPRESSION_NONE;
+	cstate->copy_dest = COPY_PARALLEL_LEADER;
+	cstate->copy_file = NULL;
+	cstate->pcopy_crlf = shared->crlf;
+	cstate->pcopy_mqh = shm_mq_attach(mq, seg, NULL);
+	cstate->pcopy_pscan = shm_toc_lookup(toc, PARALLEL_COPY_TO_KEY_SCAN,
+										 false);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	processed = CopyTo(cstate);
+	CopyFlushOutput(cstate);
+	if (shm_mq_flush(cstate->pcopy_mqh) != SHM_MQ_SUCCESS)
+		elog(ERROR, "parallel COPY leader exited unexpectedly");
+
+	/* Report buffer/WAL usage during parallel execution */
+	buffer_usage = shm_toc_lookup(toc, PARALLEL_COPY_TO_KEY_BUFFER_USAGE,
+								  false);
+	wal_usage = shm_toc_lookup(toc, PARALLEL_COPY_TO_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&buffer_usage[ParallelWorkerNumber],
+						  &wal_usage[ParallelWorkerNumber]);
+
+	pg_atomic_add_fetch_u64(&shared->processed, processed);
+
+	EndCopyTo(cstate);
+	table_close(rel, NoLock);
+}
+
+
 /*
  * error context callback for COPY FROM
  *
@@ -2508,11 +3579,20 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 					   buffer->bistate);
 	MemoryContextSwitchTo(oldcontext);
 
+	/*
+	 * Update the indexes that allow it for all the inserted tuples at once.
+	 * Errors raised there can't be attributed to a particular line.  The
+	 * other indexes are updated tuple by tuple below, so that constraint
+	 * violations are reported with the right line.
+	 */
+	if (resultRelInfo->ri_NumIndices > 0)
+		ExecInsertIndexTuplesMulti(slots, nused, estate);
+
 	for (i = 0; i < nused; i++)
 	{
 		/*
-		 * If there are any indexes, update them for all the inserted tuples,
-		 * and run AFTER ROW INSERT triggers.
+		 * If there are any indexes, update the remaining ones for all the
+		 * inserted tuples, and run AFTER ROW INSERT triggers.
 		 */
 		if (resultRelInfo->ri_NumIndices > 0)
 		{
@@ -2521,7 +3601,7 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 			cstate->cur_lineno = buffer->linenos[i];
 			recheckIndexes =
 				ExecInsertIndexTuples(buffer->slots[i], estate, false, NULL,
-									  NIL);
+									  NIL, true, false);
 			ExecARInsertTriggers(estate, resultRelInfo,
 								 slots[i], recheckIndexes,
 								 cstate->transition_capture);
@@ -2820,6 +3900,13 @@ CopyFrom(CopyState cstate)
 		ti_options |= TABLE_INSERT_FROZEN;
 	}
 
+	/*
+	 * In a parallel COPY FROM, the leader has checked that the workers can
+	 * safely insert into the table.
+	 */
+	if (cstate->pcopy_mqh != NULL)
+		ti_options |= TABLE_INSERT_PARALLEL;
+
 	/*
 	 * We need a ResultRelInfo so we can use the regular executor's
 	 * index-entry-making machinery.  (There used to be a huge amount of code
@@ -2960,6 +4047,20 @@ CopyFrom(CopyState cstate)
 		else
 			insertMethod = CIM_MULTI;
 
+		/*
+		 * If the table is new in this transaction and has no indexes or
+		 * triggers that would need to look at the new tuples while we're
+		 * still loading, let the table AM write its pages directly instead
+		 * of going through shared buffers.  Parallel workers each have their
+		 * own BulkInsertState, so they can't do that.
+		 */
+		if (insertMethod == CIM_MULTI &&
+			(ti_options & TABLE_INSERT_SKIP_FSM) &&
+			!(ti_options & TABLE_INSERT_PARALLEL) &&
+			resultRelInfo->ri_NumIndices == 0 &&
+			resultRelInfo->ri_TrigDesc == NULL)
+			ti_options |= TABLE_INSERT_BULK_WRITE;
+
 		CopyMultiInsertInfoInit(&multiInsertInfo, resultRelInfo, cstate,
 								estate, mycid, ti_options);
 	}
@@ -3295,7 +4396,9 @@ CopyFrom(CopyState cstate)
 																   estate,
 																   false,
 																   NULL,
-																   NIL);
+																   NIL,
+																   false,
+																   false);
 					}
 
 					/* AFTER ROW INSERT Triggers */
@@ -3315,58 +4418,604 @@ CopyFrom(CopyState cstate)
 		}
 	}
 
-	/* Flush any remaining buffered tuples */
-	if (insertMethod != CIM_SINGLE)
+	/* Flush any remaining buffered tuples */
+	if (insertMethod != CIM_SINGLE)
+	{
+		if (!CopyMultiInsertInfoIsEmpty(&multiInsertInfo))
+			CopyMultiInsertInfoFlush(&multiInsertInfo, NULL);
+	}
+
+	/* Done, clean up */
+	error_context_stack = errcallback.previous;
+
+	if (bistate != NULL)
+		FreeBulkInsertState(bistate);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/*
+	 * In the old protocol, tell pqcomm that we can process normal protocol
+	 * messages again.
+	 */
+	if (cstate->copy_dest == COPY_OLD_FE)
+		pq_endmsgread();
+
+	/* Execute AFTER STATEMENT insertion triggers */
+	ExecASInsertTriggers(estate, target_resultRelInfo, cstate->transition_capture);
+
+	/* Handle queued AFTER triggers */
+	AfterTriggerEndQuery(estate);
+
+	ExecResetTupleTable(estate->es_tupleTable, false);
+
+	/* Allow the FDW to shut down */
+	if (target_resultRelInfo->ri_FdwRoutine != NULL &&
+		target_resultRelInfo->ri_FdwRoutine->EndForeignInsert != NULL)
+		target_resultRelInfo->ri_FdwRoutine->EndForeignInsert(estate,
+															  target_resultRelInfo);
+
+	/* Tear down the multi-insert buffer data */
+	if (insertMethod != CIM_SINGLE)
+		CopyMultiInsertInfoCleanup(&multiInsertInfo);
+
+	ExecCloseIndices(target_resultRelInfo);
+
+	/* Close all the partitioned tables, leaf partitions, and their indices */
+	if (proute)
+		ExecCleanupTupleRouting(mtstate, proute);
+
+	/* Close any trigger target relations */
+	ExecCleanUpTriggerState(estate);
+
+	FreeExecutorState(estate);
+
+	return processed;
+}
+
+/*
+ * Run a COPY FROM with the help of parallel workers; see "Parallel COPY
+ * FROM" near the top of the file for the division of labor.
+ *
+ * Returns false, without having read any input, if this COPY can't be done
+ * in parallel or no workers could be launched.  The caller should then fall
+ * back to CopyFrom.
+ */
+static bool
+ParallelCopyFrom(CopyState cstate, const CopyStmt *stmt, uint64 *processed)
+{
+	ParallelContext *pcxt;
+	ParallelCopyShared *shared;
+	ParallelCopyLeader leader;
+	ErrorContextCallback errcallback;
+	StringInfoData batch;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	char	   *nodes;
+	char	   *sharednodes;
+	char	   *queuespace;
+	char	   *sharedquery;
+	const char *querytext;
+	Size		nodeslen;
+	Size		querylen;
+	int			i;
+
+	if (!CopyFromParallelSafe(cstate))
+		return false;
+
+	/*
+	 * The workers insert with our transaction ID and command ID, both of
+	 * which have to be settled before entering parallel mode.
+	 */
+	(void) GetCurrentTransactionId();
+	(void) GetCurrentCommandId(true);
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "ParallelCopyMain",
+								 cstate->nworkers);
+
+	/*
+	 * The workers redo BeginCopyFrom with the same options and columns, so
+	 * pass those along with the WHERE clause and range table.
+	 */
+	nodes = nodeToString(list_make4(stmt->options, stmt->attlist,
+									cstate->whereClause, cstate->range_table));
+	nodeslen = strlen(nodes) + 1;
+	querytext = debug_query_string ? debug_query_string : "";
+	querylen = strlen(querytext) + 1;
+
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelCopyShared));
+	shm_toc_estimate_chunk(&pcxt->estimator, nodeslen);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_COPY_QUEUE_SIZE, pcxt->nworkers));
+	shm_toc_estimate_chunk(&pcxt->estimator, querylen);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 6);
+
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment could be created, there's nobody to hand work to */
+	if (pcxt->nworkers == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return false;
+	}
+
+	shared = (ParallelCopyShared *)
+		shm_toc_allocate(pcxt->toc, sizeof(ParallelCopyShared));
+	shared->relid = RelationGetRelid(cstate->rel);
+	pg_atomic_init_u64(&shared->processed, 0);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_SHARED, shared);
+
+	sharednodes = (char *) shm_toc_allocate(pcxt->toc, nodeslen);
+	memcpy(sharednodes, nodes, nodeslen);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_NODES, sharednodes);
+
+	/* One queue per worker, with us as the sender */
+	queuespace = (char *)
+		shm_toc_allocate(pcxt->toc,
+						 mul_size(PARALLEL_COPY_QUEUE_SIZE, pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_QUEUES, queuespace);
+	leader.mqh = (shm_mq_handle **)
+		palloc(pcxt->nworkers * sizeof(shm_mq_handle *));
+	for (i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(queuespace + i * PARALLEL_COPY_QUEUE_SIZE,
+						   PARALLEL_COPY_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+		leader.mqh[i] = shm_mq_attach(mq, pcxt->seg, NULL);
+	}
+
+	sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen);
+	memcpy(sharedquery, querytext, querylen);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_QUERY_TEXT, sharedquery);
+
+	/* Space for each worker's BufferUsage and WalUsage */
+	buffer_usage = shm_toc_allocate(pcxt->toc,
+									mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_BUFFER_USAGE, buffer_usage);
+	wal_usage = shm_toc_allocate(pcxt->toc,
+								 mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_WAL_USAGE, wal_usage);
+
+	LaunchParallelWorkers(pcxt);
+
+	if (pcxt->nworkers_launched == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return false;
+	}
+
+	leader.pcxt = pcxt;
+	leader.nqueues = pcxt->nworkers_launched;
+	leader.pending = (StringInfoData *)
+		palloc(leader.nqueues * sizeof(StringInfoData));
+	leader.next_queue = 0;
+	for (i = 0; i < leader.nqueues; i++)
+	{
+		shm_mq_set_handle(leader.mqh[i], pcxt->worker[i].bgwhandle);
+		initStringInfo(&leader.pending[i]);
+	}
+	for (; i < pcxt->nworkers; i++)
+		shm_mq_detach(leader.mqh[i]);
+
+	/*
+	 * Set up callback to identify error line number.  It's only installed
+	 * while reading, so that errors rethrown from the workers don't get our
+	 * line number attached to them.
+	 */
+	errcallback.callback = CopyFromErrorCallback;
+	errcallback.arg = (void *) cstate;
+	errcallback.previous = error_context_stack;
+
+	initStringInfo(&batch);
+	for (;;)
+	{
+		bool		done;
+		uint64		lineno;
+		uint32		len;
+
+		CHECK_FOR_INTERRUPTS();
+
+		error_context_stack = &errcallback;
+
+		/* on input just throw the header line away */
+		if (cstate->cur_lineno == 0 && cstate->header_line)
+		{
+			cstate->cur_lineno++;
+			if (CopyReadLine(cstate))
+			{
+				error_context_stack = errcallback.previous;
+				break;
+			}
+		}
+
+		cstate->cur_lineno++;
+		done = CopyReadLine(cstate);
+
+		error_context_stack = errcallback.previous;
+
+		/* As in NextCopyFromRawFields, EOF at start of line means we're done */
+		if (done && cstate->line_buf.len == 0)
+			break;
+
+		lineno = cstate->cur_lineno;
+		len = cstate->line_buf.len;
+		appendBinaryStringInfo(&batch, (char *) &lineno, sizeof(lineno));
+		appendBinaryStringInfo(&batch, (char *) &len, sizeof(len));
+		appendBinaryStringInfo(&batch, cstate->line_buf.data, len);
+
+		if (batch.len >= PARALLEL_COPY_BATCH_SIZE)
+			ParallelCopySendBatch(&leader, &batch);
+
+		if (done)
+			break;
+	}
+
+	if (batch.len > 0)
+		ParallelCopySendBatch(&leader, &batch);
+
+	/*
+	 * Finish sending whatever is still queued up, then detach, which tells
+	 * each worker that there's no more input once it has drained its queue.
+	 */
+	for (i = 0; i < leader.nqueues; i++)
+	{
+		(void) ParallelCopySendPending(&leader, i, false);
+		shm_mq_detach(leader.mqh[i]);
+		leader.mqh[i] = NULL;
+	}
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/* Accumulate the workers' buffer and WAL usage */
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&buffer_usage[i], &wal_usage[i]);
+
+	*processed = pg_atomic_read_u64(&shared->processed);
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	/*
+	 * In the old protocol, tell pqcomm that we can process normal protocol
+	 * messages again.
+	 */
+	if (cstate->copy_dest == COPY_OLD_FE)
+		pq_endmsgread();
+
+	return true;
+}
+
+/*
+ * Can this COPY FROM be done by parallel workers?
+ *
+ * The workers run CopyFrom themselves, in whatever order their batches of
+ * lines happen to arrive, so anything that is sensitive to the order of
+ * insertion or that can't run in a parallel worker rules it out: triggers
+ * (including the ones implementing foreign keys), partitioned and foreign
+ * tables, temporary tables, FREEZE, and relfilenodes created in this
+ * transaction, which may be skipping WAL.  So does any type input function,
+ * default, generated column, check constraint, index expression or WHERE
+ * clause that isn't parallel safe.
+ */
+static bool
+CopyFromParallelSafe(CopyState cstate)
+{
+	Relation	rel = cstate->rel;
+	TupleDesc	tupDesc = RelationGetDescr(rel);
+	List	   *indexoidlist;
+	ListCell   *lc;
+	int			attnum;
+
+	if (cstate->freeze)
+		return false;
+
+	if (rel->rd_rel->relkind != RELKIND_RELATION ||
+		rel->rd_rel->relpersistence == RELPERSISTENCE_TEMP)
+		return false;
+
+	if (rel->trigdesc != NULL)
+		return false;
+
+	if (rel->rd_createSubid != InvalidSubTransactionId ||
+		rel->rd_firstRelfilenodeSubid != InvalidSubTransactionId)
+		return false;
+
+	for (attnum = 1; attnum <= tupDesc->natts; attnum++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupDesc, attnum - 1);
+
+		if (att->attisdropped)
+			continue;
+
+		if (list_member_int(cstate->attnumlist, attnum))
+		{
+			/* domain_in would evaluate the domain's constraints, too */
+			if (func_parallel(cstate->in_functions[attnum - 1].fn_oid) != PROPARALLEL_SAFE ||
+				get_typtype(att->atttypid) == TYPTYPE_DOMAIN)
+				return false;
+		}
+		else if (CopyExprParallelUnsafe(build_column_default(rel, attnum)))
+			return false;
+	}
+
+	if (tupDesc->constr != NULL)
+	{
+		int			i;
+
+		for (i = 0; i < tupDesc->constr->num_check; i++)
+		{
+			if (CopyExprParallelUnsafe(stringToNode(tupDesc->constr->check[i].ccbin)))
+				return false;
+		}
+	}
+
+	indexoidlist = RelationGetIndexList(rel);
+	foreach(lc, indexoidlist)
+	{
+		Relation	index = index_open(lfirst_oid(lc), RowExclusiveLock);
+		bool		unsafe;
+
+		unsafe = CopyExprParallelUnsafe((Node *) RelationGetIndexExpressions(index)) ||
+			CopyExprParallelUnsafe((Node *) RelationGetIndexPredicate(index));
+		index_close(index, NoLock);
+
+		if (unsafe)
+		{
+			list_free(indexoidlist);
+			return false;
+		}
+	}
+	list_free(indexoidlist);
+
+	return !CopyExprParallelUnsafe(cstate->whereClause);
+}
+
+/*
+ * Does an expression that the workers of a parallel COPY FROM would have to
+ * evaluate call anything that isn't parallel safe?
+ *
+ * This is a simplified max_parallel_hazard for expressions that don't come
+ * from the planner.  Since only the workers evaluate them, parallel
+ * restricted counts as unsafe here.
+ */
+static bool
+CopyExprParallelUnsafe(Node *node)
+{
+	return copy_parallel_unsafe_walker(node, NULL);
+}
+
+static bool
+copy_parallel_unsafe_checker(Oid func_id, void *context)
+{
+	return func_parallel(func_id) != PROPARALLEL_SAFE;
+}
+
+static bool
+copy_parallel_unsafe_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+
+	if (check_functions_in_node(node, copy_parallel_unsafe_checker, context))
+		return true;
+
+	/*
+	 * Domain constraints may call anything, and sequences (behind identity
+	 * columns) can't be advanced in a worker.
+	 */
+	if (IsA(node, CoerceToDomain) ||
+		IsA(node, NextValueExpr) ||
+		IsA(node, SubLink))
+		return true;
+
+	return expression_tree_walker(node, copy_parallel_unsafe_walker, context);
+}
+
+/*
+ * Try to send the batch pending for the i'th worker, if there is one.
+ *
+ * Returns true if the queue has nothing left to send, false if the send
+ * would block (only if 'nowait').
+ */
+static bool
+ParallelCopySendPending(ParallelCopyLeader *leader, int i, bool nowait)
+{
+	StringInfo	pending = &leader->pending[i];
+	shm_mq_result res;
+	int			j;
+
+	if (pending->len == 0)
+		return true;
+
+	/* A partially sent message must be resumed with the same arguments */
+	res = shm_mq_send(leader->mqh[i], pending->len, pending->data, nowait,
+					  true);
+	if (res == SHM_MQ_SUCCESS)
+	{
+		resetStringInfo(pending);
+		return true;
+	}
+	if (res == SHM_MQ_WOULD_BLOCK)
+		return false;
+
+	/*
+	 * The worker has gone away, which it only does when it fails.  Let the
+	 * other workers wind down, so that waiting for them rethrows the error.
+	 */
+	Assert(res == SHM_MQ_DETACHED);
+	for (j = 0; j < leader->nqueues; j++)
+	{
+		if (leader->mqh[j] != NULL)
+			shm_mq_detach(leader->mqh[j]);
+		leader->mqh[j] = NULL;
+	}
+	WaitForParallelWorkersToFinish(leader->pcxt);
+	elog(ERROR, "parallel COPY worker exited unexpectedly");
+	return false;				/* keep compiler quiet */
+}
+
+/*
+ * Hand a batch of lines to the first worker whose queue isn't backed up,
+ * waiting for one to free up if necessary.  On return, 'batch' is empty.
+ */
+static void
+ParallelCopySendBatch(ParallelCopyLeader *leader, StringInfo batch)
+{
+	for (;;)
+	{
+		int			n;
+
+		for (n = 0; n < leader->nqueues; n++)
+		{
+			int			i = (leader->next_queue + n) % leader->nqueues;
+
+			if (ParallelCopySendPending(leader, i, true))
+			{
+				StringInfoData tmp;
+
+				/* swap buffers rather than copying the batch */
+				tmp = leader->pending[i];
+				leader->pending[i] = *batch;
+				*batch = tmp;
+
+				leader->next_queue = (i + 1) % leader->nqueues;
+				(void) ParallelCopySendPending(leader, i, true);
+				return;
+			}
+		}
+
+		/* Every queue is full; wait for a worker to read from its queue */
+		(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, 0,
+						 WAIT_EVENT_MQ_SEND);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * Read the next line that the leader of a parallel COPY FROM sent us into
+ * line_buf, setting cur_lineno to its line number in the input.
+ *
+ * Returns true when there are no more lines.
+ */
+static bool
+ParallelCopyReadLine(CopyState cstate)
+{
+	uint64		lineno;
+	uint32		len;
+
+	while (cstate->pcopy_batch_off >= cstate->pcopy_batch_len)
 	{
-		if (!CopyMultiInsertInfoIsEmpty(&multiInsertInfo))
-			CopyMultiInsertInfoFlush(&multiInsertInfo, NULL);
+		shm_mq_result res;
+		Size		nbytes;
+		void	   *data;
+
+		res = shm_mq_receive(cstate->pcopy_mqh, &nbytes, &data, false);
+		if (res == SHM_MQ_DETACHED)
+			return true;
+		Assert(res == SHM_MQ_SUCCESS);
+
+		cstate->pcopy_batch = (char *) data;
+		cstate->pcopy_batch_len = nbytes;
+		cstate->pcopy_batch_off = 0;
 	}
 
-	/* Done, clean up */
-	error_context_stack = errcallback.previous;
+	Assert(cstate->pcopy_batch_off + sizeof(lineno) + sizeof(len) <=
+		   cstate->pcopy_batch_len);
+	memcpy(&lineno, cstate->pcopy_batch + cstate->pcopy_batch_off,
+		   sizeof(lineno));
+	cstate->pcopy_batch_off += sizeof(lineno);
+	memcpy(&len, cstate->pcopy_batch + cstate->pcopy_batch_off, sizeof(len));
+	cstate->pcopy_batch_off += sizeof(len);
+	Assert(cstate->pcopy_batch_off + len <= cstate->pcopy_batch_len);
 
-	if (bistate != NULL)
-		FreeBulkInsertState(bistate);
+	resetStringInfo(&cstate->line_buf);
+	appendBinaryStringInfo(&cstate->line_buf,
+						   cstate->pcopy_batch + cstate->pcopy_batch_off, len);
+	cstate->pcopy_batch_off += len;
+	cstate->line_buf_valid = true;
+	cstate->line_buf_converted = true;
+	cstate->cur_lineno = lineno;
 
-	MemoryContextSwitchTo(oldcontext);
+	return false;
+}
 
-	/*
-	 * In the old protocol, tell pqcomm that we can process normal protocol
-	 * messages again.
-	 */
-	if (cstate->copy_dest == COPY_OLD_FE)
-		pq_endmsgread();
+/*
+ * Data source callback for parallel COPY FROM workers.  They get their
+ * input from ParallelCopyReadLine, so this is never reached.
+ */
+static int
+ParallelCopyNoData(void *outbuf, int minread, int maxread)
+{
+	elog(ERROR, "parallel COPY worker cannot read input directly");
+	return 0;					/* keep compiler quiet */
+}
 
-	/* Execute AFTER STATEMENT insertion triggers */
-	ExecASInsertTriggers(estate, target_resultRelInfo, cstate->transition_capture);
+/*
+ * Main entry point for parallel COPY FROM worker processes.
+ */
+void
+ParallelCopyMain(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelCopyShared *shared;
+	List	   *nodes;
+	char	   *queuespace;
+	shm_mq	   *mq;
+	Relation	rel;
+	CopyState	cstate;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	uint64		processed;
 
-	/* Handle queued AFTER triggers */
-	AfterTriggerEndQuery(estate);
+	shared = (ParallelCopyShared *)
+		shm_toc_lookup(toc, PARALLEL_COPY_KEY_SHARED, false);
 
-	ExecResetTupleTable(estate->es_tupleTable, false);
+	/* Set debug_query_string for individual workers */
+	debug_query_string = shm_toc_lookup(toc, PARALLEL_COPY_KEY_QUERY_TEXT,
+										false);
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
 
-	/* Allow the FDW to shut down */
-	if (target_resultRelInfo->ri_FdwRoutine != NULL &&
-		target_resultRelInfo->ri_FdwRoutine->EndForeignInsert != NULL)
-		target_resultRelInfo->ri_FdwRoutine->EndForeignInsert(estate,
-															  target_resultRelInfo);
+	nodes = (List *) stringToNode(shm_toc_lookup(toc, PARALLEL_COPY_KEY_NODES,
+												 false));
 
-	/* Tear down the multi-insert buffer data */
-	if (insertMethod != CIM_SINGLE)
-		CopyMultiInsertInfoCleanup(&multiInsertInfo);
+	/* Attach to our queue as its receiver */
+	queuespace = shm_toc_lookup(toc, PARALLEL_COPY_KEY_QUEUES, false);
+	mq = (shm_mq *) (queuespace +
+					 ParallelWorkerNumber * PARALLEL_COPY_QUEUE_SIZE);
+	shm_mq_set_receiver(mq, MyProc);
 
-	ExecCloseIndices(target_resultRelInfo);
+	/* Open the table with the same lock mode as the leader */
+	rel = table_open(shared->relid, RowExclusiveLock);
 
-	/* Close all the partitioned tables, leaf partitions, and their indices */
-	if (proute)
-		ExecCleanupTupleRouting(mtstate, proute);
+	cstate = BeginCopyFrom(NULL, rel, NULL, false, ParallelCopyNoData,
+						   (List *) lsecond(nodes), (List *) linitial(nodes));
+	cstate->whereClause = (Node *) lthird(nodes);
+	cstate->range_table = (List *) lfourth(nodes);
+	cstate->pcopy_mqh = shm_mq_attach(mq, seg, NULL);
 
-	/* Close any trigger target relations */
-	ExecCleanUpTriggerState(estate);
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
 
-	FreeExecutorState(estate);
+	processed = CopyFrom(cstate);
 
-	return processed;
+	/* Report buffer/WAL usage during parallel execution */
+	buffer_usage = shm_toc_lookup(toc, PARALLEL_COPY_KEY_BUFFER_USAGE, false);
+	wal_usage = shm_toc_lookup(toc, PARALLEL_COPY_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&buffer_usage[ParallelWorkerNumber],
+						  &wal_usage[ParallelWorkerNumber]);
+
+	pg_atomic_add_fetch_u64(&shared->processed, processed);
+
+	EndCopyFrom(cstate);
+	table_close(rel, NoLock);
 }
 
 /*
@@ -3395,6 +5044,7 @@ BeginCopyFrom(ParseState *pstate,
 				num_defaults;
 	FmgrInfo   *in_functions;
 	Oid		   *typioparams;
+	CopyBinaryType *binary_types;
 	int			attnum;
 	Oid			in_func_oid;
 	int		   *defmap;
@@ -3408,6 +5058,8 @@ BeginCopyFrom(ParseState *pstate,
 	/* Initialize state variables */
 	cstate->reached_eof = false;
 	cstate->eol_type = EOL_UNKNOWN;
+	cstate->range_end = -1;
+	cstate->raw_file_pos = 0;
 	cstate->cur_relname = RelationGetRelationName(cstate->rel);
 	cstate->cur_lineno = 0;
 	cstate->cur_attname = NULL;
@@ -3444,6 +5096,8 @@ BeginCopyFrom(ParseState *pstate,
 	 */
 	in_functions = (FmgrInfo *) palloc(num_phys_attrs * sizeof(FmgrInfo));
 	typioparams = (Oid *) palloc(num_phys_attrs * sizeof(Oid));
+	binary_types = (CopyBinaryType *)
+		palloc0(num_phys_attrs * sizeof(CopyBinaryType));
 	defmap = (int *) palloc(num_phys_attrs * sizeof(int));
 	defexprs = (ExprState **) palloc(num_phys_attrs * sizeof(ExprState *));
 
@@ -3457,8 +5111,12 @@ BeginCopyFrom(ParseState *pstate,
 
 		/* Fetch the input function and typioparam info */
 		if (cstate->binary)
+		{
 			getTypeBinaryInputInfo(att->atttypid,
 								   &in_func_oid, &typioparams[attnum - 1]);
+			binary_types[attnum - 1] = CopyGetBinaryType(in_func_oid,
+														 att->atttypmod);
+		}
 		else
 			getTypeInputInfo(att->atttypid,
 							 &in_func_oid, &typioparams[attnum - 1]);
@@ -3504,6 +5162,7 @@ BeginCopyFrom(ParseState *pstate,
 	/* We keep those variables in cstate. */
 	cstate->in_functions = in_functions;
 	cstate->typioparams = typioparams;
+	cstate->binary_types = binary_types;
 	cstate->defmap = defmap;
 	cstate->defexprs = defexprs;
 	cstate->volatile_defexprs = volatile_defexprs;
@@ -3624,6 +5283,123 @@ BeginCopyFrom(ParseState *pstate,
 	return cstate;
 }
 
+/*
+ * Restrict a COPY FROM a file to the lines that start within the byte range
+ * [start, end) of the file, so that a large file can be split among several
+ * processes, as a parallel file_fdw scan does.  A line belongs to the range
+ * it starts in, however far past 'end' it extends, so adjacent ranges that
+ * cover the file read each line exactly once.  Lines are told apart by the
+ * newlines that end them, which in CSV mode assumes that no quoted field
+ * contains a newline; the caller has to know that.  Line numbers reported
+ * in errors count from the start of the range.
+ *
+ * This can be called again after NextCopyFrom has returned false, to move on
+ * to another range.  Returns false, doing nothing, if the input cannot be
+ * split, in which case the caller must read it in one go instead.
+ */
+bool
+CopyFromSetRange(CopyState cstate, off_t start, off_t end)
+{
+	Assert(cstate->is_copy_from);
+
+	if (cstate->copy_dest != COPY_FILE || cstate->is_program ||
+		cstate->binary || cstate->compression != COPY_COMPRESSION_NONE ||
+		cstate->encoding_embeds_ascii)
+		return false;
+
+	/* From the first range on, we skip the header line ourselves */
+	if (cstate->range_end < 0)
+	{
+		cstate->range_header = cstate->header_line;
+		cstate->header_line = false;
+	}
+
+	if (start > 0)
+		start = CopyFindLineStart(cstate, start);
+	if (fseeko(cstate->copy_file, start, SEEK_SET) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not seek in COPY file: %m")));
+
+	cstate->raw_buf_index = cstate->raw_buf_len = 0;
+	cstate->raw_buf[0] = '\0';
+	cstate->raw_file_pos = start;
+	cstate->reached_eof = false;
+	cstate->eol_type = EOL_UNKNOWN;
+	cstate->line_buf_valid = false;
+	cstate->cur_lineno = 0;
+	cstate->range_end = end;
+
+	if (start == 0 && cstate->range_header)
+	{
+		cstate->cur_lineno++;
+		(void) CopyReadLine(cstate);
+	}
+
+	return true;
+}
+
+/*
+ * Find the offset of the first line of a COPY FROM file that starts at or
+ * after 'offset', for CopyFromSetRange.  That is just past the first newline
+ * at or after offset - 1 that ends a line, which in text mode it doesn't if
+ * it is escaped with a backslash.  Returns the size of the file if there is
+ * no such line.
+ *
+ * This looks at raw bytes, so the input must not be in an encoding where a
+ * backslash or newline byte can be part of a multibyte character; see
+ * encoding_embeds_ascii.
+ */
+static off_t
+CopyFindLineStart(CopyState cstate, off_t offset)
+{
+	FILE	   *fp = cstate->copy_file;
+	off_t		pos = offset - 1;
+	bool		escaped = false;
+	int			c;
+
+	/*
+	 * In text mode, whether a newline is escaped depends on the whole run of
+	 * backslashes before it, so start from the beginning of any run that
+	 * ends at pos.
+	 */
+	if (!cstate->csv_mode)
+	{
+		while (pos > 0)
+		{
+			if (fseeko(fp, pos - 1, SEEK_SET) != 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not seek in COPY file: %m")));
+			if (getc(fp) != '\\')
+				break;
+			pos--;
+		}
+	}
+
+	if (fseeko(fp, pos, SEEK_SET) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not seek in COPY file: %m")));
+
+	while ((c = getc(fp)) != EOF)
+	{
+		if (escaped)
+			escaped = false;
+		else if (c == '\\' && !cstate->csv_mode)
+			escaped = true;
+		else if (c == '\n' && pos >= offset - 1)
+			return pos + 1;
+		pos++;
+	}
+	if (ferror(fp))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from COPY file: %m")));
+
+	return pos;
+}
+
 /*
  * Read raw fields in the next line for COPY FROM in text or csv mode.
  * Return false if no more lines.
@@ -3644,26 +5420,45 @@ NextCopyFromRawFields(CopyState cstate, char ***fields, int *nfields)
 	/* only available for text or csv input */
 	Assert(!cstate->binary);
 
-	/* on input just throw the header line away */
-	if (cstate->cur_lineno == 0 && cstate->header_line)
+	if (cstate->pcopy_mqh != NULL)
 	{
-		cstate->cur_lineno++;
-		if (CopyReadLine(cstate))
+		/* the leader has already split the input into lines */
+		if (ParallelCopyReadLine(cstate))
 			return false;		/* done */
 	}
+	else
+	{
+		/* on input just throw the header line away */
+		if (cstate->cur_lineno == 0 && cstate->header_line)
+		{
+			cstate->cur_lineno++;
+			if (CopyReadLine(cstate))
+				return false;	/* done */
+		}
 
-	cstate->cur_lineno++;
+		/*
+		 * Stop at the end of the range set by CopyFromSetRange.  Ranges are
+		 * delimited by newlines, so if the lines end with bare carriage
+		 * returns instead, the first range has to take the whole file.
+		 */
+		if (cstate->range_end >= 0 &&
+			cstate->raw_file_pos - RAW_BUF_BYTES(cstate) >= cstate->range_end &&
+			cstate->eol_type != EOL_CR)
+			return false;
+
+		cstate->cur_lineno++;
 
-	/* Actually read the line into memory here */
-	done = CopyReadLine(cstate);
+		/* Actually read the line into memory here */
+		done = CopyReadLine(cstate);
 
-	/*
-	 * EOF at start of line means we're done.  If we see EOF after some
-	 * characters, we act as though it was newline followed by EOF, ie,
-	 * process the line and then exit loop on next iteration.
-	 */
-	if (done && cstate->line_buf.len == 0)
-		return false;
+		/*
+		 * EOF at start of line means we're done.  If we see EOF after some
+		 * characters, we act as though it was newline followed by EOF, ie,
+		 * process the line and then exit loop on next iteration.
+		 */
+		if (done && cstate->line_buf.len == 0)
+			return false;
+	}
 
 	/* Parse the line into de-escaped field values */
 	if (cstate->csv_mode)
@@ -3843,6 +5638,7 @@ NextCopyFrom(CopyState cstate, ExprContext *econtext,
 												&in_functions[m],
 												typioparams[m],
 												att->atttypmod,
+												cstate->binary_types[m],
 												&nulls[m]);
 			cstate->cur_attname = NULL;
 		}
@@ -3974,6 +5770,54 @@ CopyReadLine(CopyState cstate)
 	return result;
 }
 
+/*
+ * Return how many bytes at the start of 's', which has 'len' bytes, are
+ * none of c1 to c4 and, if 'highbit', don't have their high bit set.  These
+ * are the bytes that the parsing loops below can pass over without looking
+ * at them individually.
+ *
+ * This works a vector at a time, so it may stop short of the first special
+ * byte within the last sizeof(Vector8) bytes; the caller's byte-at-a-time
+ * loop takes care of those.  Without SIMD support it always returns 0.
+ */
+static inline int
+CopySkipPlainBytes(const char *s, int len, char c1, char c2, char c3, char c4,
+				   bool highbit)
+{
+	int			i = 0;
+
+#ifndef USE_NO_SIMD
+	if (len >= (int) sizeof(Vector8))
+	{
+		const Vector8 v1 = vector8_broadcast((uint8) c1);
+		const Vector8 v2 = vector8_broadcast((uint8) c2);
+		const Vector8 v3 = vector8_broadcast((uint8) c3);
+		const Vector8 v4 = vector8_broadcast((uint8) c4);
+
+		for (; i <= len - (int) sizeof(Vector8); i += sizeof(Vector8))
+		{
+			Vector8		chunk;
+			Vector8		special;
+			uint32		mask;
+
+			vector8_load(&chunk, (const uint8 *) s + i);
+			special = vector8_or(vector8_or(vector8_eq(chunk, v1),
+											vector8_eq(chunk, v2)),
+								 vector8_or(vector8_eq(chunk, v3),
+											vector8_eq(chunk, v4)));
+			if (highbit)
+				special = vector8_or(special, chunk);
+
+			mask = vector8_highbit_mask(special);
+			if (mask != 0)
+				return i + pg_rightmost_one_pos32(mask);
+		}
+	}
+#endif
+
+	return i;
+}
+
 /*
  * CopyReadLineText - inner loop of CopyReadLine for text mode
  */
@@ -4071,6 +5915,37 @@ CopyReadLineText(CopyState cstate)
 			need_data = false;
 		}
 
+		/*
+		 * Pass over a run of bytes that need none of the processing below, a
+		 * vector at a time where possible.  Those are the bytes that can't
+		 * end the line, start an end-of-copy marker, change the CSV quoting
+		 * state, or start a multi-byte character we have to step over.  In
+		 * CSV mode a backslash is only special at the start of a line, so we
+		 * leave that to the byte-at-a-time code.
+		 */
+		if (!first_char_in_line || !cstate->csv_mode)
+		{
+			int			skip;
+
+			if (cstate->csv_mode)
+				skip = CopySkipPlainBytes(copy_raw_buf + raw_buf_ptr,
+										  copy_buf_len - raw_buf_ptr,
+										  '\n', '\r', quotec, escapec,
+										  cstate->encoding_embeds_ascii);
+			else
+				skip = CopySkipPlainBytes(copy_raw_buf + raw_buf_ptr,
+										  copy_buf_len - raw_buf_ptr,
+										  '\n', '\r', '\\', '\\',
+										  cstate->encoding_embeds_ascii);
+			if (skip > 0)
+			{
+				raw_buf_ptr += skip;
+				first_char_in_line = false;
+				last_was_esc = false;
+				continue;
+			}
+		}
+
 		/* OK to fetch a character */
 		prev_raw_ptr = raw_buf_ptr;
 		c = copy_raw_buf[raw_buf_ptr++];
@@ -4444,6 +6319,17 @@ CopyReadAttributesText(CopyState cstate)
 		for (;;)
 		{
 			char		c;
+			int			nplain;
+
+			/* Copy a run of bytes that need no de-escaping in one go */
+			nplain = CopySkipPlainBytes(cur_ptr, line_end_ptr - cur_ptr,
+										delimc, '\\', '\\', '\\', false);
+			if (nplain > 0)
+			{
+				memcpy(output_ptr, cur_ptr, nplain);
+				output_ptr += nplain;
+				cur_ptr += nplain;
+			}
 
 			end_ptr = cur_ptr;
 			if (cur_ptr >= line_end_ptr)
@@ -4674,6 +6560,19 @@ CopyReadAttributesCSV(CopyState cstate)
 			/* Not in quote */
 			for (;;)
 			{
+				int			nplain;
+
+				/* Copy a run of bytes that are neither delimiter nor quote */
+				nplain = CopySkipPlainBytes(cur_ptr, line_end_ptr - cur_ptr,
+											delimc, quotec, quotec, quotec,
+											false);
+				if (nplain > 0)
+				{
+					memcpy(output_ptr, cur_ptr, nplain);
+					output_ptr += nplain;
+					cur_ptr += nplain;
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					goto endfield;
@@ -4697,6 +6596,19 @@ CopyReadAttributesCSV(CopyState cstate)
 			/* In quote */
 			for (;;)
 			{
+				int			nplain;
+
+				/* Copy a run of bytes that are neither escape nor quote */
+				nplain = CopySkipPlainBytes(cur_ptr, line_end_ptr - cur_ptr,
+											escapec, quotec, quotec, quotec,
+											false);
+				if (nplain > 0)
+				{
+					memcpy(output_ptr, cur_ptr, nplain);
+					output_ptr += nplain;
+					cur_ptr += nplain;
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					ereport(ERROR,
@@ -4763,13 +6675,237 @@ endfield:
 }
 
 
+/*
+ * Identify the built-in types whose binary format CopyBinaryToDatum and
+ * CopySendBinaryDatum handle, given the column type's receive or send
+ * function.  Domains have their own receive function, so they're never
+ * converted directly.
+ */
+static CopyBinaryType
+CopyGetBinaryType(Oid func_oid, int32 typmod)
+{
+	switch (func_oid)
+	{
+		case F_BOOLRECV:
+		case F_BOOLSEND:
+			return COPY_BINARY_BOOL;
+		case F_INT2RECV:
+		case F_INT2SEND:
+			return COPY_BINARY_INT2;
+		case F_INT4RECV:
+		case F_INT4SEND:
+			return COPY_BINARY_INT4;
+		case F_OIDRECV:
+		case F_OIDSEND:
+			return COPY_BINARY_OID;
+		case F_INT8RECV:
+		case F_INT8SEND:
+			return COPY_BINARY_INT8;
+		case F_FLOAT4RECV:
+		case F_FLOAT4SEND:
+			return COPY_BINARY_FLOAT4;
+		case F_FLOAT8RECV:
+		case F_FLOAT8SEND:
+			return COPY_BINARY_FLOAT8;
+		case F_DATE_RECV:
+		case F_DATE_SEND:
+			return COPY_BINARY_DATE;
+		case F_TIMESTAMP_RECV:
+		case F_TIMESTAMPTZ_RECV:
+			/* leave rounding to a typmod's precision to the function */
+			if (typmod >= 0)
+				return COPY_BINARY_GENERIC;
+			return COPY_BINARY_TIMESTAMP;
+		case F_TIMESTAMP_SEND:
+		case F_TIMESTAMPTZ_SEND:
+			return COPY_BINARY_TIMESTAMP;
+		case F_UUID_RECV:
+		case F_UUID_SEND:
+			return COPY_BINARY_UUID;
+		default:
+			return COPY_BINARY_GENERIC;
+	}
+}
+
+/*
+ * Convert the binary representation of a value of one of the types
+ * recognized by CopyGetBinaryType, which must be CopyBinaryTypeSize[btype]
+ * bytes at 'buf', the same way its receive function would.
+ *
+ * Returns false if the value should be passed to the receive function
+ * after all, which is where out-of-range dates and timestamps get their
+ * error.
+ */
+static bool
+CopyBinaryToDatum(CopyBinaryType btype, const char *buf, Datum *result)
+{
+	uint16		u16;
+	uint32		u32;
+	uint64		u64;
+
+	switch (btype)
+	{
+		case COPY_BINARY_BOOL:
+			*result = BoolGetDatum(buf[0] != 0);
+			return true;
+		case COPY_BINARY_INT2:
+			memcpy(&u16, buf, sizeof(u16));
+			*result = Int16GetDatum((int16) pg_ntoh16(u16));
+			return true;
+		case COPY_BINARY_INT4:
+			memcpy(&u32, buf, sizeof(u32));
+			*result = Int32GetDatum((int32) pg_ntoh32(u32));
+			return true;
+		case COPY_BINARY_OID:
+			memcpy(&u32, buf, sizeof(u32));
+			*result = ObjectIdGetDatum((Oid) pg_ntoh32(u32));
+			return true;
+		case COPY_BINARY_INT8:
+			memcpy(&u64, buf, sizeof(u64));
+			*result = Int64GetDatum((int64) pg_ntoh64(u64));
+			return true;
+		case COPY_BINARY_FLOAT4:
+			{
+				union
+				{
+					float4		f;
+					uint32		i;
+				}			swap;
+
+				memcpy(&u32, buf, sizeof(u32));
+				swap.i = pg_ntoh32(u32);
+				*result = Float4GetDatum(swap.f);
+				return true;
+			}
+		case COPY_BINARY_FLOAT8:
+			{
+				union
+				{
+					float8		f;
+					uint64		i;
+				}			swap;
+
+				memcpy(&u64, buf, sizeof(u64));
+				swap.i = pg_ntoh64(u64);
+				*result = Float8GetDatum(swap.f);
+				return true;
+			}
+		case COPY_BINARY_DATE:
+			{
+				DateADT		date;
+
+				memcpy(&u32, buf, sizeof(u32));
+				date = (DateADT) pg_ntoh32(u32);
+				if (!DATE_NOT_FINITE(date) && !IS_VALID_DATE(date))
+					return false;
+				*result = DateADTGetDatum(date);
+				return true;
+			}
+		case COPY_BINARY_TIMESTAMP:
+			{
+				Timestamp	timestamp;
+
+				memcpy(&u64, buf, sizeof(u64));
+				timestamp = (Timestamp) pg_ntoh64(u64);
+				if (!TIMESTAMP_NOT_FINITE(timestamp) &&
+					!IS_VALID_TIMESTAMP(timestamp))
+					return false;
+				*result = TimestampGetDatum(timestamp);
+				return true;
+			}
+		case COPY_BINARY_UUID:
+			{
+				pg_uuid_t  *uuid = (pg_uuid_t *) palloc(UUID_LEN);
+
+				memcpy(uuid->data, buf, UUID_LEN);
+				*result = UUIDPGetDatum(uuid);
+				return true;
+			}
+		case COPY_BINARY_GENERIC:
+			break;
+	}
+
+	return false;
+}
+
+/*
+ * Send a value of one of the types recognized by CopyGetBinaryType, with
+ * its length word, in the format of the type's send function.
+ */
+static void
+CopySendBinaryDatum(CopyState cstate, CopyBinaryType btype, Datum value)
+{
+	uint64		u64;
+
+	CopySendInt32(cstate, CopyBinaryTypeSize[btype]);
+
+	switch (btype)
+	{
+		case COPY_BINARY_BOOL:
+			CopySendChar(cstate, DatumGetBool(value) ? 1 : 0);
+			break;
+		case COPY_BINARY_INT2:
+			CopySendInt16(cstate, DatumGetInt16(value));
+			break;
+		case COPY_BINARY_INT4:
+			CopySendInt32(cstate, DatumGetInt32(value));
+			break;
+		case COPY_BINARY_OID:
+			CopySendInt32(cstate, (int32) DatumGetObjectId(value));
+			break;
+		case COPY_BINARY_DATE:
+			CopySendInt32(cstate, DatumGetDateADT(value));
+			break;
+		case COPY_BINARY_INT8:
+		case COPY_BINARY_TIMESTAMP:
+			/* timestamps are int64 whether or not pass-by-value */
+			u64 = pg_hton64((uint64) DatumGetInt64(value));
+			CopySendData(cstate, &u64, sizeof(u64));
+			break;
+		case COPY_BINARY_FLOAT4:
+			{
+				union
+				{
+					float4		f;
+					uint32		i;
+				}			swap;
+
+				swap.f = DatumGetFloat4(value);
+				CopySendInt32(cstate, (int32) swap.i);
+				break;
+			}
+		case COPY_BINARY_FLOAT8:
+			{
+				union
+				{
+					float8		f;
+					uint64		i;
+				}			swap;
+
+				swap.f = DatumGetFloat8(value);
+				u64 = pg_hton64(swap.i);
+				CopySendData(cstate, &u64, sizeof(u64));
+				break;
+			}
+		case COPY_BINARY_UUID:
+			CopySendData(cstate, DatumGetUUIDP(value)->data, UUID_LEN);
+			break;
+		case COPY_BINARY_GENERIC:
+			elog(ERROR, "unexpected binary COPY type %d", (int) btype);
+			break;
+	}
+}
+
 /*
  * Read a binary attribute
+ *
+ * 'btype' says whether the value can be converted by CopyBinaryToDatum,
+ * sparing the copy into attribute_buf and the receive function call.
  */
 static Datum
 CopyReadBinaryAttribute(CopyState cstate, FmgrInfo *flinfo,
 						Oid typioparam, int32 typmod,
-						bool *isnull)
+						CopyBinaryType btype, bool *isnull)
 {
 	int32		fld_size;
 	Datum		result;
@@ -4788,18 +6924,41 @@ CopyReadBinaryAttribute(CopyState cstate, FmgrInfo *flinfo,
 				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
 				 errmsg("invalid field size")));
 
-	/* reset attribute_buf to empty, and load raw data in it */
+	/* reset attribute_buf to empty */
 	resetStringInfo(&cstate->attribute_buf);
 
-	enlargeStringInfo(&cstate->attribute_buf, fld_size);
-	if (CopyReadBinaryData(cstate, cstate->attribute_buf.data,
-						   fld_size) != fld_size)
-		ereport(ERROR,
-				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
-				 errmsg("unexpected EOF in COPY data")));
+	if (btype != COPY_BINARY_GENERIC &&
+		fld_size == CopyBinaryTypeSize[btype])
+	{
+		char		buf[MAX_COPY_BINARY_TYPE_SIZE];
+
+		if (CopyReadBinaryData(cstate, buf, fld_size) != fld_size)
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("unexpected EOF in COPY data")));
+
+		if (CopyBinaryToDatum(btype, buf, &result))
+		{
+			*isnull = false;
+			return result;
+		}
+
+		/* let the receive function report the problem */
+		appendBinaryStringInfo(&cstate->attribute_buf, buf, fld_size);
+	}
+	else
+	{
+		/* load raw data into attribute_buf */
+		enlargeStringInfo(&cstate->attribute_buf, fld_size);
+		if (CopyReadBinaryData(cstate, cstate->attribute_buf.data,
+							   fld_size) != fld_size)
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("unexpected EOF in COPY data")));
 
-	cstate->attribute_buf.len = fld_size;
-	cstate->attribute_buf.data[fld_size] = '\0';
+		cstate->attribute_buf.len = fld_size;
+		cstate->attribute_buf.data[fld_size] = '\0';
+	}
 
 	/* Call the column type's binary input converter */
 	result = ReceiveFunctionCall(flinfo, &cstate->attribute_buf,
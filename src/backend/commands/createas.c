@@ -66,6 +66,7 @@ typedef struct
 /* utility functions for CTAS definition creation */
 static ObjectAddress create_ctas_internal(List *attrList, IntoClause *into);
 static ObjectAddress create_ctas_nodata(List *tlist, IntoClause *into);
+static bool is_incremental_matview(IntoClause *into);
 
 /* DestReceiver routines for collecting data */
 static void intorel_startup(DestReceiver *self, int operation, TupleDesc typeinfo);
@@ -142,12 +143,46 @@ create_ctas_internal(List *attrList, IntoClause *into)
 
 		StoreViewQuery(intoRelationAddr.objectId, query, false);
 		CommandCounterIncrement();
+
+		/*
+		 * Set up incremental maintenance, if wanted.  ExecCreateTableAs has
+		 * checked the query already, but EXPLAIN ANALYZE gets here without
+		 * passing through there.
+		 */
+		if (is_incremental_matview(into))
+		{
+			CheckIncrementalMatViewQuery((Query *) into->viewQuery);
+			CreateIncrementalMatViewTriggers(intoRelationAddr.objectId,
+											 (Query *) into->viewQuery);
+		}
 	}
 
 	return intoRelationAddr;
 }
 
 
+/*
+ * is_incremental_matview
+ *
+ * Does the WITH clause of a materialized view ask for incremental
+ * maintenance?
+ */
+static bool
+is_incremental_matview(IntoClause *into)
+{
+	static char *validnsps[] = HEAP_RELOPT_NAMESPACES;
+	StdRdOptions *options;
+
+	options = (StdRdOptions *)
+		heap_reloptions(RELKIND_MATVIEW,
+						transformRelOptions((Datum) 0, into->options,
+											NULL, validnsps, true, false),
+						true);
+
+	return options != NULL && options->incremental;
+}
+
+
 /*
  * create_ctas_nodata
  *
@@ -230,6 +265,7 @@ ExecCreateTableAs(ParseState *pstate, CreateTableAsStmt *stmt,
 	Query	   *query = castNode(Query, stmt->query);
 	IntoClause *into = stmt->into;
 	bool		is_matview = (into->viewQuery != NULL);
+	bool		incremental = false;
 	DestReceiver *dest;
 	Oid			save_userid = InvalidOid;
 	int			save_sec_context = 0;
@@ -255,6 +291,17 @@ ExecCreateTableAs(ParseState *pstate, CreateTableAsStmt *stmt,
 		}
 	}
 
+	/*
+	 * If the materialized view is to be maintained incrementally, make sure
+	 * we know how before doing any work.  This also locks the base tables
+	 * against changes until its triggers are in place.
+	 */
+	if (is_matview && is_incremental_matview(into))
+	{
+		incremental = true;
+		CheckIncrementalMatViewQuery((Query *) into->viewQuery);
+	}
+
 	/*
 	 * Create the tuple receiver object and insert info it will need
 	 */
@@ -338,8 +385,13 @@ ExecCreateTableAs(ParseState *pstate, CreateTableAsStmt *stmt,
 		 * matter if the planner executed an allegedly-stable function that
 		 * changed the database contents, but let's do it anyway to be
 		 * parallel to the EXPLAIN code path.)
+		 *
+		 * An incrementally maintained matview must also see all base table
+		 * changes committed before we locked the tables, as its triggers
+		 * won't; in READ COMMITTED mode, that takes a new snapshot.
 		 */
-		PushCopiedSnapshot(GetActiveSnapshot());
+		PushCopiedSnapshot(incremental ? GetTransactionSnapshot() :
+						   GetActiveSnapshot());
 		UpdateActiveSnapshotCommandId();
 
 		/* Create a QueryDesc, redirecting output to our tuple receiver */
@@ -551,7 +603,7 @@ intorel_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
 	myState->rel = intoRelationDesc;
 	myState->reladdr = intoRelationAddr;
 	myState->output_cid = GetCurrentCommandId(true);
-	myState->ti_options = TABLE_INSERT_SKIP_FSM;
+	myState->ti_options = TABLE_INSERT_SKIP_FSM | TABLE_INSERT_BULK_WRITE;
 	myState->bistate = GetBulkInsertState();
 
 	/*
@@ -45,6 +45,7 @@
 #include "commands/dbcommands_xlog.h"
 #include "commands/defrem.h"
 #include "commands/seclabel.h"
+#include "commands/sequence.h"
 #include "commands/tablespace.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
@@ -52,16 +53,19 @@
 #include "postmaster/bgwriter.h"
 #include "replication/slot.h"
 #include "storage/copydir.h"
+#include "storage/doublewrite.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/lmgr.h"
 #include "storage/md.h"
 #include "storage/procarray.h"
+#include "storage/relsize.h"
 #include "storage/smgr.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/fmgroids.h"
 #include "utils/pg_locale.h"
+#include "utils/sharedcatcache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -970,6 +974,16 @@ dropdb(const char *dbname, bool missing_ok, bool force)
 	 */
 	DropDatabaseBuffers(db_id);
 
+	/*
+	 * Likewise, forget its shared catalog cache entries, cached relation
+	 * sizes and sequence values, and copies of its pages in the
+	 * double-write file.
+	 */
+	SharedCatCacheDropDatabase(db_id);
+	RelSizeCacheForgetDatabase(db_id);
+	SequenceCacheForgetDatabase(db_id);
+	DoubleWriteForgetDatabase(db_id);
+
 	/*
 	 * Tell the stats collector to forget it immediately, too.
 	 */
@@ -1256,6 +1270,14 @@ movedb(const char *dbname, const char *tblspcname)
 	 */
 	DropDatabaseBuffers(db_id);
 
+	/*
+	 * The cached sizes of its relations in the old tablespace would likewise
+	 * appear valid again, and copies of their pages in the double-write file
+	 * would refer to files that are about to be removed.
+	 */
+	RelSizeCacheForgetDatabase(db_id);
+	DoubleWriteForgetDatabase(db_id);
+
 	/*
 	 * Check for existence of files in the target directory, i.e., objects of
 	 * this database that are already in the target tablespace.  We can't
@@ -2245,6 +2267,14 @@ dbase_redo(XLogReaderState *record)
 		/* Drop pages for this database that are in the shared buffer cache */
 		DropDatabaseBuffers(xlrec->db_id);
 
+		/*
+		 * And its shared catalog cache entries, cached relation sizes and
+		 * double-written pages
+		 */
+		SharedCatCacheDropDatabase(xlrec->db_id);
+		RelSizeCacheForgetDatabase(xlrec->db_id);
+		DoubleWriteForgetDatabase(xlrec->db_id);
+
 		/* Also, clean out any fsync requests that might be pending in md.c */
 		ForgetDatabaseSyncRequests(xlrec->db_id);
 
@@ -19,6 +19,7 @@
 #include "commands/discard.h"
 #include "commands/prepare.h"
 #include "commands/sequence.h"
+#include "postmaster/proxy.h"
 #include "utils/guc.h"
 #include "utils/portal.h"
 
@@ -75,4 +76,5 @@ DiscardAll(bool isTopLevel)
 	ResetPlanCache();
 	ResetTempTableNamespace();
 	ResetSequenceCaches();
+	ResetSessionPoolability();
 }
@@ -96,6 +96,8 @@ static void show_grouping_set_keys(PlanState *planstate,
 								   List *ancestors, ExplainState *es);
 static void show_group_keys(GroupState *gstate, List *ancestors,
 							ExplainState *es);
+static void show_repartition_keys(RepartitionState *rpstate, List *ancestors,
+								  ExplainState *es);
 static void show_sort_group_keys(PlanState *planstate, const char *qlabel,
 								 int nkeys, int nPresortedKeys, AttrNumber *keycols,
 								 Oid *sortOperators, Oid *collations, bool *nullsFirst,
@@ -109,6 +111,8 @@ static void show_incremental_sort_info(IncrementalSortState *incrsortstate,
 									   ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
 static void show_hashagg_info(AggState *hashstate, ExplainState *es);
+static void show_resultcache_info(ResultCacheState *rcstate, List *ancestors,
+								  ExplainState *es);
 static void show_tidbitmap_info(BitmapHeapScanState *planstate,
 								ExplainState *es);
 static void show_instrumentation_count(const char *qlabel, int which,
@@ -190,6 +194,17 @@ ExplainQuery(ParseState *pstate, ExplainStmt *stmt,
 			timing_set = true;
 			es->timing = defGetBoolean(opt);
 		}
+		else if (strcmp(opt->defname, "timing_sample") == 0)
+		{
+			es->timing_sample = defGetInt32(opt);
+			if (es->timing_sample < 1 ||
+				es->timing_sample > INSTRUMENT_SAMPLE_MAX)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("EXPLAIN option TIMING_SAMPLE must be between 1 and %d",
+								INSTRUMENT_SAMPLE_MAX),
+						 parser_errposition(pstate, opt->location)));
+		}
 		else if (strcmp(opt->defname, "summary") == 0)
 		{
 			summary_set = true;
@@ -236,6 +251,11 @@ ExplainQuery(ParseState *pstate, ExplainStmt *stmt,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("EXPLAIN option TIMING requires ANALYZE")));
 
+	if (es->timing_sample > 1 && !es->timing)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("EXPLAIN option TIMING_SAMPLE requires TIMING")));
+
 	/* if the summary was not set explicitly, set default value */
 	es->summary = (summary_set) ? es->summary : es->analyze;
 
@@ -508,7 +528,8 @@ ExplainOnePlan(PlannedStmt *plannedstmt, IntoClause *into, ExplainState *es,
 	Assert(plannedstmt->commandType != CMD_UTILITY);
 
 	if (es->analyze && es->timing)
-		instrument_option |= INSTRUMENT_TIMER;
+		instrument_option |= INSTRUMENT_TIMER |
+			INSTRUMENT_SAMPLE(es->timing_sample);
 	else if (es->analyze)
 		instrument_option |= INSTRUMENT_ROWS;
 
@@ -1120,6 +1141,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 	ExplainWorkersState *save_workers_state = es->workers_state;
 	int			save_indent = es->indent;
 	bool		haschildren;
+	Instrumentation *instrument;
+	Instrumentation running_instrument;
 
 	/*
 	 * Prepare per-worker output buffers, if needed.  We'll append the data in
@@ -1267,6 +1290,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Material:
 			pname = sname = "Materialize";
 			break;
+		case T_ResultCache:
+			pname = sname = "Result Cache";
+			break;
 		case T_Sort:
 			pname = sname = "Sort";
 			break;
@@ -1352,6 +1378,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Hash:
 			pname = sname = "Hash";
 			break;
+		case T_Repartition:
+			pname = sname = "Repartition";
+			break;
 		default:
 			pname = sname = "???";
 			break;
@@ -1377,6 +1406,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		}
 		if (plan->parallel_aware)
 			appendStringInfoString(es->str, "Parallel ");
+		if (plan->async_capable)
+			appendStringInfoString(es->str, "Async ");
 		appendStringInfoString(es->str, pname);
 		es->indent++;
 	}
@@ -1396,6 +1427,7 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		if (custom_name)
 			ExplainPropertyText("Custom Plan Provider", custom_name, es);
 		ExplainPropertyBool("Parallel Aware", plan->parallel_aware, es);
+		ExplainPropertyBool("Async Capable", plan->async_capable, es);
 	}
 
 	switch (nodeTag(plan))
@@ -1561,16 +1593,29 @@ ExplainNode(PlanState *planstate, List *ancestors,
 	 * InstrEndLoop call anyway, if possible, to reduce the number of cases
 	 * auto_explain has to contend with.
 	 */
-	if (planstate->instrument)
-		InstrEndLoop(planstate->instrument);
+	instrument = planstate->instrument;
+	if (instrument && es->running)
+	{
+		/*
+		 * The plan is still being executed, so leave its instrumentation
+		 * alone, and summarize a copy in which the current loop counts as
+		 * done so far.  Its timing of the current call, if any, is lost.
+		 */
+		running_instrument = *instrument;
+		instrument = &running_instrument;
+		INSTR_TIME_SET_ZERO(instrument->starttime);
+		InstrEndLoop(instrument);
+	}
+	else if (instrument)
+		InstrEndLoop(instrument);
 
 	if (es->analyze &&
-		planstate->instrument && planstate->instrument->nloops > 0)
+		instrument && instrument->nloops > 0)
 	{
-		double		nloops = planstate->instrument->nloops;
-		double		startup_ms = 1000.0 * planstate->instrument->startup / nloops;
-		double		total_ms = 1000.0 * planstate->instrument->total / nloops;
-		double		rows = planstate->instrument->ntuples / nloops;
+		double		nloops = instrument->nloops;
+		double		startup_ms = 1000.0 * instrument->startup / nloops;
+		double		total_ms = 1000.0 * instrument->total / nloops;
+		double		rows = instrument->ntuples / nloops;
 
 		if (es->format == EXPLAIN_FORMAT_TEXT)
 		{
@@ -1598,7 +1643,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 	}
 	else if (es->analyze)
 	{
-		if (es->format == EXPLAIN_FORMAT_TEXT)
+		if (es->format == EXPLAIN_FORMAT_TEXT && es->running)
+			appendStringInfoString(es->str, " (no rows yet)");
+		else if (es->format == EXPLAIN_FORMAT_TEXT)
 			appendStringInfoString(es->str, " (never executed)");
 		else
 		{
@@ -1751,6 +1798,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			if (IsA(plan, SeqScan) &&
+				((SeqScan *) plan)->numHashFilterCols > 0)
+				show_instrumentation_count("Rows Removed by Bloom Filter", 2,
+										   planstate, es);
 			break;
 		case T_Gather:
 			{
@@ -1958,6 +2009,14 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Hash:
 			show_hash_info(castNode(HashState, planstate), es);
 			break;
+		case T_Repartition:
+			show_repartition_keys(castNode(RepartitionState, planstate),
+								  ancestors, es);
+			break;
+		case T_ResultCache:
+			show_resultcache_info(castNode(ResultCacheState, planstate),
+								  ancestors, es);
+			break;
 		default:
 			break;
 	}
@@ -2461,6 +2520,24 @@ show_group_keys(GroupState *gstate, List *ancestors,
 	ancestors = list_delete_first(ancestors);
 }
 
+/*
+ * Show the partition keys of a Repartition node.
+ */
+static void
+show_repartition_keys(RepartitionState *rpstate, List *ancestors,
+					  ExplainState *es)
+{
+	Repartition *plan = (Repartition *) rpstate->ps.plan;
+
+	/* The key columns refer to the tlist of the child plan */
+	ancestors = lcons(plan, ancestors);
+	show_sort_group_keys(outerPlanState(rpstate), "Partition Key",
+						 plan->numCols, 0, plan->partColIdx,
+						 NULL, NULL, NULL,
+						 ancestors, es);
+	ancestors = list_delete_first(ancestors);
+}
+
 /*
  * Common code to show sort/group keys, which are represented in plan nodes
  * as arrays of targetlist indexes.  If it's a sort key rather than a group
@@ -3153,6 +3230,155 @@ show_hashagg_info(AggState *aggstate, ExplainState *es)
 	}
 }
 
+/*
+ * Show the cache key of a Result Cache node and, if it's EXPLAIN ANALYZE,
+ * its hit and miss counts and the peak memory used by the cache.
+ */
+static void
+show_resultcache_info(ResultCacheState *rcstate, List *ancestors,
+					  ExplainState *es)
+{
+	Plan	   *plan = ((PlanState *) rcstate)->plan;
+	ListCell   *lc;
+	List	   *context;
+	StringInfoData keystr;
+	char	   *separator = "";
+	bool		useprefix;
+	int64		memPeakKb;
+
+	initStringInfo(&keystr);
+
+	/*
+	 * It's hard to imagine having a result cache with fewer than 2 RTEs, but
+	 * let's just keep the same useprefix logic as elsewhere in this file.
+	 */
+	useprefix = list_length(es->rtable) > 1 || es->verbose;
+
+	/* Set up deparsing context */
+	context = set_deparse_context_plan(es->deparse_cxt,
+									   plan,
+									   ancestors);
+
+	foreach(lc, ((ResultCache *) plan)->param_exprs)
+	{
+		Node	   *expr = (Node *) lfirst(lc);
+
+		appendStringInfoString(&keystr, separator);
+
+		appendStringInfoString(&keystr, deparse_expression(expr, context,
+														   useprefix, false));
+		separator = ", ";
+	}
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyText("Cache Key", keystr.data, es);
+	}
+	else
+	{
+		ExplainIndentText(es);
+		appendStringInfo(es->str, "Cache Key: %s\n", keystr.data);
+	}
+
+	pfree(keystr.data);
+
+	if (!es->analyze)
+		return;
+
+	/*
+	 * mem_peak is only set when we freed memory, so we must use mem_used
+	 * when mem_peak is 0.
+	 */
+	if (rcstate->stats.mem_peak > 0)
+		memPeakKb = (rcstate->stats.mem_peak + 1023) / 1024;
+	else
+		memPeakKb = (rcstate->mem_used + 1023) / 1024;
+
+	/*
+	 * During parallel query the leader may have not helped out.  We detect
+	 * this by checking how many lookups it did.  If we find it didn't do any
+	 * work then we don't show its properties.
+	 */
+	if (rcstate->stats.cache_misses > 0)
+	{
+		if (es->format != EXPLAIN_FORMAT_TEXT)
+		{
+			ExplainPropertyInteger("Cache Hits", NULL,
+								   rcstate->stats.cache_hits, es);
+			ExplainPropertyInteger("Cache Misses", NULL,
+								   rcstate->stats.cache_misses, es);
+			ExplainPropertyInteger("Cache Evictions", NULL,
+								   rcstate->stats.cache_evictions, es);
+			ExplainPropertyInteger("Cache Overflows", NULL,
+								   rcstate->stats.cache_overflows, es);
+			ExplainPropertyInteger("Peak Memory Usage", "kB", memPeakKb, es);
+		}
+		else
+		{
+			ExplainIndentText(es);
+			appendStringInfo(es->str,
+							 "Hits: " UINT64_FORMAT "  Misses: " UINT64_FORMAT "  Evictions: " UINT64_FORMAT "  Overflows: " UINT64_FORMAT "  Memory Usage: " INT64_FORMAT "kB\n",
+							 rcstate->stats.cache_hits,
+							 rcstate->stats.cache_misses,
+							 rcstate->stats.cache_evictions,
+							 rcstate->stats.cache_overflows,
+							 memPeakKb);
+		}
+	}
+
+	if (rcstate->shared_info == NULL)
+		return;
+
+	/* Show details from parallel workers */
+	for (int n = 0; n < rcstate->shared_info->num_workers; n++)
+	{
+		ResultCacheInstrumentation *si;
+
+		si = &rcstate->shared_info->sinstrument[n];
+
+		/* Skip workers that didn't do anything */
+		if (si->cache_misses == 0)
+			continue;
+
+		if (es->workers_state)
+			ExplainOpenWorker(n, es);
+
+		/*
+		 * Since the worker's ResultCacheState.mem_used field is unavailable
+		 * to us, ExecEndResultCache will have set the
+		 * ResultCacheInstrumentation.mem_peak field for us.  No need to do
+		 * the zero checks like we did for the serial case above.
+		 */
+		memPeakKb = (si->mem_peak + 1023) / 1024;
+
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+		{
+			ExplainIndentText(es);
+			appendStringInfo(es->str,
+							 "Hits: " UINT64_FORMAT "  Misses: " UINT64_FORMAT "  Evictions: " UINT64_FORMAT "  Overflows: " UINT64_FORMAT "  Memory Usage: " INT64_FORMAT "kB\n",
+							 si->cache_hits, si->cache_misses,
+							 si->cache_evictions, si->cache_overflows,
+							 memPeakKb);
+		}
+		else
+		{
+			ExplainPropertyInteger("Cache Hits", NULL,
+								   si->cache_hits, es);
+			ExplainPropertyInteger("Cache Misses", NULL,
+								   si->cache_misses, es);
+			ExplainPropertyInteger("Cache Evictions", NULL,
+								   si->cache_evictions, es);
+			ExplainPropertyInteger("Cache Overflows", NULL,
+								   si->cache_overflows, es);
+			ExplainPropertyInteger("Peak Memory Usage", "kB", memPeakKb,
+								   es);
+		}
+
+		if (es->workers_state)
+			ExplainCloseWorker(n, es);
+	}
+}
+
 /*
  * If it's EXPLAIN ANALYZE, show exact/lossy pages for a BitmapHeapScan node
  */
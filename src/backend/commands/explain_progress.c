@@ -0,0 +1,446 @@
+/*-------------------------------------------------------------------------
+ *
+ * explain_progress.c
+ *	  Inspecting the plan of a query running in another backend
+ *
+ * pg_get_backend_query_plan(pid) returns the EXPLAIN output of the query
+ * the given backend is currently running, including the row counts of each
+ * plan node so far if the query is being instrumented, which is the case if
+ * track_plan_progress was on when it started, or it is being run by EXPLAIN
+ * ANALYZE or auto_explain.
+ *
+ * The requesting backend creates a DSM segment for the answer, advertises
+ * its handle in the target backend's slot in shared memory, and signals the
+ * target with PROCSIG_PLAN_PROGRESS.  Printing a plan requires catalog
+ * access, which is not safe at an arbitrary CHECK_FOR_INTERRUPTS(), so the
+ * interrupt handler merely replaces the ExecProcNode callback of every node
+ * of the running plan tree with one that restores the original callbacks
+ * and answers the request, and so runs at the next point where any node is
+ * asked for a tuple.  If no query is running, the handler answers right
+ * away.  The requester waits for the answer on the slot's condition
+ * variable, for at most PLAN_PROGRESS_TIMEOUT msec.
+ *
+ * Each slot holds at most one request; a new request supersedes any older
+ * one, whose requester then gives up.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/commands/explain_progress.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "catalog/pg_authid.h"
+#include "commands/explain.h"
+#include "commands/explain_progress.h"
+#include "executor/executor.h"
+#include "fmgr.h"
+#include "mb/pg_wchar.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "pgstat.h"
+#include "storage/condition_variable.h"
+#include "storage/dsm.h"
+#include "storage/procarray.h"
+#include "storage/procsignal.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "utils/acl.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+
+/* size of the DSM segment for an answer, which limits the plan's length */
+#define PLAN_PROGRESS_REPLY_SIZE	(1024 * 1024)
+
+/* how long to wait for an answer, in msec */
+#define PLAN_PROGRESS_TIMEOUT		5000
+
+typedef struct PlanProgressSlot
+{
+	slock_t		mutex;			/* protects the fields below */
+	uint64		request;		/* number of the latest request */
+	dsm_handle	handle;			/* segment of the latest request */
+	bool		answered;		/* has the latest request been answered? */
+	ConditionVariable cv;		/* signaled when a request is answered */
+} PlanProgressSlot;
+
+typedef struct PlanProgressReply
+{
+	bool		found;			/* was a query running? */
+	Size		len;			/* length of text */
+	char		text[FLEXIBLE_ARRAY_MEMBER];	/* null-terminated */
+} PlanProgressReply;
+
+/* GUC variable */
+bool		track_plan_progress = false;
+
+/* set by the signal handler */
+volatile bool PlanProgressPending = false;
+
+static PlanProgressSlot *PlanProgressSlots = NULL;
+
+/* plan tree whose nodes' ExecProcNode callbacks are ours, if any */
+static PlanState *wrappedPlanState = NULL;
+
+static TupleTableSlot *ExecProcNodePlanProgress(PlanState *node);
+static bool plan_progress_wrap_walker(PlanState *planstate, void *context);
+static bool plan_progress_unwrap_walker(PlanState *planstate, void *context);
+static void plan_progress_unwrap(void);
+static void plan_progress_answer(QueryDesc *queryDesc);
+static char *explain_running_query(QueryDesc *queryDesc);
+
+/*
+ * Estimate space needed for the request slots
+ */
+Size
+PlanProgressShmemSize(void)
+{
+	return mul_size(sizeof(PlanProgressSlot), MaxBackends);
+}
+
+/*
+ * Allocate and initialize the request slots
+ */
+void
+PlanProgressShmemInit(void)
+{
+	bool		found;
+	int			i;
+
+	PlanProgressSlots = (PlanProgressSlot *)
+		ShmemInitStruct("Plan Progress Slots", PlanProgressShmemSize(), &found);
+
+	if (found)
+		return;
+
+	for (i = 0; i < MaxBackends; i++)
+	{
+		PlanProgressSlot *slot = &PlanProgressSlots[i];
+
+		SpinLockInit(&slot->mutex);
+		slot->request = 0;
+		slot->handle = DSM_HANDLE_INVALID;
+		slot->answered = true;
+		ConditionVariableInit(&slot->cv);
+	}
+}
+
+/*
+ * HandlePlanProgressInterrupt
+ *		Handle receipt of an interrupt asking for the plan of our query.
+ *
+ * All the actual work is deferred to ProcessPlanProgressInterrupt().
+ */
+void
+HandlePlanProgressInterrupt(void)
+{
+	InterruptPending = true;
+	PlanProgressPending = true;
+	/* latch will be set by procsignal_sigusr1_handler */
+}
+
+/*
+ * ProcessPlanProgressInterrupt
+ *		Arrange for a pending request for our plan to be answered.
+ *
+ * Called from ProcessInterrupts().
+ */
+void
+ProcessPlanProgressInterrupt(void)
+{
+	PlanProgressPending = false;
+
+	if (ActiveQueryDesc == NULL)
+	{
+		/* nothing is running, so answer right away */
+		plan_progress_answer(NULL);
+	}
+	else if (wrappedPlanState == NULL)
+	{
+		/* answer when some plan node is next asked for a tuple */
+		wrappedPlanState = ActiveQueryDesc->planstate;
+		plan_progress_wrap_walker(wrappedPlanState, NULL);
+	}
+}
+
+/*
+ * AtEndOfActiveQuery
+ *		Clean up when the outermost running query stops running.
+ *
+ * Called by ExecutorRun(), also on error, so this must not fail.  If a
+ * request is still to be answered, have the next CHECK_FOR_INTERRUPTS() do
+ * it.
+ */
+void
+AtEndOfActiveQuery(QueryDesc *queryDesc)
+{
+	if (wrappedPlanState == NULL)
+		return;
+
+	Assert(wrappedPlanState == queryDesc->planstate);
+	plan_progress_unwrap();
+
+	InterruptPending = true;
+	PlanProgressPending = true;
+}
+
+/*
+ * ExecProcNode callback installed by ProcessPlanProgressInterrupt()
+ */
+static TupleTableSlot *
+ExecProcNodePlanProgress(PlanState *node)
+{
+	plan_progress_unwrap();
+	plan_progress_answer(ActiveQueryDesc);
+
+	return node->ExecProcNode(node);
+}
+
+static bool
+plan_progress_wrap_walker(PlanState *planstate, void *context)
+{
+	planstate->ExecProcNode = ExecProcNodePlanProgress;
+
+	return planstate_tree_walker(planstate, plan_progress_wrap_walker,
+								 context);
+}
+
+static bool
+plan_progress_unwrap_walker(PlanState *planstate, void *context)
+{
+	/* ExecProcNodeFirst() will reinstall any instrumentation wrapper */
+	if (planstate->ExecProcNode == ExecProcNodePlanProgress)
+		ExecSetExecProcNode(planstate, planstate->ExecProcNodeReal);
+
+	return planstate_tree_walker(planstate, plan_progress_unwrap_walker,
+								 context);
+}
+
+static void
+plan_progress_unwrap(void)
+{
+	if (wrappedPlanState != NULL)
+	{
+		plan_progress_unwrap_walker(wrappedPlanState, NULL);
+		wrappedPlanState = NULL;
+	}
+}
+
+/*
+ * Answer the latest request for our plan, if not answered already.  If
+ * queryDesc is NULL, tell the requester that no query is running.
+ */
+static void
+plan_progress_answer(QueryDesc *queryDesc)
+{
+	PlanProgressSlot *slot;
+	uint64		request;
+	dsm_handle	handle;
+	bool		answered;
+	dsm_segment *seg;
+
+	if (PlanProgressSlots == NULL || MyBackendId == InvalidBackendId)
+		return;
+
+	slot = &PlanProgressSlots[MyBackendId - 1];
+	SpinLockAcquire(&slot->mutex);
+	request = slot->request;
+	handle = slot->handle;
+	answered = slot->answered;
+	SpinLockRelease(&slot->mutex);
+
+	if (answered)
+		return;
+
+	/* the requester may have given up already, destroying the segment */
+	seg = dsm_attach(handle);
+	if (seg != NULL)
+	{
+		PlanProgressReply *reply = dsm_segment_address(seg);
+		Size		maxlen;
+
+		maxlen = PLAN_PROGRESS_REPLY_SIZE -
+			offsetof(PlanProgressReply, text) - 1;
+
+		reply->found = (queryDesc != NULL);
+		reply->len = 0;
+		if (queryDesc != NULL)
+		{
+			MemoryContext tmpcontext;
+			MemoryContext oldcontext;
+			char	   *text;
+
+			tmpcontext = AllocSetContextCreate(CurrentMemoryContext,
+											   "plan progress",
+											   ALLOCSET_DEFAULT_SIZES);
+			oldcontext = MemoryContextSwitchTo(tmpcontext);
+
+			text = explain_running_query(queryDesc);
+			reply->len = pg_mbcliplen(text, strlen(text), maxlen);
+			memcpy(reply->text, text, reply->len);
+
+			MemoryContextSwitchTo(oldcontext);
+			MemoryContextDelete(tmpcontext);
+		}
+		reply->text[reply->len] = '\0';
+
+		dsm_detach(seg);
+	}
+
+	SpinLockAcquire(&slot->mutex);
+	if (slot->request == request)
+		slot->answered = true;
+	SpinLockRelease(&slot->mutex);
+
+	ConditionVariableBroadcast(&slot->cv);
+}
+
+/*
+ * Print the plan of a query that is still running, with the
+ * instrumentation that is being collected for it.
+ */
+static char *
+explain_running_query(QueryDesc *queryDesc)
+{
+	ExplainState *es = NewExplainState();
+	int			instrument = queryDesc->estate->es_instrument;
+
+	es->analyze = (instrument & (INSTRUMENT_TIMER | INSTRUMENT_ROWS)) != 0;
+	es->timing = (instrument & INSTRUMENT_TIMER) != 0;
+	es->buffers = (instrument & INSTRUMENT_BUFFERS) != 0;
+	es->wal = (instrument & INSTRUMENT_WAL) != 0;
+	es->running = true;
+	es->format = EXPLAIN_FORMAT_TEXT;
+
+	ExplainBeginOutput(es);
+	ExplainPrintPlan(es, queryDesc);
+	ExplainEndOutput(es);
+
+	/* Remove last line break */
+	if (es->str->len > 0 && es->str->data[es->str->len - 1] == '\n')
+		es->str->data[--es->str->len] = '\0';
+
+	return es->str->data;
+}
+
+/*
+ * pg_get_backend_query_plan
+ *		Return the plan of the query running in the given backend.
+ *
+ * Returns NULL, with a warning, if the process does not exist or doesn't
+ * answer in time, and without one if it is not running a query.
+ */
+Datum
+pg_get_backend_query_plan(PG_FUNCTION_ARGS)
+{
+	int			pid = PG_GETARG_INT32(0);
+	PGPROC	   *proc = BackendPidGetProc(pid);
+	BackendId	backendId;
+	PlanProgressSlot *slot;
+	dsm_segment *seg;
+	PlanProgressReply *reply;
+	uint64		request;
+	bool		answered = false;
+	bool		superseded = false;
+	TimestampTz start_time;
+	text	   *result = NULL;
+
+	if (proc == NULL)
+	{
+		ereport(WARNING,
+				(errmsg("PID %d is not a PostgreSQL server process", pid)));
+		PG_RETURN_NULL();
+	}
+
+	if (!has_privs_of_role(GetUserId(), proc->roleId) &&
+		!is_member_of_role(GetUserId(), DEFAULT_ROLE_READ_ALL_STATS))
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be a member of the role whose query is being inspected or member of pg_read_all_stats")));
+
+	/* We're in a safe place to print our own query's plan */
+	if (pid == MyProcPid)
+	{
+		if (ActiveQueryDesc == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_TEXT_P(cstring_to_text(explain_running_query(ActiveQueryDesc)));
+	}
+
+	backendId = proc->backendId;
+	if (backendId == InvalidBackendId)
+	{
+		ereport(WARNING,
+				(errmsg("PID %d is not a PostgreSQL backend process", pid)));
+		PG_RETURN_NULL();
+	}
+
+	seg = dsm_create(PLAN_PROGRESS_REPLY_SIZE, 0);
+	reply = dsm_segment_address(seg);
+
+	slot = &PlanProgressSlots[backendId - 1];
+	SpinLockAcquire(&slot->mutex);
+	request = ++slot->request;
+	slot->handle = dsm_segment_handle(seg);
+	slot->answered = false;
+	SpinLockRelease(&slot->mutex);
+
+	if (SendProcSignal(pid, PROCSIG_PLAN_PROGRESS, backendId) < 0)
+	{
+		ereport(WARNING,
+				(errmsg("could not send signal to process %d: %m", pid)));
+		dsm_detach(seg);
+		PG_RETURN_NULL();
+	}
+
+	start_time = GetCurrentTimestamp();
+	ConditionVariablePrepareToSleep(&slot->cv);
+	for (;;)
+	{
+		long		secs;
+		int			usecs;
+		long		timeout;
+
+		SpinLockAcquire(&slot->mutex);
+		if (slot->request != request)
+			superseded = true;
+		else
+			answered = slot->answered;
+		SpinLockRelease(&slot->mutex);
+
+		if (answered || superseded)
+			break;
+
+		TimestampDifference(start_time, GetCurrentTimestamp(), &secs, &usecs);
+		timeout = PLAN_PROGRESS_TIMEOUT - (secs * 1000 + usecs / 1000);
+		if (timeout <= 0 ||
+			ConditionVariableTimedSleep(&slot->cv, timeout,
+										WAIT_EVENT_PLAN_PROGRESS))
+			break;
+	}
+	ConditionVariableCancelSleep();
+
+	if (answered)
+	{
+		if (reply->found)
+			result = cstring_to_text_with_len(reply->text, reply->len);
+	}
+	else if (superseded)
+		ereport(WARNING,
+				(errmsg("request for the plan of process %d was superseded by another one",
+						pid)));
+	else
+		ereport(WARNING,
+				(errmsg("process %d did not provide its plan within %d ms",
+						pid, PLAN_PROGRESS_TIMEOUT)));
+
+	dsm_detach(seg);
+
+	if (result == NULL)
+		PG_RETURN_NULL();
+	PG_RETURN_TEXT_P(result);
+}
@@ -930,11 +930,14 @@ DefineIndex(Oid relationId,
 			/*
 			 * We'll need to be able to identify the equality operators
 			 * associated with index columns, too.  We know what to do with
-			 * btree opclasses; if there are ever any other index types that
-			 * support unique indexes, this logic will need extension.
+			 * btree and hash opclasses; if there are ever any other index
+			 * types that support unique indexes, this logic will need
+			 * extension.
 			 */
 			if (accessMethodId == BTREE_AM_OID)
 				eq_strategy = BTEqualStrategyNumber;
+			else if (accessMethodId == HASH_AM_OID)
+				eq_strategy = HTEqualStrategyNumber;
 			else
 				ereport(ERROR,
 						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
@@ -22,29 +22,44 @@
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
+#include "catalog/dependency.h"
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_am.h"
+#include "catalog/pg_inherits.h"
 #include "catalog/pg_opclass.h"
 #include "catalog/pg_operator.h"
+#include "catalog/pg_trigger.h"
+#include "catalog/pg_type.h"
 #include "commands/cluster.h"
 #include "commands/matview.h"
 #include "commands/tablecmds.h"
 #include "commands/tablespace.h"
+#include "commands/trigger.h"
 #include "executor/executor.h"
 #include "executor/spi.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
 #include "parser/parse_relation.h"
+#include "parser/parser.h"
+#include "parser/parsetree.h"
 #include "pgstat.h"
 #include "rewrite/rewriteHandler.h"
 #include "storage/lmgr.h"
 #include "storage/smgr.h"
 #include "tcop/tcopprot.h"
+#include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/guc.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
+#include "utils/ruleutils.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
+#include "utils/tuplestore.h"
+#include "utils/typcache.h"
 
 
 typedef struct
@@ -60,6 +75,10 @@ typedef struct
 
 static int	matview_maintenance_depth = 0;
 
+/* Names of the transition tables of incremental maintenance triggers */
+#define IVM_OLD_TABLE_NAME	"pg_ivm_old_table"
+#define IVM_NEW_TABLE_NAME	"pg_ivm_new_table"
+
 static void transientrel_startup(DestReceiver *self, int operation, TupleDesc typeinfo);
 static bool transientrel_receive(TupleTableSlot *slot, DestReceiver *self);
 static void transientrel_shutdown(DestReceiver *self);
@@ -73,6 +92,23 @@ static void refresh_by_heap_swap(Oid matviewOid, Oid OIDNewHeap, char relpersist
 static bool is_usable_unique_index(Relation indexRel);
 static void OpenMatViewIncrementalMaintenance(void);
 static void CloseMatViewIncrementalMaintenance(void);
+static void ivm_not_supported(const char *detail) pg_attribute_noreturn();
+static void check_ivm_jointree(Node *jtnode, Query *query);
+static void create_ivm_trigger(Oid matviewOid, Oid relid, int16 event);
+static void apply_matview_delta(Relation matviewRel, Query *query,
+								TriggerData *trigdata);
+static Query *make_ivm_delta_query(Query *query, int rtindex, Relation rel,
+								   const char *enrname);
+static void delete_matview_delta(Relation matviewRel, const char *matviewname,
+								 Query *delta);
+static void insert_matview_delta(const char *matviewname, Query *delta);
+static void recompute_matview_groups(Relation matviewRel,
+									 const char *matviewname,
+									 Query *query, Query *delta);
+static void recompute_matview(const char *matviewname, Query *query);
+static void append_ivm_match_clause(StringInfo buf, bool addand,
+									const char *leftop, const char *rightop,
+									Oid type, Oid eqop);
 
 /*
  * SetMatViewPopulatedState
@@ -309,9 +345,23 @@ ExecRefreshMatView(RefreshMatViewStmt *stmt, const char *queryString,
 	SetUserIdAndSecContext(relowner,
 						   save_sec_context | SECURITY_RESTRICTED_OPERATION);
 
-	/* Generate the data, if wanted. */
+	/*
+	 * Generate the data, if wanted.
+	 *
+	 * The maintenance triggers of an incrementally maintained matview may
+	 * have applied changes that committed while we waited for our lock.  In
+	 * READ COMMITTED mode, take a new snapshot so as not to lose them.
+	 */
 	if (!stmt->skipData)
+	{
+		bool		incremental = RelationIsIncrementalMatView(matviewRel);
+
+		if (incremental)
+			PushActiveSnapshot(GetTransactionSnapshot());
 		processed = refresh_matview_datafill(dest, dataQuery, queryString);
+		if (incremental)
+			PopActiveSnapshot();
+	}
 
 	/* Make the matview match the newly generated data. */
 	if (concurrent)
@@ -922,3 +972,770 @@ CloseMatViewIncrementalMaintenance(void)
 	matview_maintenance_depth--;
 	Assert(matview_maintenance_depth >= 0);
 }
+
+
+/*
+ * CheckIncrementalMatViewQuery
+ *		Check that a materialized view query can be maintained incrementally.
+ *
+ * We can maintain select-project-join queries, possibly with grouping and
+ * aggregates on top, over plain tables.  Changes of each base table are
+ * captured by statement-level AFTER triggers with transition tables; see
+ * CreateIncrementalMatViewTriggers.
+ *
+ * Also lock the base tables against concurrent data changes, so that none
+ * can be lost between populating the matview and creating its triggers.
+ */
+void
+CheckIncrementalMatViewQuery(Query *query)
+{
+	List	   *relids = NIL;
+	AclResult	aclresult;
+	ListCell   *lc;
+
+	Assert(query->commandType == CMD_SELECT);
+
+	if (query->cteList != NIL)
+		ivm_not_supported(_("WITH queries are not supported."));
+	if (query->setOperations != NULL)
+		ivm_not_supported(_("UNION, INTERSECT, and EXCEPT are not supported."));
+	if (query->hasSubLinks)
+		ivm_not_supported(_("Subqueries are not supported."));
+	if (query->hasWindowFuncs)
+		ivm_not_supported(_("Window functions are not supported."));
+	if (query->hasTargetSRFs)
+		ivm_not_supported(_("Set-returning functions are not supported."));
+	if (query->groupingSets != NIL)
+		ivm_not_supported(_("GROUPING SETS, ROLLUP, and CUBE are not supported."));
+	if (query->distinctClause != NIL)
+		ivm_not_supported(_("DISTINCT is not supported."));
+	if (query->limitCount != NULL || query->limitOffset != NULL)
+		ivm_not_supported(_("LIMIT and OFFSET are not supported."));
+	if (query->rowMarks != NIL)
+		ivm_not_supported(_("FOR UPDATE and FOR SHARE are not supported."));
+
+	/* The query must give the same result whenever it is rerun */
+	if (contain_mutable_functions((Node *) query))
+		ivm_not_supported(_("Functions in the query must be marked IMMUTABLE."));
+
+	check_ivm_jointree((Node *) query->jointree, query);
+
+	foreach(lc, query->rtable)
+	{
+		RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+
+		if (rte->rtekind != RTE_RELATION)
+			continue;
+
+		/* We are going to create triggers on the table */
+		aclresult = pg_class_aclcheck(rte->relid, GetUserId(), ACL_TRIGGER);
+		if (aclresult != ACLCHECK_OK)
+			aclcheck_error(aclresult, get_relkind_objtype(rte->relkind),
+						   get_rel_name(rte->relid));
+
+		/*
+		 * Statement triggers on an inheritance parent don't see changes made
+		 * directly to its children, nor the other way around.
+		 */
+		if (has_subclass(rte->relid) || has_superclass(rte->relid))
+			ivm_not_supported(_("Tables in inheritance hierarchies are not supported."));
+
+		/*
+		 * A delta is computed by joining the changed rows of one table with
+		 * the current contents of the others, which doesn't work if the
+		 * changed table is also one of the others.
+		 */
+		if (list_member_oid(relids, rte->relid))
+			ivm_not_supported(_("Joins of a table with itself are not supported."));
+		relids = lappend_oid(relids, rte->relid);
+
+		LockRelationOid(rte->relid, ShareRowExclusiveLock);
+	}
+
+	if (query->hasAggs || query->groupClause != NIL ||
+		query->havingQual != NULL)
+	{
+		/*
+		 * Changed groups are found by their grouping columns, so those must
+		 * be stored in the matview.
+		 */
+		foreach(lc, query->groupClause)
+		{
+			SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+			TargetEntry *tle = get_sortgroupclause_tle(sgc, query->targetList);
+
+			if (tle->resjunk)
+				ivm_not_supported(_("All grouping columns must appear in the select list."));
+		}
+	}
+	else
+	{
+		bool		hascols = false;
+
+		/*
+		 * Rows deleted from the matview are identified by their values, so we
+		 * must be able to compare and group by all of them.
+		 */
+		foreach(lc, query->targetList)
+		{
+			TargetEntry *tle = lfirst_node(TargetEntry, lc);
+			TypeCacheEntry *typentry;
+
+			if (tle->resjunk)
+				continue;
+			hascols = true;
+
+			typentry = lookup_type_cache(exprType((Node *) tle->expr),
+										 TYPECACHE_EQ_OPR | TYPECACHE_LT_OPR);
+			if (!OidIsValid(typentry->eq_opr) || !OidIsValid(typentry->lt_opr))
+				ivm_not_supported(psprintf(_("Column \"%s\" has type %s, which has no default btree operator class."),
+										   tle->resname,
+										   format_type_be(typentry->type_id)));
+		}
+
+		if (!hascols)
+			ivm_not_supported(_("The select list must not be empty."));
+	}
+}
+
+/*
+ * Report that a matview query can't be maintained incrementally.
+ */
+static void
+ivm_not_supported(const char *detail)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("materialized view query cannot be maintained incrementally"),
+			 errdetail_internal("%s", detail)));
+}
+
+/*
+ * Check the FROM clause of a matview query for CheckIncrementalMatViewQuery.
+ */
+static void
+check_ivm_jointree(Node *jtnode, Query *query)
+{
+	if (IsA(jtnode, RangeTblRef))
+	{
+		RangeTblEntry *rte = rt_fetch(((RangeTblRef *) jtnode)->rtindex,
+									  query->rtable);
+
+		if (rte->rtekind != RTE_RELATION ||
+			rte->relkind != RELKIND_RELATION)
+			ivm_not_supported(_("Only plain tables are supported in FROM."));
+		if (rte->tablesample != NULL)
+			ivm_not_supported(_("TABLESAMPLE is not supported."));
+	}
+	else if (IsA(jtnode, FromExpr))
+	{
+		FromExpr   *f = (FromExpr *) jtnode;
+		ListCell   *lc;
+
+		foreach(lc, f->fromlist)
+			check_ivm_jointree((Node *) lfirst(lc), query);
+	}
+	else if (IsA(jtnode, JoinExpr))
+	{
+		JoinExpr   *j = (JoinExpr *) jtnode;
+
+		if (j->jointype != JOIN_INNER)
+			ivm_not_supported(_("Outer joins are not supported."));
+		check_ivm_jointree(j->larg, query);
+		check_ivm_jointree(j->rarg, query);
+	}
+	else
+		elog(ERROR, "unrecognized node type: %d", (int) nodeTag(jtnode));
+}
+
+/*
+ * CreateIncrementalMatViewTriggers
+ *		Create the triggers that keep a materialized view up to date.
+ *
+ * Each base table gets AFTER INSERT, UPDATE, and DELETE triggers for each
+ * statement, which are handed the changed rows in transition tables, plus an
+ * AFTER TRUNCATE trigger.  The triggers are internal, and belong to the
+ * matview.
+ */
+void
+CreateIncrementalMatViewTriggers(Oid matviewOid, Query *query)
+{
+	ListCell   *lc;
+
+	foreach(lc, query->rtable)
+	{
+		RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+
+		if (rte->rtekind != RTE_RELATION)
+			continue;
+
+		create_ivm_trigger(matviewOid, rte->relid, TRIGGER_TYPE_INSERT);
+		create_ivm_trigger(matviewOid, rte->relid, TRIGGER_TYPE_UPDATE);
+		create_ivm_trigger(matviewOid, rte->relid, TRIGGER_TYPE_DELETE);
+		create_ivm_trigger(matviewOid, rte->relid, TRIGGER_TYPE_TRUNCATE);
+	}
+
+	/* Make the triggers visible */
+	CommandCounterIncrement();
+}
+
+static void
+create_ivm_trigger(Oid matviewOid, Oid relid, int16 event)
+{
+	CreateTrigStmt *trigger;
+	ObjectAddress trigaddr;
+	ObjectAddress mvaddr;
+
+	trigger = makeNode(CreateTrigStmt);
+	trigger->trigname = "MatView_Maintenance";
+	trigger->relation = NULL;
+	trigger->funcname = SystemFuncName("matview_maintenance_trigger");
+	trigger->args = list_make1(makeString(psprintf("%u", matviewOid)));
+	trigger->row = false;
+	trigger->timing = TRIGGER_TYPE_AFTER;
+	trigger->events = event;
+	trigger->columns = NIL;
+	trigger->whenClause = NULL;
+	trigger->isconstraint = false;
+	trigger->transitionRels = NIL;
+	trigger->deferrable = false;
+	trigger->initdeferred = false;
+	trigger->constrrel = NULL;
+
+	if (event == TRIGGER_TYPE_DELETE || event == TRIGGER_TYPE_UPDATE)
+	{
+		TriggerTransition *tt = makeNode(TriggerTransition);
+
+		tt->name = IVM_OLD_TABLE_NAME;
+		tt->isNew = false;
+		tt->isTable = true;
+		trigger->transitionRels = lappend(trigger->transitionRels, tt);
+	}
+	if (event == TRIGGER_TYPE_INSERT || event == TRIGGER_TYPE_UPDATE)
+	{
+		TriggerTransition *tt = makeNode(TriggerTransition);
+
+		tt->name = IVM_NEW_TABLE_NAME;
+		tt->isNew = true;
+		tt->isTable = true;
+		trigger->transitionRels = lappend(trigger->transitionRels, tt);
+	}
+
+	trigaddr = CreateTrigger(trigger, NULL, relid, InvalidOid, InvalidOid,
+							 InvalidOid, InvalidOid, InvalidOid, NULL,
+							 true, false);
+
+	/* The trigger goes away with the matview, and can't be dropped alone */
+	ObjectAddressSet(mvaddr, RelationRelationId, matviewOid);
+	recordDependencyOn(&trigaddr, &mvaddr, DEPENDENCY_INTERNAL);
+}
+
+/*
+ * matview_maintenance_trigger
+ *		Apply the changes of one statement on a base table to a materialized
+ *		view.
+ *
+ * For a query without grouping, the rows to delete from the matview are what
+ * the query yields with the changed table replaced by the old transition
+ * table, and the rows to insert what it yields over the new transition table.
+ * All other tables are unchanged by the statement, so reading their current
+ * contents is right.
+ *
+ * For a grouped query, we can't in general derive new aggregate values from
+ * old ones and the delta, so we find the groups the changed rows belong to,
+ * and recompute just those groups.
+ *
+ * The work is done by queries run through SPI, as the matview's owner, like
+ * in refresh_by_match_merge.
+ */
+Datum
+matview_maintenance_trigger(PG_FUNCTION_ARGS)
+{
+	TriggerData *trigdata = (TriggerData *) fcinfo->context;
+	Trigger    *trigger;
+	Oid			matviewOid;
+	Relation	matviewRel;
+	RewriteRule *rule;
+	Query	   *query;
+	Oid			relowner;
+	Oid			save_userid;
+	int			save_sec_context;
+	int			save_nestlevel;
+	int			old_depth;
+
+	if (!CALLED_AS_TRIGGER(fcinfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+				 errmsg("function \"%s\" was not called by trigger manager",
+						"matview_maintenance_trigger")));
+
+	if (!TRIGGER_FIRED_AFTER(trigdata->tg_event) ||
+		!TRIGGER_FIRED_FOR_STATEMENT(trigdata->tg_event))
+		ereport(ERROR,
+				(errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+				 errmsg("function \"%s\" must be fired AFTER, for each statement",
+						"matview_maintenance_trigger")));
+
+	trigger = trigdata->tg_trigger;
+	if (trigger->tgnargs != 1)
+		elog(ERROR, "wrong number of arguments for matview maintenance trigger");
+	matviewOid = atooid(trigger->tgargs[0]);
+
+	/*
+	 * Only one transaction at a time may maintain the matview, so that each
+	 * sees the base table changes of the others once they are applied.
+	 * Readers aren't blocked.
+	 *
+	 * In READ COMMITTED mode, the queries below take fresh snapshots, which
+	 * see the changes of a transaction we had to wait for.  A transaction
+	 * snapshot doesn't, so applying our delta on top of theirs could miss
+	 * rows that depend on both.
+	 */
+	if (!ConditionalLockRelationOid(matviewOid, ExclusiveLock))
+	{
+		LockRelationOid(matviewOid, ExclusiveLock);
+		if (IsolationUsesXactSnapshot())
+			ereport(ERROR,
+					(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+					 errmsg("could not serialize access due to concurrent update of materialized view \"%s\"",
+							get_rel_name(matviewOid))));
+	}
+	matviewRel = table_open(matviewOid, NoLock);
+
+	/* Nothing to maintain until the matview is populated by REFRESH */
+	if (!RelationIsPopulated(matviewRel))
+	{
+		table_close(matviewRel, NoLock);
+		return PointerGetDatum(NULL);
+	}
+
+	if (matviewRel->rd_rules == NULL || matviewRel->rd_rules->numLocks != 1)
+		elog(ERROR, "materialized view \"%s\" has wrong rewrite information",
+			 RelationGetRelationName(matviewRel));
+	rule = matviewRel->rd_rules->rules[0];
+	query = copyObject(linitial_node(Query, rule->actions));
+
+	/*
+	 * Switch to the owner's userid and lock down security-restricted
+	 * operations, as REFRESH does.
+	 */
+	relowner = matviewRel->rd_rel->relowner;
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(relowner,
+						   save_sec_context | SECURITY_RESTRICTED_OPERATION);
+	save_nestlevel = NewGUCNestLevel();
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+
+	/* Make the transition tables visible to the queries */
+	if (SPI_register_trigger_data(trigdata) != SPI_OK_TD_REGISTER)
+		elog(ERROR, "SPI_register_trigger_data failed");
+
+	old_depth = matview_maintenance_depth;
+	PG_TRY();
+	{
+		OpenMatViewIncrementalMaintenance();
+		apply_matview_delta(matviewRel, query, trigdata);
+		CloseMatViewIncrementalMaintenance();
+	}
+	PG_CATCH();
+	{
+		matview_maintenance_depth = old_depth;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	if (SPI_finish() != SPI_OK_FINISH)
+		elog(ERROR, "SPI_finish failed");
+
+	/* Roll back any GUC changes */
+	AtEOXact_GUC(false, save_nestlevel);
+
+	/* Restore userid and security context */
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+
+	table_close(matviewRel, NoLock);
+
+	return PointerGetDatum(NULL);
+}
+
+/*
+ * Apply the changes described by a trigger event to the matview.
+ */
+static void
+apply_matview_delta(Relation matviewRel, Query *query, TriggerData *trigdata)
+{
+	Relation	rel = trigdata->tg_relation;
+	Tuplestorestate *oldtable = trigdata->tg_oldtable;
+	Tuplestorestate *newtable = trigdata->tg_newtable;
+	char	   *matviewname;
+	int			rtindex;
+	ListCell   *lc;
+
+	matviewname = quote_qualified_identifier(get_namespace_name(RelationGetNamespace(matviewRel)),
+											 RelationGetRelationName(matviewRel));
+
+	if (oldtable && tuplestore_tuple_count(oldtable) == 0)
+		oldtable = NULL;
+	if (newtable && tuplestore_tuple_count(newtable) == 0)
+		newtable = NULL;
+
+	if (TRIGGER_FIRED_BY_TRUNCATE(trigdata->tg_event))
+	{
+		recompute_matview(matviewname, query);
+		return;
+	}
+	if (oldtable == NULL && newtable == NULL)
+		return;
+
+	/* An aggregate without grouping yields one row; just recompute it */
+	if (query->groupClause == NIL &&
+		(query->hasAggs || query->havingQual != NULL))
+	{
+		recompute_matview(matviewname, query);
+		return;
+	}
+
+	/* Find the changed table in the query; there's only one reference */
+	rtindex = 0;
+	foreach(lc, query->rtable)
+	{
+		RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+
+		if (rte->rtekind == RTE_RELATION &&
+			rte->relid == RelationGetRelid(rel) &&
+			rte->inFromCl)
+		{
+			rtindex = foreach_current_index(lc) + 1;
+			break;
+		}
+	}
+	if (rtindex == 0)
+		elog(ERROR, "relation \"%s\" not found in materialized view query",
+			 RelationGetRelationName(rel));
+
+	/*
+	 * Old rows go first, as an UPDATE is applied as a delete followed by an
+	 * insert.  For a grouped query, groups that both old and new rows belong
+	 * to are recomputed twice, which is wasteful but harmless.
+	 */
+	if (query->groupClause != NIL)
+	{
+		if (oldtable)
+			recompute_matview_groups(matviewRel, matviewname, query,
+									 make_ivm_delta_query(query, rtindex, rel,
+														  IVM_OLD_TABLE_NAME));
+		if (newtable)
+			recompute_matview_groups(matviewRel, matviewname, query,
+									 make_ivm_delta_query(query, rtindex, rel,
+														  IVM_NEW_TABLE_NAME));
+	}
+	else
+	{
+		if (oldtable)
+			delete_matview_delta(matviewRel, matviewname,
+								 make_ivm_delta_query(query, rtindex, rel,
+													  IVM_OLD_TABLE_NAME));
+		if (newtable)
+			insert_matview_delta(matviewname,
+								 make_ivm_delta_query(query, rtindex, rel,
+													  IVM_NEW_TABLE_NAME));
+	}
+}
+
+/*
+ * Make a copy of the matview query that reads the named transition table in
+ * place of the base table at rtindex.  The copy is only used to decompile
+ * the query, so we needn't fill in more than ruleutils.c looks at.
+ */
+static Query *
+make_ivm_delta_query(Query *query, int rtindex, Relation rel,
+					 const char *enrname)
+{
+	Query	   *delta = copyObject(query);
+	RangeTblEntry *rte = rt_fetch(rtindex, delta->rtable);
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	List	   *colnames = NIL;
+	List	   *coltypes = NIL;
+	List	   *coltypmods = NIL;
+	List	   *colcollations = NIL;
+	int			i;
+
+	/*
+	 * The transition table has the table's current columns.  As in
+	 * addRangeTableEntryForENR, a dropped column gets an invalid type, which
+	 * is how ruleutils.c tells it's dropped.
+	 */
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+
+		if (attr->attisdropped)
+		{
+			colnames = lappend(colnames, makeString(pstrdup("")));
+			coltypes = lappend_oid(coltypes, InvalidOid);
+			coltypmods = lappend_int(coltypmods, 0);
+			colcollations = lappend_oid(colcollations, InvalidOid);
+		}
+		else
+		{
+			colnames = lappend(colnames,
+							   makeString(pstrdup(NameStr(attr->attname))));
+			coltypes = lappend_oid(coltypes, attr->atttypid);
+			coltypmods = lappend_int(coltypmods, attr->atttypmod);
+			colcollations = lappend_oid(colcollations, attr->attcollation);
+		}
+	}
+
+	rte->rtekind = RTE_NAMEDTUPLESTORE;
+	rte->relid = InvalidOid;
+	rte->relkind = 0;
+	rte->inh = false;
+	rte->enrname = pstrdup(enrname);
+	rte->eref->colnames = colnames;
+	rte->coltypes = coltypes;
+	rte->coltypmods = coltypmods;
+	rte->colcollations = colcollations;
+
+	return delta;
+}
+
+/*
+ * Delete the rows the delta query yields from the matview.
+ *
+ * The matview may hold duplicate rows, so count how many times the delta
+ * yields each distinct row, and delete that many of the matching matview
+ * rows, picked by ctid.  NULLs count as equal here.
+ */
+static void
+delete_matview_delta(Relation matviewRel, const char *matviewname,
+					 Query *delta)
+{
+	TupleDesc	tupdesc = RelationGetDescr(matviewRel);
+	StringInfoData collist;
+	StringInfoData dcollist;
+	StringInfoData querybuf;
+	int			ncols = 0;
+	int			i;
+
+	initStringInfo(&collist);
+	initStringInfo(&dcollist);
+	initStringInfo(&querybuf);
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		if (TupleDescAttr(tupdesc, i)->attisdropped)
+			continue;
+		ncols++;
+		appendStringInfo(&collist, "%sc%d", ncols > 1 ? ", " : "", ncols);
+		appendStringInfo(&dcollist, "%sd.c%d", ncols > 1 ? ", " : "", ncols);
+	}
+
+	appendStringInfo(&querybuf,
+					 "DELETE FROM %s mv WHERE ctid OPERATOR(pg_catalog.=) ANY "
+					 "(SELECT tid FROM "
+					 "(SELECT mv.ctid AS tid, d.ivm_count, "
+					 "pg_catalog.row_number() OVER (PARTITION BY %s) AS ivm_rownum "
+					 "FROM %s mv, "
+					 "(SELECT %s, pg_catalog.count(*) AS ivm_count "
+					 "FROM (%s) delta(%s) GROUP BY %s) d WHERE ",
+					 matviewname, dcollist.data, matviewname,
+					 collist.data, pg_get_querydef(delta, false),
+					 collist.data, collist.data);
+
+	ncols = 0;
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+		char	   *mvcol;
+		char	   *dcol;
+
+		if (attr->attisdropped)
+			continue;
+		ncols++;
+		mvcol = quote_qualified_identifier("mv", NameStr(attr->attname));
+		dcol = psprintf("d.c%d", ncols);
+		append_ivm_match_clause(&querybuf, ncols > 1,
+								mvcol, dcol, attr->atttypid,
+								lookup_type_cache(attr->atttypid,
+												  TYPECACHE_EQ_OPR)->eq_opr);
+	}
+
+	appendStringInfoString(&querybuf,
+						   ") t WHERE ivm_rownum OPERATOR(pg_catalog.<=) ivm_count)");
+
+	if (SPI_exec(querybuf.data, 0) != SPI_OK_DELETE)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+}
+
+/*
+ * Insert the rows the delta query yields into the matview.
+ */
+static void
+insert_matview_delta(const char *matviewname, Query *delta)
+{
+	StringInfoData querybuf;
+
+	initStringInfo(&querybuf);
+	appendStringInfo(&querybuf, "INSERT INTO %s %s",
+					 matviewname, pg_get_querydef(delta, false));
+	if (SPI_exec(querybuf.data, 0) != SPI_OK_INSERT)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+}
+
+/*
+ * Recompute the groups of a grouped matview query that rows of the delta
+ * query belong to.
+ *
+ * The grouping columns of those rows are collected by the delta query,
+ * stripped down to grouping.  We delete the matview rows of these groups,
+ * and insert what the matview query yields when restricted to them.  The
+ * caller's query is left alone, since it may be needed for another delta.
+ */
+static void
+recompute_matview_groups(Relation matviewRel, const char *matviewname,
+						 Query *query, Query *delta)
+{
+	TupleDesc	tupdesc = RelationGetDescr(matviewRel);
+	List	   *keytlist = NIL;
+	List	   *keycolnames = NIL;
+	Node	   *keyquals = NULL;
+	RangeTblEntry *rte;
+	RangeTblRef *rtr;
+	StringInfoData querybuf;
+	char	   *keysql;
+	int			keyrtindex;
+	ListCell   *lc;
+
+	/* Turn the delta query into one yielding the distinct changed groups */
+	foreach(lc, delta->groupClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		TargetEntry *tle = get_sortgroupclause_tle(sgc, delta->targetList);
+		TargetEntry *keytle = flatCopyTargetEntry(tle);
+
+		keytle->resno = list_length(keytlist) + 1;
+		keytle->resname = psprintf("k%d", keytle->resno);
+		keytlist = lappend(keytlist, keytle);
+		keycolnames = lappend(keycolnames, makeString(keytle->resname));
+	}
+	delta->targetList = keytlist;
+	delta->hasAggs = false;
+	delta->havingQual = NULL;
+	delta->sortClause = NIL;
+
+	keysql = pg_get_querydef(delta, false);
+
+	/* Delete the matview rows of the changed groups */
+	initStringInfo(&querybuf);
+	appendStringInfo(&querybuf, "DELETE FROM %s mv USING (%s) k WHERE ",
+					 matviewname, keysql);
+	foreach(lc, query->groupClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		TargetEntry *tle = get_sortgroupclause_tle(sgc, query->targetList);
+		int			keyno = foreach_current_index(lc) + 1;
+		Form_pg_attribute attr;
+
+		Assert(!tle->resjunk);
+		attr = TupleDescAttr(tupdesc, tle->resno - 1);
+		append_ivm_match_clause(&querybuf, keyno > 1,
+								quote_qualified_identifier("mv", NameStr(attr->attname)),
+								psprintf("k.k%d", keyno),
+								attr->atttypid, sgc->eqop);
+	}
+	if (SPI_exec(querybuf.data, 0) != SPI_OK_DELETE)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+	/*
+	 * Rerun the matview query, joined to the changed groups on the grouping
+	 * expressions.  The groups are distinct, so the join doesn't duplicate
+	 * any input rows.
+	 */
+	query = copyObject(query);
+	rte = makeNode(RangeTblEntry);
+	rte->rtekind = RTE_SUBQUERY;
+	rte->subquery = delta;
+	rte->alias = makeAlias("ivm_keys", NIL);
+	rte->eref = makeAlias("ivm_keys", keycolnames);
+	rte->inFromCl = true;
+	query->rtable = lappend(query->rtable, rte);
+	keyrtindex = list_length(query->rtable);
+
+	rtr = makeNode(RangeTblRef);
+	rtr->rtindex = keyrtindex;
+	query->jointree->fromlist = lappend(query->jointree->fromlist, rtr);
+
+	foreach(lc, query->groupClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		TargetEntry *tle = get_sortgroupclause_tle(sgc, query->targetList);
+		Expr	   *expr = tle->expr;
+		Oid			collation = exprCollation((Node *) expr);
+		Var		   *keyvar;
+		Expr	   *eq;
+		NullTest   *exprnull;
+		NullTest   *keynull;
+		Expr	   *bothnull;
+
+		keyvar = makeVar(keyrtindex, foreach_current_index(lc) + 1,
+						 exprType((Node *) expr), exprTypmod((Node *) expr),
+						 collation, 0);
+		eq = make_opclause(sgc->eqop, BOOLOID, false,
+						   (Expr *) copyObject(expr), (Expr *) keyvar,
+						   InvalidOid, collation);
+
+		exprnull = makeNode(NullTest);
+		exprnull->arg = (Expr *) copyObject(expr);
+		exprnull->nulltesttype = IS_NULL;
+		exprnull->argisrow = false;
+		exprnull->location = -1;
+
+		keynull = makeNode(NullTest);
+		keynull->arg = (Expr *) copyObject(keyvar);
+		keynull->nulltesttype = IS_NULL;
+		keynull->argisrow = false;
+		keynull->location = -1;
+
+		bothnull = makeBoolExpr(AND_EXPR, list_make2(exprnull, keynull), -1);
+		keyquals = make_and_qual(keyquals,
+								 (Node *) makeBoolExpr(OR_EXPR,
+													   list_make2(eq, bothnull),
+													   -1));
+	}
+	query->jointree->quals = make_and_qual(query->jointree->quals, keyquals);
+
+	insert_matview_delta(matviewname, query);
+}
+
+/*
+ * Replace the whole contents of the matview with what its query yields now.
+ */
+static void
+recompute_matview(const char *matviewname, Query *query)
+{
+	StringInfoData querybuf;
+
+	initStringInfo(&querybuf);
+	appendStringInfo(&querybuf, "DELETE FROM %s", matviewname);
+	if (SPI_exec(querybuf.data, 0) != SPI_OK_DELETE)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+	insert_matview_delta(matviewname, query);
+}
+
+/*
+ * Append a condition that two values are equal, or both null.
+ */
+static void
+append_ivm_match_clause(StringInfo buf, bool addand, const char *leftop,
+						const char *rightop, Oid type, Oid eqop)
+{
+	if (addand)
+		appendStringInfoString(buf, " AND ");
+	appendStringInfoString(buf, "(");
+	generate_operator_clause(buf, leftop, type, eqop, rightop, type);
+	appendStringInfo(buf, " OR (%s IS NULL AND %s IS NULL))",
+					 leftop, rightop);
+}
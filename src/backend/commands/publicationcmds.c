@@ -17,6 +17,7 @@
 #include "access/genam.h"
 #include "access/htup_details.h"
 #include "access/table.h"
+#include "access/transam.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
 #include "catalog/indexing.h"
@@ -34,6 +35,11 @@
 #include "commands/publicationcmds.h"
 #include "funcapi.h"
 #include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
+#include "parser/parse_clause.h"
+#include "parser/parse_collate.h"
+#include "parser/parse_relation.h"
 #include "utils/acl.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
@@ -48,11 +54,12 @@
 /* Same as MAXNUMMESSAGES in sinvaladt.c */
 #define MAX_RELCACHE_INVAL_MSGS 4096
 
-static List *OpenTableList(List *tables);
+static List *OpenTableList(List *tables, bool is_drop);
 static void CloseTableList(List *rels);
 static void PublicationAddTables(Oid pubid, List *rels, bool if_not_exists,
 								 AlterPublicationStmt *stmt);
 static void PublicationDropTables(Oid pubid, List *rels, bool missing_ok);
+static bool publication_rel_has_filter(Oid pubid, Oid relid);
 
 static void
 parse_publication_options(List *options,
@@ -232,7 +239,7 @@ CreatePublication(CreatePublicationStmt *stmt)
 
 		Assert(list_length(stmt->tables) > 0);
 
-		rels = OpenTableList(stmt->tables);
+		rels = OpenTableList(stmt->tables, false);
 		PublicationAddTables(puboid, rels, true, NULL);
 		CloseTableList(rels);
 	}
@@ -372,7 +379,7 @@ AlterPublicationTables(AlterPublicationStmt *stmt, Relation rel,
 
 	Assert(list_length(stmt->tables) > 0);
 
-	rels = OpenTableList(stmt->tables);
+	rels = OpenTableList(stmt->tables, stmt->tableAction == DEFELEM_DROP);
 
 	if (stmt->tableAction == DEFELEM_ADD)
 		PublicationAddTables(pubid, rels, false, stmt);
@@ -385,7 +392,11 @@ AlterPublicationTables(AlterPublicationStmt *stmt, Relation rel,
 		List	   *delrels = NIL;
 		ListCell   *oldlc;
 
-		/* Calculate which relations to drop. */
+		/*
+		 * Calculate which relations to drop.  A relation that stays in the
+		 * publication is dropped too, and added back below, if its column
+		 * list or row filter is being set or was set before.
+		 */
 		foreach(oldlc, oldrelids)
 		{
 			Oid			oldrelid = lfirst_oid(oldlc);
@@ -394,21 +405,24 @@ AlterPublicationTables(AlterPublicationStmt *stmt, Relation rel,
 
 			foreach(newlc, rels)
 			{
-				Relation	newrel = (Relation) lfirst(newlc);
+				PublicationRelInfo *newpri = (PublicationRelInfo *) lfirst(newlc);
 
-				if (RelationGetRelid(newrel) == oldrelid)
+				if (RelationGetRelid(newpri->relation) == oldrelid)
 				{
-					found = true;
+					found = (newpri->whereClause == NULL &&
+							 newpri->columns == NIL &&
+							 !publication_rel_has_filter(pubid, oldrelid));
 					break;
 				}
 			}
 
 			if (!found)
 			{
-				Relation	oldrel = table_open(oldrelid,
-												ShareUpdateExclusiveLock);
+				PublicationRelInfo *oldpri = palloc0(sizeof(PublicationRelInfo));
 
-				delrels = lappend(delrels, oldrel);
+				oldpri->relation = table_open(oldrelid,
+											  ShareUpdateExclusiveLock);
+				delrels = lappend(delrels, oldpri);
 			}
 		}
 
@@ -499,12 +513,96 @@ RemovePublicationRelById(Oid proid)
 }
 
 /*
- * Open relations specified by a RangeVar list.
+ * Does the publication's entry for the relation have a column list or a row
+ * filter?
+ */
+static bool
+publication_rel_has_filter(Oid pubid, Oid relid)
+{
+	HeapTuple	tup;
+	bool		result;
+
+	tup = SearchSysCache2(PUBLICATIONRELMAP, ObjectIdGetDatum(relid),
+						  ObjectIdGetDatum(pubid));
+	if (!HeapTupleIsValid(tup))
+		return false;
+
+	result = !heap_attisnull(tup, Anum_pg_publication_rel_prqual, NULL) ||
+		!heap_attisnull(tup, Anum_pg_publication_rel_prattrs, NULL);
+
+	ReleaseSysCache(tup);
+
+	return result;
+}
+
+/*
+ * Allow only immutable built-in functions in a publication row filter.  The
+ * filter is evaluated during logical decoding, where only catalog contents as
+ * of the time of the change are visible, so user-defined functions can't be
+ * relied on to work.
+ */
+static bool
+publication_where_func_checker(Oid func_id, void *context)
+{
+	return func_id >= FirstNormalObjectId;
+}
+
+static bool
+check_publication_where_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+
+	if (check_functions_in_node(node, publication_where_func_checker, NULL))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("user-defined functions and operators are not allowed in publication WHERE expressions")));
+
+	return expression_tree_walker(node, check_publication_where_walker,
+								  context);
+}
+
+/*
+ * Transform the raw row filter of a table being added to a publication.
+ */
+static Node *
+transformPublicationWhereClause(Relation rel, Node *whereClause)
+{
+	ParseState *pstate;
+	ParseNamespaceItem *nsitem;
+	Node	   *result;
+
+	pstate = make_parsestate(NULL);
+
+	nsitem = addRangeTableEntryForRelation(pstate, rel, AccessShareLock,
+										   NULL, false, false);
+	addNSItemToQuery(pstate, nsitem, false, true, true);
+
+	result = transformWhereClause(pstate, copyObject(whereClause),
+								  EXPR_KIND_PUBLICATION_WHERE,
+								  "PUBLICATION WHERE");
+	assign_expr_collations(pstate, result);
+
+	if (contain_mutable_functions(result))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("functions in publication WHERE expressions must be marked IMMUTABLE")));
+
+	(void) check_publication_where_walker(result, NULL);
+
+	free_parsestate(pstate);
+
+	return result;
+}
+
+/*
+ * Open relations specified by a PublicationTable list.
  * The returned tables are locked in ShareUpdateExclusiveLock mode in order to
- * add them to a publication.
+ * add them to a publication.  Returns a list of PublicationRelInfo, carrying
+ * the untransformed row filter and the column list of each table.
  */
 static List *
-OpenTableList(List *tables)
+OpenTableList(List *tables, bool is_drop)
 {
 	List	   *relids = NIL;
 	List	   *rels = NIL;
@@ -515,14 +613,21 @@ OpenTableList(List *tables)
 	 */
 	foreach(lc, tables)
 	{
-		RangeVar   *rv = castNode(RangeVar, lfirst(lc));
+		PublicationTable *t = castNode(PublicationTable, lfirst(lc));
+		RangeVar   *rv = t->relation;
 		bool		recurse = rv->inh;
 		Relation	rel;
 		Oid			myrelid;
+		PublicationRelInfo *pri;
 
 		/* Allow query cancel in case this takes a long time */
 		CHECK_FOR_INTERRUPTS();
 
+		if (is_drop && (t->whereClause || t->columns))
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("cannot use a column list or WHERE clause when removing a table from a publication")));
+
 		rel = table_openrv(rv, ShareUpdateExclusiveLock);
 		myrelid = RelationGetRelid(rel);
 
@@ -539,7 +644,11 @@ OpenTableList(List *tables)
 			continue;
 		}
 
-		rels = lappend(rels, rel);
+		pri = palloc(sizeof(PublicationRelInfo));
+		pri->relation = rel;
+		pri->whereClause = t->whereClause;
+		pri->columns = t->columns;
+		rels = lappend(rels, pri);
 		relids = lappend_oid(relids, myrelid);
 
 		/*
@@ -572,7 +681,11 @@ OpenTableList(List *tables)
 
 				/* find_all_inheritors already got lock */
 				rel = table_open(childrelid, NoLock);
-				rels = lappend(rels, rel);
+				pri = palloc(sizeof(PublicationRelInfo));
+				pri->relation = rel;
+				pri->whereClause = t->whereClause;
+				pri->columns = t->columns;
+				rels = lappend(rels, pri);
 				relids = lappend_oid(relids, childrelid);
 			}
 		}
@@ -593,9 +706,9 @@ CloseTableList(List *rels)
 
 	foreach(lc, rels)
 	{
-		Relation	rel = (Relation) lfirst(lc);
+		PublicationRelInfo *pri = (PublicationRelInfo *) lfirst(lc);
 
-		table_close(rel, NoLock);
+		table_close(pri->relation, NoLock);
 	}
 }
 
@@ -612,7 +725,8 @@ PublicationAddTables(Oid pubid, List *rels, bool if_not_exists,
 
 	foreach(lc, rels)
 	{
-		Relation	rel = (Relation) lfirst(lc);
+		PublicationRelInfo *pri = (PublicationRelInfo *) lfirst(lc);
+		Relation	rel = pri->relation;
 		ObjectAddress obj;
 
 		/* Must be owner of the table or superuser. */
@@ -620,7 +734,11 @@ PublicationAddTables(Oid pubid, List *rels, bool if_not_exists,
 			aclcheck_error(ACLCHECK_NOT_OWNER, get_relkind_objtype(rel->rd_rel->relkind),
 						   RelationGetRelationName(rel));
 
-		obj = publication_add_relation(pubid, rel, if_not_exists);
+		if (pri->whereClause)
+			pri->whereClause = transformPublicationWhereClause(rel,
+															   pri->whereClause);
+
+		obj = publication_add_relation(pubid, pri, if_not_exists);
 		if (stmt)
 		{
 			EventTriggerCollectSimpleCommand(obj, InvalidObjectAddress,
@@ -644,7 +762,8 @@ PublicationDropTables(Oid pubid, List *rels, bool missing_ok)
 
 	foreach(lc, rels)
 	{
-		Relation	rel = (Relation) lfirst(lc);
+		PublicationRelInfo *pri = (PublicationRelInfo *) lfirst(lc);
+		Relation	rel = pri->relation;
 		Oid			relid = RelationGetRelid(rel);
 
 		prid = GetSysCacheOid2(PUBLICATIONRELMAP, Anum_pg_publication_rel_oid,
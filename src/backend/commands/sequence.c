@@ -24,6 +24,7 @@
 #include "access/xlog.h"
 #include "access/xloginsert.h"
 #include "access/xlogutils.h"
+#include "common/int.h"
 #include "catalog/dependency.h"
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
@@ -38,7 +39,9 @@
 #include "nodes/makefuncs.h"
 #include "parser/parse_type.h"
 #include "storage/lmgr.h"
+#include "storage/lwlock.h"
 #include "storage/proc.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
@@ -55,6 +58,12 @@
  */
 #define SEQ_LOG_VALS	32
 
+/*
+ * Number of fetches of CACHE values each that a refill of the shared
+ * sequence cache reserves at once (see below).
+ */
+#define SEQ_SHARED_FETCHES	1024
+
 /*
  * The "special area" of a sequence's buffer page looks like this.
  */
@@ -94,6 +103,58 @@ static HTAB *seqhashtab = NULL; /* hash table for SeqTable items */
  */
 static SeqTableData *last_used_seq = NULL;
 
+/*
+ * Shared sequence cache.
+ *
+ * Every nextval() call that can't be satisfied from the backend's own cache
+ * locks the sequence's buffer and updates its tuple, so a sequence that is
+ * used at a high rate by many sessions becomes a point of contention.  If
+ * sequence_cache_size is set, we instead reserve a range of values for many
+ * fetches at once, WAL-logging the sequence as if all of them had been
+ * fetched, and remember the range in a hash table in shared memory.
+ * nextval() then claims values from the range with an atomic fetch-add, and
+ * only takes the buffer lock again once the range is used up.  As with a
+ * CACHE setting greater than one, the values handed out are distinct, but
+ * values reserved and never used are lost, and last_value reflects the end
+ * of the reserved range.
+ *
+ * The hash table is partitioned, with an LWLock per partition.  Claiming
+ * values only takes the partition lock in shared mode; replacing or removing
+ * an entry requires it in exclusive mode.  A range is only ever replaced by
+ * a backend holding the exclusive lock on the sequence's buffer, after it
+ * has WAL-logged and flushed the new state of the sequence, so all values
+ * handed out from it survive a crash.  setval(), ALTER SEQUENCE and the
+ * like remove the sequence's entry, so the next nextval() takes a new range
+ * from the updated sequence.  Temporary sequences are not cached.
+ */
+#define NUM_SEQ_CACHE_PARTITIONS	16
+
+typedef struct SeqCacheKey
+{
+	Oid			dbid;			/* database of the sequence */
+	Oid			relid;			/* pg_class OID of the sequence */
+} SeqCacheKey;
+
+typedef struct SeqCacheEnt
+{
+	SeqCacheKey key;			/* hash key */
+	RelFileNode node;			/* relfilenode the range was taken from */
+	int64		first;			/* first value of the range */
+	int64		increment;		/* copy of sequence's increment */
+	int64		fetch;			/* values claimed by each nextval() */
+	uint64		nvalues;		/* number of values in the range */
+	pg_atomic_uint64 nclaimed;	/* number of values claimed so far */
+} SeqCacheEnt;
+
+/* GUC variable */
+int			sequence_cache_size = 0;
+
+static HTAB *SeqCacheHash = NULL;
+static LWLockPadded *SeqCacheLocks;
+
+#define SeqCachePartitionLock(hashcode) \
+	(&SeqCacheLocks[(hashcode) % NUM_SEQ_CACHE_PARTITIONS].lock)
+
 static void fill_seq_with_data(Relation rel, HeapTuple tuple);
 static Relation lock_and_open_sequence(SeqTable seq);
 static void create_seq_hashtable(void);
@@ -108,6 +169,12 @@ static void init_params(ParseState *pstate, List *options, bool for_identity,
 						List **owned_by);
 static void do_setval(Oid relid, int64 next, bool iscalled);
 static void process_owned_by(Relation seqrel, List *owned_by, bool for_identity);
+static bool seq_cache_fetch(SeqTable elm, Relation seqrel);
+static bool seq_cache_refill(SeqTable elm, Relation seqrel, Buffer buf,
+							 HeapTuple seqdatatuple, int64 incby,
+							 int64 maxv, int64 minv, int64 cache);
+static void seq_cache_forget(Oid relid);
+static bool seq_cache_claim(SeqTable elm, SeqCacheEnt *ent);
 
 
 /*
@@ -332,6 +399,7 @@ ResetSequence(Oid seq_relid)
 	/* Clear local cache so that we don't think we have cached numbers */
 	/* Note that we do not change the currval() state */
 	elm->cached = elm->last;
+	seq_cache_forget(seq_relid);
 
 	relation_close(seq_rel, NoLock);
 }
@@ -477,6 +545,7 @@ AlterSequence(ParseState *pstate, AlterSeqStmt *stmt)
 	/* Clear local cache so that we don't think we have cached numbers */
 	/* Note that we do not change the currval() state */
 	elm->cached = elm->last;
+	seq_cache_forget(relid);
 
 	/* If needed, rewrite the sequence relation itself */
 	if (need_seq_rewrite)
@@ -538,6 +607,8 @@ DeleteSequenceTuple(Oid relid)
 
 	ReleaseSysCache(tuple);
 	table_close(rel, RowExclusiveLock);
+
+	seq_cache_forget(relid);
 }
 
 /*
@@ -631,6 +702,14 @@ nextval_internal(Oid relid, bool check_permissions)
 		return elm->last;
 	}
 
+	/* Try to claim values from the shared sequence cache */
+	if (seq_cache_fetch(elm, seqrel))
+	{
+		relation_close(seqrel, NoLock);
+		last_used_seq = elm;
+		return elm->last;
+	}
+
 	pgstuple = SearchSysCache1(SEQRELID, ObjectIdGetDatum(relid));
 	if (!HeapTupleIsValid(pgstuple))
 		elog(ERROR, "cache lookup failed for sequence %u", relid);
@@ -646,6 +725,16 @@ nextval_internal(Oid relid, bool check_permissions)
 	seq = read_seq_tuple(seqrel, &buf, &seqdatatuple);
 	page = BufferGetPage(buf);
 
+	/* Reserve a new range of values for the shared cache, if we can */
+	if (seq_cache_refill(elm, seqrel, buf, &seqdatatuple, incby,
+						 maxv, minv, cache))
+	{
+		UnlockReleaseBuffer(buf);
+		relation_close(seqrel, NoLock);
+		last_used_seq = elm;
+		return elm->last;
+	}
+
 	elm->increment = incby;
 	last = next = result = seq->last_value;
 	fetch = cache;
@@ -826,6 +915,337 @@ nextval_internal(Oid relid, bool check_permissions)
 	return result;
 }
 
+/*
+ * Estimate space needed for the shared sequence cache
+ */
+Size
+SequenceCacheShmemSize(void)
+{
+	Size		size;
+
+	if (sequence_cache_size <= 0)
+		return 0;
+
+	size = mul_size(NUM_SEQ_CACHE_PARTITIONS, sizeof(LWLockPadded));
+	size = add_size(size, hash_estimate_size(sequence_cache_size,
+											 sizeof(SeqCacheEnt)));
+
+	return size;
+}
+
+/*
+ * Allocate and initialize the shared sequence cache
+ */
+void
+SequenceCacheShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+	int			i;
+
+	if (sequence_cache_size <= 0)
+		return;
+
+	SeqCacheLocks = (LWLockPadded *)
+		ShmemInitStruct("Sequence Cache Locks",
+						mul_size(NUM_SEQ_CACHE_PARTITIONS, sizeof(LWLockPadded)),
+						&found);
+	if (!found)
+	{
+		for (i = 0; i < NUM_SEQ_CACHE_PARTITIONS; i++)
+			LWLockInitialize(&SeqCacheLocks[i].lock, LWTRANCHE_SEQUENCE_CACHE);
+	}
+
+	info.keysize = sizeof(SeqCacheKey);
+	info.entrysize = sizeof(SeqCacheEnt);
+	info.num_partitions = NUM_SEQ_CACHE_PARTITIONS;
+
+	SeqCacheHash = ShmemInitHash("Sequence Cache",
+								 sequence_cache_size,
+								 sequence_cache_size,
+								 &info,
+								 HASH_ELEM | HASH_BLOBS | HASH_PARTITION |
+								 HASH_FIXED_SIZE);
+}
+
+/*
+ * Claim the next values of a shared cache entry's range for nextval()
+ *
+ * Caller must hold the entry's partition lock.  Returns false if the range
+ * is used up.
+ */
+static bool
+seq_cache_claim(SeqTable elm, SeqCacheEnt *ent)
+{
+	uint64		n;
+
+	/* Don't keep advancing the counter of a range that is used up */
+	if (pg_atomic_read_u64(&ent->nclaimed) >= ent->nvalues)
+		return false;
+
+	/* nvalues is a multiple of fetch, so we get all of them or none */
+	n = pg_atomic_fetch_add_u64(&ent->nclaimed, ent->fetch);
+	if (n >= ent->nvalues)
+		return false;
+
+	/* The values are within the sequence's bounds, so this can't overflow */
+	elm->increment = ent->increment;
+	elm->last = (int64) ((uint64) ent->first + n * (uint64) ent->increment);
+	elm->cached = (int64) ((uint64) elm->last +
+						   (ent->fetch - 1) * (uint64) ent->increment);
+	elm->last_valid = true;
+
+	return true;
+}
+
+/*
+ * seq_cache_fetch
+ *		Try to satisfy nextval() from the shared sequence cache
+ *
+ * On success, the values are stored in the backend's own cache, elm.
+ */
+static bool
+seq_cache_fetch(SeqTable elm, Relation seqrel)
+{
+	SeqCacheKey key;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	SeqCacheEnt *ent;
+	bool		result = false;
+
+	if (SeqCacheHash == NULL || RelationUsesLocalBuffers(seqrel))
+		return false;
+
+	key.dbid = MyDatabaseId;
+	key.relid = elm->relid;
+	hashcode = get_hash_value(SeqCacheHash, &key);
+	partitionLock = SeqCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_SHARED);
+	ent = (SeqCacheEnt *) hash_search_with_hash_value(SeqCacheHash, &key,
+													  hashcode, HASH_FIND,
+													  NULL);
+	if (ent && RelFileNodeEquals(ent->node, seqrel->rd_node))
+		result = seq_cache_claim(elm, ent);
+	LWLockRelease(partitionLock);
+
+	return result;
+}
+
+/*
+ * seq_cache_refill
+ *		Reserve a new range of values of a sequence for the shared cache
+ *
+ * The caller holds the exclusive lock on the sequence's buffer, and has
+ * read its tuple and pg_sequence entry.  On success, the first values of
+ * the range are stored in the backend's own cache, elm, and the sequence
+ * tuple is updated to reflect the whole range.  Returns false if the shared
+ * cache can't be used, in particular when too few values are left before
+ * the end of the sequence; the caller then carries on as usual.
+ */
+static bool
+seq_cache_refill(SeqTable elm, Relation seqrel, Buffer buf,
+				 HeapTuple seqdatatuple, int64 incby,
+				 int64 maxv, int64 minv, int64 cache)
+{
+	Form_pg_sequence_data seq = (Form_pg_sequence_data) GETSTRUCT(seqdatatuple);
+	SeqCacheKey key;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	SeqCacheEnt *ent;
+	bool		found;
+	int64		first;
+	uint64		diff;
+	uint64		step;
+	uint64		nvalues;
+	XLogRecPtr	recptr = InvalidXLogRecPtr;
+
+	if (SeqCacheHash == NULL || RelationUsesLocalBuffers(seqrel))
+		return false;
+	if ((uint64) cache > PG_UINT64_MAX / SEQ_SHARED_FETCHES)
+		return false;
+
+	key.dbid = MyDatabaseId;
+	key.relid = elm->relid;
+	hashcode = get_hash_value(SeqCacheHash, &key);
+	partitionLock = SeqCachePartitionLock(hashcode);
+
+	/*
+	 * Somebody else may have reserved a new range while we were waiting for
+	 * the buffer lock.  Otherwise, make sure there's an entry to put our new
+	 * range in before reserving it.  An entry that's new, or left over from
+	 * an older relfilenode, has no values to claim until we're done.
+	 */
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	ent = (SeqCacheEnt *) hash_search_with_hash_value(SeqCacheHash, &key,
+													  hashcode, HASH_ENTER_NULL,
+													  &found);
+	if (ent && found && RelFileNodeEquals(ent->node, seqrel->rd_node) &&
+		seq_cache_claim(elm, ent))
+	{
+		LWLockRelease(partitionLock);
+		return true;
+	}
+	if (ent)
+	{
+		ent->node = seqrel->rd_node;
+		ent->nvalues = 0;
+		if (found)
+			pg_atomic_write_u64(&ent->nclaimed, 0);
+		else
+			pg_atomic_init_u64(&ent->nclaimed, 0);
+	}
+	LWLockRelease(partitionLock);
+
+	if (ent == NULL)
+		return false;			/* cache is full */
+
+	/*
+	 * Work out the first value to hand out, and how many values there are
+	 * from there to the end of the sequence.
+	 */
+	first = seq->last_value;
+	if (incby > 0)
+	{
+		if (seq->is_called && pg_add_s64_overflow(first, incby, &first))
+			return false;
+		if (first > maxv)
+			return false;
+		diff = (uint64) maxv - (uint64) first;
+		step = (uint64) incby;
+	}
+	else
+	{
+		if (seq->is_called && pg_add_s64_overflow(first, incby, &first))
+			return false;
+		if (first < minv)
+			return false;
+		diff = (uint64) first - (uint64) minv;
+		step = (uint64) 0 - (uint64) incby;
+	}
+	nvalues = Min(diff / step, (uint64) cache * SEQ_SHARED_FETCHES - 1) + 1;
+	nvalues -= nvalues % cache;
+	if (nvalues == 0)
+		return false;
+
+	/* check the comment above nextval_internal()'s equivalent call. */
+	if (RelationNeedsWAL(seqrel))
+		GetTopTransactionId();
+
+	START_CRIT_SECTION();
+
+	/* Update the tuple as if all the values in the range had been fetched */
+	seq->last_value = (int64) ((uint64) first + (nvalues - 1) * (uint64) incby);
+	seq->is_called = true;
+	seq->log_cnt = 0;
+
+	MarkBufferDirty(buf);
+
+	if (RelationNeedsWAL(seqrel))
+	{
+		xl_seq_rec	xlrec;
+
+		XLogBeginInsert();
+		XLogRegisterBuffer(0, buf, REGBUF_WILL_INIT);
+
+		xlrec.node = seqrel->rd_node;
+		XLogRegisterData((char *) &xlrec, sizeof(xl_seq_rec));
+		XLogRegisterData((char *) seqdatatuple->t_data, seqdatatuple->t_len);
+
+		recptr = XLogInsert(RM_SEQ_ID, XLOG_SEQ_LOG);
+
+		PageSetLSN(BufferGetPage(buf), recptr);
+	}
+
+	END_CRIT_SECTION();
+
+	/*
+	 * Other backends will hand out values from the range without writing
+	 * any WAL themselves, and without waiting for our transaction to commit,
+	 * so make sure the new state of the sequence is on disk first.
+	 */
+	if (!XLogRecPtrIsInvalid(recptr))
+		XLogFlush(recptr);
+
+	/* Publish the range, keeping the first values for ourselves */
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	ent = (SeqCacheEnt *) hash_search_with_hash_value(SeqCacheHash, &key,
+													  hashcode, HASH_FIND,
+													  NULL);
+	if (ent)
+	{
+		ent->first = first;
+		ent->increment = incby;
+		ent->fetch = cache;
+		ent->nvalues = nvalues;
+		pg_atomic_write_u64(&ent->nclaimed, cache);
+	}
+	LWLockRelease(partitionLock);
+
+	elm->increment = incby;
+	elm->last = first;
+	elm->cached = (int64) ((uint64) first + (cache - 1) * (uint64) incby);
+	elm->last_valid = true;
+
+	return true;
+}
+
+/*
+ * seq_cache_forget
+ *		Remove a sequence from the shared cache
+ *
+ * This must be called whenever the sequence's state is changed other than
+ * by nextval(), so that nobody goes on claiming values from the old range.
+ */
+static void
+seq_cache_forget(Oid relid)
+{
+	SeqCacheKey key;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+
+	if (SeqCacheHash == NULL)
+		return;
+
+	key.dbid = MyDatabaseId;
+	key.relid = relid;
+	hashcode = get_hash_value(SeqCacheHash, &key);
+	partitionLock = SeqCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	(void) hash_search_with_hash_value(SeqCacheHash, &key, hashcode,
+									   HASH_REMOVE, NULL);
+	LWLockRelease(partitionLock);
+}
+
+/*
+ * SequenceCacheForgetDatabase
+ *		Remove the shared cache entries of all sequences of a database
+ */
+void
+SequenceCacheForgetDatabase(Oid dbid)
+{
+	HASH_SEQ_STATUS status;
+	SeqCacheEnt *ent;
+	int			i;
+
+	if (SeqCacheHash == NULL)
+		return;
+
+	for (i = 0; i < NUM_SEQ_CACHE_PARTITIONS; i++)
+		LWLockAcquire(&SeqCacheLocks[i].lock, LW_EXCLUSIVE);
+
+	hash_seq_init(&status, SeqCacheHash);
+	while ((ent = (SeqCacheEnt *) hash_seq_search(&status)) != NULL)
+	{
+		if (ent->key.dbid == dbid)
+			(void) hash_search(SeqCacheHash, &ent->key, HASH_REMOVE, NULL);
+	}
+
+	for (i = NUM_SEQ_CACHE_PARTITIONS; --i >= 0;)
+		LWLockRelease(&SeqCacheLocks[i].lock);
+}
+
 Datum
 currval_oid(PG_FUNCTION_ARGS)
 {
@@ -974,6 +1394,7 @@ do_setval(Oid relid, int64 next, bool iscalled)
 
 	/* In any case, forget any future cached numbers */
 	elm->cached = elm->last;
+	seq_cache_forget(relid);
 
 	/* check the comment above nextval_internal()'s equivalent call. */
 	if (RelationNeedsWAL(seqrel))
@@ -23,6 +23,7 @@
 #include "access/relscan.h"
 #include "access/sysattr.h"
 #include "access/tableam.h"
+#include "access/toast_compression.h"
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
@@ -420,6 +421,9 @@ static ObjectAddress ATExecSetOptions(Relation rel, const char *colName,
 									  Node *options, bool isReset, LOCKMODE lockmode);
 static ObjectAddress ATExecSetStorage(Relation rel, const char *colName,
 									  Node *newValue, LOCKMODE lockmode);
+static ObjectAddress ATExecSetCompression(Relation rel, const char *colName,
+										  Node *newValue, LOCKMODE lockmode);
+static char GetAttributeCompression(Oid atttypid, char *compression);
 static void ATPrepDropColumn(List **wqueue, Relation rel, bool recurse, bool recursing,
 							 AlterTableCmd *cmd, LOCKMODE lockmode,
 							 AlterTableUtilityContext *context);
@@ -531,6 +535,9 @@ static void ATExecDisableRowSecurity(Relation rel);
 static void ATExecForceNoForceRowSecurity(Relation rel, bool force_rls);
 
 static void index_copy_data(Relation rel, RelFileNode newrnode);
+static void relation_copy_storage(Relation rel, RelFileNode newrnode,
+								  char relpersistence);
+static void ATExecSetLoggedNoRewrite(Oid relid, LOCKMODE lockmode);
 static const char *storage_name(char c);
 
 static void RangeVarCallbackForDropRelation(const RangeVar *rel, Oid relOid,
@@ -852,6 +859,10 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId,
 
 		if (colDef->generated)
 			attr->attgenerated = colDef->generated;
+
+		if (colDef->compression)
+			attr->attcompression = GetAttributeCompression(attr->atttypid,
+														   colDef->compression);
 	}
 
 	/*
@@ -2380,6 +2391,22 @@ MergeAttributes(List *schema, List *supers, char relpersistence,
 									   storage_name(def->storage),
 									   storage_name(attribute->attstorage))));
 
+				/* Copy/check compression parameter */
+				if (CompressionMethodIsValid(attribute->attcompression))
+				{
+					const char *compression =
+					GetCompressionMethodName(attribute->attcompression);
+
+					if (def->compression == NULL)
+						def->compression = pstrdup(compression);
+					else if (strcmp(def->compression, compression) != 0)
+						ereport(ERROR,
+								(errcode(ERRCODE_DATATYPE_MISMATCH),
+								 errmsg("column \"%s\" has a compression method conflict",
+										attributeName),
+								 errdetail("%s versus %s", def->compression, compression)));
+				}
+
 				def->inhcount++;
 				/* Merge of NOT NULL constraints = OR 'em together */
 				def->is_not_null |= attribute->attnotnull;
@@ -2410,6 +2437,11 @@ MergeAttributes(List *schema, List *supers, char relpersistence,
 				def->raw_default = NULL;
 				def->cooked_default = NULL;
 				def->generated = attribute->attgenerated;
+				if (CompressionMethodIsValid(attribute->attcompression))
+					def->compression =
+						pstrdup(GetCompressionMethodName(attribute->attcompression));
+				else
+					def->compression = NULL;
 				def->collClause = NULL;
 				def->collOid = attribute->attcollation;
 				def->constraints = NIL;
@@ -2659,6 +2691,17 @@ MergeAttributes(List *schema, List *supers, char relpersistence,
 									   storage_name(def->storage),
 									   storage_name(newdef->storage))));
 
+				/* Copy compression parameter */
+				if (def->compression == NULL)
+					def->compression = newdef->compression;
+				else if (newdef->compression != NULL &&
+						 strcmp(def->compression, newdef->compression) != 0)
+					ereport(ERROR,
+							(errcode(ERRCODE_DATATYPE_MISMATCH),
+							 errmsg("column \"%s\" has a compression method conflict",
+									attributeName),
+							 errdetail("%s versus %s", def->compression, newdef->compression)));
+
 				/* Mark the column as locally defined */
 				def->is_local = true;
 				/* Merge of NOT NULL constraints = OR 'em together */
@@ -3925,6 +3968,7 @@ AlterTableGetLockLevel(List *cmds)
 				 * updates.
 				 */
 			case AT_SetStatistics:	/* Uses MVCC in getTableAttrs() */
+			case AT_SetCompression: /* Uses MVCC in getTableAttrs() */
 			case AT_ClusterOn:	/* Uses MVCC in getIndexes() */
 			case AT_DropCluster:	/* Uses MVCC in getIndexes() */
 			case AT_SetOptions: /* Uses MVCC in getTableAttrs() */
@@ -4151,6 +4195,12 @@ ATPrepCmd(List **wqueue, Relation rel, AlterTableCmd *cmd,
 			/* No command-specific prep needed */
 			pass = AT_PASS_MISC;
 			break;
+		case AT_SetCompression:	/* ALTER COLUMN SET COMPRESSION */
+			ATSimplePermissions(rel, ATT_TABLE | ATT_MATVIEW);
+			ATSimpleRecursion(wqueue, rel, cmd, recurse, lockmode, context);
+			/* No command-specific prep needed */
+			pass = AT_PASS_MISC;
+			break;
 		case AT_DropColumn:		/* DROP COLUMN */
 			ATSimplePermissions(rel,
 								ATT_TABLE | ATT_COMPOSITE_TYPE | ATT_FOREIGN_TABLE);
@@ -4225,10 +4275,16 @@ ATPrepCmd(List **wqueue, Relation rel, AlterTableCmd *cmd,
 						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 						 errmsg("cannot change persistence setting twice")));
 			tab->chgPersistence = ATPrepChangePersistence(rel, true);
-			/* force rewrite if necessary; see comment in ATRewriteTables */
+
+			/*
+			 * A heap can be made permanent by copying its files, without
+			 * reconstructing the tuples; other table AMs must be rewritten.
+			 * See comment in ATRewriteTables.
+			 */
 			if (tab->chgPersistence)
 			{
-				tab->rewrite |= AT_REWRITE_ALTER_PERSISTENCE;
+				if (rel->rd_rel->relam != HEAP_TABLE_AM_OID)
+					tab->rewrite |= AT_REWRITE_ALTER_PERSISTENCE;
 				tab->newrelpersistence = RELPERSISTENCE_PERMANENT;
 			}
 			pass = AT_PASS_MISC;
@@ -4492,6 +4548,10 @@ ATExecCmd(List **wqueue, AlteredTableInfo *tab, Relation rel,
 		case AT_SetStorage:		/* ALTER COLUMN SET STORAGE */
 			address = ATExecSetStorage(rel, cmd->name, cmd->def, lockmode);
 			break;
+		case AT_SetCompression:	/* ALTER COLUMN SET COMPRESSION */
+			address = ATExecSetCompression(rel, cmd->name, cmd->def,
+										   lockmode);
+			break;
 		case AT_DropColumn:		/* DROP COLUMN */
 			address = ATExecDropColumn(wqueue, rel, cmd->name,
 									   cmd->behavior, false, false,
@@ -4928,12 +4988,13 @@ ATRewriteTables(AlterTableStmt *parsetree, List **wqueue, LOCKMODE lockmode,
 		 * We only need to rewrite the table if at least one column needs to
 		 * be recomputed, or we are changing its persistence.
 		 *
-		 * There are two reasons for requiring a rewrite when changing
+		 * There are two reasons for requiring a new relfilenode when changing
 		 * persistence: on one hand, we need to ensure that the buffers
 		 * belonging to each of the two relations are marked with or without
-		 * BM_PERMANENT properly.  On the other hand, since rewriting creates
-		 * and assigns a new relfilenode, we automatically create or drop an
-		 * init fork for the relation as appropriate.
+		 * BM_PERMANENT properly.  On the other hand, we automatically create
+		 * or drop an init fork for the relation as appropriate.  Making a
+		 * heap permanent doesn't need the tuples to be reconstructed, though,
+		 * so SET LOGGED alone copies the files block by block below.
 		 */
 		if (tab->rewrite > 0)
 		{
@@ -5055,6 +5116,16 @@ ATRewriteTables(AlterTableStmt *parsetree, List **wqueue, LOCKMODE lockmode,
 				tab->partition_constraint != NULL)
 				ATRewriteTable(tab, InvalidOid, lockmode);
 
+			/*
+			 * If we had SET LOGGED but no reason to reconstruct tuples, copy
+			 * the files block by block into new, permanent relfilenodes.
+			 */
+			if (tab->chgPersistence)
+			{
+				Assert(tab->newrelpersistence == RELPERSISTENCE_PERMANENT);
+				ATExecSetLoggedNoRewrite(tab->relid, lockmode);
+			}
+
 			/*
 			 * If we had SET TABLESPACE but no reason to reconstruct tuples,
 			 * just do a block-by-block copy.
@@ -6195,6 +6266,11 @@ ATExecAddColumn(List **wqueue, AlteredTableInfo *tab, Relation rel,
 	attribute.attndims = list_length(colDef->typeName->arrayBounds);
 	attribute.attstorage = tform->typstorage;
 	attribute.attalign = tform->typalign;
+	if (colDef->compression)
+		attribute.attcompression = GetAttributeCompression(typeOid,
+														   colDef->compression);
+	else
+		attribute.attcompression = InvalidCompressionMethod;
 	attribute.attnotnull = colDef->is_not_null;
 	attribute.atthasdef = false;
 	attribute.atthasmissing = false;
@@ -7654,6 +7730,64 @@ ATExecSetStorage(Relation rel, const char *colName, Node *newValue, LOCKMODE loc
 }
 
 
+/*
+ * ALTER TABLE ALTER COLUMN SET COMPRESSION
+ *
+ * Only values compressed from now on use the new method; existing ones are
+ * left alone, so no rewrite is needed.
+ *
+ * Return value is the address of the modified column
+ */
+static ObjectAddress
+ATExecSetCompression(Relation rel, const char *colName, Node *newValue,
+					 LOCKMODE lockmode)
+{
+	Relation	attrelation;
+	HeapTuple	tuple;
+	Form_pg_attribute attrtuple;
+	AttrNumber	attnum;
+	char	   *compression;
+	ObjectAddress address;
+
+	Assert(IsA(newValue, String));
+	compression = strVal(newValue);
+
+	attrelation = table_open(AttributeRelationId, RowExclusiveLock);
+
+	tuple = SearchSysCacheCopyAttName(RelationGetRelid(rel), colName);
+	if (!HeapTupleIsValid(tuple))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_COLUMN),
+				 errmsg("column \"%s\" of relation \"%s\" does not exist",
+						colName, RelationGetRelationName(rel))));
+	attrtuple = (Form_pg_attribute) GETSTRUCT(tuple);
+
+	attnum = attrtuple->attnum;
+	if (attnum <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot alter system column \"%s\"",
+						colName)));
+
+	attrtuple->attcompression = GetAttributeCompression(attrtuple->atttypid,
+														compression);
+
+	CatalogTupleUpdate(attrelation, &tuple->t_self, tuple);
+
+	InvokeObjectPostAlterHook(RelationRelationId,
+							  RelationGetRelid(rel),
+							  attnum);
+
+	heap_freetuple(tuple);
+
+	table_close(attrelation, RowExclusiveLock);
+
+	ObjectAddressSubSet(address, RelationRelationId,
+						RelationGetRelid(rel), attnum);
+	return address;
+}
+
+
 /*
  * ALTER TABLE DROP COLUMN
  *
@@ -8510,15 +8644,15 @@ ATAddForeignKeyConstraint(List **wqueue, AlteredTableInfo *tab, Relation rel,
 		ReleaseSysCache(cla_ht);
 
 		/*
-		 * Check it's a btree; currently this can never fail since no other
-		 * index AMs support unique indexes.  If we ever did have other types
-		 * of unique indexes, we'd need a way to determine which operator
-		 * strategy number is equality.  (Is it reasonable to insist that
-		 * every such index AM use btree's number for equality?)
+		 * Check it's a btree or hash index, the only AMs that support unique
+		 * indexes, and pick the strategy number the AM uses for equality.
 		 */
-		if (amid != BTREE_AM_OID)
-			elog(ERROR, "only b-tree indexes are supported for foreign keys");
-		eqstrategy = BTEqualStrategyNumber;
+		if (amid == BTREE_AM_OID)
+			eqstrategy = BTEqualStrategyNumber;
+		else if (amid == HASH_AM_OID)
+			eqstrategy = HTEqualStrategyNumber;
+		else
+			elog(ERROR, "only b-tree and hash indexes are supported for foreign keys");
 
 		/*
 		 * There had better be a primary equality operator for the index.
@@ -11468,6 +11602,22 @@ ATExecAlterColumnType(AlteredTableInfo *tab, Relation rel,
 								   colName)));
 				break;
 
+			case OCLASS_PUBLICATION_REL:
+
+				/*
+				 * A publication's table entry depends on the columns in its
+				 * column list and in its row filter.  As with policies, punt
+				 * on rewriting the row filter; the table can be dropped from
+				 * the publication and added back instead.
+				 */
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("cannot alter type of a column used by a publication"),
+						 errdetail("%s depends on column \"%s\"",
+								   getObjectDescription(&foundObject, false),
+								   colName)));
+				break;
+
 			case OCLASS_DEFAULT:
 
 				/*
@@ -11516,7 +11666,6 @@ ATExecAlterColumnType(AlteredTableInfo *tab, Relation rel,
 			case OCLASS_EXTENSION:
 			case OCLASS_EVENT_TRIGGER:
 			case OCLASS_PUBLICATION:
-			case OCLASS_PUBLICATION_REL:
 			case OCLASS_SUBSCRIPTION:
 			case OCLASS_TRANSFORM:
 
@@ -11666,6 +11815,9 @@ ATExecAlterColumnType(AlteredTableInfo *tab, Relation rel,
 	attTup->attbyval = tform->typbyval;
 	attTup->attalign = tform->typalign;
 	attTup->attstorage = tform->typstorage;
+	/* a type that can't be compressed can't keep a compression method */
+	if (tform->typstorage == TYPSTORAGE_PLAIN)
+		attTup->attcompression = InvalidCompressionMethod;
 
 	ReleaseSysCache(typeTuple);
 
@@ -12976,6 +13128,25 @@ ATExecSetRelOptions(Relation rel, List *defList, AlterTableType operation,
 		}
 	}
 
+	/*
+	 * Incremental maintenance of a materialized view is set up when the view
+	 * is created, so it can't be turned on or off afterwards.
+	 */
+	if (rel->rd_rel->relkind == RELKIND_MATVIEW)
+	{
+		StdRdOptions *newopts;
+
+		newopts = (StdRdOptions *) heap_reloptions(RELKIND_MATVIEW,
+												   newOptions, false);
+		if ((newopts && newopts->incremental) !=
+			RelationIsIncrementalMatView(rel))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("cannot change the \"incremental\" option of materialized view \"%s\"",
+							RelationGetRelationName(rel)),
+					 errhint("Recreate the materialized view instead.")));
+	}
+
 	/*
 	 * All we need do here is update the pg_class row; the new options will be
 	 * propagated into relcaches during post-commit cache inval.
@@ -13443,6 +13614,17 @@ AlterTableMoveAll(AlterTableMoveAllStmt *stmt)
 
 static void
 index_copy_data(Relation rel, RelFileNode newrnode)
+{
+	relation_copy_storage(rel, newrnode, rel->rd_rel->relpersistence);
+}
+
+/*
+ * Copy the files of a relation to a new relfilenode, which is to have the
+ * given persistence.  That may only differ from the relation's own when
+ * making an unlogged relation permanent; its init fork is not copied then.
+ */
+static void
+relation_copy_storage(Relation rel, RelFileNode newrnode, char relpersistence)
 {
 	SMgrRelation dstrel;
 
@@ -13464,16 +13646,24 @@ index_copy_data(Relation rel, RelFileNode newrnode)
 	 * NOTE: any conflict in relfilenode value will be caught in
 	 * RelationCreateStorage().
 	 */
-	RelationCreateStorage(newrnode, rel->rd_rel->relpersistence);
+	Assert(relpersistence == rel->rd_rel->relpersistence ||
+		   (relpersistence == RELPERSISTENCE_PERMANENT &&
+			rel->rd_rel->relpersistence == RELPERSISTENCE_UNLOGGED));
+
+	RelationCreateStorage(newrnode, relpersistence);
 
 	/* copy main fork */
-	RelationCopyStorage(rel->rd_smgr, dstrel, MAIN_FORKNUM,
-						rel->rd_rel->relpersistence);
+	RelationCopyStorage(rel->rd_smgr, dstrel, MAIN_FORKNUM, relpersistence);
 
 	/* copy those extra forks that exist */
 	for (ForkNumber forkNum = MAIN_FORKNUM + 1;
 		 forkNum <= MAX_FORKNUM; forkNum++)
 	{
+		/* a permanent relation has no init fork */
+		if (forkNum == INIT_FORKNUM &&
+			relpersistence != RELPERSISTENCE_UNLOGGED)
+			continue;
+
 		if (smgrexists(rel->rd_smgr, forkNum))
 		{
 			smgrcreate(dstrel, forkNum, false);
@@ -13482,12 +13672,12 @@ index_copy_data(Relation rel, RelFileNode newrnode)
 			 * WAL log creation if the relation is persistent, or this is the
 			 * init fork of an unlogged relation.
 			 */
-			if (rel->rd_rel->relpersistence == RELPERSISTENCE_PERMANENT ||
-				(rel->rd_rel->relpersistence == RELPERSISTENCE_UNLOGGED &&
+			if (relpersistence == RELPERSISTENCE_PERMANENT ||
+				(relpersistence == RELPERSISTENCE_UNLOGGED &&
 				 forkNum == INIT_FORKNUM))
 				log_smgrcreate(&newrnode, forkNum);
 			RelationCopyStorage(rel->rd_smgr, dstrel, forkNum,
-								rel->rd_rel->relpersistence);
+								relpersistence);
 		}
 	}
 
@@ -13496,6 +13686,94 @@ index_copy_data(Relation rel, RelFileNode newrnode)
 	smgrclose(dstrel);
 }
 
+/*
+ * ATExecSetLoggedNoRewrite
+ *		Make an unlogged heap permanent, along with its toast table and indexes
+ *
+ * Instead of rewriting the table and rebuilding its indexes, we copy the
+ * files of each relation to a new, permanent relfilenode, WAL-logging the
+ * pages in batches (or syncing the files at commit, if wal_level is
+ * minimal).  The new relfilenode gets rid of the init fork, and of shared
+ * buffers not marked BM_PERMANENT, just as a rewrite would.
+ *
+ * GiST indexes are the exception: on unlogged relations they stamp pages
+ * with fake LSNs, which must not be compared with real ones later, so they
+ * are rebuilt.
+ */
+static void
+ATExecSetLoggedNoRewrite(Oid relid, LOCKMODE lockmode)
+{
+	Relation	rel;
+	Oid			reltoastrelid = InvalidOid;
+	List	   *indexoids = NIL;
+	Oid			newrelfilenode;
+	RelFileNode newrnode;
+	Relation	pg_class;
+	HeapTuple	tuple;
+	Form_pg_class rd_rel;
+	ListCell   *lc;
+
+	rel = relation_open(relid, lockmode);
+
+	Assert(rel->rd_rel->relpersistence == RELPERSISTENCE_UNLOGGED);
+	Assert(!RelationIsMapped(rel));
+
+	if (rel->rd_rel->relkind == RELKIND_INDEX &&
+		rel->rd_rel->relam == GIST_AM_OID)
+	{
+		relation_close(rel, NoLock);
+		reindex_index(relid, false, RELPERSISTENCE_PERMANENT, 0);
+		CommandCounterIncrement();
+		return;
+	}
+
+	if (rel->rd_rel->relkind != RELKIND_INDEX)
+	{
+		reltoastrelid = rel->rd_rel->reltoastrelid;
+		indexoids = RelationGetIndexList(rel);
+	}
+
+	/* Get a modifiable copy of the relation's pg_class row */
+	pg_class = table_open(RelationRelationId, RowExclusiveLock);
+
+	tuple = SearchSysCacheCopy1(RELOID, ObjectIdGetDatum(relid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for relation %u", relid);
+	rd_rel = (Form_pg_class) GETSTRUCT(tuple);
+
+	newrelfilenode = GetNewRelFileNode(rel->rd_rel->reltablespace, NULL,
+									   RELPERSISTENCE_PERMANENT);
+	newrnode = rel->rd_node;
+	newrnode.relNode = newrelfilenode;
+
+	relation_copy_storage(rel, newrnode, RELPERSISTENCE_PERMANENT);
+
+	rd_rel->relfilenode = newrelfilenode;
+	rd_rel->relpersistence = RELPERSISTENCE_PERMANENT;
+	CatalogTupleUpdate(pg_class, &tuple->t_self, tuple);
+
+	InvokeObjectPostAlterHook(RelationRelationId, relid, 0);
+
+	heap_freetuple(tuple);
+
+	table_close(pg_class, RowExclusiveLock);
+
+	RelationAssumeNewRelfilenode(rel);
+
+	relation_close(rel, NoLock);
+
+	/* Make sure the relfilenode change is visible */
+	CommandCounterIncrement();
+
+	/* Do the same for the toast table and the indexes */
+	if (OidIsValid(reltoastrelid))
+		ATExecSetLoggedNoRewrite(reltoastrelid, lockmode);
+	foreach(lc, indexoids)
+		ATExecSetLoggedNoRewrite(lfirst_oid(lc), lockmode);
+
+	list_free(indexoids);
+}
+
 /*
  * ALTER TABLE ENABLE/DISABLE TRIGGER
  *
@@ -17529,3 +17807,35 @@ ATDetachCheckNoForeignKeyRefs(Relation partition)
 		table_close(rel, NoLock);
 	}
 }
+
+/*
+ * resolve column compression specification to compression method.
+ */
+static char
+GetAttributeCompression(Oid atttypid, char *compression)
+{
+	char		cmethod;
+
+	if (compression == NULL || strcmp(compression, "default") == 0)
+		return InvalidCompressionMethod;
+
+	/*
+	 * To specify a nondefault method, the column data type must be toastable.
+	 * Note this says nothing about whether the column's attstorage setting
+	 * permits compression; we intentionally allow attstorage and
+	 * attcompression to be independent.
+	 */
+	if (!TypeIsToastable(atttypid))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("column data type %s does not support compression",
+						format_type_be(atttypid))));
+
+	cmethod = CompressionNameToMethod(compression);
+	if (!CompressionMethodIsValid(cmethod))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid compression method \"%s\"", compression)));
+
+	return cmethod;
+}
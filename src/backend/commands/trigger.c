@@ -26,6 +26,7 @@
 #include "catalog/indexing.h"
 #include "catalog/objectaccess.h"
 #include "catalog/partition.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_inherits.h"
 #include "catalog/pg_proc.h"
@@ -59,6 +60,7 @@
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
+#include "utils/spccache.h"
 #include "utils/syscache.h"
 #include "utils/tuplestore.h"
 
@@ -4083,6 +4085,83 @@ afterTriggerMarkEvents(AfterTriggerEventList *events,
 	return found;
 }
 
+/*
+ * State for prefetching the tuples of upcoming events in afterTriggerInvokeEvents
+ */
+typedef struct AfterTriggerPrefetchState
+{
+	int			target;			/* how many events to look ahead, 0 if none */
+	AfterTriggerEvent next;		/* next event of the chunk to look at */
+	int			ahead;			/* prefetched events not yet fired */
+	bool		stopped;		/* reached an event for another relation */
+	BlockNumber last_block;		/* block we last issued a prefetch for */
+} AfterTriggerPrefetchState;
+
+/*
+ * afterTriggerPrefetchEvents()
+ *
+ *	Called before firing "event", issue prefetch requests for the blocks
+ *	holding the tuples of the events that follow it in the chunk, up to
+ *	pf->target of them.  AfterTriggerExecute re-fetches each event's tuples
+ *	by TID; when a bulk UPDATE or DELETE has pushed them out of shared
+ *	buffers, this lets the reads overlap instead of waiting for each block
+ *	in turn.  We only look ahead within the current chunk, and stop at the
+ *	first event for another relation; the state is reset when the caller
+ *	moves to a new chunk or relation.
+ */
+static void
+afterTriggerPrefetchEvents(AfterTriggerPrefetchState *pf,
+						   AfterTriggerEventChunk *chunk,
+						   AfterTriggerEvent event,
+						   CommandId firing_id,
+						   Relation rel)
+{
+#ifdef USE_PREFETCH
+	if (pf->next != NULL && (char *) pf->next > (char *) event)
+		pf->ahead--;
+	else
+	{
+		pf->next = event;
+		pf->ahead = 0;
+		pf->stopped = false;
+	}
+
+	while (!pf->stopped && pf->ahead < pf->target &&
+		   (char *) pf->next < chunk->freeptr)
+	{
+		AfterTriggerEvent ev = pf->next;
+		AfterTriggerShared evtshared = GetTriggerSharedData(ev);
+
+		if ((ev->ate_flags & AFTER_TRIGGER_IN_PROGRESS) &&
+			evtshared->ats_firing_id == firing_id)
+		{
+			if (evtshared->ats_relid != RelationGetRelid(rel))
+			{
+				pf->stopped = true;
+				break;
+			}
+
+			if (ItemPointerIsValid(&(ev->ate_ctid1)) &&
+				ItemPointerGetBlockNumber(&(ev->ate_ctid1)) != pf->last_block)
+			{
+				pf->last_block = ItemPointerGetBlockNumber(&(ev->ate_ctid1));
+				PrefetchBuffer(rel, MAIN_FORKNUM, pf->last_block);
+			}
+			if ((ev->ate_flags & AFTER_TRIGGER_TUP_BITS) == AFTER_TRIGGER_2CTID &&
+				ItemPointerIsValid(&(ev->ate_ctid2)) &&
+				ItemPointerGetBlockNumber(&(ev->ate_ctid2)) != pf->last_block)
+			{
+				pf->last_block = ItemPointerGetBlockNumber(&(ev->ate_ctid2));
+				PrefetchBuffer(rel, MAIN_FORKNUM, pf->last_block);
+			}
+			pf->ahead++;
+		}
+
+		pf->next = (AfterTriggerEvent) ((char *) ev + SizeofTriggerEvent(ev));
+	}
+#endif							/* USE_PREFETCH */
+}
+
 /*
  * afterTriggerInvokeEvents()
  *
@@ -4121,6 +4200,7 @@ afterTriggerInvokeEvents(AfterTriggerEventList *events,
 	Instrumentation *instr = NULL;
 	TupleTableSlot *slot1 = NULL,
 			   *slot2 = NULL;
+	AfterTriggerPrefetchState pf = {0};
 
 	/* Make a local EState if need be */
 	if (estate == NULL)
@@ -4140,6 +4220,8 @@ afterTriggerInvokeEvents(AfterTriggerEventList *events,
 		AfterTriggerEvent event;
 		bool		all_fired_in_chunk = true;
 
+		pf.next = NULL;
+
 		for_each_event(event, chunk)
 		{
 			AfterTriggerShared evtshared = GetTriggerSharedData(event);
@@ -4177,8 +4259,24 @@ afterTriggerInvokeEvents(AfterTriggerEventList *events,
 					if (trigdesc == NULL)	/* should not happen */
 						elog(ERROR, "relation %u has no triggers",
 							 evtshared->ats_relid);
+
+					/*
+					 * Only heap block numbers can be derived from TIDs, so
+					 * don't prefetch for other table AMs.
+					 */
+					pf.next = NULL;
+					pf.last_block = InvalidBlockNumber;
+					if (rel->rd_rel->relkind == RELKIND_RELATION &&
+						rel->rd_rel->relam == HEAP_TABLE_AM_OID)
+						pf.target = get_tablespace_io_concurrency(rel->rd_rel->reltablespace);
+					else
+						pf.target = 0;
 				}
 
+				if (pf.target > 0)
+					afterTriggerPrefetchEvents(&pf, chunk, event, firing_id,
+											   rel);
+
 				/*
 				 * Fire it.  Note that the AFTER_TRIGGER_IN_PROGRESS flag is
 				 * still set, so recursive examinations of the event list
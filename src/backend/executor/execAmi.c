@@ -43,6 +43,8 @@
 #include "executor/nodeNestloop.h"
 #include "executor/nodeProjectSet.h"
 #include "executor/nodeRecursiveunion.h"
+#include "executor/nodeRepartition.h"
+#include "executor/nodeResultCache.h"
 #include "executor/nodeResult.h"
 #include "executor/nodeSamplescan.h"
 #include "executor/nodeSeqscan.h"
@@ -249,6 +251,10 @@ ExecReScan(PlanState *node)
 			ExecReScanMaterial((MaterialState *) node);
 			break;
 
+		case T_ResultCacheState:
+			ExecReScanResultCache((ResultCacheState *) node);
+			break;
+
 		case T_SortState:
 			ExecReScanSort((SortState *) node);
 			break;
@@ -277,6 +283,10 @@ ExecReScan(PlanState *node)
 			ExecReScanHash((HashState *) node);
 			break;
 
+		case T_RepartitionState:
+			ExecReScanRepartition((RepartitionState *) node);
+			break;
+
 		case T_SetOpState:
 			ExecReScanSetOp((SetOpState *) node);
 			break;
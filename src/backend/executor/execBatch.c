@@ -0,0 +1,178 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.c
+ *	  Support for passing tuples between executor nodes in batches.
+ *
+ * Besides the usual ExecProcNode method, which returns one tuple per call,
+ * a node can offer an ExecProcNodeBatch method returning a TupleBatch of up
+ * to executor_batch_size tuples.  That saves a round of function-pointer
+ * dispatch and the surrounding per-call bookkeeping for each tuple passed up
+ * the plan tree, and lets a scan evaluate its qual over the whole batch in
+ * one tight loop, producing a selection vector of the tuples that passed.
+ *
+ * The batch protocol is optional in both directions: a node only offers it
+ * when it can (see ExecPlanCanProduceBatches), and a parent only uses it
+ * when its child offers it (see ExecCanFetchBatches).  Everything else keeps
+ * going through ExecProcNode.  Parents that want to consume the tuples one
+ * at a time can use ExecProcNodeFromBatch.
+ *
+ * Since a batch producer reads ahead of its consumer, it must not do so if
+ * that could have visible side effects, so nodes whose expressions contain
+ * volatile functions don't produce batches.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execBatch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "executor/executor.h"
+#include "optimizer/optimizer.h"
+#include "utils/memutils.h"
+
+
+/* GUC parameter */
+int			executor_batch_size = 64;
+
+
+/*
+ * ExecPlanCanProduceBatches
+ *
+ * Can a node for the given plan hand out its tuples in batches?  This only
+ * checks the conditions common to all node types; callers check their own
+ * requirements too.
+ */
+bool
+ExecPlanCanProduceBatches(Plan *plan)
+{
+	if (executor_batch_size <= 1)
+		return false;
+
+	return !contain_volatile_functions((Node *) plan->qual) &&
+		!contain_volatile_functions((Node *) plan->targetlist);
+}
+
+/*
+ * ExecInitTupleBatch
+ *
+ * Create a batch of executor_batch_size slots of the given type.  The batch
+ * lives until the end of the query, and its slots are released with the
+ * rest of the tuple table.
+ */
+TupleBatch *
+ExecInitTupleBatch(EState *estate, TupleDesc tupdesc,
+				   const TupleTableSlotOps *tts_ops)
+{
+	MemoryContext oldcontext;
+	TupleBatch *batch;
+	int			i;
+
+	Assert(executor_batch_size > 0 && executor_batch_size <= PG_UINT16_MAX);
+
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	batch = palloc0(sizeof(TupleBatch));
+	batch->maxslots = executor_batch_size;
+	batch->selection = palloc(sizeof(uint16) * batch->maxslots);
+	batch->slots = palloc(sizeof(TupleTableSlot *) * batch->maxslots);
+	for (i = 0; i < batch->maxslots; i++)
+		batch->slots[i] = ExecAllocTableSlot(&estate->es_tupleTable,
+											 tupdesc, tts_ops);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return batch;
+}
+
+/*
+ * ExecClearTupleBatch
+ *
+ * Clear the slots of the batch from position "from" on, releasing any
+ * buffer pins they hold, and mark the batch as holding only the slots
+ * before that.
+ */
+void
+ExecClearTupleBatch(TupleBatch *batch, int from)
+{
+	int			i;
+
+	for (i = from; i < batch->nvalid; i++)
+		ExecClearTuple(batch->slots[i]);
+
+	batch->nvalid = from;
+	if (batch->nselected > from)
+		batch->nselected = from;
+}
+
+/*
+ * ExecQualBatch
+ *
+ * Evaluate a qual prepared with ExecInitQual over all the valid slots of the
+ * batch, setting up the batch's selection vector to point at the ones that
+ * satisfy it.  Each slot is placed in *econtext_slot (one of the tuple
+ * fields of econtext) in turn.
+ *
+ * The expression context is not reset between tuples; the caller should
+ * reset it before the next batch.
+ */
+void
+ExecQualBatch(ExprState *qual, ExprContext *econtext,
+			  TupleTableSlot **econtext_slot, TupleBatch *batch)
+{
+	int			nselected = 0;
+	int			i;
+
+	for (i = 0; i < batch->nvalid; i++)
+	{
+		*econtext_slot = batch->slots[i];
+		if (ExecQual(qual, econtext))
+			batch->selection[nselected++] = i;
+	}
+
+	batch->nselected = nselected;
+}
+
+/*
+ * ExecProjectBatch
+ *
+ * Project each selected tuple of the input batch into the slots of the
+ * result batch, which must be of the projection's result type.  Each input
+ * slot is placed in *econtext_slot in turn.  As with ExecProject, the result
+ * slots are virtual and may reference memory of the input tuples and of the
+ * expression context.
+ */
+void
+ExecProjectBatch(ProjectionInfo *projInfo, TupleTableSlot **econtext_slot,
+				 TupleBatch *input, TupleBatch *result)
+{
+	ExprState  *state = &projInfo->pi_state;
+	TupleTableSlot *saveslot = state->resultslot;
+	int			i;
+
+	Assert(input->nselected <= result->maxslots);
+
+	/*
+	 * The compiled projection fetches its result slot from the ExprState on
+	 * each evaluation, so we can simply point it at each slot of the result
+	 * batch in turn.
+	 */
+	for (i = 0; i < input->nselected; i++)
+	{
+		*econtext_slot = input->slots[input->selection[i]];
+		state->resultslot = result->slots[i];
+		(void) ExecProject(projInfo);
+		result->selection[i] = i;
+	}
+
+	state->resultslot = saveslot;
+
+	/* drop whatever the previous batch left in the remaining slots */
+	if (result->nvalid > input->nselected)
+		ExecClearTupleBatch(result, input->nselected);
+	result->nvalid = result->nselected = input->nselected;
+}
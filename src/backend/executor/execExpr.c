@@ -355,10 +355,38 @@ ExecBuildProjectionInfo(List *targetList,
 						TupleTableSlot *slot,
 						PlanState *parent,
 						TupleDesc inputDesc)
+{
+	return ExecBuildQualProjectionInfo(NIL, targetList, econtext, slot,
+									   parent, inputDesc);
+}
+
+/*
+ *		ExecBuildQualProjectionInfo
+ *
+ * As ExecBuildProjectionInfo, but the resulting expression first checks the
+ * given qual (in implicit-AND format, as for ExecInitQual), and only if that
+ * is satisfied goes on to evaluate the tlist.  It is meant to be run with
+ * ExecQualAndProject, which tells the caller whether the qual passed.
+ *
+ * Doing both in one expression saves a separate evaluation of the qual per
+ * row, and lets the columns fetched from the input tuples be shared across
+ * the two.  That matters most when the expression is JIT compiled, since the
+ * filtering and projection then are a single stretch of generated code.
+ *
+ * With an empty qual this is just ExecBuildProjectionInfo.
+ */
+ProjectionInfo *
+ExecBuildQualProjectionInfo(List *qual,
+							List *targetList,
+							ExprContext *econtext,
+							TupleTableSlot *slot,
+							PlanState *parent,
+							TupleDesc inputDesc)
 {
 	ProjectionInfo *projInfo = makeNode(ProjectionInfo);
 	ExprState  *state;
 	ExprEvalStep scratch = {0};
+	List	   *adjust_jumps = NIL;
 	ListCell   *lc;
 
 	projInfo->pi_exprContext = econtext;
@@ -372,7 +400,31 @@ ExecBuildProjectionInfo(List *targetList,
 	state->resultslot = slot;
 
 	/* Insert EEOP_*_FETCHSOME steps as needed */
-	ExecInitExprSlots(state, (Node *) targetList);
+	if (qual != NIL)
+		ExecInitExprSlots(state, (Node *) list_make2(qual, targetList));
+	else
+		ExecInitExprSlots(state, (Node *) targetList);
+
+	/*
+	 * Check the qual first, just like ExecInitQual does: if any of the quals
+	 * yields false or NULL, EEOP_QUAL stores false in the ExprState's
+	 * resvalue and skips over all the rest.
+	 */
+	Assert(qual == NIL || IsA(qual, List));
+	foreach(lc, qual)
+	{
+		Expr	   *node = (Expr *) lfirst(lc);
+
+		ExecInitExprRec(node, state, &state->resvalue, &state->resnull);
+
+		scratch.opcode = EEOP_QUAL;
+		scratch.resvalue = &state->resvalue;
+		scratch.resnull = &state->resnull;
+		scratch.d.qualexpr.jumpdone = -1;
+		ExprEvalPushStep(state, &scratch);
+		adjust_jumps = lappend_int(adjust_jumps,
+								   state->steps_len - 1);
+	}
 
 	/* Now compile each tlist column */
 	foreach(lc, targetList)
@@ -469,6 +521,30 @@ ExecBuildProjectionInfo(List *targetList,
 		}
 	}
 
+	if (qual != NIL)
+	{
+		/*
+		 * We got here only if the qual was satisfied, so report that.  The
+		 * tlist columns may have left anything in resvalue/resnull.
+		 */
+		scratch.opcode = EEOP_CONST;
+		scratch.resvalue = &state->resvalue;
+		scratch.resnull = &state->resnull;
+		scratch.d.constval.value = BoolGetDatum(true);
+		scratch.d.constval.isnull = false;
+		ExprEvalPushStep(state, &scratch);
+
+		/* a failed qual jumps to the end */
+		foreach(lc, adjust_jumps)
+		{
+			ExprEvalStep *as = &state->steps[lfirst_int(lc)];
+
+			Assert(as->opcode == EEOP_QUAL);
+			Assert(as->d.qualexpr.jumpdone == -1);
+			as->d.qualexpr.jumpdone = state->steps_len;
+		}
+	}
+
 	scratch.opcode = EEOP_DONE;
 	ExprEvalPushStep(state, &scratch);
 
@@ -2235,7 +2311,15 @@ ExecInitFunc(ExprEvalStep *scratch, Expr *node, List *args, Oid funcid,
 	if (pgstat_track_functions <= flinfo->fn_stats)
 	{
 		if (flinfo->fn_strict && nargs > 0)
-			scratch->opcode = EEOP_FUNCEXPR_STRICT;
+		{
+			/* Choose nargs optimized implementation if available. */
+			if (nargs == 1)
+				scratch->opcode = EEOP_FUNCEXPR_STRICT_1;
+			else if (nargs == 2)
+				scratch->opcode = EEOP_FUNCEXPR_STRICT_2;
+			else
+				scratch->opcode = EEOP_FUNCEXPR_STRICT;
+		}
 		else
 			scratch->opcode = EEOP_FUNCEXPR;
 	}
@@ -0,0 +1,562 @@
+/*-------------------------------------------------------------------------
+ *
+ * execExprVector.c
+ *	  Column-at-a-time evaluation of simple quals over a batch of tuples.
+ *
+ * ExecQualBatch evaluates a qual over a TupleBatch by running the compiled
+ * ExprState once per tuple.  For the most common kinds of filter clauses,
+ * comparisons of a scan column with a constant, null tests, and AND/OR
+ * combinations of those, we can do much better: deform the whole batch
+ * once, gather each referenced column into an array, and evaluate the
+ * comparison over the array in a tight loop without any per-tuple dispatch
+ * or function calls, a loop the compiler can unroll and vectorize.
+ *
+ * ExecInitVectorQual splits a qual's clauses into those that can be
+ * evaluated that way and the rest.  ExecVectorQual first evaluates the
+ * former over the batch and then the remaining ones, compiled into an
+ * ordinary ExprState, over the tuples still selected.  None of the
+ * vectorized clauses can fail, so evaluating them ahead of the others
+ * can only avoid evaluating the others, not cause new errors.
+ *
+ * While evaluating, a NULL clause result is treated like false.  That's
+ * right for the qual as a whole since the vectorized expressions don't
+ * include NOT, so a NULL can never turn into true further up.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execExprVector.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "catalog/pg_type.h"
+#include "executor/executor.h"
+#include "utils/float.h"
+#include "utils/fmgroids.h"
+#include "utils/memutils.h"
+
+
+typedef enum VectorQualNodeKind
+{
+	VQN_AND,					/* AND of args */
+	VQN_OR,						/* OR of args */
+	VQN_INT_CMP,				/* column of an integer type vs. constant */
+	VQN_FLOAT_CMP,				/* column of a float type vs. constant */
+	VQN_ISNULL,					/* column IS NULL */
+	VQN_ISNOTNULL				/* column IS NOT NULL */
+} VectorQualNodeKind;
+
+typedef enum VectorQualCmp
+{
+	VQC_LT,
+	VQC_LE,
+	VQC_EQ,
+	VQC_NE,
+	VQC_GE,
+	VQC_GT
+} VectorQualCmp;
+
+typedef struct VectorQualNode
+{
+	VectorQualNodeKind kind;
+
+	/* for VQN_AND and VQN_OR */
+	int			nargs;
+	struct VectorQualNode **args;
+
+	/* for the other kinds */
+	int			attno;			/* zero-based column number */
+	Oid			typid;			/* column's data type */
+	VectorQualCmp cmp;			/* comparison, column on the left */
+	int64		ival;			/* constant for VQN_INT_CMP */
+	float8		fval;			/* constant for VQN_FLOAT_CMP */
+
+	bool	   *match;			/* workspace: result for each tuple */
+} VectorQualNode;
+
+struct VectorQualState
+{
+	VectorQualNode *root;		/* the vectorized clauses, ANDed */
+	ExprState  *residual;		/* the other clauses, or NULL */
+	int			natts;			/* # of columns to deform */
+
+	/* workspace, sized for maxrows tuples */
+	MemoryContext mcxt;
+	int			maxrows;
+	int64	   *ivals;
+	float8	   *fvals;
+	bool	   *nulls;
+};
+
+
+/*
+ * Map a comparison function to the kind of vectorized comparison it
+ * performs, or return false if we don't know it.
+ */
+static bool
+vector_qual_comparison(Oid funcid, VectorQualNodeKind *kind,
+					   VectorQualCmp *cmp, Oid *typid)
+{
+	switch (funcid)
+	{
+#define VQ_CMPFUNC(fn, k, c, t) \
+		case fn: \
+			*kind = k; \
+			*cmp = c; \
+			*typid = t; \
+			return true
+
+			VQ_CMPFUNC(F_INT2LT, VQN_INT_CMP, VQC_LT, INT2OID);
+			VQ_CMPFUNC(F_INT2LE, VQN_INT_CMP, VQC_LE, INT2OID);
+			VQ_CMPFUNC(F_INT2EQ, VQN_INT_CMP, VQC_EQ, INT2OID);
+			VQ_CMPFUNC(F_INT2NE, VQN_INT_CMP, VQC_NE, INT2OID);
+			VQ_CMPFUNC(F_INT2GE, VQN_INT_CMP, VQC_GE, INT2OID);
+			VQ_CMPFUNC(F_INT2GT, VQN_INT_CMP, VQC_GT, INT2OID);
+			VQ_CMPFUNC(F_INT4LT, VQN_INT_CMP, VQC_LT, INT4OID);
+			VQ_CMPFUNC(F_INT4LE, VQN_INT_CMP, VQC_LE, INT4OID);
+			VQ_CMPFUNC(F_INT4EQ, VQN_INT_CMP, VQC_EQ, INT4OID);
+			VQ_CMPFUNC(F_INT4NE, VQN_INT_CMP, VQC_NE, INT4OID);
+			VQ_CMPFUNC(F_INT4GE, VQN_INT_CMP, VQC_GE, INT4OID);
+			VQ_CMPFUNC(F_INT4GT, VQN_INT_CMP, VQC_GT, INT4OID);
+			VQ_CMPFUNC(F_INT8LT, VQN_INT_CMP, VQC_LT, INT8OID);
+			VQ_CMPFUNC(F_INT8LE, VQN_INT_CMP, VQC_LE, INT8OID);
+			VQ_CMPFUNC(F_INT8EQ, VQN_INT_CMP, VQC_EQ, INT8OID);
+			VQ_CMPFUNC(F_INT8NE, VQN_INT_CMP, VQC_NE, INT8OID);
+			VQ_CMPFUNC(F_INT8GE, VQN_INT_CMP, VQC_GE, INT8OID);
+			VQ_CMPFUNC(F_INT8GT, VQN_INT_CMP, VQC_GT, INT8OID);
+			VQ_CMPFUNC(F_FLOAT4LT, VQN_FLOAT_CMP, VQC_LT, FLOAT4OID);
+			VQ_CMPFUNC(F_FLOAT4LE, VQN_FLOAT_CMP, VQC_LE, FLOAT4OID);
+			VQ_CMPFUNC(F_FLOAT4EQ, VQN_FLOAT_CMP, VQC_EQ, FLOAT4OID);
+			VQ_CMPFUNC(F_FLOAT4NE, VQN_FLOAT_CMP, VQC_NE, FLOAT4OID);
+			VQ_CMPFUNC(F_FLOAT4GE, VQN_FLOAT_CMP, VQC_GE, FLOAT4OID);
+			VQ_CMPFUNC(F_FLOAT4GT, VQN_FLOAT_CMP, VQC_GT, FLOAT4OID);
+			VQ_CMPFUNC(F_FLOAT8LT, VQN_FLOAT_CMP, VQC_LT, FLOAT8OID);
+			VQ_CMPFUNC(F_FLOAT8LE, VQN_FLOAT_CMP, VQC_LE, FLOAT8OID);
+			VQ_CMPFUNC(F_FLOAT8EQ, VQN_FLOAT_CMP, VQC_EQ, FLOAT8OID);
+			VQ_CMPFUNC(F_FLOAT8NE, VQN_FLOAT_CMP, VQC_NE, FLOAT8OID);
+			VQ_CMPFUNC(F_FLOAT8GE, VQN_FLOAT_CMP, VQC_GE, FLOAT8OID);
+			VQ_CMPFUNC(F_FLOAT8GT, VQN_FLOAT_CMP, VQC_GT, FLOAT8OID);
+
+#undef VQ_CMPFUNC
+		default:
+			return false;
+	}
+}
+
+/* Is this a Var referencing a column of the scan tuple? */
+static bool
+is_scan_column(Node *node)
+{
+	Var		   *var = (Var *) node;
+
+	return IsA(node, Var) &&
+		var->varattno > 0 &&
+		var->varlevelsup == 0 &&
+		!IS_SPECIAL_VARNO(var->varno);
+}
+
+/*
+ * Build the vectorized form of a qual clause, or return NULL if it has
+ * parts we can't vectorize.  *natts is raised to cover the columns used.
+ */
+static VectorQualNode *
+build_vector_qual_node(Expr *expr, int *natts)
+{
+	VectorQualNode *node;
+
+	if (IsA(expr, OpExpr) && list_length(((OpExpr *) expr)->args) == 2)
+	{
+		OpExpr	   *op = (OpExpr *) expr;
+		Node	   *larg = linitial(op->args);
+		Node	   *rarg = lsecond(op->args);
+		VectorQualNodeKind kind;
+		VectorQualCmp cmp;
+		Oid			typid;
+		Var		   *var;
+		Const	   *con;
+
+		if (!vector_qual_comparison(op->opfuncid, &kind, &cmp, &typid))
+			return NULL;
+
+		if (is_scan_column(larg) && IsA(rarg, Const))
+		{
+			var = (Var *) larg;
+			con = (Const *) rarg;
+		}
+		else if (IsA(larg, Const) && is_scan_column(rarg))
+		{
+			static const VectorQualCmp commuted[] = {
+				VQC_GT, VQC_GE, VQC_EQ, VQC_NE, VQC_LE, VQC_LT
+			};
+
+			var = (Var *) rarg;
+			con = (Const *) larg;
+			cmp = commuted[cmp];
+		}
+		else
+			return NULL;
+
+		/* a NULL constant makes the strict comparison NULL; leave that be */
+		if (con->constisnull || var->vartype != typid ||
+			con->consttype != typid)
+			return NULL;
+
+		node = palloc0(sizeof(VectorQualNode));
+		node->kind = kind;
+		node->attno = var->varattno - 1;
+		node->typid = typid;
+		node->cmp = cmp;
+		switch (typid)
+		{
+			case INT2OID:
+				node->ival = DatumGetInt16(con->constvalue);
+				break;
+			case INT4OID:
+				node->ival = DatumGetInt32(con->constvalue);
+				break;
+			case INT8OID:
+				node->ival = DatumGetInt64(con->constvalue);
+				break;
+			case FLOAT4OID:
+				node->fval = DatumGetFloat4(con->constvalue);
+				break;
+			case FLOAT8OID:
+				node->fval = DatumGetFloat8(con->constvalue);
+				break;
+		}
+		*natts = Max(*natts, var->varattno);
+		return node;
+	}
+	else if (IsA(expr, NullTest))
+	{
+		NullTest   *ntest = (NullTest *) expr;
+
+		/* row-valued IS [NOT] NULL has different semantics */
+		if (ntest->argisrow || !is_scan_column((Node *) ntest->arg))
+			return NULL;
+
+		node = palloc0(sizeof(VectorQualNode));
+		node->kind = (ntest->nulltesttype == IS_NULL) ? VQN_ISNULL : VQN_ISNOTNULL;
+		node->attno = ((Var *) ntest->arg)->varattno - 1;
+		*natts = Max(*natts, node->attno + 1);
+		return node;
+	}
+	else if (IsA(expr, BoolExpr) && ((BoolExpr *) expr)->boolop != NOT_EXPR)
+	{
+		BoolExpr   *boolexpr = (BoolExpr *) expr;
+		ListCell   *lc;
+		int			i = 0;
+
+		node = palloc0(sizeof(VectorQualNode));
+		node->kind = (boolexpr->boolop == AND_EXPR) ? VQN_AND : VQN_OR;
+		node->nargs = list_length(boolexpr->args);
+		node->args = palloc(sizeof(VectorQualNode *) * node->nargs);
+		foreach(lc, boolexpr->args)
+		{
+			node->args[i] = build_vector_qual_node((Expr *) lfirst(lc), natts);
+			if (node->args[i] == NULL)
+				return NULL;
+			i++;
+		}
+		return node;
+	}
+
+	return NULL;
+}
+
+/*
+ * ExecInitVectorQual
+ *
+ * Prepare a qual, given in implicit-AND list form, for evaluation over
+ * batches of scan tuples with ExecVectorQual.  Returns NULL if none of its
+ * clauses can be vectorized, in which case the caller should just use
+ * ExecQualBatch.
+ */
+VectorQualState *
+ExecInitVectorQual(List *qual, PlanState *parent)
+{
+	VectorQualState *vqstate;
+	List	   *clauses = NIL;
+	List	   *residual = NIL;
+	int			natts = 0;
+	ListCell   *lc;
+
+	foreach(lc, qual)
+	{
+		Expr	   *clause = (Expr *) lfirst(lc);
+		VectorQualNode *node = build_vector_qual_node(clause, &natts);
+
+		if (node != NULL)
+			clauses = lappend(clauses, node);
+		else
+			residual = lappend(residual, clause);
+	}
+
+	if (clauses == NIL)
+		return NULL;
+
+	vqstate = palloc0(sizeof(VectorQualState));
+	if (list_length(clauses) == 1)
+		vqstate->root = linitial(clauses);
+	else
+	{
+		VectorQualNode *root = palloc0(sizeof(VectorQualNode));
+		int			i = 0;
+
+		root->kind = VQN_AND;
+		root->nargs = list_length(clauses);
+		root->args = palloc(sizeof(VectorQualNode *) * root->nargs);
+		foreach(lc, clauses)
+			root->args[i++] = lfirst(lc);
+		vqstate->root = root;
+	}
+	vqstate->residual = ExecInitQual(residual, parent);
+	vqstate->natts = natts;
+	vqstate->mcxt = CurrentMemoryContext;
+
+	return vqstate;
+}
+
+/*
+ * Make sure the workspace of the given node and its children can hold
+ * nrows results.
+ */
+static void
+alloc_vector_qual_node(VectorQualState *vqstate, VectorQualNode *node,
+					   int nrows)
+{
+	int			i;
+
+	if (node->match)
+		pfree(node->match);
+	node->match = MemoryContextAlloc(vqstate->mcxt, sizeof(bool) * nrows);
+
+	for (i = 0; i < node->nargs; i++)
+		alloc_vector_qual_node(vqstate, node->args[i], nrows);
+}
+
+/*
+ * Gather column "attno" of the first n tuples of the batch into the
+ * integer or float workspace array, and its null flags into "nulls".
+ */
+static void
+gather_vector_column(VectorQualState *vqstate, VectorQualNode *node,
+					 TupleBatch *batch, int n)
+{
+	int			attno = node->attno;
+	bool	   *nulls = vqstate->nulls;
+	int			i;
+
+	for (i = 0; i < n; i++)
+		nulls[i] = batch->slots[i]->tts_isnull[attno];
+
+	/*
+	 * Pass-by-reference types must not be dereferenced for NULLs, so check
+	 * them even where it wouldn't be needed when passed by value.
+	 */
+#define GATHER_LOOP(dst, getter) \
+	for (i = 0; i < n; i++) \
+		(dst)[i] = nulls[i] ? 0 : getter(batch->slots[i]->tts_values[attno])
+
+	switch (node->typid)
+	{
+		case INT2OID:
+			GATHER_LOOP(vqstate->ivals, DatumGetInt16);
+			break;
+		case INT4OID:
+			GATHER_LOOP(vqstate->ivals, DatumGetInt32);
+			break;
+		case INT8OID:
+			GATHER_LOOP(vqstate->ivals, DatumGetInt64);
+			break;
+		case FLOAT4OID:
+			GATHER_LOOP(vqstate->fvals, DatumGetFloat4);
+			break;
+		case FLOAT8OID:
+			GATHER_LOOP(vqstate->fvals, DatumGetFloat8);
+			break;
+		default:
+			elog(ERROR, "unrecognized type for vectorized qual: %u",
+				 node->typid);
+	}
+
+#undef GATHER_LOOP
+}
+
+/*
+ * Evaluate a vectorized qual node over the first n tuples of the batch,
+ * leaving the results in node->match.
+ */
+static void
+eval_vector_qual_node(VectorQualState *vqstate, VectorQualNode *node,
+					  TupleBatch *batch, int n)
+{
+	bool	   *match = node->match;
+	bool	   *nulls = vqstate->nulls;
+	int			i;
+	int			j;
+
+#define CMP_LOOP(expr) \
+	for (i = 0; i < n; i++) \
+		match[i] = !nulls[i] && (expr)
+
+	switch (node->kind)
+	{
+		case VQN_AND:
+		case VQN_OR:
+			eval_vector_qual_node(vqstate, node->args[0], batch, n);
+			memcpy(match, node->args[0]->match, sizeof(bool) * n);
+			for (j = 1; j < node->nargs; j++)
+			{
+				bool	   *argmatch = node->args[j]->match;
+
+				eval_vector_qual_node(vqstate, node->args[j], batch, n);
+				if (node->kind == VQN_AND)
+				{
+					for (i = 0; i < n; i++)
+						match[i] &= argmatch[i];
+				}
+				else
+				{
+					for (i = 0; i < n; i++)
+						match[i] |= argmatch[i];
+				}
+			}
+			break;
+
+		case VQN_INT_CMP:
+			{
+				int64	   *vals = vqstate->ivals;
+				int64		c = node->ival;
+
+				gather_vector_column(vqstate, node, batch, n);
+				switch (node->cmp)
+				{
+					case VQC_LT:
+						CMP_LOOP(vals[i] < c);
+						break;
+					case VQC_LE:
+						CMP_LOOP(vals[i] <= c);
+						break;
+					case VQC_EQ:
+						CMP_LOOP(vals[i] == c);
+						break;
+					case VQC_NE:
+						CMP_LOOP(vals[i] != c);
+						break;
+					case VQC_GE:
+						CMP_LOOP(vals[i] >= c);
+						break;
+					case VQC_GT:
+						CMP_LOOP(vals[i] > c);
+						break;
+				}
+				break;
+			}
+
+		case VQN_FLOAT_CMP:
+			{
+				/* float4 values compare the same way after widening */
+				float8	   *vals = vqstate->fvals;
+				float8		c = node->fval;
+
+				gather_vector_column(vqstate, node, batch, n);
+				switch (node->cmp)
+				{
+					case VQC_LT:
+						CMP_LOOP(float8_lt(vals[i], c));
+						break;
+					case VQC_LE:
+						CMP_LOOP(float8_le(vals[i], c));
+						break;
+					case VQC_EQ:
+						CMP_LOOP(float8_eq(vals[i], c));
+						break;
+					case VQC_NE:
+						CMP_LOOP(float8_ne(vals[i], c));
+						break;
+					case VQC_GE:
+						CMP_LOOP(float8_ge(vals[i], c));
+						break;
+					case VQC_GT:
+						CMP_LOOP(float8_gt(vals[i], c));
+						break;
+				}
+				break;
+			}
+
+		case VQN_ISNULL:
+			for (i = 0; i < n; i++)
+				match[i] = batch->slots[i]->tts_isnull[node->attno];
+			break;
+
+		case VQN_ISNOTNULL:
+			for (i = 0; i < n; i++)
+				match[i] = !batch->slots[i]->tts_isnull[node->attno];
+			break;
+	}
+
+#undef CMP_LOOP
+}
+
+/*
+ * ExecVectorQual
+ *
+ * Counterpart of ExecQualBatch for quals prepared with ExecInitVectorQual:
+ * set up the batch's selection vector to point at the tuples satisfying
+ * the qual.
+ */
+void
+ExecVectorQual(VectorQualState *vqstate, ExprContext *econtext,
+			   TupleTableSlot **econtext_slot, TupleBatch *batch)
+{
+	int			n = batch->nvalid;
+	bool	   *match;
+	int			nselected = 0;
+	int			i;
+
+	if (vqstate->maxrows < batch->maxslots)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(vqstate->mcxt);
+
+		if (vqstate->ivals)
+		{
+			pfree(vqstate->ivals);
+			pfree(vqstate->fvals);
+			pfree(vqstate->nulls);
+		}
+		vqstate->ivals = palloc(sizeof(int64) * batch->maxslots);
+		vqstate->fvals = palloc(sizeof(float8) * batch->maxslots);
+		vqstate->nulls = palloc(sizeof(bool) * batch->maxslots);
+		alloc_vector_qual_node(vqstate, vqstate->root, batch->maxslots);
+		vqstate->maxrows = batch->maxslots;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	/* deform the columns we need */
+	for (i = 0; i < n; i++)
+		slot_getsomeattrs(batch->slots[i], vqstate->natts);
+
+	eval_vector_qual_node(vqstate, vqstate->root, batch, n);
+
+	match = vqstate->root->match;
+	for (i = 0; i < n; i++)
+	{
+		if (!match[i])
+			continue;
+		if (vqstate->residual)
+		{
+			*econtext_slot = batch->slots[i];
+			if (!ExecQual(vqstate->residual, econtext))
+				continue;
+		}
+		batch->selection[nselected++] = i;
+	}
+
+	batch->nselected = nselected;
+}
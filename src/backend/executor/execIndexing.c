@@ -6,7 +6,8 @@
  *
  * ExecInsertIndexTuples() is the main entry point.  It's called after
  * inserting a tuple to the heap, and it inserts corresponding index tuples
- * into all indexes.  At the same time, it enforces any unique and
+ * into all indexes.  After inserting a batch of tuples to the heap,
+ * ExecInsertIndexTuplesMulti() can be used to handle most indexes first.  At the same time, it enforces any unique and
  * exclusion constraints:
  *
  * Unique Indexes
@@ -106,6 +107,7 @@
  */
 #include "postgres.h"
 
+#include "access/amapi.h"
 #include "access/genam.h"
 #include "access/relscan.h"
 #include "access/tableam.h"
@@ -136,6 +138,8 @@ static bool check_exclusion_or_unique_constraint(Relation heap, Relation index,
 static bool index_recheck_constraint(Relation index, Oid *constr_procs,
 									 Datum *existing_values, bool *existing_isnull,
 									 Datum *new_values);
+static bool ExecIndexAllowsMultiInsert(Relation indexRelation,
+									   IndexInfo *indexInfo);
 
 /* ----------------------------------------------------------------
  *		ExecOpenIndices
@@ -264,9 +268,16 @@ ExecCloseIndices(ResultRelInfo *resultRelInfo)
  *		If 'arbiterIndexes' is nonempty, noDupErr applies only to
  *		those indexes.  NIL means noDupErr applies to all indexes.
  *
- *		CAUTION: this must not be called for a HOT update.
- *		We can't defend against that here for lack of info.
- *		Should we change the API to make it safer?
+ *		If 'skipMultiInsert' is true, indexes that ExecInsertIndexTuplesMulti
+ *		handles are skipped, as caller has used that for them already.
+ *
+ *		If 'onlySummarizing' is true, only summarizing indexes are updated.
+ *		That's what a HOT update that modified a column of a summarizing
+ *		index needs.
+ *
+ *		CAUTION: this must not be called for a HOT update, except with
+ *		'onlySummarizing'.  We can't defend against that here for lack of
+ *		info.  Should we change the API to make it safer?
  * ----------------------------------------------------------------
  */
 List *
@@ -274,7 +285,9 @@ ExecInsertIndexTuples(TupleTableSlot *slot,
 					  EState *estate,
 					  bool noDupErr,
 					  bool *specConflict,
-					  List *arbiterIndexes)
+					  List *arbiterIndexes,
+					  bool skipMultiInsert,
+					  bool onlySummarizing)
 {
 	ItemPointer tupleid = &slot->tts_tid;
 	List	   *result = NIL;
@@ -331,6 +344,17 @@ ExecInsertIndexTuples(TupleTableSlot *slot,
 		if (!indexInfo->ii_ReadyForInserts)
 			continue;
 
+		if (skipMultiInsert && ExecIndexAllowsMultiInsert(indexRelation,
+														  indexInfo))
+			continue;
+
+		/*
+		 * Skip processing of non-summarizing indexes if we only update
+		 * summarizing indexes
+		 */
+		if (onlySummarizing && !indexRelation->rd_indam->amsummarizing)
+			continue;
+
 		/* Check for partial index */
 		if (indexInfo->ii_Predicate != NIL)
 		{
@@ -461,6 +485,107 @@ ExecInsertIndexTuples(TupleTableSlot *slot,
 	return result;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecInsertIndexTuplesMulti
+ *
+ *		This routine inserts the index tuples for several heap tuples
+ *		inserted into the result relation at once, as by COPY, into the
+ *		indexes that allow that: those whose access method provides
+ *		aminsertmulti, and that have no constraints to enforce, nor
+ *		expressions or a predicate whose evaluation might fail for one of
+ *		the tuples.  The access method can then sort the tuples and insert
+ *		those going to the same place together.
+ *
+ *		Caller must still call ExecInsertIndexTuples with skipMultiInsert
+ *		for each heap tuple, to take care of the other indexes.
+ * ----------------------------------------------------------------
+ */
+void
+ExecInsertIndexTuplesMulti(TupleTableSlot **slots,
+						   int nslots,
+						   EState *estate)
+{
+	ResultRelInfo *resultRelInfo;
+	int			i;
+	int			numIndices;
+	RelationPtr relationDescs;
+	Relation	heapRelation;
+	IndexInfo **indexInfoArray;
+	MemoryContext oldcontext;
+	Datum	  **values = NULL;
+	bool	  **isnull = NULL;
+	ItemPointer tupleids = NULL;
+
+	/*
+	 * Get information from the result relation info structure.
+	 */
+	resultRelInfo = estate->es_result_relation_info;
+	numIndices = resultRelInfo->ri_NumIndices;
+	relationDescs = resultRelInfo->ri_IndexRelationDescs;
+	indexInfoArray = resultRelInfo->ri_IndexRelationInfo;
+	heapRelation = resultRelInfo->ri_RelationDesc;
+
+	/* Work in the EState's per-tuple context, like ExecInsertIndexTuples */
+	oldcontext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+
+	for (i = 0; i < numIndices; i++)
+	{
+		Relation	indexRelation = relationDescs[i];
+		IndexInfo  *indexInfo;
+		int			j;
+
+		if (indexRelation == NULL)
+			continue;
+
+		indexInfo = indexInfoArray[i];
+
+		/* If the index is marked as read-only, ignore it */
+		if (!indexInfo->ii_ReadyForInserts)
+			continue;
+
+		if (!ExecIndexAllowsMultiInsert(indexRelation, indexInfo))
+			continue;
+
+		/* Set up the arrays on first use, they can be reused for all */
+		if (values == NULL)
+		{
+			values = palloc(nslots * sizeof(Datum *));
+			isnull = palloc(nslots * sizeof(bool *));
+			tupleids = palloc(nslots * sizeof(ItemPointerData));
+			for (j = 0; j < nslots; j++)
+			{
+				Assert(slots[j]->tts_tableOid == RelationGetRelid(heapRelation));
+				Assert(ItemPointerIsValid(&slots[j]->tts_tid));
+
+				values[j] = palloc(INDEX_MAX_KEYS * sizeof(Datum));
+				isnull[j] = palloc(INDEX_MAX_KEYS * sizeof(bool));
+				tupleids[j] = slots[j]->tts_tid;
+			}
+		}
+
+		for (j = 0; j < nslots; j++)
+			FormIndexDatum(indexInfo, slots[j], estate, values[j], isnull[j]);
+
+		index_insert_multi(indexRelation, values, isnull, tupleids, nslots,
+						   heapRelation, indexInfo);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Can ExecInsertIndexTuplesMulti handle this index?
+ */
+static bool
+ExecIndexAllowsMultiInsert(Relation indexRelation, IndexInfo *indexInfo)
+{
+	return indexRelation->rd_indam->aminsertmulti != NULL &&
+		!indexRelation->rd_index->indisunique &&
+		indexInfo->ii_ExclusionOps == NULL &&
+		indexInfo->ii_Expressions == NIL &&
+		indexInfo->ii_Predicate == NIL;
+}
+
 /* ----------------------------------------------------------------
  *		ExecCheckIndexConstraints
  *
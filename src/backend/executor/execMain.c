@@ -39,12 +39,14 @@
 
 #include "access/heapam.h"
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/sysattr.h"
 #include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xact.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_publication.h"
+#include "commands/explain_progress.h"
 #include "commands/matview.h"
 #include "commands/trigger.h"
 #include "executor/execdebug.h"
@@ -75,6 +77,9 @@ ExecutorEnd_hook_type ExecutorEnd_hook = NULL;
 /* Hook for plugin to get control in ExecCheckRTPerms() */
 ExecutorCheckPerms_hook_type ExecutorCheckPerms_hook = NULL;
 
+/* The outermost query being run by ExecutorRun(), if any */
+QueryDesc  *ActiveQueryDesc = NULL;
+
 /* decls for local routines only used within this module */
 static void InitPlan(QueryDesc *queryDesc, int eflags);
 static void CheckValidRowMarkRel(Relation rel, RowMarkType markType);
@@ -251,6 +256,8 @@ standard_ExecutorStart(QueryDesc *queryDesc, int eflags)
 	estate->es_crosscheck_snapshot = RegisterSnapshot(queryDesc->crosscheck_snapshot);
 	estate->es_top_eflags = eflags;
 	estate->es_instrument = queryDesc->instrument_options;
+	if (track_plan_progress)
+		estate->es_instrument |= INSTRUMENT_ROWS;
 	estate->es_jit_flags = queryDesc->plannedstmt->jitFlags;
 
 	/*
@@ -302,10 +309,34 @@ ExecutorRun(QueryDesc *queryDesc,
 			ScanDirection direction, uint64 count,
 			bool execute_once)
 {
-	if (ExecutorRun_hook)
-		(*ExecutorRun_hook) (queryDesc, direction, count, execute_once);
-	else
-		standard_ExecutorRun(queryDesc, direction, count, execute_once);
+	/* Nested queries just run */
+	if (ActiveQueryDesc != NULL)
+	{
+		if (ExecutorRun_hook)
+			(*ExecutorRun_hook) (queryDesc, direction, count, execute_once);
+		else
+			standard_ExecutorRun(queryDesc, direction, count, execute_once);
+		return;
+	}
+
+	/*
+	 * Advertise the outermost query, so that its plan can be inspected while
+	 * it runs; see explain_progress.c.
+	 */
+	ActiveQueryDesc = queryDesc;
+	PG_TRY();
+	{
+		if (ExecutorRun_hook)
+			(*ExecutorRun_hook) (queryDesc, direction, count, execute_once);
+		else
+			standard_ExecutorRun(queryDesc, direction, count, execute_once);
+	}
+	PG_FINALLY();
+	{
+		ActiveQueryDesc = NULL;
+		AtEndOfActiveQuery(queryDesc);
+	}
+	PG_END_TRY();
 }
 
 void
@@ -790,7 +821,12 @@ ExecCheckXactReadOnly(PlannedStmt *plannedstmt)
 		PreventCommandIfReadOnly(CreateCommandName((Node *) plannedstmt));
 	}
 
-	if (plannedstmt->commandType != CMD_SELECT || plannedstmt->hasModifyingCTE)
+	/*
+	 * A parallel worker may run the ModifyTable of a parallel INSERT, which
+	 * the leader has vetted already.
+	 */
+	if ((plannedstmt->commandType != CMD_SELECT || plannedstmt->hasModifyingCTE) &&
+		!IsParallelWorker())
 		PreventCommandIfParallelMode(CreateCommandName((Node *) plannedstmt));
 }
 
@@ -1316,6 +1352,11 @@ InitResultRelInfo(ResultRelInfo *resultRelInfo,
 	/* The following fields are set later if needed */
 	resultRelInfo->ri_FdwState = NULL;
 	resultRelInfo->ri_usesFdwDirectModify = false;
+	resultRelInfo->ri_NumSlots = 0;
+	resultRelInfo->ri_NumSlotsInitialized = 0;
+	resultRelInfo->ri_BatchSize = 0;
+	resultRelInfo->ri_Slots = NULL;
+	resultRelInfo->ri_PlanSlots = NULL;
 	resultRelInfo->ri_ConstraintExprs = NULL;
 	resultRelInfo->ri_GeneratedExprs = NULL;
 	resultRelInfo->ri_junkFilter = NULL;
@@ -1630,7 +1671,15 @@ ExecutePlan(EState *estate,
 
 	estate->es_use_parallel_mode = use_parallel_mode;
 	if (use_parallel_mode)
+	{
+		/*
+		 * Nobody can assign a transaction ID in parallel mode, so an INSERT
+		 * needs one before it starts, for the rows the workers write too.
+		 */
+		if (operation == CMD_INSERT)
+			(void) GetCurrentTransactionId();
 		EnterParallelMode();
+	}
 
 	/*
 	 * Loop until we've processed the proper number of tuples from the plan.
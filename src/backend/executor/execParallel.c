@@ -23,6 +23,7 @@
 
 #include "postgres.h"
 
+#include "catalog/pg_class.h"
 #include "executor/execParallel.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
@@ -35,6 +36,9 @@
 #include "executor/nodeIncrementalSort.h"
 #include "executor/nodeIndexonlyscan.h"
 #include "executor/nodeIndexscan.h"
+#include "executor/nodeMaterial.h"
+#include "executor/nodeRepartition.h"
+#include "executor/nodeResultCache.h"
 #include "executor/nodeSeqscan.h"
 #include "executor/nodeSort.h"
 #include "executor/nodeSubplan.h"
@@ -42,6 +46,7 @@
 #include "jit/jit.h"
 #include "nodes/nodeFuncs.h"
 #include "pgstat.h"
+#include "storage/bufmgr.h"
 #include "storage/spin.h"
 #include "tcop/tcopprot.h"
 #include "utils/datum.h"
@@ -77,6 +82,8 @@ typedef struct FixedParallelExecutorState
 	dsa_pointer param_exec;
 	int			eflags;
 	int			jit_flags;
+	bool		local_buffers_shared;	/* may read leader's temp relations? */
+	pg_atomic_uint64 processed; /* rows inserted by workers, if an INSERT */
 } FixedParallelExecutorState;
 
 /*
@@ -125,6 +132,7 @@ typedef struct ExecParallelInitializeDSMContext
 
 /* Helper functions that run in the parallel leader. */
 static char *ExecSerializePlan(Plan *plan, EState *estate);
+static bool ExecParallelReadsTempRelations(EState *estate);
 static bool ExecParallelEstimate(PlanState *node,
 								 ExecParallelEstimateContext *e);
 static bool ExecParallelInitializeDSM(PlanState *node,
@@ -185,6 +193,17 @@ ExecSerializePlan(Plan *plan, EState *estate)
 	pstmt->rtable = estate->es_range_table;
 	pstmt->resultRelations = NIL;
 	pstmt->rootResultRelations = NIL;
+
+	/*
+	 * If the workers are to run the ModifyTable of a parallel INSERT, they
+	 * need to open its result relation.
+	 */
+	if (IsA(plan, ModifyTable))
+	{
+		pstmt->commandType = ((ModifyTable *) plan)->operation;
+		pstmt->resultRelations = estate->es_plannedstmt->resultRelations;
+	}
+
 	pstmt->appendRelations = NIL;
 
 	/*
@@ -217,6 +236,30 @@ ExecSerializePlan(Plan *plan, EState *estate)
 	return nodeToString(pstmt);
 }
 
+/*
+ * Does the query involve any of our temporary relations?
+ *
+ * The planner only allows workers to scan them if enable_parallel_temp_scan
+ * is on, but we don't know which relations the workers' part of the plan
+ * uses, so just look at the whole range table.
+ */
+static bool
+ExecParallelReadsTempRelations(EState *estate)
+{
+	ListCell   *lc;
+
+	foreach(lc, estate->es_range_table)
+	{
+		RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc);
+
+		if (rte->rtekind == RTE_RELATION &&
+			get_rel_persistence(rte->relid) == RELPERSISTENCE_TEMP)
+			return true;
+	}
+
+	return false;
+}
+
 /*
  * Parallel-aware plan nodes (and occasionally others) may need some state
  * which is shared across all parallel workers.  Before we size the DSM, give
@@ -277,6 +320,16 @@ ExecParallelEstimate(PlanState *planstate, ExecParallelEstimateContext *e)
 				ExecHashJoinEstimate((HashJoinState *) planstate,
 									 e->pcxt);
 			break;
+		case T_RepartitionState:
+			if (planstate->plan->parallel_aware)
+				ExecRepartitionEstimate((RepartitionState *) planstate,
+										e->pcxt);
+			break;
+		case T_MaterialState:
+			if (planstate->plan->parallel_aware)
+				ExecMaterialEstimate((MaterialState *) planstate,
+									 e->pcxt);
+			break;
 		case T_HashState:
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecHashEstimate((HashState *) planstate, e->pcxt);
@@ -293,6 +346,10 @@ ExecParallelEstimate(PlanState *planstate, ExecParallelEstimateContext *e)
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecAggEstimate((AggState *) planstate, e->pcxt);
 			break;
+		case T_ResultCacheState:
+			/* even when not parallel-aware, for EXPLAIN ANALYZE */
+			ExecResultCacheEstimate((ResultCacheState *) planstate, e->pcxt);
+			break;
 		default:
 			break;
 	}
@@ -497,6 +554,16 @@ ExecParallelInitializeDSM(PlanState *planstate,
 				ExecHashJoinInitializeDSM((HashJoinState *) planstate,
 										  d->pcxt);
 			break;
+		case T_RepartitionState:
+			if (planstate->plan->parallel_aware)
+				ExecRepartitionInitializeDSM((RepartitionState *) planstate,
+											 d->pcxt);
+			break;
+		case T_MaterialState:
+			if (planstate->plan->parallel_aware)
+				ExecMaterialInitializeDSM((MaterialState *) planstate,
+										  d->pcxt);
+			break;
 		case T_HashState:
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecHashInitializeDSM((HashState *) planstate, d->pcxt);
@@ -513,6 +580,10 @@ ExecParallelInitializeDSM(PlanState *planstate,
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecAggInitializeDSM((AggState *) planstate, d->pcxt);
 			break;
+		case T_ResultCacheState:
+			/* even when not parallel-aware, for EXPLAIN ANALYZE */
+			ExecResultCacheInitializeDSM((ResultCacheState *) planstate, d->pcxt);
+			break;
 		default:
 			break;
 	}
@@ -623,6 +694,16 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate,
 	/* Fix up and serialize plan to be sent to workers. */
 	pstmt_data = ExecSerializePlan(planstate->plan, estate);
 
+	/*
+	 * If the query scans any of our temporary tables, the workers read their
+	 * pages from disk, so write out our local buffers first.
+	 */
+	if (ExecParallelReadsTempRelations(estate))
+	{
+		ShareLocalBuffers();
+		pei->local_buffers_shared = true;
+	}
+
 	/* Create a parallel context. */
 	pcxt = CreateParallelContext("postgres", "ParallelQueryMain", nworkers);
 	pei->pcxt = pcxt;
@@ -730,6 +811,8 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate,
 	fpes->param_exec = InvalidDsaPointer;
 	fpes->eflags = estate->es_top_eflags;
 	fpes->jit_flags = estate->es_jit_flags;
+	fpes->local_buffers_shared = pei->local_buffers_shared;
+	pg_atomic_init_u64(&fpes->processed, 0);
 	shm_toc_insert(pcxt->toc, PARALLEL_KEY_EXECUTOR_FIXED, fpes);
 
 	/* Store query string */
@@ -910,6 +993,7 @@ ExecParallelReinitialize(PlanState *planstate,
 	pei->finished = false;
 
 	fpes = shm_toc_lookup(pei->pcxt->toc, PARALLEL_KEY_EXECUTOR_FIXED, false);
+	pg_atomic_write_u64(&fpes->processed, 0);
 
 	/* Free any serialized parameters from the last round. */
 	if (DsaPointerIsValid(fpes->param_exec))
@@ -986,9 +1070,23 @@ ExecParallelReInitializeDSM(PlanState *planstate,
 				ExecHashJoinReInitializeDSM((HashJoinState *) planstate,
 											pcxt);
 			break;
-		case T_HashState:
+		case T_RepartitionState:
+			if (planstate->plan->parallel_aware)
+				ExecRepartitionReInitializeDSM((RepartitionState *) planstate,
+											   pcxt);
+			break;
+		case T_MaterialState:
+			if (planstate->plan->parallel_aware)
+				ExecMaterialReInitializeDSM((MaterialState *) planstate,
+											pcxt);
+			break;
 		case T_SortState:
+			if (planstate->plan->parallel_aware)
+				ExecSortReInitializeDSM((SortState *) planstate, pcxt);
+			break;
+		case T_HashState:
 		case T_IncrementalSortState:
+		case T_ResultCacheState:
 			/* these nodes have DSM state, but no reinitialization is required */
 			break;
 
@@ -1058,6 +1156,9 @@ ExecParallelRetrieveInstrumentation(PlanState *planstate,
 		case T_AggState:
 			ExecAggRetrieveInstrumentation((AggState *) planstate);
 			break;
+		case T_ResultCacheState:
+			ExecResultCacheRetrieveInstrumentation((ResultCacheState *) planstate);
+			break;
 		default:
 			break;
 	}
@@ -1112,6 +1213,7 @@ ExecParallelRetrieveJitInstrumentation(PlanState *planstate,
 void
 ExecParallelFinish(ParallelExecutorInfo *pei)
 {
+	FixedParallelExecutorState *fpes;
 	int			nworkers = pei->pcxt->nworkers_launched;
 	int			i;
 
@@ -1146,6 +1248,10 @@ ExecParallelFinish(ParallelExecutorInfo *pei)
 	/* Now wait for the workers to finish. */
 	WaitForParallelWorkersToFinish(pei->pcxt);
 
+	/* Count the rows the workers inserted, if any, as processed by us. */
+	fpes = shm_toc_lookup(pei->pcxt->toc, PARALLEL_KEY_EXECUTOR_FIXED, false);
+	pei->planstate->state->es_processed += pg_atomic_read_u64(&fpes->processed);
+
 	/*
 	 * Next, accumulate buffer/WAL usage.  (This must wait for the workers to
 	 * finish, or we might get incomplete data.)
@@ -1191,6 +1297,11 @@ ExecParallelCleanup(ParallelExecutorInfo *pei)
 		DestroyParallelContext(pei->pcxt);
 		pei->pcxt = NULL;
 	}
+	if (pei->local_buffers_shared)
+	{
+		UnshareLocalBuffers();
+		pei->local_buffers_shared = false;
+	}
 	pfree(pei);
 }
 
@@ -1333,6 +1444,16 @@ ExecParallelInitializeWorker(PlanState *planstate, ParallelWorkerContext *pwcxt)
 				ExecHashJoinInitializeWorker((HashJoinState *) planstate,
 											 pwcxt);
 			break;
+		case T_RepartitionState:
+			if (planstate->plan->parallel_aware)
+				ExecRepartitionInitializeWorker((RepartitionState *) planstate,
+												pwcxt);
+			break;
+		case T_MaterialState:
+			if (planstate->plan->parallel_aware)
+				ExecMaterialInitializeWorker((MaterialState *) planstate,
+											 pwcxt);
+			break;
 		case T_HashState:
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecHashInitializeWorker((HashState *) planstate, pwcxt);
@@ -1350,6 +1471,11 @@ ExecParallelInitializeWorker(PlanState *planstate, ParallelWorkerContext *pwcxt)
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecAggInitializeWorker((AggState *) planstate, pwcxt);
 			break;
+		case T_ResultCacheState:
+			/* even when not parallel-aware, for EXPLAIN ANALYZE */
+			ExecResultCacheInitializeWorker((ResultCacheState *) planstate,
+											pwcxt);
+			break;
 		default:
 			break;
 	}
@@ -1391,6 +1517,8 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 
 	/* Get fixed-size state. */
 	fpes = shm_toc_lookup(toc, PARALLEL_KEY_EXECUTOR_FIXED, false);
+	if (fpes->local_buffers_shared)
+		UseSharedLocalBuffers();
 
 	/* Set up DestReceiver, SharedExecutorInstrumentation, and QueryDesc. */
 	receiver = ExecParallelGetReceiver(seg, toc);
@@ -1453,6 +1581,11 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 	/* Shut down the executor */
 	ExecutorFinish(queryDesc);
 
+	/* Report the rows we inserted, for the leader's count */
+	if (queryDesc->operation == CMD_INSERT)
+		pg_atomic_add_fetch_u64(&fpes->processed,
+								queryDesc->estate->es_processed);
+
 	/* Report buffer/WAL usage during parallel execution. */
 	buffer_usage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
 	wal_usage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
@@ -127,6 +127,15 @@ struct PartitionTupleRouting
  *		routing it through this table). A NULL value is stored if no tuple
  *		conversion is required.
  *
+ * last_found_datum_index, last_found_part_index, last_found_count
+ *		The bound datum index that matched the last tuple, the partition
+ *		get_partition_for_tuple() found for it, and the number of
+ *		consecutive tuples that were routed to it.  Once that count reaches
+ *		PARTITION_CACHED_FIND_THRESHOLD, the bounds of that partition are
+ *		checked first for list and range partitioning, before falling back to
+ *		a binary search.  This makes loading data that's mostly sorted by the
+ *		partition key, like a COPY into a time-partitioned table, cheaper.
+ *
  * indexes
  *		Array of partdesc->nparts elements.  For leaf partitions the index
  *		corresponds to the partition's ResultRelInfo in the encapsulating
@@ -144,9 +153,19 @@ typedef struct PartitionDispatchData
 	PartitionDesc partdesc;
 	TupleTableSlot *tupslot;
 	AttrMap    *tupmap;
+	int			last_found_datum_index;
+	int			last_found_part_index;
+	int			last_found_count;
 	int			indexes[FLEXIBLE_ARRAY_MEMBER];
 }			PartitionDispatchData;
 
+/*
+ * Number of consecutive tuples that must be routed to the same partition
+ * before get_partition_for_tuple() starts checking that partition's bounds
+ * before doing a binary search.
+ */
+#define PARTITION_CACHED_FIND_THRESHOLD	16
+
 /* struct to hold result relations coming from UPDATE subplans */
 typedef struct SubplanResultRelHashElem
 {
@@ -941,6 +960,24 @@ ExecInitRoutingInfo(ModifyTableState *mtstate,
 		partRelInfo->ri_FdwRoutine->BeginForeignInsert != NULL)
 		partRelInfo->ri_FdwRoutine->BeginForeignInsert(mtstate, partRelInfo);
 
+	/*
+	 * Determine if the FDW supports batch insert and determine the batch size
+	 * (a FDW may support batching, but it may be disabled for the
+	 * server/table or for this particular query).
+	 *
+	 * If the FDW does not support batching, we set the batch size to 1.
+	 */
+	if (mtstate->operation == CMD_INSERT &&
+		partRelInfo->ri_FdwRoutine != NULL &&
+		partRelInfo->ri_FdwRoutine->GetForeignModifyBatchSize &&
+		partRelInfo->ri_FdwRoutine->ExecForeignBatchInsert)
+		partRelInfo->ri_BatchSize =
+			partRelInfo->ri_FdwRoutine->GetForeignModifyBatchSize(partRelInfo);
+	else
+		partRelInfo->ri_BatchSize = 1;
+
+	Assert(partRelInfo->ri_BatchSize >= 1);
+
 	partRelInfo->ri_PartitionInfo = partrouteinfo;
 	partRelInfo->ri_CopyMultiInsertBuffer = NULL;
 
@@ -1018,6 +1055,9 @@ ExecInitPartitionDispatchInfo(EState *estate,
 	pd->key = RelationGetPartitionKey(rel);
 	pd->keystate = NIL;
 	pd->partdesc = partdesc;
+	pd->last_found_datum_index = -1;
+	pd->last_found_part_index = -1;
+	pd->last_found_count = 0;
 	if (parent_pd != NULL)
 	{
 		TupleDesc	tupdesc = RelationGetDescr(rel);
@@ -1220,11 +1260,17 @@ FormPartitionKeyDatum(PartitionDispatch pd,
  *
  * Return value is index of the partition (>= 0 and < partdesc->nparts) if one
  * found or -1 if none found.
+ *
+ * For list and range partitioning, if the last PARTITION_CACHED_FIND_THRESHOLD
+ * or more tuples all went to the same partition, we check whether this one
+ * belongs there too before searching all the bounds.  Checking one or two
+ * bounds is cheap enough that it doesn't matter much if the guess is wrong,
+ * and it saves a binary search per tuple when loading sorted data.
  */
 static int
 get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 {
-	int			bound_offset;
+	int			bound_offset = -1;
 	int			part_index = -1;
 	PartitionKey key = pd->key;
 	PartitionDesc partdesc = pd->partdesc;
@@ -1245,19 +1291,40 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 													   values, isnull);
 
 				part_index = boundinfo->indexes[rowHash % greatest_modulus];
+
+				/* Nothing to cache; finding the partition is cheap anyway */
+				if (part_index < 0)
+					part_index = boundinfo->default_index;
+				return part_index;
 			}
-			break;
 
 		case PARTITION_STRATEGY_LIST:
 			if (isnull[0])
 			{
 				if (partition_bound_accepts_nulls(boundinfo))
-					part_index = boundinfo->null_index;
+					return boundinfo->null_index;
 			}
 			else
 			{
 				bool		equal = false;
 
+				if (pd->last_found_count >= PARTITION_CACHED_FIND_THRESHOLD)
+				{
+					int			last_datum_offset = pd->last_found_datum_index;
+					Datum		lastDatum = boundinfo->datums[last_datum_offset][0];
+					int32		cmpval;
+
+					/* Does the value match the last one we found? */
+					cmpval = DatumGetInt32(FunctionCall2Coll(&key->partsupfunc[0],
+															 key->partcollation[0],
+															 lastDatum,
+															 values[0]));
+					if (cmpval == 0)
+						return boundinfo->indexes[last_datum_offset];
+
+					/* No, fall through to the binary search */
+				}
+
 				bound_offset = partition_list_bsearch(key->partsupfunc,
 													  key->partcollation,
 													  boundinfo,
@@ -1288,6 +1355,40 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 
 				if (!range_partkey_has_null)
 				{
+					if (pd->last_found_count >= PARTITION_CACHED_FIND_THRESHOLD)
+					{
+						int			last_datum_offset = pd->last_found_datum_index;
+						int32		cmpval;
+
+						/* Is the value at least the last partition's lower bound? */
+						cmpval = partition_rbound_datum_cmp(key->partsupfunc,
+															key->partcollation,
+															boundinfo->datums[last_datum_offset],
+															boundinfo->kind[last_datum_offset],
+															values,
+															key->partnatts);
+
+						/* If it's equal, there's no need to check the upper bound */
+						if (cmpval == 0)
+							return boundinfo->indexes[last_datum_offset + 1];
+
+						if (cmpval < 0 &&
+							last_datum_offset + 1 < boundinfo->ndatums)
+						{
+							/* Is it below the upper bound? */
+							cmpval = partition_rbound_datum_cmp(key->partsupfunc,
+																key->partcollation,
+																boundinfo->datums[last_datum_offset + 1],
+																boundinfo->kind[last_datum_offset + 1],
+																values,
+																key->partnatts);
+							if (cmpval > 0)
+								return boundinfo->indexes[last_datum_offset + 1];
+						}
+
+						/* No, fall through to the binary search */
+					}
+
 					bound_offset = partition_range_datum_bsearch(key->partsupfunc,
 																 key->partcollation,
 																 boundinfo,
@@ -1313,10 +1414,28 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 
 	/*
 	 * part_index < 0 means we failed to find a partition of this parent. Use
-	 * the default partition, if there is one.
+	 * the default partition, if there is one.  There's no need to reset the
+	 * cached partition; the bounds are always checked before it's used.
 	 */
 	if (part_index < 0)
-		part_index = boundinfo->default_index;
+		return boundinfo->default_index;
+
+	/*
+	 * Remember the partition we found, and for how many tuples in a row.  A
+	 * list partition can be reached through any of its values, so always
+	 * remember the datum that matched this time; otherwise a run of tuples
+	 * with a different value for the same partition would keep comparing
+	 * against a stale datum.
+	 */
+	Assert(bound_offset >= 0);
+	if (part_index == pd->last_found_part_index)
+		pd->last_found_count++;
+	else
+	{
+		pd->last_found_count = 1;
+		pd->last_found_part_index = part_index;
+	}
+	pd->last_found_datum_index = bound_offset;
 
 	return part_index;
 }
@@ -1995,6 +2114,80 @@ ExecFindInitialMatchingSubPlans(PartitionPruneState *prunestate, int nsubplans)
 	return result;
 }
 
+/*
+ * ExecGetLockPrunedRelids
+ *		Perform the initial pruning steps of the plan's lock-time prunable
+ *		PartitionPruneInfos, and return the RT indexes of the leaf partitions
+ *		in plannedstmt->prunableRelids that no subplan will scan.
+ *
+ * This lets the plan cache avoid locking partitions of a generic plan that
+ * executor startup would prune anyway.  The caller must already hold locks
+ * on all of the plan's relations other than the prunable partitions, and
+ * must pass the same Params that the plan will later be executed with;
+ * since the pruning steps involved are immutable, executor startup then
+ * prunes the same partitions.
+ */
+Bitmapset *
+ExecGetLockPrunedRelids(PlannedStmt *plannedstmt, ParamListInfo params)
+{
+	Bitmapset  *scanned = NULL;
+	Bitmapset  *result;
+	EState	   *estate;
+	PlanState  *planstate;
+	MemoryContext oldcontext;
+	ListCell   *lc;
+	int			i;
+
+	estate = CreateExecutorState();
+	estate->es_param_list_info = params;
+	ExecInitRangeTable(estate, plannedstmt->rtable);
+
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	/* The pruning expressions need a parent PlanState to be initialized in */
+	planstate = makeNode(PlanState);
+	planstate->state = estate;
+	ExecAssignExprContext(estate, planstate);
+
+	foreach(lc, plannedstmt->partPruneInfos)
+	{
+		PartitionPruneInfo *pruneinfo = lfirst_node(PartitionPruneInfo, lc);
+		PartitionPruneState *prunestate;
+		Bitmapset  *validsubplans;
+
+		prunestate = ExecCreatePartitionPruneState(planstate, pruneinfo);
+		validsubplans =
+			ExecFindInitialMatchingSubPlans(prunestate,
+											list_length(pruneinfo->subplan_rtis));
+
+		i = -1;
+		while ((i = bms_next_member(validsubplans, i)) >= 0)
+		{
+			int			rti = list_nth_int(pruneinfo->subplan_rtis, i);
+
+			if (rti > 0)
+				scanned = bms_add_member(scanned, rti);
+		}
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/*
+	 * A partition may appear below more than one Append, so anything that
+	 * any of them keeps must be locked.
+	 */
+	result = bms_difference(plannedstmt->prunableRelids, scanned);
+
+	for (i = 0; i < estate->es_range_table_size; i++)
+	{
+		if (estate->es_relations[i])
+			table_close(estate->es_relations[i], NoLock);
+	}
+	FreeExecutorState(estate);
+
+	return result;
+}
+
 /*
  * ExecFindMatchingSubPlans
  *		Determine which subplans match the pruning steps detailed in
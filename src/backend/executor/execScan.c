@@ -19,6 +19,7 @@
 #include "postgres.h"
 
 #include "executor/executor.h"
+#include "jit/jit.h"
 #include "miscadmin.h"
 #include "utils/memutils.h"
 
@@ -162,12 +163,14 @@ ExecScan(ScanState *node,
 	ExprContext *econtext;
 	ExprState  *qual;
 	ProjectionInfo *projInfo;
+	ProjectionInfo *qualProjInfo;
 
 	/*
 	 * Fetch data from node
 	 */
 	qual = node->ps.qual;
 	projInfo = node->ps.ps_ProjInfo;
+	qualProjInfo = node->ss_QualProjInfo;
 	econtext = node->ps.ps_ExprContext;
 
 	/* interrupt checks are in ExecScanFetch */
@@ -176,7 +179,7 @@ ExecScan(ScanState *node,
 	 * If we have neither a qual to check nor a projection to do, just skip
 	 * all the overhead and return the raw scan tuple.
 	 */
-	if (!qual && !projInfo)
+	if (!qual && !projInfo && !qualProjInfo)
 	{
 		ResetExprContext(econtext);
 		return ExecScanFetch(node, accessMtd, recheckMtd);
@@ -208,6 +211,8 @@ ExecScan(ScanState *node,
 		{
 			if (projInfo)
 				return ExecClearTuple(projInfo->pi_state.resultslot);
+			else if (qualProjInfo)
+				return ExecClearTuple(qualProjInfo->pi_state.resultslot);
 			else
 				return slot;
 		}
@@ -217,6 +222,23 @@ ExecScan(ScanState *node,
 		 */
 		econtext->ecxt_scantuple = slot;
 
+		/*
+		 * If the qual and projection have been built as one expression, a
+		 * single evaluation tells us whether the tuple qualifies and forms
+		 * the projection tuple if so.
+		 */
+		if (qualProjInfo)
+		{
+			TupleTableSlot *result = ExecQualAndProject(qualProjInfo);
+
+			if (result)
+				return result;
+
+			InstrCountFiltered1(node, 1);
+			ResetExprContext(econtext);
+			continue;
+		}
+
 		/*
 		 * check that the current tuple satisfies the qual-clause
 		 *
@@ -255,6 +277,136 @@ ExecScan(ScanState *node,
 	}
 }
 
+/* ----------------------------------------------------------------
+ *		ExecScanBatch
+ *
+ *		Batch counterpart of ExecScan: fetches a batch of tuples with
+ *		batchAccessMtd, which fills in the given batch and returns the
+ *		number of tuples stored (fewer than the batch holds only at the end
+ *		of the scan), checks the qual over the whole batch and projects the
+ *		qualifying tuples.  Once a batch came back short we don't call
+ *		batchAccessMtd again until a rescan, since table AMs start over if
+ *		asked for more tuples after reporting the end of the scan.
+ *		If the node has set up ss_VectorQual, that is used to check the
+ *		qual instead of ps.qual.
+ *		Returns a batch with no selected tuples at the end of the scan.
+ *
+ *		Inside an EvalPlanQual recheck, or when not scanning forward, the
+ *		batch is instead filled one tuple at a time using ExecScan with
+ *		accessMtd and recheckMtd.
+ * ----------------------------------------------------------------
+ */
+TupleBatch *
+ExecScanBatch(ScanState *node,
+			  ExecScanBatchAccessMtd batchAccessMtd,
+			  ExecScanAccessMtd accessMtd,
+			  ExecScanRecheckMtd recheckMtd)
+{
+	EState	   *estate = node->ps.state;
+	ExprContext *econtext = node->ps.ps_ExprContext;
+	ExprState  *qual = node->ps.qual;
+	ProjectionInfo *projInfo = node->ps.ps_ProjInfo;
+	TupleBatch *scanbatch;
+	TupleBatch *result;
+
+	/* Create the batches on first use */
+	if (node->ss_ScanBatch == NULL)
+	{
+		node->ss_ScanBatch =
+			ExecInitTupleBatch(estate,
+							   node->ss_ScanTupleSlot->tts_tupleDescriptor,
+							   node->ss_ScanTupleSlot->tts_ops);
+		if (projInfo)
+			node->ps.ps_ResultBatch =
+				ExecInitTupleBatch(estate,
+								   node->ps.ps_ResultTupleSlot->tts_tupleDescriptor,
+								   node->ps.ps_ResultTupleSlot->tts_ops);
+	}
+
+	scanbatch = node->ss_ScanBatch;
+	result = projInfo ? node->ps.ps_ResultBatch : scanbatch;
+
+	if (estate->es_epq_active != NULL ||
+		!ScanDirectionIsForward(estate->es_direction))
+	{
+		int			n = 0;
+
+		while (n < result->maxslots && !node->ss_ScanBatchDone)
+		{
+			TupleTableSlot *slot = ExecScan(node, accessMtd, recheckMtd);
+
+			if (TupIsNull(slot))
+			{
+				node->ss_ScanBatchDone = true;
+				break;
+			}
+			ExecCopySlot(result->slots[n], slot);
+			result->selection[n] = n;
+			n++;
+		}
+
+		if (result->nvalid > n)
+			ExecClearTupleBatch(result, n);
+		result->nvalid = result->nselected = n;
+		return result;
+	}
+
+	/*
+	 * Fetch batches until we obtain one with at least one tuple passing the
+	 * qual.  All the tuples of a batch share one cycle of the per-tuple
+	 * memory context.
+	 */
+	for (;;)
+	{
+		int			ntuples = 0;
+
+		CHECK_FOR_INTERRUPTS();
+
+		ResetExprContext(econtext);
+
+		if (!node->ss_ScanBatchDone)
+		{
+			ntuples = batchAccessMtd(node, scanbatch);
+			if (ntuples < scanbatch->maxslots)
+				node->ss_ScanBatchDone = true;
+		}
+
+		if (ntuples == 0)
+		{
+			ExecClearTupleBatch(scanbatch, 0);
+			if (projInfo)
+				ExecClearTupleBatch(result, 0);
+			return result;
+		}
+
+		if (node->ss_VectorQual)
+			ExecVectorQual(node->ss_VectorQual, econtext,
+						   &econtext->ecxt_scantuple, scanbatch);
+		else if (qual)
+			ExecQualBatch(qual, econtext, &econtext->ecxt_scantuple,
+						  scanbatch);
+		else
+		{
+			int			i;
+
+			for (i = 0; i < scanbatch->nvalid; i++)
+				scanbatch->selection[i] = i;
+			scanbatch->nselected = scanbatch->nvalid;
+		}
+
+		InstrCountFiltered1(node, scanbatch->nvalid - scanbatch->nselected);
+
+		if (scanbatch->nselected > 0)
+			break;
+	}
+
+	if (projInfo)
+		ExecProjectBatch(projInfo, &econtext->ecxt_scantuple, scanbatch,
+						 result);
+
+	return result;
+}
+
 /*
  * ExecAssignScanProjectionInfo
  *		Set up projection info for a scan node, if necessary.
@@ -289,6 +441,43 @@ ExecAssignScanProjectionInfoWithVarno(ScanState *node, Index varno)
 	ExecConditionalAssignProjectionInfo(&node->ps, tupdesc, varno);
 }
 
+/*
+ * ExecAssignScanQualProjectionInfo
+ *		Set up projection info and the qual for a scan node, building them as
+ *		a single expression where that is worthwhile.
+ *
+ * When expressions are JIT compiled, having ExecScan check the qual and then
+ * do the projection means calling two separately generated functions per
+ * tuple, each fetching its own columns from the scan tuple.  With both in
+ * one expression (see ExecBuildQualProjectionInfo), the generated code
+ * filters and projects a tuple in one go, keeping the column values in
+ * registers in between.  In that case the result goes to ss_QualProjInfo and
+ * ps.qual and ps_ProjInfo are left NULL; otherwise this does the same as
+ * ExecAssignScanProjectionInfo followed by ExecInitQual.
+ *
+ * The scan slot's descriptor must have been set already.
+ */
+void
+ExecAssignScanQualProjectionInfo(ScanState *node, List *qual)
+{
+	Scan	   *scan = (Scan *) node->ps.plan;
+	TupleDesc	tupdesc = node->ss_ScanTupleSlot->tts_tupleDescriptor;
+
+	if (qual != NIL && jit_fuse_scans &&
+		(node->ps.state->es_jit_flags & PGJIT_EXPR))
+	{
+		node->ss_QualProjInfo =
+			ExecConditionalAssignQualProjectionInfo(&node->ps, tupdesc,
+													scan->scanrelid, qual);
+		if (node->ss_QualProjInfo != NULL)
+			return;
+	}
+	else
+		ExecAssignScanProjectionInfo(node);
+
+	node->ps.qual = ExecInitQual(qual, &node->ps);
+}
+
 /*
  * ExecScanReScan
  *
@@ -305,6 +494,7 @@ ExecScanReScan(ScanState *node)
 	 * can tell that this plan node is not positioned on a tuple.
 	 */
 	ExecClearTuple(node->ss_ScanTupleSlot);
+	node->ss_ScanBatchDone = false;
 
 	/* Rescan EvalPlanQual tuple if we're inside an EvalPlanQual recheck */
 	if (estate->es_epq_active != NULL)
@@ -583,6 +583,51 @@ ExecConditionalAssignProjectionInfo(PlanState *planstate, TupleDesc inputDesc,
 	}
 }
 
+/* ----------------
+ *		ExecConditionalAssignQualProjectionInfo
+ *
+ * as ExecConditionalAssignProjectionInfo, but if a projection is required,
+ * build it together with the given qual (see ExecBuildQualProjectionInfo).
+ * The result is returned rather than stored in ps_ProjInfo, which is left
+ * NULL either way; a NULL result means no projection is required, and then
+ * the caller has to set up the qual by itself.
+ * ----------------
+ */
+ProjectionInfo *
+ExecConditionalAssignQualProjectionInfo(PlanState *planstate,
+										TupleDesc inputDesc,
+										Index varno,
+										List *qual)
+{
+	planstate->ps_ProjInfo = NULL;
+
+	if (tlist_matches_tupdesc(planstate,
+							  planstate->plan->targetlist,
+							  varno,
+							  inputDesc))
+	{
+		planstate->resultopsset = planstate->scanopsset;
+		planstate->resultopsfixed = planstate->scanopsfixed;
+		planstate->resultops = planstate->scanops;
+		return NULL;
+	}
+
+	if (!planstate->ps_ResultTupleSlot)
+	{
+		ExecInitResultSlot(planstate, &TTSOpsVirtual);
+		planstate->resultops = &TTSOpsVirtual;
+		planstate->resultopsfixed = true;
+		planstate->resultopsset = true;
+	}
+
+	return ExecBuildQualProjectionInfo(qual,
+									   planstate->plan->targetlist,
+									   planstate->ps_ExprContext,
+									   planstate->ps_ResultTupleSlot,
+									   planstate,
+									   inputDesc);
+}
+
 static bool
 tlist_matches_tupdesc(PlanState *ps, List *tlist, Index varno, TupleDesc tupdesc)
 {
@@ -806,7 +851,19 @@ ExecGetRangeTableRelation(EState *estate, Index rti)
 
 		Assert(rte->rtekind == RTE_RELATION);
 
-		if (!IsParallelWorker())
+		if (!IsParallelWorker() &&
+			estate->es_plannedstmt &&
+			bms_is_member(rti, estate->es_plannedstmt->prunableRelids))
+		{
+			/*
+			 * The plan cache doesn't lock leaf partitions that it expects
+			 * initial pruning to remove, so we might not hold a lock on this
+			 * one yet.  Executor startup prunes the same partitions, so this
+			 * normally only finds locks that are already held.
+			 */
+			rel = table_open(rte->relid, rte->rellockmode);
+		}
+		else if (!IsParallelWorker())
 		{
 			/*
 			 * In a normal query, we should already have the appropriate lock,
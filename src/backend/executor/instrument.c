@@ -39,6 +39,7 @@ InstrAlloc(int n, int instrument_options)
 		bool		need_buffers = (instrument_options & INSTRUMENT_BUFFERS) != 0;
 		bool		need_wal = (instrument_options & INSTRUMENT_WAL) != 0;
 		bool		need_timer = (instrument_options & INSTRUMENT_TIMER) != 0;
+		int			sample_interval = INSTRUMENT_SAMPLE_INTERVAL(instrument_options);
 		int			i;
 
 		for (i = 0; i < n; i++)
@@ -46,6 +47,7 @@ InstrAlloc(int n, int instrument_options)
 			instr[i].need_bufusage = need_buffers;
 			instr[i].need_walusage = need_wal;
 			instr[i].need_timer = need_timer;
+			instr[i].sample_interval = sample_interval;
 		}
 	}
 
@@ -60,15 +62,35 @@ InstrInit(Instrumentation *instr, int instrument_options)
 	instr->need_bufusage = (instrument_options & INSTRUMENT_BUFFERS) != 0;
 	instr->need_walusage = (instrument_options & INSTRUMENT_WAL) != 0;
 	instr->need_timer = (instrument_options & INSTRUMENT_TIMER) != 0;
+	instr->sample_interval = INSTRUMENT_SAMPLE_INTERVAL(instrument_options);
 }
 
 /* Entry to a plan node */
 void
 InstrStartNode(Instrumentation *instr)
 {
-	if (instr->need_timer &&
-		!INSTR_TIME_SET_CURRENT_LAZY(instr->starttime))
-		elog(ERROR, "InstrStartNode called twice in a row");
+	if (instr->need_timer)
+	{
+		/*
+		 * When sampling, time the first call of each cycle, which includes
+		 * the startup, and every sample_interval'th call after that.
+		 */
+		if (instr->sample_interval > 1)
+		{
+			instr->ncalls += 1;
+			if (instr->sample_countdown > 0)
+				instr->sample_countdown--;
+			else
+			{
+				instr->sample_countdown = instr->sample_interval - 1;
+				instr->nsampled += 1;
+				if (!INSTR_TIME_SET_CURRENT_LAZY(instr->starttime))
+					elog(ERROR, "InstrStartNode called twice in a row");
+			}
+		}
+		else if (!INSTR_TIME_SET_CURRENT_LAZY(instr->starttime))
+			elog(ERROR, "InstrStartNode called twice in a row");
+	}
 
 	/* save buffer usage totals at node entry, if needed */
 	if (instr->need_bufusage)
@@ -90,13 +112,16 @@ InstrStopNode(Instrumentation *instr, double nTuples)
 	/* let's update the time only if the timer was requested */
 	if (instr->need_timer)
 	{
-		if (INSTR_TIME_IS_ZERO(instr->starttime))
-			elog(ERROR, "InstrStopNode called without start");
-
-		INSTR_TIME_SET_CURRENT(endtime);
-		INSTR_TIME_ACCUM_DIFF(instr->counter, endtime, instr->starttime);
+		if (!INSTR_TIME_IS_ZERO(instr->starttime))
+		{
+			INSTR_TIME_SET_CURRENT(endtime);
+			INSTR_TIME_ACCUM_DIFF(instr->counter, endtime, instr->starttime);
 
-		INSTR_TIME_SET_ZERO(instr->starttime);
+			INSTR_TIME_SET_ZERO(instr->starttime);
+		}
+		else if (instr->sample_interval <= 1)
+			elog(ERROR, "InstrStopNode called without start");
+		/* else this call wasn't sampled */
 	}
 
 	/* Add delta of buffer usage since entry to node's totals */
@@ -116,6 +141,14 @@ InstrStopNode(Instrumentation *instr, double nTuples)
 	}
 }
 
+/* Update tuple count */
+void
+InstrUpdateTupleCount(Instrumentation *instr, double nTuples)
+{
+	/* count the returned tuples */
+	instr->tuplecount += nTuples;
+}
+
 /* Finish a run cycle for a plan node */
 void
 InstrEndLoop(Instrumentation *instr)
@@ -132,6 +165,16 @@ InstrEndLoop(Instrumentation *instr)
 	/* Accumulate per-cycle statistics into totals */
 	totaltime = INSTR_TIME_GET_DOUBLE(instr->counter);
 
+	/*
+	 * If we timed only a sample of the calls, extrapolate from the timed
+	 * calls after the first one to all calls after the first one.  If none
+	 * was timed, we have nothing better than the first call's time.
+	 */
+	if (instr->ncalls > instr->nsampled && instr->nsampled > 1)
+		totaltime = instr->firsttuple +
+			(totaltime - instr->firsttuple) *
+			(instr->ncalls - 1) / (instr->nsampled - 1);
+
 	instr->startup += instr->firsttuple;
 	instr->total += totaltime;
 	instr->ntuples += instr->tuplecount;
@@ -143,6 +186,9 @@ InstrEndLoop(Instrumentation *instr)
 	INSTR_TIME_SET_ZERO(instr->counter);
 	instr->firsttuple = 0;
 	instr->tuplecount = 0;
+	instr->sample_countdown = 0;
+	instr->ncalls = 0;
+	instr->nsampled = 0;
 }
 
 /* aggregate instrumentation information */
@@ -160,6 +206,8 @@ InstrAggNode(Instrumentation *dst, Instrumentation *add)
 	INSTR_TIME_ADD(dst->counter, add->counter);
 
 	dst->tuplecount += add->tuplecount;
+	dst->ncalls += add->ncalls;
+	dst->nsampled += add->nsampled;
 	dst->startup += add->startup;
 	dst->total += add->total;
 	dst->ntuples += add->ntuples;
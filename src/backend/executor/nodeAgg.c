@@ -192,7 +192,12 @@
  *	  set in the largest rollup that we're going to process, and use the
  *	  per-tuple memory context of those ExprContexts to store the aggregate
  *	  transition values.  hashcontext is the single context created to support
- *	  all hash tables.
+ *	  all hash tables.  The entries of the hash tables, each of which holds a
+ *	  group's representative tuple and its AggStatePerGroupData array in a
+ *	  single chunk, are kept apart in hash_tablecxt.  They are never freed one
+ *	  by one, so that can be a bump context, which spends only a pointer's
+ *	  worth of overhead on each.  By-value transition values are stored right
+ *	  in the per-group array; only by-reference ones live in hashcontext.
  *
  *	  Spilling To Disk
  *
@@ -246,6 +251,7 @@
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "common/hashfn.h"
+#include "common/int.h"
 #include "executor/execExpr.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
@@ -261,6 +267,8 @@
 #include "utils/datum.h"
 #include "utils/dynahash.h"
 #include "utils/expandeddatum.h"
+#include "utils/float.h"
+#include "utils/fmgroids.h"
 #include "utils/logtape.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
@@ -311,6 +319,9 @@
  */
 #define CHUNKHDRSZ 16
 
+/* Chunk overhead of the bump context holding the hash table entries */
+#define ENTRY_CHUNKHDRSZ sizeof(void *)
+
 /*
  * Track all tapes needed for a HashAgg that spills. We don't know the maximum
  * number of tapes needed at the start of the algorithm (because it can
@@ -389,6 +400,11 @@ static void advance_transition_function(AggState *aggstate,
 										AggStatePerTrans pertrans,
 										AggStatePerGroup pergroupstate);
 static void advance_aggregates(AggState *aggstate);
+static void advance_aggregates_batch(AggState *aggstate);
+static void advance_transition_batch(AggStatePerTrans pertrans,
+									 AggStatePerGroup pergroupstate,
+									 TupleBatch *batch, int first);
+static bool agg_can_advance_batches(AggState *aggstate);
 static void process_ordered_aggregate_single(AggState *aggstate,
 											 AggStatePerTrans pertrans,
 											 AggStatePerGroup pergroupstate);
@@ -585,6 +601,9 @@ fetch_input_tuple(AggState *aggstate)
 			return NULL;
 		slot = aggstate->sort_slot;
 	}
+	else if (aggstate->input_batch_mode)
+		slot = ExecProcNodeFromBatch(outerPlanState(aggstate),
+									 &aggstate->input_batch);
 	else
 		slot = ExecProcNode(outerPlanState(aggstate));
 
@@ -852,6 +871,318 @@ advance_aggregates(AggState *aggstate)
 							  &dummynull);
 }
 
+/*
+ * Advance each aggregate transition state for the rest of the tuples of the
+ * current input batch, and consume them.
+ *
+ * This is only used for plain aggregation when agg_can_advance_batches()
+ * found that all the transitions are simple enough to be computed here,
+ * directly from the input columns, without going through the transition
+ * expression once per tuple.
+ */
+static void
+advance_aggregates_batch(AggState *aggstate)
+{
+	TupleBatch *batch = aggstate->input_batch;
+	AggStatePerGroup pergroup = aggstate->all_pergroups[0];
+	int			first;
+	int			transno;
+
+	Assert(aggstate->input_batch_trans);
+
+	if (batch == NULL || batch->next >= batch->nselected)
+		return;
+	first = batch->next;
+
+	if (aggstate->input_batch_natts > 0)
+	{
+		for (int i = first; i < batch->nselected; i++)
+			slot_getsomeattrs(batch->slots[batch->selection[i]],
+							  aggstate->input_batch_natts);
+	}
+
+	for (transno = 0; transno < aggstate->numtrans; transno++)
+		advance_transition_batch(&aggstate->pertrans[transno],
+								 &pergroup[transno], batch, first);
+
+	batch->next = batch->nselected;
+}
+
+/*
+ * Advance a transition state whose function is strict and whose initial
+ * value is NULL: the first non-NULL input becomes the state, NULL inputs are
+ * skipped, and a NULL state stays NULL.  That's what the transition
+ * expression does for such functions, see ExecBuildAggTrans.  "step" gives
+ * the new state from "state" and "value", like the transition function
+ * would.
+ */
+#define ADVANCE_STRICT_TRANSITION_BATCH(type, fromdatum, todatum, step) \
+	do { \
+		bool		init = pergroupstate->noTransValue; \
+		type		state = 0; \
+		\
+		if (!init) \
+		{ \
+			if (pergroupstate->transValueIsNull) \
+				break; \
+			state = fromdatum(pergroupstate->transValue); \
+		} \
+		for (int i = first; i < batch->nselected; i++) \
+		{ \
+			TupleTableSlot *slot = batch->slots[batch->selection[i]]; \
+			type		value; \
+			\
+			if (slot->tts_isnull[attno]) \
+				continue; \
+			value = fromdatum(slot->tts_values[attno]); \
+			if (init) \
+			{ \
+				state = value; \
+				init = false; \
+			} \
+			else \
+				state = (step); \
+		} \
+		if (!init) \
+		{ \
+			pergroupstate->transValue = todatum(state); \
+			pergroupstate->transValueIsNull = false; \
+			pergroupstate->noTransValue = false; \
+		} \
+	} while (0)
+
+/*
+ * Advance one transition state for batch->selection[first ..], where the
+ * input columns have been deformed already.  The transition function must be
+ * one of those accepted by agg_can_advance_batches(), and we must compute
+ * the same result, including overflow errors, as calling it once per tuple.
+ */
+static void
+advance_transition_batch(AggStatePerTrans pertrans,
+						 AggStatePerGroup pergroupstate,
+						 TupleBatch *batch, int first)
+{
+	int			attno = pertrans->batchInputAttno - 1;
+
+	switch (pertrans->transfn_oid)
+	{
+		case F_INT8INC:
+			{
+				/* count(*) */
+				int64		count = DatumGetInt64(pergroupstate->transValue);
+
+				Assert(!pergroupstate->transValueIsNull);
+				if (unlikely(pg_add_s64_overflow(count,
+												 batch->nselected - first,
+												 &count)))
+					ereport(ERROR,
+							(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+							 errmsg("bigint out of range")));
+				pergroupstate->transValue = Int64GetDatum(count);
+				break;
+			}
+		case F_INT8INC_ANY:
+			{
+				/* count(any): strict, so count the non-NULL inputs */
+				int64		count = DatumGetInt64(pergroupstate->transValue);
+				int64		n = 0;
+
+				Assert(!pergroupstate->transValueIsNull);
+				for (int i = first; i < batch->nselected; i++)
+					n += !batch->slots[batch->selection[i]]->tts_isnull[attno];
+				if (unlikely(pg_add_s64_overflow(count, n, &count)))
+					ereport(ERROR,
+							(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+							 errmsg("bigint out of range")));
+				pergroupstate->transValue = Int64GetDatum(count);
+				break;
+			}
+		case F_INT2_SUM:
+		case F_INT4_SUM:
+			{
+				/*
+				 * Not strict: a NULL state means no non-NULL input yet.  These
+				 * don't check for overflow, so adding up the batch first gives
+				 * the same result.
+				 */
+				int64		sum = 0;
+				bool		any = false;
+
+				for (int i = first; i < batch->nselected; i++)
+				{
+					TupleTableSlot *slot = batch->slots[batch->selection[i]];
+
+					if (slot->tts_isnull[attno])
+						continue;
+					if (pertrans->transfn_oid == F_INT2_SUM)
+						sum += DatumGetInt16(slot->tts_values[attno]);
+					else
+						sum += DatumGetInt32(slot->tts_values[attno]);
+					any = true;
+				}
+				if (!any)
+					break;
+				if (!pergroupstate->transValueIsNull)
+					sum += DatumGetInt64(pergroupstate->transValue);
+				pergroupstate->transValue = Int64GetDatum(sum);
+				pergroupstate->transValueIsNull = false;
+				break;
+			}
+		case F_FLOAT4PL:
+			ADVANCE_STRICT_TRANSITION_BATCH(float4, DatumGetFloat4,
+											Float4GetDatum,
+											float4_pl(state, value));
+			break;
+		case F_FLOAT8PL:
+			ADVANCE_STRICT_TRANSITION_BATCH(float8, DatumGetFloat8,
+											Float8GetDatum,
+											float8_pl(state, value));
+			break;
+		case F_INT2LARGER:
+			ADVANCE_STRICT_TRANSITION_BATCH(int16, DatumGetInt16,
+											Int16GetDatum,
+											state > value ? state : value);
+			break;
+		case F_INT2SMALLER:
+			ADVANCE_STRICT_TRANSITION_BATCH(int16, DatumGetInt16,
+											Int16GetDatum,
+											state < value ? state : value);
+			break;
+		case F_INT4LARGER:
+			ADVANCE_STRICT_TRANSITION_BATCH(int32, DatumGetInt32,
+											Int32GetDatum,
+											state > value ? state : value);
+			break;
+		case F_INT4SMALLER:
+			ADVANCE_STRICT_TRANSITION_BATCH(int32, DatumGetInt32,
+											Int32GetDatum,
+											state < value ? state : value);
+			break;
+		case F_INT8LARGER:
+			ADVANCE_STRICT_TRANSITION_BATCH(int64, DatumGetInt64,
+											Int64GetDatum,
+											state > value ? state : value);
+			break;
+		case F_INT8SMALLER:
+			ADVANCE_STRICT_TRANSITION_BATCH(int64, DatumGetInt64,
+											Int64GetDatum,
+											state < value ? state : value);
+			break;
+		case F_FLOAT4LARGER:
+			ADVANCE_STRICT_TRANSITION_BATCH(float4, DatumGetFloat4,
+											Float4GetDatum,
+											float4_gt(state, value) ? state : value);
+			break;
+		case F_FLOAT4SMALLER:
+			ADVANCE_STRICT_TRANSITION_BATCH(float4, DatumGetFloat4,
+											Float4GetDatum,
+											float4_lt(state, value) ? state : value);
+			break;
+		case F_FLOAT8LARGER:
+			ADVANCE_STRICT_TRANSITION_BATCH(float8, DatumGetFloat8,
+											Float8GetDatum,
+											float8_gt(state, value) ? state : value);
+			break;
+		case F_FLOAT8SMALLER:
+			ADVANCE_STRICT_TRANSITION_BATCH(float8, DatumGetFloat8,
+											Float8GetDatum,
+											float8_lt(state, value) ? state : value);
+			break;
+		default:
+			elog(ERROR, "unexpected batch transition function %u",
+				 pertrans->transfn_oid);
+	}
+}
+
+#undef ADVANCE_STRICT_TRANSITION_BATCH
+
+/*
+ * Can advance_aggregates_batch() be used for all the transitions of this
+ * plain aggregation?  If so, set up each pertrans->batchInputAttno and
+ * aggstate->input_batch_natts.
+ *
+ * That requires every aggregate to have a transition function known to
+ * advance_transition_batch(), a pass-by-value state, and no argument or a
+ * single plain input column as argument; and no FILTER, DISTINCT or ORDER
+ * BY.  This covers count, and sum, min and max over integer and float
+ * columns.
+ */
+static bool
+agg_can_advance_batches(AggState *aggstate)
+{
+	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
+	int			natts = 0;
+	int			transno;
+
+	if (!aggstate->input_batch_mode ||
+		node->aggstrategy != AGG_PLAIN ||
+		node->groupingSets != NIL ||
+		node->chain != NIL ||
+		DO_AGGSPLIT_COMBINE(aggstate->aggsplit) ||
+		aggstate->numtrans == 0)
+		return false;
+
+	for (transno = 0; transno < aggstate->numtrans; transno++)
+	{
+		AggStatePerTrans pertrans = &aggstate->pertrans[transno];
+		Aggref	   *aggref = pertrans->aggref;
+		AttrNumber	attno = 0;
+
+		if (aggref->aggkind != AGGKIND_NORMAL ||
+			aggref->aggfilter != NULL ||
+			pertrans->numSortCols > 0 ||
+			!pertrans->transtypeByVal)
+			return false;
+
+		switch (pertrans->transfn_oid)
+		{
+			case F_INT8INC:
+				/* count(*) is the only one without arguments */
+				if (pertrans->numTransInputs != 0)
+					return false;
+				break;
+			case F_INT8INC_ANY:
+			case F_INT2_SUM:
+			case F_INT4_SUM:
+			case F_FLOAT4PL:
+			case F_FLOAT8PL:
+			case F_INT2LARGER:
+			case F_INT2SMALLER:
+			case F_INT4LARGER:
+			case F_INT4SMALLER:
+			case F_INT8LARGER:
+			case F_INT8SMALLER:
+			case F_FLOAT4LARGER:
+			case F_FLOAT4SMALLER:
+			case F_FLOAT8LARGER:
+			case F_FLOAT8SMALLER:
+				{
+					TargetEntry *tle;
+					Var		   *var;
+
+					if (pertrans->numTransInputs != 1)
+						return false;
+					tle = linitial_node(TargetEntry, aggref->args);
+					if (!IsA(tle->expr, Var))
+						return false;
+					var = (Var *) tle->expr;
+					if (var->varno != OUTER_VAR || var->varattno <= 0)
+						return false;
+					attno = var->varattno;
+					break;
+				}
+			default:
+				return false;
+		}
+
+		pertrans->batchInputAttno = attno;
+		natts = Max(natts, attno);
+	}
+
+	aggstate->input_batch_natts = natts;
+	return true;
+}
+
 /*
  * Run the transition function for a DISTINCT or ORDER BY aggregate
  * with only one input.  This is called after we have completed
@@ -1463,9 +1794,10 @@ find_cols_walker(Node *node, FindColsContext *context)
  * We have a separate hashtable and associated perhash data structure for each
  * grouping set for which we're doing hashing.
  *
- * The contents of the hash tables always live in the hashcontext's per-tuple
- * memory context (there is only one of these for all tables together, since
- * they are all reset at the same time).
+ * The entries of the hash tables always live in hash_tablecxt, and their
+ * by-reference transition values in the hashcontext's per-tuple memory
+ * context (there is only one of each for all tables together, since they are
+ * all reset at the same time).
  */
 static void
 build_hash_tables(AggState *aggstate)
@@ -1507,7 +1839,7 @@ build_hash_table(AggState *aggstate, int setno, long nbuckets)
 {
 	AggStatePerHash perhash = &aggstate->perhash[setno];
 	MemoryContext metacxt = aggstate->hash_metacxt;
-	MemoryContext hashcxt = aggstate->hashcontext->ecxt_per_tuple_memory;
+	MemoryContext tablecxt = aggstate->hash_tablecxt;
 	MemoryContext tmpcxt = aggstate->tmpcontext->ecxt_per_tuple_memory;
 	Size		additionalsize;
 
@@ -1515,10 +1847,11 @@ build_hash_table(AggState *aggstate, int setno, long nbuckets)
 		   aggstate->aggstrategy == AGG_MIXED);
 
 	/*
-	 * Used to make sure initial hash table allocation does not exceed
-	 * hash_mem. Note that the estimate does not include space for
-	 * pass-by-reference transition data values, nor for the representative
-	 * tuple of each group.
+	 * The per-group states are allocated along with the representative tuple
+	 * of each group.  This is also used to make sure initial hash table
+	 * allocation does not exceed hash_mem, although the estimate does not
+	 * include space for pass-by-reference transition data values, nor for
+	 * the representative tuple.
 	 */
 	additionalsize = aggstate->numtrans * sizeof(AggStatePerGroupData);
 
@@ -1532,7 +1865,7 @@ build_hash_table(AggState *aggstate, int setno, long nbuckets)
 												nbuckets,
 												additionalsize,
 												metacxt,
-												hashcxt,
+												tablecxt,
 												tmpcxt,
 												DO_AGGSPLIT_SKIPFINAL(aggstate->aggsplit));
 }
@@ -1694,19 +2027,15 @@ find_hash_columns(AggState *aggstate)
 Size
 hash_agg_entry_size(int numTrans, Size tupleWidth, Size transitionSpace)
 {
-	Size		tupleChunkSize;
-	Size		pergroupChunkSize;
+	Size		entryChunkSize;
 	Size		transitionChunkSize;
 	Size		tupleSize = (MAXALIGN(SizeofMinimalTupleHeader) +
 							 tupleWidth);
 	Size		pergroupSize = numTrans * sizeof(AggStatePerGroupData);
 
-	tupleChunkSize = CHUNKHDRSZ + tupleSize;
-
-	if (pergroupSize > 0)
-		pergroupChunkSize = CHUNKHDRSZ + pergroupSize;
-	else
-		pergroupChunkSize = 0;
+	/* the tuple and the per-group states share a chunk of a bump context */
+	entryChunkSize = MAXALIGN(ENTRY_CHUNKHDRSZ + MAXALIGN(pergroupSize) +
+							  tupleSize);
 
 	if (transitionSpace > 0)
 		transitionChunkSize = CHUNKHDRSZ + transitionSpace;
@@ -1715,8 +2044,7 @@ hash_agg_entry_size(int numTrans, Size tupleWidth, Size transitionSpace)
 
 	return
 		sizeof(TupleHashEntryData) +
-		tupleChunkSize +
-		pergroupChunkSize +
+		entryChunkSize +
 		transitionChunkSize;
 }
 
@@ -1853,8 +2181,11 @@ hash_agg_check_limits(AggState *aggstate)
 	uint64		ngroups = aggstate->hash_ngroups_current;
 	Size		meta_mem = MemoryContextMemAllocated(aggstate->hash_metacxt,
 													 true);
-	Size		hashkey_mem = MemoryContextMemAllocated(aggstate->hashcontext->ecxt_per_tuple_memory,
-														true);
+	Size		hashkey_mem;
+
+	hashkey_mem = MemoryContextMemAllocated(aggstate->hash_tablecxt, true) +
+		MemoryContextMemAllocated(aggstate->hashcontext->ecxt_per_tuple_memory,
+								  true);
 
 	/*
 	 * Don't spill unless there's at least one group in the hash table so we
@@ -1924,7 +2255,8 @@ hash_agg_update_metrics(AggState *aggstate, bool from_tape, int npartitions)
 	meta_mem = MemoryContextMemAllocated(aggstate->hash_metacxt, true);
 
 	/* memory for the group keys and transition states */
-	hashkey_mem = MemoryContextMemAllocated(aggstate->hashcontext->ecxt_per_tuple_memory, true);
+	hashkey_mem = MemoryContextMemAllocated(aggstate->hash_tablecxt, true) +
+		MemoryContextMemAllocated(aggstate->hashcontext->ecxt_per_tuple_memory, true);
 
 	/* memory for read/write tape buffers, if spilled */
 	buffer_mem = npartitions * HASHAGG_WRITE_BUFFER_SIZE;
@@ -2046,11 +2378,8 @@ initialize_hash_entry(AggState *aggstate, TupleHashTable hashtable,
 	if (aggstate->numtrans == 0)
 		return;
 
-	pergroup = (AggStatePerGroup)
-		MemoryContextAlloc(hashtable->tablecxt,
-						   sizeof(AggStatePerGroupData) * aggstate->numtrans);
-
-	entry->additional = pergroup;
+	/* allocated by the hash table, next to the group's tuple */
+	pergroup = (AggStatePerGroup) entry->additional;
 
 	/*
 	 * Initialize aggregates for new tuple group, lookup_hash_entries()
@@ -2448,6 +2777,13 @@ agg_retrieve_direct(AggState *aggstate)
 					/* Reset per-input-tuple context after each tuple */
 					ResetExprContext(tmpcontext);
 
+					/*
+					 * If we can, also advance them for the rest of the
+					 * current input batch in one go.
+					 */
+					if (aggstate->input_batch_trans)
+						advance_aggregates_batch(aggstate);
+
 					outerslot = fetch_input_tuple(aggstate);
 					if (TupIsNull(outerslot))
 					{
@@ -2609,6 +2945,7 @@ agg_refill_hash_table(AggState *aggstate)
 
 	/* free memory and reset hash tables */
 	ReScanExprContext(aggstate->hashcontext);
+	MemoryContextReset(aggstate->hash_tablecxt);
 	for (int setno = 0; setno < aggstate->num_hashes; setno++)
 		ResetTupleHashTable(aggstate->perhash[setno].hashtable);
 
@@ -3362,6 +3699,8 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		eflags &= ~EXEC_FLAG_REWIND;
 	outerPlan = outerPlan(node);
 	outerPlanState(aggstate) = ExecInitNode(outerPlan, estate, eflags);
+	aggstate->input_batch_mode = ExecCanFetchBatches(outerPlanState(aggstate));
+	aggstate->input_batch = NULL;
 
 	/*
 	 * initialize source tuple type.
@@ -3628,13 +3967,12 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	 */
 	if (use_hashing)
 	{
-		Plan	   *outerplan = outerPlan(node);
-		uint64		totalGroups = 0;
-		int			i;
-
 		aggstate->hash_metacxt = AllocSetContextCreate(aggstate->ss.ps.state->es_query_cxt,
 													   "HashAgg meta context",
 													   ALLOCSET_DEFAULT_SIZES);
+		aggstate->hash_tablecxt = BumpContextCreate(aggstate->ss.ps.state->es_query_cxt,
+													"HashAgg table context",
+													ALLOCSET_DEFAULT_SIZES);
 		aggstate->hash_spill_rslot = ExecInitExtraTupleSlot(estate, scanDesc,
 															&TTSOpsMinimalTuple);
 		aggstate->hash_spill_wslot = ExecInitExtraTupleSlot(estate, scanDesc,
@@ -3642,30 +3980,6 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 
 		/* this is an array of pointers, not structures */
 		aggstate->hash_pergroup = pergroups;
-
-		aggstate->hashentrysize = hash_agg_entry_size(aggstate->numtrans,
-													  outerplan->plan_width,
-													  node->transitionSpace);
-
-		/*
-		 * Consider all of the grouping sets together when setting the limits
-		 * and estimating the number of partitions. This can be inaccurate
-		 * when there is more than one grouping set, but should still be
-		 * reasonable.
-		 */
-		for (i = 0; i < aggstate->num_hashes; i++)
-			totalGroups += aggstate->perhash[i].aggnode->numGroups;
-
-		hash_agg_set_limits(aggstate->hashentrysize, totalGroups, 0,
-							&aggstate->hash_mem_limit,
-							&aggstate->hash_ngroups_limit,
-							&aggstate->hash_planned_partitions);
-		find_hash_columns(aggstate);
-		build_hash_tables(aggstate);
-		aggstate->table_filled = false;
-
-		/* Initialize this to 1, meaning nothing spilled, yet */
-		aggstate->hash_batches_used = 1;
 	}
 
 	/*
@@ -4021,6 +4335,48 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 				(errcode(ERRCODE_GROUPING_ERROR),
 				 errmsg("aggregate function calls cannot be nested")));
 
+	/*
+	 * Now that the number of transition states is known, set up the hash
+	 * tables.  Their entries hold the per-group states, so this has to wait
+	 * until here.
+	 */
+	if (use_hashing)
+	{
+		Plan	   *outerplan = outerPlan(node);
+		uint64		totalGroups = 0;
+		int			i;
+
+		aggstate->hashentrysize = hash_agg_entry_size(aggstate->numtrans,
+													  outerplan->plan_width,
+													  node->transitionSpace);
+
+		/*
+		 * Consider all of the grouping sets together when setting the limits
+		 * and estimating the number of partitions. This can be inaccurate
+		 * when there is more than one grouping set, but should still be
+		 * reasonable.
+		 */
+		for (i = 0; i < aggstate->num_hashes; i++)
+			totalGroups += aggstate->perhash[i].aggnode->numGroups;
+
+		hash_agg_set_limits(aggstate->hashentrysize, totalGroups, 0,
+							&aggstate->hash_mem_limit,
+							&aggstate->hash_ngroups_limit,
+							&aggstate->hash_planned_partitions);
+		find_hash_columns(aggstate);
+		build_hash_tables(aggstate);
+		aggstate->table_filled = false;
+
+		/* Initialize this to 1, meaning nothing spilled, yet */
+		aggstate->hash_batches_used = 1;
+	}
+
+	/*
+	 * When we fetch the input in batches, check whether the transitions can
+	 * be advanced a whole batch at a time.
+	 */
+	aggstate->input_batch_trans = agg_can_advance_batches(aggstate);
+
 	/*
 	 * Build expressions doing all the transition work at once. We build a
 	 * different one for each phase, as the number of transition function
@@ -4591,6 +4947,11 @@ ExecEndAgg(AggState *node)
 		MemoryContextDelete(node->hash_metacxt);
 		node->hash_metacxt = NULL;
 	}
+	if (node->hash_tablecxt != NULL)
+	{
+		MemoryContextDelete(node->hash_tablecxt);
+		node->hash_tablecxt = NULL;
+	}
 
 	for (transno = 0; transno < node->numtrans; transno++)
 	{
@@ -4717,6 +5078,7 @@ ExecReScanAgg(AggState *node)
 		node->hash_ngroups_current = 0;
 
 		ReScanExprContext(node->hashcontext);
+		MemoryContextReset(node->hash_tablecxt);
 		/* Rebuild an empty hash table */
 		build_hash_tables(node);
 		node->table_filled = false;
@@ -4743,6 +5105,8 @@ ExecReScanAgg(AggState *node)
 		node->projected_set = -1;
 	}
 
+	node->input_batch = NULL;
+
 	if (outerPlan->chgParam == NULL)
 		ExecReScan(outerPlan);
 }
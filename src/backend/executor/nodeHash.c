@@ -34,6 +34,7 @@
 #include "executor/hashjoin.h"
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
+#include "lib/bloomfilter.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "port/atomics.h"
@@ -45,6 +46,7 @@
 #include "utils/syscache.h"
 
 static void ExecHashIncreaseNumBatches(HashJoinTable hashtable);
+static bool ExecHashTableIsSplittable(HashJoinTable hashtable);
 static void ExecHashIncreaseNumBuckets(HashJoinTable hashtable);
 static void ExecParallelHashIncreaseNumBatches(HashJoinTable hashtable);
 static void ExecParallelHashIncreaseNumBuckets(HashJoinTable hashtable);
@@ -55,6 +57,8 @@ static void ExecHashSkewTableInsert(HashJoinTable hashtable,
 									uint32 hashvalue,
 									int bucketNumber);
 static void ExecHashRemoveNextSkewBucket(HashJoinTable hashtable);
+static inline void ExecHashPushTuple(HashJoinTable hashtable, int bucketno,
+									 HashJoinTuple hashTuple);
 
 static void *dense_alloc(HashJoinTable hashtable, Size size);
 static HashJoinTuple ExecParallelHashTupleAlloc(HashJoinTable hashtable,
@@ -174,6 +178,11 @@ MultiExecPrivateHash(HashState *node)
 		{
 			int			bucketNumber;
 
+			if (hashtable->bloomfilter)
+				bloom_add_element(hashtable->bloomfilter,
+								  (unsigned char *) &hashvalue,
+								  sizeof(hashvalue));
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -196,7 +205,7 @@ MultiExecPrivateHash(HashState *node)
 		ExecHashIncreaseNumBuckets(hashtable);
 
 	/* Account for the buckets in spaceUsed (reported in EXPLAIN ANALYZE) */
-	hashtable->spaceUsed += hashtable->nbuckets * sizeof(HashJoinTuple);
+	hashtable->spaceUsed += hashtable->nbuckets * HJ_BUCKET_BYTES;
 	if (hashtable->spaceUsed > hashtable->spacePeak)
 		hashtable->spacePeak = hashtable->spaceUsed;
 
@@ -486,6 +495,7 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	hashtable->log2_nbuckets = log2_nbuckets;
 	hashtable->log2_nbuckets_optimal = log2_nbuckets;
 	hashtable->buckets.unshared = NULL;
+	hashtable->bucketTags = NULL;
 	hashtable->keepNulls = keepNulls;
 	hashtable->skewEnabled = false;
 	hashtable->skewBucket = NULL;
@@ -502,12 +512,22 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	hashtable->skewTuples = 0;
 	hashtable->innerBatchFile = NULL;
 	hashtable->outerBatchFile = NULL;
+	hashtable->innerFragmentFile = NULL;
+	hashtable->outerFragmentFile = NULL;
+	hashtable->curfragment = 0;
+	hashtable->fragmented = false;
+	hashtable->outerMatched = NULL;
+	hashtable->outerMatchedLen = 0;
+	hashtable->nOuterTuples = 0;
+	hashtable->outerTupleNo = -1;
 	hashtable->spaceUsed = 0;
 	hashtable->spacePeak = 0;
 	hashtable->spaceAllowed = space_allowed;
 	hashtable->spaceUsedSkew = 0;
 	hashtable->spaceAllowedSkew =
 		hashtable->spaceAllowed * SKEW_HASH_MEM_PERCENT / 100;
+	hashtable->spaceUsedBloom = 0;
+	hashtable->bloomfilter = NULL;
 	hashtable->chunks = NULL;
 	hashtable->current_chunk = NULL;
 	hashtable->parallel_state = state->parallel_state;
@@ -638,6 +658,7 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 
 		hashtable->buckets.unshared = (HashJoinTuple *)
 			palloc0(nbuckets * sizeof(HashJoinTuple));
+		hashtable->bucketTags = (uint16 *) palloc0(nbuckets * sizeof(uint16));
 
 		/*
 		 * Set up for skew optimization, if possible and there's a need for
@@ -759,7 +780,7 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 	 * Note that both nbuckets and nbatch must be powers of 2 to make
 	 * ExecHashGetBucketAndBatch fast.
 	 */
-	max_pointers = *space_allowed / sizeof(HashJoinTuple);
+	max_pointers = *space_allowed / HJ_BUCKET_BYTES;
 	max_pointers = Min(max_pointers, MaxAllocSize / sizeof(HashJoinTuple));
 	/* If max_pointers isn't a power of 2, must round it down to one */
 	mppow2 = 1L << my_log2(max_pointers);
@@ -782,7 +803,7 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 	 * If there's not enough space to store the projected number of tuples and
 	 * the required bucket headers, we will need multiple batches.
 	 */
-	bucket_bytes = sizeof(HashJoinTuple) * nbuckets;
+	bucket_bytes = HJ_BUCKET_BYTES * nbuckets;
 	if (inner_rel_bytes + bucket_bytes > hash_table_bytes)
 	{
 		/* We'll need multiple batches */
@@ -808,19 +829,19 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 
 		/*
 		 * Estimate the number of buckets we'll want to have when hash_mem is
-		 * entirely full.  Each bucket will contain a bucket pointer plus
-		 * NTUP_PER_BUCKET tuples, whose projected size already includes
+		 * entirely full.  Each bucket will contain a bucket pointer and tag
+		 * plus NTUP_PER_BUCKET tuples, whose projected size already includes
 		 * overhead for the hash code, pointer to the next tuple, etc.
 		 */
-		bucket_size = (tupsize * NTUP_PER_BUCKET + sizeof(HashJoinTuple));
+		bucket_size = (tupsize * NTUP_PER_BUCKET + HJ_BUCKET_BYTES);
 		lbuckets = 1L << my_log2(hash_table_bytes / bucket_size);
 		lbuckets = Min(lbuckets, max_pointers);
 		nbuckets = (int) lbuckets;
 		nbuckets = 1 << my_log2(nbuckets);
-		bucket_bytes = nbuckets * sizeof(HashJoinTuple);
+		bucket_bytes = nbuckets * HJ_BUCKET_BYTES;
 
 		/*
-		 * Buckets are simple pointers to hashjoin tuples, while tupsize
+		 * Buckets are simple pointers to hashjoin tuples plus tags, while tupsize
 		 * includes the pointer, hash code, and MinimalTupleData.  So buckets
 		 * should never really exceed 25% of hash_mem (even for
 		 * NTUP_PER_BUCKET=1); except maybe for hash_mem values that are not
@@ -844,6 +865,40 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 }
 
 
+/* ----------------------------------------------------------------
+ *		ExecHashTableCreateBloomFilter
+ *
+ *		Have the hash table also collect the hash values of the inner
+ *		tuples in a bloom filter, sized for the given number of tuples.
+ *		Must be called before the hash table is filled.
+ *
+ * The filter's memory comes out of the join's budget like the buckets', so
+ * it gets only a small share of that.
+ * ----------------------------------------------------------------
+ */
+void
+ExecHashTableCreateBloomFilter(HashJoinTable hashtable, double ntuples)
+{
+	MemoryContext oldcxt;
+	int			bloom_mem;
+
+	Assert(hashtable->parallel_state == NULL);
+	Assert(hashtable->totalTuples == 0);
+
+	bloom_mem = hashtable->spaceAllowed * BLOOM_HASH_MEM_PERCENT / 100 / 1024;
+
+	oldcxt = MemoryContextSwitchTo(hashtable->hashCxt);
+	hashtable->bloomfilter = bloom_create_ext((int64) Max(ntuples, 1.0),
+											  Max(bloom_mem, 1),
+											  BLOOM_MIN_SIZE_KB, 0);
+	MemoryContextSwitchTo(oldcxt);
+
+	hashtable->spaceUsedBloom = bloom_size(hashtable->bloomfilter);
+	hashtable->spaceUsed += hashtable->spaceUsedBloom;
+	if (hashtable->spaceUsed > hashtable->spacePeak)
+		hashtable->spacePeak = hashtable->spaceUsed;
+}
+
 /* ----------------------------------------------------------------
  *		ExecHashTableDestroy
  *
@@ -870,6 +925,10 @@ ExecHashTableDestroy(HashJoinTable hashtable)
 				BufFileClose(hashtable->outerBatchFile[i]);
 		}
 	}
+	if (hashtable->innerFragmentFile)
+		BufFileClose(hashtable->innerFragmentFile);
+	if (hashtable->outerFragmentFile)
+		BufFileClose(hashtable->outerFragmentFile);
 
 	/* Release working memory (batchCxt is a child, so it goes away too) */
 	MemoryContextDelete(hashtable->hashCxt);
@@ -898,9 +957,22 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 	if (!hashtable->growEnabled)
 		return;
 
-	/* safety check to avoid overflow */
-	if (oldnbatch > Min(INT_MAX / 2, MaxAllocSize / (sizeof(void *) * 2)))
+	/*
+	 * If all the tuples in memory have the same hash value, no number of
+	 * batches can divide them, so don't bother trying; the rest of the batch
+	 * will be processed in fragments instead (see ExecHashTableInsert).
+	 * Likewise if nbatch can't grow any more without overflowing.
+	 */
+	if (oldnbatch > Min(INT_MAX / 2, MaxAllocSize / (sizeof(void *) * 2)) ||
+		!ExecHashTableIsSplittable(hashtable))
+	{
+		hashtable->growEnabled = false;
+#ifdef HJDEBUG
+		printf("Hashjoin %p: disabling further increase of nbatch\n",
+			   hashtable);
+#endif
 		return;
+	}
 
 	nbatch = oldnbatch * 2;
 	Assert(nbatch > 1);
@@ -957,6 +1029,9 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 		hashtable->buckets.unshared =
 			repalloc(hashtable->buckets.unshared,
 					 sizeof(HashJoinTuple) * hashtable->nbuckets);
+		hashtable->bucketTags =
+			repalloc(hashtable->bucketTags,
+					 sizeof(uint16) * hashtable->nbuckets);
 	}
 
 	/*
@@ -966,6 +1041,7 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 	 */
 	memset(hashtable->buckets.unshared, 0,
 		   sizeof(HashJoinTuple) * hashtable->nbuckets);
+	memset(hashtable->bucketTags, 0, sizeof(uint16) * hashtable->nbuckets);
 	oldchunks = hashtable->chunks;
 	hashtable->chunks = NULL;
 
@@ -999,8 +1075,7 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 				memcpy(copyTuple, hashTuple, hashTupleSize);
 
 				/* and add it back to the appropriate bucket */
-				copyTuple->next.unshared = hashtable->buckets.unshared[bucketno];
-				hashtable->buckets.unshared[bucketno] = copyTuple;
+				ExecHashPushTuple(hashtable, bucketno, copyTuple);
 			}
 			else
 			{
@@ -1033,11 +1108,10 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 
 	/*
 	 * If we dumped out either all or none of the tuples in the table, disable
-	 * further expansion of nbatch.  This situation implies that we have
-	 * enough tuples of identical hashvalues to overflow spaceAllowed.
-	 * Increasing nbatch will not fix it since there's no way to subdivide the
-	 * group any more finely. We have to just gut it out and hope the server
-	 * has enough RAM.
+	 * further expansion of nbatch for this batch.  The hash values differ,
+	 * but perhaps only in bits that more batches would take a long time to
+	 * reach, so rather than repartitioning over and over, we process the
+	 * rest of the batch in fragments.  The next batch gets to try again.
 	 */
 	if (nfreed == 0 || nfreed == ninmemory)
 	{
@@ -1049,6 +1123,43 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 	}
 }
 
+/*
+ * ExecHashTableIsSplittable
+ *		check whether the tuples in the hash table have different hash
+ *		values, so that increasing nbatch might divide them
+ */
+static bool
+ExecHashTableIsSplittable(HashJoinTable hashtable)
+{
+	HashMemoryChunk chunk;
+	bool		first = true;
+	uint32		hashvalue = 0;
+
+	for (chunk = hashtable->chunks; chunk != NULL; chunk = chunk->next.unshared)
+	{
+		size_t		idx = 0;
+
+		while (idx < chunk->used)
+		{
+			HashJoinTuple hashTuple = (HashJoinTuple) (HASH_CHUNK_DATA(chunk) + idx);
+			MinimalTuple tuple = HJTUPLE_MINTUPLE(hashTuple);
+
+			if (first)
+			{
+				hashvalue = hashTuple->hashvalue;
+				first = false;
+			}
+			else if (hashTuple->hashvalue != hashvalue)
+				return true;
+
+			idx += MAXALIGN(HJTUPLE_OVERHEAD + tuple->t_len);
+		}
+	}
+
+	/* an empty table is no reason to stop growing */
+	return first;
+}
+
 /*
  * ExecParallelHashIncreaseNumBatches
  *		Every participant attached to grow_batches_barrier must run this
@@ -1460,9 +1571,13 @@ ExecHashIncreaseNumBuckets(HashJoinTable hashtable)
 	hashtable->buckets.unshared =
 		(HashJoinTuple *) repalloc(hashtable->buckets.unshared,
 								   hashtable->nbuckets * sizeof(HashJoinTuple));
+	hashtable->bucketTags =
+		(uint16 *) repalloc(hashtable->bucketTags,
+							hashtable->nbuckets * sizeof(uint16));
 
 	memset(hashtable->buckets.unshared, 0,
 		   hashtable->nbuckets * sizeof(HashJoinTuple));
+	memset(hashtable->bucketTags, 0, hashtable->nbuckets * sizeof(uint16));
 
 	/* scan through all tuples in all chunks to rebuild the hash table */
 	for (chunk = hashtable->chunks; chunk != NULL; chunk = chunk->next.unshared)
@@ -1480,8 +1595,7 @@ ExecHashIncreaseNumBuckets(HashJoinTable hashtable)
 									  &bucketno, &batchno);
 
 			/* add the tuple to the proper bucket */
-			hashTuple->next.unshared = hashtable->buckets.unshared[bucketno];
-			hashtable->buckets.unshared[bucketno] = hashTuple;
+			ExecHashPushTuple(hashtable, bucketno, hashTuple);
 
 			/* advance index past the tuple */
 			idx += MAXALIGN(HJTUPLE_OVERHEAD +
@@ -1581,6 +1695,19 @@ ExecParallelHashIncreaseNumBuckets(HashJoinTable hashtable)
 	}
 }
 
+/*
+ * Insert a tuple at the front of a bucket of the private hash table, and
+ * add its bit to the bucket's tag.
+ */
+static inline void
+ExecHashPushTuple(HashJoinTable hashtable, int bucketno,
+				  HashJoinTuple hashTuple)
+{
+	hashTuple->next.unshared = hashtable->buckets.unshared[bucketno];
+	hashtable->buckets.unshared[bucketno] = hashTuple;
+	hashtable->bucketTags[bucketno] |= HJ_BUCKET_TAG(hashTuple->hashvalue);
+}
+
 /*
  * ExecHashTableInsert
  *		insert a tuple into the hash table depending on the hash value
@@ -1608,7 +1735,19 @@ ExecHashTableInsert(HashJoinTable hashtable,
 	/*
 	 * decide whether to put the tuple in the hash table or a temp file
 	 */
-	if (batchno == hashtable->curbatch)
+	if (batchno == hashtable->curbatch && !hashtable->growEnabled &&
+		hashtable->spaceUsed > hashtable->spaceUsedBloom &&
+		hashtable->spaceUsed + HJTUPLE_OVERHEAD + tuple->t_len +
+		hashtable->nbuckets_optimal * HJ_BUCKET_BYTES > hashtable->spaceAllowed)
+	{
+		/*
+		 * The hash table is full, and the batch can't be split any further,
+		 * so leave the tuple to the batch's next fragment.
+		 */
+		ExecHashJoinSaveTuple(tuple, hashvalue, &hashtable->innerFragmentFile);
+		hashtable->fragmented = true;
+	}
+	else if (batchno == hashtable->curbatch)
 	{
 		/*
 		 * put the tuple in hash table
@@ -1633,15 +1772,14 @@ ExecHashTableInsert(HashJoinTable hashtable,
 		HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
 
 		/* Push it onto the front of the bucket's list */
-		hashTuple->next.unshared = hashtable->buckets.unshared[bucketno];
-		hashtable->buckets.unshared[bucketno] = hashTuple;
+		ExecHashPushTuple(hashtable, bucketno, hashTuple);
 
 		/*
 		 * Increase the (optimal) number of buckets if we just exceeded the
 		 * NTUP_PER_BUCKET threshold, but only when there's still a single
-		 * batch.
+		 * batch, and we're not going to process it in fragments.
 		 */
-		if (hashtable->nbatch == 1 &&
+		if (hashtable->nbatch == 1 && hashtable->growEnabled &&
 			ntuples > (hashtable->nbuckets_optimal * NTUP_PER_BUCKET))
 		{
 			/* Guard against integer overflow and alloc size overflow */
@@ -1658,7 +1796,7 @@ ExecHashTableInsert(HashJoinTable hashtable,
 		if (hashtable->spaceUsed > hashtable->spacePeak)
 			hashtable->spacePeak = hashtable->spaceUsed;
 		if (hashtable->spaceUsed +
-			hashtable->nbuckets_optimal * sizeof(HashJoinTuple)
+			hashtable->nbuckets_optimal * HJ_BUCKET_BYTES
 			> hashtable->spaceAllowed)
 			ExecHashIncreaseNumBatches(hashtable);
 	}
@@ -1951,7 +2089,14 @@ ExecScanHashBucket(HashJoinState *hjstate,
 	else if (hjstate->hj_CurSkewBucketNo != INVALID_SKEW_BUCKET_NO)
 		hashTuple = hashtable->skewBucket[hjstate->hj_CurSkewBucketNo]->tuples;
 	else
-		hashTuple = hashtable->buckets.unshared[hjstate->hj_CurBucketNo];
+	{
+		int			bucketno = hjstate->hj_CurBucketNo;
+
+		/* skip the bucket if its tag says it has no tuple to check */
+		if ((hashtable->bucketTags[bucketno] & HJ_BUCKET_TAG(hashvalue)) == 0)
+			return false;
+		hashTuple = hashtable->buckets.unshared[bucketno];
+	}
 
 	while (hashTuple != NULL)
 	{
@@ -2153,8 +2298,10 @@ ExecHashTableReset(HashJoinTable hashtable)
 	/* Reallocate and reinitialize the hash bucket headers. */
 	hashtable->buckets.unshared = (HashJoinTuple *)
 		palloc0(nbuckets * sizeof(HashJoinTuple));
+	hashtable->bucketTags = (uint16 *) palloc0(nbuckets * sizeof(uint16));
 
-	hashtable->spaceUsed = 0;
+	/* the bloom filter, if any, lives on in hashCxt */
+	hashtable->spaceUsed = hashtable->spaceUsedBloom;
 
 	MemoryContextSwitchTo(oldcxt);
 
@@ -2510,8 +2657,7 @@ ExecHashRemoveNextSkewBucket(HashJoinTable hashtable)
 			memcpy(copyTuple, hashTuple, tupleSize);
 			pfree(hashTuple);
 
-			copyTuple->next.unshared = hashtable->buckets.unshared[bucketno];
-			hashtable->buckets.unshared[bucketno] = copyTuple;
+			ExecHashPushTuple(hashtable, bucketno, copyTuple);
 
 			/* We have reduced skew space, but overall space doesn't change */
 			hashtable->spaceUsedSkew -= tupleSize;
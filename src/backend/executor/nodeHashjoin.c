@@ -112,6 +112,7 @@
 #include "executor/hashjoin.h"
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
+#include "lib/bloomfilter.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "utils/memutils.h"
@@ -133,6 +134,13 @@
 /* Returns true if doing null-fill on inner relation */
 #define HJ_FILL_INNER(hjstate)	((hjstate)->hj_NullOuterTupleSlot != NULL)
 
+/* Returns true if the current batch is processed in fragments */
+#define HJ_BATCH_FRAGMENTED(hashtable) \
+	((hashtable)->innerFragmentFile != NULL || (hashtable)->curfragment > 0)
+
+/* Fraction of bits set beyond which a bloom filter isn't worth applying */
+#define HJ_FILTER_MAX_BITS_SET	0.75
+
 static TupleTableSlot *ExecHashJoinOuterGetTuple(PlanState *outerNode,
 												 HashJoinState *hjstate,
 												 uint32 *hashvalue);
@@ -144,8 +152,36 @@ static TupleTableSlot *ExecHashJoinGetSavedTuple(HashJoinState *hjstate,
 												 uint32 *hashvalue,
 												 TupleTableSlot *tupleSlot);
 static bool ExecHashJoinNewBatch(HashJoinState *hjstate);
+static bool ExecHashJoinNewFragment(HashJoinState *hjstate);
+static void ExecHashJoinLoadInnerFile(HashJoinState *hjstate, BufFile *file);
+static void ExecHashJoinResetSkew(HashJoinTable hashtable);
+static bool ExecHashJoinTrackOuterTuple(HashJoinState *hjstate,
+										TupleTableSlot *slot,
+										uint32 hashvalue, int batchno);
 static bool ExecParallelHashJoinNewBatch(HashJoinState *hjstate);
 static void ExecParallelHashJoinPartitionOuter(HashJoinState *node);
+static void ExecHashJoinPushDownFilter(HashJoinState *hjstate);
+static TupleTableSlot *ExecHashJoinOuterGetBatchTuple(PlanState *outerNode,
+													  HashJoinState *hjstate,
+													  uint32 *hashvalue);
+static void ExecHashJoinHashOuterBatch(HashJoinState *hjstate);
+
+
+/*
+ * Fetch the next tuple from the outer plan, a batch at a time if the outer
+ * plan supports that.
+ */
+static inline TupleTableSlot *
+ExecHashJoinFetchOuter(HashJoinState *hjstate, PlanState *outerNode)
+{
+	if (hjstate->hj_OuterTupleBatchMode)
+	{
+		/* this may start a new batch, whose tuples aren't hashed yet */
+		hjstate->hj_OuterBatchHashed = false;
+		return ExecProcNodeFromBatch(outerNode, &hjstate->hj_OuterTupleBatch);
+	}
+	return ExecProcNode(outerNode);
+}
 
 
 /* ----------------------------------------------------------------
@@ -255,11 +291,20 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 					 */
 					node->hj_FirstOuterTupleSlot = NULL;
 				}
+				else if (node->hj_FilterScan != NULL)
+				{
+					/*
+					 * Fetching a tuple now would start the outer scan before
+					 * we can give it our bloom filter, so don't.
+					 */
+					node->hj_FirstOuterTupleSlot = NULL;
+				}
 				else if (HJ_FILL_OUTER(node) ||
 						 (outerNode->plan->startup_cost < hashNode->ps.plan->total_cost &&
 						  !node->hj_OuterNotEmpty))
 				{
-					node->hj_FirstOuterTupleSlot = ExecProcNode(outerNode);
+					node->hj_FirstOuterTupleSlot =
+						ExecHashJoinFetchOuter(node, outerNode);
 					if (TupIsNull(node->hj_FirstOuterTupleSlot))
 					{
 						node->hj_OuterNotEmpty = false;
@@ -282,6 +327,14 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 												HJ_FILL_INNER(node));
 				node->hj_HashTable = hashtable;
 
+				/* collect the inner hash values for the outer scan too */
+				if (node->hj_FilterScan != NULL)
+				{
+					node->hj_FilterScan->hashfilter = NULL;
+					ExecHashTableCreateBloomFilter(hashtable,
+												   hashNode->ps.plan->plan_rows);
+				}
+
 				/*
 				 * Execute the Hash node, to build the hash table.  If using
 				 * Parallel Hash, then we'll try to help hashing unless we
@@ -290,6 +343,9 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				hashNode->hashtable = hashtable;
 				(void) MultiExecProcNode((PlanState *) hashNode);
 
+				if (node->hj_FilterScan != NULL)
+					ExecHashJoinPushDownFilter(node);
+
 				/*
 				 * If the inner relation is completely empty, and we're not
 				 * doing a left outer join, we can quit without scanning the
@@ -391,13 +447,18 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 					node->hj_CurSkewBucketNo == INVALID_SKEW_BUCKET_NO)
 				{
 					bool		shouldFree;
-					MinimalTuple mintuple = ExecFetchSlotMinimalTuple(outerTupleSlot,
-																	  &shouldFree);
+					MinimalTuple mintuple;
+
+					/* The batch's first fragment already postponed it */
+					if (hashtable->curfragment > 0)
+						continue;
 
 					/*
 					 * Need to postpone this outer tuple to a later batch.
 					 * Save it in the corresponding outer-batch file.
 					 */
+					mintuple = ExecFetchSlotMinimalTuple(outerTupleSlot,
+														 &shouldFree);
 					Assert(parallel_state == NULL);
 					Assert(batchno > hashtable->curbatch);
 					ExecHashJoinSaveTuple(mintuple, hashvalue,
@@ -410,6 +471,15 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 					continue;
 				}
 
+				/*
+				 * If the batch is processed in fragments, keep track of the
+				 * outer tuple's matches across them.
+				 */
+				if (!parallel && HJ_BATCH_FRAGMENTED(hashtable) &&
+					!ExecHashJoinTrackOuterTuple(node, outerTupleSlot,
+												 hashvalue, batchno))
+					continue;
+
 				/* OK, let's scan the bucket for matches */
 				node->hj_JoinState = HJ_SCAN_BUCKET;
 
@@ -468,11 +538,18 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 					}
 					else
 					{
+						long		tupleno = hashtable->outerTupleNo;
+
 						/*
 						 * This is really only needed if HJ_FILL_INNER(node),
 						 * but we'll avoid the branch and just set it always.
 						 */
 						HeapTupleHeaderSetMatch(HJTUPLE_MINTUPLE(node->hj_CurTuple));
+
+						/* Remember the match for the batch's other fragments */
+						if (tupleno >= 0)
+							hashtable->outerMatched[tupleno / BITS_PER_BYTE] |=
+								1 << (tupleno % BITS_PER_BYTE);
 					}
 
 					/* In an antijoin, we never return a matched tuple */
@@ -504,12 +581,16 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				/*
 				 * The current outer tuple has run out of matches, so check
 				 * whether to emit a dummy outer-join tuple.  Whether we emit
-				 * one or not, the next state is NEED_NEW_OUTER.
+				 * one or not, the next state is NEED_NEW_OUTER.  If the batch
+				 * has more fragments to come, the tuple might still find a
+				 * match in one of them, so that's decided in the last one.
 				 */
 				node->hj_JoinState = HJ_NEED_NEW_OUTER;
 
 				if (!node->hj_MatchedOuter &&
-					HJ_FILL_OUTER(node))
+					HJ_FILL_OUTER(node) &&
+					(hashtable->outerTupleNo < 0 ||
+					 hashtable->innerFragmentFile == NULL))
 				{
 					/*
 					 * Generate a fake join tuple with nulls for the inner
@@ -660,6 +741,12 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 
 	outerPlanState(hjstate) = ExecInitNode(outerNode, estate, eflags);
 	outerDesc = ExecGetResultType(outerPlanState(hjstate));
+	hjstate->hj_OuterTupleBatchMode =
+		ExecCanFetchBatches(outerPlanState(hjstate));
+	hjstate->hj_OuterTupleBatch = NULL;
+	hjstate->hj_OuterBatchHashed = false;
+	hjstate->hj_OuterBatchHashValues = NULL;
+	hjstate->hj_OuterBatchHashValid = NULL;
 	innerPlanState(hjstate) = ExecInitNode((Plan *) hashNode, estate, eflags);
 	innerDesc = ExecGetResultType(innerPlanState(hjstate));
 
@@ -752,6 +839,23 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_MatchedOuter = false;
 	hjstate->hj_OuterNotEmpty = false;
 
+	/*
+	 * If the planner asked the seq scan on our outer side, possibly below a
+	 * Gather, to check its tuples against a bloom filter of our inner hash
+	 * values, remember it so that we can give it the filter.
+	 */
+	hjstate->hj_FilterScan = NULL;
+	if (!node->join.plan.parallel_aware)
+	{
+		PlanState  *outerstate = outerPlanState(hjstate);
+
+		if (IsA(outerstate, GatherState))
+			outerstate = outerPlanState(outerstate);
+		if (IsA(outerstate, SeqScanState) &&
+			((SeqScan *) outerstate->plan)->numHashFilterCols > 0)
+			hjstate->hj_FilterScan = (SeqScanState *) outerstate;
+	}
+
 	return hjstate;
 }
 
@@ -792,6 +896,26 @@ ExecEndHashJoin(HashJoinState *node)
 	ExecEndNode(innerPlanState(node));
 }
 
+/*
+ * ExecHashJoinPushDownFilter
+ *
+ *		give the bloom filter of the freshly built hash table to the outer
+ *		seq scan, so that it can skip the tuples that can't have a match
+ *
+ * If the filter turned out to be too full to reject much, say because the
+ * inner relation was much bigger than estimated, checking every outer tuple
+ * against it would just be a waste, so it's not handed on then.
+ */
+static void
+ExecHashJoinPushDownFilter(HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+
+	if (hashtable->bloomfilter != NULL &&
+		bloom_prop_bits_set(hashtable->bloomfilter) <= HJ_FILTER_MAX_BITS_SET)
+		hjstate->hj_FilterScan->hashfilter = hashtable->bloomfilter;
+}
+
 /*
  * ExecHashJoinOuterGetTuple
  *
@@ -813,7 +937,8 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	int			curbatch = hashtable->curbatch;
 	TupleTableSlot *slot;
 
-	if (curbatch == 0)			/* if it is the first pass */
+	/* if it is the first pass */
+	if (curbatch == 0 && hashtable->curfragment == 0)
 	{
 		/*
 		 * Check to see if first outer tuple was already fetched by
@@ -822,8 +947,11 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 		slot = hjstate->hj_FirstOuterTupleSlot;
 		if (!TupIsNull(slot))
 			hjstate->hj_FirstOuterTupleSlot = NULL;
+		else if (hjstate->hj_OuterTupleBatchMode)
+			return ExecHashJoinOuterGetBatchTuple(outerNode, hjstate,
+												  hashvalue);
 		else
-			slot = ExecProcNode(outerNode);
+			slot = ExecHashJoinFetchOuter(hjstate, outerNode);
 
 		while (!TupIsNull(slot))
 		{
@@ -849,12 +977,18 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 			 * That tuple couldn't match because of a NULL, so discard it and
 			 * continue with the next one.
 			 */
-			slot = ExecProcNode(outerNode);
+			slot = ExecHashJoinFetchOuter(hjstate, outerNode);
 		}
 	}
 	else if (curbatch < hashtable->nbatch)
 	{
-		BufFile    *file = hashtable->outerBatchFile[curbatch];
+		BufFile    *file;
+
+		/* batch 0's outer tuples were saved for its later fragments */
+		if (curbatch == 0)
+			file = hashtable->outerFragmentFile;
+		else
+			file = hashtable->outerBatchFile[curbatch];
 
 		/*
 		 * In outer-join cases, we could get here even though the batch file
@@ -875,6 +1009,126 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	return NULL;
 }
 
+/*
+ * ExecHashJoinOuterGetBatchTuple
+ *
+ *		ExecHashJoinOuterGetTuple's first pass when the outer plan returns
+ *		batches of tuples.
+ *
+ * The hash values of a whole batch are computed up front, which lets us
+ * prefetch the buckets they will probe: the cache misses of the batch's
+ * tuples then overlap, rather than each probe stalling in turn.
+ */
+static TupleTableSlot *
+ExecHashJoinOuterGetBatchTuple(PlanState *outerNode,
+							   HashJoinState *hjstate,
+							   uint32 *hashvalue)
+{
+	for (;;)
+	{
+		TupleBatch *batch = hjstate->hj_OuterTupleBatch;
+		int			pos;
+
+		if (batch == NULL || batch->next >= batch->nselected)
+		{
+			/* once the node reported the end of its tuples, stay there */
+			if (batch != NULL && batch->nselected == 0)
+				return NULL;
+
+			batch = hjstate->hj_OuterTupleBatch = ExecProcNodeBatch(outerNode);
+			batch->next = 0;
+			if (batch->nselected == 0)
+				return NULL;
+			hjstate->hj_OuterBatchHashed = false;
+		}
+
+		if (!hjstate->hj_OuterBatchHashed)
+			ExecHashJoinHashOuterBatch(hjstate);
+
+		pos = batch->next++;
+		if (hjstate->hj_OuterBatchHashValid[pos])
+		{
+			/* remember outer relation is not empty for possible rescan */
+			hjstate->hj_OuterNotEmpty = true;
+
+			*hashvalue = hjstate->hj_OuterBatchHashValues[pos];
+			return batch->slots[batch->selection[pos]];
+		}
+
+		/*
+		 * That tuple couldn't match because of a NULL, so discard it and
+		 * continue with the next one.
+		 */
+	}
+}
+
+/*
+ * ExecHashJoinHashOuterBatch
+ *
+ *		compute the hash values of the outer batch's tuples not consumed
+ *		yet, and prefetch the hash table entries they're going to look at
+ *
+ * We first prefetch each tuple's bucket and bucket tag, and then, once those
+ * have had time to arrive, the first tuple of each bucket worth scanning.
+ */
+static void
+ExecHashJoinHashOuterBatch(HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	TupleBatch *batch = hjstate->hj_OuterTupleBatch;
+	ExprContext *econtext = hjstate->js.ps.ps_ExprContext;
+	uint32	   *hashvalues;
+	bool	   *valid;
+	int			bucketno;
+	int			batchno;
+	int			i;
+
+	if (hjstate->hj_OuterBatchHashValues == NULL)
+	{
+		MemoryContext cxt = hjstate->js.ps.state->es_query_cxt;
+
+		hjstate->hj_OuterBatchHashValues = (uint32 *)
+			MemoryContextAlloc(cxt, batch->maxslots * sizeof(uint32));
+		hjstate->hj_OuterBatchHashValid = (bool *)
+			MemoryContextAlloc(cxt, batch->maxslots * sizeof(bool));
+	}
+	hashvalues = hjstate->hj_OuterBatchHashValues;
+	valid = hjstate->hj_OuterBatchHashValid;
+
+	for (i = batch->next; i < batch->nselected; i++)
+	{
+		econtext->ecxt_outertuple = batch->slots[batch->selection[i]];
+		valid[i] = ExecHashGetHashValue(hashtable, econtext,
+										hjstate->hj_OuterHashKeys,
+										true,	/* outer tuple */
+										HJ_FILL_OUTER(hjstate),
+										&hashvalues[i]);
+		if (valid[i])
+		{
+			ExecHashGetBucketAndBatch(hashtable, hashvalues[i],
+									  &bucketno, &batchno);
+			if (batchno == hashtable->curbatch)
+			{
+				pg_prefetch_mem(&hashtable->bucketTags[bucketno]);
+				pg_prefetch_mem(&hashtable->buckets.unshared[bucketno]);
+			}
+		}
+	}
+
+	for (i = batch->next; i < batch->nselected; i++)
+	{
+		if (!valid[i])
+			continue;
+		ExecHashGetBucketAndBatch(hashtable, hashvalues[i],
+								  &bucketno, &batchno);
+		if (batchno == hashtable->curbatch &&
+			(hashtable->bucketTags[bucketno] & HJ_BUCKET_TAG(hashvalues[i])) != 0)
+			pg_prefetch_mem(hashtable->buckets.unshared[bucketno]);
+	}
+
+	hjstate->hj_OuterBatchHashed = true;
+}
+
 /*
  * ExecHashJoinOuterGetTuple variant for the parallel case.
  */
@@ -894,7 +1148,7 @@ ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
 	 */
 	if (curbatch == 0 && hashtable->nbatch == 1)
 	{
-		slot = ExecProcNode(outerNode);
+		slot = ExecHashJoinFetchOuter(hjstate, outerNode);
 
 		while (!TupIsNull(slot))
 		{
@@ -912,7 +1166,7 @@ ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
 			 * That tuple couldn't match because of a NULL, so discard it and
 			 * continue with the next one.
 			 */
-			slot = ExecProcNode(outerNode);
+			slot = ExecHashJoinFetchOuter(hjstate, outerNode);
 		}
 	}
 	else if (curbatch < hashtable->nbatch)
@@ -950,8 +1204,14 @@ ExecHashJoinNewBatch(HashJoinState *hjstate)
 	int			nbatch;
 	int			curbatch;
 	BufFile    *innerFile;
-	TupleTableSlot *slot;
-	uint32		hashvalue;
+
+	/*
+	 * If the current batch didn't fit in memory, move on to its next
+	 * fragment, if there's any point.
+	 */
+	if (hashtable->innerFragmentFile != NULL &&
+		ExecHashJoinNewFragment(hjstate))
+		return true;
 
 	nbatch = hashtable->nbatch;
 	curbatch = hashtable->curbatch;
@@ -968,19 +1228,23 @@ ExecHashJoinNewBatch(HashJoinState *hjstate)
 	}
 	else						/* we just finished the first batch */
 	{
-		/*
-		 * Reset some of the skew optimization state variables, since we no
-		 * longer need to consider skew tuples after the first batch. The
-		 * memory context reset we are about to do will release the skew
-		 * hashtable itself.
-		 */
-		hashtable->skewEnabled = false;
-		hashtable->skewBucket = NULL;
-		hashtable->skewBucketNums = NULL;
-		hashtable->nSkewBuckets = 0;
-		hashtable->spaceUsedSkew = 0;
+		ExecHashJoinResetSkew(hashtable);
+		if (hashtable->outerFragmentFile)
+			BufFileClose(hashtable->outerFragmentFile);
+		hashtable->outerFragmentFile = NULL;
 	}
 
+	/*
+	 * Forget about the previous batch's fragments, and give the next batch a
+	 * chance of its own to be split, if it turns out not to fit in memory.
+	 */
+	hashtable->curfragment = 0;
+	hashtable->nOuterTuples = 0;
+	hashtable->outerTupleNo = -1;
+	if (hashtable->outerMatched)
+		MemSet(hashtable->outerMatched, 0, hashtable->outerMatchedLen);
+	hashtable->growEnabled = true;
+
 	/*
 	 * We can always skip over any batches that are completely empty on both
 	 * sides.  We can sometimes skip over batches that are empty on only one
@@ -1040,29 +1304,12 @@ ExecHashJoinNewBatch(HashJoinState *hjstate)
 
 	if (innerFile != NULL)
 	{
-		if (BufFileSeek(innerFile, 0, 0L, SEEK_SET))
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not rewind hash-join temporary file")));
-
-		while ((slot = ExecHashJoinGetSavedTuple(hjstate,
-												 innerFile,
-												 &hashvalue,
-												 hjstate->hj_HashTupleSlot)))
-		{
-			/*
-			 * NOTE: some tuples may be sent to future batches.  Also, it is
-			 * possible for hashtable->nbatch to be increased here!
-			 */
-			ExecHashTableInsert(hashtable, slot, hashvalue);
-		}
-
 		/*
 		 * after we build the hash table, the inner batch file is no longer
 		 * needed
 		 */
-		BufFileClose(innerFile);
 		hashtable->innerBatchFile[curbatch] = NULL;
+		ExecHashJoinLoadInnerFile(hjstate, innerFile);
 	}
 
 	/*
@@ -1079,6 +1326,191 @@ ExecHashJoinNewBatch(HashJoinState *hjstate)
 	return true;
 }
 
+/*
+ * ExecHashJoinNewFragment
+ *		switch to the next fragment of the current batch
+ *
+ * Returns true if successful, false if the remaining fragments can't produce
+ * any tuples.
+ */
+static bool
+ExecHashJoinNewFragment(HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	int			curbatch = hashtable->curbatch;
+	BufFile    *innerFile = hashtable->innerFragmentFile;
+	BufFile    *outerFile;
+
+	hashtable->innerFragmentFile = NULL;
+
+	if (curbatch == 0)
+		outerFile = hashtable->outerFragmentFile;
+	else
+		outerFile = hashtable->outerBatchFile[curbatch];
+
+	/*
+	 * Without outer tuples to probe with, only a right/full join has
+	 * anything left to do: emit the remaining inner tuples.
+	 */
+	if (outerFile == NULL && !HJ_FILL_INNER(hjstate))
+	{
+		BufFileClose(innerFile);
+		return false;
+	}
+
+	/* The skew hash table is only probed in batch 0's first fragment */
+	if (curbatch == 0 && hashtable->curfragment == 0)
+		ExecHashJoinResetSkew(hashtable);
+
+	hashtable->curfragment++;
+	hashtable->nOuterTuples = 0;
+	hashtable->outerTupleNo = -1;
+
+	/*
+	 * Reload the hash table with the next fragment; tuples that still don't
+	 * fit go to a new fragment file.
+	 */
+	ExecHashTableReset(hashtable);
+	ExecHashJoinLoadInnerFile(hjstate, innerFile);
+
+	/* Rewind the outer tuples, to read them once more */
+	if (outerFile != NULL)
+	{
+		if (BufFileSeek(outerFile, 0, 0L, SEEK_SET))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not rewind hash-join temporary file")));
+	}
+
+	return true;
+}
+
+/*
+ * ExecHashJoinLoadInnerFile
+ *		insert the tuples of an inner batch or fragment file into the hash
+ *		table, and close the file
+ */
+static void
+ExecHashJoinLoadInnerFile(HashJoinState *hjstate, BufFile *file)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	TupleTableSlot *slot;
+	uint32		hashvalue;
+
+	if (BufFileSeek(file, 0, 0L, SEEK_SET))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not rewind hash-join temporary file")));
+
+	while ((slot = ExecHashJoinGetSavedTuple(hjstate,
+											 file,
+											 &hashvalue,
+											 hjstate->hj_HashTupleSlot)))
+	{
+		/*
+		 * NOTE: some tuples may be sent to future batches or fragments.
+		 * Also, it is possible for hashtable->nbatch to be increased here!
+		 */
+		ExecHashTableInsert(hashtable, slot, hashvalue);
+	}
+
+	BufFileClose(file);
+}
+
+/*
+ * ExecHashJoinResetSkew
+ *		stop considering skew tuples, once batch 0's first pass is done
+ */
+static void
+ExecHashJoinResetSkew(HashJoinTable hashtable)
+{
+	/*
+	 * Reset some of the skew optimization state variables, since we no
+	 * longer need to consider skew tuples after the first batch. The memory
+	 * context reset we are about to do will release the skew hashtable
+	 * itself.
+	 */
+	hashtable->skewEnabled = false;
+	hashtable->skewBucket = NULL;
+	hashtable->skewBucketNums = NULL;
+	hashtable->nSkewBuckets = 0;
+	hashtable->spaceUsedSkew = 0;
+}
+
+/*
+ * ExecHashJoinTrackOuterTuple
+ *		number an outer tuple of a batch processed in fragments, so that its
+ *		matches can be tracked across them
+ *
+ * Returns false if the tuple needn't be probed again, because it already
+ * found the only match we care about in an earlier fragment.
+ */
+static bool
+ExecHashJoinTrackOuterTuple(HashJoinState *hjstate, TupleTableSlot *slot,
+							uint32 hashvalue, int batchno)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	long		tupleno;
+
+	/*
+	 * A skew tuple of another batch is only probed against batch 0's first
+	 * fragment, which holds the skew hash table, so there's nothing to track.
+	 */
+	if (batchno != hashtable->curbatch)
+	{
+		hashtable->outerTupleNo = -1;
+		return true;
+	}
+
+	/* Save batch 0's outer tuples for its later fragments */
+	if (hashtable->curbatch == 0 && hashtable->curfragment == 0)
+	{
+		bool		shouldFree;
+		MinimalTuple mintuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+
+		ExecHashJoinSaveTuple(mintuple, hashvalue,
+							  &hashtable->outerFragmentFile);
+
+		if (shouldFree)
+			heap_free_minimal_tuple(mintuple);
+	}
+
+	tupleno = hashtable->nOuterTuples++;
+	if (tupleno / BITS_PER_BYTE >= hashtable->outerMatchedLen)
+	{
+		long		newlen = Max(hashtable->outerMatchedLen * 2, 1024);
+
+		/* only the first fragment reads tuples it hasn't numbered before */
+		Assert(hashtable->curfragment == 0);
+		if (hashtable->outerMatched == NULL)
+			hashtable->outerMatched = (bits8 *)
+				MemoryContextAllocZero(hashtable->hashCxt, newlen);
+		else
+		{
+			hashtable->outerMatched = (bits8 *)
+				repalloc(hashtable->outerMatched, newlen);
+			MemSet(hashtable->outerMatched + hashtable->outerMatchedLen, 0,
+				   newlen - hashtable->outerMatchedLen);
+		}
+		hashtable->outerMatchedLen = newlen;
+	}
+	hashtable->outerTupleNo = tupleno;
+
+	if (hashtable->outerMatched[tupleno / BITS_PER_BYTE] &
+		(1 << (tupleno % BITS_PER_BYTE)))
+	{
+		/*
+		 * If only the first match matters, or any match rules the tuple out
+		 * as in an antijoin, we're done with it.
+		 */
+		if (hjstate->js.single_match || hjstate->js.jointype == JOIN_ANTI)
+			return false;
+		hjstate->hj_MatchedOuter = true;
+	}
+
+	return true;
+}
+
 /*
  * Choose a batch to work on, and attach to it.  Returns true if successful,
  * false if there are no more batches.
@@ -1223,7 +1655,7 @@ ExecHashJoinSaveTuple(MinimalTuple tuple, uint32 hashvalue,
 	if (file == NULL)
 	{
 		/* First write to this batch file, so open it. */
-		file = BufFileCreateTemp(false);
+		file = BufFileCreateCompressTemp(false);
 		*fileptr = file;
 	}
 
@@ -1300,6 +1732,7 @@ ExecReScanHashJoin(HashJoinState *node)
 	if (node->hj_HashTable != NULL)
 	{
 		if (node->hj_HashTable->nbatch == 1 &&
+			!node->hj_HashTable->fragmented &&
 			node->js.ps.righttree->chgParam == NULL)
 		{
 			/*
@@ -1346,6 +1779,10 @@ ExecReScanHashJoin(HashJoinState *node)
 			node->hj_HashTable = NULL;
 			node->hj_JoinState = HJ_BUILD_HASHTABLE;
 
+			/* the outer scan's bloom filter went away with the hash table */
+			if (node->hj_FilterScan != NULL)
+				node->hj_FilterScan->hashfilter = NULL;
+
 			/*
 			 * if chgParam of subnode is not null then plan will be re-scanned
 			 * by first ExecProcNode.
@@ -1363,6 +1800,8 @@ ExecReScanHashJoin(HashJoinState *node)
 
 	node->hj_MatchedOuter = false;
 	node->hj_FirstOuterTupleSlot = NULL;
+	node->hj_OuterTupleBatch = NULL;
+	node->hj_OuterBatchHashed = false;
 
 	/*
 	 * if chgParam of subnode is not null then plan will be re-scanned by
@@ -1402,7 +1841,7 @@ ExecParallelHashJoinPartitionOuter(HashJoinState *hjstate)
 	/* Execute outer plan, writing all tuples to shared tuplestores. */
 	for (;;)
 	{
-		slot = ExecProcNode(outerState);
+		slot = ExecHashJoinFetchOuter(hjstate, outerState);
 		if (TupIsNull(slot))
 			break;
 		econtext->ecxt_outertuple = slot;
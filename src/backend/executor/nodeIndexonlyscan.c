@@ -35,16 +35,29 @@
 #include "access/tableam.h"
 #include "access/tupdesc.h"
 #include "access/visibilitymap.h"
+#include "access/xlog.h"
+#include "catalog/pg_am.h"
 #include "executor/execdebug.h"
 #include "executor/nodeIndexonlyscan.h"
 #include "executor/nodeIndexscan.h"
 #include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/autovacuum.h"
 #include "storage/bufmgr.h"
 #include "storage/predicate.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 
 
+/*
+ * An index-only scan that has to visit the heap for at least this many
+ * tuples asks autovacuum to set visibility map bits where it visited last.
+ */
+#define IOS_SET_VISIBLE_THRESHOLD	1000
+
+static void IndexOnlyRequestSetVisible(IndexOnlyScanState *node);
+
+
 static TupleTableSlot *IndexOnlyNext(IndexOnlyScanState *node);
 static void StoreIndexTuple(TupleTableSlot *slot, IndexTuple itup,
 							TupleDesc itupdesc);
@@ -166,9 +179,13 @@ IndexOnlyNext(IndexOnlyScanState *node)
 			 * Rats, we have to visit the heap to check visibility.
 			 */
 			InstrCountTuples2(node, 1);
+			node->ioss_HeapFetches++;
+			node->ioss_LastHeapFetchBlock = ItemPointerGetBlockNumber(tid);
 			if (!index_fetch_heap(scandesc, node->ioss_TableSlot))
 				continue;		/* no visible tuple, try next index entry */
 
+			pgstat_count_ios_heap_fetch(scandesc->heapRelation);
+
 			ExecClearTuple(node->ioss_TableSlot);
 
 			/*
@@ -189,6 +206,8 @@ IndexOnlyNext(IndexOnlyScanState *node)
 
 			tuple_from_heap = true;
 		}
+		else
+			pgstat_count_ios_heap_fetch_avoided(scandesc->heapRelation);
 
 		/*
 		 * Fill the scan tuple slot with data from the index.  This might be
@@ -360,6 +379,32 @@ ExecReScanIndexOnlyScan(IndexOnlyScanState *node)
 	ExecScanReScan(&node->ss);
 }
 
+/*
+ * IndexOnlyRequestSetVisible
+ *
+ *		Ask autovacuum to set the visibility map bits of the range of heap
+ *		pages this scan last had to visit.  For tables that are mostly
+ *		inserted into, that's where the recently filled pages are, which won't
+ *		otherwise be marked all-visible until the next VACUUM.  The request
+ *		may be dropped if autovacuum already has too much to do.
+ */
+static void
+IndexOnlyRequestSetVisible(IndexOnlyScanState *node)
+{
+	Relation	heapRel = node->ss.ss_currentRelation;
+	BlockNumber blkno = node->ioss_LastHeapFetchBlock;
+
+	if (!AutoVacuumingActive() || RecoveryInProgress())
+		return;
+	if (heapRel->rd_rel->relam != HEAP_TABLE_AM_OID ||
+		heapRel->rd_rel->relpersistence == RELPERSISTENCE_TEMP)
+		return;
+
+	(void) AutoVacuumRequestWork(AVW_HeapSetVisible,
+								 RelationGetRelid(heapRel),
+								 blkno - blkno % AVW_SET_VISIBLE_PAGES);
+}
+
 
 /* ----------------------------------------------------------------
  *		ExecEndIndexOnlyScan
@@ -377,6 +422,9 @@ ExecEndIndexOnlyScan(IndexOnlyScanState *node)
 	indexRelationDesc = node->ioss_RelationDesc;
 	indexScanDesc = node->ioss_ScanDesc;
 
+	if (node->ioss_HeapFetches >= IOS_SET_VISIBLE_THRESHOLD)
+		IndexOnlyRequestSetVisible(node);
+
 	/* Release VM buffer pin, if any. */
 	if (node->ioss_VMBuffer != InvalidBuffer)
 	{
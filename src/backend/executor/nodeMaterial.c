@@ -21,9 +21,56 @@
  */
 #include "postgres.h"
 
+#include "access/parallel.h"
 #include "executor/executor.h"
 #include "executor/nodeMaterial.h"
 #include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/barrier.h"
+#include "storage/buffile.h"
+
+/*
+ * Shared state of a Parallel Materialize.
+ *
+ * Each participant that attaches while the barrier is still in the building
+ * phase writes the tuples it gets from its share of the partial subplan to a
+ * file of its own in the SharedFileSet.  Once they have all finished, every
+ * participant reads back the files of all of them, so each one sees the
+ * whole relation, as many times as it likes, while the subplan has run only
+ * once.
+ */
+typedef struct ParallelMaterialState
+{
+	Barrier		barrier;
+	pg_atomic_uint32 nfiles;	/* number of files created so far */
+	SharedFileSet fileset;
+} ParallelMaterialState;
+
+#define PARALLEL_MATERIAL_PHASE_BUILDING	0
+#define PARALLEL_MATERIAL_PHASE_DONE		1
+
+/*
+ * A participant's private state for reading the files of a Parallel
+ * Materialize.  BufFileAppend() can't glue them together for sequential
+ * reading, so we step from one file to the next ourselves.
+ */
+typedef struct ParallelMaterialReader
+{
+	int			nfiles;
+	BufFile   **files;
+	int			curfile;		/* file we're reading */
+	int			markfile;		/* file of the mark, and position in it */
+	int			markfileno;
+	off_t		markoffset;
+	MinimalTuple tuple;			/* buffer for the current tuple */
+	Size		tuplesize;		/* allocated size of the buffer */
+} ParallelMaterialReader;
+
+static ParallelMaterialReader *ExecParallelMaterial(MaterialState *node);
+static TupleTableSlot *ExecParallelMaterialNext(MaterialState *node);
+static void ExecParallelMaterialSeek(ParallelMaterialReader *reader,
+									 int filenum, int fileno, off_t offset);
+static void ExecParallelMaterialEndRead(MaterialState *node);
 
 /* ----------------------------------------------------------------
  *		ExecMaterial
@@ -48,6 +95,17 @@ ExecMaterial(PlanState *pstate)
 
 	CHECK_FOR_INTERRUPTS();
 
+	/*
+	 * A Parallel Materialize stores the tuples in cooperation with the other
+	 * participants instead; see ExecParallelMaterial.
+	 */
+	if (node->pstate != NULL)
+	{
+		if (node->preader == NULL)
+			node->preader = ExecParallelMaterial(node);
+		return ExecParallelMaterialNext(node);
+	}
+
 	/*
 	 * get state info from node
 	 */
@@ -156,6 +214,177 @@ ExecMaterial(PlanState *pstate)
 	return ExecClearTuple(slot);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecParallelMaterial
+ *
+ *		Writes this participant's share of the outer subtree's tuples to
+ *		a file of its own in the shared temporary files, and waits for the
+ *		others to do the same.  Returns the state for reading back the
+ *		files of all of them.
+ * ----------------------------------------------------------------
+ */
+static ParallelMaterialReader *
+ExecParallelMaterial(MaterialState *node)
+{
+	ParallelMaterialState *pstate = node->pstate;
+	EState	   *estate = node->ss.ps.state;
+	ParallelMaterialReader *reader;
+	char		name[MAXPGPATH];
+	int			i;
+
+	/*
+	 * If the files are already complete, we're too late to contribute, so
+	 * just read what those who came before us wrote.
+	 */
+	BarrierAttach(&pstate->barrier);
+	if (BarrierPhase(&pstate->barrier) == PARALLEL_MATERIAL_PHASE_BUILDING)
+	{
+		PlanState  *outerNode = outerPlanState(node);
+		ScanDirection dir = estate->es_direction;
+		BufFile    *file;
+		TupleTableSlot *slot;
+
+		snprintf(name, sizeof(name), "material.%u",
+				 pg_atomic_fetch_add_u32(&pstate->nfiles, 1));
+		file = BufFileCreateShared(&pstate->fileset, name);
+
+		estate->es_direction = ForwardScanDirection;
+		for (;;)
+		{
+			MinimalTuple tuple;
+			bool		shouldFree;
+
+			slot = ExecProcNode(outerNode);
+			if (TupIsNull(slot))
+				break;
+
+			/* t_len comes first, so that's all the framing we need */
+			tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+			BufFileWrite(file, tuple, tuple->t_len);
+			if (shouldFree)
+				pfree(tuple);
+		}
+		estate->es_direction = dir;
+
+		BufFileExportShared(file);
+		BufFileClose(file);
+
+		BarrierArriveAndWait(&pstate->barrier, WAIT_EVENT_PARALLEL_MATERIAL);
+	}
+	Assert(BarrierPhase(&pstate->barrier) == PARALLEL_MATERIAL_PHASE_DONE);
+	BarrierDetach(&pstate->barrier);
+
+	reader = MemoryContextAllocZero(estate->es_query_cxt,
+									sizeof(ParallelMaterialReader));
+	reader->nfiles = pg_atomic_read_u32(&pstate->nfiles);
+	reader->files = MemoryContextAlloc(estate->es_query_cxt,
+									   sizeof(BufFile *) * reader->nfiles);
+	for (i = 0; i < reader->nfiles; i++)
+	{
+		snprintf(name, sizeof(name), "material.%u", i);
+		reader->files[i] = BufFileOpenShared(&pstate->fileset, name,
+											 O_RDONLY);
+	}
+
+	return reader;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecParallelMaterialNext
+ *
+ *		Returns the next tuple from the files of a Parallel Materialize.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecParallelMaterialNext(MaterialState *node)
+{
+	ParallelMaterialReader *reader = node->preader;
+	TupleTableSlot *slot = node->ss.ps.ps_ResultTupleSlot;
+	uint32		t_len;
+	size_t		nread;
+
+	Assert(ScanDirectionIsForward(node->ss.ps.state->es_direction));
+
+	for (;;)
+	{
+		if (reader->curfile >= reader->nfiles)
+			return ExecClearTuple(slot);
+
+		nread = BufFileRead(reader->files[reader->curfile], &t_len,
+							sizeof(t_len));
+		if (nread == sizeof(t_len))
+			break;
+		if (nread != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from shared materialize temporary file"),
+					 errdetail_internal("Short read while reading tuple length.")));
+
+		/* On to the next participant's file, if any */
+		if (++reader->curfile < reader->nfiles)
+			ExecParallelMaterialSeek(reader, reader->curfile, 0, 0);
+	}
+
+	if (t_len > reader->tuplesize)
+	{
+		Size		newsize = Max(t_len, reader->tuplesize * 2);
+
+		if (reader->tuple != NULL)
+			pfree(reader->tuple);
+		reader->tuple =
+			MemoryContextAlloc(node->ss.ps.state->es_query_cxt, newsize);
+		reader->tuplesize = newsize;
+	}
+
+	reader->tuple->t_len = t_len;
+	nread = BufFileRead(reader->files[reader->curfile],
+						(char *) reader->tuple + sizeof(t_len),
+						t_len - sizeof(t_len));
+	if (nread != t_len - sizeof(t_len))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from shared materialize temporary file"),
+				 errdetail_internal("Short read while reading tuple.")));
+
+	return ExecStoreMinimalTuple(reader->tuple, slot, false);
+}
+
+/*
+ * Position the reader at the given position in one of the files.
+ */
+static void
+ExecParallelMaterialSeek(ParallelMaterialReader *reader,
+						 int filenum, int fileno, off_t offset)
+{
+	reader->curfile = filenum;
+	if (filenum < reader->nfiles &&
+		BufFileSeek(reader->files[filenum], fileno, offset, SEEK_SET) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not seek in shared materialize temporary file")));
+}
+
+/*
+ * Forget about the files of a Parallel Materialize.
+ */
+static void
+ExecParallelMaterialEndRead(MaterialState *node)
+{
+	ParallelMaterialReader *reader = node->preader;
+	int			i;
+
+	if (reader == NULL)
+		return;
+
+	for (i = 0; i < reader->nfiles; i++)
+		BufFileClose(reader->files[i]);
+	pfree(reader->files);
+	if (reader->tuple != NULL)
+		pfree(reader->tuple);
+	pfree(reader);
+	node->preader = NULL;
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitMaterial
  * ----------------------------------------------------------------
@@ -196,6 +425,11 @@ ExecInitMaterial(Material *node, EState *estate, int eflags)
 
 	matstate->eof_underlying = false;
 	matstate->tuplestorestate = NULL;
+	matstate->pstate = NULL;
+	matstate->preader = NULL;
+
+	/* A Parallel Materialize can't be read backwards */
+	Assert(!node->plan.parallel_aware || !(eflags & EXEC_FLAG_BACKWARD));
 
 	/*
 	 * Miscellaneous initialization
@@ -250,6 +484,7 @@ ExecEndMaterial(MaterialState *node)
 	if (node->tuplestorestate != NULL)
 		tuplestore_end(node->tuplestorestate);
 	node->tuplestorestate = NULL;
+	ExecParallelMaterialEndRead(node);
 
 	/*
 	 * shut down the subplan
@@ -268,6 +503,20 @@ ExecMaterialMarkPos(MaterialState *node)
 {
 	Assert(node->eflags & EXEC_FLAG_MARK);
 
+	if (node->pstate != NULL)
+	{
+		ParallelMaterialReader *reader = node->preader;
+
+		if (!reader)
+			return;
+
+		reader->markfile = reader->curfile;
+		if (reader->curfile < reader->nfiles)
+			BufFileTell(reader->files[reader->curfile],
+						&reader->markfileno, &reader->markoffset);
+		return;
+	}
+
 	/*
 	 * if we haven't materialized yet, just return.
 	 */
@@ -296,6 +545,18 @@ ExecMaterialRestrPos(MaterialState *node)
 {
 	Assert(node->eflags & EXEC_FLAG_MARK);
 
+	if (node->pstate != NULL)
+	{
+		ParallelMaterialReader *reader = node->preader;
+
+		if (!reader)
+			return;
+
+		ExecParallelMaterialSeek(reader, reader->markfile,
+								 reader->markfileno, reader->markoffset);
+		return;
+	}
+
 	/*
 	 * if we haven't materialized yet, just return.
 	 */
@@ -321,6 +582,21 @@ ExecReScanMaterial(MaterialState *node)
 
 	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
 
+	if (node->pstate != NULL)
+	{
+		/*
+		 * The files of a Parallel Materialize can be reread from the start
+		 * as often as we like.  If the subplan must be rerun, that can only
+		 * be because the Gather above is being rescanned, and then
+		 * ExecMaterialReInitializeDSM resets the shared state.
+		 */
+		if (outerPlan->chgParam != NULL)
+			ExecParallelMaterialEndRead(node);
+		else if (node->preader != NULL)
+			ExecParallelMaterialSeek(node->preader, 0, 0, 0);
+		return;
+	}
+
 	if (node->eflags != 0)
 	{
 		/*
@@ -366,3 +642,100 @@ ExecReScanMaterial(MaterialState *node)
 		node->eof_underlying = false;
 	}
 }
+
+/* ----------------------------------------------------------------
+ *						Parallel Query Support
+ * ----------------------------------------------------------------
+ */
+
+/* ----------------------------------------------------------------
+ *		ExecMaterialEstimate
+ *
+ *		Estimate space required to coordinate the participants of a
+ *		Parallel Materialize.
+ * ----------------------------------------------------------------
+ */
+void
+ExecMaterialEstimate(MaterialState *node, ParallelContext *pcxt)
+{
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelMaterialState));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecMaterialInitializeDSM
+ *
+ *		Set up the shared state of a Parallel Materialize.
+ * ----------------------------------------------------------------
+ */
+void
+ExecMaterialInitializeDSM(MaterialState *node, ParallelContext *pcxt)
+{
+	ParallelMaterialState *pstate;
+
+	/*
+	 * Without a DSM segment there can't be any workers, and the leader
+	 * alone can just as well work like a plain Materialize; that also saves
+	 * us from having to clean up the files ourselves.
+	 */
+	if (pcxt->seg == NULL)
+		return;
+
+	pstate = shm_toc_allocate(pcxt->toc, sizeof(ParallelMaterialState));
+	BarrierInit(&pstate->barrier, 0);
+	pg_atomic_init_u32(&pstate->nfiles, 0);
+	SharedFileSetInit(&pstate->fileset, pcxt->seg);
+
+	node->pstate = pstate;
+	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pstate);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecMaterialReInitializeDSM
+ *
+ *		Reset the shared state of a Parallel Materialize before a rescan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecMaterialReInitializeDSM(MaterialState *node, ParallelContext *pcxt)
+{
+	ParallelMaterialState *pstate = node->pstate;
+	uint32		nfiles;
+	uint32		i;
+
+	if (pstate == NULL)
+		return;
+
+	/* The workers are gone, and we must not keep reading the old files */
+	ExecParallelMaterialEndRead(node);
+
+	nfiles = pg_atomic_read_u32(&pstate->nfiles);
+	for (i = 0; i < nfiles; i++)
+	{
+		char		name[MAXPGPATH];
+
+		snprintf(name, sizeof(name), "material.%u", i);
+		BufFileDeleteShared(&pstate->fileset, name);
+	}
+
+	BarrierInit(&pstate->barrier, 0);
+	pg_atomic_write_u32(&pstate->nfiles, 0);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecMaterialInitializeWorker
+ *
+ *		Attach worker to the shared state of a Parallel Materialize.
+ * ----------------------------------------------------------------
+ */
+void
+ExecMaterialInitializeWorker(MaterialState *node,
+							 ParallelWorkerContext *pwcxt)
+{
+	ParallelMaterialState *pstate;
+
+	pstate = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id,
+							false);
+	SharedFileSetAttach(&pstate->fileset, pwcxt->seg);
+	node->pstate = pstate;
+}
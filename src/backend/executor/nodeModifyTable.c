@@ -39,6 +39,7 @@
 
 #include "access/heapam.h"
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/tableam.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
@@ -66,6 +67,10 @@ static bool ExecOnConflictUpdate(ModifyTableState *mtstate,
 								 EState *estate,
 								 bool canSetTag,
 								 TupleTableSlot **returning);
+static void ExecBatchInsert(ModifyTableState *mtstate,
+							ResultRelInfo *resultRelInfo,
+							EState *estate,
+							bool canSetTag);
 static TupleTableSlot *ExecPrepareTupleRouting(ModifyTableState *mtstate,
 											   EState *estate,
 											   PartitionTupleRouting *proute,
@@ -426,6 +431,60 @@ ExecInsert(ModifyTableState *mtstate,
 			resultRelationDesc->rd_att->constr->has_generated_stored)
 			ExecComputeStoredGenerated(estate, slot, CMD_INSERT);
 
+		/*
+		 * If the FDW supports batching, and batching is requested, accumulate
+		 * rows and insert them in batches.  Otherwise use the per-row
+		 * inserts.
+		 */
+		if (resultRelInfo->ri_BatchSize > 1)
+		{
+			MemoryContext oldContext;
+
+			/*
+			 * If a certain number of tuples have already been accumulated,
+			 * perform the batch insert
+			 */
+			if (resultRelInfo->ri_NumSlots == resultRelInfo->ri_BatchSize)
+				ExecBatchInsert(mtstate, resultRelInfo, estate, canSetTag);
+
+			oldContext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+			if (resultRelInfo->ri_Slots == NULL)
+			{
+				resultRelInfo->ri_Slots = palloc(sizeof(TupleTableSlot *) *
+												 resultRelInfo->ri_BatchSize);
+				resultRelInfo->ri_PlanSlots = palloc(sizeof(TupleTableSlot *) *
+													 resultRelInfo->ri_BatchSize);
+			}
+
+			/*
+			 * The slots are kept across batches, so create them only the
+			 * first time around.  They go into the executor's tuple table,
+			 * which takes care of releasing them at executor shutdown.
+			 */
+			if (resultRelInfo->ri_NumSlots >= resultRelInfo->ri_NumSlotsInitialized)
+			{
+				resultRelInfo->ri_Slots[resultRelInfo->ri_NumSlots] =
+					ExecInitExtraTupleSlot(estate, slot->tts_tupleDescriptor,
+										   slot->tts_ops);
+				resultRelInfo->ri_PlanSlots[resultRelInfo->ri_NumSlots] =
+					ExecInitExtraTupleSlot(estate, planSlot->tts_tupleDescriptor,
+										   planSlot->tts_ops);
+				resultRelInfo->ri_NumSlotsInitialized++;
+			}
+
+			ExecCopySlot(resultRelInfo->ri_Slots[resultRelInfo->ri_NumSlots],
+						 slot);
+			ExecCopySlot(resultRelInfo->ri_PlanSlots[resultRelInfo->ri_NumSlots],
+						 planSlot);
+
+			resultRelInfo->ri_NumSlots++;
+
+			MemoryContextSwitchTo(oldContext);
+
+			return NULL;
+		}
+
 		/*
 		 * insert into foreign table: let the FDW do it
 		 */
@@ -584,7 +643,7 @@ ExecInsert(ModifyTableState *mtstate,
 			/* insert index entries for tuple */
 			recheckIndexes = ExecInsertIndexTuples(slot, estate, true,
 												   &specConflict,
-												   arbiterIndexes);
+												   arbiterIndexes, false, false);
 
 			/* adjust the tuple's state accordingly */
 			table_tuple_complete_speculative(resultRelationDesc, slot,
@@ -614,15 +673,20 @@ ExecInsert(ModifyTableState *mtstate,
 		}
 		else
 		{
-			/* insert the tuple normally */
+			/*
+			 * Insert the tuple normally.  The planner only lets parallel
+			 * workers get here if the target table is safe for them to
+			 * write, see insert_target_parallel_safe().
+			 */
 			table_tuple_insert(resultRelationDesc, slot,
 							   estate->es_output_cid,
-							   0, NULL);
+							   IsParallelWorker() ? TABLE_INSERT_PARALLEL : 0,
+							   NULL);
 
 			/* insert index entries for tuple */
 			if (resultRelInfo->ri_NumIndices > 0)
 				recheckIndexes = ExecInsertIndexTuples(slot, estate, false, NULL,
-													   NIL);
+													   NIL, false, false);
 		}
 	}
 
@@ -683,6 +747,62 @@ ExecInsert(ModifyTableState *mtstate,
 	return result;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecBatchInsert
+ *
+ *		Insert the tuples accumulated for the given foreign result
+ *		relation by ExecInsert using the FDW's batch insert callback,
+ *		then do the per-row processing ExecInsert skipped for them.
+ * ----------------------------------------------------------------
+ */
+static void
+ExecBatchInsert(ModifyTableState *mtstate,
+				ResultRelInfo *resultRelInfo,
+				EState *estate,
+				bool canSetTag)
+{
+	int			i;
+	int			numInserted = resultRelInfo->ri_NumSlots;
+	TupleTableSlot *slot;
+	TupleTableSlot **rslots;
+
+	/*
+	 * insert into foreign table: let the FDW do it
+	 */
+	rslots = resultRelInfo->ri_FdwRoutine->ExecForeignBatchInsert(estate,
+																  resultRelInfo,
+																  resultRelInfo->ri_Slots,
+																  resultRelInfo->ri_PlanSlots,
+																  &numInserted);
+
+	for (i = 0; i < numInserted; i++)
+	{
+		slot = rslots[i];
+
+		/*
+		 * AFTER ROW Triggers might reference the tableoid column, so
+		 * (re-)initialize tts_tableOid before evaluating them.
+		 */
+		slot->tts_tableOid = RelationGetRelid(resultRelInfo->ri_RelationDesc);
+
+		/* AFTER ROW INSERT Triggers */
+		ExecARInsertTriggers(estate, resultRelInfo, slot, NIL,
+							 mtstate->mt_transition_capture);
+
+		/*
+		 * Check any WITH CHECK OPTION constraints from parent views.  See the
+		 * comment in ExecInsert.
+		 */
+		if (resultRelInfo->ri_WithCheckOptions != NIL)
+			ExecWithCheckOptions(WCO_VIEW_CHECK, resultRelInfo, slot, estate);
+	}
+
+	if (canSetTag)
+		estate->es_processed += numInserted;
+
+	resultRelInfo->ri_NumSlots = 0;
+}
+
 /* ----------------------------------------------------------------
  *		ExecDelete
  *
@@ -1144,7 +1264,7 @@ ExecUpdate(ModifyTableState *mtstate,
 	{
 		LockTupleMode lockmode;
 		bool		partition_constraint_failed;
-		bool		update_indexes;
+		TU_UpdateIndexes update_indexes;
 
 		/*
 		 * Constraints might reference the tableoid column, so (re-)initialize
@@ -1475,8 +1595,10 @@ lreplace:;
 		}
 
 		/* insert index entries for tuple if necessary */
-		if (resultRelInfo->ri_NumIndices > 0 && update_indexes)
-			recheckIndexes = ExecInsertIndexTuples(slot, estate, false, NULL, NIL);
+		if (resultRelInfo->ri_NumIndices > 0 && update_indexes != TU_None)
+			recheckIndexes = ExecInsertIndexTuples(slot, estate, false, NULL, NIL,
+												   false,
+												   update_indexes == TU_Summarizing);
 	}
 
 	if (canSetTag)
@@ -2278,6 +2400,33 @@ ExecModifyTable(PlanState *pstate)
 	/* Restore es_result_relation_info before exiting */
 	estate->es_result_relation_info = saved_resultRelInfo;
 
+	/*
+	 * Insert remaining tuples for batch insert.
+	 */
+	if (operation == CMD_INSERT)
+	{
+		ListCell   *lc;
+		int			i;
+
+		resultRelInfo = node->resultRelInfo;
+		for (i = 0; i < node->mt_nplans; i++, resultRelInfo++)
+		{
+			if (resultRelInfo->ri_NumSlots > 0)
+				ExecBatchInsert(node, resultRelInfo, estate, node->canSetTag);
+		}
+
+		if (proute)
+		{
+			foreach(lc, estate->es_tuple_routing_result_relations)
+			{
+				resultRelInfo = (ResultRelInfo *) lfirst(lc);
+				if (resultRelInfo->ri_NumSlots > 0)
+					ExecBatchInsert(node, resultRelInfo, estate,
+									node->canSetTag);
+			}
+		}
+	}
+
 	/*
 	 * We're done, but fire AFTER STATEMENT triggers before exiting.
 	 */
@@ -2733,6 +2882,32 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 		}
 	}
 
+	/*
+	 * Determine if the FDW supports batch insert and determine the batch
+	 * size (a FDW may support batching, but it may be disabled for the
+	 * server/table).
+	 *
+	 * We only do this for INSERT, so that for UPDATE/DELETE the batch size
+	 * remains set to 0.
+	 */
+	if (operation == CMD_INSERT)
+	{
+		resultRelInfo = mtstate->resultRelInfo;
+		for (i = 0; i < nplans; i++, resultRelInfo++)
+		{
+			if (!resultRelInfo->ri_usesFdwDirectModify &&
+				resultRelInfo->ri_FdwRoutine != NULL &&
+				resultRelInfo->ri_FdwRoutine->GetForeignModifyBatchSize &&
+				resultRelInfo->ri_FdwRoutine->ExecForeignBatchInsert)
+				resultRelInfo->ri_BatchSize =
+					resultRelInfo->ri_FdwRoutine->GetForeignModifyBatchSize(resultRelInfo);
+			else
+				resultRelInfo->ri_BatchSize = 1;
+
+			Assert(resultRelInfo->ri_BatchSize >= 1);
+		}
+	}
+
 	/*
 	 * Lastly, if this is not the primary (canSetTag) ModifyTable node, add it
 	 * to estate->es_auxmodifytables so that it will be run to completion by
@@ -0,0 +1,518 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeRepartition.c
+ *	  Routines to redistribute tuples among the participants of a parallel
+ *	  query.
+ *
+ * A Repartition node lets the participants of a parallel query exchange
+ * their tuples so that all the tuples with equal partition keys end up in
+ * the same participant.  It is used below a Finalize Aggregate, which can
+ * then compute its groups in each worker rather than in the leader alone,
+ * and below the WindowAggs of window functions, so that each worker can
+ * compute whole window partitions.
+ *
+ * There are two phases.  First every participant reads all the tuples of
+ * its subplan and writes each into one of a number of partitions, chosen by
+ * hashing the partition key columns; each partition is a SharedTuplestore.
+ * Once all participants are done writing, they each repeatedly claim a
+ * partition that no one has read yet and return all of its tuples.
+ *
+ * A participant that only starts after the others have finished writing
+ * doesn't run its subplan at all.  That's OK because at that point the
+ * others must have consumed all of the input of the parallel-aware scans
+ * below, so its subplan would not return any tuples anyway; this is the
+ * same reasoning as for Parallel Hash Join's build side.
+ *
+ * Outside of a parallel query there is no shared state and the tuples are
+ * just passed through.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeRepartition.c
+ *
+ *-------------------------------------------------------------------------
+ */
+/*
+ * INTERFACE ROUTINES
+ *		ExecRepartition			- return the tuples of the claimed partitions
+ *		ExecInitRepartition		- initialize node and subnodes
+ *		ExecEndRepartition		- shutdown node and subnodes
+ *		ExecReScanRepartition	- rescan the node
+ *
+ *		ExecRepartitionEstimate		estimates DSM space needed
+ *		ExecRepartitionInitializeDSM	initialize DSM for parallel query
+ *		ExecRepartitionReInitializeDSM	reinitialize DSM for fresh scan
+ *		ExecRepartitionInitializeWorker attach to DSM info in parallel worker
+ */
+#include "postgres.h"
+
+#include "access/parallel.h"
+#include "common/hashfn.h"
+#include "executor/executor.h"
+#include "executor/nodeRepartition.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "storage/barrier.h"
+#include "storage/sharedfileset.h"
+#include "utils/sharedtuplestore.h"
+
+/* Phases of ParallelRepartitionState.barrier */
+#define REPARTITION_PHASE_WRITING	0
+#define REPARTITION_PHASE_READING	1
+
+/*
+ * Number of partitions per participant.  Having more partitions than
+ * participants evens out the work when the partitions differ in size.
+ */
+#define REPARTITION_PARTITIONS_PER_PARTICIPANT	4
+
+/*
+ * Initial value for the partition hash.  The Finalize Aggregate above us
+ * hashes the same columns with the same functions for its hash table, so we
+ * must start from something else than it (zero), or all the groups of one
+ * participant would share the low bits of their hash values.
+ */
+#define REPARTITION_HASH_IV		0x5bd1e995
+
+/*
+ * Shared state of a Repartition node in parallel query, followed by the
+ * partitions.
+ */
+typedef struct ParallelRepartitionState
+{
+	int			nparticipants;	/* leader and planned workers */
+	int			npartitions;	/* number of partitions */
+	Size		sts_size;		/* space for each partition, MAXALIGN'd */
+	pg_atomic_uint32 next_partition;	/* next partition to claim */
+	Barrier		barrier;		/* see REPARTITION_PHASE_* */
+	SharedFileSet fileset;		/* holds the partitions' files */
+	uint64		stores[FLEXIBLE_ARRAY_MEMBER];	/* really npartitions
+												 * SharedTuplestores */
+} ParallelRepartitionState;
+
+#define RepartitionStore(pstate, i) \
+	((SharedTuplestore *) ((char *) (pstate)->stores + (i) * (pstate)->sts_size))
+
+static void ExecRepartitionWrite(RepartitionState *node);
+static uint32 ExecRepartitionHash(RepartitionState *node,
+								  TupleTableSlot *slot);
+static Size ExecRepartitionSharedSize(int nparticipants);
+static void ExecRepartitionInitializeShared(RepartitionState *node,
+											ParallelRepartitionState *pstate);
+
+/* ----------------------------------------------------------------
+ *		ExecRepartition
+ *
+ *		The first call writes out all the tuples of the subplan, and waits
+ *		for the other participants to do the same.  After that, each call
+ *		returns the next tuple of the partition we've claimed, claiming
+ *		another one when that's exhausted.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecRepartition(PlanState *pstate)
+{
+	RepartitionState *node = castNode(RepartitionState, pstate);
+	ParallelRepartitionState *shared = node->pstate;
+	TupleTableSlot *slot = node->ps.ps_ResultTupleSlot;
+
+	CHECK_FOR_INTERRUPTS();
+
+	/* Without anyone to exchange tuples with, just pass them through. */
+	if (shared == NULL)
+	{
+		TupleTableSlot *outerslot = ExecProcNode(outerPlanState(node));
+
+		if (TupIsNull(outerslot))
+			return ExecClearTuple(slot);
+		return ExecCopySlot(slot, outerslot);
+	}
+
+	if (node->done)
+		return ExecClearTuple(slot);
+
+	if (!node->written)
+	{
+		ExecRepartitionWrite(node);
+		node->written = true;
+	}
+
+	for (;;)
+	{
+		uint32		partition;
+
+		if (node->curpartition >= 0)
+		{
+			SharedTuplestoreAccessor *accessor;
+			MinimalTuple tuple;
+
+			accessor = node->accessors[node->curpartition];
+			tuple = sts_parallel_scan_next(accessor, NULL);
+			if (tuple != NULL)
+				return ExecStoreMinimalTuple(tuple, slot, false);
+
+			sts_end_parallel_scan(accessor);
+			node->curpartition = -1;
+		}
+
+		/* claim the next partition nobody has read yet */
+		partition = pg_atomic_fetch_add_u32(&shared->next_partition, 1);
+		if (partition >= shared->npartitions)
+			break;
+
+		node->curpartition = partition;
+		sts_begin_parallel_scan(node->accessors[partition]);
+	}
+
+	/* All partitions claimed, so we're done. */
+	BarrierDetach(&shared->barrier);
+	node->done = true;
+
+	return ExecClearTuple(slot);
+}
+
+/*
+ * ExecRepartitionWrite
+ *		Write all the tuples of the subplan into their partitions, unless
+ *		we're too late for that, and wait for the other participants to
+ *		finish writing too.
+ */
+static void
+ExecRepartitionWrite(RepartitionState *node)
+{
+	ParallelRepartitionState *shared = node->pstate;
+	ExprContext *econtext = node->ps.ps_ExprContext;
+	int			participant = ParallelWorkerNumber + 1;
+	int			i;
+
+	node->accessors = (SharedTuplestoreAccessor **)
+		palloc(shared->npartitions * sizeof(SharedTuplestoreAccessor *));
+	for (i = 0; i < shared->npartitions; i++)
+		node->accessors[i] = sts_attach(RepartitionStore(shared, i),
+										participant, &shared->fileset);
+
+	if (BarrierAttach(&shared->barrier) != REPARTITION_PHASE_WRITING)
+	{
+		/* We've missed the writing phase; see comments at top of file. */
+		Assert(BarrierPhase(&shared->barrier) == REPARTITION_PHASE_READING);
+		return;
+	}
+
+	for (;;)
+	{
+		TupleTableSlot *slot = ExecProcNode(outerPlanState(node));
+		MinimalTuple tuple;
+		bool		shouldFree;
+		uint32		hashvalue;
+
+		if (TupIsNull(slot))
+			break;
+
+		ResetExprContext(econtext);
+		hashvalue = ExecRepartitionHash(node, slot);
+
+		tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+		sts_puttuple(node->accessors[hashvalue % shared->npartitions],
+					 NULL, tuple);
+		if (shouldFree)
+			heap_free_minimal_tuple(tuple);
+	}
+
+	for (i = 0; i < shared->npartitions; i++)
+		sts_end_write(node->accessors[i]);
+
+	BarrierArriveAndWait(&shared->barrier, WAIT_EVENT_REPARTITION_WRITE);
+	Assert(BarrierPhase(&shared->barrier) == REPARTITION_PHASE_READING);
+}
+
+/*
+ * ExecRepartitionHash
+ *		Compute the partition hash value of the tuple in the slot.
+ *
+ * This combines the hash values of the columns just like
+ * TupleHashTableHash does, only starting from REPARTITION_HASH_IV.
+ */
+static uint32
+ExecRepartitionHash(RepartitionState *node, TupleTableSlot *slot)
+{
+	Repartition *plan = (Repartition *) node->ps.plan;
+	MemoryContext oldContext;
+	uint32		hashkey = REPARTITION_HASH_IV;
+	int			i;
+
+	/* the hash functions might leak memory */
+	oldContext = MemoryContextSwitchTo(node->ps.ps_ExprContext->ecxt_per_tuple_memory);
+
+	for (i = 0; i < plan->numCols; i++)
+	{
+		Datum		attr;
+		bool		isNull;
+
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		attr = slot_getattr(slot, plan->partColIdx[i], &isNull);
+
+		/* treat nulls as having hash key 0 */
+		if (!isNull)
+		{
+			uint32		hkey;
+
+			hkey = DatumGetUInt32(FunctionCall1Coll(&node->hashfunctions[i],
+													plan->partCollations[i],
+													attr));
+			hashkey ^= hkey;
+		}
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	return murmurhash32(hashkey);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitRepartition
+ * ----------------------------------------------------------------
+ */
+RepartitionState *
+ExecInitRepartition(Repartition *node, EState *estate, int eflags)
+{
+	RepartitionState *rpstate;
+	Oid		   *eqfuncoids;
+
+	/* check for unsupported flags */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	rpstate = makeNode(RepartitionState);
+	rpstate->ps.plan = (Plan *) node;
+	rpstate->ps.state = estate;
+	rpstate->ps.ExecProcNode = ExecRepartition;
+
+	rpstate->pstate = NULL;
+	rpstate->accessors = NULL;
+	rpstate->written = false;
+	rpstate->curpartition = -1;
+	rpstate->done = false;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * create expression context for node, for the hash functions
+	 */
+	ExecAssignExprContext(estate, &rpstate->ps);
+
+	/*
+	 * initialize child nodes
+	 */
+	outerPlanState(rpstate) = ExecInitNode(outerPlan(node), estate, eflags);
+
+	/*
+	 * Initialize result type and slot.  No need to initialize projection info
+	 * because this node doesn't do projections.
+	 */
+	ExecInitResultTupleSlotTL(&rpstate->ps, &TTSOpsMinimalTuple);
+	rpstate->ps.ps_ProjInfo = NULL;
+
+	/*
+	 * Look up the hash functions of the partition key columns.
+	 */
+	execTuplesHashPrepare(node->numCols, node->partOperators,
+						  &eqfuncoids, &rpstate->hashfunctions);
+
+	return rpstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndRepartition
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndRepartition(RepartitionState *node)
+{
+	/* close any files we still have open */
+	ExecShutdownRepartition(node);
+
+	ExecFreeExprContext(&node->ps);
+	ExecClearTuple(node->ps.ps_ResultTupleSlot);
+
+	ExecEndNode(outerPlanState(node));
+}
+
+/* ----------------------------------------------------------------
+ *		ExecShutdownRepartition
+ *
+ *		Detach from the partitions' tuplestores.  This has to happen
+ *		before the DSM segment holding them goes away, which the Gather
+ *		above us does when it shuts down.
+ * ----------------------------------------------------------------
+ */
+void
+ExecShutdownRepartition(RepartitionState *node)
+{
+	int			i;
+
+	if (node->accessors == NULL)
+		return;
+
+	for (i = 0; i < node->pstate->npartitions; i++)
+	{
+		sts_end_parallel_scan(node->accessors[i]);
+		pfree(node->accessors[i]);
+	}
+	pfree(node->accessors);
+	node->accessors = NULL;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecReScanRepartition
+ *
+ *		In a parallel query, the shared state is reset by
+ *		ExecRepartitionReInitializeDSM.
+ * ----------------------------------------------------------------
+ */
+void
+ExecReScanRepartition(RepartitionState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+
+	ExecClearTuple(node->ps.ps_ResultTupleSlot);
+
+	ExecShutdownRepartition(node);
+	node->written = false;
+	node->curpartition = -1;
+	node->done = false;
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (outerPlan->chgParam == NULL)
+		ExecReScan(outerPlan);
+}
+
+/* ----------------------------------------------------------------
+ *						Parallel Query Support
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * ExecRepartitionSharedSize
+ *		Space needed for the shared state, with the given number of
+ *		participants.
+ */
+static Size
+ExecRepartitionSharedSize(int nparticipants)
+{
+	int			npartitions;
+
+	npartitions = nparticipants * REPARTITION_PARTITIONS_PER_PARTICIPANT;
+
+	return add_size(offsetof(ParallelRepartitionState, stores),
+					mul_size(MAXALIGN(sts_estimate(nparticipants)),
+							 npartitions));
+}
+
+/*
+ * ExecRepartitionInitializeShared
+ *		(Re)initialize the barrier and the partitions, which start out empty.
+ */
+static void
+ExecRepartitionInitializeShared(RepartitionState *node,
+								ParallelRepartitionState *pstate)
+{
+	int			i;
+
+	pg_atomic_init_u32(&pstate->next_partition, 0);
+	BarrierInit(&pstate->barrier, 0);
+
+	for (i = 0; i < pstate->npartitions; i++)
+	{
+		SharedTuplestore *sts = RepartitionStore(pstate, i);
+		char		name[NAMEDATALEN];
+
+		/* sts_initialize doesn't reset the page counts */
+		memset(sts, 0, pstate->sts_size);
+		snprintf(name, sizeof(name), "repartition%d.%d",
+				 node->ps.plan->plan_node_id, i);
+		pfree(sts_initialize(sts, pstate->nparticipants, 0, 0, 0,
+							 &pstate->fileset, name));
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRepartitionEstimate
+ *
+ *		Estimate space required to share the partitions.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRepartitionEstimate(RepartitionState *node, ParallelContext *pcxt)
+{
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   ExecRepartitionSharedSize(pcxt->nworkers + 1));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRepartitionInitializeDSM
+ *
+ *		Set up the shared partitions.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRepartitionInitializeDSM(RepartitionState *node, ParallelContext *pcxt)
+{
+	ParallelRepartitionState *pstate;
+	int			nparticipants = pcxt->nworkers + 1;
+
+	pstate = shm_toc_allocate(pcxt->toc,
+							  ExecRepartitionSharedSize(nparticipants));
+	pstate->nparticipants = nparticipants;
+	pstate->npartitions = nparticipants * REPARTITION_PARTITIONS_PER_PARTICIPANT;
+	pstate->sts_size = MAXALIGN(sts_estimate(nparticipants));
+	SharedFileSetInit(&pstate->fileset, pcxt->seg);
+	ExecRepartitionInitializeShared(node, pstate);
+
+	shm_toc_insert(pcxt->toc, node->ps.plan->plan_node_id, pstate);
+	node->pstate = pstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRepartitionReInitializeDSM
+ *
+ *		Reset the shared state for a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRepartitionReInitializeDSM(RepartitionState *node, ParallelContext *pcxt)
+{
+	ParallelRepartitionState *pstate = node->pstate;
+
+	/* get rid of the files of the previous scan */
+	SharedFileSetDeleteAll(&pstate->fileset);
+	ExecRepartitionInitializeShared(node, pstate);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRepartitionInitializeWorker
+ *
+ *		Attach to the shared partitions.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRepartitionInitializeWorker(RepartitionState *node,
+								ParallelWorkerContext *pwcxt)
+{
+	ParallelRepartitionState *pstate;
+
+	pstate = shm_toc_lookup(pwcxt->toc, node->ps.plan->plan_node_id, false);
+	SharedFileSetAttach(&pstate->fileset, pwcxt->seg);
+	node->pstate = pstate;
+}
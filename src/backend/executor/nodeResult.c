@@ -139,6 +139,65 @@ ExecResult(PlanState *pstate)
 	return NULL;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecResultBatch(node)
+ *
+ *		Like ExecResult, but projects a whole batch of tuples from the
+ *		outer plan at once.  Only used when there is an outer plan that
+ *		supports batches.
+ * ----------------------------------------------------------------
+ */
+static TupleBatch *
+ExecResultBatch(PlanState *pstate)
+{
+	ResultState *node = castNode(ResultState, pstate);
+	ExprContext *econtext = node->ps.ps_ExprContext;
+	TupleBatch *result = node->ps.ps_ResultBatch;
+	TupleBatch *outerBatch;
+
+	CHECK_FOR_INTERRUPTS();
+
+	if (result == NULL)
+	{
+		TupleTableSlot *slot = node->ps.ps_ResultTupleSlot;
+
+		result = ExecInitTupleBatch(node->ps.state,
+									slot->tts_tupleDescriptor,
+									slot->tts_ops);
+		node->ps.ps_ResultBatch = result;
+	}
+
+	/*
+	 * check constant qualifications like (2 > 1), if not already done
+	 */
+	if (node->rs_checkqual)
+	{
+		bool		qualResult = ExecQual(node->resconstantqual, econtext);
+
+		node->rs_checkqual = false;
+		if (!qualResult)
+			node->rs_done = true;
+	}
+
+	/*
+	 * Reset per-tuple memory context to free any expression evaluation
+	 * storage allocated in the previous batch.
+	 */
+	ResetExprContext(econtext);
+
+	if (node->rs_done)
+	{
+		ExecClearTupleBatch(result, 0);
+		return result;
+	}
+
+	outerBatch = ExecProcNodeBatch(outerPlanState(node));
+	ExecProjectBatch(node->ps.ps_ProjInfo, &econtext->ecxt_outertuple,
+					 outerBatch, result);
+
+	return result;
+}
+
 /* ----------------------------------------------------------------
  *		ExecResultMarkPos
  * ----------------------------------------------------------------
@@ -228,6 +287,14 @@ ExecInitResult(Result *node, EState *estate, int eflags)
 	resstate->resconstantqual =
 		ExecInitQual((List *) node->resconstantqual, (PlanState *) resstate);
 
+	/*
+	 * We can pass on batches of the outer plan's tuples, if it has them.
+	 */
+	if (outerPlanState(resstate) != NULL &&
+		ExecCanFetchBatches(outerPlanState(resstate)) &&
+		ExecPlanCanProduceBatches(&node->plan))
+		resstate->ps.ExecProcNodeBatch = ExecResultBatch;
+
 	return resstate;
 }
 
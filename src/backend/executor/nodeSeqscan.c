@@ -16,6 +16,7 @@
  * INTERFACE ROUTINES
  *		ExecSeqScan				sequentially scans a relation.
  *		ExecSeqNext				retrieve next tuple in sequential order.
+ *		ExecSeqScanBatch		sequentially scans a relation, a batch at a time.
  *		ExecInitSeqScan			creates and initializes a seqscan node.
  *		ExecEndSeqScan			releases any storage allocated.
  *		ExecReScanSeqScan		rescans the relation
@@ -31,15 +32,100 @@
 #include "access/tableam.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSeqscan.h"
+#include "lib/bloomfilter.h"
+#include "optimizer/optimizer.h"
+#include "utils/lsyscache.h"
 #include "utils/rel.h"
 
+/*
+ * Copy of the hash join's bloom filter in the DSM of a parallel scan, so that
+ * the workers can apply it too.
+ */
+typedef struct SharedHashFilter
+{
+	Size		size;			/* space for the filter */
+	bool		valid;			/* does data hold a filter? */
+	uint64		data[FLEXIBLE_ARRAY_MEMBER];	/* really a bloom_filter */
+} SharedHashFilter;
+
+/* DSM key of the shared filter; must not collide with the plan node IDs */
+#define PARALLEL_KEY_HASH_FILTER(plan_node_id) \
+	(UINT64CONST(0xE100000000000000) | (uint64) (plan_node_id))
+
 static TupleTableSlot *SeqNext(SeqScanState *node);
+static int	SeqNextBatch(SeqScanState *node, TupleBatch *batch);
+static void SeqSetScanProjection(SeqScanState *node);
 
 /* ----------------------------------------------------------------
  *						Scan Support
  * ----------------------------------------------------------------
  */
 
+/*
+ * SeqPassesHashFilter
+ *		Could the tuple in the slot find a join partner, as far as the
+ *		bloom filter handed to us by the hash join above can tell?
+ *
+ * The join key columns are hashed exactly as ExecHashGetHashValue hashes the
+ * join's outer tuples, so that the filter has no false negatives.  Any memory
+ * leaked by the hash functions goes to the per-tuple context; it is left to
+ * the caller to reset that.
+ */
+static inline bool
+SeqPassesHashFilter(SeqScanState *node, TupleTableSlot *slot)
+{
+	SeqScan    *plan = (SeqScan *) node->ss.ps.plan;
+	MemoryContext oldContext;
+	uint32		hashkey = 0;
+	bool		passes = true;
+	int			i;
+
+	oldContext = MemoryContextSwitchTo(node->ss.ps.ps_ExprContext->ecxt_per_tuple_memory);
+
+	for (i = 0; i < plan->numHashFilterCols; i++)
+	{
+		Datum		keyval;
+		bool		isNull;
+
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		keyval = slot_getattr(slot, plan->hashFilterColIdx[i], &isNull);
+
+		if (isNull)
+		{
+			/* a strict join operator can't match a null, so neither can we */
+			if (node->hashfilter_strict[i])
+			{
+				passes = false;
+				break;
+			}
+			/* otherwise a null hashes to zero, ie. leaves hashkey alone */
+		}
+		else
+		{
+			uint32		hkey;
+
+			hkey = DatumGetUInt32(FunctionCall1Coll(&node->hashfilter_functions[i],
+													plan->hashFilterCollations[i],
+													keyval));
+			hashkey ^= hkey;
+		}
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	if (passes &&
+		bloom_lacks_element(node->hashfilter, (unsigned char *) &hashkey,
+							sizeof(hashkey)))
+		passes = false;
+
+	if (!passes)
+		InstrCountFiltered2(node, 1);
+
+	return passes;
+}
+
 /* ----------------------------------------------------------------
  *		SeqNext
  *
@@ -72,16 +158,77 @@ SeqNext(SeqScanState *node)
 								   estate->es_snapshot,
 								   0, NULL);
 		node->ss.ss_currentScanDesc = scandesc;
+		SeqSetScanProjection(node);
 	}
 
 	/*
-	 * get the next tuple from the table
+	 * get the next tuple from the table, skipping those the hash join above
+	 * would find no partner for
 	 */
-	if (table_scan_getnextslot(scandesc, direction, slot))
-		return slot;
+	while (table_scan_getnextslot(scandesc, direction, slot))
+	{
+		if (node->hashfilter == NULL || SeqPassesHashFilter(node, slot))
+			return slot;
+		ResetExprContext(node->ss.ps.ps_ExprContext);
+	}
 	return NULL;
 }
 
+/* ----------------------------------------------------------------
+ *		SeqNextBatch
+ *
+ *		This is a workhorse for ExecSeqScanBatch: fill the batch with the
+ *		next tuples of the table, and return how many were stored.
+ * ----------------------------------------------------------------
+ */
+static int
+SeqNextBatch(SeqScanState *node, TupleBatch *batch)
+{
+	TableScanDesc scandesc = node->ss.ss_currentScanDesc;
+	int			n;
+
+	if (scandesc == NULL)
+	{
+		/* see SeqNext */
+		scandesc = table_beginscan(node->ss.ss_currentRelation,
+								   node->ss.ps.state->es_snapshot,
+								   0, NULL);
+		node->ss.ss_currentScanDesc = scandesc;
+		SeqSetScanProjection(node);
+	}
+
+	for (n = 0; n < batch->maxslots;)
+	{
+		if (!table_scan_getnextslot(scandesc, ForwardScanDirection,
+									batch->slots[n]))
+			break;
+		/* a tuple failing the filter gets its slot overwritten */
+		if (node->hashfilter == NULL ||
+			SeqPassesHashFilter(node, batch->slots[n]))
+			n++;
+	}
+
+	/* release the tuples of the previous batch we didn't overwrite */
+	if (batch->nvalid > n)
+		ExecClearTupleBatch(batch, n);
+	batch->nvalid = n;
+
+	return n;
+}
+
+/*
+ * SeqSetScanProjection
+ *		Tell a freshly started scan which columns we need, if its table AM
+ *		wants to know.
+ */
+static void
+SeqSetScanProjection(SeqScanState *node)
+{
+	if (node->project_scan)
+		table_scan_set_projection(node->ss.ss_currentScanDesc,
+								  node->scan_attrs);
+}
+
 /*
  * SeqRecheck -- access method routine to recheck a tuple in EvalPlanQual
  */
@@ -114,6 +261,23 @@ ExecSeqScan(PlanState *pstate)
 					(ExecScanRecheckMtd) SeqRecheck);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSeqScanBatch(node)
+ *
+ *		Like ExecSeqScan, but returns a batch of qualifying tuples.
+ * ----------------------------------------------------------------
+ */
+static TupleBatch *
+ExecSeqScanBatch(PlanState *pstate)
+{
+	SeqScanState *node = castNode(SeqScanState, pstate);
+
+	return ExecScanBatch(&node->ss,
+						 (ExecScanBatchAccessMtd) SeqNextBatch,
+						 (ExecScanAccessMtd) SeqNext,
+						 (ExecScanRecheckMtd) SeqRecheck);
+}
+
 
 /* ----------------------------------------------------------------
  *		ExecInitSeqScan
@@ -151,7 +315,7 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	 */
 	scanstate->ss.ss_currentRelation =
 		ExecOpenScanRelation(estate,
-							 node->scanrelid,
+							 node->scan.scanrelid,
 							 eflags);
 
 	/* and create slot with the appropriate rowtype */
@@ -163,13 +327,81 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	 * Initialize result type and projection.
 	 */
 	ExecInitResultTypeTL(&scanstate->ss.ps);
-	ExecAssignScanProjectionInfo(&scanstate->ss);
 
 	/*
-	 * initialize child expressions
+	 * initialize child expressions; this may build the qual into the
+	 * projection
 	 */
-	scanstate->ss.ps.qual =
-		ExecInitQual(node->plan.qual, (PlanState *) scanstate);
+	ExecAssignScanQualProjectionInfo(&scanstate->ss, node->scan.plan.qual);
+
+	/*
+	 * If the planner asked for it, prepare to check our tuples against the
+	 * bloom filter of the hash join above.  The join sets hashfilter once it
+	 * has built its hash table.
+	 */
+	if (node->numHashFilterCols > 0)
+	{
+		int			nkeys = node->numHashFilterCols;
+		int			i;
+
+		scanstate->hashfilter_functions =
+			(FmgrInfo *) palloc(nkeys * sizeof(FmgrInfo));
+		scanstate->hashfilter_strict = (bool *) palloc(nkeys * sizeof(bool));
+
+		for (i = 0; i < nkeys; i++)
+		{
+			Oid			left_hashfn;
+			Oid			right_hashfn;
+
+			if (!get_op_hash_functions(node->hashFilterOperators[i],
+									   &left_hashfn, &right_hashfn))
+				elog(ERROR, "could not find hash function for hash operator %u",
+					 node->hashFilterOperators[i]);
+			fmgr_info(left_hashfn, &scanstate->hashfilter_functions[i]);
+			scanstate->hashfilter_strict[i] =
+				op_strict(node->hashFilterOperators[i]);
+		}
+	}
+
+	/*
+	 * If the table AM can skip columns nobody looks at, collect the ones we
+	 * need: those referenced by the target list, the qual, and the bloom
+	 * filter.  A whole-row reference needs them all, so there's nothing to
+	 * tell the AM in that case.
+	 */
+	if (table_scan_supports_projection(scanstate->ss.ss_currentRelation))
+	{
+		Index		scanrelid = node->scan.scanrelid;
+		Bitmapset  *attrs = NULL;
+		int			i;
+
+		pull_varattnos((Node *) node->scan.plan.targetlist, scanrelid, &attrs);
+		pull_varattnos((Node *) node->scan.plan.qual, scanrelid, &attrs);
+		for (i = 0; i < node->numHashFilterCols; i++)
+			attrs = bms_add_member(attrs,
+								   node->hashFilterColIdx[i] -
+								   FirstLowInvalidHeapAttributeNumber);
+
+		if (!bms_is_member(0 - FirstLowInvalidHeapAttributeNumber, attrs))
+		{
+			scanstate->project_scan = true;
+			scanstate->scan_attrs = attrs;
+		}
+	}
+
+	/*
+	 * offer our tuples in batches too, if possible.  Batches are checked
+	 * against ps.qual, so not if that has been merged into the projection;
+	 * the point of both is to cut the per-tuple overhead of evaluating the
+	 * qual.
+	 */
+	if (scanstate->ss.ss_QualProjInfo == NULL &&
+		ExecPlanCanProduceBatches(&node->scan.plan))
+	{
+		scanstate->ss.ps.ExecProcNodeBatch = ExecSeqScanBatch;
+		scanstate->ss.ss_VectorQual =
+			ExecInitVectorQual(node->scan.plan.qual, (PlanState *) scanstate);
+	}
 
 	return scanstate;
 }
@@ -256,6 +488,41 @@ ExecSeqScanEstimate(SeqScanState *node,
 												  estate->es_snapshot);
 	shm_toc_estimate_chunk(&pcxt->estimator, node->pscan_len);
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/*
+	 * If the hash join above us has already given us a bloom filter, make
+	 * room for a copy of it.  The join builds its hash table before it asks
+	 * for the first outer tuple, so we normally do have one by now.
+	 */
+	if (((SeqScan *) node->ss.ps.plan)->numHashFilterCols > 0)
+	{
+		Size		filter_size = 0;
+
+		if (node->hashfilter != NULL)
+			filter_size = bloom_size(node->hashfilter);
+		shm_toc_estimate_chunk(&pcxt->estimator,
+							   add_size(offsetof(SharedHashFilter, data),
+										filter_size));
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+}
+
+/*
+ * Copy our current bloom filter, if any, to the shared filter.
+ */
+static void
+ExecSeqScanShareHashFilter(SeqScanState *node)
+{
+	SharedHashFilter *shared = node->shared_hashfilter;
+
+	if (node->hashfilter != NULL &&
+		bloom_size(node->hashfilter) == shared->size)
+	{
+		memcpy(shared->data, node->hashfilter, shared->size);
+		shared->valid = true;
+	}
+	else
+		shared->valid = false;
 }
 
 /* ----------------------------------------------------------------
@@ -278,6 +545,24 @@ ExecSeqScanInitializeDSM(SeqScanState *node,
 	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pscan);
 	node->ss.ss_currentScanDesc =
 		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+	SeqSetScanProjection(node);
+
+	if (((SeqScan *) node->ss.ps.plan)->numHashFilterCols > 0)
+	{
+		Size		filter_size = 0;
+		SharedHashFilter *shared;
+
+		if (node->hashfilter != NULL)
+			filter_size = bloom_size(node->hashfilter);
+		shared = shm_toc_allocate(pcxt->toc,
+								  offsetof(SharedHashFilter, data) + filter_size);
+		shared->size = filter_size;
+		shm_toc_insert(pcxt->toc,
+					   PARALLEL_KEY_HASH_FILTER(node->ss.ps.plan->plan_node_id),
+					   shared);
+		node->shared_hashfilter = shared;
+		ExecSeqScanShareHashFilter(node);
+	}
 }
 
 /* ----------------------------------------------------------------
@@ -294,6 +579,10 @@ ExecSeqScanReInitializeDSM(SeqScanState *node,
 
 	pscan = node->ss.ss_currentScanDesc->rs_parallel;
 	table_parallelscan_reinitialize(node->ss.ss_currentRelation, pscan);
+
+	/* the hash join may have rebuilt its filter since */
+	if (node->shared_hashfilter != NULL)
+		ExecSeqScanShareHashFilter(node);
 }
 
 /* ----------------------------------------------------------------
@@ -311,4 +600,16 @@ ExecSeqScanInitializeWorker(SeqScanState *node,
 	pscan = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, false);
 	node->ss.ss_currentScanDesc =
 		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+	SeqSetScanProjection(node);
+
+	if (((SeqScan *) node->ss.ps.plan)->numHashFilterCols > 0)
+	{
+		SharedHashFilter *shared;
+
+		shared = shm_toc_lookup(pwcxt->toc,
+								PARALLEL_KEY_HASH_FILTER(node->ss.ps.plan->plan_node_id),
+								false);
+		if (shared->valid)
+			node->hashfilter = (bloom_filter *) shared->data;
+	}
 }
@@ -19,8 +19,41 @@
 #include "executor/execdebug.h"
 #include "executor/nodeSort.h"
 #include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/barrier.h"
 #include "utils/tuplesort.h"
 
+/*
+ * Shared state of a Parallel Sort.
+ *
+ * Each participant that attaches while the barrier is still in the sorting
+ * phase sorts the tuples it gets from its subplan into a run of its own, in
+ * the shared temporary files of the Sharedsort that follows this struct.  The
+ * participant elected by the barrier once they have all finished merges the
+ * runs and returns the result, while the others return nothing, so the output
+ * of the Gather above is in sort order.  The SharedSortInfo for EXPLAIN
+ * ANALYZE, if any, follows the Sharedsort.
+ */
+typedef struct ParallelSortState
+{
+	Barrier		barrier;
+	pg_atomic_uint32 nruns;		/* number of runs written so far */
+	int			nparticipants;	/* maximum number of participants */
+	bool		instrumented;	/* is there a SharedSortInfo? */
+} ParallelSortState;
+
+#define PARALLEL_SORT_PHASE_SORTING		0
+#define PARALLEL_SORT_PHASE_MERGING		1
+
+#define ParallelSortShared(pstate) \
+	((Sharedsort *) ((char *) (pstate) + MAXALIGN(sizeof(ParallelSortState))))
+#define ParallelSortInstrument(pstate) \
+	((SharedSortInfo *) ((char *) ParallelSortShared(pstate) + \
+						 tuplesort_estimate_shared((pstate)->nparticipants)))
+
+static Tuplesortstate *ExecParallelSort(SortState *node, TupleDesc tupDesc);
+static Size ExecParallelSortSize(SortState *node, ParallelContext *pcxt);
+
 
 /* ----------------------------------------------------------------
  *		ExecSort
@@ -57,6 +90,23 @@ ExecSort(PlanState *pstate)
 	dir = estate->es_direction;
 	tuplesortstate = (Tuplesortstate *) node->tuplesortstate;
 
+	/*
+	 * A Parallel Sort sorts its share of the tuples in cooperation with the
+	 * other participants instead; see ExecParallelSort.
+	 */
+	if (!node->sort_Done && node->pstate != NULL)
+	{
+		estate->es_direction = ForwardScanDirection;
+		tuplesortstate =
+			ExecParallelSort(node, ExecGetResultType(outerPlanState(node)));
+		estate->es_direction = dir;
+
+		node->tuplesortstate = (void *) tuplesortstate;
+		node->sort_Done = true;
+		node->bounded_Done = node->bounded;
+		node->bound_Done = node->bound;
+	}
+
 	/*
 	 * If first time through, read all tuples from outer plan and pass them to
 	 * tuplesort.c. Subsequent calls just fetch tuples from tuplesort.
@@ -144,6 +194,10 @@ ExecSort(PlanState *pstate)
 	SO1_printf("ExecSort: %s\n",
 			   "retrieving tuple from tuplesort");
 
+	/* In a Parallel Sort, only the participant that merged returns tuples */
+	if (tuplesortstate == NULL)
+		return ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+
 	/*
 	 * Get the first or next tuple from tuplesort. Returns NULL if no more
 	 * tuples.  Note that we only rely on slot tuple remaining valid until the
@@ -156,6 +210,100 @@ ExecSort(PlanState *pstate)
 	return slot;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecParallelSort
+ *
+ *		Sorts this participant's share of the outer subtree's tuples into
+ *		a run in the shared temporary files, and waits for the others to
+ *		do the same.  The participant elected to merge the runs returns the
+ *		tuplesort state to fetch the merged result from; the others return
+ *		NULL.
+ * ----------------------------------------------------------------
+ */
+static Tuplesortstate *
+ExecParallelSort(SortState *node, TupleDesc tupDesc)
+{
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+	ParallelSortState *pstate = node->pstate;
+	PlanState  *outerNode = outerPlanState(node);
+	SortCoordinateData coordinate;
+	Tuplesortstate *tuplesortstate;
+	TupleTableSlot *slot;
+
+	/*
+	 * If the runs are already being merged, we're too late to contribute
+	 * one, so leave the work to those who came before us.
+	 */
+	BarrierAttach(&pstate->barrier);
+	if (BarrierPhase(&pstate->barrier) != PARALLEL_SORT_PHASE_SORTING)
+	{
+		BarrierDetach(&pstate->barrier);
+		return NULL;
+	}
+
+	coordinate.isWorker = true;
+	coordinate.nParticipants = -1;
+	coordinate.sharedsort = ParallelSortShared(pstate);
+
+	tuplesortstate = tuplesort_begin_heap(tupDesc,
+										  plannode->numCols,
+										  plannode->sortColIdx,
+										  plannode->sortOperators,
+										  plannode->collations,
+										  plannode->nullsFirst,
+										  work_mem,
+										  &coordinate,
+										  false);
+
+	for (;;)
+	{
+		slot = ExecProcNode(outerNode);
+
+		if (TupIsNull(slot))
+			break;
+
+		tuplesort_puttupleslot(tuplesortstate, slot);
+	}
+
+	/* Write out our run, which the merge will read back from the files */
+	tuplesort_performsort(tuplesortstate);
+	if (node->shared_info && node->am_worker)
+	{
+		TuplesortInstrumentation *si;
+
+		Assert(IsParallelWorker());
+		Assert(ParallelWorkerNumber <= node->shared_info->num_workers);
+		si = &node->shared_info->sinstrument[ParallelWorkerNumber];
+		tuplesort_get_stats(tuplesortstate, si);
+	}
+	tuplesort_end(tuplesortstate);
+	pg_atomic_fetch_add_u32(&pstate->nruns, 1);
+
+	if (!BarrierArriveAndWait(&pstate->barrier, WAIT_EVENT_PARALLEL_SORT))
+	{
+		BarrierDetach(&pstate->barrier);
+		return NULL;
+	}
+
+	/* We were elected to merge the runs of all the participants */
+	coordinate.isWorker = false;
+	coordinate.nParticipants = pg_atomic_read_u32(&pstate->nruns);
+
+	tuplesortstate = tuplesort_begin_heap(tupDesc,
+										  plannode->numCols,
+										  plannode->sortColIdx,
+										  plannode->sortOperators,
+										  plannode->collations,
+										  plannode->nullsFirst,
+										  work_mem,
+										  &coordinate,
+										  false);
+	tuplesort_performsort(tuplesortstate);
+	BarrierDetach(&pstate->barrier);
+
+	return tuplesortstate;
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitSort
  *
@@ -328,7 +476,8 @@ ExecReScanSort(SortState *node)
 		!node->randomAccess)
 	{
 		node->sort_Done = false;
-		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+		if (node->tuplesortstate != NULL)
+			tuplesort_end((Tuplesortstate *) node->tuplesortstate);
 		node->tuplesortstate = NULL;
 
 		/*
@@ -347,10 +496,32 @@ ExecReScanSort(SortState *node)
  * ----------------------------------------------------------------
  */
 
+/*
+ * Space needed for the shared state of a Parallel Sort, including the sort
+ * statistics if any.
+ */
+static Size
+ExecParallelSortSize(SortState *node, ParallelContext *pcxt)
+{
+	Size		size;
+
+	size = MAXALIGN(sizeof(ParallelSortState));
+	size = add_size(size, tuplesort_estimate_shared(pcxt->nworkers + 1));
+	if (node->ss.ps.instrument && pcxt->nworkers > 0)
+	{
+		size = add_size(size, offsetof(SharedSortInfo, sinstrument));
+		size = add_size(size, mul_size(pcxt->nworkers,
+									   sizeof(TuplesortInstrumentation)));
+	}
+
+	return size;
+}
+
 /* ----------------------------------------------------------------
  *		ExecSortEstimate
  *
- *		Estimate space required to propagate sort statistics.
+ *		Estimate space required to propagate sort statistics, and for a
+ *		Parallel Sort, to coordinate the participants.
  * ----------------------------------------------------------------
  */
 void
@@ -358,6 +529,14 @@ ExecSortEstimate(SortState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		shm_toc_estimate_chunk(&pcxt->estimator,
+							   ExecParallelSortSize(node, pcxt));
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+		return;
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -371,7 +550,8 @@ ExecSortEstimate(SortState *node, ParallelContext *pcxt)
 /* ----------------------------------------------------------------
  *		ExecSortInitializeDSM
  *
- *		Initialize DSM space for sort statistics.
+ *		Initialize DSM space for sort statistics, and for a Parallel Sort,
+ *		the shared sort state.
  * ----------------------------------------------------------------
  */
 void
@@ -379,6 +559,33 @@ ExecSortInitializeDSM(SortState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		ParallelSortState *pstate;
+
+		pstate = shm_toc_allocate(pcxt->toc, ExecParallelSortSize(node, pcxt));
+		BarrierInit(&pstate->barrier, 0);
+		pg_atomic_init_u32(&pstate->nruns, 0);
+		pstate->nparticipants = pcxt->nworkers + 1;
+		pstate->instrumented = node->ss.ps.instrument && pcxt->nworkers > 0;
+		tuplesort_initialize_shared(ParallelSortShared(pstate),
+									pstate->nparticipants, pcxt->seg);
+
+		if (pstate->instrumented)
+		{
+			size = offsetof(SharedSortInfo, sinstrument)
+				+ pcxt->nworkers * sizeof(TuplesortInstrumentation);
+			node->shared_info = ParallelSortInstrument(pstate);
+			/* ensure any unfilled slots will contain zeroes */
+			memset(node->shared_info, 0, size);
+			node->shared_info->num_workers = pcxt->nworkers;
+		}
+
+		node->pstate = pstate;
+		shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pstate);
+		return;
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -393,15 +600,46 @@ ExecSortInitializeDSM(SortState *node, ParallelContext *pcxt)
 				   node->shared_info);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSortReInitializeDSM
+ *
+ *		Reset the shared state of a Parallel Sort before a rescan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSortReInitializeDSM(SortState *node, ParallelContext *pcxt)
+{
+	ParallelSortState *pstate = node->pstate;
+
+	BarrierInit(&pstate->barrier, 0);
+	pg_atomic_write_u32(&pstate->nruns, 0);
+	tuplesort_reinitialize_shared(ParallelSortShared(pstate));
+}
+
 /* ----------------------------------------------------------------
  *		ExecSortInitializeWorker
  *
- *		Attach worker to DSM space for sort statistics.
+ *		Attach worker to DSM space for sort statistics, and for a Parallel
+ *		Sort, the shared sort state.
  * ----------------------------------------------------------------
  */
 void
 ExecSortInitializeWorker(SortState *node, ParallelWorkerContext *pwcxt)
 {
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		ParallelSortState *pstate;
+
+		pstate = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id,
+								false);
+		tuplesort_attach_shared(ParallelSortShared(pstate), pwcxt->seg);
+		node->pstate = pstate;
+		if (pstate->instrumented)
+			node->shared_info = ParallelSortInstrument(pstate);
+		node->am_worker = true;
+		return;
+	}
+
 	node->shared_info =
 		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
 	node->am_worker = true;
@@ -8,6 +8,16 @@
  *
  * A TupleQueueReader reads tuples from a shm_mq and returns the tuples.
  *
+ * Sending each tuple as a message of its own is expensive when tuples are
+ * small, as every message updates the queue's shared state and wakes up the
+ * receiver.  So, while the receiver still has unread data in the queue, the
+ * sender collects tuples into a batch and sends the batch as one message.
+ * A message holds one or more MinimalTuples, each starting at a MAXALIGN'd
+ * offset; since a MinimalTuple starts with its length, the reader can step
+ * through them without any further framing.  Once the receiver has caught
+ * up, tuples are sent without delay, so that a slow producer doesn't hold
+ * back tuples a waiting leader could already be returning.
+ *
  * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -22,48 +32,59 @@
 #include "access/htup_details.h"
 #include "executor/tqueue.h"
 
+/*
+ * Maximum size of a batch of tuples sent as one message.  It's kept well
+ * below the size of a tuple queue, so that the receiver can read one batch
+ * while the sender is writing the next.
+ */
+#define TQUEUE_BATCH_SIZE	8192
+
 /*
  * DestReceiver object's private contents
  *
- * queue is a pointer to data supplied by DestReceiver's caller.
+ * queue is a pointer to data supplied by DestReceiver's caller.  batch holds
+ * the tuples not sent yet, batch_used bytes of it.
  */
 typedef struct TQueueDestReceiver
 {
 	DestReceiver pub;			/* public fields */
 	shm_mq_handle *queue;		/* shm_mq to send to */
+	char	   *batch;			/* tuples waiting to be sent */
+	Size		batch_used;		/* bytes used in batch */
 } TQueueDestReceiver;
 
 /*
  * TupleQueueReader object's private contents
  *
- * queue is a pointer to data supplied by reader's caller.
+ * queue is a pointer to data supplied by reader's caller.  batch points to
+ * the message last received, which holds batch_len bytes of tuples, of which
+ * the ones before batch_off have been returned already.
  *
  * "typedef struct TupleQueueReader TupleQueueReader" is in tqueue.h
  */
 struct TupleQueueReader
 {
 	shm_mq_handle *queue;		/* shm_mq to receive from */
+	char	   *batch;			/* current message */
+	Size		batch_len;		/* its length */
+	Size		batch_off;		/* offset of the next tuple to return */
 };
 
 /*
- * Receive a tuple from a query, and send it to the designated shm_mq.
+ * Send a message holding one or more tuples.
+ *
+ * Unless force_flush is true, the receiver may not see the message until we
+ * have sent more, or detached from the queue.
  *
  * Returns true if successful, false if shm_mq has been detached.
  */
 static bool
-tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
+tqueueSendMessage(TQueueDestReceiver *tqueue, Size nbytes, const void *data,
+				  bool force_flush)
 {
-	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
-	MinimalTuple tuple;
 	shm_mq_result result;
-	bool		should_free;
-
-	/* Send the tuple itself. */
-	tuple = ExecFetchSlotMinimalTuple(slot, &should_free);
-	result = shm_mq_send(tqueue->queue, tuple->t_len, tuple, false);
 
-	if (should_free)
-		pfree(tuple);
+	result = shm_mq_send(tqueue->queue, nbytes, data, false, force_flush);
 
 	/* Check for failure. */
 	if (result == SHM_MQ_DETACHED)
@@ -76,6 +97,63 @@ tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
 	return true;
 }
 
+/*
+ * Send the tuples collected in the batch, if any.
+ */
+static bool
+tqueueFlushBatch(TQueueDestReceiver *tqueue, bool force_flush)
+{
+	Size		nbytes = tqueue->batch_used;
+
+	if (nbytes == 0)
+		return true;
+
+	tqueue->batch_used = 0;
+	return tqueueSendMessage(tqueue, nbytes, tqueue->batch, force_flush);
+}
+
+/*
+ * Receive a tuple from a query, and send it to the designated shm_mq, or
+ * add it to the batch to be sent later.
+ *
+ * Returns true if successful, false if shm_mq has been detached.
+ */
+static bool
+tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
+{
+	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
+	MinimalTuple tuple;
+	Size		len;
+	bool		should_free;
+	bool		result = true;
+
+	tuple = ExecFetchSlotMinimalTuple(slot, &should_free);
+	len = tuple->t_len;
+
+	/*
+	 * Make room for the tuple, or send it alone if it's too big to batch.
+	 * shm_mq flushes these messages once enough of them have piled up.
+	 */
+	if (tqueue->batch_used + MAXALIGN(len) > TQUEUE_BATCH_SIZE)
+		result = tqueueFlushBatch(tqueue, false);
+	if (result && MAXALIGN(len) > TQUEUE_BATCH_SIZE)
+		result = tqueueSendMessage(tqueue, len, tuple, false);
+	else if (result)
+	{
+		memcpy(tqueue->batch + tqueue->batch_used, tuple, len);
+		tqueue->batch_used += MAXALIGN(len);
+
+		/* Don't keep tuples back if the receiver is waiting for them. */
+		if (shm_mq_is_drained(tqueue->queue))
+			result = tqueueFlushBatch(tqueue, true);
+	}
+
+	if (should_free)
+		pfree(tuple);
+
+	return result;
+}
+
 /*
  * Prepare to receive tuples from executor.
  */
@@ -94,7 +172,11 @@ tqueueShutdownReceiver(DestReceiver *self)
 	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
 
 	if (tqueue->queue != NULL)
+	{
+		/* Send what's left; if the receiver is gone, nobody cares. */
+		(void) tqueueFlushBatch(tqueue, true);
 		shm_mq_detach(tqueue->queue);
+	}
 	tqueue->queue = NULL;
 }
 
@@ -109,6 +191,8 @@ tqueueDestroyReceiver(DestReceiver *self)
 	/* We probably already detached from queue, but let's be sure */
 	if (tqueue->queue != NULL)
 		shm_mq_detach(tqueue->queue);
+	if (tqueue->batch != NULL)
+		pfree(tqueue->batch);
 	pfree(self);
 }
 
@@ -128,6 +212,8 @@ CreateTupleQueueDestReceiver(shm_mq_handle *handle)
 	self->pub.rDestroy = tqueueDestroyReceiver;
 	self->pub.mydest = DestTupleQueue;
 	self->queue = handle;
+	/* zeroed, so that alignment padding isn't sent uninitialized */
+	self->batch = palloc0(TQUEUE_BATCH_SIZE);
 
 	return (DestReceiver *) self;
 }
@@ -168,6 +254,9 @@ DestroyTupleQueueReader(TupleQueueReader *reader)
  * and should not be freed.  The pointer is invalid after the next call to
  * TupleQueueReaderNext().
  *
+ * Tuples are returned from the batch last received until it's exhausted;
+ * only then do we go back to the queue for another message.
+ *
  * Even when shm_mq_receive() returns SHM_MQ_WOULD_BLOCK, this can still
  * accumulate bytes from a partially-read message, so it's useful to call
  * this with nowait = true even if nothing is returned.
@@ -183,6 +272,15 @@ TupleQueueReaderNext(TupleQueueReader *reader, bool nowait, bool *done)
 	if (done != NULL)
 		*done = false;
 
+	/* Return the next tuple of the current batch, if there's one left. */
+	if (reader->batch_off < reader->batch_len)
+	{
+		tuple = (MinimalTuple) (reader->batch + reader->batch_off);
+		reader->batch_off += MAXALIGN(tuple->t_len);
+		Assert(reader->batch_off <= MAXALIGN(reader->batch_len));
+		return tuple;
+	}
+
 	/* Attempt to read a message. */
 	result = shm_mq_receive(reader->queue, &nbytes, &data, nowait);
 
@@ -201,10 +299,15 @@ TupleQueueReaderNext(TupleQueueReader *reader, bool nowait, bool *done)
 
 	/*
 	 * Return a pointer to the queue memory directly (which had better be
-	 * sufficiently aligned).
+	 * sufficiently aligned).  The message stays valid until the next call to
+	 * shm_mq_receive(), which we won't make before it's been used up.
 	 */
 	tuple = (MinimalTuple) data;
-	Assert(tuple->t_len == nbytes);
+	Assert(tuple->t_len <= nbytes);
+
+	reader->batch = (char *) data;
+	reader->batch_len = nbytes;
+	reader->batch_off = MAXALIGN(tuple->t_len);
 
 	return tuple;
 }
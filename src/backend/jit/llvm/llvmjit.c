@@ -146,6 +146,30 @@ llvm_create_context(int jitFlags)
 	return context;
 }
 
+/*
+ * Create a context for code that lives until the end of the session.
+ *
+ * This is for code that doesn't embed any query's state, and so can be
+ * shared by all later queries, like the cached tuple deforming functions of
+ * llvmjit_deform.c.  Such a context isn't tracked by any resource owner, and
+ * the code emitted for it is never released.
+ */
+LLVMJitContext *
+llvm_create_session_context(int jitFlags)
+{
+	LLVMJitContext *context;
+
+	llvm_assert_in_fatal_section();
+
+	llvm_session_initialize();
+
+	context = MemoryContextAllocZero(TopMemoryContext,
+									 sizeof(LLVMJitContext));
+	context->base.flags = jitFlags;
+
+	return context;
+}
+
 /*
  * Release resources required by one llvm context.
  */
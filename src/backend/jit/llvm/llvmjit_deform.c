@@ -22,11 +22,182 @@
 
 #include "access/htup_details.h"
 #include "access/tupdesc_details.h"
+#include "common/hashfn.h"
 #include "executor/tuptable.h"
 #include "jit/llvmjit.h"
 #include "jit/llvmjit_emit.h"
+#include "lib/stringinfo.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
 
 
+/*
+ * Cache of emitted deforming functions.
+ *
+ * A deforming function depends only on the physical layout of the tuple
+ * descriptor, the type of slot and the number of columns to deform, never on
+ * any state of the query it was generated for.  So instead of generating,
+ * optimizing and emitting the same code again for every query on a table,
+ * we keep the functions we emitted for the rest of the session, and have the
+ * expressions of later queries call them through a pointer.
+ *
+ * The entries are looked up by the hash of their signature, which encodes
+ * all the inputs of slot_compile_deform() the code depends on.  On a hash
+ * collision we just don't cache the newcomer.
+ */
+typedef struct DeformCacheEntry
+{
+	uint32		hash;			/* hash of signature; must be first */
+	char	   *signature;		/* what the function was generated for */
+	int			siglen;
+	void	   *func;			/* the emitted function */
+} DeformCacheEntry;
+
+/* emitted code is never freed, so don't let the cache grow without bound */
+#define DEFORM_CACHE_MAX_ENTRIES	1024
+
+static HTAB *deform_cache = NULL;
+
+static char *deform_signature(TupleDesc desc, const TupleTableSlotOps *ops,
+							  int natts, int jitFlags, int *len);
+
+
+/*
+ * Return a function that deforms a tuple of type desc up to natts columns,
+ * for the code of context to call, or NULL if we don't JIT deforming for
+ * this type of slot.  Unlike slot_compile_deform(), use the session's cache
+ * of deforming functions if possible.
+ */
+LLVMValueRef
+slot_compile_deform_cached(LLVMJitContext *context, TupleDesc desc,
+						   const TupleTableSlotOps *ops, int natts)
+{
+	DeformCacheEntry *entry;
+	char	   *signature;
+	int			siglen;
+	uint32		hash;
+
+	/* see slot_compile_deform() */
+	if (!jit_cache_deforming ||
+		(ops != &TTSOpsHeapTuple && ops != &TTSOpsBufferHeapTuple &&
+		 ops != &TTSOpsMinimalTuple))
+		return slot_compile_deform(context, desc, ops, natts);
+
+	if (deform_cache == NULL)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(uint32);
+		ctl.entrysize = sizeof(DeformCacheEntry);
+		deform_cache = hash_create("LLVM JIT deform cache", 64, &ctl,
+								   HASH_ELEM | HASH_BLOBS);
+	}
+
+	signature = deform_signature(desc, ops, natts, context->base.flags,
+								 &siglen);
+	hash = hash_bytes((unsigned char *) signature, siglen);
+
+	entry = (DeformCacheEntry *) hash_search(deform_cache, &hash,
+											 HASH_FIND, NULL);
+	if (entry == NULL &&
+		hash_get_num_entries(deform_cache) < DEFORM_CACHE_MAX_ENTRIES)
+	{
+		LLVMJitContext *session_context;
+		LLVMValueRef v_deform_fn;
+		char	   *funcname;
+		void	   *func;
+
+		/*
+		 * Emit the function in a module of its own, right away.  The module
+		 * must have been emitted successfully before we add the entry; if we
+		 * fail halfway, all we leak is the session context.
+		 */
+		session_context = llvm_create_session_context(context->base.flags);
+		v_deform_fn = slot_compile_deform(session_context, desc, ops, natts);
+		Assert(v_deform_fn != NULL);
+
+		/* the function has to be visible to be looked up */
+		LLVMSetLinkage(v_deform_fn, LLVMExternalLinkage);
+		funcname = pstrdup(LLVMGetValueName(v_deform_fn));
+		func = llvm_get_function(session_context, funcname);
+		pfree(funcname);
+
+		/* charge the work to the query that had to do it */
+		InstrJitAgg(&context->base.instr, &session_context->base.instr);
+
+		entry = (DeformCacheEntry *) hash_search(deform_cache, &hash,
+												 HASH_ENTER, NULL);
+		entry->signature = MemoryContextAlloc(TopMemoryContext, siglen);
+		memcpy(entry->signature, signature, siglen);
+		entry->siglen = siglen;
+		entry->func = func;
+	}
+
+	if (entry == NULL || entry->siglen != siglen ||
+		memcmp(entry->signature, signature, siglen) != 0)
+	{
+		/* cache full, or hash collision */
+		pfree(signature);
+		return slot_compile_deform(context, desc, ops, natts);
+	}
+
+	pfree(signature);
+
+	{
+		LLVMTypeRef param_types[1];
+		LLVMTypeRef deform_sig;
+
+		param_types[0] = l_ptr(StructTupleTableSlot);
+		deform_sig = LLVMFunctionType(LLVMVoidType(), param_types,
+									  lengthof(param_types), 0);
+
+		return l_ptr_const(entry->func, l_ptr(deform_sig));
+	}
+}
+
+/*
+ * Build the cache signature of a deforming function: everything about its
+ * inputs that the generated code depends on.
+ */
+static char *
+deform_signature(TupleDesc desc, const TupleTableSlotOps *ops, int natts,
+				 int jitFlags, int *len)
+{
+	StringInfoData buf;
+	char		slotkind;
+	int			optflags = jitFlags & (PGJIT_OPT3 | PGJIT_INLINE);
+	int			attnum;
+
+	if (ops == &TTSOpsHeapTuple)
+		slotkind = 'h';
+	else if (ops == &TTSOpsBufferHeapTuple)
+		slotkind = 'b';
+	else
+		slotkind = 'm';
+
+	initStringInfo(&buf);
+	appendStringInfoChar(&buf, slotkind);
+	appendBinaryStringInfo(&buf, (char *) &optflags, sizeof(optflags));
+	appendBinaryStringInfo(&buf, (char *) &natts, sizeof(natts));
+	appendBinaryStringInfo(&buf, (char *) &desc->natts, sizeof(desc->natts));
+
+	for (attnum = 0; attnum < desc->natts; attnum++)
+	{
+		Form_pg_attribute att = TupleDescAttr(desc, attnum);
+
+		appendBinaryStringInfo(&buf, (char *) &att->attlen,
+							   sizeof(att->attlen));
+		appendStringInfoChar(&buf, att->attalign);
+		appendStringInfoChar(&buf, att->attbyval);
+		appendStringInfoChar(&buf, att->attnotnull);
+		appendStringInfoChar(&buf, att->atthasmissing);
+		appendStringInfoChar(&buf, att->attisdropped);
+	}
+
+	*len = buf.len;
+	return buf.data;
+}
+
 /*
  * Create a function that deforms a tuple of type desc up to natts columns.
  */
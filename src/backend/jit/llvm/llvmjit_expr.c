@@ -329,9 +329,9 @@ llvm_compile_expr(ExprState *state)
 					if (tts_ops && desc && (context->base.flags & PGJIT_DEFORM))
 					{
 						l_jit_deform =
-							slot_compile_deform(context, desc,
-												tts_ops,
-												op->d.fetch.last_var);
+							slot_compile_deform_cached(context, desc,
+													   tts_ops,
+													   op->d.fetch.last_var);
 					}
 
 					if (l_jit_deform)
@@ -547,12 +547,14 @@ llvm_compile_expr(ExprState *state)
 
 			case EEOP_FUNCEXPR:
 			case EEOP_FUNCEXPR_STRICT:
+			case EEOP_FUNCEXPR_STRICT_1:
+			case EEOP_FUNCEXPR_STRICT_2:
 				{
 					FunctionCallInfo fcinfo = op->d.func.fcinfo_data;
 					LLVMValueRef v_fcinfo_isnull;
 					LLVMValueRef v_retval;
 
-					if (opcode == EEOP_FUNCEXPR_STRICT)
+					if (opcode != EEOP_FUNCEXPR)
 					{
 						LLVMBasicBlockRef b_nonull;
 						LLVMBasicBlockRef *b_checkargnulls;
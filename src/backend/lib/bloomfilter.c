@@ -75,7 +75,7 @@ static inline uint32 mod_m(uint32 a, uint64 m);
  * implementation allocates only enough memory to target its standard false
  * positive rate, using a simple formula with caller's total_elems estimate as
  * an input.  The bitset might be as small as 1MB, even when bloom_work_mem is
- * much higher.
+ * much higher; see bloom_create_ext() for callers that want smaller filters.
  *
  * The Bloom filter is seeded using a value provided by the caller.  Using a
  * distinct seed value on every call makes it unlikely that the same false
@@ -86,6 +86,22 @@ static inline uint32 mod_m(uint32 a, uint64 m);
  */
 bloom_filter *
 bloom_create(int64 total_elems, int bloom_work_mem, uint64 seed)
+{
+	return bloom_create_ext(total_elems, bloom_work_mem, 1024, seed);
+}
+
+/*
+ * Like bloom_create(), but with the minimum bitset size given by caller as
+ * bloom_min_mem, in KB.
+ *
+ * The floor of bloom_create() is a good default when total_elems might be a
+ * wild guess, but a caller sizing many small filters from estimates it can
+ * trust, and that can cope with a filter that turns out too full, is better
+ * off without it.
+ */
+bloom_filter *
+bloom_create_ext(int64 total_elems, int bloom_work_mem, int bloom_min_mem,
+				 uint64 seed)
 {
 	bloom_filter *filter;
 	int			bloom_power;
@@ -100,7 +116,7 @@ bloom_create(int64 total_elems, int bloom_work_mem, uint64 seed)
 	 * false positive rate still won't exceed 2% in almost all cases.
 	 */
 	bitset_bytes = Min(bloom_work_mem * UINT64CONST(1024), total_elems * 2);
-	bitset_bytes = Max(1024 * 1024, bitset_bytes);
+	bitset_bytes = Max(bloom_min_mem * UINT64CONST(1024), bitset_bytes);
 
 	/*
 	 * Size in bits should be the highest power of two <= target.  bitset_bits
@@ -129,6 +145,19 @@ bloom_free(bloom_filter *filter)
 	pfree(filter);
 }
 
+/*
+ * Size of Bloom filter, in bytes
+ *
+ * A filter is a single chunk of memory without any pointers, so a copy of
+ * this many bytes made elsewhere (in shared memory, say) is a valid filter
+ * too, as long as it isn't passed to bloom_free().
+ */
+Size
+bloom_size(bloom_filter *filter)
+{
+	return offsetof(bloom_filter, bitset) + filter->m / BITS_PER_BYTE;
+}
+
 /*
  * Add element to Bloom filter
  */
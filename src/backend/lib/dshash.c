@@ -17,8 +17,12 @@
  * is only expected to happen a small number of times until a stable size is
  * found, since growth is geometric.
  *
- * Future versions may support iterators and incremental resizing; for now
- * the implementation is minimalist.
+ * Sequential scans visit one partition at a time, holding only that
+ * partition's lock, so they don't block concurrent resizing for longer than
+ * it takes to scan a partition.
+ *
+ * Future versions may support incremental resizing; for now the
+ * implementation is minimalist.
  *
  * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -574,6 +578,114 @@ dshash_release_lock(dshash_table *hash_table, void *entry)
 	LWLockRelease(PARTITION_LOCK(hash_table, partition_index));
 }
 
+/*
+ * Begin a sequential scan of all entries.  Entries are returned with their
+ * partition locked in shared or exclusive mode depending on 'exclusive',
+ * and the lock stays held until dshash_seq_next moves to another partition
+ * or dshash_seq_term is called, so the same advice as for dshash_find
+ * applies: don't do much between calls.  Entries inserted or deleted by
+ * other backends during the scan may or may not be returned.
+ *
+ * The caller must not hold any partition lock, and must not call
+ * dshash_find and friends during the scan.
+ */
+void
+dshash_seq_init(dshash_seq_status *status, dshash_table *hash_table,
+				bool exclusive)
+{
+	Assert(hash_table->control->magic == DSHASH_MAGIC);
+	Assert(!hash_table->find_locked);
+
+	status->hash_table = hash_table;
+	status->exclusive = exclusive;
+	status->curpartition = -1;
+	status->curbucket = 0;
+	status->endbucket = 0;
+	status->curitem = NULL;
+	status->nextitem = InvalidDsaPointer;
+}
+
+/*
+ * Return the next entry of a sequential scan, or NULL at the end.  When NULL
+ * is returned, no lock is held anymore and dshash_seq_term need not be
+ * called, though doing so is harmless.
+ */
+void *
+dshash_seq_next(dshash_seq_status *status)
+{
+	dshash_table *hash_table = status->hash_table;
+	dsa_pointer item_pointer = status->nextitem;
+
+	while (!DsaPointerIsValid(item_pointer))
+	{
+		if (status->curpartition >= 0 && status->curbucket < status->endbucket)
+		{
+			/* Move on to the next bucket in this partition. */
+			item_pointer = hash_table->buckets[status->curbucket++];
+			continue;
+		}
+
+		/* Done with this partition. */
+		if (status->curpartition >= 0)
+			LWLockRelease(PARTITION_LOCK(hash_table, status->curpartition));
+		if (++status->curpartition >= DSHASH_NUM_PARTITIONS)
+		{
+			status->curpartition = -1;
+			status->curitem = NULL;
+			return NULL;
+		}
+
+		/*
+		 * Lock the next partition.  The hash table can't be resized while we
+		 * hold the lock, so the partition's range of buckets stays put.
+		 * Resizing between partitions is harmless, because an entry's
+		 * partition depends only on its hash value.
+		 */
+		LWLockAcquire(PARTITION_LOCK(hash_table, status->curpartition),
+					  status->exclusive ? LW_EXCLUSIVE : LW_SHARED);
+		ensure_valid_bucket_pointers(hash_table);
+		status->curbucket =
+			BUCKET_INDEX_FOR_PARTITION(status->curpartition,
+									   hash_table->size_log2);
+		status->endbucket = status->curbucket +
+			BUCKETS_PER_PARTITION(hash_table->size_log2);
+	}
+
+	status->curitem = dsa_get_address(hash_table->area, item_pointer);
+
+	/* Remember the next item, in case the caller deletes this one. */
+	status->nextitem = status->curitem->next;
+
+	return ENTRY_FROM_ITEM(status->curitem);
+}
+
+/*
+ * End a sequential scan before dshash_seq_next has returned NULL, releasing
+ * the lock held.
+ */
+void
+dshash_seq_term(dshash_seq_status *status)
+{
+	if (status->curpartition >= 0)
+		LWLockRelease(PARTITION_LOCK(status->hash_table,
+									 status->curpartition));
+	status->curpartition = -1;
+}
+
+/*
+ * Delete the entry most recently returned by dshash_seq_next.  The scan must
+ * have been started in exclusive mode.
+ */
+void
+dshash_delete_current(dshash_seq_status *status)
+{
+	Assert(status->exclusive);
+	Assert(status->curitem != NULL);
+
+	delete_item(status->hash_table, status->curitem);
+	status->curitem = NULL;
+}
+
 /*
  * A compare function that forwards to memcmp.
  */
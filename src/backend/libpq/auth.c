@@ -357,6 +357,21 @@ ClientAuthentication(Port *port)
 
 	CHECK_FOR_INTERRUPTS();
 
+	/*
+	 * A connection proxy starting a backend to grow a session pool has
+	 * already had a client authenticated for the same user and database; see
+	 * proxy.c.  Still honor a reject entry added since.
+	 */
+	if (port->proxy_trusted &&
+		port->hba->auth_method != uaReject &&
+		port->hba->auth_method != uaImplicitReject)
+	{
+		if (ClientAuthentication_hook)
+			(*ClientAuthentication_hook) (port, STATUS_OK);
+		sendAuthRequest(port, AUTH_REQ_OK, NULL, 0);
+		return;
+	}
+
 	/*
 	 * This is the first point where we have access to the hba record for the
 	 * current connection, so perform any verifications based on the hba
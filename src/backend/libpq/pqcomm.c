@@ -57,6 +57,8 @@
  *		pq_flush		- flush pending output
  *		pq_flush_if_writable - flush pending output if writable without blocking
  *		pq_getbyte_if_available - get a byte if available without blocking
+ *		pq_buffer_has_complete_message - is a whole message already received?
+ *		pq_start_compression - compress the rest of the session
  *
  * message-level I/O (and old-style-COPY-OUT cruft):
  *		pq_putmessage	- send a normal message (suppressed in COPY OUT mode)
@@ -87,12 +89,15 @@
 #endif
 
 #include "common/ip.h"
+#include "common/stream_compression.h"
 #include "libpq/libpq.h"
 #include "miscadmin.h"
 #include "port/pg_bswap.h"
+#include "postmaster/postmaster.h"
 #include "storage/ipc.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
+#include "utils/varlena.h"
 
 /*
  * Cope with the various platform-specific ways to spell TCP keepalive socket
@@ -118,6 +123,7 @@
  */
 int			Unix_socket_permissions;
 char	   *Unix_socket_group;
+bool		protocol_compression = false;
 
 /* Where the Unix socket files are (list of palloc'd strings) */
 static List *sock_paths = NIL;
@@ -141,6 +147,30 @@ static char PqRecvBuffer[PQ_RECV_BUFFER_SIZE];
 static int	PqRecvPointer;		/* Next index to read a byte from PqRecvBuffer */
 static int	PqRecvLength;		/* End of data available in PqRecvBuffer */
 
+/*
+ * Protocol compression state, see pq_start_compression().  Once compression
+ * is on, data leaves PqSendBuffer compressed into PqZSendBuffer one chunk at
+ * a time, and what we receive collects in PqZRecvBuffer until a whole chunk
+ * can be decompressed into PqZResultBuffer, from where it goes to
+ * PqRecvBuffer.
+ */
+static StreamCompressor *PqCompressor = NULL;
+static StreamCompressor *PqDecompressor = NULL;
+
+#define PQ_ZBUFFER_SIZE (PQ_COMPRESSION_HEADER_SIZE + PQ_COMPRESSION_MAX_COMPRESSED)
+
+static char *PqZSendBuffer;
+static int	PqZSendPointer;		/* End of the chunk in PqZSendBuffer */
+static int	PqZSendStart;		/* Next index to send a byte in PqZSendBuffer */
+
+static char *PqZRecvBuffer;
+static int	PqZRecvLength;		/* End of data available in PqZRecvBuffer */
+
+static char *PqZResultBuffer;
+static int	PqZResultPointer;	/* Next index to read a byte from
+								 * PqZResultBuffer */
+static int	PqZResultLength;	/* End of data available in PqZResultBuffer */
+
 /*
  * Message status
  */
@@ -162,6 +192,8 @@ static void socket_startcopyout(void);
 static void socket_endcopyout(bool errorAbort);
 static int	internal_putbytes(const char *s, size_t len);
 static int	internal_flush(void);
+static int	internal_flush_buffer(const char *buf, int *start, int *end);
+static ssize_t pq_read(void *ptr, size_t len);
 
 #ifdef HAVE_UNIX_SOCKETS
 static int	Lock_AF_UNIX(const char *unixSocketDir, const char *unixSocketPath);
@@ -191,6 +223,9 @@ WaitEventSet *FeBeWaitSet;
 void
 pq_init(void)
 {
+	int			socket_pos PG_USED_FOR_ASSERTS_ONLY;
+	int			latch_pos PG_USED_FOR_ASSERTS_ONLY;
+
 	/* initialize state variables */
 	PqSendBufferSize = PQ_SEND_BUFFER_SIZE;
 	PqSendBuffer = MemoryContextAlloc(TopMemoryContext, PqSendBufferSize);
@@ -219,10 +254,19 @@ pq_init(void)
 #endif
 
 	FeBeWaitSet = CreateWaitEventSet(TopMemoryContext, 3);
-	AddWaitEventToSet(FeBeWaitSet, WL_SOCKET_WRITEABLE, MyProcPort->sock,
+	socket_pos = AddWaitEventToSet(FeBeWaitSet, WL_SOCKET_WRITEABLE,
+								   MyProcPort->sock, NULL, NULL);
+	latch_pos = AddWaitEventToSet(FeBeWaitSet, WL_LATCH_SET, PGINVALID_SOCKET,
+								  MyLatch, NULL);
+	AddWaitEventToSet(FeBeWaitSet, WL_POSTMASTER_DEATH, PGINVALID_SOCKET,
 					  NULL, NULL);
-	AddWaitEventToSet(FeBeWaitSet, WL_LATCH_SET, -1, MyLatch, NULL);
-	AddWaitEventToSet(FeBeWaitSet, WL_POSTMASTER_DEATH, -1, NULL, NULL);
+
+	/*
+	 * The event positions match the order we added them, but let's sanity
+	 * check them to be sure.
+	 */
+	Assert(socket_pos == FeBeWaitSetSocketPos);
+	Assert(latch_pos == FeBeWaitSetLatchPos);
 }
 
 /* --------------------------------
@@ -947,8 +991,8 @@ pq_recvbuf(void)
 	{
 		int			r;
 
-		r = secure_read(MyProcPort, PqRecvBuffer + PqRecvLength,
-						PQ_RECV_BUFFER_SIZE - PqRecvLength);
+		r = pq_read(PqRecvBuffer + PqRecvLength,
+					PQ_RECV_BUFFER_SIZE - PqRecvLength);
 
 		if (r < 0)
 		{
@@ -979,6 +1023,83 @@ pq_recvbuf(void)
 	}
 }
 
+/* --------------------------------
+ *		pq_read - read data from the client
+ *
+ * Like secure_read(), but decompresses the data if protocol compression is
+ * on.  Data we can't decompress is reported, and treated as EOF.
+ * --------------------------------
+ */
+static ssize_t
+pq_read(void *ptr, size_t len)
+{
+	if (PqDecompressor == NULL)
+		return secure_read(MyProcPort, ptr, len);
+
+	for (;;)
+	{
+		ssize_t		r;
+
+		/* Return what's left of the last chunk decompressed, if anything */
+		if (PqZResultPointer < PqZResultLength)
+		{
+			r = Min(len, PqZResultLength - PqZResultPointer);
+			memcpy(ptr, PqZResultBuffer + PqZResultPointer, r);
+			PqZResultPointer += r;
+			return r;
+		}
+
+		/* Decompress the next chunk, if we have all of it */
+		if (PqZRecvLength >= PQ_COMPRESSION_HEADER_SIZE)
+		{
+			uint32		zlen;
+			uint32		rawlen;
+
+			memcpy(&zlen, PqZRecvBuffer, 4);
+			zlen = pg_ntoh32(zlen);
+			memcpy(&rawlen, PqZRecvBuffer + 4, 4);
+			rawlen = pg_ntoh32(rawlen);
+
+			if (zlen == 0 || zlen > PQ_COMPRESSION_MAX_COMPRESSED ||
+				rawlen == 0 || rawlen > PQ_COMPRESSION_CHUNK_SIZE)
+			{
+				ereport(COMMERROR,
+						(errcode(ERRCODE_PROTOCOL_VIOLATION),
+						 errmsg("invalid compressed data chunk from client")));
+				return 0;
+			}
+
+			if (PqZRecvLength >= PQ_COMPRESSION_HEADER_SIZE + zlen)
+			{
+				if (!stream_decompress(PqDecompressor,
+									   PqZRecvBuffer + PQ_COMPRESSION_HEADER_SIZE,
+									   zlen, PqZResultBuffer, rawlen))
+				{
+					ereport(COMMERROR,
+							(errcode(ERRCODE_PROTOCOL_VIOLATION),
+							 errmsg("could not decompress data from client")));
+					return 0;
+				}
+				PqZResultPointer = 0;
+				PqZResultLength = rawlen;
+
+				PqZRecvLength -= PQ_COMPRESSION_HEADER_SIZE + zlen;
+				memmove(PqZRecvBuffer,
+						PqZRecvBuffer + PQ_COMPRESSION_HEADER_SIZE + zlen,
+						PqZRecvLength);
+				continue;
+			}
+		}
+
+		/* Need more data */
+		r = secure_read(MyProcPort, PqZRecvBuffer + PqZRecvLength,
+						PQ_ZBUFFER_SIZE - PqZRecvLength);
+		if (r <= 0)
+			return r;
+		PqZRecvLength += r;
+	}
+}
+
 /* --------------------------------
  *		pq_getbyte	- get a single byte from connection, or return EOF
  * --------------------------------
@@ -1039,7 +1160,7 @@ pq_getbyte_if_available(unsigned char *c)
 	/* Put the socket into non-blocking mode */
 	socket_set_nonblocking(true);
 
-	r = secure_read(MyProcPort, c, 1);
+	r = pq_read(c, 1);
 	if (r < 0)
 	{
 		/*
@@ -1071,6 +1192,30 @@ pq_getbyte_if_available(unsigned char *c)
 	return r;
 }
 
+/* --------------------------------
+ *		pq_buffer_has_complete_message - check for a fully received message
+ *
+ * Returns true if the receive buffer already holds at least one complete
+ * protocol 3 message (type byte, length word and body), which can thus be
+ * read without waiting for the client.  Data still held inside the SSL or
+ * GSSAPI layer is not considered.
+ * --------------------------------
+ */
+bool
+pq_buffer_has_complete_message(void)
+{
+	uint32		len;
+
+	if (PqRecvLength - PqRecvPointer < 1 + 4)
+		return false;
+
+	memcpy(&len, PqRecvBuffer + PqRecvPointer + 1, 4);
+	len = pg_ntoh32(len);
+
+	/* the length word counts itself, but not the type byte */
+	return (uint32) (PqRecvLength - PqRecvPointer - 1) >= len;
+}
+
 /* --------------------------------
  *		pq_getbytes		- get a known number of bytes from connection
  *
@@ -1407,17 +1552,81 @@ socket_flush(void)
  */
 static int
 internal_flush(void)
+{
+	if (PqCompressor == NULL)
+		return internal_flush_buffer(PqSendBuffer, &PqSendStart, &PqSendPointer);
+
+	for (;;)
+	{
+		int			rawlen;
+		int			zlen;
+		uint32		n32;
+
+		/* Finish sending the last chunk compressed */
+		if (PqZSendStart < PqZSendPointer)
+		{
+			if (internal_flush_buffer(PqZSendBuffer, &PqZSendStart,
+									  &PqZSendPointer))
+			{
+				/* the uncompressed data is dropped as well */
+				PqSendStart = PqSendPointer = 0;
+				return EOF;
+			}
+			if (PqZSendStart < PqZSendPointer)
+				return 0;		/* would block */
+		}
+
+		if (PqSendStart >= PqSendPointer)
+			break;
+
+		/* Compress the next chunk */
+		rawlen = Min(PqSendPointer - PqSendStart, PQ_COMPRESSION_CHUNK_SIZE);
+		zlen = stream_compress(PqCompressor, PqSendBuffer + PqSendStart, rawlen,
+							   PqZSendBuffer + PQ_COMPRESSION_HEADER_SIZE,
+							   PQ_COMPRESSION_MAX_COMPRESSED);
+		if (zlen < 0)
+		{
+			ereport(COMMERROR,
+					(errmsg("could not compress data to send to client")));
+			PqSendStart = PqSendPointer = 0;
+			ClientConnectionLost = 1;
+			InterruptPending = 1;
+			return EOF;
+		}
+
+		n32 = pg_hton32((uint32) zlen);
+		memcpy(PqZSendBuffer, &n32, 4);
+		n32 = pg_hton32((uint32) rawlen);
+		memcpy(PqZSendBuffer + 4, &n32, 4);
+		PqZSendStart = 0;
+		PqZSendPointer = PQ_COMPRESSION_HEADER_SIZE + zlen;
+		PqSendStart += rawlen;
+	}
+
+	PqSendStart = PqSendPointer = 0;
+	return 0;
+}
+
+/* --------------------------------
+ *		internal_flush_buffer - send buf[*start .. *end)
+ *
+ * Advances *start past what was sent, and resets both to 0 once all of it
+ * is.  Returns like internal_flush().
+ * --------------------------------
+ */
+static int
+internal_flush_buffer(const char *buf, int *start, int *end)
 {
 	static int	last_reported_send_errno = 0;
 
-	char	   *bufptr = PqSendBuffer + PqSendStart;
-	char	   *bufend = PqSendBuffer + PqSendPointer;
+	const char *bufptr = buf + *start;
+	const char *bufend = buf + *end;
 
 	while (bufptr < bufend)
 	{
 		int			r;
 
-		r = secure_write(MyProcPort, bufptr, bufend - bufptr);
+		r = secure_write(MyProcPort, (char *) bufptr, bufend - bufptr);
 
 		if (r <= 0)
 		{
@@ -1457,7 +1666,7 @@ internal_flush(void)
 			 * flag that'll cause the next CHECK_FOR_INTERRUPTS to terminate
 			 * the connection.
 			 */
-			PqSendStart = PqSendPointer = 0;
+			*start = *end = 0;
 			ClientConnectionLost = 1;
 			InterruptPending = 1;
 			return EOF;
@@ -1465,10 +1674,10 @@ internal_flush(void)
 
 		last_reported_send_errno = 0;	/* reset after any successful send */
 		bufptr += r;
-		PqSendStart += r;
+		*start += r;
 	}
 
-	PqSendStart = PqSendPointer = 0;
+	*start = *end = 0;
 	return 0;
 }
 
@@ -1484,7 +1693,7 @@ socket_flush_if_writable(void)
 	int			res;
 
 	/* Quick exit if nothing to do */
-	if (PqSendPointer == PqSendStart)
+	if (!socket_is_send_pending())
 		return 0;
 
 	/* No-op if reentrant call */
@@ -1507,7 +1716,8 @@ socket_flush_if_writable(void)
 static bool
 socket_is_send_pending(void)
 {
-	return (PqSendStart < PqSendPointer);
+	return (PqSendStart < PqSendPointer ||
+			PqZSendStart < PqZSendPointer);
 }
 
 /* --------------------------------
@@ -1630,6 +1840,100 @@ socket_endcopyout(bool errorAbort)
 	DoingCopyOut = false;
 }
 
+/* --------------------------------
+ *		pq_start_compression - compress the rest of the session
+ *
+ *		methods is the value of the client's _pq_.compression startup
+ *		parameter, a list of compression methods in order of preference.
+ *		If we support one of them, we name it in a CompressionAck message,
+ *		and compress everything we exchange with the client after that.
+ *		Otherwise nothing changes, and the client will see no CompressionAck.
+ *
+ *		This must be called right after the startup packet has been read.
+ * --------------------------------
+ */
+void
+pq_start_compression(const char *methods)
+{
+	StreamCompressionMethod method = STREAM_COMPRESSION_NONE;
+	StreamCompressor *compressor;
+	StreamCompressor *decompressor;
+	MemoryContext oldcontext;
+	const char *name;
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *lc;
+
+	Assert(PqCompressor == NULL);
+
+	if (!protocol_compression)
+		return;
+
+	rawstring = pstrdup(methods);
+	if (SplitIdentifierString(rawstring, ',', &elemlist))
+	{
+		foreach(lc, elemlist)
+		{
+			StreamCompressionMethod m;
+
+			if (parse_stream_compression_method((char *) lfirst(lc), &m) &&
+				m != STREAM_COMPRESSION_NONE &&
+				stream_compression_supported(m))
+			{
+				method = m;
+				break;
+			}
+		}
+	}
+	list_free(elemlist);
+	pfree(rawstring);
+
+	if (method == STREAM_COMPRESSION_NONE)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	compressor = stream_compressor_create(method, false);
+	decompressor = stream_compressor_create(method, true);
+	if (compressor == NULL || decompressor == NULL)
+	{
+		if (compressor != NULL)
+			stream_compressor_free(compressor);
+		if (decompressor != NULL)
+			stream_compressor_free(decompressor);
+		MemoryContextSwitchTo(oldcontext);
+		ereport(LOG,
+				(errmsg("could not initialize %s compression",
+						stream_compression_method_name(method))));
+		return;
+	}
+	Assert(stream_compress_bound(compressor, PQ_COMPRESSION_CHUNK_SIZE) <=
+		   PQ_COMPRESSION_MAX_COMPRESSED);
+
+	PqZSendBuffer = palloc(PQ_ZBUFFER_SIZE);
+	PqZRecvBuffer = palloc(PQ_ZBUFFER_SIZE);
+	PqZResultBuffer = palloc(PQ_COMPRESSION_CHUNK_SIZE);
+	MemoryContextSwitchTo(oldcontext);
+
+	/* The acknowledgement itself goes out uncompressed */
+	name = stream_compression_method_name(method);
+	pq_putmessage('z', name, strlen(name) + 1);
+	pq_flush();
+
+	if (Log_connections)
+		ereport(LOG,
+				(errmsg("connection compressed: method=%s", name)));
+
+	PqCompressor = compressor;
+	PqDecompressor = decompressor;
+	PqZSendStart = PqZSendPointer = 0;
+	PqZResultPointer = PqZResultLength = 0;
+
+	/* Anything the client sent after the startup packet is compressed */
+	PqZRecvLength = PqRecvLength - PqRecvPointer;
+	memcpy(PqZRecvBuffer, PqRecvBuffer + PqRecvPointer, PqZRecvLength);
+	PqRecvPointer = PqRecvLength = 0;
+}
+
 /*
  * Support for TCP Keepalive parameters
  */
@@ -96,6 +96,8 @@ _copyPlannedStmt(const PlannedStmt *from)
 	COPY_NODE_FIELD(subplans);
 	COPY_BITMAPSET_FIELD(rewindPlanIDs);
 	COPY_NODE_FIELD(rowMarks);
+	COPY_NODE_FIELD(partPruneInfos);
+	COPY_BITMAPSET_FIELD(prunableRelids);
 	COPY_NODE_FIELD(relationOids);
 	COPY_NODE_FIELD(invalItems);
 	COPY_NODE_FIELD(paramExecTypes);
@@ -121,6 +123,7 @@ CopyPlanFields(const Plan *from, Plan *newnode)
 	COPY_SCALAR_FIELD(plan_width);
 	COPY_SCALAR_FIELD(parallel_aware);
 	COPY_SCALAR_FIELD(parallel_safe);
+	COPY_SCALAR_FIELD(async_capable);
 	COPY_SCALAR_FIELD(plan_node_id);
 	COPY_NODE_FIELD(targetlist);
 	COPY_NODE_FIELD(qual);
@@ -244,6 +247,7 @@ _copyAppend(const Append *from)
 	 */
 	COPY_BITMAPSET_FIELD(apprelids);
 	COPY_NODE_FIELD(appendplans);
+	COPY_SCALAR_FIELD(nasyncplans);
 	COPY_SCALAR_FIELD(first_partial_plan);
 	COPY_NODE_FIELD(part_prune_info);
 
@@ -446,6 +450,14 @@ _copySeqScan(const SeqScan *from)
 	 */
 	CopyScanFields((const Scan *) from, (Scan *) newnode);
 
+	/*
+	 * copy remainder of node
+	 */
+	COPY_SCALAR_FIELD(numHashFilterCols);
+	COPY_POINTER_FIELD(hashFilterColIdx, from->numHashFilterCols * sizeof(AttrNumber));
+	COPY_POINTER_FIELD(hashFilterOperators, from->numHashFilterCols * sizeof(Oid));
+	COPY_POINTER_FIELD(hashFilterCollations, from->numHashFilterCols * sizeof(Oid));
+
 	return newnode;
 }
 
@@ -927,6 +939,33 @@ _copyMaterial(const Material *from)
 }
 
 
+/*
+ * _copyResultCache
+ */
+static ResultCache *
+_copyResultCache(const ResultCache *from)
+{
+	ResultCache *newnode = makeNode(ResultCache);
+
+	/*
+	 * copy node superclass fields
+	 */
+	CopyPlanFields((const Plan *) from, (Plan *) newnode);
+
+	/*
+	 * copy remainder of node
+	 */
+	COPY_SCALAR_FIELD(numKeys);
+	COPY_POINTER_FIELD(hashOperators, sizeof(Oid) * from->numKeys);
+	COPY_POINTER_FIELD(collations, sizeof(Oid) * from->numKeys);
+	COPY_NODE_FIELD(param_exprs);
+	COPY_SCALAR_FIELD(singlerow);
+	COPY_SCALAR_FIELD(est_entries);
+
+	return newnode;
+}
+
+
 /*
  * CopySortFields
  *
@@ -1116,6 +1155,30 @@ _copyHash(const Hash *from)
 	return newnode;
 }
 
+/*
+ * _copyRepartition
+ */
+static Repartition *
+_copyRepartition(const Repartition *from)
+{
+	Repartition *newnode = makeNode(Repartition);
+
+	/*
+	 * copy node superclass fields
+	 */
+	CopyPlanFields((const Plan *) from, (Plan *) newnode);
+
+	/*
+	 * copy remainder of node
+	 */
+	COPY_SCALAR_FIELD(numCols);
+	COPY_POINTER_FIELD(partColIdx, from->numCols * sizeof(AttrNumber));
+	COPY_POINTER_FIELD(partOperators, from->numCols * sizeof(Oid));
+	COPY_POINTER_FIELD(partCollations, from->numCols * sizeof(Oid));
+
+	return newnode;
+}
+
 /*
  * _copySetOp
  */
@@ -1235,6 +1298,7 @@ _copyPartitionPruneInfo(const PartitionPruneInfo *from)
 
 	COPY_NODE_FIELD(prune_infos);
 	COPY_BITMAPSET_FIELD(other_subplans);
+	COPY_NODE_FIELD(subplan_rtis);
 
 	return newnode;
 }
@@ -2930,6 +2994,7 @@ _copyColumnDef(const ColumnDef *from)
 
 	COPY_STRING_FIELD(colname);
 	COPY_NODE_FIELD(typeName);
+	COPY_STRING_FIELD(compression);
 	COPY_SCALAR_FIELD(inhcount);
 	COPY_SCALAR_FIELD(is_local);
 	COPY_SCALAR_FIELD(is_not_null);
@@ -4674,6 +4739,18 @@ _copyPartitionCmd(const PartitionCmd *from)
 	return newnode;
 }
 
+static PublicationTable *
+_copyPublicationTable(const PublicationTable *from)
+{
+	PublicationTable *newnode = makeNode(PublicationTable);
+
+	COPY_NODE_FIELD(relation);
+	COPY_NODE_FIELD(columns);
+	COPY_NODE_FIELD(whereClause);
+
+	return newnode;
+}
+
 static CreatePublicationStmt *
 _copyCreatePublicationStmt(const CreatePublicationStmt *from)
 {
@@ -4937,6 +5014,9 @@ copyObjectImpl(const void *from)
 		case T_Material:
 			retval = _copyMaterial(from);
 			break;
+		case T_ResultCache:
+			retval = _copyResultCache(from);
+			break;
 		case T_Sort:
 			retval = _copySort(from);
 			break;
@@ -4958,6 +5038,9 @@ copyObjectImpl(const void *from)
 		case T_Hash:
 			retval = _copyHash(from);
 			break;
+		case T_Repartition:
+			retval = _copyRepartition(from);
+			break;
 		case T_SetOp:
 			retval = _copySetOp(from);
 			break;
@@ -5547,6 +5630,9 @@ copyObjectImpl(const void *from)
 		case T_AlterPolicyStmt:
 			retval = _copyAlterPolicyStmt(from);
 			break;
+		case T_PublicationTable:
+			retval = _copyPublicationTable(from);
+			break;
 		case T_CreatePublicationStmt:
 			retval = _copyCreatePublicationStmt(from);
 			break;
@@ -314,6 +314,8 @@ _outPlannedStmt(StringInfo str, const PlannedStmt *node)
 	WRITE_NODE_FIELD(subplans);
 	WRITE_BITMAPSET_FIELD(rewindPlanIDs);
 	WRITE_NODE_FIELD(rowMarks);
+	WRITE_NODE_FIELD(partPruneInfos);
+	WRITE_BITMAPSET_FIELD(prunableRelids);
 	WRITE_NODE_FIELD(relationOids);
 	WRITE_NODE_FIELD(invalItems);
 	WRITE_NODE_FIELD(paramExecTypes);
@@ -334,6 +336,7 @@ _outPlanInfo(StringInfo str, const Plan *node)
 	WRITE_INT_FIELD(plan_width);
 	WRITE_BOOL_FIELD(parallel_aware);
 	WRITE_BOOL_FIELD(parallel_safe);
+	WRITE_BOOL_FIELD(async_capable);
 	WRITE_INT_FIELD(plan_node_id);
 	WRITE_NODE_FIELD(targetlist);
 	WRITE_NODE_FIELD(qual);
@@ -434,6 +437,7 @@ _outAppend(StringInfo str, const Append *node)
 
 	WRITE_BITMAPSET_FIELD(apprelids);
 	WRITE_NODE_FIELD(appendplans);
+	WRITE_INT_FIELD(nasyncplans);
 	WRITE_INT_FIELD(first_partial_plan);
 	WRITE_NODE_FIELD(part_prune_info);
 }
@@ -536,6 +540,11 @@ _outSeqScan(StringInfo str, const SeqScan *node)
 	WRITE_NODE_TYPE("SEQSCAN");
 
 	_outScanInfo(str, (const Scan *) node);
+
+	WRITE_INT_FIELD(numHashFilterCols);
+	WRITE_ATTRNUMBER_ARRAY(hashFilterColIdx, node->numHashFilterCols);
+	WRITE_OID_ARRAY(hashFilterOperators, node->numHashFilterCols);
+	WRITE_OID_ARRAY(hashFilterCollations, node->numHashFilterCols);
 }
 
 static void
@@ -836,6 +845,21 @@ _outMaterial(StringInfo str, const Material *node)
 	_outPlanInfo(str, (const Plan *) node);
 }
 
+static void
+_outResultCache(StringInfo str, const ResultCache *node)
+{
+	WRITE_NODE_TYPE("RESULTCACHE");
+
+	_outPlanInfo(str, (const Plan *) node);
+
+	WRITE_INT_FIELD(numKeys);
+	WRITE_OID_ARRAY(hashOperators, node->numKeys);
+	WRITE_OID_ARRAY(collations, node->numKeys);
+	WRITE_NODE_FIELD(param_exprs);
+	WRITE_BOOL_FIELD(singlerow);
+	WRITE_UINT_FIELD(est_entries);
+}
+
 static void
 _outSortInfo(StringInfo str, const Sort *node)
 {
@@ -893,6 +917,19 @@ _outHash(StringInfo str, const Hash *node)
 	WRITE_FLOAT_FIELD(rows_total, "%.0f");
 }
 
+static void
+_outRepartition(StringInfo str, const Repartition *node)
+{
+	WRITE_NODE_TYPE("REPARTITION");
+
+	_outPlanInfo(str, (const Plan *) node);
+
+	WRITE_INT_FIELD(numCols);
+	WRITE_ATTRNUMBER_ARRAY(partColIdx, node->numCols);
+	WRITE_OID_ARRAY(partOperators, node->numCols);
+	WRITE_OID_ARRAY(partCollations, node->numCols);
+}
+
 static void
 _outSetOp(StringInfo str, const SetOp *node)
 {
@@ -969,6 +1006,7 @@ _outPartitionPruneInfo(StringInfo str, const PartitionPruneInfo *node)
 
 	WRITE_NODE_FIELD(prune_infos);
 	WRITE_BITMAPSET_FIELD(other_subplans);
+	WRITE_NODE_FIELD(subplan_rtis);
 }
 
 static void
@@ -1908,6 +1946,21 @@ _outMaterialPath(StringInfo str, const MaterialPath *node)
 	WRITE_NODE_FIELD(subpath);
 }
 
+static void
+_outResultCachePath(StringInfo str, const ResultCachePath *node)
+{
+	WRITE_NODE_TYPE("RESULTCACHEPATH");
+
+	_outPathInfo(str, (const Path *) node);
+
+	WRITE_NODE_FIELD(subpath);
+	WRITE_NODE_FIELD(hash_operators);
+	WRITE_NODE_FIELD(param_exprs);
+	WRITE_BOOL_FIELD(singlerow);
+	WRITE_FLOAT_FIELD(calls, "%.0f");
+	WRITE_UINT_FIELD(est_entries);
+}
+
 static void
 _outUniquePath(StringInfo str, const UniquePath *node)
 {
@@ -2149,6 +2202,17 @@ _outGatherMergePath(StringInfo str, const GatherMergePath *node)
 	WRITE_INT_FIELD(num_workers);
 }
 
+static void
+_outRepartitionPath(StringInfo str, const RepartitionPath *node)
+{
+	WRITE_NODE_TYPE("REPARTITIONPATH");
+
+	_outPathInfo(str, (const Path *) node);
+
+	WRITE_NODE_FIELD(subpath);
+	WRITE_NODE_FIELD(groupClause);
+}
+
 static void
 _outNestPath(StringInfo str, const NestPath *node)
 {
@@ -2196,6 +2260,8 @@ _outPlannerGlobal(StringInfo str, const PlannerGlobal *node)
 	WRITE_NODE_FIELD(resultRelations);
 	WRITE_NODE_FIELD(rootResultRelations);
 	WRITE_NODE_FIELD(appendRelations);
+	WRITE_NODE_FIELD(partPruneInfos);
+	WRITE_BITMAPSET_FIELD(prunableRelids);
 	WRITE_NODE_FIELD(relationOids);
 	WRITE_NODE_FIELD(invalItems);
 	WRITE_NODE_FIELD(paramExecTypes);
@@ -2311,6 +2377,7 @@ _outRelOptInfo(StringInfo str, const RelOptInfo *node)
 	WRITE_BOOL_FIELD(consider_partitionwise_join);
 	WRITE_BITMAPSET_FIELD(top_parent_relids);
 	WRITE_BOOL_FIELD(partbounds_merged);
+	WRITE_BITMAPSET_FIELD(live_parts);
 	WRITE_BITMAPSET_FIELD(all_partrels);
 	WRITE_NODE_FIELD(partitioned_child_rels);
 }
@@ -2834,6 +2901,7 @@ _outColumnDef(StringInfo str, const ColumnDef *node)
 
 	WRITE_STRING_FIELD(colname);
 	WRITE_NODE_FIELD(typeName);
+	WRITE_STRING_FIELD(compression);
 	WRITE_INT_FIELD(inhcount);
 	WRITE_BOOL_FIELD(is_local);
 	WRITE_BOOL_FIELD(is_not_null);
@@ -3809,6 +3877,9 @@ outNode(StringInfo str, const void *obj)
 			case T_Material:
 				_outMaterial(str, obj);
 				break;
+			case T_ResultCache:
+				_outResultCache(str, obj);
+				break;
 			case T_Sort:
 				_outSort(str, obj);
 				break;
@@ -3821,6 +3892,9 @@ outNode(StringInfo str, const void *obj)
 			case T_Hash:
 				_outHash(str, obj);
 				break;
+			case T_Repartition:
+				_outRepartition(str, obj);
+				break;
 			case T_SetOp:
 				_outSetOp(str, obj);
 				break;
@@ -4043,6 +4117,9 @@ outNode(StringInfo str, const void *obj)
 			case T_MaterialPath:
 				_outMaterialPath(str, obj);
 				break;
+			case T_ResultCachePath:
+				_outResultCachePath(str, obj);
+				break;
 			case T_UniquePath:
 				_outUniquePath(str, obj);
 				break;
@@ -4094,6 +4171,9 @@ outNode(StringInfo str, const void *obj)
 			case T_GatherMergePath:
 				_outGatherMergePath(str, obj);
 				break;
+			case T_RepartitionPath:
+				_outRepartitionPath(str, obj);
+				break;
 			case T_NestPath:
 				_outNestPath(str, obj);
 				break;
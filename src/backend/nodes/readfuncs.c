@@ -1547,6 +1547,8 @@ _readPlannedStmt(void)
 	READ_NODE_FIELD(subplans);
 	READ_BITMAPSET_FIELD(rewindPlanIDs);
 	READ_NODE_FIELD(rowMarks);
+	READ_NODE_FIELD(partPruneInfos);
+	READ_BITMAPSET_FIELD(prunableRelids);
 	READ_NODE_FIELD(relationOids);
 	READ_NODE_FIELD(invalItems);
 	READ_NODE_FIELD(paramExecTypes);
@@ -1572,6 +1574,7 @@ ReadCommonPlan(Plan *local_node)
 	READ_INT_FIELD(plan_width);
 	READ_BOOL_FIELD(parallel_aware);
 	READ_BOOL_FIELD(parallel_safe);
+	READ_BOOL_FIELD(async_capable);
 	READ_INT_FIELD(plan_node_id);
 	READ_NODE_FIELD(targetlist);
 	READ_NODE_FIELD(qual);
@@ -1670,6 +1673,7 @@ _readAppend(void)
 
 	READ_BITMAPSET_FIELD(apprelids);
 	READ_NODE_FIELD(appendplans);
+	READ_INT_FIELD(nasyncplans);
 	READ_INT_FIELD(first_partial_plan);
 	READ_NODE_FIELD(part_prune_info);
 
@@ -1782,9 +1786,14 @@ _readScan(void)
 static SeqScan *
 _readSeqScan(void)
 {
-	READ_LOCALS_NO_FIELDS(SeqScan);
+	READ_LOCALS(SeqScan);
 
-	ReadCommonScan(local_node);
+	ReadCommonScan(&local_node->scan);
+
+	READ_INT_FIELD(numHashFilterCols);
+	READ_ATTRNUMBER_ARRAY(hashFilterColIdx, local_node->numHashFilterCols);
+	READ_OID_ARRAY(hashFilterOperators, local_node->numHashFilterCols);
+	READ_OID_ARRAY(hashFilterCollations, local_node->numHashFilterCols);
 
 	READ_DONE();
 }
@@ -2150,6 +2159,26 @@ _readMaterial(void)
 	READ_DONE();
 }
 
+/*
+ * _readResultCache
+ */
+static ResultCache *
+_readResultCache(void)
+{
+	READ_LOCALS(ResultCache);
+
+	ReadCommonPlan(&local_node->plan);
+
+	READ_INT_FIELD(numKeys);
+	READ_OID_ARRAY(hashOperators, local_node->numKeys);
+	READ_OID_ARRAY(collations, local_node->numKeys);
+	READ_NODE_FIELD(param_exprs);
+	READ_BOOL_FIELD(singlerow);
+	READ_UINT_FIELD(est_entries);
+
+	READ_DONE();
+}
+
 /*
  * ReadCommonSort
  *	Assign the basic stuff of all nodes that inherit from Sort
@@ -2348,6 +2377,24 @@ _readHash(void)
 	READ_DONE();
 }
 
+/*
+ * _readRepartition
+ */
+static Repartition *
+_readRepartition(void)
+{
+	READ_LOCALS(Repartition);
+
+	ReadCommonPlan(&local_node->plan);
+
+	READ_INT_FIELD(numCols);
+	READ_ATTRNUMBER_ARRAY(partColIdx, local_node->numCols);
+	READ_OID_ARRAY(partOperators, local_node->numCols);
+	READ_OID_ARRAY(partCollations, local_node->numCols);
+
+	READ_DONE();
+}
+
 /*
  * _readSetOp
  */
@@ -2449,6 +2496,7 @@ _readPartitionPruneInfo(void)
 
 	READ_NODE_FIELD(prune_infos);
 	READ_BITMAPSET_FIELD(other_subplans);
+	READ_NODE_FIELD(subplan_rtis);
 
 	READ_DONE();
 }
@@ -2832,6 +2880,8 @@ parseNodeString(void)
 		return_value = _readHashJoin();
 	else if (MATCH("MATERIAL", 8))
 		return_value = _readMaterial();
+	else if (MATCH("RESULTCACHE", 11))
+		return_value = _readResultCache();
 	else if (MATCH("SORT", 4))
 		return_value = _readSort();
 	else if (MATCH("INCREMENTALSORT", 15))
@@ -2850,6 +2900,8 @@ parseNodeString(void)
 		return_value = _readGatherMerge();
 	else if (MATCH("HASH", 4))
 		return_value = _readHash();
+	else if (MATCH("REPARTITION", 11))
+		return_value = _readRepartition();
 	else if (MATCH("SETOP", 5))
 		return_value = _readSetOp();
 	else if (MATCH("LOCKROWS", 8))
@@ -61,6 +61,7 @@ typedef struct pushdown_safety_info
 /* These parameters are set by GUC */
 bool		enable_geqo = false;	/* just in case GUC doesn't set it */
 int			geqo_threshold;
+int			join_search_block_size = 0;
 int			min_parallel_table_scan_size;
 int			min_parallel_index_scan_size;
 
@@ -93,6 +94,8 @@ static void set_foreign_size(PlannerInfo *root, RelOptInfo *rel,
 							 RangeTblEntry *rte);
 static void set_foreign_pathlist(PlannerInfo *root, RelOptInfo *rel,
 								 RangeTblEntry *rte);
+static List *get_append_rel_children(PlannerInfo *root, RelOptInfo *rel,
+									 Index rti);
 static void set_append_rel_size(PlannerInfo *root, RelOptInfo *rel,
 								Index rti, RangeTblEntry *rte);
 static void set_append_rel_pathlist(PlannerInfo *root, RelOptInfo *rel,
@@ -125,6 +128,8 @@ static void set_result_pathlist(PlannerInfo *root, RelOptInfo *rel,
 static void set_worktable_pathlist(PlannerInfo *root, RelOptInfo *rel,
 								   RangeTblEntry *rte);
 static RelOptInfo *make_rel_from_joinlist(PlannerInfo *root, List *joinlist);
+static RelOptInfo *idp_join_search(PlannerInfo *root, int levels_needed,
+								   List *initial_rels);
 static bool subquery_is_pushdown_safe(Query *subquery, Query *topquery,
 									  pushdown_safety_info *safetyInfo);
 static bool recurse_pushdown_safe(Node *setOp, Query *topquery,
@@ -609,16 +614,16 @@ set_rel_consider_parallel(PlannerInfo *root, RelOptInfo *rel,
 		case RTE_RELATION:
 
 			/*
-			 * Currently, parallel workers can't access the leader's temporary
-			 * tables.  We could possibly relax this if we wrote all of its
-			 * local buffers at the start of the query and made no changes
-			 * thereafter (maybe we could allow hint bit changes), and if we
-			 * taught the workers to read them.  Writing a large number of
-			 * temporary buffers could be expensive, though, and we don't have
-			 * the rest of the necessary infrastructure right now anyway.  So
-			 * for now, bail out if we see a temporary table.
+			 * Parallel workers can't access the leader's local buffers, but
+			 * they can read its temporary tables from disk if the leader
+			 * writes out all of its local buffers at the start of the query
+			 * and makes no changes thereafter, not even to hint bits (see
+			 * ShareLocalBuffers).  Writing a large number of temporary
+			 * buffers could be expensive, though, so only do that if
+			 * enable_parallel_temp_scan allows it.
 			 */
-			if (get_rel_persistence(rte->relid) == RELPERSISTENCE_TEMP)
+			if (get_rel_persistence(rte->relid) == RELPERSISTENCE_TEMP &&
+				!enable_parallel_temp_scan)
 				return;
 
 			/*
@@ -931,6 +936,49 @@ set_foreign_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 	rel->fdwroutine->GetForeignPaths(root, rel, rte->relid);
 }
 
+/*
+ * get_append_rel_children
+ *	  Build a list of the AppendRelInfos of the member relations of the
+ *	  appendrel 'rel', whose RT index is 'rti', in the order they were added.
+ *
+ * root->append_rel_list has the children of every appendrel in the query, so
+ * searching it for each appendrel gets slow when there are many partitions.
+ * A partitioned table's children are just its unpruned partitions, which we
+ * can go to directly.
+ */
+static List *
+get_append_rel_children(PlannerInfo *root, RelOptInfo *rel, Index rti)
+{
+	List	   *result = NIL;
+	ListCell   *l;
+
+	if (rel->part_rels != NULL)
+	{
+		int			i = -1;
+
+		while ((i = bms_next_member(rel->live_parts, i)) >= 0)
+		{
+			AppendRelInfo *appinfo;
+
+			appinfo = root->append_rel_array[rel->part_rels[i]->relid];
+			Assert(appinfo->parent_relid == rti);
+			result = lappend(result, appinfo);
+		}
+		return result;
+	}
+
+	foreach(l, root->append_rel_list)
+	{
+		AppendRelInfo *appinfo = (AppendRelInfo *) lfirst(l);
+
+		/* append_rel_list contains all append rels; ignore others */
+		if (appinfo->parent_relid == rti)
+			result = lappend(result, appinfo);
+	}
+
+	return result;
+}
+
 /*
  * set_append_rel_size
  *	  Set size estimates for a simple "append relation"
@@ -952,6 +1000,7 @@ set_append_rel_size(PlannerInfo *root, RelOptInfo *rel,
 	double		parent_size;
 	double	   *parent_attrsizes;
 	int			nattrs;
+	List	   *child_appinfos;
 	ListCell   *l;
 
 	/* Guard against stack overflow due to overly deep inheritance tree. */
@@ -1001,7 +1050,8 @@ set_append_rel_size(PlannerInfo *root, RelOptInfo *rel,
 	nattrs = rel->max_attr - rel->min_attr + 1;
 	parent_attrsizes = (double *) palloc0(nattrs * sizeof(double));
 
-	foreach(l, root->append_rel_list)
+	child_appinfos = get_append_rel_children(root, rel, parentRTindex);
+	foreach(l, child_appinfos)
 	{
 		AppendRelInfo *appinfo = (AppendRelInfo *) lfirst(l);
 		int			childRTindex;
@@ -1010,10 +1060,6 @@ set_append_rel_size(PlannerInfo *root, RelOptInfo *rel,
 		ListCell   *parentvars;
 		ListCell   *childvars;
 
-		/* append_rel_list contains all append rels; ignore others */
-		if (appinfo->parent_relid != parentRTindex)
-			continue;
-
 		childRTindex = appinfo->child_relid;
 		childRTE = root->simple_rte_array[childRTindex];
 
@@ -1227,23 +1273,21 @@ set_append_rel_pathlist(PlannerInfo *root, RelOptInfo *rel,
 {
 	int			parentRTindex = rti;
 	List	   *live_childrels = NIL;
+	List	   *child_appinfos;
 	ListCell   *l;
 
 	/*
 	 * Generate access paths for each member relation, and remember the
 	 * non-dummy children.
 	 */
-	foreach(l, root->append_rel_list)
+	child_appinfos = get_append_rel_children(root, rel, parentRTindex);
+	foreach(l, child_appinfos)
 	{
 		AppendRelInfo *appinfo = (AppendRelInfo *) lfirst(l);
 		int			childRTindex;
 		RangeTblEntry *childRTE;
 		RelOptInfo *childrel;
 
-		/* append_rel_list contains all append rels; ignore others */
-		if (appinfo->parent_relid != parentRTindex)
-			continue;
-
 		/* Re-locate the child RTE and RelOptInfo */
 		childRTindex = appinfo->child_relid;
 		childRTE = root->simple_rte_array[childRTindex];
@@ -3026,6 +3070,9 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 
 		if (join_search_hook)
 			return (*join_search_hook) (root, levels_needed, initial_rels);
+		else if (join_search_block_size > 0 &&
+				 levels_needed > Max(join_search_block_size, 2))
+			return idp_join_search(root, levels_needed, initial_rels);
 		else if (enable_geqo && levels_needed >= geqo_threshold)
 			return geqo(root, levels_needed, initial_rels);
 		else
@@ -3147,6 +3194,157 @@ standard_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
 	return rel;
 }
 
+/*
+ * idp_join_search
+ *	  Find a join order for many jointree items by iterative dynamic
+ *	  programming.
+ *
+ * The exhaustive search of standard_join_search gets impractical beyond a
+ * dozen or so jointree items.  This implements the IDP1 algorithm of
+ * Kossmann and Stocker: we run the dynamic-programming search only up to
+ * join_search_block_size items, commit to the cheapest join rel built at
+ * the highest level reached, and search again with that rel standing in for
+ * the items it joins, until all remaining items fit into one block.  Unlike
+ * GEQO, this is deterministic, and it still finds the best plan for each
+ * block.
+ *
+ * Join rels of one round that don't include any of the items joined by the
+ * rel chosen in it are built from items that are still there in the next
+ * round, so they are carried over with their paths, and the next round only
+ * makes joins that include the newly chosen rel.
+ *
+ * Join order restrictions might make it impossible to complete the rels
+ * chosen earlier; if a round can't make any join at all, we forget what we
+ * have done and fall back to standard_join_search.
+ */
+static RelOptInfo *
+idp_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
+{
+	int			block_size = Max(join_search_block_size, 2);
+	int			savelength = list_length(root->join_rel_list);
+	struct HTAB *savehash = root->join_rel_hash;
+	List	   *items = initial_rels;
+	List	  **prev_levels = NULL;
+	int			prev_top = 0;
+	RelOptInfo *chosen = NULL;
+	RelOptInfo *rel;
+
+	Assert(root->join_rel_level == NULL);
+
+	/*
+	 * If we have to fall back, we'll drop the join rels made here; have them
+	 * entered into a fresh hash table meanwhile, as geqo_eval() does.  If we
+	 * succeed, that table will be rebuilt from the whole list as needed.
+	 */
+	root->join_rel_hash = NULL;
+
+	for (;;)
+	{
+		int			nitems = list_length(items);
+		int			top = Min(nitems, block_size);
+		List	  **levels;
+		int			lev;
+		int			best_level;
+		ListCell   *lc;
+
+		levels = (List **) palloc0((top + 1) * sizeof(List *));
+		levels[1] = items;
+		root->join_rel_level = levels;
+		root->initial_rels = items;
+
+		for (lev = 2; lev <= top; lev++)
+		{
+			List	   *reused = NIL;
+
+			if (chosen != NULL && lev <= prev_top)
+			{
+				foreach(lc, prev_levels[lev])
+				{
+					rel = (RelOptInfo *) lfirst(lc);
+					if (!bms_overlap(rel->relids, chosen->relids))
+						reused = lappend(reused, rel);
+				}
+			}
+
+			join_search_one_level_reusing(root, lev,
+										  chosen ? chosen->relids : NULL,
+										  reused != NIL);
+
+			/* see standard_join_search */
+			foreach(lc, levels[lev])
+			{
+				rel = (RelOptInfo *) lfirst(lc);
+
+				generate_partitionwise_join_paths(root, rel);
+				if (nitems > block_size || lev < top)
+					generate_useful_gather_paths(root, rel, false);
+				set_cheapest(rel);
+
+#ifdef OPTIMIZER_DEBUG
+				debug_print_rel(root, rel);
+#endif
+			}
+
+			levels[lev] = list_concat(levels[lev], reused);
+		}
+
+		if (nitems <= block_size)
+		{
+			/* That was the last round; we should have a single rel */
+			if (levels[top] != NIL)
+			{
+				Assert(list_length(levels[top]) == 1);
+				rel = (RelOptInfo *) linitial(levels[top]);
+				root->join_rel_level = NULL;
+				root->initial_rels = initial_rels;
+				return rel;
+			}
+			break;
+		}
+
+		/* Choose the cheapest rel of the highest level we got to */
+		for (best_level = top; best_level > 1; best_level--)
+		{
+			if (levels[best_level] != NIL)
+				break;
+		}
+		if (best_level == 1)
+			break;
+
+		chosen = NULL;
+		foreach(lc, levels[best_level])
+		{
+			rel = (RelOptInfo *) lfirst(lc);
+
+			if (chosen == NULL ||
+				compare_path_costs(rel->cheapest_total_path,
+								   chosen->cheapest_total_path,
+								   TOTAL_COST) < 0)
+				chosen = rel;
+		}
+
+		/* Replace the items it joins with it */
+		items = list_make1(chosen);
+		foreach(lc, levels[1])
+		{
+			rel = (RelOptInfo *) lfirst(lc);
+			if (!bms_overlap(rel->relids, chosen->relids))
+				items = lappend(items, rel);
+		}
+
+		prev_levels = levels;
+		prev_top = top;
+	}
+
+	/* Failed; forget the join rels made here and do it the standard way */
+	root->join_rel_list = list_truncate(root->join_rel_list, savelength);
+	root->join_rel_hash = savehash;
+	root->join_rel_level = NULL;
+	root->initial_rels = initial_rels;
+
+	return standard_join_search(root, levels_needed, initial_rels);
+}
+
 /*****************************************************************************
  *			PUSHING QUALS DOWN INTO SUBQUERIES
  *****************************************************************************/
@@ -3916,8 +4114,6 @@ generate_partitionwise_join_paths(PlannerInfo *root, RelOptInfo *rel)
 {
 	List	   *live_children = NIL;
 	int			cnt_parts;
-	int			num_parts;
-	RelOptInfo **part_rels;
 
 	/* Handle only join relations here. */
 	if (!IS_JOIN_REL(rel))
@@ -3933,17 +4129,11 @@ generate_partitionwise_join_paths(PlannerInfo *root, RelOptInfo *rel)
 	/* Guard against stack overflow due to overly deep partition hierarchy. */
 	check_stack_depth();
 
-	num_parts = rel->nparts;
-	part_rels = rel->part_rels;
-
 	/* Collect non-dummy child-joins. */
-	for (cnt_parts = 0; cnt_parts < num_parts; cnt_parts++)
+	cnt_parts = -1;
+	while ((cnt_parts = bms_next_member(rel->live_parts, cnt_parts)) >= 0)
 	{
-		RelOptInfo *child_rel = part_rels[cnt_parts];
-
-		/* If it's been pruned entirely, it's certainly dummy. */
-		if (child_rel == NULL)
-			continue;
+		RelOptInfo *child_rel = rel->part_rels[cnt_parts];
 
 		/* Add partitionwise join paths for partitioned child-joins. */
 		generate_partitionwise_join_paths(root, child_rel);
@@ -4109,6 +4299,10 @@ print_path(PlannerInfo *root, Path *path, int indent)
 			ptype = "Material";
 			subpath = ((MaterialPath *) path)->subpath;
 			break;
+		case T_ResultCachePath:
+			ptype = "ResultCache";
+			subpath = ((ResultCachePath *) path)->subpath;
+			break;
 		case T_UniquePath:
 			ptype = "Unique";
 			subpath = ((UniquePath *) path)->subpath;
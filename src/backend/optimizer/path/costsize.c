@@ -79,6 +79,7 @@
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
 #include "executor/nodeHash.h"
+#include "executor/nodeResultCache.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
@@ -132,14 +133,24 @@ bool		enable_incremental_sort = true;
 bool		enable_hashagg = true;
 bool		enable_nestloop = true;
 bool		enable_material = true;
+bool		enable_resultcache = true;
 bool		enable_mergejoin = true;
 bool		enable_hashjoin = true;
+bool		enable_hashjoin_bloom_filter = true;
 bool		enable_gathermerge = true;
 bool		enable_partitionwise_join = false;
 bool		enable_partitionwise_aggregate = false;
 bool		enable_parallel_append = true;
 bool		enable_parallel_hash = true;
+bool		enable_parallel_hashagg = false;
+bool		enable_parallel_insert = false;
+bool		enable_parallel_material = false;
+bool		enable_parallel_nonpartial_agg = false;
+bool		enable_parallel_sort = false;
+bool		enable_parallel_temp_scan = false;
+bool		enable_parallel_window = false;
 bool		enable_partition_pruning = true;
+bool		enable_async_append = true;
 
 typedef struct
 {
@@ -1864,7 +1875,8 @@ cost_incremental_sort(Path *path,
 
 	/* Estimate number of groups with equal presorted keys. */
 	if (!unknown_varno)
-		input_groups = estimate_num_groups(root, presortedExprs, input_tuples, NULL);
+		input_groups = estimate_num_groups(root, presortedExprs, input_tuples,
+										   NULL, NULL);
 
 	group_tuples = input_tuples / input_groups;
 	group_input_run_cost = input_run_cost / input_groups;
@@ -1948,6 +1960,54 @@ cost_sort(Path *path, PlannerInfo *root,
 	path->total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_parallel_sort
+ *	  Determines and returns the cost of a Parallel Sort, including the cost
+ *	  of reading the input data.
+ *
+ * 'tuples' is the number of tuples each participant sorts.  Each participant
+ * sorts its tuples as for cost_sort and writes them out as a single run, and
+ * then one participant merges the runs of all of them, reading them back in.
+ * path->parallel_workers must already be set.
+ */
+void
+cost_parallel_sort(Path *path, PlannerInfo *root,
+				   List *pathkeys, Cost input_cost, double tuples, int width,
+				   Cost comparison_cost, int sort_mem)
+{
+	Cost		startup_cost;
+	Cost		run_cost;
+	double		nparticipants = path->parallel_workers + 1;
+	double		total_tuples = tuples * get_parallel_divisor(path);
+
+	cost_tuplesort(&startup_cost, &run_cost,
+				   tuples, width,
+				   comparison_cost, sort_mem,
+				   -1.0);
+
+	/* write out the run */
+	startup_cost += seq_page_cost * page_size(tuples, width);
+
+	/*
+	 * The merge reads all the runs back, and keeps a heap of the next tuple
+	 * of each, much like cost_gather_merge.
+	 */
+	comparison_cost += 2.0 * cpu_operator_cost;
+	startup_cost += comparison_cost * nparticipants * LOG2(nparticipants);
+	run_cost = seq_page_cost * page_size(total_tuples, width);
+	run_cost += comparison_cost * total_tuples * LOG2(nparticipants);
+	run_cost += cpu_operator_cost * total_tuples;
+
+	if (!enable_sort)
+		startup_cost += disable_cost;
+
+	startup_cost += input_cost;
+
+	path->rows = tuples;
+	path->startup_cost = startup_cost;
+	path->total_cost = startup_cost + run_cost;
+}
+
 /*
  * append_nonpartial_cost
  *	  Estimate the cost of the non-partial paths in a Parallel Append.
@@ -2240,6 +2300,40 @@ cost_merge_append(Path *path, PlannerInfo *root,
 	path->total_cost = startup_cost + run_cost + input_total_cost;
 }
 
+/*
+ * cost_repartition
+ *	  Determines and returns the cost of redistributing the rows of a partial
+ *	  path among the participants of a parallel query.
+ *
+ * 'tuples' and 'width' describe the rows of one participant.  All of them are
+ * hashed and written to shared temporary files before the first row can be
+ * returned, and each row is read back by one of the participants; we assume
+ * each participant ends up reading about as many rows as it wrote.
+ */
+void
+cost_repartition(Path *path, int numCols,
+				 Cost input_startup_cost, Cost input_total_cost,
+				 double tuples, int width)
+{
+	Cost		startup_cost = input_total_cost;
+	Cost		run_cost = 0;
+	double		npages = page_size(tuples, width);
+
+	path->rows = tuples;
+
+	/* hash the partition key columns and write out every row */
+	startup_cost += cpu_operator_cost * numCols * tuples;
+	startup_cost += cpu_tuple_cost * tuples;
+	startup_cost += seq_page_cost * npages;
+
+	/* read the rows of the claimed partitions back */
+	run_cost += cpu_tuple_cost * tuples;
+	run_cost += seq_page_cost * npages;
+
+	path->startup_cost = startup_cost;
+	path->total_cost = startup_cost + run_cost;
+}
+
 /*
  * cost_material
  *	  Determines and returns the cost of materializing a relation, including
@@ -2295,6 +2389,40 @@ cost_material(Path *path,
 	path->total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_parallel_material
+ *	  Determines and returns the cost of a Parallel Materialize, including
+ *	  the cost of reading the input data.
+ *
+ * 'tuples' is the number of tuples each participant gets from its share of
+ * the partial input and writes out to the shared temporary files, before
+ * any of them can return a row.  Each participant then reads back all the
+ * tuples written by all of them, so that's what path->rows is set to.
+ * path->parallel_workers must already be set.
+ */
+void
+cost_parallel_material(Path *path, Cost input_cost, double tuples, int width)
+{
+	Cost		startup_cost = input_cost;
+	Cost		run_cost;
+	double		total_tuples = tuples * get_parallel_divisor(path);
+
+	/* write out our share */
+	startup_cost += cpu_operator_cost * tuples;
+	startup_cost += seq_page_cost * page_size(tuples, width);
+
+	/*
+	 * Read back everything, with the same bookkeeping charge per tuple as
+	 * cost_material.  The rows always come from the files.
+	 */
+	run_cost = 2 * cpu_operator_cost * total_tuples;
+	run_cost += seq_page_cost * page_size(total_tuples, width);
+
+	path->rows = total_tuples;
+	path->startup_cost = startup_cost;
+	path->total_cost = startup_cost + run_cost;
+}
+
 /*
  * cost_agg
  *		Determines and returns the cost of performing an Agg plan node,
@@ -3305,6 +3433,13 @@ final_cost_mergejoin(PlannerInfo *root, MergePath *path,
 	if (path->skip_mark_restore)
 		path->materialize_inner = false;
 
+	/*
+	 * A Parallel Materialize supports mark/restore itself, and already reads
+	 * the rows from a file; another Material on top would just copy them.
+	 */
+	else if (IsA(inner_path, MaterialPath) && inner_path->parallel_aware)
+		path->materialize_inner = false;
+
 	/*
 	 * Prefer materializing if it looks cheaper, unless the user has asked to
 	 * suppress materialization.
@@ -3918,6 +4053,148 @@ cost_subplan(PlannerInfo *root, SubPlan *subplan, Plan *plan)
 }
 
 
+/*
+ * cost_resultcache_rescan
+ *	  Determines the estimated cost of rescanning a ResultCache node.
+ *
+ * In order to estimate this, we must gain knowledge of how often we expect to
+ * be called and how many distinct sets of parameters we are likely to be
+ * called with.  If we expect a good cache hit ratio, then we can set our
+ * costs to account for that hit ratio, plus a little bit of cost for the
+ * caching itself.  Caching will not work out well if we expect to be called
+ * with too many distinct parameter values.  The worst-case here is that we
+ * never see any parameter value twice, in which case we'd never get a cache
+ * hit and caching would be a complete waste of effort.
+ */
+static void
+cost_resultcache_rescan(PlannerInfo *root, ResultCachePath *rcpath,
+						Cost *rescan_startup_cost, Cost *rescan_total_cost)
+{
+	Cost		input_startup_cost = rcpath->subpath->startup_cost;
+	Cost		input_total_cost = rcpath->subpath->total_cost;
+	double		tuples = rcpath->subpath->rows;
+	double		calls = rcpath->calls;
+	int			width = rcpath->subpath->pathtarget->width;
+
+	EstimationInfo estinfo;
+	double		hash_mem_bytes;
+	double		est_entry_bytes;
+	double		est_cache_entries;
+	double		ndistinct;
+	double		evict_ratio;
+	double		hit_ratio;
+	Cost		startup_cost;
+	Cost		total_cost;
+
+	/* available cache space */
+	hash_mem_bytes = get_hash_mem() * 1024L;
+
+	/*
+	 * Set the number of bytes each cache entry should consume in the cache.
+	 * To provide us with better estimations on how many cache entries we can
+	 * store at once, we make a call to the executor here to ask it what
+	 * memory overheads there are for a single cache entry.
+	 *
+	 * XXX we also store the cache key, but that's not accounted for here.
+	 */
+	est_entry_bytes = relation_byte_size(tuples, width) +
+		ExecEstimateCacheEntryOverheadBytes(tuples);
+
+	/* estimate on the upper limit of cache entries we can hold at once */
+	est_cache_entries = floor(hash_mem_bytes / est_entry_bytes);
+
+	/* estimate on the distinct number of parameter values */
+	ndistinct = estimate_num_groups(root, rcpath->param_exprs, calls, NULL,
+									&estinfo);
+
+	/*
+	 * When the estimation fell back on using a default value, it's a bit too
+	 * risky to assume that it's ok to use a Result Cache.  The use of a
+	 * default could cause us to use a Result Cache when it's really
+	 * inappropriate to do so.  If we see that this has been done, then we'll
+	 * assume that every call will have unique parameters, which will almost
+	 * certainly mean a ResultCachePath will never survive add_path().
+	 */
+	if ((estinfo.flags & SELFLAG_USED_DEFAULT) != 0)
+		ndistinct = calls;
+
+	/*
+	 * Since we've already estimated the maximum number of entries we can
+	 * store at once and know the estimated number of distinct values we'll
+	 * be called with, we'll take this opportunity to set the path's
+	 * est_entries.  This will ultimately determine the hash table size that
+	 * the executor will use.  If we leave this at zero, the executor will
+	 * just choose the size itself.  Really this is not the right place to do
+	 * this, but it's convenient since everything is already calculated.
+	 */
+	rcpath->est_entries = Min(Min(ndistinct, est_cache_entries),
+							  PG_UINT32_MAX);
+
+	/*
+	 * When the number of distinct parameter values is above the amount we
+	 * can store in the cache, then we'll have to evict some entries from the
+	 * cache.  This is not free. Here we estimate how often we'll incur the
+	 * cost of that eviction.
+	 */
+	evict_ratio = 1.0 - Min(est_cache_entries, ndistinct) / ndistinct;
+
+	/*
+	 * In order to estimate how costly a single scan will be, we need to
+	 * attempt to estimate what the cache hit ratio will be.  To do that we
+	 * must look at how many scans are estimated in total for this node and
+	 * how many of those scans we expect to get a cache hit.  The first scan
+	 * for each distinct parameter value is always a miss, and of the
+	 * repeats, only those whose entry is still in the cache can be hits.
+	 */
+	hit_ratio = ((calls - ndistinct) / calls) *
+		(Min(est_cache_entries, ndistinct) / ndistinct);
+
+	Assert(hit_ratio >= 0 && hit_ratio <= 1.0);
+
+	/*
+	 * Set the total_cost accounting for the expected cache hit ratio.  We
+	 * also add on a cpu_operator_cost to account for a cache lookup. This
+	 * will happen regardless of whether it's a cache hit or not.
+	 */
+	total_cost = input_total_cost * (1.0 - hit_ratio) + cpu_operator_cost;
+
+	/* Now adjust the total cost to account for cache evictions */
+
+	/* Charge a cpu_tuple_cost for evicting the actual cache entry */
+	total_cost += cpu_tuple_cost * evict_ratio;
+
+	/*
+	 * Charge a 10th of cpu_operator_cost to evict every tuple in that entry.
+	 * The per-tuple eviction is really just a pfree, so charging a whole
+	 * cpu_operator_cost seems a little excessive.
+	 */
+	total_cost += cpu_operator_cost / 10.0 * evict_ratio * tuples;
+
+	/*
+	 * Now adjust for storing things in the cache, since that's not free
+	 * either.  Everything must go in the cache.  We don't proportion this
+	 * over any ratio, just apply it once for the scan.  We charge a
+	 * cpu_tuple_cost for the creation of the cache entry and also a
+	 * cpu_operator_cost for each tuple we expect to cache.
+	 */
+	total_cost += cpu_tuple_cost + cpu_operator_cost * tuples;
+
+	/*
+	 * Getting the first row must be also be proportioned according to the
+	 * expected cache hit ratio.
+	 */
+	startup_cost = input_startup_cost * (1.0 - hit_ratio);
+
+	/*
+	 * Additionally we charge a cpu_tuple_cost to account for cache lookups,
+	 * which we'll do regardless of whether it was a cache hit or not.
+	 */
+	startup_cost += cpu_tuple_cost;
+
+	*rescan_startup_cost = startup_cost;
+	*rescan_total_cost = total_cost;
+}
+
 /*
  * cost_rescan
  *		Given a finished Path, estimate the costs of rescanning it after
@@ -4011,7 +4288,9 @@ cost_rescan(PlannerInfo *root, Path *path,
 														path->pathtarget->width);
 				long		work_mem_bytes = work_mem * 1024L;
 
-				if (nbytes > work_mem_bytes)
+				/* A Parallel Materialize always rereads its files */
+				if (nbytes > work_mem_bytes ||
+					(path->pathtype == T_Material && path->parallel_aware))
 				{
 					/* It will spill, so account for re-read cost */
 					double		npages = ceil(nbytes / BLCKSZ);
@@ -4022,6 +4301,11 @@ cost_rescan(PlannerInfo *root, Path *path,
 				*rescan_total_cost = run_cost;
 			}
 			break;
+		case T_ResultCache:
+			/* All the hard work is done by cost_resultcache_rescan */
+			cost_resultcache_rescan(root, (ResultCachePath *) path,
+									rescan_startup_cost, rescan_total_cost);
+			break;
 		default:
 			*rescan_startup_cost = path->startup_cost;
 			*rescan_total_cost = path->total_cost;
@@ -26,10 +26,12 @@
 static void make_rels_by_clause_joins(PlannerInfo *root,
 									  RelOptInfo *old_rel,
 									  List *other_rels_list,
-									  ListCell *other_rels);
+									  ListCell *other_rels,
+									  Relids new_relids);
 static void make_rels_by_clauseless_joins(PlannerInfo *root,
 										  RelOptInfo *old_rel,
-										  List *other_rels);
+										  List *other_rels,
+										  Relids new_relids);
 static bool has_join_restriction(PlannerInfo *root, RelOptInfo *rel);
 static bool has_legal_joinclause(PlannerInfo *root, RelOptInfo *rel);
 static bool restriction_is_constant_false(List *restrictlist,
@@ -69,6 +71,25 @@ static void get_matching_part_pairs(PlannerInfo *root, RelOptInfo *joinrel,
  */
 void
 join_search_one_level(PlannerInfo *root, int level)
+{
+	join_search_one_level_reusing(root, level, NULL, false);
+}
+
+/*
+ * join_search_one_level_reusing
+ *	  Like join_search_one_level, but for a search that reuses join rels
+ *	  from an earlier search over a subset of the jointree items.
+ *
+ * If new_relids isn't NULL, root->join_rel_level[j] may contain such
+ * reused rels, which don't include new_relids and already have all their
+ * paths; then only joins that include new_relids are made.  have_reused
+ * says whether the caller will add reused rels to the result, which makes
+ * it unnecessary to force cartesian-product joins if no other join can be
+ * made.
+ */
+void
+join_search_one_level_reusing(PlannerInfo *root, int level,
+							  Relids new_relids, bool have_reused)
 {
 	List	  **joinrels = root->join_rel_level;
 	ListCell   *r;
@@ -123,7 +144,8 @@ join_search_one_level(PlannerInfo *root, int level)
 			make_rels_by_clause_joins(root,
 									  old_rel,
 									  other_rels_list,
-									  other_rels);
+									  other_rels,
+									  new_relids);
 		}
 		else
 		{
@@ -141,7 +163,8 @@ join_search_one_level(PlannerInfo *root, int level)
 			 */
 			make_rels_by_clauseless_joins(root,
 										  old_rel,
-										  joinrels[1]);
+										  joinrels[1],
+										  new_relids);
 		}
 	}
 
@@ -196,6 +219,12 @@ join_search_one_level(PlannerInfo *root, int level)
 			{
 				RelOptInfo *new_rel = (RelOptInfo *) lfirst(r2);
 
+				/* two reused rels were considered in the earlier search */
+				if (new_relids &&
+					!bms_overlap(old_rel->relids, new_relids) &&
+					!bms_overlap(new_rel->relids, new_relids))
+					continue;
+
 				if (!bms_overlap(old_rel->relids, new_rel->relids))
 				{
 					/*
@@ -232,7 +261,7 @@ join_search_one_level(PlannerInfo *root, int level)
 	 * cartesian joins in this case (no bushy).
 	 *----------
 	 */
-	if (joinrels[level] == NIL)
+	if (joinrels[level] == NIL && !have_reused)
 	{
 		/*
 		 * This loop is just like the first one, except we always call
@@ -244,7 +273,8 @@ join_search_one_level(PlannerInfo *root, int level)
 
 			make_rels_by_clauseless_joins(root,
 										  old_rel,
-										  joinrels[1]);
+										  joinrels[1],
+										  new_relids);
 		}
 
 		/*----------
@@ -289,6 +319,7 @@ join_search_one_level(PlannerInfo *root, int level)
  * 'other_rels_list': a list containing the other
  * rels to be considered for joining
  * 'other_rels': the first cell to be considered
+ * 'new_relids': if not NULL, only joins including these are made
  *
  * Currently, this is only used with initial rels in other_rels, but it
  * will work for joining to joinrels too.
@@ -297,14 +328,20 @@ static void
 make_rels_by_clause_joins(PlannerInfo *root,
 						  RelOptInfo *old_rel,
 						  List *other_rels_list,
-						  ListCell *other_rels)
+						  ListCell *other_rels,
+						  Relids new_relids)
 {
+	bool		old_is_new = (new_relids == NULL ||
+							  bms_overlap(old_rel->relids, new_relids));
 	ListCell   *l;
 
 	for_each_cell(l, other_rels_list, other_rels)
 	{
 		RelOptInfo *other_rel = (RelOptInfo *) lfirst(l);
 
+		if (!old_is_new && !bms_overlap(other_rel->relids, new_relids))
+			continue;
+
 		if (!bms_overlap(old_rel->relids, other_rel->relids) &&
 			(have_relevant_joinclause(root, old_rel, other_rel) ||
 			 have_join_order_restriction(root, old_rel, other_rel)))
@@ -323,6 +360,7 @@ make_rels_by_clause_joins(PlannerInfo *root,
  *
  * 'old_rel' is the relation entry for the relation to be joined
  * 'other_rels': a list containing the other rels to be considered for joining
+ * 'new_relids': if not NULL, only joins including these are made
  *
  * Currently, this is only used with initial rels in other_rels, but it would
  * work for joining to joinrels too.
@@ -330,14 +368,20 @@ make_rels_by_clause_joins(PlannerInfo *root,
 static void
 make_rels_by_clauseless_joins(PlannerInfo *root,
 							  RelOptInfo *old_rel,
-							  List *other_rels)
+							  List *other_rels,
+							  Relids new_relids)
 {
+	bool		old_is_new = (new_relids == NULL ||
+							  bms_overlap(old_rel->relids, new_relids));
 	ListCell   *l;
 
 	foreach(l, other_rels)
 	{
 		RelOptInfo *other_rel = (RelOptInfo *) lfirst(l);
 
+		if (!old_is_new && !bms_overlap(other_rel->relids, new_relids))
+			continue;
+
 		if (!bms_overlap(other_rel->relids, old_rel->relids))
 		{
 			(void) make_join_rel(root, old_rel, other_rel);
@@ -1539,6 +1583,8 @@ try_partitionwise_join(PlannerInfo *root, RelOptInfo *rel1, RelOptInfo *rel2,
 												 child_sjinfo,
 												 child_sjinfo->jointype);
 			joinrel->part_rels[cnt_parts] = child_joinrel;
+			joinrel->live_parts = bms_add_member(joinrel->live_parts,
+												 cnt_parts);
 			joinrel->all_partrels = bms_add_members(joinrel->all_partrels,
 													child_joinrel->relids);
 		}
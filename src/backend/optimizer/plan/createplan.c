@@ -70,6 +70,9 @@
 #define CP_LABEL_TLIST		0x0004	/* tlist must contain sortgrouprefs */
 #define CP_IGNORE_TLIST		0x0008	/* caller will replace tlist */
 
+/* Fewest inner rows for which a hash join pushes down a bloom filter */
+#define HASH_FILTER_MIN_INNER_ROWS	1000
+
 
 static Plan *create_plan_recurse(PlannerInfo *root, Path *best_path,
 								 int flags);
@@ -81,6 +84,7 @@ static List *get_gating_quals(PlannerInfo *root, List *quals);
 static Plan *create_gating_plan(PlannerInfo *root, Path *path, Plan *plan,
 								List *gating_quals);
 static Plan *create_join_plan(PlannerInfo *root, JoinPath *best_path);
+static bool mark_async_capable_plan(Plan *plan, Path *path);
 static Plan *create_append_plan(PlannerInfo *root, AppendPath *best_path,
 								int flags);
 static Plan *create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_path,
@@ -90,6 +94,9 @@ static Result *create_group_result_plan(PlannerInfo *root,
 static ProjectSet *create_project_set_plan(PlannerInfo *root, ProjectSetPath *best_path);
 static Material *create_material_plan(PlannerInfo *root, MaterialPath *best_path,
 									  int flags);
+static ResultCache *create_resultcache_plan(PlannerInfo *root,
+											ResultCachePath *best_path,
+											int flags);
 static Plan *create_unique_plan(PlannerInfo *root, UniquePath *best_path,
 								int flags);
 static Gather *create_gather_plan(PlannerInfo *root, GatherPath *best_path);
@@ -154,6 +161,9 @@ static CustomScan *create_customscan_plan(PlannerInfo *root,
 static NestLoop *create_nestloop_plan(PlannerInfo *root, NestPath *best_path);
 static MergeJoin *create_mergejoin_plan(PlannerInfo *root, MergePath *best_path);
 static HashJoin *create_hashjoin_plan(PlannerInfo *root, HashPath *best_path);
+static void push_hash_filter_to_outer_scan(HashPath *best_path,
+										   Plan *outer_plan,
+										   List *hashclauses);
 static Node *replace_nestloop_params(PlannerInfo *root, Node *expr);
 static Node *replace_nestloop_params_mutator(Node *node, PlannerInfo *root);
 static void fix_indexqual_references(PlannerInfo *root, IndexPath *index_path,
@@ -270,6 +280,11 @@ static Sort *make_sort_from_groupcols(List *groupcls,
 									  AttrNumber *grpColIdx,
 									  Plan *lefttree);
 static Material *make_material(Plan *lefttree);
+static ResultCache *make_resultcache(Plan *lefttree, Oid *hashoperators,
+									 Oid *collations,
+									 List *param_exprs,
+									 bool singlerow,
+									 uint32 est_entries);
 static WindowAgg *make_windowagg(List *tlist, Index winref,
 								 int partNumCols, AttrNumber *partColIdx, Oid *partOperators, Oid *partCollations,
 								 int ordNumCols, AttrNumber *ordColIdx, Oid *ordOperators, Oid *ordCollations,
@@ -300,6 +315,9 @@ static ModifyTable *make_modifytable(PlannerInfo *root,
 									 List *rowMarks, OnConflictExpr *onconflict, int epqParam);
 static GatherMerge *create_gather_merge_plan(PlannerInfo *root,
 											 GatherMergePath *best_path);
+static Repartition *create_repartition_plan(PlannerInfo *root,
+											RepartitionPath *best_path,
+											int flags);
 
 
 /*
@@ -337,9 +355,10 @@ create_plan(PlannerInfo *root, Path *best_path)
 	 * column names and other decorative info.  Targetlists generated within
 	 * the planner don't bother with that stuff, but we must have it on the
 	 * top-level tlist seen at execution time.  However, ModifyTable plan
-	 * nodes don't have a tlist matching the querytree targetlist.
+	 * nodes, and a Gather above a ModifyTable that the workers run, don't
+	 * have a tlist matching the querytree targetlist.
 	 */
-	if (!IsA(plan, ModifyTable))
+	if (root->parse->commandType == CMD_SELECT)
 		apply_tlist_labeling(plan->targetlist, root->processed_tlist);
 
 	/*
@@ -444,6 +463,11 @@ create_plan_recurse(PlannerInfo *root, Path *best_path, int flags)
 												 (MaterialPath *) best_path,
 												 flags);
 			break;
+		case T_ResultCache:
+			plan = (Plan *) create_resultcache_plan(root,
+													(ResultCachePath *) best_path,
+													flags);
+			break;
 		case T_Unique:
 			if (IsA(best_path, UpperUniquePath))
 			{
@@ -519,6 +543,11 @@ create_plan_recurse(PlannerInfo *root, Path *best_path, int flags)
 			plan = (Plan *) create_gather_merge_plan(root,
 													 (GatherMergePath *) best_path);
 			break;
+		case T_Repartition:
+			plan = (Plan *) create_repartition_plan(root,
+													(RepartitionPath *) best_path,
+													flags);
+			break;
 		default:
 			elog(ERROR, "unrecognized node type: %d",
 				 (int) best_path->pathtype);
@@ -1066,6 +1095,43 @@ create_join_plan(PlannerInfo *root, JoinPath *best_path)
 	return plan;
 }
 
+/*
+ * mark_async_capable_plan
+ *		Check whether the Plan node created from a Path node is async-capable,
+ *		and if so, mark the Plan node as such and return true, otherwise
+ *		return false.
+ */
+static bool
+mark_async_capable_plan(Plan *plan, Path *path)
+{
+	switch (nodeTag(path))
+	{
+		case T_ForeignPath:
+			{
+				FdwRoutine *fdwroutine = path->parent->fdwroutine;
+
+				/*
+				 * If the generated plan node includes a gating Result node,
+				 * we can't execute it asynchronously.
+				 */
+				if (IsA(plan, Result))
+					return false;
+
+				Assert(fdwroutine != NULL);
+				if (fdwroutine->IsForeignPathAsyncCapable != NULL &&
+					fdwroutine->IsForeignPathAsyncCapable((ForeignPath *) path))
+					break;
+				return false;
+			}
+		default:
+			return false;
+	}
+
+	plan->async_capable = true;
+
+	return true;
+}
+
 /*
  * create_append_plan
  *	  Create an Append plan for 'best_path' and (recursively) plans
@@ -1090,6 +1156,8 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path, int flags)
 	Oid		   *nodeSortOperators = NULL;
 	Oid		   *nodeCollations = NULL;
 	bool	   *nodeNullsFirst = NULL;
+	int			nasyncplans = 0;
+	bool		consider_async = false;
 
 	/*
 	 * The subpaths list could be empty, if every child was proven empty by
@@ -1153,6 +1221,11 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path, int flags)
 		tlist_was_changed = (orig_tlist_length != list_length(plan->plan.targetlist));
 	}
 
+	/* If appropriate, consider async append */
+	consider_async = (enable_async_append && pathkeys == NIL &&
+					  !best_path->path.parallel_safe &&
+					  list_length(best_path->subpaths) > 1);
+
 	/* Build the plan for each child */
 	foreach(subpaths, best_path->subpaths)
 	{
@@ -1219,6 +1292,13 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path, int flags)
 			}
 		}
 
+		/* If needed, check to see if subplan can be executed asynchronously */
+		if (consider_async && mark_async_capable_plan(subplan, subpath))
+		{
+			Assert(subplan->async_capable);
+			++nasyncplans;
+		}
+
 		subplans = lappend(subplans, subplan);
 	}
 
@@ -1255,6 +1335,7 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path, int flags)
 	}
 
 	plan->appendplans = subplans;
+	plan->nasyncplans = nasyncplans;
 	plan->first_partial_plan = best_path->first_partial_path;
 	plan->part_prune_info = partpruneinfo;
 
@@ -1516,6 +1597,60 @@ create_material_plan(PlannerInfo *root, MaterialPath *best_path, int flags)
 	return plan;
 }
 
+/*
+ * create_resultcache_plan
+ *	  Create a ResultCache plan for 'best_path' and (recursively) plans
+ *	  for its subpaths.
+ *
+ *	  Returns a Plan node.
+ */
+static ResultCache *
+create_resultcache_plan(PlannerInfo *root, ResultCachePath *best_path, int flags)
+{
+	ResultCache *plan;
+	Plan	   *subplan;
+	Oid		   *operators;
+	Oid		   *collations;
+	List	   *param_exprs = NIL;
+	ListCell   *lc;
+	ListCell   *lc2;
+	int			nkeys;
+	int			i;
+
+	/*
+	 * As with Material, we don't want any excess columns in the cached
+	 * tuples.
+	 */
+	subplan = create_plan_recurse(root, best_path->subpath,
+								  flags | CP_SMALL_TLIST);
+
+	param_exprs = (List *) replace_nestloop_params(root, (Node *)
+												   best_path->param_exprs);
+
+	nkeys = list_length(param_exprs);
+	Assert(nkeys > 0);
+	operators = palloc(nkeys * sizeof(Oid));
+	collations = palloc(nkeys * sizeof(Oid));
+
+	i = 0;
+	forboth(lc, param_exprs, lc2, best_path->hash_operators)
+	{
+		Expr	   *param_expr = (Expr *) lfirst(lc);
+		Oid			opno = lfirst_oid(lc2);
+
+		operators[i] = opno;
+		collations[i] = exprCollation((Node *) param_expr);
+		i++;
+	}
+
+	plan = make_resultcache(subplan, operators, collations, param_exprs,
+							best_path->singlerow, best_path->est_entries);
+
+	copy_generic_path_info(&plan->plan, (Path *) best_path);
+
+	return plan;
+}
+
 /*
  * create_unique_plan
  *	  Create a Unique plan for 'best_path' and (recursively) plans
@@ -1812,6 +1947,44 @@ create_gather_merge_plan(PlannerInfo *root, GatherMergePath *best_path)
 	return gm_plan;
 }
 
+/*
+ * create_repartition_plan
+ *
+ *	  Create a Repartition plan for 'best_path' and (recursively) plans
+ *	  for its subpaths.
+ */
+static Repartition *
+create_repartition_plan(PlannerInfo *root, RepartitionPath *best_path,
+						int flags)
+{
+	Repartition *plan;
+	Plan	   *subplan;
+
+	/*
+	 * Repartition doesn't project, so the partition key columns must be
+	 * labeled in the subplan's tlist for us to find them.  Also, any excess
+	 * columns would only make the tuples we write out bigger.
+	 */
+	subplan = create_plan_recurse(root, best_path->subpath,
+								  flags | CP_LABEL_TLIST | CP_SMALL_TLIST);
+
+	plan = makeNode(Repartition);
+	plan->plan.targetlist = subplan->targetlist;
+	plan->plan.qual = NIL;
+	plan->plan.lefttree = subplan;
+	plan->plan.righttree = NULL;
+	plan->numCols = list_length(best_path->groupClause);
+	plan->partColIdx = extract_grouping_cols(best_path->groupClause,
+											 subplan->targetlist);
+	plan->partOperators = extract_grouping_ops(best_path->groupClause);
+	plan->partCollations = extract_grouping_collations(best_path->groupClause,
+													   subplan->targetlist);
+
+	copy_generic_path_info(&plan->plan, (Path *) best_path);
+
+	return plan;
+}
+
 /*
  * create_projection_plan
  *
@@ -2776,7 +2949,7 @@ create_seqscan_plan(PlannerInfo *root, Path *best_path,
 							 scan_clauses,
 							 scan_relid);
 
-	copy_generic_path_info(&scan_plan->plan, best_path);
+	copy_generic_path_info(&scan_plan->scan.plan, best_path);
 
 	return scan_plan;
 }
@@ -4582,6 +4755,8 @@ create_hashjoin_plan(PlannerInfo *root,
 		inner_hashkeys = lappend(inner_hashkeys, lsecond(hclause->args));
 	}
 
+	push_hash_filter_to_outer_scan(best_path, outer_plan, hashclauses);
+
 	/*
 	 * Build the hash node and hash join node.
 	 */
@@ -4626,6 +4801,88 @@ create_hashjoin_plan(PlannerInfo *root,
 	return join_plan;
 }
 
+/*
+ * push_hash_filter_to_outer_scan
+ *	  Ask the seq scan on the outer side of a hash join, if there is one, to
+ *	  skip the tuples failing a bloom filter of the join's inner hash values.
+ *
+ * The executor builds the filter along with the hash table, and hands it to
+ * the scan before starting that; if the scan is below a Gather, the workers
+ * get a copy.  Every outer hash key must be a plain column of the scanned
+ * table, so that the scan can compute the same hash values as the join, and
+ * the join must be one that discards unmatched outer tuples.  Parallel Hash
+ * is left out, since its hash table is filled by several processes.
+ *
+ * There's no cost model for this: checking the filter is cheap compared to
+ * what it saves, so we do it whenever the join is expected to return less
+ * than half as many rows as it gets from its outer side.  Except if the
+ * inner side is expected to be tiny: probing a hash table that small costs
+ * hardly more than probing the filter would.
+ */
+static void
+push_hash_filter_to_outer_scan(HashPath *best_path, Plan *outer_plan,
+							   List *hashclauses)
+{
+	JoinType	jointype = best_path->jpath.jointype;
+	SeqScan    *scan;
+	int			nkeys;
+	int			i;
+	ListCell   *lc;
+
+	if (!enable_hashjoin_bloom_filter || best_path->jpath.path.parallel_aware)
+		return;
+	if (jointype != JOIN_INNER && jointype != JOIN_SEMI &&
+		jointype != JOIN_RIGHT)
+		return;
+	if (best_path->jpath.path.rows >=
+		0.5 * best_path->jpath.outerjoinpath->rows)
+		return;
+	if (best_path->jpath.innerjoinpath->rows < HASH_FILTER_MIN_INNER_ROWS)
+		return;
+
+	if (IsA(outer_plan, Gather))
+		outer_plan = outer_plan->lefttree;
+	if (!IsA(outer_plan, SeqScan))
+		return;
+	scan = (SeqScan *) outer_plan;
+
+	foreach(lc, hashclauses)
+	{
+		OpExpr	   *hclause = lfirst_node(OpExpr, lc);
+		Node	   *node = (Node *) linitial(hclause->args);
+		Var		   *var;
+
+		if (IsA(node, RelabelType))
+			node = (Node *) ((RelabelType *) node)->arg;
+		if (!IsA(node, Var))
+			return;
+		var = (Var *) node;
+		if (var->varno != scan->scan.scanrelid || var->varlevelsup != 0 ||
+			var->varattno <= 0)
+			return;
+	}
+
+	nkeys = list_length(hashclauses);
+	scan->numHashFilterCols = nkeys;
+	scan->hashFilterColIdx = (AttrNumber *) palloc(nkeys * sizeof(AttrNumber));
+	scan->hashFilterOperators = (Oid *) palloc(nkeys * sizeof(Oid));
+	scan->hashFilterCollations = (Oid *) palloc(nkeys * sizeof(Oid));
+
+	i = 0;
+	foreach(lc, hashclauses)
+	{
+		OpExpr	   *hclause = lfirst_node(OpExpr, lc);
+		Node	   *node = (Node *) linitial(hclause->args);
+
+		if (IsA(node, RelabelType))
+			node = (Node *) ((RelabelType *) node)->arg;
+		scan->hashFilterColIdx[i] = ((Var *) node)->varattno;
+		scan->hashFilterOperators[i] = hclause->opno;
+		scan->hashFilterCollations[i] = hclause->inputcollid;
+		i++;
+	}
+}
+
 
 /*****************************************************************************
  *
@@ -5225,13 +5482,17 @@ make_seqscan(List *qptlist,
 			 Index scanrelid)
 {
 	SeqScan    *node = makeNode(SeqScan);
-	Plan	   *plan = &node->plan;
+	Plan	   *plan = &node->scan.plan;
 
 	plan->targetlist = qptlist;
 	plan->qual = qpqual;
 	plan->lefttree = NULL;
 	plan->righttree = NULL;
-	node->scanrelid = scanrelid;
+	node->scan.scanrelid = scanrelid;
+	node->numHashFilterCols = 0;
+	node->hashFilterColIdx = NULL;
+	node->hashFilterOperators = NULL;
+	node->hashFilterCollations = NULL;
 
 	return node;
 }
@@ -6299,6 +6560,28 @@ make_material(Plan *lefttree)
 	return node;
 }
 
+static ResultCache *
+make_resultcache(Plan *lefttree, Oid *hashoperators, Oid *collations,
+				 List *param_exprs, bool singlerow, uint32 est_entries)
+{
+	ResultCache *node = makeNode(ResultCache);
+	Plan	   *plan = &node->plan;
+
+	plan->targetlist = lefttree->targetlist;
+	plan->qual = NIL;
+	plan->lefttree = lefttree;
+	plan->righttree = NULL;
+
+	node->numKeys = list_length(param_exprs);
+	node->hashOperators = hashoperators;
+	node->collations = collations;
+	node->param_exprs = param_exprs;
+	node->singlerow = singlerow;
+	node->est_entries = est_entries;
+
+	return node;
+}
+
 /*
  * materialize_finished_plan: stick a Material node atop a completed plan
  *
@@ -6929,6 +7212,8 @@ is_projection_capable_path(Path *path)
 	{
 		case T_Hash:
 		case T_Material:
+		case T_ResultCache:
+		case T_Repartition:
 		case T_Sort:
 		case T_IncrementalSort:
 		case T_Unique:
@@ -6974,6 +7259,8 @@ is_projection_capable_plan(Plan *plan)
 	{
 		case T_Hash:
 		case T_Material:
+		case T_ResultCache:
+		case T_Repartition:
 		case T_Sort:
 		case T_Unique:
 		case T_SetOp:
@@ -58,6 +58,7 @@
 #include "parser/parse_agg.h"
 #include "parser/parsetree.h"
 #include "partitioning/partdesc.h"
+#include "rewrite/rewriteHandler.h"
 #include "rewrite/rewriteManip.h"
 #include "storage/dsm_impl.h"
 #include "utils/lsyscache.h"
@@ -129,6 +130,7 @@ typedef struct
 /* Local functions */
 static Node *preprocess_expression(PlannerInfo *root, Node *expr, int kind);
 static void preprocess_qual_conditions(PlannerInfo *root, Node *jtnode);
+static bool insert_target_parallel_safe(Query *parse);
 static void inheritance_planner(PlannerInfo *root);
 static void grouping_planner(PlannerInfo *root, bool inheritance_update,
 							 double tuple_fraction);
@@ -175,7 +177,9 @@ static void consider_groupingsets_paths(PlannerInfo *root,
 										bool can_hash,
 										grouping_sets_data *gd,
 										const AggClauseCosts *agg_costs,
-										double dNumGroups);
+										double dNumGroups,
+										bool is_partial);
+static List *get_common_grouping_clause(Query *parse);
 static RelOptInfo *create_window_paths(PlannerInfo *root,
 									   RelOptInfo *input_rel,
 									   PathTarget *input_target,
@@ -189,7 +193,9 @@ static void create_one_window_path(PlannerInfo *root,
 								   PathTarget *input_target,
 								   PathTarget *output_target,
 								   WindowFuncLists *wflists,
-								   List *activeWindows);
+								   List *activeWindows,
+								   bool is_partial);
+static List *get_common_window_partition(List *activeWindows);
 static RelOptInfo *create_distinct_paths(PlannerInfo *root,
 										 RelOptInfo *input_rel);
 static RelOptInfo *create_ordered_paths(PlannerInfo *root,
@@ -307,6 +313,8 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	glob->resultRelations = NIL;
 	glob->rootResultRelations = NIL;
 	glob->appendRelations = NIL;
+	glob->partPruneInfos = NIL;
+	glob->prunableRelids = NULL;
 	glob->relationOids = NIL;
 	glob->invalItems = NIL;
 	glob->paramExecTypes = NIL;
@@ -325,10 +333,12 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	 *
 	 * (Note that we do allow CREATE TABLE AS, SELECT INTO, and CREATE
 	 * MATERIALIZED VIEW to use parallel plans, but as of now, only the leader
-	 * backend writes into a completely new table.  In the future, we can
-	 * extend it to allow workers to write into the table.  However, to allow
-	 * parallel updates and deletes, we have to solve other problems,
-	 * especially around combo CIDs.)
+	 * backend writes into a completely new table.  INSERT can use parallel
+	 * mode too if enable_parallel_insert is set and the target table is one
+	 * the workers can write to, see insert_target_parallel_safe; the workers
+	 * may then do the inserting themselves.  To allow parallel updates and
+	 * deletes, we have to solve other problems, especially around combo
+	 * CIDs.)
 	 *
 	 * For now, we don't try to use parallel mode if we're running inside a
 	 * parallel worker.  We might eventually be able to relax this
@@ -337,7 +347,9 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	 */
 	if ((cursorOptions & CURSOR_OPT_PARALLEL_OK) != 0 &&
 		IsUnderPostmaster &&
-		parse->commandType == CMD_SELECT &&
+		(parse->commandType == CMD_SELECT ||
+		 (parse->commandType == CMD_INSERT && enable_parallel_insert &&
+		  insert_target_parallel_safe(parse))) &&
 		!parse->hasModifyingCTE &&
 		max_parallel_workers_per_gather > 0 &&
 		!IsParallelWorker())
@@ -525,6 +537,16 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	result->subplans = glob->subplans;
 	result->rewindPlanIDs = glob->rewindPlanIDs;
 	result->rowMarks = glob->finalrowmarks;
+
+	/*
+	 * The executor opens every relation that has a row mark, pruned or not,
+	 * so with row marks present no relation may be left unlocked.
+	 */
+	if (glob->finalrowmarks == NIL)
+	{
+		result->partPruneInfos = glob->partPruneInfos;
+		result->prunableRelids = glob->prunableRelids;
+	}
 	result->relationOids = glob->relationOids;
 	result->invalItems = glob->invalItems;
 	result->paramExecTypes = glob->paramExecTypes;
@@ -564,6 +586,95 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	return result;
 }
 
+/*
+ * insert_target_parallel_safe
+ *		Can the target of an INSERT be written in parallel mode, and by
+ *		parallel workers?
+ *
+ * Anything the executor does per row, besides evaluating the query, must be
+ * safe to run in a worker, and in any order: so there must be no triggers
+ * (which also rules out foreign keys), and check constraints, generated
+ * columns, index expressions and predicates must be parallel safe.  The
+ * table must be a plain permanent one, since workers can't access the
+ * leader's local buffers and routing tuples to partitions or FDWs isn't
+ * prepared for it, and its relfilenode must not be new in this transaction,
+ * since then the inserts may be skipping WAL.  ON CONFLICT, RETURNING and
+ * WITH CHECK OPTION aren't supported.
+ */
+static bool
+insert_target_parallel_safe(Query *parse)
+{
+	RangeTblEntry *rte = rt_fetch(parse->resultRelation, parse->rtable);
+	Relation	rel;
+	TupleDesc	tupDesc;
+	List	   *indexoidlist;
+	ListCell   *lc;
+	bool		result = false;
+	int			attnum;
+
+	if (parse->onConflict != NULL ||
+		parse->returningList != NIL ||
+		parse->withCheckOptions != NIL)
+		return false;
+
+	if (rte->relkind != RELKIND_RELATION)
+		return false;
+
+	/* The rewriter already locked the target */
+	rel = table_open(rte->relid, NoLock);
+	tupDesc = RelationGetDescr(rel);
+
+	if (rel->rd_rel->relpersistence == RELPERSISTENCE_TEMP ||
+		rel->trigdesc != NULL ||
+		rel->rd_createSubid != InvalidSubTransactionId ||
+		rel->rd_firstRelfilenodeSubid != InvalidSubTransactionId)
+		goto done;
+
+	for (attnum = 1; attnum <= tupDesc->natts; attnum++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupDesc, attnum - 1);
+
+		if (att->attgenerated &&
+			!is_parallel_safe_expr(build_column_default(rel, attnum)))
+			goto done;
+	}
+
+	if (tupDesc->constr != NULL)
+	{
+		int			i;
+
+		for (i = 0; i < tupDesc->constr->num_check; i++)
+		{
+			if (!is_parallel_safe_expr(stringToNode(tupDesc->constr->check[i].ccbin)))
+				goto done;
+		}
+	}
+
+	indexoidlist = RelationGetIndexList(rel);
+	foreach(lc, indexoidlist)
+	{
+		Relation	index = index_open(lfirst_oid(lc), rte->rellockmode);
+		bool		safe;
+
+		safe = is_parallel_safe_expr((Node *) RelationGetIndexExpressions(index)) &&
+			is_parallel_safe_expr((Node *) RelationGetIndexPredicate(index));
+		index_close(index, NoLock);
+
+		if (!safe)
+		{
+			list_free(indexoidlist);
+			goto done;
+		}
+	}
+	list_free(indexoidlist);
+
+	result = true;
+
+done:
+	table_close(rel, NoLock);
+	return result;
+}
+
 
 /*--------------------
  * subquery_planner
@@ -2389,6 +2500,47 @@ grouping_planner(PlannerInfo *root, bool inheritance_update,
 		add_path(final_rel, path);
 	}
 
+	/*
+	 * An INSERT is only allowed to use parallel mode if the workers can
+	 * write to its target (see standard_planner), so then also consider
+	 * putting the ModifyTable below the Gather, on top of the cheapest
+	 * partial path.  Each participant inserts the rows it computes itself,
+	 * and only the row counts need to be sent back to the leader.
+	 */
+	if (parse->commandType == CMD_INSERT && !inheritance_update &&
+		root->glob->parallelModeOK &&
+		current_rel->partial_pathlist != NIL &&
+		!limit_needed(parse))
+	{
+		Path	   *partial_path = (Path *) linitial(current_rel->partial_pathlist);
+		ModifyTablePath *mtpath;
+		double		rows = 0;
+
+		mtpath = create_modifytable_path(root, final_rel,
+										 parse->commandType,
+										 parse->canSetTag,
+										 parse->resultRelation,
+										 0,
+										 false,
+										 list_make1_int(parse->resultRelation),
+										 list_make1(partial_path),
+										 list_make1(root),
+										 NIL,
+										 NIL,
+										 NIL,
+										 NULL,
+										 assign_special_exec_param(root));
+
+		/* It runs in every participant, on that one's share of the rows */
+		mtpath->path.parallel_safe = true;
+		mtpath->path.parallel_workers = partial_path->parallel_workers;
+
+		/* No tuples come out of it, so there are none to gather */
+		add_path(final_rel, (Path *)
+				 create_gather_path(root, final_rel, &mtpath->path,
+									create_empty_pathtarget(), NULL, &rows));
+	}
+
 	/*
 	 * Generate partial paths for final_rel, too, if outer query levels might
 	 * be able to make use of them.
@@ -3719,7 +3871,7 @@ get_number_of_groups(PlannerInfo *root,
 					double		numGroups = estimate_num_groups(root,
 																groupExprs,
 																path_rows,
-																&gset);
+																&gset, NULL);
 
 					gs->numGroups = numGroups;
 					rollup->numGroups += numGroups;
@@ -3744,7 +3896,7 @@ get_number_of_groups(PlannerInfo *root,
 					double		numGroups = estimate_num_groups(root,
 																groupExprs,
 																path_rows,
-																&gset);
+																&gset, NULL);
 
 					gs->numGroups = numGroups;
 					gd->dNumHashGroups += numGroups;
@@ -3760,7 +3912,7 @@ get_number_of_groups(PlannerInfo *root,
 												 target_list);
 
 			dNumGroups = estimate_num_groups(root, groupExprs, path_rows,
-											 NULL);
+											 NULL, NULL);
 		}
 	}
 	else if (parse->groupingSets)
@@ -4183,7 +4335,9 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
  * For a given input path, consider the possible ways of doing grouping sets on
  * it, by combinations of hashing and sorting.  This can be called multiple
  * times, so it's important that it not scribble on input.  No result is
- * returned, but any generated paths are added to grouped_rel.
+ * returned, but any generated paths are added to grouped_rel, as partial
+ * paths if is_partial (the input then being a partial path repartitioned on
+ * the columns common to all the grouping sets).
  */
 static void
 consider_groupingsets_paths(PlannerInfo *root,
@@ -4193,10 +4347,12 @@ consider_groupingsets_paths(PlannerInfo *root,
 							bool can_hash,
 							grouping_sets_data *gd,
 							const AggClauseCosts *agg_costs,
-							double dNumGroups)
+							double dNumGroups,
+							bool is_partial)
 {
 	Query	   *parse = root->parse;
 	int			hash_mem = get_hash_mem();
+	Path	   *gspath;
 
 	/*
 	 * If we're not being offered sorted input, then only consider plans that
@@ -4350,15 +4506,18 @@ consider_groupingsets_paths(PlannerInfo *root,
 			strat = AGG_MIXED;
 		}
 
-		add_path(grouped_rel, (Path *)
-				 create_groupingsets_path(root,
-										  grouped_rel,
-										  path,
-										  (List *) parse->havingQual,
-										  strat,
-										  new_rollups,
-										  agg_costs,
-										  dNumGroups));
+		gspath = (Path *) create_groupingsets_path(root,
+												   grouped_rel,
+												   path,
+												   (List *) parse->havingQual,
+												   strat,
+												   new_rollups,
+												   agg_costs,
+												   dNumGroups);
+		if (is_partial)
+			add_partial_path(grouped_rel, gspath);
+		else
+			add_path(grouped_rel, gspath);
 		return;
 	}
 
@@ -4507,15 +4666,18 @@ consider_groupingsets_paths(PlannerInfo *root,
 
 		if (rollups)
 		{
-			add_path(grouped_rel, (Path *)
-					 create_groupingsets_path(root,
-											  grouped_rel,
-											  path,
-											  (List *) parse->havingQual,
-											  AGG_MIXED,
-											  rollups,
-											  agg_costs,
-											  dNumGroups));
+			gspath = (Path *) create_groupingsets_path(root,
+													   grouped_rel,
+													   path,
+													   (List *) parse->havingQual,
+													   AGG_MIXED,
+													   rollups,
+													   agg_costs,
+													   dNumGroups);
+			if (is_partial)
+				add_partial_path(grouped_rel, gspath);
+			else
+				add_path(grouped_rel, gspath);
 		}
 	}
 
@@ -4523,15 +4685,57 @@ consider_groupingsets_paths(PlannerInfo *root,
 	 * Now try the simple sorted case.
 	 */
 	if (!gd->unsortable_sets)
-		add_path(grouped_rel, (Path *)
-				 create_groupingsets_path(root,
-										  grouped_rel,
-										  path,
-										  (List *) parse->havingQual,
-										  AGG_SORTED,
-										  gd->rollups,
-										  agg_costs,
-										  dNumGroups));
+	{
+		gspath = (Path *) create_groupingsets_path(root,
+												   grouped_rel,
+												   path,
+												   (List *) parse->havingQual,
+												   AGG_SORTED,
+												   gd->rollups,
+												   agg_costs,
+												   dNumGroups);
+		if (is_partial)
+			add_partial_path(grouped_rel, gspath);
+		else
+			add_path(grouped_rel, gspath);
+	}
+}
+
+/*
+ * get_common_grouping_clause
+ *		Find the grouping columns shared by all the grouping sets.
+ *
+ * Returns the SortGroupClauses of the GROUP BY list that appear in every
+ * grouping set (all of them, if there are no grouping sets), or NIL if there
+ * are none.  Rows that agree on these columns fall into the same group of
+ * every grouping set.  The columns must be hashable, for Repartition.
+ */
+static List *
+get_common_grouping_clause(Query *parse)
+{
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	foreach(lc, parse->groupClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		bool		common = sgc->hashable;
+		ListCell   *lc2;
+
+		/* preprocess_grouping_sets() has expanded these to lists of refs */
+		foreach(lc2, parse->groupingSets)
+		{
+			if (!common)
+				break;
+			common = list_member_int((List *) lfirst(lc2),
+									 sgc->tleSortGroupRef);
+		}
+
+		if (common)
+			result = lappend(result, sgc);
+	}
+
+	return result;
 }
 
 /*
@@ -4596,7 +4800,42 @@ create_window_paths(PlannerInfo *root,
 								   input_target,
 								   output_target,
 								   wflists,
-								   activeWindows);
+								   activeWindows,
+								   false);
+	}
+
+	/*
+	 * The workers can also compute the window functions, if all the windows
+	 * partition the rows by some common columns: redistribute the rows among
+	 * the workers on those columns, so that each window partition is seen by
+	 * a single worker in full, and let each worker sort and process its own
+	 * partitions.  Only the results then pass through the Gather.
+	 */
+	if (enable_parallel_window && window_rel->consider_parallel &&
+		input_rel->partial_pathlist != NIL)
+	{
+		List	   *partClause = get_common_window_partition(activeWindows);
+
+		if (partClause != NIL)
+		{
+			Path	   *path = linitial(input_rel->partial_pathlist);
+
+			path = (Path *) create_repartition_path(root,
+													window_rel,
+													path,
+													partClause);
+			create_one_window_path(root,
+								   window_rel,
+								   path,
+								   input_target,
+								   output_target,
+								   wflists,
+								   activeWindows,
+								   true);
+
+			window_rel->reltarget = output_target;
+			generate_useful_gather_paths(root, window_rel, false);
+		}
 	}
 
 	/*
@@ -4630,6 +4869,8 @@ create_window_paths(PlannerInfo *root,
  * output_target: what the topmost WindowAggPath should return
  * wflists: result of find_window_functions
  * activeWindows: result of select_active_windows
+ * is_partial: path is a partial path, repartitioned on the windows'
+ *		common partitioning columns; the result is added as a partial path
  */
 static void
 create_one_window_path(PlannerInfo *root,
@@ -4638,7 +4879,8 @@ create_one_window_path(PlannerInfo *root,
 					   PathTarget *input_target,
 					   PathTarget *output_target,
 					   WindowFuncLists *wflists,
-					   List *activeWindows)
+					   List *activeWindows,
+					   bool is_partial)
 {
 	PathTarget *window_target;
 	ListCell   *l;
@@ -4711,7 +4953,49 @@ create_one_window_path(PlannerInfo *root,
 								  wc);
 	}
 
-	add_path(window_rel, path);
+	if (is_partial)
+		add_partial_path(window_rel, path);
+	else
+		add_path(window_rel, path);
+}
+
+/*
+ * get_common_window_partition
+ *		Find the partitioning columns shared by all the active windows.
+ *
+ * Returns the SortGroupClauses of the first window's PARTITION BY list that
+ * also appear in that of every other window, or NIL if there are none.  Rows
+ * that agree on these columns fall into the same partition of every window.
+ * The columns must be hashable, for Repartition.
+ */
+static List *
+get_common_window_partition(List *activeWindows)
+{
+	WindowClause *first = linitial_node(WindowClause, activeWindows);
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	foreach(lc, first->partitionClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		bool		common = sgc->hashable;
+		ListCell   *lc2;
+
+		foreach(lc2, activeWindows)
+		{
+			WindowClause *wc = lfirst_node(WindowClause, lc2);
+
+			if (!common)
+				break;
+			common = (get_sortgroupref_clause_noerr(sgc->tleSortGroupRef,
+													wc->partitionClause) != NULL);
+		}
+
+		if (common)
+			result = lappend(result, sgc);
+	}
+
+	return result;
 }
 
 /*
@@ -4778,7 +5062,7 @@ create_distinct_paths(PlannerInfo *root,
 												parse->targetList);
 		numDistinctRows = estimate_num_groups(root, distinctExprs,
 											  cheapest_input_path->rows,
-											  NULL);
+											  NULL, NULL);
 	}
 
 	/*
@@ -5081,6 +5365,31 @@ create_ordered_paths(PlannerInfo *root,
 												path, target);
 
 			add_path(ordered_rel, path);
+
+			/*
+			 * The participants can also write their sorted runs to shared
+			 * temporary files for one of them to merge, so that the rows
+			 * only pass through the Gather once, in order.  That's no good
+			 * for a bounded sort, where each participant is better off
+			 * keeping just the top rows of its own share.
+			 */
+			if (enable_parallel_sort && limit_tuples < 0)
+			{
+				path = (Path *) create_parallel_sort_path(root,
+														  ordered_rel,
+														  cheapest_partial_path,
+														  root->sort_pathkeys);
+				path = (Path *) create_gather_path(root, ordered_rel,
+												   path, path->pathtarget,
+												   NULL, NULL);
+
+				/* Add projection step if needed */
+				if (path->pathtarget != target)
+					path = apply_projection_to_path(root, ordered_rel,
+													path, target);
+
+				add_path(ordered_rel, path);
+			}
 		}
 
 		/*
@@ -6335,7 +6644,8 @@ plan_cluster_use_sort(Oid tableOid, Oid indexOid)
  *		CREATE INDEX should request for use
  *
  * tableOid is the table on which the index is to be built.  indexOid is the
- * OID of an index to be created or reindexed (which must be a btree index).
+ * OID of an index to be created or reindexed (whose access method must
+ * support parallel builds).
  *
  * Return value is the number of parallel worker processes to request.  It
  * may be unsafe to proceed if this is 0.  Note that this does not include the
@@ -6521,7 +6831,8 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 				{
 					consider_groupingsets_paths(root, grouped_rel,
 												path, true, can_hash,
-												gd, agg_costs, dNumGroups);
+												gd, agg_costs, dNumGroups,
+												false);
 				}
 				else if (parse->hasAggs)
 				{
@@ -6595,7 +6906,8 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 			{
 				consider_groupingsets_paths(root, grouped_rel,
 											path, true, can_hash,
-											gd, agg_costs, dNumGroups);
+											gd, agg_costs, dNumGroups,
+											false);
 			}
 			else if (parse->hasAggs)
 			{
@@ -6751,7 +7063,8 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 			 */
 			consider_groupingsets_paths(root, grouped_rel,
 										cheapest_path, false, true,
-										gd, agg_costs, dNumGroups);
+										gd, agg_costs, dNumGroups,
+										false);
 		}
 		else
 		{
@@ -6791,6 +7104,122 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 									 agg_final_costs,
 									 dNumGroups));
 		}
+
+		/*
+		 * We can also finalize the groups in the workers, by redistributing
+		 * the partially grouped rows among them on the grouping columns, so
+		 * that each worker sees all the partial groups of the final groups it
+		 * is given.  Then the finalization is divided among the workers and
+		 * only the final groups pass through the Gather, which pays off when
+		 * there are many groups.  The result is a partial path of grouped_rel,
+		 * which gather_grouping_paths will take care of below.
+		 */
+		if (enable_parallel_hashagg && grouped_rel->consider_parallel &&
+			partially_grouped_rel && partially_grouped_rel->partial_pathlist &&
+			parse->groupClause != NIL && !parse->groupingSets)
+		{
+			Path	   *path = linitial(partially_grouped_rel->partial_pathlist);
+			double		dNumWorkerGroups;
+
+			path = (Path *) create_repartition_path(root,
+													grouped_rel,
+													path,
+													parse->groupClause);
+
+			/* each worker gets its share of the groups */
+			dNumWorkerGroups = clamp_row_est(dNumGroups / path->parallel_workers);
+
+			add_partial_path(grouped_rel, (Path *)
+							 create_agg_path(root,
+											 grouped_rel,
+											 path,
+											 grouped_rel->reltarget,
+											 AGG_HASHED,
+											 AGGSPLIT_FINAL_DESERIAL,
+											 parse->groupClause,
+											 havingQual,
+											 agg_final_costs,
+											 dNumWorkerGroups));
+		}
+	}
+
+	/*
+	 * Aggregation that can't be split into partial and final steps, because
+	 * of DISTINCT or ORDER BY aggregates, ordered-set aggregates, aggregates
+	 * whose states can't be serialized or grouping sets, can still be done by
+	 * the workers if each of them is given whole groups.  So redistribute the
+	 * input rows among the workers on the grouping columns (those common to
+	 * all the grouping sets), and let each aggregate its own share of the
+	 * groups in full.  As above, the result is a partial path of grouped_rel.
+	 */
+	if (enable_parallel_nonpartial_agg && grouped_rel->consider_parallel &&
+		input_rel->partial_pathlist != NIL &&
+		(extra->flags & GROUPING_CAN_PARTIAL_AGG) == 0)
+	{
+		List	   *groupClause = get_common_grouping_clause(parse);
+
+		if (groupClause != NIL)
+		{
+			Path	   *path = linitial(input_rel->partial_pathlist);
+			double		dNumWorkerGroups;
+
+			path = (Path *) create_repartition_path(root,
+													grouped_rel,
+													path,
+													groupClause);
+
+			/* each worker gets its share of the groups */
+			dNumWorkerGroups = clamp_row_est(dNumGroups / path->parallel_workers);
+
+			if (can_sort)
+			{
+				Path	   *sorted_path;
+
+				sorted_path = (Path *) create_sort_path(root,
+														grouped_rel,
+														path,
+														root->group_pathkeys,
+														-1.0);
+				if (parse->groupingSets)
+					consider_groupingsets_paths(root, grouped_rel,
+												sorted_path, true, can_hash,
+												gd, agg_costs,
+												dNumWorkerGroups, true);
+				else
+					add_partial_path(grouped_rel, (Path *)
+									 create_agg_path(root,
+													 grouped_rel,
+													 sorted_path,
+													 grouped_rel->reltarget,
+													 AGG_SORTED,
+													 AGGSPLIT_SIMPLE,
+													 parse->groupClause,
+													 havingQual,
+													 agg_costs,
+													 dNumWorkerGroups));
+			}
+
+			if (can_hash)
+			{
+				if (parse->groupingSets)
+					consider_groupingsets_paths(root, grouped_rel,
+												path, false, true,
+												gd, agg_costs,
+												dNumWorkerGroups, true);
+				else
+					add_partial_path(grouped_rel, (Path *)
+									 create_agg_path(root,
+													 grouped_rel,
+													 path,
+													 grouped_rel->reltarget,
+													 AGG_HASHED,
+													 AGGSPLIT_SIMPLE,
+													 parse->groupClause,
+													 havingQual,
+													 agg_costs,
+													 dNumWorkerGroups));
+			}
+		}
 	}
 
 	/*
@@ -7494,7 +7923,9 @@ apply_scanjoin_target_to_paths(PlannerInfo *root,
 		int			partition_idx;
 
 		/* Adjust each partition. */
-		for (partition_idx = 0; partition_idx < rel->nparts; partition_idx++)
+		partition_idx = -1;
+		while ((partition_idx = bms_next_member(rel->live_parts,
+												partition_idx)) >= 0)
 		{
 			RelOptInfo *child_rel = rel->part_rels[partition_idx];
 			AppendRelInfo **appinfos;
@@ -7502,8 +7933,8 @@ apply_scanjoin_target_to_paths(PlannerInfo *root,
 			List	   *child_scanjoin_targets = NIL;
 			ListCell   *lc;
 
-			/* Pruned or dummy children can be ignored. */
-			if (child_rel == NULL || IS_DUMMY_REL(child_rel))
+			/* Dummy children can be ignored. */
+			if (IS_DUMMY_REL(child_rel))
 				continue;
 
 			/* Translate scan/join targets for this child. */
@@ -7584,7 +8015,6 @@ create_partitionwise_grouping_paths(PlannerInfo *root,
 									PartitionwiseAggregateType patype,
 									GroupPathExtraData *extra)
 {
-	int			nparts = input_rel->nparts;
 	int			cnt_parts;
 	List	   *grouped_live_children = NIL;
 	List	   *partially_grouped_live_children = NIL;
@@ -7596,7 +8026,9 @@ create_partitionwise_grouping_paths(PlannerInfo *root,
 		   partially_grouped_rel != NULL);
 
 	/* Add paths for partitionwise aggregation/grouping. */
-	for (cnt_parts = 0; cnt_parts < nparts; cnt_parts++)
+	cnt_parts = -1;
+	while ((cnt_parts = bms_next_member(input_rel->live_parts,
+										cnt_parts)) >= 0)
 	{
 		RelOptInfo *child_input_rel = input_rel->part_rels[cnt_parts];
 		PathTarget *child_target = copy_pathtarget(target);
@@ -7606,8 +8038,8 @@ create_partitionwise_grouping_paths(PlannerInfo *root,
 		RelOptInfo *child_grouped_rel;
 		RelOptInfo *child_partially_grouped_rel;
 
-		/* Pruned or dummy children can be ignored. */
-		if (child_input_rel == NULL || IS_DUMMY_REL(child_input_rel))
+		/* Dummy children can be ignored. */
+		if (IS_DUMMY_REL(child_input_rel))
 			continue;
 
 		/*
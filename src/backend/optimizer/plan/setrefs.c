@@ -107,6 +107,9 @@ static Plan *set_append_references(PlannerInfo *root,
 static Plan *set_mergeappend_references(PlannerInfo *root,
 										MergeAppend *mplan,
 										int rtoffset);
+static void set_part_prune_references(PlannerInfo *root,
+									  PartitionPruneInfo *pruneinfo,
+									  int rtoffset);
 static void set_hash_references(PlannerInfo *root, Plan *plan, int rtoffset);
 static Relids offset_relid_set(Relids relids, int rtoffset);
 static Node *fix_scan_expr(PlannerInfo *root, Node *node, int rtoffset);
@@ -488,11 +491,11 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 			{
 				SeqScan    *splan = (SeqScan *) plan;
 
-				splan->scanrelid += rtoffset;
-				splan->plan.targetlist =
-					fix_scan_list(root, splan->plan.targetlist, rtoffset);
-				splan->plan.qual =
-					fix_scan_list(root, splan->plan.qual, rtoffset);
+				splan->scan.scanrelid += rtoffset;
+				splan->scan.plan.targetlist =
+					fix_scan_list(root, splan->scan.plan.targetlist, rtoffset);
+				splan->scan.plan.qual =
+					fix_scan_list(root, splan->scan.plan.qual, rtoffset);
 			}
 			break;
 		case T_SampleScan:
@@ -681,6 +684,7 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
+		case T_Repartition:
 
 			/*
 			 * These plan types don't actually bother to evaluate their
@@ -697,6 +701,22 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 			 */
 			Assert(plan->qual == NIL);
 			break;
+		case T_ResultCache:
+			{
+				ResultCache *rcplan = (ResultCache *) plan;
+
+				/*
+				 * Like the plan types above, ResultCache doesn't evaluate its
+				 * tlist or quals.  But we have to fix up the cache key
+				 * expressions.
+				 */
+				set_dummy_tlist_references(plan, rtoffset);
+				Assert(plan->qual == NIL);
+
+				rcplan->param_exprs = fix_scan_list(root, rcplan->param_exprs,
+													rtoffset);
+				break;
+			}
 		case T_LockRows:
 			{
 				LockRows   *splan = (LockRows *) plan;
@@ -1350,20 +1370,7 @@ set_append_references(PlannerInfo *root,
 	aplan->apprelids = offset_relid_set(aplan->apprelids, rtoffset);
 
 	if (aplan->part_prune_info)
-	{
-		foreach(l, aplan->part_prune_info->prune_infos)
-		{
-			List	   *prune_infos = lfirst(l);
-			ListCell   *l2;
-
-			foreach(l2, prune_infos)
-			{
-				PartitionedRelPruneInfo *pinfo = lfirst(l2);
-
-				pinfo->rtindex += rtoffset;
-			}
-		}
-	}
+		set_part_prune_references(root, aplan->part_prune_info, rtoffset);
 
 	/* We don't need to recurse to lefttree or righttree ... */
 	Assert(aplan->plan.lefttree == NULL);
@@ -1414,26 +1421,57 @@ set_mergeappend_references(PlannerInfo *root,
 	mplan->apprelids = offset_relid_set(mplan->apprelids, rtoffset);
 
 	if (mplan->part_prune_info)
+		set_part_prune_references(root, mplan->part_prune_info, rtoffset);
+
+	/* We don't need to recurse to lefttree or righttree ... */
+	Assert(mplan->plan.lefttree == NULL);
+	Assert(mplan->plan.righttree == NULL);
+
+	return (Plan *) mplan;
+}
+
+/*
+ * set_part_prune_references
+ *		Do set_plan_references processing on the PartitionPruneInfo of an
+ *		Append or MergeAppend
+ *
+ * If the PartitionPruneInfo says which leaf partitions its subplans scan,
+ * its initial pruning can be done before those partitions are locked, so
+ * remember it and them in the PlannerGlobal.
+ */
+static void
+set_part_prune_references(PlannerInfo *root, PartitionPruneInfo *pruneinfo,
+						  int rtoffset)
+{
+	PlannerGlobal *glob = root->glob;
+	ListCell   *l;
+
+	foreach(l, pruneinfo->prune_infos)
 	{
-		foreach(l, mplan->part_prune_info->prune_infos)
-		{
-			List	   *prune_infos = lfirst(l);
-			ListCell   *l2;
+		List	   *prune_infos = lfirst(l);
+		ListCell   *l2;
 
-			foreach(l2, prune_infos)
-			{
-				PartitionedRelPruneInfo *pinfo = lfirst(l2);
+		foreach(l2, prune_infos)
+		{
+			PartitionedRelPruneInfo *pinfo = lfirst(l2);
 
-				pinfo->rtindex += rtoffset;
-			}
+			pinfo->rtindex += rtoffset;
 		}
 	}
 
-	/* We don't need to recurse to lefttree or righttree ... */
-	Assert(mplan->plan.lefttree == NULL);
-	Assert(mplan->plan.righttree == NULL);
+	if (pruneinfo->subplan_rtis == NIL)
+		return;
 
-	return (Plan *) mplan;
+	foreach(l, pruneinfo->subplan_rtis)
+	{
+		if (lfirst_int(l) == 0)
+			continue;
+		lfirst_int(l) += rtoffset;
+		glob->prunableRelids = bms_add_member(glob->prunableRelids,
+											  lfirst_int(l));
+	}
+
+	glob->partPruneInfos = lappend(glob->partPruneInfos, pruneinfo);
 }
 
 /*
@@ -338,7 +338,7 @@ recurse_set_operations(Node *setOp, PlannerInfo *root,
 				*pNumGroups = estimate_num_groups(subroot,
 												  get_tlist_exprs(subquery->targetList, false),
 												  subpath->rows,
-												  NULL);
+												  NULL, NULL);
 		}
 	}
 	else if (IsA(setOp, SetOperationStmt))
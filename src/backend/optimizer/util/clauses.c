@@ -890,6 +890,27 @@ is_parallel_safe(PlannerInfo *root, Node *node)
 	return !max_parallel_hazard_walker(node, &context);
 }
 
+/*
+ * is_parallel_safe_expr
+ *		Detect whether an expression that isn't part of the query, such as a
+ *		check constraint or index expression of a relation the query writes
+ *		to, could be evaluated by a parallel worker
+ *
+ * Unlike is_parallel_safe, we can't use the hazard of the whole query as a
+ * shortcut, and parallel-restricted counts as unsafe.
+ */
+bool
+is_parallel_safe_expr(Node *node)
+{
+	max_parallel_hazard_context context;
+
+	context.max_hazard = PROPARALLEL_SAFE;
+	context.max_interesting = PROPARALLEL_RESTRICTED;
+	context.safe_param_ids = NIL;
+
+	return !max_parallel_hazard_walker(node, &context);
+}
+
 /* core logic for all parallel-hazard checks */
 static bool
 max_parallel_hazard_test(char proparallel, max_parallel_hazard_context *context)
@@ -337,11 +337,13 @@ expand_partitioned_rtentry(PlannerInfo *root, RelOptInfo *relinfo,
 	/*
 	 * We also store partition RelOptInfo pointers in the parent relation.
 	 * Since we're palloc0'ing, slots corresponding to pruned partitions will
-	 * contain NULL.
+	 * contain NULL.  live_parts tells which slots are filled, so that later
+	 * processing can visit just the surviving partitions.
 	 */
 	Assert(relinfo->part_rels == NULL);
 	relinfo->part_rels = (RelOptInfo **)
 		palloc0(relinfo->nparts * sizeof(RelOptInfo *));
+	relinfo->live_parts = live_parts;
 
 	/*
 	 * Create a child RTE for each live partition.  Note that unlike
@@ -1551,6 +1551,104 @@ create_material_path(RelOptInfo *rel, Path *subpath)
 	return pathnode;
 }
 
+/*
+ * create_parallel_material_path
+ *	  Creates a pathnode that represents a Parallel Materialize of a partial
+ *	  path: the participants store their shares of the rows in shared
+ *	  temporary files, and each of them then returns all the rows, as often
+ *	  as it is rescanned.  It is meant to be the inner side of a partial
+ *	  join, in place of a complete path that every participant would have to
+ *	  compute for itself.
+ *
+ * 'rel' is the parent relation associated with the result
+ * 'subpath' is the partial path representing the source of data
+ */
+MaterialPath *
+create_parallel_material_path(RelOptInfo *rel, Path *subpath)
+{
+	MaterialPath *pathnode = makeNode(MaterialPath);
+
+	Assert(subpath->parent == rel);
+	Assert(subpath->param_info == NULL);
+
+	pathnode->path.pathtype = T_Material;
+	pathnode->path.parent = rel;
+	pathnode->path.pathtarget = rel->reltarget;
+	pathnode->path.param_info = NULL;
+	pathnode->path.parallel_aware = true;
+	pathnode->path.parallel_safe = true;
+	pathnode->path.parallel_workers = subpath->parallel_workers;
+
+	/*
+	 * The rows come back in the order of the participants' files, so they're
+	 * only sorted if a single participant returned them all, as with a
+	 * Parallel Sort.
+	 */
+	if (IsA(subpath, SortPath) && subpath->parallel_aware)
+		pathnode->path.pathkeys = subpath->pathkeys;
+	else
+		pathnode->path.pathkeys = NIL;
+
+	pathnode->subpath = subpath;
+
+	cost_parallel_material(&pathnode->path,
+						   subpath->total_cost,
+						   subpath->rows,
+						   subpath->pathtarget->width);
+
+	return pathnode;
+}
+
+/*
+ * create_resultcache_path
+ *	  Creates a path corresponding to a ResultCache plan, returning the
+ *	  pathnode.
+ */
+ResultCachePath *
+create_resultcache_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
+						List *param_exprs, List *hash_operators,
+						bool singlerow, double calls)
+{
+	ResultCachePath *pathnode = makeNode(ResultCachePath);
+
+	Assert(subpath->parent == rel);
+
+	pathnode->path.pathtype = T_ResultCache;
+	pathnode->path.parent = rel;
+	pathnode->path.pathtarget = rel->reltarget;
+	pathnode->path.param_info = subpath->param_info;
+	pathnode->path.parallel_aware = false;
+	pathnode->path.parallel_safe = rel->consider_parallel &&
+		subpath->parallel_safe;
+	pathnode->path.parallel_workers = subpath->parallel_workers;
+	pathnode->path.pathkeys = subpath->pathkeys;
+
+	pathnode->subpath = subpath;
+	pathnode->hash_operators = hash_operators;
+	pathnode->param_exprs = param_exprs;
+	pathnode->singlerow = singlerow;
+	pathnode->calls = calls;
+
+	/*
+	 * For now we set est_entries to 0.  cost_resultcache_rescan() does all
+	 * the hard work to determine how many cache entries there are likely to
+	 * be, so it seems best to leave it up to that function to fill this field
+	 * in.  If left at 0, the executor will make a guess at a good value.
+	 */
+	pathnode->est_entries = 0;
+
+	/*
+	 * Add a small additional charge for caching the first entry.  All the
+	 * harder calculations for rescans are performed in
+	 * cost_resultcache_rescan().
+	 */
+	pathnode->path.startup_cost = subpath->startup_cost + cpu_tuple_cost;
+	pathnode->path.total_cost = subpath->total_cost + cpu_tuple_cost;
+	pathnode->path.rows = subpath->rows;
+
+	return pathnode;
+}
+
 /*
  * create_unique_path
  *	  Creates a path representing elimination of distinct rows from the
@@ -1688,7 +1786,7 @@ create_unique_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
 	pathnode->path.rows = estimate_num_groups(root,
 											  sjinfo->semi_rhs_exprs,
 											  rel->rows,
-											  NULL);
+											  NULL, NULL);
 	numCols = list_length(sjinfo->semi_rhs_exprs);
 
 	if (sjinfo->semi_can_btree)
@@ -1896,6 +1994,10 @@ create_gather_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
 	pathnode->num_workers = subpath->parallel_workers;
 	pathnode->single_copy = false;
 
+	/* ... unless only one participant returns rows, as for a Parallel Sort */
+	if (IsA(subpath, SortPath) && subpath->parallel_aware)
+		pathnode->path.pathkeys = subpath->pathkeys;
+
 	if (pathnode->num_workers == 0)
 	{
 		pathnode->path.pathkeys = subpath->pathkeys;
@@ -1908,6 +2010,50 @@ create_gather_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
 	return pathnode;
 }
 
+/*
+ * create_repartition_path
+ *	  Creates a pathnode that represents redistributing the rows of a
+ *	  partial path among the participants of a parallel query by hashing the
+ *	  grouping columns.  The result is still a partial path, of the same
+ *	  rows, but all the rows of a group now come out of the same participant.
+ *
+ * 'rel' is the parent relation associated with the result
+ * 'subpath' is the partial path whose rows are to be redistributed
+ * 'groupClause' is a list of SortGroupClause's for the grouping columns
+ */
+RepartitionPath *
+create_repartition_path(PlannerInfo *root,
+						RelOptInfo *rel,
+						Path *subpath,
+						List *groupClause)
+{
+	RepartitionPath *pathnode = makeNode(RepartitionPath);
+
+	Assert(subpath->parallel_safe);
+	Assert(subpath->parallel_workers > 0);
+
+	pathnode->path.pathtype = T_Repartition;
+	pathnode->path.parent = rel;
+	/* Repartition doesn't project, so use source path's pathtarget */
+	pathnode->path.pathtarget = subpath->pathtarget;
+	/* For now, assume we are above any joins, so no parameterization */
+	pathnode->path.param_info = NULL;
+	pathnode->path.parallel_aware = true;
+	pathnode->path.parallel_safe = true;
+	pathnode->path.parallel_workers = subpath->parallel_workers;
+	/* rows from different partitions are interleaved */
+	pathnode->path.pathkeys = NIL;
+
+	pathnode->subpath = subpath;
+	pathnode->groupClause = groupClause;
+
+	cost_repartition(&pathnode->path, list_length(groupClause),
+					 subpath->startup_cost, subpath->total_cost,
+					 subpath->rows, subpath->pathtarget->width);
+
+	return pathnode;
+}
+
 /*
  * create_subqueryscan_path
  *	  Creates a path corresponding to a scan of a subquery,
@@ -2880,6 +3026,48 @@ create_sort_path(PlannerInfo *root,
 	return pathnode;
 }
 
+/*
+ * create_parallel_sort_path
+ *	  Creates a pathnode that represents a Parallel Sort of a partial path:
+ *	  the participants sort their shares of the rows, and one of them merges
+ *	  the results and returns all the rows in order, while the others return
+ *	  none.  A Gather on top of it therefore preserves the sort order.
+ *
+ * 'rel' is the parent relation associated with the result
+ * 'subpath' is the partial path representing the source of data
+ * 'pathkeys' represent the desired sort order
+ */
+SortPath *
+create_parallel_sort_path(PlannerInfo *root,
+						  RelOptInfo *rel,
+						  Path *subpath,
+						  List *pathkeys)
+{
+	SortPath   *pathnode = makeNode(SortPath);
+
+	pathnode->path.pathtype = T_Sort;
+	pathnode->path.parent = rel;
+	/* Sort doesn't project, so use source path's pathtarget */
+	pathnode->path.pathtarget = subpath->pathtarget;
+	/* For now, assume we are above any joins, so no parameterization */
+	pathnode->path.param_info = NULL;
+	pathnode->path.parallel_aware = true;
+	pathnode->path.parallel_safe = true;
+	pathnode->path.parallel_workers = subpath->parallel_workers;
+	pathnode->path.pathkeys = pathkeys;
+
+	pathnode->subpath = subpath;
+
+	cost_parallel_sort(&pathnode->path, root, pathkeys,
+					   subpath->total_cost,
+					   subpath->rows,
+					   subpath->pathtarget->width,
+					   0.0,
+					   work_mem);
+
+	return pathnode;
+}
+
 /*
  * create_group_path
  *	  Creates a pathnode that represents performing grouping of presorted input
@@ -3848,6 +4036,22 @@ reparameterize_path(PlannerInfo *root, Path *path,
 									   apath->partitioned_rels,
 									   -1);
 			}
+		case T_ResultCache:
+			{
+				ResultCachePath *rcpath = (ResultCachePath *) path;
+				Path	   *spath;
+
+				spath = reparameterize_path(root, rcpath->subpath,
+											required_outer, loop_count);
+				if (spath == NULL)
+					return NULL;
+				return (Path *) create_resultcache_path(root, rel,
+														spath,
+														rcpath->param_exprs,
+														rcpath->hash_operators,
+														rcpath->singlerow,
+														rcpath->calls);
+			}
 		default:
 			break;
 	}
@@ -4076,6 +4280,17 @@ do { \
 			}
 			break;
 
+		case T_ResultCachePath:
+			{
+				ResultCachePath *rcpath;
+
+				FLAT_COPY_PATH(rcpath, path, ResultCachePath);
+				REPARAMETERIZE_CHILD_PATH(rcpath->subpath);
+				ADJUST_CHILD_ATTRS(rcpath->param_exprs);
+				new_path = (Path *) rcpath;
+			}
+			break;
+
 		default:
 
 			/* We don't know how to reparameterize this path. */
@@ -37,6 +37,7 @@
 
 #include "access/hash.h"
 #include "access/nbtree.h"
+#include "catalog/pg_class.h"
 #include "catalog/pg_operator.h"
 #include "catalog/pg_opfamily.h"
 #include "catalog/pg_proc.h"
@@ -143,6 +144,7 @@ static List *make_partitionedrel_pruneinfo(PlannerInfo *root,
 										   int *relid_subplan_map,
 										   List *partitioned_rels, List *prunequal,
 										   Bitmapset **matchedsubplans);
+static bool initial_pruning_is_immutable(List *prune_infos);
 static void gen_partprune_steps(RelOptInfo *rel, List *clauses,
 								PartClauseTarget target,
 								GeneratePruningStepsContext *context);
@@ -318,9 +320,85 @@ make_partition_pruneinfo(PlannerInfo *root, RelOptInfo *parentrel,
 	else
 		pruneinfo->other_subplans = NULL;
 
+	/*
+	 * If the initial pruning steps give the same answer every time they're
+	 * performed with the same Params, the plan cache may perform them before
+	 * locking the leaf partitions, and lock only those that survive.  For
+	 * that it needs to know which leaf partition each subplan scans.
+	 */
+	pruneinfo->subplan_rtis = NIL;
+	if (initial_pruning_is_immutable(prunerelinfos))
+	{
+		i = 0;
+		foreach(lc, subpaths)
+		{
+			RelOptInfo *pathrel = ((Path *) lfirst(lc))->parent;
+			RangeTblEntry *rte = planner_rt_fetch(pathrel->relid, root);
+			int			rti = 0;
+
+			if (!bms_is_member(i, pruneinfo->other_subplans) &&
+				rte->rtekind == RTE_RELATION &&
+				rte->relkind != RELKIND_PARTITIONED_TABLE)
+				rti = pathrel->relid;
+
+			pruneinfo->subplan_rtis = lappend_int(pruneinfo->subplan_rtis,
+												  rti);
+			i++;
+		}
+	}
+
 	return pruneinfo;
 }
 
+/*
+ * initial_pruning_is_immutable
+ *		Are there initial pruning steps in 'prune_infos', and do they use
+ *		only immutable comparison functions and expressions?
+ *
+ * Such steps depend on nothing but the values of the statement's external
+ * Params, so performing them early can't give a different answer than
+ * performing them at executor startup.
+ */
+static bool
+initial_pruning_is_immutable(List *prune_infos)
+{
+	bool		found = false;
+	ListCell   *lc;
+
+	foreach(lc, prune_infos)
+	{
+		List	   *pinfolist = lfirst(lc);
+		ListCell   *lc2;
+
+		foreach(lc2, pinfolist)
+		{
+			PartitionedRelPruneInfo *pinfo = lfirst(lc2);
+			ListCell   *lc3;
+
+			foreach(lc3, pinfo->initial_pruning_steps)
+			{
+				PartitionPruneStepOp *step = lfirst(lc3);
+				ListCell   *lc4;
+
+				found = true;
+
+				if (!IsA(step, PartitionPruneStepOp))
+					continue;
+
+				foreach(lc4, step->cmpfns)
+				{
+					if (func_volatile(lfirst_oid(lc4)) != PROVOLATILE_IMMUTABLE)
+						return false;
+				}
+				if (contain_mutable_functions((Node *) step->exprs))
+					return false;
+			}
+		}
+	}
+
+	return found;
+}
+
 /*
  * make_partitionedrel_pruneinfo
  *		Build a List of PartitionedRelPruneInfos, one for each partitioned
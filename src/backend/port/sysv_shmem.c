@@ -30,6 +30,9 @@
 #ifdef HAVE_SYS_SHM_H
 #include <sys/shm.h>
 #endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 #include "miscadmin.h"
 #include "port/pg_bitutils.h"
@@ -70,6 +73,19 @@
  */
 
 
+/*
+ * On Linux, the NUMA memory policy of the main shared memory region can be
+ * set with the mbind(2) system call, and move_pages(2) tells on which node
+ * each page ended up.  We call them directly rather than depend on libnuma
+ * just for this; the policy numbers are from <linux/mempolicy.h>.
+ */
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_move_pages)
+#define USE_SHMEM_NUMA
+#define PG_MPOL_BIND		2
+#define PG_MPOL_INTERLEAVE	3
+#endif
+
+
 typedef key_t IpcMemoryKey;		/* shared memory key passed to shmget(2) */
 typedef int IpcMemoryId;		/* shared memory ID returned by shmget(2) */
 
@@ -100,6 +116,9 @@ void	   *UsedShmemSegAddr = NULL;
 static Size AnonymousShmemSize;
 static void *AnonymousShmem = NULL;
 
+/* size of the pages backing the main region, if known */
+static Size ShmemPageSize = 0;
+
 static void *InternalIpcMemoryCreate(IpcMemoryKey memKey, Size size);
 static void IpcMemoryDetach(int status, Datum shmaddr);
 static void IpcMemoryDelete(int status, Datum shmId);
@@ -547,6 +566,126 @@ GetHugePageSize(Size *hugepagesize, int *mmap_flags)
 
 #endif							/* MAP_HUGETLB */
 
+#ifdef USE_SHMEM_NUMA
+
+/*
+ * Parse a list of NUMA node numbers and ranges of them, like "0,2-3", into
+ * a bitmask.  Returns false if the list is malformed.
+ */
+static bool
+ParseNumaNodeList(const char *str, unsigned long *mask)
+{
+	const char *p = str;
+	int			nbits = 8 * sizeof(unsigned long);
+
+	memset(mask, 0, PG_SHMEM_MAX_NUMA_NODES / 8);
+
+	for (;;)
+	{
+		char	   *endp;
+		long		first;
+		long		last;
+
+		while (isspace((unsigned char) *p))
+			p++;
+		if (!isdigit((unsigned char) *p))
+			return false;
+		first = last = strtol(p, &endp, 10);
+		p = endp;
+		if (*p == '-')
+		{
+			p++;
+			if (!isdigit((unsigned char) *p))
+				return false;
+			last = strtol(p, &endp, 10);
+			p = endp;
+		}
+		if (first > last || last >= PG_SHMEM_MAX_NUMA_NODES)
+			return false;
+		for (; first <= last; first++)
+			mask[first / nbits] |= 1UL << (first % nbits);
+
+		while (isspace((unsigned char) *p))
+			p++;
+		if (*p == '\0')
+			return true;
+		if (*p++ != ',')
+			return false;
+	}
+}
+
+/*
+ * Find the NUMA nodes that have memory, as a bitmask.  Returns false if the
+ * kernel doesn't tell.
+ */
+static bool
+GetMemoryNumaNodes(unsigned long *mask)
+{
+	FILE	   *fp;
+	char		buf[256];
+	bool		result = false;
+
+	fp = AllocateFile("/sys/devices/system/node/has_memory", "r");
+	if (fp == NULL)
+		fp = AllocateFile("/sys/devices/system/node/online", "r");
+	if (fp == NULL)
+		return false;
+
+	if (fgets(buf, sizeof(buf), fp))
+	{
+		buf[strcspn(buf, "\n")] = '\0';
+		result = ParseNumaNodeList(buf, mask);
+	}
+	FreeFile(fp);
+
+	return result;
+}
+
+#endif							/* USE_SHMEM_NUMA */
+
+/*
+ * Apply shared_memory_numa to a newly created shared memory region.  This
+ * must be done before the region is touched, since the policy only affects
+ * pages that haven't been allocated yet.
+ */
+static void
+SetSharedMemoryNumaPolicy(void *addr, Size size)
+{
+#ifdef USE_SHMEM_NUMA
+	unsigned long mask[PG_SHMEM_MAX_NUMA_NODES / (8 * sizeof(unsigned long))];
+	int			mode;
+
+	if (shared_memory_numa == SHMEM_NUMA_OFF)
+		return;
+
+	if (shared_memory_numa_nodes[0] != '\0')
+	{
+		if (!ParseNumaNodeList(shared_memory_numa_nodes, mask))
+			ereport(FATAL,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid value for parameter \"%s\": \"%s\"",
+							"shared_memory_numa_nodes",
+							shared_memory_numa_nodes),
+					 errhint("Specify a comma-separated list of NUMA node numbers or ranges, like \"0,2-3\".")));
+	}
+	else if (!GetMemoryNumaNodes(mask))
+	{
+		ereport(LOG,
+				(errmsg("could not determine the NUMA nodes of this system, shared memory NUMA policy not set")));
+		return;
+	}
+
+	mode = (shared_memory_numa == SHMEM_NUMA_BIND) ?
+		PG_MPOL_BIND : PG_MPOL_INTERLEAVE;
+
+	/* the kernel looks at one bit less than maxnode says */
+	if (syscall(SYS_mbind, addr, (unsigned long) size, mode, mask,
+				(unsigned long) PG_SHMEM_MAX_NUMA_NODES + 1, 0) != 0)
+		ereport(shared_memory_numa == SHMEM_NUMA_BIND ? FATAL : LOG,
+				(errmsg("could not set NUMA memory policy of shared memory: %m")));
+#endif							/* USE_SHMEM_NUMA */
+}
+
 /*
  * Creates an anonymous mmap()ed shared memory segment.
  *
@@ -581,6 +720,8 @@ CreateAnonymousSegment(Size *size)
 		ptr = mmap(NULL, allocsize, PROT_READ | PROT_WRITE,
 				   PG_MMAP_FLAGS | mmap_flags, -1, 0);
 		mmap_errno = errno;
+		if (ptr != MAP_FAILED)
+			ShmemPageSize = hugepagesize;
 		if (huge_pages == HUGE_PAGES_TRY && ptr == MAP_FAILED)
 			elog(DEBUG1, "mmap(%zu) with MAP_HUGETLB failed, huge pages disabled: %m",
 				 allocsize);
@@ -675,6 +816,12 @@ PGSharedMemoryCreate(Size size,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("huge pages not supported on this platform")));
 #endif
+#ifndef USE_SHMEM_NUMA
+	if (shared_memory_numa != SHMEM_NUMA_OFF)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("NUMA memory policies are not supported on this platform")));
+#endif
 
 	/* Room for a header? */
 	Assert(size > MAXALIGN(sizeof(PGShmemHeader)));
@@ -778,6 +925,15 @@ PGSharedMemoryCreate(Size size,
 			elog(LOG, "shmdt(%p) failed: %m", oldhdr);
 	}
 
+	/*
+	 * Spread the main region across NUMA nodes, if requested, before
+	 * anything is written to it.
+	 */
+	if (AnonymousShmem != NULL)
+		SetSharedMemoryNumaPolicy(AnonymousShmem, AnonymousShmemSize);
+	else
+		SetSharedMemoryNumaPolicy(memAddress, size);
+
 	/* Initialize new segment. */
 	hdr = (PGShmemHeader *) memAddress;
 	hdr->creatorPID = getpid();
@@ -928,3 +1084,62 @@ PGSharedMemoryDetach(void)
 		AnonymousShmem = NULL;
 	}
 }
+
+/*
+ * PGSharedMemoryNumaUsage
+ *
+ * Add up how many bytes of the given range of shared memory are on each
+ * NUMA node.  node_bytes must have room for PG_SHMEM_MAX_NUMA_NODES entries;
+ * the bytes that are on no node yet, because the pages haven't been touched
+ * since the server started, are added to *unplaced_bytes.  Returns false if
+ * that information isn't available on this platform.
+ */
+bool
+PGSharedMemoryNumaUsage(void *addr, Size size, Size *node_bytes,
+						Size *unplaced_bytes)
+{
+#ifdef USE_SHMEM_NUMA
+#define NUMA_QUERY_BATCH 1024
+	void	   *pages[NUMA_QUERY_BATCH];
+	int			status[NUMA_QUERY_BATCH];
+	Size		pagesize = ShmemPageSize;
+	char	   *start = (char *) addr;
+	char	   *end = start + size;
+	char	   *page;
+
+	if (pagesize == 0)
+		pagesize = sysconf(_SC_PAGESIZE);
+
+	page = (char *) TYPEALIGN_DOWN(pagesize, start);
+	while (page < end)
+	{
+		int			npages = 0;
+		int			i;
+
+		for (; npages < NUMA_QUERY_BATCH && page < end; page += pagesize)
+			pages[npages++] = page;
+
+		/* with no target nodes, this only reports where the pages are */
+		if (syscall(SYS_move_pages, 0, (unsigned long) npages, pages, NULL,
+					status, 0) != 0)
+			ereport(ERROR,
+					(errmsg("could not get NUMA node of shared memory: %m")));
+
+		for (i = 0; i < npages; i++)
+		{
+			char	   *p = (char *) pages[i];
+			Size		bytes;
+
+			bytes = Min(end, p + pagesize) - Max(start, p);
+			if (status[i] >= 0 && status[i] < PG_SHMEM_MAX_NUMA_NODES)
+				node_bytes[status[i]] += bytes;
+			else
+				*unplaced_bytes += bytes;
+		}
+	}
+
+	return true;
+#else
+	return false;
+#endif							/* USE_SHMEM_NUMA */
+}
@@ -215,6 +215,11 @@ PGSharedMemoryCreate(Size size,
 		elog(FATAL, "could not reserve memory region: error code %lu",
 			 GetLastError());
 
+	if (shared_memory_numa != SHMEM_NUMA_OFF)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("NUMA memory policies are not supported on this platform")));
+
 	/* Room for a header? */
 	Assert(size > MAXALIGN(sizeof(PGShmemHeader)));
 
@@ -466,6 +471,18 @@ PGSharedMemoryNoReAttach(void)
 	PGSharedMemoryDetach();
 }
 
+/*
+ * PGSharedMemoryNumaUsage
+ *
+ * NUMA placement of shared memory is not reported on Windows.
+ */
+bool
+PGSharedMemoryNumaUsage(void *addr, Size size, Size *node_bytes,
+						Size *unplaced_bytes)
+{
+	return false;
+}
+
 /*
  * PGSharedMemoryDetach
  *
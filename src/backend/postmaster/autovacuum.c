@@ -61,6 +61,7 @@
  */
 #include "postgres.h"
 
+#include <math.h>
 #include <signal.h>
 #include <sys/time.h>
 #include <unistd.h>
@@ -74,6 +75,7 @@
 #include "access/xact.h"
 #include "catalog/dependency.h"
 #include "catalog/namespace.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_database.h"
 #include "commands/dbcommands.h"
 #include "commands/vacuum.h"
@@ -185,6 +187,14 @@ typedef struct av_relation
 								 * reloptions, or NULL if none */
 } av_relation;
 
+/* struct to keep track of tables to vacuum and/or analyze, in priority order */
+typedef struct av_candidate
+{
+	Oid			ac_relid;
+	bool		ac_wraparound;	/* at risk of wraparound? */
+	double		ac_score;		/* priority; see relation_needs_vacanalyze */
+} av_candidate;
+
 /* struct to keep track of tables to vacuum and/or analyze, after rechecking */
 typedef struct autovac_table
 {
@@ -332,16 +342,20 @@ static void relation_needs_vacanalyze(Oid relid, AutoVacOpts *relopts,
 									  Form_pg_class classForm,
 									  PgStat_StatTabEntry *tabentry,
 									  int effective_multixact_freeze_max_age,
-									  bool *dovacuum, bool *doanalyze, bool *wraparound);
+									  bool *dovacuum, bool *doanalyze, bool *wraparound,
+									  double *score);
+static int	av_candidate_cmp(const ListCell *a, const ListCell *b);
+static List *av_add_candidate(List *candidates, Oid relid, bool wraparound,
+							  double score);
 
 static void autovacuum_do_vac_analyze(autovac_table *tab,
 									  BufferAccessStrategy bstrategy);
 static AutoVacOpts *extract_autovac_opts(HeapTuple tup,
 										 TupleDesc pg_class_desc);
 static PgStat_StatTabEntry *get_pgstat_tabentry_relid(Oid relid, bool isshared,
-													  PgStat_StatDBEntry *shared,
-													  PgStat_StatDBEntry *dbentry);
+													  PgStat_StatTabEntry *tabbuf);
 static void perform_work_item(AutoVacuumWorkItem *workitem);
+static void autovac_set_visible(Oid relid, BlockNumber blkno);
 static void autovac_report_activity(autovac_table *tab);
 static void autovac_report_workitem(AutoVacuumWorkItem *workitem,
 									const char *nspname, const char *relname);
@@ -1937,12 +1951,12 @@ do_autovacuum(void)
 	TableScanDesc relScan;
 	Form_pg_database dbForm;
 	List	   *table_oids = NIL;
+	List	   *candidates = NIL;
 	List	   *orphan_oids = NIL;
 	HASHCTL		ctl;
 	HTAB	   *table_toast_map;
 	ListCell   *volatile cell;
-	PgStat_StatDBEntry *shared;
-	PgStat_StatDBEntry *dbentry;
+	PgStat_StatTabEntry tabbuf;
 	BufferAccessStrategy bstrategy;
 	ScanKeyData key;
 	TupleDesc	pg_class_desc;
@@ -1961,12 +1975,6 @@ do_autovacuum(void)
 										  ALLOCSET_DEFAULT_SIZES);
 	MemoryContextSwitchTo(AutovacMemCxt);
 
-	/*
-	 * may be NULL if we couldn't find an entry (only happens if we are
-	 * forcing a vacuum for anti-wrap purposes).
-	 */
-	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
-
 	/* Start a transaction so our commands have one to play into. */
 	StartTransactionCommand();
 
@@ -2014,9 +2022,6 @@ do_autovacuum(void)
 	/* StartTransactionCommand changed elsewhere */
 	MemoryContextSwitchTo(AutovacMemCxt);
 
-	/* The database hash where pgstat keeps shared relations */
-	shared = pgstat_fetch_stat_dbentry(InvalidOid);
-
 	classRel = table_open(RelationRelationId, AccessShareLock);
 
 	/* create a copy so we can use it after closing pg_class */
@@ -2061,6 +2066,7 @@ do_autovacuum(void)
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		double		score;
 
 		if (classForm->relkind != RELKIND_RELATION &&
 			classForm->relkind != RELKIND_MATVIEW)
@@ -2096,16 +2102,17 @@ do_autovacuum(void)
 		/* Fetch reloptions and the pgstat entry for this table */
 		relopts = extract_autovac_opts(tuple, pg_class_desc);
 		tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
-											 shared, dbentry);
+											 &tabbuf);
 
 		/* Check if it needs vacuum or analyze */
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
 								  effective_multixact_freeze_max_age,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound, &score);
 
-		/* Relations that need work are added to table_oids */
+		/* Relations that need work are added to the candidates */
 		if (dovacuum || doanalyze)
-			table_oids = lappend_oid(table_oids, relid);
+			candidates = av_add_candidate(candidates, relid, wraparound,
+										  score);
 
 		/*
 		 * Remember TOAST associations for the second pass.  Note: we must do
@@ -2154,6 +2161,7 @@ do_autovacuum(void)
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		double		score;
 
 		/*
 		 * We cannot safely process other backends' temp tables, so skip 'em.
@@ -2180,20 +2188,32 @@ do_autovacuum(void)
 
 		/* Fetch the pgstat entry for this table */
 		tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
-											 shared, dbentry);
+											 &tabbuf);
 
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
 								  effective_multixact_freeze_max_age,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound, &score);
 
 		/* ignore analyze for toast tables */
 		if (dovacuum)
-			table_oids = lappend_oid(table_oids, relid);
+			candidates = av_add_candidate(candidates, relid, wraparound,
+										  score);
 	}
 
 	table_endscan(relScan);
 	table_close(classRel, AccessShareLock);
 
+	/*
+	 * Process the most urgent tables first, rather than in pg_class order,
+	 * so that small, busy tables are not stuck behind a large table that
+	 * takes hours.  Other workers in this database skip whatever table we
+	 * are working on, and take the next one in their own order.
+	 */
+	list_sort(candidates, av_candidate_cmp);
+	foreach(cell, candidates)
+		table_oids = lappend_oid(table_oids, ((av_candidate *) lfirst(cell))->ac_relid);
+	list_free_deep(candidates);
+
 	/*
 	 * Recheck orphan temporary tables, and if they still seem orphaned, drop
 	 * them.  We'll eat a transaction per dropped table, which might seem
@@ -2396,10 +2416,10 @@ do_autovacuum(void)
 		 * It could have changed if something else processed the table while
 		 * we weren't looking.
 		 *
-		 * Note: we have a special case in pgstat code to ensure that the
-		 * stats we read are as up-to-date as possible, to avoid the problem
-		 * that somebody just finished vacuuming this table.  The window to
-		 * the race condition is not closed but it is very small.
+		 * Note: table statistics are read directly from shared memory, so
+		 * they are as up-to-date as possible, to avoid the problem that
+		 * somebody just finished vacuuming this table.  The window to the
+		 * race condition is not closed but it is very small.
 		 */
 		MemoryContextSwitchTo(AutovacMemCxt);
 		tab = table_recheck_autovac(relid, table_toast_map, pg_class_desc,
@@ -2661,6 +2681,14 @@ perform_work_item(AutoVacuumWorkItem *workitem)
 									ObjectIdGetDatum(workitem->avw_relation),
 									Int64GetDatum((int64) workitem->avw_blockNumber));
 				break;
+			case AVW_HeapSetVisible:
+				autovac_set_visible(workitem->avw_relation,
+									workitem->avw_blockNumber);
+				break;
+			case AVW_GinCleanPendingList:
+				DirectFunctionCall1(gin_clean_pending_list,
+									ObjectIdGetDatum(workitem->avw_relation));
+				break;
 			default:
 				elog(WARNING, "unrecognized work item found: type %d",
 					 workitem->avw_type);
@@ -2712,6 +2740,42 @@ deleted2:
 		pfree(cur_relname);
 }
 
+/*
+ * autovac_set_visible
+ *		Set visibility map bits on one AVW_HeapSetVisible range of a table
+ *
+ * This is best-effort: if the table is gone, isn't a heap, or is locked by
+ * a VACUUM or some DDL, just forget about it.
+ */
+static void
+autovac_set_visible(Oid relid, BlockNumber blkno)
+{
+	Relation	rel;
+	BlockNumber nset;
+
+	if (!ConditionalLockRelationOid(relid, ShareUpdateExclusiveLock))
+		return;
+
+	rel = try_relation_open(relid, NoLock);
+	if (rel == NULL)
+	{
+		UnlockRelationOid(relid, ShareUpdateExclusiveLock);
+		return;
+	}
+
+	if ((rel->rd_rel->relkind == RELKIND_RELATION ||
+		 rel->rd_rel->relkind == RELKIND_MATVIEW) &&
+		rel->rd_rel->relam == HEAP_TABLE_AM_OID)
+	{
+		nset = heap_vacuum_set_visible(rel, blkno, AVW_SET_VISIBLE_PAGES,
+									   GetAccessStrategy(BAS_VACUUM));
+		elog(DEBUG2, "autovacuum: marked %u pages of \"%s\" all-visible",
+			 nset, RelationGetRelationName(rel));
+	}
+
+	relation_close(rel, ShareUpdateExclusiveLock);
+}
+
 /*
  * extract_autovac_opts
  *
@@ -2742,25 +2806,17 @@ extract_autovac_opts(HeapTuple tup, TupleDesc pg_class_desc)
 /*
  * get_pgstat_tabentry_relid
  *
- * Fetch the pgstat entry of a table, either local to a database or shared.
+ * Fetch the current pgstat entry of a table, either local to a database or
+ * shared, into *tabbuf.  Returns tabbuf, or NULL if there is no entry.
  */
 static PgStat_StatTabEntry *
-get_pgstat_tabentry_relid(Oid relid, bool isshared, PgStat_StatDBEntry *shared,
-						  PgStat_StatDBEntry *dbentry)
+get_pgstat_tabentry_relid(Oid relid, bool isshared, PgStat_StatTabEntry *tabbuf)
 {
-	PgStat_StatTabEntry *tabentry = NULL;
+	if (pgstat_tables_fetch(isshared ? InvalidOid : MyDatabaseId, relid,
+							tabbuf))
+		return tabbuf;
 
-	if (isshared)
-	{
-		if (PointerIsValid(shared))
-			tabentry = hash_search(shared->tables, &relid,
-								   HASH_FIND, NULL);
-	}
-	else if (PointerIsValid(dbentry))
-		tabentry = hash_search(dbentry->tables, &relid,
-							   HASH_FIND, NULL);
-
-	return tabentry;
+	return NULL;
 }
 
 /*
@@ -2782,17 +2838,11 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 	bool		doanalyze;
 	autovac_table *tab = NULL;
 	PgStat_StatTabEntry *tabentry;
-	PgStat_StatDBEntry *shared;
-	PgStat_StatDBEntry *dbentry;
+	PgStat_StatTabEntry tabbuf;
 	bool		wraparound;
+	double		score;
 	AutoVacOpts *avopts;
 
-	/* use fresh stats */
-	autovac_refresh_stats();
-
-	shared = pgstat_fetch_stat_dbentry(InvalidOid);
-	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
-
 	/* fetch the relation's relcache entry */
 	classTup = SearchSysCacheCopy1(RELOID, ObjectIdGetDatum(relid));
 	if (!HeapTupleIsValid(classTup))
@@ -2815,13 +2865,13 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 			avopts = &hentry->ar_reloptions;
 	}
 
-	/* fetch the pgstat table entry */
+	/* fetch the current pgstat table entry */
 	tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
-										 shared, dbentry);
+										 &tabbuf);
 
 	relation_needs_vacanalyze(relid, avopts, classForm, tabentry,
 							  effective_multixact_freeze_max_age,
-							  &dovacuum, &doanalyze, &wraparound);
+							  &dovacuum, &doanalyze, &wraparound, &score);
 
 	/* ignore ANALYZE for toast tables */
 	if (classForm->relkind == RELKIND_TOASTVALUE)
@@ -2894,6 +2944,7 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 		tab->at_params.truncate = VACOPT_TERNARY_DEFAULT;
 		/* As of now, we don't support parallel vacuum for autovacuum */
 		tab->at_params.nworkers = -1;
+		tab->at_params.ring_size = -1;
 		tab->at_params.freeze_min_age = freeze_min_age;
 		tab->at_params.freeze_table_age = freeze_table_age;
 		tab->at_params.multixact_freeze_min_age = multixact_freeze_min_age;
@@ -2925,7 +2976,8 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
  *
  * Check whether a relation needs to be vacuumed or analyzed; return each into
  * "dovacuum" and "doanalyze", respectively.  Also return whether the vacuum is
- * being forced because of Xid or multixact wraparound.
+ * being forced because of Xid or multixact wraparound, and a "score" saying
+ * how urgent that is, to order the tables we process.
  *
  * relopts is a pointer to the AutoVacOpts options (either for itself in the
  * case of a plain table, or for either itself or its parent table in the case
@@ -2956,6 +3008,13 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
  * autovacuum_vacuum_threshold GUC variable.  Similarly, a vac_scale_factor
  * value < 0 is substituted with the value of
  * autovacuum_vacuum_scale_factor GUC variable.  Ditto for analyze.
+ *
+ * For a table at risk of wraparound, the score is how far past
+ * freeze_max_age (or multixact_freeze_max_age) it is, so the oldest go first.
+ * Otherwise it's the largest of the ratios of dead tuples, inserted tuples
+ * and changed tuples to their thresholds, discounted by the logarithm of the
+ * table size as a rough estimate of the cost of processing it.  Small tables
+ * with a lot of churn thus go before large ones that are barely due.
  */
 static void
 relation_needs_vacanalyze(Oid relid,
@@ -2966,7 +3025,8 @@ relation_needs_vacanalyze(Oid relid,
  /* output params below */
 						  bool *dovacuum,
 						  bool *doanalyze,
-						  bool *wraparound)
+						  bool *wraparound,
+						  double *score)
 {
 	bool		force_vacuum;
 	bool		av_enabled;
@@ -3057,6 +3117,21 @@ relation_needs_vacanalyze(Oid relid,
 			MultiXactIdPrecedes(classForm->relminmxid, multiForceLimit);
 	}
 	*wraparound = force_vacuum;
+	*score = 0;
+
+	if (force_vacuum)
+	{
+		double		xidage = 0;
+		double		mxidage = 0;
+
+		if (TransactionIdIsNormal(classForm->relfrozenxid))
+			xidage = (double) (recentXid - classForm->relfrozenxid) /
+				Max(freeze_max_age, 1);
+		if (MultiXactIdIsValid(classForm->relminmxid))
+			mxidage = (double) (recentMulti - classForm->relminmxid) /
+				Max(multixact_freeze_max_age, 1);
+		*score = Max(xidage, mxidage);
+	}
 
 	/* User disabled it in pg_class.reloptions?  (But ignore if at risk) */
 	if (!av_enabled && !force_vacuum)
@@ -3106,6 +3181,17 @@ relation_needs_vacanalyze(Oid relid,
 		*dovacuum = force_vacuum || (vactuples > vacthresh) ||
 			(vac_ins_base_thresh >= 0 && instuples > vacinsthresh);
 		*doanalyze = (anltuples > anlthresh);
+
+		if (!force_vacuum)
+		{
+			double		urgency;
+
+			urgency = vactuples / Max(vacthresh, 1);
+			if (vac_ins_base_thresh >= 0)
+				urgency = Max(urgency, instuples / Max(vacinsthresh, 1));
+			urgency = Max(urgency, anltuples / Max(anlthresh, 1));
+			*score = urgency / log10(10.0 + Max(classForm->relpages, 0));
+		}
 	}
 	else
 	{
@@ -3123,6 +3209,43 @@ relation_needs_vacanalyze(Oid relid,
 		*doanalyze = false;
 }
 
+/*
+ * av_add_candidate
+ *		Add a table to the list of tables to process
+ */
+static List *
+av_add_candidate(List *candidates, Oid relid, bool wraparound, double score)
+{
+	av_candidate *cand = palloc(sizeof(av_candidate));
+
+	cand->ac_relid = relid;
+	cand->ac_wraparound = wraparound;
+	cand->ac_score = score;
+
+	return lappend(candidates, cand);
+}
+
+/*
+ * av_candidate_cmp
+ *		list_sort comparator putting the most urgent tables first
+ *
+ * Tables at risk of wraparound always go before the rest.
+ */
+static int
+av_candidate_cmp(const ListCell *a, const ListCell *b)
+{
+	av_candidate *ca = (av_candidate *) lfirst(a);
+	av_candidate *cb = (av_candidate *) lfirst(b);
+
+	if (ca->ac_wraparound != cb->ac_wraparound)
+		return ca->ac_wraparound ? -1 : 1;
+	if (ca->ac_score > cb->ac_score)
+		return -1;
+	if (ca->ac_score < cb->ac_score)
+		return 1;
+	return 0;
+}
+
 /*
  * autovacuum_do_vac_analyze
  *		Vacuum and/or analyze the specified table
@@ -3205,6 +3328,14 @@ autovac_report_workitem(AutoVacuumWorkItem *workitem,
 			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
 					 "autovacuum: BRIN summarize");
 			break;
+		case AVW_HeapSetVisible:
+			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
+					 "autovacuum: set visible");
+			break;
+		case AVW_GinCleanPendingList:
+			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
+					 "autovacuum: GIN pending list cleanup");
+			break;
 	}
 
 	/*
@@ -3252,6 +3383,26 @@ AutoVacuumRequestWork(AutoVacuumWorkItemType type, Oid relationId,
 
 	LWLockAcquire(AutovacuumLock, LW_EXCLUSIVE);
 
+	/*
+	 * If the same work is already waiting to be done, there's nothing to
+	 * add.  Requests that come from queries, rather than from inserts, can be
+	 * frequent.
+	 */
+	for (i = 0; i < NUM_WORKITEMS; i++)
+	{
+		AutoVacuumWorkItem *workitem = &AutoVacuumShmem->av_workItems[i];
+
+		if (workitem->avw_used && !workitem->avw_active &&
+			workitem->avw_type == type &&
+			workitem->avw_database == MyDatabaseId &&
+			workitem->avw_relation == relationId &&
+			workitem->avw_blockNumber == blkno)
+		{
+			LWLockRelease(AutovacuumLock);
+			return true;
+		}
+	}
+
 	/*
 	 * Locate an unused work item and fill it with the given data.
 	 */
@@ -3380,8 +3531,8 @@ AutoVacuumShmemInit(void)
  * rereading the pgstats files too many times in quick succession when there
  * are many databases.
  *
- * Note: we avoid throttling in the autovac worker, as it would be
- * counterproductive in the recheck logic.
+ * Note: we avoid throttling in autovac workers, which want the freshest data
+ * they can get.
  */
 static void
 autovac_refresh_stats(void)
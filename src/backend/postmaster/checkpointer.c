@@ -146,6 +146,7 @@ static CheckpointerShmemStruct *CheckpointerShmem;
 int			CheckPointTimeout = 300;
 int			CheckPointWarning = 30;
 double		CheckPointCompletionTarget = 0.5;
+int			CheckPointColdBufferAge = 0;
 
 /*
  * Private state
@@ -160,10 +161,27 @@ static double ckpt_cached_elapsed;
 static pg_time_t last_checkpoint_time;
 static pg_time_t last_xlog_switch_time;
 
+/*
+ * For writing cold buffers between checkpoints: recent samples of the WAL
+ * position, oldest first, and when we last scanned buffers.
+ */
+#define NUM_COLD_LSN_SAMPLES	16
+
+typedef struct ColdLSNSample
+{
+	pg_time_t	time;
+	XLogRecPtr	lsn;
+} ColdLSNSample;
+
+static ColdLSNSample cold_lsn_samples[NUM_COLD_LSN_SAMPLES];
+static int	num_cold_lsn_samples = 0;
+static pg_time_t last_cold_scan_time = 0;
+
 /* Prototypes for private functions */
 
 static void HandleCheckpointerInterrupts(void);
 static void CheckArchiveTimeout(void);
+static void WriteColdBuffers(pg_time_t now);
 static bool IsCheckpointOnSchedule(double progress);
 static bool ImmediateCheckpointRequested(void);
 static bool CompactCheckpointerRequestQueue(void);
@@ -485,6 +503,12 @@ CheckpointerMain(void)
 		/* Check for archive_timeout and switch xlog files if necessary. */
 		CheckArchiveTimeout();
 
+		/* Write out buffers that haven't been modified in a while */
+		if (CheckPointColdBufferAge > 0)
+			WriteColdBuffers((pg_time_t) time(NULL));
+		else
+			num_cold_lsn_samples = 0;
+
 		/*
 		 * Send off activity statistics to the stats collector.  (The reason
 		 * why we re-use bgwriter-related code for this is that the bgwriter
@@ -517,6 +541,8 @@ CheckpointerMain(void)
 				continue;		/* no sleep for us ... */
 			cur_timeout = Min(cur_timeout, XLogArchiveTimeout - elapsed_secs);
 		}
+		if (CheckPointColdBufferAge > 0)
+			cur_timeout = Min(cur_timeout, 1);
 
 		(void) WaitLatch(MyLatch,
 						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
@@ -525,6 +551,69 @@ CheckpointerMain(void)
 	}
 }
 
+/*
+ * WriteColdBuffers -- write out dirty buffers between checkpoints
+ *
+ * With checkpoint_cold_buffer_age set, the checkpointer wakes up every
+ * second between checkpoints and writes out the dirty buffers that have not
+ * been modified for that long, scanning the whole buffer pool once per
+ * checkpoint_cold_buffer_age.  That spreads the writes of buffers that only
+ * get dirtied once in a while over the whole checkpoint cycle, so the next
+ * checkpoint has fewer buffers to write.
+ *
+ * A buffer's page LSN tells us when it was last modified in terms of WAL
+ * position, so we keep samples of the WAL position over time to translate
+ * the age to an LSN.
+ */
+static void
+WriteColdBuffers(pg_time_t now)
+{
+	XLogRecPtr	horizon = InvalidXLogRecPtr;
+	pg_time_t	sample_interval;
+	int			nscan;
+	int			i;
+
+	/* Take a sample of the current WAL position, if it's time for one */
+	sample_interval = Max(CheckPointColdBufferAge / (NUM_COLD_LSN_SAMPLES / 2), 1);
+	if (num_cold_lsn_samples == 0 ||
+		now - cold_lsn_samples[num_cold_lsn_samples - 1].time >= sample_interval ||
+		now < cold_lsn_samples[num_cold_lsn_samples - 1].time)
+	{
+		if (num_cold_lsn_samples == NUM_COLD_LSN_SAMPLES)
+		{
+			memmove(&cold_lsn_samples[0], &cold_lsn_samples[1],
+					sizeof(ColdLSNSample) * (NUM_COLD_LSN_SAMPLES - 1));
+			num_cold_lsn_samples--;
+		}
+		cold_lsn_samples[num_cold_lsn_samples].time = now;
+		cold_lsn_samples[num_cold_lsn_samples].lsn =
+			RecoveryInProgress() ? GetXLogReplayRecPtr(NULL) : GetInsertRecPtr();
+		num_cold_lsn_samples++;
+	}
+
+	/* Find the WAL position as of checkpoint_cold_buffer_age ago */
+	for (i = num_cold_lsn_samples - 1; i >= 0; i--)
+	{
+		if (now - cold_lsn_samples[i].time >= CheckPointColdBufferAge)
+		{
+			horizon = cold_lsn_samples[i].lsn;
+			break;
+		}
+	}
+	if (XLogRecPtrIsInvalid(horizon))
+		return;
+
+	/* Scan the whole buffer pool once per checkpoint_cold_buffer_age */
+	if (last_cold_scan_time == 0 || now <= last_cold_scan_time)
+		nscan = NBuffers / CheckPointColdBufferAge;
+	else
+		nscan = (int) Min((double) NBuffers * (now - last_cold_scan_time) /
+						  CheckPointColdBufferAge, NBuffers);
+	last_cold_scan_time = now;
+
+	(void) BufferSyncCold(horizon, Max(nscan, 1));
+}
+
 /*
  * Process any new interrupts.
  */
@@ -38,6 +38,8 @@
 #include "access/transam.h"
 #include "access/twophase_rmgr.h"
 #include "access/xact.h"
+#include "access/xlog.h"
+#include "access/xlogprefetch.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_proc.h"
 #include "common/ip.h"
@@ -53,6 +55,7 @@
 #include "postmaster/postmaster.h"
 #include "replication/walsender.h"
 #include "storage/backendid.h"
+#include "storage/buf_stats.h"
 #include "storage/dsm.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
@@ -105,18 +108,6 @@
 #define PGSTAT_FUNCTION_HASH_SIZE	512
 
 
-/* ----------
- * Total number of backends including auxiliary
- *
- * We reserve a slot for each possible BackendId, plus one for each
- * possible auxiliary process type.  (This scheme assumes there is not
- * more than one of any auxiliary process type at a time.) MaxBackends
- * includes autovacuum workers and background workers as well.
- * ----------
- */
-#define NumBackendStatSlots (MaxBackends + NUM_AUXPROCTYPES)
-
-
 /* ----------
  * GUC parameters
  * ----------
@@ -268,6 +259,9 @@ typedef struct TwoPhasePgStatRecord
 static MemoryContext pgStatLocalContext = NULL;
 static HTAB *pgStatDBHash = NULL;
 
+/* Copies of the shared table statistics looked at in this snapshot */
+static HTAB *pgStatTabSnapshot = NULL;
+
 /* Status for backends including auxiliary */
 static LocalPgBackendStatus *localBackendStatusTable = NULL;
 
@@ -308,21 +302,21 @@ static pid_t pgstat_forkexec(void);
 
 NON_EXEC_STATIC void PgstatCollectorMain(int argc, char *argv[]) pg_attribute_noreturn();
 static void pgstat_beshutdown_hook(int code, Datum arg);
+static void pgstat_flush_hook(int code, Datum arg);
 
 static PgStat_StatDBEntry *pgstat_get_db_entry(Oid databaseid, bool create);
-static PgStat_StatTabEntry *pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry,
-												 Oid tableoid, bool create);
 static void pgstat_write_statsfiles(bool permanent, bool allDbs);
 static void pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent);
 static HTAB *pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep);
-static void pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash, bool permanent);
+static void pgstat_read_db_statsfile(Oid databaseid, HTAB *funchash, bool permanent);
 static void backend_read_statsfile(void);
 static void pgstat_read_current_status(void);
 
 static bool pgstat_write_statsfile_needed(void);
 static bool pgstat_db_requested(Oid databaseid);
 
-static void pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg);
+static void pgstat_send_dbstat(PgStat_MsgDbstat *msg);
+static void pgstat_send_dropdb(Oid databaseid);
 static void pgstat_send_funcstats(void);
 static void pgstat_send_slru(void);
 static HTAB *pgstat_collect_oids(Oid catalogid, AttrNumber anum_oid);
@@ -341,16 +335,13 @@ static void pgstat_setheader(PgStat_MsgHdr *hdr, StatMsgType mtype);
 static void pgstat_send(void *msg, int len);
 
 static void pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len);
-static void pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len);
-static void pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len);
+static void pgstat_recv_dbstat(PgStat_MsgDbstat *msg, int len);
 static void pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len);
 static void pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len);
 static void pgstat_recv_resetsharedcounter(PgStat_MsgResetsharedcounter *msg, int len);
 static void pgstat_recv_resetsinglecounter(PgStat_MsgResetsinglecounter *msg, int len);
 static void pgstat_recv_resetslrucounter(PgStat_MsgResetslrucounter *msg, int len);
 static void pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len);
-static void pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len);
-static void pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len);
 static void pgstat_recv_archiver(PgStat_MsgArchiver *msg, int len);
 static void pgstat_recv_bgwriter(PgStat_MsgBgWriter *msg, int len);
 static void pgstat_recv_slru(PgStat_MsgSLRU *msg, int len);
@@ -713,6 +704,7 @@ pgstat_reset_all(void)
 {
 	pgstat_reset_remove_files(pgstat_stat_directory);
 	pgstat_reset_remove_files(PGSTAT_STAT_PERMANENT_DIRECTORY);
+	pgstat_tables_discard();
 }
 
 #ifdef EXEC_BACKEND
@@ -829,9 +821,10 @@ allow_immediate_pgstat_restart(void)
  * pgstat_report_stat() -
  *
  *	Must be called by processes that performs DML: tcop/postgres.c, logical
- *	receiver processes, SPI worker, etc. to send the so far collected
- *	per-table and function usage statistics to the collector.  Note that this
- *	is called only when not within a transaction, so it is fair to use
+ *	receiver processes, SPI worker, etc. to add the so far collected per-table
+ *	usage statistics to the shared table statistics, and to send the
+ *	database-wide and function usage statistics to the collector.  Note that
+ *	this is called only when not within a transaction, so it is fair to use
  *	transaction stop time as an approximation of current time.
  * ----------
  */
@@ -843,11 +836,20 @@ pgstat_report_stat(bool force)
 	static TimestampTz last_report = 0;
 
 	TimestampTz now;
-	PgStat_MsgTabstat regular_msg;
-	PgStat_MsgTabstat shared_msg;
+	PgStat_MsgDbstat regular_msg;
+	PgStat_MsgDbstat shared_msg;
+	bool		have_regular = false;
+	bool		have_shared = false;
 	TabStatusArray *tsa;
 	int			i;
 
+	/* Buffer usage counters are kept in shared memory, see buf_stats.c */
+	BufferStatsFlush(force);
+	/* and so are the I/O counters, see pgstat_io.c */
+	pgstat_flush_io(force);
+	/* and the LWLock contention counters, see lwlock.c */
+	LWLockStatsFlush(force);
+
 	/* Don't expend a clock check if nothing to do */
 	if ((pgStatTabList == NULL || pgStatTabList->tsa_used == 0) &&
 		pgStatXactCommit == 0 && pgStatXactRollback == 0 &&
@@ -865,7 +867,7 @@ pgstat_report_stat(bool force)
 	last_report = now;
 
 	/*
-	 * Destroy pgStatTabHash before we start invalidating PgStat_TableEntry
+	 * Destroy pgStatTabHash before we start invalidating PgStat_TableStatus
 	 * entries it points to.  (Should we fail partway through the loop below,
 	 * it's okay to have removed the hashtable already --- the only
 	 * consequence is we'd get multiple entries for the same table in the
@@ -877,22 +879,22 @@ pgstat_report_stat(bool force)
 
 	/*
 	 * Scan through the TabStatusArray struct(s) to find tables that actually
-	 * have counts, and build messages to send.  We have to separate shared
-	 * relations from regular ones because the databaseid field in the message
-	 * header has to depend on that.
+	 * have counts, add them to the shared table statistics, and sum them up
+	 * for the database-wide counters.  We have to separate shared relations
+	 * from regular ones because the databaseid field in the message header
+	 * has to depend on that.
 	 */
+	MemSet(&regular_msg, 0, sizeof(regular_msg));
+	MemSet(&shared_msg, 0, sizeof(shared_msg));
 	regular_msg.m_databaseid = MyDatabaseId;
 	shared_msg.m_databaseid = InvalidOid;
-	regular_msg.m_nentries = 0;
-	shared_msg.m_nentries = 0;
 
 	for (tsa = pgStatTabList; tsa != NULL; tsa = tsa->tsa_next)
 	{
 		for (i = 0; i < tsa->tsa_used; i++)
 		{
 			PgStat_TableStatus *entry = &tsa->tsa_entries[i];
-			PgStat_MsgTabstat *this_msg;
-			PgStat_TableEntry *this_ent;
+			PgStat_MsgDbstat *this_msg;
 
 			/* Shouldn't have any pending transaction-dependent counts */
 			Assert(entry->trans == NULL);
@@ -905,19 +907,25 @@ pgstat_report_stat(bool force)
 					   sizeof(PgStat_TableCounts)) == 0)
 				continue;
 
-			/*
-			 * OK, insert data into the appropriate message, and send if full.
-			 */
+			pgstat_tables_add_counts(entry->t_shared ? InvalidOid : MyDatabaseId,
+									 entry->t_id, &entry->t_counts);
+
+			/* Add per-table stats to the per-database totals, too */
 			this_msg = entry->t_shared ? &shared_msg : &regular_msg;
-			this_ent = &this_msg->m_entry[this_msg->m_nentries];
-			this_ent->t_id = entry->t_id;
-			memcpy(&this_ent->t_counts, &entry->t_counts,
-				   sizeof(PgStat_TableCounts));
-			if (++this_msg->m_nentries >= PGSTAT_NUM_TABENTRIES)
-			{
-				pgstat_send_tabstat(this_msg);
-				this_msg->m_nentries = 0;
-			}
+			this_msg->m_tuples_returned += entry->t_counts.t_tuples_returned;
+			this_msg->m_tuples_fetched += entry->t_counts.t_tuples_fetched;
+			this_msg->m_tuples_inserted += entry->t_counts.t_tuples_inserted;
+			this_msg->m_tuples_updated += entry->t_counts.t_tuples_updated;
+			this_msg->m_tuples_deleted += entry->t_counts.t_tuples_deleted;
+			this_msg->m_blocks_fetched += entry->t_counts.t_blocks_fetched;
+			this_msg->m_blocks_hit += entry->t_counts.t_blocks_hit;
+			if (entry->t_shared)
+				have_shared = true;
+			else
+				have_regular = true;
+
+			/* don't add the counts again if we fail partway through */
+			MemSet(&entry->t_counts, 0, sizeof(PgStat_TableCounts));
 		}
 		/* zero out PgStat_TableStatus structs after use */
 		MemSet(tsa->tsa_entries, 0,
@@ -926,14 +934,13 @@ pgstat_report_stat(bool force)
 	}
 
 	/*
-	 * Send partial messages.  Make sure that any pending xact commit/abort
-	 * gets counted, even if there are no table stats to send.
+	 * Send the database-wide counts.  Make sure that any pending xact
+	 * commit/abort gets counted, even if there were no table stats.
 	 */
-	if (regular_msg.m_nentries > 0 ||
-		pgStatXactCommit > 0 || pgStatXactRollback > 0)
-		pgstat_send_tabstat(&regular_msg);
-	if (shared_msg.m_nentries > 0)
-		pgstat_send_tabstat(&shared_msg);
+	if (have_regular || pgStatXactCommit > 0 || pgStatXactRollback > 0)
+		pgstat_send_dbstat(&regular_msg);
+	if (have_shared)
+		pgstat_send_dbstat(&shared_msg);
 
 	/* Now, send function statistics */
 	pgstat_send_funcstats();
@@ -943,28 +950,25 @@ pgstat_report_stat(bool force)
 }
 
 /*
- * Subroutine for pgstat_report_stat: finish and send a tabstat message
+ * Subroutine for pgstat_report_stat: finish and send a dbstat message
  */
 static void
-pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg)
+pgstat_send_dbstat(PgStat_MsgDbstat *msg)
 {
-	int			n;
-	int			len;
-
 	/* It's unlikely we'd get here with no socket, but maybe not impossible */
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
 	/*
 	 * Report and reset accumulated xact commit/rollback and I/O timings
-	 * whenever we send a normal tabstat message
+	 * whenever we send a normal dbstat message
 	 */
-	if (OidIsValid(tsmsg->m_databaseid))
+	if (OidIsValid(msg->m_databaseid))
 	{
-		tsmsg->m_xact_commit = pgStatXactCommit;
-		tsmsg->m_xact_rollback = pgStatXactRollback;
-		tsmsg->m_block_read_time = pgStatBlockReadTime;
-		tsmsg->m_block_write_time = pgStatBlockWriteTime;
+		msg->m_xact_commit = pgStatXactCommit;
+		msg->m_xact_rollback = pgStatXactRollback;
+		msg->m_block_read_time = pgStatBlockReadTime;
+		msg->m_block_write_time = pgStatBlockWriteTime;
 		pgStatXactCommit = 0;
 		pgStatXactRollback = 0;
 		pgStatBlockReadTime = 0;
@@ -972,18 +976,14 @@ pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg)
 	}
 	else
 	{
-		tsmsg->m_xact_commit = 0;
-		tsmsg->m_xact_rollback = 0;
-		tsmsg->m_block_read_time = 0;
-		tsmsg->m_block_write_time = 0;
+		msg->m_xact_commit = 0;
+		msg->m_xact_rollback = 0;
+		msg->m_block_read_time = 0;
+		msg->m_block_write_time = 0;
 	}
 
-	n = tsmsg->m_nentries;
-	len = offsetof(PgStat_MsgTabstat, m_entry[0]) +
-		n * sizeof(PgStat_TableEntry);
-
-	pgstat_setheader(&tsmsg->m_hdr, PGSTAT_MTYPE_TABSTAT);
-	pgstat_send(tsmsg, len);
+	pgstat_setheader(&msg->m_hdr, PGSTAT_MTYPE_DBSTAT);
+	pgstat_send(msg, sizeof(PgStat_MsgDbstat));
 }
 
 /*
@@ -1045,23 +1045,39 @@ pgstat_send_funcstats(void)
 /* ----------
  * pgstat_vacuum_stat() -
  *
- *	Will tell the collector about objects he can get rid of.
+ *	Will remove the statistics of dead tables from shared memory, and tell
+ *	the collector about other objects he can get rid of.
  * ----------
  */
 void
 pgstat_vacuum_stat(void)
 {
 	HTAB	   *htab;
-	PgStat_MsgTabpurge msg;
+	HTAB	   *relids;
 	PgStat_MsgFuncpurge f_msg;
 	HASH_SEQ_STATUS hstat;
 	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
 	PgStat_StatFuncEntry *funcentry;
 	int			len;
 
+	/*
+	 * Read pg_database and make a list of OIDs of all existing databases
+	 */
+	htab = pgstat_collect_oids(DatabaseRelationId, Anum_pg_database_oid);
+
+	/*
+	 * Similarly, make a list of all known relations in this DB, and remove
+	 * the table statistics of everything that's not in either list.
+	 */
+	relids = pgstat_collect_oids(RelationRelationId, Anum_pg_class_oid);
+	pgstat_tables_purge(htab, MyDatabaseId, relids);
+	hash_destroy(relids);
+
 	if (pgStatSock == PGINVALID_SOCKET)
+	{
+		hash_destroy(htab);
 		return;
+	}
 
 	/*
 	 * If not done for this transaction, read the statistics collector stats
@@ -1069,11 +1085,6 @@ pgstat_vacuum_stat(void)
 	 */
 	backend_read_statsfile();
 
-	/*
-	 * Read pg_database and make a list of OIDs of all existing databases
-	 */
-	htab = pgstat_collect_oids(DatabaseRelationId, Anum_pg_database_oid);
-
 	/*
 	 * Search the database hash table for dead databases and tell the
 	 * collector to drop them.
@@ -1085,10 +1096,13 @@ pgstat_vacuum_stat(void)
 
 		CHECK_FOR_INTERRUPTS();
 
-		/* the DB entry for shared tables (with InvalidOid) is never dropped */
+		/*
+		 * the DB entry for shared tables (with InvalidOid) is never dropped;
+		 * the table statistics of dropped databases are already gone
+		 */
 		if (OidIsValid(dbid) &&
 			hash_search(htab, (void *) &dbid, HASH_FIND, NULL) == NULL)
-			pgstat_drop_database(dbid);
+			pgstat_send_dropdb(dbid);
 	}
 
 	/* Clean up */
@@ -1100,72 +1114,12 @@ pgstat_vacuum_stat(void)
 	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
 												 (void *) &MyDatabaseId,
 												 HASH_FIND, NULL);
-	if (dbentry == NULL || dbentry->tables == NULL)
+	if (dbentry == NULL)
 		return;
 
 	/*
-	 * Similarly to above, make a list of all known relations in this DB.
-	 */
-	htab = pgstat_collect_oids(RelationRelationId, Anum_pg_class_oid);
-
-	/*
-	 * Initialize our messages table counter to zero
-	 */
-	msg.m_nentries = 0;
-
-	/*
-	 * Check for all tables listed in stats hashtable if they still exist.
-	 */
-	hash_seq_init(&hstat, dbentry->tables);
-	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&hstat)) != NULL)
-	{
-		Oid			tabid = tabentry->tableid;
-
-		CHECK_FOR_INTERRUPTS();
-
-		if (hash_search(htab, (void *) &tabid, HASH_FIND, NULL) != NULL)
-			continue;
-
-		/*
-		 * Not there, so add this table's Oid to the message
-		 */
-		msg.m_tableid[msg.m_nentries++] = tabid;
-
-		/*
-		 * If the message is full, send it out and reinitialize to empty
-		 */
-		if (msg.m_nentries >= PGSTAT_NUM_TABPURGE)
-		{
-			len = offsetof(PgStat_MsgTabpurge, m_tableid[0])
-				+ msg.m_nentries * sizeof(Oid);
-
-			pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-			msg.m_databaseid = MyDatabaseId;
-			pgstat_send(&msg, len);
-
-			msg.m_nentries = 0;
-		}
-	}
-
-	/*
-	 * Send the rest
-	 */
-	if (msg.m_nentries > 0)
-	{
-		len = offsetof(PgStat_MsgTabpurge, m_tableid[0])
-			+ msg.m_nentries * sizeof(Oid);
-
-		pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-		msg.m_databaseid = MyDatabaseId;
-		pgstat_send(&msg, len);
-	}
-
-	/* Clean up */
-	hash_destroy(htab);
-
-	/*
-	 * Now repeat the above steps for functions.  However, we needn't bother
-	 * in the common case where no function stats are being collected.
+	 * Now do the same for functions.  However, we needn't bother in the
+	 * common case where no function stats are being collected.
 	 */
 	if (dbentry->functions != NULL &&
 		hash_get_num_entries(dbentry->functions) > 0)
@@ -1275,13 +1229,24 @@ pgstat_collect_oids(Oid catalogid, AttrNumber anum_oid)
 /* ----------
  * pgstat_drop_database() -
  *
- *	Tell the collector that we just dropped a database.
- *	(If the message gets lost, we will still clean the dead DB eventually
- *	via future invocations of pgstat_vacuum_stat().)
+ *	Remove the table statistics of a database we just dropped, and tell the
+ *	collector about it.  (If the message gets lost, we will still clean the
+ *	dead DB eventually via future invocations of pgstat_vacuum_stat().)
  * ----------
  */
 void
 pgstat_drop_database(Oid databaseid)
+{
+	pgstat_tables_drop_database(databaseid);
+	pgstat_send_dropdb(databaseid);
+}
+
+/*
+ * Subroutine for pgstat_drop_database and pgstat_vacuum_stat: tell the
+ * collector to drop a database
+ */
+static void
+pgstat_send_dropdb(Oid databaseid)
 {
 	PgStat_MsgDropdb msg;
 
@@ -1297,9 +1262,7 @@ pgstat_drop_database(Oid databaseid)
 /* ----------
  * pgstat_drop_relation() -
  *
- *	Tell the collector that we just dropped a relation.
- *	(If the message gets lost, we will still clean the dead entry eventually
- *	via future invocations of pgstat_vacuum_stat().)
+ *	Remove the statistics of a relation we just dropped.
  *
  *	Currently not used for lack of any good place to call it; we rely
  *	entirely on pgstat_vacuum_stat() to clean out stats for dead rels.
@@ -1309,20 +1272,7 @@ pgstat_drop_database(Oid databaseid)
 void
 pgstat_drop_relation(Oid relid)
 {
-	PgStat_MsgTabpurge msg;
-	int			len;
-
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
-	msg.m_tableid[0] = relid;
-	msg.m_nentries = 1;
-
-	len = offsetof(PgStat_MsgTabpurge, m_tableid[0]) + sizeof(Oid);
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-	msg.m_databaseid = MyDatabaseId;
-	pgstat_send(&msg, len);
+	pgstat_tables_reset(MyDatabaseId, relid);
 }
 #endif							/* NOT_USED */
 
@@ -1330,7 +1280,8 @@ pgstat_drop_relation(Oid relid)
 /* ----------
  * pgstat_reset_counters() -
  *
- *	Tell the statistics collector to reset counters for our database.
+ *	Reset the table statistics of our database, and tell the statistics
+ *	collector to reset its counters for it.
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1341,6 +1292,8 @@ pgstat_reset_counters(void)
 {
 	PgStat_MsgResetcounter msg;
 
+	pgstat_tables_drop_database(MyDatabaseId);
+
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
@@ -1363,6 +1316,34 @@ pgstat_reset_shared_counters(const char *target)
 {
 	PgStat_MsgResetsharedcounter msg;
 
+	/* the recovery prefetching counters are kept in shared memory */
+	if (strcmp(target, "prefetch_recovery") == 0)
+	{
+		XLogPrefetchResetStats();
+		return;
+	}
+
+	/* so are the group commit counters */
+	if (strcmp(target, "group_commit") == 0)
+	{
+		XLogGroupCommitResetStats();
+		return;
+	}
+
+	/* and the I/O counters */
+	if (strcmp(target, "io") == 0)
+	{
+		pgstat_reset_io();
+		return;
+	}
+
+	/* and the LWLock contention counters */
+	if (strcmp(target, "lwlock") == 0)
+	{
+		LWLockStatsReset();
+		return;
+	}
+
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
@@ -1374,7 +1355,7 @@ pgstat_reset_shared_counters(const char *target)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("unrecognized reset target: \"%s\"", target),
-				 errhint("Target must be \"archiver\" or \"bgwriter\".")));
+				 errhint("Target must be \"archiver\", \"bgwriter\", \"group_commit\", \"io\", \"lwlock\" or \"prefetch_recovery\".")));
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETSHAREDCOUNTER);
 	pgstat_send(&msg, sizeof(msg));
@@ -1394,6 +1375,11 @@ pgstat_reset_single_counter(Oid objoid, PgStat_Single_Reset_Type type)
 {
 	PgStat_MsgResetsinglecounter msg;
 
+	/* table statistics are kept in shared memory */
+	if (type == RESET_TABLE)
+		pgstat_tables_reset(MyDatabaseId, objoid);
+
+	/* the collector still sets the database's reset timestamp */
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
@@ -1456,32 +1442,27 @@ pgstat_report_autovac(Oid dboid)
 /* ---------
  * pgstat_report_vacuum() -
  *
- *	Tell the collector about the table we just vacuumed.
+ *	Record the table we just vacuumed in its statistics.
  * ---------
  */
 void
 pgstat_report_vacuum(Oid tableoid, bool shared,
 					 PgStat_Counter livetuples, PgStat_Counter deadtuples)
 {
-	PgStat_MsgVacuum msg;
-
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_VACUUM);
-	msg.m_databaseid = shared ? InvalidOid : MyDatabaseId;
-	msg.m_tableoid = tableoid;
-	msg.m_autovacuum = IsAutoVacuumWorkerProcess();
-	msg.m_vacuumtime = GetCurrentTimestamp();
-	msg.m_live_tuples = livetuples;
-	msg.m_dead_tuples = deadtuples;
-	pgstat_send(&msg, sizeof(msg));
+	pgstat_tables_report_vacuum(shared ? InvalidOid : MyDatabaseId,
+								tableoid,
+								IsAutoVacuumWorkerProcess(),
+								GetCurrentTimestamp(),
+								livetuples, deadtuples);
 }
 
 /* --------
  * pgstat_report_analyze() -
  *
- *	Tell the collector about the table we just analyzed.
+ *	Record the table we just analyzed in its statistics.
  *
  * Caller must provide new live- and dead-tuples estimates, as well as a
  * flag indicating whether to reset the changes_since_analyze counter.
@@ -1492,9 +1473,7 @@ pgstat_report_analyze(Relation rel,
 					  PgStat_Counter livetuples, PgStat_Counter deadtuples,
 					  bool resetcounter)
 {
-	PgStat_MsgAnalyze msg;
-
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	/*
@@ -1502,10 +1481,9 @@ pgstat_report_analyze(Relation rel,
 	 * already inserted and/or deleted rows in the target table. ANALYZE will
 	 * have counted such rows as live or dead respectively. Because we will
 	 * report our counts of such rows at transaction end, we should subtract
-	 * off these counts from what we send to the collector now, else they'll
-	 * be double-counted after commit.  (This approach also ensures that the
-	 * collector ends up with the right numbers if we abort instead of
-	 * committing.)
+	 * off these counts from what we store now, else they'll be double-counted
+	 * after commit.  (This approach also ensures that the statistics end up
+	 * with the right numbers if we abort instead of committing.)
 	 */
 	if (rel->pgstat_info != NULL)
 	{
@@ -1523,15 +1501,11 @@ pgstat_report_analyze(Relation rel,
 		deadtuples = Max(deadtuples, 0);
 	}
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_ANALYZE);
-	msg.m_databaseid = rel->rd_rel->relisshared ? InvalidOid : MyDatabaseId;
-	msg.m_tableoid = RelationGetRelid(rel);
-	msg.m_autovacuum = IsAutoVacuumWorkerProcess();
-	msg.m_resetcounter = resetcounter;
-	msg.m_analyzetime = GetCurrentTimestamp();
-	msg.m_live_tuples = livetuples;
-	msg.m_dead_tuples = deadtuples;
-	pgstat_send(&msg, sizeof(msg));
+	pgstat_tables_report_analyze(rel->rd_rel->relisshared ? InvalidOid : MyDatabaseId,
+								 RelationGetRelid(rel),
+								 IsAutoVacuumWorkerProcess(),
+								 GetCurrentTimestamp(),
+								 livetuples, deadtuples, resetcounter);
 }
 
 /* --------
@@ -2500,56 +2474,55 @@ pgstat_fetch_stat_dbentry(Oid dbid)
  *
  *	Support function for the SQL-callable pgstat* functions. Returns
  *	the collected statistics for one table or NULL. NULL doesn't mean
- *	that the table doesn't exist, it is just not yet known by the
- *	collector, so the caller is better off to report ZERO instead.
+ *	that the table doesn't exist, it just has no statistics yet, so the
+ *	caller is better off to report ZERO instead.
+ *
+ *	The statistics are copied out of shared memory the first time a table
+ *	is asked about in a transaction, and the copy returned from then on.
  * ----------
  */
 PgStat_StatTabEntry *
 pgstat_fetch_stat_tabentry(Oid relid)
 {
-	Oid			dbid;
-	PgStat_StatDBEntry *dbentry;
+	PgStat_StatTabEntry tabbuf;
 	PgStat_StatTabEntry *tabentry;
 
-	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
-	 */
-	backend_read_statsfile();
-
-	/*
-	 * Lookup our database, then look in its table hash table.
-	 */
-	dbid = MyDatabaseId;
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &dbid,
-												 HASH_FIND, NULL);
-	if (dbentry != NULL && dbentry->tables != NULL)
+	if (pgStatTabSnapshot == NULL)
 	{
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &relid,
-													   HASH_FIND, NULL);
-		if (tabentry)
-			return tabentry;
+		HASHCTL		hash_ctl;
+
+		pgstat_setup_memcxt();
+
+		memset(&hash_ctl, 0, sizeof(hash_ctl));
+		hash_ctl.keysize = sizeof(Oid);
+		hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
+		hash_ctl.hcxt = pgStatLocalContext;
+		pgStatTabSnapshot = hash_create("Table statistics snapshot",
+										PGSTAT_TAB_HASH_SIZE,
+										&hash_ctl,
+										HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
 	}
 
+	tabentry = (PgStat_StatTabEntry *) hash_search(pgStatTabSnapshot,
+												   (void *) &relid,
+												   HASH_FIND, NULL);
+	if (tabentry)
+		return tabentry;
+
 	/*
-	 * If we didn't find it, maybe it's a shared table.
+	 * Look in our database, and if we don't find it there, maybe it's a
+	 * shared table.
 	 */
-	dbid = InvalidOid;
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &dbid,
-												 HASH_FIND, NULL);
-	if (dbentry != NULL && dbentry->tables != NULL)
-	{
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &relid,
-													   HASH_FIND, NULL);
-		if (tabentry)
-			return tabentry;
-	}
+	if (!pgstat_tables_fetch(MyDatabaseId, relid, &tabbuf) &&
+		!pgstat_tables_fetch(InvalidOid, relid, &tabbuf))
+		return NULL;
 
-	return NULL;
+	tabentry = (PgStat_StatTabEntry *) hash_search(pgStatTabSnapshot,
+												   (void *) &relid,
+												   HASH_ENTER, NULL);
+	memcpy(tabentry, &tabbuf, sizeof(PgStat_StatTabEntry));
+
+	return tabentry;
 }
 
 
@@ -2902,7 +2875,15 @@ pgstat_initialize(void)
 		MyBEEntry = &BackendStatusArray[MaxBackends + MyAuxProcType];
 	}
 
-	/* Set up a process-exit hook to clean up */
+	/* The wait event counters are indexed the same way */
+	pgstat_wait_initialize(MyBEEntry - BackendStatusArray);
+
+	/*
+	 * Set up process-exit hooks to clean up.  The remaining table counts
+	 * must be flushed while the dynamic shared memory holding the table
+	 * statistics is still mapped, hence the separate before_shmem_exit hook.
+	 */
+	before_shmem_exit(pgstat_flush_hook, 0);
 	on_shmem_exit(pgstat_beshutdown_hook, 0);
 }
 
@@ -3051,6 +3032,9 @@ pgstat_bestart(void)
 		   &lbeentry,
 		   sizeof(PgBackendStatus));
 
+	/* Keep the count of allocated memory in the entry from now on */
+	SetAllocatedBytesCounter(unvolatize(uint64 *, &vbeentry->st_allocated_bytes));
+
 	/*
 	 * We can write the out-of-line strings and structs using the pointers
 	 * that are in lbeentry; this saves some de-volatilizing messiness.
@@ -3076,33 +3060,41 @@ pgstat_bestart(void)
 
 	PGSTAT_END_WRITE_ACTIVITY(vbeentry);
 
+	pgstat_wait_bestart(lbeentry.st_userid);
+
 	/* Update app name to current GUC setting */
 	if (application_name)
 		pgstat_report_appname(application_name);
 }
 
 /*
- * Shut down a single backend's statistics reporting at process exit.
+ * Flush any remaining statistics counts at process exit.
  *
- * Flush any remaining statistics counts out to the collector.
  * Without this, operations triggered during backend exit (such as
  * temp table deletions) won't be counted.
- *
- * Lastly, clear out our entry in the PgBackendStatus array.
  */
 static void
-pgstat_beshutdown_hook(int code, Datum arg)
+pgstat_flush_hook(int code, Datum arg)
 {
-	volatile PgBackendStatus *beentry = MyBEEntry;
-
 	/*
 	 * If we got as far as discovering our own database ID, we can report what
-	 * we did to the collector.  Otherwise, we'd be sending an invalid
-	 * database ID, so forget it.  (This means that accesses to pg_database
-	 * during failed backend starts might never get counted.)
+	 * we did.  Otherwise, we'd be reporting an invalid database ID, so forget
+	 * it.  (This means that accesses to pg_database during failed backend
+	 * starts might never get counted.)
 	 */
 	if (OidIsValid(MyDatabaseId))
 		pgstat_report_stat(true);
+}
+
+/*
+ * Shut down a single backend's statistics reporting at process exit.
+ *
+ * Clear out our entry in the PgBackendStatus array.
+ */
+static void
+pgstat_beshutdown_hook(int code, Datum arg)
+{
+	volatile PgBackendStatus *beentry = MyBEEntry;
 
 	/*
 	 * Clear my status entry, following the protocol of bumping st_changecount
@@ -3111,6 +3103,9 @@ pgstat_beshutdown_hook(int code, Datum arg)
 	 */
 	PGSTAT_BEGIN_WRITE_ACTIVITY(beentry);
 
+	/* The entry may be reused by another process; take the counter back */
+	SetAllocatedBytesCounter(NULL);
+
 	beentry->st_procpid = 0;	/* mark invalid */
 
 	PGSTAT_END_WRITE_ACTIVITY(beentry);
@@ -3669,6 +3664,12 @@ pgstat_get_wait_activity(WaitEventActivity w)
 		case WAIT_EVENT_LOGICAL_LAUNCHER_MAIN:
 			event_name = "LogicalLauncherMain";
 			break;
+		case WAIT_EVENT_LOGICAL_PARALLEL_APPLY_MAIN:
+			event_name = "LogicalParallelApplyMain";
+			break;
+		case WAIT_EVENT_PARALLEL_WORKER_IDLE:
+			event_name = "ParallelWorkerIdle";
+			break;
 		case WAIT_EVENT_PGSTAT_MAIN:
 			event_name = "PgStatMain";
 			break;
@@ -3721,6 +3722,9 @@ pgstat_get_wait_client(WaitEventClient w)
 		case WAIT_EVENT_LIBPQWALRECEIVER_RECEIVE:
 			event_name = "LibPQWalReceiverReceive";
 			break;
+		case WAIT_EVENT_PREFORK_HANDOFF:
+			event_name = "PreforkHandoff";
+			break;
 		case WAIT_EVENT_SSL_OPEN_SERVER:
 			event_name = "SSLOpenServer";
 			break;
@@ -3752,6 +3756,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 
 	switch (w)
 	{
+		case WAIT_EVENT_APPEND_READY:
+			event_name = "AppendReady";
+			break;
 		case WAIT_EVENT_BACKUP_WAIT_WAL_ARCHIVE:
 			event_name = "BackupWaitWalArchive";
 			break;
@@ -3770,6 +3777,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_CHECKPOINT_START:
 			event_name = "CheckpointStart";
 			break;
+		case WAIT_EVENT_DOUBLE_WRITE_SLOT:
+			event_name = "DoubleWriteSlot";
+			break;
 		case WAIT_EVENT_EXECUTE_GATHER:
 			event_name = "ExecuteGather";
 			break;
@@ -3818,6 +3828,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_HASH_GROW_BUCKETS_REINSERT:
 			event_name = "HashGrowBucketsReinsert";
 			break;
+		case WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE:
+			event_name = "LogicalParallelApplyStateChange";
+			break;
 		case WAIT_EVENT_LOGICAL_SYNC_DATA:
 			event_name = "LogicalSyncData";
 			break;
@@ -3845,6 +3858,15 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_PARALLEL_FINISH:
 			event_name = "ParallelFinish";
 			break;
+		case WAIT_EVENT_PARALLEL_MATERIAL:
+			event_name = "ParallelMaterial";
+			break;
+		case WAIT_EVENT_PARALLEL_SORT:
+			event_name = "ParallelSort";
+			break;
+		case WAIT_EVENT_PLAN_PROGRESS:
+			event_name = "PlanProgress";
+			break;
 		case WAIT_EVENT_PROCARRAY_GROUP_UPDATE:
 			event_name = "ProcArrayGroupUpdate";
 			break;
@@ -3860,9 +3882,15 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_RECOVERY_CONFLICT_TABLESPACE:
 			event_name = "RecoveryConflictTablespace";
 			break;
+		case WAIT_EVENT_RECOVERY_PARALLEL_REDO:
+			event_name = "RecoveryParallelRedo";
+			break;
 		case WAIT_EVENT_RECOVERY_PAUSE:
 			event_name = "RecoveryPause";
 			break;
+		case WAIT_EVENT_REPARTITION_WRITE:
+			event_name = "RepartitionWrite";
+			break;
 		case WAIT_EVENT_REPLICATION_ORIGIN_DROP:
 			event_name = "ReplicationOriginDrop";
 			break;
@@ -3988,6 +4016,15 @@ pgstat_get_wait_io(WaitEventIO w)
 		case WAIT_EVENT_DATA_FILE_WRITE:
 			event_name = "DataFileWrite";
 			break;
+		case WAIT_EVENT_DOUBLE_WRITE_READ:
+			event_name = "DoubleWriteRead";
+			break;
+		case WAIT_EVENT_DOUBLE_WRITE_SYNC:
+			event_name = "DoubleWriteSync";
+			break;
+		case WAIT_EVENT_DOUBLE_WRITE_WRITE:
+			event_name = "DoubleWriteWrite";
+			break;
 		case WAIT_EVENT_DSM_FILL_ZERO_WRITE:
 			event_name = "DSMFillZeroWrite";
 			break;
@@ -4387,6 +4424,11 @@ pgstat_send_bgwriter(void)
 	/* We assume this initializes to zeroes */
 	static const PgStat_MsgBgWriter all_zeroes;
 
+	/* Buffer usage, I/O and LWLock counters are kept in shared memory */
+	BufferStatsFlush(false);
+	pgstat_flush_io(false);
+	LWLockStatsFlush(false);
+
 	/*
 	 * This function can be called even if nothing at all has happened. In
 	 * this case, avoid sending a completely empty message to the stats
@@ -4595,12 +4637,8 @@ PgstatCollectorMain(int argc, char *argv[])
 					pgstat_recv_inquiry(&msg.msg_inquiry, len);
 					break;
 
-				case PGSTAT_MTYPE_TABSTAT:
-					pgstat_recv_tabstat(&msg.msg_tabstat, len);
-					break;
-
-				case PGSTAT_MTYPE_TABPURGE:
-					pgstat_recv_tabpurge(&msg.msg_tabpurge, len);
+				case PGSTAT_MTYPE_DBSTAT:
+					pgstat_recv_dbstat(&msg.msg_dbstat, len);
 					break;
 
 				case PGSTAT_MTYPE_DROPDB:
@@ -4630,14 +4668,6 @@ PgstatCollectorMain(int argc, char *argv[])
 					pgstat_recv_autovac(&msg.msg_autovacuum_start, len);
 					break;
 
-				case PGSTAT_MTYPE_VACUUM:
-					pgstat_recv_vacuum(&msg.msg_vacuum, len);
-					break;
-
-				case PGSTAT_MTYPE_ANALYZE:
-					pgstat_recv_analyze(&msg.msg_analyze, len);
-					break;
-
 				case PGSTAT_MTYPE_ARCHIVER:
 					pgstat_recv_archiver(&msg.msg_archiver, len);
 					break;
@@ -4755,13 +4785,6 @@ reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
 	dbentry->stats_timestamp = 0;
 
 	memset(&hash_ctl, 0, sizeof(hash_ctl));
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-	dbentry->tables = hash_create("Per-database table",
-								  PGSTAT_TAB_HASH_SIZE,
-								  &hash_ctl,
-								  HASH_ELEM | HASH_BLOBS);
-
 	hash_ctl.keysize = sizeof(Oid);
 	hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
 	dbentry->functions = hash_create("Per-database function",
@@ -4791,8 +4814,8 @@ pgstat_get_db_entry(Oid databaseid, bool create)
 		return NULL;
 
 	/*
-	 * If not found, initialize the new one.  This creates empty hash tables
-	 * for tables and functions, too.
+	 * If not found, initialize the new one.  This creates an empty hash table
+	 * for functions, too.
 	 */
 	if (!found)
 		reset_dbentry_counters(result);
@@ -4801,56 +4824,6 @@ pgstat_get_db_entry(Oid databaseid, bool create)
 }
 
 
-/*
- * Lookup the hash table entry for the specified table. If no hash
- * table entry exists, initialize it, if the create parameter is true.
- * Else, return NULL.
- */
-static PgStat_StatTabEntry *
-pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
-{
-	PgStat_StatTabEntry *result;
-	bool		found;
-	HASHACTION	action = (create ? HASH_ENTER : HASH_FIND);
-
-	/* Lookup or create the hash table entry for this table */
-	result = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-												 &tableoid,
-												 action, &found);
-
-	if (!create && !found)
-		return NULL;
-
-	/* If not found, initialize the new one. */
-	if (!found)
-	{
-		result->numscans = 0;
-		result->tuples_returned = 0;
-		result->tuples_fetched = 0;
-		result->tuples_inserted = 0;
-		result->tuples_updated = 0;
-		result->tuples_deleted = 0;
-		result->tuples_hot_updated = 0;
-		result->n_live_tuples = 0;
-		result->n_dead_tuples = 0;
-		result->changes_since_analyze = 0;
-		result->inserts_since_vacuum = 0;
-		result->blocks_fetched = 0;
-		result->blocks_hit = 0;
-		result->vacuum_timestamp = 0;
-		result->vacuum_count = 0;
-		result->autovac_vacuum_timestamp = 0;
-		result->autovac_vacuum_count = 0;
-		result->analyze_timestamp = 0;
-		result->analyze_count = 0;
-		result->autovac_analyze_timestamp = 0;
-		result->autovac_analyze_count = 0;
-	}
-
-	return result;
-}
-
-
 /* ----------
  * pgstat_write_statsfiles() -
  *		Write the global statistics file, as well as requested DB files.
@@ -4928,8 +4901,8 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
 	{
 		/*
-		 * Write out the table and function stats for this DB into the
-		 * appropriate per-DB stat file, if required.
+		 * Write out the function stats for this DB into the appropriate
+		 * per-DB stat file, if required.
 		 */
 		if (allDbs || pgstat_db_requested(dbentry->databaseid))
 		{
@@ -4940,11 +4913,11 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 		}
 
 		/*
-		 * Write out the DB entry. We don't write the tables or functions
-		 * pointers, since they're of no use to any other process.
+		 * Write out the DB entry. We don't write the functions pointer,
+		 * since it's of no use to any other process.
 		 */
 		fputc('D', fpout);
-		rc = fwrite(dbentry, offsetof(PgStat_StatDBEntry, tables), 1, fpout);
+		rc = fwrite(dbentry, offsetof(PgStat_StatDBEntry, functions), 1, fpout);
 		(void) rc;				/* we'll check for error with ferror */
 	}
 
@@ -5025,9 +4998,7 @@ get_dbstat_filename(bool permanent, bool tempname, Oid databaseid,
 static void
 pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
 {
-	HASH_SEQ_STATUS tstat;
 	HASH_SEQ_STATUS fstat;
-	PgStat_StatTabEntry *tabentry;
 	PgStat_StatFuncEntry *funcentry;
 	FILE	   *fpout;
 	int32		format_id;
@@ -5061,17 +5032,6 @@ pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
 	rc = fwrite(&format_id, sizeof(format_id), 1, fpout);
 	(void) rc;					/* we'll check for error with ferror */
 
-	/*
-	 * Walk through the database's access stats per table.
-	 */
-	hash_seq_init(&tstat, dbentry->tables);
-	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&tstat)) != NULL)
-	{
-		fputc('T', fpout);
-		rc = fwrite(tabentry, sizeof(PgStat_StatTabEntry), 1, fpout);
-		(void) rc;				/* we'll check for error with ferror */
-	}
-
 	/*
 	 * Walk through the database's function stats table.
 	 */
@@ -5133,7 +5093,7 @@ pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
  *
  *	If 'onlydb' is not InvalidOid, it means we only want data for that DB
  *	plus the shared catalogs ("DB 0").  We'll still populate the DB hash
- *	table for all databases, but we don't bother even creating table/function
+ *	table for all databases, but we don't bother even creating function
  *	hash tables for other databases.
  *
  *	'permanent' specifies reading from the permanent files not temporary ones.
@@ -5141,8 +5101,8 @@ pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
  *	files after reading; the in-memory status is now authoritative, and the
  *	files would be out of date in case somebody else reads them.
  *
- *	If a 'deep' read is requested, table/function stats are read, otherwise
- *	the table/function hash tables remain empty.
+ *	If a 'deep' read is requested, function stats are read, otherwise the
+ *	function hash tables remain empty.
  * ----------
  */
 static HTAB *
@@ -5280,8 +5240,8 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 				 * follows.
 				 */
 			case 'D':
-				if (fread(&dbbuf, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
+				if (fread(&dbbuf, 1, offsetof(PgStat_StatDBEntry, functions),
+						  fpin) != offsetof(PgStat_StatDBEntry, functions))
 				{
 					ereport(pgStatRunningInCollector ? LOG : WARNING,
 							(errmsg("corrupted statistics file \"%s\"",
@@ -5305,7 +5265,6 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 				}
 
 				memcpy(dbentry, &dbbuf, sizeof(PgStat_StatDBEntry));
-				dbentry->tables = NULL;
 				dbentry->functions = NULL;
 
 				/*
@@ -5318,7 +5277,7 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 					dbentry->stats_timestamp = 0;
 
 				/*
-				 * Don't create tables/functions hashtables for uninteresting
+				 * Don't create functions hashtables for uninteresting
 				 * databases.
 				 */
 				if (onlydb != InvalidOid)
@@ -5329,14 +5288,6 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 				}
 
 				memset(&hash_ctl, 0, sizeof(hash_ctl));
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->tables = hash_create("Per-database table",
-											  PGSTAT_TAB_HASH_SIZE,
-											  &hash_ctl,
-											  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-
 				hash_ctl.keysize = sizeof(Oid);
 				hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
 				hash_ctl.hcxt = pgStatLocalContext;
@@ -5347,11 +5298,10 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 
 				/*
 				 * If requested, read the data from the database-specific
-				 * file.  Otherwise we just leave the hashtables empty.
+				 * file.  Otherwise we just leave the hashtable empty.
 				 */
 				if (deep)
 					pgstat_read_db_statsfile(dbentry->databaseid,
-											 dbentry->tables,
 											 dbentry->functions,
 											 permanent);
 
@@ -5386,22 +5336,18 @@ done:
  * pgstat_read_db_statsfile() -
  *
  *	Reads in the existing statistics collector file for the given database,
- *	filling the passed-in tables and functions hash tables.
+ *	filling the passed-in functions hash table.
  *
  *	As in pgstat_read_statsfiles, if the permanent file is requested, it is
  *	removed after reading.
  *
- *	Note: this code has the ability to skip storing per-table or per-function
- *	data, if NULL is passed for the corresponding hashtable.  That's not used
- *	at the moment though.
+ *	Note: this code has the ability to skip storing per-function data, if
+ *	NULL is passed for the hashtable.  That's not used at the moment though.
  * ----------
  */
 static void
-pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
-						 bool permanent)
+pgstat_read_db_statsfile(Oid databaseid, HTAB *funchash, bool permanent)
 {
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatTabEntry tabbuf;
 	PgStat_StatFuncEntry funcbuf;
 	PgStat_StatFuncEntry *funcentry;
 	FILE	   *fpin;
@@ -5449,40 +5395,6 @@ pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
 	{
 		switch (fgetc(fpin))
 		{
-				/*
-				 * 'T'	A PgStat_StatTabEntry follows.
-				 */
-			case 'T':
-				if (fread(&tabbuf, 1, sizeof(PgStat_StatTabEntry),
-						  fpin) != sizeof(PgStat_StatTabEntry))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Skip if table data not wanted.
-				 */
-				if (tabhash == NULL)
-					break;
-
-				tabentry = (PgStat_StatTabEntry *) hash_search(tabhash,
-															   (void *) &tabbuf.tableid,
-															   HASH_ENTER, &found);
-
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(tabentry, &tabbuf, sizeof(tabbuf));
-				break;
-
 				/*
 				 * 'F'	A PgStat_StatFuncEntry follows.
 				 */
@@ -5647,8 +5559,8 @@ pgstat_read_db_statsfile_timestamp(Oid databaseid, bool permanent,
 				 * follows.
 				 */
 			case 'D':
-				if (fread(&dbentry, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
+				if (fread(&dbentry, 1, offsetof(PgStat_StatDBEntry, functions),
+						  fpin) != offsetof(PgStat_StatDBEntry, functions))
 				{
 					ereport(pgStatRunningInCollector ? LOG : WARNING,
 							(errmsg("corrupted statistics file \"%s\"",
@@ -5853,6 +5765,7 @@ pgstat_clear_snapshot(void)
 	/* Reset variables */
 	pgStatLocalContext = NULL;
 	pgStatDBHash = NULL;
+	pgStatTabSnapshot = NULL;
 	localBackendStatusTable = NULL;
 	localNumBackends = 0;
 }
@@ -5952,145 +5865,29 @@ pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len)
 
 
 /* ----------
- * pgstat_recv_tabstat() -
+ * pgstat_recv_dbstat() -
  *
  *	Count what the backend has done.
  * ----------
  */
 static void
-pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
+pgstat_recv_dbstat(PgStat_MsgDbstat *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-	int			i;
-	bool		found;
 
 	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
 
-	/*
-	 * Update database-wide stats.
-	 */
 	dbentry->n_xact_commit += (PgStat_Counter) (msg->m_xact_commit);
 	dbentry->n_xact_rollback += (PgStat_Counter) (msg->m_xact_rollback);
 	dbentry->n_block_read_time += msg->m_block_read_time;
 	dbentry->n_block_write_time += msg->m_block_write_time;
-
-	/*
-	 * Process all table entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		PgStat_TableEntry *tabmsg = &(msg->m_entry[i]);
-
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &(tabmsg->t_id),
-													   HASH_ENTER, &found);
-
-		if (!found)
-		{
-			/*
-			 * If it's a new table entry, initialize counters to the values we
-			 * just got.
-			 */
-			tabentry->numscans = tabmsg->t_counts.t_numscans;
-			tabentry->tuples_returned = tabmsg->t_counts.t_tuples_returned;
-			tabentry->tuples_fetched = tabmsg->t_counts.t_tuples_fetched;
-			tabentry->tuples_inserted = tabmsg->t_counts.t_tuples_inserted;
-			tabentry->tuples_updated = tabmsg->t_counts.t_tuples_updated;
-			tabentry->tuples_deleted = tabmsg->t_counts.t_tuples_deleted;
-			tabentry->tuples_hot_updated = tabmsg->t_counts.t_tuples_hot_updated;
-			tabentry->n_live_tuples = tabmsg->t_counts.t_delta_live_tuples;
-			tabentry->n_dead_tuples = tabmsg->t_counts.t_delta_dead_tuples;
-			tabentry->changes_since_analyze = tabmsg->t_counts.t_changed_tuples;
-			tabentry->inserts_since_vacuum = tabmsg->t_counts.t_tuples_inserted;
-			tabentry->blocks_fetched = tabmsg->t_counts.t_blocks_fetched;
-			tabentry->blocks_hit = tabmsg->t_counts.t_blocks_hit;
-
-			tabentry->vacuum_timestamp = 0;
-			tabentry->vacuum_count = 0;
-			tabentry->autovac_vacuum_timestamp = 0;
-			tabentry->autovac_vacuum_count = 0;
-			tabentry->analyze_timestamp = 0;
-			tabentry->analyze_count = 0;
-			tabentry->autovac_analyze_timestamp = 0;
-			tabentry->autovac_analyze_count = 0;
-		}
-		else
-		{
-			/*
-			 * Otherwise add the values to the existing entry.
-			 */
-			tabentry->numscans += tabmsg->t_counts.t_numscans;
-			tabentry->tuples_returned += tabmsg->t_counts.t_tuples_returned;
-			tabentry->tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
-			tabentry->tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
-			tabentry->tuples_updated += tabmsg->t_counts.t_tuples_updated;
-			tabentry->tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
-			tabentry->tuples_hot_updated += tabmsg->t_counts.t_tuples_hot_updated;
-			/* If table was truncated, first reset the live/dead counters */
-			if (tabmsg->t_counts.t_truncated)
-			{
-				tabentry->n_live_tuples = 0;
-				tabentry->n_dead_tuples = 0;
-				tabentry->inserts_since_vacuum = 0;
-			}
-			tabentry->n_live_tuples += tabmsg->t_counts.t_delta_live_tuples;
-			tabentry->n_dead_tuples += tabmsg->t_counts.t_delta_dead_tuples;
-			tabentry->changes_since_analyze += tabmsg->t_counts.t_changed_tuples;
-			tabentry->inserts_since_vacuum += tabmsg->t_counts.t_tuples_inserted;
-			tabentry->blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
-			tabentry->blocks_hit += tabmsg->t_counts.t_blocks_hit;
-		}
-
-		/* Clamp n_live_tuples in case of negative delta_live_tuples */
-		tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
-		/* Likewise for n_dead_tuples */
-		tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
-
-		/*
-		 * Add per-table stats to the per-database entry, too.
-		 */
-		dbentry->n_tuples_returned += tabmsg->t_counts.t_tuples_returned;
-		dbentry->n_tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
-		dbentry->n_tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
-		dbentry->n_tuples_updated += tabmsg->t_counts.t_tuples_updated;
-		dbentry->n_tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
-		dbentry->n_blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
-		dbentry->n_blocks_hit += tabmsg->t_counts.t_blocks_hit;
-	}
-}
-
-
-/* ----------
- * pgstat_recv_tabpurge() -
- *
- *	Arrange for dead table removal.
- * ----------
- */
-static void
-pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	int			i;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->tables)
-		return;
-
-	/*
-	 * Process all table entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->tables,
-						   (void *) &(msg->m_tableid[i]),
-						   HASH_REMOVE, NULL);
-	}
+	dbentry->n_tuples_returned += msg->m_tuples_returned;
+	dbentry->n_tuples_fetched += msg->m_tuples_fetched;
+	dbentry->n_tuples_inserted += msg->m_tuples_inserted;
+	dbentry->n_tuples_updated += msg->m_tuples_updated;
+	dbentry->n_tuples_deleted += msg->m_tuples_deleted;
+	dbentry->n_blocks_fetched += msg->m_blocks_fetched;
+	dbentry->n_blocks_hit += msg->m_blocks_hit;
 }
 
 
@@ -6123,8 +5920,6 @@ pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len)
 		elog(DEBUG2, "removing stats file \"%s\"", statfile);
 		unlink(statfile);
 
-		if (dbentry->tables != NULL)
-			hash_destroy(dbentry->tables);
 		if (dbentry->functions != NULL)
 			hash_destroy(dbentry->functions);
 
@@ -6157,20 +5952,18 @@ pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len)
 		return;
 
 	/*
-	 * We simply throw away all the database's table entries by recreating a
-	 * new hash table for them.
+	 * We simply throw away all the database's function entries by recreating
+	 * a new hash table for them.  The table entries are in shared memory and
+	 * have been reset by the sender.
 	 */
-	if (dbentry->tables != NULL)
-		hash_destroy(dbentry->tables);
 	if (dbentry->functions != NULL)
 		hash_destroy(dbentry->functions);
 
-	dbentry->tables = NULL;
 	dbentry->functions = NULL;
 
 	/*
-	 * Reset database-level stats, too.  This creates empty hash tables for
-	 * tables and functions.
+	 * Reset database-level stats, too.  This creates an empty hash table for
+	 * functions.
 	 */
 	reset_dbentry_counters(dbentry);
 }
@@ -6222,11 +6015,11 @@ pgstat_recv_resetsinglecounter(PgStat_MsgResetsinglecounter *msg, int len)
 	/* Set the reset timestamp for the whole database */
 	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
 
-	/* Remove object if it exists, ignore it if not */
-	if (msg->m_resettype == RESET_TABLE)
-		(void) hash_search(dbentry->tables, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
-	else if (msg->m_resettype == RESET_FUNCTION)
+	/*
+	 * Remove object if it exists, ignore it if not.  Table entries are in
+	 * shared memory and have been reset by the sender.
+	 */
+	if (msg->m_resettype == RESET_FUNCTION)
 		(void) hash_search(dbentry->functions, (void *) &(msg->m_objectid),
 						   HASH_REMOVE, NULL);
 }
@@ -6273,95 +6066,6 @@ pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len)
 	dbentry->last_autovac_time = msg->m_start_time;
 }
 
-/* ----------
- * pgstat_recv_vacuum() -
- *
- *	Process a VACUUM message.
- * ----------
- */
-static void
-pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-
-	/*
-	 * Store the data in the table's hashtable entry.
-	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
-
-	tabentry->n_live_tuples = msg->m_live_tuples;
-	tabentry->n_dead_tuples = msg->m_dead_tuples;
-
-	/*
-	 * It is quite possible that a non-aggressive VACUUM ended up skipping
-	 * various pages, however, we'll zero the insert counter here regardless.
-	 * It's currently used only to track when we need to perform an "insert"
-	 * autovacuum, which are mainly intended to freeze newly inserted tuples.
-	 * Zeroing this may just mean we'll not try to vacuum the table again
-	 * until enough tuples have been inserted to trigger another insert
-	 * autovacuum.  An anti-wraparound autovacuum will catch any persistent
-	 * stragglers.
-	 */
-	tabentry->inserts_since_vacuum = 0;
-
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->autovac_vacuum_count++;
-	}
-	else
-	{
-		tabentry->vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->vacuum_count++;
-	}
-}
-
-/* ----------
- * pgstat_recv_analyze() -
- *
- *	Process an ANALYZE message.
- * ----------
- */
-static void
-pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-
-	/*
-	 * Store the data in the table's hashtable entry.
-	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
-
-	tabentry->n_live_tuples = msg->m_live_tuples;
-	tabentry->n_dead_tuples = msg->m_dead_tuples;
-
-	/*
-	 * If commanded, reset changes_since_analyze to zero.  This forgets any
-	 * changes that were committed while the ANALYZE was in progress, but we
-	 * have no good way to estimate how many of those there were.
-	 */
-	if (msg->m_resetcounter)
-		tabentry->changes_since_analyze = 0;
-
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_analyze_timestamp = msg->m_analyzetime;
-		tabentry->autovac_analyze_count++;
-	}
-	else
-	{
-		tabentry->analyze_timestamp = msg->m_analyzetime;
-		tabentry->analyze_count++;
-	}
-}
-
-
 /* ----------
  * pgstat_recv_archiver() -
  *
@@ -0,0 +1,253 @@
+/*-------------------------------------------------------------------------
+ *
+ * pgstat_io.c
+ *	  I/O statistics by backend type, object and context
+ *
+ * pg_stat_bgwriter only tells how many buffers the background writer, the
+ * checkpointer and all other processes together have written, and
+ * pg_stat_database how many blocks were read.  The counters here break
+ * relation I/O down further: by the type of process doing it, by whether it
+ * concerns shared buffers or the local buffers of temporary relations, and
+ * by the buffer access strategy in use, if any.  Besides reads, writes,
+ * extensions and fsyncs, buffer hits, evictions and reuses of buffers from
+ * a strategy's ring are counted, and with track_io_timing the time spent in
+ * each kind of I/O is measured.
+ *
+ * Processes count into a small local array, and add it to atomic counters
+ * in shared memory at most every PGSTAT_IO_FLUSH_INTERVAL msec, from
+ * pgstat_report_stat() and the main loops of the background writer and
+ * checkpointer, and at process exit.  Counting thus costs next to nothing,
+ * and is safe in critical sections.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/pgstat_io.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/xact.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "storage/shmem.h"
+#include "utils/timestamp.h"
+
+/* minimum time between flushes of the pending counts, in msec */
+#define PGSTAT_IO_FLUSH_INTERVAL	500
+
+typedef struct IOStatsShared
+{
+	pg_atomic_uint64 stat_reset_timestamp;
+	pg_atomic_uint64 counts[BACKEND_NUM_TYPES][IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES][IOOP_NUM_TYPES];
+	pg_atomic_uint64 times[BACKEND_NUM_TYPES][IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES][IOOP_NUM_TYPES];
+} IOStatsShared;
+
+static IOStatsShared *IOStats = NULL;
+
+/* Counts of this process not yet added to the shared counters */
+static PgStat_Counter pendingCounts[IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES][IOOP_NUM_TYPES];
+static PgStat_Counter pendingTimes[IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES][IOOP_NUM_TYPES];
+static bool havePendingIO = false;
+
+/*
+ * Estimate space needed for the shared counters
+ */
+Size
+IOStatsShmemSize(void)
+{
+	return sizeof(IOStatsShared);
+}
+
+/*
+ * Allocate and initialize the shared counters
+ */
+void
+IOStatsShmemInit(void)
+{
+	bool		found;
+	int			b,
+				o,
+				c,
+				op;
+
+	IOStats = (IOStatsShared *)
+		ShmemInitStruct("I/O Stats", sizeof(IOStatsShared), &found);
+
+	if (found)
+		return;
+
+	pg_atomic_init_u64(&IOStats->stat_reset_timestamp,
+					   (uint64) GetCurrentTimestamp());
+	for (b = 0; b < BACKEND_NUM_TYPES; b++)
+		for (o = 0; o < IOOBJECT_NUM_TYPES; o++)
+			for (c = 0; c < IOCONTEXT_NUM_TYPES; c++)
+				for (op = 0; op < IOOP_NUM_TYPES; op++)
+				{
+					pg_atomic_init_u64(&IOStats->counts[b][o][c][op], 0);
+					pg_atomic_init_u64(&IOStats->times[b][o][c][op], 0);
+				}
+}
+
+/*
+ * Count cnt I/O operations of the given kind
+ */
+void
+pgstat_count_io_op_n(IOObject io_object, IOContext io_context, IOOp io_op,
+					 uint32 cnt)
+{
+	pendingCounts[io_object][io_context][io_op] += cnt;
+	havePendingIO = true;
+}
+
+/*
+ * Count the time spent in I/O operations of the given kind, as measured by
+ * callers when track_io_timing is on.  The operations themselves are
+ * counted separately, with pgstat_count_io_op().
+ */
+void
+pgstat_count_io_time(IOObject io_object, IOContext io_context, IOOp io_op,
+					 instr_time io_time)
+{
+	pendingTimes[io_object][io_context][io_op] +=
+		INSTR_TIME_GET_MICROSEC(io_time);
+	havePendingIO = true;
+}
+
+/*
+ * Add the counts of this process to the shared counters
+ *
+ * Unless force is true, this does nothing if the last flush was less than
+ * PGSTAT_IO_FLUSH_INTERVAL msec ago.
+ */
+void
+pgstat_flush_io(bool force)
+{
+	static TimestampTz last_flush = 0;
+	int			o,
+				c,
+				op;
+
+	if (!havePendingIO || IOStats == NULL)
+		return;
+
+	if (!force)
+	{
+		TimestampTz now = GetCurrentTransactionStopTimestamp();
+
+		if (!TimestampDifferenceExceeds(last_flush, now,
+										PGSTAT_IO_FLUSH_INTERVAL))
+			return;
+		last_flush = now;
+	}
+
+	for (o = 0; o < IOOBJECT_NUM_TYPES; o++)
+	{
+		for (c = 0; c < IOCONTEXT_NUM_TYPES; c++)
+		{
+			for (op = 0; op < IOOP_NUM_TYPES; op++)
+			{
+				if (pendingCounts[o][c][op] != 0)
+					pg_atomic_fetch_add_u64(&IOStats->counts[MyBackendType][o][c][op],
+											pendingCounts[o][c][op]);
+				if (pendingTimes[o][c][op] != 0)
+					pg_atomic_fetch_add_u64(&IOStats->times[MyBackendType][o][c][op],
+											pendingTimes[o][c][op]);
+			}
+		}
+	}
+
+	MemSet(pendingCounts, 0, sizeof(pendingCounts));
+	MemSet(pendingTimes, 0, sizeof(pendingTimes));
+	havePendingIO = false;
+}
+
+/*
+ * Copy the shared counters to *result
+ */
+void
+pgstat_fetch_io(PgStat_IOStats *result)
+{
+	int			b,
+				o,
+				c,
+				op;
+
+	result->stat_reset_timestamp = (TimestampTz)
+		pg_atomic_read_u64(&IOStats->stat_reset_timestamp);
+
+	for (b = 0; b < BACKEND_NUM_TYPES; b++)
+		for (o = 0; o < IOOBJECT_NUM_TYPES; o++)
+			for (c = 0; c < IOCONTEXT_NUM_TYPES; c++)
+				for (op = 0; op < IOOP_NUM_TYPES; op++)
+				{
+					result->counts[b][o][c][op] =
+						pg_atomic_read_u64(&IOStats->counts[b][o][c][op]);
+					result->times[b][o][c][op] =
+						pg_atomic_read_u64(&IOStats->times[b][o][c][op]);
+				}
+}
+
+/*
+ * Reset the shared counters
+ *
+ * Counts still pending in other processes are added after the reset.
+ */
+void
+pgstat_reset_io(void)
+{
+	int			b,
+				o,
+				c,
+				op;
+
+	for (b = 0; b < BACKEND_NUM_TYPES; b++)
+		for (o = 0; o < IOOBJECT_NUM_TYPES; o++)
+			for (c = 0; c < IOCONTEXT_NUM_TYPES; c++)
+				for (op = 0; op < IOOP_NUM_TYPES; op++)
+				{
+					pg_atomic_write_u64(&IOStats->counts[b][o][c][op], 0);
+					pg_atomic_write_u64(&IOStats->times[b][o][c][op], 0);
+				}
+
+	pg_atomic_write_u64(&IOStats->stat_reset_timestamp,
+						(uint64) GetCurrentTimestamp());
+}
+
+const char *
+pgstat_get_io_object_name(IOObject io_object)
+{
+	switch (io_object)
+	{
+		case IOOBJECT_RELATION:
+			return "relation";
+		case IOOBJECT_TEMP_RELATION:
+			return "temp relation";
+	}
+
+	elog(ERROR, "unrecognized IOObject value: %d", io_object);
+	return NULL;				/* keep compiler quiet */
+}
+
+const char *
+pgstat_get_io_context_name(IOContext io_context)
+{
+	switch (io_context)
+	{
+		case IOCONTEXT_NORMAL:
+			return "normal";
+		case IOCONTEXT_BULKREAD:
+			return "bulkread";
+		case IOCONTEXT_BULKWRITE:
+			return "bulkwrite";
+		case IOCONTEXT_VACUUM:
+			return "vacuum";
+	}
+
+	elog(ERROR, "unrecognized IOContext value: %d", io_context);
+	return NULL;				/* keep compiler quiet */
+}
@@ -0,0 +1,564 @@
+/*-------------------------------------------------------------------------
+ *
+ * pgstat_tables.c
+ *	  Table and index statistics kept in shared memory
+ *
+ * The statistics collector used to receive every backend's per-table counts
+ * over its UDP socket and had to write them all out to the stats files
+ * whenever any backend wanted to read them, which with many relations meant
+ * rewriting very large files many times per second, and left autovacuum
+ * working from stats that could be several hundred milliseconds old.
+ *
+ * Instead, the per-table counters now live in a dshash table in a DSA area
+ * created in place in the main shared memory segment, growing into DSM
+ * segments as needed.  Backends add their pending counts directly to the
+ * shared entries when pgstat_report_stat() runs, which happens at most
+ * every PGSTAT_STAT_INTERVAL msec; VACUUM and ANALYZE update the entries
+ * they're about; and readers look the entries up directly.  The hash table
+ * is keyed by database and table OID, shared relations using InvalidOid
+ * as database OID, as before.
+ *
+ * Database-wide, function and cluster-wide statistics are still kept by the
+ * collector.
+ *
+ * The contents are written out to PGSTAT_TABLES_FILENAME at shutdown and
+ * read back by the startup process, unless it has to perform recovery, in
+ * which case they are thrown away, like the rest of the statistics.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/pgstat_tables.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <unistd.h>
+
+#include "lib/dshash.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/fd.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/dsa.h"
+#include "utils/memutils.h"
+
+#define PGSTAT_TABLES_FILENAME	PGSTAT_STAT_PERMANENT_DIRECTORY "/tables.stat"
+#define PGSTAT_TABLES_TMPFILE	PGSTAT_STAT_PERMANENT_DIRECTORY "/tables.tmp"
+
+/*
+ * Size of the part of the DSA area that lives in the main shared memory
+ * segment.  Small installations never need more; larger ones get more
+ * memory from DSM segments.
+ */
+#define PGSTAT_TABLES_AREA_SIZE		(1024 * 1024)
+
+typedef struct TabStatKey
+{
+	Oid			databaseid;		/* InvalidOid for shared relations */
+	Oid			tableid;
+} TabStatKey;
+
+typedef struct TabStatSharedEntry
+{
+	TabStatKey	key;			/* hash key --- must be first */
+	PgStat_StatTabEntry stats;
+} TabStatSharedEntry;
+
+typedef struct TabStatShared
+{
+	dshash_table_handle hash_handle;
+	char		area[FLEXIBLE_ARRAY_MEMBER];	/* in-place DSA area */
+} TabStatShared;
+
+static const dshash_parameters tabstat_hash_params = {
+	sizeof(TabStatKey),
+	sizeof(TabStatSharedEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_TABLE_STATS_HASH
+};
+
+static TabStatShared *TabStats = NULL;
+static dsa_area *TabStatArea = NULL;
+static dshash_table *TabStatHash = NULL;
+
+static void attach_table_stats(void);
+static TabStatSharedEntry *get_shared_entry(Oid dbid, Oid tableid);
+
+/*
+ * Estimate space needed for the table statistics
+ */
+Size
+PgStatTablesShmemSize(void)
+{
+	return add_size(offsetof(TabStatShared, area), PGSTAT_TABLES_AREA_SIZE);
+}
+
+/*
+ * Allocate and initialize the table statistics
+ */
+void
+PgStatTablesShmemInit(void)
+{
+	bool		found;
+
+	TabStats = (TabStatShared *)
+		ShmemInitStruct("Table Statistics", PgStatTablesShmemSize(), &found);
+
+	if (!found)
+	{
+		dsa_area   *area;
+		dshash_table *hash;
+
+		/*
+		 * Create the area and the hash table in it.  The postmaster must not
+		 * create DSM segments, so keep the area within the space reserved
+		 * for it while doing so, and lift the limit afterwards.  Backends
+		 * attach to both when they first need them.
+		 */
+		area = dsa_create_in_place(TabStats->area, PGSTAT_TABLES_AREA_SIZE,
+								   LWTRANCHE_TABLE_STATS_DSA, NULL);
+		dsa_pin(area);
+		dsa_set_size_limit(area, PGSTAT_TABLES_AREA_SIZE);
+
+		hash = dshash_create(area, &tabstat_hash_params, NULL);
+		TabStats->hash_handle = dshash_get_hash_table_handle(hash);
+
+		dsa_set_size_limit(area, -1);
+		dshash_detach(hash);
+		dsa_detach(area);
+	}
+}
+
+/*
+ * Attach to the table statistics for the rest of this process's life
+ */
+static void
+attach_table_stats(void)
+{
+	MemoryContext oldcxt;
+
+	if (TabStatHash != NULL)
+		return;
+
+	oldcxt = MemoryContextSwitchTo(TopMemoryContext);
+	TabStatArea = dsa_attach_in_place(TabStats->area, NULL);
+	dsa_pin_mapping(TabStatArea);
+	TabStatHash = dshash_attach(TabStatArea, &tabstat_hash_params,
+								TabStats->hash_handle, NULL);
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * Find or create the entry of a table, and return it exclusively locked
+ */
+static TabStatSharedEntry *
+get_shared_entry(Oid dbid, Oid tableid)
+{
+	TabStatSharedEntry *entry;
+	TabStatKey	key;
+	bool		found;
+
+	attach_table_stats();
+
+	key.databaseid = dbid;
+	key.tableid = tableid;
+	entry = dshash_find_or_insert(TabStatHash, &key, &found);
+
+	if (!found)
+	{
+		MemSet(&entry->stats, 0, sizeof(PgStat_StatTabEntry));
+		entry->stats.tableid = tableid;
+	}
+
+	return entry;
+}
+
+/*
+ * Add the counts a backend has accumulated for a table to the shared entry
+ */
+void
+pgstat_tables_add_counts(Oid dbid, Oid tableid,
+						 const PgStat_TableCounts *counts)
+{
+	TabStatSharedEntry *entry;
+	PgStat_StatTabEntry *tabentry;
+
+	entry = get_shared_entry(dbid, tableid);
+	tabentry = &entry->stats;
+
+	tabentry->numscans += counts->t_numscans;
+	tabentry->tuples_returned += counts->t_tuples_returned;
+	tabentry->tuples_fetched += counts->t_tuples_fetched;
+	tabentry->ios_heap_fetches += counts->t_ios_heap_fetches;
+	tabentry->ios_heap_fetches_avoided += counts->t_ios_heap_fetches_avoided;
+	tabentry->tuples_inserted += counts->t_tuples_inserted;
+	tabentry->tuples_updated += counts->t_tuples_updated;
+	tabentry->tuples_deleted += counts->t_tuples_deleted;
+	tabentry->tuples_hot_updated += counts->t_tuples_hot_updated;
+	/* If table was truncated, first reset the live/dead counters */
+	if (counts->t_truncated)
+	{
+		tabentry->n_live_tuples = 0;
+		tabentry->n_dead_tuples = 0;
+		tabentry->inserts_since_vacuum = 0;
+	}
+	tabentry->n_live_tuples += counts->t_delta_live_tuples;
+	tabentry->n_dead_tuples += counts->t_delta_dead_tuples;
+	tabentry->changes_since_analyze += counts->t_changed_tuples;
+	tabentry->inserts_since_vacuum += counts->t_tuples_inserted;
+	tabentry->blocks_fetched += counts->t_blocks_fetched;
+	tabentry->blocks_hit += counts->t_blocks_hit;
+
+	/* Clamp n_live_tuples in case of negative delta_live_tuples */
+	tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
+	/* Likewise for n_dead_tuples */
+	tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
+
+	dshash_release_lock(TabStatHash, entry);
+}
+
+/*
+ * Record that a table has been vacuumed
+ */
+void
+pgstat_tables_report_vacuum(Oid dbid, Oid tableid, bool autovacuum,
+							TimestampTz vacuumtime,
+							PgStat_Counter livetuples,
+							PgStat_Counter deadtuples)
+{
+	TabStatSharedEntry *entry;
+	PgStat_StatTabEntry *tabentry;
+
+	entry = get_shared_entry(dbid, tableid);
+	tabentry = &entry->stats;
+
+	tabentry->n_live_tuples = livetuples;
+	tabentry->n_dead_tuples = deadtuples;
+
+	/*
+	 * It is quite possible that a non-aggressive VACUUM ended up skipping
+	 * various pages, however, we'll zero the insert counter here regardless.
+	 * It's currently used only to track when we need to perform an "insert"
+	 * autovacuum, which are mainly intended to freeze newly inserted tuples.
+	 * Zeroing this may just mean we'll not try to vacuum the table again
+	 * until enough tuples have been inserted to trigger another insert
+	 * autovacuum.  An anti-wraparound autovacuum will catch any persistent
+	 * stragglers.
+	 */
+	tabentry->inserts_since_vacuum = 0;
+
+	if (autovacuum)
+	{
+		tabentry->autovac_vacuum_timestamp = vacuumtime;
+		tabentry->autovac_vacuum_count++;
+	}
+	else
+	{
+		tabentry->vacuum_timestamp = vacuumtime;
+		tabentry->vacuum_count++;
+	}
+
+	dshash_release_lock(TabStatHash, entry);
+}
+
+/*
+ * Record that a table has been analyzed
+ */
+void
+pgstat_tables_report_analyze(Oid dbid, Oid tableid, bool autovacuum,
+							 TimestampTz analyzetime,
+							 PgStat_Counter livetuples,
+							 PgStat_Counter deadtuples,
+							 bool resetcounter)
+{
+	TabStatSharedEntry *entry;
+	PgStat_StatTabEntry *tabentry;
+
+	entry = get_shared_entry(dbid, tableid);
+	tabentry = &entry->stats;
+
+	tabentry->n_live_tuples = livetuples;
+	tabentry->n_dead_tuples = deadtuples;
+
+	/*
+	 * If commanded, reset changes_since_analyze to zero.  This forgets any
+	 * changes that were committed while the ANALYZE was in progress, but we
+	 * have no good way to estimate how many of those there were.
+	 */
+	if (resetcounter)
+		tabentry->changes_since_analyze = 0;
+
+	if (autovacuum)
+	{
+		tabentry->autovac_analyze_timestamp = analyzetime;
+		tabentry->autovac_analyze_count++;
+	}
+	else
+	{
+		tabentry->analyze_timestamp = analyzetime;
+		tabentry->analyze_count++;
+	}
+
+	dshash_release_lock(TabStatHash, entry);
+}
+
+/*
+ * Copy the statistics of a table into *result.  Returns false if there are
+ * none.
+ */
+bool
+pgstat_tables_fetch(Oid dbid, Oid tableid, PgStat_StatTabEntry *result)
+{
+	TabStatSharedEntry *entry;
+	TabStatKey	key;
+
+	attach_table_stats();
+
+	key.databaseid = dbid;
+	key.tableid = tableid;
+	entry = dshash_find(TabStatHash, &key, false);
+	if (entry == NULL)
+		return false;
+
+	memcpy(result, &entry->stats, sizeof(PgStat_StatTabEntry));
+	dshash_release_lock(TabStatHash, entry);
+
+	return true;
+}
+
+/*
+ * Forget the statistics of a single table
+ */
+void
+pgstat_tables_reset(Oid dbid, Oid tableid)
+{
+	TabStatKey	key;
+
+	attach_table_stats();
+
+	key.databaseid = dbid;
+	key.tableid = tableid;
+	(void) dshash_delete_key(TabStatHash, &key);
+}
+
+/*
+ * Forget the statistics of all tables of a database
+ */
+void
+pgstat_tables_drop_database(Oid dbid)
+{
+	dshash_seq_status status;
+	TabStatSharedEntry *entry;
+
+	attach_table_stats();
+
+	dshash_seq_init(&status, TabStatHash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		if (entry->key.databaseid == dbid)
+			dshash_delete_current(&status);
+	}
+}
+
+/*
+ * Remove the statistics of dead objects: tables of databases not listed in
+ * 'dbids', and tables of database 'dbid' not listed in 'relids'.  Both hash
+ * tables are keyed by OID, as made by pgstat_collect_oids().  Shared
+ * relations are never removed.
+ */
+void
+pgstat_tables_purge(HTAB *dbids, Oid dbid, HTAB *relids)
+{
+	dshash_seq_status status;
+	TabStatSharedEntry *entry;
+
+	attach_table_stats();
+
+	dshash_seq_init(&status, TabStatHash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		Oid			entry_dbid = entry->key.databaseid;
+
+		if (!OidIsValid(entry_dbid))
+			continue;
+
+		if (entry_dbid == dbid)
+		{
+			if (hash_search(relids, &entry->key.tableid, HASH_FIND, NULL) == NULL)
+				dshash_delete_current(&status);
+		}
+		else if (hash_search(dbids, &entry_dbid, HASH_FIND, NULL) == NULL)
+			dshash_delete_current(&status);
+	}
+}
+
+/*
+ * Write the table statistics out to disk.  Called at shutdown, when no
+ * other process changes them anymore.
+ *
+ * A standalone backend shuts down the XLOG machinery in an on_shmem_exit
+ * callback, after its dynamic shared memory has been detached; it writes the
+ * statistics from pgstat_tables_shutdown_hook instead.
+ */
+void
+pgstat_tables_write(void)
+{
+	dshash_seq_status status;
+	TabStatSharedEntry *entry;
+	FILE	   *fpout;
+	int32		format_id;
+	int			rc;
+
+	elog(DEBUG2, "writing stats file \"%s\"", PGSTAT_TABLES_FILENAME);
+
+	fpout = AllocateFile(PGSTAT_TABLES_TMPFILE, PG_BINARY_W);
+	if (fpout == NULL)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not open temporary statistics file \"%s\": %m",
+						PGSTAT_TABLES_TMPFILE)));
+		return;
+	}
+
+	format_id = PGSTAT_FILE_FORMAT_ID;
+	rc = fwrite(&format_id, sizeof(format_id), 1, fpout);
+	(void) rc;					/* we'll check for error with ferror */
+
+	attach_table_stats();
+
+	dshash_seq_init(&status, TabStatHash, false);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		fputc('T', fpout);
+		rc = fwrite(&entry->key, sizeof(TabStatKey), 1, fpout);
+		rc = fwrite(&entry->stats, sizeof(PgStat_StatTabEntry), 1, fpout);
+		(void) rc;				/* we'll check for error with ferror */
+	}
+
+	fputc('E', fpout);
+
+	if (ferror(fpout))
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not write temporary statistics file \"%s\": %m",
+						PGSTAT_TABLES_TMPFILE)));
+		FreeFile(fpout);
+		unlink(PGSTAT_TABLES_TMPFILE);
+	}
+	else if (FreeFile(fpout) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not close temporary statistics file \"%s\": %m",
+						PGSTAT_TABLES_TMPFILE)));
+		unlink(PGSTAT_TABLES_TMPFILE);
+	}
+	else if (durable_rename(PGSTAT_TABLES_TMPFILE, PGSTAT_TABLES_FILENAME,
+							LOG) != 0)
+		unlink(PGSTAT_TABLES_TMPFILE);
+}
+
+/*
+ * before_shmem_exit callback of a standalone backend, see above.
+ */
+void
+pgstat_tables_shutdown_hook(int code, Datum arg)
+{
+	pgstat_tables_write();
+}
+
+/*
+ * Load the table statistics saved at the last shutdown, if any.  The file
+ * is removed afterwards, so that the statistics are not loaded again after
+ * a crash.
+ */
+void
+pgstat_tables_restore(void)
+{
+	FILE	   *fpin;
+	int32		format_id;
+
+	fpin = AllocateFile(PGSTAT_TABLES_FILENAME, PG_BINARY_R);
+	if (fpin == NULL)
+	{
+		if (errno != ENOENT)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not open statistics file \"%s\": %m",
+							PGSTAT_TABLES_FILENAME)));
+		return;
+	}
+
+	elog(DEBUG2, "reading stats file \"%s\"", PGSTAT_TABLES_FILENAME);
+
+	attach_table_stats();
+
+	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
+		format_id != PGSTAT_FILE_FORMAT_ID)
+	{
+		ereport(LOG,
+				(errmsg("corrupted statistics file \"%s\"",
+						PGSTAT_TABLES_FILENAME)));
+		goto done;
+	}
+
+	for (;;)
+	{
+		TabStatKey	key;
+		PgStat_StatTabEntry stats;
+		TabStatSharedEntry *entry;
+		bool		found;
+
+		switch (fgetc(fpin))
+		{
+			case 'T':
+				if (fread(&key, 1, sizeof(key), fpin) != sizeof(key) ||
+					fread(&stats, 1, sizeof(stats), fpin) != sizeof(stats))
+				{
+					ereport(LOG,
+							(errmsg("corrupted statistics file \"%s\"",
+									PGSTAT_TABLES_FILENAME)));
+					goto done;
+				}
+
+				entry = dshash_find_or_insert(TabStatHash, &key, &found);
+				memcpy(&entry->stats, &stats, sizeof(PgStat_StatTabEntry));
+				dshash_release_lock(TabStatHash, entry);
+				break;
+
+			case 'E':
+				goto done;
+
+			default:
+				ereport(LOG,
+						(errmsg("corrupted statistics file \"%s\"",
+								PGSTAT_TABLES_FILENAME)));
+				goto done;
+		}
+	}
+
+done:
+	FreeFile(fpin);
+	pgstat_tables_discard();
+}
+
+/*
+ * Remove the saved table statistics
+ */
+void
+pgstat_tables_discard(void)
+{
+	if (unlink(PGSTAT_TABLES_FILENAME) < 0 && errno != ENOENT)
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not unlink file \"%s\": %m",
+						PGSTAT_TABLES_FILENAME)));
+}
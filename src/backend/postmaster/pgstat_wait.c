@@ -0,0 +1,241 @@
+/*-------------------------------------------------------------------------
+ *
+ * pgstat_wait.c
+ *	  Counting and timing of wait events
+ *
+ * pgstat_report_wait_start() and pgstat_report_wait_end() only advertise
+ * the current wait event in PGPROC, so sampling pg_stat_activity used to be
+ * the only way to see where processes spend their time waiting.  With
+ * track_wait_timing enabled, they also time every wait, and add it to
+ * per-process, per-wait-event counters: the number of waits, their total
+ * duration, and a histogram of their durations with power-of-two buckets.
+ *
+ * Each process owns one PgStat_BackendWaitStats entry in shared memory, at
+ * the same index as its PgBackendStatus entry.  Only the owner writes to it,
+ * so no locking is needed; readers copy the entry out following the
+ * st_changecount protocol.  A process's counters start from zero when it
+ * starts and go away when it exits.
+ *
+ * Timing uses the instr_time infrastructure, that is clock_gettime() on
+ * most platforms, which is cheap where the kernel provides a clock source
+ * readable from user space, such as the TSC on modern x86.  Still, that is
+ * two clock readings for every wait, which is why this is off by default.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/pgstat_wait.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "common/hashfn.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/pg_bitutils.h"
+#include "storage/ipc.h"
+#include "storage/shmem.h"
+
+/* GUC variable */
+bool		track_wait_timing = false;
+
+/* Is a wait being timed right now? */
+bool		pgstat_wait_timing_active = false;
+
+static PgStat_BackendWaitStats *WaitStatsArray = NULL;
+static PgStat_BackendWaitStats *MyWaitStats = NULL;
+
+/* the wait being timed */
+static uint32 waitEventInfo;
+static instr_time waitStart;
+
+static void pgstat_wait_shutdown_hook(int code, Datum arg);
+
+/*
+ * Estimate space needed for the wait event counters
+ */
+Size
+WaitStatsShmemSize(void)
+{
+	return mul_size(sizeof(PgStat_BackendWaitStats), NumBackendStatSlots);
+}
+
+/*
+ * Allocate and initialize the wait event counters
+ */
+void
+WaitStatsShmemInit(void)
+{
+	Size		size = WaitStatsShmemSize();
+	bool		found;
+
+	WaitStatsArray = (PgStat_BackendWaitStats *)
+		ShmemInitStruct("Wait Event Stats", size, &found);
+
+	if (!found)
+		MemSet(WaitStatsArray, 0, size);
+}
+
+/*
+ * Set up the counters of this process, which owns the given slot of the
+ * PgBackendStatus array.  Called from pgstat_initialize().
+ */
+void
+pgstat_wait_initialize(int slot)
+{
+	volatile PgStat_BackendWaitStats *stats;
+
+	Assert(slot >= 0 && slot < NumBackendStatSlots);
+	MyWaitStats = &WaitStatsArray[slot];
+	stats = MyWaitStats;
+
+	/* Forget about the previous owner of the slot */
+	PGSTAT_BEGIN_WRITE_ACTIVITY(stats);
+	stats->procpid = MyProcPid;
+	stats->userid = InvalidOid;
+	MemSet(unvolatize(PgStat_WaitEventCounts *, &stats->events[0]), 0,
+		   sizeof(stats->events));
+	PGSTAT_END_WRITE_ACTIVITY(stats);
+
+	on_shmem_exit(pgstat_wait_shutdown_hook, 0);
+}
+
+/*
+ * Record the user this process is running as, for permission checks of
+ * readers.  Called from pgstat_bestart().
+ */
+void
+pgstat_wait_bestart(Oid userid)
+{
+	volatile PgStat_BackendWaitStats *stats = MyWaitStats;
+
+	Assert(stats != NULL);
+
+	PGSTAT_BEGIN_WRITE_ACTIVITY(stats);
+	stats->userid = userid;
+	PGSTAT_END_WRITE_ACTIVITY(stats);
+}
+
+/*
+ * Mark our entry unused at process exit.
+ */
+static void
+pgstat_wait_shutdown_hook(int code, Datum arg)
+{
+	volatile PgStat_BackendWaitStats *stats = MyWaitStats;
+
+	pgstat_wait_timing_active = false;
+
+	PGSTAT_BEGIN_WRITE_ACTIVITY(stats);
+	stats->procpid = 0;
+	PGSTAT_END_WRITE_ACTIVITY(stats);
+
+	MyWaitStats = NULL;
+}
+
+/*
+ * Start timing a wait.  Called by pgstat_report_wait_start() when
+ * track_wait_timing is on.
+ */
+void
+pgstat_wait_timing_start(uint32 wait_event_info)
+{
+	if (MyWaitStats == NULL)
+		return;
+
+	waitEventInfo = wait_event_info;
+	INSTR_TIME_SET_CURRENT(waitStart);
+	pgstat_wait_timing_active = true;
+}
+
+/*
+ * Finish timing a wait, and count it.  Called by pgstat_report_wait_end()
+ * if pgstat_wait_timing_start() has been called.
+ *
+ * This runs in all sorts of places, including critical sections and error
+ * recovery, so it must not fail.
+ */
+void
+pgstat_wait_timing_end(void)
+{
+	volatile PgStat_BackendWaitStats *stats = MyWaitStats;
+	volatile PgStat_WaitEventCounts *counts;
+	instr_time	duration;
+	uint64		usecs;
+	int			bucket;
+	int			slot;
+	int			i;
+
+	pgstat_wait_timing_active = false;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, waitStart);
+	usecs = INSTR_TIME_GET_MICROSEC(duration);
+
+	if (usecs == 0)
+		bucket = 0;
+	else
+		bucket = Min(pg_leftmost_one_pos64(usecs) + 1,
+					 PGSTAT_WAIT_HIST_BUCKETS - 1);
+
+	/*
+	 * Find the wait event's slot, or a free one, by linear probing.  Slots
+	 * are never freed, so the first free slot ends the search.
+	 */
+	slot = hash_bytes_uint32(waitEventInfo) % PGSTAT_WAIT_EVENT_SLOTS;
+	for (i = 0; i < PGSTAT_WAIT_EVENT_SLOTS; i++)
+	{
+		counts = &stats->events[slot];
+		if (counts->wait_event_info == waitEventInfo ||
+			counts->wait_event_info == 0)
+			break;
+		slot = (slot + 1) % PGSTAT_WAIT_EVENT_SLOTS;
+	}
+	if (i == PGSTAT_WAIT_EVENT_SLOTS)
+		return;					/* no room */
+
+	PGSTAT_BEGIN_WRITE_ACTIVITY(stats);
+	counts->wait_event_info = waitEventInfo;
+	counts->calls++;
+	counts->total_time += usecs;
+	counts->histogram[bucket]++;
+	PGSTAT_END_WRITE_ACTIVITY(stats);
+}
+
+/*
+ * Copy the wait event counters in the given slot to *result.  Returns false
+ * if the slot number is past the end of the array; callers loop over slots
+ * starting from 0 until then.  Unused entries have procpid set to 0.
+ */
+bool
+pgstat_fetch_wait_stats(int slot, PgStat_BackendWaitStats *result)
+{
+	volatile PgStat_BackendWaitStats *stats;
+
+	if (slot < 0 || slot >= NumBackendStatSlots)
+		return false;
+
+	stats = &WaitStatsArray[slot];
+	for (;;)
+	{
+		int			before_changecount;
+		int			after_changecount;
+
+		pgstat_begin_read_activity(stats, before_changecount);
+		memcpy(result, unvolatize(PgStat_BackendWaitStats *, stats),
+			   sizeof(PgStat_BackendWaitStats));
+		pgstat_end_read_activity(stats, after_changecount);
+
+		if (pgstat_read_activity_complete(before_changecount,
+										  after_changecount))
+			break;
+
+		/* Make sure we can break out of loop if stuck... */
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	return true;
+}
@@ -113,6 +113,7 @@
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/fork_process.h"
 #include "postmaster/pgarch.h"
+#include "postmaster/proxy.h"
 #include "postmaster/postmaster.h"
 #include "postmaster/syslogger.h"
 #include "replication/logicallauncher.h"
@@ -122,6 +123,7 @@
 #include "storage/pg_shmem.h"
 #include "storage/pmsignal.h"
 #include "storage/proc.h"
+#include "storage/sinval.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
 #include "utils/datetime.h"
@@ -182,6 +184,9 @@ typedef struct bkend
 	int			bkend_type;		/* child process flavor, see above */
 	bool		dead_end;		/* is it going to send an error and quit? */
 	bool		bgworker_notify;	/* gets bgworker start/stop notifications */
+	int			prefork_db;		/* PreforkDatabaseList index of a pre-forked
+								 * backend waiting for a client, else -1 */
+	pgsocket	prefork_sock;	/* socket to hand it the client through */
 	dlist_node	elem;			/* list link in BackendList */
 } Backend;
 
@@ -219,6 +224,10 @@ int			ReservedBackends;
 #define MAXLISTEN	64
 static pgsocket ListenSocket[MAXLISTEN];
 
+/* The wait event set ServerLoop waits on, and whether it has the sockets */
+static WaitEventSet *pm_wait_set;
+static bool pm_wait_set_accepting = false;
+
 /*
  * Set by the -o option
  */
@@ -248,6 +257,9 @@ bool		enable_bonjour = false;
 char	   *bonjour_name;
 bool		restart_after_crash = true;
 
+int			PreforkBackends = 0;
+char	   *PreforkDatabases = NULL;
+
 /* PIDs of special child processes; 0 when not running */
 static pid_t StartupPID = 0,
 			BgWriterPID = 0,
@@ -259,6 +271,57 @@ static pid_t StartupPID = 0,
 			PgStatPID = 0,
 			SysLoggerPID = 0;
 
+/* PIDs of the connection proxies, connection_proxies of them */
+static pid_t *ProxyPIDs = NULL;
+
+/*
+ * Pools of pre-forked backends, prefork_backends of them for each database
+ * in prefork_databases.  See StartPreforkedBackend().
+ */
+typedef struct PreforkDatabase
+{
+	char		name[NAMEDATALEN];
+	int			nbackends;		/* backends in the pool */
+	time_t		restart_time;	/* don't start any before this time */
+} PreforkDatabase;
+
+static PreforkDatabase *PreforkDatabaseList = NULL;
+static int	NumPreforkDatabases = 0;
+static int	NumPreforkedBackends = 0;	/* in all pools */
+
+/* In a pre-forked backend, its end of the socket pair to the postmaster */
+static pgsocket PreforkSocket = PGINVALID_SOCKET;
+
+/*
+ * New connections that might go to a pre-forked backend, waiting for their
+ * startup packet to arrive.  We wait PREFORK_ROUTE_TIMEOUT msec at most,
+ * checking at least every PREFORK_POLL_INTERVAL msec.
+ */
+typedef struct PendingConnection
+{
+	Port	   *port;
+	TimestampTz accept_time;
+	bool		readable;		/* has the startup packet arrived? */
+} PendingConnection;
+
+#define PREFORK_MAX_PENDING		64
+#define PREFORK_ROUTE_TIMEOUT	50
+#define PREFORK_POLL_INTERVAL	10
+
+static PendingConnection PendingConnections[PREFORK_MAX_PENDING];
+static int	NumPendingConnections = 0;
+static bool PendingConnectionsChanged = false;
+
+/* How long to wait before replacing a pre-forked backend that failed, in s */
+#define PREFORK_RESTART_INTERVAL 10
+
+typedef enum
+{
+	PREFORK_ROUTE_HANDED_OFF,	/* a pre-forked backend got the connection */
+	PREFORK_ROUTE_FORK,			/* start a new backend for it */
+	PREFORK_ROUTE_WAIT			/* startup packet not there yet */
+} PreforkRoute;
+
 /* Startup process's status */
 typedef enum
 {
@@ -395,6 +458,7 @@ static DNSServiceRef bonjour_sdref = NULL;
  * postmaster.c - function prototypes
  */
 static void CloseServerPorts(int status, Datum arg);
+static void SetRemoteHost(Port *port);
 static void unlink_external_pid_file(int status, Datum arg);
 static void getInstallationPaths(const char *argv0);
 static void checkControlFile(void);
@@ -415,14 +479,16 @@ static void LogChildExit(int lev, const char *procname,
 						 int pid, int exitstatus);
 static void PostmasterStateMachine(void);
 static void BackendInitialize(Port *port);
-static void BackendRun(Port *port) pg_attribute_noreturn();
+static void LogConnectionReceived(Port *port);
+static void InitConnectionPsDisplay(Port *port);
+static void BackendRun(const char *dbname, const char *username) pg_attribute_noreturn();
 static void ExitPostmaster(int status) pg_attribute_noreturn();
 static int	ServerLoop(void);
 static int	BackendStartup(Port *port);
 static int	ProcessStartupPacket(Port *port, bool ssl_done, bool gss_done);
 static void SendNegotiateProtocolVersion(List *unrecognized_protocol_options);
 static void processCancelRequest(Port *port, void *pkt);
-static int	initMasks(fd_set *rmask);
+static void ConfigurePostmasterWaitSet(bool accept_connections);
 static void report_fork_failure_to_client(Port *port, int errnum);
 static CAC_state canAcceptConnections(int backend_type);
 static bool RandomCancelKey(int32 *cancel_key);
@@ -433,6 +499,19 @@ static void TerminateChildren(int signal);
 #define SignalChildren(sig)			   SignalSomeChildren(sig, BACKEND_TYPE_ALL)
 
 static int	CountChildren(int target);
+static void StartProxies(void);
+static void SignalProxies(int signal);
+static int	CountProxies(void);
+static bool CleanupProxy(int pid, int exitstatus);
+static void LoadPreforkDatabases(void);
+static void MaintainPreforkedBackends(void);
+static bool StartPreforkedBackend(int dbidx);
+static void ReleasePreforkedBackend(Backend *bp);
+static void RetirePreforkedBackends(void);
+static bool RouteToPreforkedBackend(Port *port);
+static PreforkRoute RouteConnection(Port *port);
+static bool PreforkHandOff(Backend *bp, Port *port);
+static void ProcessPendingConnections(void);
 static bool assign_backendlist_entry(RegisteredBgWorker *rw);
 static void maybe_start_bgworkers(void);
 static bool CreateOptsFile(int argc, char *argv[], char *fullprogname);
@@ -526,6 +605,7 @@ typedef struct
 	bool		IsBinaryUpgrade;
 	int			max_safe_fds;
 	int			MaxBackends;
+	int			FastPathLockGroupsPerBackend;
 #ifdef WIN32
 	HANDLE		PostmasterHandle;
 	HANDLE		initial_signal_pipe;
@@ -587,6 +667,7 @@ PostmasterMain(int argc, char *argv[])
 	bool		listen_addr_saved = false;
 	int			i;
 	char	   *output_config_variable = NULL;
+	char	   *proxySocketDir = NULL;
 
 	InitProcessGlobals();
 
@@ -618,6 +699,12 @@ PostmasterMain(int argc, char *argv[])
 	/* Initialize paths to installation files */
 	getInstallationPaths(argv[0]);
 
+	/*
+	 * Set up the process-local latch that the signal handlers set to wake up
+	 * ServerLoop.
+	 */
+	InitProcessLocalLatch();
+
 	/*
 	 * Set up signal handlers for the postmaster process.
 	 *
@@ -632,10 +719,9 @@ PostmasterMain(int argc, char *argv[])
 	 *
 	 * 2. We do not set the SA_RESTART flag.  This is because signals will be
 	 * blocked at all times except when ServerLoop is waiting for something to
-	 * happen, and during that window, we want signals to exit the select(2)
-	 * wait so that ServerLoop can respond if anything interesting happened.
-	 * On some platforms, signals marked SA_RESTART would not cause the
-	 * select() wait to end.
+	 * happen, and during that window, we want signals to interrupt the wait
+	 * so that the handlers run promptly.  The handlers set our latch, so that
+	 * ServerLoop can respond if anything interesting happened.
 	 *
 	 * Child processes will generally want SA_RESTART, so pqsignal() sets that
 	 * flag.  We expect children to set up their own handlers before
@@ -1013,9 +1099,11 @@ PostmasterMain(int argc, char *argv[])
 
 	/*
 	 * Now that loadable modules have had their chance to register background
-	 * workers, calculate MaxBackends.
+	 * workers, calculate MaxBackends.  The fast-path lock array size is
+	 * fixed at the same time.
 	 */
 	InitializeMaxBackends();
+	InitializeFastPathLocks();
 
 	/*
 	 * Set up shared memory and semaphores.
@@ -1269,7 +1357,10 @@ PostmasterMain(int argc, char *argv[])
 				success++;
 				/* record the first successful Unix socket in lockfile */
 				if (success == 1)
+				{
 					AddToDataDirLockFile(LOCK_FILE_LINE_SOCKET_DIR, socketdir);
+					proxySocketDir = pstrdup(socketdir);
+				}
 			}
 			else
 				ereport(WARNING,
@@ -1293,6 +1384,16 @@ PostmasterMain(int argc, char *argv[])
 		ereport(FATAL,
 				(errmsg("no socket created for listening")));
 
+	/*
+	 * Set up the sockets of the connection proxies, if any.  They reach the
+	 * backends they start through our first Unix-domain socket.
+	 */
+	ProxyInitListen(proxySocketDir);
+	ProxyPIDs = palloc0(ConnectionProxies * sizeof(pid_t));
+
+	/* Likewise for the pools of pre-forked backends */
+	LoadPreforkDatabases();
+
 	/*
 	 * If no valid TCP ports, write an empty line for listen address,
 	 * indicating the Unix socket must be used.  Note that this line is not
@@ -1444,6 +1545,7 @@ CloseServerPorts(int status, Datum arg)
 			ListenSocket[i] = PGINVALID_SOCKET;
 		}
 	}
+	ProxyCloseListen();
 
 	/*
 	 * Next, remove any filesystem entries for Unix sockets.  To avoid race
@@ -1656,101 +1758,110 @@ DetermineSleepTime(struct timeval *timeout)
 static int
 ServerLoop(void)
 {
-	fd_set		readmask;
-	int			nSockets;
 	time_t		last_lockfile_recheck_time,
 				last_touch_time;
+	WaitEvent	events[MAXLISTEN + PREFORK_MAX_PENDING + 1];
+	int			nevents;
 
 	last_lockfile_recheck_time = last_touch_time = time(NULL);
 
-	nSockets = initMasks(&readmask);
-
 	for (;;)
 	{
-		fd_set		rmask;
-		int			selres;
+		struct timeval timeout;
+		long		cur_timeout;
+		bool		accept_connections;
 		time_t		now;
+		int			i;
 
 		/*
-		 * Wait for a connection request to arrive.
-		 *
-		 * We block all signals except while sleeping. That makes it safe for
-		 * signal handlers, which again block all signals while executing, to
-		 * do nontrivial work.
-		 *
 		 * If we are in PM_WAIT_DEAD_END state, then we don't want to accept
-		 * any new connections, so we don't call select(), and just sleep.
+		 * any new connections, so we only wait for signals, and sleep at most
+		 * 100 msec at a time.  Otherwise, wait for a connection request or
+		 * the startup packet of a pending connection to arrive as well.
+		 *
+		 * The wait event set is kept from one iteration to the next, and
+		 * rebuilt only when what we wait for changes.
 		 */
-		memcpy((char *) &rmask, (char *) &readmask, sizeof(fd_set));
-
-		if (pmState == PM_WAIT_DEAD_END)
-		{
-			PG_SETMASK(&UnBlockSig);
-
-			pg_usleep(100000L); /* 100 msec seems reasonable */
-			selres = 0;
-
-			PG_SETMASK(&BlockSig);
-		}
+		accept_connections = (pmState != PM_WAIT_DEAD_END);
+		if (pm_wait_set == NULL ||
+			accept_connections != pm_wait_set_accepting ||
+			PendingConnectionsChanged)
+			ConfigurePostmasterWaitSet(accept_connections);
+
+		if (!accept_connections)
+			cur_timeout = 100L; /* 100 msec seems reasonable */
 		else
 		{
-			/* must set timeout each time; some OSes change it! */
-			struct timeval timeout;
-
 			/* Needs to run with blocked signals! */
 			DetermineSleepTime(&timeout);
+			cur_timeout = timeout.tv_sec * 1000L + timeout.tv_usec / 1000L;
 
-			PG_SETMASK(&UnBlockSig);
-
-			selres = select(nSockets, &rmask, NULL, NULL, &timeout);
-
-			PG_SETMASK(&BlockSig);
-		}
-
-		/* Now check the select() result */
-		if (selres < 0)
-		{
-			if (errno != EINTR && errno != EWOULDBLOCK)
-			{
-				ereport(LOG,
-						(errcode_for_socket_access(),
-						 errmsg("select() failed in postmaster: %m")));
-				return STATUS_ERROR;
-			}
+			/*
+			 * Don't keep pending connections waiting for long, and check
+			 * every second whether the pools of pre-forked backends can be
+			 * filled up.
+			 */
+			if (NumPendingConnections > 0)
+				cur_timeout = Min(cur_timeout, PREFORK_POLL_INTERVAL);
+			else if (NumPreforkedBackends < NumPreforkDatabases * PreforkBackends)
+				cur_timeout = Min(cur_timeout, 1000L);
 		}
 
 		/*
-		 * New connection pending on any of our sockets? If so, fork a child
-		 * process to deal with it.
+		 * We block all signals except while sleeping. That makes it safe for
+		 * signal handlers, which again block all signals while executing, to
+		 * do nontrivial work.  They set our latch to end the wait.
 		 */
-		if (selres > 0)
+		PG_SETMASK(&UnBlockSig);
+
+		nevents = WaitEventSetWait(pm_wait_set, cur_timeout,
+								   events, lengthof(events),
+								   0 /* postmaster posts no wait_events */ );
+
+		PG_SETMASK(&BlockSig);
+
+		for (i = 0; i < nevents; i++)
 		{
-			int			i;
+			if (events[i].events & WL_LATCH_SET)
+				ResetLatch(MyLatch);
+			else if (events[i].user_data != NULL)
+			{
+				/* The startup packet of a pending connection has arrived */
+				Port	   *pending = (Port *) events[i].user_data;
 
-			for (i = 0; i < MAXLISTEN; i++)
+				for (int j = 0; j < NumPendingConnections; j++)
+				{
+					if (PendingConnections[j].port == pending)
+						PendingConnections[j].readable = true;
+				}
+			}
+			else if (events[i].events & WL_SOCKET_ACCEPT)
 			{
-				if (ListenSocket[i] == PGINVALID_SOCKET)
-					break;
-				if (FD_ISSET(ListenSocket[i], &rmask))
+				/*
+				 * New connection pending on one of our sockets.  Fork a child
+				 * process to deal with it.
+				 */
+				Port	   *port;
+
+				port = ConnCreate(events[i].fd);
+				if (port && !RouteToPreforkedBackend(port))
 				{
-					Port	   *port;
+					BackendStartup(port);
 
-					port = ConnCreate(ListenSocket[i]);
-					if (port)
-					{
-						BackendStartup(port);
-
-						/*
-						 * We no longer need the open socket or port structure
-						 * in this process
-						 */
-						StreamClose(port->sock);
-						ConnFree(port);
-					}
+					/*
+					 * We no longer need the open socket or port structure in
+					 * this process
+					 */
+					StreamClose(port->sock);
+					ConnFree(port);
 				}
 			}
 		}
 
+		/* Deal with connections waiting for their startup packet */
+		if (NumPendingConnections > 0)
+			ProcessPendingConnections();
+
 		/* If we have lost the log collector, try to start a new one */
 		if (SysLoggerPID == 0 && Logging_collector)
 			SysLoggerPID = SysLogger_Start();
@@ -1801,6 +1912,14 @@ ServerLoop(void)
 		if (PgArchPID == 0 && PgArchStartupAllowed())
 			PgArchPID = pgarch_start();
 
+		/* Likewise for the connection proxies, while we accept connections */
+		if ((pmState == PM_RUN || pmState == PM_HOT_STANDBY) &&
+			connsAllowed == ALLOW_ALL_CONNS)
+			StartProxies();
+
+		/* Fill up the pools of pre-forked backends, or empty them */
+		MaintainPreforkedBackends();
+
 		/* If we need to signal the autovacuum launcher, do so now */
 		if (avlauncher_needs_signal)
 		{
@@ -1890,30 +2009,46 @@ ServerLoop(void)
 }
 
 /*
- * Initialise the masks for select() for the ports we are listening on.
- * Return the number of sockets to listen on.
+ * (Re)build the wait event set ServerLoop waits on: our latch, which the
+ * signal handlers set, and unless accept_connections is false, the sockets
+ * we are listening on and the sockets of pending connections.
+ *
+ * A WaitEventSet has no way to remove a socket, so we start over whenever
+ * the pending connections change.  Building the set anew also gets rid of
+ * the registrations of pending connections that have been passed on, which
+ * could otherwise keep reporting activity on them in another process.
  */
-static int
-initMasks(fd_set *rmask)
+static void
+ConfigurePostmasterWaitSet(bool accept_connections)
 {
-	int			maxsock = -1;
 	int			i;
 
-	FD_ZERO(rmask);
+	if (pm_wait_set)
+		FreeWaitEventSet(pm_wait_set);
 
-	for (i = 0; i < MAXLISTEN; i++)
-	{
-		int			fd = ListenSocket[i];
+	pm_wait_set = CreateWaitEventSet(PostmasterContext,
+									 MAXLISTEN + PREFORK_MAX_PENDING + 1);
+	AddWaitEventToSet(pm_wait_set, WL_LATCH_SET, PGINVALID_SOCKET, MyLatch,
+					  NULL);
 
-		if (fd == PGINVALID_SOCKET)
-			break;
-		FD_SET(fd, rmask);
+	if (accept_connections)
+	{
+		for (i = 0; i < MAXLISTEN; i++)
+		{
+			if (ListenSocket[i] == PGINVALID_SOCKET)
+				break;
+			AddWaitEventToSet(pm_wait_set, WL_SOCKET_ACCEPT, ListenSocket[i],
+							  NULL, NULL);
+		}
 
-		if (fd > maxsock)
-			maxsock = fd;
+		for (i = 0; i < NumPendingConnections; i++)
+			AddWaitEventToSet(pm_wait_set, WL_SOCKET_READABLE,
+							  PendingConnections[i].port->sock, NULL,
+							  PendingConnections[i].port);
 	}
 
-	return maxsock + 1;
+	pm_wait_set_accepting = accept_connections;
+	PendingConnectionsChanged = false;
 }
 
 
@@ -1942,6 +2077,7 @@ ProcessStartupPacket(Port *port, bool ssl_done, bool gss_done)
 	void	   *buf;
 	ProtocolVersion proto;
 	MemoryContext oldcontext;
+	char	   *compression_methods = NULL;
 
 	pq_startmsgread();
 
@@ -2090,6 +2226,33 @@ retry1:
 		return ProcessStartupPacket(port, GSSok == 'G', true);
 	}
 
+	/*
+	 * A connection proxy tells us the address of its client ahead of the
+	 * client's startup packet.
+	 */
+	if (proto == PROXY_REQUEST_CODE && !port->proxied)
+	{
+		if (!ProcessProxyRequest(port, buf, len))
+			return STATUS_ERROR;
+
+		SetRemoteHost(port);
+		if (Log_connections)
+		{
+			if (port->remote_port[0])
+				ereport(LOG,
+						(errmsg("connection received through connection proxy: host=%s port=%s",
+								port->remote_host,
+								port->remote_port)));
+			else
+				ereport(LOG,
+						(errmsg("connection received through connection proxy: host=%s",
+								port->remote_host)));
+		}
+
+		/* The proxy doesn't do encryption */
+		return ProcessStartupPacket(port, true, true);
+	}
+
 	/* Could add additional special packet types here */
 
 	/*
@@ -2172,12 +2335,14 @@ retry1:
 									valptr),
 							 errhint("Valid values are: \"false\", 0, \"true\", 1, \"database\".")));
 			}
+			else if (strcmp(nameptr, "_pq_.compression") == 0)
+				compression_methods = pstrdup(valptr);
 			else if (strncmp(nameptr, "_pq_.", 5) == 0)
 			{
 				/*
 				 * Any option beginning with _pq_. is reserved for use as a
-				 * protocol-level option, but at present no such options are
-				 * defined.
+				 * protocol-level option, but at present no other such options
+				 * are defined.
 				 */
 				unrecognized_protocol_options =
 					lappend(unrecognized_protocol_options, pstrdup(nameptr));
@@ -2341,6 +2506,14 @@ retry1:
 			break;
 	}
 
+	/*
+	 * Compress the rest of the session if the client asked for it, unless
+	 * it's talking to us through a connection proxy, which passes on its
+	 * startup packet but doesn't compress.
+	 */
+	if (compression_methods != NULL && !port->proxied)
+		pq_start_compression(compression_methods);
+
 	return STATUS_OK;
 }
 
@@ -2608,6 +2781,35 @@ ClosePostmasterPorts(bool am_syslogger)
 		}
 	}
 
+	/* Connection proxies keep theirs, of course */
+	if (MyBackendType != B_PROXY)
+		ProxyCloseListen();
+
+	/* Release the postmaster's wait event set, too */
+	if (pm_wait_set)
+	{
+		FreeWaitEventSetAfterFork(pm_wait_set);
+		pm_wait_set = NULL;
+	}
+
+	/*
+	 * Close our ends of the pre-forked backends' socket pairs, so that they
+	 * see when we close ours, and the sockets of pending connections.
+	 */
+	{
+		dlist_iter	iter;
+
+		dlist_foreach(iter, &BackendList)
+		{
+			Backend    *bp = dlist_container(Backend, elem, iter.cur);
+
+			if (bp->prefork_sock != PGINVALID_SOCKET)
+				StreamClose(bp->prefork_sock);
+		}
+	}
+	for (i = 0; i < NumPendingConnections; i++)
+		StreamClose(PendingConnections[i].port->sock);
+
 	/*
 	 * If using syslogger, close the read side of the pipe.  We don't bother
 	 * tracking this in fd.c, either.
@@ -2726,6 +2928,14 @@ SIGHUP_handler(SIGNAL_ARGS)
 			signal_child(SysLoggerPID, SIGHUP);
 		if (PgStatPID != 0)
 			signal_child(PgStatPID, SIGHUP);
+		SignalProxies(SIGHUP);
+
+		/*
+		 * Replace the pre-forked backends, which could not pick up the new
+		 * settings until they get a client.
+		 */
+		RetirePreforkedBackends();
+		LoadPreforkDatabases();
 
 		/* Reload authentication config files too */
 		if (!load_hba())
@@ -2760,6 +2970,9 @@ SIGHUP_handler(SIGNAL_ARGS)
 #endif
 	}
 
+	/* Wake up ServerLoop, so that it acts on whatever we did here */
+	SetLatch(MyLatch);
+
 #ifdef WIN32
 	PG_SETMASK(&UnBlockSig);
 #endif
@@ -2827,6 +3040,12 @@ pmdie(SIGNAL_ARGS)
 				pmState = PM_STOP_BACKENDS;
 			}
 
+			/*
+			 * Connection proxies stop accepting connections, and let go of
+			 * their clients as soon as these are between transactions.
+			 */
+			SignalProxies(SIGTERM);
+
 			/*
 			 * Now wait for online backup mode to end and backends to exit. If
 			 * that is already the case, PostmasterStateMachine will take the
@@ -2911,6 +3130,9 @@ pmdie(SIGNAL_ARGS)
 			break;
 	}
 
+	/* Wake up ServerLoop, so that it acts on whatever we did here */
+	SetLatch(MyLatch);
+
 #ifdef WIN32
 	PG_SETMASK(&UnBlockSig);
 #endif
@@ -2948,6 +3170,9 @@ reaper(SIGNAL_ARGS)
 		{
 			StartupPID = 0;
 
+			/* It may have started parallel redo workers */
+			BackgroundWorkerStopNotifications(pid);
+
 			/*
 			 * Startup process exited in response to a shutdown request (or it
 			 * completed normally regardless of the shutdown request).
@@ -3219,6 +3444,15 @@ reaper(SIGNAL_ARGS)
 			continue;
 		}
 
+		/*
+		 * Was it a connection proxy?  Its clients lost their connections,
+		 * but the backends serving them notice that by themselves; no need
+		 * to force reset of the rest of the system.  ServerLoop will start a
+		 * new one, unless we are shutting down.
+		 */
+		if (CleanupProxy(pid, exitstatus))
+			continue;
+
 		/* Was it the system logger?  If so, try to start a new one */
 		if (pid == SysLoggerPID)
 		{
@@ -3251,6 +3485,9 @@ reaper(SIGNAL_ARGS)
 	 */
 	PostmasterStateMachine();
 
+	/* Wake up ServerLoop, so that it acts on whatever we did here */
+	SetLatch(MyLatch);
+
 	/* Done with signal handler */
 #ifdef WIN32
 	PG_SETMASK(&UnBlockSig);
@@ -3426,6 +3663,17 @@ CleanupBackend(int pid,
 				ShmemBackendArrayRemove(bp);
 #endif
 			}
+			if (bp->prefork_db >= 0)
+			{
+				/*
+				 * A pre-forked backend that exits before getting a client
+				 * probably failed to connect to its database.  Don't try
+				 * again right away.
+				 */
+				PreforkDatabaseList[bp->prefork_db].restart_time =
+					time(NULL) + PREFORK_RESTART_INTERVAL;
+				ReleasePreforkedBackend(bp);
+			}
 			if (bp->bgworker_notify)
 			{
 				/*
@@ -3541,6 +3789,8 @@ HandleChildCrash(int pid, int exitstatus, const char *procname)
 				ShmemBackendArrayRemove(bp);
 #endif
 			}
+			if (bp->prefork_db >= 0)
+				ReleasePreforkedBackend(bp);
 			dlist_delete(iter.cur);
 			free(bp);
 			/* Keep looping so we can signal remaining backends */
@@ -3683,6 +3933,10 @@ HandleChildCrash(int pid, int exitstatus, const char *procname)
 		allow_immediate_pgstat_restart();
 	}
 
+	/* The connection proxies go too, their backends being gone */
+	if (take_action)
+		SignalProxies(SIGQUIT);
+
 	/* We do NOT restart the syslogger */
 
 	if (Shutdown != ImmediateShutdown)
@@ -3823,6 +4077,8 @@ PostmasterStateMachine(void)
 			signal_child(StartupPID, SIGTERM);
 		if (WalReceiverPID != 0)
 			signal_child(WalReceiverPID, SIGTERM);
+		/* and the connection proxies, whose backends are going away */
+		SignalProxies(SIGTERM);
 		/* checkpointer, archiver, stats, and syslogger may continue for now */
 
 		/* Now transition to PM_WAIT_BACKENDS state to wait for them to die */
@@ -3904,6 +4160,7 @@ PostmasterStateMachine(void)
 						signal_child(PgArchPID, SIGQUIT);
 					if (PgStatPID != 0)
 						signal_child(PgStatPID, SIGQUIT);
+					SignalProxies(SIGQUIT);
 				}
 			}
 		}
@@ -3927,10 +4184,10 @@ PostmasterStateMachine(void)
 	{
 		/*
 		 * PM_WAIT_DEAD_END state ends when the BackendList is entirely empty
-		 * (ie, no dead_end children remain), and the archiver and stats
-		 * collector are gone too.
+		 * (ie, no dead_end children remain), and the archiver, stats
+		 * collector and connection proxies are gone too.
 		 *
-		 * The reason we wait for those two is to protect them against a new
+		 * The reason we wait for those is to protect them against a new
 		 * postmaster starting conflicting subprocesses; this isn't an
 		 * ironclad protection, but it at least helps in the
 		 * shutdown-and-immediately-restart scenario.  Note that they have
@@ -3939,7 +4196,7 @@ PostmasterStateMachine(void)
 		 * FatalError processing.
 		 */
 		if (dlist_is_empty(&BackendList) &&
-			PgArchPID == 0 && PgStatPID == 0)
+			PgArchPID == 0 && PgStatPID == 0 && CountProxies() == 0)
 		{
 			/* These other guys should be dead already */
 			Assert(StartupPID == 0);
@@ -4141,6 +4398,7 @@ TerminateChildren(int signal)
 		signal_child(PgArchPID, signal);
 	if (PgStatPID != 0)
 		signal_child(PgStatPID, signal);
+	SignalProxies(signal);
 }
 
 /*
@@ -4201,6 +4459,10 @@ BackendStartup(Port *port)
 	/* Hasn't asked to be notified about any bgworkers yet */
 	bn->bgworker_notify = false;
 
+	/* Not a pre-forked backend */
+	bn->prefork_db = -1;
+	bn->prefork_sock = PGINVALID_SOCKET;
+
 #ifdef EXEC_BACKEND
 	pid = backend_forkexec(port);
 #else							/* !EXEC_BACKEND */
@@ -4219,7 +4481,7 @@ BackendStartup(Port *port)
 		BackendInitialize(port);
 
 		/* And run the backend */
-		BackendRun(port);
+		BackendRun(port->database_name, port->user_name);
 	}
 #endif							/* EXEC_BACKEND */
 
@@ -4304,10 +4566,6 @@ static void
 BackendInitialize(Port *port)
 {
 	int			status;
-	int			ret;
-	char		remote_host[NI_MAXHOST];
-	char		remote_port[NI_MAXSERV];
-	StringInfoData ps_data;
 
 	/* Save port etc. for ps status */
 	MyProcPort = port;
@@ -4362,53 +4620,10 @@ BackendInitialize(Port *port)
 	/*
 	 * Get the remote host name and port for logging and status display.
 	 */
-	remote_host[0] = '\0';
-	remote_port[0] = '\0';
-	if ((ret = pg_getnameinfo_all(&port->raddr.addr, port->raddr.salen,
-								  remote_host, sizeof(remote_host),
-								  remote_port, sizeof(remote_port),
-								  (log_hostname ? 0 : NI_NUMERICHOST) | NI_NUMERICSERV)) != 0)
-		ereport(WARNING,
-				(errmsg_internal("pg_getnameinfo_all() failed: %s",
-								 gai_strerror(ret))));
-
-	/*
-	 * Save remote_host and remote_port in port structure (after this, they
-	 * will appear in log_line_prefix data for log messages).
-	 */
-	port->remote_host = strdup(remote_host);
-	port->remote_port = strdup(remote_port);
+	SetRemoteHost(port);
 
 	/* And now we can issue the Log_connections message, if wanted */
-	if (Log_connections)
-	{
-		if (remote_port[0])
-			ereport(LOG,
-					(errmsg("connection received: host=%s port=%s",
-							remote_host,
-							remote_port)));
-		else
-			ereport(LOG,
-					(errmsg("connection received: host=%s",
-							remote_host)));
-	}
-
-	/*
-	 * If we did a reverse lookup to name, we might as well save the results
-	 * rather than possibly repeating the lookup during authentication.
-	 *
-	 * Note that we don't want to specify NI_NAMEREQD above, because then we'd
-	 * get nothing useful for a client without an rDNS entry.  Therefore, we
-	 * must check whether we got a numeric IPv4 or IPv6 address, and not save
-	 * it into remote_hostname if so.  (This test is conservative and might
-	 * sometimes classify a hostname as numeric, but an error in that
-	 * direction is safe; it only results in a possible extra lookup.)
-	 */
-	if (log_hostname &&
-		ret == 0 &&
-		strspn(remote_host, "0123456789.") < strlen(remote_host) &&
-		strspn(remote_host, "0123456789ABCDEFabcdef:") < strlen(remote_host))
-		port->remote_hostname = strdup(remote_host);
+	LogConnectionReceived(port);
 
 	/*
 	 * Ready to begin client interaction.  We will give up and exit(1) after a
@@ -4434,6 +4649,9 @@ BackendInitialize(Port *port)
 	 */
 	status = ProcessStartupPacket(port, false, false);
 
+	/* Only the connection proxies need to know their secret from here on */
+	ProxyForgetSecret();
+
 	/*
 	 * Stop here if it was bad or a cancel packet.  ProcessStartupPacket
 	 * already did any appropriate error reporting.
@@ -4445,6 +4663,44 @@ BackendInitialize(Port *port)
 	 * Now that we have the user and database name, we can set the process
 	 * title for ps.  It's good to do this as early as possible in startup.
 	 */
+	InitConnectionPsDisplay(port);
+
+	/*
+	 * Disable the timeout, and prevent SIGTERM/SIGQUIT again.
+	 */
+	disable_timeout(STARTUP_PACKET_TIMEOUT, false);
+	PG_SETMASK(&BlockSig);
+}
+
+/*
+ * Issue the Log_connections message for a new connection, if wanted
+ */
+static void
+LogConnectionReceived(Port *port)
+{
+	if (Log_connections)
+	{
+		if (port->remote_port[0])
+			ereport(LOG,
+					(errmsg("connection received: host=%s port=%s",
+							port->remote_host,
+							port->remote_port)));
+		else
+			ereport(LOG,
+					(errmsg("connection received: host=%s",
+							port->remote_host)));
+	}
+}
+
+/*
+ * Set the process title of a backend, once it knows the user and database
+ * name of its client
+ */
+static void
+InitConnectionPsDisplay(Port *port)
+{
+	StringInfoData ps_data;
+
 	initStringInfo(&ps_data);
 	if (am_walsender)
 		appendStringInfo(&ps_data, "%s ", GetBackendTypeDesc(B_WAL_SENDER));
@@ -4459,24 +4715,67 @@ BackendInitialize(Port *port)
 	pfree(ps_data.data);
 
 	set_ps_display("initializing");
+}
+
+
+/*
+ * SetRemoteHost -- look up the name and port of the client's address
+ *
+ * The results are saved in the Port structure; after this, they will appear
+ * in log_line_prefix data for log messages.
+ */
+static void
+SetRemoteHost(Port *port)
+{
+	int			ret;
+	char		remote_host[NI_MAXHOST];
+	char		remote_port[NI_MAXSERV];
+
+	remote_host[0] = '\0';
+	remote_port[0] = '\0';
+	if ((ret = pg_getnameinfo_all(&port->raddr.addr, port->raddr.salen,
+								  remote_host, sizeof(remote_host),
+								  remote_port, sizeof(remote_port),
+								  (log_hostname ? 0 : NI_NUMERICHOST) | NI_NUMERICSERV)) != 0)
+		ereport(WARNING,
+				(errmsg_internal("pg_getnameinfo_all() failed: %s",
+								 gai_strerror(ret))));
+
+	port->remote_host = strdup(remote_host);
+	port->remote_port = strdup(remote_port);
 
 	/*
-	 * Disable the timeout, and prevent SIGTERM/SIGQUIT again.
+	 * If we did a reverse lookup to name, we might as well save the results
+	 * rather than possibly repeating the lookup during authentication.
+	 *
+	 * Note that we don't want to specify NI_NAMEREQD above, because then we'd
+	 * get nothing useful for a client without an rDNS entry.  Therefore, we
+	 * must check whether we got a numeric IPv4 or IPv6 address, and not save
+	 * it into remote_hostname if so.  (This test is conservative and might
+	 * sometimes classify a hostname as numeric, but an error in that
+	 * direction is safe; it only results in a possible extra lookup.)
 	 */
-	disable_timeout(STARTUP_PACKET_TIMEOUT, false);
-	PG_SETMASK(&BlockSig);
+	port->remote_hostname = NULL;
+	if (log_hostname &&
+		ret == 0 &&
+		strspn(remote_host, "0123456789.") < strlen(remote_host) &&
+		strspn(remote_host, "0123456789ABCDEFabcdef:") < strlen(remote_host))
+		port->remote_hostname = strdup(remote_host);
 }
 
 
 /*
  * BackendRun -- set up the backend's argument list and invoke PostgresMain()
  *
+ * username is NULL for a pre-forked backend, which gets it from its client
+ * later.
+ *
  * returns:
  *		Shouldn't return at all.
  *		If PostgresMain() fails, return status.
  */
 static void
-BackendRun(Port *port)
+BackendRun(const char *dbname, const char *username)
 {
 	char	  **av;
 	int			maxac;
@@ -4527,7 +4826,7 @@ BackendRun(Port *port)
 	 */
 	MemoryContextSwitchTo(TopMemoryContext);
 
-	PostgresMain(ac, av, port->database_name, port->user_name);
+	PostgresMain(ac, av, dbname, username);
 }
 
 
@@ -5050,7 +5349,7 @@ SubPostmasterMain(int argc, char *argv[])
 		CreateSharedMemoryAndSemaphores();
 
 		/* And run the backend */
-		BackendRun(&port);		/* does not return */
+		BackendRun(port.database_name, port.user_name); /* does not return */
 	}
 	if (strcmp(argv[1], "--forkboot") == 0)
 	{
@@ -5351,6 +5650,9 @@ sigusr1_handler(SIGNAL_ARGS)
 		signal_child(StartupPID, SIGUSR2);
 	}
 
+	/* Wake up ServerLoop, so that it acts on whatever we did here */
+	SetLatch(MyLatch);
+
 #ifdef WIN32
 	PG_SETMASK(&UnBlockSig);
 #endif
@@ -5447,18 +5749,770 @@ CountChildren(int target)
 	return cnt;
 }
 
-
 /*
- * StartChildProcess -- start an auxiliary process for the postmaster
- *
- * "type" determines what kind of child will be started.  All child types
- * initially go to AuxiliaryProcessMain, which will handle common setup.
- *
- * Return value of StartChildProcess is subprocess' PID, or 0 if failed
- * to start subprocess.
+ * Start the connection proxies that are not running
  */
-static pid_t
-StartChildProcess(AuxProcType type)
+static void
+StartProxies(void)
+{
+	int			i;
+
+	for (i = 0; i < ConnectionProxies; i++)
+	{
+		if (ProxyPIDs[i] == 0)
+			ProxyPIDs[i] = ProxyStart(i);
+	}
+}
+
+/*
+ * Send a signal to all connection proxies
+ */
+static void
+SignalProxies(int signal)
+{
+	int			i;
+
+	for (i = 0; i < ConnectionProxies; i++)
+	{
+		if (ProxyPIDs[i] != 0)
+			signal_child(ProxyPIDs[i], signal);
+	}
+}
+
+/*
+ * Count the running connection proxies
+ */
+static int
+CountProxies(void)
+{
+	int			cnt = 0;
+	int			i;
+
+	for (i = 0; i < ConnectionProxies; i++)
+	{
+		if (ProxyPIDs[i] != 0)
+			cnt++;
+	}
+	return cnt;
+}
+
+/*
+ * If the given process was a connection proxy, forget about it and return
+ * true.
+ */
+static bool
+CleanupProxy(int pid, int exitstatus)
+{
+	int			i;
+
+	for (i = 0; i < ConnectionProxies; i++)
+	{
+		if (ProxyPIDs[i] == pid)
+		{
+			ProxyPIDs[i] = 0;
+			if (!EXIT_STATUS_0(exitstatus))
+				LogChildExit(LOG, _("connection proxy"), pid, exitstatus);
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/*
+ * Pre-forked backends
+ *
+ * Most of the time it takes to open a connection goes into forking a backend
+ * and having it connect to its database, notably to load the relcache.  With
+ * prefork_backends set, we keep that many backends for each database in
+ * prefork_databases, connected to it ahead of time and waiting for a client.
+ * Each is connected to us through a socket pair.  When the startup packet
+ * of a new connection asks for one of those databases, we pass the client's
+ * socket down that socket pair to a waiting backend, which then reads the
+ * startup packet itself, authenticates the client and carries on like any
+ * other backend; see PreforkAwaitClient().  We take it out of the pool at
+ * that point, and start another one to replace it.
+ *
+ * Connections for other databases, replication connections, and those that
+ * start with an SSL or GSSAPI encryption request get a new backend as usual.
+ * Since the startup packet usually arrives a little after the connection
+ * does, new connections wait for it in PendingConnections for a while, and
+ * get a new backend too if it does not come in time.
+ *
+ * Pre-forked backends count as regular backends for everything else.  They
+ * cannot pick up configuration changes, so we replace them all on SIGHUP.
+ */
+
+/*
+ * Set up PreforkDatabaseList from prefork_databases.  The pools must be
+ * empty.
+ */
+static void
+LoadPreforkDatabases(void)
+{
+	Assert(NumPreforkedBackends == 0);
+
+	if (PreforkDatabaseList)
+		pfree(PreforkDatabaseList);
+	PreforkDatabaseList = NULL;
+	NumPreforkDatabases = 0;
+
+	if (PreforkBackends == 0)
+		return;
+
+#ifdef EXEC_BACKEND
+	ereport(LOG,
+			(errmsg("pre-forked backends are not supported on this platform")));
+#else
+	{
+		char	   *rawstring;
+		List	   *elemlist;
+		ListCell   *l;
+
+		rawstring = pstrdup(PreforkDatabases);
+		if (!SplitIdentifierString(rawstring, ',', &elemlist))
+		{
+			/* syntax error in list, check_prefork_databases() rejects it */
+			pfree(rawstring);
+			return;
+		}
+
+		if (elemlist != NIL)
+			PreforkDatabaseList = (PreforkDatabase *)
+				palloc0(list_length(elemlist) * sizeof(PreforkDatabase));
+		foreach(l, elemlist)
+		{
+			PreforkDatabase *db = &PreforkDatabaseList[NumPreforkDatabases++];
+
+			strlcpy(db->name, (char *) lfirst(l), NAMEDATALEN);
+		}
+
+		list_free(elemlist);
+		pfree(rawstring);
+	}
+#endif
+}
+
+/*
+ * Start pre-forked backends as needed to fill up the pools, or empty them if
+ * we're not accepting connections.
+ */
+static void
+MaintainPreforkedBackends(void)
+{
+	time_t		now;
+	int			nconns;
+	int			i;
+
+	if (NumPreforkDatabases == 0 ||
+		!(pmState == PM_RUN || pmState == PM_HOT_STANDBY) ||
+		connsAllowed != ALLOW_ALL_CONNS)
+	{
+		if (NumPreforkedBackends > 0)
+			RetirePreforkedBackends();
+		return;
+	}
+
+	if (NumPreforkedBackends >= NumPreforkDatabases * PreforkBackends)
+		return;
+
+	now = time(NULL);
+	nconns = CountChildren(BACKEND_TYPE_NORMAL);
+
+	for (i = 0; i < NumPreforkDatabases; i++)
+	{
+		PreforkDatabase *db = &PreforkDatabaseList[i];
+
+		if (db->restart_time > now)
+			continue;
+
+		while (db->nbackends < PreforkBackends)
+		{
+			/*
+			 * Don't take up the connection slots reserved for superusers,
+			 * nor the last free child slots.
+			 */
+			if (nconns >= MaxConnections - ReservedBackends ||
+				canAcceptConnections(BACKEND_TYPE_NORMAL) != CAC_OK)
+				return;
+
+			if (!StartPreforkedBackend(i))
+			{
+				db->restart_time = now + PREFORK_RESTART_INTERVAL;
+				break;
+			}
+			nconns++;
+		}
+	}
+}
+
+/*
+ * Start a pre-forked backend for the given database, and add it to its pool
+ *
+ * Returns false if that failed.
+ */
+static bool
+StartPreforkedBackend(int dbidx)
+{
+#ifdef EXEC_BACKEND
+	return false;
+#else
+	Backend    *bn;
+	pgsocket	socks[2];
+	pid_t		pid;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, socks) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not create socket pair for pre-forked backend: %m")));
+		return false;
+	}
+
+	bn = (Backend *) malloc(sizeof(Backend));
+	if (!bn)
+	{
+		closesocket(socks[0]);
+		closesocket(socks[1]);
+		ereport(LOG,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+		return false;
+	}
+
+	if (!RandomCancelKey(&MyCancelKey))
+	{
+		closesocket(socks[0]);
+		closesocket(socks[1]);
+		free(bn);
+		ereport(LOG,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not generate random cancel key")));
+		return false;
+	}
+
+	bn->cancel_key = MyCancelKey;
+	bn->dead_end = false;
+	bn->child_slot = MyPMChildSlot = AssignPostmasterChildSlot();
+	bn->bgworker_notify = false;
+
+	pid = fork_process();
+	if (pid == 0)				/* child */
+	{
+		char	   *dbname;
+
+		free(bn);
+
+		/* Detangle from postmaster */
+		InitPostmasterChild();
+
+		closesocket(socks[0]);
+		PreforkSocket = socks[1];
+
+		/* Close the postmaster's sockets */
+		ClosePostmasterPorts(false);
+
+		/* Only the connection proxies need to know their secret */
+		ProxyForgetSecret();
+
+		IsPreforkedBackend = true;
+
+		dbname = MemoryContextStrdup(TopMemoryContext,
+									 PreforkDatabaseList[dbidx].name);
+		init_ps_display(dbname);
+		set_ps_display("initializing");
+
+		/* And run the backend, InitPostgres() waits for the client */
+		BackendRun(dbname, NULL);
+	}
+
+	if (pid < 0)
+	{
+		/* in parent, fork failed */
+		int			save_errno = errno;
+
+		(void) ReleasePostmasterChildSlot(bn->child_slot);
+		free(bn);
+		closesocket(socks[0]);
+		closesocket(socks[1]);
+		errno = save_errno;
+		ereport(LOG,
+				(errmsg("could not fork pre-forked backend: %m")));
+		return false;
+	}
+
+	/* in parent, successful fork */
+	closesocket(socks[1]);
+
+	bn->pid = pid;
+	bn->bkend_type = BACKEND_TYPE_NORMAL;
+	bn->prefork_db = dbidx;
+	bn->prefork_sock = socks[0];
+	dlist_push_head(&BackendList, &bn->elem);
+
+	PreforkDatabaseList[dbidx].nbackends++;
+	NumPreforkedBackends++;
+
+	return true;
+#endif
+}
+
+/*
+ * Take a backend out of its pool of pre-forked backends, because it got a
+ * client or exited.  If it is still waiting for a client, it exits when it
+ * sees us close the socket pair.
+ */
+static void
+ReleasePreforkedBackend(Backend *bp)
+{
+	Assert(bp->prefork_db >= 0);
+
+	StreamClose(bp->prefork_sock);
+	PreforkDatabaseList[bp->prefork_db].nbackends--;
+	NumPreforkedBackends--;
+
+	bp->prefork_db = -1;
+	bp->prefork_sock = PGINVALID_SOCKET;
+}
+
+/*
+ * Empty all pools of pre-forked backends
+ */
+static void
+RetirePreforkedBackends(void)
+{
+	dlist_iter	iter;
+
+	dlist_foreach(iter, &BackendList)
+	{
+		Backend    *bp = dlist_container(Backend, elem, iter.cur);
+
+		if (bp->prefork_db >= 0)
+			ReleasePreforkedBackend(bp);
+	}
+	Assert(NumPreforkedBackends == 0);
+}
+
+/*
+ * Try to have a pre-forked backend serve a new connection
+ *
+ * Returns true if the connection was taken care of, by passing it to a
+ * pre-forked backend or by adding it to PendingConnections.  Otherwise, the
+ * caller starts a backend for it as usual.
+ */
+static bool
+RouteToPreforkedBackend(Port *port)
+{
+	if (NumPreforkedBackends == 0)
+		return false;
+
+	switch (RouteConnection(port))
+	{
+		case PREFORK_ROUTE_HANDED_OFF:
+			StreamClose(port->sock);
+			ConnFree(port);
+			return true;
+
+		case PREFORK_ROUTE_WAIT:
+			if (NumPendingConnections >= PREFORK_MAX_PENDING)
+				return false;
+			PendingConnections[NumPendingConnections].port = port;
+			PendingConnections[NumPendingConnections].accept_time =
+				GetCurrentTimestamp();
+			PendingConnections[NumPendingConnections].readable = false;
+			NumPendingConnections++;
+			PendingConnectionsChanged = true;
+			return true;
+
+		case PREFORK_ROUTE_FORK:
+			break;
+	}
+
+	return false;
+}
+
+/*
+ * Look at the startup packet of a new connection, without consuming it, and
+ * pass the connection to a pre-forked backend for its database if one is
+ * ready.
+ */
+static PreforkRoute
+RouteConnection(Port *port)
+{
+	char		buf[MAX_STARTUP_PACKET_LENGTH + 1];
+	ssize_t		n;
+	uint32		len;
+	ProtocolVersion proto;
+	char	   *user_name = NULL;
+	char	   *database_name = NULL;
+	char		dbname[NAMEDATALEN];
+	int32		offset;
+	dlist_iter	iter;
+
+	n = recv(port->sock, buf, MAX_STARTUP_PACKET_LENGTH,
+			 MSG_PEEK | MSG_DONTWAIT);
+	if (n < 0)
+	{
+		if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+			return PREFORK_ROUTE_WAIT;
+		return PREFORK_ROUTE_FORK;
+	}
+	if (n == 0)
+		return PREFORK_ROUTE_FORK;	/* let the backend deal with EOF */
+	if (n < 2 * sizeof(uint32))
+		return PREFORK_ROUTE_WAIT;
+
+	memcpy(&len, buf, sizeof(uint32));
+	len = pg_ntoh32(len);
+	memcpy(&proto, buf + sizeof(uint32), sizeof(ProtocolVersion));
+	proto = pg_ntoh32(proto);
+
+	/* Leave anything but a protocol 3 startup packet to a new backend */
+	if (len < 2 * sizeof(uint32) || len > MAX_STARTUP_PACKET_LENGTH ||
+		PG_PROTOCOL_MAJOR(proto) != 3)
+		return PREFORK_ROUTE_FORK;
+	if (n < len)
+		return PREFORK_ROUTE_WAIT;
+	buf[len] = '\0';
+
+	/* Pick out the user and database names, as ProcessStartupPacket() does */
+	offset = 2 * sizeof(uint32);
+	while (offset < len)
+	{
+		char	   *nameptr = buf + offset;
+		int32		valoffset;
+		char	   *valptr;
+
+		if (*nameptr == '\0')
+			break;
+		valoffset = offset + strlen(nameptr) + 1;
+		if (valoffset >= len)
+			break;
+		valptr = buf + valoffset;
+
+		if (strcmp(nameptr, "database") == 0)
+			database_name = valptr;
+		else if (strcmp(nameptr, "user") == 0)
+			user_name = valptr;
+		else if (strcmp(nameptr, "replication") == 0)
+			return PREFORK_ROUTE_FORK;
+
+		offset = valoffset + strlen(valptr) + 1;
+	}
+
+	if (user_name == NULL || user_name[0] == '\0')
+		return PREFORK_ROUTE_FORK;
+	if (database_name == NULL || database_name[0] == '\0')
+		database_name = user_name;
+	strlcpy(dbname, database_name, sizeof(dbname));
+
+	dlist_foreach(iter, &BackendList)
+	{
+		Backend    *bp = dlist_container(Backend, elem, iter.cur);
+		bool		ok;
+
+		if (bp->prefork_db < 0 ||
+			strcmp(PreforkDatabaseList[bp->prefork_db].name, dbname) != 0 ||
+			!IsPostmasterChildPreforkReady(bp->child_slot))
+			continue;
+
+		ok = PreforkHandOff(bp, port);
+		ReleasePreforkedBackend(bp);
+		return ok ? PREFORK_ROUTE_HANDED_OFF : PREFORK_ROUTE_FORK;
+	}
+
+	return PREFORK_ROUTE_FORK;
+}
+
+/*
+ * Pass a client connection to a pre-forked backend, along with its Port
+ *
+ * Returns false if that failed.
+ */
+static bool
+PreforkHandOff(Backend *bp, Port *port)
+{
+#ifdef EXEC_BACKEND
+	return false;
+#else
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	union
+	{
+		struct cmsghdr hdr;
+		char		buf[CMSG_SPACE(sizeof(int))];
+	}			cmsgbuf;
+	ssize_t		rc;
+
+	/* We checked that it can accept connections when starting it */
+	port->canAcceptConnections = CAC_OK;
+
+	memset(&msg, 0, sizeof(msg));
+	memset(&cmsgbuf, 0, sizeof(cmsgbuf));
+	iov.iov_base = port;
+	iov.iov_len = sizeof(Port);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &port->sock, sizeof(int));
+
+	rc = sendmsg(bp->prefork_sock, &msg, MSG_DONTWAIT);
+	if (rc != sizeof(Port))
+	{
+		if (rc < 0)
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not pass connection to pre-forked backend: %m")));
+		else
+			ereport(LOG,
+					(errmsg("could not pass connection to pre-forked backend: sent %d of %d bytes",
+							(int) rc, (int) sizeof(Port))));
+		return false;
+	}
+
+	ereport(DEBUG2,
+			(errmsg_internal("passed connection to pre-forked backend, pid=%d socket=%d",
+							 (int) bp->pid, (int) port->sock)));
+	return true;
+#endif
+}
+
+/*
+ * Route the connections in PendingConnections whose startup packet has
+ * arrived, or start backends for them if they have waited long enough.
+ */
+static void
+ProcessPendingConnections(void)
+{
+	TimestampTz now = GetCurrentTimestamp();
+	int			i = 0;
+
+	while (i < NumPendingConnections)
+	{
+		Port	   *port = PendingConnections[i].port;
+		PreforkRoute route = PREFORK_ROUTE_WAIT;
+
+		if (PendingConnections[i].readable)
+		{
+			PendingConnections[i].readable = false;
+			route = RouteConnection(port);
+		}
+		if (route == PREFORK_ROUTE_WAIT &&
+			TimestampDifferenceExceeds(PendingConnections[i].accept_time, now,
+									   PREFORK_ROUTE_TIMEOUT))
+			route = PREFORK_ROUTE_FORK;
+
+		if (route == PREFORK_ROUTE_WAIT)
+		{
+			i++;
+			continue;
+		}
+
+		/*
+		 * Remove it from the list first, lest the new backend close its
+		 * socket in ClosePostmasterPorts().
+		 */
+		PendingConnections[i] = PendingConnections[--NumPendingConnections];
+		PendingConnectionsChanged = true;
+
+		if (route == PREFORK_ROUTE_FORK)
+			BackendStartup(port);
+
+		/* We no longer need the open socket or port structure */
+		StreamClose(port->sock);
+		ConnFree(port);
+	}
+}
+
+/*
+ * PreforkAwaitClient -- wait in a pre-forked backend for the postmaster to
+ *		hand it a client connection, then collect the startup packet
+ *
+ * This is called by InitPostgres() once we're connected to our database,
+ * and does for the connection what BackendInitialize() does in a regular
+ * backend.  If the postmaster takes us out of the pool instead, we exit.
+ */
+void
+PreforkAwaitClient(const char *dbname)
+{
+#ifdef EXEC_BACKEND
+	elog(FATAL, "pre-forked backends are not supported on this platform");
+#else
+	Port	   *port;
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	union
+	{
+		struct cmsghdr hdr;
+		char		buf[CMSG_SPACE(sizeof(int))];
+	}			cmsgbuf;
+	pgsocket	sock = PGINVALID_SOCKET;
+	ssize_t		rc;
+	int			status;
+	WaitEventSet *wait_set;
+
+	Assert(IsPreforkedBackend);
+
+	port = (Port *) calloc(1, sizeof(Port));
+	if (!port)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+
+	set_ps_display("waiting for connection");
+	MarkPostmasterChildPreforkReady(true);
+
+	/*
+	 * We may be woken up many times before a connection arrives, so set up
+	 * the wait event set once rather than on every iteration.
+	 */
+	wait_set = CreateWaitEventSet(CurrentMemoryContext, 3);
+	AddWaitEventToSet(wait_set, WL_LATCH_SET, PGINVALID_SOCKET, MyLatch, NULL);
+	AddWaitEventToSet(wait_set, WL_SOCKET_READABLE, PreforkSocket, NULL, NULL);
+	AddWaitEventToSet(wait_set, WL_EXIT_ON_PM_DEATH, PGINVALID_SOCKET,
+					  NULL, NULL);
+
+	for (;;)
+	{
+		WaitEvent	event;
+
+		if (WaitEventSetWait(wait_set, -1L, &event, 1,
+							 WAIT_EVENT_PREFORK_HANDOFF) == 0)
+			continue;
+
+		if (event.events & WL_LATCH_SET)
+		{
+			ResetLatch(MyLatch);
+			CHECK_FOR_INTERRUPTS();
+
+			/* Keep up with invalidation messages while we're idle */
+			if (catchupInterruptPending)
+				ProcessCatchupInterrupt();
+		}
+
+		if (event.events & WL_SOCKET_READABLE)
+			break;
+	}
+
+	FreeWaitEventSet(wait_set);
+
+	memset(&msg, 0, sizeof(msg));
+	memset(&cmsgbuf, 0, sizeof(cmsgbuf));
+	iov.iov_base = port;
+	iov.iov_len = sizeof(Port);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+	do
+	{
+		rc = recvmsg(PreforkSocket, &msg, MSG_WAITALL);
+	} while (rc < 0 && errno == EINTR);
+
+	if (rc < 0)
+		ereport(FATAL,
+				(errcode_for_socket_access(),
+				 errmsg("could not receive connection from postmaster: %m")));
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg != NULL &&
+		cmsg->cmsg_level == SOL_SOCKET &&
+		cmsg->cmsg_type == SCM_RIGHTS)
+		memcpy(&sock, CMSG_DATA(cmsg), sizeof(int));
+
+	/* If the postmaster closed the socket pair instead, we're done */
+	if (rc != sizeof(Port) || sock == PGINVALID_SOCKET)
+	{
+		if (sock != PGINVALID_SOCKET)
+			closesocket(sock);
+		proc_exit(0);
+	}
+
+	MarkPostmasterChildPreforkReady(false);
+	closesocket(PreforkSocket);
+	PreforkSocket = PGINVALID_SOCKET;
+
+	/*
+	 * Only the plain fields of the Port came across, set up the rest as
+	 * ConnCreate() would.
+	 */
+	port->sock = sock;
+#if defined(ENABLE_GSS) || defined(ENABLE_SSPI)
+	port->gss = (pg_gssinfo *) calloc(1, sizeof(pg_gssinfo));
+	if (!port->gss)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+#endif
+
+	/* The session starts now, as far as anyone is concerned */
+	MyStartTimestamp = GetCurrentTimestamp();
+	MyStartTime = timestamptz_to_time_t(MyStartTimestamp);
+
+	/* From here on, as in BackendInitialize() */
+	MyProcPort = port;
+	ReserveExternalFD();
+
+	if (PreAuthDelay > 0)
+		pg_usleep(PreAuthDelay * 1000000L);
+
+	ClientAuthInProgress = true;
+
+	port->remote_host = "";
+	port->remote_port = "";
+
+	pq_init();
+	whereToSendOutput = DestRemote;
+
+	SetRemoteHost(port);
+	LogConnectionReceived(port);
+
+	/*
+	 * Give up after AuthenticationTimeout.  The regular signal handlers are
+	 * in place already, so instead of STARTUP_PACKET_TIMEOUT we use the
+	 * statement timeout, which makes us exit while ClientAuthInProgress is
+	 * set; see StatementTimeoutHandler().
+	 */
+	enable_timeout_after(STATEMENT_TIMEOUT, AuthenticationTimeout * 1000);
+
+	status = ProcessStartupPacket(port, false, false);
+
+	disable_timeout(STATEMENT_TIMEOUT, false);
+
+	if (status != STATUS_OK)
+		proc_exit(0);
+
+	/* The postmaster checked these, so this shouldn't happen */
+	if (am_walsender || strcmp(port->database_name, dbname) != 0)
+		ereport(FATAL,
+				(errmsg_internal("pre-forked backend for database \"%s\" got a connection for database \"%s\"",
+								 dbname, port->database_name)));
+
+	InitConnectionPsDisplay(port);
+#endif
+}
+
+
+/*
+ * StartChildProcess -- start an auxiliary process for the postmaster
+ *
+ * "type" determines what kind of child will be started.  All child types
+ * initially go to AuxiliaryProcessMain, which will handle common setup.
+ *
+ * Return value of StartChildProcess is subprocess' PID, or 0 if failed
+ * to start subprocess.
+ */
+static pid_t
+StartChildProcess(AuxProcType type)
 {
 	pid_t		pid;
 	char	   *av[10];
@@ -5598,6 +6652,8 @@ StartAutovacuumWorker(void)
 			bn->dead_end = false;
 			bn->child_slot = MyPMChildSlot = AssignPostmasterChildSlot();
 			bn->bgworker_notify = false;
+			bn->prefork_db = -1;
+			bn->prefork_sock = PGINVALID_SOCKET;
 
 			bn->pid = StartAutoVacWorker();
 			if (bn->pid > 0)
@@ -5990,6 +7046,8 @@ assign_backendlist_entry(RegisteredBgWorker *rw)
 	bn->bkend_type = BACKEND_TYPE_BGWORKER;
 	bn->dead_end = false;
 	bn->bgworker_notify = false;
+	bn->prefork_db = -1;
+	bn->prefork_sock = PGINVALID_SOCKET;
 
 	rw->rw_backend = bn;
 	rw->rw_child_slot = bn->child_slot;
@@ -6133,6 +7191,10 @@ PostmasterMarkPIDForWorkerNotify(int pid)
 	dlist_iter	iter;
 	Backend    *bp;
 
+	/* The startup process starts parallel redo workers */
+	if (pid != 0 && pid == StartupPID)
+		return true;
+
 	dlist_foreach(iter, &BackendList)
 	{
 		bp = dlist_container(Backend, elem, iter.cur);
@@ -6224,6 +7286,7 @@ save_backend_variables(BackendParameters *param, Port *port,
 	param->max_safe_fds = max_safe_fds;
 
 	param->MaxBackends = MaxBackends;
+	param->FastPathLockGroupsPerBackend = FastPathLockGroupsPerBackend;
 
 #ifdef WIN32
 	param->PostmasterHandle = PostmasterHandle;
@@ -6459,6 +7522,7 @@ restore_backend_variables(BackendParameters *param, Port *port)
 	max_safe_fds = param->max_safe_fds;
 
 	MaxBackends = param->MaxBackends;
+	FastPathLockGroupsPerBackend = param->FastPathLockGroupsPerBackend;
 
 #ifdef WIN32
 	PostmasterHandle = param->PostmasterHandle;
@@ -0,0 +1,1693 @@
+/*-------------------------------------------------------------------------
+ *
+ * proxy.c
+ *	  Connection proxies, multiplexing client sessions onto pooled backends
+ *
+ * With connection_proxies set, the postmaster listens on proxy_port in
+ * addition to the regular port, and starts that many proxy processes.  Each
+ * accepts client connections on the proxy port, and relays the protocol
+ * messages of a client to a backend only for the duration of a transaction.
+ * Between transactions, the backend returns to a pool shared by all clients
+ * that connected with the same startup packet, that is with the same user,
+ * database and options, and serves other clients.  A pool keeps at most
+ * session_pool_size backends; clients that need one while all are busy wait
+ * for the next to become free.
+ *
+ * A client is authenticated by a backend of its own, which the proxy starts
+ * with the client's startup packet and which then joins the pool, or goes
+ * away if the pool is full.  Backends started later to grow the pool skip
+ * authentication, since a client has already authenticated for the same
+ * user and database.
+ *
+ * Proxies start backends by connecting to the postmaster's Unix-domain
+ * socket, sending a ProxyRequestPacket ahead of the client's startup
+ * packet, so that the backend knows the client's address, and
+ * authentication and logging use that rather than the Unix-domain socket.
+ *
+ * Some session state cannot be handed from one client to the next: session
+ * parameters set with SET, temporary objects, prepared statements, LISTEN,
+ * session-level advisory locks and WITH HOLD cursors.  A backend whose
+ * session acquires any of them tells its proxy so with a ParameterStatus
+ * message, just before ReadyForQuery, and the proxy then dedicates the
+ * backend to that client until it disconnects, or resets its session with
+ * DISCARD ALL.  This keeps the semantics of a session intact, but such a
+ * client no longer benefits from pooling.
+ *
+ * Proxies are not supported in EXEC_BACKEND builds, nor without poll().
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/proxy.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <netdb.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#ifdef HAVE_NETINET_TCP_H
+#include <netinet/tcp.h>
+#endif
+#ifdef HAVE_SYS_UN_H
+#include <sys/un.h>
+#endif
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#endif
+
+#include "common/ip.h"
+#include "lib/stringinfo.h"
+#include "libpq/libpq.h"
+#include "libpq/pqformat.h"
+#include "libpq/pqsignal.h"
+#include "miscadmin.h"
+#include "nodes/pg_list.h"
+#include "pgstat.h"
+#include "postmaster/fork_process.h"
+#include "postmaster/interrupt.h"
+#include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
+#include "storage/ipc.h"
+#include "storage/pmsignal.h"
+#include "storage/shmem.h"
+#include "tcop/tcopprot.h"
+#include "utils/elog.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/ps_status.h"
+#include "utils/varlena.h"
+
+#if defined(HAVE_POLL) && defined(HAVE_UNIX_SOCKETS) && !defined(EXEC_BACKEND)
+#define PROXY_SUPPORTED
+#endif
+
+/* GUC variables */
+int			ConnectionProxies = 0;
+int			ProxyPortNumber = 6543;
+int			SessionPoolSize = 10;
+
+#define MAXPROXYLISTEN	64
+
+static pgsocket ProxyListenSocket[MAXPROXYLISTEN];
+
+/* Shared between the postmaster, the proxies and the backends they start */
+static char ProxySecret[PROXY_SECRET_LEN];
+
+/* Unix-domain socket through which proxies start backends */
+static char ProxySocketPath[MAXPGPATH];
+
+static ProxyStats *ProxyStatsArray = NULL;
+
+/* Session state of a backend started by a proxy; see ReportSessionPoolability */
+static const char *sessionUnpoolableReason = NULL;
+static bool sessionUnpoolableReported = false;
+
+
+/*
+ * Set up the listen sockets of the connection proxies, if enabled.  Called
+ * by the postmaster after creating its own sockets; socketdir is the first
+ * directory it created a Unix-domain socket in, or NULL if none.
+ */
+void
+ProxyInitListen(const char *socketdir)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *l;
+	int			success = 0;
+	int			i;
+
+	for (i = 0; i < MAXPROXYLISTEN; i++)
+		ProxyListenSocket[i] = PGINVALID_SOCKET;
+
+	if (ConnectionProxies == 0)
+		return;
+
+#ifndef PROXY_SUPPORTED
+	ereport(FATAL,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("connection proxies are not supported on this platform")));
+#endif
+
+	if (socketdir == NULL)
+		ereport(FATAL,
+				(errmsg("connection proxies require a Unix-domain socket"),
+				 errhint("Set \"unix_socket_directories\" to a directory to create one in.")));
+
+	if (ProxyPortNumber == PostPortNumber)
+		ereport(FATAL,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("\"proxy_port\" must be different from \"port\"")));
+
+	UNIXSOCK_PATH(ProxySocketPath, PostPortNumber, socketdir);
+
+	/* Need a modifiable copy of ListenAddresses */
+	rawstring = pstrdup(ListenAddresses);
+
+	/* Parse string into list of hostnames */
+	if (!SplitGUCList(rawstring, ',', &elemlist))
+		ereport(FATAL,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid list syntax in parameter \"%s\"",
+						"listen_addresses")));
+
+	foreach(l, elemlist)
+	{
+		char	   *curhost = (char *) lfirst(l);
+
+		if (StreamServerPort(AF_UNSPEC,
+							 strcmp(curhost, "*") == 0 ? NULL : curhost,
+							 (unsigned short) ProxyPortNumber,
+							 NULL,
+							 ProxyListenSocket, MAXPROXYLISTEN) == STATUS_OK)
+			success++;
+		else
+			ereport(WARNING,
+					(errmsg("could not create connection proxy listen socket for \"%s\"",
+							curhost)));
+	}
+
+	list_free(elemlist);
+	pfree(rawstring);
+
+	if (!success)
+		ereport(FATAL,
+				(errmsg("could not create any TCP/IP sockets for connection proxies"),
+				 errhint("Connection proxies listen on \"listen_addresses\".")));
+
+	/* All proxies accept on the same sockets, so don't block in accept() */
+	for (i = 0; i < MAXPROXYLISTEN; i++)
+	{
+		if (ProxyListenSocket[i] == PGINVALID_SOCKET)
+			break;
+		if (!pg_set_noblock(ProxyListenSocket[i]))
+			ereport(FATAL,
+					(errcode_for_socket_access(),
+					 errmsg("could not set connection proxy socket to nonblocking mode: %m")));
+	}
+
+	if (!pg_strong_random(ProxySecret, PROXY_SECRET_LEN))
+		ereport(FATAL,
+				(errmsg("could not generate connection proxy secret")));
+}
+
+/*
+ * Close the listen sockets of the connection proxies
+ */
+void
+ProxyCloseListen(void)
+{
+	int			i;
+
+	if (ConnectionProxies == 0)
+		return;
+
+	for (i = 0; i < MAXPROXYLISTEN; i++)
+	{
+		if (ProxyListenSocket[i] != PGINVALID_SOCKET)
+		{
+			StreamClose(ProxyListenSocket[i]);
+			ProxyListenSocket[i] = PGINVALID_SOCKET;
+		}
+	}
+}
+
+/*
+ * Check a proxy request packet received by a backend, and apply it to the
+ * backend's Port.  Returns false, after logging why, if the request is not
+ * valid.
+ */
+bool
+ProcessProxyRequest(Port *port, void *pkt, int len)
+{
+	ProxyRequestPacket *req = (ProxyRequestPacket *) pkt;
+	int			diff = 0;
+	int			i;
+
+	if (ConnectionProxies == 0 || !IS_AF_UNIX(port->laddr.addr.ss_family) ||
+		len != sizeof(ProxyRequestPacket))
+	{
+		ereport(COMMERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("invalid connection proxy request")));
+		return false;
+	}
+
+	/* Compare the whole secret, to not give away how much of it matched */
+	for (i = 0; i < PROXY_SECRET_LEN; i++)
+		diff |= req->secret[i] ^ ProxySecret[i];
+	if (diff != 0)
+	{
+		ereport(COMMERROR,
+				(errcode(ERRCODE_INVALID_AUTHORIZATION_SPECIFICATION),
+				 errmsg("invalid connection proxy request")));
+		return false;
+	}
+
+	port->raddr = req->raddr;
+	port->proxied = true;
+	port->proxy_trusted = (req->flags & PROXY_REQUEST_TRUSTED) != 0;
+
+	return true;
+}
+
+/*
+ * Backends no longer need the secret once they have their startup packet,
+ * so don't leave it lying around in their memory.
+ */
+void
+ProxyForgetSecret(void)
+{
+	explicit_bzero(ProxySecret, PROXY_SECRET_LEN);
+}
+
+
+/* ------------------------------------------------------------
+ * Backend side
+ * ------------------------------------------------------------
+ */
+
+/*
+ * Note that the session holds state that cannot be carried over to another
+ * client of a connection proxy.  reason must be a string constant.
+ *
+ * This does nothing outside of backends started by a proxy, and must not
+ * fail, as it is called from all over.
+ */
+void
+MarkSessionUnpoolable(const char *reason)
+{
+	if (MyProcPort == NULL || !MyProcPort->proxied)
+		return;
+
+	if (sessionUnpoolableReason == NULL)
+		sessionUnpoolableReason = reason;
+}
+
+/*
+ * Note that the session has been reset, by DISCARD ALL
+ */
+void
+ResetSessionPoolability(void)
+{
+	sessionUnpoolableReason = NULL;
+}
+
+/*
+ * Tell the proxy whether it may hand this backend to another client, if
+ * that changed since the last report.  Called just before ReadyForQuery.
+ */
+void
+ReportSessionPoolability(void)
+{
+	bool		unpoolable = (sessionUnpoolableReason != NULL);
+	StringInfoData buf;
+
+	if (unpoolable == sessionUnpoolableReported ||
+		whereToSendOutput != DestRemote)
+		return;
+
+	pq_beginmessage(&buf, 'S');
+	pq_sendstring(&buf, PROXY_SESSION_STATE_PARAM);
+	pq_sendstring(&buf, unpoolable ? sessionUnpoolableReason : "");
+	pq_endmessage(&buf);
+
+	sessionUnpoolableReported = unpoolable;
+}
+
+
+/* ------------------------------------------------------------
+ * Shared memory and monitoring
+ * ------------------------------------------------------------
+ */
+
+Size
+ProxyShmemSize(void)
+{
+	return mul_size(sizeof(ProxyStats), ConnectionProxies);
+}
+
+void
+ProxyShmemInit(void)
+{
+	bool		found;
+
+	if (ConnectionProxies == 0)
+		return;
+
+	ProxyStatsArray = (ProxyStats *)
+		ShmemInitStruct("Connection Proxy Stats", ProxyShmemSize(), &found);
+
+	if (!found)
+		MemSet(ProxyStatsArray, 0, ProxyShmemSize());
+}
+
+/*
+ * Copy the counters of the given proxy to *result.  Returns false if there
+ * is no such proxy; result->pid is 0 if it is not running.
+ */
+bool
+ProxyFetchStats(int id, ProxyStats *result)
+{
+	volatile ProxyStats *stats;
+
+	if (id < 0 || id >= ConnectionProxies || ProxyStatsArray == NULL)
+		return false;
+
+	stats = &ProxyStatsArray[id];
+	for (;;)
+	{
+		int			before_changecount;
+		int			after_changecount;
+
+		pgstat_begin_read_activity(stats, before_changecount);
+		memcpy(result, unvolatize(ProxyStats *, stats), sizeof(ProxyStats));
+		pgstat_end_read_activity(stats, after_changecount);
+
+		if (pgstat_read_activity_complete(before_changecount,
+										  after_changecount))
+			break;
+
+		/* Make sure we can break out of loop if stuck... */
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	return true;
+}
+
+
+#ifdef PROXY_SUPPORTED
+
+/* ------------------------------------------------------------
+ * Proxy process
+ * ------------------------------------------------------------
+ */
+
+/* How much to try to read from a socket at once */
+#define PROXY_READ_SIZE		8192
+
+/* Stop reading from a connection while its peer has this much unsent */
+#define PROXY_OUTPUT_LIMIT	(256 * 1024)
+
+/* Largest protocol message relayed */
+#define PROXY_MAX_MESSAGE	(MaxAllocSize - PROXY_READ_SIZE - 16)
+
+typedef struct ProxyPool ProxyPool;
+typedef struct ProxyBackend ProxyBackend;
+
+/* Common part of client and backend connections */
+typedef struct ProxyConn
+{
+	bool		is_backend;
+	bool		closing;		/* close once the output is sent */
+	bool		closed;			/* socket closed, to be freed */
+	pgsocket	sock;
+	StringInfoData inbuf;		/* received; cursor is the processed part */
+	StringInfoData outbuf;		/* to send; cursor is the sent part */
+} ProxyConn;
+
+typedef enum ProxyClientState
+{
+	CLIENT_STARTUP,				/* waiting for the startup packet */
+	CLIENT_AUTH,				/* authenticating through its own backend */
+	CLIENT_IDLE,				/* between transactions */
+	CLIENT_WAITING,				/* waiting for a backend */
+	CLIENT_ACTIVE				/* has a backend */
+} ProxyClientState;
+
+typedef struct ProxyClient
+{
+	ProxyConn	conn;
+	ProxyClientState state;
+	SockAddr	raddr;
+	time_t		connect_time;
+	ProxyPool  *pool;			/* set once the startup packet is in */
+	ProxyBackend *backend;		/* in CLIENT_AUTH and CLIENT_ACTIVE */
+	int			pending;		/* Query, FunctionCall and Sync messages not
+								 * yet answered by ReadyForQuery */
+} ProxyClient;
+
+typedef enum ProxyBackendState
+{
+	BACKEND_STARTING,			/* started to grow a pool, not ready yet */
+	BACKEND_AUTH,				/* authenticating a client */
+	BACKEND_IDLE,				/* in its pool, ready for a client */
+	BACKEND_ACTIVE				/* serving a client */
+} ProxyBackendState;
+
+struct ProxyBackend
+{
+	ProxyConn	conn;
+	ProxyBackendState state;
+	ProxyPool  *pool;
+	ProxyClient *client;		/* in BACKEND_AUTH and BACKEND_ACTIVE */
+	bool		dedicated;		/* session state ties it to its client */
+};
+
+/* Backends shared by the clients with the same startup packet */
+struct ProxyPool
+{
+	char	   *startup;		/* startup packet, with length word */
+	int			startup_len;
+	int			n_clients;		/* authenticated clients */
+	int			n_backends;		/* backends other than dedicated ones,
+								 * including starting ones */
+	int			n_starting;
+	int			n_dedicated;
+	List	   *idle;			/* idle backends, ready for use */
+	List	   *waiting;		/* clients waiting for a backend */
+};
+
+static int	MyProxyId;
+static ProxyStats *MyProxyStats;
+
+static List *proxyClients = NIL;
+static List *proxyBackends = NIL;
+static List *proxyPools = NIL;
+static int64 proxyTransactions = 0;
+
+static void ProxyMain(int id) pg_attribute_noreturn();
+static void proxy_shutdown_hook(int code, Datum arg);
+static void proxy_report_stats(void);
+static void proxy_accept(pgsocket listen_sock);
+static void proxy_read(ProxyConn *conn);
+static void proxy_write(ProxyConn *conn);
+static void proxy_close(ProxyConn *conn);
+static void proxy_free_closed(void);
+static int	proxy_next_message(ProxyConn *conn, int *msglen);
+static bool proxy_wants_input(ProxyConn *conn);
+static void proxy_send_error(ProxyClient *client, const char *sqlstate,
+							 const char *msg);
+static void client_process_startup(ProxyClient *client);
+static void client_process_messages(ProxyClient *client);
+static void client_acquire_backend(ProxyClient *client);
+static void client_lost(ProxyClient *client);
+static ProxyPool *pool_lookup(const char *startup, int len);
+static void pool_grow(ProxyPool *pool);
+static ProxyBackend *backend_launch(ProxyPool *pool, ProxyClient *client,
+									bool trusted);
+static void backend_process_messages(ProxyBackend *backend);
+static void backend_bind(ProxyBackend *backend, ProxyClient *client);
+static void backend_release(ProxyBackend *backend);
+static void backend_terminate(ProxyBackend *backend);
+static void backend_lost(ProxyBackend *backend);
+static void backend_detach(ProxyBackend *backend);
+static void backend_set_dedicated(ProxyBackend *backend, const char *reason);
+
+/*
+ * Start connection proxy number id.  Returns the PID, or 0 on failure.
+ */
+int
+ProxyStart(int id)
+{
+	pid_t		pid;
+
+	switch ((pid = fork_process()))
+	{
+		case -1:
+			ereport(LOG,
+					(errmsg("could not fork connection proxy: %m")));
+			return 0;
+
+		case 0:
+			/* in postmaster child ... */
+			InitPostmasterChild();
+
+			/* Close the postmaster's sockets, except for the proxy ones */
+			MyBackendType = B_PROXY;
+			ClosePostmasterPorts(false);
+
+			ProxyMain(id);
+			break;
+
+		default:
+			return (int) pid;
+	}
+
+	/* shouldn't get here */
+	return 0;
+}
+
+/*
+ * Main entry point for a connection proxy
+ */
+static void
+ProxyMain(int id)
+{
+	struct pollfd *fds = NULL;
+	ProxyConn **fdconns = NULL;
+	int			maxfds = 0;
+	bool		listening = true;
+
+	/*
+	 * Ignore all signals usually bound to some action in the postmaster,
+	 * except for SIGHUP, SIGTERM and SIGQUIT.
+	 */
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGINT, SIG_IGN);
+	pqsignal(SIGTERM, SignalHandlerForShutdownRequest);
+	pqsignal(SIGQUIT, SignalHandlerForCrashExit);
+	pqsignal(SIGALRM, SIG_IGN);
+	pqsignal(SIGPIPE, SIG_IGN);
+	pqsignal(SIGUSR1, SIG_IGN);
+	pqsignal(SIGUSR2, SIG_IGN);
+	/* Reset some signals that are accepted by postmaster but not here */
+	pqsignal(SIGCHLD, SIG_DFL);
+	PG_SETMASK(&UnBlockSig);
+
+	init_ps_display(NULL);
+
+	MyProxyId = id;
+	MyProxyStats = &ProxyStatsArray[id];
+
+	/* A predecessor that died mid-update may have left the count odd */
+	if (MyProxyStats->st_changecount & 1)
+		MyProxyStats->st_changecount++;
+	pg_write_barrier();
+	on_proc_exit(proxy_shutdown_hook, 0);
+	proxy_report_stats();
+
+	for (;;)
+	{
+		int			nfds = 0;
+		int			needed;
+		int			rc;
+		int			i;
+		time_t		now;
+		ListCell   *lc;
+
+		if (ConfigReloadPending)
+		{
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		/*
+		 * On shutdown, stop accepting connections, and let go of clients as
+		 * soon as they are between transactions.
+		 */
+		if (ShutdownRequestPending)
+		{
+			if (listening)
+			{
+				ProxyCloseListen();
+				listening = false;
+			}
+
+			foreach(lc, proxyClients)
+			{
+				ProxyClient *client = (ProxyClient *) lfirst(lc);
+
+				if (client->state != CLIENT_ACTIVE &&
+					client->state != CLIENT_AUTH)
+					proxy_close(&client->conn);
+			}
+			foreach(lc, proxyBackends)
+			{
+				ProxyBackend *backend = (ProxyBackend *) lfirst(lc);
+
+				if (backend->state == BACKEND_IDLE ||
+					backend->state == BACKEND_STARTING)
+					backend_terminate(backend);
+			}
+		}
+
+		/* Give up on clients that don't send a startup packet in time */
+		now = time(NULL);
+		foreach(lc, proxyClients)
+		{
+			ProxyClient *client = (ProxyClient *) lfirst(lc);
+
+			if (client->state == CLIENT_STARTUP &&
+				now - client->connect_time > AuthenticationTimeout)
+				proxy_close(&client->conn);
+		}
+
+		/* Send what we can before waiting */
+		foreach(lc, proxyClients)
+			proxy_write((ProxyConn *) lfirst(lc));
+		foreach(lc, proxyBackends)
+			proxy_write((ProxyConn *) lfirst(lc));
+
+		proxy_free_closed();
+		proxy_report_stats();
+
+		if (ShutdownRequestPending && proxyClients == NIL &&
+			proxyBackends == NIL)
+			proc_exit(0);
+
+		/* Set up the poll array */
+		needed = MAXPROXYLISTEN + 1 + list_length(proxyClients) +
+			list_length(proxyBackends);
+		if (needed > maxfds)
+		{
+			maxfds = Max(needed, 2 * maxfds);
+			if (fds)
+			{
+				pfree(fds);
+				pfree(fdconns);
+			}
+			fds = palloc(maxfds * sizeof(struct pollfd));
+			fdconns = palloc(maxfds * sizeof(ProxyConn *));
+		}
+
+		fds[nfds].fd = postmaster_alive_fds[POSTMASTER_FD_WATCH];
+		fds[nfds].events = POLLIN;
+		fdconns[nfds++] = NULL;
+
+		for (i = 0; listening && i < MAXPROXYLISTEN; i++)
+		{
+			if (ProxyListenSocket[i] == PGINVALID_SOCKET)
+				break;
+			fds[nfds].fd = ProxyListenSocket[i];
+			fds[nfds].events = POLLIN;
+			fdconns[nfds++] = NULL;
+		}
+
+		foreach(lc, proxyClients)
+		{
+			ProxyConn  *conn = (ProxyConn *) lfirst(lc);
+
+			fds[nfds].fd = conn->sock;
+			fds[nfds].events = (proxy_wants_input(conn) ? POLLIN : 0) |
+				(conn->outbuf.cursor < conn->outbuf.len ? POLLOUT : 0);
+			fdconns[nfds++] = conn;
+		}
+		foreach(lc, proxyBackends)
+		{
+			ProxyConn  *conn = (ProxyConn *) lfirst(lc);
+
+			fds[nfds].fd = conn->sock;
+			fds[nfds].events = (proxy_wants_input(conn) ? POLLIN : 0) |
+				(conn->outbuf.cursor < conn->outbuf.len ? POLLOUT : 0);
+			fdconns[nfds++] = conn;
+		}
+
+		rc = poll(fds, nfds, 1000);
+
+		if (rc < 0)
+		{
+			if (errno != EINTR)
+				ereport(LOG,
+						(errcode_for_socket_access(),
+						 errmsg("poll() failed in connection proxy: %m")));
+			continue;
+		}
+
+		/* Exit immediately if the postmaster died */
+		if (!PostmasterIsAlive())
+			exit(1);
+
+		for (i = 1; i < nfds; i++)
+		{
+			ProxyConn  *conn = fdconns[i];
+
+			if (fds[i].revents == 0)
+				continue;
+
+			if (conn == NULL)
+				proxy_accept(fds[i].fd);
+			else if (!conn->closed)
+			{
+				if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+					proxy_read(conn);
+				if (!conn->closed && (fds[i].revents & POLLOUT))
+					proxy_write(conn);
+			}
+		}
+	}
+}
+
+/*
+ * Mark our stats entry unused at exit
+ */
+static void
+proxy_shutdown_hook(int code, Datum arg)
+{
+	volatile ProxyStats *stats = MyProxyStats;
+
+	PGSTAT_BEGIN_WRITE_ACTIVITY(stats);
+	stats->pid = 0;
+	PGSTAT_END_WRITE_ACTIVITY(stats);
+}
+
+/*
+ * Publish our counters for pg_stat_proxies
+ */
+static void
+proxy_report_stats(void)
+{
+	volatile ProxyStats *stats = MyProxyStats;
+	int			n_idle = 0;
+	int			n_dedicated = 0;
+	int			n_waiting = 0;
+	ListCell   *lc;
+
+	foreach(lc, proxyPools)
+	{
+		ProxyPool  *pool = (ProxyPool *) lfirst(lc);
+
+		n_idle += list_length(pool->idle);
+		n_dedicated += pool->n_dedicated;
+		n_waiting += list_length(pool->waiting);
+	}
+
+	PGSTAT_BEGIN_WRITE_ACTIVITY(stats);
+	stats->pid = MyProcPid;
+	stats->n_clients = list_length(proxyClients);
+	stats->n_pools = list_length(proxyPools);
+	stats->n_backends = list_length(proxyBackends);
+	stats->n_idle_backends = n_idle;
+	stats->n_dedicated_backends = n_dedicated;
+	stats->n_waiting_clients = n_waiting;
+	stats->n_transactions = proxyTransactions;
+	PGSTAT_END_WRITE_ACTIVITY(stats);
+}
+
+static void
+proxy_init_conn(ProxyConn *conn, pgsocket sock, bool is_backend)
+{
+	conn->is_backend = is_backend;
+	conn->sock = sock;
+	initStringInfo(&conn->inbuf);
+	initStringInfo(&conn->outbuf);
+}
+
+/*
+ * Accept new client connections on a listen socket
+ */
+static void
+proxy_accept(pgsocket listen_sock)
+{
+	for (;;)
+	{
+		ProxyClient *client;
+		SockAddr	raddr;
+		pgsocket	sock;
+		int			on = 1;
+
+		raddr.salen = sizeof(raddr.addr);
+		sock = accept(listen_sock, (struct sockaddr *) &raddr.addr,
+					  &raddr.salen);
+		if (sock == PGINVALID_SOCKET)
+		{
+			/* Another proxy may have beaten us to it */
+			if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+				ereport(LOG,
+						(errcode_for_socket_access(),
+						 errmsg("could not accept new connection: %m")));
+			return;
+		}
+
+		if (!pg_set_noblock(sock))
+		{
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not set socket to nonblocking mode: %m")));
+			closesocket(sock);
+			continue;
+		}
+#ifdef TCP_NODELAY
+		(void) setsockopt(sock, IPPROTO_TCP, TCP_NODELAY,
+						  (char *) &on, sizeof(on));
+#endif
+		(void) setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE,
+						  (char *) &on, sizeof(on));
+
+		client = palloc0(sizeof(ProxyClient));
+		proxy_init_conn(&client->conn, sock, false);
+		client->state = CLIENT_STARTUP;
+		client->raddr = raddr;
+		client->connect_time = time(NULL);
+		proxyClients = lappend(proxyClients, client);
+	}
+}
+
+/*
+ * Should we read from this connection?  We stop reading while the other
+ * side can't keep up, and from clients that are waiting for a backend.
+ */
+static bool
+proxy_wants_input(ProxyConn *conn)
+{
+	ProxyConn  *peer = NULL;
+
+	if (conn->closing)
+		return false;
+
+	if (conn->is_backend)
+	{
+		ProxyBackend *backend = (ProxyBackend *) conn;
+
+		if (backend->client)
+			peer = &backend->client->conn;
+	}
+	else
+	{
+		ProxyClient *client = (ProxyClient *) conn;
+
+		if (client->state == CLIENT_WAITING)
+			return false;
+		if (client->backend)
+			peer = &client->backend->conn;
+	}
+
+	return peer == NULL ||
+		peer->outbuf.len - peer->outbuf.cursor < PROXY_OUTPUT_LIMIT;
+}
+
+/*
+ * Read what is available on a connection, and process it
+ */
+static void
+proxy_read(ProxyConn *conn)
+{
+	StringInfo	buf = &conn->inbuf;
+	ssize_t		n;
+
+	enlargeStringInfo(buf, PROXY_READ_SIZE);
+	n = recv(conn->sock, buf->data + buf->len, buf->maxlen - buf->len - 1, 0);
+	if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+		return;
+	if (n <= 0)
+	{
+		/* Connection closed or broken */
+		if (conn->is_backend)
+			backend_lost((ProxyBackend *) conn);
+		else
+			client_lost((ProxyClient *) conn);
+		return;
+	}
+	buf->len += n;
+	buf->data[buf->len] = '\0';
+
+	if (conn->is_backend)
+		backend_process_messages((ProxyBackend *) conn);
+	else
+	{
+		ProxyClient *client = (ProxyClient *) conn;
+
+		if (client->state == CLIENT_STARTUP)
+			client_process_startup(client);
+		else
+			client_process_messages(client);
+	}
+
+	/* Forget what has been processed */
+	if (buf->cursor > 0)
+	{
+		if (buf->cursor < buf->len)
+			memmove(buf->data, buf->data + buf->cursor, buf->len - buf->cursor);
+		buf->len -= buf->cursor;
+		buf->cursor = 0;
+		buf->data[buf->len] = '\0';
+	}
+}
+
+/*
+ * Send what we can of the output of a connection
+ */
+static void
+proxy_write(ProxyConn *conn)
+{
+	StringInfo	buf = &conn->outbuf;
+
+	while (!conn->closed && buf->cursor < buf->len)
+	{
+		ssize_t		n;
+
+		n = send(conn->sock, buf->data + buf->cursor, buf->len - buf->cursor, 0);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return;
+			if (conn->is_backend)
+				backend_lost((ProxyBackend *) conn);
+			else
+				client_lost((ProxyClient *) conn);
+			return;
+		}
+		buf->cursor += n;
+	}
+
+	resetStringInfo(buf);
+
+	if (conn->closing && !conn->closed)
+		proxy_close(conn);
+}
+
+/*
+ * Close a connection.  It is freed later, since the main loop may still
+ * hold pointers to it.
+ */
+static void
+proxy_close(ProxyConn *conn)
+{
+	if (conn->closed)
+		return;
+
+	closesocket(conn->sock);
+	conn->sock = PGINVALID_SOCKET;
+	conn->closed = true;
+
+	if (!conn->is_backend)
+	{
+		ProxyClient *client = (ProxyClient *) conn;
+
+		if (client->state == CLIENT_WAITING)
+			client->pool->waiting = list_delete_ptr(client->pool->waiting,
+													client);
+		if (client->state != CLIENT_STARTUP &&
+			client->state != CLIENT_AUTH)
+			client->pool->n_clients--;
+	}
+}
+
+/*
+ * Free closed connections, and pools that have neither clients nor
+ * backends left.
+ */
+static void
+proxy_free_closed(void)
+{
+	ListCell   *lc;
+
+	foreach(lc, proxyClients)
+	{
+		ProxyClient *client = (ProxyClient *) lfirst(lc);
+
+		if (client->conn.closed)
+		{
+			proxyClients = foreach_delete_current(proxyClients, lc);
+			pfree(client->conn.inbuf.data);
+			pfree(client->conn.outbuf.data);
+			pfree(client);
+		}
+	}
+
+	foreach(lc, proxyBackends)
+	{
+		ProxyBackend *backend = (ProxyBackend *) lfirst(lc);
+
+		if (backend->conn.closed)
+		{
+			proxyBackends = foreach_delete_current(proxyBackends, lc);
+			pfree(backend->conn.inbuf.data);
+			pfree(backend->conn.outbuf.data);
+			pfree(backend);
+		}
+	}
+
+	foreach(lc, proxyPools)
+	{
+		ProxyPool  *pool = (ProxyPool *) lfirst(lc);
+		ListCell   *lc2;
+		bool		inuse = (pool->n_clients > 0 || pool->n_backends > 0 ||
+							 pool->n_dedicated > 0);
+
+		/* Clients still authenticating refer to the pool, too */
+		foreach(lc2, proxyClients)
+		{
+			if (((ProxyClient *) lfirst(lc2))->pool == pool)
+				inuse = true;
+		}
+
+		if (!inuse)
+		{
+			proxyPools = foreach_delete_current(proxyPools, lc);
+			pfree(pool->startup);
+			pfree(pool);
+		}
+	}
+}
+
+/*
+ * Check for a complete message at the cursor of a connection's input.
+ * Returns 1 and sets *msglen to its length, including the type byte, if
+ * there is one; 0 if there isn't yet; and -1 if the length is bogus.
+ */
+static int
+proxy_next_message(ProxyConn *conn, int *msglen)
+{
+	StringInfo	buf = &conn->inbuf;
+	int			avail = buf->len - buf->cursor;
+	uint32		len;
+
+	if (avail < 5)
+		return 0;
+
+	memcpy(&len, buf->data + buf->cursor + 1, 4);
+	len = pg_ntoh32(len);
+	if (len < 4 || len > PROXY_MAX_MESSAGE)
+		return -1;
+
+	if (avail < (int) len + 1)
+	{
+		/* Make room for the rest at once */
+		enlargeStringInfo(buf, len + 1 - avail);
+		return 0;
+	}
+
+	*msglen = len + 1;
+	return 1;
+}
+
+/*
+ * Send a FATAL error to a client and close its connection
+ */
+static void
+proxy_send_error(ProxyClient *client, const char *sqlstate, const char *msg)
+{
+	StringInfoData buf;
+
+	initStringInfo(&buf);
+	pq_sendbyte(&buf, 'S');
+	pq_sendstring(&buf, "FATAL");
+	pq_sendbyte(&buf, 'V');
+	pq_sendstring(&buf, "FATAL");
+	pq_sendbyte(&buf, 'C');
+	pq_sendstring(&buf, sqlstate);
+	pq_sendbyte(&buf, 'M');
+	pq_sendstring(&buf, msg);
+	pq_sendbyte(&buf, '\0');
+
+	pq_sendbyte(&client->conn.outbuf, 'E');
+	pq_sendint32(&client->conn.outbuf, buf.len + 4);
+	appendBinaryStringInfo(&client->conn.outbuf, buf.data, buf.len);
+	pfree(buf.data);
+
+	client->conn.closing = true;
+}
+
+/*
+ * Process the startup packet of a new client, or a request to negotiate
+ * encryption that precedes it.
+ */
+static void
+client_process_startup(ProxyClient *client)
+{
+	StringInfo	buf = &client->conn.inbuf;
+
+	while (client->state == CLIENT_STARTUP && !client->conn.closing)
+	{
+		int			avail = buf->len - buf->cursor;
+		uint32		len;
+		ProtocolVersion proto;
+		char	   *packet;
+		int			offset;
+		ProxyBackend *backend;
+
+		if (avail < 8)
+			return;
+
+		memcpy(&len, buf->data + buf->cursor, 4);
+		len = pg_ntoh32(len);
+		if (len < 8 || len > MAX_STARTUP_PACKET_LENGTH)
+		{
+			proxy_close(&client->conn);
+			return;
+		}
+		if (avail < (int) len)
+			return;
+
+		packet = buf->data + buf->cursor;
+		memcpy(&proto, packet + 4, 4);
+		proto = pg_ntoh32(proto);
+
+		if (proto == NEGOTIATE_SSL_CODE || proto == NEGOTIATE_GSS_CODE)
+		{
+			/* No encryption through a proxy; the client may proceed without */
+			appendStringInfoChar(&client->conn.outbuf, 'N');
+			buf->cursor += len;
+			continue;
+		}
+
+		if (proto == CANCEL_REQUEST_CODE)
+		{
+			/* Not supported; the client doesn't expect a response anyway */
+			proxy_close(&client->conn);
+			return;
+		}
+
+		if (PG_PROTOCOL_MAJOR(proto) != 3)
+		{
+			proxy_send_error(client, "0A000",
+							 "connection proxies only support protocol version 3");
+			return;
+		}
+
+		/* Reject replication connections, which can't share backends */
+		for (offset = 8; offset < (int) len;)
+		{
+			char	   *name = packet + offset;
+			char	   *value;
+
+			if (*name == '\0')
+				break;
+			value = name + strnlen(name, len - offset) + 1;
+			if (value >= packet + len)
+				break;
+			if (strcmp(name, "replication") == 0)
+			{
+				proxy_send_error(client, "0A000",
+								 "replication connections are not supported through connection proxies");
+				return;
+			}
+			offset = value - packet + strnlen(value, packet + len - value) + 1;
+		}
+
+		client->pool = pool_lookup(packet, len);
+		buf->cursor += len;
+
+		/* Authenticate the client through a backend of its own */
+		backend = backend_launch(client->pool, client, false);
+		if (backend == NULL)
+		{
+			proxy_send_error(client, "53000",
+							 "connection proxy could not start a backend");
+			return;
+		}
+		backend->client = client;
+		client->backend = backend;
+		client->state = CLIENT_AUTH;
+	}
+}
+
+/*
+ * Relay the messages of a client to its backend, acquiring one first if
+ * needed.
+ */
+static void
+client_process_messages(ProxyClient *client)
+{
+	int			msglen;
+	int			rc;
+
+	while (!client->conn.closing && !client->conn.closed &&
+		   (rc = proxy_next_message(&client->conn, &msglen)) != 0)
+	{
+		char		msgtype;
+
+		if (rc < 0)
+		{
+			proxy_close(&client->conn);
+			if (client->backend)
+				backend_terminate(client->backend);
+			return;
+		}
+
+		msgtype = client->conn.inbuf.data[client->conn.inbuf.cursor];
+
+		if (client->state == CLIENT_IDLE)
+		{
+			if (msgtype == 'X')
+			{
+				proxy_close(&client->conn);
+				return;
+			}
+			client_acquire_backend(client);
+		}
+
+		if (client->state != CLIENT_ACTIVE && client->state != CLIENT_AUTH)
+			return;
+
+		if (msgtype == 'X')
+		{
+			/* The session ends mid-transaction, or had its own backend */
+			proxy_close(&client->conn);
+			backend_terminate(client->backend);
+			return;
+		}
+
+		if (msgtype == 'Q' || msgtype == 'F' || msgtype == 'S')
+			client->pending++;
+
+		appendBinaryStringInfo(&client->backend->conn.outbuf,
+							   client->conn.inbuf.data + client->conn.inbuf.cursor,
+							   msglen);
+		client->conn.inbuf.cursor += msglen;
+	}
+}
+
+/*
+ * Get an idle backend of the client's pool, or queue the client for one
+ */
+static void
+client_acquire_backend(ProxyClient *client)
+{
+	ProxyPool  *pool = client->pool;
+
+	if (pool->idle != NIL)
+	{
+		ProxyBackend *backend = (ProxyBackend *) linitial(pool->idle);
+
+		pool->idle = list_delete_first(pool->idle);
+		backend_bind(backend, client);
+		return;
+	}
+
+	client->state = CLIENT_WAITING;
+	pool->waiting = lappend(pool->waiting, client);
+	pool_grow(pool);
+}
+
+/*
+ * A client closed its connection, or it broke
+ */
+static void
+client_lost(ProxyClient *client)
+{
+	ProxyBackend *backend = client->backend;
+
+	proxy_close(&client->conn);
+
+	/* A backend in the middle of a transaction or session can't be reused */
+	if (backend)
+		backend_terminate(backend);
+}
+
+/*
+ * Find or create the pool for a startup packet
+ */
+static ProxyPool *
+pool_lookup(const char *startup, int len)
+{
+	ProxyPool  *pool;
+	ListCell   *lc;
+
+	foreach(lc, proxyPools)
+	{
+		pool = (ProxyPool *) lfirst(lc);
+		if (pool->startup_len == len && memcmp(pool->startup, startup, len) == 0)
+			return pool;
+	}
+
+	pool = palloc0(sizeof(ProxyPool));
+	pool->startup = palloc(len);
+	memcpy(pool->startup, startup, len);
+	pool->startup_len = len;
+	proxyPools = lappend(proxyPools, pool);
+
+	return pool;
+}
+
+/*
+ * Start backends for the clients waiting in a pool, as far as the pool may
+ * grow and not enough backends are on their way already.  If the pool is
+ * left without any backend the clients could get, fail them.
+ */
+static void
+pool_grow(ProxyPool *pool)
+{
+	while (pool->waiting != NIL && pool->n_backends < SessionPoolSize &&
+		   pool->n_starting < list_length(pool->waiting))
+	{
+		if (backend_launch(pool, (ProxyClient *) linitial(pool->waiting),
+						   true) == NULL)
+			break;
+	}
+
+	if (pool->n_backends == 0)
+	{
+		while (pool->waiting != NIL)
+		{
+			ProxyClient *client = (ProxyClient *) linitial(pool->waiting);
+
+			pool->waiting = list_delete_first(pool->waiting);
+			client->state = CLIENT_IDLE;
+			proxy_send_error(client, "53000",
+							 "connection proxy could not start a backend");
+		}
+	}
+}
+
+/*
+ * Start a backend for a pool, on behalf of the given client.  A trusted one
+ * grows the pool; otherwise it authenticates the client.  Returns NULL if
+ * we could not connect to the postmaster.
+ */
+static ProxyBackend *
+backend_launch(ProxyPool *pool, ProxyClient *client, bool trusted)
+{
+	ProxyBackend *backend;
+	ProxyRequestPacket req;
+	struct sockaddr_un addr;
+	pgsocket	sock;
+
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock == PGINVALID_SOCKET)
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not create socket: %m")));
+		return NULL;
+	}
+
+	MemSet(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strlcpy(addr.sun_path, ProxySocketPath, sizeof(addr.sun_path));
+
+	/* Connecting to the postmaster doesn't take long, so do it blocking */
+	if (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+		!pg_set_noblock(sock))
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("connection proxy could not connect to server socket \"%s\": %m",
+						ProxySocketPath)));
+		closesocket(sock);
+		return NULL;
+	}
+
+	backend = palloc0(sizeof(ProxyBackend));
+	proxy_init_conn(&backend->conn, sock, true);
+	backend->pool = pool;
+
+	if (trusted)
+	{
+		backend->state = BACKEND_STARTING;
+		pool->n_backends++;
+		pool->n_starting++;
+	}
+	else
+		backend->state = BACKEND_AUTH;
+
+	MemSet(&req, 0, sizeof(req));
+	req.proxyRequestCode = pg_hton32(PROXY_REQUEST_CODE);
+	req.flags = trusted ? PROXY_REQUEST_TRUSTED : 0;
+	memcpy(req.secret, ProxySecret, PROXY_SECRET_LEN);
+	req.raddr = client->raddr;
+
+	pq_sendint32(&backend->conn.outbuf, sizeof(req) + 4);
+	appendBinaryStringInfo(&backend->conn.outbuf, (char *) &req, sizeof(req));
+	appendBinaryStringInfo(&backend->conn.outbuf, pool->startup,
+						   pool->startup_len);
+
+	proxyBackends = lappend(proxyBackends, backend);
+
+	return backend;
+}
+
+/*
+ * Process the messages a backend sent
+ */
+static void
+backend_process_messages(ProxyBackend *backend)
+{
+	StringInfo	buf = &backend->conn.inbuf;
+	int			msglen;
+	int			rc;
+
+	while (!backend->conn.closed && !backend->conn.closing &&
+		   (rc = proxy_next_message(&backend->conn, &msglen)) != 0)
+	{
+		char	   *msg = buf->data + buf->cursor;
+		char		msgtype = msg[0];
+		ProxyClient *client = backend->client;
+		bool		relay = (client != NULL);
+
+		if (rc < 0)
+		{
+			backend_lost(backend);
+			return;
+		}
+		buf->cursor += msglen;
+
+		if (msgtype == 'S' && strcmp(msg + 5, PROXY_SESSION_STATE_PARAM) == 0)
+		{
+			char	   *value = msg + 5 + strlen(PROXY_SESSION_STATE_PARAM) + 1;
+
+			backend_set_dedicated(backend, *value ? value : NULL);
+			continue;
+		}
+
+		switch (backend->state)
+		{
+			case BACKEND_STARTING:
+				if (msgtype == 'E')
+				{
+					ereport(LOG,
+							(errmsg("connection proxy could not start a backend for a session pool")));
+					backend_lost(backend);
+					return;
+				}
+				if (msgtype == 'Z')
+				{
+					backend->pool->n_starting--;
+					backend_release(backend);
+				}
+				break;
+
+			case BACKEND_AUTH:
+				if (msgtype == 'K')
+				{
+					/* Cancel requests are not supported through a proxy */
+					MemSet(msg + 5, 0, msglen - 5);
+				}
+				else if (msgtype == 'Z')
+				{
+					ProxyPool  *pool = backend->pool;
+
+					/* Authenticated; the client joins its pool */
+					appendBinaryStringInfo(&client->conn.outbuf, msg, msglen);
+					relay = false;
+					client->backend = NULL;
+					client->state = CLIENT_IDLE;
+					pool->n_clients++;
+
+					/*
+					 * The backend joins the pool too, unless that's full, or
+					 * it already holds session state.
+					 */
+					backend->client = NULL;
+					if (backend->dedicated)
+					{
+						/* Tie it to the client after all */
+						backend_bind(backend, client);
+						pool->n_dedicated++;
+					}
+					else if (pool->n_backends < SessionPoolSize)
+					{
+						pool->n_backends++;
+						backend_release(backend);
+					}
+					else
+						backend_terminate(backend);
+
+					/* The client may have sent something already */
+					client_process_messages(client);
+				}
+				break;
+
+			case BACKEND_IDLE:
+				/* Nobody to tell about notices and such */
+				relay = false;
+				break;
+
+			case BACKEND_ACTIVE:
+				if (msgtype == 'Z')
+				{
+					char		status = msglen > 5 ? msg[5] : 'I';
+
+					client->pending--;
+					if (status == 'I')
+						proxyTransactions++;
+
+					if (status == 'I' && client->pending <= 0 &&
+						!backend->dedicated)
+					{
+						/* Between transactions; hand the backend on */
+						appendBinaryStringInfo(&client->conn.outbuf, msg, msglen);
+						relay = false;
+						client->backend = NULL;
+						client->state = CLIENT_IDLE;
+						backend->client = NULL;
+						if (ShutdownRequestPending)
+							client->conn.closing = true;
+						backend_release(backend);
+						client_process_messages(client);
+					}
+				}
+				break;
+		}
+
+		if (relay)
+			appendBinaryStringInfo(&client->conn.outbuf, msg, msglen);
+	}
+}
+
+/*
+ * Attach a backend to a client
+ */
+static void
+backend_bind(ProxyBackend *backend, ProxyClient *client)
+{
+	backend->state = BACKEND_ACTIVE;
+	backend->client = client;
+	client->backend = backend;
+	client->state = CLIENT_ACTIVE;
+	client->pending = 0;
+}
+
+/*
+ * A backend of a pool is free; give it to the next waiting client, or keep
+ * it for later.
+ */
+static void
+backend_release(ProxyBackend *backend)
+{
+	ProxyPool  *pool = backend->pool;
+
+	if (pool->n_backends > SessionPoolSize || ShutdownRequestPending)
+	{
+		backend_terminate(backend);
+		return;
+	}
+
+	if (pool->waiting != NIL)
+	{
+		ProxyClient *client = (ProxyClient *) linitial(pool->waiting);
+
+		pool->waiting = list_delete_first(pool->waiting);
+		backend_bind(backend, client);
+		client_process_messages(client);
+		return;
+	}
+
+	backend->state = BACKEND_IDLE;
+	pool->idle = lappend(pool->idle, backend);
+}
+
+/*
+ * Ask a backend to exit, and forget about it
+ */
+static void
+backend_terminate(ProxyBackend *backend)
+{
+	if (backend->conn.closing || backend->conn.closed)
+		return;
+
+	pq_sendbyte(&backend->conn.outbuf, 'X');
+	pq_sendint32(&backend->conn.outbuf, 4);
+	backend->conn.closing = true;
+
+	backend_detach(backend);
+}
+
+/*
+ * A backend closed its connection, or it broke
+ */
+static void
+backend_lost(ProxyBackend *backend)
+{
+	proxy_close(&backend->conn);
+	backend_detach(backend);
+}
+
+/*
+ * A backend is going away; fix up its pool and client
+ */
+static void
+backend_detach(ProxyBackend *backend)
+{
+	ProxyPool  *pool = backend->pool;
+	ProxyClient *client = backend->client;
+
+	if (pool == NULL)
+		return;					/* already done */
+	backend->pool = NULL;
+
+	switch (backend->state)
+	{
+		case BACKEND_STARTING:
+			pool->n_starting--;
+			pool->n_backends--;
+			break;
+		case BACKEND_AUTH:
+			break;
+		case BACKEND_IDLE:
+			pool->idle = list_delete_ptr(pool->idle, backend);
+			pool->n_backends--;
+			break;
+		case BACKEND_ACTIVE:
+			if (backend->dedicated)
+				pool->n_dedicated--;
+			else
+				pool->n_backends--;
+			break;
+	}
+
+	/* Its client goes with it, once it has seen the backend's last words */
+	if (client)
+	{
+		client->backend = NULL;
+		client->conn.closing = true;
+		if (client->state == CLIENT_ACTIVE)
+			client->state = CLIENT_IDLE;
+	}
+	backend->client = NULL;
+
+	/* Replace it for waiting clients, if needed */
+	if (pool->waiting != NIL)
+		pool_grow(pool);
+}
+
+/*
+ * A backend reported a change of its session state
+ */
+static void
+backend_set_dedicated(ProxyBackend *backend, const char *reason)
+{
+	ProxyPool  *pool = backend->pool;
+	bool		dedicated = (reason != NULL);
+
+	if (dedicated == backend->dedicated)
+		return;
+	backend->dedicated = dedicated;
+
+	/* While authenticating, it does not count against the pool yet */
+	if (backend->state == BACKEND_AUTH)
+		return;
+
+	if (dedicated)
+	{
+		char		remote_host[NI_MAXHOST];
+
+		remote_host[0] = '\0';
+		(void) pg_getnameinfo_all(&backend->client->raddr.addr,
+								  backend->client->raddr.salen,
+								  remote_host, sizeof(remote_host),
+								  NULL, 0, NI_NUMERICHOST);
+		ereport(Log_connections ? LOG : DEBUG1,
+				(errmsg("connection proxy dedicates a backend to client %s",
+						remote_host),
+				 errdetail("The session holds state that cannot be shared: %s.",
+						   reason)));
+		pool->n_backends--;
+		pool->n_dedicated++;
+	}
+	else
+	{
+		pool->n_dedicated--;
+		pool->n_backends++;
+	}
+}
+
+#else							/* !PROXY_SUPPORTED */
+
+int
+ProxyStart(int id)
+{
+	return 0;
+}
+
+#endif							/* PROXY_SUPPORTED */
@@ -15,10 +15,20 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <time.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "access/xlog_internal.h"	/* for pg_start/stop_backup */
 #include "catalog/pg_type.h"
 #include "common/file_perm.h"
+#include "common/stream_compression.h"
 #include "commands/progress.h"
 #include "lib/stringinfo.h"
 #include "libpq/libpq.h"
@@ -35,11 +45,13 @@
 #include "replication/walsender_private.h"
 #include "storage/bufpage.h"
 #include "storage/checksum.h"
+#include "storage/doublewrite.h"
 #include "storage/dsm_impl.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/reinit.h"
 #include "utils/builtins.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/relcache.h"
 #include "utils/resowner.h"
@@ -56,6 +68,7 @@ typedef struct
 	bool		sendtblspcmapfile;
 	backup_manifest_option manifest;
 	pg_checksum_type manifest_checksum_type;
+	StreamCompressionMethod compression;
 } basebackup_options;
 
 static int64 sendTablespace(char *path, char *oid, bool sizeonly,
@@ -72,6 +85,12 @@ static int64 _tarWriteHeader(const char *filename, const char *linktarget,
 							 struct stat *statbuf, bool sizeonly);
 static int64 _tarWriteDir(const char *pathbuf, int basepathlen, struct stat *statbuf,
 						  bool sizeonly);
+static void begin_tar_stream(void);
+static void send_tar_data(const char *data, size_t len);
+static void end_tar_stream(void);
+static void compress_tar_data(const char *data, size_t len, bool finish);
+static void release_tar_compressor(void);
+static void send_copy_data(const char *data, size_t len);
 static void send_int8_string(StringInfoData *buf, int64 intval);
 static void SendBackupHeader(List *tablespaces);
 static void perform_base_backup(basebackup_options *opt);
@@ -103,6 +122,25 @@ static char *statrelpath = NULL;
 /* The actual number of bytes, transfer of which may cause sleep. */
 static uint64 throttling_sample;
 
+/*
+ * Compression applied to the tar streams, if requested by the client.  The
+ * compressor state is set up at the start of each tar stream and released
+ * at its end; the output buffer is kept for the whole backup.
+ */
+static StreamCompressionMethod backup_compression = STREAM_COMPRESSION_NONE;
+static bool backup_compression_active = false;
+static char *backup_compression_buf = NULL;
+static size_t backup_compression_bufsize = 0;
+#ifdef HAVE_LIBZ
+static z_stream backup_zstream;
+#endif
+#ifdef USE_LZ4
+static LZ4F_compressionContext_t backup_lz4_ctx = NULL;
+#endif
+#ifdef USE_ZSTD
+static ZSTD_CCtx *backup_zstd_ctx = NULL;
+#endif
+
 /* Amount of data already transferred but not yet throttled.  */
 static int64 throttling_counter;
 
@@ -225,6 +263,12 @@ static const struct exclude_list_item excludeFiles[] =
 	{"postmaster.pid", false},
 	{"postmaster.opts", false},
 
+	/*
+	 * Skip the double-write file.  A backup relies on full-page images in WAL
+	 * for torn page protection instead.
+	 */
+	{DOUBLE_WRITE_FILENAME, false},
+
 	/* end of list */
 	{NULL, false}
 };
@@ -266,6 +310,12 @@ perform_base_backup(basebackup_options *opt)
 
 	backup_total = 0;
 	backup_streamed = 0;
+
+	/* clean up after a previous backup that failed halfway through */
+	if (backup_compression_active)
+		release_tar_compressor();
+	backup_compression = opt->compression;
+
 	pgstat_progress_start_command(PROGRESS_COMMAND_BASEBACKUP, InvalidOid);
 
 	/*
@@ -411,6 +461,8 @@ perform_base_backup(basebackup_options *opt)
 			pq_sendint16(&buf, 0);	/* natts */
 			pq_endmessage(&buf);
 
+			begin_tar_stream();
+
 			if (ti->path == NULL)
 			{
 				struct stat statbuf;
@@ -455,7 +507,7 @@ perform_base_backup(basebackup_options *opt)
 				Assert(lnext(tablespaces, lc) == NULL);
 			}
 			else
-				pq_putemptymessage('c');	/* CopyDone */
+				end_tar_stream();
 
 			tblspc_streamed++;
 			pgstat_progress_update_param(PROGRESS_BASEBACKUP_TBLSPC_STREAMED,
@@ -638,10 +690,8 @@ perform_base_backup(basebackup_options *opt)
 											   len, pathbuf, true)) > 0)
 			{
 				CheckXLogRemoved(segno, tli);
-				/* Send the chunk as a CopyData message */
-				if (pq_putmessage('d', buf, cnt))
-					ereport(ERROR,
-							(errmsg("base backup could not send data, aborting backup")));
+				/* Send the chunk into the tar stream */
+				send_tar_data(buf, cnt);
 				update_basebackup_progress(cnt);
 
 				len += cnt;
@@ -705,8 +755,8 @@ perform_base_backup(basebackup_options *opt)
 			sendFileWithContent(pathbuf, "", &manifest);
 		}
 
-		/* Send CopyDone message for the last tar file */
-		pq_putemptymessage('c');
+		/* Terminate the last tar file */
+		end_tar_stream();
 	}
 
 	AddWALInfoToBackupManifest(&manifest, startptr, starttli, endptr, endtli);
@@ -762,6 +812,7 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 	bool		o_noverify_checksums = false;
 	bool		o_manifest = false;
 	bool		o_manifest_checksums = false;
+	bool		o_compression = false;
 
 	MemSet(opt, 0, sizeof(*opt));
 	opt->manifest = MANIFEST_OPTION_NO;
@@ -878,6 +929,26 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 								optval)));
 			o_manifest = true;
 		}
+		else if (strcmp(defel->defname, "compression") == 0)
+		{
+			char	   *optval = strVal(defel->arg);
+
+			if (o_compression)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			if (!parse_stream_compression_method(optval, &opt->compression))
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("unrecognized compression method: \"%s\"",
+								optval)));
+			if (!stream_compression_supported(opt->compression))
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("compression method \"%s\" is not supported by this build",
+								optval)));
+			o_compression = true;
+		}
 		else if (strcmp(defel->defname, "manifest_checksums") == 0)
 		{
 			char	   *optval = strVal(defel->arg);
@@ -1112,8 +1183,8 @@ sendFileWithContent(const char *filename, const char *content,
 	statbuf.st_size = len;
 
 	_tarWriteHeader(filename, NULL, &statbuf, false);
-	/* Send the contents as a CopyData message */
-	pq_putmessage('d', content, len);
+	/* Send the contents into the tar stream */
+	send_tar_data(content, len);
 	update_basebackup_progress(len);
 
 	/* Pad to a multiple of the tar block size. */
@@ -1123,7 +1194,7 @@ sendFileWithContent(const char *filename, const char *content,
 		char		buf[TAR_BLOCK_SIZE];
 
 		MemSet(buf, 0, pad);
-		pq_putmessage('d', buf, pad);
+		send_tar_data(buf, pad);
 		update_basebackup_progress(pad);
 	}
 
@@ -1748,10 +1819,8 @@ sendFile(const char *readfilename, const char *tarfilename,
 			}
 		}
 
-		/* Send the chunk as a CopyData message */
-		if (pq_putmessage('d', buf, cnt))
-			ereport(ERROR,
-					(errmsg("base backup could not send data, aborting backup")));
+		/* Send the chunk into the tar stream */
+		send_tar_data(buf, cnt);
 		update_basebackup_progress(cnt);
 
 		/* Also feed it to the checksum machinery. */
@@ -1768,7 +1837,7 @@ sendFile(const char *readfilename, const char *tarfilename,
 		while (len < statbuf->st_size)
 		{
 			cnt = Min(sizeof(buf), statbuf->st_size - len);
-			pq_putmessage('d', buf, cnt);
+			send_tar_data(buf, cnt);
 			pg_checksum_update(&checksum_ctx, (uint8 *) buf, cnt);
 			update_basebackup_progress(cnt);
 			len += cnt;
@@ -1785,7 +1854,7 @@ sendFile(const char *readfilename, const char *tarfilename,
 	if (pad > 0)
 	{
 		MemSet(buf, 0, pad);
-		pq_putmessage('d', buf, pad);
+		send_tar_data(buf, pad);
 		update_basebackup_progress(pad);
 	}
 
@@ -1843,7 +1912,7 @@ _tarWriteHeader(const char *filename, const char *linktarget,
 				elog(ERROR, "unrecognized tar error: %d", rc);
 		}
 
-		pq_putmessage('d', h, sizeof(h));
+		send_tar_data(h, sizeof(h));
 		update_basebackup_progress(sizeof(h));
 	}
 
@@ -1869,6 +1938,253 @@ _tarWriteDir(const char *pathbuf, int basepathlen, struct stat *statbuf,
 	return _tarWriteHeader(pathbuf + basepathlen + 1, NULL, statbuf, sizeonly);
 }
 
+/*
+ * Start sending a tar stream, after the CopyOutResponse message for it.
+ *
+ * If the client asked for compression, set up the compressor.  The whole tar
+ * stream, including its end-of-archive marker, then becomes a single file in
+ * the format of the respective command-line tool, which the client can store
+ * as-is.
+ */
+static void
+begin_tar_stream(void)
+{
+	Assert(!backup_compression_active);
+
+	if (backup_compression == STREAM_COMPRESSION_NONE)
+		return;
+
+	if (backup_compression_buf == NULL)
+	{
+		backup_compression_bufsize = 2 * TAR_SEND_SIZE;
+#ifdef USE_LZ4
+		backup_compression_bufsize = Max(backup_compression_bufsize,
+										 LZ4F_compressBound(TAR_SEND_SIZE, NULL));
+#endif
+		backup_compression_buf = MemoryContextAlloc(TopMemoryContext,
+													backup_compression_bufsize);
+	}
+
+	switch (backup_compression)
+	{
+#ifdef HAVE_LIBZ
+		case STREAM_COMPRESSION_GZIP:
+			MemSet(&backup_zstream, 0, sizeof(backup_zstream));
+			/* add 16 to the window bits to get a gzip header and trailer */
+			if (deflateInit2(&backup_zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+							 MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+				ereport(ERROR,
+						(errcode(ERRCODE_OUT_OF_MEMORY),
+						 errmsg("could not initialize compression library")));
+			break;
+#endif
+#ifdef USE_LZ4
+		case STREAM_COMPRESSION_LZ4:
+			{
+				size_t		len;
+
+				if (LZ4F_isError(LZ4F_createCompressionContext(&backup_lz4_ctx,
+															   LZ4F_VERSION)))
+					ereport(ERROR,
+							(errcode(ERRCODE_OUT_OF_MEMORY),
+							 errmsg("could not initialize compression library")));
+				len = LZ4F_compressBegin(backup_lz4_ctx, backup_compression_buf,
+										 backup_compression_bufsize, NULL);
+				if (LZ4F_isError(len))
+					elog(ERROR, "could not compress data: %s",
+						 LZ4F_getErrorName(len));
+				send_copy_data(backup_compression_buf, len);
+			}
+			break;
+#endif
+#ifdef USE_ZSTD
+		case STREAM_COMPRESSION_ZSTD:
+			backup_zstd_ctx = ZSTD_createCCtx();
+			if (backup_zstd_ctx == NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_OUT_OF_MEMORY),
+						 errmsg("could not initialize compression library")));
+			break;
+#endif
+		default:
+			elog(ERROR, "unsupported compression method %d",
+				 (int) backup_compression);
+	}
+
+	backup_compression_active = true;
+}
+
+/*
+ * Send data into the current tar stream, compressing it if requested.
+ */
+static void
+send_tar_data(const char *data, size_t len)
+{
+	if (backup_compression_active)
+		compress_tar_data(data, len, false);
+	else
+		send_copy_data(data, len);
+}
+
+/*
+ * Finish the current tar stream, and send CopyDone.
+ *
+ * Without compression, the client appends the two blocks of zeroes that end
+ * a tar archive itself.  A compressed stream has to include them, since the
+ * client does not look inside it.
+ */
+static void
+end_tar_stream(void)
+{
+	if (backup_compression_active)
+	{
+		char		zerobuf[2 * TAR_BLOCK_SIZE];
+
+		MemSet(zerobuf, 0, sizeof(zerobuf));
+		compress_tar_data(zerobuf, sizeof(zerobuf), false);
+		compress_tar_data(NULL, 0, true);
+		release_tar_compressor();
+	}
+
+	pq_putemptymessage('c');	/* CopyDone */
+}
+
+/*
+ * Feed data to the compressor, sending whatever output it produces.  With
+ * finish = true, also write out the end of the compressed file.
+ */
+static void
+compress_tar_data(const char *data, size_t len, bool finish)
+{
+	char	   *out = backup_compression_buf;
+	size_t		outsize = backup_compression_bufsize;
+
+	switch (backup_compression)
+	{
+#ifdef HAVE_LIBZ
+		case STREAM_COMPRESSION_GZIP:
+			{
+				int			rc;
+
+				backup_zstream.next_in = (Bytef *) data;
+				backup_zstream.avail_in = len;
+				do
+				{
+					backup_zstream.next_out = (Bytef *) out;
+					backup_zstream.avail_out = outsize;
+					rc = deflate(&backup_zstream, finish ? Z_FINISH : Z_NO_FLUSH);
+					if (rc == Z_STREAM_ERROR)
+						elog(ERROR, "could not compress data: %s",
+							 backup_zstream.msg ? backup_zstream.msg : "unknown error");
+					if (backup_zstream.avail_out < outsize)
+						send_copy_data(out, outsize - backup_zstream.avail_out);
+				} while (finish ? rc != Z_STREAM_END :
+						 backup_zstream.avail_out == 0);
+			}
+			break;
+#endif
+#ifdef USE_LZ4
+		case STREAM_COMPRESSION_LZ4:
+			{
+				size_t		outlen;
+
+				/* feed the data in pieces that fit the output buffer */
+				while (len > 0)
+				{
+					size_t		chunk = Min(len, TAR_SEND_SIZE);
+
+					outlen = LZ4F_compressUpdate(backup_lz4_ctx, out, outsize,
+												 data, chunk, NULL);
+					if (LZ4F_isError(outlen))
+						elog(ERROR, "could not compress data: %s",
+							 LZ4F_getErrorName(outlen));
+					if (outlen > 0)
+						send_copy_data(out, outlen);
+					data += chunk;
+					len -= chunk;
+				}
+
+				if (finish)
+				{
+					outlen = LZ4F_compressEnd(backup_lz4_ctx, out, outsize, NULL);
+					if (LZ4F_isError(outlen))
+						elog(ERROR, "could not compress data: %s",
+							 LZ4F_getErrorName(outlen));
+					send_copy_data(out, outlen);
+				}
+			}
+			break;
+#endif
+#ifdef USE_ZSTD
+		case STREAM_COMPRESSION_ZSTD:
+			{
+				ZSTD_inBuffer input = {data, len, 0};
+				size_t		remaining;
+
+				do
+				{
+					ZSTD_outBuffer output = {out, outsize, 0};
+
+					remaining = ZSTD_compressStream2(backup_zstd_ctx, &output, &input,
+													 finish ? ZSTD_e_end : ZSTD_e_continue);
+					if (ZSTD_isError(remaining))
+						elog(ERROR, "could not compress data: %s",
+							 ZSTD_getErrorName(remaining));
+					if (output.pos > 0)
+						send_copy_data(out, output.pos);
+				} while (finish ? remaining != 0 : input.pos < input.size);
+			}
+			break;
+#endif
+		default:
+			elog(ERROR, "unsupported compression method %d",
+				 (int) backup_compression);
+	}
+}
+
+/*
+ * Release the compressor of the current tar stream.
+ */
+static void
+release_tar_compressor(void)
+{
+	switch (backup_compression)
+	{
+#ifdef HAVE_LIBZ
+		case STREAM_COMPRESSION_GZIP:
+			deflateEnd(&backup_zstream);
+			break;
+#endif
+#ifdef USE_LZ4
+		case STREAM_COMPRESSION_LZ4:
+			LZ4F_freeCompressionContext(backup_lz4_ctx);
+			backup_lz4_ctx = NULL;
+			break;
+#endif
+#ifdef USE_ZSTD
+		case STREAM_COMPRESSION_ZSTD:
+			ZSTD_freeCCtx(backup_zstd_ctx);
+			backup_zstd_ctx = NULL;
+			break;
+#endif
+		default:
+			break;
+	}
+
+	backup_compression_active = false;
+}
+
+/*
+ * Send a chunk of a tar stream as a CopyData message.
+ */
+static void
+send_copy_data(const char *data, size_t len)
+{
+	if (pq_putmessage('d', data, len))
+		ereport(ERROR,
+				(errmsg("base backup could not send data, aborting backup")));
+}
+
 /*
  * Increment the network transfer counter by the given number of bytes,
  * and sleep if necessary to comply with the requested network transfer
@@ -448,9 +448,21 @@ libpqrcv_startstreaming(WalReceiverConn *conn,
 		appendStringInfoChar(&cmd, ')');
 	}
 	else
+	{
 		appendStringInfo(&cmd, " TIMELINE %u",
 						 options->proto.physical.startpointTLI);
 
+		if (options->proto.physical.compression)
+		{
+			if (PQserverVersion(conn->streamConn) < 140000)
+				ereport(ERROR,
+						(errmsg("could not start WAL streaming: %s",
+								"the primary server does not support stream compression")));
+			appendStringInfo(&cmd, " COMPRESSION '%s'",
+							 options->proto.physical.compression);
+		}
+	}
+
 	/* Start streaming. */
 	res = libpqrcv_PQexec(conn->streamConn, cmd.data);
 	pfree(cmd.data);
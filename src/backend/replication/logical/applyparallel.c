@@ -0,0 +1,1116 @@
+/*-------------------------------------------------------------------------
+ * applyparallel.c
+ *	   Support routines for applying transactions in parallel
+ *
+ * Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/replication/logical/applyparallel.c
+ *
+ * NOTES
+ *	  With max_parallel_apply_workers_per_subscription > 0 the apply worker
+ *	  of a subscription (the leader) does not apply every remote transaction
+ *	  itself.  Instead, it collects the messages of each transaction until
+ *	  its COMMIT arrives and then hands the whole transaction to one of its
+ *	  parallel apply workers, through a shm_mq in a dynamic shared memory
+ *	  segment set up for each of them.  The parallel apply workers apply
+ *	  their transactions concurrently, but commit them in the order of the
+ *	  remote commits: each transaction is given a sequence number in that
+ *	  order, and a worker waits until the transaction before its own has
+ *	  committed.  They all use the leader's replication origin, which thus
+ *	  advances just like when the leader applies everything itself.
+ *
+ *	  Transactions may only be applied concurrently if they do not touch
+ *	  the same rows.  While collecting a transaction, the leader hashes the
+ *	  replica identity of every row it changes, and remembers those hashes
+ *	  for the transactions still in flight.  A transaction that collides
+ *	  with transactions of a single worker is handed to that same worker,
+ *	  which applies them in order anyway; one that collides with several
+ *	  workers' has to wait for them to commit first.  To make the replica
+ *	  identity the only thing that could make two changes collide, parallel
+ *	  apply is limited to tables without other unique or exclusion indexes
+ *	  and without triggers that fire while applying, see
+ *	  logicalrep_rel_parallel_safe().
+ *
+ *	  Any transaction that touches another table, truncates, or exceeds
+ *	  logical_decoding_work_mem is applied by the leader itself, as is
+ *	  everything while some table is still being synchronized.  The leader
+ *	  then first waits for all transactions in flight to commit.
+ *
+ *	  Relation and type messages are applied by the leader right away.  It
+ *	  keeps the latest of each, and sends those a parallel apply worker has
+ *	  not seen yet along with the next transaction for that worker.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/xact.h"
+#include "access/xlog.h"
+#include "catalog/pg_subscription_rel.h"
+#include "common/hashfn.h"
+#include "libpq/pqformat.h"
+#include "libpq/pqsignal.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/interrupt.h"
+#include "replication/logicallauncher.h"
+#include "replication/logicalproto.h"
+#include "replication/logicalrelation.h"
+#include "replication/logicalworker.h"
+#include "replication/origin.h"
+#include "replication/reorderbuffer.h"
+#include "replication/worker_internal.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/timestamp.h"
+#include "utils/typcache.h"
+
+#define PARALLEL_APPLY_MAGIC		0x6c727061
+
+/* DSM keys for a parallel apply worker. */
+#define PARALLEL_APPLY_KEY_SHARED	1
+#define PARALLEL_APPLY_KEY_MQ		2
+
+/* Size of the queue from the leader to each parallel apply worker. */
+#define PARALLEL_APPLY_QUEUE_SIZE	(16 * 1024 * 1024)
+
+/*
+ * Message announcing the next transaction to a parallel apply worker,
+ * followed by its sequence number.
+ */
+#define PARALLEL_APPLY_MSG_TXN		'p'
+
+/* Prune the keys of committed transactions beyond this many. */
+#define PARALLEL_APPLY_MAX_KEYS		65536
+
+/* State shared with one parallel apply worker. */
+typedef struct ParallelApplyWorkerShared
+{
+	slock_t		mutex;
+	bool		exited;			/* has the worker exited? */
+} ParallelApplyWorkerShared;
+
+/* The leader's view of one of its parallel apply workers. */
+typedef struct ParallelApplyWorkerInfo
+{
+	dsm_segment *dsm_seg;		/* NULL if this entry is unused */
+	shm_mq_handle *mq_handle;
+	ParallelApplyWorkerShared *shared;
+	uint64		last_seq;		/* last transaction handed to the worker */
+	uint64		schema_version; /* last schema message sent to the worker */
+} ParallelApplyWorkerInfo;
+
+/* What the leader does with the current remote transaction. */
+typedef enum
+{
+	PA_TXN_NONE,				/* not in a remote transaction */
+	PA_TXN_COLLECT,				/* collecting it for a parallel apply worker */
+	PA_TXN_SERIAL				/* applying it itself */
+} ParallelApplyTxnState;
+
+/* Entry of the table of row keys changed by transactions in flight. */
+typedef struct ParallelApplyKeyEntry
+{
+	uint32		key;			/* hash key, must be first */
+	uint64		seq;			/* last transaction that changed the row */
+	int			worker;			/* and the worker it was handed to */
+} ParallelApplyKeyEntry;
+
+/* Entry of the table of relation and type messages. */
+typedef struct ParallelApplySchemaKey
+{
+	char		action;
+	uint32		id;
+} ParallelApplySchemaKey;
+
+typedef struct ParallelApplySchemaEntry
+{
+	ParallelApplySchemaKey key; /* hash key, must be first */
+	uint64		version;
+	int			len;
+	char	   *data;
+} ParallelApplySchemaEntry;
+
+/* Leader state. */
+static ParallelApplyWorkerInfo *pa_workers = NULL;
+static int	pa_nslots = 0;
+static uint64 pa_last_seq = 0;
+static XLogRecPtr pa_last_remote_end = InvalidXLogRecPtr;
+static HTAB *pa_keys = NULL;
+static HTAB *pa_schema = NULL;
+static uint64 pa_schema_version = 0;
+static TimestampTz pa_last_launch_failure = 0;
+
+/* The remote transaction being collected. */
+static ParallelApplyTxnState pa_txn_state = PA_TXN_NONE;
+static MemoryContext PaTxnContext = NULL;
+static List *pa_txn_messages = NIL;
+static List *pa_txn_keys = NIL;
+static Size pa_txn_size = 0;
+
+/* Parallel apply worker state. */
+static ParallelApplyWorkerShared *pa_shared = NULL;
+static uint64 pa_current_seq = 0;
+
+static uint64 pa_get_committed_seq(void);
+static void pa_check_workers(void);
+static void pa_free_worker(ParallelApplyWorkerInfo *winfo);
+static bool pa_launch_worker(ParallelApplyWorkerInfo *winfo);
+static int	pa_get_worker(void);
+static void pa_wait_for_seq(uint64 seq);
+static void pa_send(ParallelApplyWorkerInfo *winfo, Size nbytes,
+					const void *data);
+static void pa_remember_schema(StringInfo s);
+static void pa_send_schema(ParallelApplyWorkerInfo *winfo);
+static void pa_buffer_message(StringInfo s);
+static bool pa_classify_change(StringInfo s);
+static bool pa_add_key(LogicalRepRelMapEntry *rel,
+					   LogicalRepTupleData *tuple);
+static void pa_end_classification(void);
+static void pa_reset_txn(void);
+static void pa_apply_serially(bool complete);
+static void pa_dispatch_txn(void);
+static void pa_worker_onexit(int code, Datum arg);
+static bool pa_leader_alive(LogicalRepWorker *leader);
+
+/*
+ * Return the sequence number of the last transaction committed by our
+ * parallel apply workers.
+ */
+static uint64
+pa_get_committed_seq(void)
+{
+	uint64		seq;
+
+	SpinLockAcquire(&MyLogicalRepWorker->relmutex);
+	seq = MyLogicalRepWorker->pa_committed_seq;
+	SpinLockRelease(&MyLogicalRepWorker->relmutex);
+
+	return seq;
+}
+
+/*
+ * Let go of the parallel apply workers that have exited, and of idle ones
+ * beyond max_parallel_apply_workers_per_subscription.
+ *
+ * A worker exiting before it has committed all the transactions it was
+ * handed makes the leader fail too; the worker has reported why.
+ */
+static void
+pa_check_workers(void)
+{
+	int			nworkers = 0;
+	int			i;
+
+	for (i = 0; i < pa_nslots; i++)
+	{
+		ParallelApplyWorkerInfo *winfo = &pa_workers[i];
+		bool		exited;
+
+		if (winfo->dsm_seg == NULL)
+			continue;
+
+		SpinLockAcquire(&winfo->shared->mutex);
+		exited = winfo->shared->exited;
+		SpinLockRelease(&winfo->shared->mutex);
+
+		if (exited)
+		{
+			if (winfo->last_seq > pa_get_committed_seq())
+				ereport(ERROR,
+						(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+						 errmsg("logical replication parallel apply worker for subscription \"%s\" has exited unexpectedly",
+								MySubscription->name)));
+
+			pa_free_worker(winfo);
+		}
+		else if (nworkers >= max_parallel_apply_workers_per_subscription &&
+				 winfo->last_seq <= pa_get_committed_seq())
+			pa_free_worker(winfo);
+		else
+			nworkers++;
+	}
+}
+
+/*
+ * Detach from a parallel apply worker's segment, which makes the worker
+ * exit if it hasn't yet.
+ */
+static void
+pa_free_worker(ParallelApplyWorkerInfo *winfo)
+{
+	dsm_detach(winfo->dsm_seg);
+	MemSet(winfo, 0, sizeof(ParallelApplyWorkerInfo));
+}
+
+/*
+ * Set up a segment for a new parallel apply worker and start it.
+ *
+ * Returns false if that is not possible right now.  After a failure, we
+ * don't try again for wal_retrieve_retry_interval.
+ */
+static bool
+pa_launch_worker(ParallelApplyWorkerInfo *winfo)
+{
+	TimestampTz now = GetCurrentTimestamp();
+	shm_toc_estimator e;
+	Size		segsize;
+	dsm_segment *seg;
+	shm_toc    *toc;
+	ParallelApplyWorkerShared *shared;
+	shm_mq	   *mq;
+	MemoryContext oldctx;
+
+	if (pa_last_launch_failure != 0 &&
+		!TimestampDifferenceExceeds(pa_last_launch_failure, now,
+									wal_retrieve_retry_interval))
+		return false;
+
+	shm_toc_initialize_estimator(&e);
+	shm_toc_estimate_chunk(&e, sizeof(ParallelApplyWorkerShared));
+	shm_toc_estimate_chunk(&e, PARALLEL_APPLY_QUEUE_SIZE);
+	shm_toc_estimate_keys(&e, 2);
+	segsize = shm_toc_estimate(&e);
+
+	seg = dsm_create(segsize, DSM_CREATE_NULL_IF_MAXSEGMENTS);
+	if (seg == NULL)
+	{
+		pa_last_launch_failure = now;
+		return false;
+	}
+
+	/* The segment lives as long as the worker, not the transaction. */
+	dsm_pin_mapping(seg);
+
+	toc = shm_toc_create(PARALLEL_APPLY_MAGIC, dsm_segment_address(seg),
+						 segsize);
+
+	shared = shm_toc_allocate(toc, sizeof(ParallelApplyWorkerShared));
+	SpinLockInit(&shared->mutex);
+	shared->exited = false;
+	shm_toc_insert(toc, PARALLEL_APPLY_KEY_SHARED, shared);
+
+	mq = shm_mq_create(shm_toc_allocate(toc, PARALLEL_APPLY_QUEUE_SIZE),
+					   PARALLEL_APPLY_QUEUE_SIZE);
+	shm_toc_insert(toc, PARALLEL_APPLY_KEY_MQ, mq);
+	shm_mq_set_sender(mq, MyProc);
+
+	if (!logicalrep_worker_launch(MyLogicalRepWorker->dbid,
+								  MySubscription->oid,
+								  MySubscription->name,
+								  MyLogicalRepWorker->userid,
+								  InvalidOid,
+								  dsm_segment_handle(seg)))
+	{
+		dsm_detach(seg);
+		pa_last_launch_failure = now;
+		return false;
+	}
+
+	oldctx = MemoryContextSwitchTo(ApplyContext);
+	winfo->mq_handle = shm_mq_attach(mq, seg, NULL);
+	MemoryContextSwitchTo(oldctx);
+
+	winfo->dsm_seg = seg;
+	winfo->shared = shared;
+	winfo->last_seq = 0;
+	winfo->schema_version = 0;
+
+	return true;
+}
+
+/*
+ * Pick a parallel apply worker for a transaction that does not collide with
+ * any in flight: an idle one if possible, else a new one if allowed, else
+ * the one with the least work queued.  Returns -1 if there is none.
+ */
+static int
+pa_get_worker(void)
+{
+	uint64		committed = pa_get_committed_seq();
+	int			nworkers = 0;
+	int			free_slot = -1;
+	int			best = -1;
+	int			i;
+
+	for (i = 0; i < pa_nslots; i++)
+	{
+		ParallelApplyWorkerInfo *winfo = &pa_workers[i];
+
+		if (winfo->dsm_seg == NULL)
+		{
+			if (free_slot < 0)
+				free_slot = i;
+			continue;
+		}
+
+		if (winfo->last_seq <= committed)
+			return i;
+
+		nworkers++;
+		if (best < 0 || winfo->last_seq < pa_workers[best].last_seq)
+			best = i;
+	}
+
+	if (free_slot >= 0 &&
+		nworkers < max_parallel_apply_workers_per_subscription &&
+		pa_launch_worker(&pa_workers[free_slot]))
+		return free_slot;
+
+	return best;
+}
+
+/*
+ * Wait until our parallel apply workers have committed the transaction with
+ * the given sequence number, and those before it.
+ */
+static void
+pa_wait_for_seq(uint64 seq)
+{
+	while (pa_get_committed_seq() < seq)
+	{
+		pa_check_workers();
+
+		(void) ConditionVariableTimedSleep(&MyLogicalRepWorker->pa_cv, 1000L,
+										   WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE);
+	}
+	ConditionVariableCancelSleep();
+
+	/* Keep the flush positions in commit order. */
+	pa_report_progress();
+}
+
+/*
+ * Send a message to a parallel apply worker, waiting for room in its queue.
+ */
+static void
+pa_send(ParallelApplyWorkerInfo *winfo, Size nbytes, const void *data)
+{
+	shm_mq_result result;
+
+	result = shm_mq_send(winfo->mq_handle, nbytes, data, false, true);
+
+	if (result != SHM_MQ_SUCCESS)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not send data to logical replication parallel apply worker for subscription \"%s\"",
+						MySubscription->name)));
+}
+
+/*
+ * Remember a relation or type message for the parallel apply workers.
+ */
+static void
+pa_remember_schema(StringInfo s)
+{
+	StringInfoData msg = *s;
+	ParallelApplySchemaKey key;
+	ParallelApplySchemaEntry *entry;
+	int			len = s->len - s->cursor;
+	bool		found;
+
+	if (pa_schema == NULL)
+	{
+		HASHCTL		ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(ParallelApplySchemaKey);
+		ctl.entrysize = sizeof(ParallelApplySchemaEntry);
+		ctl.hcxt = ApplyContext;
+		pa_schema = hash_create("logical replication parallel apply schema",
+								128, &ctl,
+								HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	/* Both start with the remote OID. */
+	MemSet(&key, 0, sizeof(key));
+	key.action = pq_getmsgbyte(&msg);
+	key.id = pq_getmsgint(&msg, 4);
+
+	entry = hash_search(pa_schema, &key, HASH_ENTER, &found);
+	if (found)
+		pfree(entry->data);
+
+	entry->data = MemoryContextAlloc(ApplyContext, len);
+	memcpy(entry->data, s->data + s->cursor, len);
+	entry->len = len;
+	entry->version = ++pa_schema_version;
+}
+
+/*
+ * Send a parallel apply worker the relation and type messages it has not
+ * seen yet.
+ */
+static void
+pa_send_schema(ParallelApplyWorkerInfo *winfo)
+{
+	HASH_SEQ_STATUS status;
+	ParallelApplySchemaEntry *entry;
+
+	if (winfo->schema_version == pa_schema_version)
+		return;
+
+	hash_seq_init(&status, pa_schema);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->version > winfo->schema_version)
+			pa_send(winfo, entry->len, entry->data);
+	}
+
+	winfo->schema_version = pa_schema_version;
+}
+
+/*
+ * Add a message to the transaction being collected.
+ */
+static void
+pa_buffer_message(StringInfo s)
+{
+	MemoryContext oldctx;
+	StringInfo	copy;
+
+	if (PaTxnContext == NULL)
+		PaTxnContext = AllocSetContextCreate(ApplyContext,
+											 "ParallelApplyTxnContext",
+											 ALLOCSET_DEFAULT_SIZES);
+
+	oldctx = MemoryContextSwitchTo(PaTxnContext);
+
+	copy = makeStringInfo();
+	appendBinaryStringInfo(copy, s->data + s->cursor, s->len - s->cursor);
+	pa_txn_messages = lappend(pa_txn_messages, copy);
+	pa_txn_size += copy->len;
+
+	MemoryContextSwitchTo(oldctx);
+}
+
+/*
+ * Check whether a message of the transaction being collected allows applying
+ * the transaction in parallel, and remember the rows it changes.
+ */
+static bool
+pa_classify_change(StringInfo s)
+{
+	StringInfoData msg = *s;
+	char		action = pq_getmsgbyte(&msg);
+	LogicalRepRelId relid;
+	LogicalRepTupleData oldtup;
+	LogicalRepTupleData newtup;
+	bool		has_oldtuple = false;
+	bool		has_newtuple = true;
+	LogicalRepRelMapEntry *rel;
+	bool		safe;
+
+	switch (action)
+	{
+		case 'O':
+			return true;
+		case 'I':
+			relid = logicalrep_read_insert(&msg, &newtup);
+			break;
+		case 'U':
+			relid = logicalrep_read_update(&msg, &has_oldtuple,
+										   &oldtup, &newtup);
+			break;
+		case 'D':
+			relid = logicalrep_read_delete(&msg, &oldtup);
+			has_oldtuple = true;
+			has_newtuple = false;
+			break;
+		default:
+			return false;
+	}
+
+	/* The transaction lasts until the remote transaction is collected. */
+	if (!IsTransactionState())
+		StartTransactionCommand();
+	MemoryContextSwitchTo(ApplyMessageContext);
+
+	rel = logicalrep_rel_open(relid, AccessShareLock);
+
+	safe = rel->parallel_safe && rel->state == SUBREL_STATE_READY;
+	if (safe)
+	{
+		/* Input functions may need an active snapshot, so get one */
+		PushActiveSnapshot(GetTransactionSnapshot());
+
+		if (has_newtuple)
+			safe = pa_add_key(rel, &newtup);
+		if (safe && has_oldtuple)
+			safe = pa_add_key(rel, &oldtup);
+
+		PopActiveSnapshot();
+	}
+
+	logicalrep_rel_close(rel, NoLock);
+
+	return safe;
+}
+
+/*
+ * Hash the replica identity of a remote tuple and add it to the keys of the
+ * transaction being collected.
+ *
+ * The key columns are converted to local values and hashed with the hash
+ * function of their type, so that values that are equal locally hash alike
+ * even if their representation differs.  Returns false if that is not
+ * possible.
+ */
+static bool
+pa_add_key(LogicalRepRelMapEntry *rel, LogicalRepTupleData *tuple)
+{
+	TupleDesc	desc = RelationGetDescr(rel->localrel);
+	uint32		key = hash_uint32((uint32) rel->localreloid);
+	MemoryContext oldctx;
+	int			i = -1;
+
+	while ((i = bms_next_member(rel->parallel_keys, i)) >= 0)
+	{
+		Form_pg_attribute att = TupleDescAttr(desc, i);
+		int			remoteattnum = rel->attrmap->attnums[i];
+		TypeCacheEntry *typentry;
+		StringInfo	value;
+		Oid			typfunc;
+		Oid			typioparam;
+		Datum		datum;
+
+		if (remoteattnum < 0 || remoteattnum >= tuple->ncols)
+			return false;
+
+		typentry = lookup_type_cache(att->atttypid,
+									 TYPECACHE_HASH_PROC_FINFO);
+		if (!OidIsValid(typentry->hash_proc))
+			return false;
+
+		value = &tuple->colvalues[remoteattnum];
+
+		if (tuple->colstatus[remoteattnum] == LOGICALREP_COLUMN_TEXT)
+		{
+			getTypeInputInfo(att->atttypid, &typfunc, &typioparam);
+			datum = OidInputFunctionCall(typfunc, value->data,
+										 typioparam, att->atttypmod);
+		}
+		else if (tuple->colstatus[remoteattnum] == LOGICALREP_COLUMN_BINARY)
+		{
+			StringInfoData buf = *value;
+
+			getTypeBinaryInputInfo(att->atttypid, &typfunc, &typioparam);
+			datum = OidReceiveFunctionCall(typfunc, &buf,
+										   typioparam, att->atttypmod);
+		}
+		else
+			return false;
+
+		key = hash_combine(key,
+						   DatumGetUInt32(FunctionCall1Coll(&typentry->hash_proc_finfo,
+															att->attcollation,
+															datum)));
+	}
+
+	oldctx = MemoryContextSwitchTo(PaTxnContext);
+	pa_txn_keys = lappend_int(pa_txn_keys, (int) key);
+	MemoryContextSwitchTo(oldctx);
+
+	return true;
+}
+
+/*
+ * End the local transaction used to look at the tables of the transaction
+ * being collected.
+ */
+static void
+pa_end_classification(void)
+{
+	if (IsTransactionState())
+	{
+		CommitTransactionCommand();
+		MemoryContextSwitchTo(ApplyMessageContext);
+	}
+}
+
+/*
+ * Forget the transaction being collected.
+ */
+static void
+pa_reset_txn(void)
+{
+	if (PaTxnContext != NULL)
+		MemoryContextReset(PaTxnContext);
+	pa_txn_messages = NIL;
+	pa_txn_keys = NIL;
+	pa_txn_size = 0;
+}
+
+/*
+ * Apply the transaction collected so far in the leader, once everything
+ * handed to parallel apply workers has committed.  If the transaction is
+ * not complete, the leader goes on to apply the rest of it too.
+ */
+static void
+pa_apply_serially(bool complete)
+{
+	ListCell   *lc;
+
+	pa_end_classification();
+	pa_wait_for_seq(pa_last_seq);
+
+	pa_txn_state = complete ? PA_TXN_NONE : PA_TXN_SERIAL;
+
+	foreach(lc, pa_txn_messages)
+		apply_dispatch((StringInfo) lfirst(lc));
+
+	pa_reset_txn();
+}
+
+/*
+ * Hand the transaction collected to a parallel apply worker.
+ */
+static void
+pa_dispatch_txn(void)
+{
+	ParallelApplyWorkerInfo *winfo;
+	StringInfoData msg;
+	uint64		committed;
+	uint64		wait_seq = 0;
+	uint64		seq;
+	int			target = -1;
+	bool		multiple = false;
+	ListCell   *lc;
+
+	pa_end_classification();
+	pa_check_workers();
+
+	/* Find the workers with transactions in flight that change our rows. */
+	committed = pa_get_committed_seq();
+	if (pa_keys != NULL)
+	{
+		foreach(lc, pa_txn_keys)
+		{
+			uint32		key = (uint32) lfirst_int(lc);
+			ParallelApplyKeyEntry *entry;
+
+			entry = hash_search(pa_keys, &key, HASH_FIND, NULL);
+			if (entry == NULL || entry->seq <= committed)
+				continue;
+
+			if (target < 0)
+				target = entry->worker;
+			else if (entry->worker != target)
+				multiple = true;
+			wait_seq = Max(wait_seq, entry->seq);
+		}
+	}
+
+	/*
+	 * A single worker applies its transactions in order, so it can take this
+	 * one too.  If several workers are involved, they have to commit theirs
+	 * first.
+	 */
+	if (multiple)
+	{
+		pa_wait_for_seq(wait_seq);
+		target = -1;
+	}
+
+	if (target < 0)
+		target = pa_get_worker();
+
+	if (target < 0)
+	{
+		/* No parallel apply worker to be had, so apply it ourselves. */
+		pa_apply_serially(true);
+		return;
+	}
+
+	winfo = &pa_workers[target];
+	seq = ++pa_last_seq;
+
+	pa_send_schema(winfo);
+
+	initStringInfo(&msg);
+	pq_sendbyte(&msg, PARALLEL_APPLY_MSG_TXN);
+	pq_sendint64(&msg, seq);
+	pa_send(winfo, msg.len, msg.data);
+
+	foreach(lc, pa_txn_messages)
+	{
+		StringInfo	s = (StringInfo) lfirst(lc);
+
+		pa_send(winfo, s->len, s->data);
+	}
+
+	winfo->last_seq = seq;
+
+	/* Remember the rows it changes. */
+	if (pa_keys == NULL)
+	{
+		HASHCTL		ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(uint32);
+		ctl.entrysize = sizeof(ParallelApplyKeyEntry);
+		ctl.hcxt = ApplyContext;
+		pa_keys = hash_create("logical replication parallel apply keys",
+							  1024, &ctl,
+							  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+	else if (hash_get_num_entries(pa_keys) > PARALLEL_APPLY_MAX_KEYS)
+	{
+		HASH_SEQ_STATUS status;
+		ParallelApplyKeyEntry *entry;
+
+		committed = pa_get_committed_seq();
+		hash_seq_init(&status, pa_keys);
+		while ((entry = hash_seq_search(&status)) != NULL)
+		{
+			if (entry->seq <= committed)
+				hash_search(pa_keys, &entry->key, HASH_REMOVE, NULL);
+		}
+	}
+
+	foreach(lc, pa_txn_keys)
+	{
+		uint32		key = (uint32) lfirst_int(lc);
+		ParallelApplyKeyEntry *entry;
+
+		entry = hash_search(pa_keys, &key, HASH_ENTER, NULL);
+		entry->seq = seq;
+		entry->worker = target;
+	}
+
+	pa_txn_state = PA_TXN_NONE;
+	pa_reset_txn();
+
+	in_remote_transaction = false;
+	pgstat_report_activity(STATE_IDLE, NULL);
+}
+
+/*
+ * Look at a logical replication protocol message in the leader apply worker
+ * before it is applied.
+ *
+ * Returns true if the message was taken care of for parallel apply, false if
+ * the caller should apply it as usual.
+ */
+bool
+pa_handle_message(StringInfo s)
+{
+	char		action;
+
+	/* Table synchronization workers apply everything themselves. */
+	if (am_tablesync_worker())
+		return false;
+
+	action = s->data[s->cursor];
+
+	if (action == 'R' || action == 'Y')
+	{
+		pa_remember_schema(s);
+		return false;
+	}
+
+	switch (pa_txn_state)
+	{
+		case PA_TXN_NONE:
+			if (action != 'B')
+				return false;
+
+			if (pa_workers == NULL)
+			{
+				pa_nslots = max_logical_replication_workers;
+				pa_workers = MemoryContextAllocZero(ApplyContext,
+													sizeof(ParallelApplyWorkerInfo) * pa_nslots);
+			}
+
+			if (max_parallel_apply_workers_per_subscription <= 0 ||
+				!AllTablesyncsReady())
+			{
+				pa_wait_for_seq(pa_last_seq);
+				pa_txn_state = PA_TXN_SERIAL;
+				return false;
+			}
+
+			pa_txn_state = PA_TXN_COLLECT;
+			pa_buffer_message(s);
+
+			/* Keep the apply loop from doing work between transactions. */
+			in_remote_transaction = true;
+			return true;
+
+		case PA_TXN_SERIAL:
+			if (action == 'C')
+				pa_txn_state = PA_TXN_NONE;
+			return false;
+
+		case PA_TXN_COLLECT:
+			pa_buffer_message(s);
+
+			if (action == 'C')
+				pa_dispatch_txn();
+			else if (pa_txn_size > logical_decoding_work_mem * 1024L ||
+					 !pa_classify_change(s))
+				pa_apply_serially(false);
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Do parallel apply workers have transactions yet to commit?
+ */
+bool
+pa_have_inflight(void)
+{
+	return pa_last_seq > 0 && pa_last_seq > pa_get_committed_seq();
+}
+
+/*
+ * Record the flush position of what parallel apply workers have committed.
+ */
+void
+pa_report_progress(void)
+{
+	XLogRecPtr	remote_end;
+	XLogRecPtr	local_end;
+
+	if (pa_last_seq == 0)
+		return;
+
+	SpinLockAcquire(&MyLogicalRepWorker->relmutex);
+	remote_end = MyLogicalRepWorker->pa_remote_end;
+	local_end = MyLogicalRepWorker->pa_local_end;
+	SpinLockRelease(&MyLogicalRepWorker->relmutex);
+
+	if (remote_end > pa_last_remote_end)
+	{
+		store_flush_position(remote_end, local_end);
+		pa_last_remote_end = remote_end;
+	}
+}
+
+/*
+ * Tell the leader that we are gone.
+ */
+static void
+pa_worker_onexit(int code, Datum arg)
+{
+	SpinLockAcquire(&pa_shared->mutex);
+	pa_shared->exited = true;
+	SpinLockRelease(&pa_shared->mutex);
+
+	ConditionVariableBroadcast(&logicalrep_worker_leader()->pa_cv);
+}
+
+/*
+ * Is the leader of this parallel apply worker still around?
+ */
+static bool
+pa_leader_alive(LogicalRepWorker *leader)
+{
+	bool		alive;
+
+	LWLockAcquire(LogicalRepWorkerLock, LW_SHARED);
+	alive = leader->in_use && leader->proc &&
+		leader->proc->pid == MyLogicalRepWorker->leader_pid;
+	LWLockRelease(LogicalRepWorkerLock);
+
+	return alive;
+}
+
+/*
+ * Wait until it is the turn of the current transaction to commit.
+ */
+void
+pa_wait_for_turn(void)
+{
+	LogicalRepWorker *leader = logicalrep_worker_leader();
+
+	for (;;)
+	{
+		uint64		committed;
+
+		SpinLockAcquire(&leader->relmutex);
+		committed = leader->pa_committed_seq;
+		SpinLockRelease(&leader->relmutex);
+
+		if (committed + 1 >= pa_current_seq)
+			break;
+
+		if (!pa_leader_alive(leader))
+		{
+			ereport(LOG,
+					(errmsg("logical replication parallel apply worker for subscription \"%s\" will stop because the apply worker has exited",
+							MySubscription->name)));
+			proc_exit(0);
+		}
+
+		(void) ConditionVariableTimedSleep(&leader->pa_cv, 1000L,
+										   WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE);
+	}
+	ConditionVariableCancelSleep();
+}
+
+/*
+ * Tell the leader that the current transaction has committed, ending at the
+ * given remote and local positions.
+ */
+void
+pa_commit_done(XLogRecPtr remote_end, XLogRecPtr local_end)
+{
+	LogicalRepWorker *leader = logicalrep_worker_leader();
+
+	SpinLockAcquire(&leader->relmutex);
+	leader->pa_committed_seq = pa_current_seq;
+	if (remote_end > leader->pa_remote_end)
+		leader->pa_remote_end = remote_end;
+	if (local_end > leader->pa_local_end)
+		leader->pa_local_end = local_end;
+	SpinLockRelease(&leader->relmutex);
+
+	ConditionVariableBroadcast(&leader->pa_cv);
+}
+
+/* Logical Replication parallel apply worker entry point */
+void
+ParallelApplyWorkerMain(Datum main_arg)
+{
+	int			worker_slot = DatumGetInt32(main_arg);
+	dsm_handle	handle;
+	dsm_segment *seg;
+	shm_toc    *toc;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	char		originname[NAMEDATALEN];
+	RepOriginId originid;
+
+	/* Setup signal handling */
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/*
+	 * Attach to the segment set up by the leader.  Without a resource owner,
+	 * the mapping lasts until we exit.
+	 */
+	memcpy(&handle, MyBgworkerEntry->bgw_extra, sizeof(dsm_handle));
+	seg = dsm_attach(handle);
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+
+	toc = shm_toc_attach(PARALLEL_APPLY_MAGIC, dsm_segment_address(seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("invalid magic number in dynamic shared memory segment")));
+
+	pa_shared = shm_toc_lookup(toc, PARALLEL_APPLY_KEY_SHARED, false);
+	mq = shm_toc_lookup(toc, PARALLEL_APPLY_KEY_MQ, false);
+	shm_mq_set_receiver(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	/* Attach to slot */
+	logicalrep_worker_attach(worker_slot);
+	before_shmem_exit(pa_worker_onexit, (Datum) 0);
+
+	/* Initialise stats to a sanish value */
+	MyLogicalRepWorker->last_send_time = MyLogicalRepWorker->last_recv_time =
+		MyLogicalRepWorker->reply_time = GetCurrentTimestamp();
+
+	InitializeApplyWorker();
+
+	/* Share the leader's replication origin. */
+	StartTransactionCommand();
+	snprintf(originname, sizeof(originname), "pg_%u", MySubscription->oid);
+	originid = replorigin_by_name(originname, false);
+	replorigin_session_setup(originid, MyLogicalRepWorker->leader_pid);
+	replorigin_session_origin = originid;
+	CommitTransactionCommand();
+
+	ApplyMessageContext = AllocSetContextCreate(ApplyContext,
+												"ApplyMessageContext",
+												ALLOCSET_DEFAULT_SIZES);
+
+	for (;;)
+	{
+		shm_mq_result result;
+		Size		len;
+		void	   *data;
+		int			rc;
+
+		CHECK_FOR_INTERRUPTS();
+
+		MemoryContextSwitchTo(ApplyMessageContext);
+
+		result = shm_mq_receive(mqh, &len, &data, true);
+
+		if (result == SHM_MQ_SUCCESS)
+		{
+			StringInfoData s;
+
+			if (len == 0)
+				elog(ERROR, "invalid message length");
+
+			s.data = data;
+			s.len = len;
+			s.maxlen = -1;
+			s.cursor = 0;
+
+			if (s.data[0] == PARALLEL_APPLY_MSG_TXN)
+			{
+				(void) pq_getmsgbyte(&s);
+				pa_current_seq = pq_getmsgint64(&s);
+			}
+			else
+				apply_dispatch(&s);
+
+			MemoryContextReset(ApplyMessageContext);
+			continue;
+		}
+
+		/* The leader is gone, or does not need us anymore. */
+		if (result == SHM_MQ_DETACHED)
+			proc_exit(0);
+
+		if (!in_remote_transaction)
+		{
+			/*
+			 * If we didn't get any transactions for a while there might be
+			 * unconsumed invalidation messages in the queue, consume them
+			 * now.
+			 */
+			AcceptInvalidationMessages();
+			maybe_reread_subscription();
+		}
+
+		rc = WaitLatch(MyLatch,
+					   WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+					   1000L,
+					   WAIT_EVENT_LOGICAL_PARALLEL_APPLY_MAIN);
+
+		if (rc & WL_LATCH_SET)
+			ResetLatch(MyLatch);
+
+		if (ConfigReloadPending)
+		{
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+	}
+}
@@ -0,0 +1,883 @@
+/*-------------------------------------------------------------------------
+ * fanout.c
+ *	   Sharing decoded changes between walsenders
+ *
+ * Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/replication/logical/fanout.c
+ *
+ * NOTES
+ *	  Every walsender streaming from a logical replication slot normally reads
+ *	  and decodes WAL on its own, even if several of them use the same output
+ *	  plugin with the same options and thus send the very same data.  With
+ *	  max_logical_decoding_fanout_groups > 0 such walsenders form a group
+ *	  instead: the first of them (the leader) decodes as usual, but also
+ *	  copies every message it sends to its client into a ring buffer in
+ *	  shared memory.  The other walsenders of the group (members) don't
+ *	  decode at all, they just send the messages from the ring buffer.
+ *
+ *	  Output plugins remember some things across transactions, like the
+ *	  relation descriptions pgoutput already sent, so the leader's output is
+ *	  only valid for a member from a point where both have the same state.
+ *	  A walsender that wants to join a group thus first decodes on its own
+ *	  until it is at the same WAL position as the leader, and asks the leader
+ *	  for a join marker there.  The leader restarts its output plugin between
+ *	  two WAL records, which makes it forget that state, and publishes the
+ *	  WAL position and ring buffer position of that point.  A walsender whose
+ *	  own decoding got exactly to that WAL position has sent everything
+ *	  before it, and continues with the leader's output from there.
+ *
+ *	  The leader never waits for members.  It publishes new messages only
+ *	  once it has completely processed the WAL record they were produced
+ *	  for, so a transaction is always published as a whole.  A member copies
+ *	  everything published before sending any of it, and checks afterwards
+ *	  whether the leader overwrote the data in the meantime.  If it did, or
+ *	  the leader went away, the member goes back to decoding on its own,
+ *	  starting after the last record it sent, and may join again later.
+ *
+ *	  A member does not decode, so its slot's restart_lsn and catalog_xmin
+ *	  don't advance by themselves.  The leader publishes those of its slot,
+ *	  and a member adopts them once its client has confirmed at least what
+ *	  the leader's client had confirmed when they were computed: they are
+ *	  valid for decoding from any later point as well.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/transam.h"
+#include "access/xlog.h"
+#include "miscadmin.h"
+#include "nodes/parsenodes.h"
+#include "nodes/value.h"
+#include "replication/fanout.h"
+#include "replication/slot.h"
+#include "replication/walsender.h"
+#include "replication/walsender_private.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+
+/* maximum length of the output plugin name and options of a group */
+#define DECODE_FANOUT_KEY_LEN		1024
+
+/* how long a joining walsender waits for the leader to set a join marker */
+#define DECODE_FANOUT_JOIN_WAIT_MS			1000
+
+/* how long to decode on our own after failing to join or falling behind */
+#define DECODE_FANOUT_JOIN_RETRY_MS			10000
+
+/* how long a member waits for a leader not keeping up with the WAL */
+#define DECODE_FANOUT_LEADER_STALL_MS		10000
+
+typedef struct DecodeFanoutGroup
+{
+	/*
+	 * in_use, dboid and key only change while holding DecodeFanoutLock
+	 * exclusively and the mutex.  Everything else is protected by the mutex.
+	 */
+	slock_t		mutex;
+	bool		in_use;
+	uint64		generation;		/* advanced whenever the leader changes */
+	Oid			dboid;
+	char		key[DECODE_FANOUT_KEY_LEN];
+
+	/*
+	 * Ring buffer positions are byte offsets that only ever increase.  Data
+	 * before write_pos - ring size may have been overwritten; data before
+	 * head_pos is complete.
+	 */
+	uint64		write_pos;
+	uint64		head_pos;
+	XLogRecPtr	head_endptr;	/* leader's read position at head_pos */
+
+	/* join protocol */
+	XLogRecPtr	join_request;	/* where a walsender waits for a marker */
+	XLogRecPtr	marker_lsn;		/* WAL position of the latest marker */
+	uint64		marker_pos;		/* ring buffer position of that marker */
+
+	/* the leader's slot, as of its last confirmation */
+	XLogRecPtr	leader_confirmed_flush;
+	XLogRecPtr	leader_restart_lsn;
+	TransactionId leader_catalog_xmin;
+
+	/*
+	 * Latches of the walsenders in or joining the group, indexed like
+	 * WalSndCtl->walsnds, followed by the ring buffer.
+	 */
+	Latch	   *latches[FLEXIBLE_ARRAY_MEMBER];
+} DecodeFanoutGroup;
+
+typedef struct DecodeFanoutCtlData
+{
+	Size		group_size;		/* distance between two groups */
+	char		groups[FLEXIBLE_ARRAY_MEMBER];
+} DecodeFanoutCtlData;
+
+#define DecodeFanoutRingSize \
+	((Size) logical_decoding_fanout_buffer_size * 1024)
+#define DecodeFanoutGetGroup(i) \
+	((DecodeFanoutGroup *) (DecodeFanoutCtl->groups + \
+							(i) * DecodeFanoutCtl->group_size))
+#define DecodeFanoutGroupRing(group) \
+	((char *) (group) + DecodeFanoutGroupHeaderSize())
+
+/* GUC variables */
+int			max_logical_decoding_fanout_groups = 0;
+int			logical_decoding_fanout_buffer_size = 16384;
+
+DecodeFanoutRole MyDecodeFanoutRole = DECODE_FANOUT_NONE;
+
+static DecodeFanoutCtlData *DecodeFanoutCtl = NULL;
+
+static DecodeFanoutGroup *MyGroup = NULL;
+static uint64 MyGeneration;
+static int	MyWalSndIndex;
+static char MyKey[DECODE_FANOUT_KEY_LEN];
+
+/* our client wants commits after this position */
+static XLogRecPtr MyStartLsn = InvalidXLogRecPtr;
+
+/* leader: where to write next; member: where to read next */
+static uint64 MyRingPos = 0;
+
+/* leader: has anybody asked for a join marker yet? */
+static bool MyGroupActive = false;
+
+static TimestampTz MyJoinRetryAt = 0;
+static TimestampTz MyJoinWaitStart = 0;
+
+/* member: when did the leader make progress last? */
+static XLogRecPtr MyLastEndptr = InvalidXLogRecPtr;
+static TimestampTz MyLastProgress = 0;
+
+/* member: copy of the ring buffer data being sent */
+static char *MyReadBuffer = NULL;
+
+static bool exit_callback_registered = false;
+
+static Size DecodeFanoutGroupHeaderSize(void);
+static Size DecodeFanoutGroupSize(void);
+static bool decode_fanout_build_key(const char *plugin, List *options,
+									char *key);
+static void decode_fanout_find_group(void);
+static void decode_fanout_wakeup(DecodeFanoutGroup *group);
+static void decode_fanout_ring_write(DecodeFanoutGroup *group, uint64 pos,
+									 const char *data, Size len);
+static void decode_fanout_ring_read(DecodeFanoutGroup *group, uint64 pos,
+									char *data, Size len);
+static void DecodeFanoutShmemExit(int code, Datum arg);
+
+static Size
+DecodeFanoutGroupHeaderSize(void)
+{
+	return MAXALIGN(add_size(offsetof(DecodeFanoutGroup, latches),
+							 mul_size(max_wal_senders, sizeof(Latch *))));
+}
+
+static Size
+DecodeFanoutGroupSize(void)
+{
+	return MAXALIGN(add_size(DecodeFanoutGroupHeaderSize(),
+							 DecodeFanoutRingSize));
+}
+
+Size
+DecodeFanoutShmemSize(void)
+{
+	Size		size;
+
+	if (max_logical_decoding_fanout_groups == 0)
+		return 0;
+
+	size = MAXALIGN(offsetof(DecodeFanoutCtlData, groups));
+	size = add_size(size, mul_size(max_logical_decoding_fanout_groups,
+								   DecodeFanoutGroupSize()));
+
+	return size;
+}
+
+void
+DecodeFanoutShmemInit(void)
+{
+	bool		found;
+
+	if (max_logical_decoding_fanout_groups == 0)
+		return;
+
+	DecodeFanoutCtl = (DecodeFanoutCtlData *)
+		ShmemInitStruct("Logical Decoding Fan-out", DecodeFanoutShmemSize(),
+						&found);
+
+	if (!found)
+	{
+		int			i;
+
+		DecodeFanoutCtl->group_size = DecodeFanoutGroupSize();
+
+		for (i = 0; i < max_logical_decoding_fanout_groups; i++)
+		{
+			DecodeFanoutGroup *group = DecodeFanoutGetGroup(i);
+
+			memset(group, 0, DecodeFanoutGroupHeaderSize());
+			SpinLockInit(&group->mutex);
+		}
+	}
+}
+
+/*
+ * Make the current walsender part of the decoding fan-out group for its
+ * output plugin and options.  It becomes the group's leader if there's no
+ * such group yet, and else tries to join the group as it goes.
+ *
+ * start_lsn is the position after which our client wants commits.
+ */
+void
+DecodeFanoutAttach(List *options, XLogRecPtr start_lsn)
+{
+	Assert(MyDecodeFanoutRole == DECODE_FANOUT_NONE);
+	Assert(MyReplicationSlot != NULL && MyWalSnd != NULL);
+
+	if (DecodeFanoutCtl == NULL)
+		return;
+
+	if (!decode_fanout_build_key(NameStr(MyReplicationSlot->data.plugin),
+								 options, MyKey))
+		return;
+
+	if (!exit_callback_registered)
+	{
+		before_shmem_exit(DecodeFanoutShmemExit, (Datum) 0);
+		exit_callback_registered = true;
+	}
+
+	MyWalSndIndex = MyWalSnd - WalSndCtl->walsnds;
+	MyStartLsn = start_lsn;
+
+	decode_fanout_find_group();
+}
+
+/*
+ * Leave our decoding fan-out group.  If we were its leader, the group goes
+ * away and its members have to decode on their own again.
+ */
+void
+DecodeFanoutDetach(void)
+{
+	DecodeFanoutGroup *group = MyGroup;
+	bool		was_leader = false;
+
+	if (MyDecodeFanoutRole == DECODE_FANOUT_NONE)
+		return;
+
+	LWLockAcquire(DecodeFanoutLock, LW_EXCLUSIVE);
+	SpinLockAcquire(&group->mutex);
+	if (group->generation == MyGeneration)
+	{
+		if (MyDecodeFanoutRole == DECODE_FANOUT_LEADER)
+		{
+			group->in_use = false;
+			group->generation++;
+			was_leader = true;
+		}
+		else
+			group->latches[MyWalSndIndex] = NULL;
+	}
+	SpinLockRelease(&group->mutex);
+	LWLockRelease(DecodeFanoutLock);
+
+	/* let the members notice that we're gone */
+	if (was_leader)
+		decode_fanout_wakeup(group);
+
+	/* don't try to join again right away if we fell out of the group */
+	if (MyDecodeFanoutRole == DECODE_FANOUT_MEMBER)
+		MyJoinRetryAt = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+													DECODE_FANOUT_JOIN_RETRY_MS);
+
+	elog(DEBUG1, "walsender left logical decoding fan-out group");
+
+	MyGroup = NULL;
+	MyDecodeFanoutRole = DECODE_FANOUT_NONE;
+	MyGroupActive = false;
+	MyJoinWaitStart = 0;
+}
+
+/*
+ * Leader: copy a message we sent to our client into the ring buffer.
+ */
+void
+DecodeFanoutWrite(const char *data, Size len)
+{
+	DecodeFanoutGroup *group = MyGroup;
+	uint32		msglen = len;
+	Size		total = sizeof(uint32) + len;
+
+	Assert(MyDecodeFanoutRole == DECODE_FANOUT_LEADER);
+
+	/* nobody is interested before the first join marker */
+	if (!MyGroupActive)
+		return;
+
+	/* announce the data we're about to overwrite before doing so */
+	SpinLockAcquire(&group->mutex);
+	group->write_pos = MyRingPos + total;
+	SpinLockRelease(&group->mutex);
+	pg_write_barrier();
+
+	/*
+	 * A message that doesn't fit into the ring buffer can't be sent by any
+	 * member; advancing write_pos past it makes them notice that.
+	 */
+	if (total <= DecodeFanoutRingSize)
+	{
+		decode_fanout_ring_write(group, MyRingPos,
+								 (char *) &msglen, sizeof(uint32));
+		decode_fanout_ring_write(group, MyRingPos + sizeof(uint32), data, len);
+	}
+
+	MyRingPos += total;
+}
+
+/*
+ * Leader: make the messages written for the WAL record ending at endptr
+ * visible to the members.
+ *
+ * Returns true if a walsender is waiting for a join marker at endptr, in
+ * which case the caller has to restart its output plugin and call
+ * DecodeFanoutSetMarker() before decoding the next record.  consistent says
+ * whether the snapshot builder has reached a consistent state yet.
+ */
+bool
+DecodeFanoutPublish(XLogRecPtr endptr, bool consistent)
+{
+	DecodeFanoutGroup *group = MyGroup;
+	bool		want_marker;
+
+	Assert(MyDecodeFanoutRole == DECODE_FANOUT_LEADER);
+
+	SpinLockAcquire(&group->mutex);
+	group->head_pos = MyRingPos;
+	group->head_endptr = endptr;
+	want_marker = consistent && endptr >= MyStartLsn &&
+		!XLogRecPtrIsInvalid(group->join_request) &&
+		endptr >= group->join_request &&
+		group->marker_lsn != endptr;
+	SpinLockRelease(&group->mutex);
+
+	if (MyGroupActive)
+		decode_fanout_wakeup(group);
+
+	return want_marker;
+}
+
+/*
+ * Leader: let walsenders join the group at endptr, where our output plugin
+ * has just been restarted.
+ */
+void
+DecodeFanoutSetMarker(XLogRecPtr endptr)
+{
+	DecodeFanoutGroup *group = MyGroup;
+
+	Assert(MyDecodeFanoutRole == DECODE_FANOUT_LEADER);
+
+	SpinLockAcquire(&group->mutex);
+	Assert(group->head_pos == MyRingPos);
+	group->marker_lsn = endptr;
+	group->marker_pos = MyRingPos;
+	group->join_request = InvalidXLogRecPtr;
+	SpinLockRelease(&group->mutex);
+
+	MyGroupActive = true;
+
+	decode_fanout_wakeup(group);
+}
+
+/*
+ * Try to join our group, having decoded on our own up to endptr.
+ *
+ * Returns true if we joined; the caller then has to send the leader's
+ * output from now on.  Otherwise, *wait is set if the caller should wait
+ * for the leader to set a join marker at endptr rather than decoding the
+ * next record.
+ */
+bool
+DecodeFanoutTryJoin(XLogRecPtr endptr, bool consistent, bool *wait)
+{
+	DecodeFanoutGroup *group = MyGroup;
+	bool		valid;
+	bool		joined = false;
+	XLogRecPtr	leader_endptr = InvalidXLogRecPtr;
+
+	Assert(MyDecodeFanoutRole == DECODE_FANOUT_JOINING);
+
+	*wait = false;
+
+	/* the leader's output before our start point is of no use to us */
+	if (!consistent || endptr < MyStartLsn)
+		return false;
+
+	if (MyJoinRetryAt != 0)
+	{
+		if (GetCurrentTimestamp() < MyJoinRetryAt)
+			return false;
+		MyJoinRetryAt = 0;
+	}
+
+	SpinLockAcquire(&group->mutex);
+	valid = group->generation == MyGeneration;
+	if (valid)
+	{
+		if (group->marker_lsn == endptr &&
+			group->write_pos <= group->marker_pos + DecodeFanoutRingSize)
+		{
+			/* we're exactly where the leader restarted its output plugin */
+			MyRingPos = group->marker_pos;
+			group->latches[MyWalSndIndex] = MyLatch;
+			joined = true;
+		}
+		else if (group->marker_lsn > endptr)
+		{
+			/* our own decoding is still on its way to the latest marker */
+		}
+		else if (group->head_endptr <= endptr)
+		{
+			/*
+			 * The leader isn't ahead of us, so it'll get to endptr and set a
+			 * marker there if we ask for it.
+			 */
+			if (group->join_request < endptr)
+				group->join_request = endptr;
+			group->latches[MyWalSndIndex] = MyLatch;
+			leader_endptr = group->head_endptr;
+			*wait = true;
+		}
+	}
+	SpinLockRelease(&group->mutex);
+
+	if (!valid)
+	{
+		/* the leader left, maybe we can take over */
+		MyGroup = NULL;
+		MyDecodeFanoutRole = DECODE_FANOUT_NONE;
+		decode_fanout_find_group();
+		return false;
+	}
+
+	if (joined)
+	{
+		ReplicationSlot *slot = MyReplicationSlot;
+
+		/*
+		 * Candidates for advancing our slot found by our own decoding might
+		 * be older than what we adopt from the leader later; forget them.
+		 */
+		SpinLockAcquire(&slot->mutex);
+		slot->candidate_catalog_xmin = InvalidTransactionId;
+		slot->candidate_xmin_lsn = InvalidXLogRecPtr;
+		slot->candidate_restart_lsn = InvalidXLogRecPtr;
+		slot->candidate_restart_valid = InvalidXLogRecPtr;
+		SpinLockRelease(&slot->mutex);
+
+		if (MyReadBuffer == NULL)
+			MyReadBuffer = MemoryContextAlloc(TopMemoryContext,
+											  DecodeFanoutRingSize);
+
+		MyDecodeFanoutRole = DECODE_FANOUT_MEMBER;
+		MyJoinWaitStart = 0;
+		MyLastEndptr = endptr;
+		MyLastProgress = GetCurrentTimestamp();
+
+		elog(DEBUG1, "walsender joined logical decoding fan-out group at %X/%X",
+			 (uint32) (endptr >> 32), (uint32) endptr);
+		return true;
+	}
+
+	if (*wait)
+	{
+		TimestampTz now = GetCurrentTimestamp();
+
+		if (MyJoinWaitStart == 0)
+			MyJoinWaitStart = now;
+
+		/*
+		 * There's no point in waiting for the leader if there's no WAL to
+		 * decode anyway.  Otherwise, don't wait for a leader that doesn't
+		 * make progress, and let our client have its changes.
+		 */
+		if (GetFlushRecPtr() > endptr &&
+			TimestampDifferenceExceeds(MyJoinWaitStart, now,
+									   DECODE_FANOUT_JOIN_WAIT_MS))
+		{
+			SpinLockAcquire(&group->mutex);
+			if (group->generation == MyGeneration)
+			{
+				if (group->join_request == endptr)
+					group->join_request = InvalidXLogRecPtr;
+				group->latches[MyWalSndIndex] = NULL;
+			}
+			SpinLockRelease(&group->mutex);
+
+			elog(DEBUG1, "walsender gave up waiting for logical decoding fan-out group leader at %X/%X",
+				 (uint32) (leader_endptr >> 32), (uint32) leader_endptr);
+
+			MyJoinRetryAt = TimestampTzPlusMilliseconds(now,
+														DECODE_FANOUT_JOIN_RETRY_MS);
+			MyJoinWaitStart = 0;
+			*wait = false;
+		}
+	}
+	else
+		MyJoinWaitStart = 0;
+
+	return false;
+}
+
+/*
+ * Member: get the messages the leader published since the last call.
+ *
+ * On DECODE_FANOUT_READ_DATA, *data and *len describe a series of messages,
+ * each preceded by its uint32 length, ready to be sent to the client.  The
+ * data stays valid until the next call.  On DECODE_FANOUT_READ_DATA and
+ * DECODE_FANOUT_READ_EMPTY, *endptr is set to the leader's read position,
+ * up to which everything the client needs has been returned.
+ */
+DecodeFanoutReadResult
+DecodeFanoutRead(char **data, Size *len, XLogRecPtr *endptr)
+{
+	DecodeFanoutGroup *group = MyGroup;
+	Size		ring_size = DecodeFanoutRingSize;
+	bool		valid;
+	uint64		head_pos;
+	uint64		write_pos;
+	XLogRecPtr	head_endptr;
+
+	Assert(MyDecodeFanoutRole == DECODE_FANOUT_MEMBER);
+
+	SpinLockAcquire(&group->mutex);
+	valid = group->generation == MyGeneration;
+	head_pos = group->head_pos;
+	head_endptr = group->head_endptr;
+	write_pos = group->write_pos;
+	SpinLockRelease(&group->mutex);
+
+	if (!valid)
+	{
+		elog(DEBUG1, "logical decoding fan-out group leader went away");
+		return DECODE_FANOUT_READ_LOST;
+	}
+	if (write_pos > MyRingPos + ring_size)
+	{
+		elog(DEBUG1, "walsender fell behind its logical decoding fan-out group");
+		return DECODE_FANOUT_READ_LOST;
+	}
+
+	*endptr = head_endptr;
+
+	if (head_pos == MyRingPos)
+	{
+		TimestampTz now = GetCurrentTimestamp();
+
+		/* leave a leader that doesn't keep up with the WAL */
+		if (head_endptr != MyLastEndptr)
+		{
+			MyLastEndptr = head_endptr;
+			MyLastProgress = now;
+		}
+		else if (GetFlushRecPtr() > head_endptr &&
+				 TimestampDifferenceExceeds(MyLastProgress, now,
+											DECODE_FANOUT_LEADER_STALL_MS))
+		{
+			elog(DEBUG1, "logical decoding fan-out group leader does not make progress");
+			return DECODE_FANOUT_READ_LOST;
+		}
+
+		return DECODE_FANOUT_READ_EMPTY;
+	}
+
+	*len = head_pos - MyRingPos;
+	decode_fanout_ring_read(group, MyRingPos, MyReadBuffer, *len);
+
+	/* check whether the leader overwrote any of that while we copied it */
+	pg_read_barrier();
+	SpinLockAcquire(&group->mutex);
+	valid = group->generation == MyGeneration;
+	write_pos = group->write_pos;
+	SpinLockRelease(&group->mutex);
+
+	if (!valid || write_pos > MyRingPos + ring_size)
+	{
+		elog(DEBUG1, "walsender fell behind its logical decoding fan-out group");
+		return DECODE_FANOUT_READ_LOST;
+	}
+
+	MyRingPos = head_pos;
+	MyLastEndptr = head_endptr;
+	MyLastProgress = GetCurrentTimestamp();
+	*data = MyReadBuffer;
+
+	return DECODE_FANOUT_READ_DATA;
+}
+
+/*
+ * Called after our client confirmed a position.  The leader shares the
+ * horizon of its slot with the members, and members advance their slots to
+ * it if that's safe.
+ */
+void
+DecodeFanoutSyncSlot(void)
+{
+	DecodeFanoutGroup *group = MyGroup;
+	ReplicationSlot *slot = MyReplicationSlot;
+	XLogRecPtr	confirmed_flush;
+	XLogRecPtr	restart_lsn;
+	TransactionId catalog_xmin;
+	bool		valid;
+	bool		updated_xmin = false;
+	bool		updated_restart = false;
+
+	if (MyDecodeFanoutRole == DECODE_FANOUT_LEADER)
+	{
+		SpinLockAcquire(&slot->mutex);
+		confirmed_flush = slot->data.confirmed_flush;
+		restart_lsn = slot->data.restart_lsn;
+		catalog_xmin = slot->data.catalog_xmin;
+		SpinLockRelease(&slot->mutex);
+
+		SpinLockAcquire(&group->mutex);
+		group->leader_confirmed_flush = confirmed_flush;
+		group->leader_restart_lsn = restart_lsn;
+		group->leader_catalog_xmin = catalog_xmin;
+		SpinLockRelease(&group->mutex);
+		return;
+	}
+
+	if (MyDecodeFanoutRole != DECODE_FANOUT_MEMBER)
+		return;
+
+	SpinLockAcquire(&group->mutex);
+	valid = group->generation == MyGeneration;
+	confirmed_flush = group->leader_confirmed_flush;
+	restart_lsn = group->leader_restart_lsn;
+	catalog_xmin = group->leader_catalog_xmin;
+	SpinLockRelease(&group->mutex);
+
+	if (!valid || XLogRecPtrIsInvalid(confirmed_flush))
+		return;
+
+	SpinLockAcquire(&slot->mutex);
+	if (confirmed_flush <= slot->data.confirmed_flush)
+	{
+		if (restart_lsn > slot->data.restart_lsn)
+		{
+			slot->data.restart_lsn = restart_lsn;
+			updated_restart = true;
+		}
+		if (TransactionIdIsValid(catalog_xmin) &&
+			TransactionIdPrecedes(slot->data.catalog_xmin, catalog_xmin))
+		{
+			slot->data.catalog_xmin = catalog_xmin;
+			updated_xmin = true;
+		}
+	}
+	SpinLockRelease(&slot->mutex);
+
+	/*
+	 * As in LogicalConfirmReceivedLocation(), write the new xmin to disk
+	 * before letting the global value advance.
+	 */
+	if (updated_xmin || updated_restart)
+	{
+		ReplicationSlotMarkDirty();
+		ReplicationSlotSave();
+	}
+
+	if (updated_xmin)
+	{
+		SpinLockAcquire(&slot->mutex);
+		slot->effective_catalog_xmin = slot->data.catalog_xmin;
+		SpinLockRelease(&slot->mutex);
+
+		ReplicationSlotsComputeRequiredXmin(false);
+	}
+
+	if (updated_xmin || updated_restart)
+		ReplicationSlotsComputeRequiredLSN();
+}
+
+/*
+ * Serialize an output plugin name and its options into a group key.
+ * Returns false if the key doesn't fit.
+ */
+static bool
+decode_fanout_build_key(const char *plugin, List *options, char *key)
+{
+	StringInfoData buf;
+	ListCell   *lc;
+	bool		fits;
+
+	initStringInfo(&buf);
+	appendStringInfoString(&buf, plugin);
+
+	/* length-prefix everything, option values may contain anything */
+	foreach(lc, options)
+	{
+		DefElem    *elem = (DefElem *) lfirst(lc);
+
+		appendStringInfo(&buf, " %d:%s", (int) strlen(elem->defname),
+						 elem->defname);
+		if (elem->arg != NULL)
+		{
+			char	   *value = strVal(elem->arg);
+
+			appendStringInfo(&buf, "=%d:%s", (int) strlen(value), value);
+		}
+	}
+
+	fits = buf.len < DECODE_FANOUT_KEY_LEN;
+	if (fits)
+		memcpy(key, buf.data, buf.len + 1);
+	pfree(buf.data);
+
+	return fits;
+}
+
+/*
+ * Join the group for our key as a joining walsender, or become the leader
+ * of a new one.  If all groups are taken, we just stay on our own.
+ */
+static void
+decode_fanout_find_group(void)
+{
+	DecodeFanoutGroup *free_group = NULL;
+	int			i;
+
+	Assert(MyDecodeFanoutRole == DECODE_FANOUT_NONE);
+
+	LWLockAcquire(DecodeFanoutLock, LW_EXCLUSIVE);
+
+	for (i = 0; i < max_logical_decoding_fanout_groups; i++)
+	{
+		DecodeFanoutGroup *group = DecodeFanoutGetGroup(i);
+
+		/* in_use, dboid and key can't change while we hold the lock */
+		if (!group->in_use)
+		{
+			if (free_group == NULL)
+				free_group = group;
+			continue;
+		}
+
+		if (group->dboid == MyDatabaseId && strcmp(group->key, MyKey) == 0)
+		{
+			SpinLockAcquire(&group->mutex);
+			MyGeneration = group->generation;
+			SpinLockRelease(&group->mutex);
+
+			MyGroup = group;
+			MyDecodeFanoutRole = DECODE_FANOUT_JOINING;
+			break;
+		}
+	}
+
+	if (MyGroup == NULL && free_group != NULL)
+	{
+		DecodeFanoutGroup *group = free_group;
+
+		SpinLockAcquire(&group->mutex);
+		group->in_use = true;
+		group->generation++;
+		group->dboid = MyDatabaseId;
+		strlcpy(group->key, MyKey, DECODE_FANOUT_KEY_LEN);
+		group->write_pos = 0;
+		group->head_pos = 0;
+		group->head_endptr = InvalidXLogRecPtr;
+		group->join_request = InvalidXLogRecPtr;
+		group->marker_lsn = InvalidXLogRecPtr;
+		group->marker_pos = 0;
+		group->leader_confirmed_flush = InvalidXLogRecPtr;
+		group->leader_restart_lsn = InvalidXLogRecPtr;
+		group->leader_catalog_xmin = InvalidTransactionId;
+		memset(group->latches, 0, sizeof(Latch *) * max_wal_senders);
+		MyGeneration = group->generation;
+		SpinLockRelease(&group->mutex);
+
+		MyGroup = group;
+		MyDecodeFanoutRole = DECODE_FANOUT_LEADER;
+		MyRingPos = 0;
+		MyGroupActive = false;
+	}
+
+	LWLockRelease(DecodeFanoutLock);
+
+	if (MyDecodeFanoutRole == DECODE_FANOUT_LEADER)
+		elog(DEBUG1, "walsender leads new logical decoding fan-out group");
+}
+
+/*
+ * Wake up the walsenders in or joining a group.
+ *
+ * The latch pointers are read without holding the mutex; at worst we set
+ * the latch of a process that's not interested anymore.
+ */
+static void
+decode_fanout_wakeup(DecodeFanoutGroup *group)
+{
+	int			i;
+
+	for (i = 0; i < max_wal_senders; i++)
+	{
+		Latch	   *latch = group->latches[i];
+
+		if (latch != NULL && i != MyWalSndIndex)
+			SetLatch(latch);
+	}
+}
+
+static void
+decode_fanout_ring_write(DecodeFanoutGroup *group, uint64 pos,
+						 const char *data, Size len)
+{
+	char	   *ring = DecodeFanoutGroupRing(group);
+	Size		ring_size = DecodeFanoutRingSize;
+	Size		offset = pos % ring_size;
+	Size		first = Min(len, ring_size - offset);
+
+	Assert(len <= ring_size);
+
+	memcpy(ring + offset, data, first);
+	if (first < len)
+		memcpy(ring, data + first, len - first);
+}
+
+static void
+decode_fanout_ring_read(DecodeFanoutGroup *group, uint64 pos,
+						char *data, Size len)
+{
+	char	   *ring = DecodeFanoutGroupRing(group);
+	Size		ring_size = DecodeFanoutRingSize;
+	Size		offset = pos % ring_size;
+	Size		first = Min(len, ring_size - offset);
+
+	Assert(len <= ring_size);
+
+	memcpy(data, ring + offset, first);
+	if (first < len)
+		memcpy(data + first, ring, len - first);
+}
+
+/*
+ * Leave our group when exiting, so that a group we lead goes away.
+ */
+static void
+DecodeFanoutShmemExit(int code, Datum arg)
+{
+	DecodeFanoutDetach();
+}
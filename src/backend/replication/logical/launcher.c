@@ -53,6 +53,7 @@
 
 int			max_logical_replication_workers = 4;
 int			max_sync_workers_per_subscription = 2;
+int			max_parallel_apply_workers_per_subscription = 0;
 
 LogicalRepWorker *MyLogicalRepWorker = NULL;
 
@@ -172,8 +173,10 @@ get_subscription_list(void)
  *
  * This is only needed for cleaning up the shared memory in case the worker
  * fails to attach.
+ *
+ * Returns whether the attach was successful.
  */
-static void
+static bool
 WaitForReplicationWorkerAttach(LogicalRepWorker *worker,
 							   uint16 generation,
 							   BackgroundWorkerHandle *handle)
@@ -192,8 +195,10 @@ WaitForReplicationWorkerAttach(LogicalRepWorker *worker,
 		/* Worker either died or has started; no need to do anything. */
 		if (!worker->in_use || worker->proc)
 		{
+			bool		attached = worker->in_use;
+
 			LWLockRelease(LogicalRepWorkerLock);
-			return;
+			return attached;
 		}
 
 		LWLockRelease(LogicalRepWorkerLock);
@@ -208,7 +213,7 @@ WaitForReplicationWorkerAttach(LogicalRepWorker *worker,
 			if (generation == worker->generation)
 				logicalrep_worker_cleanup(worker);
 			LWLockRelease(LogicalRepWorkerLock);
-			return;
+			return false;
 		}
 
 		/*
@@ -244,6 +249,10 @@ logicalrep_worker_find(Oid subid, Oid relid, bool only_running)
 	{
 		LogicalRepWorker *w = &LogicalRepCtx->workers[i];
 
+		/* Skip parallel apply workers. */
+		if (isParallelApplyWorker(w))
+			continue;
+
 		if (w->in_use && w->subid == subid && w->relid == relid &&
 			(!only_running || w->proc))
 		{
@@ -281,10 +290,15 @@ logicalrep_workers_find(Oid subid, bool only_running)
 
 /*
  * Start new apply background worker, if possible.
+ *
+ * A valid subworker_dsm makes it a parallel apply worker of the calling apply
+ * worker, fed through that segment.
+ *
+ * Returns true on success, false on failure.
  */
-void
+bool
 logicalrep_worker_launch(Oid dbid, Oid subid, const char *subname, Oid userid,
-						 Oid relid)
+						 Oid relid, dsm_handle subworker_dsm)
 {
 	BackgroundWorker bgw;
 	BackgroundWorkerHandle *bgw_handle;
@@ -293,7 +307,12 @@ logicalrep_worker_launch(Oid dbid, Oid subid, const char *subname, Oid userid,
 	int			slot = 0;
 	LogicalRepWorker *worker = NULL;
 	int			nsyncworkers;
+	int			nparallelapplyworkers;
 	TimestampTz now;
+	bool		is_parallel_apply_worker = (subworker_dsm != DSM_HANDLE_INVALID);
+
+	/* Sanity check - tablesync worker cannot be a subworker */
+	Assert(!(is_parallel_apply_worker && OidIsValid(relid)));
 
 	ereport(DEBUG1,
 			(errmsg("starting logical replication worker for subscription \"%s\"",
@@ -326,6 +345,7 @@ retry:
 	}
 
 	nsyncworkers = logicalrep_sync_worker_count(subid);
+	nparallelapplyworkers = logicalrep_pa_worker_count(subid);
 
 	now = GetCurrentTimestamp();
 
@@ -368,10 +388,18 @@ retry:
 	 * silently as we might get here because of an otherwise harmless race
 	 * condition.
 	 */
-	if (nsyncworkers >= max_sync_workers_per_subscription)
+	if (OidIsValid(relid) && nsyncworkers >= max_sync_workers_per_subscription)
 	{
 		LWLockRelease(LogicalRepWorkerLock);
-		return;
+		return false;
+	}
+
+	/* Likewise for the parallel apply worker limit. */
+	if (is_parallel_apply_worker &&
+		nparallelapplyworkers >= max_parallel_apply_workers_per_subscription)
+	{
+		LWLockRelease(LogicalRepWorkerLock);
+		return false;
 	}
 
 	/*
@@ -385,7 +413,7 @@ retry:
 				(errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
 				 errmsg("out of logical replication worker slots"),
 				 errhint("You might need to increase max_logical_replication_workers.")));
-		return;
+		return false;
 	}
 
 	/* Prepare the worker slot. */
@@ -404,6 +432,12 @@ retry:
 	TIMESTAMP_NOBEGIN(worker->last_recv_time);
 	worker->reply_lsn = InvalidXLogRecPtr;
 	TIMESTAMP_NOBEGIN(worker->reply_time);
+	worker->leader_pid = is_parallel_apply_worker ? MyProcPid : 0;
+	worker->leader_slot = is_parallel_apply_worker ?
+		MyLogicalRepWorker - LogicalRepCtx->workers : -1;
+	worker->pa_committed_seq = 0;
+	worker->pa_remote_end = InvalidXLogRecPtr;
+	worker->pa_local_end = InvalidXLogRecPtr;
 
 	/* Before releasing lock, remember generation for future identification. */
 	generation = worker->generation;
@@ -416,19 +450,31 @@ retry:
 		BGWORKER_BACKEND_DATABASE_CONNECTION;
 	bgw.bgw_start_time = BgWorkerStart_RecoveryFinished;
 	snprintf(bgw.bgw_library_name, BGW_MAXLEN, "postgres");
-	snprintf(bgw.bgw_function_name, BGW_MAXLEN, "ApplyWorkerMain");
+	if (is_parallel_apply_worker)
+		snprintf(bgw.bgw_function_name, BGW_MAXLEN, "ParallelApplyWorkerMain");
+	else
+		snprintf(bgw.bgw_function_name, BGW_MAXLEN, "ApplyWorkerMain");
 	if (OidIsValid(relid))
 		snprintf(bgw.bgw_name, BGW_MAXLEN,
 				 "logical replication worker for subscription %u sync %u", subid, relid);
+	else if (is_parallel_apply_worker)
+		snprintf(bgw.bgw_name, BGW_MAXLEN,
+				 "logical replication parallel apply worker for subscription %u", subid);
 	else
 		snprintf(bgw.bgw_name, BGW_MAXLEN,
 				 "logical replication worker for subscription %u", subid);
-	snprintf(bgw.bgw_type, BGW_MAXLEN, "logical replication worker");
+	if (is_parallel_apply_worker)
+		snprintf(bgw.bgw_type, BGW_MAXLEN, "logical replication parallel apply worker");
+	else
+		snprintf(bgw.bgw_type, BGW_MAXLEN, "logical replication worker");
 
 	bgw.bgw_restart_time = BGW_NEVER_RESTART;
 	bgw.bgw_notify_pid = MyProcPid;
 	bgw.bgw_main_arg = Int32GetDatum(slot);
 
+	if (is_parallel_apply_worker)
+		memcpy(bgw.bgw_extra, &subworker_dsm, sizeof(dsm_handle));
+
 	if (!RegisterDynamicBackgroundWorker(&bgw, &bgw_handle))
 	{
 		/* Failed to start worker, so clean up the worker slot. */
@@ -441,11 +487,11 @@ retry:
 				(errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
 				 errmsg("out of background worker slots"),
 				 errhint("You might need to increase max_worker_processes.")));
-		return;
+		return false;
 	}
 
 	/* Now wait until it attaches. */
-	WaitForReplicationWorkerAttach(worker, generation, bgw_handle);
+	return WaitForReplicationWorkerAttach(worker, generation, bgw_handle);
 }
 
 /*
@@ -658,12 +704,46 @@ logicalrep_worker_attach(int slot)
 	LWLockRelease(LogicalRepWorkerLock);
 }
 
+/*
+ * Return the slot of the leader apply worker a parallel apply worker belongs
+ * to.  Note that the leader may have exited since, check leader_pid.
+ */
+LogicalRepWorker *
+logicalrep_worker_leader(void)
+{
+	Assert(am_parallel_apply_worker());
+
+	return &LogicalRepCtx->workers[MyLogicalRepWorker->leader_slot];
+}
+
 /*
  * Detach the worker (cleans up the worker info).
  */
 static void
 logicalrep_worker_detach(void)
 {
+	/*
+	 * An apply worker takes its parallel apply workers down with it, as they
+	 * would otherwise go on committing after it.
+	 */
+	if (!am_tablesync_worker() && !am_parallel_apply_worker())
+	{
+		int			i;
+
+		LWLockAcquire(LogicalRepWorkerLock, LW_SHARED);
+
+		for (i = 0; i < max_logical_replication_workers; i++)
+		{
+			LogicalRepWorker *w = &LogicalRepCtx->workers[i];
+
+			if (w->in_use && w->proc && w->leader_pid == MyProcPid &&
+				isParallelApplyWorker(w))
+				kill(w->proc->pid, SIGTERM);
+		}
+
+		LWLockRelease(LogicalRepWorkerLock);
+	}
+
 	/* Block concurrent access. */
 	LWLockAcquire(LogicalRepWorkerLock, LW_EXCLUSIVE);
 
@@ -686,6 +766,8 @@ logicalrep_worker_cleanup(LogicalRepWorker *worker)
 	worker->userid = InvalidOid;
 	worker->subid = InvalidOid;
 	worker->relid = InvalidOid;
+	worker->leader_pid = 0;
+	worker->leader_slot = -1;
 }
 
 /*
@@ -740,6 +822,69 @@ logicalrep_sync_worker_count(Oid subid)
 	return res;
 }
 
+/*
+ * Count the number of registered (not necessarily running) parallel apply
+ * workers for a subscription.
+ */
+int
+logicalrep_pa_worker_count(Oid subid)
+{
+	int			i;
+	int			res = 0;
+
+	Assert(LWLockHeldByMe(LogicalRepWorkerLock));
+
+	for (i = 0; i < max_logical_replication_workers; i++)
+	{
+		LogicalRepWorker *w = &LogicalRepCtx->workers[i];
+
+		if (w->in_use && w->subid == subid && isParallelApplyWorker(w))
+			res++;
+	}
+
+	return res;
+}
+
+/*
+ * Wait until no parallel apply workers of the subscription are left, such as
+ * those of a previous apply worker that are still shutting down, and reset
+ * the parallel apply state of our own slot.
+ */
+void
+logicalrep_pa_workers_wait_for_exit(Oid subid)
+{
+	for (;;)
+	{
+		int			nworkers;
+		int			rc;
+
+		LWLockAcquire(LogicalRepWorkerLock, LW_SHARED);
+		nworkers = logicalrep_pa_worker_count(subid);
+		LWLockRelease(LogicalRepWorkerLock);
+
+		if (nworkers == 0)
+			break;
+
+		/* Wait a bit --- we don't expect to have to wait long. */
+		rc = WaitLatch(MyLatch,
+					   WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+					   10L, WAIT_EVENT_BGWORKER_SHUTDOWN);
+
+		if (rc & WL_LATCH_SET)
+		{
+			ResetLatch(MyLatch);
+			CHECK_FOR_INTERRUPTS();
+		}
+	}
+
+	/* Their commits no longer count. */
+	SpinLockAcquire(&MyLogicalRepWorker->relmutex);
+	MyLogicalRepWorker->pa_committed_seq = 0;
+	MyLogicalRepWorker->pa_remote_end = InvalidXLogRecPtr;
+	MyLogicalRepWorker->pa_local_end = InvalidXLogRecPtr;
+	SpinLockRelease(&MyLogicalRepWorker->relmutex);
+}
+
 /*
  * ApplyLauncherShmemSize
  *		Compute space needed for replication launcher shared memory
@@ -815,6 +960,7 @@ ApplyLauncherShmemInit(void)
 
 			memset(worker, 0, sizeof(LogicalRepWorker));
 			SpinLockInit(&worker->relmutex);
+			ConditionVariableInit(&worker->pa_cv);
 		}
 	}
 }
@@ -1017,7 +1163,8 @@ ApplyLauncherMain(Datum main_arg)
 					wait_time = wal_retrieve_retry_interval;
 
 					logicalrep_worker_launch(sub->dbid, sub->oid, sub->name,
-											 sub->owner, InvalidOid);
+											 sub->owner, InvalidOid,
+											 DSM_HANDLE_INVALID);
 				}
 			}
 
@@ -1123,6 +1270,10 @@ pg_stat_get_subscription(PG_FUNCTION_ARGS)
 		if (!worker.proc || !IsBackendPid(worker.proc->pid))
 			continue;
 
+		/* Parallel apply workers are reported through their leader. */
+		if (isParallelApplyWorker(&worker))
+			continue;
+
 		if (OidIsValid(subid) && worker.subid != subid)
 			continue;
 
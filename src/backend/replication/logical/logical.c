@@ -577,6 +577,27 @@ FreeDecodingContext(LogicalDecodingContext *ctx)
 	MemoryContextDelete(ctx->context);
 }
 
+/*
+ * Restart the output plugin of a decoding context, so that it forgets any
+ * state it built up during the session (like which relation descriptions it
+ * already sent).  Output produced afterwards is then the same as that of a
+ * freshly started session.  Must only be called between records.
+ */
+void
+ResetDecodingContextOutputPlugin(LogicalDecodingContext *ctx)
+{
+	MemoryContext old_context;
+
+	old_context = MemoryContextSwitchTo(ctx->context);
+
+	if (ctx->callbacks.shutdown_cb != NULL)
+		shutdown_cb_wrapper(ctx);
+	if (ctx->callbacks.startup_cb != NULL)
+		startup_cb_wrapper(ctx, &ctx->options, false);
+
+	MemoryContextSwitchTo(old_context);
+}
+
 /*
  * Prepare a write using the context's output routine.
  */
@@ -1046,9 +1046,15 @@ ReplicationOriginExitCleanup(int code, Datum arg)
  * Obviously only one such cached origin can exist per process and the current
  * cached value can only be set again after the previous value is torn down
  * with replorigin_session_reset().
+ *
+ * Normally the origin must not be in use by any other process.  A non-zero
+ * acquired_by instead asks to share the origin with the process of that PID,
+ * which must already have set it up; this is how parallel apply workers
+ * advance the origin of their leader apply worker.  Such a process never
+ * owns the origin, so exiting or resetting it leaves the owner's setup alone.
  */
 void
-replorigin_session_setup(RepOriginId node)
+replorigin_session_setup(RepOriginId node, int acquired_by)
 {
 	static bool registered_cleanup;
 	int			i;
@@ -1090,12 +1096,18 @@ replorigin_session_setup(RepOriginId node)
 		if (curstate->roident != node)
 			continue;
 
-		else if (curstate->acquired_by != 0)
+		else if (curstate->acquired_by != acquired_by)
 		{
-			ereport(ERROR,
-					(errcode(ERRCODE_OBJECT_IN_USE),
-					 errmsg("replication origin with OID %d is already active for PID %d",
-							curstate->roident, curstate->acquired_by)));
+			if (acquired_by == 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_OBJECT_IN_USE),
+						 errmsg("replication origin with OID %d is already active for PID %d",
+								curstate->roident, curstate->acquired_by)));
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+						 errmsg("replication origin with OID %d is not active for PID %d",
+								curstate->roident, acquired_by)));
 		}
 
 		/* ok, found slot */
@@ -1103,7 +1115,12 @@ replorigin_session_setup(RepOriginId node)
 	}
 
 
-	if (session_replication_state == NULL && free_slot == -1)
+	if (session_replication_state == NULL && acquired_by != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("replication origin with OID %d is not active for PID %d",
+						node, acquired_by)));
+	else if (session_replication_state == NULL && free_slot == -1)
 		ereport(ERROR,
 				(errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
 				 errmsg("could not find free replication state slot for replication origin with OID %u",
@@ -1121,7 +1138,8 @@ replorigin_session_setup(RepOriginId node)
 
 	Assert(session_replication_state->roident != InvalidRepOriginId);
 
-	session_replication_state->acquired_by = MyProcPid;
+	if (acquired_by == 0)
+		session_replication_state->acquired_by = MyProcPid;
 
 	LWLockRelease(ReplicationOriginLock);
 
@@ -1149,7 +1167,8 @@ replorigin_session_reset(void)
 
 	LWLockAcquire(ReplicationOriginLock, LW_EXCLUSIVE);
 
-	session_replication_state->acquired_by = 0;
+	if (session_replication_state->acquired_by == MyProcPid)
+		session_replication_state->acquired_by = 0;
 	cv = &session_replication_state->origin_cv;
 	session_replication_state = NULL;
 
@@ -1305,7 +1324,7 @@ pg_replication_origin_session_setup(PG_FUNCTION_ARGS)
 
 	name = text_to_cstring((text *) DatumGetPointer(PG_GETARG_DATUM(0)));
 	origin = replorigin_by_name(name, false);
-	replorigin_session_setup(origin);
+	replorigin_session_setup(origin, 0);
 
 	replorigin_session_origin = origin;
 
@@ -16,10 +16,13 @@
 
 #include "postgres.h"
 
+#include "access/htup_details.h"
 #include "access/sysattr.h"
 #include "access/table.h"
 #include "catalog/namespace.h"
+#include "catalog/pg_index.h"
 #include "catalog/pg_subscription_rel.h"
+#include "commands/trigger.h"
 #include "executor/executor.h"
 #include "nodes/makefuncs.h"
 #include "replication/logicalrelation.h"
@@ -160,6 +163,7 @@ logicalrep_relmap_free_entry(LogicalRepRelMapEntry *entry)
 
 	if (entry->attrmap)
 		pfree(entry->attrmap);
+	bms_free(entry->parallel_keys);
 }
 
 /*
@@ -227,6 +231,87 @@ logicalrep_rel_att_by_name(LogicalRepRelation *remoterel, const char *attname)
 	return -1;
 }
 
+/*
+ * Can changes to the relation be applied by parallel apply workers?
+ *
+ * The leader apply worker orders the transactions it hands to parallel apply
+ * workers only by the replica identity of the rows they change (see
+ * applyparallel.c), so there must be no other way for two changes to
+ * collide: no other unique or exclusion index, and no triggers that fire
+ * while applying.  If the relation qualifies, also remember the replica
+ * identity columns, as attribute offsets, in entry->parallel_keys.
+ */
+static bool
+logicalrep_rel_parallel_safe(LogicalRepRelMapEntry *entry, Bitmapset *idkey)
+{
+	Relation	rel = entry->localrel;
+	Oid			idxoid;
+	List	   *indexes;
+	ListCell   *lc;
+	MemoryContext oldctx;
+	int			i;
+
+	if (!entry->updatable || idkey == NULL ||
+		rel->rd_rel->relkind != RELKIND_RELATION)
+		return false;
+
+	idxoid = RelationGetReplicaIndex(rel);
+	if (!OidIsValid(idxoid))
+		idxoid = RelationGetPrimaryKeyIndex(rel);
+
+	indexes = RelationGetIndexList(rel);
+	foreach(lc, indexes)
+	{
+		Oid			indexoid = lfirst_oid(lc);
+		HeapTuple	tup;
+		Form_pg_index index;
+		bool		unique;
+
+		if (indexoid == idxoid)
+			continue;
+
+		tup = SearchSysCache1(INDEXRELID, ObjectIdGetDatum(indexoid));
+		if (!HeapTupleIsValid(tup))
+			elog(ERROR, "cache lookup failed for index %u", indexoid);
+		index = (Form_pg_index) GETSTRUCT(tup);
+		unique = index->indisunique || index->indisexclusion;
+		ReleaseSysCache(tup);
+
+		if (unique)
+		{
+			list_free(indexes);
+			return false;
+		}
+	}
+	list_free(indexes);
+
+	if (rel->trigdesc != NULL)
+	{
+		for (i = 0; i < rel->trigdesc->numtriggers; i++)
+		{
+			char		tgenabled = rel->trigdesc->triggers[i].tgenabled;
+
+			if (tgenabled == TRIGGER_FIRES_ALWAYS ||
+				tgenabled == TRIGGER_FIRES_ON_REPLICA)
+				return false;
+		}
+	}
+
+	/* Updatable, so every identity column maps to a remote key column. */
+	oldctx = MemoryContextSwitchTo(LogicalRepRelMapContext);
+	i = -1;
+	while ((i = bms_next_member(idkey, i)) >= 0)
+	{
+		int			attnum = i + FirstLowInvalidHeapAttributeNumber;
+
+		entry->parallel_keys = bms_add_member(entry->parallel_keys,
+											  AttrNumberGetAttrOffset(attnum));
+	}
+	MemoryContextSwitchTo(oldctx);
+
+	return true;
+}
+
 /*
  * Open the local relation associated with the remote one.
  *
@@ -380,6 +465,10 @@ logicalrep_rel_open(LogicalRepRelId remoteid, LOCKMODE lockmode)
 			}
 		}
 
+		bms_free(entry->parallel_keys);
+		entry->parallel_keys = NULL;
+		entry->parallel_safe = logicalrep_rel_parallel_safe(entry, idkey);
+
 		entry->localreloid = relid;
 	}
 
@@ -67,6 +67,9 @@
  *	  allocator, evicting the oldest changes would make it more likely the
  *	  memory gets actually freed.
  *
+ *	  Spilled changes are written in blocks of up to SPILL_BLOCK_SIZE bytes,
+ *	  each of which may be compressed as per logical_decoding_spill_compression.
+ *
  *	  We still rely on max_changes_in_memory when loading serialized changes
  *	  back into memory. At that point we can't use the memory limit directly
  *	  as we load the subxacts independently. One option to deal with this
@@ -83,6 +86,9 @@
 
 #include <unistd.h>
 #include <sys/stat.h>
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
 
 #include "access/detoast.h"
 #include "access/heapam.h"
@@ -91,6 +97,7 @@
 #include "access/xact.h"
 #include "access/xlog_internal.h"
 #include "catalog/catalog.h"
+#include "common/pg_lzcompress.h"
 #include "lib/binaryheap.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -178,6 +185,20 @@ typedef struct ReorderBufferDiskChange
 	/* data follows */
 } ReorderBufferDiskChange;
 
+/*
+ * Header of a block of changes in a spill file.  The changes are stored
+ * maxaligned one after the other, and then possibly compressed.
+ */
+typedef struct ReorderBufferDiskBlock
+{
+	uint32		size;			/* size of the data following on disk */
+	uint32		rawsize;		/* size of the changes, uncompressed */
+	uint8		method;			/* a ReorderBufferSpillCompression */
+} ReorderBufferDiskBlock;
+
+/* Size beyond which a block of changes is written out */
+#define SPILL_BLOCK_SIZE	(64 * 1024)
+
 #define IsSpecInsert(action) \
 ( \
 	((action) == REORDER_BUFFER_CHANGE_INTERNAL_SPEC_INSERT) \
@@ -206,6 +227,7 @@ typedef struct ReorderBufferDiskChange
  * like.
  */
 int			logical_decoding_work_mem;
+int			logical_decoding_spill_compression = SPILL_COMPRESSION_NONE;
 static const Size max_changes_in_memory = 4096; /* XXX for restore only */
 
 /* ---------------------------------------
@@ -246,6 +268,10 @@ static void ReorderBufferCheckMemoryLimit(ReorderBuffer *rb);
 static void ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn);
 static void ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 										 int fd, ReorderBufferChange *change);
+static void ReorderBufferSerializeBlock(ReorderBuffer *rb, ReorderBufferTXN *txn,
+										int fd);
+static void ReorderBufferDecompressBlock(ReorderBufferDiskBlock *block,
+										 char *source, char *dest);
 static Size ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 										TXNEntryFile *file, XLogSegNo *segno);
 static void ReorderBufferRestoreChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
@@ -341,6 +367,9 @@ ReorderBufferAllocate(void)
 
 	buffer->outbuf = NULL;
 	buffer->outbufsize = 0;
+	buffer->spillbuf = NULL;
+	buffer->spillbufsize = 0;
+	buffer->spilllen = 0;
 	buffer->size = 0;
 
 	buffer->current_restart_decoding_lsn = InvalidXLogRecPtr;
@@ -2949,6 +2978,25 @@ ReorderBufferSerializeReserve(ReorderBuffer *rb, Size sz)
 	}
 }
 
+/*
+ * Ensure the spill block buffer is >= sz.
+ */
+static void
+ReorderBufferSpillReserve(ReorderBuffer *rb, Size sz)
+{
+	if (!rb->spillbufsize)
+	{
+		sz = Max(sz, SPILL_BLOCK_SIZE);
+		rb->spillbuf = MemoryContextAlloc(rb->context, sz);
+		rb->spillbufsize = sz;
+	}
+	else if (rb->spillbufsize < sz)
+	{
+		rb->spillbuf = repalloc(rb->spillbuf, sz);
+		rb->spillbufsize = sz;
+	}
+}
+
 /*
  * Find the largest transaction (toplevel or subxact) to evict (spill to disk).
  *
@@ -3116,6 +3164,9 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 	elog(DEBUG2, "spill %u changes in XID %u to disk",
 		 (uint32) txn->nentries_mem, txn->xid);
 
+	/* Forget any block left behind by an error. */
+	rb->spilllen = 0;
+
 	/* do the same to all child TXs */
 	dlist_foreach(subtxn_i, &txn->subtxns)
 	{
@@ -3142,7 +3193,10 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 			char		path[MAXPGPATH];
 
 			if (fd != -1)
+			{
+				ReorderBufferSerializeBlock(rb, txn, fd);
 				CloseTransientFile(fd);
+			}
 
 			XLByteToSeg(change->lsn, curOpenSegNo, wal_segment_size);
 
@@ -3176,7 +3230,130 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 	txn->txn_flags |= RBTXN_IS_SERIALIZED;
 
 	if (fd != -1)
+	{
+		ReorderBufferSerializeBlock(rb, txn, fd);
 		CloseTransientFile(fd);
+	}
+}
+
+/*
+ * Write to a spill file, erroring out on failure.
+ */
+static void
+ReorderBufferSpillWrite(ReorderBufferTXN *txn, int fd, char *data, Size len)
+{
+	errno = 0;
+	pgstat_report_wait_start(WAIT_EVENT_REORDER_BUFFER_WRITE);
+	if (write(fd, data, len) != len)
+	{
+		int			save_errno = errno;
+
+		CloseTransientFile(fd);
+
+		/* if write didn't set errno, assume problem is no disk space */
+		errno = save_errno ? save_errno : ENOSPC;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to data file for XID %u: %m",
+						txn->xid)));
+	}
+	pgstat_report_wait_end();
+}
+
+/*
+ * Write out the block of changes collected, compressing it if enabled and
+ * worthwhile.
+ */
+static void
+ReorderBufferSerializeBlock(ReorderBuffer *rb, ReorderBufferTXN *txn, int fd)
+{
+	ReorderBufferDiskBlock block;
+	char	   *data = rb->spillbuf;
+	int32		len = -1;
+
+	if (rb->spilllen == 0)
+		return;
+
+	MemSet(&block, 0, sizeof(block));
+	block.rawsize = rb->spilllen;
+
+	/* The output buffer is free again, compress into it. */
+	switch ((ReorderBufferSpillCompression) logical_decoding_spill_compression)
+	{
+		case SPILL_COMPRESSION_PGLZ:
+			ReorderBufferSerializeReserve(rb, PGLZ_MAX_OUTPUT(rb->spilllen));
+			len = pglz_compress(rb->spillbuf, rb->spilllen, rb->outbuf,
+								PGLZ_strategy_default);
+			break;
+
+		case SPILL_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			ReorderBufferSerializeReserve(rb, LZ4_COMPRESSBOUND(rb->spilllen));
+			len = LZ4_compress_default(rb->spillbuf, rb->outbuf, rb->spilllen,
+									   LZ4_COMPRESSBOUND(rb->spilllen));
+			if (len <= 0)
+				len = -1;		/* failure */
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+
+		case SPILL_COMPRESSION_NONE:
+			break;
+			/* no default case, so that compiler will warn */
+	}
+
+	if (len >= 0 && len < rb->spilllen)
+	{
+		block.method = logical_decoding_spill_compression;
+		block.size = len;
+		data = rb->outbuf;
+	}
+	else
+	{
+		block.method = SPILL_COMPRESSION_NONE;
+		block.size = rb->spilllen;
+	}
+
+	ReorderBufferSpillWrite(txn, fd, (char *) &block, sizeof(block));
+	ReorderBufferSpillWrite(txn, fd, data, block.size);
+
+	rb->spilllen = 0;
+}
+
+/*
+ * Decompress a block of changes read from a spill file.
+ */
+static void
+ReorderBufferDecompressBlock(ReorderBufferDiskBlock *block, char *source,
+							 char *dest)
+{
+	int32		len = -1;
+
+	switch ((ReorderBufferSpillCompression) block->method)
+	{
+		case SPILL_COMPRESSION_PGLZ:
+			len = pglz_decompress(source, block->size, dest, block->rawsize,
+								  true);
+			break;
+
+		case SPILL_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			len = LZ4_decompress_safe(source, dest, block->size,
+									  block->rawsize);
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+
+		case SPILL_COMPRESSION_NONE:
+			break;
+	}
+
+	if (len != block->rawsize)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("could not decompress block of reorderbuffer spill file")));
 }
 
 /*
@@ -3346,22 +3523,17 @@ ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 
 	ondisk->size = sz;
 
-	errno = 0;
-	pgstat_report_wait_start(WAIT_EVENT_REORDER_BUFFER_WRITE);
-	if (write(fd, rb->outbuf, ondisk->size) != ondisk->size)
-	{
-		int			save_errno = errno;
+	/* ondisk is gone once compressing the block below reuses outbuf */
+	Assert(ondisk->change.action == change->action);
 
-		CloseTransientFile(fd);
+	/* Add it to the current block, keeping the changes maxaligned. */
+	ReorderBufferSpillReserve(rb, rb->spilllen + MAXALIGN(sz));
+	memcpy(rb->spillbuf + rb->spilllen, rb->outbuf, sz);
+	memset(rb->spillbuf + rb->spilllen + sz, 0, MAXALIGN(sz) - sz);
+	rb->spilllen += MAXALIGN(sz);
 
-		/* if write didn't set errno, assume problem is no disk space */
-		errno = save_errno ? save_errno : ENOSPC;
-		ereport(ERROR,
-				(errcode_for_file_access(),
-				 errmsg("could not write to data file for XID %u: %m",
-						txn->xid)));
-	}
-	pgstat_report_wait_end();
+	if (rb->spilllen >= SPILL_BLOCK_SIZE)
+		ReorderBufferSerializeBlock(rb, txn, fd);
 
 	/*
 	 * Keep the transaction's final_lsn up to date with each change we send to
@@ -3373,8 +3545,6 @@ ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 	 */
 	if (txn->final_lsn < change->lsn)
 		txn->final_lsn = change->lsn;
-
-	Assert(ondisk->change.action == change->action);
 }
 
 /* Returns true, if the output plugin supports streaming, false, otherwise. */
@@ -3614,10 +3784,16 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 
 	XLByteToSeg(txn->final_lsn, last_segno, wal_segment_size);
 
+	/*
+	 * Blocks are restored as a whole, so we may overshoot
+	 * max_changes_in_memory by up to a block's worth of changes.
+	 */
 	while (restored < max_changes_in_memory && *segno <= last_segno)
 	{
 		int			readBytes;
-		ReorderBufferDiskChange *ondisk;
+		ReorderBufferDiskBlock block;
+		char	   *data;
+		Size		off;
 
 		if (*fd == -1)
 		{
@@ -3655,13 +3831,12 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 		}
 
 		/*
-		 * Read the statically sized part of a change which has information
-		 * about the total size. If we couldn't read a record, we're at the
-		 * end of this file.
+		 * Read the header of the next block of changes, which has information
+		 * about its size. If we couldn't read one, we're at the end of this
+		 * file.
 		 */
-		ReorderBufferSerializeReserve(rb, sizeof(ReorderBufferDiskChange));
-		readBytes = FileRead(file->vfd, rb->outbuf,
-							 sizeof(ReorderBufferDiskChange),
+		readBytes = FileRead(file->vfd, (char *) &block,
+							 sizeof(ReorderBufferDiskBlock),
 							 file->curOffset, WAIT_EVENT_REORDER_BUFFER_READ);
 
 		/* eof */
@@ -3676,46 +3851,61 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 			ereport(ERROR,
 					(errcode_for_file_access(),
 					 errmsg("could not read from reorderbuffer spill file: %m")));
-		else if (readBytes != sizeof(ReorderBufferDiskChange))
+		else if (readBytes != sizeof(ReorderBufferDiskBlock))
 			ereport(ERROR,
 					(errcode_for_file_access(),
 					 errmsg("could not read from reorderbuffer spill file: read %d instead of %u bytes",
 							readBytes,
-							(uint32) sizeof(ReorderBufferDiskChange))));
+							(uint32) sizeof(ReorderBufferDiskBlock))));
 
 		file->curOffset += readBytes;
 
-		ondisk = (ReorderBufferDiskChange *) rb->outbuf;
-
-		ReorderBufferSerializeReserve(rb,
-									  sizeof(ReorderBufferDiskChange) + ondisk->size);
-		ondisk = (ReorderBufferDiskChange *) rb->outbuf;
+		/* Read compressed data into the output buffer, to decompress it. */
+		if (block.method == SPILL_COMPRESSION_NONE)
+		{
+			ReorderBufferSpillReserve(rb, block.size);
+			data = rb->spillbuf;
+		}
+		else
+		{
+			ReorderBufferSerializeReserve(rb, block.size);
+			data = rb->outbuf;
+		}
 
-		readBytes = FileRead(file->vfd,
-							 rb->outbuf + sizeof(ReorderBufferDiskChange),
-							 ondisk->size - sizeof(ReorderBufferDiskChange),
-							 file->curOffset,
+		readBytes = FileRead(file->vfd, data, block.size, file->curOffset,
 							 WAIT_EVENT_REORDER_BUFFER_READ);
 
 		if (readBytes < 0)
 			ereport(ERROR,
 					(errcode_for_file_access(),
 					 errmsg("could not read from reorderbuffer spill file: %m")));
-		else if (readBytes != ondisk->size - sizeof(ReorderBufferDiskChange))
+		else if (readBytes != block.size)
 			ereport(ERROR,
 					(errcode_for_file_access(),
 					 errmsg("could not read from reorderbuffer spill file: read %d instead of %u bytes",
-							readBytes,
-							(uint32) (ondisk->size - sizeof(ReorderBufferDiskChange)))));
+							readBytes, block.size)));
 
 		file->curOffset += readBytes;
 
+		if (block.method != SPILL_COMPRESSION_NONE)
+		{
+			ReorderBufferSpillReserve(rb, block.rawsize);
+			ReorderBufferDecompressBlock(&block, rb->outbuf, rb->spillbuf);
+		}
+
 		/*
-		 * ok, read a full change from disk, now restore it into proper
-		 * in-memory format
+		 * ok, read a full block from disk, now restore its changes into
+		 * proper in-memory format
 		 */
-		ReorderBufferRestoreChange(rb, txn, rb->outbuf);
-		restored++;
+		for (off = 0; off < block.rawsize;)
+		{
+			ReorderBufferDiskChange *ondisk;
+
+			ondisk = (ReorderBufferDiskChange *) (rb->spillbuf + off);
+			ReorderBufferRestoreChange(rb, txn, rb->spillbuf + off);
+			off += MAXALIGN(ondisk->size);
+			restored++;
+		}
 	}
 
 	return restored;
@@ -4238,7 +4428,7 @@ ReorderBufferToastReplace(ReorderBuffer *rb, ReorderBufferTXN *txn,
 				   VARSIZE(chunk) - VARHDRSZ);
 			data_done += VARSIZE(chunk) - VARHDRSZ;
 		}
-		Assert(data_done == toast_pointer.va_extsize);
+		Assert(data_done == VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer));
 
 		/* make sure its marked as compressed or not */
 		if (VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer))
@@ -86,11 +86,13 @@
 #include "postgres.h"
 
 #include "access/table.h"
+#include "access/transam.h"
 #include "access/xact.h"
 #include "catalog/pg_subscription_rel.h"
 #include "catalog/pg_type.h"
 #include "commands/copy.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
 #include "parser/parse_relation.h"
 #include "pgstat.h"
 #include "replication/logicallauncher.h"
@@ -98,12 +100,14 @@
 #include "replication/walreceiver.h"
 #include "replication/worker_internal.h"
 #include "storage/ipc.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/snapmgr.h"
 
 static bool table_states_valid = false;
+static List *table_states = NIL;
 
 StringInfo	copybuf = NULL;
 
@@ -324,7 +328,6 @@ process_syncing_tables_for_apply(XLogRecPtr current_lsn)
 		Oid			relid;
 		TimestampTz last_start_time;
 	};
-	static List *table_states = NIL;
 	static HTAB *last_start_times = NULL;
 	ListCell   *lc;
 	bool		started_tx = false;
@@ -507,7 +510,8 @@ process_syncing_tables_for_apply(XLogRecPtr current_lsn)
 												 MySubscription->oid,
 												 MySubscription->name,
 												 MyLogicalRepWorker->userid,
-												 rstate->relid);
+												 rstate->relid,
+												 DSM_HANDLE_INVALID);
 						hentry->last_start_time = now;
 					}
 				}
@@ -534,6 +538,68 @@ process_syncing_tables(XLogRecPtr current_lsn)
 		process_syncing_tables_for_apply(current_lsn);
 }
 
+/*
+ * Are all tables of the subscription known to be in READY state?
+ *
+ * This only consults the state tracked by process_syncing_tables(), and
+ * answers false whenever that has been invalidated and not rebuilt yet.
+ */
+bool
+AllTablesyncsReady(void)
+{
+	ListCell   *lc;
+
+	if (!table_states_valid)
+		return false;
+
+	foreach(lc, table_states)
+	{
+		SubscriptionRelState *rstate = (SubscriptionRelState *) lfirst(lc);
+
+		if (rstate->state != SUBREL_STATE_READY)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Can the initial contents of the table be copied in binary format?
+ *
+ * The binary representation of a type is only known to be the same on both
+ * sides for built-in types, so that requires the binary option of the
+ * subscription, and every column to have the same built-in type locally as
+ * on the publisher.
+ */
+static bool
+copy_table_binary_ok(LogicalRepRelMapEntry *rel)
+{
+	TupleDesc	desc = RelationGetDescr(rel->localrel);
+	int			nmapped = 0;
+	int			i;
+
+	if (!MySubscription->binary)
+		return false;
+
+	for (i = 0; i < desc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(desc, i);
+		int			remoteattnum = rel->attrmap->attnums[i];
+
+		if (att->attisdropped || att->attgenerated || remoteattnum < 0)
+			continue;
+
+		if (att->atttypid >= FirstNormalObjectId ||
+			att->atttypid != rel->remoterel.atttyps[remoteattnum])
+			return false;
+
+		nmapped++;
+	}
+
+	/* COPY FROM complains about the missing columns otherwise. */
+	return nmapped == rel->remoterel.natts;
+}
+
 /*
  * Create list of columns for COPY based on logical relation mapping.
  */
@@ -631,18 +697,31 @@ copy_read_data(void *outbuf, int minread, int maxread)
 /*
  * Get information about remote relation in similar fashion the RELATION
  * message provides during replication.
+ *
+ * Only the columns published by the subscribed publications are included.
+ * The row filters of those publications are returned in *qual, as a list of
+ * SQL expressions any one of which a row must satisfy; NIL means that all
+ * rows are published.  *all_columns is set to false if some columns of the
+ * table are not published.
  */
 static void
 fetch_remote_table_info(char *nspname, char *relname,
-						LogicalRepRelation *lrel)
+						LogicalRepRelation *lrel, List **qual,
+						bool *all_columns)
 {
 	WalRcvExecResult *res;
 	StringInfoData cmd;
 	TupleTableSlot *slot;
 	Oid			tableRow[] = {OIDOID, CHAROID, CHAROID};
 	Oid			attrRow[] = {TEXTOID, OIDOID, INT4OID, BOOLOID};
+	Oid			filterRow[] = {TEXTARRAYOID, TEXTOID};
 	bool		isnull;
 	int			natt;
+	List	   *columns = NIL;
+	bool		all_rows = false;
+
+	*qual = NIL;
+	*all_columns = true;
 
 	lrel->nspname = nspname;
 	lrel->relname = relname;
@@ -680,6 +759,89 @@ fetch_remote_table_info(char *nspname, char *relname,
 	ExecDropSingleTupleTableSlot(slot);
 	walrcv_clear_result(res);
 
+	/*
+	 * Fetch the column lists and row filters of the publications, which may
+	 * be attached to the table itself or to one of its ancestors.  Older
+	 * servers have neither.
+	 */
+	if (walrcv_server_version(wrconn) >= 140000)
+	{
+		ListCell   *lc;
+		bool		first = true;
+
+		*all_columns = false;
+
+		resetStringInfo(&cmd);
+		appendStringInfo(&cmd,
+						 "SELECT (SELECT pg_catalog.array_agg(a.attname::pg_catalog.text)"
+						 "          FROM pg_catalog.pg_attribute a"
+						 "         WHERE a.attrelid = pr.prrelid"
+						 "           AND a.attnum = ANY(pr.prattrs)),"
+						 "       pg_catalog.pg_get_expr(pr.prqual, pr.prrelid)"
+						 "  FROM pg_catalog.pg_publication p"
+						 "  LEFT JOIN pg_catalog.pg_publication_rel pr"
+						 "       ON (pr.prpubid = p.oid AND pr.prrelid IN"
+						 "           (SELECT relid FROM pg_catalog.pg_partition_ancestors(%u)))"
+						 " WHERE (p.puballtables OR pr.prrelid IS NOT NULL)"
+						 "   AND p.pubname IN (",
+						 lrel->remoteid);
+		foreach(lc, MySubscription->publications)
+		{
+			if (!first)
+				appendStringInfoString(&cmd, ", ");
+			appendStringInfoString(&cmd, quote_literal_cstr(strVal(lfirst(lc))));
+			first = false;
+		}
+		appendStringInfoChar(&cmd, ')');
+
+		res = walrcv_exec(wrconn, cmd.data, lengthof(filterRow), filterRow);
+
+		if (res->status != WALRCV_OK_TUPLES)
+			ereport(ERROR,
+					(errmsg("could not fetch row filters for table \"%s.%s\" from publisher: %s",
+							nspname, relname, res->err)));
+
+		slot = MakeSingleTupleTableSlot(res->tupledesc, &TTSOpsMinimalTuple);
+		while (tuplestore_gettupleslot(res->tuplestore, true, false, slot))
+		{
+			Datum		value;
+
+			value = slot_getattr(slot, 1, &isnull);
+			if (isnull)
+				*all_columns = true;
+			else if (!*all_columns)
+			{
+				Datum	   *elems;
+				int			nelems;
+				int			i;
+
+				deconstruct_array(DatumGetArrayTypeP(value), TEXTOID, -1,
+								  false, TYPALIGN_INT, &elems, NULL, &nelems);
+				for (i = 0; i < nelems; i++)
+				{
+					Value	   *colname = makeString(TextDatumGetCString(elems[i]));
+
+					if (!list_member(columns, colname))
+						columns = lappend(columns, colname);
+				}
+			}
+
+			value = slot_getattr(slot, 2, &isnull);
+			if (isnull)
+				all_rows = true;
+			else if (!all_rows)
+				*qual = lappend(*qual, TextDatumGetCString(value));
+
+			ExecClearTuple(slot);
+		}
+		ExecDropSingleTupleTableSlot(slot);
+
+		walrcv_clear_result(res);
+
+		if (all_rows)
+			*qual = NIL;
+	}
+
 	/* Now fetch columns. */
 	resetStringInfo(&cmd);
 	appendStringInfo(&cmd,
@@ -716,6 +878,15 @@ fetch_remote_table_info(char *nspname, char *relname,
 		lrel->attnames[natt] =
 			TextDatumGetCString(slot_getattr(slot, 1, &isnull));
 		Assert(!isnull);
+
+		/* Skip the columns that are not published. */
+		if (!*all_columns &&
+			!list_member(columns, makeString(lrel->attnames[natt])))
+		{
+			ExecClearTuple(slot);
+			continue;
+		}
+
 		lrel->atttyps[natt] = DatumGetObjectId(slot_getattr(slot, 2, &isnull));
 		Assert(!isnull);
 		if (DatumGetBool(slot_getattr(slot, 4, &isnull)))
@@ -750,11 +921,16 @@ copy_table(Relation rel)
 	StringInfoData cmd;
 	CopyState	cstate;
 	List	   *attnamelist;
+	List	   *options = NIL;
+	List	   *qual;
+	bool		all_columns;
 	ParseState *pstate;
+	bool		binary;
 
 	/* Get the publisher relation info. */
 	fetch_remote_table_info(get_namespace_name(RelationGetNamespace(rel)),
-							RelationGetRelationName(rel), &lrel);
+							RelationGetRelationName(rel), &lrel, &qual,
+							&all_columns);
 
 	/* Put the relation into relmap. */
 	logicalrep_relmap_update(&lrel);
@@ -763,16 +939,20 @@ copy_table(Relation rel)
 	relmapentry = logicalrep_rel_open(lrel.remoteid, NoLock);
 	Assert(rel == relmapentry->localrel);
 
+	binary = copy_table_binary_ok(relmapentry);
+
 	/* Start copy on the publisher. */
 	initStringInfo(&cmd);
-	if (lrel.relkind == RELKIND_RELATION)
+	if (lrel.relkind == RELKIND_RELATION && qual == NIL && all_columns)
 		appendStringInfo(&cmd, "COPY %s TO STDOUT",
 						 quote_qualified_identifier(lrel.nspname, lrel.relname));
 	else
 	{
 		/*
 		 * For non-tables, we need to do COPY (SELECT ...), but we can't just
-		 * do SELECT * because we need to not copy generated columns.
+		 * do SELECT * because we need to not copy generated columns.  The
+		 * same goes for tables with a column list or row filter, which are
+		 * applied by the SELECT.
 		 */
 		appendStringInfo(&cmd, "COPY (SELECT ");
 		for (int i = 0; i < lrel.natts; i++)
@@ -781,9 +961,25 @@ copy_table(Relation rel)
 			if (i < lrel.natts - 1)
 				appendStringInfoString(&cmd, ", ");
 		}
-		appendStringInfo(&cmd, " FROM %s) TO STDOUT",
+		appendStringInfo(&cmd, " FROM %s%s",
+						 lrel.relkind == RELKIND_RELATION ? "ONLY " : "",
 						 quote_qualified_identifier(lrel.nspname, lrel.relname));
+		if (qual != NIL)
+		{
+			ListCell   *lc;
+
+			appendStringInfoString(&cmd, " WHERE ");
+			foreach(lc, qual)
+			{
+				if (lc != list_head(qual))
+					appendStringInfoString(&cmd, " OR ");
+				appendStringInfo(&cmd, "(%s)", (char *) lfirst(lc));
+			}
+		}
+		appendStringInfoString(&cmd, ") TO STDOUT");
 	}
+	if (binary)
+		appendStringInfoString(&cmd, " WITH (FORMAT binary)");
 	res = walrcv_exec(wrconn, cmd.data, 0, NULL);
 	pfree(cmd.data);
 	if (res->status != WALRCV_OK_COPY_OUT)
@@ -799,7 +995,10 @@ copy_table(Relation rel)
 										 NULL, false, false);
 
 	attnamelist = make_copy_attnamelist(relmapentry);
-	cstate = BeginCopyFrom(pstate, rel, NULL, false, copy_read_data, attnamelist, NIL);
+	if (binary)
+		options = list_make1(makeDefElem("format",
+										 (Node *) makeString("binary"), -1));
+	cstate = BeginCopyFrom(pstate, rel, NULL, false, copy_read_data, attnamelist, options);
 
 	/* Do the copy */
 	(void) CopyFrom(cstate);
@@ -13,7 +13,8 @@
  *
  *	  The main worker (apply) is started by logical replication worker
  *	  launcher for every enabled subscription in a database. It uses
- *	  walsender protocol to communicate with publisher.
+ *	  walsender protocol to communicate with publisher.  It may hand whole
+ *	  transactions on to parallel apply workers, see applyparallel.c.
  *
  *	  This module includes server facing code and shares libpqwalreceiver
  *	  module with walreceiver for providing the libpq specific functionality.
@@ -99,7 +100,7 @@ typedef struct SlotErrCallbackArg
 	int			remote_attnum;
 } SlotErrCallbackArg;
 
-static MemoryContext ApplyMessageContext = NULL;
+MemoryContext ApplyMessageContext = NULL;
 MemoryContext ApplyContext = NULL;
 
 WalReceiverConn *wrconn = NULL;
@@ -112,10 +113,6 @@ static XLogRecPtr remote_final_lsn = InvalidXLogRecPtr;
 
 static void send_feedback(XLogRecPtr recvpos, bool force, bool requestReply);
 
-static void store_flush_position(XLogRecPtr remote_lsn);
-
-static void maybe_reread_subscription(void);
-
 static void apply_handle_insert_internal(ResultRelInfo *relinfo,
 										 EState *estate, TupleTableSlot *remoteslot);
 static void apply_handle_update_internal(ResultRelInfo *relinfo,
@@ -573,6 +570,10 @@ apply_handle_commit(StringInfo s)
 
 	Assert(commit_data.commit_lsn == remote_final_lsn);
 
+	/* Parallel apply workers commit in the order of the remote commits. */
+	if (am_parallel_apply_worker())
+		pa_wait_for_turn();
+
 	/* The synchronization worker runs in single transaction. */
 	if (IsTransactionState() && !am_tablesync_worker())
 	{
@@ -586,10 +587,16 @@ apply_handle_commit(StringInfo s)
 		CommitTransactionCommand();
 		pgstat_report_stat(false);
 
-		store_flush_position(commit_data.end_lsn);
+		if (am_parallel_apply_worker())
+			pa_commit_done(commit_data.end_lsn, XactLastCommitEnd);
+		else
+			store_flush_position(commit_data.end_lsn, XactLastCommitEnd);
 	}
 	else
 	{
+		if (am_parallel_apply_worker())
+			pa_commit_done(commit_data.end_lsn, InvalidXLogRecPtr);
+
 		/* Process any invalidation messages that might have accumulated. */
 		AcceptInvalidationMessages();
 		maybe_reread_subscription();
@@ -598,7 +605,8 @@ apply_handle_commit(StringInfo s)
 	in_remote_transaction = false;
 
 	/* Process any tables that are being synchronized in parallel. */
-	process_syncing_tables(commit_data.end_lsn);
+	if (!am_parallel_apply_worker())
+		process_syncing_tables(commit_data.end_lsn);
 
 	pgstat_report_activity(STATE_IDLE, NULL);
 }
@@ -1415,7 +1423,7 @@ apply_handle_truncate(StringInfo s)
 /*
  * Logical replication protocol message dispatcher.
  */
-static void
+void
 apply_dispatch(StringInfo s)
 {
 	char		action = pq_getmsgbyte(s);
@@ -1520,10 +1528,10 @@ get_flush_position(XLogRecPtr *write, XLogRecPtr *flush,
 }
 
 /*
- * Store current remote/local lsn pair in the tracking list.
+ * Store given remote/local lsn pair in the tracking list.
  */
-static void
-store_flush_position(XLogRecPtr remote_lsn)
+void
+store_flush_position(XLogRecPtr remote_lsn, XLogRecPtr local_lsn)
 {
 	FlushPosition *flushpos;
 
@@ -1532,7 +1540,7 @@ store_flush_position(XLogRecPtr remote_lsn)
 
 	/* Track commit lsn  */
 	flushpos = (FlushPosition *) palloc(sizeof(FlushPosition));
-	flushpos->local_end = XactLastCommitEnd;
+	flushpos->local_end = local_lsn;
 	flushpos->remote_end = remote_lsn;
 
 	dlist_push_tail(&lsn_mapping, &flushpos->node);
@@ -1644,7 +1652,8 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 
 						UpdateWorkerStats(last_received, send_time, false);
 
-						apply_dispatch(&s);
+						if (!pa_handle_message(&s))
+							apply_dispatch(&s);
 					}
 					else if (c == 'k')
 					{
@@ -1706,9 +1715,10 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 		 * wake up after WalWriterDelay to see if they've been flushed yet (in
 		 * which case we should send a feedback message).  Otherwise, there's
 		 * no particular urgency about waking up unless we get data or a
-		 * signal.
+		 * signal.  Transactions handed to parallel apply workers count as
+		 * unflushed until they have committed.
 		 */
-		if (!dlist_is_empty(&lsn_mapping))
+		if (!dlist_is_empty(&lsn_mapping) || pa_have_inflight())
 			wait_time = WalWriterDelay;
 		else
 			wait_time = NAPTIME_PER_CYCLE;
@@ -1813,13 +1823,17 @@ send_feedback(XLogRecPtr recvpos, bool force, bool requestReply)
 	if (recvpos < last_recvpos)
 		recvpos = last_recvpos;
 
+	/* Pick up the commits of parallel apply workers. */
+	pa_report_progress();
+
 	get_flush_position(&writepos, &flushpos, &have_pending_txes);
 
 	/*
 	 * No outstanding transactions to flush, we can report the latest received
-	 * position. This is important for synchronous replication.
+	 * position. This is important for synchronous replication.  That does
+	 * not hold while parallel apply workers have yet to commit some.
 	 */
-	if (!have_pending_txes)
+	if (!have_pending_txes && !pa_have_inflight())
 		flushpos = writepos = recvpos;
 
 	if (writepos < last_writepos)
@@ -1876,7 +1890,7 @@ send_feedback(XLogRecPtr recvpos, bool force, bool requestReply)
 /*
  * Reread subscription info if needed. Most changes will be exit.
  */
-static void
+void
 maybe_reread_subscription(void)
 {
 	MemoryContext oldctx;
@@ -1979,36 +1993,15 @@ subscription_change_cb(Datum arg, int cacheid, uint32 hashvalue)
 	MySubscriptionValid = false;
 }
 
-/* Logical Replication Apply worker entry point */
+/*
+ * Common initialization of apply workers and parallel apply workers: connect
+ * to the database and load the subscription.  The caller has attached to its
+ * worker slot already.
+ */
 void
-ApplyWorkerMain(Datum main_arg)
+InitializeApplyWorker(void)
 {
-	int			worker_slot = DatumGetInt32(main_arg);
 	MemoryContext oldctx;
-	char		originname[NAMEDATALEN];
-	XLogRecPtr	origin_startpos;
-	char	   *myslotname;
-	WalRcvStreamOptions options;
-
-	/* Attach to slot */
-	logicalrep_worker_attach(worker_slot);
-
-	/* Setup signal handling */
-	pqsignal(SIGHUP, SignalHandlerForConfigReload);
-	pqsignal(SIGTERM, die);
-	BackgroundWorkerUnblockSignals();
-
-	/*
-	 * We don't currently need any ResourceOwner in a walreceiver process, but
-	 * if we did, we could call CreateAuxProcessResourceOwner here.
-	 */
-
-	/* Initialise stats to a sanish value */
-	MyLogicalRepWorker->last_send_time = MyLogicalRepWorker->last_recv_time =
-		MyLogicalRepWorker->reply_time = GetCurrentTimestamp();
-
-	/* Load the libpq-specific functions */
-	load_file("libpqwalreceiver", false);
 
 	/* Run as replica session replication role. */
 	SetConfigOption("session_replication_role", "replica",
@@ -2068,12 +2061,50 @@ ApplyWorkerMain(Datum main_arg)
 		ereport(LOG,
 				(errmsg("logical replication table synchronization worker for subscription \"%s\", table \"%s\" has started",
 						MySubscription->name, get_rel_name(MyLogicalRepWorker->relid))));
+	else if (am_parallel_apply_worker())
+		ereport(LOG,
+				(errmsg("logical replication parallel apply worker for subscription \"%s\" has started",
+						MySubscription->name)));
 	else
 		ereport(LOG,
 				(errmsg("logical replication apply worker for subscription \"%s\" has started",
 						MySubscription->name)));
 
 	CommitTransactionCommand();
+}
+
+/* Logical Replication Apply worker entry point */
+void
+ApplyWorkerMain(Datum main_arg)
+{
+	int			worker_slot = DatumGetInt32(main_arg);
+	MemoryContext oldctx;
+	char		originname[NAMEDATALEN];
+	XLogRecPtr	origin_startpos;
+	char	   *myslotname;
+	WalRcvStreamOptions options;
+
+	/* Attach to slot */
+	logicalrep_worker_attach(worker_slot);
+
+	/* Setup signal handling */
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/*
+	 * We don't currently need any ResourceOwner in a walreceiver process, but
+	 * if we did, we could call CreateAuxProcessResourceOwner here.
+	 */
+
+	/* Initialise stats to a sanish value */
+	MyLogicalRepWorker->last_send_time = MyLogicalRepWorker->last_recv_time =
+		MyLogicalRepWorker->reply_time = GetCurrentTimestamp();
+
+	/* Load the libpq-specific functions */
+	load_file("libpqwalreceiver", false);
+
+	InitializeApplyWorker();
 
 	/* Connect to the origin and start the replication. */
 	elog(DEBUG1, "connecting to publisher using connection string \"%s\"",
@@ -2111,13 +2142,19 @@ ApplyWorkerMain(Datum main_arg)
 			ereport(ERROR,
 					(errmsg("subscription has no replication slot set")));
 
+		/*
+		 * Parallel apply workers of a previous apply worker may still be
+		 * about to commit; let them go before reading our start position.
+		 */
+		logicalrep_pa_workers_wait_for_exit(MySubscription->oid);
+
 		/* Setup replication origin tracking. */
 		StartTransactionCommand();
 		snprintf(originname, sizeof(originname), "pg_%u", MySubscription->oid);
 		originid = replorigin_by_name(originname, true);
 		if (!OidIsValid(originid))
 			originid = replorigin_create(originname);
-		replorigin_session_setup(originid);
+		replorigin_session_setup(originid, 0);
 		replorigin_session_origin = originid;
 		origin_startpos = replorigin_session_get_progress(false);
 		CommitTransactionCommand();
@@ -12,15 +12,24 @@
  */
 #include "postgres.h"
 
+#include "access/attmap.h"
+#include "access/sysattr.h"
 #include "access/tupconvert.h"
 #include "catalog/partition.h"
 #include "catalog/pg_publication.h"
+#include "catalog/pg_publication_rel.h"
 #include "commands/defrem.h"
+#include "executor/executor.h"
 #include "fmgr.h"
+#include "nodes/makefuncs.h"
+#include "optimizer/optimizer.h"
+#include "parser/parse_coerce.h"
+#include "rewrite/rewriteManip.h"
 #include "replication/logical.h"
 #include "replication/logicalproto.h"
 #include "replication/origin.h"
 #include "replication/pgoutput.h"
+#include "utils/builtins.h"
 #include "utils/int8.h"
 #include "utils/inval.h"
 #include "utils/lsyscache.h"
@@ -49,11 +58,13 @@ static bool pgoutput_origin_filter(LogicalDecodingContext *ctx,
 								   RepOriginId origin_id);
 
 static bool publications_valid;
+static bool publication_callback_registered = false;
 
 static List *LoadPublications(List *pubnames);
 static void publication_invalidation_cb(Datum arg, int cacheid,
 										uint32 hashvalue);
-static void send_relation_and_attrs(Relation relation, LogicalDecodingContext *ctx);
+static void send_relation_and_attrs(Relation relation, LogicalDecodingContext *ctx,
+									Bitmapset *columns);
 
 /*
  * Entry in the map used to remember which relation schemas we sent.
@@ -89,13 +100,31 @@ typedef struct RelationSyncEntry
 	 * having identical TupleDesc.
 	 */
 	TupleConversionMap *map;
+
+	/*
+	 * Row filter and column list, combined over all the publications that
+	 * publish the relation, and expressed in terms of publish_as_relid's
+	 * attribute numbers.  'exprstate' is NULL if all rows are published and
+	 * 'columns' is NULL if all columns are.  These are allocated in
+	 * 'filter_cxt' and rebuilt whenever 'replicate_valid' is reset.
+	 */
+	MemoryContext filter_cxt;
+	EState	   *estate;
+	ExprState  *exprstate;
+	TupleTableSlot *scanslot;
+	Bitmapset  *qualattrs;		/* attributes the row filter references */
+	Bitmapset  *columns;
 } RelationSyncEntry;
 
 /* Map used to remember which relation schemas we sent. */
 static HTAB *RelationSyncCache = NULL;
+static bool relation_callbacks_registered = false;
 
 static void init_rel_sync_cache(MemoryContext decoding_context);
 static RelationSyncEntry *get_rel_sync_entry(PGOutputData *data, Oid relid);
+static void build_rel_sync_filter(RelationSyncEntry *entry, List *pubids,
+								  List *srcrelids);
+static bool pgoutput_row_filter(RelationSyncEntry *entry, HeapTuple tuple);
 static void rel_sync_cache_relation_cb(Datum arg, Oid relid);
 static void rel_sync_cache_publication_cb(Datum arg, int cacheid,
 										  uint32 hashvalue);
@@ -237,12 +266,20 @@ pgoutput_startup(LogicalDecodingContext *ctx, OutputPluginOptions *opt,
 					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 					 errmsg("publication_names parameter missing")));
 
-		/* Init publication state. */
+		/*
+		 * Init publication state.  The output plugin may be restarted within
+		 * the same session, and callbacks can't be unregistered, so only
+		 * register ours once.
+		 */
 		data->publications = NIL;
 		publications_valid = false;
-		CacheRegisterSyscacheCallback(PUBLICATIONOID,
-									  publication_invalidation_cb,
-									  (Datum) 0);
+		if (!publication_callback_registered)
+		{
+			CacheRegisterSyscacheCallback(PUBLICATIONOID,
+										  publication_invalidation_cb,
+										  (Datum) 0);
+			publication_callback_registered = true;
+		}
 
 		/* Initialize relation schema cache. */
 		init_rel_sync_cache(CacheMemoryContext);
@@ -323,19 +360,22 @@ maybe_send_schema(LogicalDecodingContext *ctx,
 		relentry->map = convert_tuples_by_name(CreateTupleDescCopy(indesc),
 											   CreateTupleDescCopy(outdesc));
 		MemoryContextSwitchTo(oldctx);
-		send_relation_and_attrs(ancestor, ctx);
+		send_relation_and_attrs(ancestor, ctx, relentry->columns);
 		RelationClose(ancestor);
+		send_relation_and_attrs(relation, ctx, NULL);
 	}
+	else
+		send_relation_and_attrs(relation, ctx, relentry->columns);
 
-	send_relation_and_attrs(relation, ctx);
 	relentry->schema_sent = true;
 }
 
 /*
- * Sends a relation
+ * Sends a relation, limited to the given columns unless that is NULL
  */
 static void
-send_relation_and_attrs(Relation relation, LogicalDecodingContext *ctx)
+send_relation_and_attrs(Relation relation, LogicalDecodingContext *ctx,
+						Bitmapset *columns)
 {
 	TupleDesc	desc = RelationGetDescr(relation);
 	int			i;
@@ -355,6 +395,9 @@ send_relation_and_attrs(Relation relation, LogicalDecodingContext *ctx)
 		if (att->attisdropped || att->attgenerated)
 			continue;
 
+		if (columns != NULL && !bms_is_member(att->attnum, columns))
+			continue;
+
 		if (att->atttypid < FirstGenbkiObjectId)
 			continue;
 
@@ -364,10 +407,60 @@ send_relation_and_attrs(Relation relation, LogicalDecodingContext *ctx)
 	}
 
 	OutputPluginPrepareWrite(ctx, false);
-	logicalrep_write_rel(ctx->out, relation);
+	logicalrep_write_rel(ctx->out, relation, columns);
 	OutputPluginWrite(ctx, false);
 }
 
+/*
+ * Does the tuple pass the relation's row filter?
+ *
+ * The tuple must already be in publish_as_relid's format.  A filter that
+ * would need to read an unchanged TOASTed value can't be evaluated during
+ * decoding, so such rows are published.
+ */
+static bool
+pgoutput_row_filter(RelationSyncEntry *entry, HeapTuple tuple)
+{
+	ExprContext *econtext;
+	Datum		ret;
+	bool		isnull;
+	int			attnum;
+
+	if (entry->exprstate == NULL)
+		return true;
+
+	ExecStoreHeapTuple(tuple, entry->scanslot, false);
+
+	attnum = -1;
+	while ((attnum = bms_next_member(entry->qualattrs, attnum)) >= 0)
+	{
+		Form_pg_attribute att;
+		Datum		value;
+
+		if (attnum > entry->scanslot->tts_tupleDescriptor->natts)
+			continue;
+
+		att = TupleDescAttr(entry->scanslot->tts_tupleDescriptor, attnum - 1);
+		value = slot_getattr(entry->scanslot, attnum, &isnull);
+		if (!isnull && att->attlen == -1 &&
+			VARATT_IS_EXTERNAL_ONDISK(value))
+		{
+			ExecClearTuple(entry->scanslot);
+			return true;
+		}
+	}
+
+	econtext = GetPerTupleExprContext(entry->estate);
+	econtext->ecxt_scantuple = entry->scanslot;
+
+	ret = ExecEvalExprSwitchContext(entry->exprstate, econtext, &isnull);
+
+	ExecClearTuple(entry->scanslot);
+	ResetPerTupleExprContext(entry->estate);
+
+	return !isnull && DatumGetBool(ret);
+}
+
 /*
  * Sends the decoded DML over wire.
  */
@@ -425,9 +518,12 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 						tuple = execute_attr_map_tuple(tuple, relentry->map);
 				}
 
+				if (!pgoutput_row_filter(relentry, tuple))
+					break;
+
 				OutputPluginPrepareWrite(ctx, true);
 				logicalrep_write_insert(ctx->out, relation, tuple,
-										data->binary);
+										data->binary, relentry->columns);
 				OutputPluginWrite(ctx, true);
 				break;
 			}
@@ -436,6 +532,8 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 				HeapTuple	oldtuple = change->data.tp.oldtuple ?
 				&change->data.tp.oldtuple->tuple : NULL;
 				HeapTuple	newtuple = &change->data.tp.newtuple->tuple;
+				bool		old_matches;
+				bool		new_matches;
 
 				/* Switch relation if publishing via root. */
 				if (relentry->publish_as_relid != RelationGetRelid(relation))
@@ -450,9 +548,31 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 					}
 				}
 
+				/*
+				 * Apply the row filter to both versions of the row.  Without
+				 * an old tuple the replica identity didn't change, and that's
+				 * all a filter of a publication of UPDATEs may look at.  A
+				 * row that moves out of the filtered set is deleted on the
+				 * subscriber, one that moves into it is inserted.
+				 */
+				new_matches = pgoutput_row_filter(relentry, newtuple);
+				old_matches = oldtuple ?
+					pgoutput_row_filter(relentry, oldtuple) : new_matches;
+
+				if (!old_matches && !new_matches)
+					break;
+
 				OutputPluginPrepareWrite(ctx, true);
-				logicalrep_write_update(ctx->out, relation, oldtuple, newtuple,
-										data->binary);
+				if (old_matches && new_matches)
+					logicalrep_write_update(ctx->out, relation, oldtuple,
+											newtuple, data->binary,
+											relentry->columns);
+				else if (old_matches)
+					logicalrep_write_delete(ctx->out, relation, oldtuple,
+											data->binary, relentry->columns);
+				else
+					logicalrep_write_insert(ctx->out, relation, newtuple,
+											data->binary, relentry->columns);
 				OutputPluginWrite(ctx, true);
 				break;
 			}
@@ -471,9 +591,12 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 						oldtuple = execute_attr_map_tuple(oldtuple, relentry->map);
 				}
 
+				if (!pgoutput_row_filter(relentry, oldtuple))
+					break;
+
 				OutputPluginPrepareWrite(ctx, true);
 				logicalrep_write_delete(ctx->out, relation, oldtuple,
-										data->binary);
+										data->binary, relentry->columns);
 				OutputPluginWrite(ctx, true);
 			}
 			else
@@ -565,6 +688,17 @@ pgoutput_shutdown(LogicalDecodingContext *ctx)
 {
 	if (RelationSyncCache)
 	{
+		HASH_SEQ_STATUS status;
+		RelationSyncEntry *entry;
+
+		/* Row filters live outside of the hash table's memory. */
+		hash_seq_init(&status, RelationSyncCache);
+		while ((entry = (RelationSyncEntry *) hash_seq_search(&status)) != NULL)
+		{
+			if (entry->filter_cxt)
+				MemoryContextDelete(entry->filter_cxt);
+		}
+
 		hash_destroy(RelationSyncCache);
 		RelationSyncCache = NULL;
 	}
@@ -635,10 +769,15 @@ init_rel_sync_cache(MemoryContext cachectx)
 
 	Assert(RelationSyncCache != NULL);
 
+	/* The cache may be rebuilt, but its callbacks must be registered once. */
+	if (relation_callbacks_registered)
+		return;
+
 	CacheRegisterRelcacheCallback(rel_sync_cache_relation_cb, (Datum) 0);
 	CacheRegisterSyscacheCallback(PUBLICATIONRELMAP,
 								  rel_sync_cache_publication_cb,
 								  (Datum) 0);
+	relation_callbacks_registered = true;
 }
 
 /*
@@ -669,12 +808,24 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 	MemoryContextSwitchTo(oldctx);
 	Assert(entry != NULL);
 
+	if (!found)
+	{
+		entry->filter_cxt = NULL;
+		entry->estate = NULL;
+		entry->exprstate = NULL;
+		entry->scanslot = NULL;
+		entry->qualattrs = NULL;
+		entry->columns = NULL;
+	}
+
 	/* Not found means schema wasn't sent */
 	if (!found || !entry->replicate_valid)
 	{
 		List	   *pubids = GetRelationPublications(relid);
 		ListCell   *lc;
 		Oid			publish_as_relid = relid;
+		List	   *filter_pubids = NIL;
+		List	   *filter_relids = NIL;
 
 		/* Reload publications if needed before use. */
 		if (!publications_valid)
@@ -700,6 +851,7 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 		{
 			Publication *pub = lfirst(lc);
 			bool		publish = false;
+			Oid			filter_relid = InvalidOid;
 
 			if (pub->alltables)
 			{
@@ -711,6 +863,7 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 			if (!publish)
 			{
 				bool		ancestor_published = false;
+				Oid			top_ancestor = InvalidOid;
 
 				/*
 				 * For a partition, check if any of the ancestors are
@@ -735,6 +888,7 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 											pub->oid))
 						{
 							ancestor_published = true;
+							top_ancestor = ancestor;
 							if (pub->pubviaroot)
 								publish_as_relid = ancestor;
 						}
@@ -743,6 +897,16 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 
 				if (list_member_oid(pubids, pub->oid) || ancestor_published)
 					publish = true;
+
+				/*
+				 * Remember whose entry in the publication holds the row
+				 * filter and column list that apply to this relation.
+				 */
+				if (ancestor_published &&
+					(pub->pubviaroot || !list_member_oid(pubids, pub->oid)))
+					filter_relid = top_ancestor;
+				else
+					filter_relid = relid;
 			}
 
 			/*
@@ -757,25 +921,174 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 				entry->pubactions.pubupdate |= pub->pubactions.pubupdate;
 				entry->pubactions.pubdelete |= pub->pubactions.pubdelete;
 				entry->pubactions.pubtruncate |= pub->pubactions.pubtruncate;
-			}
 
-			if (entry->pubactions.pubinsert && entry->pubactions.pubupdate &&
-				entry->pubactions.pubdelete && entry->pubactions.pubtruncate)
-				break;
+				filter_pubids = lappend_oid(filter_pubids, pub->oid);
+				filter_relids = lappend_oid(filter_relids, filter_relid);
+			}
 		}
 
 		list_free(pubids);
 
 		entry->publish_as_relid = publish_as_relid;
-		entry->replicate_valid = true;
-	}
+		build_rel_sync_filter(entry, filter_pubids, filter_relids);
+		list_free(filter_pubids);
+		list_free(filter_relids);
 
-	if (!found)
+		/* The column list may have changed, so send the schema again. */
 		entry->schema_sent = false;
+		entry->replicate_valid = true;
+	}
 
 	return entry;
 }
 
+/*
+ * Build the row filter and column list of a relation sync entry.
+ *
+ * 'pubids' are the publications that publish the relation, and 'srcrelids'
+ * the relations (the relation itself or one of its ancestors) whose entries
+ * in those publications apply, or InvalidOid for FOR ALL TABLES publications.
+ * A row is published if it matches the row filter of any publication, and a
+ * column if any publication's column list includes it; a publication without
+ * a row filter or column list publishes all rows or columns.
+ */
+static void
+build_rel_sync_filter(RelationSyncEntry *entry, List *pubids,
+					  List *srcrelids)
+{
+	Relation	target;
+	List	   *quals = NIL;
+	Bitmapset  *columns = NULL;
+	bool		all_rows = false;
+	bool		all_columns = false;
+	MemoryContext oldctx;
+	ListCell   *lc1,
+			   *lc2;
+
+	/* Throw away the previous filter, if any. */
+	if (entry->filter_cxt)
+		MemoryContextDelete(entry->filter_cxt);
+	entry->filter_cxt = NULL;
+	entry->estate = NULL;
+	entry->exprstate = NULL;
+	entry->scanslot = NULL;
+	entry->qualattrs = NULL;
+	entry->columns = NULL;
+
+	if (pubids == NIL)
+		return;
+
+	entry->filter_cxt = AllocSetContextCreate(CacheMemoryContext,
+											  "logical replication row filter",
+											  ALLOCSET_SMALL_SIZES);
+	oldctx = MemoryContextSwitchTo(entry->filter_cxt);
+
+	target = RelationIdGetRelation(entry->publish_as_relid);
+
+	forboth(lc1, pubids, lc2, srcrelids)
+	{
+		Oid			pubid = lfirst_oid(lc1);
+		Oid			srcrelid = lfirst_oid(lc2);
+		AttrMap    *attrmap = NULL;
+		HeapTuple	tup;
+		Datum		datum;
+		bool		isnull;
+
+		if (!OidIsValid(srcrelid))
+		{
+			all_rows = all_columns = true;
+			break;
+		}
+
+		tup = SearchSysCache2(PUBLICATIONRELMAP, ObjectIdGetDatum(srcrelid),
+							  ObjectIdGetDatum(pubid));
+		if (!HeapTupleIsValid(tup))
+			elog(ERROR, "cache lookup failed for relation %u in publication %u",
+				 srcrelid, pubid);
+
+		/* The entry may belong to an ancestor with different attnums. */
+		if (srcrelid != entry->publish_as_relid)
+		{
+			Relation	srcrel = RelationIdGetRelation(srcrelid);
+
+			attrmap = build_attrmap_by_name(RelationGetDescr(target),
+											RelationGetDescr(srcrel));
+			RelationClose(srcrel);
+		}
+
+		datum = SysCacheGetAttr(PUBLICATIONRELMAP, tup,
+								Anum_pg_publication_rel_prqual, &isnull);
+		if (isnull)
+			all_rows = true;
+		else if (!all_rows)
+		{
+			Node	   *qual = stringToNode(TextDatumGetCString(datum));
+
+			if (attrmap)
+			{
+				bool		found_whole_row;
+
+				qual = map_variable_attnos(qual, 1, 0, attrmap, InvalidOid,
+										   &found_whole_row);
+			}
+			quals = lappend(quals, qual);
+		}
+
+		datum = SysCacheGetAttr(PUBLICATIONRELMAP, tup,
+								Anum_pg_publication_rel_prattrs, &isnull);
+		if (isnull)
+			all_columns = true;
+		else if (!all_columns)
+		{
+			int2vector *attrs = (int2vector *) DatumGetPointer(datum);
+			int			i;
+
+			for (i = 0; i < attrs->dim1; i++)
+			{
+				AttrNumber	attnum = attrs->values[i];
+
+				if (attrmap)
+					attnum = attrmap->attnums[attnum - 1];
+				columns = bms_add_member(columns, attnum);
+			}
+		}
+
+		ReleaseSysCache(tup);
+	}
+
+	if (!all_rows)
+	{
+		Expr	   *expr;
+		Bitmapset  *varattnos = NULL;
+		int			attnum;
+
+		Assert(quals != NIL);
+		expr = list_length(quals) == 1 ? linitial(quals) : make_orclause(quals);
+
+		entry->estate = CreateExecutorState();
+		entry->exprstate = ExecPrepareExpr(expr, entry->estate);
+		entry->scanslot =
+			MakeSingleTupleTableSlot(CreateTupleDescCopy(RelationGetDescr(target)),
+									 &TTSOpsHeapTuple);
+
+		pull_varattnos((Node *) expr, 1, &varattnos);
+		attnum = -1;
+		while ((attnum = bms_next_member(varattnos, attnum)) >= 0)
+		{
+			if (attnum + FirstLowInvalidHeapAttributeNumber > 0)
+				entry->qualattrs =
+					bms_add_member(entry->qualattrs,
+								   attnum + FirstLowInvalidHeapAttributeNumber);
+		}
+	}
+
+	if (!all_columns)
+		entry->columns = columns;
+
+	RelationClose(target);
+	MemoryContextSwitchTo(oldctx);
+}
+
 /*
  * Relcache invalidation callback
  */
@@ -808,10 +1121,14 @@ rel_sync_cache_relation_cb(Datum arg, Oid relid)
 											  HASH_FIND, NULL);
 
 	/*
-	 * Reset schema sent status as the relation definition may have changed.
+	 * Reset schema sent status as the relation definition may have changed,
+	 * and rebuild the row filter against the new definition.
 	 */
 	if (entry != NULL)
+	{
 		entry->schema_sent = false;
+		entry->replicate_valid = false;
+	}
 }
 
 /*
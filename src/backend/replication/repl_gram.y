@@ -89,6 +89,7 @@ static SQLCmd *make_sqlcmd(void);
 %token K_USE_SNAPSHOT
 %token K_MANIFEST
 %token K_MANIFEST_CHECKSUMS
+%token K_COMPRESSION
 
 %type <node>	command
 %type <node>	base_backup start_replication start_logical_replication
@@ -100,7 +101,7 @@ static SQLCmd *make_sqlcmd(void);
 %type <list>	plugin_options plugin_opt_list
 %type <defelt>	plugin_opt_elem
 %type <node>	plugin_opt_arg
-%type <str>		opt_slot var_name
+%type <str>		opt_slot opt_compression var_name
 %type <boolval>	opt_temporary
 %type <list>	create_slot_opt_list
 %type <defelt>	create_slot_opt
@@ -158,7 +159,7 @@ var_name:	IDENT	{ $$ = $1; }
 /*
  * BASE_BACKUP [LABEL '<label>'] [PROGRESS] [FAST] [WAL] [NOWAIT]
  * [MAX_RATE %d] [TABLESPACE_MAP] [NOVERIFY_CHECKSUMS]
- * [MANIFEST %s] [MANIFEST_CHECKSUMS %s]
+ * [MANIFEST %s] [MANIFEST_CHECKSUMS %s] [COMPRESSION %s]
  */
 base_backup:
 			K_BASE_BACKUP base_backup_opt_list
@@ -222,6 +223,11 @@ base_backup_opt:
 				  $$ = makeDefElem("manifest",
 								   (Node *)makeString($2), -1);
 				}
+			| K_COMPRESSION SCONST
+				{
+				  $$ = makeDefElem("compression",
+								   (Node *)makeString($2), -1);
+				}
 			| K_MANIFEST_CHECKSUMS SCONST
 				{
 				  $$ = makeDefElem("manifest_checksums",
@@ -307,9 +313,10 @@ drop_replication_slot:
 
 /*
  * START_REPLICATION [SLOT slot] [PHYSICAL] %X/%X [TIMELINE %d]
+ *		[COMPRESSION method]
  */
 start_replication:
-			K_START_REPLICATION opt_slot opt_physical RECPTR opt_timeline
+			K_START_REPLICATION opt_slot opt_physical RECPTR opt_timeline opt_compression
 				{
 					StartReplicationCmd *cmd;
 
@@ -318,6 +325,7 @@ start_replication:
 					cmd->slotname = $2;
 					cmd->startpoint = $4;
 					cmd->timeline = $5;
+					cmd->compression = $6;
 					$$ = (Node *) cmd;
 				}
 			;
@@ -384,6 +392,11 @@ opt_timeline:
 				| /* EMPTY */			{ $$ = 0; }
 			;
 
+opt_compression:
+			K_COMPRESSION SCONST			{ $$ = $2; }
+			| /* EMPTY */					{ $$ = NULL; }
+			;
+
 
 plugin_options:
 			'(' plugin_opt_list ')'			{ $$ = $2; }
@@ -84,6 +84,7 @@
 #include "storage/proc.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 
 /* User-settable parameters for sync rep */
@@ -97,9 +98,19 @@ static bool announce_next_takeover = true;
 SyncRepConfigData *SyncRepConfig = NULL;
 static int	SyncRepWaitMode = SYNC_REP_NO_WAIT;
 
+/*
+ * pgprocnos of the backends released by SyncRepWakeQueue(), whose latches
+ * are set by SyncRepWakeReleased() once SyncRepLock has been released.
+ * Setting a latch may mean a system call, so we don't want to do that while
+ * everybody trying to commit waits for the lock.
+ */
+static int *released_procnos = NULL;
+static int	num_released_procnos = 0;
+
 static void SyncRepQueueInsert(int mode);
 static void SyncRepCancelWait(void);
 static int	SyncRepWakeQueue(bool all, int mode);
+static void SyncRepWakeReleased(void);
 
 static bool SyncRepGetSyncRecPtr(XLogRecPtr *writePtr,
 								 XLogRecPtr *flushPtr,
@@ -173,6 +184,19 @@ SyncRepWaitForLSN(XLogRecPtr lsn, bool commit)
 	Assert(SHMQueueIsDetached(&(MyProc->syncRepLinks)));
 	Assert(WalSndCtl != NULL);
 
+#ifdef PG_HAVE_8BYTE_SINGLE_COPY_ATOMICITY
+
+	/*
+	 * If the standbys have already confirmed our LSN, which is common when
+	 * many backends commit at once and the walsender releases them in
+	 * batches, there's no need to take the lock at all.  The released LSN
+	 * only ever advances, so if we see a stale value we just take the slow
+	 * path below.
+	 */
+	if (lsn <= WalSndCtl->lsn[mode])
+		return;
+#endif
+
 	LWLockAcquire(SyncRepLock, LW_EXCLUSIVE);
 	Assert(MyProc->syncRepState == SYNC_REP_NOT_WAITING);
 
@@ -521,6 +545,8 @@ SyncRepReleaseWaiters(void)
 
 	LWLockRelease(SyncRepLock);
 
+	SyncRepWakeReleased();
+
 	elog(DEBUG3, "released %d procs up to write %X/%X, %d procs up to flush %X/%X, %d procs up to apply %X/%X",
 		 numwrite, (uint32) (writePtr >> 32), (uint32) writePtr,
 		 numflush, (uint32) (flushPtr >> 32), (uint32) flushPtr,
@@ -857,9 +883,13 @@ SyncRepGetStandbyPriority(void)
 
 /*
  * Walk the specified queue from head.  Set the state of any backends that
- * need to be woken, remove them from the queue, and then wake them.
- * Pass all = true to wake whole queue; otherwise, just wake up to
- * the walsender's LSN.
+ * need to be woken and remove them from the queue.  Pass all = true to wake
+ * whole queue; otherwise, just wake up to the walsender's LSN.
+ *
+ * The backends are only remembered here; the caller must call
+ * SyncRepWakeReleased() after releasing the lock to actually wake them.
+ * Since the queue is ordered by LSN, this releases everybody waiting for an
+ * LSN up to the confirmed one as a single batch.
  *
  * The caller must hold SyncRepLock in exclusive mode.
  */
@@ -875,6 +905,16 @@ SyncRepWakeQueue(bool all, int mode)
 	Assert(LWLockHeldByMeInMode(SyncRepLock, LW_EXCLUSIVE));
 	Assert(SyncRepQueueIsOrderedByLSN(mode));
 
+	/*
+	 * A backend waits in at most one queue, so there can't be more released
+	 * backends than PGPROCs, however many queues we release before waking
+	 * them.
+	 */
+	if (released_procnos == NULL)
+		released_procnos = (int *)
+			MemoryContextAlloc(TopMemoryContext,
+							   ProcGlobal->allProcCount * sizeof(int));
+
 	proc = (PGPROC *) SHMQueueNext(&(WalSndCtl->SyncRepQueue[mode]),
 								   &(WalSndCtl->SyncRepQueue[mode]),
 								   offsetof(PGPROC, syncRepLinks));
@@ -915,9 +955,11 @@ SyncRepWakeQueue(bool all, int mode)
 		thisproc->syncRepState = SYNC_REP_WAIT_COMPLETE;
 
 		/*
-		 * Wake only when we have set state and removed from queue.
+		 * Wake only when we have set state and removed from queue, which
+		 * SyncRepWakeReleased() does later.
 		 */
-		SetLatch(&(thisproc->procLatch));
+		Assert(num_released_procnos < ProcGlobal->allProcCount);
+		released_procnos[num_released_procnos++] = thisproc->pgprocno;
 
 		numprocs++;
 	}
@@ -925,6 +967,25 @@ SyncRepWakeQueue(bool all, int mode)
 	return numprocs;
 }
 
+/*
+ * Wake the backends released by SyncRepWakeQueue().
+ *
+ * This is done without holding SyncRepLock.  A backend that notices its
+ * state change before we get to it may already have left
+ * SyncRepWaitForLSN(), possibly to wait again for a later commit; the extra
+ * latch wakeup is harmless then, as the wait loop rechecks its state.
+ */
+static void
+SyncRepWakeReleased(void)
+{
+	int			i;
+
+	for (i = 0; i < num_released_procnos; i++)
+		SetLatch(&ProcGlobal->allProcs[released_procnos[i]].procLatch);
+
+	num_released_procnos = 0;
+}
+
 /*
  * The checkpointer calls this as needed to update the shared
  * sync_standbys_defined flag, so that backends don't remain permanently wedged
@@ -964,6 +1025,8 @@ SyncRepUpdateSyncStandbysDefined(void)
 		WalSndCtl->sync_standbys_defined = sync_standbys_defined;
 
 		LWLockRelease(SyncRepLock);
+
+		SyncRepWakeReleased();
 	}
 }
 
@@ -59,6 +59,7 @@
 #include "catalog/pg_authid.h"
 #include "catalog/pg_type.h"
 #include "common/ip.h"
+#include "common/stream_compression.h"
 #include "funcapi.h"
 #include "libpq/pqformat.h"
 #include "libpq/pqsignal.h"
@@ -88,6 +89,8 @@
 int			wal_receiver_status_interval;
 int			wal_receiver_timeout;
 bool		hot_standby_feedback;
+int			wal_receiver_compression = STREAM_COMPRESSION_NONE;
+int			wal_receiver_relay_buffers = 256;
 
 /* libpqwalreceiver connection */
 static WalReceiverConn *wrconn = NULL;
@@ -124,6 +127,13 @@ static struct
 static StringInfoData reply_message;
 static StringInfoData incoming_message;
 
+/*
+ * Decompression of the WAL stream, if we asked the primary to compress it,
+ * and the buffer for the decompressed WAL.
+ */
+static StreamCompressor *wal_decompressor = NULL;
+static StringInfoData decompressed_message;
+
 /* Prototypes for private functions */
 static void WalRcvFetchTimeLineHistoryFiles(TimeLineID first, TimeLineID last);
 static void WalRcvWaitForStartPosition(XLogRecPtr *startpoint, TimeLineID *startpointTLI);
@@ -400,6 +410,18 @@ WalReceiverMain(void)
 		options.startpoint = startpoint;
 		options.slotname = slotname[0] != '\0' ? slotname : NULL;
 		options.proto.physical.startpointTLI = startpointTLI;
+		options.proto.physical.compression = NULL;
+		if (wal_receiver_compression != STREAM_COMPRESSION_NONE)
+		{
+			wal_decompressor = stream_compressor_create(wal_receiver_compression,
+														true);
+			if (wal_decompressor == NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_OUT_OF_MEMORY),
+						 errmsg("could not initialize WAL stream decompression")));
+			options.proto.physical.compression =
+				stream_compression_method_name(wal_receiver_compression);
+		}
 		ThisTimeLineID = startpointTLI;
 		if (walrcv_startstreaming(wrconn, &options))
 		{
@@ -415,10 +437,14 @@ WalReceiverMain(void)
 								startpointTLI)));
 			first_stream = false;
 
+			/* The relay buffers now receive WAL of this timeline */
+			WalRcvRelayReset(startpointTLI);
+
 			/* Initialize LogstreamResult and buffers for processing messages */
 			LogstreamResult.Write = LogstreamResult.Flush = GetXLogReplayRecPtr(NULL);
 			initStringInfo(&reply_message);
 			initStringInfo(&incoming_message);
+			initStringInfo(&decompressed_message);
 
 			/* Initialize the last recv timestamp */
 			last_recv_timestamp = GetCurrentTimestamp();
@@ -606,6 +632,13 @@ WalReceiverMain(void)
 					(errmsg("primary server contains no more WAL on requested timeline %u",
 							startpointTLI)));
 
+		/* the next stream starts with a fresh decompressor */
+		if (wal_decompressor != NULL)
+		{
+			stream_compressor_free(wal_decompressor);
+			wal_decompressor = NULL;
+		}
+
 		/*
 		 * End of WAL reached on the requested timeline. Close the last
 		 * segment, and await for new orders from the startup process.
@@ -859,6 +892,41 @@ XLogWalRcvProcessMsg(unsigned char type, char *buf, Size len)
 				XLogWalRcvWrite(buf, len, dataStart);
 				break;
 			}
+		case 'z':				/* compressed WAL records */
+			{
+				int32		rawLen;
+
+				/* copy message to StringInfo */
+				hdrlen = sizeof(int64) + sizeof(int64) + sizeof(int64) +
+					sizeof(int32);
+				if (len < hdrlen || wal_decompressor == NULL)
+					ereport(ERROR,
+							(errcode(ERRCODE_PROTOCOL_VIOLATION),
+							 errmsg_internal("invalid WAL message received from primary")));
+				appendBinaryStringInfo(&incoming_message, buf, hdrlen);
+
+				/* read the fields */
+				dataStart = pq_getmsgint64(&incoming_message);
+				walEnd = pq_getmsgint64(&incoming_message);
+				sendTime = pq_getmsgint64(&incoming_message);
+				rawLen = pq_getmsgint(&incoming_message, 4);
+				if (rawLen < 0 || rawLen >= MaxAllocSize)
+					ereport(ERROR,
+							(errcode(ERRCODE_PROTOCOL_VIOLATION),
+							 errmsg_internal("invalid WAL message received from primary")));
+				ProcessWalSndrMessage(walEnd, sendTime);
+
+				resetStringInfo(&decompressed_message);
+				enlargeStringInfo(&decompressed_message, rawLen);
+				if (!stream_decompress(wal_decompressor, buf + hdrlen,
+									   len - hdrlen,
+									   decompressed_message.data, rawLen))
+					ereport(ERROR,
+							(errcode(ERRCODE_DATA_CORRUPTED),
+							 errmsg("could not decompress WAL received from primary")));
+				XLogWalRcvWrite(decompressed_message.data, rawLen, dataStart);
+				break;
+			}
 		case 'k':				/* Keepalive */
 			{
 				/* copy message to StringInfo */
@@ -898,6 +966,10 @@ XLogWalRcvWrite(char *buf, Size nbytes, XLogRecPtr recptr)
 	int			startoff;
 	int			byteswritten;
 
+	/* Keep a copy in shared memory for cascading walsenders */
+	if (AllowCascadeReplication())
+		WalRcvRelayWrite(buf, nbytes, recptr);
+
 	while (nbytes > 0)
 	{
 		int			segbytes;
@@ -31,6 +31,18 @@
 
 WalRcvData *WalRcv = NULL;
 
+/*
+ * Relay buffers: the most recently received WAL pages, kept in shared memory
+ * for cascading walsenders.  A page is always kept in the same buffer,
+ * determined by its position, like in the WAL buffers; WalRcvRelayBlocks
+ * holds the end position of the page that each buffer contains.
+ */
+static pg_atomic_uint64 *WalRcvRelayBlocks = NULL;
+static char *WalRcvRelayPages = NULL;
+
+#define RelayRecPtrToBufIdx(recptr) \
+	(((recptr) / XLOG_BLCKSZ) % wal_receiver_relay_buffers)
+
 /*
  * How long to wait for walreceiver to start up after requesting
  * postmaster to launch it. In seconds.
@@ -45,6 +57,16 @@ WalRcvShmemSize(void)
 
 	size = add_size(size, sizeof(WalRcvData));
 
+	/* relay buffers, page-aligned like the WAL buffers */
+	if (wal_receiver_relay_buffers > 0)
+	{
+		size = add_size(size, mul_size(sizeof(pg_atomic_uint64),
+									   wal_receiver_relay_buffers));
+		size = add_size(size, XLOG_BLCKSZ);
+		size = add_size(size, mul_size(XLOG_BLCKSZ,
+									   wal_receiver_relay_buffers));
+	}
+
 	return size;
 }
 
@@ -64,6 +86,25 @@ WalRcvShmemInit(void)
 		WalRcv->walRcvState = WALRCV_STOPPED;
 		SpinLockInit(&WalRcv->mutex);
 		WalRcv->latch = NULL;
+		pg_atomic_init_u32(&WalRcv->relayTLI, 0);
+		pg_atomic_init_u64(&WalRcv->relayUpto, InvalidXLogRecPtr);
+	}
+
+	if (wal_receiver_relay_buffers > 0)
+	{
+		char	   *ptr = (char *) WalRcv + sizeof(WalRcvData);
+		int			i;
+
+		ptr = (char *) MAXALIGN(ptr);
+		WalRcvRelayBlocks = (pg_atomic_uint64 *) ptr;
+		ptr += sizeof(pg_atomic_uint64) * wal_receiver_relay_buffers;
+		WalRcvRelayPages = (char *) TYPEALIGN(XLOG_BLCKSZ, ptr);
+
+		if (!found)
+		{
+			for (i = 0; i < wal_receiver_relay_buffers; i++)
+				pg_atomic_init_u64(&WalRcvRelayBlocks[i], InvalidXLogRecPtr);
+		}
 	}
 }
 
@@ -406,3 +447,139 @@ GetReplicationTransferLatency(void)
 
 	return ms;
 }
+
+/*
+ * Forget the contents of the relay buffers, when walreceiver starts
+ * streaming on timeline 'tli'.
+ */
+void
+WalRcvRelayReset(TimeLineID tli)
+{
+	int			i;
+
+	if (wal_receiver_relay_buffers <= 0)
+		return;
+
+	pg_atomic_write_u64(&WalRcv->relayUpto, InvalidXLogRecPtr);
+	for (i = 0; i < wal_receiver_relay_buffers; i++)
+		pg_atomic_write_u64(&WalRcvRelayBlocks[i], InvalidXLogRecPtr);
+	pg_write_barrier();
+	pg_atomic_write_u32(&WalRcv->relayTLI, tli);
+	pg_write_barrier();
+}
+
+/*
+ * Copy WAL that walreceiver has just received into the relay buffers.
+ *
+ * This is only called by walreceiver, so there is a single writer.  A
+ * buffer's block entry is invalidated before the buffer is reused for
+ * another page, so that readers can tell they copied a page that was being
+ * replaced.  Data appended to a page that's already in its buffer doesn't
+ * disturb readers, as they never look past the flush position, which is
+ * advanced after the data has been copied here.
+ */
+void
+WalRcvRelayWrite(const char *buf, Size nbytes, XLogRecPtr recptr)
+{
+	if (wal_receiver_relay_buffers <= 0)
+		return;
+
+	while (nbytes > 0)
+	{
+		int			idx = RelayRecPtrToBufIdx(recptr);
+		XLogRecPtr	pageEndPtr = recptr + (XLOG_BLCKSZ - recptr % XLOG_BLCKSZ);
+		Size		offset = recptr % XLOG_BLCKSZ;
+		Size		len = Min(nbytes, XLOG_BLCKSZ - offset);
+		char	   *page = WalRcvRelayPages + idx * (Size) XLOG_BLCKSZ;
+
+		if (offset == 0)
+		{
+			/* start of a new page */
+			pg_atomic_write_u64(&WalRcvRelayBlocks[idx], InvalidXLogRecPtr);
+			pg_write_barrier();
+			memcpy(page, buf, len);
+			pg_write_barrier();
+			pg_atomic_write_u64(&WalRcvRelayBlocks[idx], pageEndPtr);
+		}
+		else if (pg_atomic_read_u64(&WalRcvRelayBlocks[idx]) == pageEndPtr)
+		{
+			/* more data on a page we already have */
+			memcpy(page + offset, buf, len);
+		}
+
+		/*
+		 * Otherwise, we didn't get the beginning of the page, when streaming
+		 * started in the middle of it.  Leave it to be read from the file.
+		 */
+
+		buf += len;
+		recptr += len;
+		nbytes -= len;
+	}
+
+	pg_write_barrier();
+	pg_atomic_write_u64(&WalRcv->relayUpto, recptr);
+}
+
+/*
+ * Read received WAL from the relay buffers, for a cascading walsender.
+ *
+ * Copies 'count' bytes of WAL of timeline 'tli' starting at 'startptr' into
+ * 'buf', for as long as the pages are in the relay buffers, and returns the
+ * number of bytes copied.  The rest has to be read from the WAL files, which
+ * includes WAL that the startup process got from the archive rather than
+ * from walreceiver.
+ */
+Size
+WalRcvRelayRead(char *buf, XLogRecPtr startptr, Size count, TimeLineID tli)
+{
+	XLogRecPtr	ptr = startptr;
+	XLogRecPtr	relayUpto;
+	Size		nbytes;
+
+	if (wal_receiver_relay_buffers <= 0 ||
+		pg_atomic_read_u32(&WalRcv->relayTLI) != tli)
+		return 0;
+
+	/* don't look past what walreceiver has copied */
+	relayUpto = pg_atomic_read_u64(&WalRcv->relayUpto);
+	pg_read_barrier();
+	if (relayUpto <= startptr)
+		return 0;
+	if (count > relayUpto - startptr)
+		count = relayUpto - startptr;
+	nbytes = count;
+
+	while (nbytes > 0)
+	{
+		int			idx = RelayRecPtrToBufIdx(ptr);
+		XLogRecPtr	pageEndPtr = ptr + (XLOG_BLCKSZ - ptr % XLOG_BLCKSZ);
+		Size		offset = ptr % XLOG_BLCKSZ;
+		Size		len = Min(nbytes, XLOG_BLCKSZ - offset);
+
+		if (pg_atomic_read_u64(&WalRcvRelayBlocks[idx]) != pageEndPtr)
+			break;
+		pg_read_barrier();
+
+		memcpy(buf, WalRcvRelayPages + idx * (Size) XLOG_BLCKSZ + offset, len);
+
+		/* did the buffer get reused while we were copying? */
+		pg_read_barrier();
+		if (pg_atomic_read_u64(&WalRcvRelayBlocks[idx]) != pageEndPtr)
+			break;
+
+		buf += len;
+		ptr += len;
+		nbytes -= len;
+	}
+
+	/*
+	 * If walreceiver has switched to another timeline meanwhile, what we
+	 * copied may come from it.
+	 */
+	pg_read_barrier();
+	if (pg_atomic_read_u32(&WalRcv->relayTLI) != tli)
+		return 0;
+
+	return count - nbytes;
+}
@@ -60,6 +60,7 @@
 #include "catalog/pg_type.h"
 #include "commands/dbcommands.h"
 #include "commands/defrem.h"
+#include "common/stream_compression.h"
 #include "funcapi.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
@@ -69,6 +70,7 @@
 #include "postmaster/interrupt.h"
 #include "replication/basebackup.h"
 #include "replication/decode.h"
+#include "replication/fanout.h"
 #include "replication/logical.h"
 #include "replication/slot.h"
 #include "replication/snapbuild.h"
@@ -158,6 +160,13 @@ static StringInfoData output_message;
 static StringInfoData reply_message;
 static StringInfoData tmpbuf;
 
+/*
+ * Compression of the WAL sent in physical replication, if the client asked
+ * for it, and the buffer for the compressed messages.
+ */
+static StreamCompressor *wal_compressor = NULL;
+static StringInfoData compressed_message;
+
 /* Timestamp of last ProcessRepliesIfAny(). */
 static TimestampTz last_processing = 0;
 
@@ -196,6 +205,9 @@ static volatile sig_atomic_t replication_active = false;
 
 static LogicalDecodingContext *logical_decoding_ctx = NULL;
 
+/* output plugin options, to recreate the decoding context when needed */
+static List *logical_decoding_options = NIL;
+
 /* A sample associating a WAL location with the time it was written. */
 typedef struct
 {
@@ -229,6 +241,9 @@ static void WalSndKill(int code, Datum arg);
 static void WalSndShutdown(void) pg_attribute_noreturn();
 static void XLogSendPhysical(void);
 static void XLogSendLogical(void);
+static bool XLogSendFanout(void);
+static bool WalSndDecodingConsistent(void);
+static void WalSndLeaveFanoutGroup(void);
 static void WalSndDone(WalSndSendDataCallback send_data);
 static XLogRecPtr GetStandbyFlushRecPtr(void);
 static void IdentifySystem(void);
@@ -244,6 +259,7 @@ static void WalSndKeepalive(bool requestReply);
 static void WalSndKeepaliveIfNecessary(void);
 static void WalSndCheckTimeOut(void);
 static long WalSndComputeSleeptime(TimestampTz now);
+static void WalSndWait(uint32 socket_events, long timeout, uint32 wait_event);
 static void WalSndPrepareWrite(LogicalDecodingContext *ctx, XLogRecPtr lsn, TransactionId xid, bool last_write);
 static void WalSndWriteData(LogicalDecodingContext *ctx, XLogRecPtr lsn, TransactionId xid, bool last_write);
 static void WalSndUpdateProgress(LogicalDecodingContext *ctx, XLogRecPtr lsn, TransactionId xid);
@@ -301,6 +317,14 @@ WalSndErrorCleanup(void)
 	if (xlogreader != NULL && xlogreader->seg.ws_file >= 0)
 		wal_segment_close(xlogreader);
 
+	DecodeFanoutDetach();
+
+	if (wal_compressor != NULL)
+	{
+		stream_compressor_free(wal_compressor);
+		wal_compressor = NULL;
+	}
+
 	if (MyReplicationSlot != NULL)
 		ReplicationSlotRelease();
 
@@ -589,6 +613,36 @@ StartReplication(StartReplicationCmd *cmd)
 				(errcode(ERRCODE_OUT_OF_MEMORY),
 				 errmsg("out of memory")));
 
+	if (cmd->compression)
+	{
+		StreamCompressionMethod method;
+
+		if (!parse_stream_compression_method(cmd->compression, &method))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("unrecognized stream compression method \"%s\"",
+							cmd->compression)));
+		if (!stream_compression_supported(method))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("stream compression method \"%s\" is not supported by this build",
+							cmd->compression)));
+
+		/* the compressor's history has to last as long as the stream */
+		if (method != STREAM_COMPRESSION_NONE)
+		{
+			MemoryContext oldcxt = MemoryContextSwitchTo(TopMemoryContext);
+
+			wal_compressor = stream_compressor_create(method, false);
+			MemoryContextSwitchTo(oldcxt);
+			if (wal_compressor == NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_OUT_OF_MEMORY),
+						 errmsg("could not initialize %s compression",
+								cmd->compression)));
+		}
+	}
+
 	/*
 	 * We assume here that we're logging enough information in the WAL for
 	 * log-shipping, since this is checked in PostmasterMain().
@@ -752,6 +806,12 @@ StartReplication(StartReplicationCmd *cmd)
 		Assert(streamingDoneSending && streamingDoneReceiving);
 	}
 
+	if (wal_compressor != NULL)
+	{
+		stream_compressor_free(wal_compressor);
+		wal_compressor = NULL;
+	}
+
 	if (cmd->slotname)
 		ReplicationSlotRelease();
 
@@ -837,6 +897,14 @@ logical_read_xlog_page(XLogReaderState *state, XLogRecPtr targetPagePtr, int req
 	else
 		count = flushptr - targetPagePtr;	/* part of the page available */
 
+	/*
+	 * If the page is still in the WAL buffers, copy it from there; it's
+	 * cheaper than reading it back from the file.
+	 */
+	if (!sendTimeLineIsHistoric &&
+		XLogReadFromBuffers(cur_page, targetPagePtr, count) == count)
+		return count;
+
 	/* now actually read the data, we know it's there */
 	if (!WALRead(state,
 				 cur_page,
@@ -1180,6 +1248,17 @@ StartLogicalReplication(StartReplicationCmd *cmd)
 							  WalSndPrepareWrite, WalSndWriteData,
 							  WalSndUpdateProgress);
 	xlogreader = logical_decoding_ctx->reader;
+	logical_decoding_options = cmd->options;
+
+	/*
+	 * Share the decoding with other walsenders using the same output plugin
+	 * and options.  Not when streaming in-progress transactions though, as
+	 * the output for those can't be joined at a record boundary.
+	 */
+	if (!logical_decoding_ctx->streaming)
+		DecodeFanoutAttach(cmd->options,
+						   Max(cmd->startpoint,
+							   MyReplicationSlot->data.confirmed_flush));
 
 	WalSndSetState(WALSNDSTATE_CATCHUP);
 
@@ -1212,7 +1291,10 @@ StartLogicalReplication(StartReplicationCmd *cmd)
 	/* Main loop of walsender */
 	WalSndLoop(XLogSendLogical);
 
-	FreeDecodingContext(logical_decoding_ctx);
+	DecodeFanoutDetach();
+	if (logical_decoding_ctx != NULL)
+		FreeDecodingContext(logical_decoding_ctx);
+	logical_decoding_options = NIL;
 	ReplicationSlotRelease();
 
 	replication_active = false;
@@ -1280,6 +1362,10 @@ WalSndWriteData(LogicalDecodingContext *ctx, XLogRecPtr lsn, TransactionId xid,
 	/* output previously gathered data in a CopyData packet */
 	pq_putmessage_noblock('d', ctx->out->data, ctx->out->len);
 
+	/* and pass it on to the members of our decoding fan-out group */
+	if (MyDecodeFanoutRole == DECODE_FANOUT_LEADER)
+		DecodeFanoutWrite(ctx->out->data, ctx->out->len);
+
 	CHECK_FOR_INTERRUPTS();
 
 	/* Try to flush pending output to the client */
@@ -1297,7 +1383,6 @@ WalSndWriteData(LogicalDecodingContext *ctx, XLogRecPtr lsn, TransactionId xid,
 	/* If we have pending write here, go to slow path */
 	for (;;)
 	{
-		int			wakeEvents;
 		long		sleeptime;
 
 		/* Check for input from the client */
@@ -1314,13 +1399,9 @@ WalSndWriteData(LogicalDecodingContext *ctx, XLogRecPtr lsn, TransactionId xid,
 
 		sleeptime = WalSndComputeSleeptime(GetCurrentTimestamp());
 
-		wakeEvents = WL_LATCH_SET | WL_EXIT_ON_PM_DEATH |
-			WL_SOCKET_WRITEABLE | WL_SOCKET_READABLE | WL_TIMEOUT;
-
 		/* Sleep until something happens or we time out */
-		(void) WaitLatchOrSocket(MyLatch, wakeEvents,
-								 MyProcPort->sock, sleeptime,
-								 WAIT_EVENT_WAL_SENDER_WRITE_DATA);
+		WalSndWait(WL_SOCKET_WRITEABLE | WL_SOCKET_READABLE, sleeptime,
+				   WAIT_EVENT_WAL_SENDER_WRITE_DATA);
 
 		/* Clear any already-pending wakeups */
 		ResetLatch(MyLatch);
@@ -1490,15 +1571,12 @@ WalSndWaitForWal(XLogRecPtr loc)
 		 */
 		sleeptime = WalSndComputeSleeptime(GetCurrentTimestamp());
 
-		wakeEvents = WL_LATCH_SET | WL_EXIT_ON_PM_DEATH |
-			WL_SOCKET_READABLE | WL_TIMEOUT;
+		wakeEvents = WL_SOCKET_READABLE;
 
 		if (pq_is_send_pending())
 			wakeEvents |= WL_SOCKET_WRITEABLE;
 
-		(void) WaitLatchOrSocket(MyLatch, wakeEvents,
-								 MyProcPort->sock, sleeptime,
-								 WAIT_EVENT_WAL_SENDER_WAIT_WAL);
+		WalSndWait(wakeEvents, sleeptime, WAIT_EVENT_WAL_SENDER_WAIT_WAL);
 	}
 
 	/* reactivate latch so WalSndLoop knows to continue */
@@ -1596,6 +1674,7 @@ exec_replication_command(const char *cmd_string)
 	initStringInfo(&output_message);
 	initStringInfo(&reply_message);
 	initStringInfo(&tmpbuf);
+	initStringInfo(&compressed_message);
 
 	/* Report to pgstat that this process is running */
 	pgstat_report_activity(STATE_RUNNING, NULL);
@@ -1626,11 +1705,12 @@ exec_replication_command(const char *cmd_string)
 				PreventInTransactionBlock(true, "START_REPLICATION");
 
 				if (cmd->kind == REPLICATION_KIND_PHYSICAL)
+				{
 					StartReplication(cmd);
+					Assert(xlogreader != NULL);
+				}
 				else
 					StartLogicalReplication(cmd);
-
-				Assert(xlogreader != NULL);
 				break;
 			}
 
@@ -1950,7 +2030,10 @@ ProcessStandbyReplyMessage(void)
 	if (MyReplicationSlot && flushPtr != InvalidXLogRecPtr)
 	{
 		if (SlotIsLogical(MyReplicationSlot))
+		{
 			LogicalConfirmReceivedLocation(flushPtr);
+			DecodeFanoutSyncSlot();
+		}
 		else
 			PhysicalConfirmReceivedLocation(flushPtr);
 	}
@@ -2343,8 +2426,7 @@ WalSndLoop(WalSndSendDataCallback send_data)
 			long		sleeptime;
 			int			wakeEvents;
 
-			wakeEvents = WL_LATCH_SET | WL_EXIT_ON_PM_DEATH | WL_TIMEOUT |
-				WL_SOCKET_READABLE;
+			wakeEvents = WL_SOCKET_READABLE;
 
 			/*
 			 * Use fresh timestamp, not last_processing, to reduce the chance
@@ -2356,9 +2438,7 @@ WalSndLoop(WalSndSendDataCallback send_data)
 				wakeEvents |= WL_SOCKET_WRITEABLE;
 
 			/* Sleep until something happens or we time out */
-			(void) WaitLatchOrSocket(MyLatch, wakeEvents,
-									 MyProcPort->sock, sleeptime,
-									 WAIT_EVENT_WAL_SENDER_MAIN);
+			WalSndWait(wakeEvents, sleeptime, WAIT_EVENT_WAL_SENDER_MAIN);
 		}
 	}
 }
@@ -2527,8 +2607,10 @@ XLogSendPhysical(void)
 	XLogRecPtr	startptr;
 	XLogRecPtr	endptr;
 	Size		nbytes;
+	Size		nbuffered;
 	XLogSegNo	segno;
 	WALReadError errinfo;
+	StringInfo	msg;
 
 	/* If requested switch the WAL sender to the stopping state. */
 	if (got_STOPPING)
@@ -2740,24 +2822,42 @@ XLogSendPhysical(void)
 
 	/*
 	 * Read the log directly into the output buffer to avoid extra memcpy
-	 * calls.
+	 * calls.  On a primary, recent WAL is usually still in the WAL buffers;
+	 * on a standby, in walreceiver's relay buffers.  Copy as much as we can
+	 * from there, and read only the rest from the files.
 	 */
 	enlargeStringInfo(&output_message, nbytes);
 
+	nbuffered = 0;
+	if (!sendTimeLineIsHistoric)
+	{
+		char	   *dst = &output_message.data[output_message.len];
+
+		if (am_cascading_walsender)
+			nbuffered = WalRcvRelayRead(dst, startptr, nbytes, sendTimeLine);
+		else
+			nbuffered = XLogReadFromBuffers(dst, startptr, nbytes);
+	}
+
 retry:
-	if (!WALRead(xlogreader,
-				 &output_message.data[output_message.len],
-				 startptr,
-				 nbytes,
-				 xlogreader->seg.ws_tli,	/* Pass the current TLI because
-											 * only WalSndSegmentOpen controls
-											 * whether new TLI is needed. */
-				 &errinfo))
-		WALReadRaiseError(&errinfo);
+	if (nbuffered < nbytes)
+	{
+		if (!WALRead(xlogreader,
+					 &output_message.data[output_message.len + nbuffered],
+					 startptr + nbuffered,
+					 nbytes - nbuffered,
+					 xlogreader->seg.ws_tli,	/* Pass the current TLI because
+												 * only WalSndSegmentOpen
+												 * controls whether new TLI is
+												 * needed. */
+					 &errinfo))
+			WALReadRaiseError(&errinfo);
 
-	/* See logical_read_xlog_page(). */
-	XLByteToSeg(startptr, segno, xlogreader->segcxt.ws_segsize);
-	CheckXLogRemoved(segno, xlogreader->seg.ws_tli);
+		/* See logical_read_xlog_page(). */
+		XLByteToSeg(startptr + nbuffered, segno,
+					xlogreader->segcxt.ws_segsize);
+		CheckXLogRemoved(segno, xlogreader->seg.ws_tli);
+	}
 
 	/*
 	 * During recovery, the currently-open WAL file might be replaced with the
@@ -2786,15 +2886,46 @@ retry:
 	output_message.len += nbytes;
 	output_message.data[output_message.len] = '\0';
 
+	/*
+	 * If compression was requested, send the slice as a compressed message
+	 * instead.  The compressor keeps the history of the stream, so every
+	 * slice of WAL sent from now on must go through it.
+	 */
+	msg = &output_message;
+	if (wal_compressor != NULL)
+	{
+		const int	hdrlen = 1 + sizeof(int64) * 3;
+		size_t		bound = stream_compress_bound(wal_compressor, nbytes);
+		int			clen;
+
+		resetStringInfo(&compressed_message);
+		pq_sendbyte(&compressed_message, 'z');
+		appendBinaryStringInfo(&compressed_message, output_message.data + 1,
+							   hdrlen - 1);
+		pq_sendint32(&compressed_message, nbytes);	/* rawLen */
+		enlargeStringInfo(&compressed_message, bound);
+
+		clen = stream_compress(wal_compressor,
+							   output_message.data + hdrlen, nbytes,
+							   compressed_message.data + compressed_message.len,
+							   bound);
+		if (clen < 0)
+			ereport(ERROR,
+					(errmsg("could not compress WAL stream")));
+		compressed_message.len += clen;
+		compressed_message.data[compressed_message.len] = '\0';
+		msg = &compressed_message;
+	}
+
 	/*
 	 * Fill the send timestamp last, so that it is taken as late as possible.
 	 */
 	resetStringInfo(&tmpbuf);
 	pq_sendint64(&tmpbuf, GetCurrentTimestamp());
-	memcpy(&output_message.data[1 + sizeof(int64) + sizeof(int64)],
+	memcpy(&msg->data[1 + sizeof(int64) + sizeof(int64)],
 		   tmpbuf.data, sizeof(int64));
 
-	pq_putmessage_noblock('d', output_message.data, output_message.len);
+	pq_putmessage_noblock('d', msg->data, msg->len);
 
 	sentPtr = endptr;
 
@@ -2843,6 +2974,43 @@ XLogSendLogical(void)
 	 */
 	WalSndCaughtUp = false;
 
+	/*
+	 * Members of a decoding fan-out group send what the leader decoded.  At
+	 * shutdown, go back to decoding on our own though, so that we don't stop
+	 * before having sent everything.
+	 */
+	if (MyDecodeFanoutRole == DECODE_FANOUT_MEMBER)
+	{
+		if (!got_STOPPING && XLogSendFanout())
+			return;
+		WalSndLeaveFanoutGroup();
+	}
+	else if (MyDecodeFanoutRole == DECODE_FANOUT_JOINING)
+	{
+		bool		wait;
+
+		if (got_STOPPING)
+			DecodeFanoutDetach();
+		else if (DecodeFanoutTryJoin(logical_decoding_ctx->reader->EndRecPtr,
+									 WalSndDecodingConsistent(),
+									 &wait))
+		{
+			/* everything the decoding context still holds is obsolete */
+			FreeDecodingContext(logical_decoding_ctx);
+			logical_decoding_ctx = NULL;
+			xlogreader = NULL;
+
+			(void) XLogSendFanout();
+			return;
+		}
+		else if (wait)
+		{
+			/* sleep until the leader has set a join marker */
+			WalSndCaughtUp = true;
+			return;
+		}
+	}
+
 	record = XLogReadRecord(logical_decoding_ctx->reader, &errm);
 
 	/* xlog record was invalid */
@@ -2859,6 +3027,18 @@ XLogSendLogical(void)
 		LogicalDecodingProcessRecord(logical_decoding_ctx, logical_decoding_ctx->reader);
 
 		sentPtr = logical_decoding_ctx->reader->EndRecPtr;
+
+		/*
+		 * Publish the output for this record to the members of our fan-out
+		 * group.  If a walsender waits to join here, restart the output
+		 * plugin so that what follows doesn't depend on what came before.
+		 */
+		if (MyDecodeFanoutRole == DECODE_FANOUT_LEADER &&
+			DecodeFanoutPublish(sentPtr, WalSndDecodingConsistent()))
+		{
+			ResetDecodingContextOutputPlugin(logical_decoding_ctx);
+			DecodeFanoutSetMarker(sentPtr);
+		}
 	}
 
 	/*
@@ -2892,6 +3072,119 @@ XLogSendLogical(void)
 	}
 }
 
+/*
+ * Has our snapshot builder reached a consistent state yet?
+ */
+static bool
+WalSndDecodingConsistent(void)
+{
+	return SnapBuildCurrentState(logical_decoding_ctx->snapshot_builder) ==
+		SNAPBUILD_CONSISTENT;
+}
+
+/*
+ * Stream out what the leader of our decoding fan-out group decoded.
+ *
+ * Returns false if we can't keep up with the leader, or it went away, in
+ * which case we have to decode on our own again.
+ */
+static bool
+XLogSendFanout(void)
+{
+	char	   *data;
+	Size		len;
+	XLogRecPtr	endptr;
+
+	switch (DecodeFanoutRead(&data, &len, &endptr))
+	{
+		case DECODE_FANOUT_READ_LOST:
+			return false;
+
+		case DECODE_FANOUT_READ_EMPTY:
+			WalSndCaughtUp = true;
+			break;
+
+		case DECODE_FANOUT_READ_DATA:
+			{
+				TimestampTz now = GetCurrentTimestamp();
+
+				resetStringInfo(&tmpbuf);
+				pq_sendint64(&tmpbuf, now);
+
+				while (len > 0)
+				{
+					uint32		msglen;
+
+					memcpy(&msglen, data, sizeof(uint32));
+					data += sizeof(uint32);
+
+					/* fill in the send time, as in WalSndWriteData */
+					memcpy(&data[1 + sizeof(int64) + sizeof(int64)],
+						   tmpbuf.data, sizeof(int64));
+					pq_putmessage_noblock('d', data, msglen);
+
+					data += msglen;
+					len -= sizeof(uint32) + msglen;
+				}
+
+				WalSndUpdateProgress(NULL, endptr, InvalidTransactionId);
+				break;
+			}
+	}
+
+	if (endptr > sentPtr)
+		sentPtr = endptr;
+
+	/*
+	 * As in WalSndWaitForWal, let an otherwise idle client know how far we
+	 * got.
+	 */
+	if (WalSndCaughtUp &&
+		MyWalSnd->flush < sentPtr &&
+		MyWalSnd->write < sentPtr &&
+		!waiting_for_ping_response)
+		WalSndKeepalive(false);
+
+	/* Update shared memory status */
+	{
+		WalSnd	   *walsnd = MyWalSnd;
+
+		SpinLockAcquire(&walsnd->mutex);
+		walsnd->sentPtr = sentPtr;
+		SpinLockRelease(&walsnd->mutex);
+	}
+
+	return true;
+}
+
+/*
+ * Go back to decoding on our own after having sent the output of the leader
+ * of our decoding fan-out group, continuing after the last record sent.
+ */
+static void
+WalSndLeaveFanoutGroup(void)
+{
+	XLogRecPtr	startpoint;
+
+	DecodeFanoutDetach();
+
+	startpoint = Max(sentPtr, MyReplicationSlot->data.confirmed_flush);
+
+	logical_decoding_ctx =
+		CreateDecodingContext(startpoint, logical_decoding_options, false,
+							  XL_ROUTINE(.page_read = logical_read_xlog_page,
+										 .segment_open = WalSndSegmentOpen,
+										 .segment_close = wal_segment_close),
+							  WalSndPrepareWrite, WalSndWriteData,
+							  WalSndUpdateProgress);
+	xlogreader = logical_decoding_ctx->reader;
+
+	XLogBeginRead(logical_decoding_ctx->reader,
+				  MyReplicationSlot->data.restart_lsn);
+
+	DecodeFanoutAttach(logical_decoding_options, startpoint);
+}
+
 /*
  * Shutdown if the sender is caught up.
  *
@@ -3085,6 +3378,25 @@ WalSndShmemInit(void)
 	}
 }
 
+/*
+ * Wait for readiness on the FeBe socket, or a timeout.  The mask should be
+ * composed of optional WL_SOCKET_WRITEABLE and WL_SOCKET_READABLE flags.
+ * Exit on postmaster death.
+ *
+ * This reuses the long-lived FeBeWaitSet, rather than building a new wait
+ * event set for every wait as WaitLatchOrSocket() does.
+ */
+static void
+WalSndWait(uint32 socket_events, long timeout, uint32 wait_event)
+{
+	WaitEvent	event;
+
+	ModifyWaitEvent(FeBeWaitSet, FeBeWaitSetSocketPos, socket_events, NULL);
+	if (WaitEventSetWait(FeBeWaitSet, timeout, &event, 1, wait_event) == 1 &&
+		(event.events & WL_POSTMASTER_DEATH))
+		proc_exit(1);
+}
+
 /*
  * Wake up all walsenders
  *
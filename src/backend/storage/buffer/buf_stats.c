@@ -0,0 +1,445 @@
+/*-------------------------------------------------------------------------
+ *
+ * buf_stats.c
+ *	  Shared buffer usage counters, per relation and per access strategy
+ *
+ * pg_buffercache can tell what is in shared buffers right now, but only by
+ * looking at every buffer header, and it cannot tell which relations keep
+ * pushing each other out.  The counters here are maintained continuously
+ * instead: every hit, read, eviction, dirtying and write of a shared buffer
+ * is counted for the relation it belongs to, and hits, reads, evictions and
+ * backend writes also for the buffer access strategy in use.
+ *
+ * Counting must be cheap and must work in critical sections, so backends
+ * count into a small fixed-size table in local memory, and add its contents
+ * to the counters in shared memory at most every BUFSTATS_FLUSH_INTERVAL
+ * msec, from pgstat_report_stat() and the main loops of the background
+ * writer and checkpointer, and at process exit.  Relations are identified
+ * by relfilenode, because the processes writing buffers out know nothing
+ * else about them.  There is room for BUFSTATS_MAX_RELATIONS relations in
+ * shared memory; the counts of any further relations are added up in a
+ * single entry until the counters are reset.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/buffer/buf_stats.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/xact.h"
+#include "common/hashfn.h"
+#include "miscadmin.h"
+#include "port/atomics.h"
+#include "storage/buf_stats.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/hsearch.h"
+
+/* GUC variable */
+bool		track_buffer_usage = true;
+
+/* number of relations that can have counters of their own */
+#define BUFSTATS_MAX_RELATIONS		8192
+
+/* number of relations a backend can have pending counts for */
+#define BUFSTATS_PENDING_SLOTS		128
+
+/* minimum time between flushes of the pending counts, in msec */
+#define BUFSTATS_FLUSH_INTERVAL		500
+
+typedef struct BufferStatsEntry
+{
+	RelFileNode rnode;			/* hash key */
+	pg_atomic_uint64 counts[BUFSTATS_NUM_COUNTERS];
+} BufferStatsEntry;
+
+/*
+ * The shared counters.  BufferStatsLock protects the hash table and
+ * reset_timestamp; the counters themselves are updated atomically while
+ * holding it in shared mode.
+ */
+typedef struct BufferStatsShared
+{
+	TimestampTz reset_timestamp;
+	BufferStatsEntry other;		/* relations that didn't fit */
+	pg_atomic_uint64 strategy_counts[BUFSTATS_NUM_STRATEGIES][BUFSTATS_NUM_COUNTERS];
+} BufferStatsShared;
+
+static BufferStatsShared *BufferStats = NULL;
+static HTAB *BufferStatsHash = NULL;
+
+/*
+ * Counts not yet added to the shared counters.  pendingRels is an
+ * open-addressing table; a slot is free if its relNode is InvalidOid.
+ */
+static BufferStatsRelation pendingRels[BUFSTATS_PENDING_SLOTS];
+static BufferStatsRelation pendingOther;	/* when pendingRels is full */
+static uint64 pendingStrategies[BUFSTATS_NUM_STRATEGIES][BUFSTATS_NUM_COUNTERS];
+static int	nPendingRels = 0;
+static int	lastPendingSlot = 0;
+static bool havePending = false;
+
+static void BufferStatsFlushPending(void);
+
+/*
+ * Estimate space needed for the shared counters
+ */
+Size
+BufferStatsShmemSize(void)
+{
+	return add_size(MAXALIGN(sizeof(BufferStatsShared)),
+					hash_estimate_size(BUFSTATS_MAX_RELATIONS,
+									   sizeof(BufferStatsEntry)));
+}
+
+/*
+ * Allocate and initialize the shared counters
+ */
+void
+BufferStatsShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+	int			i,
+				j;
+
+	BufferStats = (BufferStatsShared *)
+		ShmemInitStruct("Buffer Usage Stats", sizeof(BufferStatsShared),
+						&found);
+
+	if (!found)
+	{
+		BufferStats->reset_timestamp = GetCurrentTimestamp();
+		MemSet(&BufferStats->other.rnode, 0, sizeof(RelFileNode));
+		for (j = 0; j < BUFSTATS_NUM_COUNTERS; j++)
+		{
+			pg_atomic_init_u64(&BufferStats->other.counts[j], 0);
+			for (i = 0; i < BUFSTATS_NUM_STRATEGIES; i++)
+				pg_atomic_init_u64(&BufferStats->strategy_counts[i][j], 0);
+		}
+	}
+
+	info.keysize = sizeof(RelFileNode);
+	info.entrysize = sizeof(BufferStatsEntry);
+
+	BufferStatsHash = ShmemInitHash("Buffer Usage Stats Hash",
+									BUFSTATS_MAX_RELATIONS,
+									BUFSTATS_MAX_RELATIONS,
+									&info,
+									HASH_ELEM | HASH_BLOBS | HASH_FIXED_SIZE);
+}
+
+/*
+ * BufferStatsCountRelation
+ *		Count an event for a shared buffer of the given relation
+ *
+ * Callers normally use pgstat_count_buffer_usage, which checks
+ * track_buffer_usage first.  This is safe to call in a critical section.
+ */
+void
+BufferStatsCountRelation(const RelFileNode *rnode, BufferStatsCounter counter)
+{
+	int			slot = lastPendingSlot;
+	int			i;
+
+	/* consecutive counts are very often for the same relation */
+	if (!RelFileNodeEquals(pendingRels[slot].rnode, *rnode))
+	{
+		slot = murmurhash32(rnode->relNode ^ rnode->dbNode) %
+			BUFSTATS_PENDING_SLOTS;
+
+		for (i = 0; i < BUFSTATS_PENDING_SLOTS; i++)
+		{
+			if (pendingRels[slot].rnode.relNode == InvalidOid)
+				break;
+			if (RelFileNodeEquals(pendingRels[slot].rnode, *rnode))
+				break;
+			slot = (slot + 1) % BUFSTATS_PENDING_SLOTS;
+		}
+
+		if (pendingRels[slot].rnode.relNode == InvalidOid)
+		{
+			/*
+			 * Keep the table at most three quarters full, so that probing
+			 * stays short.  Make room by flushing, unless we're in a critical
+			 * section; then the count goes to pendingOther.
+			 */
+			if (nPendingRels >= BUFSTATS_PENDING_SLOTS * 3 / 4)
+			{
+				if (CritSectionCount > 0)
+				{
+					pendingOther.counts[counter]++;
+					havePending = true;
+					return;
+				}
+				BufferStatsFlushPending();
+				BufferStatsCountRelation(rnode, counter);
+				return;
+			}
+
+			pendingRels[slot].rnode = *rnode;
+			nPendingRels++;
+		}
+
+		lastPendingSlot = slot;
+	}
+
+	pendingRels[slot].counts[counter]++;
+	havePending = true;
+}
+
+/*
+ * BufferStatsCountStrategy
+ *		Count an event for the given buffer access strategy
+ *
+ * A NULL strategy counts as BAS_NORMAL.
+ */
+void
+BufferStatsCountStrategy(BufferAccessStrategy strategy,
+						 BufferStatsCounter counter)
+{
+	pendingStrategies[GetAccessStrategyType(strategy)][counter]++;
+	havePending = true;
+}
+
+/*
+ * BufferStatsFlush
+ *		Add the counts of this process to the shared counters
+ *
+ * Unless force is true, this does nothing if the last flush was less than
+ * BUFSTATS_FLUSH_INTERVAL msec ago.
+ */
+void
+BufferStatsFlush(bool force)
+{
+	static TimestampTz last_flush = 0;
+
+	if (!havePending || BufferStats == NULL)
+		return;
+
+	if (!force)
+	{
+		TimestampTz now = GetCurrentTransactionStopTimestamp();
+
+		if (!TimestampDifferenceExceeds(last_flush, now,
+										BUFSTATS_FLUSH_INTERVAL))
+			return;
+		last_flush = now;
+	}
+
+	BufferStatsFlushPending();
+}
+
+/*
+ * Add counts to shared counters.
+ */
+static void
+BufferStatsAdd(BufferStatsEntry *entry, const uint64 *counts)
+{
+	int			i;
+
+	for (i = 0; i < BUFSTATS_NUM_COUNTERS; i++)
+	{
+		if (counts[i] != 0)
+			pg_atomic_fetch_add_u64(&entry->counts[i], counts[i]);
+	}
+}
+
+/*
+ * Subroutine of BufferStatsFlush: flush pending counts unconditionally.
+ *
+ * Relations that have counters already only need the lock in shared mode;
+ * it is taken in exclusive mode only if there are new relations to add.
+ */
+static void
+BufferStatsFlushPending(void)
+{
+	bool		have_new = false;
+	int			i,
+				j;
+
+	LWLockAcquire(BufferStatsLock, LW_SHARED);
+
+	for (i = 0; i < BUFSTATS_PENDING_SLOTS; i++)
+	{
+		BufferStatsRelation *pending = &pendingRels[i];
+		BufferStatsEntry *entry;
+
+		if (pending->rnode.relNode == InvalidOid)
+			continue;
+
+		entry = (BufferStatsEntry *) hash_search(BufferStatsHash,
+												 &pending->rnode,
+												 HASH_FIND, NULL);
+		if (entry == NULL)
+		{
+			have_new = true;
+			continue;
+		}
+
+		BufferStatsAdd(entry, pending->counts);
+		MemSet(pending, 0, sizeof(BufferStatsRelation));
+	}
+
+	BufferStatsAdd(&BufferStats->other, pendingOther.counts);
+	MemSet(&pendingOther, 0, sizeof(BufferStatsRelation));
+
+	for (i = 0; i < BUFSTATS_NUM_STRATEGIES; i++)
+	{
+		for (j = 0; j < BUFSTATS_NUM_COUNTERS; j++)
+		{
+			if (pendingStrategies[i][j] != 0)
+				pg_atomic_fetch_add_u64(&BufferStats->strategy_counts[i][j],
+										pendingStrategies[i][j]);
+			pendingStrategies[i][j] = 0;
+		}
+	}
+
+	LWLockRelease(BufferStatsLock);
+
+	if (have_new)
+	{
+		LWLockAcquire(BufferStatsLock, LW_EXCLUSIVE);
+
+		for (i = 0; i < BUFSTATS_PENDING_SLOTS; i++)
+		{
+			BufferStatsRelation *pending = &pendingRels[i];
+			BufferStatsEntry *entry;
+			bool		found;
+
+			if (pending->rnode.relNode == InvalidOid)
+				continue;
+
+			entry = (BufferStatsEntry *) hash_search(BufferStatsHash,
+													 &pending->rnode,
+													 HASH_ENTER_NULL, &found);
+			if (entry == NULL)
+				entry = &BufferStats->other;
+			else if (!found)
+			{
+				for (j = 0; j < BUFSTATS_NUM_COUNTERS; j++)
+					pg_atomic_init_u64(&entry->counts[j], 0);
+			}
+
+			BufferStatsAdd(entry, pending->counts);
+			MemSet(pending, 0, sizeof(BufferStatsRelation));
+		}
+
+		LWLockRelease(BufferStatsLock);
+	}
+
+	nPendingRels = 0;
+	lastPendingSlot = 0;
+	havePending = false;
+}
+
+/*
+ * BufferStatsGetRelations
+ *		Return a palloc'd copy of the counters of all relations
+ *
+ * The copy ends with an entry whose rnode is all zeroes, for the relations
+ * that didn't fit.  *nrels is set to the number of entries.
+ */
+BufferStatsRelation *
+BufferStatsGetRelations(int *nrels)
+{
+	BufferStatsRelation *result;
+	BufferStatsEntry *entry;
+	HASH_SEQ_STATUS status;
+	int			n = 0;
+	int			i;
+
+	LWLockAcquire(BufferStatsLock, LW_SHARED);
+
+	result = palloc((hash_get_num_entries(BufferStatsHash) + 1) *
+					sizeof(BufferStatsRelation));
+
+	hash_seq_init(&status, BufferStatsHash);
+	while ((entry = (BufferStatsEntry *) hash_seq_search(&status)) != NULL)
+	{
+		result[n].rnode = entry->rnode;
+		for (i = 0; i < BUFSTATS_NUM_COUNTERS; i++)
+			result[n].counts[i] = pg_atomic_read_u64(&entry->counts[i]);
+		n++;
+	}
+
+	result[n].rnode = BufferStats->other.rnode;
+	for (i = 0; i < BUFSTATS_NUM_COUNTERS; i++)
+		result[n].counts[i] = pg_atomic_read_u64(&BufferStats->other.counts[i]);
+	n++;
+
+	LWLockRelease(BufferStatsLock);
+
+	*nrels = n;
+	return result;
+}
+
+/*
+ * BufferStatsGetStrategies
+ *		Copy the counters of all buffer access strategies
+ */
+void
+BufferStatsGetStrategies(uint64 counts[BUFSTATS_NUM_STRATEGIES][BUFSTATS_NUM_COUNTERS])
+{
+	int			i,
+				j;
+
+	for (i = 0; i < BUFSTATS_NUM_STRATEGIES; i++)
+	{
+		for (j = 0; j < BUFSTATS_NUM_COUNTERS; j++)
+			counts[i][j] = pg_atomic_read_u64(&BufferStats->strategy_counts[i][j]);
+	}
+}
+
+/*
+ * BufferStatsGetResetTimestamp
+ *		Return the time the counters were last reset
+ */
+TimestampTz
+BufferStatsGetResetTimestamp(void)
+{
+	TimestampTz result;
+
+	LWLockAcquire(BufferStatsLock, LW_SHARED);
+	result = BufferStats->reset_timestamp;
+	LWLockRelease(BufferStatsLock);
+
+	return result;
+}
+
+/*
+ * BufferStatsReset
+ *		Reset all shared counters, and forget all relations
+ *
+ * Counts still pending in other processes are added after the reset.
+ */
+void
+BufferStatsReset(void)
+{
+	BufferStatsEntry *entry;
+	HASH_SEQ_STATUS status;
+	int			i,
+				j;
+
+	LWLockAcquire(BufferStatsLock, LW_EXCLUSIVE);
+
+	hash_seq_init(&status, BufferStatsHash);
+	while ((entry = (BufferStatsEntry *) hash_seq_search(&status)) != NULL)
+		hash_search(BufferStatsHash, &entry->rnode, HASH_REMOVE, NULL);
+
+	for (j = 0; j < BUFSTATS_NUM_COUNTERS; j++)
+	{
+		pg_atomic_write_u64(&BufferStats->other.counts[j], 0);
+		for (i = 0; i < BUFSTATS_NUM_STRATEGIES; i++)
+			pg_atomic_write_u64(&BufferStats->strategy_counts[i][j], 0);
+	}
+
+	BufferStats->reset_timestamp = GetCurrentTimestamp();
+
+	LWLockRelease(BufferStatsLock);
+}
@@ -3,12 +3,35 @@
  * buf_table.c
  *	  routines for mapping BufferTags to buffer indexes.
  *
- * Note: the routines in this file do no locking of their own.  The caller
- * must hold a suitable lock on the appropriate BufMappingLock, as specified
+ * Note: the routines in this file do no locking of their own.  Changes
+ * require an exclusive lock on the appropriate BufMappingLock, as specified
  * in the comments.  We can't do the locking inside these functions because
  * in most cases the caller needs to adjust the buffer header contents
  * before the lock is released (see notes in README).
  *
+ * Lookups are also exact while the caller holds at least a share lock on
+ * the tag's BufMappingLock, but they may be done without any lock, too.
+ * An unlocked lookup can miss an entry that is being added or removed, or
+ * return a buffer that is being given a different tag; the caller must pin
+ * the buffer and then check its tag, and retry with the lock held if that
+ * fails (see BufferAlloc).
+ *
+ * The table is an open-addressing hash table of cache-line-sized buckets.
+ * Each bucket has room for a few entries, each of which packs the hash code
+ * of the tag together with the buffer ID into one 64-bit word, so that a
+ * lookup normally reads a single cache line of the table, plus the headers
+ * of the buffers whose tag has the same hash code.  Tags are not stored in
+ * the table; they are compared with the tags in the buffer headers.
+ *
+ * A bucket belongs to the mapping partition given by its number modulo
+ * NUM_BUFFER_PARTITIONS.  An entry goes in the bucket its hash code selects,
+ * which always belongs to the entry's partition, or if that is full, in the
+ * next bucket of the same partition that has room ("next" meaning
+ * NUM_BUFFER_PARTITIONS buckets further on).  Every bucket counts the
+ * entries that were moved past it, so that lookups know whether to look at
+ * the next bucket.  That way, an entry only ever touches buckets of its own
+ * partition, and all changes to a bucket are made under one BufMappingLock.
+ *
  *
  * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -21,18 +44,50 @@
  */
 #include "postgres.h"
 
+#include "common/hashfn.h"
+#include "port/pg_bitutils.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "storage/shmem.h"
+
+/* number of entries in a bucket; with the overflow count, fills 64 bytes */
+#define BUF_TABLE_BUCKET_SLOTS	7
+
+/*
+ * An entry is the tag's hash code in the high half and the buffer ID plus
+ * one in the low half.  Zero marks a free slot.
+ */
+#define BufTableEntry(hashcode, buf_id) \
+	(((uint64) (hashcode) << 32) | (uint64) ((buf_id) + 1))
+#define BufTableEntryHash(entry)	((uint32) ((entry) >> 32))
+#define BufTableEntryBufId(entry)	((int) ((entry) & 0xFFFFFFFF) - 1)
 
-/* entry for buffer lookup hashtable */
-typedef struct
+typedef struct BufTableBucket
 {
-	BufferTag	key;			/* Tag of a disk page */
-	int			id;				/* Associated buffer ID */
-} BufferLookupEnt;
+	pg_atomic_uint64 slots[BUF_TABLE_BUCKET_SLOTS];
+	pg_atomic_uint32 noverflow; /* # of entries placed past this bucket */
+} BufTableBucket;
 
-static HTAB *SharedBufHash;
+static BufTableBucket *SharedBufTable;
+static uint32 SharedBufTableMask;	/* number of buckets - 1 */
 
+/*
+ * Number of buckets for a table of the given size.  This is a power of 2 no
+ * smaller than NUM_BUFFER_PARTITIONS, so that the partition of a bucket is
+ * the partition of the hash codes that select it.  The table is kept less
+ * than half full, and every partition gets at least four buckets, which
+ * makes it very unlikely that any partition ever runs out of room.
+ */
+static uint32
+BufTableNumBuckets(int size)
+{
+	uint32		nbuckets;
+
+	nbuckets = ((uint64) size * 2) / BUF_TABLE_BUCKET_SLOTS + 1;
+	nbuckets = Max(nbuckets, NUM_BUFFER_PARTITIONS * 4);
+
+	return pg_nextpower2_32(nbuckets);
+}
 
 /*
  * Estimate space needed for mapping hashtable
@@ -41,7 +96,8 @@ static HTAB *SharedBufHash;
 Size
 BufTableShmemSize(int size)
 {
-	return hash_estimate_size(size, sizeof(BufferLookupEnt));
+	return add_size(mul_size(BufTableNumBuckets(size), sizeof(BufTableBucket)),
+					PG_CACHE_LINE_SIZE);
 }
 
 /*
@@ -51,19 +107,31 @@ BufTableShmemSize(int size)
 void
 InitBufTable(int size)
 {
-	HASHCTL		info;
+	uint32		nbuckets = BufTableNumBuckets(size);
+	char	   *ptr;
+	bool		found;
 
 	/* assume no locking is needed yet */
 
-	/* BufferTag maps to Buffer */
-	info.keysize = sizeof(BufferTag);
-	info.entrysize = sizeof(BufferLookupEnt);
-	info.num_partitions = NUM_BUFFER_PARTITIONS;
+	ptr = ShmemInitStruct("Shared Buffer Lookup Table",
+						  BufTableShmemSize(size), &found);
+
+	/* Align the buckets to cache lines, so that each takes up only one */
+	SharedBufTable = (BufTableBucket *) TYPEALIGN(PG_CACHE_LINE_SIZE, ptr);
+	SharedBufTableMask = nbuckets - 1;
 
-	SharedBufHash = ShmemInitHash("Shared Buffer Lookup Table",
-								  size, size,
-								  &info,
-								  HASH_ELEM | HASH_BLOBS | HASH_PARTITION);
+	if (!found)
+	{
+		uint32		i;
+		int			j;
+
+		for (i = 0; i < nbuckets; i++)
+		{
+			for (j = 0; j < BUF_TABLE_BUCKET_SLOTS; j++)
+				pg_atomic_init_u64(&SharedBufTable[i].slots[j], 0);
+			pg_atomic_init_u32(&SharedBufTable[i].noverflow, 0);
+		}
+	}
 }
 
 /*
@@ -78,31 +146,56 @@ InitBufTable(int size)
 uint32
 BufTableHashCode(BufferTag *tagPtr)
 {
-	return get_hash_value(SharedBufHash, (void *) tagPtr);
+	return tag_hash((void *) tagPtr, sizeof(BufferTag));
+}
+
+/*
+ * Return the bucket following the given one in the same partition.
+ */
+static inline uint32
+BufTableNextBucket(uint32 bucket)
+{
+	return (bucket + NUM_BUFFER_PARTITIONS) & SharedBufTableMask;
 }
 
 /*
  * BufTableLookup
  *		Lookup the given BufferTag; return buffer ID, or -1 if not found
  *
- * Caller must hold at least share lock on BufMappingLock for tag's partition
+ * The result is only certain if the caller holds at least share lock on
+ * BufMappingLock for tag's partition; see the notes at the top of the file.
  */
 int
 BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 {
-	BufferLookupEnt *result;
+	uint32		bucket = hashcode & SharedBufTableMask;
+	uint32		nbuckets = SharedBufTableMask + 1;
+	uint32		n;
+
+	for (n = 0; n < nbuckets / NUM_BUFFER_PARTITIONS; n++)
+	{
+		BufTableBucket *b = &SharedBufTable[bucket];
+		int			i;
+
+		for (i = 0; i < BUF_TABLE_BUCKET_SLOTS; i++)
+		{
+			uint64		entry = pg_atomic_read_u64(&b->slots[i]);
+			int			buf_id;
+
+			if (entry == 0 || BufTableEntryHash(entry) != hashcode)
+				continue;
 
-	result = (BufferLookupEnt *)
-		hash_search_with_hash_value(SharedBufHash,
-									(void *) tagPtr,
-									hashcode,
-									HASH_FIND,
-									NULL);
+			buf_id = BufTableEntryBufId(entry);
+			if (BUFFERTAGS_EQUAL(GetBufferDescriptor(buf_id)->tag, *tagPtr))
+				return buf_id;
+		}
 
-	if (!result)
-		return -1;
+		if (pg_atomic_read_u32(&b->noverflow) == 0)
+			break;
+		bucket = BufTableNextBucket(bucket);
+	}
 
-	return result->id;
+	return -1;
 }
 
 /*
@@ -113,50 +206,107 @@ BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
  * Returns -1 on successful insertion.  If a conflicting entry exists
  * already, returns the buffer ID in that entry.
  *
+ * Note that the buffer's header doesn't carry the new tag yet, so
+ * lookups don't find the new entry until the caller has set it.
+ *
  * Caller must hold exclusive lock on BufMappingLock for tag's partition
  */
 int
 BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id)
 {
-	BufferLookupEnt *result;
-	bool		found;
+	uint32		bucket;
+	uint32		nbuckets = SharedBufTableMask + 1;
+	uint32		n;
+	int			existing;
 
 	Assert(buf_id >= 0);		/* -1 is reserved for not-in-table */
 	Assert(tagPtr->blockNum != P_NEW);	/* invalid tag */
 
-	result = (BufferLookupEnt *)
-		hash_search_with_hash_value(SharedBufHash,
-									(void *) tagPtr,
-									hashcode,
-									HASH_ENTER,
-									&found);
+	existing = BufTableLookup(tagPtr, hashcode);
+	if (existing >= 0)			/* found something already in the table */
+		return existing;
 
-	if (found)					/* found something already in the table */
-		return result->id;
+	/*
+	 * Find the first bucket with a free slot.  We have to count the entry
+	 * as overflowing the full buckets before it, but readers may not be
+	 * told to look further before the entry is there: first pick the slot,
+	 * then fill it, then bump the counts.
+	 */
+	bucket = hashcode & SharedBufTableMask;
+	for (n = 0; n < nbuckets / NUM_BUFFER_PARTITIONS; n++)
+	{
+		BufTableBucket *b = &SharedBufTable[bucket];
+		int			i;
 
-	result->id = buf_id;
+		for (i = 0; i < BUF_TABLE_BUCKET_SLOTS; i++)
+		{
+			if (pg_atomic_read_u64(&b->slots[i]) == 0)
+			{
+				uint32		home = hashcode & SharedBufTableMask;
 
-	return -1;
+				pg_atomic_write_u64(&b->slots[i],
+									BufTableEntry(hashcode, buf_id));
+
+				for (; home != bucket; home = BufTableNextBucket(home))
+					pg_atomic_fetch_add_u32(&SharedBufTable[home].noverflow, 1);
+
+				return -1;
+			}
+		}
+
+		bucket = BufTableNextBucket(bucket);
+	}
+
+	/*
+	 * The partition is full.  With the table sized as it is, this shouldn't
+	 * happen short of a broken hash function.
+	 */
+	elog(ERROR, "out of shared buffer lookup table slots");
+	return -1;					/* keep compiler quiet */
 }
 
 /*
  * BufTableDelete
- *		Delete the hashtable entry for given tag (which must exist)
+ *		Delete the hashtable entry for given tag and buffer ID (which must
+ *		exist)
+ *
+ * The buffer's header may already carry a different tag, so the entry is
+ * found by its hash code and buffer ID and the tag isn't looked at.
  *
  * Caller must hold exclusive lock on BufMappingLock for tag's partition
  */
 void
-BufTableDelete(BufferTag *tagPtr, uint32 hashcode)
+BufTableDelete(BufferTag *tagPtr, uint32 hashcode, int buf_id)
 {
-	BufferLookupEnt *result;
+	uint64		entry = BufTableEntry(hashcode, buf_id);
+	uint32		home = hashcode & SharedBufTableMask;
+	uint32		bucket = home;
+	uint32		nbuckets = SharedBufTableMask + 1;
+	uint32		n;
+
+	for (n = 0; n < nbuckets / NUM_BUFFER_PARTITIONS; n++)
+	{
+		BufTableBucket *b = &SharedBufTable[bucket];
+		int			i;
+
+		for (i = 0; i < BUF_TABLE_BUCKET_SLOTS; i++)
+		{
+			if (pg_atomic_read_u64(&b->slots[i]) == entry)
+			{
+				pg_atomic_write_u64(&b->slots[i], 0);
+
+				for (; home != bucket; home = BufTableNextBucket(home))
+					pg_atomic_fetch_sub_u32(&SharedBufTable[home].noverflow, 1);
+
+				return;
+			}
+		}
 
-	result = (BufferLookupEnt *)
-		hash_search_with_hash_value(SharedBufHash,
-									(void *) tagPtr,
-									hashcode,
-									HASH_REMOVE,
-									NULL);
+		if (pg_atomic_read_u32(&b->noverflow) == 0)
+			break;
+		bucket = BufTableNextBucket(bucket);
+	}
 
-	if (!result)				/* shouldn't happen */
-		elog(ERROR, "shared buffer hash table corrupted");
+	/* shouldn't happen */
+	elog(ERROR, "shared buffer hash table corrupted");
 }
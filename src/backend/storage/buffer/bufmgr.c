@@ -42,14 +42,18 @@
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
+#include "port/pg_iovec.h"
 #include "postmaster/bgwriter.h"
 #include "storage/buf_internals.h"
+#include "storage/buf_stats.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
 #include "storage/smgr.h"
 #include "storage/standby.h"
 #include "utils/memdebug.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
@@ -120,6 +124,24 @@ typedef struct SMgrSortArray
 	SMgrRelation srel;
 } SMgrSortArray;
 
+/*
+ * State BgBufferSync keeps for each buffer pool partition between calls, so
+ * we can determine the strategy point's advance rate and avoid scanning
+ * already-cleaned buffers.  Buffer IDs are relative to the partition.
+ */
+typedef struct BgSyncPartitionState
+{
+	bool		saved_info_valid;
+	int			prev_strategy_buf_id;
+	uint32		prev_strategy_passes;
+	int			next_to_clean;
+	uint32		next_passes;
+
+	/* Moving averages of allocation rate and clean-buffer density */
+	float		smoothed_alloc;
+	float		smoothed_density;
+} BgSyncPartitionState;
+
 /* GUC variables */
 bool		zero_damaged_pages = false;
 int			bgwriter_lru_maxpages = 100;
@@ -149,9 +171,20 @@ int			checkpoint_flush_after = 0;
 int			bgwriter_flush_after = 0;
 int			backend_flush_after = 0;
 
-/* local state for StartBufferIO and related functions */
-static BufferDesc *InProgressBuf = NULL;
-static bool IsForInput;
+/*
+ * local state for StartBufferIO and related functions
+ *
+ * ReadBuffers keeps I/O in progress on up to MAX_BUFFERS_PER_READ buffers at
+ * a time, and may need to write out one more victim buffer meanwhile.
+ */
+#define MAX_IN_PROGRESS_IO (MAX_BUFFERS_PER_READ + 1)
+
+static BufferDesc *InProgressBufs[MAX_IN_PROGRESS_IO];
+static bool InProgressForInput[MAX_IN_PROGRESS_IO];
+static int	NumInProgressBufs = 0;
+
+StaticAssertDecl(MAX_BUFFERS_PER_READ <= PG_IOV_MAX,
+				 "MAX_BUFFERS_PER_READ must not exceed PG_IOV_MAX");
 
 /* local state for LockBufferForCleanup */
 static BufferDesc *PinCountWaitBuf = NULL;
@@ -453,10 +486,16 @@ static Buffer ReadBuffer_common(SMgrRelation reln, char relpersistence,
 								ForkNumber forkNum, BlockNumber blockNum,
 								ReadBufferMode mode, BufferAccessStrategy strategy,
 								bool *hit);
+static void ReadBuffersRun(SMgrRelation smgr, ForkNumber forkNum,
+						   BlockNumber blockNum, BufferDesc **bufs,
+						   int nblocks, IOContext io_context);
+static IOContext IOContextForStrategy(BufferAccessStrategy strategy);
 static bool PinBuffer(BufferDesc *buf, BufferAccessStrategy strategy);
 static void PinBuffer_Locked(BufferDesc *buf);
 static void UnpinBuffer(BufferDesc *buf, bool fixOwner);
 static void BufferSync(int flags);
+static bool BgBufferSyncPartition(int partition, BgSyncPartitionState *state,
+								  int maxpages, WritebackContext *wb_context);
 static uint32 WaitBufHdrUnlocked(BufferDesc *buf);
 static int	SyncOneBuffer(int buf_id, bool skip_recently_used,
 						  WritebackContext *wb_context);
@@ -472,7 +511,8 @@ static BufferDesc *BufferAlloc(SMgrRelation smgr,
 							   BlockNumber blockNum,
 							   BufferAccessStrategy strategy,
 							   bool *foundPtr);
-static void FlushBuffer(BufferDesc *buf, SMgrRelation reln);
+static void FlushBuffer(BufferDesc *buf, SMgrRelation reln,
+						IOContext io_context);
 static void AtProcExit_Buffers(int code, Datum arg);
 static void CheckForBufferLeaks(void);
 static int	rnode_comparator(const void *p1, const void *p2);
@@ -706,6 +746,202 @@ ReadBufferWithoutRelcache(RelFileNode rnode, ForkNumber forkNum,
 							 mode, strategy, &hit);
 }
 
+/*
+ * IOContextForStrategy -- the context I/O with the given buffer access
+ *		strategy is counted in, for pg_stat_io
+ */
+static IOContext
+IOContextForStrategy(BufferAccessStrategy strategy)
+{
+	switch (GetAccessStrategyType(strategy))
+	{
+		case BAS_NORMAL:
+			return IOCONTEXT_NORMAL;
+		case BAS_BULKREAD:
+			return IOCONTEXT_BULKREAD;
+		case BAS_BULKWRITE:
+			return IOCONTEXT_BULKWRITE;
+		case BAS_VACUUM:
+			return IOCONTEXT_VACUUM;
+	}
+
+	elog(ERROR, "unrecognized BufferAccessStrategyType");
+	return IOCONTEXT_NORMAL;	/* keep compiler quiet */
+}
+
+/*
+ * ReadBuffers -- pin a range of consecutive blocks of a relation
+ *
+ * This fills buffers[i] with what ReadBufferExtended would return for block
+ * blockNum + i in RBM_NORMAL mode, for each i below nblocks.  The difference
+ * is that each run of blocks that are not in shared buffers yet is read with
+ * a single smgrreadv call, instead of one read per block.  nblocks must be
+ * between 1 and MAX_BUFFERS_PER_READ, and should be comfortably less than
+ * the number of buffers the strategy, if any, cycles through, since all of
+ * the buffers stay pinned until the caller releases them.
+ *
+ * The blocks are pinned in ascending order and I/O is kept in progress on
+ * the buffers of the current run until it has been read.  Because every
+ * ReadBuffers caller works its way up through the blocks the same way,
+ * waiting for another backend's I/O on a later block can't deadlock.
+ */
+void
+ReadBuffers(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
+			int nblocks, Buffer *buffers, BufferAccessStrategy strategy)
+{
+	SMgrRelation smgr;
+	BufferDesc *run[MAX_BUFFERS_PER_READ];
+	int			nrun = 0;
+	IOContext	io_context = IOContextForStrategy(strategy);
+	int			i;
+
+	Assert(nblocks > 0 && nblocks <= MAX_BUFFERS_PER_READ);
+
+	/* Local buffers can't have I/O in progress; just read them one by one */
+	if (RelationUsesLocalBuffers(reln))
+	{
+		for (i = 0; i < nblocks; i++)
+			buffers[i] = ReadBufferExtended(reln, forkNum, blockNum + i,
+											RBM_NORMAL, strategy);
+		return;
+	}
+
+	/* Open it at the smgr level if not already done */
+	RelationOpenSmgr(reln);
+	smgr = reln->rd_smgr;
+
+	for (i = 0; i < nblocks; i++)
+	{
+		BufferDesc *bufHdr;
+		bool		found;
+
+		/* Make sure we will have room to remember the buffer pin */
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
+		TRACE_POSTGRESQL_BUFFER_READ_START(forkNum, blockNum + i,
+										   smgr->smgr_rnode.node.spcNode,
+										   smgr->smgr_rnode.node.dbNode,
+										   smgr->smgr_rnode.node.relNode,
+										   smgr->smgr_rnode.backend,
+										   false);
+
+		pgstat_count_buffer_read(reln);
+		bufHdr = BufferAlloc(smgr, reln->rd_rel->relpersistence, forkNum,
+							 blockNum + i, strategy, &found);
+		buffers[i] = BufferDescriptorGetBuffer(bufHdr);
+
+		if (!found)
+		{
+			pgBufferUsage.shared_blks_read++;
+			pgstat_count_buffer_usage_strategy(&smgr->smgr_rnode.node,
+											   strategy, BUFSTATS_READ);
+			run[nrun++] = bufHdr;
+			continue;
+		}
+
+		/* a block that is already valid ends the current run */
+		ReadBuffersRun(smgr, forkNum, blockNum + i - nrun, run, nrun,
+					   io_context);
+		nrun = 0;
+
+		pgstat_count_buffer_hit(reln);
+		pgBufferUsage.shared_blks_hit++;
+		pgstat_count_buffer_usage_strategy(&smgr->smgr_rnode.node,
+										   strategy, BUFSTATS_HIT);
+		pgstat_count_io_op(IOOBJECT_RELATION, io_context, IOOP_HIT);
+		VacuumPageHit++;
+		if (VacuumCostActive)
+			VacuumCostBalance += VacuumCostPageHit;
+
+		TRACE_POSTGRESQL_BUFFER_READ_DONE(forkNum, blockNum + i,
+										  smgr->smgr_rnode.node.spcNode,
+										  smgr->smgr_rnode.node.dbNode,
+										  smgr->smgr_rnode.node.relNode,
+										  smgr->smgr_rnode.backend,
+										  false,
+										  true);
+	}
+
+	ReadBuffersRun(smgr, forkNum, blockNum + nblocks - nrun, run, nrun,
+				   io_context);
+}
+
+/*
+ * ReadBuffersRun -- subroutine for ReadBuffers
+ *
+ * Reads nblocks consecutive blocks starting at blockNum into the given
+ * buffers, which BufferAlloc has marked IO_IN_PROGRESS, and marks them
+ * valid.  The pages are checked like in ReadBuffer_common.
+ */
+static void
+ReadBuffersRun(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
+			   BufferDesc **bufs, int nblocks, IOContext io_context)
+{
+	char	   *blocks[MAX_BUFFERS_PER_READ];
+	instr_time	io_start,
+				io_time;
+	int			i;
+
+	if (nblocks == 0)
+		return;
+
+	for (i = 0; i < nblocks; i++)
+		blocks[i] = (char *) BufHdrGetBlock(bufs[i]);
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
+	smgrreadv(smgr, forkNum, blockNum, blocks, nblocks);
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
+		INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+		pgstat_count_io_time(IOOBJECT_RELATION, io_context, IOOP_READ,
+							 io_time);
+	}
+	pgstat_count_io_op_n(IOOBJECT_RELATION, io_context, IOOP_READ, nblocks);
+
+	for (i = 0; i < nblocks; i++)
+	{
+		/* check for garbage data */
+		if (!PageIsVerified((Page) blocks[i], blockNum + i))
+		{
+			if (zero_damaged_pages)
+			{
+				ereport(WARNING,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("invalid page in block %u of relation %s; zeroing out page",
+								blockNum + i,
+								relpath(smgr->smgr_rnode, forkNum))));
+				MemSet(blocks[i], 0, BLCKSZ);
+			}
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("invalid page in block %u of relation %s",
+								blockNum + i,
+								relpath(smgr->smgr_rnode, forkNum))));
+		}
+
+		/* Set BM_VALID, terminate IO, and wake up any waiters */
+		TerminateBufferIO(bufs[i], false, BM_VALID);
+
+		VacuumPageMiss++;
+		if (VacuumCostActive)
+			VacuumCostBalance += VacuumCostPageMiss;
+
+		TRACE_POSTGRESQL_BUFFER_READ_DONE(forkNum, blockNum + i,
+										  smgr->smgr_rnode.node.spcNode,
+										  smgr->smgr_rnode.node.dbNode,
+										  smgr->smgr_rnode.node.relNode,
+										  smgr->smgr_rnode.backend,
+										  false,
+										  false);
+	}
+}
 
 /*
  * ReadBuffer_common -- common logic for all ReadBuffer variants
@@ -722,6 +958,8 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	bool		found;
 	bool		isExtend;
 	bool		isLocalBuf = SmgrIsTemp(smgr);
+	IOObject	io_object;
+	IOContext	io_context;
 
 	*hit = false;
 
@@ -743,6 +981,10 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	if (isLocalBuf)
 	{
+		/* local buffers don't use buffer access strategies */
+		io_object = IOOBJECT_TEMP_RELATION;
+		io_context = IOCONTEXT_NORMAL;
+
 		bufHdr = LocalBufferAlloc(smgr, forkNum, blockNum, &found);
 		if (found)
 			pgBufferUsage.local_blks_hit++;
@@ -754,6 +996,9 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	}
 	else
 	{
+		io_object = IOOBJECT_RELATION;
+		io_context = IOContextForStrategy(strategy);
+
 		/*
 		 * lookup the buffer.  IO_IN_PROGRESS is set if the requested block is
 		 * not currently in memory.
@@ -761,12 +1006,20 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		bufHdr = BufferAlloc(smgr, relpersistence, forkNum, blockNum,
 							 strategy, &found);
 		if (found)
+		{
 			pgBufferUsage.shared_blks_hit++;
+			pgstat_count_buffer_usage_strategy(&smgr->smgr_rnode.node,
+											   strategy, BUFSTATS_HIT);
+		}
 		else if (isExtend)
 			pgBufferUsage.shared_blks_written++;
 		else if (mode == RBM_NORMAL || mode == RBM_NORMAL_NO_LOG ||
 				 mode == RBM_ZERO_ON_ERROR)
+		{
 			pgBufferUsage.shared_blks_read++;
+			pgstat_count_buffer_usage_strategy(&smgr->smgr_rnode.node,
+											   strategy, BUFSTATS_READ);
+		}
 	}
 
 	/* At this point we do NOT hold any locks. */
@@ -779,6 +1032,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			/* Just need to update stats before we exit */
 			*hit = true;
 			VacuumPageHit++;
+			pgstat_count_io_op(io_object, io_context, IOOP_HIT);
 
 			if (VacuumCostActive)
 				VacuumCostBalance += VacuumCostPageHit;
@@ -878,11 +1132,26 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	if (isExtend)
 	{
+		instr_time	io_start,
+					io_time;
+
 		/* new buffers are zero-filled */
 		MemSet((char *) bufBlock, 0, BLCKSZ);
+
+		if (track_io_timing)
+			INSTR_TIME_SET_CURRENT(io_start);
+
 		/* don't set checksum for all-zero page */
 		smgrextend(smgr, forkNum, blockNum, (char *) bufBlock, false);
 
+		if (track_io_timing)
+		{
+			INSTR_TIME_SET_CURRENT(io_time);
+			INSTR_TIME_SUBTRACT(io_time, io_start);
+			pgstat_count_io_time(io_object, io_context, IOOP_EXTEND, io_time);
+		}
+		pgstat_count_io_op(io_object, io_context, IOOP_EXTEND);
+
 		/*
 		 * NB: we're *not* doing a ScheduleBufferTagForWriteback here;
 		 * although we're essentially performing a write. At least on linux
@@ -914,7 +1183,10 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				INSTR_TIME_SUBTRACT(io_time, io_start);
 				pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
 				INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+				pgstat_count_io_time(io_object, io_context, IOOP_READ,
+									 io_time);
 			}
+			pgstat_count_io_op(io_object, io_context, IOOP_READ);
 
 			/* check for garbage data */
 			if (!PageIsVerified((Page) bufBlock, blockNum))
@@ -1019,6 +1291,8 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	BufferDesc *buf;
 	bool		valid;
 	uint32		buf_state;
+	bool		from_ring;
+	IOContext	io_context = IOContextForStrategy(strategy);
 
 	/* create a tag so we can lookup the buffer */
 	INIT_BUFFERTAG(newTag, smgr->smgr_rnode.node, forkNum, blockNum);
@@ -1027,6 +1301,35 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
+	/*
+	 * First try to find and pin the buffer without the mapping lock.  The
+	 * lookup can be wrong while the mapping is being changed, but once we
+	 * hold a pin the buffer can't be given a new tag, so if it still has the
+	 * tag we were after it's the right buffer.  Otherwise, drop the pin and
+	 * do it the hard way.
+	 */
+	buf_id = BufTableLookup(&newTag, newHash);
+	if (buf_id >= 0)
+	{
+		buf = GetBufferDescriptor(buf_id);
+
+		valid = PinBuffer(buf, strategy);
+
+		if (BUFFERTAGS_EQUAL(buf->tag, newTag) &&
+			(pg_atomic_read_u32(&buf->state) & BM_TAG_VALID))
+		{
+			*foundPtr = true;
+
+			/* see below */
+			if (!valid && StartBufferIO(buf, true))
+				*foundPtr = false;
+
+			return buf;
+		}
+
+		UnpinBuffer(buf, true);
+	}
+
 	/* see if the block is in the buffer pool already */
 	LWLockAcquire(newPartitionLock, LW_SHARED);
 	buf_id = BufTableLookup(&newTag, newHash);
@@ -1087,7 +1390,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		 * Select a victim buffer.  The buffer is returned with its header
 		 * spinlock still held!
 		 */
-		buf = StrategyGetBuffer(strategy, &buf_state);
+		buf = StrategyGetBuffer(strategy, &buf_state, &from_ring);
 
 		Assert(BUF_STATE_GET_REFCOUNT(buf_state) == 0);
 
@@ -1156,9 +1459,13 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 														  smgr->smgr_rnode.node.dbNode,
 														  smgr->smgr_rnode.node.relNode);
 
-				FlushBuffer(buf, NULL);
+				FlushBuffer(buf, NULL, io_context);
 				LWLockRelease(BufferDescriptorGetContentLock(buf));
 
+				if (track_buffer_usage)
+					BufferStatsCountStrategy(strategy,
+											 BUFSTATS_WRITTEN_BACKEND);
+
 				ScheduleBufferTagForWriteback(&BackendWritebackContext,
 											  &buf->tag);
 
@@ -1296,7 +1603,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			break;
 
 		UnlockBufHdr(buf, buf_state);
-		BufTableDelete(&newTag, newHash);
+		BufTableDelete(&newTag, newHash, buf->buf_id);
 		if (oldPartitionLock != NULL &&
 			oldPartitionLock != newPartitionLock)
 			LWLockRelease(oldPartitionLock);
@@ -1330,13 +1637,27 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	if (oldPartitionLock != NULL)
 	{
-		BufTableDelete(&oldTag, oldHash);
+		BufTableDelete(&oldTag, oldHash, buf->buf_id);
 		if (oldPartitionLock != newPartitionLock)
 			LWLockRelease(oldPartitionLock);
 	}
 
 	LWLockRelease(newPartitionLock);
 
+	/* the old contents count as evicted, by whoever needed the buffer */
+	if (oldPartitionLock != NULL)
+	{
+		pgstat_count_buffer_usage_strategy(&oldTag.rnode, strategy,
+										   BUFSTATS_EVICTED);
+
+		/*
+		 * A buffer the strategy had used before is reused rather than
+		 * evicted from the point of view of the buffer pool as a whole.
+		 */
+		pgstat_count_io_op(IOOBJECT_RELATION, io_context,
+						   from_ring ? IOOP_REUSE : IOOP_EVICT);
+	}
+
 	/*
 	 * Buffer contents are currently invalid.  Try to get the io_in_progress
 	 * lock.  If StartBufferIO returns false, then someone else managed to
@@ -1443,7 +1764,7 @@ retry:
 	 * Remove the buffer from the lookup hashtable, if it was in there.
 	 */
 	if (oldFlags & BM_TAG_VALID)
-		BufTableDelete(&oldTag, oldHash);
+		BufTableDelete(&oldTag, oldHash, buf->buf_id);
 
 	/*
 	 * Done with mapping lock.
@@ -1510,6 +1831,7 @@ MarkBufferDirty(Buffer buffer)
 	{
 		VacuumPageDirty++;
 		pgBufferUsage.shared_blks_dirtied++;
+		pgstat_count_buffer_usage(&bufHdr->tag.rnode, BUFSTATS_DIRTIED);
 		if (VacuumCostActive)
 			VacuumCostBalance += VacuumCostPageDirty;
 	}
@@ -2096,36 +2418,64 @@ BufferSync(int flags)
 /*
  * BgBufferSync -- Write out some dirty buffers in the pool.
  *
- * This is called periodically by the background writer process.
+ * This is called periodically by the background writer process.  Each
+ * partition of the buffer pool has a clock sweep of its own (see
+ * freelist.c), so this cleans ahead of each of them in turn, giving each an
+ * equal share of bgwriter_lru_maxpages.
  *
  * Returns true if it's appropriate for the bgwriter process to go into
- * low-power hibernation mode.  (This happens if the strategy clock sweep
- * has been "lapped" and no buffer allocations have occurred recently,
+ * low-power hibernation mode.  (This happens if the strategy clock sweeps
+ * have all been "lapped" and no buffer allocations have occurred recently,
  * or if the bgwriter has been effectively disabled by setting
  * bgwriter_lru_maxpages to 0.)
  */
 bool
 BgBufferSync(WritebackContext *wb_context)
+{
+	static BgSyncPartitionState *partition_state = NULL;
+	int			nparts = StrategyNumPartitions();
+	int			maxpages;
+	bool		hibernate = true;
+	int			i;
+
+	if (partition_state == NULL)
+	{
+		partition_state = (BgSyncPartitionState *)
+			MemoryContextAllocZero(TopMemoryContext,
+								   nparts * sizeof(BgSyncPartitionState));
+		for (i = 0; i < nparts; i++)
+			partition_state[i].smoothed_density = 10.0;
+	}
+
+	maxpages = (bgwriter_lru_maxpages + nparts - 1) / nparts;
+
+	for (i = 0; i < nparts; i++)
+	{
+		if (!BgBufferSyncPartition(i, &partition_state[i], maxpages,
+								   wb_context))
+			hibernate = false;
+	}
+
+	return hibernate;
+}
+
+/*
+ * BgBufferSyncPartition -- the work of BgBufferSync for one partition
+ *
+ * The buffer IDs handled here are relative to the start of the partition,
+ * as with StrategySyncStart.  Returns true if the partition is idle.
+ */
+static bool
+BgBufferSyncPartition(int partition, BgSyncPartitionState *state,
+					  int maxpages, WritebackContext *wb_context)
 {
 	/* info obtained from freelist.c */
+	int			first_buffer;
+	int			num_buffers;
 	int			strategy_buf_id;
 	uint32		strategy_passes;
 	uint32		recent_alloc;
 
-	/*
-	 * Information saved between calls so we can determine the strategy
-	 * point's advance rate and avoid scanning already-cleaned buffers.
-	 */
-	static bool saved_info_valid = false;
-	static int	prev_strategy_buf_id;
-	static uint32 prev_strategy_passes;
-	static int	next_to_clean;
-	static uint32 next_passes;
-
-	/* Moving averages of allocation rate and clean-buffer density */
-	static float smoothed_alloc = 0;
-	static float smoothed_density = 10.0;
-
 	/* Potentially these could be tunables, but for now, not */
 	float		smoothing_samples = 16;
 	float		scan_whole_pool_milliseconds = 120000.0;
@@ -2152,7 +2502,9 @@ BgBufferSync(WritebackContext *wb_context)
 	 * Find out where the freelist clock sweep currently is, and how many
 	 * buffer allocations have happened since our last call.
 	 */
-	strategy_buf_id = StrategySyncStart(&strategy_passes, &recent_alloc);
+	StrategyPartitionRange(partition, &first_buffer, &num_buffers);
+	strategy_buf_id = StrategySyncStart(partition, &strategy_passes,
+										&recent_alloc);
 
 	/* Report buffer alloc counts to pgstat */
 	BgWriterStats.m_buf_alloc += recent_alloc;
@@ -2164,7 +2516,7 @@ BgBufferSync(WritebackContext *wb_context)
 	 */
 	if (bgwriter_lru_maxpages <= 0)
 	{
-		saved_info_valid = false;
+		state->saved_info_valid = false;
 		return true;
 	}
 
@@ -2176,34 +2528,34 @@ BgBufferSync(WritebackContext *wb_context)
 	 * weird-looking coding of xxx_passes comparisons are to avoid bogus
 	 * behavior when the passes counts wrap around.
 	 */
-	if (saved_info_valid)
+	if (state->saved_info_valid)
 	{
-		int32		passes_delta = strategy_passes - prev_strategy_passes;
+		int32		passes_delta = strategy_passes - state->prev_strategy_passes;
 
-		strategy_delta = strategy_buf_id - prev_strategy_buf_id;
-		strategy_delta += (long) passes_delta * NBuffers;
+		strategy_delta = strategy_buf_id - state->prev_strategy_buf_id;
+		strategy_delta += (long) passes_delta * num_buffers;
 
 		Assert(strategy_delta >= 0);
 
-		if ((int32) (next_passes - strategy_passes) > 0)
+		if ((int32) (state->next_passes - strategy_passes) > 0)
 		{
 			/* we're one pass ahead of the strategy point */
-			bufs_to_lap = strategy_buf_id - next_to_clean;
+			bufs_to_lap = strategy_buf_id - state->next_to_clean;
 #ifdef BGW_DEBUG
 			elog(DEBUG2, "bgwriter ahead: bgw %u-%u strategy %u-%u delta=%ld lap=%d",
-				 next_passes, next_to_clean,
+				 state->next_passes, state->next_to_clean,
 				 strategy_passes, strategy_buf_id,
 				 strategy_delta, bufs_to_lap);
 #endif
 		}
-		else if (next_passes == strategy_passes &&
-				 next_to_clean >= strategy_buf_id)
+		else if (state->next_passes == strategy_passes &&
+				 state->next_to_clean >= strategy_buf_id)
 		{
 			/* on same pass, but ahead or at least not behind */
-			bufs_to_lap = NBuffers - (next_to_clean - strategy_buf_id);
+			bufs_to_lap = num_buffers - (state->next_to_clean - strategy_buf_id);
 #ifdef BGW_DEBUG
 			elog(DEBUG2, "bgwriter ahead: bgw %u-%u strategy %u-%u delta=%ld lap=%d",
-				 next_passes, next_to_clean,
+				 state->next_passes, state->next_to_clean,
 				 strategy_passes, strategy_buf_id,
 				 strategy_delta, bufs_to_lap);
 #endif
@@ -2216,13 +2568,13 @@ BgBufferSync(WritebackContext *wb_context)
 			 */
 #ifdef BGW_DEBUG
 			elog(DEBUG2, "bgwriter behind: bgw %u-%u strategy %u-%u delta=%ld",
-				 next_passes, next_to_clean,
+				 state->next_passes, state->next_to_clean,
 				 strategy_passes, strategy_buf_id,
 				 strategy_delta);
 #endif
-			next_to_clean = strategy_buf_id;
-			next_passes = strategy_passes;
-			bufs_to_lap = NBuffers;
+			state->next_to_clean = strategy_buf_id;
+			state->next_passes = strategy_passes;
+			bufs_to_lap = num_buffers;
 		}
 	}
 	else
@@ -2236,15 +2588,15 @@ BgBufferSync(WritebackContext *wb_context)
 			 strategy_passes, strategy_buf_id);
 #endif
 		strategy_delta = 0;
-		next_to_clean = strategy_buf_id;
-		next_passes = strategy_passes;
-		bufs_to_lap = NBuffers;
+		state->next_to_clean = strategy_buf_id;
+		state->next_passes = strategy_passes;
+		bufs_to_lap = num_buffers;
 	}
 
 	/* Update saved info for next time */
-	prev_strategy_buf_id = strategy_buf_id;
-	prev_strategy_passes = strategy_passes;
-	saved_info_valid = true;
+	state->prev_strategy_buf_id = strategy_buf_id;
+	state->prev_strategy_passes = strategy_passes;
+	state->saved_info_valid = true;
 
 	/*
 	 * Compute how many buffers had to be scanned for each new allocation, ie,
@@ -2255,7 +2607,7 @@ BgBufferSync(WritebackContext *wb_context)
 	if (strategy_delta > 0 && recent_alloc > 0)
 	{
 		scans_per_alloc = (float) strategy_delta / (float) recent_alloc;
-		smoothed_density += (scans_per_alloc - smoothed_density) /
+		state->smoothed_density += (scans_per_alloc - state->smoothed_density) /
 			smoothing_samples;
 	}
 
@@ -2264,22 +2616,22 @@ BgBufferSync(WritebackContext *wb_context)
 	 * strategy point and where we've scanned ahead to, based on the smoothed
 	 * density estimate.
 	 */
-	bufs_ahead = NBuffers - bufs_to_lap;
-	reusable_buffers_est = (float) bufs_ahead / smoothed_density;
+	bufs_ahead = num_buffers - bufs_to_lap;
+	reusable_buffers_est = (float) bufs_ahead / state->smoothed_density;
 
 	/*
 	 * Track a moving average of recent buffer allocations.  Here, rather than
 	 * a true average we want a fast-attack, slow-decline behavior: we
 	 * immediately follow any increase.
 	 */
-	if (smoothed_alloc <= (float) recent_alloc)
-		smoothed_alloc = recent_alloc;
+	if (state->smoothed_alloc <= (float) recent_alloc)
+		state->smoothed_alloc = recent_alloc;
 	else
-		smoothed_alloc += ((float) recent_alloc - smoothed_alloc) /
+		state->smoothed_alloc += ((float) recent_alloc - state->smoothed_alloc) /
 			smoothing_samples;
 
 	/* Scale the estimate by a GUC to allow more aggressive tuning. */
-	upcoming_alloc_est = (int) (smoothed_alloc * bgwriter_lru_multiplier);
+	upcoming_alloc_est = (int) (state->smoothed_alloc * bgwriter_lru_multiplier);
 
 	/*
 	 * If recent_alloc remains at zero for many cycles, smoothed_alloc will
@@ -2290,7 +2642,7 @@ BgBufferSync(WritebackContext *wb_context)
 	 * syndrome.  It will pop back up as soon as recent_alloc increases.
 	 */
 	if (upcoming_alloc_est == 0)
-		smoothed_alloc = 0;
+		state->smoothed_alloc = 0;
 
 	/*
 	 * Even in cases where there's been little or no buffer allocation
@@ -2300,9 +2652,9 @@ BgBufferSync(WritebackContext *wb_context)
 	 *
 	 * (scan_whole_pool_milliseconds / BgWriterDelay) computes how many times
 	 * the BGW will be called during the scan_whole_pool time; slice the
-	 * buffer pool into that many sections.
+	 * partition into that many sections.
 	 */
-	min_scan_buffers = (int) (NBuffers / (scan_whole_pool_milliseconds / BgWriterDelay));
+	min_scan_buffers = (int) (num_buffers / (scan_whole_pool_milliseconds / BgWriterDelay));
 
 	if (upcoming_alloc_est < (min_scan_buffers + reusable_buffers_est))
 	{
@@ -2317,7 +2669,7 @@ BgBufferSync(WritebackContext *wb_context)
 	 * Now write out dirty reusable buffers, working forward from the
 	 * next_to_clean point, until we have lapped the strategy scan, or cleaned
 	 * enough buffers to match our estimate of the next cycle's allocation
-	 * requirements, or hit the bgwriter_lru_maxpages limit.
+	 * requirements, or hit the partition's share of bgwriter_lru_maxpages.
 	 */
 
 	/* Make sure we can handle the pin inside SyncOneBuffer */
@@ -2330,20 +2682,20 @@ BgBufferSync(WritebackContext *wb_context)
 	/* Execute the LRU scan */
 	while (num_to_scan > 0 && reusable_buffers < upcoming_alloc_est)
 	{
-		int			sync_state = SyncOneBuffer(next_to_clean, true,
-											   wb_context);
+		int			sync_state = SyncOneBuffer(first_buffer + state->next_to_clean,
+											   true, wb_context);
 
-		if (++next_to_clean >= NBuffers)
+		if (++state->next_to_clean >= num_buffers)
 		{
-			next_to_clean = 0;
-			next_passes++;
+			state->next_to_clean = 0;
+			state->next_passes++;
 		}
 		num_to_scan--;
 
 		if (sync_state & BUF_WRITTEN)
 		{
 			reusable_buffers++;
-			if (++num_written >= bgwriter_lru_maxpages)
+			if (++num_written >= maxpages)
 			{
 				BgWriterStats.m_maxwritten_clean++;
 				break;
@@ -2357,8 +2709,8 @@ BgBufferSync(WritebackContext *wb_context)
 
 #ifdef BGW_DEBUG
 	elog(DEBUG1, "bgwriter: recent_alloc=%u smoothed=%.2f delta=%ld ahead=%d density=%.2f reusable_est=%d upcoming_est=%d scanned=%d wrote=%d reusable=%d",
-		 recent_alloc, smoothed_alloc, strategy_delta, bufs_ahead,
-		 smoothed_density, reusable_buffers_est, upcoming_alloc_est,
+		 recent_alloc, state->smoothed_alloc, strategy_delta, bufs_ahead,
+		 state->smoothed_density, reusable_buffers_est, upcoming_alloc_est,
 		 bufs_to_lap - num_to_scan,
 		 num_written,
 		 reusable_buffers - reusable_buffers_est);
@@ -2377,17 +2729,17 @@ BgBufferSync(WritebackContext *wb_context)
 	if (new_strategy_delta > 0 && new_recent_alloc > 0)
 	{
 		scans_per_alloc = (float) new_strategy_delta / (float) new_recent_alloc;
-		smoothed_density += (scans_per_alloc - smoothed_density) /
+		state->smoothed_density += (scans_per_alloc - state->smoothed_density) /
 			smoothing_samples;
 
 #ifdef BGW_DEBUG
 		elog(DEBUG2, "bgwriter: cleaner density alloc=%u scan=%ld density=%.2f new smoothed=%.2f",
 			 new_recent_alloc, new_strategy_delta,
-			 scans_per_alloc, smoothed_density);
+			 scans_per_alloc, state->smoothed_density);
 #endif
 	}
 
-	/* Return true if OK to hibernate */
+	/* Return true if the partition is idle */
 	return (bufs_to_lap == 0 && recent_alloc == 0);
 }
 
@@ -2454,7 +2806,7 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	PinBuffer_Locked(bufHdr);
 	LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
 
-	FlushBuffer(bufHdr, NULL);
+	FlushBuffer(bufHdr, NULL, IOCONTEXT_NORMAL);
 
 	LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 
@@ -2467,6 +2819,87 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	return result | BUF_WRITTEN;
 }
 
+/*
+ * BufferSyncCold -- write out dirty buffers that have not been modified
+ *		in a while
+ *
+ * The checkpointer calls this between checkpoints, so that the dirty
+ * buffers of the buffer pool are written out continuously, instead of all
+ * at once at the next checkpoint.  It scans the next nscan buffers of the
+ * pool, continuing where the previous call left off, and writes the dirty
+ * buffers of permanent relations whose page LSN is older than horizon:
+ * those have not been modified since then, and are unlikely to be dirtied
+ * again before the next checkpoint would have to write them anyway.
+ *
+ * Returns the number of buffers written.
+ */
+int
+BufferSyncCold(XLogRecPtr horizon, int nscan)
+{
+	static int	next_to_scan = 0;
+	static WritebackContext wb_context;
+	static bool wb_context_initialized = false;
+	const uint32 mask = BM_VALID | BM_DIRTY | BM_PERMANENT;
+	int			num_written = 0;
+
+	if (!wb_context_initialized)
+	{
+		WritebackContextInit(&wb_context, &checkpoint_flush_after);
+		wb_context_initialized = true;
+	}
+
+	nscan = Min(nscan, NBuffers);
+	while (nscan-- > 0)
+	{
+		BufferDesc *bufHdr = GetBufferDescriptor(next_to_scan);
+		uint32		buf_state;
+		BufferTag	tag;
+
+		if (++next_to_scan >= NBuffers)
+			next_to_scan = 0;
+
+		/* Skip clean buffers without taking the header lock */
+		buf_state = pg_atomic_read_u32(&bufHdr->state);
+		if ((buf_state & mask) != mask)
+			continue;
+
+		ReservePrivateRefCountEntry();
+
+		/*
+		 * We read the page LSN without the content lock, like
+		 * BufferGetLSNAtomic() does.  It might be changing under us, but
+		 * a recently modified page doesn't qualify anyway.
+		 */
+		buf_state = LockBufHdr(bufHdr);
+		if ((buf_state & mask) != mask ||
+			PageGetLSN(BufHdrGetBlock(bufHdr)) >= horizon)
+		{
+			UnlockBufHdr(bufHdr, buf_state);
+			continue;
+		}
+
+		PinBuffer_Locked(bufHdr);
+		LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
+
+		FlushBuffer(bufHdr, NULL, IOCONTEXT_NORMAL);
+
+		LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
+
+		tag = bufHdr->tag;
+
+		UnpinBuffer(bufHdr, true);
+
+		ScheduleBufferTagForWriteback(&wb_context, &tag);
+
+		BgWriterStats.m_buf_written_checkpoints++;
+		num_written++;
+	}
+
+	IssuePendingWritebacks(&wb_context);
+
+	return num_written;
+}
+
 /*
  *		AtEOXact_Buffers - clean up at end of transaction.
  *
@@ -2540,6 +2973,10 @@ AtProcExit_Buffers(int code, Datum arg)
 
 	/* localbuf.c needs a chance too */
 	AtProcExit_LocalBuffers();
+
+	/* don't lose the counts since the last flush */
+	BufferStatsFlush(true);
+	pgstat_flush_io(true);
 }
 
 /*
@@ -2641,7 +3078,9 @@ CheckPointBuffers(int flags)
 	BufferSync(flags);
 	CheckpointStats.ckpt_sync_t = GetCurrentTimestamp();
 	TRACE_POSTGRESQL_BUFFER_CHECKPOINT_SYNC_START();
+	DoubleWriteCheckpointStart();
 	ProcessSyncRequests();
+	DoubleWriteCheckpointDone();
 	CheckpointStats.ckpt_sync_end_t = GetCurrentTimestamp();
 	TRACE_POSTGRESQL_BUFFER_CHECKPOINT_DONE();
 }
@@ -2722,10 +3161,11 @@ BufferGetTag(Buffer buffer, RelFileNode *rnode, ForkNumber *forknum,
  * written.)
  *
  * If the caller has an smgr reference for the buffer's relation, pass it
- * as the second parameter.  If not, pass NULL.
+ * as the second parameter.  If not, pass NULL.  io_context is the context
+ * the write is counted in, for pg_stat_io.
  */
 static void
-FlushBuffer(BufferDesc *buf, SMgrRelation reln)
+FlushBuffer(BufferDesc *buf, SMgrRelation reln, IOContext io_context)
 {
 	XLogRecPtr	recptr;
 	ErrorContextCallback errcallback;
@@ -2734,6 +3174,7 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 	Block		bufBlock;
 	char	   *bufToWrite;
 	uint32		buf_state;
+	int			dwslot = -1;
 
 	/*
 	 * Acquire the buffer's io_in_progress lock.  If StartBufferIO returns
@@ -2805,6 +3246,16 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 	 */
 	bufToWrite = PageSetChecksumCopy((Page) bufBlock, buf->tag.blockNum);
 
+	/*
+	 * If the double-write file protects against torn pages in place of
+	 * full-page images in WAL, write a copy of the page there first.  Pages
+	 * without an LSN were never WAL-logged, so redo won't look at them.
+	 */
+	if ((buf_state & BM_PERMANENT) && !XLogRecPtrIsInvalid(recptr) &&
+		DoubleWriteActive())
+		dwslot = DoubleWriteBegin(buf->tag.rnode, buf->tag.forkNum,
+								  buf->tag.blockNum, bufToWrite);
+
 	if (track_io_timing)
 		INSTR_TIME_SET_CURRENT(io_start);
 
@@ -2817,15 +3268,27 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 			  bufToWrite,
 			  false);
 
+	if (dwslot >= 0)
+		DoubleWriteEnd(dwslot);
+
 	if (track_io_timing)
 	{
 		INSTR_TIME_SET_CURRENT(io_time);
 		INSTR_TIME_SUBTRACT(io_time, io_start);
 		pgstat_count_buffer_write_time(INSTR_TIME_GET_MICROSEC(io_time));
 		INSTR_TIME_ADD(pgBufferUsage.blk_write_time, io_time);
+		pgstat_count_io_time(IOOBJECT_RELATION, io_context, IOOP_WRITE,
+							 io_time);
 	}
+	pgstat_count_io_op(IOOBJECT_RELATION, io_context, IOOP_WRITE);
 
 	pgBufferUsage.shared_blks_written++;
+	pgstat_count_buffer_usage(&buf->tag.rnode,
+							  MyBackendType == B_BG_WRITER ?
+							  BUFSTATS_WRITTEN_BGWRITER :
+							  MyBackendType == B_CHECKPOINTER ?
+							  BUFSTATS_WRITTEN_CHECKPOINTER :
+							  BUFSTATS_WRITTEN_BACKEND);
 
 	/*
 	 * Mark the buffer as clean (unless BM_JUST_DIRTIED has become set) and
@@ -3277,6 +3740,8 @@ FlushRelationBuffers(Relation rel)
 			{
 				ErrorContextCallback errcallback;
 				Page		localpage;
+				instr_time	io_start,
+							io_time;
 
 				localpage = (char *) LocalBufHdrGetBlock(bufHdr);
 
@@ -3288,12 +3753,26 @@ FlushRelationBuffers(Relation rel)
 
 				PageSetChecksumInplace(localpage, bufHdr->tag.blockNum);
 
+				if (track_io_timing)
+					INSTR_TIME_SET_CURRENT(io_start);
+
 				smgrwrite(rel->rd_smgr,
 						  bufHdr->tag.forkNum,
 						  bufHdr->tag.blockNum,
 						  localpage,
 						  false);
 
+				if (track_io_timing)
+				{
+					INSTR_TIME_SET_CURRENT(io_time);
+					INSTR_TIME_SUBTRACT(io_time, io_start);
+					pgstat_count_io_time(IOOBJECT_TEMP_RELATION,
+										 IOCONTEXT_NORMAL, IOOP_WRITE,
+										 io_time);
+				}
+				pgstat_count_io_op(IOOBJECT_TEMP_RELATION, IOCONTEXT_NORMAL,
+								   IOOP_WRITE);
+
 				buf_state &= ~(BM_DIRTY | BM_JUST_DIRTIED);
 				pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
 
@@ -3329,7 +3808,7 @@ FlushRelationBuffers(Relation rel)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, rel->rd_smgr);
+			FlushBuffer(bufHdr, rel->rd_smgr, IOCONTEXT_NORMAL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3425,7 +3904,7 @@ FlushRelationsAllBuffers(SMgrRelation *smgrs, int nrels)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, srelent->srel);
+			FlushBuffer(bufHdr, srelent->srel, IOCONTEXT_NORMAL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3481,7 +3960,7 @@ FlushDatabaseBuffers(Oid dbid)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, NULL);
+			FlushBuffer(bufHdr, NULL, IOCONTEXT_NORMAL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3508,7 +3987,7 @@ FlushOneBuffer(Buffer buffer)
 
 	Assert(LWLockHeldByMe(BufferDescriptorGetContentLock(bufHdr)));
 
-	FlushBuffer(bufHdr, NULL);
+	FlushBuffer(bufHdr, NULL, IOCONTEXT_NORMAL);
 }
 
 /*
@@ -3595,7 +4074,12 @@ MarkBufferDirtyHint(Buffer buffer, bool buffer_std)
 
 	if (BufferIsLocal(buffer))
 	{
-		MarkLocalBufferDirty(buffer);
+		/*
+		 * Parallel workers may be reading the page from disk, so leave it
+		 * alone there; the hint bits are just set in our copy.
+		 */
+		if (!LocalBuffersShared())
+			MarkLocalBufferDirty(buffer);
 		return;
 	}
 
@@ -3710,6 +4194,7 @@ MarkBufferDirtyHint(Buffer buffer, bool buffer_std)
 		{
 			VacuumPageDirty++;
 			pgBufferUsage.shared_blks_dirtied++;
+			pgstat_count_buffer_usage(&bufHdr->tag.rnode, BUFSTATS_DIRTIED);
 			if (VacuumCostActive)
 				VacuumCostBalance += VacuumCostPageDirty;
 		}
@@ -4089,7 +4574,8 @@ WaitIO(BufferDesc *buf)
 /*
  * StartBufferIO: begin I/O on this buffer
  *	(Assumptions)
- *	My process is executing no IO
+ *	My process is executing no IO on this buffer, and fewer than
+ *	MAX_IN_PROGRESS_IO in total
  *	The buffer is Pinned
  *
  * In some scenarios there are race conditions in which multiple backends
@@ -4109,7 +4595,7 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 {
 	uint32		buf_state;
 
-	Assert(!InProgressBuf);
+	Assert(NumInProgressBufs < MAX_IN_PROGRESS_IO);
 
 	for (;;)
 	{
@@ -4148,8 +4634,9 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 	buf_state |= BM_IO_IN_PROGRESS;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = buf;
-	IsForInput = forInput;
+	InProgressBufs[NumInProgressBufs] = buf;
+	InProgressForInput[NumInProgressBufs] = forInput;
+	NumInProgressBufs++;
 
 	return true;
 }
@@ -4175,8 +4662,20 @@ static void
 TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 {
 	uint32		buf_state;
+	int			i;
 
-	Assert(buf == InProgressBuf);
+	/* forget the buffer, keeping the others in the order they started */
+	for (i = 0; i < NumInProgressBufs; i++)
+	{
+		if (InProgressBufs[i] == buf)
+			break;
+	}
+	Assert(i < NumInProgressBufs);
+	NumInProgressBufs--;
+	memmove(&InProgressBufs[i], &InProgressBufs[i + 1],
+			(NumInProgressBufs - i) * sizeof(BufferDesc *));
+	memmove(&InProgressForInput[i], &InProgressForInput[i + 1],
+			(NumInProgressBufs - i) * sizeof(bool));
 
 	buf_state = LockBufHdr(buf);
 
@@ -4189,8 +4688,6 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 	buf_state |= set_flag_bits;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = NULL;
-
 	LWLockRelease(BufferDescriptorGetIOLock(buf));
 }
 
@@ -4198,7 +4695,7 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
  * AbortBufferIO: Clean up any active buffer I/O after an error.
  *
  *	All LWLocks we might have held have been released,
- *	but we haven't yet released buffer pins, so the buffer is still pinned.
+ *	but we haven't yet released buffer pins, so the buffers are still pinned.
  *
  *	If I/O was in progress, we always set BM_IO_ERROR, even though it's
  *	possible the error condition wasn't related to the I/O.
@@ -4206,10 +4703,12 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 void
 AbortBufferIO(void)
 {
-	BufferDesc *buf = InProgressBuf;
+	DoubleWriteAbort();
 
-	if (buf)
+	while (NumInProgressBufs > 0)
 	{
+		BufferDesc *buf = InProgressBufs[NumInProgressBufs - 1];
+		bool		forInput = InProgressForInput[NumInProgressBufs - 1];
 		uint32		buf_state;
 
 		/*
@@ -4222,7 +4721,7 @@ AbortBufferIO(void)
 
 		buf_state = LockBufHdr(buf);
 		Assert(buf_state & BM_IO_IN_PROGRESS);
-		if (IsForInput)
+		if (forInput)
 		{
 			Assert(!(buf_state & BM_DIRTY));
 
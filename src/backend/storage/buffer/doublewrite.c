@@ -0,0 +1,998 @@
+/*-------------------------------------------------------------------------
+ *
+ * doublewrite.c
+ *	  Torn page protection by writing pages to a double-write file first.
+ *
+ * A data page write that is interrupted by an operating system crash can
+ * leave a "torn" page on disk, with a mix of old and new contents.  Redo
+ * cannot repair such a page from the row-level changes in WAL, so normally
+ * the first modification of each page after a checkpoint logs an image of
+ * the whole page (see full_page_writes).  Those images often make up most
+ * of the WAL volume.
+ *
+ * With double_write_buffers set, FlushBuffer() instead writes a copy of
+ * every page of a permanent relation to a slot of the double-write file,
+ * and makes sure the copy has reached stable storage, before it writes the
+ * page to the relation itself.  A write to the data file can then only be
+ * torn while an intact copy exists; crash recovery restores those copies
+ * before replaying WAL, and full-page images are no longer needed for torn
+ * page protection.  xlog.c treats full_page_writes as off while this is
+ * enabled, as long as wal_level is minimal; otherwise the WAL may also be
+ * replayed onto a base backup or by a standby, which our copies don't cover.
+ *
+ * A slot can be reused once the data file write it protects has reached
+ * stable storage.  That happens when the next checkpoint or restartpoint
+ * fsyncs the data files; if we run out of slots before that, the process
+ * that needs one fsyncs the relation forks written through the used slots
+ * itself.  Flushing the double-write file is shared between processes the
+ * same way XLogFlush() shares WAL flushes.
+ *
+ * Slots must not outlive the relations they describe, or recovery could
+ * write an old page into a relation that later reused the relfilenode.
+ * The copies of a relation are therefore durably discarded before its
+ * files are truncated or unlinked, and when its database is dropped.
+ *
+ * Only pages written out through the buffer manager are protected.  Pages
+ * written directly to smgr, such as those of new relation forks built by
+ * CREATE INDEX or copied by ALTER TABLE SET TABLESPACE, are logged in full
+ * or fsync'd before commit anyway.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/buffer/doublewrite.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "access/xlogdefs.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/pg_crc32c.h"
+#include "storage/bufpage.h"
+#include "storage/condition_variable.h"
+#include "storage/doublewrite.h"
+#include "storage/fd.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "utils/memutils.h"
+
+/*
+ * Each slot of the file holds a header, padded to DW_HEADER_SIZE bytes,
+ * followed by the page.
+ */
+#define DW_MAGIC			0x44575031	/* "DWP1" */
+#define DW_HEADER_SIZE		512
+#define DW_SLOT_SIZE		(DW_HEADER_SIZE + BLCKSZ)
+#define DW_SLOT_OFFSET(slotno)	((off_t) (slotno) * DW_SLOT_SIZE)
+
+typedef struct DoubleWriteHeader
+{
+	uint32		magic;			/* DW_MAGIC */
+	pg_crc32c	crc;			/* CRC of the rest of the header and page */
+	uint64		seq;			/* order in which the slot was filled */
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber blkno;
+} DoubleWriteHeader;
+
+StaticAssertDecl(sizeof(DoubleWriteHeader) <= DW_HEADER_SIZE,
+				 "DoubleWriteHeader too large");
+
+/*
+ * Life cycle of a slot.  A slot is FILLING while its owner writes the copy,
+ * WRITTEN once that is done, FLUSHING while some process fsyncs the file,
+ * DURABLE once the copy is on stable storage, UNSYNCED once the owner has
+ * written the data page, and SYNCING while some process fsyncs the data file
+ * in order to free it.
+ */
+typedef enum DoubleWriteSlotState
+{
+	DW_SLOT_FREE = 0,
+	DW_SLOT_FILLING,
+	DW_SLOT_WRITTEN,
+	DW_SLOT_FLUSHING,
+	DW_SLOT_DURABLE,
+	DW_SLOT_UNSYNCED,
+	DW_SLOT_SYNCING
+} DoubleWriteSlotState;
+
+typedef struct DoubleWriteSlot
+{
+	DoubleWriteSlotState state;
+	bool		checkpointed;	/* data page covered by running checkpoint? */
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber blkno;
+} DoubleWriteSlot;
+
+/*
+ * Shared state.  The slot array is protected by DoubleWriteLock, and only
+ * the holder of DoubleWriteSyncLock moves slots to and from FLUSHING.
+ */
+typedef struct DoubleWriteCtlData
+{
+	bool		ready;			/* file initialized after recovery? */
+	bool		reclaiming;		/* somebody syncing data files for slots? */
+	uint64		nextSeq;
+	int			nextSlot;		/* where to start looking for a free slot */
+	ConditionVariable slotFreed;
+	DoubleWriteSlot slots[FLEXIBLE_ARRAY_MEMBER];
+} DoubleWriteCtlData;
+
+/* Relation fork whose data file must be fsync'd to free slots */
+typedef struct DoubleWriteTarget
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+} DoubleWriteTarget;
+
+/* A valid copy found in the file by recovery */
+typedef struct DoubleWriteCopy
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber blkno;
+	XLogRecPtr	lsn;
+	uint64		seq;
+	int			slotno;
+} DoubleWriteCopy;
+
+/* GUC variables */
+int			double_write_buffers = 0;
+
+static DoubleWriteCtlData *DoubleWriteCtl = NULL;
+
+/* Process-local state */
+static File DoubleWriteFile = -1;
+static char *DoubleWriteBuf = NULL;
+static DoubleWriteTarget *ReclaimTargets = NULL;
+static int	MyDoubleWriteSlot = -1;
+
+static int	DoubleWriteAcquireSlot(RelFileNode rnode, ForkNumber forknum,
+								   BlockNumber blkno, uint64 *seq);
+static void DoubleWriteReclaim(void);
+static void DoubleWriteFlush(int slotno);
+static void DoubleWriteDiscard(const RelFileNode *rnode, Oid dbid,
+							   ForkNumber forknum, BlockNumber firstblock);
+static pg_crc32c DoubleWriteChecksum(DoubleWriteHeader *hdr, char *page);
+static int	target_cmp(const void *a, const void *b);
+static int	copy_cmp(const void *a, const void *b);
+
+
+/*
+ * Estimate space needed for double-write slot bookkeeping
+ */
+Size
+DoubleWriteShmemSize(void)
+{
+	if (double_write_buffers <= 0)
+		return 0;
+
+	return add_size(offsetof(DoubleWriteCtlData, slots),
+					mul_size(double_write_buffers, sizeof(DoubleWriteSlot)));
+}
+
+/*
+ * Allocate and initialize double-write shared state
+ */
+void
+DoubleWriteShmemInit(void)
+{
+	bool		found;
+
+	if (double_write_buffers <= 0)
+		return;
+
+	DoubleWriteCtl = (DoubleWriteCtlData *)
+		ShmemInitStruct("Double Write Ctl", DoubleWriteShmemSize(), &found);
+
+	if (!found)
+	{
+		MemSet(DoubleWriteCtl, 0, DoubleWriteShmemSize());
+		ConditionVariableInit(&DoubleWriteCtl->slotFreed);
+	}
+}
+
+/*
+ * DoubleWriteRecover
+ *		Restore torn pages from the double-write file after a crash
+ *
+ * Called by the startup process before WAL replay begins.  The file is
+ * read even if double_write_buffers has been turned off since the crash.
+ * For each page that has valid copies, the most recent one is written back
+ * to the relation, unless the page on disk is already newer, or the
+ * relation has been truncated or dropped in the meantime.  A copy can be
+ * more recent than the page on disk only if a write of the page was
+ * interrupted, and it is never more recent than WAL, which was flushed
+ * before the copy was written.
+ */
+void
+DoubleWriteRecover(void)
+{
+	int			fd;
+	struct stat st;
+	int			nslots;
+	int			ncopies = 0;
+	int			nrestored = 0;
+	DoubleWriteCopy *copies;
+	char	   *buf;
+	PGAlignedBlock diskpage;
+	SMgrRelation reln = NULL;
+	bool		dirty[MAX_FORKNUM + 1];
+	int			i;
+
+	fd = OpenTransientFile(DOUBLE_WRITE_FILE, O_RDONLY | PG_BINARY);
+	if (fd < 0)
+	{
+		if (errno == ENOENT)
+			return;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", DOUBLE_WRITE_FILE)));
+	}
+	if (fstat(fd, &st) < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m", DOUBLE_WRITE_FILE)));
+
+	nslots = st.st_size / DW_SLOT_SIZE;
+	copies = palloc(Max(nslots, 1) * sizeof(DoubleWriteCopy));
+	buf = palloc(DW_SLOT_SIZE);
+
+	/* Collect the valid copies */
+	for (i = 0; i < nslots; i++)
+	{
+		DoubleWriteHeader *hdr = (DoubleWriteHeader *) buf;
+		char	   *page = buf + DW_HEADER_SIZE;
+		int			r;
+
+		pgstat_report_wait_start(WAIT_EVENT_DOUBLE_WRITE_READ);
+		r = pg_pread(fd, buf, DW_SLOT_SIZE, DW_SLOT_OFFSET(i));
+		pgstat_report_wait_end();
+		if (r != DW_SLOT_SIZE)
+		{
+			if (r < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read file \"%s\": %m",
+								DOUBLE_WRITE_FILE)));
+			break;
+		}
+
+		if (hdr->magic != DW_MAGIC ||
+			!EQ_CRC32C(hdr->crc, DoubleWriteChecksum(hdr, page)))
+			continue;
+
+		copies[ncopies].rnode = hdr->rnode;
+		copies[ncopies].forknum = hdr->forknum;
+		copies[ncopies].blkno = hdr->blkno;
+		copies[ncopies].lsn = PageGetLSN((Page) page);
+		copies[ncopies].seq = hdr->seq;
+		copies[ncopies].slotno = i;
+		ncopies++;
+	}
+
+	/* Sort by page, most recent copy first */
+	qsort(copies, ncopies, sizeof(DoubleWriteCopy), copy_cmp);
+
+	memset(dirty, 0, sizeof(dirty));
+	for (i = 0; i < ncopies; i++)
+	{
+		DoubleWriteCopy *copy = &copies[i];
+		char	   *page = buf + DW_HEADER_SIZE;
+
+		/* Only the first, most recent, copy of each page matters */
+		if (i > 0 &&
+			RelFileNodeEquals(copy->rnode, copies[i - 1].rnode) &&
+			copy->forknum == copies[i - 1].forknum &&
+			copy->blkno == copies[i - 1].blkno)
+			continue;
+
+		/* Moving on to another relation?  Sync the previous one first. */
+		if (reln != NULL && !RelFileNodeEquals(copy->rnode,
+											   reln->smgr_rnode.node))
+		{
+			for (int f = 0; f <= MAX_FORKNUM; f++)
+			{
+				if (dirty[f])
+					smgrimmedsync(reln, f);
+			}
+			memset(dirty, 0, sizeof(dirty));
+			smgrclose(reln);
+			reln = NULL;
+		}
+		if (reln == NULL)
+			reln = smgropen(copy->rnode, InvalidBackendId);
+
+		if (copy->forknum < 0 || copy->forknum > MAX_FORKNUM ||
+			!smgrexists(reln, copy->forknum) ||
+			copy->blkno >= smgrnblocks(reln, copy->forknum))
+			continue;
+
+		smgrread(reln, copy->forknum, copy->blkno, diskpage.data);
+		if (PageGetLSN((Page) diskpage.data) > copy->lsn)
+			continue;
+
+		pgstat_report_wait_start(WAIT_EVENT_DOUBLE_WRITE_READ);
+		if (pg_pread(fd, buf, DW_SLOT_SIZE,
+					 DW_SLOT_OFFSET(copy->slotno)) != DW_SLOT_SIZE)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m",
+							DOUBLE_WRITE_FILE)));
+		pgstat_report_wait_end();
+
+		if (memcmp(diskpage.data, page, BLCKSZ) == 0)
+			continue;
+
+		smgrwrite(reln, copy->forknum, copy->blkno, page, true);
+		dirty[copy->forknum] = true;
+		nrestored++;
+	}
+
+	if (reln != NULL)
+	{
+		for (int f = 0; f <= MAX_FORKNUM; f++)
+		{
+			if (dirty[f])
+				smgrimmedsync(reln, f);
+		}
+		smgrclose(reln);
+	}
+
+	if (CloseTransientFile(fd) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m", DOUBLE_WRITE_FILE)));
+
+	if (nrestored > 0)
+		ereport(LOG,
+				(errmsg_plural("restored %d page from the double-write file",
+							   "restored %d pages from the double-write file",
+							   nrestored, nrestored)));
+
+	pfree(copies);
+	pfree(buf);
+}
+
+/*
+ * DoubleWriteInitFile
+ *		Create an empty double-write file, or remove it if disabled
+ *
+ * Called by the startup process before WAL replay begins, after
+ * DoubleWriteRecover() if there was a crash.  Page writes bypass the
+ * double-write file until this has been done.
+ */
+void
+DoubleWriteInitFile(void)
+{
+	int			fd;
+	PGAlignedBlock zbuf;
+	off_t		size;
+	off_t		offset;
+
+	if (double_write_buffers <= 0)
+	{
+		if (unlink(DOUBLE_WRITE_FILE) == 0)
+			fsync_fname("global", true);
+		else if (errno != ENOENT)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not remove file \"%s\": %m",
+							DOUBLE_WRITE_FILE)));
+		return;
+	}
+
+	fd = OpenTransientFile(DOUBLE_WRITE_FILE,
+						   O_RDWR | O_CREAT | O_TRUNC | PG_BINARY);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not create file \"%s\": %m", DOUBLE_WRITE_FILE)));
+
+	/* Zero-fill it, so that no slot holds a valid header */
+	memset(zbuf.data, 0, BLCKSZ);
+	size = DW_SLOT_OFFSET(double_write_buffers);
+	for (offset = 0; offset < size; offset += BLCKSZ)
+	{
+		int			len = Min(BLCKSZ, size - offset);
+
+		errno = 0;
+		pgstat_report_wait_start(WAIT_EVENT_DOUBLE_WRITE_WRITE);
+		if (pg_pwrite(fd, zbuf.data, len, offset) != len)
+		{
+			/* if write didn't set errno, assume problem is no disk space */
+			if (errno == 0)
+				errno = ENOSPC;
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write to file \"%s\": %m",
+							DOUBLE_WRITE_FILE)));
+		}
+		pgstat_report_wait_end();
+	}
+
+	pgstat_report_wait_start(WAIT_EVENT_DOUBLE_WRITE_SYNC);
+	if (pg_fsync(fd) != 0)
+		ereport(data_sync_elevel(ERROR),
+				(errcode_for_file_access(),
+				 errmsg("could not fsync file \"%s\": %m", DOUBLE_WRITE_FILE)));
+	pgstat_report_wait_end();
+
+	if (CloseTransientFile(fd) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m", DOUBLE_WRITE_FILE)));
+
+	fsync_fname("global", true);
+
+	LWLockAcquire(DoubleWriteLock, LW_EXCLUSIVE);
+	DoubleWriteCtl->ready = true;
+	LWLockRelease(DoubleWriteLock);
+}
+
+/*
+ * DoubleWriteActive
+ *		Should page writes go through the double-write file?
+ */
+bool
+DoubleWriteActive(void)
+{
+	return DoubleWriteCtl != NULL && DoubleWriteCtl->ready;
+}
+
+/*
+ * DoubleWriteBegin
+ *		Write a copy of a page to the double-write file
+ *
+ * Returns once the copy is on stable storage and the page may be written to
+ * the relation.  The caller must pass the returned slot number to
+ * DoubleWriteEnd() after doing so.  The page must be protected against
+ * concurrent changes other than hint bits, by a pin and a share lock.
+ */
+int
+DoubleWriteBegin(RelFileNode rnode, ForkNumber forknum, BlockNumber blkno,
+				 char *page)
+{
+	DoubleWriteHeader *hdr;
+	uint64		seq;
+	int			slotno;
+	int			nbytes;
+
+	Assert(DoubleWriteActive());
+	Assert(MyDoubleWriteSlot < 0);
+
+	if (DoubleWriteFile < 0)
+	{
+		DoubleWriteFile = PathNameOpenFile(DOUBLE_WRITE_FILE,
+										   O_RDWR | PG_BINARY);
+		if (DoubleWriteFile < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\": %m",
+							DOUBLE_WRITE_FILE)));
+	}
+	if (DoubleWriteBuf == NULL)
+		DoubleWriteBuf = MemoryContextAllocZero(TopMemoryContext,
+												DW_SLOT_SIZE);
+
+	/*
+	 * Copy the page first, so that the checksum covers exactly what we write
+	 * even if hint bits are being set concurrently.
+	 */
+	hdr = (DoubleWriteHeader *) DoubleWriteBuf;
+	memcpy(DoubleWriteBuf + DW_HEADER_SIZE, page, BLCKSZ);
+
+	slotno = DoubleWriteAcquireSlot(rnode, forknum, blkno, &seq);
+	MyDoubleWriteSlot = slotno;
+
+	hdr->magic = DW_MAGIC;
+	hdr->seq = seq;
+	hdr->rnode = rnode;
+	hdr->forknum = forknum;
+	hdr->blkno = blkno;
+	hdr->crc = DoubleWriteChecksum(hdr, DoubleWriteBuf + DW_HEADER_SIZE);
+
+	errno = 0;
+	nbytes = FileWrite(DoubleWriteFile, DoubleWriteBuf, DW_SLOT_SIZE,
+					   DW_SLOT_OFFSET(slotno), WAIT_EVENT_DOUBLE_WRITE_WRITE);
+	if (nbytes != DW_SLOT_SIZE)
+	{
+		/* if write didn't set errno, assume problem is no disk space */
+		if (nbytes >= 0 && errno == 0)
+			errno = ENOSPC;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to file \"%s\": %m",
+						DOUBLE_WRITE_FILE)));
+	}
+
+	LWLockAcquire(DoubleWriteLock, LW_EXCLUSIVE);
+	DoubleWriteCtl->slots[slotno].state = DW_SLOT_WRITTEN;
+	LWLockRelease(DoubleWriteLock);
+
+	DoubleWriteFlush(slotno);
+
+	return slotno;
+}
+
+/*
+ * DoubleWriteEnd
+ *		Note that the data page protected by a slot has been written
+ *
+ * The slot stays in use until the data file has been fsync'd.
+ */
+void
+DoubleWriteEnd(int slotno)
+{
+	Assert(slotno == MyDoubleWriteSlot);
+
+	LWLockAcquire(DoubleWriteLock, LW_EXCLUSIVE);
+	Assert(DoubleWriteCtl->slots[slotno].state == DW_SLOT_DURABLE);
+	DoubleWriteCtl->slots[slotno].state = DW_SLOT_UNSYNCED;
+	LWLockRelease(DoubleWriteLock);
+
+	MyDoubleWriteSlot = -1;
+}
+
+/*
+ * DoubleWriteAbort
+ *		Clean up after an error in the middle of a double-written page write
+ *
+ * We don't know how far the write of the copy or the data page got, so the
+ * slot is treated as if the data page had been written.  That keeps any
+ * intact copy around until the data file has been fsync'd.
+ */
+void
+DoubleWriteAbort(void)
+{
+	if (MyDoubleWriteSlot < 0)
+		return;
+
+	LWLockAcquire(DoubleWriteLock, LW_EXCLUSIVE);
+	DoubleWriteCtl->slots[MyDoubleWriteSlot].state = DW_SLOT_UNSYNCED;
+	LWLockRelease(DoubleWriteLock);
+
+	MyDoubleWriteSlot = -1;
+}
+
+/*
+ * DoubleWriteCheckpointStart
+ *		Note the slots whose data pages the current checkpoint will sync
+ *
+ * Called by the checkpointer after writing out the dirty buffers and before
+ * processing the pending fsync requests.  The data pages of all slots that
+ * are UNSYNCED at this point have been written, and their fsync requests
+ * will be absorbed and performed by ProcessSyncRequests().
+ */
+void
+DoubleWriteCheckpointStart(void)
+{
+	int			i;
+
+	if (!DoubleWriteActive())
+		return;
+
+	LWLockAcquire(DoubleWriteLock, LW_EXCLUSIVE);
+	for (i = 0; i < double_write_buffers; i++)
+	{
+		DoubleWriteSlot *slot = &DoubleWriteCtl->slots[i];
+
+		slot->checkpointed = (slot->state == DW_SLOT_UNSYNCED);
+	}
+	LWLockRelease(DoubleWriteLock);
+}
+
+/*
+ * DoubleWriteCheckpointDone
+ *		Free the slots whose data pages the checkpoint has synced
+ */
+void
+DoubleWriteCheckpointDone(void)
+{
+	bool		freed = false;
+	int			i;
+
+	if (!DoubleWriteActive())
+		return;
+
+	LWLockAcquire(DoubleWriteLock, LW_EXCLUSIVE);
+	for (i = 0; i < double_write_buffers; i++)
+	{
+		DoubleWriteSlot *slot = &DoubleWriteCtl->slots[i];
+
+		if (slot->checkpointed && slot->state == DW_SLOT_UNSYNCED)
+		{
+			slot->state = DW_SLOT_FREE;
+			freed = true;
+		}
+		slot->checkpointed = false;
+	}
+	LWLockRelease(DoubleWriteLock);
+
+	if (freed)
+		ConditionVariableBroadcast(&DoubleWriteCtl->slotFreed);
+}
+
+/*
+ * DoubleWriteForget
+ *		Discard the copies of a relation fork's pages from firstblock on
+ *
+ * Called before truncating a relation fork, or with InvalidForkNumber and
+ * firstblock 0 before unlinking all forks of a relation.  The buffers of
+ * the pages concerned must already have been dropped.
+ */
+void
+DoubleWriteForget(RelFileNode rnode, ForkNumber forknum,
+				  BlockNumber firstblock)
+{
+	DoubleWriteDiscard(&rnode, InvalidOid, forknum, firstblock);
+}
+
+/*
+ * DoubleWriteForgetDatabase
+ *		Discard the copies of all pages of a database
+ */
+void
+DoubleWriteForgetDatabase(Oid dbid)
+{
+	DoubleWriteDiscard(NULL, dbid, InvalidForkNumber, 0);
+}
+
+/*
+ * Acquire a free slot for the given page, waiting for one if necessary.
+ */
+static int
+DoubleWriteAcquireSlot(RelFileNode rnode, ForkNumber forknum,
+					   BlockNumber blkno, uint64 *seq)
+{
+	for (;;)
+	{
+		bool		unsynced = false;
+		int			i;
+
+		LWLockAcquire(DoubleWriteLock, LW_EXCLUSIVE);
+
+		for (i = 0; i < double_write_buffers; i++)
+		{
+			int			slotno = (DoubleWriteCtl->nextSlot + i) % double_write_buffers;
+			DoubleWriteSlot *slot = &DoubleWriteCtl->slots[slotno];
+
+			if (slot->state == DW_SLOT_FREE)
+			{
+				slot->state = DW_SLOT_FILLING;
+				slot->checkpointed = false;
+				slot->rnode = rnode;
+				slot->forknum = forknum;
+				slot->blkno = blkno;
+				*seq = DoubleWriteCtl->nextSeq++;
+				DoubleWriteCtl->nextSlot = (slotno + 1) % double_write_buffers;
+				LWLockRelease(DoubleWriteLock);
+				ConditionVariableCancelSleep();
+				return slotno;
+			}
+			if (slot->state == DW_SLOT_UNSYNCED)
+				unsynced = true;
+		}
+
+		/*
+		 * All slots are in use.  Free the ones whose data pages have been
+		 * written by syncing their data files, unless somebody is already
+		 * doing that; otherwise wait for a slot to be freed.
+		 */
+		if (unsynced && !DoubleWriteCtl->reclaiming)
+		{
+			DoubleWriteReclaim();	/* releases DoubleWriteLock */
+			continue;
+		}
+
+		LWLockRelease(DoubleWriteLock);
+		ConditionVariableSleep(&DoubleWriteCtl->slotFreed,
+							   WAIT_EVENT_DOUBLE_WRITE_SLOT);
+	}
+}
+
+/*
+ * Free all UNSYNCED slots by fsyncing the relation forks they belong to.
+ *
+ * Called with DoubleWriteLock held exclusively; releases it.
+ */
+static void
+DoubleWriteReclaim(void)
+{
+	int			ntargets = 0;
+	int			i;
+
+	if (ReclaimTargets == NULL)
+		ReclaimTargets = MemoryContextAlloc(TopMemoryContext,
+											double_write_buffers * sizeof(DoubleWriteTarget));
+
+	for (i = 0; i < double_write_buffers; i++)
+	{
+		DoubleWriteSlot *slot = &DoubleWriteCtl->slots[i];
+
+		if (slot->state == DW_SLOT_UNSYNCED)
+		{
+			slot->state = DW_SLOT_SYNCING;
+			ReclaimTargets[ntargets].rnode = slot->rnode;
+			ReclaimTargets[ntargets].forknum = slot->forknum;
+			ntargets++;
+		}
+	}
+	DoubleWriteCtl->reclaiming = true;
+	LWLockRelease(DoubleWriteLock);
+
+	qsort(ReclaimTargets, ntargets, sizeof(DoubleWriteTarget), target_cmp);
+
+	PG_TRY();
+	{
+		for (i = 0; i < ntargets; i++)
+		{
+			SMgrRelation reln;
+
+			if (i > 0 && target_cmp(&ReclaimTargets[i],
+									&ReclaimTargets[i - 1]) == 0)
+				continue;
+
+			reln = smgropen(ReclaimTargets[i].rnode, InvalidBackendId);
+			if (smgrexists(reln, ReclaimTargets[i].forknum))
+				smgrimmedsync(reln, ReclaimTargets[i].forknum);
+		}
+	}
+	PG_CATCH();
+	{
+		/* Leave the slots for somebody else to try again */
+		LWLockAcquire(DoubleWriteLock, LW_EXCLUSIVE);
+		for (i = 0; i < double_write_buffers; i++)
+		{
+			if (DoubleWriteCtl->slots[i].state == DW_SLOT_SYNCING)
+				DoubleWriteCtl->slots[i].state = DW_SLOT_UNSYNCED;
+		}
+		DoubleWriteCtl->reclaiming = false;
+		LWLockRelease(DoubleWriteLock);
+		ConditionVariableBroadcast(&DoubleWriteCtl->slotFreed);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	LWLockAcquire(DoubleWriteLock, LW_EXCLUSIVE);
+	for (i = 0; i < double_write_buffers; i++)
+	{
+		if (DoubleWriteCtl->slots[i].state == DW_SLOT_SYNCING)
+			DoubleWriteCtl->slots[i].state = DW_SLOT_FREE;
+	}
+	DoubleWriteCtl->reclaiming = false;
+	LWLockRelease(DoubleWriteLock);
+
+	ConditionVariableBroadcast(&DoubleWriteCtl->slotFreed);
+}
+
+/*
+ * Make sure the copy in the given slot has reached stable storage.
+ *
+ * Whoever gets DoubleWriteSyncLock fsyncs the file on behalf of everybody
+ * whose copy has been written by then; the others wait for the lock to be
+ * released and check whether their copy was covered.
+ */
+static void
+DoubleWriteFlush(int slotno)
+{
+	for (;;)
+	{
+		DoubleWriteSlotState state;
+		int			i;
+
+		LWLockAcquire(DoubleWriteLock, LW_SHARED);
+		state = DoubleWriteCtl->slots[slotno].state;
+		LWLockRelease(DoubleWriteLock);
+
+		if (state == DW_SLOT_DURABLE)
+			break;
+
+		if (!LWLockAcquireOrWait(DoubleWriteSyncLock, LW_EXCLUSIVE))
+			continue;
+
+		/*
+		 * Slots still FLUSHING were left behind by a failed fsync, so include
+		 * them too.
+		 */
+		LWLockAcquire(DoubleWriteLock, LW_EXCLUSIVE);
+		for (i = 0; i < double_write_buffers; i++)
+		{
+			if (DoubleWriteCtl->slots[i].state == DW_SLOT_WRITTEN)
+				DoubleWriteCtl->slots[i].state = DW_SLOT_FLUSHING;
+		}
+		LWLockRelease(DoubleWriteLock);
+
+		if (FileSync(DoubleWriteFile, WAIT_EVENT_DOUBLE_WRITE_SYNC) < 0)
+			ereport(data_sync_elevel(ERROR),
+					(errcode_for_file_access(),
+					 errmsg("could not fsync file \"%s\": %m",
+							DOUBLE_WRITE_FILE)));
+
+		LWLockAcquire(DoubleWriteLock, LW_EXCLUSIVE);
+		for (i = 0; i < double_write_buffers; i++)
+		{
+			if (DoubleWriteCtl->slots[i].state == DW_SLOT_FLUSHING)
+				DoubleWriteCtl->slots[i].state = DW_SLOT_DURABLE;
+		}
+		LWLockRelease(DoubleWriteLock);
+
+		LWLockRelease(DoubleWriteSyncLock);
+	}
+}
+
+/*
+ * Durably discard the copies of a relation fork's pages from firstblock on,
+ * of all forks if forknum is InvalidForkNumber, or of all relations of a
+ * database if rnode is NULL.
+ */
+static void
+DoubleWriteDiscard(const RelFileNode *rnode, Oid dbid,
+				   ForkNumber forknum, BlockNumber firstblock)
+{
+	bool		discarded = false;
+	int			i;
+
+	if (!DoubleWriteActive())
+		return;
+
+	/*
+	 * Wait for any sync of the relation's files to finish, so that nobody
+	 * tries to open them while they are being removed.
+	 */
+	for (;;)
+	{
+		bool		syncing = false;
+
+		LWLockAcquire(DoubleWriteLock, LW_EXCLUSIVE);
+		for (i = 0; i < double_write_buffers; i++)
+		{
+			DoubleWriteSlot *slot = &DoubleWriteCtl->slots[i];
+
+			if (slot->state == DW_SLOT_SYNCING &&
+				(rnode ? RelFileNodeEquals(slot->rnode, *rnode) :
+				 slot->rnode.dbNode == dbid))
+			{
+				syncing = true;
+				break;
+			}
+		}
+		if (!syncing)
+			break;
+		LWLockRelease(DoubleWriteLock);
+		ConditionVariableSleep(&DoubleWriteCtl->slotFreed,
+							   WAIT_EVENT_DOUBLE_WRITE_SLOT);
+	}
+	ConditionVariableCancelSleep();
+
+	/* Still holding DoubleWriteLock, wipe the headers of matching slots */
+	for (i = 0; i < double_write_buffers; i++)
+	{
+		DoubleWriteSlot *slot = &DoubleWriteCtl->slots[i];
+		char		zbuf[DW_HEADER_SIZE];
+
+		if (slot->state == DW_SLOT_FREE)
+			continue;
+		if (rnode)
+		{
+			if (!RelFileNodeEquals(slot->rnode, *rnode) ||
+				(forknum != InvalidForkNumber && slot->forknum != forknum) ||
+				slot->blkno < firstblock)
+				continue;
+		}
+		else if (slot->rnode.dbNode != dbid)
+			continue;
+
+		/* The buffers are gone, so no write can be in progress */
+		Assert(slot->state == DW_SLOT_UNSYNCED);
+
+		if (DoubleWriteFile < 0)
+		{
+			DoubleWriteFile = PathNameOpenFile(DOUBLE_WRITE_FILE,
+											   O_RDWR | PG_BINARY);
+			if (DoubleWriteFile < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not open file \"%s\": %m",
+								DOUBLE_WRITE_FILE)));
+		}
+
+		memset(zbuf, 0, sizeof(zbuf));
+		errno = 0;
+		if (FileWrite(DoubleWriteFile, zbuf, DW_HEADER_SIZE,
+					  DW_SLOT_OFFSET(i),
+					  WAIT_EVENT_DOUBLE_WRITE_WRITE) != DW_HEADER_SIZE)
+		{
+			if (errno == 0)
+				errno = ENOSPC;
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write to file \"%s\": %m",
+							DOUBLE_WRITE_FILE)));
+		}
+		slot->state = DW_SLOT_FREE;
+		discarded = true;
+	}
+
+	if (discarded &&
+		FileSync(DoubleWriteFile, WAIT_EVENT_DOUBLE_WRITE_SYNC) < 0)
+		ereport(data_sync_elevel(ERROR),
+				(errcode_for_file_access(),
+				 errmsg("could not fsync file \"%s\": %m",
+						DOUBLE_WRITE_FILE)));
+
+	LWLockRelease(DoubleWriteLock);
+
+	if (discarded)
+		ConditionVariableBroadcast(&DoubleWriteCtl->slotFreed);
+}
+
+/*
+ * Compute the CRC of a slot's header, excluding the fields before seq, and
+ * page.
+ */
+static pg_crc32c
+DoubleWriteChecksum(DoubleWriteHeader *hdr, char *page)
+{
+	pg_crc32c	crc;
+
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, (char *) hdr + offsetof(DoubleWriteHeader, seq),
+				sizeof(DoubleWriteHeader) - offsetof(DoubleWriteHeader, seq));
+	COMP_CRC32C(crc, page, BLCKSZ);
+	FIN_CRC32C(crc);
+
+	return crc;
+}
+
+/*
+ * qsort comparator for DoubleWriteTarget
+ */
+static int
+target_cmp(const void *a, const void *b)
+{
+	const DoubleWriteTarget *ta = (const DoubleWriteTarget *) a;
+	const DoubleWriteTarget *tb = (const DoubleWriteTarget *) b;
+	int			r;
+
+	r = memcmp(&ta->rnode, &tb->rnode, sizeof(RelFileNode));
+	if (r != 0)
+		return r;
+	if (ta->forknum != tb->forknum)
+		return ta->forknum < tb->forknum ? -1 : 1;
+	return 0;
+}
+
+/*
+ * qsort comparator for DoubleWriteCopy: by page, then most recent first
+ */
+static int
+copy_cmp(const void *a, const void *b)
+{
+	const DoubleWriteCopy *ca = (const DoubleWriteCopy *) a;
+	const DoubleWriteCopy *cb = (const DoubleWriteCopy *) b;
+	int			r;
+
+	r = memcmp(&ca->rnode, &cb->rnode, sizeof(RelFileNode));
+	if (r != 0)
+		return r;
+	if (ca->forknum != cb->forknum)
+		return ca->forknum < cb->forknum ? -1 : 1;
+	if (ca->blkno != cb->blkno)
+		return ca->blkno < cb->blkno ? -1 : 1;
+	if (ca->lsn != cb->lsn)
+		return ca->lsn > cb->lsn ? -1 : 1;
+	if (ca->seq != cb->seq)
+		return ca->seq > cb->seq ? -1 : 1;
+	return 0;
+}
@@ -15,6 +15,7 @@
  */
 #include "postgres.h"
 
+#include "miscadmin.h"
 #include "port/atomics.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
@@ -24,17 +25,34 @@
 
 
 /*
- * The shared freelist control information.
+ * The buffer pool is split into up to MAX_STRATEGY_PARTITIONS partitions of
+ * consecutive buffers, each of which has a clock sweep and a freelist of its
+ * own.  A backend allocates from one partition at a time, so that backends
+ * working on different partitions don't fight over the same clock hand, but
+ * moves on to the next partition every STRATEGY_PARTITION_ALLOCS allocations
+ * so that a single busy backend still cycles through the whole pool.  A
+ * partition is never made smaller than MIN_STRATEGY_PARTITION_BUFFERS.
+ */
+#define MAX_STRATEGY_PARTITIONS			8
+#define MIN_STRATEGY_PARTITION_BUFFERS	1024
+#define STRATEGY_PARTITION_ALLOCS		64
+
+/*
+ * The shared freelist and clock sweep information of one partition.
  */
 typedef struct
 {
 	/* Spinlock: protects the values below */
 	slock_t		buffer_strategy_lock;
 
+	int			firstBuffer;	/* first buffer of the partition */
+	int			numBuffers;		/* number of buffers in the partition */
+
 	/*
-	 * Clock sweep hand: index of next buffer to consider grabbing. Note that
-	 * this isn't a concrete buffer - we only ever increase the value. So, to
-	 * get an actual buffer, it needs to be used modulo NBuffers.
+	 * Clock sweep hand: index of next buffer to consider grabbing, relative
+	 * to firstBuffer. Note that this isn't a concrete buffer - we only ever
+	 * increase the value. So, to get an actual buffer, it needs to be used
+	 * modulo numBuffers.
 	 */
 	pg_atomic_uint32 nextVictimBuffer;
 
@@ -52,17 +70,43 @@ typedef struct
 	 */
 	uint32		completePasses; /* Complete cycles of the clock sweep */
 	pg_atomic_uint32 numBufferAllocs;	/* Buffers allocated since last reset */
+} BufferStrategyPartition;
+
+/* Pad each partition to a cache line, to keep them from sharing one */
+typedef union BufferStrategyPartitionPadded
+{
+	BufferStrategyPartition part;
+	char		pad[PG_CACHE_LINE_SIZE];
+} BufferStrategyPartitionPadded;
+
+/*
+ * The shared freelist control information.
+ */
+typedef struct
+{
+	int			numPartitions;
 
 	/*
 	 * Bgworker process to be notified upon activity or -1 if none. See
 	 * StrategyNotifyBgWriter.
 	 */
 	int			bgwprocno;
+
+	/* Spinlock: protects bgwprocno */
+	slock_t		bgwprocno_lock;
+
+	BufferStrategyPartitionPadded partitions[FLEXIBLE_ARRAY_MEMBER];
 } BufferStrategyControl;
 
 /* Pointers to shared state */
 static BufferStrategyControl *StrategyControl = NULL;
 
+/* Partition this backend is allocating from, and how often it has */
+static int	MyStrategyPartition = -1;
+static int	MyStrategyPartitionAllocs = 0;
+
+#define StrategyPartition(i) (&StrategyControl->partitions[i].part)
+
 /*
  * Private (non-shared) state for managing a ring of shared buffers to re-use.
  * This is currently the only kind of BufferAccessStrategy object, but someday
@@ -72,8 +116,17 @@ typedef struct BufferAccessStrategyData
 {
 	/* Overall strategy type */
 	BufferAccessStrategyType btype;
-	/* Number of elements in buffers[] array */
+	/* Number of elements of buffers[] array currently in use */
 	int			ring_size;
+	/* Number of elements in buffers[] array; ring_size can grow up to this */
+	int			max_ring_size;
+
+	/*
+	 * Number of ring buffers reused in the current pass over the ring, and
+	 * how many of them could only be written after flushing WAL.
+	 */
+	int			pass_reuses;
+	int			pass_wal_flushes;
 
 	/*
 	 * Index of the "current" slot in the ring, ie, the one most recently
@@ -98,19 +151,44 @@ typedef struct BufferAccessStrategyData
 
 
 /* Prototypes for internal functions */
+static int	StrategyNumPartitionsFor(int nbuffers);
+static BufferStrategyPartition *BufferStrategyPartitionOf(int buf_id);
 static BufferDesc *GetBufferFromRing(BufferAccessStrategy strategy,
 									 uint32 *buf_state);
 static void AddBufferToRing(BufferAccessStrategy strategy,
 							BufferDesc *buf);
 
+/*
+ * StrategyNumPartitionsFor -- how many partitions to split nbuffers into
+ */
+static int
+StrategyNumPartitionsFor(int nbuffers)
+{
+	int			nparts = nbuffers / MIN_STRATEGY_PARTITION_BUFFERS;
+
+	return Max(1, Min(nparts, MAX_STRATEGY_PARTITIONS));
+}
+
+/*
+ * BufferStrategyPartitionOf -- the partition a buffer belongs to
+ */
+static BufferStrategyPartition *
+BufferStrategyPartitionOf(int buf_id)
+{
+	int			per_part = NBuffers / StrategyControl->numPartitions;
+	int			i = Min(buf_id / per_part, StrategyControl->numPartitions - 1);
+
+	return StrategyPartition(i);
+}
+
 /*
  * ClockSweepTick - Helper routine for StrategyGetBuffer()
  *
- * Move the clock hand one buffer ahead of its current position and return the
- * id of the buffer now under the hand.
+ * Move the clock hand of the partition one buffer ahead of its current
+ * position and return the id of the buffer now under the hand.
  */
 static inline uint32
-ClockSweepTick(void)
+ClockSweepTick(BufferStrategyPartition *part)
 {
 	uint32		victim;
 
@@ -120,14 +198,14 @@ ClockSweepTick(void)
 	 * apparent order.
 	 */
 	victim =
-		pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, 1);
+		pg_atomic_fetch_add_u32(&part->nextVictimBuffer, 1);
 
-	if (victim >= NBuffers)
+	if (victim >= part->numBuffers)
 	{
 		uint32		originalVictim = victim;
 
 		/* always wrap what we look up in BufferDescriptors */
-		victim = victim % NBuffers;
+		victim = victim % part->numBuffers;
 
 		/*
 		 * If we're the one that just caused a wraparound, force
@@ -153,19 +231,19 @@ ClockSweepTick(void)
 				 * could lead to an overflow of nextVictimBuffers, but that's
 				 * highly unlikely and wouldn't be particularly harmful.
 				 */
-				SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
+				SpinLockAcquire(&part->buffer_strategy_lock);
 
-				wrapped = expected % NBuffers;
+				wrapped = expected % part->numBuffers;
 
-				success = pg_atomic_compare_exchange_u32(&StrategyControl->nextVictimBuffer,
+				success = pg_atomic_compare_exchange_u32(&part->nextVictimBuffer,
 														 &expected, wrapped);
 				if (success)
-					StrategyControl->completePasses++;
-				SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+					part->completePasses++;
+				SpinLockRelease(&part->buffer_strategy_lock);
 			}
 		}
 	}
-	return victim;
+	return part->firstBuffer + victim;
 }
 
 /*
@@ -179,10 +257,14 @@ ClockSweepTick(void)
 bool
 have_free_buffer(void)
 {
-	if (StrategyControl->firstFreeBuffer >= 0)
-		return true;
-	else
-		return false;
+	int			i;
+
+	for (i = 0; i < StrategyControl->numPartitions; i++)
+	{
+		if (StrategyPartition(i)->firstFreeBuffer >= 0)
+			return true;
+	}
+	return false;
 }
 
 /*
@@ -193,27 +275,35 @@ have_free_buffer(void)
  *	the selected buffer must not currently be pinned by anyone.
  *
  *	strategy is a BufferAccessStrategy object, or NULL for default strategy.
+ *	*from_ring is set to true if the buffer comes from the strategy's ring.
  *
  *	To ensure that no one else can pin the buffer before we do, we must
  *	return the buffer with the buffer header spinlock still held.
  */
 BufferDesc *
-StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
+StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state,
+				  bool *from_ring)
 {
 	BufferDesc *buf;
+	BufferStrategyPartition *part;
 	int			bgwprocno;
 	int			trycounter;
+	int			nexhausted;
 	uint32		local_buf_state;	/* to avoid repeated (de-)referencing */
 
 	/*
 	 * If given a strategy object, see whether it can select a buffer. We
 	 * assume strategy objects don't need buffer_strategy_lock.
 	 */
+	*from_ring = false;
 	if (strategy != NULL)
 	{
 		buf = GetBufferFromRing(strategy, buf_state);
 		if (buf != NULL)
+		{
+			*from_ring = true;
 			return buf;
+		}
 	}
 
 	/*
@@ -242,12 +332,28 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 		SetLatch(&ProcGlobal->allProcs[bgwprocno].procLatch);
 	}
 
+	/*
+	 * Pick the partition to allocate from.  Backends start out on different
+	 * partitions, and each moves on to the next one after a while.
+	 */
+	if (MyStrategyPartition < 0 ||
+		++MyStrategyPartitionAllocs >= STRATEGY_PARTITION_ALLOCS)
+	{
+		if (MyStrategyPartition < 0)
+			MyStrategyPartition = (MyProc ? MyProc->pgprocno : 0);
+		else
+			MyStrategyPartition++;
+		MyStrategyPartition %= StrategyControl->numPartitions;
+		MyStrategyPartitionAllocs = 0;
+	}
+	part = StrategyPartition(MyStrategyPartition);
+
 	/*
 	 * We count buffer allocation requests so that the bgwriter can estimate
 	 * the rate of buffer consumption.  Note that buffers recycled by a
 	 * strategy object are intentionally not counted here.
 	 */
-	pg_atomic_fetch_add_u32(&StrategyControl->numBufferAllocs, 1);
+	pg_atomic_fetch_add_u32(&part->numBufferAllocs, 1);
 
 	/*
 	 * First check, without acquiring the lock, whether there's buffers in the
@@ -265,31 +371,31 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 	 * buffer_strategy_lock not the individual buffer spinlocks, so it's OK to
 	 * manipulate them without holding the spinlock.
 	 */
-	if (StrategyControl->firstFreeBuffer >= 0)
+	if (part->firstFreeBuffer >= 0)
 	{
 		while (true)
 		{
 			/* Acquire the spinlock to remove element from the freelist */
-			SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
+			SpinLockAcquire(&part->buffer_strategy_lock);
 
-			if (StrategyControl->firstFreeBuffer < 0)
+			if (part->firstFreeBuffer < 0)
 			{
-				SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+				SpinLockRelease(&part->buffer_strategy_lock);
 				break;
 			}
 
-			buf = GetBufferDescriptor(StrategyControl->firstFreeBuffer);
+			buf = GetBufferDescriptor(part->firstFreeBuffer);
 			Assert(buf->freeNext != FREENEXT_NOT_IN_LIST);
 
 			/* Unconditionally remove buffer from freelist */
-			StrategyControl->firstFreeBuffer = buf->freeNext;
+			part->firstFreeBuffer = buf->freeNext;
 			buf->freeNext = FREENEXT_NOT_IN_LIST;
 
 			/*
 			 * Release the lock so someone else can access the freelist while
 			 * we check out this buffer.
 			 */
-			SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+			SpinLockRelease(&part->buffer_strategy_lock);
 
 			/*
 			 * If the buffer is pinned or has a nonzero usage_count, we cannot
@@ -313,10 +419,11 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 	}
 
 	/* Nothing on the freelist, so run the "clock sweep" algorithm */
-	trycounter = NBuffers;
+	trycounter = part->numBuffers;
+	nexhausted = 0;
 	for (;;)
 	{
-		buf = GetBufferDescriptor(ClockSweepTick());
+		buf = GetBufferDescriptor(ClockSweepTick(part));
 
 		/*
 		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
@@ -330,7 +437,7 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 			{
 				local_buf_state -= BUF_USAGECOUNT_ONE;
 
-				trycounter = NBuffers;
+				trycounter = part->numBuffers;
 			}
 			else
 			{
@@ -344,14 +451,22 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 		else if (--trycounter == 0)
 		{
 			/*
-			 * We've scanned all the buffers without making any state changes,
-			 * so all the buffers are pinned (or were when we looked at them).
-			 * We could hope that someone will free one eventually, but it's
-			 * probably better to fail than to risk getting stuck in an
-			 * infinite loop.
+			 * We've scanned all the buffers of the partition without making
+			 * any state changes, so all of them are pinned (or were when we
+			 * looked at them).  Try the next partition.  Once that has
+			 * happened in every partition, we could hope that someone will
+			 * free one eventually, but it's probably better to fail than to
+			 * risk getting stuck in an infinite loop.
 			 */
 			UnlockBufHdr(buf, local_buf_state);
-			elog(ERROR, "no unpinned buffers available");
+			if (++nexhausted >= StrategyControl->numPartitions)
+				elog(ERROR, "no unpinned buffers available");
+			MyStrategyPartition = (MyStrategyPartition + 1) %
+				StrategyControl->numPartitions;
+			MyStrategyPartitionAllocs = 0;
+			part = StrategyPartition(MyStrategyPartition);
+			trycounter = part->numBuffers;
+			continue;
 		}
 		UnlockBufHdr(buf, local_buf_state);
 	}
@@ -363,7 +478,9 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 void
 StrategyFreeBuffer(BufferDesc *buf)
 {
-	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
+	BufferStrategyPartition *part = BufferStrategyPartitionOf(buf->buf_id);
+
+	SpinLockAcquire(&part->buffer_strategy_lock);
 
 	/*
 	 * It is possible that we are told to put something in the freelist that
@@ -371,20 +488,44 @@ StrategyFreeBuffer(BufferDesc *buf)
 	 */
 	if (buf->freeNext == FREENEXT_NOT_IN_LIST)
 	{
-		buf->freeNext = StrategyControl->firstFreeBuffer;
+		buf->freeNext = part->firstFreeBuffer;
 		if (buf->freeNext < 0)
-			StrategyControl->lastFreeBuffer = buf->buf_id;
-		StrategyControl->firstFreeBuffer = buf->buf_id;
+			part->lastFreeBuffer = buf->buf_id;
+		part->firstFreeBuffer = buf->buf_id;
 	}
 
-	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+	SpinLockRelease(&part->buffer_strategy_lock);
 }
 
 /*
- * StrategySyncStart -- tell BufferSync where to start syncing
+ * StrategyNumPartitions -- number of buffer pool partitions
+ */
+int
+StrategyNumPartitions(void)
+{
+	return StrategyControl->numPartitions;
+}
+
+/*
+ * StrategyPartitionRange -- the buffers making up a partition
  *
- * The result is the buffer index of the best buffer to sync first.
- * BufferSync() will proceed circularly around the buffer array from there.
+ * The partition consists of *num_buffers buffers starting at *first_buffer.
+ */
+void
+StrategyPartitionRange(int partition, int *first_buffer, int *num_buffers)
+{
+	BufferStrategyPartition *part = StrategyPartition(partition);
+
+	*first_buffer = part->firstBuffer;
+	*num_buffers = part->numBuffers;
+}
+
+/*
+ * StrategySyncStart -- tell BgBufferSync where to start syncing
+ *
+ * The result is the index of the best buffer to sync first, relative to the
+ * start of the given partition.  BgBufferSync() will proceed circularly
+ * around the partition from there.
  *
  * In addition, we return the completed-pass count (which is effectively
  * the higher-order bits of nextVictimBuffer) and the count of recent buffer
@@ -392,31 +533,33 @@ StrategyFreeBuffer(BufferDesc *buf)
  * being read.
  */
 int
-StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc)
+StrategySyncStart(int partition, uint32 *complete_passes,
+				  uint32 *num_buf_alloc)
 {
+	BufferStrategyPartition *part = StrategyPartition(partition);
 	uint32		nextVictimBuffer;
 	int			result;
 
-	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
-	nextVictimBuffer = pg_atomic_read_u32(&StrategyControl->nextVictimBuffer);
-	result = nextVictimBuffer % NBuffers;
+	SpinLockAcquire(&part->buffer_strategy_lock);
+	nextVictimBuffer = pg_atomic_read_u32(&part->nextVictimBuffer);
+	result = nextVictimBuffer % part->numBuffers;
 
 	if (complete_passes)
 	{
-		*complete_passes = StrategyControl->completePasses;
+		*complete_passes = part->completePasses;
 
 		/*
 		 * Additionally add the number of wraparounds that happened before
 		 * completePasses could be incremented. C.f. ClockSweepTick().
 		 */
-		*complete_passes += nextVictimBuffer / NBuffers;
+		*complete_passes += nextVictimBuffer / part->numBuffers;
 	}
 
 	if (num_buf_alloc)
 	{
-		*num_buf_alloc = pg_atomic_exchange_u32(&StrategyControl->numBufferAllocs, 0);
+		*num_buf_alloc = pg_atomic_exchange_u32(&part->numBufferAllocs, 0);
 	}
-	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+	SpinLockRelease(&part->buffer_strategy_lock);
 	return result;
 }
 
@@ -432,13 +575,13 @@ void
 StrategyNotifyBgWriter(int bgwprocno)
 {
 	/*
-	 * We acquire buffer_strategy_lock just to ensure that the store appears
+	 * We acquire bgwprocno_lock just to ensure that the store appears
 	 * atomic to StrategyGetBuffer.  The bgwriter should call this rather
 	 * infrequently, so there's no performance penalty from being safe.
 	 */
-	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
+	SpinLockAcquire(&StrategyControl->bgwprocno_lock);
 	StrategyControl->bgwprocno = bgwprocno;
-	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+	SpinLockRelease(&StrategyControl->bgwprocno_lock);
 }
 
 
@@ -459,7 +602,12 @@ StrategyShmemSize(void)
 	size = add_size(size, BufTableShmemSize(NBuffers + NUM_BUFFER_PARTITIONS));
 
 	/* size of the shared replacement strategy control block */
-	size = add_size(size, MAXALIGN(sizeof(BufferStrategyControl)));
+	size = add_size(size,
+					add_size(offsetof(BufferStrategyControl, partitions),
+							 mul_size(StrategyNumPartitionsFor(NBuffers),
+									  sizeof(BufferStrategyPartitionPadded))));
+	/* and slop to align the partitions */
+	size = add_size(size, PG_CACHE_LINE_SIZE);
 
 	return size;
 }
@@ -474,6 +622,8 @@ StrategyShmemSize(void)
 void
 StrategyInitialize(bool init)
 {
+	int			nparts = StrategyNumPartitionsFor(NBuffers);
+	char	   *ptr;
 	bool		found;
 
 	/*
@@ -491,35 +641,64 @@ StrategyInitialize(bool init)
 	/*
 	 * Get or create the shared strategy control block
 	 */
+	ptr = ShmemInitStruct("Buffer Strategy Status",
+						  offsetof(BufferStrategyControl, partitions) +
+						  nparts * sizeof(BufferStrategyPartitionPadded) +
+						  PG_CACHE_LINE_SIZE,
+						  &found);
+
+	/*
+	 * Place the struct so that the partitions start on a cache line
+	 * boundary.
+	 */
 	StrategyControl = (BufferStrategyControl *)
-		ShmemInitStruct("Buffer Strategy Status",
-						sizeof(BufferStrategyControl),
-						&found);
+		(TYPEALIGN(PG_CACHE_LINE_SIZE,
+				   ptr + offsetof(BufferStrategyControl, partitions)) -
+		 offsetof(BufferStrategyControl, partitions));
 
 	if (!found)
 	{
+		int			per_part = NBuffers / nparts;
+		int			i;
+
 		/*
 		 * Only done once, usually in postmaster
 		 */
 		Assert(init);
 
-		SpinLockInit(&StrategyControl->buffer_strategy_lock);
+		StrategyControl->numPartitions = nparts;
 
-		/*
-		 * Grab the whole linked list of free buffers for our strategy. We
-		 * assume it was previously set up by InitBufferPool().
-		 */
-		StrategyControl->firstFreeBuffer = 0;
-		StrategyControl->lastFreeBuffer = NBuffers - 1;
+		for (i = 0; i < nparts; i++)
+		{
+			BufferStrategyPartition *part = StrategyPartition(i);
+
+			SpinLockInit(&part->buffer_strategy_lock);
+
+			/* the last partition takes the remainder */
+			part->firstBuffer = i * per_part;
+			part->numBuffers = (i == nparts - 1) ?
+				NBuffers - part->firstBuffer : per_part;
+
+			/*
+			 * Grab the partition's part of the linked list of free buffers
+			 * for our strategy.  We assume it was previously set up by
+			 * InitBufferPool(), and cut it at the end of the partition.
+			 */
+			part->firstFreeBuffer = part->firstBuffer;
+			part->lastFreeBuffer = part->firstBuffer + part->numBuffers - 1;
+			GetBufferDescriptor(part->lastFreeBuffer)->freeNext =
+				FREENEXT_END_OF_LIST;
 
-		/* Initialize the clock sweep pointer */
-		pg_atomic_init_u32(&StrategyControl->nextVictimBuffer, 0);
+			/* Initialize the clock sweep pointer */
+			pg_atomic_init_u32(&part->nextVictimBuffer, 0);
 
-		/* Clear statistics */
-		StrategyControl->completePasses = 0;
-		pg_atomic_init_u32(&StrategyControl->numBufferAllocs, 0);
+			/* Clear statistics */
+			part->completePasses = 0;
+			pg_atomic_init_u32(&part->numBufferAllocs, 0);
+		}
 
 		/* No pending notification */
+		SpinLockInit(&StrategyControl->bgwprocno_lock);
 		StrategyControl->bgwprocno = -1;
 	}
 	else
@@ -536,26 +715,64 @@ StrategyInitialize(bool init)
 /*
  * GetAccessStrategy -- create a BufferAccessStrategy object
  *
- * The object is allocated in the current memory context.
+ * The object is allocated in the current memory context.  The VACUUM ring
+ * may use up to vacuum_buffer_usage_limit; if that is zero, no ring is used,
+ * and NULL is returned like for BAS_NORMAL.
  */
 BufferAccessStrategy
 GetAccessStrategy(BufferAccessStrategyType btype)
+{
+	/*
+	 * Select the ring size limit to use.  See buffer/README for rationales.
+	 * Bulk reads don't wait for WAL flushes, so their ring doesn't grow.
+	 */
+	switch (btype)
+	{
+		case BAS_NORMAL:
+			/* if someone asks for NORMAL, just give 'em a "default" object */
+			return NULL;
+
+		case BAS_BULKREAD:
+			return GetAccessStrategyWithSize(btype, 256);
+		case BAS_BULKWRITE:
+			return GetAccessStrategyWithSize(btype, 64 * 1024);
+		case BAS_VACUUM:
+			return GetAccessStrategyWithSize(btype, VacuumBufferUsageLimit);
+	}
+
+	elog(ERROR, "unrecognized buffer access strategy: %d", (int) btype);
+	return NULL;				/* keep compiler quiet */
+}
+
+/*
+ * GetAccessStrategyWithSize -- create a BufferAccessStrategy object with a
+ *		given limit on the ring size
+ *
+ * ring_size_kb is the most memory, in kB, the ring may use.  The ring starts
+ * out smaller than that if the strategy normally uses a smaller one, and
+ * grows while it finds that WAL flushes are holding up the reuse of its
+ * buffers.  Zero means not to use a ring, and NULL is returned.
+ *
+ * The object is allocated in the current memory context.
+ */
+BufferAccessStrategy
+GetAccessStrategyWithSize(BufferAccessStrategyType btype, int ring_size_kb)
 {
 	BufferAccessStrategy strategy;
 	int			ring_size;
+	int			max_ring_size;
+
+	if (btype == BAS_NORMAL || ring_size_kb == 0)
+		return NULL;
 
 	/*
-	 * Select ring size to use.  See buffer/README for rationales.
+	 * Select the initial ring size.  See buffer/README for rationales.
 	 *
 	 * Note: if you change the ring size for BAS_BULKREAD, see also
 	 * SYNC_SCAN_REPORT_INTERVAL in access/heap/syncscan.c.
 	 */
 	switch (btype)
 	{
-		case BAS_NORMAL:
-			/* if someone asks for NORMAL, just give 'em a "default" object */
-			return NULL;
-
 		case BAS_BULKREAD:
 			ring_size = 256 * 1024 / BLCKSZ;
 			break;
@@ -573,20 +790,37 @@ GetAccessStrategy(BufferAccessStrategyType btype)
 	}
 
 	/* Make sure ring isn't an undue fraction of shared buffers */
-	ring_size = Min(NBuffers / 8, ring_size);
+	max_ring_size = Min((int64) ring_size_kb * 1024 / BLCKSZ, NBuffers / 8);
+	max_ring_size = Max(max_ring_size, 1);
+	ring_size = Min(ring_size, max_ring_size);
 
 	/* Allocate the object and initialize all elements to zeroes */
 	strategy = (BufferAccessStrategy)
 		palloc0(offsetof(BufferAccessStrategyData, buffers) +
-				ring_size * sizeof(Buffer));
+				max_ring_size * sizeof(Buffer));
 
 	/* Set fields that don't start out zero */
 	strategy->btype = btype;
 	strategy->ring_size = ring_size;
+	strategy->max_ring_size = max_ring_size;
 
 	return strategy;
 }
 
+/*
+ * GetAccessStrategyType -- return the type of a BufferAccessStrategy object
+ *
+ * A NULL strategy is the default, BAS_NORMAL, one.
+ */
+BufferAccessStrategyType
+GetAccessStrategyType(BufferAccessStrategy strategy)
+{
+	if (strategy == NULL)
+		return BAS_NORMAL;
+
+	return strategy->btype;
+}
+
 /*
  * FreeAccessStrategy -- release a BufferAccessStrategy object
  *
@@ -617,8 +851,25 @@ GetBufferFromRing(BufferAccessStrategy strategy, uint32 *buf_state)
 
 	/* Advance to next ring slot */
 	if (++strategy->current >= strategy->ring_size)
+	{
 		strategy->current = 0;
 
+		/*
+		 * If many of the buffers reused in the pass just finished had to wait
+		 * for a WAL flush, WAL writing can't keep up with a ring this small:
+		 * the ring comes around to a buffer before the WAL for the changes
+		 * made to it has been flushed in the background.  Double the ring
+		 * then, up to its limit, to give WAL more time to catch up.  The new
+		 * slots are empty, so they get filled as we come to them.
+		 */
+		if (strategy->pass_wal_flushes > strategy->pass_reuses / 8 &&
+			strategy->ring_size < strategy->max_ring_size)
+			strategy->ring_size = Min(strategy->ring_size * 2,
+									  strategy->max_ring_size);
+		strategy->pass_reuses = 0;
+		strategy->pass_wal_flushes = 0;
+	}
+
 	/*
 	 * If the slot hasn't been filled yet, tell the caller to allocate a new
 	 * buffer with the normal allocation strategy.  He will then fill this
@@ -646,6 +897,7 @@ GetBufferFromRing(BufferAccessStrategy strategy, uint32 *buf_state)
 		&& BUF_STATE_GET_USAGECOUNT(local_buf_state) <= 1)
 	{
 		strategy->current_was_in_ring = true;
+		strategy->pass_reuses++;
 		*buf_state = local_buf_state;
 		return buf;
 	}
@@ -685,15 +937,22 @@ AddBufferToRing(BufferAccessStrategy strategy, BufferDesc *buf)
 bool
 StrategyRejectBuffer(BufferAccessStrategy strategy, BufferDesc *buf)
 {
-	/* We only do this in bulkread mode */
-	if (strategy->btype != BAS_BULKREAD)
-		return false;
-
 	/* Don't muck with behavior of normal buffer-replacement strategy */
 	if (!strategy->current_was_in_ring ||
 		strategy->buffers[strategy->current] != BufferDescriptorGetBuffer(buf))
 		return false;
 
+	/*
+	 * We only reject buffers in bulkread mode.  The other strategies write
+	 * the buffer, but remember the WAL flush, so that the ring can grow if
+	 * that happens too often; see GetBufferFromRing.
+	 */
+	if (strategy->btype != BAS_BULKREAD)
+	{
+		strategy->pass_wal_flushes++;
+		return false;
+	}
+
 	/*
 	 * Remove the dirty buffer from the ring; necessary to prevent infinite
 	 * loop if all ring members are dirty.
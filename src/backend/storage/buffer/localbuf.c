@@ -18,6 +18,7 @@
 #include "access/parallel.h"
 #include "catalog/catalog.h"
 #include "executor/instrument.h"
+#include "pgstat.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
 #include "utils/guc.h"
@@ -48,8 +49,17 @@ static int	nextFreeLocalBuf = 0;
 
 static HTAB *LocalBufHash = NULL;
 
+/*
+ * In the leader of a parallel query, the number of parallel queries whose
+ * workers may currently be reading our temporary relations from disk (see
+ * ShareLocalBuffers); in a parallel worker, 1 if the leader has shared its
+ * local buffers with us.
+ */
+static int	LocalBufferShareCount = 0;
+
 
 static void InitLocalBuffers(void);
+static void WriteLocalBuffer(BufferDesc *bufHdr);
 static Block GetLocalBufferStorage(void);
 
 
@@ -207,30 +217,22 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 
 	/*
 	 * this buffer is not referenced but it might still be dirty. if that's
-	 * the case, write it out before reusing it!
+	 * the case, write it out before reusing it!  A parallel worker's copies
+	 * of its leader's pages are never written back, though, since the files
+	 * belong to the leader; it shouldn't have dirtied them anyway.
 	 */
 	if (buf_state & BM_DIRTY)
 	{
-		SMgrRelation oreln;
-		Page		localpage = (char *) LocalBufHdrGetBlock(bufHdr);
-
-		/* Find smgr relation for buffer */
-		oreln = smgropen(bufHdr->tag.rnode, MyBackendId);
-
-		PageSetChecksumInplace(localpage, bufHdr->tag.blockNum);
-
-		/* And write... */
-		smgrwrite(oreln,
-				  bufHdr->tag.forkNum,
-				  bufHdr->tag.blockNum,
-				  localpage,
-				  false);
-
-		/* Mark not-dirty now in case we error out below */
-		buf_state &= ~BM_DIRTY;
-		pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
-
-		pgBufferUsage.local_blks_written++;
+		if (IsParallelWorker())
+		{
+			buf_state &= ~BM_DIRTY;
+			pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
+		}
+		else
+		{
+			WriteLocalBuffer(bufHdr);
+			buf_state = pg_atomic_read_u32(&bufHdr->state);
+		}
 	}
 
 	/*
@@ -256,6 +258,8 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 		CLEAR_BUFFERTAG(bufHdr->tag);
 		buf_state &= ~(BM_VALID | BM_TAG_VALID);
 		pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
+		pgstat_count_io_op(IOOBJECT_TEMP_RELATION, IOCONTEXT_NORMAL,
+						   IOOP_EVICT);
 	}
 
 	hresult = (LocalBufferLookupEnt *)
@@ -311,6 +315,124 @@ MarkLocalBufferDirty(Buffer buffer)
 	pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
 }
 
+/*
+ * WriteLocalBuffer -
+ *	  write out a dirty local buffer, and mark it clean
+ */
+static void
+WriteLocalBuffer(BufferDesc *bufHdr)
+{
+	SMgrRelation oreln;
+	Page		localpage = (char *) LocalBufHdrGetBlock(bufHdr);
+	instr_time	io_start,
+				io_time;
+	uint32		buf_state;
+
+	/* Find smgr relation for buffer */
+	oreln = smgropen(bufHdr->tag.rnode, MyBackendId);
+
+	PageSetChecksumInplace(localpage, bufHdr->tag.blockNum);
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
+	/* And write... */
+	smgrwrite(oreln,
+			  bufHdr->tag.forkNum,
+			  bufHdr->tag.blockNum,
+			  localpage,
+			  false);
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_io_time(IOOBJECT_TEMP_RELATION, IOCONTEXT_NORMAL,
+							 IOOP_WRITE, io_time);
+	}
+	pgstat_count_io_op(IOOBJECT_TEMP_RELATION, IOCONTEXT_NORMAL,
+					   IOOP_WRITE);
+
+	/* Mark not-dirty now in case we error out later */
+	buf_state = pg_atomic_read_u32(&bufHdr->state);
+	buf_state &= ~BM_DIRTY;
+	pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
+
+	pgBufferUsage.local_blks_written++;
+}
+
+/*
+ * ShareLocalBuffers -
+ *	  let parallel workers read our temporary relations
+ *
+ * Parallel workers have no access to our local buffers, but they can read
+ * the pages of our temporary relations from disk into local buffers of their
+ * own, if we write out all our dirty local buffers before launching them.
+ * Until the matching UnshareLocalBuffers() call, the pages on disk must then
+ * stay the same.  Parallel mode already forbids changing the contents of
+ * existing tables, so this only requires that we not dirty local buffers to
+ * set hint bits or to prune pages, which LocalBuffersShared() tells callers.
+ * Pages of relations created in the meantime can be written as usual, since
+ * the workers don't know about them.
+ */
+void
+ShareLocalBuffers(void)
+{
+	int			i;
+
+	Assert(!IsParallelWorker());
+
+	for (i = 0; i < NLocBuffer; i++)
+	{
+		BufferDesc *bufHdr = GetLocalBufferDescriptor(i);
+		uint32		buf_state;
+
+		buf_state = pg_atomic_read_u32(&bufHdr->state);
+
+		if ((buf_state & (BM_VALID | BM_DIRTY)) == (BM_VALID | BM_DIRTY))
+			WriteLocalBuffer(bufHdr);
+	}
+
+	LocalBufferShareCount++;
+}
+
+/*
+ * UnshareLocalBuffers -
+ *	  note that the workers of a parallel query are done with our buffers
+ */
+void
+UnshareLocalBuffers(void)
+{
+	Assert(LocalBufferShareCount > 0);
+	LocalBufferShareCount--;
+}
+
+/*
+ * UseSharedLocalBuffers -
+ *	  let a parallel worker read its leader's temporary relations
+ *
+ * The leader must have called ShareLocalBuffers() first.
+ */
+void
+UseSharedLocalBuffers(void)
+{
+	Assert(IsParallelWorker());
+	LocalBufferShareCount = 1;
+}
+
+/*
+ * LocalBuffersShared -
+ *	  are the pages of our temporary relations being read by parallel workers?
+ *
+ * Also true in a parallel worker that reads its leader's temporary relations.
+ * While this is true, local buffers of existing relations must not be dirtied.
+ */
+bool
+LocalBuffersShared(void)
+{
+	return LocalBufferShareCount > 0;
+}
+
 /*
  * DropRelFileNodeLocalBuffers
  *		This function removes from the buffer pool all the pages of the
@@ -421,13 +543,14 @@ InitLocalBuffers(void)
 
 	/*
 	 * Parallel workers can't access data in temporary tables, because they
-	 * have no visibility into the local buffers of their leader.  This is a
+	 * have no visibility into the local buffers of their leader, unless the
+	 * leader has written them all out (see ShareLocalBuffers).  This is a
 	 * convenient, low-cost place to provide a backstop check for that.  Note
 	 * that we don't wish to prevent a parallel worker from accessing catalog
 	 * metadata about a temp table, so checks at higher levels would be
 	 * inappropriate.
 	 */
-	if (IsParallelWorker())
+	if (IsParallelWorker() && !LocalBuffersShared())
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
 				 errmsg("cannot access temporary tables during a parallel operation")));
@@ -524,10 +647,13 @@ GetLocalBufferStorage(void)
 		/* But not more than what we need for all remaining local bufs */
 		num_bufs = Min(num_bufs, NLocBuffer - total_bufs_allocated);
 		/* And don't overflow MaxAllocSize, either */
-		num_bufs = Min(num_bufs, MaxAllocSize / BLCKSZ);
+		num_bufs = Min(num_bufs, (MaxAllocSize - PG_IO_ALIGN_SIZE) / BLCKSZ);
 
-		cur_block = (char *) MemoryContextAlloc(LocalBufferContext,
-												num_bufs * BLCKSZ);
+		/* Buffers are aligned for direct I/O, see io_direct */
+		cur_block = (char *)
+			TYPEALIGN(PG_IO_ALIGN_SIZE,
+					  MemoryContextAlloc(LocalBufferContext,
+										 num_bufs * BLCKSZ + PG_IO_ALIGN_SIZE));
 		next_buf_in_block = 0;
 		num_bufs_in_block = num_bufs;
 	}
@@ -578,6 +704,10 @@ void
 AtEOXact_LocalBuffers(bool isCommit)
 {
 	CheckForLocalBufferLeaks();
+
+	/* Forget sharing by parallel queries that errored out */
+	if (!IsParallelWorker())
+		LocalBufferShareCount = 0;
 }
 
 /*
@@ -0,0 +1,153 @@
+/*-------------------------------------------------------------------------
+ *
+ * readahead.c
+ *	  Prefetching of the blocks a scan is about to read.
+ *
+ * A scan that reads a relation one block at a time through ReadBuffer has
+ * at most one I/O in flight, unless the kernel's own read-ahead happens to
+ * guess its access pattern.  The routines here let such a scan keep several
+ * PrefetchBuffer requests in flight instead: the caller supplies a callback
+ * that predicts the blocks it is going to read, in order, and reports each
+ * block it is about to read with ReadAheadAdvance.  The reads themselves
+ * still go through ReadBuffer, which then usually finds the data in the
+ * kernel's cache, or waits for less time.
+ *
+ * The number of prefetches kept in flight (the distance) starts at one and
+ * doubles every time a prefetch actually initiates I/O, up to the maximum
+ * given by the caller, usually effective_io_concurrency or
+ * maintenance_io_concurrency for the relation's tablespace.  It decreases
+ * again while blocks turn out to be in shared buffers already, so that a
+ * scan of a cached relation does not pay for more than one buffer mapping
+ * lookup per block.
+ *
+ * The predicted blocks need not all be read.  When the caller reads a block
+ * that was predicted, the predictions before it are forgotten along with
+ * it; reading blocks that were not predicted does not affect the state.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/buffer/readahead.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "storage/bufmgr.h"
+#include "storage/readahead.h"
+
+struct ReadAheadState
+{
+	Relation	rel;
+	ForkNumber	forknum;
+	ReadAheadCallback callback;
+	void	   *callback_arg;
+	bool		exhausted;		/* callback has returned InvalidBlockNumber */
+	int			distance;		/* current number of prefetches to keep */
+	int			max_distance;	/* upper limit for distance */
+
+	/* circular queue of prefetched blocks that haven't been read yet */
+	int			head;
+	int			nqueued;
+	BlockNumber queue[FLEXIBLE_ARRAY_MEMBER];
+};
+
+/*
+ * ReadAheadBegin -- set up prefetching for a scan of a relation fork
+ *
+ * max_distance is the largest number of prefetches to keep in flight.  It
+ * must be at least 1; callers that don't want to prefetch should not use
+ * this at all.  The state is allocated in CurrentMemoryContext.
+ */
+ReadAheadState *
+ReadAheadBegin(Relation rel, ForkNumber forknum, int max_distance,
+			   ReadAheadCallback callback, void *callback_arg)
+{
+	ReadAheadState *ra;
+
+	Assert(max_distance > 0);
+
+	ra = palloc(offsetof(ReadAheadState, queue) +
+				sizeof(BlockNumber) * max_distance);
+	ra->rel = rel;
+	ra->forknum = forknum;
+	ra->callback = callback;
+	ra->callback_arg = callback_arg;
+	ra->max_distance = max_distance;
+	ReadAheadReset(ra);
+
+	return ra;
+}
+
+/*
+ * ReadAheadAdvance -- report that the scan is about to read blkno
+ *
+ * This forgets the predictions up to blkno, if it was predicted, and issues
+ * as many new prefetches as the current distance allows.
+ */
+void
+ReadAheadAdvance(ReadAheadState *ra, BlockNumber blkno)
+{
+	int			i;
+
+	for (i = 0; i < ra->nqueued; i++)
+	{
+		if (ra->queue[(ra->head + i) % ra->max_distance] == blkno)
+		{
+			ra->head = (ra->head + i + 1) % ra->max_distance;
+			ra->nqueued -= i + 1;
+			break;
+		}
+	}
+
+	while (!ra->exhausted && ra->nqueued < ra->distance)
+	{
+		BlockNumber next = ra->callback(ra->callback_arg);
+		PrefetchBufferResult result;
+
+		if (!BlockNumberIsValid(next))
+		{
+			ra->exhausted = true;
+			break;
+		}
+
+		/* the block being read now is not worth a prefetch */
+		if (next == blkno)
+			continue;
+
+		result = PrefetchBuffer(ra->rel, ra->forknum, next);
+		ra->queue[(ra->head + ra->nqueued) % ra->max_distance] = next;
+		ra->nqueued++;
+
+		if (result.initiated_io)
+			ra->distance = Min(ra->distance * 2, ra->max_distance);
+		else if (ra->distance > 1)
+			ra->distance--;
+	}
+}
+
+/*
+ * ReadAheadReset -- forget all predictions, to start over
+ *
+ * The callback will be called again at the next ReadAheadAdvance, even if
+ * it has returned InvalidBlockNumber before.
+ */
+void
+ReadAheadReset(ReadAheadState *ra)
+{
+	ra->exhausted = false;
+	ra->distance = 1;
+	ra->head = 0;
+	ra->nqueued = 0;
+}
+
+/*
+ * ReadAheadEnd -- release the state
+ */
+void
+ReadAheadEnd(ReadAheadState *ra)
+{
+	pfree(ra);
+}
@@ -40,12 +40,24 @@
  * when the corresponding files need to be survived across the transaction and
  * need to be opened and closed multiple times.  Such files need to be created
  * as a member of a SharedFileSet.
+ *
+ * Finally, a BufFile created with BufFileCreateCompressTemp() compresses each
+ * bufferload with the method selected by temp_file_compression when it is
+ * dumped, and stores it behind a small header giving its compressed and raw
+ * sizes.  The position in such a file is then the position of the next
+ * compressed bufferload, so it can only be written sequentially, and then
+ * rewound and read sequentially; that's all hash join batch files need.
  *-------------------------------------------------------------------------
  */
 
 #include "postgres.h"
 
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+
 #include "commands/tablespace.h"
+#include "common/pg_lzcompress.h"
 #include "executor/instrument.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -62,6 +74,16 @@
 #define MAX_PHYSICAL_FILESIZE	0x40000000
 #define BUFFILE_SEG_SIZE		(MAX_PHYSICAL_FILESIZE / BLCKSZ)
 
+/* Header of each bufferload in a compressed BufFile */
+typedef struct BufFileChunkHeader
+{
+	int32		size;			/* # of bytes stored after the header */
+	int32		rawsize;		/* # of bytes once decompressed */
+} BufFileChunkHeader;
+
+/* GUC variables */
+int			temp_file_compression = TEMP_FILE_COMPRESSION_NONE;
+
 /*
  * This data structure represents a buffered file that consists of one or
  * more physical files (each accessed through a virtual file descriptor
@@ -80,6 +102,14 @@ struct BufFile
 	SharedFileSet *fileset;		/* space for segment files if shared */
 	const char *name;			/* name of this BufFile if shared */
 
+	/*
+	 * Compression method of the bufferloads, or TEMP_FILE_COMPRESSION_NONE,
+	 * and workspace for compressing them.  For a compressed file, curFile
+	 * and curOffset are the physical position of the next bufferload.
+	 */
+	int			compression;
+	char	   *cbuffer;		/* palloc'd, PGLZ_MAX_OUTPUT(BLCKSZ) bytes */
+
 	/*
 	 * resowner is the ResourceOwner to use for underlying temp files.  (We
 	 * don't need to remember the memory context we're using explicitly,
@@ -103,6 +133,10 @@ static BufFile *makeBufFile(File firstfile);
 static void extendBufFile(BufFile *file);
 static void BufFileLoadBuffer(BufFile *file);
 static void BufFileDumpBuffer(BufFile *file);
+static int	BufFileLoadData(BufFile *file, char *data, int nbytes);
+static void BufFileDumpData(BufFile *file, const char *data, int nbytes);
+static void BufFileLoadCompressedBuffer(BufFile *file);
+static void BufFileDumpCompressedBuffer(BufFile *file);
 static void BufFileFlush(BufFile *file);
 static File MakeNewSharedSegment(BufFile *file, int segment);
 
@@ -122,6 +156,8 @@ makeBufFileCommon(int nfiles)
 	file->curOffset = 0L;
 	file->pos = 0;
 	file->nbytes = 0;
+	file->compression = TEMP_FILE_COMPRESSION_NONE;
+	file->cbuffer = NULL;
 
 	return file;
 }
@@ -210,6 +246,28 @@ BufFileCreateTemp(bool interXact)
 	return file;
 }
 
+/*
+ * Create a BufFile for a new temporary file, like BufFileCreateTemp(), whose
+ * contents are compressed with the method selected by temp_file_compression.
+ *
+ * The file must be written sequentially, and can then only be rewound with
+ * BufFileSeek(file, 0, 0, SEEK_SET) and read sequentially.  If compression is
+ * disabled, this is just an ordinary temporary file.
+ */
+BufFile *
+BufFileCreateCompressTemp(bool interXact)
+{
+	BufFile    *file = BufFileCreateTemp(interXact);
+
+	if (temp_file_compression != TEMP_FILE_COMPRESSION_NONE)
+	{
+		file->compression = temp_file_compression;
+		file->cbuffer = palloc(PGLZ_MAX_OUTPUT(BLCKSZ));
+	}
+
+	return file;
+}
+
 /*
  * Build the name for a given segment of a given BufFile.
  */
@@ -403,6 +461,8 @@ BufFileClose(BufFile *file)
 		FileClose(file->files[i]);
 	/* release the buffer space */
 	pfree(file->files);
+	if (file->cbuffer)
+		pfree(file->cbuffer);
 	pfree(file);
 }
 
@@ -418,6 +478,12 @@ BufFileLoadBuffer(BufFile *file)
 {
 	File		thisfile;
 
+	if (file->compression != TEMP_FILE_COMPRESSION_NONE)
+	{
+		BufFileLoadCompressedBuffer(file);
+		return;
+	}
+
 	/*
 	 * Advance to next component file if necessary and possible.
 	 */
@@ -462,15 +528,56 @@ BufFileLoadBuffer(BufFile *file)
 static void
 BufFileDumpBuffer(BufFile *file)
 {
-	int			wpos = 0;
-	int			bytestowrite;
-	File		thisfile;
+	if (file->compression != TEMP_FILE_COMPRESSION_NONE)
+	{
+		BufFileDumpCompressedBuffer(file);
+		return;
+	}
 
 	/*
 	 * Unlike BufFileLoadBuffer, we must dump the whole buffer even if it
-	 * crosses a component-file boundary; so we need a loop.
+	 * crosses a component-file boundary.
+	 */
+	BufFileDumpData(file, file->buffer.data, file->nbytes);
+	file->dirty = false;
+
+	pgBufferUsage.temp_blks_written++;
+
+	/*
+	 * At this point, curOffset has been advanced to the end of the buffer,
+	 * ie, its original value + nbytes.  We need to make it point to the
+	 * logical file position, ie, original value + pos, in case that is less
+	 * (as could happen due to a small backwards seek in a dirty buffer!)
 	 */
-	while (wpos < file->nbytes)
+	file->curOffset -= (file->nbytes - file->pos);
+	if (file->curOffset < 0)	/* handle possible segment crossing */
+	{
+		file->curFile--;
+		Assert(file->curFile >= 0);
+		file->curOffset += MAX_PHYSICAL_FILESIZE;
+	}
+
+	/*
+	 * Now we can set the buffer empty without changing the logical position
+	 */
+	file->pos = 0;
+	file->nbytes = 0;
+}
+
+/*
+ * BufFileDumpData
+ *
+ * Write nbytes of data starting at curOffset, crossing component-file
+ * boundaries as needed, and advance curOffset past them.
+ */
+static void
+BufFileDumpData(BufFile *file, const char *data, int nbytes)
+{
+	int			wpos = 0;
+	int			bytestowrite;
+	File		thisfile;
+
+	while (wpos < nbytes)
 	{
 		off_t		availbytes;
 
@@ -488,7 +595,7 @@ BufFileDumpBuffer(BufFile *file)
 		/*
 		 * Determine how much we need to write into this file.
 		 */
-		bytestowrite = file->nbytes - wpos;
+		bytestowrite = nbytes - wpos;
 		availbytes = MAX_PHYSICAL_FILESIZE - file->curOffset;
 
 		if ((off_t) bytestowrite > availbytes)
@@ -496,7 +603,7 @@ BufFileDumpBuffer(BufFile *file)
 
 		thisfile = file->files[file->curFile];
 		bytestowrite = FileWrite(thisfile,
-								 file->buffer.data + wpos,
+								 (char *) data + wpos,
 								 bytestowrite,
 								 file->curOffset,
 								 WAIT_EVENT_BUFFILE_WRITE);
@@ -507,32 +614,213 @@ BufFileDumpBuffer(BufFile *file)
 							FilePathName(thisfile))));
 		file->curOffset += bytestowrite;
 		wpos += bytestowrite;
-
-		pgBufferUsage.temp_blks_written++;
 	}
-	file->dirty = false;
+}
 
-	/*
-	 * At this point, curOffset has been advanced to the end of the buffer,
-	 * ie, its original value + nbytes.  We need to make it point to the
-	 * logical file position, ie, original value + pos, in case that is less
-	 * (as could happen due to a small backwards seek in a dirty buffer!)
-	 */
-	file->curOffset -= (file->nbytes - file->pos);
-	if (file->curOffset < 0)	/* handle possible segment crossing */
+/*
+ * BufFileLoadData
+ *
+ * Read up to nbytes of data starting at curOffset, crossing component-file
+ * boundaries as needed, and advance curOffset past them.  Returns the number
+ * of bytes read, which is less than nbytes only at end of file.
+ */
+static int
+BufFileLoadData(BufFile *file, char *data, int nbytes)
+{
+	int			rpos = 0;
+
+	while (rpos < nbytes)
 	{
-		file->curFile--;
-		Assert(file->curFile >= 0);
-		file->curOffset += MAX_PHYSICAL_FILESIZE;
+		File		thisfile;
+		int			nread;
+
+		if (file->curOffset >= MAX_PHYSICAL_FILESIZE)
+		{
+			if (file->curFile + 1 >= file->numFiles)
+				break;
+			file->curFile++;
+			file->curOffset = 0L;
+		}
+
+		thisfile = file->files[file->curFile];
+		nread = FileRead(thisfile,
+						 data + rpos,
+						 Min(nbytes - rpos,
+							 MAX_PHYSICAL_FILESIZE - file->curOffset),
+						 file->curOffset,
+						 WAIT_EVENT_BUFFILE_READ);
+		if (nread < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m",
+							FilePathName(thisfile))));
+		if (nread == 0)
+			break;
+		file->curOffset += nread;
+		rpos += nread;
 	}
 
-	/*
-	 * Now we can set the buffer empty without changing the logical position
-	 */
+	return rpos;
+}
+
+/*
+ * BufFileDumpCompressedBuffer
+ *
+ * Compress the buffer contents and write them, behind their header, at the
+ * current physical position.  A bufferload that doesn't shrink is stored as
+ * is.  At call, should have dirty = true, nbytes > 0.
+ */
+static void
+BufFileDumpCompressedBuffer(BufFile *file)
+{
+	BufFileChunkHeader hdr;
+	const char *data = file->buffer.data;
+
+	hdr.rawsize = file->nbytes;
+	hdr.size = BufFileCompress(file->compression, file->buffer.data,
+							   file->nbytes, file->cbuffer);
+	if (hdr.size >= 0)
+		data = file->cbuffer;
+	else
+		hdr.size = file->nbytes;
+
+	BufFileDumpData(file, (char *) &hdr, sizeof(hdr));
+	BufFileDumpData(file, data, hdr.size);
+
+	pgBufferUsage.temp_blks_written++;
+
+	file->dirty = false;
 	file->pos = 0;
 	file->nbytes = 0;
 }
 
+/*
+ * BufFileLoadCompressedBuffer
+ *
+ * Read the bufferload at the current physical position, and decompress it
+ * into the buffer.  At call, must have dirty = false, pos and nbytes = 0.
+ */
+static void
+BufFileLoadCompressedBuffer(BufFile *file)
+{
+	BufFileChunkHeader hdr;
+	int			nread;
+
+	nread = BufFileLoadData(file, (char *) &hdr, sizeof(hdr));
+	if (nread == 0)
+		return;					/* EOF */
+	if (nread != sizeof(hdr) ||
+		hdr.rawsize <= 0 || hdr.rawsize > BLCKSZ ||
+		hdr.size <= 0 || hdr.size > hdr.rawsize)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("invalid compressed block header in temporary file")));
+
+	if (hdr.size == hdr.rawsize)
+	{
+		nread = BufFileLoadData(file, file->buffer.data, hdr.size);
+		if (nread != hdr.size)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read temporary file: read only %d of %d bytes",
+							nread, hdr.size)));
+	}
+	else
+	{
+		nread = BufFileLoadData(file, file->cbuffer, hdr.size);
+		if (nread != hdr.size)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read temporary file: read only %d of %d bytes",
+							nread, hdr.size)));
+		BufFileDecompress(file->compression, file->cbuffer, hdr.size,
+						  file->buffer.data, hdr.rawsize);
+	}
+
+	file->nbytes = hdr.rawsize;
+
+	pgBufferUsage.temp_blks_read++;
+}
+
+/*
+ * BufFileCompress
+ *
+ * Compress len bytes at src into dest, which must have room for
+ * PGLZ_MAX_OUTPUT(len) bytes, with the given TempFileCompression method.
+ * Returns the compressed size, or -1 if the data didn't shrink.
+ *
+ * This is also used by logtape.c, which compresses the blocks of a tape set
+ * itself, to keep them individually addressable.
+ */
+int32
+BufFileCompress(int method, const char *src, int32 len, char *dest)
+{
+	int32		clen = -1;
+
+	switch ((TempFileCompression) method)
+	{
+		case TEMP_FILE_COMPRESSION_PGLZ:
+			clen = pglz_compress(src, len, dest, PGLZ_strategy_default);
+			break;
+
+		case TEMP_FILE_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			/* Refuse any result that doesn't shrink */
+			clen = LZ4_compress_default(src, dest, len, len - 1);
+			if (clen <= 0)
+				clen = -1;
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+
+		case TEMP_FILE_COMPRESSION_NONE:
+			break;
+			/* no default case, so that compiler will warn */
+	}
+
+	if (clen >= len)
+		clen = -1;
+
+	return clen;
+}
+
+/*
+ * BufFileDecompress
+ *
+ * Decompress len bytes at src, compressed by BufFileCompress() with the
+ * given method, into rawlen bytes at dest.
+ */
+void
+BufFileDecompress(int method, const char *src, int32 len, char *dest,
+				  int32 rawlen)
+{
+	int32		dlen = -1;
+
+	switch ((TempFileCompression) method)
+	{
+		case TEMP_FILE_COMPRESSION_PGLZ:
+			dlen = pglz_decompress(src, len, dest, rawlen, true);
+			break;
+
+		case TEMP_FILE_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			dlen = LZ4_decompress_safe(src, dest, len, rawlen);
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+
+		case TEMP_FILE_COMPRESSION_NONE:
+			break;
+	}
+
+	if (dlen != rawlen)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("could not decompress block of temporary file")));
+}
+
 /*
  * BufFileRead
  *
@@ -551,8 +839,12 @@ BufFileRead(BufFile *file, void *ptr, size_t size)
 	{
 		if (file->pos >= file->nbytes)
 		{
-			/* Try to load more data into buffer. */
-			file->curOffset += file->pos;
+			/*
+			 * Try to load more data into buffer.  (In a compressed file,
+			 * curOffset already points past the current bufferload.)
+			 */
+			if (file->compression == TEMP_FILE_COMPRESSION_NONE)
+				file->curOffset += file->pos;
 			file->pos = 0;
 			file->nbytes = 0;
 			BufFileLoadBuffer(file);
@@ -599,6 +891,7 @@ BufFileWrite(BufFile *file, void *ptr, size_t size)
 			else
 			{
 				/* Hmm, went directly from reading to writing? */
+				Assert(file->compression == TEMP_FILE_COMPRESSION_NONE);
 				file->curOffset += file->pos;
 				file->pos = 0;
 				file->nbytes = 0;
@@ -652,6 +945,19 @@ BufFileSeek(BufFile *file, int fileno, off_t offset, int whence)
 	int			newFile;
 	off_t		newOffset;
 
+	/* A compressed file can only be rewound */
+	if (file->compression != TEMP_FILE_COMPRESSION_NONE)
+	{
+		if (whence != SEEK_SET || fileno != 0 || offset != 0)
+			elog(ERROR, "cannot seek in compressed temporary file");
+		BufFileFlush(file);
+		file->curFile = 0;
+		file->curOffset = 0L;
+		file->pos = 0;
+		file->nbytes = 0;
+		return 0;
+	}
+
 	switch (whence)
 	{
 		case SEEK_SET:
@@ -742,6 +1048,7 @@ BufFileSeek(BufFile *file, int fileno, off_t offset, int whence)
 void
 BufFileTell(BufFile *file, int *fileno, off_t *offset)
 {
+	Assert(file->compression == TEMP_FILE_COMPRESSION_NONE);
 	*fileno = file->curFile;
 	*offset = file->curOffset + file->pos;
 }
@@ -91,10 +91,12 @@
 #include "common/file_perm.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/pg_iovec.h"
 #include "portability/mem.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "utils/guc.h"
+#include "utils/memutils.h"
 #include "utils/resowner_private.h"
 
 /* Define PG_FLUSH_DATA_WORKS if we have an implementation for pg_flush_data */
@@ -156,6 +158,10 @@ int			max_safe_fds = FD_MINFREE;	/* default if not changed */
 /* Whether it is safe to continue running after fsync() fails. */
 bool		data_sync_retry = false;
 
+/* Which kinds of files to open with direct I/O, see io_direct GUC */
+char	   *io_direct_string;
+int			io_direct_flags = 0;
+
 /* Debugging.... */
 
 #ifdef FDDEBUG
@@ -316,6 +322,12 @@ static File AllocateVfd(void);
 static void FreeVfd(File file);
 
 static int	FileAccess(File file);
+static bool FileIovNeedsBounce(Vfd *vfdP, const struct iovec *iov, int iovcnt);
+static char *GetBounceBuffer(void);
+static int	FileReadVBounce(File file, const struct iovec *iov, int iovcnt,
+							off_t offset, uint32 wait_event_info);
+static int	FileWriteVBounce(File file, const struct iovec *iov, int iovcnt,
+							 off_t offset, uint32 wait_event_info);
 static File OpenTemporaryFileInTablespace(Oid tblspcOid, bool rejectError);
 static bool reserveAllocatedDesc(void);
 static int	FreeDesc(AllocateDesc *desc);
@@ -1929,6 +1941,13 @@ FilePrefetch(File file, off_t offset, int amount, uint32 wait_event_info)
 			   file, VfdCache[file].fileName,
 			   (int64) offset, amount));
 
+	/*
+	 * With direct I/O, the data would only go into a kernel cache that the
+	 * reads won't look at.
+	 */
+	if (VfdCache[file].fileFlags & PG_O_DIRECT)
+		return 0;
+
 	returnCode = FileAccess(file);
 	if (returnCode < 0)
 		return returnCode;
@@ -1959,6 +1978,10 @@ FileWriteback(File file, off_t offset, off_t nbytes, uint32 wait_event_info)
 	if (nbytes <= 0)
 		return;
 
+	/* With direct I/O, there is no dirty data in the kernel to write back */
+	if (VfdCache[file].fileFlags & PG_O_DIRECT)
+		return;
+
 	returnCode = FileAccess(file);
 	if (returnCode < 0)
 		return;
@@ -1971,16 +1994,36 @@ FileWriteback(File file, off_t offset, off_t nbytes, uint32 wait_event_info)
 int
 FileRead(File file, char *buffer, int amount, off_t offset,
 		 uint32 wait_event_info)
+{
+	struct iovec iov;
+
+	iov.iov_base = buffer;
+	iov.iov_len = amount;
+
+	return FileReadV(file, &iov, 1, offset, wait_event_info);
+}
+
+/*
+ * FileReadV --- read into several buffers from consecutive file positions
+ *
+ * Like FileRead, this returns the number of bytes read, which may be less
+ * than the total length of the buffers at EOF, or -1 on failure.  iovcnt
+ * must not exceed PG_IOV_MAX.
+ */
+int
+FileReadV(File file, const struct iovec *iov, int iovcnt, off_t offset,
+		  uint32 wait_event_info)
 {
 	int			returnCode;
 	Vfd		   *vfdP;
 
 	Assert(FileIsValid(file));
+	Assert(iovcnt > 0 && iovcnt <= PG_IOV_MAX);
 
-	DO_DB(elog(LOG, "FileRead: %d (%s) " INT64_FORMAT " %d %p",
+	DO_DB(elog(LOG, "FileReadV: %d (%s) " INT64_FORMAT " %d",
 			   file, VfdCache[file].fileName,
 			   (int64) offset,
-			   amount, buffer));
+			   iovcnt));
 
 	returnCode = FileAccess(file);
 	if (returnCode < 0)
@@ -1988,9 +2031,12 @@ FileRead(File file, char *buffer, int amount, off_t offset,
 
 	vfdP = &VfdCache[file];
 
+	if (FileIovNeedsBounce(vfdP, iov, iovcnt))
+		return FileReadVBounce(file, iov, iovcnt, offset, wait_event_info);
+
 retry:
 	pgstat_report_wait_start(wait_event_info);
-	returnCode = pg_pread(vfdP->fd, buffer, amount, offset);
+	returnCode = pg_preadv(vfdP->fd, iov, iovcnt, offset);
 	pgstat_report_wait_end();
 
 	if (returnCode < 0)
@@ -2027,16 +2073,40 @@ retry:
 int
 FileWrite(File file, char *buffer, int amount, off_t offset,
 		  uint32 wait_event_info)
+{
+	struct iovec iov;
+
+	iov.iov_base = buffer;
+	iov.iov_len = amount;
+
+	return FileWriteV(file, &iov, 1, offset, wait_event_info);
+}
+
+/*
+ * FileWriteV --- write several buffers to consecutive file positions
+ *
+ * Returns the number of bytes written, or -1 on failure, like FileWrite.
+ * iovcnt must not exceed PG_IOV_MAX.
+ */
+int
+FileWriteV(File file, const struct iovec *iov, int iovcnt, off_t offset,
+		   uint32 wait_event_info)
 {
 	int			returnCode;
 	Vfd		   *vfdP;
+	int			amount = 0;
+	int			i;
 
 	Assert(FileIsValid(file));
+	Assert(iovcnt > 0 && iovcnt <= PG_IOV_MAX);
+
+	for (i = 0; i < iovcnt; i++)
+		amount += iov[i].iov_len;
 
-	DO_DB(elog(LOG, "FileWrite: %d (%s) " INT64_FORMAT " %d %p",
+	DO_DB(elog(LOG, "FileWriteV: %d (%s) " INT64_FORMAT " %d %d",
 			   file, VfdCache[file].fileName,
 			   (int64) offset,
-			   amount, buffer));
+			   amount, iovcnt));
 
 	returnCode = FileAccess(file);
 	if (returnCode < 0)
@@ -2044,6 +2114,9 @@ FileWrite(File file, char *buffer, int amount, off_t offset,
 
 	vfdP = &VfdCache[file];
 
+	if (FileIovNeedsBounce(vfdP, iov, iovcnt))
+		return FileWriteVBounce(file, iov, iovcnt, offset, wait_event_info);
+
 	/*
 	 * If enforcing temp_file_limit and it's a temp file, check to see if the
 	 * write would overrun temp_file_limit, and throw error if so.  Note: it's
@@ -2072,7 +2145,7 @@ FileWrite(File file, char *buffer, int amount, off_t offset,
 retry:
 	errno = 0;
 	pgstat_report_wait_start(wait_event_info);
-	returnCode = pg_pwrite(VfdCache[file].fd, buffer, amount, offset);
+	returnCode = pg_pwritev(VfdCache[file].fd, iov, iovcnt, offset);
 	pgstat_report_wait_end();
 
 	/* if write didn't set errno, assume problem is no disk space */
@@ -2098,7 +2171,7 @@ retry:
 	else
 	{
 		/*
-		 * See comments in FileRead()
+		 * See comments in FileReadV()
 		 */
 #ifdef WIN32
 		DWORD		error = GetLastError();
@@ -2122,6 +2195,215 @@ retry:
 	return returnCode;
 }
 
+/*
+ * FileIovNeedsBounce - does I/O with these buffers need a bounce buffer?
+ *
+ * Files opened with direct I/O can only be read into and written from
+ * buffers aligned to PG_IO_ALIGN_SIZE.  Shared and local buffers are, but
+ * some callers use buffers of their own.
+ */
+static bool
+FileIovNeedsBounce(Vfd *vfdP, const struct iovec *iov, int iovcnt)
+{
+	int			i;
+
+	if ((vfdP->fileFlags & PG_O_DIRECT) == 0)
+		return false;
+
+	for (i = 0; i < iovcnt; i++)
+	{
+		if ((uintptr_t) iov[i].iov_base % PG_IO_ALIGN_SIZE != 0 ||
+			iov[i].iov_len % PG_IO_ALIGN_SIZE != 0)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * GetBounceBuffer - return a BLCKSZ buffer suitable for direct I/O
+ */
+static char *
+GetBounceBuffer(void)
+{
+	static char *bounce_buffer = NULL;
+
+	if (bounce_buffer == NULL)
+		bounce_buffer = (char *)
+			TYPEALIGN(PG_IO_ALIGN_SIZE,
+					  MemoryContextAlloc(TopMemoryContext,
+										 BLCKSZ + PG_IO_ALIGN_SIZE));
+	return bounce_buffer;
+}
+
+/*
+ * FileReadVBounce - FileReadV through a bounce buffer
+ *
+ * This reads one block at a time into the bounce buffer, and copies it to
+ * the caller's buffers.  Returns the number of bytes read, like FileReadV.
+ */
+static int
+FileReadVBounce(File file, const struct iovec *iov, int iovcnt, off_t offset,
+				uint32 wait_event_info)
+{
+	struct iovec biov;
+	int			total = 0;
+	int			i;
+
+	biov.iov_base = GetBounceBuffer();
+
+	for (i = 0; i < iovcnt; i++)
+	{
+		size_t		done;
+
+		for (done = 0; done < iov[i].iov_len; done += biov.iov_len)
+		{
+			int			nbytes;
+
+			biov.iov_len = Min(BLCKSZ, iov[i].iov_len - done);
+			nbytes = FileReadV(file, &biov, 1, offset + total,
+							   wait_event_info);
+			if (nbytes < 0)
+				return nbytes;
+			memcpy((char *) iov[i].iov_base + done, biov.iov_base, nbytes);
+			total += nbytes;
+			if (nbytes < biov.iov_len)
+				return total;
+		}
+	}
+	return total;
+}
+
+/*
+ * FileWriteVBounce - FileWriteV through a bounce buffer
+ *
+ * Like FileReadVBounce, but for writes.
+ */
+static int
+FileWriteVBounce(File file, const struct iovec *iov, int iovcnt, off_t offset,
+				 uint32 wait_event_info)
+{
+	struct iovec biov;
+	int			total = 0;
+	int			i;
+
+	biov.iov_base = GetBounceBuffer();
+
+	for (i = 0; i < iovcnt; i++)
+	{
+		size_t		done;
+
+		for (done = 0; done < iov[i].iov_len; done += biov.iov_len)
+		{
+			int			nbytes;
+
+			biov.iov_len = Min(BLCKSZ, iov[i].iov_len - done);
+			memcpy(biov.iov_base, (char *) iov[i].iov_base + done,
+				   biov.iov_len);
+			nbytes = FileWriteV(file, &biov, 1, offset + total,
+								wait_event_info);
+			if (nbytes < 0)
+				return nbytes;
+			total += nbytes;
+			if (nbytes < biov.iov_len)
+				return total;
+		}
+	}
+	return total;
+}
+
+/*
+ * FileZero - write zeroes to a range of a file
+ *
+ * Returns 0 on success, or -1 with errno set on failure.  A short write is
+ * reported as ENOSPC, like in FileWriteV.
+ */
+int
+FileZero(File file, off_t offset, off_t amount, uint32 wait_event_info)
+{
+	static const PGAlignedBlock zbuffer = {{0}};
+	struct iovec iov[PG_IOV_MAX];
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileZero: %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) amount));
+
+	while (amount > 0)
+	{
+		int			iovcnt = 0;
+		off_t		chunk = 0;
+		int			written;
+
+		/* all the iovecs point to the same block of zeroes */
+		while (iovcnt < PG_IOV_MAX && chunk < amount)
+		{
+			iov[iovcnt].iov_base = unconstify(char *, &zbuffer.data[0]);
+			iov[iovcnt].iov_len = Min(BLCKSZ, amount - chunk);
+			chunk += iov[iovcnt].iov_len;
+			iovcnt++;
+		}
+
+		written = FileWriteV(file, iov, iovcnt, offset, wait_event_info);
+		if (written < 0)
+			return -1;
+		if (written != chunk)
+		{
+			/* FileWriteV has set errno already */
+			return -1;
+		}
+
+		offset += chunk;
+		amount -= chunk;
+	}
+
+	return 0;
+}
+
+/*
+ * FileFallocate - allocate space for a range of a file
+ *
+ * The range reads back as zeroes afterwards.  If posix_fallocate() isn't
+ * available, or the file system doesn't support it, this writes zeroes to the
+ * range instead.  Returns 0 on success, or -1 with errno set on failure.
+ */
+int
+FileFallocate(File file, off_t offset, off_t amount, uint32 wait_event_info)
+{
+#ifdef HAVE_POSIX_FALLOCATE
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileFallocate: %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) amount));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return -1;
+
+retry:
+	pgstat_report_wait_start(wait_event_info);
+	returnCode = posix_fallocate(VfdCache[file].fd, offset, amount);
+	pgstat_report_wait_end();
+
+	if (returnCode == 0)
+		return 0;
+	else if (returnCode == EINTR)
+		goto retry;
+
+	/* posix_fallocate() doesn't set errno, but returns the error code */
+	if (returnCode != EINVAL && returnCode != EOPNOTSUPP)
+	{
+		errno = returnCode;
+		return -1;
+	}
+#endif
+
+	return FileZero(file, offset, amount, wait_event_info);
+}
+
 int
 FileSync(File file, uint32 wait_event_info)
 {
@@ -19,23 +19,32 @@
 #include "access/heapam.h"
 #include "access/multixact.h"
 #include "access/nbtree.h"
+#include "access/parallel.h"
 #include "access/subtrans.h"
 #include "access/syncscan.h"
 #include "access/twophase.h"
+#include "access/xlogprefetch.h"
 #include "commands/async.h"
+#include "commands/sequence.h"
+#include "commands/explain_progress.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
+#include "replication/fanout.h"
 #include "replication/logicallauncher.h"
 #include "replication/origin.h"
 #include "replication/slot.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
+#include "storage/buf_stats.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/dsm.h"
+#include "storage/extension_lock.h"
 #include "storage/ipc.h"
 #include "storage/pg_shmem.h"
 #include "storage/pmsignal.h"
@@ -43,8 +52,11 @@
 #include "storage/proc.h"
 #include "storage/procarray.h"
 #include "storage/procsignal.h"
+#include "storage/relsize.h"
 #include "storage/sinvaladt.h"
 #include "storage/spin.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 
 /* GUCs */
@@ -122,19 +134,30 @@ CreateSharedMemoryAndSemaphores(void)
 												 sizeof(ShmemIndexEnt)));
 		size = add_size(size, dsm_estimate_size());
 		size = add_size(size, BufferShmemSize());
+		size = add_size(size, BufferStatsShmemSize());
+		size = add_size(size, RelSizeCacheShmemSize());
+		size = add_size(size, SequenceCacheShmemSize());
+		size = add_size(size, DoubleWriteShmemSize());
+		size = add_size(size, LWLockStatsShmemSize());
 		size = add_size(size, LockShmemSize());
+		size = add_size(size, RelExtLockShmemSize());
 		size = add_size(size, PredicateLockShmemSize());
 		size = add_size(size, ProcGlobalShmemSize());
 		size = add_size(size, XLOGShmemSize());
+		size = add_size(size, XLogPrefetchShmemSize());
 		size = add_size(size, CLOGShmemSize());
 		size = add_size(size, CommitTsShmemSize());
 		size = add_size(size, SUBTRANSShmemSize());
 		size = add_size(size, TwoPhaseShmemSize());
 		size = add_size(size, BackgroundWorkerShmemSize());
+		size = add_size(size, ParallelWorkerPoolShmemSize());
 		size = add_size(size, MultiXactShmemSize());
 		size = add_size(size, LWLockShmemSize());
 		size = add_size(size, ProcArrayShmemSize());
 		size = add_size(size, BackendStatusShmemSize());
+		size = add_size(size, PgStatTablesShmemSize());
+		size = add_size(size, WaitStatsShmemSize());
+		size = add_size(size, IOStatsShmemSize());
 		size = add_size(size, SInvalShmemSize());
 		size = add_size(size, PMSignalShmemSize());
 		size = add_size(size, ProcSignalShmemSize());
@@ -145,10 +168,15 @@ CreateSharedMemoryAndSemaphores(void)
 		size = add_size(size, WalSndShmemSize());
 		size = add_size(size, WalRcvShmemSize());
 		size = add_size(size, ApplyLauncherShmemSize());
+		size = add_size(size, DecodeFanoutShmemSize());
 		size = add_size(size, SnapMgrShmemSize());
 		size = add_size(size, BTreeShmemSize());
 		size = add_size(size, SyncScanShmemSize());
 		size = add_size(size, AsyncShmemSize());
+		size = add_size(size, SharedCatCacheShmemSize());
+		size = add_size(size, SharedPlanCacheShmemSize());
+		size = add_size(size, PlanProgressShmemSize());
+		size = add_size(size, ProxyShmemSize());
 #ifdef EXEC_BACKEND
 		size = add_size(size, ShmemBackendArraySize());
 #endif
@@ -216,16 +244,23 @@ CreateSharedMemoryAndSemaphores(void)
 	 * Set up xlog, clog, and buffers
 	 */
 	XLOGShmemInit();
+	XLogPrefetchShmemInit();
 	CLOGShmemInit();
 	CommitTsShmemInit();
 	SUBTRANSShmemInit();
 	MultiXactShmemInit();
 	InitBufferPool();
+	BufferStatsShmemInit();
+	RelSizeCacheShmemInit();
+	SequenceCacheShmemInit();
+	DoubleWriteShmemInit();
+	LWLockStatsShmemInit();
 
 	/*
 	 * Set up lock manager
 	 */
 	InitLocks();
+	InitRelExtLocks();
 
 	/*
 	 * Set up predicate lock manager
@@ -239,8 +274,12 @@ CreateSharedMemoryAndSemaphores(void)
 		InitProcGlobal();
 	CreateSharedProcArray();
 	CreateSharedBackendStatus();
+	PgStatTablesShmemInit();
+	WaitStatsShmemInit();
+	IOStatsShmemInit();
 	TwoPhaseShmemInit();
 	BackgroundWorkerShmemInit();
+	ParallelWorkerPoolShmemInit();
 
 	/*
 	 * Set up shared-inval messaging
@@ -259,6 +298,7 @@ CreateSharedMemoryAndSemaphores(void)
 	WalSndShmemInit();
 	WalRcvShmemInit();
 	ApplyLauncherShmemInit();
+	DecodeFanoutShmemInit();
 
 	/*
 	 * Set up other modules that need some shared memory space
@@ -267,6 +307,10 @@ CreateSharedMemoryAndSemaphores(void)
 	BTreeShmemInit();
 	SyncScanShmemInit();
 	AsyncShmemInit();
+	SharedCatCacheShmemInit();
+	SharedPlanCacheShmemInit();
+	PlanProgressShmemInit();
+	ProxyShmemInit();
 
 #ifdef EXEC_BACKEND
 
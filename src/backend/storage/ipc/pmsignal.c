@@ -55,12 +55,17 @@
  * but carries the extra information that the child is a WAL sender.
  * WAL senders too start in ACTIVE state, but switch to WALSENDER once they
  * start streaming the WAL (and they never go back to ACTIVE after that).
+ *
+ * Likewise, PREFORK_READY is ACTIVE for a pre-forked backend that is ready
+ * to be handed a client connection.  It goes back to ACTIVE once it has been
+ * handed one.
  */
 
 #define PM_CHILD_UNUSED		0	/* these values must fit in sig_atomic_t */
 #define PM_CHILD_ASSIGNED	1
 #define PM_CHILD_ACTIVE		2
 #define PM_CHILD_WALSENDER	3
+#define PM_CHILD_PREFORK_READY	4
 
 /* "typedef struct PMSignalData PMSignalData" appears in pmsignal.h */
 struct PMSignalData
@@ -248,6 +253,22 @@ IsPostmasterChildWalSender(int slot)
 		return false;
 }
 
+/*
+ * IsPostmasterChildPreforkReady - check if given slot is in use by a
+ * pre-forked backend waiting for a client connection.
+ */
+bool
+IsPostmasterChildPreforkReady(int slot)
+{
+	Assert(slot > 0 && slot <= PMSignalState->num_child_flags);
+	slot--;
+
+	if (PMSignalState->PMChildFlags[slot] == PM_CHILD_PREFORK_READY)
+		return true;
+	else
+		return false;
+}
+
 /*
  * MarkPostmasterChildActive - mark a postmaster child as about to begin
  * actively using shared memory.  This is called in the child process.
@@ -281,6 +302,26 @@ MarkPostmasterChildWalSender(void)
 	PMSignalState->PMChildFlags[slot] = PM_CHILD_WALSENDER;
 }
 
+/*
+ * MarkPostmasterChildPreforkReady - mark a pre-forked backend as ready, or
+ * no longer ready, to be handed a client connection.  This is called in the
+ * child process, once it has set itself up.
+ */
+void
+MarkPostmasterChildPreforkReady(bool ready)
+{
+	int			slot = MyPMChildSlot;
+
+	Assert(IsPreforkedBackend);
+
+	Assert(slot > 0 && slot <= PMSignalState->num_child_flags);
+	slot--;
+	Assert(PMSignalState->PMChildFlags[slot] ==
+		   (ready ? PM_CHILD_ACTIVE : PM_CHILD_PREFORK_READY));
+	PMSignalState->PMChildFlags[slot] =
+		(ready ? PM_CHILD_PREFORK_READY : PM_CHILD_ACTIVE);
+}
+
 /*
  * MarkPostmasterChildInactive - mark a postmaster child as done using
  * shared memory.  This is called in the child process.
@@ -293,7 +334,8 @@ MarkPostmasterChildInactive(void)
 	Assert(slot > 0 && slot <= PMSignalState->num_child_flags);
 	slot--;
 	Assert(PMSignalState->PMChildFlags[slot] == PM_CHILD_ACTIVE ||
-		   PMSignalState->PMChildFlags[slot] == PM_CHILD_WALSENDER);
+		   PMSignalState->PMChildFlags[slot] == PM_CHILD_WALSENDER ||
+		   PMSignalState->PMChildFlags[slot] == PM_CHILD_PREFORK_READY);
 	PMSignalState->PMChildFlags[slot] = PM_CHILD_ASSIGNED;
 }
 
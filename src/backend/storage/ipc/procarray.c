@@ -101,6 +101,38 @@ typedef struct ProcArrayStruct
 	int			pgprocnos[FLEXIBLE_ARRAY_MEMBER];
 } ProcArrayStruct;
 
+/*
+ * Snapshot contents shared between backends.
+ *
+ * The first backend that has to build a snapshot the hard way after
+ * xactCompletionCount changed stores the result here, and other backends
+ * taking a snapshot before the next transaction with an xid finishes copy it
+ * instead of scanning the whole proc array.  This is only done by, and for,
+ * backends without an xid of their own, which would otherwise have to be
+ * left out of the snapshot: in read-mostly workloads that is nearly all of
+ * them.
+ *
+ * completionCount is the xactCompletionCount the contents were computed for,
+ * or 0 if there are none yet.  Both filling and reading the cache happen
+ * while holding ProcArrayLock in shared mode, so xactCompletionCount cannot
+ * change underneath either; fill_in_progress keeps concurrent builders from
+ * writing at the same time, and barriers make sure nobody sees
+ * completionCount before the contents it describes.
+ */
+typedef struct SnapshotCacheStruct
+{
+	pg_atomic_uint64 completionCount;
+	pg_atomic_flag fill_in_progress;
+	TransactionId xmin;
+	TransactionId xmax;
+	uint32		xcnt;
+	int32		subxcnt;
+	bool		suboverflowed;
+
+	/* xip[] followed by subxip[], sized like a snapshot's arrays */
+	TransactionId xids[FLEXIBLE_ARRAY_MEMBER];
+} SnapshotCacheStruct;
+
 /*
  * State for the GlobalVisTest* family of functions. Those functions can
  * e.g. be used to decide if a deleted row can be removed without violating
@@ -239,6 +271,8 @@ typedef struct ComputeXidHorizonsResult
 
 static ProcArrayStruct *procArray;
 
+static SnapshotCacheStruct *snapshotCache;
+
 static PGPROC *allProcs;
 
 /*
@@ -329,6 +363,13 @@ static inline void ProcArrayEndTransactionInternal(PGPROC *proc, TransactionId l
 static void ProcArrayGroupClearXid(PGPROC *proc, TransactionId latestXid);
 static void MaintainLatestCompletedXid(TransactionId latestXid);
 static void MaintainLatestCompletedXidRecovery(TransactionId latestXid);
+static bool SnapshotCacheLookup(Snapshot snapshot, uint64 completionCount,
+								TransactionId xmax, TransactionId *xmin,
+								size_t *count,
+								int *subcount, bool *suboverflowed);
+static void SnapshotCacheFill(Snapshot snapshot, uint64 completionCount,
+							  TransactionId xmin, TransactionId xmax,
+							  size_t count, int subcount, bool suboverflowed);
 
 static inline FullTransactionId FullXidRelativeTo(FullTransactionId rel,
 												  TransactionId xid);
@@ -364,6 +405,14 @@ ProcArrayShmemSize(void)
 #define TOTAL_MAX_CACHED_SUBXIDS \
 	((PGPROC_MAX_CACHED_SUBXIDS + 1) * PROCARRAY_MAXPROCS)
 
+	/* The shared snapshot cache, see SnapshotCacheStruct */
+#define SNAPSHOT_CACHE_SIZE \
+	add_size(offsetof(SnapshotCacheStruct, xids), \
+			 mul_size(sizeof(TransactionId), \
+					  add_size(PROCARRAY_MAXPROCS, TOTAL_MAX_CACHED_SUBXIDS)))
+
+	size = add_size(size, SNAPSHOT_CACHE_SIZE);
+
 	if (EnableHotStandby)
 	{
 		size = add_size(size,
@@ -412,6 +461,14 @@ CreateSharedProcArray(void)
 
 	allProcs = ProcGlobal->allProcs;
 
+	snapshotCache = (SnapshotCacheStruct *)
+		ShmemInitStruct("Snapshot Cache", SNAPSHOT_CACHE_SIZE, &found);
+	if (!found)
+	{
+		pg_atomic_init_u64(&snapshotCache->completionCount, 0);
+		pg_atomic_init_flag(&snapshotCache->fill_in_progress);
+	}
+
 	/* Create or attach to the KnownAssignedXids arrays too, if needed */
 	if (EnableHotStandby)
 	{
@@ -2027,6 +2084,82 @@ GetSnapshotDataReuse(Snapshot snapshot)
 	return true;
 }
 
+/*
+ * Helper function for GetSnapshotData() that copies the contents of the
+ * shared snapshot cache into the snapshot, if they were built for the current
+ * xactCompletionCount.  The caller must not have an xid of its own.
+ *
+ * Like GetSnapshotDataReuse(), this relies on the snapshot contents being
+ * the same for all backends without an xid as long as xactCompletionCount
+ * doesn't change, which it can't while we hold ProcArrayLock.
+ */
+static bool
+SnapshotCacheLookup(Snapshot snapshot, uint64 completionCount,
+					TransactionId xmax, TransactionId *xmin, size_t *count,
+					int *subcount, bool *suboverflowed)
+{
+	Assert(LWLockHeldByMe(ProcArrayLock));
+	Assert(!TransactionIdIsValid(MyProc->xid));
+
+	if (pg_atomic_read_u64(&snapshotCache->completionCount) != completionCount)
+		return false;
+
+	/* pairs with the barrier in SnapshotCacheFill() */
+	pg_read_barrier();
+
+	Assert(snapshotCache->xmax == xmax);
+
+	*xmin = snapshotCache->xmin;
+	*count = snapshotCache->xcnt;
+	*subcount = snapshotCache->subxcnt;
+	*suboverflowed = snapshotCache->suboverflowed;
+
+	memcpy(snapshot->xip, snapshotCache->xids,
+		   *count * sizeof(TransactionId));
+	memcpy(snapshot->subxip, snapshotCache->xids + procArray->maxProcs,
+		   *subcount * sizeof(TransactionId));
+
+	return true;
+}
+
+/*
+ * Store a snapshot just built by GetSnapshotData() in the shared snapshot
+ * cache, unless some other backend already did or is doing so.
+ */
+static void
+SnapshotCacheFill(Snapshot snapshot, uint64 completionCount,
+				  TransactionId xmin, TransactionId xmax,
+				  size_t count, int subcount, bool suboverflowed)
+{
+	Assert(LWLockHeldByMe(ProcArrayLock));
+	Assert(!TransactionIdIsValid(MyProc->xid));
+
+	if (pg_atomic_read_u64(&snapshotCache->completionCount) == completionCount)
+		return;
+	if (!pg_atomic_test_set_flag(&snapshotCache->fill_in_progress))
+		return;
+
+	/* somebody else might have filled it before we got the flag */
+	if (pg_atomic_read_u64(&snapshotCache->completionCount) != completionCount)
+	{
+		snapshotCache->xmin = xmin;
+		snapshotCache->xmax = xmax;
+		snapshotCache->xcnt = count;
+		snapshotCache->subxcnt = subcount;
+		snapshotCache->suboverflowed = suboverflowed;
+		memcpy(snapshotCache->xids, snapshot->xip,
+			   count * sizeof(TransactionId));
+		memcpy(snapshotCache->xids + procArray->maxProcs, snapshot->subxip,
+			   subcount * sizeof(TransactionId));
+
+		/* make the contents visible before marking them valid */
+		pg_write_barrier();
+		pg_atomic_write_u64(&snapshotCache->completionCount, completionCount);
+	}
+
+	pg_atomic_clear_flag(&snapshotCache->fill_in_progress);
+}
+
 /*
  * GetSnapshotData -- returns information about running transactions.
  *
@@ -2075,6 +2208,7 @@ GetSnapshotData(Snapshot snapshot)
 	int			mypgxactoff;
 	TransactionId myxid;
 	uint64		curXactCompletionCount;
+	bool		use_cache;
 
 	TransactionId replication_slot_xmin = InvalidTransactionId;
 	TransactionId replication_slot_catalog_xmin = InvalidTransactionId;
@@ -2147,7 +2281,21 @@ GetSnapshotData(Snapshot snapshot)
 
 	snapshot->takenDuringRecovery = RecoveryInProgress();
 
-	if (!snapshot->takenDuringRecovery)
+	/*
+	 * Unless we have an xid, which needs to be left out of our snapshot, try
+	 * to copy what another backend computed since the last transaction
+	 * finished.
+	 */
+	use_cache = !snapshot->takenDuringRecovery &&
+		!TransactionIdIsValid(myxid);
+
+	if (use_cache &&
+		SnapshotCacheLookup(snapshot, curXactCompletionCount, xmax,
+							&xmin, &count, &subcount, &suboverflowed))
+	{
+		/* nothing more to do */
+	}
+	else if (!snapshot->takenDuringRecovery)
 	{
 		size_t		numProcs = arrayP->numProcs;
 		TransactionId *xip = snapshot->xip;
@@ -2251,6 +2399,10 @@ GetSnapshotData(Snapshot snapshot)
 				}
 			}
 		}
+
+		if (use_cache)
+			SnapshotCacheFill(snapshot, curXactCompletionCount, xmin, xmax,
+							  count, subcount, suboverflowed);
 	}
 	else
 	{
@@ -3415,6 +3567,8 @@ CountDBConnections(Oid databaseid)
 			continue;			/* do not count prepared xacts */
 		if (proc->isBackgroundWorker)
 			continue;			/* do not count background workers */
+		if (ProcGlobal->vacuumFlags[index] & PROC_IS_PREFORKED)
+			continue;			/* nor pre-forked backends without a client */
 		if (!OidIsValid(databaseid) ||
 			proc->databaseId == databaseid)
 			count++;
@@ -3499,8 +3653,10 @@ CountUserBackends(Oid roleid)
  * CountOtherDBBackends -- check for other backends running in the given DB
  *
  * If there are other backends in the DB, we will wait a maximum of 5 seconds
- * for them to exit.  Autovacuum backends are encouraged to exit early by
- * sending them SIGTERM, but normal user backends are just waited for.
+ * for them to exit.  Autovacuum backends, pre-forked backends still
+ * waiting for a client and pooled parallel workers waiting for work are
+ * encouraged to exit early by sending them SIGTERM, but normal user backends
+ * are just waited for.
  *
  * The current backend is always ignored; it is caller's responsibility to
  * check whether the current backend uses the given DB, if it's important.
@@ -3523,7 +3679,8 @@ CountOtherDBBackends(Oid databaseId, int *nbackends, int *nprepared)
 {
 	ProcArrayStruct *arrayP = procArray;
 
-#define MAXAUTOVACPIDS	10		/* max autovacs to SIGTERM per iteration */
+#define MAXAUTOVACPIDS	10		/* max autovacs and pre-forked backends to
+								 * SIGTERM per iteration */
 	int			autovac_pids[MAXAUTOVACPIDS];
 	int			tries;
 
@@ -3558,7 +3715,8 @@ CountOtherDBBackends(Oid databaseId, int *nbackends, int *nprepared)
 			else
 			{
 				(*nbackends)++;
-				if ((vacuumFlags & PROC_IS_AUTOVACUUM) &&
+				if ((vacuumFlags & (PROC_IS_AUTOVACUUM | PROC_IS_PREFORKED |
+									PROC_IS_IDLE_PARALLEL_WORKER)) &&
 					nautovacs < MAXAUTOVACPIDS)
 					autovac_pids[nautovacs++] = proc->pid;
 			}
@@ -3570,7 +3728,11 @@ CountOtherDBBackends(Oid databaseId, int *nbackends, int *nprepared)
 			return false;		/* no conflicting backends, so done */
 
 		/*
-		 * Send SIGTERM to any conflicting autovacuums before sleeping. We
+		 * Send SIGTERM to any conflicting autovacuums, pre-forked backends
+		 * and idle pooled parallel workers before sleeping.  (A pre-forked
+		 * backend may have been handed a client meanwhile, whose connection
+		 * is then terminated; likewise, a parallel worker may have been
+		 * handed a parallel query, which then fails.)  We
 		 * postpone this step until after the loop because we don't want to
 		 * hold ProcArrayLock while issuing kill(). We have no idea what might
 		 * block kill() inside the kernel...
@@ -3826,6 +3988,12 @@ XidCacheRemoveRunningXids(TransactionId xid,
 	/* Also advance global latestCompletedXid while holding the lock */
 	MaintainLatestCompletedXid(latestXid);
 
+	/*
+	 * That changes the xmax of new snapshots, so a snapshot cached for the
+	 * current completion count must not be reused.
+	 */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -4280,6 +4448,9 @@ ExpireTreeKnownAssignedTransactionIds(TransactionId xid, int nsubxids,
 	/* As in ProcArrayEndTransaction, advance latestCompletedXid */
 	MaintainLatestCompletedXidRecovery(max_xid);
 
+	/* ... and xactCompletionCount */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -4292,6 +4463,13 @@ ExpireAllKnownAssignedTransactionIds(void)
 {
 	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
 	KnownAssignedXidsRemovePreceding(InvalidTransactionId);
+
+	/*
+	 * Any transactions that were in-progress were effectively aborted, so
+	 * advance xactCompletionCount.
+	 */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -4304,6 +4482,13 @@ ExpireOldKnownAssignedTransactionIds(TransactionId xid)
 {
 	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
 	KnownAssignedXidsRemovePreceding(xid);
+
+	/*
+	 * Any transactions that were in-progress were effectively aborted, so
+	 * advance xactCompletionCount.
+	 */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -107,6 +107,13 @@ struct shm_mq
  * locally by copying the chunks into a backend-local buffer.  mqh_buffer is
  * the buffer, and mqh_buflen is the number of bytes allocated for it.
  *
+ * mqh_send_pending is the number of bytes that the sender has written into
+ * the ring but not yet added to mq_bytes_written, and mqh_consume_pending
+ * is the number of bytes that the receiver has consumed but not yet added
+ * to mq_bytes_read.  Updating those counters costs a memory barrier, and
+ * the counterparty must be woken up with SetLatch(), which is fairly
+ * expensive, so we try to do it only once per batch of messages.
+ *
  * mqh_partial_bytes, mqh_expected_bytes, and mqh_length_word_complete
  * are used to track the state of non-blocking operations.  When the caller
  * attempts a non-blocking operation that returns SHM_MQ_WOULD_BLOCK, they
@@ -135,6 +142,7 @@ struct shm_mq_handle
 	char	   *mqh_buffer;
 	Size		mqh_buflen;
 	Size		mqh_consume_pending;
+	Size		mqh_send_pending;
 	Size		mqh_partial_bytes;
 	Size		mqh_expected_bytes;
 	bool		mqh_length_word_complete;
@@ -145,9 +153,12 @@ struct shm_mq_handle
 static void shm_mq_detach_internal(shm_mq *mq);
 static shm_mq_result shm_mq_send_bytes(shm_mq_handle *mqh, Size nbytes,
 									   const void *data, bool nowait, Size *bytes_written);
+static shm_mq_result shm_mq_receive_internal(shm_mq_handle *mqh,
+											 Size *nbytesp, void **datap,
+											 bool nowait, bool hold);
 static shm_mq_result shm_mq_receive_bytes(shm_mq_handle *mqh,
-										  Size bytes_needed, bool nowait, Size *nbytesp,
-										  void **datap);
+										  Size bytes_needed, bool nowait, bool hold,
+										  Size *nbytesp, void **datap);
 static bool shm_mq_counterparty_gone(shm_mq *mq,
 									 BackgroundWorkerHandle *handle);
 static bool shm_mq_wait_internal(shm_mq *mq, PGPROC **ptr,
@@ -290,6 +301,7 @@ shm_mq_attach(shm_mq *mq, dsm_segment *seg, BackgroundWorkerHandle *handle)
 	mqh->mqh_buffer = NULL;
 	mqh->mqh_buflen = 0;
 	mqh->mqh_consume_pending = 0;
+	mqh->mqh_send_pending = 0;
 	mqh->mqh_partial_bytes = 0;
 	mqh->mqh_expected_bytes = 0;
 	mqh->mqh_length_word_complete = false;
@@ -317,14 +329,15 @@ shm_mq_set_handle(shm_mq_handle *mqh, BackgroundWorkerHandle *handle)
  * Write a message into a shared message queue.
  */
 shm_mq_result
-shm_mq_send(shm_mq_handle *mqh, Size nbytes, const void *data, bool nowait)
+shm_mq_send(shm_mq_handle *mqh, Size nbytes, const void *data, bool nowait,
+			bool force_flush)
 {
 	shm_mq_iovec iov;
 
 	iov.data = data;
 	iov.len = nbytes;
 
-	return shm_mq_sendv(mqh, &iov, 1, nowait);
+	return shm_mq_sendv(mqh, &iov, 1, nowait, force_flush);
 }
 
 /*
@@ -341,13 +354,21 @@ shm_mq_send(shm_mq_handle *mqh, Size nbytes, const void *data, bool nowait)
  * arguments, each time the process latch is set.  (Once begun, the sending
  * of a message cannot be aborted except by detaching from the queue; changing
  * the length or payload will corrupt the queue.)
+ *
+ * When force_flush = true, the message is made visible to the receiver, and
+ * the receiver's latch is set, before we return.  Otherwise, that is put off
+ * until more than 1/4th of the ring has been filled with unflushed messages,
+ * or the ring fills up, so that a sender of many messages wakes up the
+ * receiver once per batch rather than once per message.  A caller that
+ * doesn't force a flush must eventually call shm_mq_flush() or
+ * shm_mq_detach(), or the receiver may never see the last messages.
  */
 shm_mq_result
-shm_mq_sendv(shm_mq_handle *mqh, shm_mq_iovec *iov, int iovcnt, bool nowait)
+shm_mq_sendv(shm_mq_handle *mqh, shm_mq_iovec *iov, int iovcnt, bool nowait,
+			 bool force_flush)
 {
 	shm_mq_result res;
 	shm_mq	   *mq = mqh->mqh_queue;
-	PGPROC	   *receiver;
 	Size		nbytes = 0;
 	Size		bytes_written;
 	int			i;
@@ -488,6 +509,36 @@ shm_mq_sendv(shm_mq_handle *mqh, shm_mq_iovec *iov, int iovcnt, bool nowait)
 	mqh->mqh_partial_bytes = 0;
 	mqh->mqh_length_word_complete = false;
 
+	/* If queue has been detached, let caller know. */
+	if (mq->mq_detached)
+		return SHM_MQ_DETACHED;
+
+	/* Notify receiver of the newly-written data, if it's time to. */
+	if (force_flush || mqh->mqh_send_pending > mq->mq_ring_size / 4)
+		return shm_mq_flush(mqh);
+
+	return SHM_MQ_SUCCESS;
+}
+
+/*
+ * Make all messages sent so far visible to the receiver, and wake it up.
+ *
+ * This is only needed after sending messages with force_flush = false.
+ */
+shm_mq_result
+shm_mq_flush(shm_mq_handle *mqh)
+{
+	shm_mq	   *mq = mqh->mqh_queue;
+	PGPROC	   *receiver;
+
+	Assert(mq->mq_sender == MyProc);
+
+	if (mqh->mqh_send_pending > 0)
+	{
+		shm_mq_inc_bytes_written(mq, mqh->mqh_send_pending);
+		mqh->mqh_send_pending = 0;
+	}
+
 	/* If queue has been detached, let caller know. */
 	if (mq->mq_detached)
 		return SHM_MQ_DETACHED;
@@ -509,7 +560,6 @@ shm_mq_sendv(shm_mq_handle *mqh, shm_mq_iovec *iov, int iovcnt, bool nowait)
 		mqh->mqh_counterparty_attached = true;
 	}
 
-	/* Notify receiver of the newly-written data, and return. */
 	SetLatch(&receiver->procLatch);
 	return SHM_MQ_SUCCESS;
 }
@@ -538,6 +588,78 @@ shm_mq_sendv(shm_mq_handle *mqh, shm_mq_iovec *iov, int iovcnt, bool nowait)
  */
 shm_mq_result
 shm_mq_receive(shm_mq_handle *mqh, Size *nbytesp, void **datap, bool nowait)
+{
+	return shm_mq_receive_internal(mqh, nbytesp, datap, nowait, false);
+}
+
+/*
+ * Receive up to maxmsgs messages from a shared message queue.
+ *
+ * The first message is received just like shm_mq_receive() would; after
+ * that, we keep going as long as further messages are already complete in
+ * the queue, without ever waiting.  On success, *nmsgs is set to the number
+ * of messages received, and msgs[i] describes the i'th of them.
+ *
+ * The space that received messages occupy in the ring is only given back to
+ * the sender at the next receive operation, so each message that is stored
+ * contiguously in the ring is returned as a pointer into shared memory, and
+ * all of them remain valid until the next receive operation, just like a
+ * single message returned by shm_mq_receive().  A message that wraps around
+ * the end of the ring must be copied into our buffer, though, so it can only
+ * be the last one of a batch.
+ *
+ * If no message can be received, the return value is the same as that of
+ * shm_mq_receive(); a failure to receive any message after the first one is
+ * not reported until the next call.
+ */
+shm_mq_result
+shm_mq_receive_many(shm_mq_handle *mqh, shm_mq_iovec *msgs, int maxmsgs,
+					int *nmsgs, bool nowait)
+{
+	int			n = 0;
+
+	Assert(maxmsgs > 0);
+
+	while (n < maxmsgs)
+	{
+		shm_mq_result res;
+		Size		nbytes;
+		void	   *data;
+
+		if (n == 0)
+			res = shm_mq_receive_internal(mqh, &nbytes, &data, nowait, false);
+		else
+			res = shm_mq_receive_internal(mqh, &nbytes, &data, true, true);
+		if (res != SHM_MQ_SUCCESS)
+		{
+			if (n == 0)
+				return res;
+			break;
+		}
+
+		msgs[n].data = data;
+		msgs[n].len = nbytes;
+		n++;
+
+		/* The next message would overwrite our buffer. */
+		if (data == mqh->mqh_buffer)
+			break;
+	}
+
+	*nmsgs = n;
+	return SHM_MQ_SUCCESS;
+}
+
+/*
+ * Guts of shm_mq_receive() and shm_mq_receive_many().
+ *
+ * If hold is true, we don't give back the space of previously received
+ * messages to the sender, even if we have to return SHM_MQ_WOULD_BLOCK.
+ * That's only safe with nowait, since the sender might be waiting for it.
+ */
+static shm_mq_result
+shm_mq_receive_internal(shm_mq_handle *mqh, Size *nbytesp, void **datap,
+						bool nowait, bool hold)
 {
 	shm_mq	   *mq = mqh->mqh_queue;
 	shm_mq_result res;
@@ -546,6 +668,7 @@ shm_mq_receive(shm_mq_handle *mqh, Size *nbytesp, void **datap, bool nowait)
 	void	   *rawdata;
 
 	Assert(mq->mq_receiver == MyProc);
+	Assert(nowait || !hold);
 
 	/* We can't receive data until the sender has attached. */
 	if (!mqh->mqh_counterparty_attached)
@@ -590,7 +713,7 @@ shm_mq_receive(shm_mq_handle *mqh, Size *nbytesp, void **datap, bool nowait)
 	 * because SetLatch() is fairly expensive and we don't want to do it too
 	 * often.
 	 */
-	if (mqh->mqh_consume_pending > mq->mq_ring_size / 4)
+	if (!hold && mqh->mqh_consume_pending > mq->mq_ring_size / 4)
 	{
 		shm_mq_inc_bytes_read(mq, mqh->mqh_consume_pending);
 		mqh->mqh_consume_pending = 0;
@@ -602,7 +725,7 @@ shm_mq_receive(shm_mq_handle *mqh, Size *nbytesp, void **datap, bool nowait)
 		/* Try to receive the message length word. */
 		Assert(mqh->mqh_partial_bytes < sizeof(Size));
 		res = shm_mq_receive_bytes(mqh, sizeof(Size) - mqh->mqh_partial_bytes,
-								   nowait, &rb, &rawdata);
+								   nowait, hold, &rb, &rawdata);
 		if (res != SHM_MQ_SUCCESS)
 			return res;
 
@@ -682,7 +805,7 @@ shm_mq_receive(shm_mq_handle *mqh, Size *nbytesp, void **datap, bool nowait)
 		 * we need not copy the data and can return a pointer directly into
 		 * shared memory.
 		 */
-		res = shm_mq_receive_bytes(mqh, nbytes, nowait, &rb, &rawdata);
+		res = shm_mq_receive_bytes(mqh, nbytes, nowait, hold, &rb, &rawdata);
 		if (res != SHM_MQ_SUCCESS)
 			return res;
 		if (rb >= nbytes)
@@ -742,7 +865,8 @@ shm_mq_receive(shm_mq_handle *mqh, Size *nbytesp, void **datap, bool nowait)
 
 		/* Wait for some more data. */
 		still_needed = nbytes - mqh->mqh_partial_bytes;
-		res = shm_mq_receive_bytes(mqh, still_needed, nowait, &rb, &rawdata);
+		res = shm_mq_receive_bytes(mqh, still_needed, nowait, hold, &rb,
+								   &rawdata);
 		if (res != SHM_MQ_SUCCESS)
 			return res;
 		if (rb > still_needed)
@@ -792,6 +916,13 @@ shm_mq_wait_for_attach(shm_mq_handle *mqh)
 void
 shm_mq_detach(shm_mq_handle *mqh)
 {
+	/* Before detaching, make any messages we haven't flushed visible. */
+	if (mqh->mqh_send_pending > 0)
+	{
+		shm_mq_inc_bytes_written(mqh->mqh_queue, mqh->mqh_send_pending);
+		mqh->mqh_send_pending = 0;
+	}
+
 	/* Notify counterparty that we're outta here. */
 	shm_mq_detach_internal(mqh->mqh_queue);
 
@@ -850,6 +981,25 @@ shm_mq_get_queue(shm_mq_handle *mqh)
 	return mqh->mqh_queue;
 }
 
+/*
+ * Has the receiver consumed everything written to the queue so far?
+ *
+ * This is meant for a sender deciding whether to hold back data it could
+ * combine into a larger message.  The receiver only reports consumed bytes
+ * lazily, but always does so before it waits for more data, so a true result
+ * means that the receiver is (or is about to be) waiting.  Messages that we
+ * haven't flushed yet are invisible to the receiver, so they don't count.
+ * The answer can be out of date by the time the caller acts on it.
+ */
+bool
+shm_mq_is_drained(shm_mq_handle *mqh)
+{
+	shm_mq	   *mq = mqh->mqh_queue;
+
+	return pg_atomic_read_u64(&mq->mq_bytes_read) ==
+		pg_atomic_read_u64(&mq->mq_bytes_written);
+}
+
 /*
  * Write bytes into a shared message queue.
  */
@@ -868,9 +1018,12 @@ shm_mq_send_bytes(shm_mq_handle *mqh, Size nbytes, const void *data,
 		uint64		rb;
 		uint64		wb;
 
-		/* Compute number of ring buffer bytes used and available. */
+		/*
+		 * Compute number of ring buffer bytes used and available.  Bytes we
+		 * have written but not yet flushed are used, too.
+		 */
 		rb = pg_atomic_read_u64(&mq->mq_bytes_read);
-		wb = pg_atomic_read_u64(&mq->mq_bytes_written);
+		wb = pg_atomic_read_u64(&mq->mq_bytes_written) + mqh->mqh_send_pending;
 		Assert(wb >= rb);
 		used = wb - rb;
 		Assert(used <= ringsize);
@@ -892,6 +1045,16 @@ shm_mq_send_bytes(shm_mq_handle *mqh, Size nbytes, const void *data,
 			return SHM_MQ_DETACHED;
 		}
 
+		/*
+		 * If the queue is full, the receiver must see everything we've
+		 * written before it can make room for more, so flush it now.
+		 */
+		if (available == 0 && mqh->mqh_send_pending > 0)
+		{
+			shm_mq_inc_bytes_written(mq, mqh->mqh_send_pending);
+			mqh->mqh_send_pending = 0;
+		}
+
 		if (available == 0 && !mqh->mqh_counterparty_attached)
 		{
 			/*
@@ -983,15 +1146,13 @@ shm_mq_send_bytes(shm_mq_handle *mqh, Size nbytes, const void *data,
 			 * that this will never actually insert any padding except at the
 			 * end of a run of bytes, because the buffer size is a multiple of
 			 * MAXIMUM_ALIGNOF, and each read is as well.
+			 *
+			 * For efficiency, we don't update mq_bytes_written or set the
+			 * reader's latch here.  We'll do that only when the buffer fills
+			 * up or the message is flushed.
 			 */
 			Assert(sent == nbytes || sendnow == MAXALIGN(sendnow));
-			shm_mq_inc_bytes_written(mq, MAXALIGN(sendnow));
-
-			/*
-			 * For efficiency, we don't set the reader's latch here.  We'll do
-			 * that only when the buffer fills up or after writing an entire
-			 * message.
-			 */
+			mqh->mqh_send_pending += MAXALIGN(sendnow);
 		}
 	}
 
@@ -1007,10 +1168,13 @@ shm_mq_send_bytes(shm_mq_handle *mqh, Size nbytes, const void *data,
  * to the location at which data bytes can be read, *nbytesp is set to the
  * number of bytes which can be read at that address, and the return value
  * is SHM_MQ_SUCCESS.
+ *
+ * If hold is true, data consumed earlier is not marked as read even if we
+ * have to return SHM_MQ_WOULD_BLOCK; see shm_mq_receive_internal.
  */
 static shm_mq_result
 shm_mq_receive_bytes(shm_mq_handle *mqh, Size bytes_needed, bool nowait,
-					 Size *nbytesp, void **datap)
+					 bool hold, Size *nbytesp, void **datap)
 {
 	shm_mq	   *mq = mqh->mqh_queue;
 	Size		ringsize = mq->mq_ring_size;
@@ -1075,9 +1239,10 @@ shm_mq_receive_bytes(shm_mq_handle *mqh, Size bytes_needed, bool nowait,
 
 		/*
 		 * We didn't get enough data to satisfy the request, so mark any data
-		 * previously-consumed as read to make more buffer space.
+		 * previously-consumed as read to make more buffer space, unless the
+		 * caller still needs it.
 		 */
-		if (mqh->mqh_consume_pending > 0)
+		if (!hold && mqh->mqh_consume_pending > 0)
 		{
 			shm_mq_inc_bytes_read(mq, mqh->mqh_consume_pending);
 			mqh->mqh_consume_pending = 0;
@@ -605,3 +605,107 @@ pg_get_shmem_allocations(PG_FUNCTION_ARGS)
 
 	return (Datum) 0;
 }
+
+/*
+ * Add rows to a pg_get_shmem_numa() result for one range of shared memory:
+ * one per NUMA node that some of it is on, and one with a null node for the
+ * part that isn't on any node yet.
+ */
+static void
+shmem_numa_put_range(Tuplestorestate *tupstore, TupleDesc tupdesc,
+					 const char *name, void *addr, Size size)
+{
+	Size		node_bytes[PG_SHMEM_MAX_NUMA_NODES];
+	Size		unplaced_bytes = 0;
+	Datum		values[3];
+	bool		nulls[3];
+	int			node;
+
+	memset(node_bytes, 0, sizeof(node_bytes));
+	if (!PGSharedMemoryNumaUsage(addr, size, node_bytes, &unplaced_bytes))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("NUMA information is not available on this platform")));
+
+	memset(nulls, 0, sizeof(nulls));
+	if (name)
+		values[0] = CStringGetTextDatum(name);
+	else
+		nulls[0] = true;
+
+	for (node = 0; node < PG_SHMEM_MAX_NUMA_NODES; node++)
+	{
+		if (node_bytes[node] == 0)
+			continue;
+		values[1] = Int32GetDatum(node);
+		values[2] = Int64GetDatum(node_bytes[node]);
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	if (unplaced_bytes > 0)
+	{
+		nulls[1] = true;
+		values[2] = Int64GetDatum(unplaced_bytes);
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+}
+
+/* SQL SRF showing the NUMA nodes the shared memory allocations are on */
+Datum
+pg_get_shmem_numa(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	HASH_SEQ_STATUS hstat;
+	ShmemIndexEnt *ent;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	LWLockAcquire(ShmemIndexLock, LW_SHARED);
+
+	hash_seq_init(&hstat, ShmemIndex);
+
+	/* output the placement of all allocated entries */
+	while ((ent = (ShmemIndexEnt *) hash_seq_search(&hstat)) != NULL)
+		shmem_numa_put_range(tupstore, tupdesc, ent->key,
+							 ent->location, ent->allocated_size);
+
+	/*
+	 * Also of the as-of-yet unused shared memory.  Allocations not counted
+	 * via the shmem index are left out, since we don't know where they are.
+	 */
+	shmem_numa_put_range(tupstore, tupdesc, NULL,
+						 (char *) ShmemSegHdr + ShmemSegHdr->freeoffset,
+						 ShmemSegHdr->totalsize - ShmemSegHdr->freeoffset);
+
+	LWLockRelease(ShmemIndexLock);
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
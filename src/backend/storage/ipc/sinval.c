@@ -16,6 +16,7 @@
 
 #include "access/xact.h"
 #include "commands/async.h"
+#include "common/hashfn.h"
 #include "miscadmin.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
@@ -59,6 +60,10 @@ SendSharedInvalidMessages(const SharedInvalidationMessage *msgs, int n)
  * routine was entered.  It is of course possible for more messages to get
  * queued right after our last SIGetDataEntries call.
  *
+ * If messages were lost because we fell too far behind, summaryFunction or
+ * resetFunction is called to discard whatever state they might have
+ * concerned, before processing the messages that follow them.
+ *
  * NOTE: it is entirely possible for this routine to be invoked recursively
  * as a consequence of processing inside the invalFunction or resetFunction.
  * Furthermore, such a recursive call must guarantee that all outstanding
@@ -69,6 +74,7 @@ SendSharedInvalidMessages(const SharedInvalidationMessage *msgs, int n)
  */
 void
 ReceiveSharedInvalidMessages(void (*invalFunction) (SharedInvalidationMessage *msg),
+							 void (*summaryFunction) (const SharedInvalidationSummary *summary),
 							 void (*resetFunction) (void))
 {
 #define MAXINVALMSGS 32
@@ -93,13 +99,14 @@ ReceiveSharedInvalidMessages(void (*invalFunction) (SharedInvalidationMessage *m
 	do
 	{
 		int			getResult;
+		SharedInvalidationSummary summary;
 
 		nextmsg = nummsgs = 0;
 
 		/* Try to get some more messages */
-		getResult = SIGetDataEntries(messages, MAXINVALMSGS);
+		getResult = SIGetDataEntries(messages, MAXINVALMSGS, &summary);
 
-		if (getResult < 0)
+		if (getResult == SI_GET_RESET)
 		{
 			/* got a reset message */
 			elog(DEBUG4, "cache state reset");
@@ -108,6 +115,16 @@ ReceiveSharedInvalidMessages(void (*invalFunction) (SharedInvalidationMessage *m
 			break;				/* nothing more to do */
 		}
 
+		if (getResult == SI_GET_SUMMARY)
+		{
+			/* got a summary of lost messages; more messages may follow */
+			elog(DEBUG4, "partial cache state reset");
+			SharedInvalidMessageCounter++;
+			summaryFunction(&summary);
+			nummsgs = MAXINVALMSGS;
+			continue;
+		}
+
 		/* Process them, being wary that a recursive call might eat some */
 		nextmsg = 0;
 		nummsgs = getResult;
@@ -143,6 +160,49 @@ ReceiveSharedInvalidMessages(void (*invalFunction) (SharedInvalidationMessage *m
 }
 
 
+/*
+ * Add a relation to the Bloom filter of a summary of lost messages
+ *
+ * We set two bits per relation, taken from a single hash value.
+ */
+void
+SharedInvalSummaryAddRelation(SharedInvalidationSummary *summary, Oid relid)
+{
+	uint32		hash = murmurhash32((uint32) relid);
+	uint32		bit1 = hash % SINVAL_SUMMARY_FILTER_BITS;
+	uint32		bit2 = (hash >> 16) % SINVAL_SUMMARY_FILTER_BITS;
+
+	summary->relations[bit1 / 64] |= UINT64CONST(1) << (bit1 % 64);
+	summary->relations[bit2 / 64] |= UINT64CONST(1) << (bit2 % 64);
+}
+
+/*
+ * Might messages about a relation have been summarized?
+ */
+bool
+SharedInvalSummaryHasRelation(const SharedInvalidationSummary *summary,
+							  Oid relid)
+{
+	uint32		hash = murmurhash32((uint32) relid);
+	uint32		bit1 = hash % SINVAL_SUMMARY_FILTER_BITS;
+	uint32		bit2 = (hash >> 16) % SINVAL_SUMMARY_FILTER_BITS;
+
+	return (summary->relations[bit1 / 64] & (UINT64CONST(1) << (bit1 % 64))) != 0 &&
+		(summary->relations[bit2 / 64] & (UINT64CONST(1) << (bit2 % 64))) != 0;
+}
+
+/*
+ * Were messages about a catalog cache summarized?
+ */
+bool
+SharedInvalSummaryHasCatcache(const SharedInvalidationSummary *summary,
+							  int cacheId)
+{
+	Assert(cacheId >= 0 && cacheId < SINVAL_SUMMARY_CATCACHES);
+
+	return (summary->catcaches[cacheId / 64] & (UINT64CONST(1) << (cacheId % 64))) != 0;
+}
+
 /*
  * HandleCatchupInterrupt
  *
@@ -19,6 +19,7 @@
 
 #include "access/transam.h"
 #include "miscadmin.h"
+#include "port/pg_bitutils.h"
 #include "storage/backendid.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
@@ -42,16 +43,22 @@
  * smallest nextMsgNum --- it may lag behind.  We only update it when
  * SICleanupQueue is called, and we try not to do that often.)
  *
- * In reality, the messages are stored in a circular buffer of MAXNUMMESSAGES
- * entries.  We translate MsgNum values into circular-buffer indexes by
- * computing MsgNum % MAXNUMMESSAGES (this should be fast as long as
- * MAXNUMMESSAGES is a constant and a power of 2).  As long as maxMsgNum
- * doesn't exceed minMsgNum by more than MAXNUMMESSAGES, we have enough space
- * in the buffer.  If the buffer does overflow, we recover by setting the
- * "reset" flag for each backend that has fallen too far behind.  A backend
- * that is in "reset" state is ignored while determining minMsgNum.  When
- * it does finally attempt to receive inval messages, it must discard all
- * its invalidatable state, since it won't know what it missed.
+ * In reality, the messages are stored in a circular buffer of queueSize
+ * entries, sinval_queue_size rounded up to a power of 2.  We translate
+ * MsgNum values into circular-buffer indexes by masking off the high bits.
+ * As long as maxMsgNum doesn't exceed minMsgNum by more than queueSize, we
+ * have enough space in the buffer.  If the buffer does overflow, we recover
+ * by summarizing the messages that backends who have fallen too far behind
+ * haven't read, and moving them ahead to half a queue behind, so that they
+ * won't need that again soon.  The summary (see SharedInvalidationSummary)
+ * only tells which catalog caches and, approximately, which relations the
+ * lost messages concerned, so that a backend reading it needs to discard
+ * just that state, not all of its caches; messages for other databases than
+ * the backend's are skipped.  Messages that can't be summarized, which are
+ * rare, set the "reset" flag for the backend instead.  A backend that is in
+ * "reset" state is ignored while determining minMsgNum.  When it does
+ * finally attempt to receive inval messages, it must discard all its
+ * invalidatable state, since it won't know what it missed.
  *
  * To reduce the probability of needing resets, we send a "catchup" interrupt
  * to any backend that seems to be falling unreasonably far behind.  The
@@ -73,7 +80,7 @@
  * whenever minMsgNum exceeds MSGNUMWRAPAROUND, we subtract MSGNUMWRAPAROUND
  * from all the MsgNum variables simultaneously.  MSGNUMWRAPAROUND can be
  * large so that we don't need to do this often.  It must be a multiple of
- * MAXNUMMESSAGES so that the existing circular-buffer entries don't need
+ * queueSize so that the existing circular-buffer entries don't need
  * to be moved when we do it.
  *
  * Access to the shared sinval array is protected by two locks, SInvalReadLock
@@ -106,11 +113,11 @@
 /*
  * Configurable parameters.
  *
- * MAXNUMMESSAGES: max number of shared-inval messages we can buffer.
- * Must be a power of 2 for speed.
+ * MAX_QUEUE_SIZE: max number of shared-inval messages we can buffer; the
+ * queue size itself is set by sinval_queue_size.
  *
  * MSGNUMWRAPAROUND: how often to reduce MsgNum variables to avoid overflow.
- * Must be a multiple of MAXNUMMESSAGES.  Should be large.
+ * Must be a multiple of MAX_QUEUE_SIZE.  Should be large.
  *
  * CLEANUP_MIN: the minimum number of messages that must be in the buffer
  * before we bother to call SICleanupQueue.
@@ -127,13 +134,19 @@
  * per iteration.
  */
 
-#define MAXNUMMESSAGES 4096
-#define MSGNUMWRAPAROUND (MAXNUMMESSAGES * 262144)
-#define CLEANUP_MIN (MAXNUMMESSAGES / 2)
-#define CLEANUP_QUANTUM (MAXNUMMESSAGES / 16)
-#define SIG_THRESHOLD (MAXNUMMESSAGES / 2)
+#define MAX_QUEUE_SIZE (1 << 20)
+#define MSGNUMWRAPAROUND (MAX_QUEUE_SIZE * 1024)
+#define CLEANUP_MIN(segP) ((segP)->queueSize / 2)
+#define CLEANUP_QUANTUM(segP) ((segP)->queueSize / 16)
+#define SIG_THRESHOLD(segP) ((segP)->queueSize / 2)
 #define WRITE_QUANTUM 64
 
+/* circular-buffer slot of a message */
+#define MSG_SLOT(segP, msgnum) ((msgnum) & ((segP)->queueSize - 1))
+
+/* GUC variable */
+int			sinval_queue_size = 4096;
+
 /* Per-backend state in shared invalidation structure */
 typedef struct ProcState
 {
@@ -154,6 +167,10 @@ typedef struct ProcState
 	 */
 	bool		sendOnly;		/* backend only sends, never receives */
 
+	/* Summary of messages dropped before the backend could read them */
+	bool		hasSummary;		/* summary has anything in it */
+	SharedInvalidationSummary summary;
+
 	/*
 	 * Next LocalTransactionId to use for each idle backend slot.  We keep
 	 * this here because it is indexed by BackendId and it is convenient to
@@ -174,13 +191,15 @@ typedef struct SISeg
 	int			nextThreshold;	/* # of messages to call SICleanupQueue */
 	int			lastBackend;	/* index of last active procState entry, +1 */
 	int			maxBackends;	/* size of procState array */
+	int			queueSize;		/* size of buffer array, a power of 2 */
 
 	slock_t		msgnumLock;		/* spinlock protecting maxMsgNum */
 
 	/*
-	 * Circular buffer holding shared-inval messages
+	 * Circular buffer holding shared-inval messages, allocated after the
+	 * procState array
 	 */
-	SharedInvalidationMessage buffer[MAXNUMMESSAGES];
+	SharedInvalidationMessage *buffer;
 
 	/*
 	 * Per-backend invalidation state info (has MaxBackends entries).
@@ -194,8 +213,19 @@ static SISeg *shmInvalBuffer;	/* pointer to the shared inval buffer */
 static LocalTransactionId nextLocalTransactionId;
 
 static void CleanupInvalidationState(int status, Datum arg);
+static bool SISummarizeMessages(SISeg *segP, ProcState *stateP, int upto);
 
 
+/*
+ * Number of messages in the circular buffer
+ */
+static int
+SInvalQueueSize(void)
+{
+	return (int) pg_nextpower2_32((uint32) Min(sinval_queue_size,
+											   MAX_QUEUE_SIZE));
+}
+
 /*
  * SInvalShmemSize --- return shared-memory space needed
  */
@@ -206,6 +236,9 @@ SInvalShmemSize(void)
 
 	size = offsetof(SISeg, procState);
 	size = add_size(size, mul_size(sizeof(ProcState), MaxBackends));
+	size = MAXALIGN(size);
+	size = add_size(size, mul_size(sizeof(SharedInvalidationMessage),
+								   SInvalQueueSize()));
 
 	return size;
 }
@@ -229,9 +262,14 @@ CreateSharedInvalidationState(void)
 	/* Clear message counters, save size of procState array, init spinlock */
 	shmInvalBuffer->minMsgNum = 0;
 	shmInvalBuffer->maxMsgNum = 0;
-	shmInvalBuffer->nextThreshold = CLEANUP_MIN;
 	shmInvalBuffer->lastBackend = 0;
 	shmInvalBuffer->maxBackends = MaxBackends;
+	shmInvalBuffer->queueSize = SInvalQueueSize();
+	shmInvalBuffer->nextThreshold = CLEANUP_MIN(shmInvalBuffer);
+	shmInvalBuffer->buffer = (SharedInvalidationMessage *)
+		((char *) shmInvalBuffer +
+		 MAXALIGN(offsetof(SISeg, procState) +
+				  MaxBackends * sizeof(ProcState)));
 	SpinLockInit(&shmInvalBuffer->msgnumLock);
 
 	/* The buffer[] array is initially all unused, so we need not fill it */
@@ -245,6 +283,7 @@ CreateSharedInvalidationState(void)
 		shmInvalBuffer->procState[i].resetState = false;
 		shmInvalBuffer->procState[i].signaled = false;
 		shmInvalBuffer->procState[i].hasMessages = false;
+		shmInvalBuffer->procState[i].hasSummary = false;
 		shmInvalBuffer->procState[i].nextLXID = InvalidLocalTransactionId;
 	}
 }
@@ -314,6 +353,8 @@ SharedInvalBackendInit(bool sendOnly)
 	stateP->signaled = false;
 	stateP->hasMessages = false;
 	stateP->sendOnly = sendOnly;
+	stateP->hasSummary = false;
+	MemSet(&stateP->summary, 0, sizeof(SharedInvalidationSummary));
 
 	LWLockRelease(SInvalWriteLock);
 
@@ -464,7 +505,7 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
 		for (;;)
 		{
 			numMsgs = segP->maxMsgNum - segP->minMsgNum;
-			if (numMsgs + nthistime > MAXNUMMESSAGES ||
+			if (numMsgs + nthistime > segP->queueSize ||
 				numMsgs >= segP->nextThreshold)
 				SICleanupQueue(true, nthistime);
 			else
@@ -477,7 +518,7 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
 		max = segP->maxMsgNum;
 		while (nthistime-- > 0)
 		{
-			segP->buffer[max % MAXNUMMESSAGES] = *data++;
+			segP->buffer[MSG_SLOT(segP, max)] = *data++;
 			max++;
 		}
 
@@ -511,7 +552,9 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
  * Possible return values:
  *	0:	 no SI message available
  *	n>0: next n SI messages have been extracted into data[]
- * -1:	 SI reset message extracted
+ *	SI_GET_RESET:	SI reset message extracted
+ *	SI_GET_SUMMARY: summary of lost messages extracted into *summary;
+ *					call again for the messages that follow
  *
  * If the return value is less than the array size "datasize", the caller
  * can assume that there are no more SI messages after the one(s) returned.
@@ -533,7 +576,8 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
  * to break our hold on SInvalReadLock into segments.
  */
 int
-SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
+SIGetDataEntries(SharedInvalidationMessage *data, int datasize,
+				 SharedInvalidationSummary *summary)
 {
 	SISeg	   *segP;
 	ProcState  *stateP;
@@ -585,8 +629,24 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
 		stateP->nextMsgNum = max;
 		stateP->resetState = false;
 		stateP->signaled = false;
+		stateP->hasSummary = false;
+		MemSet(&stateP->summary, 0, sizeof(SharedInvalidationSummary));
 		LWLockRelease(SInvalReadLock);
-		return -1;
+		return SI_GET_RESET;
+	}
+
+	if (stateP->hasSummary)
+	{
+		/*
+		 * Hand over the summary of the messages we lost.  The messages that
+		 * follow them come with the next call.
+		 */
+		memcpy(summary, &stateP->summary, sizeof(SharedInvalidationSummary));
+		stateP->hasSummary = false;
+		MemSet(&stateP->summary, 0, sizeof(SharedInvalidationSummary));
+		stateP->hasMessages = true;
+		LWLockRelease(SInvalReadLock);
+		return SI_GET_SUMMARY;
 	}
 
 	/*
@@ -600,7 +660,7 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
 	n = 0;
 	while (n < datasize && stateP->nextMsgNum < max)
 	{
-		data[n++] = segP->buffer[stateP->nextMsgNum % MAXNUMMESSAGES];
+		data[n++] = segP->buffer[MSG_SLOT(segP, stateP->nextMsgNum)];
 		stateP->nextMsgNum++;
 	}
 
@@ -627,8 +687,9 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
  * callerHasWriteLock is true if caller is holding SInvalWriteLock.
  * minFree is the minimum number of message slots to make free.
  *
- * Possible side effects of this routine include marking one or more
- * backends as "reset" in the array, and sending PROCSIG_CATCHUP_INTERRUPT
+ * Possible side effects of this routine include summarizing messages for,
+ * or marking as "reset", one or more backends in the array, and sending
+ * PROCSIG_CATCHUP_INTERRUPT
  * to some backend that seems to be getting too far behind.  We signal at
  * most one backend at a time, for reasons explained at the top of the file.
  *
@@ -660,8 +721,8 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 	 * a problem even when they are the only active backend.
 	 */
 	min = segP->maxMsgNum;
-	minsig = min - SIG_THRESHOLD;
-	lowbound = min - MAXNUMMESSAGES + minFree;
+	minsig = min - SIG_THRESHOLD(segP);
+	lowbound = min - segP->queueSize + minFree;
 
 	for (i = 0; i < segP->lastBackend; i++)
 	{
@@ -673,14 +734,25 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 			continue;
 
 		/*
-		 * If we must free some space and this backend is preventing it, force
-		 * him into reset state and then ignore until he catches up.
+		 * If we must free some space and this backend is preventing it,
+		 * summarize the messages he hasn't read, up to half a queue behind
+		 * the newest one so that this doesn't have to be repeated for every
+		 * write.  If that's not possible, force him into reset state and
+		 * then ignore until he catches up.
 		 */
 		if (n < lowbound)
 		{
-			stateP->resetState = true;
-			/* no point in signaling him ... */
-			continue;
+			int			upto = Max(lowbound,
+								   segP->maxMsgNum - segP->queueSize / 2);
+
+			if (!SISummarizeMessages(segP, stateP, upto))
+			{
+				stateP->resetState = true;
+				/* no point in signaling him ... */
+				continue;
+			}
+			stateP->nextMsgNum = n = upto;
+			stateP->hasSummary = true;
 		}
 
 		/* Track the global minimum nextMsgNum */
@@ -717,10 +789,11 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 	 * threshold at which we should repeat SICleanupQueue().
 	 */
 	numMsgs = segP->maxMsgNum - segP->minMsgNum;
-	if (numMsgs < CLEANUP_MIN)
-		segP->nextThreshold = CLEANUP_MIN;
+	if (numMsgs < CLEANUP_MIN(segP))
+		segP->nextThreshold = CLEANUP_MIN(segP);
 	else
-		segP->nextThreshold = (numMsgs / CLEANUP_QUANTUM + 1) * CLEANUP_QUANTUM;
+		segP->nextThreshold = (numMsgs / CLEANUP_QUANTUM(segP) + 1) *
+			CLEANUP_QUANTUM(segP);
 
 	/*
 	 * Lastly, signal anyone who needs a catchup interrupt.  Since
@@ -748,6 +821,79 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 	}
 }
 
+/*
+ * SISummarizeMessages
+ *		Add the messages a backend hasn't read, up to "upto", to its summary
+ *
+ * Caller must hold SInvalWriteLock and SInvalReadLock exclusively.  Returns
+ * false if a message that can't be summarized was found; the backend must
+ * then be reset.
+ */
+static bool
+SISummarizeMessages(SISeg *segP, ProcState *stateP, int upto)
+{
+	SharedInvalidationSummary *summary = &stateP->summary;
+	Oid			dbid = stateP->proc->databaseId;
+	int			i;
+
+	/*
+	 * Messages for other databases don't matter to the backend, unless it
+	 * isn't connected to one yet.
+	 */
+#define SUMMARY_SKIPS_DB(msgdb) \
+	(OidIsValid(dbid) && OidIsValid(msgdb) && (msgdb) != dbid)
+
+	for (i = stateP->nextMsgNum; i < upto; i++)
+	{
+		SharedInvalidationMessage *msg = &segP->buffer[MSG_SLOT(segP, i)];
+
+		if (msg->id >= 0)
+		{
+			if (SUMMARY_SKIPS_DB(msg->cc.dbId))
+				continue;
+			if (msg->cc.id >= SINVAL_SUMMARY_CATCACHES)
+				return false;
+			summary->catcaches[msg->cc.id / 64] |=
+				UINT64CONST(1) << (msg->cc.id % 64);
+		}
+		else if (msg->id == SHAREDINVALRELCACHE_ID)
+		{
+			if (SUMMARY_SKIPS_DB(msg->rc.dbId))
+				continue;
+			if (!OidIsValid(msg->rc.relId))
+				return false;
+			SharedInvalSummaryAddRelation(summary, msg->rc.relId);
+		}
+		else if (msg->id == SHAREDINVALSMGR_ID)
+		{
+			/* a backend can have smgr entries of any database */
+			summary->smgr = true;
+		}
+		else if (msg->id == SHAREDINVALSNAPSHOT_ID)
+		{
+			/* the catalog snapshot is invalidated for any summary */
+		}
+		else if (msg->id == SHAREDINVALCATALOG_ID)
+		{
+			if (SUMMARY_SKIPS_DB(msg->cat.dbId))
+				continue;
+			return false;
+		}
+		else if (msg->id == SHAREDINVALRELMAP_ID)
+		{
+			if (SUMMARY_SKIPS_DB(msg->rm.dbId))
+				continue;
+			return false;
+		}
+		else
+			return false;
+	}
+
+#undef SUMMARY_SKIPS_DB
+
+	return true;
+}
+
 
 /*
  * GetNextLocalTransactionId --- allocate a new LocalTransactionId
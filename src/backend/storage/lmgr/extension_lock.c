@@ -0,0 +1,210 @@
+/*-------------------------------------------------------------------------
+ *
+ * extension_lock.c
+ *	  Relation extension locks.
+ *
+ * Relation extension locks used to be heavyweight locks, but they don't
+ * need most of what the heavyweight lock manager provides: they are only
+ * ever taken in exclusive mode, held for a short time and never until the
+ * end of the transaction, and the holder doesn't acquire any other
+ * heavyweight lock, so they can't take part in a deadlock.  Going through
+ * the lock manager's partitioned hash table on every extension showed up
+ * in the profiles of concurrent bulk loads, so instead we hash the
+ * relation's OIDs to one of a fixed number of LWLocks.
+ *
+ * Two relations can map to the same LWLock, in which case extending one
+ * blocks extending the other.  That's harmless because a backend never
+ * holds the extension lock of more than one relation at a time.  It may
+ * take the same relation's lock again while holding it, though, for
+ * example to extend the relation's free space map while adding pages to
+ * the relation, so we keep a count of how often it is held.
+ *
+ * Each LWLock comes with a count of the backends waiting for it, which is
+ * used to decide how far to extend a relation at once (see hio.c).
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/backend/storage/lmgr/extension_lock.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "common/hashfn.h"
+#include "port/atomics.h"
+#include "storage/extension_lock.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+
+typedef struct RelExtLockEntry
+{
+	LWLock		lock;
+	pg_atomic_uint32 nwaiters;	/* # of backends waiting for the lock */
+} RelExtLockEntry;
+
+/* Pad each entry to a cache line, to keep them from sharing one */
+typedef union RelExtLockPadded
+{
+	RelExtLockEntry ent;
+	char		pad[PG_CACHE_LINE_SIZE];
+} RelExtLockPadded;
+
+static RelExtLockPadded *RelExtLockArray;
+
+/* The relation extension lock held by this backend, if any */
+static RelExtLockEntry *held_entry = NULL;
+static Oid	held_dbid = InvalidOid;
+static Oid	held_relid = InvalidOid;
+static int	held_count = 0;
+
+/*
+ * Return the entry for the given relation.
+ */
+static inline RelExtLockEntry *
+RelExtLockEntryFor(Oid dbid, Oid relid)
+{
+	uint32		hashcode = hash_combine(murmurhash32(dbid), murmurhash32(relid));
+
+	return &RelExtLockArray[hashcode % N_RELEXTLOCK_ENTS].ent;
+}
+
+/*
+ * Make sure the held_* variables are up to date.
+ *
+ * An error releases all LWLocks without telling us, so if we think we hold
+ * a lock that LWLock doesn't know about, forget it.
+ */
+static inline void
+RelExtLockCheckHeld(void)
+{
+	if (held_count > 0 && !LWLockHeldByMe(&held_entry->lock))
+	{
+		held_entry = NULL;
+		held_count = 0;
+	}
+}
+
+/*
+ * Estimate space needed for relation extension locks
+ */
+Size
+RelExtLockShmemSize(void)
+{
+	return mul_size(N_RELEXTLOCK_ENTS, sizeof(RelExtLockPadded));
+}
+
+/*
+ * Allocate and initialize relation extension locks in shared memory
+ */
+void
+InitRelExtLocks(void)
+{
+	bool		found;
+	int			i;
+
+	RelExtLockArray = (RelExtLockPadded *)
+		ShmemInitStruct("Relation Extension Locks",
+						RelExtLockShmemSize(), &found);
+
+	if (!found)
+	{
+		for (i = 0; i < N_RELEXTLOCK_ENTS; i++)
+		{
+			LWLockInitialize(&RelExtLockArray[i].ent.lock,
+							 LWTRANCHE_RELATION_EXTENSION);
+			pg_atomic_init_u32(&RelExtLockArray[i].ent.nwaiters, 0);
+		}
+	}
+}
+
+/*
+ * RelExtLockAcquire
+ *		Acquire the extension lock of the given relation
+ *
+ * If conditional is true, returns false instead of waiting if the lock is
+ * not available.  Otherwise, always returns true.
+ */
+bool
+RelExtLockAcquire(Oid dbid, Oid relid, bool conditional)
+{
+	RelExtLockEntry *entry;
+
+	RelExtLockCheckHeld();
+
+	if (held_count > 0)
+	{
+		if (held_dbid != dbid || held_relid != relid)
+			elog(ERROR, "cannot acquire extension lock of relation %u while holding that of relation %u",
+				 relid, held_relid);
+		held_count++;
+		return true;
+	}
+
+	entry = RelExtLockEntryFor(dbid, relid);
+
+	if (conditional)
+	{
+		if (!LWLockConditionalAcquire(&entry->lock, LW_EXCLUSIVE))
+			return false;
+	}
+	else
+	{
+		pg_atomic_fetch_add_u32(&entry->nwaiters, 1);
+		LWLockAcquire(&entry->lock, LW_EXCLUSIVE);
+		pg_atomic_fetch_sub_u32(&entry->nwaiters, 1);
+	}
+
+	held_entry = entry;
+	held_dbid = dbid;
+	held_relid = relid;
+	held_count = 1;
+
+	return true;
+}
+
+/*
+ * RelExtLockRelease
+ *		Release the extension lock of the given relation
+ */
+void
+RelExtLockRelease(Oid dbid, Oid relid)
+{
+	RelExtLockCheckHeld();
+
+	if (held_count == 0 || held_dbid != dbid || held_relid != relid)
+		elog(ERROR, "extension lock of relation %u is not held", relid);
+
+	if (--held_count == 0)
+	{
+		LWLockRelease(&held_entry->lock);
+		held_entry = NULL;
+	}
+}
+
+/*
+ * RelExtLockWaiterCount
+ *		Count the number of processes waiting for the given relation's
+ *		extension lock
+ *
+ * This includes the backends waiting to extend other relations that map to
+ * the same LWLock, which is usually close enough.
+ */
+int
+RelExtLockWaiterCount(Oid dbid, Oid relid)
+{
+	return pg_atomic_read_u32(&RelExtLockEntryFor(dbid, relid)->nwaiters);
+}
+
+/*
+ * RelExtLockHeldByMe
+ *		Does this backend hold any relation extension lock?
+ */
+bool
+RelExtLockHeldByMe(void)
+{
+	RelExtLockCheckHeld();
+
+	return held_count > 0;
+}
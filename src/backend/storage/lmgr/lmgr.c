@@ -22,6 +22,7 @@
 #include "commands/progress.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "storage/extension_lock.h"
 #include "storage/lmgr.h"
 #include "storage/procarray.h"
 #include "storage/sinvaladt.h"
@@ -391,23 +392,24 @@ UnlockRelationIdForSession(LockRelId *relid, LOCKMODE lockmode)
 /*
  *		LockRelationForExtension
  *
- * This lock tag is used to interlock addition of pages to relations.
+ * This lock is used to interlock addition of pages to relations.
  * We need such locking because bufmgr/smgr definition of P_NEW is not
  * race-condition-proof.
  *
+ * The lock doesn't go through the heavyweight lock manager; see
+ * extension_lock.c.  Only ExclusiveLock is supported.
+ *
  * We assume the caller is already holding some type of regular lock on
  * the relation, so no AcceptInvalidationMessages call is needed here.
  */
 void
 LockRelationForExtension(Relation relation, LOCKMODE lockmode)
 {
-	LOCKTAG		tag;
+	Assert(lockmode == ExclusiveLock);
 
-	SET_LOCKTAG_RELATION_EXTEND(tag,
-								relation->rd_lockInfo.lockRelId.dbId,
-								relation->rd_lockInfo.lockRelId.relId);
-
-	(void) LockAcquire(&tag, lockmode, false, false);
+	(void) RelExtLockAcquire(relation->rd_lockInfo.lockRelId.dbId,
+							 relation->rd_lockInfo.lockRelId.relId,
+							 false);
 }
 
 /*
@@ -419,13 +421,11 @@ LockRelationForExtension(Relation relation, LOCKMODE lockmode)
 bool
 ConditionalLockRelationForExtension(Relation relation, LOCKMODE lockmode)
 {
-	LOCKTAG		tag;
-
-	SET_LOCKTAG_RELATION_EXTEND(tag,
-								relation->rd_lockInfo.lockRelId.dbId,
-								relation->rd_lockInfo.lockRelId.relId);
+	Assert(lockmode == ExclusiveLock);
 
-	return (LockAcquire(&tag, lockmode, false, true) != LOCKACQUIRE_NOT_AVAIL);
+	return RelExtLockAcquire(relation->rd_lockInfo.lockRelId.dbId,
+							 relation->rd_lockInfo.lockRelId.relId,
+							 true);
 }
 
 /*
@@ -436,13 +436,8 @@ ConditionalLockRelationForExtension(Relation relation, LOCKMODE lockmode)
 int
 RelationExtensionLockWaiterCount(Relation relation)
 {
-	LOCKTAG		tag;
-
-	SET_LOCKTAG_RELATION_EXTEND(tag,
-								relation->rd_lockInfo.lockRelId.dbId,
-								relation->rd_lockInfo.lockRelId.relId);
-
-	return LockWaiterCount(&tag);
+	return RelExtLockWaiterCount(relation->rd_lockInfo.lockRelId.dbId,
+								 relation->rd_lockInfo.lockRelId.relId);
 }
 
 /*
@@ -451,13 +446,10 @@ RelationExtensionLockWaiterCount(Relation relation)
 void
 UnlockRelationForExtension(Relation relation, LOCKMODE lockmode)
 {
-	LOCKTAG		tag;
-
-	SET_LOCKTAG_RELATION_EXTEND(tag,
-								relation->rd_lockInfo.lockRelId.dbId,
-								relation->rd_lockInfo.lockRelId.relId);
+	Assert(lockmode == ExclusiveLock);
 
-	LockRelease(&tag, lockmode, false);
+	RelExtLockRelease(relation->rd_lockInfo.lockRelId.dbId,
+					  relation->rd_lockInfo.lockRelId.relId);
 }
 
 /*
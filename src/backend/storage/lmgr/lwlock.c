@@ -72,21 +72,41 @@
  *
  * This protects us against the problem from above as nobody can release too
  *	  quick, before we're queued, since after Phase 2 we're already queued.
+ *
+ *
+ * That scheme lets newcomers barge in ahead of processes that are already
+ * queued, and releasing a lock wakes up all queued shared lockers.  That is
+ * good for throughput, but on a few very heavily contended locks, such as
+ * ProcArrayLock, it can starve exclusive lockers and form convoys of
+ * processes that wake up only to find the lock taken again.  With
+ * lwlock_handoff enabled, those locks are marked with LW_FLAG_HANDOFF, and
+ * handed over in the order the waiters queued up instead:
+ *	 - Nobody acquires the lock directly while there are waiters
+ *	   (LW_FLAG_HAS_WAITERS), they queue up behind them instead.
+ *	 - Whoever releases the lock acquires it on behalf of the first
+ *	   exclusive waiter in the queue, or all shared waiters up to the first
+ *	   exclusive one, and wakes them up with lwGranted set; they don't retry.
+ *	 - Phase 3 above is replaced by doing the same handoff after queueing
+ *	   ourselves, in case the lock was released in the meantime.
  * -------------------------------------------------------------------------
  */
 #include "postgres.h"
 
+#include "access/xact.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
+#include "portability/instr_time.h"
 #include "postmaster/postmaster.h"
 #include "replication/slot.h"
 #include "storage/ipc.h"
 #include "storage/predicate.h"
 #include "storage/proc.h"
 #include "storage/proclist.h"
+#include "storage/shmem.h"
 #include "storage/spin.h"
 #include "utils/memutils.h"
+#include "utils/timestamp.h"
 
 #ifdef LWLOCK_STATS
 #include "utils/hsearch.h"
@@ -99,6 +119,7 @@ extern slock_t *ShmemLock;
 #define LW_FLAG_HAS_WAITERS			((uint32) 1 << 30)
 #define LW_FLAG_RELEASE_OK			((uint32) 1 << 29)
 #define LW_FLAG_LOCKED				((uint32) 1 << 28)
+#define LW_FLAG_HANDOFF				((uint32) 1 << 27)
 
 #define LW_VAL_EXCLUSIVE			((uint32) 1 << 24)
 #define LW_VAL_SHARED				1
@@ -177,7 +198,35 @@ static const char *const BuiltinTrancheNames[] = {
 	/* LWTRANCHE_PARALLEL_APPEND: */
 	"ParallelAppend",
 	/* LWTRANCHE_PER_XACT_PREDICATE_LIST: */
-	"PerXactPredicateList"
+	"PerXactPredicateList",
+	/* LWTRANCHE_RELATION_EXTENSION: */
+	"RelationExtension",
+	/* LWTRANCHE_XACT_SLRU: */
+	"XactSLRU",
+	/* LWTRANCHE_COMMITTS_SLRU: */
+	"CommitTsSLRU",
+	/* LWTRANCHE_SUBTRANS_SLRU: */
+	"SubtransSLRU",
+	/* LWTRANCHE_MULTIXACTOFFSET_SLRU: */
+	"MultiXactOffsetSLRU",
+	/* LWTRANCHE_MULTIXACTMEMBER_SLRU: */
+	"MultiXactMemberSLRU",
+	/* LWTRANCHE_NOTIFY_SLRU: */
+	"NotifySLRU",
+	/* LWTRANCHE_SERIAL_SLRU: */
+	"SerialSLRU",
+	/* LWTRANCHE_SHARED_PLAN_CACHE_DSA: */
+	"SharedPlanCacheDSA",
+	/* LWTRANCHE_TABLE_STATS_DSA: */
+	"TableStatsDSA",
+	/* LWTRANCHE_TABLE_STATS_HASH: */
+	"TableStatsHash",
+	/* LWTRANCHE_SHARED_CATCACHE_DSA: */
+	"SharedCatCacheDSA",
+	/* LWTRANCHE_RELSIZE_CACHE: */
+	"RelSizeCache",
+	/* LWTRANCHE_SEQUENCE_CACHE: */
+	"SequenceCache"
 };
 
 StaticAssertDecl(lengthof(BuiltinTrancheNames) ==
@@ -240,10 +289,35 @@ NamedLWLockTranche *NamedLWLockTrancheArray = NULL;
 
 static bool lock_named_request_allowed = true;
 
+/* GUC variables */
+bool		lwlock_handoff = false;
+
+/*
+ * Contention statistics of individual LWLocks and built-in tranches.
+ * Processes count into pendingStats, and add it to the atomic counters in
+ * shared memory at most every LWLOCK_STATS_FLUSH_INTERVAL msec, from
+ * pgstat_report_stat() and the main loops of the background writer and
+ * checkpointer, and at process exit, like the I/O counters in pgstat_io.c.
+ */
+#define LWLOCK_STATS_FLUSH_INTERVAL 500
+
+typedef struct LWLockStatsShared
+{
+	pg_atomic_uint64 stat_reset_timestamp;
+	pg_atomic_uint64 acquire_count[NUM_LWLOCK_STATS_ENTRIES];
+	pg_atomic_uint64 wait_count[NUM_LWLOCK_STATS_ENTRIES];
+	pg_atomic_uint64 wait_time[NUM_LWLOCK_STATS_ENTRIES];
+} LWLockStatsShared;
+
+static LWLockStatsShared *SharedLWLockStats = NULL;
+static LWLockStatsEntry pendingStats[NUM_LWLOCK_STATS_ENTRIES];
+static bool havePendingStats = false;
+
 static void InitializeLWLocks(void);
 static inline void LWLockReportWaitStart(LWLock *lock);
 static inline void LWLockReportWaitEnd(void);
 static const char *GetLWTrancheName(uint16 trancheId);
+static void LWLockStatsShutdown(int code, Datum arg);
 
 #define T_NAME(lock) \
 	GetLWTrancheName((lock)->tranche)
@@ -540,6 +614,13 @@ InitializeLWLocks(void)
 	for (id = 0; id < NUM_PREDICATELOCK_PARTITIONS; id++, lock++)
 		LWLockInitialize(&lock->lock, LWTRANCHE_PREDICATE_LOCK_MANAGER);
 
+	/* Hand the most heavily contended locks over in queue order, if asked */
+	if (lwlock_handoff)
+	{
+		pg_atomic_fetch_or_u32(&ProcArrayLock->state, LW_FLAG_HANDOFF);
+		pg_atomic_fetch_or_u32(&WALWriteLock->state, LW_FLAG_HANDOFF);
+	}
+
 	/*
 	 * Copy the info about any named tranches into shared memory (so that
 	 * other processes can see it), and initialize the requested LWLocks.
@@ -585,6 +666,9 @@ InitLWLockAccess(void)
 #ifdef LWLOCK_STATS
 	init_lwlock_stats();
 #endif
+
+	/* don't lose the contention statistics since the last flush */
+	on_shmem_exit(LWLockStatsShutdown, 0);
 }
 
 /*
@@ -774,6 +858,40 @@ LWLockReportWaitEnd(void)
 	pgstat_report_wait_end();
 }
 
+/*
+ * Count an acquisition of a lock in the contention statistics.
+ */
+static inline void
+LWLockCountAcquire(LWLock *lock)
+{
+	if (lock->tranche < NUM_LWLOCK_STATS_ENTRIES)
+	{
+		pendingStats[lock->tranche].acquire_count++;
+		havePendingStats = true;
+	}
+}
+
+/*
+ * Count a sleep on a lock, which started at wait_start, in the contention
+ * statistics.
+ */
+static void
+LWLockCountWait(LWLock *lock, instr_time wait_start)
+{
+	instr_time	duration;
+
+	if (lock->tranche < NUM_LWLOCK_STATS_ENTRIES)
+	{
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, wait_start);
+
+		pendingStats[lock->tranche].wait_count++;
+		pendingStats[lock->tranche].wait_time +=
+			INSTR_TIME_GET_MICROSEC(duration);
+		havePendingStats = true;
+	}
+}
+
 /*
  * Return the name of an LWLock tranche.
  */
@@ -843,7 +961,11 @@ LWLockAttemptLock(LWLock *lock, LWLockMode mode)
 
 		desired_state = old_state;
 
-		if (mode == LW_EXCLUSIVE)
+		/* With handoff, don't jump the queue */
+		if ((old_state & (LW_FLAG_HANDOFF | LW_FLAG_HAS_WAITERS)) ==
+			(LW_FLAG_HANDOFF | LW_FLAG_HAS_WAITERS))
+			lock_free = false;
+		else if (mode == LW_EXCLUSIVE)
 		{
 			lock_free = (old_state & LW_LOCK_MASK) == 0;
 			if (lock_free)
@@ -1060,6 +1182,125 @@ LWLockWakeup(LWLock *lock)
 	}
 }
 
+/*
+ * Hand a lock marked LW_FLAG_HANDOFF over to the waiters at the head of the
+ * queue: the first exclusive waiter, or all shared waiters up to the first
+ * exclusive one.  We acquire the lock on their behalf and wake them up with
+ * lwGranted set, so that they needn't retry.  LW_WAIT_UNTIL_FREE waiters are
+ * woken up along with them, like LWLockWakeup() does.
+ *
+ * If the lock isn't free for them, nobody is woken up; whoever holds it will
+ * call us again when releasing it.
+ */
+static void
+LWLockHandOff(LWLock *lock)
+{
+	proclist_head wakeup;
+	proclist_mutable_iter iter;
+	LWLockMode	grant_mode = LW_WAIT_UNTIL_FREE;
+	uint32		ngranted = 0;
+	bool		grantable;
+	uint32		old_state;
+
+	proclist_init(&wakeup);
+
+	LWLockWaitListLock(lock);
+
+	/* Determine whom to hand the lock to */
+	proclist_foreach_modify(iter, &lock->waiters, lwWaitLink)
+	{
+		PGPROC	   *waiter = GetPGProcByNumber(iter.cur);
+
+		if (waiter->lwWaitMode == LW_WAIT_UNTIL_FREE)
+			continue;
+		if (ngranted > 0 &&
+			(grant_mode == LW_EXCLUSIVE || waiter->lwWaitMode == LW_EXCLUSIVE))
+			break;
+		grant_mode = waiter->lwWaitMode;
+		ngranted++;
+	}
+
+	/* Acquire the lock for them, if it's free, keeping the wait list locked */
+	old_state = pg_atomic_read_u32(&lock->state);
+	while (true)
+	{
+		uint32		desired_state = old_state;
+
+		if (grant_mode == LW_SHARED)
+		{
+			grantable = (old_state & LW_VAL_EXCLUSIVE) == 0;
+			desired_state += ngranted * LW_VAL_SHARED;
+		}
+		else
+		{
+			grantable = (old_state & LW_LOCK_MASK) == 0;
+			if (grant_mode == LW_EXCLUSIVE)
+				desired_state += LW_VAL_EXCLUSIVE;
+		}
+
+		if (!grantable ||
+			pg_atomic_compare_exchange_u32(&lock->state, &old_state,
+										   desired_state))
+			break;
+	}
+
+	if (grantable)
+	{
+		proclist_foreach_modify(iter, &lock->waiters, lwWaitLink)
+		{
+			PGPROC	   *waiter = GetPGProcByNumber(iter.cur);
+
+			if (waiter->lwWaitMode != LW_WAIT_UNTIL_FREE)
+			{
+				if (ngranted == 0)
+					break;
+				ngranted--;
+				waiter->lwGranted = true;
+#ifdef LOCK_DEBUG
+				if (grant_mode == LW_EXCLUSIVE)
+					lock->owner = waiter;
+#endif
+			}
+
+			proclist_delete(&lock->waiters, iter.cur, lwWaitLink);
+			proclist_push_tail(&wakeup, iter.cur, lwWaitLink);
+		}
+		Assert(ngranted == 0);
+	}
+
+	/*
+	 * Set the flags, and release the wait list lock.  The processes we wake
+	 * up won't retry, so there's no reason to clear LW_FLAG_RELEASE_OK.
+	 */
+	old_state = pg_atomic_read_u32(&lock->state);
+	while (true)
+	{
+		uint32		desired_state = old_state;
+
+		desired_state |= LW_FLAG_RELEASE_OK;
+		if (proclist_is_empty(&lock->waiters))
+			desired_state &= ~LW_FLAG_HAS_WAITERS;
+		desired_state &= ~LW_FLAG_LOCKED;
+
+		if (pg_atomic_compare_exchange_u32(&lock->state, &old_state,
+										   desired_state))
+			break;
+	}
+
+	/* Awaken the waiters I removed from the queue */
+	proclist_foreach_modify(iter, &wakeup, lwWaitLink)
+	{
+		PGPROC	   *waiter = GetPGProcByNumber(iter.cur);
+
+		LOG_LWDEBUG("LWLockHandOff", lock, "release waiter");
+		proclist_delete(&wakeup, iter.cur, lwWaitLink);
+		/* check comment in LWLockWakeup() about this barrier */
+		pg_write_barrier();
+		waiter->lwWaiting = false;
+		PGSemaphoreUnlock(waiter->sem);
+	}
+}
+
 /*
  * Add ourselves to the end of the queue.
  *
@@ -1210,6 +1451,7 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 	PGPROC	   *proc = MyProc;
 	bool		result = true;
 	int			extraWaits = 0;
+	instr_time	wait_start;
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
 
@@ -1260,7 +1502,8 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 	 * in the presence of contention.  The efficiency of being able to do that
 	 * outweighs the inefficiency of sometimes wasting a process dispatch
 	 * cycle because the lock is not free when a released waiter finally gets
-	 * to run.  See pgsql-hackers archives for 29-Dec-01.
+	 * to run.  See pgsql-hackers archives for 29-Dec-01.  (Locks marked with
+	 * LW_FLAG_HANDOFF are the exception, where fairness matters more.)
 	 */
 	for (;;)
 	{
@@ -1292,16 +1535,28 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 		/* add to the queue */
 		LWLockQueueSelf(lock, mode);
 
-		/* we're now guaranteed to be woken up if necessary */
-		mustwait = LWLockAttemptLock(lock, mode);
-
-		/* ok, grabbed the lock the second time round, need to undo queueing */
-		if (!mustwait)
+		if (pg_atomic_read_u32(&lock->state) & LW_FLAG_HANDOFF)
 		{
-			LOG_LWDEBUG("LWLockAcquire", lock, "acquired, undoing queue");
+			/*
+			 * Rather than grabbing the lock ourselves, hand it to whoever is
+			 * first in line, in case it was released before we queued.  That
+			 * may well be us, in which case we'll be woken up right away.
+			 */
+			LWLockHandOff(lock);
+		}
+		else
+		{
+			/* we're now guaranteed to be woken up if necessary */
+			mustwait = LWLockAttemptLock(lock, mode);
 
-			LWLockDequeueSelf(lock);
-			break;
+			/* ok, grabbed the lock the second time round, undo queueing */
+			if (!mustwait)
+			{
+				LOG_LWDEBUG("LWLockAcquire", lock, "acquired, undoing queue");
+
+				LWLockDequeueSelf(lock);
+				break;
+			}
 		}
 
 		/*
@@ -1324,6 +1579,7 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 
 		LWLockReportWaitStart(lock);
 		TRACE_POSTGRESQL_LWLOCK_WAIT_START(T_NAME(lock), mode);
+		INSTR_TIME_SET_CURRENT(wait_start);
 
 		for (;;)
 		{
@@ -1333,6 +1589,8 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 			extraWaits++;
 		}
 
+		LWLockCountWait(lock, wait_start);
+
 		/* Retrying, allow LWLockRelease to release waiters again. */
 		pg_atomic_fetch_or_u32(&lock->state, LW_FLAG_RELEASE_OK);
 
@@ -1350,11 +1608,20 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 
 		LOG_LWDEBUG("LWLockAcquire", lock, "awakened");
 
-		/* Now loop back and try to acquire lock again. */
 		result = false;
+
+		/* Done, if the lock was handed to us */
+		if (proc->lwGranted)
+		{
+			proc->lwGranted = false;
+			break;
+		}
+
+		/* Now loop back and try to acquire lock again. */
 	}
 
 	TRACE_POSTGRESQL_LWLOCK_ACQUIRE(T_NAME(lock), mode);
+	LWLockCountAcquire(lock);
 
 	/* Add lock to list of locks held by this backend */
 	held_lwlocks[num_held_lwlocks].lock = lock;
@@ -1413,6 +1680,7 @@ LWLockConditionalAcquire(LWLock *lock, LWLockMode mode)
 		held_lwlocks[num_held_lwlocks].lock = lock;
 		held_lwlocks[num_held_lwlocks++].mode = mode;
 		TRACE_POSTGRESQL_LWLOCK_CONDACQUIRE(T_NAME(lock), mode);
+		LWLockCountAcquire(lock);
 	}
 	return !mustwait;
 }
@@ -1437,6 +1705,7 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 	PGPROC	   *proc = MyProc;
 	bool		mustwait;
 	int			extraWaits = 0;
+	instr_time	wait_start;
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
 
@@ -1468,7 +1737,16 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 	{
 		LWLockQueueSelf(lock, LW_WAIT_UNTIL_FREE);
 
-		mustwait = LWLockAttemptLock(lock, mode);
+		if (pg_atomic_read_u32(&lock->state) & LW_FLAG_HANDOFF)
+		{
+			/*
+			 * As in LWLockAcquire(), let the lock go to whoever is first in
+			 * line.  We're woken up once it's free, or has been handed over.
+			 */
+			LWLockHandOff(lock);
+		}
+		else
+			mustwait = LWLockAttemptLock(lock, mode);
 
 		if (mustwait)
 		{
@@ -1485,6 +1763,7 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 
 			LWLockReportWaitStart(lock);
 			TRACE_POSTGRESQL_LWLOCK_WAIT_START(T_NAME(lock), mode);
+			INSTR_TIME_SET_CURRENT(wait_start);
 
 			for (;;)
 			{
@@ -1494,6 +1773,8 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 				extraWaits++;
 			}
 
+			LWLockCountWait(lock, wait_start);
+
 #ifdef LOCK_DEBUG
 			{
 				/* not waiting anymore */
@@ -1541,6 +1822,7 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 		held_lwlocks[num_held_lwlocks].lock = lock;
 		held_lwlocks[num_held_lwlocks++].mode = mode;
 		TRACE_POSTGRESQL_LWLOCK_ACQUIRE_OR_WAIT(T_NAME(lock), mode);
+		LWLockCountAcquire(lock);
 	}
 
 	return !mustwait;
@@ -1621,6 +1903,7 @@ LWLockWaitForVar(LWLock *lock, uint64 *valptr, uint64 oldval, uint64 *newval)
 	PGPROC	   *proc = MyProc;
 	int			extraWaits = 0;
 	bool		result = false;
+	instr_time	wait_start;
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
 
@@ -1701,6 +1984,7 @@ LWLockWaitForVar(LWLock *lock, uint64 *valptr, uint64 oldval, uint64 *newval)
 
 		LWLockReportWaitStart(lock);
 		TRACE_POSTGRESQL_LWLOCK_WAIT_START(T_NAME(lock), LW_EXCLUSIVE);
+		INSTR_TIME_SET_CURRENT(wait_start);
 
 		for (;;)
 		{
@@ -1710,6 +1994,8 @@ LWLockWaitForVar(LWLock *lock, uint64 *valptr, uint64 oldval, uint64 *newval)
 			extraWaits++;
 		}
 
+		LWLockCountWait(lock, wait_start);
+
 #ifdef LOCK_DEBUG
 		{
 			/* not waiting anymore */
@@ -1867,7 +2153,10 @@ LWLockRelease(LWLock *lock)
 	{
 		/* XXX: remove before commit? */
 		LOG_LWDEBUG("LWLockRelease", lock, "releasing waiters");
-		LWLockWakeup(lock);
+		if (oldstate & LW_FLAG_HANDOFF)
+			LWLockHandOff(lock);
+		else
+			LWLockWakeup(lock);
 	}
 
 	TRACE_POSTGRESQL_LWLOCK_RELEASE(T_NAME(lock));
@@ -1954,3 +2243,136 @@ LWLockHeldByMeInMode(LWLock *l, LWLockMode mode)
 	}
 	return false;
 }
+
+
+/*
+ * Estimate space needed for the shared contention statistics
+ */
+Size
+LWLockStatsShmemSize(void)
+{
+	return sizeof(LWLockStatsShared);
+}
+
+/*
+ * Allocate and initialize the shared contention statistics
+ */
+void
+LWLockStatsShmemInit(void)
+{
+	bool		found;
+	int			i;
+
+	SharedLWLockStats = (LWLockStatsShared *)
+		ShmemInitStruct("LWLock Stats", sizeof(LWLockStatsShared), &found);
+
+	if (found)
+		return;
+
+	pg_atomic_init_u64(&SharedLWLockStats->stat_reset_timestamp,
+					   (uint64) GetCurrentTimestamp());
+	for (i = 0; i < NUM_LWLOCK_STATS_ENTRIES; i++)
+	{
+		pg_atomic_init_u64(&SharedLWLockStats->acquire_count[i], 0);
+		pg_atomic_init_u64(&SharedLWLockStats->wait_count[i], 0);
+		pg_atomic_init_u64(&SharedLWLockStats->wait_time[i], 0);
+	}
+}
+
+/*
+ * Add the contention statistics of this process to the shared counters
+ *
+ * Unless force is true, this does nothing if the last flush was less than
+ * LWLOCK_STATS_FLUSH_INTERVAL msec ago.
+ */
+void
+LWLockStatsFlush(bool force)
+{
+	static TimestampTz last_flush = 0;
+	int			i;
+
+	if (!havePendingStats || SharedLWLockStats == NULL)
+		return;
+
+	if (!force)
+	{
+		TimestampTz now = GetCurrentTransactionStopTimestamp();
+
+		if (!TimestampDifferenceExceeds(last_flush, now,
+										LWLOCK_STATS_FLUSH_INTERVAL))
+			return;
+		last_flush = now;
+	}
+
+	for (i = 0; i < NUM_LWLOCK_STATS_ENTRIES; i++)
+	{
+		LWLockStatsEntry *pending = &pendingStats[i];
+
+		if (pending->acquire_count != 0)
+			pg_atomic_fetch_add_u64(&SharedLWLockStats->acquire_count[i],
+									pending->acquire_count);
+		if (pending->wait_count != 0)
+		{
+			pg_atomic_fetch_add_u64(&SharedLWLockStats->wait_count[i],
+									pending->wait_count);
+			pg_atomic_fetch_add_u64(&SharedLWLockStats->wait_time[i],
+									pending->wait_time);
+		}
+	}
+
+	MemSet(pendingStats, 0, sizeof(pendingStats));
+	havePendingStats = false;
+}
+
+/*
+ * Flush the contention statistics at process exit
+ */
+static void
+LWLockStatsShutdown(int code, Datum arg)
+{
+	LWLockStatsFlush(true);
+}
+
+/*
+ * Copy the shared contention statistics to result, which must have room for
+ * NUM_LWLOCK_STATS_ENTRIES entries indexed by tranche ID, and return the time
+ * of the last reset.
+ */
+TimestampTz
+LWLockStatsFetch(LWLockStatsEntry *result)
+{
+	int			i;
+
+	for (i = 0; i < NUM_LWLOCK_STATS_ENTRIES; i++)
+	{
+		result[i].acquire_count =
+			pg_atomic_read_u64(&SharedLWLockStats->acquire_count[i]);
+		result[i].wait_count =
+			pg_atomic_read_u64(&SharedLWLockStats->wait_count[i]);
+		result[i].wait_time =
+			pg_atomic_read_u64(&SharedLWLockStats->wait_time[i]);
+	}
+
+	return (TimestampTz)
+		pg_atomic_read_u64(&SharedLWLockStats->stat_reset_timestamp);
+}
+
+/*
+ * Reset the shared contention statistics
+ *
+ * Counts still pending in other processes are added after the reset.
+ */
+void
+LWLockStatsReset(void)
+{
+	int			i;
+
+	for (i = 0; i < NUM_LWLOCK_STATS_ENTRIES; i++)
+	{
+		pg_atomic_write_u64(&SharedLWLockStats->acquire_count[i], 0);
+		pg_atomic_write_u64(&SharedLWLockStats->wait_count[i], 0);
+		pg_atomic_write_u64(&SharedLWLockStats->wait_time[i], 0);
+	}
+	pg_atomic_write_u64(&SharedLWLockStats->stat_reset_timestamp,
+						(uint64) GetCurrentTimestamp());
+}
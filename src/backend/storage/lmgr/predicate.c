@@ -200,6 +200,7 @@
 #include "access/twophase_rmgr.h"
 #include "access/xact.h"
 #include "access/xlog.h"
+#include "common/hashfn.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/bufmgr.h"
@@ -207,6 +208,7 @@
 #include "storage/predicate_internals.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
+#include "utils/guc.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
 
@@ -256,6 +258,30 @@
 #define PredicateLockHashPartitionLockByIndex(i) \
 	(&MainLWLockArray[PREDICATELOCK_MANAGER_LWLOCK_OFFSET + (i)].lock)
 
+/*
+ * Every predicate lock target is also counted in one of a fixed number of
+ * per-relation hint counters, chosen by hashing the target's database and
+ * relation OIDs.  A writer that finds the counter for its relation at zero
+ * knows that there can be no predicate lock on any tuple, page or the whole
+ * of the relation, and can skip the partition lock lookups of
+ * CheckForSerializableConflictIn() altogether.  That's the common case for
+ * tables that serializable transactions write but rarely read.
+ *
+ * The counter is incremented before a target is inserted into the hash
+ * table and decremented after it has been removed, so it is never zero
+ * while a target for the relation exists.  Relations that hash to the same
+ * counter merely cause false positives.
+ */
+#define NUM_PREDICATELOCK_REL_HINTS 1024
+
+#define PredicateLockRelHint(dbId, relId) \
+	(&PredicateLockRelHints[hash_combine(murmurhash32(dbId), \
+										 murmurhash32(relId)) % \
+							NUM_PREDICATELOCK_REL_HINTS])
+#define PredicateLockRelHintForTag(targettag) \
+	PredicateLockRelHint(GET_PREDICATELOCKTARGETTAG_DB(targettag), \
+						 GET_PREDICATELOCKTARGETTAG_RELATION(targettag))
+
 #define NPREDICATELOCKTARGETENTS() \
 	mul_size(max_predicate_locks_per_xact, add_size(MaxBackends, max_prepared_xacts))
 
@@ -392,6 +418,7 @@ static HTAB *SerializableXidHash;
 static HTAB *PredicateLockTargetHash;
 static HTAB *PredicateLockHash;
 static SHM_QUEUE *FinishedSerializableTransactions;
+static pg_atomic_uint32 *PredicateLockRelHints;
 
 /*
  * Tag for a dummy entry in PredicateLockTargetHash. By temporarily removing
@@ -820,8 +847,8 @@ SerialInit(void)
 	 */
 	SerialSlruCtl->PagePrecedes = SerialPagePrecedesLogically;
 	SimpleLruInit(SerialSlruCtl, "Serial",
-				  NUM_SERIAL_BUFFERS, 0, SerialSLRULock, "pg_serial",
-				  LWTRANCHE_SERIAL_BUFFER);
+				  serializable_buffers, 0, "pg_serial",
+				  LWTRANCHE_SERIAL_BUFFER, LWTRANCHE_SERIAL_SLRU);
 	/* Override default assumption that writes should be fsync'd */
 	SerialSlruCtl->do_fsync = false;
 
@@ -843,6 +870,15 @@ SerialInit(void)
 	}
 }
 
+/*
+ * GUC check_hook for serializable_buffers
+ */
+bool
+check_serial_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("serializable_buffers", newval);
+}
+
 /*
  * Record a committed read write serializable xid and the minimum
  * commitSeqNo of any transactions to which this xid had a rw-conflict out.
@@ -856,12 +892,17 @@ SerialAdd(TransactionId xid, SerCommitSeqNo minConflictCommitSeqNo)
 	int			slotno;
 	int			firstZeroPage;
 	bool		isNewPage;
+	LWLock	   *lock;
 
 	Assert(TransactionIdIsValid(xid));
 
 	targetPage = SerialPage(xid);
 
-	LWLockAcquire(SerialSLRULock, LW_EXCLUSIVE);
+	/*
+	 * SerialControlLock protects serialControl, and is taken before the bank
+	 * lock of any page we touch.
+	 */
+	LWLockAcquire(SerialControlLock, LW_EXCLUSIVE);
 
 	/*
 	 * If no serializable transactions are active, there shouldn't be anything
@@ -897,21 +938,30 @@ SerialAdd(TransactionId xid, SerCommitSeqNo minConflictCommitSeqNo)
 
 	if (isNewPage)
 	{
-		/* Initialize intervening pages. */
-		while (firstZeroPage != targetPage)
+		/* Initialize intervening pages; might involve trading bank locks. */
+		for (;;)
 		{
-			(void) SimpleLruZeroPage(SerialSlruCtl, firstZeroPage);
+			lock = SimpleLruGetBankLock(SerialSlruCtl, firstZeroPage);
+			LWLockAcquire(lock, LW_EXCLUSIVE);
+			slotno = SimpleLruZeroPage(SerialSlruCtl, firstZeroPage);
+			if (firstZeroPage == targetPage)
+				break;
 			firstZeroPage = SerialNextPage(firstZeroPage);
+			LWLockRelease(lock);
 		}
-		slotno = SimpleLruZeroPage(SerialSlruCtl, targetPage);
 	}
 	else
+	{
+		lock = SimpleLruGetBankLock(SerialSlruCtl, targetPage);
+		LWLockAcquire(lock, LW_EXCLUSIVE);
 		slotno = SimpleLruReadPage(SerialSlruCtl, targetPage, true, xid);
+	}
 
 	SerialValue(slotno, xid) = minConflictCommitSeqNo;
 	SerialSlruCtl->shared->page_dirty[slotno] = true;
 
-	LWLockRelease(SerialSLRULock);
+	LWLockRelease(lock);
+	LWLockRelease(SerialControlLock);
 }
 
 /*
@@ -929,10 +979,10 @@ SerialGetMinConflictCommitSeqNo(TransactionId xid)
 
 	Assert(TransactionIdIsValid(xid));
 
-	LWLockAcquire(SerialSLRULock, LW_SHARED);
+	LWLockAcquire(SerialControlLock, LW_SHARED);
 	headXid = serialControl->headXid;
 	tailXid = serialControl->tailXid;
-	LWLockRelease(SerialSLRULock);
+	LWLockRelease(SerialControlLock);
 
 	if (!TransactionIdIsValid(headXid))
 		return 0;
@@ -944,13 +994,13 @@ SerialGetMinConflictCommitSeqNo(TransactionId xid)
 		return 0;
 
 	/*
-	 * The following function must be called without holding SerialSLRULock,
-	 * but will return with that lock held, which must then be released.
+	 * The following function must be called without holding the SLRU bank
+	 * lock, but will return with that lock held, which must then be released.
 	 */
 	slotno = SimpleLruReadPage_ReadOnly(SerialSlruCtl,
 										SerialPage(xid), xid);
 	val = SerialValue(slotno, xid);
-	LWLockRelease(SerialSLRULock);
+	LWLockRelease(SimpleLruGetBankLock(SerialSlruCtl, SerialPage(xid)));
 	return val;
 }
 
@@ -963,7 +1013,7 @@ SerialGetMinConflictCommitSeqNo(TransactionId xid)
 static void
 SerialSetActiveSerXmin(TransactionId xid)
 {
-	LWLockAcquire(SerialSLRULock, LW_EXCLUSIVE);
+	LWLockAcquire(SerialControlLock, LW_EXCLUSIVE);
 
 	/*
 	 * When no sxacts are active, nothing overlaps, set the xid values to
@@ -975,7 +1025,7 @@ SerialSetActiveSerXmin(TransactionId xid)
 	{
 		serialControl->tailXid = InvalidTransactionId;
 		serialControl->headXid = InvalidTransactionId;
-		LWLockRelease(SerialSLRULock);
+		LWLockRelease(SerialControlLock);
 		return;
 	}
 
@@ -993,7 +1043,7 @@ SerialSetActiveSerXmin(TransactionId xid)
 		{
 			serialControl->tailXid = xid;
 		}
-		LWLockRelease(SerialSLRULock);
+		LWLockRelease(SerialControlLock);
 		return;
 	}
 
@@ -1002,7 +1052,7 @@ SerialSetActiveSerXmin(TransactionId xid)
 
 	serialControl->tailXid = xid;
 
-	LWLockRelease(SerialSLRULock);
+	LWLockRelease(SerialControlLock);
 }
 
 /*
@@ -1016,12 +1066,12 @@ CheckPointPredicate(void)
 {
 	int			tailPage;
 
-	LWLockAcquire(SerialSLRULock, LW_EXCLUSIVE);
+	LWLockAcquire(SerialControlLock, LW_EXCLUSIVE);
 
 	/* Exit quickly if the SLRU is currently not in use. */
 	if (serialControl->headPage < 0)
 	{
-		LWLockRelease(SerialSLRULock);
+		LWLockRelease(SerialControlLock);
 		return;
 	}
 
@@ -1046,7 +1096,7 @@ CheckPointPredicate(void)
 		serialControl->headPage = -1;
 	}
 
-	LWLockRelease(SerialSLRULock);
+	LWLockRelease(SerialControlLock);
 
 	/* Truncate away pages that are no longer required */
 	SimpleLruTruncate(SerialSlruCtl, tailPage);
@@ -1271,6 +1321,23 @@ InitPredicateLocks(void)
 	if (!found)
 		SHMQueueInit(FinishedSerializableTransactions);
 
+	/*
+	 * Create or attach to the per-relation hint counters.
+	 */
+	PredicateLockRelHints = (pg_atomic_uint32 *)
+		ShmemInitStruct("PredicateLockRelHints",
+						mul_size(NUM_PREDICATELOCK_REL_HINTS,
+								 sizeof(pg_atomic_uint32)),
+						&found);
+	Assert(found == IsUnderPostmaster);
+	if (!found)
+	{
+		int			i;
+
+		for (i = 0; i < NUM_PREDICATELOCK_REL_HINTS; i++)
+			pg_atomic_init_u32(&PredicateLockRelHints[i], 0);
+	}
+
 	/*
 	 * Initialize the SLRU storage for old committed serializable
 	 * transactions.
@@ -1323,9 +1390,13 @@ PredicateLockShmemSize(void)
 	/* Head for list of finished serializable transactions. */
 	size = add_size(size, sizeof(SHM_QUEUE));
 
+	/* Per-relation hint counters. */
+	size = add_size(size, mul_size(NUM_PREDICATELOCK_REL_HINTS,
+								   sizeof(pg_atomic_uint32)));
+
 	/* Shared memory structures for SLRU tracking of old committed xids. */
 	size = add_size(size, sizeof(SerialControlData));
-	size = add_size(size, SimpleLruShmemSize(NUM_SERIAL_BUFFERS, 0));
+	size = add_size(size, SimpleLruShmemSize(serializable_buffers, 0));
 
 	return size;
 }
@@ -2096,6 +2167,7 @@ static void
 RemoveTargetIfNoLongerUsed(PREDICATELOCKTARGET *target, uint32 targettaghash)
 {
 	PREDICATELOCKTARGET *rmtarget PG_USED_FOR_ASSERTS_ONLY;
+	pg_atomic_uint32 *hint;
 
 	Assert(LWLockHeldByMe(SerializablePredicateListLock));
 
@@ -2103,12 +2175,14 @@ RemoveTargetIfNoLongerUsed(PREDICATELOCKTARGET *target, uint32 targettaghash)
 	if (!SHMQueueEmpty(&target->predicateLocks))
 		return;
 
-	/* Actually remove the target. */
+	/* Actually remove the target, and then uncount it. */
+	hint = PredicateLockRelHintForTag(target->tag);
 	rmtarget = hash_search_with_hash_value(PredicateLockTargetHash,
 										   &target->tag,
 										   targettaghash,
 										   HASH_REMOVE, NULL);
 	Assert(rmtarget == target);
+	pg_atomic_fetch_sub_u32(hint, 1);
 }
 
 /*
@@ -2390,11 +2464,17 @@ CreatePredicateLock(const PREDICATELOCKTARGETTAG *targettag,
 		LWLockAcquire(&sxact->perXactPredicateListLock, LW_EXCLUSIVE);
 	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
 
-	/* Make sure that the target is represented. */
+	/*
+	 * Make sure that the target is represented.  Count it in the relation's
+	 * hint counter first, and take that back if it already existed.
+	 */
+	pg_atomic_fetch_add_u32(PredicateLockRelHintForTag(*targettag), 1);
 	target = (PREDICATELOCKTARGET *)
 		hash_search_with_hash_value(PredicateLockTargetHash,
 									targettag, targettaghash,
 									HASH_ENTER_NULL, &found);
+	if (!target || found)
+		pg_atomic_fetch_sub_u32(PredicateLockRelHintForTag(*targettag), 1);
 	if (!target)
 		ereport(ERROR,
 				(errcode(ERRCODE_OUT_OF_MEMORY),
@@ -2727,10 +2807,13 @@ TransferPredicateLocksToNewTarget(PREDICATELOCKTARGETTAG oldtargettag,
 		PREDICATELOCK *oldpredlock;
 		PREDICATELOCKTAG newpredlocktag;
 
+		pg_atomic_fetch_add_u32(PredicateLockRelHintForTag(newtargettag), 1);
 		newtarget = hash_search_with_hash_value(PredicateLockTargetHash,
 												&newtargettag,
 												newtargettaghash,
 												HASH_ENTER_NULL, &found);
+		if (!newtarget || found)
+			pg_atomic_fetch_sub_u32(PredicateLockRelHintForTag(newtargettag), 1);
 
 		if (!newtarget)
 		{
@@ -2971,11 +3054,14 @@ DropAllPredicateLocksFromTable(Relation relation, bool transfer)
 
 			SET_PREDICATELOCKTARGETTAG_RELATION(heaptargettag, dbId, heapId);
 			heaptargettaghash = PredicateLockTargetTagHashCode(&heaptargettag);
+			pg_atomic_fetch_add_u32(PredicateLockRelHintForTag(heaptargettag), 1);
 			heaptarget = hash_search_with_hash_value(PredicateLockTargetHash,
 													 &heaptargettag,
 													 heaptargettaghash,
 													 HASH_ENTER, &found);
-			if (!found)
+			if (found)
+				pg_atomic_fetch_sub_u32(PredicateLockRelHintForTag(heaptargettag), 1);
+			else
 				SHMQueueInit(&heaptarget->predicateLocks);
 		}
 
@@ -3055,6 +3141,7 @@ DropAllPredicateLocksFromTable(Relation relation, bool transfer)
 		hash_search(PredicateLockTargetHash, &oldtarget->tag, HASH_REMOVE,
 					&found);
 		Assert(found);
+		pg_atomic_fetch_sub_u32(PredicateLockRelHint(dbId, relId), 1);
 	}
 
 	/* Put the scratch entry back */
@@ -4054,6 +4141,7 @@ CheckForSerializableConflictOut(Relation relation, TransactionId xid, Snapshot s
 	SERIALIZABLEXIDTAG sxidtag;
 	SERIALIZABLEXID *sxid;
 	SERIALIZABLEXACT *sxact;
+	LWLockMode	lockmode = LW_SHARED;
 
 	if (!SerializationNeededForRead(relation, snapshot))
 		return;
@@ -4074,9 +4162,15 @@ CheckForSerializableConflictOut(Relation relation, TransactionId xid, Snapshot s
 
 	/*
 	 * Find sxact or summarized info for the top level xid.
+	 *
+	 * Most of the time, the answer is that there's no conflict to record, so
+	 * we start out with a shared lock on SerializableXactHashLock.  If it
+	 * turns out that we need to modify a transaction's flags or conflict
+	 * lists, we come back here and redo the checks in exclusive mode.
 	 */
 	sxidtag.xid = xid;
-	LWLockAcquire(SerializableXactHashLock, LW_EXCLUSIVE);
+retry:
+	LWLockAcquire(SerializableXactHashLock, lockmode);
 	sxid = (SERIALIZABLEXID *)
 		hash_search(SerializableXidHash, &sxidtag, HASH_FIND, NULL);
 	if (!sxid)
@@ -4090,6 +4184,13 @@ CheckForSerializableConflictOut(Relation relation, TransactionId xid, Snapshot s
 		conflictCommitSeqNo = SerialGetMinConflictCommitSeqNo(xid);
 		if (conflictCommitSeqNo != 0)
 		{
+			if (lockmode == LW_SHARED)
+			{
+				LWLockRelease(SerializableXactHashLock);
+				lockmode = LW_EXCLUSIVE;
+				goto retry;
+			}
+
 			if (conflictCommitSeqNo != InvalidSerCommitSeqNo
 				&& (!SxactIsReadOnly(MySerializableXact)
 					|| conflictCommitSeqNo
@@ -4134,6 +4235,12 @@ CheckForSerializableConflictOut(Relation relation, TransactionId xid, Snapshot s
 	{
 		if (!SxactIsPrepared(sxact))
 		{
+			if (lockmode == LW_SHARED)
+			{
+				LWLockRelease(SerializableXactHashLock);
+				lockmode = LW_EXCLUSIVE;
+				goto retry;
+			}
 			sxact->flags |= SXACT_FLAG_DOOMED;
 			LWLockRelease(SerializableXactHashLock);
 			return;
@@ -4179,6 +4286,13 @@ CheckForSerializableConflictOut(Relation relation, TransactionId xid, Snapshot s
 		return;
 	}
 
+	if (lockmode == LW_SHARED)
+	{
+		LWLockRelease(SerializableXactHashLock);
+		lockmode = LW_EXCLUSIVE;
+		goto retry;
+	}
+
 	/*
 	 * Flag the conflict.  But first, if this conflict creates a dangerous
 	 * structure, ereport an error.
@@ -4395,6 +4509,17 @@ CheckForSerializableConflictIn(Relation relation, ItemPointer tid, BlockNumber b
 	 */
 	MyXactDidWrite = true;
 
+	/*
+	 * If no predicate lock target for this relation exists, there's nothing
+	 * to check.  The barrier makes sure that we don't read the hint counter
+	 * before whatever our caller did to the relation, like the partition
+	 * lock acquisitions below would.
+	 */
+	pg_memory_barrier();
+	if (pg_atomic_read_u32(PredicateLockRelHint(relation->rd_node.dbNode,
+												relation->rd_id)) == 0)
+		return;
+
 	/*
 	 * It is important that we check for locks from the finest granularity to
 	 * the coarsest granularity, so that granularity promotion doesn't cause
@@ -4488,6 +4613,11 @@ CheckTableForSerializableConflictIn(Relation relation)
 	dbId = relation->rd_node.dbNode;
 	heapId = relation->rd_id;
 
+	/* Skip scanning the whole target table if the heap has no targets */
+	pg_memory_barrier();
+	if (pg_atomic_read_u32(PredicateLockRelHint(dbId, heapId)) == 0)
+		return;
+
 	LWLockAcquire(SerializablePredicateListLock, LW_EXCLUSIVE);
 	for (i = 0; i < NUM_PREDICATELOCK_PARTITIONS; i++)
 		LWLockAcquire(PredicateLockHashPartitionLockByIndex(i), LW_SHARED);
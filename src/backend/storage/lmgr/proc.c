@@ -94,6 +94,17 @@ static void AuxiliaryProcKill(int code, Datum arg);
 static void CheckDeadLock(void);
 
 
+/*
+ * Report shared-memory space needed for the fast-path lock arrays of one
+ * PGPROC.
+ */
+static Size
+FastPathLockShmemSizePerProc(void)
+{
+	return add_size(MAXALIGN(FastPathLockGroupsPerBackend * sizeof(uint64)),
+					MAXALIGN(FastPathLockSlotsPerBackend() * sizeof(Oid)));
+}
+
 /*
  * Report shared-memory space needed by InitProcGlobal.
  */
@@ -113,6 +124,9 @@ ProcGlobalShmemSize(void)
 	size = add_size(size, mul_size(TotalProcs, sizeof(*ProcGlobal->subxidStates)));
 	size = add_size(size, mul_size(TotalProcs, sizeof(*ProcGlobal->vacuumFlags)));
 
+	/* fast-path lock arrays, see InitProcGlobal() */
+	size = add_size(size, mul_size(TotalProcs, FastPathLockShmemSizePerProc()));
+
 	return size;
 }
 
@@ -162,6 +176,9 @@ InitProcGlobal(void)
 				j;
 	bool		found;
 	uint32		TotalProcs = MaxBackends + NUM_AUXILIARY_PROCS + max_prepared_xacts;
+	char	   *fpPtr;
+	Size		fpLockBitsSize,
+				fpRelIdSize;
 
 	/* Create the ProcGlobal shared structure */
 	ProcGlobal = (PROC_HDR *)
@@ -213,10 +230,26 @@ InitProcGlobal(void)
 	ProcGlobal->vacuumFlags = (uint8 *) ShmemAlloc(TotalProcs * sizeof(*ProcGlobal->vacuumFlags));
 	MemSet(ProcGlobal->vacuumFlags, 0, TotalProcs * sizeof(*ProcGlobal->vacuumFlags));
 
+	/*
+	 * The fast-path lock arrays are sized at server start, so they can't be
+	 * part of PGPROC itself.  Allocate them in one chunk and hand out pieces
+	 * to each PGPROC.
+	 */
+	fpLockBitsSize = MAXALIGN(FastPathLockGroupsPerBackend * sizeof(uint64));
+	fpRelIdSize = MAXALIGN(FastPathLockSlotsPerBackend() * sizeof(Oid));
+
+	fpPtr = ShmemAlloc(TotalProcs * (fpLockBitsSize + fpRelIdSize));
+	MemSet(fpPtr, 0, TotalProcs * (fpLockBitsSize + fpRelIdSize));
+
 	for (i = 0; i < TotalProcs; i++)
 	{
 		/* Common initialization for all PGPROCs, regardless of type. */
 
+		procs[i].fpLockBits = (uint64 *) fpPtr;
+		fpPtr += fpLockBitsSize;
+		procs[i].fpRelId = (Oid *) fpPtr;
+		fpPtr += fpRelIdSize;
+
 		/*
 		 * Set up per-PGPROC semaphore, latch, and fpInfoLock.  Prepared xact
 		 * dummy PGPROCs don't need these though - they're never associated
@@ -397,8 +430,11 @@ InitProcess(void)
 	/* NB -- autovac launcher intentionally does not set IS_AUTOVACUUM */
 	if (IsAutoVacuumWorkerProcess())
 		MyProc->vacuumFlags |= PROC_IS_AUTOVACUUM;
+	if (IsPreforkedBackend)
+		MyProc->vacuumFlags |= PROC_IS_PREFORKED;
 	MyProc->lwWaiting = false;
 	MyProc->lwWaitMode = 0;
+	MyProc->lwGranted = false;
 	MyProc->waitLock = NULL;
 	MyProc->waitProcLock = NULL;
 #ifdef USE_ASSERT_CHECKING
@@ -577,6 +613,7 @@ InitAuxiliaryProcess(void)
 	MyProc->vacuumFlags = 0;
 	MyProc->lwWaiting = false;
 	MyProc->lwWaitMode = 0;
+	MyProc->lwGranted = false;
 	MyProc->waitLock = NULL;
 	MyProc->waitProcLock = NULL;
 #ifdef USE_ASSERT_CHECKING
@@ -612,6 +649,9 @@ InitAuxiliaryProcess(void)
 	 * Arrange to clean up at process exit.
 	 */
 	on_shmem_exit(AuxiliaryProcKill, Int32GetDatum(proctype));
+
+	/* Initialize local state needed for LWLocks */
+	InitLWLockAccess();
 }
 
 /*
@@ -1909,3 +1949,43 @@ BecomeLockGroupMember(PGPROC *leader, int pid)
 
 	return ok;
 }
+
+/*
+ * LeaveLockGroup - stop being a member of a lock group
+ *
+ * A parallel worker that is kept around to serve another parallel context
+ * leaves the lock group of its previous leader this way, rather than at
+ * process exit.  It must not hold any heavyweight locks anymore.  As in
+ * ProcKill, if the leader has exited already and we're the last member, we
+ * must return the leader's PGPROC to the freelist.
+ */
+void
+LeaveLockGroup(void)
+{
+	PGPROC	   *leader = MyProc->lockGroupLeader;
+	LWLock	   *leader_lwlock;
+
+	if (leader == NULL)
+		return;
+
+	/* A group leader stays one until it exits */
+	Assert(leader != MyProc);
+
+	leader_lwlock = LockHashPartitionLockByProc(leader);
+	LWLockAcquire(leader_lwlock, LW_EXCLUSIVE);
+	Assert(!dlist_is_empty(&leader->lockGroupMembers));
+	dlist_delete(&MyProc->lockGroupLink);
+	if (dlist_is_empty(&leader->lockGroupMembers))
+	{
+		PGPROC	   *volatile *procgloballist = leader->procgloballist;
+
+		/* Leader exited first; return its PGPROC. */
+		leader->lockGroupLeader = NULL;
+		SpinLockAcquire(ProcStructLock);
+		leader->links.next = (SHM_QUEUE *) *procgloballist;
+		*procgloballist = leader;
+		SpinLockRelease(ProcStructLock);
+	}
+	MyProc->lockGroupLeader = NULL;
+	LWLockRelease(leader_lwlock);
+}
@@ -0,0 +1,271 @@
+/*-------------------------------------------------------------------------
+ *
+ * relsize.c
+ *	  Shared cache of relation fork sizes.
+ *
+ * Asking md.c for the size of a relation fork costs an lseek() call for
+ * each of its segments, and smgrnblocks() is called often: by the planner
+ * for every relation of every query, at the start of every sequential scan,
+ * and whenever a relation is extended.  With many relations, the system
+ * calls add up.  This module keeps the sizes of the forks of permanent and
+ * unlogged relations in a hash table in shared memory, so that looking one
+ * up usually costs no more than a shared LWLock on one partition of the
+ * table.  Temporary relations are left out; their relfilenodes are only
+ * unique per backend.
+ *
+ * The cached sizes must never be smaller than the real ones, or a backend
+ * extending a relation could overwrite a block somebody else just added.
+ * Relations only grow, except when truncated under AccessExclusiveLock, so
+ * we maintain that by only ever raising a cached size, both when a relation
+ * is extended and when storing a size read from the file system, which may
+ * be out of date by the time we store it.  smgrtruncate() invalidates the
+ * size before truncating the file, and stores the new size afterwards.
+ * Entries are removed when a relation's files are unlinked or its database
+ * is dropped, so a relfilenode that is reused later starts afresh.
+ *
+ * The hash table has a fixed size, set by relsize_cache_size; once it is
+ * full, the sizes of additional relations are not cached.  Setting it to
+ * zero disables the cache.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/smgr/relsize.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "storage/lwlock.h"
+#include "storage/relsize.h"
+#include "storage/shmem.h"
+#include "utils/hsearch.h"
+
+/* Number of partitions of the hash table, each with its own LWLock */
+#define NUM_RELSIZE_PARTITIONS	16
+
+typedef struct RelSizeEnt
+{
+	RelFileNode rnode;			/* hash key */
+	BlockNumber nblocks[MAX_FORKNUM + 1];	/* InvalidBlockNumber if unknown */
+} RelSizeEnt;
+
+/* GUC variables */
+int			relsize_cache_size = 10000;
+
+static HTAB *RelSizeHash = NULL;
+static LWLockPadded *RelSizeLocks;
+
+#define RelSizePartitionLock(hashcode) \
+	(&RelSizeLocks[(hashcode) % NUM_RELSIZE_PARTITIONS].lock)
+
+/*
+ * Estimate space needed for the relation size cache
+ */
+Size
+RelSizeCacheShmemSize(void)
+{
+	Size		size;
+
+	if (relsize_cache_size <= 0)
+		return 0;
+
+	size = mul_size(NUM_RELSIZE_PARTITIONS, sizeof(LWLockPadded));
+	size = add_size(size, hash_estimate_size(relsize_cache_size,
+											 sizeof(RelSizeEnt)));
+
+	return size;
+}
+
+/*
+ * Allocate and initialize the relation size cache in shared memory
+ */
+void
+RelSizeCacheShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+	int			i;
+
+	if (relsize_cache_size <= 0)
+		return;
+
+	RelSizeLocks = (LWLockPadded *)
+		ShmemInitStruct("Relation Size Cache Locks",
+						mul_size(NUM_RELSIZE_PARTITIONS, sizeof(LWLockPadded)),
+						&found);
+	if (!found)
+	{
+		for (i = 0; i < NUM_RELSIZE_PARTITIONS; i++)
+			LWLockInitialize(&RelSizeLocks[i].lock, LWTRANCHE_RELSIZE_CACHE);
+	}
+
+	info.keysize = sizeof(RelFileNode);
+	info.entrysize = sizeof(RelSizeEnt);
+	info.num_partitions = NUM_RELSIZE_PARTITIONS;
+
+	RelSizeHash = ShmemInitHash("Relation Size Cache",
+								relsize_cache_size,
+								relsize_cache_size,
+								&info,
+								HASH_ELEM | HASH_BLOBS | HASH_PARTITION |
+								HASH_FIXED_SIZE);
+}
+
+/*
+ * RelSizeCacheLookup
+ *		Return the cached size of a relation fork, or InvalidBlockNumber
+ */
+BlockNumber
+RelSizeCacheLookup(RelFileNode rnode, ForkNumber forknum)
+{
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	RelSizeEnt *ent;
+	BlockNumber result = InvalidBlockNumber;
+
+	if (RelSizeHash == NULL)
+		return InvalidBlockNumber;
+
+	hashcode = get_hash_value(RelSizeHash, &rnode);
+	partitionLock = RelSizePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_SHARED);
+	ent = (RelSizeEnt *) hash_search_with_hash_value(RelSizeHash, &rnode,
+													 hashcode, HASH_FIND,
+													 NULL);
+	if (ent)
+		result = ent->nblocks[forknum];
+	LWLockRelease(partitionLock);
+
+	return result;
+}
+
+/*
+ * RelSizeCacheRecord
+ *		Note that a relation fork has at least the given number of blocks
+ *
+ * This is called after extending the fork, and after reading its size from
+ * the file system.  The cached size is only ever raised here, since the
+ * size we were given may already be out of date.
+ */
+void
+RelSizeCacheRecord(RelFileNode rnode, ForkNumber forknum, BlockNumber nblocks)
+{
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	RelSizeEnt *ent;
+	bool		found;
+
+	if (RelSizeHash == NULL || nblocks == InvalidBlockNumber)
+		return;
+
+	hashcode = get_hash_value(RelSizeHash, &rnode);
+	partitionLock = RelSizePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	ent = (RelSizeEnt *) hash_search_with_hash_value(RelSizeHash, &rnode,
+													 hashcode, HASH_ENTER_NULL,
+													 &found);
+	if (ent)
+	{
+		if (!found)
+		{
+			for (int i = 0; i <= MAX_FORKNUM; i++)
+				ent->nblocks[i] = InvalidBlockNumber;
+		}
+		if (ent->nblocks[forknum] == InvalidBlockNumber ||
+			ent->nblocks[forknum] < nblocks)
+			ent->nblocks[forknum] = nblocks;
+	}
+	LWLockRelease(partitionLock);
+}
+
+/*
+ * RelSizeCacheTruncate
+ *		Set the cached size of a relation fork that is being truncated
+ *
+ * Pass InvalidBlockNumber before truncating the fork, to make everyone
+ * read the size from the file system, and the new size once it's done.
+ * The caller must hold AccessExclusiveLock on the relation, so that nobody
+ * else records a size in between.
+ */
+void
+RelSizeCacheTruncate(RelFileNode rnode, ForkNumber forknum,
+					 BlockNumber nblocks)
+{
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	RelSizeEnt *ent;
+
+	if (RelSizeHash == NULL)
+		return;
+
+	hashcode = get_hash_value(RelSizeHash, &rnode);
+	partitionLock = RelSizePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	ent = (RelSizeEnt *) hash_search_with_hash_value(RelSizeHash, &rnode,
+													 hashcode, HASH_FIND,
+													 NULL);
+	if (ent)
+		ent->nblocks[forknum] = nblocks;
+	LWLockRelease(partitionLock);
+}
+
+/*
+ * RelSizeCacheForget
+ *		Remove the entry of a relation whose files are being unlinked
+ */
+void
+RelSizeCacheForget(RelFileNode rnode)
+{
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+
+	if (RelSizeHash == NULL)
+		return;
+
+	hashcode = get_hash_value(RelSizeHash, &rnode);
+	partitionLock = RelSizePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	(void) hash_search_with_hash_value(RelSizeHash, &rnode, hashcode,
+									   HASH_REMOVE, NULL);
+	LWLockRelease(partitionLock);
+}
+
+/*
+ * RelSizeCacheForgetDatabase
+ *		Remove the entries of all relations of a database
+ *
+ * This is called when a database is dropped or moved to another
+ * tablespace, which removes its files without unlinking relations one by
+ * one.  It's not a performance-critical path, so we just scan the whole
+ * table.
+ */
+void
+RelSizeCacheForgetDatabase(Oid dbid)
+{
+	HASH_SEQ_STATUS status;
+	RelSizeEnt *ent;
+	int			i;
+
+	if (RelSizeHash == NULL)
+		return;
+
+	for (i = 0; i < NUM_RELSIZE_PARTITIONS; i++)
+		LWLockAcquire(&RelSizeLocks[i].lock, LW_EXCLUSIVE);
+
+	hash_seq_init(&status, RelSizeHash);
+	while ((ent = (RelSizeEnt *) hash_seq_search(&status)) != NULL)
+	{
+		if (ent->rnode.dbNode == dbid)
+			(void) hash_search(RelSizeHash, &ent->rnode, HASH_REMOVE, NULL);
+	}
+
+	for (i = NUM_RELSIZE_PARTITIONS; --i >= 0;)
+		LWLockRelease(&RelSizeLocks[i].lock);
+}
@@ -20,8 +20,10 @@
 #include "access/xlog.h"
 #include "lib/ilist.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/ipc.h"
 #include "storage/md.h"
+#include "storage/relsize.h"
 #include "storage/smgr.h"
 #include "utils/hsearch.h"
 #include "utils/inval.h"
@@ -50,12 +52,18 @@ typedef struct f_smgr
 								bool isRedo);
 	void		(*smgr_extend) (SMgrRelation reln, ForkNumber forknum,
 								BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_zeroextend) (SMgrRelation reln, ForkNumber forknum,
+									BlockNumber blocknum, BlockNumber nblocks,
+									bool skipFsync);
 	bool		(*smgr_prefetch) (SMgrRelation reln, ForkNumber forknum,
 								  BlockNumber blocknum);
 	void		(*smgr_read) (SMgrRelation reln, ForkNumber forknum,
 							  BlockNumber blocknum, char *buffer);
 	void		(*smgr_write) (SMgrRelation reln, ForkNumber forknum,
 							   BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_readv) (SMgrRelation reln, ForkNumber forknum,
+							   BlockNumber blocknum, char **buffers,
+							   BlockNumber nblocks);
 	void		(*smgr_writeback) (SMgrRelation reln, ForkNumber forknum,
 								   BlockNumber blocknum, BlockNumber nblocks);
 	BlockNumber (*smgr_nblocks) (SMgrRelation reln, ForkNumber forknum);
@@ -75,9 +83,11 @@ static const f_smgr smgrsw[] = {
 		.smgr_exists = mdexists,
 		.smgr_unlink = mdunlink,
 		.smgr_extend = mdextend,
+		.smgr_zeroextend = mdzeroextend,
 		.smgr_prefetch = mdprefetch,
 		.smgr_read = mdread,
 		.smgr_write = mdwrite,
+		.smgr_readv = mdreadv,
 		.smgr_writeback = mdwriteback,
 		.smgr_nblocks = mdnblocks,
 		.smgr_truncate = mdtruncate,
@@ -334,6 +344,11 @@ void
 smgrcreate(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 {
 	smgrsw[reln->smgr_which].smgr_create(reln, forknum, isRedo);
+
+	/* In redo, the file might exist already; don't trust any cached size */
+	if (!SmgrIsTemp(reln))
+		RelSizeCacheTruncate(reln->smgr_rnode.node, forknum,
+							 InvalidBlockNumber);
 }
 
 /*
@@ -430,6 +445,19 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 	for (i = 0; i < nrels; i++)
 		CacheInvalidateSmgr(rnodes[i]);
 
+	/*
+	 * Likewise, forget their sizes in the shared cache, and discard any
+	 * copies of their pages in the double-write file.
+	 */
+	for (i = 0; i < nrels; i++)
+	{
+		if (!RelFileNodeBackendIsTemp(rnodes[i]))
+		{
+			RelSizeCacheForget(rnodes[i].node);
+			DoubleWriteForget(rnodes[i].node, InvalidForkNumber, 0);
+		}
+	}
+
 	/*
 	 * Delete the physical file(s).
 	 *
@@ -466,6 +494,9 @@ smgrextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	smgrsw[reln->smgr_which].smgr_extend(reln, forknum, blocknum,
 										 buffer, skipFsync);
 
+	if (!SmgrIsTemp(reln))
+		RelSizeCacheRecord(reln->smgr_rnode.node, forknum, blocknum + 1);
+
 	/*
 	 * Normally we expect this to increase nblocks by one, but if the cached
 	 * value isn't as expected, just invalidate it so the next call asks the
@@ -477,6 +508,34 @@ smgrextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
 }
 
+/*
+ *	smgrzeroextend() -- Add new zeroed out blocks to a file.
+ *
+ *		Similar to smgrextend(), except the relation is extended by nblocks
+ *		blocks of zeroes starting at blocknum, which the storage manager may
+ *		be able to do more cheaply than writing them one at a time.
+ */
+void
+smgrzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			   BlockNumber nblocks, bool skipFsync)
+{
+	smgrsw[reln->smgr_which].smgr_zeroextend(reln, forknum, blocknum,
+											 nblocks, skipFsync);
+
+	if (!SmgrIsTemp(reln))
+		RelSizeCacheRecord(reln->smgr_rnode.node, forknum, blocknum + nblocks);
+
+	/*
+	 * Normally we expect this to increase nblocks by nblocks, but if the
+	 * cached value isn't as expected, just invalidate it so the next call
+	 * asks the kernel.
+	 */
+	if (reln->smgr_cached_nblocks[forknum] == blocknum)
+		reln->smgr_cached_nblocks[forknum] = blocknum + nblocks;
+	else
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+}
+
 /*
  *	smgrprefetch() -- Initiate asynchronous read of the specified block of a relation.
  *
@@ -529,6 +588,21 @@ smgrwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 }
 
 
+/*
+ *	smgrreadv() -- read the specified consecutive blocks into buffers.
+ *
+ *		This is the same as calling smgrread() for each of the nblocks blocks
+ *		starting at blocknum, with buffers[i] receiving block blocknum + i,
+ *		but lets the storage manager combine the reads.
+ */
+void
+smgrreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		  char **buffers, BlockNumber nblocks)
+{
+	smgrsw[reln->smgr_which].smgr_readv(reln, forknum, blocknum, buffers,
+										nblocks);
+}
+
 /*
  *	smgrwriteback() -- Trigger kernel writeback for the supplied range of
  *					   blocks.
@@ -557,13 +631,65 @@ smgrnblocks(SMgrRelation reln, ForkNumber forknum)
 	if (InRecovery && reln->smgr_cached_nblocks[forknum] != InvalidBlockNumber)
 		return reln->smgr_cached_nblocks[forknum];
 
+	/*
+	 * Otherwise, sizes kept in the shared cache are always up to date; see
+	 * relsize.c.
+	 */
+	if (!SmgrIsTemp(reln))
+	{
+		result = RelSizeCacheLookup(reln->smgr_rnode.node, forknum);
+		if (result != InvalidBlockNumber)
+		{
+			reln->smgr_cached_nblocks[forknum] = result;
+			return result;
+		}
+	}
+
 	result = smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
 
+	if (!SmgrIsTemp(reln))
+		RelSizeCacheRecord(reln->smgr_rnode.node, forknum, result);
+
 	reln->smgr_cached_nblocks[forknum] = result;
 
 	return result;
 }
 
+/*
+ *	smgrforgetnblocks() -- Forget the cached sizes of the forks of the
+ *						   supplied relation.
+ *
+ * In recovery, smgrnblocks() caches relation sizes.  Processes replaying
+ * WAL in parallel call this when another one may have changed them.
+ */
+void
+smgrforgetnblocks(SMgrRelation reln)
+{
+	ForkNumber	forknum;
+
+	for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+}
+
+/*
+ *	smgrforgetallnblocks() -- Forget the cached sizes of all relations.
+ */
+void
+smgrforgetallnblocks(void)
+{
+	HASH_SEQ_STATUS status;
+	SMgrRelation reln;
+
+	/* Nothing to do if hashtable not set up */
+	if (SMgrRelationHash == NULL)
+		return;
+
+	hash_seq_init(&status, SMgrRelationHash);
+
+	while ((reln = (SMgrRelation) hash_seq_search(&status)) != NULL)
+		smgrforgetnblocks(reln);
+}
+
 /*
  *	smgrtruncate() -- Truncate the given forks of supplied relation to
  *					  each specified numbers of blocks
@@ -602,9 +728,19 @@ smgrtruncate(SMgrRelation reln, ForkNumber *forknum, int nforks, BlockNumber *nb
 	{
 		/* Make the cached size is invalid if we encounter an error. */
 		reln->smgr_cached_nblocks[forknum[i]] = InvalidBlockNumber;
+		if (!SmgrIsTemp(reln))
+		{
+			RelSizeCacheTruncate(reln->smgr_rnode.node, forknum[i],
+								 InvalidBlockNumber);
+			DoubleWriteForget(reln->smgr_rnode.node, forknum[i], nblocks[i]);
+		}
 
 		smgrsw[reln->smgr_which].smgr_truncate(reln, forknum[i], nblocks[i]);
 
+		if (!SmgrIsTemp(reln))
+			RelSizeCacheTruncate(reln->smgr_rnode.node, forknum[i],
+								 nblocks[i]);
+
 		/*
 		 * We might as well update the local smgr_cached_nblocks values. The
 		 * smgr cache inval message that this function sent will cause other
@@ -39,6 +39,7 @@
 #include "executor/tstoreReceiver.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
+#include "tcop/tcopprot.h"
 #include "utils/portal.h"
 
 
@@ -284,8 +285,17 @@ ReadyForQuery(CommandDest dest)
 			}
 			else
 				pq_putemptymessage('Z');
-			/* Flush output at end of cycle in any case. */
-			pq_flush();
+
+			/*
+			 * Flush output at end of cycle, unless defer_sync_flush is set
+			 * and the client has already sent another complete message.  A
+			 * pipelining client then gets the replies to several cycles in
+			 * one write; PostgresMain flushes before it waits for input.
+			 */
+			if (!defer_sync_flush ||
+				PG_PROTOCOL_MAJOR(FrontendProtocol) < 3 ||
+				!pq_buffer_has_complete_message())
+				pq_flush();
 			break;
 
 		case DestNone:
@@ -41,6 +41,7 @@
 #include "access/xact.h"
 #include "catalog/pg_type.h"
 #include "commands/async.h"
+#include "commands/explain_progress.h"
 #include "commands/prepare.h"
 #include "executor/spi.h"
 #include "jit/jit.h"
@@ -60,6 +61,7 @@
 #include "postmaster/autovacuum.h"
 #include "postmaster/interrupt.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
 #include "replication/logicallauncher.h"
 #include "replication/logicalworker.h"
 #include "replication/slot.h"
@@ -101,6 +103,9 @@ int			max_stack_depth = 100;
 /* wait N seconds to allow attach from a debugger */
 int			PostAuthDelay = 0;
 
+/* GUC variable: hold back flushes while more client messages are buffered */
+bool		defer_sync_flush = false;
+
 
 
 /* ----------------
@@ -3209,6 +3214,9 @@ ProcessInterrupts(void)
 
 	if (ParallelMessagePending)
 		HandleParallelMessages();
+
+	if (PlanProgressPending)
+		ProcessPlanProgressInterrupt();
 }
 
 
@@ -3902,6 +3910,7 @@ PostgresMain(int argc, char *argv[],
 
 		/* Initialize MaxBackends (if under postmaster, was done already) */
 		InitializeMaxBackends();
+		InitializeFastPathLocks();
 	}
 
 	/* Early initialization */
@@ -4239,6 +4248,9 @@ PostgresMain(int argc, char *argv[],
 				pgstat_report_activity(STATE_IDLE, NULL);
 			}
 
+			/* Tell a connection proxy whether it may reuse our session */
+			ReportSessionPoolability();
+
 			ReadyForQuery(whereToSendOutput);
 			send_ready_for_query = false;
 		}
@@ -4251,6 +4263,15 @@ PostgresMain(int argc, char *argv[],
 		 */
 		DoingCommandRead = true;
 
+		/*
+		 * If ReadyForQuery held back its flush because the client had
+		 * already sent more messages, those have now been consumed; make
+		 * sure everything is on the wire before we wait for more input.
+		 */
+		if (defer_sync_flush && whereToSendOutput == DestRemote &&
+			!pq_buffer_has_complete_message())
+			pq_flush();
+
 		/*
 		 * (3) read a command (loop blocks here)
 		 */
@@ -1417,6 +1417,134 @@ DecodeDateTime(char **field, int *ftype, int nf,
 }
 
 
+/* DecodeISODateTimeFast()
+ * Interpret a string in the canonical ISO 8601 layout
+ *		"YYYY-MM-DD[ T]HH:MM:SS[.ffffff][+-HH[:MM]]"
+ * (the time part being optional) without going through ParseDateTime and
+ * DecodeDateTime.  This is the form in which datestyle ISO prints timestamps,
+ * so it is what bulk loads and dumps mostly feed back to us.
+ *
+ * Returns true and fills *tm, *fsec and *tzp (if not NULL) exactly as
+ * DecodeDateTime would have done.  Returns false, with the outputs in an
+ * unspecified state, if the string deviates from that layout in any way
+ * (including out-of-range fields); the caller should then take the general
+ * path, which also takes care of reporting errors.
+ */
+bool
+DecodeISODateTimeFast(const char *str, struct pg_tm *tm, fsec_t *fsec,
+					  int *tzp)
+{
+	const char *cp = str;
+	bool		have_tz = false;
+
+#define ISO_DIGIT(c)	((c) >= '0' && (c) <= '9')
+#define ISO_2DIGITS(p)	(ISO_DIGIT((p)[0]) && ISO_DIGIT((p)[1]))
+#define ISO_2DIGITS_VAL(p)	(((p)[0] - '0') * 10 + ((p)[1] - '0'))
+
+	/* YYYY-MM-DD */
+	if (!ISO_2DIGITS(cp) || !ISO_2DIGITS(cp + 2) || cp[4] != '-' ||
+		!ISO_2DIGITS(cp + 5) || cp[7] != '-' || !ISO_2DIGITS(cp + 8))
+		return false;
+	tm->tm_year = ISO_2DIGITS_VAL(cp) * 100 + ISO_2DIGITS_VAL(cp + 2);
+	tm->tm_mon = ISO_2DIGITS_VAL(cp + 5);
+	tm->tm_mday = ISO_2DIGITS_VAL(cp + 8);
+	cp += 10;
+
+	if (tm->tm_year < 1 || tm->tm_mon < 1 || tm->tm_mon > MONTHS_PER_YEAR ||
+		tm->tm_mday < 1 ||
+		tm->tm_mday > day_tab[isleap(tm->tm_year)][tm->tm_mon - 1])
+		return false;
+
+	tm->tm_hour = 0;
+	tm->tm_min = 0;
+	tm->tm_sec = 0;
+	*fsec = 0;
+	tm->tm_isdst = -1;
+
+	/* [ T]HH:MM:SS[.ffffff] */
+	if (*cp == ' ' || *cp == 'T')
+	{
+		cp++;
+		if (!ISO_2DIGITS(cp) || cp[2] != ':' ||
+			!ISO_2DIGITS(cp + 3) || cp[5] != ':' || !ISO_2DIGITS(cp + 6))
+			return false;
+		tm->tm_hour = ISO_2DIGITS_VAL(cp);
+		tm->tm_min = ISO_2DIGITS_VAL(cp + 3);
+		tm->tm_sec = ISO_2DIGITS_VAL(cp + 6);
+		cp += 8;
+
+		/* leave "24:00:00" and leap seconds to the general code */
+		if (tm->tm_hour >= HOURS_PER_DAY ||
+			tm->tm_min >= MINS_PER_HOUR ||
+			tm->tm_sec >= SECS_PER_MINUTE)
+			return false;
+
+		if (*cp == '.')
+		{
+			int			ndigits = 0;
+			int			frac = 0;
+
+			cp++;
+			while (ISO_DIGIT(*cp) && ndigits < 6)
+			{
+				frac = frac * 10 + (*cp++ - '0');
+				ndigits++;
+			}
+			/* more digits than we keep would need rounding */
+			if (ndigits == 0 || ISO_DIGIT(*cp))
+				return false;
+			while (ndigits++ < 6)
+				frac *= 10;
+			*fsec = frac;
+		}
+	}
+
+	/* +-HH[:MM], only accepted after a time */
+	if ((*cp == '+' || *cp == '-') && cp - str > 10)
+	{
+		int			hr,
+					min = 0;
+		int			tz;
+
+		if (!ISO_2DIGITS(cp + 1))
+			return false;
+		hr = ISO_2DIGITS_VAL(cp + 1);
+		if (cp[3] == ':')
+		{
+			if (!ISO_2DIGITS(cp + 4))
+				return false;
+			min = ISO_2DIGITS_VAL(cp + 4);
+			if (cp[6] != '\0')
+				return false;
+		}
+		else if (cp[3] != '\0')
+			return false;
+
+		if (hr > MAX_TZDISP_HOUR || min >= MINS_PER_HOUR)
+			return false;
+
+		tz = (hr * MINS_PER_HOUR + min) * SECS_PER_MINUTE;
+		if (*cp == '-')
+			tz = -tz;
+		if (tzp != NULL)
+			*tzp = -tz;
+		have_tz = true;
+	}
+	else if (*cp != '\0')
+		return false;
+
+#undef ISO_DIGIT
+#undef ISO_2DIGITS
+#undef ISO_2DIGITS_VAL
+
+	/* timezone not specified? then use session timezone */
+	if (tzp != NULL && !have_tz)
+		*tzp = DetermineTimeZoneOffset(tm, session_timezone);
+
+	return true;
+}
+
+
 /* DetermineTimeZoneOffset()
  *
  * Given a struct pg_tm in which tm_year, tm_mon, tm_mday, tm_hour, tm_min,
@@ -21,8 +21,10 @@
 Datum
 jsonb_exists(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
 	text	   *key = PG_GETARG_TEXT_PP(1);
+	Jsonb	   *jb = DatumGetJsonbPForKey(PG_GETARG_DATUM(0),
+										  VARDATA_ANY(key),
+										  VARSIZE_ANY_EXHDR(key));
 	JsonbValue	kval;
 	JsonbValue *v = NULL;
 
@@ -13,6 +13,8 @@
  */
 #include "postgres.h"
 
+#include "access/detoast.h"
+#include "access/toast_compression.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_type.h"
 #include "common/hashfn.h"
@@ -40,6 +42,10 @@
 static void fillJsonbValue(JsonbContainer *container, int index,
 						   char *base_addr, uint32 offset,
 						   JsonbValue *result);
+static int	getJsonbKeyIndex(JsonbContainer *container,
+							 const char *keyVal, int keyLen);
+static Jsonb *detoastJsonbPrefix(struct varlena *attr, uint64 len,
+								 uint64 rawsize);
 static bool equalsJsonbScalarValue(JsonbValue *a, JsonbValue *b);
 static int	compareJsonbScalarValue(JsonbValue *a, JsonbValue *b);
 static Jsonb *convertToJsonb(JsonbValue *val);
@@ -390,6 +396,36 @@ findJsonbValueFromContainer(JsonbContainer *container, uint32 flags,
 JsonbValue *
 getKeyJsonValueFromContainer(JsonbContainer *container,
 							 const char *keyVal, int keyLen, JsonbValue *res)
+{
+	int			count = JsonContainerSize(container);
+	int			index;
+
+	Assert(JsonContainerIsObject(container));
+
+	index = getJsonbKeyIndex(container, keyVal, keyLen);
+	if (index < 0)
+		return NULL;
+
+	/* Found our key, return corresponding value */
+	index += count;
+
+	if (!res)
+		res = palloc(sizeof(JsonbValue));
+
+	fillJsonbValue(container, index, (char *) (container->children + count * 2),
+				   getJsonbOffset(container, index),
+				   res);
+
+	return res;
+}
+
+/*
+ * Find the index of a key in a Jsonb object, or -1 if it's not there.
+ *
+ * This looks only at the JEntries and the keys, not at the values.
+ */
+static int
+getJsonbKeyIndex(JsonbContainer *container, const char *keyVal, int keyLen)
 {
 	JEntry	   *children = container->children;
 	int			count = JsonContainerSize(container);
@@ -397,11 +433,9 @@ getKeyJsonValueFromContainer(JsonbContainer *container,
 	uint32		stopLow,
 				stopHigh;
 
-	Assert(JsonContainerIsObject(container));
-
-	/* Quick out without a palloc cycle if object is empty */
+	/* Quick out if object is empty */
 	if (count <= 0)
-		return NULL;
+		return -1;
 
 	/*
 	 * Binary search the container. Since we know this is an object, account
@@ -426,19 +460,7 @@ getKeyJsonValueFromContainer(JsonbContainer *container,
 											  keyVal, keyLen);
 
 		if (difference == 0)
-		{
-			/* Found our key, return corresponding value */
-			int			index = stopMiddle + count;
-
-			if (!res)
-				res = palloc(sizeof(JsonbValue));
-
-			fillJsonbValue(container, index, baseAddr,
-						   getJsonbOffset(container, index),
-						   res);
-
-			return res;
-		}
+			return stopMiddle;
 		else
 		{
 			if (difference < 0)
@@ -449,7 +471,115 @@ getKeyJsonValueFromContainer(JsonbContainer *container,
 	}
 
 	/* Not found */
-	return NULL;
+	return -1;
+}
+
+/*
+ * Detoast a jsonb datum just enough to look up keyVal in its root object
+ * with getKeyJsonValueFromContainer().
+ *
+ * An object stores all its keys before all its values, so the lookup needs
+ * only a prefix of the datum: the root header and JEntries, the keys, and
+ * the values up to the one of keyVal.  For a compressed or toasted datum,
+ * only that prefix is decompressed or fetched, which for a large document
+ * can be much less than all of it.  The result is good for nothing but
+ * that lookup, as it may lack the other values.
+ *
+ * Datums that aren't compressed or toasted, that can't be sliced cheaply,
+ * or whose root isn't an object are detoasted in full.
+ */
+Jsonb *
+DatumGetJsonbPForKey(Datum d, const char *keyVal, int keyLen)
+{
+	struct varlena *attr = (struct varlena *) DatumGetPointer(d);
+	Jsonb	   *jb;
+	uint64		rawsize;
+	uint64		dataoff;
+	uint32		count;
+	uint32		keyslen;
+	int			index;
+
+	if (VARATT_IS_EXTERNAL_ONDISK(attr))
+	{
+		struct varatt_external toast_pointer;
+
+		/*
+		 * A slice of an external value compressed with anything but pglz
+		 * fetches all of the value, and we take up to four slices.
+		 */
+		VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+		if (VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer) &&
+			VARATT_EXTERNAL_GET_COMPRESS_METHOD(toast_pointer) !=
+			TOAST_PGLZ_COMPRESSION_ID)
+			return DatumGetJsonbP(d);
+	}
+	else if (!VARATT_IS_COMPRESSED(attr))
+		return DatumGetJsonbP(d);
+
+	rawsize = toast_raw_datum_size(d) - VARHDRSZ;
+
+	/* The root header tells whether it's an object, and its size */
+	jb = detoastJsonbPrefix(attr, sizeof(uint32), rawsize);
+	if (jb == NULL)
+		return DatumGetJsonbP(d);
+	if (!JB_ROOT_IS_OBJECT(jb))
+	{
+		pfree(jb);
+		return DatumGetJsonbP(d);
+	}
+	count = JB_ROOT_COUNT(jb);
+	pfree(jb);
+
+	/* The JEntries give where the keys end, which is where the values begin */
+	dataoff = sizeof(uint32) + (uint64) count * 2 * sizeof(JEntry);
+	jb = detoastJsonbPrefix(attr, dataoff, rawsize);
+	if (jb == NULL)
+		return DatumGetJsonbP(d);
+	keyslen = getJsonbOffset(&jb->root, count);
+	pfree(jb);
+
+	/* With the keys, we can find the one we're after */
+	jb = detoastJsonbPrefix(attr, dataoff + keyslen, rawsize);
+	if (jb == NULL)
+		return DatumGetJsonbP(d);
+	index = getJsonbKeyIndex(&jb->root, keyVal, keyLen);
+	if (index < 0)
+		return jb;
+
+	/* And then we need the values up to the end of its value */
+	index += count;
+	dataoff += getJsonbOffset(&jb->root, index) +
+		getJsonbLength(&jb->root, index);
+	pfree(jb);
+	jb = detoastJsonbPrefix(attr, dataoff, rawsize);
+	if (jb == NULL)
+		return DatumGetJsonbP(d);
+
+	return jb;
+}
+
+/*
+ * Detoast the first len bytes of a jsonb datum of rawsize bytes.
+ *
+ * Returns NULL if that's not less than all of it, or if the datum turns out
+ * to be shorter, in which case the caller should just detoast all of it.
+ */
+static Jsonb *
+detoastJsonbPrefix(struct varlena *attr, uint64 len, uint64 rawsize)
+{
+	Jsonb	   *jb;
+
+	if (len >= rawsize)
+		return NULL;
+
+	jb = (Jsonb *) detoast_attr_slice(attr, 0, (int32) len);
+	if (VARSIZE(jb) - VARHDRSZ < len)
+	{
+		pfree(jb);
+		return NULL;
+	}
+
+	return jb;
 }
 
 /*
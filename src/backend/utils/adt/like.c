@@ -128,6 +128,7 @@ SB_lower_char(unsigned char c, pg_locale_t locale, bool locale_is_c)
 
 #define MatchText	SB_MatchText
 #define do_like_escape	SB_do_like_escape
+#define MATCH_MEMCHR
 
 #include "like_match.c"
 
@@ -143,6 +144,7 @@ SB_lower_char(unsigned char c, pg_locale_t locale, bool locale_is_c)
 #define NextChar(p, plen) \
 	do { (p)++; (plen)--; } while ((plen) > 0 && (*(p) & 0xC0) == 0x80 )
 #define MatchText	UTF8_MatchText
+#define MATCH_MEMCHR
 
 #include "like_match.c"
 
@@ -15,6 +15,9 @@
  * MatchText - to name of function wanted
  * do_like_escape - name of function if wanted - needs CHAREQ and CopyAdvChar
  * MATCH_LOWER - define for case (4) to specify case folding for 1-byte chars
+ * MATCH_MEMCHR - define if the byte starting a character can't occur inside
+ *	 another character, so that memchr() can be used to find candidate text
+ *	 positions for a literal pattern character; cases (1) and (2)
  *
  * Copyright (c) 1996-2020, PostgreSQL Global Development Group
  *
@@ -171,6 +174,24 @@ MatchText(const char *t, int tlen, const char *p, int plen,
 			else
 				firstpat = GETCHAR(*p);
 
+#ifdef MATCH_MEMCHR
+			while (tlen > 0)
+			{
+				const char *next = memchr(t, firstpat, tlen);
+				int			matched;
+
+				if (next == NULL)
+					break;
+				tlen -= next - t;
+				t = next;
+
+				matched = MatchText(t, tlen, p, plen, locale, locale_is_c);
+				if (matched != LIKE_FALSE)
+					return matched; /* TRUE or ABORT */
+
+				NextChar(t, tlen);
+			}
+#else
 			while (tlen > 0)
 			{
 				if (GETCHAR(*t) == firstpat)
@@ -184,6 +205,7 @@ MatchText(const char *t, int tlen, const char *p, int plen,
 
 				NextChar(t, tlen);
 			}
+#endif
 
 			/*
 			 * End of text with no match, so no point in trying later places
@@ -358,3 +380,7 @@ do_like_escape(text *pat, text *esc)
 #undef MATCH_LOWER
 
 #endif
+
+#ifdef MATCH_MEMCHR
+#undef MATCH_MEMCHR
+#endif
@@ -24,11 +24,15 @@
 #include "pgstat.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
+#include "storage/buf_stats.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
 #include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/inet.h"
+#include "utils/relfilenodemap.h"
 #include "utils/timestamp.h"
 
 #define UINT32_ACCESS_ONCE(var)		 ((uint32)(*((volatile uint32 *)&(var))))
@@ -86,6 +90,38 @@ pg_stat_get_tuples_fetched(PG_FUNCTION_ARGS)
 }
 
 
+Datum
+pg_stat_get_ios_heap_fetches(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	int64		result;
+	PgStat_StatTabEntry *tabentry;
+
+	if ((tabentry = pgstat_fetch_stat_tabentry(relid)) == NULL)
+		result = 0;
+	else
+		result = (int64) (tabentry->ios_heap_fetches);
+
+	PG_RETURN_INT64(result);
+}
+
+
+Datum
+pg_stat_get_ios_heap_fetches_avoided(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	int64		result;
+	PgStat_StatTabEntry *tabentry;
+
+	if ((tabentry = pgstat_fetch_stat_tabentry(relid)) == NULL)
+		result = 0;
+	else
+		result = (int64) (tabentry->ios_heap_fetches_avoided);
+
+	PG_RETURN_INT64(result);
+}
+
+
 Datum
 pg_stat_get_tuples_inserted(PG_FUNCTION_ARGS)
 {
@@ -567,7 +603,7 @@ pg_stat_get_progress_info(PG_FUNCTION_ARGS)
 Datum
 pg_stat_get_activity(PG_FUNCTION_ARGS)
 {
-#define PG_STAT_GET_ACTIVITY_COLS	30
+#define PG_STAT_GET_ACTIVITY_COLS	31
 	int			num_backends = pgstat_fetch_stat_numbackends();
 	int			curr_backend;
 	int			pid = PG_ARGISNULL(0) ? -1 : PG_GETARG_INT32(0);
@@ -670,6 +706,8 @@ pg_stat_get_activity(PG_FUNCTION_ARGS)
 		else
 			nulls[16] = true;
 
+		values[30] = Int64GetDatum((int64) beentry->st_allocated_bytes);
+
 		/* Values only available to role member or pg_read_all_stats */
 		if (HAS_PGSTAT_PERMISSIONS(beentry->st_userid))
 		{
@@ -1774,6 +1812,550 @@ pg_stat_get_slru(PG_FUNCTION_ARGS)
 	return (Datum) 0;
 }
 
+/*
+ * Returns shared buffer usage counters per relation.  The relation OID can
+ * only be looked up for relations of the current database, and shared ones.
+ */
+Datum
+pg_stat_get_buffer_relations(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_BUFFER_RELATIONS_COLS	12
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	BufferStatsRelation *rels;
+	TimestampTz reset_timestamp;
+	int			nrels;
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	rels = BufferStatsGetRelations(&nrels);
+	reset_timestamp = BufferStatsGetResetTimestamp();
+
+	for (i = 0; i < nrels; i++)
+	{
+		/* for each row */
+		Datum		values[PG_STAT_GET_BUFFER_RELATIONS_COLS];
+		bool		nulls[PG_STAT_GET_BUFFER_RELATIONS_COLS];
+		BufferStatsRelation *rel = &rels[i];
+		int			j;
+
+		MemSet(values, 0, sizeof(values));
+		MemSet(nulls, 0, sizeof(nulls));
+
+		/* the entry for relations that didn't fit has no identity */
+		if (rel->rnode.relNode == InvalidOid)
+		{
+			nulls[0] = nulls[1] = nulls[2] = nulls[3] = true;
+		}
+		else
+		{
+			Oid			relid = InvalidOid;
+
+			if (rel->rnode.dbNode == MyDatabaseId ||
+				rel->rnode.dbNode == InvalidOid)
+				relid = RelidByRelfilenode(rel->rnode.spcNode,
+										   rel->rnode.relNode);
+
+			values[0] = ObjectIdGetDatum(rel->rnode.dbNode);
+			if (OidIsValid(relid))
+				values[1] = ObjectIdGetDatum(relid);
+			else
+				nulls[1] = true;
+			values[2] = ObjectIdGetDatum(rel->rnode.spcNode);
+			values[3] = ObjectIdGetDatum(rel->rnode.relNode);
+		}
+
+		for (j = 0; j < BUFSTATS_NUM_COUNTERS; j++)
+			values[4 + j] = Int64GetDatum((int64) rel->counts[j]);
+		values[4 + BUFSTATS_NUM_COUNTERS] = TimestampTzGetDatum(reset_timestamp);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Returns shared buffer usage counters per buffer access strategy.
+ */
+Datum
+pg_stat_get_buffer_strategies(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_BUFFER_STRATEGIES_COLS	6
+	static const char *const strategy_names[BUFSTATS_NUM_STRATEGIES] = {
+		[BAS_NORMAL] = "normal",
+		[BAS_BULKREAD] = "bulkread",
+		[BAS_BULKWRITE] = "bulkwrite",
+		[BAS_VACUUM] = "vacuum"
+	};
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	uint64		counts[BUFSTATS_NUM_STRATEGIES][BUFSTATS_NUM_COUNTERS];
+	TimestampTz reset_timestamp;
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	BufferStatsGetStrategies(counts);
+	reset_timestamp = BufferStatsGetResetTimestamp();
+
+	for (i = 0; i < BUFSTATS_NUM_STRATEGIES; i++)
+	{
+		/* for each row */
+		Datum		values[PG_STAT_GET_BUFFER_STRATEGIES_COLS];
+		bool		nulls[PG_STAT_GET_BUFFER_STRATEGIES_COLS];
+
+		MemSet(values, 0, sizeof(values));
+		MemSet(nulls, 0, sizeof(nulls));
+
+		values[0] = PointerGetDatum(cstring_to_text(strategy_names[i]));
+		values[1] = Int64GetDatum((int64) counts[i][BUFSTATS_HIT]);
+		values[2] = Int64GetDatum((int64) counts[i][BUFSTATS_READ]);
+		values[3] = Int64GetDatum((int64) counts[i][BUFSTATS_EVICTED]);
+		values[4] = Int64GetDatum((int64) counts[i][BUFSTATS_WRITTEN_BACKEND]);
+		values[5] = TimestampTzGetDatum(reset_timestamp);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Returns the I/O counters, one row per backend type, object and context.
+ * Combinations that can't happen are left out: processes that do no
+ * relation I/O, and temporary relations with buffer access strategies.
+ * Counters that can't be non-zero in a row are shown as NULL.
+ */
+Datum
+pg_stat_get_io(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_IO_COLS	16
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	PgStat_IOStats *stats;
+	int			b;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	stats = palloc(sizeof(PgStat_IOStats));
+	pgstat_fetch_io(stats);
+
+	for (b = 0; b < BACKEND_NUM_TYPES; b++)
+	{
+		int			o;
+
+		switch ((BackendType) b)
+		{
+			case B_INVALID:
+			case B_ARCHIVER:
+			case B_LOGGER:
+			case B_PROXY:
+			case B_STATS_COLLECTOR:
+			case B_WAL_RECEIVER:
+			case B_WAL_WRITER:
+				/* these do no relation I/O */
+				continue;
+			default:
+				break;
+		}
+
+		for (o = 0; o < IOOBJECT_NUM_TYPES; o++)
+		{
+			int			c;
+
+			for (c = 0; c < IOCONTEXT_NUM_TYPES; c++)
+			{
+				PgStat_Counter *counts = stats->counts[b][o][c];
+				PgStat_Counter *times = stats->times[b][o][c];
+				Datum		values[PG_STAT_GET_IO_COLS];
+				bool		nulls[PG_STAT_GET_IO_COLS];
+
+				/* local buffers don't use strategies */
+				if (o == IOOBJECT_TEMP_RELATION && c != IOCONTEXT_NORMAL)
+					continue;
+
+				MemSet(values, 0, sizeof(values));
+				MemSet(nulls, 0, sizeof(nulls));
+
+				values[0] = CStringGetTextDatum(GetBackendTypeDesc((BackendType) b));
+				values[1] = CStringGetTextDatum(pgstat_get_io_object_name((IOObject) o));
+				values[2] = CStringGetTextDatum(pgstat_get_io_context_name((IOContext) c));
+				values[3] = Int64GetDatum(counts[IOOP_READ]);
+				/* convert to msec */
+				values[4] = Float8GetDatum(((double) times[IOOP_READ]) / 1000.0);
+				values[5] = Int64GetDatum(counts[IOOP_WRITE]);
+				values[6] = Float8GetDatum(((double) times[IOOP_WRITE]) / 1000.0);
+				values[7] = Int64GetDatum(counts[IOOP_EXTEND]);
+				values[8] = Float8GetDatum(((double) times[IOOP_EXTEND]) / 1000.0);
+				values[9] = Int64GetDatum(BLCKSZ);
+				values[10] = Int64GetDatum(counts[IOOP_HIT]);
+				values[11] = Int64GetDatum(counts[IOOP_EVICT]);
+
+				/* only buffer access strategies have rings to reuse */
+				if (c == IOCONTEXT_NORMAL)
+					nulls[12] = true;
+				else
+					values[12] = Int64GetDatum(counts[IOOP_REUSE]);
+
+				/* only relations are fsync'd, and never through a strategy */
+				if (o == IOOBJECT_TEMP_RELATION || c != IOCONTEXT_NORMAL)
+				{
+					nulls[13] = true;
+					nulls[14] = true;
+				}
+				else
+				{
+					values[13] = Int64GetDatum(counts[IOOP_FSYNC]);
+					values[14] = Float8GetDatum(((double) times[IOOP_FSYNC]) / 1000.0);
+				}
+
+				values[15] = TimestampTzGetDatum(stats->stat_reset_timestamp);
+
+				tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+			}
+		}
+	}
+
+	pfree(stats);
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Returns contention statistics of the individual LWLocks and the built-in
+ * LWLock tranches.
+ */
+Datum
+pg_stat_get_lwlocks(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_LWLOCKS_COLS	5
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	LWLockStatsEntry *stats;
+	TimestampTz stat_reset_timestamp;
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	stats = palloc(sizeof(LWLockStatsEntry) * NUM_LWLOCK_STATS_ENTRIES);
+	stat_reset_timestamp = LWLockStatsFetch(stats);
+
+	for (i = 0; i < NUM_LWLOCK_STATS_ENTRIES; i++)
+	{
+		Datum		values[PG_STAT_GET_LWLOCKS_COLS];
+		bool		nulls[PG_STAT_GET_LWLOCKS_COLS];
+		const char *name = GetLWLockIdentifier(PG_WAIT_LWLOCK, i);
+
+		/* skip unused individual lock numbers */
+		if (name[0] == '<')
+			continue;
+
+		MemSet(values, 0, sizeof(values));
+		MemSet(nulls, 0, sizeof(nulls));
+
+		values[0] = CStringGetTextDatum(name);
+		values[1] = Int64GetDatum(stats[i].acquire_count);
+		values[2] = Int64GetDatum(stats[i].wait_count);
+		/* convert to msec */
+		values[3] = Float8GetDatum(((double) stats[i].wait_time) / 1000.0);
+		values[4] = TimestampTzGetDatum(stat_reset_timestamp);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	pfree(stats);
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Returns the wait event counters of the process with the given PID, or of
+ * all processes if the PID is NULL.
+ */
+Datum
+pg_stat_get_wait_events(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_WAIT_EVENTS_COLS	6
+	int			pid = PG_ARGISNULL(0) ? -1 : PG_GETARG_INT32(0);
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	PgStat_BackendWaitStats *stats;
+	int			slot;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	stats = palloc(sizeof(PgStat_BackendWaitStats));
+
+	for (slot = 0; pgstat_fetch_wait_stats(slot, stats); slot++)
+	{
+		int			i;
+
+		if (stats->procpid == 0)
+			continue;
+		if (pid != -1 && stats->procpid != pid)
+			continue;
+
+		/* Only show the counters of processes the user may look at */
+		if (!HAS_PGSTAT_PERMISSIONS(stats->userid))
+			continue;
+
+		for (i = 0; i < PGSTAT_WAIT_EVENT_SLOTS; i++)
+		{
+			PgStat_WaitEventCounts *counts = &stats->events[i];
+			Datum		values[PG_STAT_GET_WAIT_EVENTS_COLS];
+			bool		nulls[PG_STAT_GET_WAIT_EVENTS_COLS];
+			Datum		histogram[PGSTAT_WAIT_HIST_BUCKETS];
+			const char *wait_event_type;
+			const char *wait_event;
+			int			j;
+
+			if (counts->wait_event_info == 0)
+				continue;
+
+			MemSet(nulls, 0, sizeof(nulls));
+
+			wait_event_type = pgstat_get_wait_event_type(counts->wait_event_info);
+			wait_event = pgstat_get_wait_event(counts->wait_event_info);
+
+			for (j = 0; j < PGSTAT_WAIT_HIST_BUCKETS; j++)
+				histogram[j] = Int64GetDatum((int64) counts->histogram[j]);
+
+			values[0] = Int32GetDatum(stats->procpid);
+			if (wait_event_type)
+				values[1] = CStringGetTextDatum(wait_event_type);
+			else
+				nulls[1] = true;
+			if (wait_event)
+				values[2] = CStringGetTextDatum(wait_event);
+			else
+				nulls[2] = true;
+			values[3] = Int64GetDatum((int64) counts->calls);
+			/* convert to msec */
+			values[4] = Float8GetDatum(((double) counts->total_time) / 1000.0);
+			values[5] = PointerGetDatum(construct_array(histogram,
+														PGSTAT_WAIT_HIST_BUCKETS,
+														INT8OID, sizeof(int64),
+														FLOAT8PASSBYVAL,
+														TYPALIGN_DOUBLE));
+
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		}
+	}
+
+	pfree(stats);
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Returns the activity counters of the running connection proxies
+ */
+Datum
+pg_stat_get_proxies(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_PROXIES_COLS	8
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	ProxyStats	stats;
+	int			id;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	for (id = 0; ProxyFetchStats(id, &stats); id++)
+	{
+		Datum		values[PG_STAT_GET_PROXIES_COLS];
+		bool		nulls[PG_STAT_GET_PROXIES_COLS];
+
+		if (stats.pid == 0)
+			continue;
+
+		MemSet(nulls, 0, sizeof(nulls));
+
+		values[0] = Int32GetDatum(stats.pid);
+		values[1] = Int32GetDatum(stats.n_clients);
+		values[2] = Int32GetDatum(stats.n_pools);
+		values[3] = Int32GetDatum(stats.n_backends);
+		values[4] = Int32GetDatum(stats.n_idle_backends);
+		values[5] = Int32GetDatum(stats.n_dedicated_backends);
+		values[6] = Int32GetDatum(stats.n_waiting_clients);
+		values[7] = Int64GetDatum(stats.n_transactions);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
 Datum
 pg_stat_get_xact_numscans(PG_FUNCTION_ARGS)
 {
@@ -2033,6 +2615,15 @@ pg_stat_reset_slru(PG_FUNCTION_ARGS)
 	PG_RETURN_VOID();
 }
 
+/* Reset shared buffer usage counters. */
+Datum
+pg_stat_reset_buffer_usage(PG_FUNCTION_ARGS)
+{
+	BufferStatsReset();
+
+	PG_RETURN_VOID();
+}
+
 Datum
 pg_stat_get_archiver(PG_FUNCTION_ARGS)
 {
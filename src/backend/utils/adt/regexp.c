@@ -77,7 +77,7 @@ typedef struct regexp_matches_ctx
  * the array, dropping the entry at the end of the array if necessary to
  * make room.  (This might seem to be weighting the new entry too heavily,
  * but if we insert new entries further back, we'll be unable to adjust to
- * a sudden shift in the query mix where we are presented with MAX_CACHED_RES
+ * a sudden shift in the query mix where we are presented with regex_cache_size
  * never-before-seen items used circularly.  We ought to be able to handle
  * that case, so we have to insert at the front.)
  *
@@ -88,13 +88,27 @@ typedef struct regexp_matches_ctx
  * A reusable pattern that isn't used at least as often as non-reusable
  * patterns are seen will "fail to keep up" and will drop off the end of the
  * cache.  With move-to-front, a reusable pattern is guaranteed to stay in
- * the cache as long as it's used at least once in every MAX_CACHED_RES uses.
+ * the cache as long as it's used at least once in every regex_cache_size uses.
+ *
+ * The maximum number of cached regular expressions is set by the
+ * regex_cache_size GUC.  The array is allocated with malloc, like the
+ * patterns, and grown when the setting is raised; if it is lowered, surplus
+ * entries are dropped from the end the next time an entry is added.
  */
+int			regex_cache_size = 64;
 
-/* this is the maximum number of cached regular expressions */
-#ifndef MAX_CACHED_RES
-#define MAX_CACHED_RES	32
-#endif
+/*
+ * Many patterns used in practice are plain strings, possibly anchored at
+ * either end, such as 'foo', '^foo' or '^foo$'.  When we see one of those
+ * compiled with flags that don't change the meaning of ordinary characters,
+ * we remember it, so that a simple yes/no match can be answered by searching
+ * the data for the bytes of the pattern, without converting the data to
+ * pg_wchar and running the regex engine.  The pattern is still compiled, so
+ * that errors are reported just as before.
+ */
+#define RE_LITERAL			0x01	/* pattern is a literal string */
+#define RE_LITERAL_START	0x02	/* ... which must be at the start */
+#define RE_LITERAL_END		0x04	/* ... which must be at the end */
 
 /* this structure describes one cached regular expression */
 typedef struct cached_re_str
@@ -103,11 +117,15 @@ typedef struct cached_re_str
 	int			cre_pat_len;	/* length of original RE, in bytes */
 	int			cre_flags;		/* compile flags: extended,icase etc */
 	Oid			cre_collation;	/* collation to use */
+	int			cre_literal;	/* RE_LITERAL_xxx flags, or 0 */
+	int			cre_literal_off;	/* offset of literal string in cre_pat */
+	int			cre_literal_len;	/* length of literal string, in bytes */
 	regex_t		cre_re;			/* the compiled regular expression */
 } cached_re_str;
 
 static int	num_res = 0;		/* # of cached re's */
-static cached_re_str re_array[MAX_CACHED_RES];	/* cached re's */
+static int	max_res = 0;		/* allocated size of re_array */
+static cached_re_str *re_array = NULL;	/* cached re's */
 
 
 /* Local functions */
@@ -118,6 +136,10 @@ static regexp_matches_ctx *setup_regexp_matches(text *orig_str, text *pattern,
 												bool ignore_degenerate,
 												bool fetching_unmatched);
 static ArrayType *build_regexp_match_result(regexp_matches_ctx *matchctx);
+static cached_re_str *RE_compile_and_cache_entry(text *text_re, int cflags,
+												 Oid collation);
+static void RE_check_literal(cached_re_str *cre);
+static bool RE_literal_execute(cached_re_str *cre, char *dat, int dat_len);
 static Datum build_regexp_split_result(regexp_matches_ctx *splitctx);
 
 
@@ -135,6 +157,17 @@ static Datum build_regexp_split_result(regexp_matches_ctx *splitctx);
  */
 regex_t *
 RE_compile_and_cache(text *text_re, int cflags, Oid collation)
+{
+	return &RE_compile_and_cache_entry(text_re, cflags, collation)->cre_re;
+}
+
+/*
+ * RE_compile_and_cache_entry - workhorse for RE_compile_and_cache
+ *
+ * Returns the cache entry, which stays valid until the next call.
+ */
+static cached_re_str *
+RE_compile_and_cache_entry(text *text_re, int cflags, Oid collation)
 {
 	int			text_re_len = VARSIZE_ANY_EXHDR(text_re);
 	char	   *text_re_val = VARDATA_ANY(text_re);
@@ -167,10 +200,27 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 				re_array[0] = re_temp;
 			}
 
-			return &re_array[0].cre_re;
+			return &re_array[0];
 		}
 	}
 
+	/*
+	 * Make sure there is room for regex_cache_size entries before we compile
+	 * anything, so that failing to get it doesn't leak the compiled RE.
+	 */
+	if (max_res < regex_cache_size)
+	{
+		cached_re_str *new_array;
+
+		new_array = realloc(re_array, regex_cache_size * sizeof(cached_re_str));
+		if (new_array == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory")));
+		re_array = new_array;
+		max_res = regex_cache_size;
+	}
+
 	/*
 	 * Couldn't find it, so try to compile the new RE.  To avoid leaking
 	 * resources on failure, we build into the re_temp local.
@@ -226,15 +276,15 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 	re_temp.cre_pat_len = text_re_len;
 	re_temp.cre_flags = cflags;
 	re_temp.cre_collation = collation;
+	RE_check_literal(&re_temp);
 
 	/*
 	 * Okay, we have a valid new item in re_temp; insert it into the storage
-	 * array.  Discard last entry if needed.
+	 * array.  Discard last entries if needed.
 	 */
-	if (num_res >= MAX_CACHED_RES)
+	while (num_res >= regex_cache_size)
 	{
 		--num_res;
-		Assert(num_res < MAX_CACHED_RES);
 		pg_regfree(&re_array[num_res].cre_re);
 		free(re_array[num_res].cre_pat);
 	}
@@ -245,7 +295,118 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 	re_array[0] = re_temp;
 	num_res++;
 
-	return &re_array[0].cre_re;
+	return &re_array[0];
+}
+
+/*
+ * RE_check_literal - see whether a new cache entry is a literal string
+ *
+ * Sets the cre_literal fields of the entry.
+ */
+static void
+RE_check_literal(cached_re_str *cre)
+{
+	const char *pat = cre->cre_pat;
+	int			start = 0;
+	int			end = cre->cre_pat_len;
+	int			flags = RE_LITERAL;
+	int			i;
+
+	cre->cre_literal = 0;
+
+	/*
+	 * Matching bytes is the same as matching characters only if a match can't
+	 * start in the middle of a character, which holds for single-byte
+	 * encodings and for UTF8.
+	 */
+	if (pg_database_encoding_max_length() != 1 &&
+		GetDatabaseEncoding() != PG_UTF8)
+		return;
+
+	/* case folding and expanded syntax change the meaning of plain chars */
+	if (cre->cre_flags & (REG_ICASE | REG_EXPANDED))
+		return;
+
+	if (cre->cre_flags & REG_QUOTE)
+	{
+		/* nothing is special */
+	}
+	else if (cre->cre_flags & REG_EXTENDED)
+	{
+		/* ^ and $ anchor only to the ends of the string, unless REG_NLANCH */
+		if (!(cre->cre_flags & REG_NLANCH))
+		{
+			if (end > 0 && pat[0] == '^')
+			{
+				flags |= RE_LITERAL_START;
+				start++;
+			}
+			if (end > start && pat[end - 1] == '$')
+			{
+				flags |= RE_LITERAL_END;
+				end--;
+			}
+		}
+
+		for (i = start; i < end; i++)
+		{
+			if (strchr("\\^$.[]()|*+?{}", pat[i]) != NULL)
+				return;
+		}
+	}
+	else
+	{
+		/* don't bother with BREs */
+		return;
+	}
+
+	cre->cre_literal = flags;
+	cre->cre_literal_off = start;
+	cre->cre_literal_len = end - start;
+}
+
+/*
+ * RE_literal_execute - match a literal-string RE by searching for its bytes
+ *
+ * Returns true on match, false on no match
+ */
+static bool
+RE_literal_execute(cached_re_str *cre, char *dat, int dat_len)
+{
+	const char *lit = cre->cre_pat + cre->cre_literal_off;
+	int			lit_len = cre->cre_literal_len;
+	const char *p;
+	const char *last;
+
+	if (lit_len > dat_len)
+		return false;
+
+	switch (cre->cre_literal & (RE_LITERAL_START | RE_LITERAL_END))
+	{
+		case RE_LITERAL_START | RE_LITERAL_END:
+			return lit_len == dat_len && memcmp(dat, lit, lit_len) == 0;
+		case RE_LITERAL_START:
+			return memcmp(dat, lit, lit_len) == 0;
+		case RE_LITERAL_END:
+			return memcmp(dat + dat_len - lit_len, lit, lit_len) == 0;
+	}
+
+	if (lit_len == 0)
+		return true;
+
+	/* find each occurrence of the first byte, then compare the rest */
+	p = dat;
+	last = dat + dat_len - lit_len;
+	while (p <= last)
+	{
+		p = memchr(p, (unsigned char) lit[0], last - p + 1);
+		if (p == NULL)
+			return false;
+		if (memcmp(p + 1, lit + 1, lit_len - 1) == 0)
+			return true;
+		p++;
+	}
+	return false;
 }
 
 /*
@@ -344,12 +505,16 @@ RE_compile_and_execute(text *text_re, char *dat, int dat_len,
 					   int cflags, Oid collation,
 					   int nmatch, regmatch_t *pmatch)
 {
-	regex_t    *re;
+	cached_re_str *cre;
 
 	/* Compile RE */
-	re = RE_compile_and_cache(text_re, cflags, collation);
+	cre = RE_compile_and_cache_entry(text_re, cflags, collation);
+
+	/* Plain strings needn't go through the regex engine for a yes/no answer */
+	if (cre->cre_literal && nmatch == 0)
+		return RE_literal_execute(cre, dat, dat_len);
 
-	return RE_execute(re, dat, dat_len, nmatch, pmatch);
+	return RE_execute(&cre->cre_re, dat, dat_len, nmatch, pmatch);
 }
 
 
@@ -23,11 +23,13 @@
 
 #include "postgres.h"
 
+#include "access/genam.h"
 #include "access/htup_details.h"
 #include "access/sysattr.h"
 #include "access/table.h"
 #include "access/tableam.h"
 #include "access/xact.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_operator.h"
@@ -105,6 +107,7 @@ typedef struct RI_ConstraintInfo
 	NameData	conname;		/* name of the FK constraint */
 	Oid			pk_relid;		/* referenced relation */
 	Oid			fk_relid;		/* referencing relation */
+	Oid			conindid;		/* unique index on referenced columns */
 	char		confupdtype;	/* foreign key's ON UPDATE action */
 	char		confdeltype;	/* foreign key's ON DELETE action */
 	char		confmatchtype;	/* foreign key's match type */
@@ -209,6 +212,9 @@ static const RI_ConstraintInfo *ri_FetchConstraintInfo(Trigger *trigger,
 static const RI_ConstraintInfo *ri_LoadConstraintInfo(Oid constraintOid);
 static SPIPlanPtr ri_PlanCheck(const char *querystr, int nargs, Oid *argtypes,
 							   RI_QueryKey *qkey, Relation fk_rel, Relation pk_rel);
+static bool ri_ProbeReferencedKey(const RI_ConstraintInfo *riinfo,
+								  Relation fk_rel, Relation pk_rel,
+								  TupleTableSlot *newslot, bool *found);
 static bool ri_PerformCheck(const RI_ConstraintInfo *riinfo,
 							RI_QueryKey *qkey, SPIPlanPtr qplan,
 							Relation fk_rel, Relation pk_rel,
@@ -237,6 +243,7 @@ RI_FKey_check(TriggerData *trigdata)
 	TupleTableSlot *newslot;
 	RI_QueryKey qkey;
 	SPIPlanPtr	qplan;
+	bool		found;
 
 	riinfo = ri_FetchConstraintInfo(trigdata->tg_trigger,
 									trigdata->tg_relation, false);
@@ -333,6 +340,25 @@ RI_FKey_check(TriggerData *trigdata)
 			break;
 	}
 
+	/*
+	 * In the common case, look the key up in the PK table's unique index
+	 * directly, without going through SPI and the executor.  That's much
+	 * cheaper when a bulk load fires this trigger once for each row.
+	 */
+	if (ri_ProbeReferencedKey(riinfo, fk_rel, pk_rel, newslot, &found))
+	{
+		if (!found)
+			ri_ReportViolation(riinfo,
+							   pk_rel, fk_rel,
+							   newslot,
+							   NULL,
+							   RI_PLAN_CHECK_LOOKUPPK, false);
+
+		table_close(pk_rel, RowShareLock);
+
+		return PointerGetDatum(NULL);
+	}
+
 	if (SPI_connect() != SPI_OK_CONNECT)
 		elog(ERROR, "SPI_connect failed");
 
@@ -2056,6 +2082,7 @@ ri_LoadConstraintInfo(Oid constraintOid)
 	memcpy(&riinfo->conname, &conForm->conname, sizeof(NameData));
 	riinfo->pk_relid = conForm->confrelid;
 	riinfo->fk_relid = conForm->conrelid;
+	riinfo->conindid = conForm->conindid;
 	riinfo->confupdtype = conForm->confupdtype;
 	riinfo->confdeltype = conForm->confdeltype;
 	riinfo->confmatchtype = conForm->confmatchtype;
@@ -2311,6 +2338,222 @@ ri_PerformCheck(const RI_ConstraintInfo *riinfo,
 	return SPI_processed != 0;
 }
 
+/*
+ * Look up the key of a new or updated FK row in the PK table's unique index,
+ * and lock the PK row that has it.
+ *
+ * This has the same effect as running the RI_PLAN_CHECK_LOOKUPPK query
+ *		SELECT 1 FROM ONLY <pktable> x WHERE pkatt1 = $1 [AND ...]
+ *			FOR KEY SHARE OF x
+ * through ri_PerformCheck, but avoids the overhead of SPI and executor
+ * startup, which dominates the cost of the check when a large number of FK
+ * rows is loaded.  Returns false, without doing anything, if the lookup
+ * can't be done that way: the PK table is partitioned, the operators don't
+ * belong to the index's operator families without a non-trivial cast of
+ * the FK values, or the PK table's owner lacks table-level privileges, in
+ * which case the query is left to report the error.  Otherwise, returns
+ * true and sets *found to whether a matching row exists.
+ *
+ * Caller must have checked that the FK key has no null columns.
+ */
+static bool
+ri_ProbeReferencedKey(const RI_ConstraintInfo *riinfo,
+					  Relation fk_rel, Relation pk_rel,
+					  TupleTableSlot *newslot, bool *found)
+{
+	Oid			pk_owner = RelationGetForm(pk_rel)->relowner;
+	Relation	idxrel;
+	ScanKeyData skey[RI_MAX_NUMKEYS];
+	IndexScanDesc scan;
+	TupleTableSlot *slot;
+	Snapshot	snapshot;
+	int			lockflags;
+	Oid			save_userid;
+	int			save_sec_context;
+
+	if (pk_rel->rd_rel->relkind != RELKIND_RELATION ||
+		!OidIsValid(riinfo->conindid))
+		return false;
+
+	/*
+	 * The query would be run with the PK table owner's privileges, and would
+	 * need SELECT and UPDATE (for the row lock) on the table.  Leave cases
+	 * involving column privileges, and the error, to the query.
+	 */
+	if (pg_class_aclmask(RelationGetRelid(pk_rel), pk_owner,
+						 ACL_SELECT | ACL_UPDATE, ACLMASK_ALL) !=
+		(ACL_SELECT | ACL_UPDATE))
+		return false;
+
+	idxrel = index_open(riinfo->conindid, RowShareLock);
+	if (idxrel->rd_rel->relam != BTREE_AM_OID ||
+		idxrel->rd_index->indnkeyatts != riinfo->nkeys)
+	{
+		index_close(idxrel, RowShareLock);
+		return false;
+	}
+
+	/*
+	 * Build the scan keys, which must be in index column order.  The FK
+	 * columns can be listed in any order.
+	 */
+	for (int j = 0; j < riinfo->nkeys; j++)
+	{
+		AttrNumber	pkattno = idxrel->rd_index->indkey.values[j];
+		Oid			fk_type;
+		Oid			eq_opr;
+		int			strategy;
+		Oid			lefttype;
+		Oid			righttype;
+		Datum		value;
+		bool		isnull;
+		int			i;
+
+		for (i = 0; i < riinfo->nkeys; i++)
+		{
+			if (riinfo->pk_attnums[i] == pkattno)
+				break;
+		}
+		if (i >= riinfo->nkeys)
+			elog(ERROR, "index %u does not cover the referenced columns of constraint \"%s\"",
+				 riinfo->conindid, NameStr(riinfo->conname));
+
+		/*
+		 * The query would coerce the FK value to the operator's input type.
+		 * We can do without that only if the coercion is a no-op.
+		 */
+		eq_opr = riinfo->pf_eq_oprs[i];
+		fk_type = RIAttType(fk_rel, riinfo->fk_attnums[i]);
+		if (!op_in_opfamily(eq_opr, idxrel->rd_opfamily[j]))
+		{
+			index_close(idxrel, RowShareLock);
+			return false;
+		}
+		get_op_opfamily_properties(eq_opr, idxrel->rd_opfamily[j], false,
+								   &strategy, &lefttype, &righttype);
+		if (strategy != BTEqualStrategyNumber ||
+			!IsBinaryCoercible(fk_type, righttype))
+		{
+			index_close(idxrel, RowShareLock);
+			return false;
+		}
+
+		value = slot_getattr(newslot, riinfo->fk_attnums[i], &isnull);
+		Assert(!isnull);
+
+		ScanKeyEntryInitialize(&skey[j],
+							   0,
+							   j + 1,
+							   strategy,
+							   righttype,
+							   idxrel->rd_indcollation[j],
+							   get_opcode(eq_opr),
+							   value);
+	}
+
+	/*
+	 * Like the query run through SPI, use a new snapshot that sees our own
+	 * work, and run as the PK table's owner.
+	 */
+	CommandCounterIncrement();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	snapshot = GetActiveSnapshot();
+
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(pk_owner,
+						   save_sec_context | SECURITY_LOCAL_USERID_CHANGE |
+						   SECURITY_NOFORCE_RLS);
+
+	lockflags = TUPLE_LOCK_FLAG_LOCK_UPDATE_IN_PROGRESS;
+	if (!IsolationUsesXactSnapshot())
+		lockflags |= TUPLE_LOCK_FLAG_FIND_LAST_VERSION;
+
+	slot = table_slot_create(pk_rel, NULL);
+	scan = index_beginscan(pk_rel, idxrel, snapshot, riinfo->nkeys, 0);
+	index_rescan(scan, skey, riinfo->nkeys, NULL, 0);
+
+	*found = false;
+	while (!*found && index_getnext_slot(scan, ForwardScanDirection, slot))
+	{
+		TM_FailureData tmfd;
+		TM_Result	res;
+
+		res = table_tuple_lock(pk_rel, &slot->tts_tid, snapshot,
+							   slot, GetCurrentCommandId(true),
+							   LockTupleKeyShare, LockWaitBlock,
+							   lockflags, &tmfd);
+		switch (res)
+		{
+			case TM_Ok:
+				*found = true;
+
+				/*
+				 * If the row was updated concurrently, we locked its latest
+				 * version; recheck that it still has the key.
+				 */
+				if (tmfd.traversed)
+				{
+					for (int j = 0; j < riinfo->nkeys; j++)
+					{
+						Datum		value;
+						bool		isnull;
+
+						value = slot_getattr(slot,
+											 idxrel->rd_index->indkey.values[j],
+											 &isnull);
+						if (isnull ||
+							!DatumGetBool(FunctionCall2Coll(&skey[j].sk_func,
+															skey[j].sk_collation,
+															value,
+															skey[j].sk_argument)))
+						{
+							*found = false;
+							break;
+						}
+					}
+				}
+				break;
+
+			case TM_SelfModified:
+
+				/*
+				 * Updated or deleted by a later command of our own
+				 * transaction; not a match, as in ExecLockRows.
+				 */
+				break;
+
+			case TM_Updated:
+			case TM_Deleted:
+				if (IsolationUsesXactSnapshot())
+					ereport(ERROR,
+							(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+							 errmsg("could not serialize access due to concurrent update")));
+				if (res == TM_Updated)
+					elog(ERROR, "unexpected table_tuple_lock status: %u", res);
+				/* the row was deleted, so it's not a match */
+				break;
+
+			case TM_Invisible:
+				elog(ERROR, "attempted to lock invisible tuple");
+				break;
+
+			default:
+				elog(ERROR, "unrecognized table_tuple_lock status: %u", res);
+				break;
+		}
+	}
+
+	index_endscan(scan);
+	ExecDropSingleTupleTableSlot(slot);
+
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+	PopActiveSnapshot();
+
+	index_close(idxrel, RowShareLock);
+
+	return true;
+}
+
 /*
  * Extract fields from a tuple into Datum/nulls arrays
  */
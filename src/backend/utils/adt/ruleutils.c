@@ -800,6 +800,26 @@ pg_get_viewdef_worker(Oid viewoid, int prettyFlags, int wrapColumn)
 	return buf.data;
 }
 
+/*
+ * Internal version that decompiles a query tree built or modified by the
+ * caller, such as the queries used for incremental maintenance of
+ * materialized views.  Returns a palloc'd C string.
+ */
+char *
+pg_get_querydef(Query *query, bool pretty)
+{
+	StringInfoData buf;
+	int			prettyFlags;
+
+	prettyFlags = pretty ? (PRETTYFLAG_PAREN | PRETTYFLAG_INDENT | PRETTYFLAG_SCHEMA) : PRETTYFLAG_INDENT;
+
+	initStringInfo(&buf);
+
+	get_query_def(query, &buf, NIL, NULL, prettyFlags, WRAP_COLUMN_DEFAULT, 0);
+
+	return buf.data;
+}
+
 /* ----------
  * pg_get_triggerdef		- Get the definition of a trigger
  * ----------
@@ -2122,12 +2142,28 @@ pg_get_constraintdef_worker(Oid constraintId, bool fullCommand,
 				Oid			indexId;
 				int			keyatts;
 				HeapTuple	indtup;
+				HeapTuple	classtup;
+				Oid			amoid;
+
+				indexId = get_constraint_index(constraintId);
 
 				/* Start off the constraint definition */
 				if (conForm->contype == CONSTRAINT_PRIMARY)
-					appendStringInfoString(&buf, "PRIMARY KEY (");
+					appendStringInfoString(&buf, "PRIMARY KEY ");
 				else
-					appendStringInfoString(&buf, "UNIQUE (");
+					appendStringInfoString(&buf, "UNIQUE ");
+
+				/* Name the index's access method, unless it's the default */
+				classtup = SearchSysCache1(RELOID, ObjectIdGetDatum(indexId));
+				if (!HeapTupleIsValid(classtup))
+					elog(ERROR, "cache lookup failed for relation %u", indexId);
+				amoid = ((Form_pg_class) GETSTRUCT(classtup))->relam;
+				ReleaseSysCache(classtup);
+				if (amoid != BTREE_AM_OID)
+					appendStringInfo(&buf, "USING %s ",
+									 quote_identifier(get_am_name(amoid)));
+
+				appendStringInfoChar(&buf, '(');
 
 				/* Fetch and build target column list */
 				val = SysCacheGetAttr(CONSTROID, tup,
@@ -2140,8 +2176,6 @@ pg_get_constraintdef_worker(Oid constraintId, bool fullCommand,
 
 				appendStringInfoChar(&buf, ')');
 
-				indexId = get_constraint_index(constraintId);
-
 				/* Build including column list (from pg_index.indkeys) */
 				indtup = SearchSysCache1(INDEXRELID, ObjectIdGetDatum(indexId));
 				if (!HeapTupleIsValid(indtup))
@@ -10228,6 +10262,10 @@ get_from_clause_item(Node *jtnode, Query *query, deparse_context *context)
 			case RTE_CTE:
 				appendStringInfoString(buf, quote_identifier(rte->ctename));
 				break;
+			case RTE_NAMEDTUPLESTORE:
+				/* Ephemeral named relation, such as a transition table */
+				appendStringInfoString(buf, quote_identifier(rte->enrname));
+				break;
 			default:
 				elog(ERROR, "unrecognized RTE kind: %d", (int) rte->rtekind);
 				break;
@@ -10280,6 +10318,12 @@ get_from_clause_item(Node *jtnode, Query *query, deparse_context *context)
 			if (strcmp(refname, rte->ctename) != 0)
 				printalias = true;
 		}
+		else if (rte->rtekind == RTE_NAMEDTUPLESTORE)
+		{
+			/* Likewise for an ephemeral named relation */
+			if (strcmp(refname, rte->enrname) != 0)
+				printalias = true;
+		}
 		if (printalias)
 			appendStringInfo(buf, " %s", quote_identifier(refname));
 
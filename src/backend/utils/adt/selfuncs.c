@@ -343,9 +343,9 @@ var_eq_const(VariableStatData *vardata, Oid operator, Oid collation,
 		 * don't like this, maybe you shouldn't be using eqsel for your
 		 * operator...)
 		 */
-		if (get_attstatsslot(&sslot, vardata->statsTuple,
-							 STATISTIC_KIND_MCV, InvalidOid,
-							 ATTSTATSSLOT_VALUES | ATTSTATSSLOT_NUMBERS))
+		if (get_vardata_attstatsslot(&sslot, vardata,
+									 STATISTIC_KIND_MCV, InvalidOid,
+									 ATTSTATSSLOT_VALUES | ATTSTATSSLOT_NUMBERS))
 		{
 			LOCAL_FCINFO(fcinfo, 2);
 			FmgrInfo	eqproc;
@@ -514,9 +514,9 @@ var_eq_non_const(VariableStatData *vardata, Oid operator, Oid collation,
 		 * Cross-check: selectivity should never be estimated as more than the
 		 * most common value's.
 		 */
-		if (get_attstatsslot(&sslot, vardata->statsTuple,
-							 STATISTIC_KIND_MCV, InvalidOid,
-							 ATTSTATSSLOT_NUMBERS))
+		if (get_vardata_attstatsslot(&sslot, vardata,
+									 STATISTIC_KIND_MCV, InvalidOid,
+									 ATTSTATSSLOT_NUMBERS))
 		{
 			if (sslot.nnumbers > 0 && selec > sslot.numbers[0])
 				selec = sslot.numbers[0];
@@ -740,9 +740,9 @@ mcv_selectivity(VariableStatData *vardata, FmgrInfo *opproc, Oid collation,
 
 	if (HeapTupleIsValid(vardata->statsTuple) &&
 		statistic_proc_security_check(vardata, opproc->fn_oid) &&
-		get_attstatsslot(&sslot, vardata->statsTuple,
-						 STATISTIC_KIND_MCV, InvalidOid,
-						 ATTSTATSSLOT_VALUES | ATTSTATSSLOT_NUMBERS))
+		get_vardata_attstatsslot(&sslot, vardata,
+								 STATISTIC_KIND_MCV, InvalidOid,
+								 ATTSTATSSLOT_VALUES | ATTSTATSSLOT_NUMBERS))
 	{
 		LOCAL_FCINFO(fcinfo, 2);
 
@@ -832,9 +832,9 @@ histogram_selectivity(VariableStatData *vardata,
 
 	if (HeapTupleIsValid(vardata->statsTuple) &&
 		statistic_proc_security_check(vardata, opproc->fn_oid) &&
-		get_attstatsslot(&sslot, vardata->statsTuple,
-						 STATISTIC_KIND_HISTOGRAM, InvalidOid,
-						 ATTSTATSSLOT_VALUES))
+		get_vardata_attstatsslot(&sslot, vardata,
+								 STATISTIC_KIND_HISTOGRAM, InvalidOid,
+								 ATTSTATSSLOT_VALUES))
 	{
 		*hist_size = sslot.nvalues;
 		if (sslot.nvalues >= min_hist_size)
@@ -1060,9 +1060,9 @@ ineq_histogram_selectivity(PlannerInfo *root,
 	 */
 	if (HeapTupleIsValid(vardata->statsTuple) &&
 		statistic_proc_security_check(vardata, opproc->fn_oid) &&
-		get_attstatsslot(&sslot, vardata->statsTuple,
-						 STATISTIC_KIND_HISTOGRAM, InvalidOid,
-						 ATTSTATSSLOT_VALUES))
+		get_vardata_attstatsslot(&sslot, vardata,
+								 STATISTIC_KIND_HISTOGRAM, InvalidOid,
+								 ATTSTATSSLOT_VALUES))
 	{
 		if (sslot.nvalues > 1 &&
 			sslot.stacoll == collation &&
@@ -1198,9 +1198,9 @@ ineq_histogram_selectivity(PlannerInfo *root,
 															 &isdefault);
 
 					/* Subtract off the number of known MCVs */
-					if (get_attstatsslot(&mcvslot, vardata->statsTuple,
-										 STATISTIC_KIND_MCV, InvalidOid,
-										 ATTSTATSSLOT_NUMBERS))
+					if (get_vardata_attstatsslot(&mcvslot, vardata,
+												 STATISTIC_KIND_MCV, InvalidOid,
+												 ATTSTATSSLOT_NUMBERS))
 					{
 						otherdistinct -= mcvslot.nnumbers;
 						free_attstatsslot(&mcvslot);
@@ -1551,9 +1551,9 @@ booltestsel(PlannerInfo *root, BoolTestType booltesttype, Node *arg,
 		stats = (Form_pg_statistic) GETSTRUCT(vardata.statsTuple);
 		freq_null = stats->stanullfrac;
 
-		if (get_attstatsslot(&sslot, vardata.statsTuple,
-							 STATISTIC_KIND_MCV, InvalidOid,
-							 ATTSTATSSLOT_VALUES | ATTSTATSSLOT_NUMBERS)
+		if (get_vardata_attstatsslot(&sslot, &vardata,
+									 STATISTIC_KIND_MCV, InvalidOid,
+									 ATTSTATSSLOT_VALUES | ATTSTATSSLOT_NUMBERS)
 			&& sslot.nnumbers > 0)
 		{
 			double		freq_true;
@@ -2279,9 +2279,9 @@ eqjoinsel(PG_FUNCTION_ARGS)
 		/* note we allow use of nullfrac regardless of security check */
 		stats1 = (Form_pg_statistic) GETSTRUCT(vardata1.statsTuple);
 		if (statistic_proc_security_check(&vardata1, opfuncoid))
-			have_mcvs1 = get_attstatsslot(&sslot1, vardata1.statsTuple,
-										  STATISTIC_KIND_MCV, InvalidOid,
-										  ATTSTATSSLOT_VALUES | ATTSTATSSLOT_NUMBERS);
+			have_mcvs1 = get_vardata_attstatsslot(&sslot1, &vardata1,
+												  STATISTIC_KIND_MCV, InvalidOid,
+												  ATTSTATSSLOT_VALUES | ATTSTATSSLOT_NUMBERS);
 	}
 
 	if (HeapTupleIsValid(vardata2.statsTuple))
@@ -2289,9 +2289,9 @@ eqjoinsel(PG_FUNCTION_ARGS)
 		/* note we allow use of nullfrac regardless of security check */
 		stats2 = (Form_pg_statistic) GETSTRUCT(vardata2.statsTuple);
 		if (statistic_proc_security_check(&vardata2, opfuncoid))
-			have_mcvs2 = get_attstatsslot(&sslot2, vardata2.statsTuple,
-										  STATISTIC_KIND_MCV, InvalidOid,
-										  ATTSTATSSLOT_VALUES | ATTSTATSSLOT_NUMBERS);
+			have_mcvs2 = get_vardata_attstatsslot(&sslot2, &vardata2,
+												  STATISTIC_KIND_MCV, InvalidOid,
+												  ATTSTATSSLOT_VALUES | ATTSTATSSLOT_NUMBERS);
 	}
 
 	/* We need to compute the inner-join selectivity in all cases */
@@ -3241,6 +3241,7 @@ typedef struct
 	Node	   *var;			/* might be an expression, not just a Var */
 	RelOptInfo *rel;			/* relation it belongs to */
 	double		ndistinct;		/* # distinct values */
+	bool		isdefault;		/* true if DEFAULT_NUM_DISTINCT was used */
 } GroupVarInfo;
 
 static List *
@@ -3287,6 +3288,7 @@ add_unique_group_var(PlannerInfo *root, List *varinfos,
 	varinfo->var = var;
 	varinfo->rel = vardata->rel;
 	varinfo->ndistinct = ndistinct;
+	varinfo->isdefault = isdefault;
 	varinfos = lappend(varinfos, varinfo);
 	return varinfos;
 }
@@ -3311,6 +3313,12 @@ add_unique_group_var(PlannerInfo *root, List *varinfos,
  *	pgset - NULL, or a List** pointing to a grouping set to filter the
  *		groupExprs against
  *
+ * Outputs:
+ *	estinfo - When passed as non-NULL, the function will set bits in the
+ *		"flags" field in order to provide callers with additional information
+ *		about the estimation.  Currently, we only set the SELFLAG_USED_DEFAULT
+ *		bit if we used any default values in the estimation.
+ *
  * Given the lack of any cross-correlation statistics in the system, it's
  * impossible to do anything really trustworthy with GROUP BY conditions
  * involving multiple Vars.  We should however avoid assuming the worst
@@ -3358,7 +3366,7 @@ add_unique_group_var(PlannerInfo *root, List *varinfos,
  */
 double
 estimate_num_groups(PlannerInfo *root, List *groupExprs, double input_rows,
-					List **pgset)
+					List **pgset, EstimationInfo *estinfo)
 {
 	List	   *varinfos = NIL;
 	double		srf_multiplier = 1.0;
@@ -3366,6 +3374,10 @@ estimate_num_groups(PlannerInfo *root, List *groupExprs, double input_rows,
 	ListCell   *l;
 	int			i;
 
+	/* Zero the estinfo output parameter, if non-NULL */
+	if (estinfo != NULL)
+		memset(estinfo, 0, sizeof(EstimationInfo));
+
 	/*
 	 * We don't ever want to return an estimate of zero groups, as that tends
 	 * to lead to division-by-zero and other unpleasantness.  The input_rows
@@ -3569,6 +3581,13 @@ estimate_num_groups(PlannerInfo *root, List *groupExprs, double input_rows,
 					if (relmaxndistinct < varinfo2->ndistinct)
 						relmaxndistinct = varinfo2->ndistinct;
 					relvarcount++;
+
+					/*
+					 * When varinfo2's isdefault is set then we'd better set
+					 * the SELFLAG_USED_DEFAULT bit in the EstimationInfo.
+					 */
+					if (estinfo != NULL && varinfo2->isdefault)
+						estinfo->flags |= SELFLAG_USED_DEFAULT;
 				}
 
 				/* we're done with this relation */
@@ -3739,9 +3758,9 @@ estimate_hash_bucket_stats(PlannerInfo *root, Node *hashkey, double nbuckets,
 
 	if (HeapTupleIsValid(vardata.statsTuple))
 	{
-		if (get_attstatsslot(&sslot, vardata.statsTuple,
-							 STATISTIC_KIND_MCV, InvalidOid,
-							 ATTSTATSSLOT_NUMBERS))
+		if (get_vardata_attstatsslot(&sslot, &vardata,
+									 STATISTIC_KIND_MCV, InvalidOid,
+									 ATTSTATSSLOT_NUMBERS))
 		{
 			/*
 			 * The first MCV stat is for the most common value.
@@ -4734,6 +4753,8 @@ examine_variable(PlannerInfo *root, Node *node, int varRelid,
 	/* Make sure we don't return dangling pointers in vardata */
 	MemSet(vardata, 0, sizeof(VariableStatData));
 
+	vardata->root = root;
+
 	/* Save the exposed type of the expression */
 	vardata->vartype = exprType(node);
 
@@ -5237,6 +5258,117 @@ examine_simple_variable(PlannerInfo *root, Var *var,
 	}
 }
 
+/*
+ * get_vardata_attstatsslot
+ *		get_attstatsslot() for the statistics tuple of a VariableStatData
+ *
+ * Clauses on the same column, and join clauses considered for many join
+ * paths, would each detoast and deconstruct the same pg_statistic arrays
+ * again.  So we keep the slots looked up while planning a query in a hash
+ * table attached to its topmost PlannerInfo, keyed by the column and the
+ * get_attstatsslot() arguments, and hand out copies of them.  The arrays
+ * live as long as the PlannerInfo; the copies only own their values[], so
+ * callers release them with free_attstatsslot() as usual.
+ */
+bool
+get_vardata_attstatsslot(AttStatsSlot *sslot, VariableStatData *vardata,
+						 int reqkind, Oid reqop, int flags)
+{
+	typedef struct
+	{
+		Oid			starelid;
+		Oid			reqop;
+		int			reqkind;
+		int			flags;
+		int16		staattnum;
+		bool		stainherit;
+	} StatsSlotCacheKey;
+	typedef struct
+	{
+		StatsSlotCacheKey key;	/* hash key --- must be first */
+		bool		found;
+		AttStatsSlot sslot;
+	} StatsSlotCacheEntry;
+
+	PlannerInfo *root = vardata->root;
+	Form_pg_statistic stats;
+	StatsSlotCacheKey key;
+	StatsSlotCacheEntry *entry;
+	bool		found;
+
+	if (root == NULL || !HeapTupleIsValid(vardata->statsTuple))
+		return get_attstatsslot(sslot, vardata->statsTuple,
+								reqkind, reqop, flags);
+
+	while (root->parent_root != NULL)
+		root = root->parent_root;
+
+	if (root->stats_slot_cache == NULL)
+	{
+		HASHCTL		ctl;
+
+		/* GEQO plans in short-lived contexts, so don't use the current one */
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(StatsSlotCacheKey);
+		ctl.entrysize = sizeof(StatsSlotCacheEntry);
+		ctl.hcxt = GetMemoryChunkContext(root);
+		root->stats_slot_cache = hash_create("planner statistics slots", 64,
+											 &ctl,
+											 HASH_ELEM | HASH_BLOBS |
+											 HASH_CONTEXT);
+	}
+
+	stats = (Form_pg_statistic) GETSTRUCT(vardata->statsTuple);
+	MemSet(&key, 0, sizeof(key));
+	key.starelid = stats->starelid;
+	key.reqop = reqop;
+	key.reqkind = reqkind;
+	key.flags = flags;
+	key.staattnum = stats->staattnum;
+	key.stainherit = stats->stainherit;
+
+	entry = (StatsSlotCacheEntry *) hash_search(root->stats_slot_cache, &key,
+												HASH_ENTER, &found);
+	if (!found)
+	{
+		MemoryContext oldcxt;
+
+		/* Don't leave a half-made entry behind if we fail */
+		PG_TRY();
+		{
+			oldcxt = MemoryContextSwitchTo(GetMemoryChunkContext(root));
+			entry->found = get_attstatsslot(&entry->sslot,
+											vardata->statsTuple,
+											reqkind, reqop, flags);
+			MemoryContextSwitchTo(oldcxt);
+		}
+		PG_CATCH();
+		{
+			hash_search(root->stats_slot_cache, &key, HASH_REMOVE, NULL);
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+	}
+
+	if (!entry->found)
+	{
+		memset(sslot, 0, sizeof(AttStatsSlot));
+		return false;
+	}
+
+	*sslot = entry->sslot;
+	sslot->values_arr = NULL;
+	sslot->numbers_arr = NULL;
+	if (entry->sslot.values != NULL)
+	{
+		sslot->values = (Datum *) palloc(entry->sslot.nvalues * sizeof(Datum));
+		memcpy(sslot->values, entry->sslot.values,
+			   entry->sslot.nvalues * sizeof(Datum));
+	}
+
+	return true;
+}
+
 /*
  * Check whether it is permitted to call func_oid passing some of the
  * pg_statistic data in vardata.  We allow this either if the user has SELECT
@@ -5456,9 +5588,9 @@ get_variable_range(PlannerInfo *root, VariableStatData *vardata,
 	 * If there is a histogram with the ordering we want, grab the first and
 	 * last values.
 	 */
-	if (get_attstatsslot(&sslot, vardata->statsTuple,
-						 STATISTIC_KIND_HISTOGRAM, sortop,
-						 ATTSTATSSLOT_VALUES))
+	if (get_vardata_attstatsslot(&sslot, vardata,
+								 STATISTIC_KIND_HISTOGRAM, sortop,
+								 ATTSTATSSLOT_VALUES))
 	{
 		if (sslot.stacoll == collation && sslot.nvalues > 0)
 		{
@@ -5476,9 +5608,9 @@ get_variable_range(PlannerInfo *root, VariableStatData *vardata,
 	 * ordering, but it beats ignoring available data.
 	 */
 	if (!have_data &&
-		get_attstatsslot(&sslot, vardata->statsTuple,
-						 STATISTIC_KIND_HISTOGRAM, InvalidOid,
-						 ATTSTATSSLOT_VALUES))
+		get_vardata_attstatsslot(&sslot, vardata,
+								 STATISTIC_KIND_HISTOGRAM, InvalidOid,
+								 ATTSTATSSLOT_VALUES))
 	{
 		get_stats_slot_range(&sslot, opfuncoid, &opproc,
 							 collation, typLen, typByVal,
@@ -5491,9 +5623,9 @@ get_variable_range(PlannerInfo *root, VariableStatData *vardata,
 	 * needed even if we also have a histogram, since the histogram excludes
 	 * the MCVs.
 	 */
-	if (get_attstatsslot(&sslot, vardata->statsTuple,
-						 STATISTIC_KIND_MCV, InvalidOid,
-						 ATTSTATSSLOT_VALUES))
+	if (get_vardata_attstatsslot(&sslot, vardata,
+								 STATISTIC_KIND_MCV, InvalidOid,
+								 ATTSTATSSLOT_VALUES))
 	{
 		get_stats_slot_range(&sslot, opfuncoid, &opproc,
 							 collation, typLen, typByVal,
@@ -6235,6 +6367,47 @@ add_predicate_to_index_quals(IndexOptInfo *index, List *indexQuals)
 }
 
 
+/*
+ * Can the index AM do this btree index path as a skip scan?  This must match
+ * the conditions checked by _bt_preprocess_skip_key(): no quals on the first
+ * index column, some qual other than IS NOT NULL on the second one, and no
+ * ScalarArrayOpExpr or RowCompareExpr quals.
+ */
+static bool
+btree_skip_scan_possible(IndexPath *path)
+{
+	bool		found = false;
+	ListCell   *lc;
+
+	if (path->indexinfo->nkeycolumns < 2)
+		return false;
+
+	foreach(lc, path->indexclauses)
+	{
+		IndexClause *iclause = lfirst_node(IndexClause, lc);
+		ListCell   *lc2;
+
+		if (iclause->indexcol == 0)
+			return false;
+
+		foreach(lc2, iclause->indexquals)
+		{
+			RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc2);
+			Expr	   *clause = rinfo->clause;
+
+			if (IsA(clause, ScalarArrayOpExpr) ||
+				IsA(clause, RowCompareExpr))
+				return false;
+			if (iclause->indexcol == 1 &&
+				!(IsA(clause, NullTest) &&
+				  ((NullTest *) clause)->nulltesttype == IS_NOT_NULL))
+				found = true;
+		}
+	}
+
+	return found;
+}
+
 void
 btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 			   Cost *indexStartupCost, Cost *indexTotalCost,
@@ -6254,6 +6427,7 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	bool		found_saop;
 	bool		found_is_null_op;
 	double		num_sa_scans;
+	bool		skip_scan;
 	ListCell   *lc;
 
 	/*
@@ -6272,9 +6446,16 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * If there's a ScalarArrayOpExpr in the quals, we'll actually perform N
 	 * index scans not one, but the ScalarArrayOpExpr's operator can be
 	 * considered to act the same as it normally does.
+	 *
+	 * If there are no quals on the first column, the scan can be done as a
+	 * skip scan, with one primitive index scan per distinct value of the
+	 * first column.  Each of those acts as if there were an '=' qual on the
+	 * first column, so we collect boundary quals from the second column on.
+	 * A plain full-index scan is costed separately below.
 	 */
+	skip_scan = btree_skip_scan_possible(path);
 	indexBoundQuals = NIL;
-	indexcol = 0;
+	indexcol = skip_scan ? 1 : 0;
 	eqQualHere = false;
 	found_saop = false;
 	found_is_null_op = false;
@@ -6360,13 +6541,15 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * If index is unique and we found an '=' clause for each column, we can
 	 * just assume numIndexTuples = 1 and skip the expensive
 	 * clauselist_selectivity calculations.  However, a ScalarArrayOp or
-	 * NullTest invalidates that theory, even though it sets eqQualHere.
+	 * NullTest invalidates that theory, even though it sets eqQualHere, and
+	 * so does a skip scan.
 	 */
 	if (index->unique &&
 		indexcol == index->nkeycolumns - 1 &&
 		eqQualHere &&
 		!found_saop &&
-		!found_is_null_op)
+		!found_is_null_op &&
+		!skip_scan)
 		numIndexTuples = 1.0;
 	else
 	{
@@ -6434,6 +6617,61 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	costs.indexStartupCost += descentCost;
 	costs.indexTotalCost += costs.num_sa_scans * descentCost;
 
+	/*
+	 * For a skip scan, the above covers the tuples within the boundary quals
+	 * and the first descent.  Each distinct value of the first column costs
+	 * two more descents (one to find the value, one to start its primitive
+	 * scan) and at least one leaf page.  If the first column has so many
+	 * distinct values that reading the whole index is cheaper, the index AM
+	 * gives up skipping, so charge for a full-index scan in that case.
+	 */
+	if (skip_scan)
+	{
+		GenericCosts fullcosts;
+		Expr	   *firstcol;
+		double		ndistinct;
+		double		spc_random_page_cost;
+
+		firstcol = ((TargetEntry *) linitial(index->indextlist))->expr;
+		ndistinct = estimate_num_groups(root, list_make1(firstcol),
+										index->rel->tuples, NULL, NULL);
+
+		descentCost = (index->tree_height + 1) * 50.0 * cpu_operator_cost;
+		if (index->tuples > 1)
+			descentCost += ceil(log(index->tuples) / log(2.0)) *
+				cpu_operator_cost;
+
+		get_tablespace_page_costs(index->reltablespace,
+								  &spc_random_page_cost,
+								  NULL);
+
+		costs.indexTotalCost += ndistinct * 2 * descentCost;
+		if (ndistinct > costs.numIndexPages)
+		{
+			costs.indexTotalCost += (ndistinct - costs.numIndexPages) *
+				spc_random_page_cost;
+			costs.numIndexPages = ndistinct;
+		}
+
+		MemSet(&fullcosts, 0, sizeof(fullcosts));
+		fullcosts.numIndexTuples =
+			clauselist_selectivity(root,
+								   add_predicate_to_index_quals(index, NIL),
+								   index->rel->relid,
+								   JOIN_INNER,
+								   NULL) * index->rel->tuples;
+		genericcostestimate(root, path, loop_count, &fullcosts);
+		fullcosts.indexStartupCost += descentCost;
+		fullcosts.indexTotalCost += descentCost;
+
+		if (fullcosts.indexTotalCost < costs.indexTotalCost)
+		{
+			costs.indexStartupCost = fullcosts.indexStartupCost;
+			costs.indexTotalCost = fullcosts.indexTotalCost;
+			costs.numIndexPages = fullcosts.numIndexPages;
+		}
+	}
+
 	/*
 	 * If we can get an estimate of the first column's ordering correlation C
 	 * from pg_statistic, estimate the index correlation as C for a
@@ -6443,6 +6681,7 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * correlation by the number of columns, but that seems too strong.)
 	 */
 	MemSet(&vardata, 0, sizeof(vardata));
+	vardata.root = root;
 
 	if (index->indexkeys[0] != 0)
 	{
@@ -6511,9 +6750,9 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 									 index->opcintype[0],
 									 BTLessStrategyNumber);
 		if (OidIsValid(sortop) &&
-			get_attstatsslot(&sslot, vardata.statsTuple,
-							 STATISTIC_KIND_CORRELATION, sortop,
-							 ATTSTATSSLOT_NUMBERS))
+			get_vardata_attstatsslot(&sslot, &vardata,
+									 STATISTIC_KIND_CORRELATION, sortop,
+									 ATTSTATSSLOT_NUMBERS))
 		{
 			double		varCorrelation;
 
@@ -7462,13 +7701,15 @@ brincostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 			}
 		}
 
+		vardata.root = root;
+
 		if (HeapTupleIsValid(vardata.statsTuple))
 		{
 			AttStatsSlot sslot;
 
-			if (get_attstatsslot(&sslot, vardata.statsTuple,
-								 STATISTIC_KIND_CORRELATION, InvalidOid,
-								 ATTSTATSSLOT_NUMBERS))
+			if (get_vardata_attstatsslot(&sslot, &vardata,
+										 STATISTIC_KIND_CORRELATION, InvalidOid,
+										 ATTSTATSSLOT_NUMBERS))
 			{
 				double		varCorrelation = 0.0;
 
@@ -34,8 +34,21 @@ static const float weights[] = {0.1f, 0.2f, 0.4f, 1.0f};
 #define RANK_NORM_RDIVRPLUS1	0x20
 #define DEF_NORM_METHOD			RANK_NO_NORM
 
-static float calc_rank_or(const float *w, TSVector t, TSQuery q);
-static float calc_rank_and(const float *w, TSVector t, TSQuery q);
+/*
+ * The sorted, de-duplicated operands of the query that calc_rank works with.
+ * The query is nearly always the same for all the rows ranked by one call
+ * site, so we keep them in fn_extra along with a copy of the query they were
+ * made from, instead of collecting and sorting them again for every row.
+ */
+typedef struct RankQuery
+{
+	TSQuery		query;			/* the query; items point into it */
+	QueryOperand **items;		/* distinct operands, sorted */
+	int			nitems;			/* number of entries in items */
+} RankQuery;
+
+static float calc_rank_or(const float *w, TSVector t, RankQuery *rq);
+static float calc_rank_and(const float *w, TSVector t, RankQuery *rq);
 
 /*
  * Returns a weight of a word collocation
@@ -196,8 +209,55 @@ SortAndUniqItems(TSQuery q, int *size)
 	return res;
 }
 
+/*
+ * Returns the RankQuery for 'query', reusing the one cached in fn_extra if
+ * it was made from an identical query.
+ */
+static RankQuery *
+get_rank_query(FunctionCallInfo fcinfo, TSQuery query)
+{
+	RankQuery  *rq;
+	MemoryContext oldcontext;
+
+	if (fcinfo->flinfo == NULL)
+	{
+		/* called directly, so there is nowhere to keep it */
+		rq = (RankQuery *) palloc(sizeof(RankQuery));
+		rq->query = query;
+		rq->nitems = query->size;
+		rq->items = SortAndUniqItems(query, &rq->nitems);
+		return rq;
+	}
+
+	rq = (RankQuery *) fcinfo->flinfo->fn_extra;
+	if (rq != NULL &&
+		VARSIZE(rq->query) == VARSIZE(query) &&
+		memcmp(rq->query, query, VARSIZE(query)) == 0)
+		return rq;
+
+	if (rq != NULL)
+	{
+		pfree(rq->items);
+		pfree(rq->query);
+	}
+	else
+		rq = (RankQuery *) MemoryContextAlloc(fcinfo->flinfo->fn_mcxt,
+											  sizeof(RankQuery));
+
+	oldcontext = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+	rq->query = (TSQuery) palloc(VARSIZE(query));
+	memcpy(rq->query, query, VARSIZE(query));
+	rq->nitems = query->size;
+	rq->items = SortAndUniqItems(rq->query, &rq->nitems);
+	MemoryContextSwitchTo(oldcontext);
+
+	fcinfo->flinfo->fn_extra = rq;
+
+	return rq;
+}
+
 static float
-calc_rank_and(const float *w, TSVector t, TSQuery q)
+calc_rank_and(const float *w, TSVector t, RankQuery *rq)
 {
 	WordEntryPosVector **pos;
 	WordEntryPosVector1 posnull;
@@ -215,16 +275,13 @@ calc_rank_and(const float *w, TSVector t, TSQuery q)
 				dist,
 				nitem;
 	float		res = -1.0;
-	QueryOperand **item;
-	int			size = q->size;
+	TSQuery		q = rq->query;
+	QueryOperand **item = rq->items;
+	int			size = rq->nitems;
 
-	item = SortAndUniqItems(q, &size);
 	if (size < 2)
-	{
-		pfree(item);
-		return calc_rank_or(w, t, q);
-	}
-	pos = (WordEntryPosVector **) palloc0(sizeof(WordEntryPosVector *) * q->size);
+		return calc_rank_or(w, t, rq);
+	pos = (WordEntryPosVector **) palloc0(sizeof(WordEntryPosVector *) * size);
 
 	/* A dummy WordEntryPos array to use when haspos is false */
 	posnull.npos = 1;
@@ -275,12 +332,11 @@ calc_rank_and(const float *w, TSVector t, TSQuery q)
 		}
 	}
 	pfree(pos);
-	pfree(item);
 	return res;
 }
 
 static float
-calc_rank_or(const float *w, TSVector t, TSQuery q)
+calc_rank_or(const float *w, TSVector t, RankQuery *rq)
 {
 	WordEntry  *entry,
 			   *firstentry;
@@ -291,15 +347,14 @@ calc_rank_or(const float *w, TSVector t, TSQuery q)
 				i,
 				nitem;
 	float		res = 0.0;
-	QueryOperand **item;
-	int			size = q->size;
+	TSQuery		q = rq->query;
+	QueryOperand **item = rq->items;
+	int			size = rq->nitems;
 
 	/* A dummy WordEntryPos array to use when haspos is false */
 	posnull.npos = 1;
 	posnull.pos[0] = 0;
 
-	item = SortAndUniqItems(q, &size);
-
 	for (i = 0; i < size; i++)
 	{
 		float		resj,
@@ -349,13 +404,13 @@ calc_rank_or(const float *w, TSVector t, TSQuery q)
 	}
 	if (size > 0)
 		res = res / size;
-	pfree(item);
 	return res;
 }
 
 static float
-calc_rank(const float *w, TSVector t, TSQuery q, int32 method)
+calc_rank(const float *w, TSVector t, RankQuery *rq, int32 method)
 {
+	TSQuery		q = rq->query;
 	QueryItem  *item = GETQUERY(q);
 	float		res = 0.0;
 	int			len;
@@ -366,8 +421,8 @@ calc_rank(const float *w, TSVector t, TSQuery q, int32 method)
 	/* XXX: What about NOT? */
 	res = (item->type == QI_OPR && (item->qoperator.oper == OP_AND ||
 									item->qoperator.oper == OP_PHRASE)) ?
-		calc_rank_and(w, t, q) :
-		calc_rank_or(w, t, q);
+		calc_rank_and(w, t, rq) :
+		calc_rank_or(w, t, rq);
 
 	if (res < 0)
 		res = 1e-20f;
@@ -443,7 +498,8 @@ ts_rank_wttf(PG_FUNCTION_ARGS)
 	int			method = PG_GETARG_INT32(3);
 	float		res;
 
-	res = calc_rank(getWeights(win), txt, query, method);
+	res = calc_rank(getWeights(win), txt, get_rank_query(fcinfo, query),
+					method);
 
 	PG_FREE_IF_COPY(win, 0);
 	PG_FREE_IF_COPY(txt, 1);
@@ -459,7 +515,8 @@ ts_rank_wtt(PG_FUNCTION_ARGS)
 	TSQuery		query = PG_GETARG_TSQUERY(2);
 	float		res;
 
-	res = calc_rank(getWeights(win), txt, query, DEF_NORM_METHOD);
+	res = calc_rank(getWeights(win), txt, get_rank_query(fcinfo, query),
+					DEF_NORM_METHOD);
 
 	PG_FREE_IF_COPY(win, 0);
 	PG_FREE_IF_COPY(txt, 1);
@@ -475,7 +532,8 @@ ts_rank_ttf(PG_FUNCTION_ARGS)
 	int			method = PG_GETARG_INT32(2);
 	float		res;
 
-	res = calc_rank(getWeights(NULL), txt, query, method);
+	res = calc_rank(getWeights(NULL), txt, get_rank_query(fcinfo, query),
+					method);
 
 	PG_FREE_IF_COPY(txt, 0);
 	PG_FREE_IF_COPY(query, 1);
@@ -489,7 +547,8 @@ ts_rank_tt(PG_FUNCTION_ARGS)
 	TSQuery		query = PG_GETARG_TSQUERY(1);
 	float		res;
 
-	res = calc_rank(getWeights(NULL), txt, query, DEF_NORM_METHOD);
+	res = calc_rank(getWeights(NULL), txt, get_rank_query(fcinfo, query),
+					DEF_NORM_METHOD);
 
 	PG_FREE_IF_COPY(txt, 0);
 	PG_FREE_IF_COPY(query, 1);
@@ -37,6 +37,8 @@
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
+#include "utils/sharedcatcache.h"
+#include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
 
@@ -63,6 +65,9 @@
 /* Cache management header --- pointer is NULL until created */
 static CatCacheHeader *CacheHdr = NULL;
 
+/* GUC variable */
+int			max_catcache_memory = 0;
+
 static inline HeapTuple SearchCatCacheInternal(CatCache *cache,
 											   int nkeys,
 											   Datum v1, Datum v2,
@@ -88,6 +93,9 @@ static void CatCachePrintStats(int code, Datum arg);
 #endif
 static void CatCacheRemoveCTup(CatCache *cache, CatCTup *ct);
 static void CatCacheRemoveCList(CatCache *cache, CatCList *cl);
+static inline void CatCacheTouchTuple(CatCTup *ct);
+static inline void CatCacheTouchList(CatCList *cl);
+static void CatCacheEvict(CatCTup *keep);
 static void CatalogCacheInitializeCache(CatCache *cache);
 static CatCTup *CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 										Datum *arguments,
@@ -98,6 +106,10 @@ static void CatCacheFreeKeys(TupleDesc tupdesc, int nkeys, int *attnos,
 							 Datum *keys);
 static void CatCacheCopyKeys(TupleDesc tupdesc, int nkeys, int *attnos,
 							 Datum *srckeys, Datum *dstkeys);
+static Size CatCacheKeysSize(TupleDesc tupdesc, int nkeys, int *attnos,
+							 Datum *keys);
+static Size CatCTupSize(CatCache *cache, CatCTup *ct);
+static Size CatCListSize(CatCache *cache, CatCList *cl);
 
 
 /*
@@ -386,6 +398,31 @@ CatalogCacheCompareTuple(const CatCache *cache, int nkeys,
 	return true;
 }
 
+/*
+ *		CatalogCacheTupleMatches
+ *
+ * Does a tuple fetched from the shared catalog cache match the passed
+ * arguments?  Its hash value does, but that's all we know.
+ */
+static bool
+CatalogCacheTupleMatches(CatCache *cache, int nkeys, HeapTuple tuple,
+						 const Datum *arguments)
+{
+	Datum		keys[CATCACHE_MAXKEYS];
+	int			i;
+
+	for (i = 0; i < nkeys; i++)
+	{
+		bool		isnull;
+
+		keys[i] = heap_getattr(tuple, cache->cc_keyno[i], cache->cc_tupdesc,
+							   &isnull);
+		Assert(!isnull);
+	}
+
+	return CatalogCacheCompareTuple(cache, nkeys, keys, arguments);
+}
+
 
 #ifdef CATCACHE_STATS
 
@@ -471,8 +508,10 @@ CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 		return;					/* nothing left to do */
 	}
 
-	/* delink from linked list */
+	/* delink from linked lists */
 	dlist_delete(&ct->cache_elem);
+	dlist_delete(&ct->lru_elem);
+	CacheHdr->ch_nbytes -= CatCTupSize(cache, ct);
 
 	/*
 	 * Free keys when we're dealing with a negative entry, normal entries just
@@ -510,6 +549,9 @@ CatCacheRemoveCList(CatCache *cache, CatCList *cl)
 
 		Assert(ct->c_list == cl);
 		ct->c_list = NULL;
+		/* it's on its own again, as far as eviction is concerned */
+		ct->lastaccess = cl->lastaccess;
+		dlist_push_head(&CacheHdr->ch_lru, &ct->lru_elem);
 		/* if the member is dead and now has no references, remove it */
 		if (
 #ifndef CATCACHE_FORCE_RELEASE
@@ -519,8 +561,10 @@ CatCacheRemoveCList(CatCache *cache, CatCList *cl)
 			CatCacheRemoveCTup(cache, ct);
 	}
 
-	/* delink from linked list */
+	/* delink from linked lists */
 	dlist_delete(&cl->cache_elem);
+	dlist_delete(&cl->lru_elem);
+	CacheHdr->ch_nbytes -= CatCListSize(cache, cl);
 
 	/* free associated column data */
 	CatCacheFreeKeys(cache->cc_tupdesc, cl->nkeys,
@@ -529,6 +573,93 @@ CatCacheRemoveCList(CatCache *cache, CatCList *cl)
 	pfree(cl);
 }
 
+/*
+ *		CatCacheTouchTuple
+ *		CatCacheTouchList
+ *
+ * Note that a tuple or list was just used, making it the last candidate for
+ * eviction.  A tuple belonging to a list is evicted with the list, so we
+ * touch the list instead.
+ */
+static inline void
+CatCacheTouchTuple(CatCTup *ct)
+{
+	if (ct->c_list != NULL)
+		CatCacheTouchList(ct->c_list);
+	else
+	{
+		ct->lastaccess = ++CacheHdr->ch_clock;
+		dlist_move_head(&CacheHdr->ch_lru, &ct->lru_elem);
+	}
+}
+
+static inline void
+CatCacheTouchList(CatCList *cl)
+{
+	cl->lastaccess = ++CacheHdr->ch_clock;
+	dlist_move_head(&CacheHdr->ch_lru_lists, &cl->lru_elem);
+}
+
+/*
+ *		CatCacheEvict
+ *
+ * Remove the least recently used tuples and lists until the caches use no
+ * more than max_catcache_memory again, or there's nothing left to remove.
+ * Entries that are in use can't be removed, nor can "keep", the tuple the
+ * caller has just created and not yet taken a reference to.
+ *
+ * We walk the tuple and list LRU lists from their tails in step, always
+ * taking the older of their current entries.  Removing an entry doesn't
+ * remove any other entry from either list: tuples in the tuple list don't
+ * belong to lists, and the members of a removed list that survive are put
+ * at the head of the tuple list.
+ */
+static void
+CatCacheEvict(CatCTup *keep)
+{
+	Size		limit = (Size) max_catcache_memory * 1024;
+	dlist_node *tcur = CacheHdr->ch_lru.head.prev;
+	dlist_node *lcur = CacheHdr->ch_lru_lists.head.prev;
+
+	while (CacheHdr->ch_nbytes > limit)
+	{
+		CatCTup    *ct = NULL;
+		CatCList   *cl = NULL;
+
+		if (tcur != &CacheHdr->ch_lru.head)
+			ct = dlist_container(CatCTup, lru_elem, tcur);
+		if (lcur != &CacheHdr->ch_lru_lists.head)
+			cl = dlist_container(CatCList, lru_elem, lcur);
+
+		if (ct == NULL && cl == NULL)
+			break;
+
+		if (cl == NULL || (ct != NULL && ct->lastaccess <= cl->lastaccess))
+		{
+			tcur = tcur->prev;
+			Assert(ct->c_list == NULL);
+			if (ct != keep && ct->refcount == 0)
+				CatCacheRemoveCTup(ct->my_cache, ct);
+		}
+		else
+		{
+			lcur = lcur->prev;
+			if (cl->refcount == 0)
+			{
+				int			i;
+
+				/* have the members that aren't in use removed with it */
+				for (i = 0; i < cl->n_members; i++)
+				{
+					if (cl->members[i]->refcount == 0)
+						cl->members[i]->dead = true;
+				}
+				CatCacheRemoveCList(cl->my_cache, cl);
+			}
+		}
+	}
+}
+
 
 /*
  *	CatCacheInvalidate
@@ -638,7 +769,7 @@ CreateCacheMemoryContext(void)
  * This is not very efficient if the target cache is nearly empty.
  * However, it shouldn't need to be efficient; we don't invoke it often.
  */
-static void
+void
 ResetCatalogCache(CatCache *cache)
 {
 	dlist_mutable_iter iter;
@@ -802,6 +933,10 @@ InitCatCache(int id,
 		CacheHdr = (CatCacheHeader *) palloc(sizeof(CatCacheHeader));
 		slist_init(&CacheHdr->ch_caches);
 		CacheHdr->ch_ntup = 0;
+		CacheHdr->ch_nbytes = 0;
+		CacheHdr->ch_clock = 0;
+		dlist_init(&CacheHdr->ch_lru);
+		dlist_init(&CacheHdr->ch_lru_lists);
 #ifdef CATCACHE_STATS
 		/* set up to dump stats at backend exit */
 		on_proc_exit(CatCachePrintStats, 0);
@@ -1263,6 +1398,7 @@ SearchCatCacheInternal(CatCache *cache,
 		 * near the front of the hashbucket's list.)
 		 */
 		dlist_move_head(bucket, &ct->cache_elem);
+		CatCacheTouchTuple(ct);
 
 		/*
 		 * If it's a positive entry, bump its refcount and return it. If it's
@@ -1322,6 +1458,8 @@ SearchCatCacheMiss(CatCache *cache,
 	HeapTuple	ntp;
 	CatCTup    *ct;
 	Datum		arguments[CATCACHE_MAXKEYS];
+	bool		use_shared;
+	uint64		shared_generation = 0;
 
 	/* Initialize local parameter array */
 	arguments[0] = v1;
@@ -1329,6 +1467,55 @@ SearchCatCacheMiss(CatCache *cache,
 	arguments[2] = v3;
 	arguments[3] = v4;
 
+	/*
+	 * If another backend has already loaded the tuple, we can take it from
+	 * the shared catalog cache instead of searching the relation.
+	 */
+	use_shared = SharedCatCacheUsable();
+	if (use_shared)
+	{
+		List	   *tuples;
+		ListCell   *lc;
+
+		tuples = SharedCatCacheFetch(cache, hashValue, &shared_generation);
+
+		ct = NULL;
+		foreach(lc, tuples)
+		{
+			HeapTuple	stp = (HeapTuple) lfirst(lc);
+
+			if (ct == NULL &&
+				CatalogCacheTupleMatches(cache, nkeys, stp, arguments))
+			{
+				ct = CatalogCacheCreateEntry(cache, stp, arguments,
+											 hashValue, hashIndex,
+											 false);
+				/* immediately set the refcount to 1 */
+				ResourceOwnerEnlargeCatCacheRefs(CurrentResourceOwner);
+				ct->refcount++;
+				ResourceOwnerRememberCatCacheRef(CurrentResourceOwner, &ct->tuple);
+			}
+			heap_freetuple(stp);
+		}
+		list_free(tuples);
+
+		if (ct != NULL)
+		{
+			CACHE_elog(DEBUG2, "SearchCatCache(%s): put shared tuple in bucket %d",
+					   cache->cc_relname, hashIndex);
+#ifdef CATCACHE_STATS
+			cache->cc_newloads++;
+#endif
+			return &ct->tuple;
+		}
+
+		/*
+		 * Make sure that the snapshot we search the relation with is taken
+		 * after the generation was read; see sharedcatcache.c.
+		 */
+		InvalidateCatalogSnapshot();
+	}
+
 	/*
 	 * Ok, need to make a lookup in the relation, copy the scankey and fill
 	 * out any per-call fields.
@@ -1374,6 +1561,11 @@ SearchCatCacheMiss(CatCache *cache,
 		ResourceOwnerEnlargeCatCacheRefs(CurrentResourceOwner);
 		ct->refcount++;
 		ResourceOwnerRememberCatCacheRef(CurrentResourceOwner, &ct->tuple);
+
+		/* offer it to other backends; ct->tuple has been detoasted */
+		if (use_shared)
+			SharedCatCacheStore(cache, hashValue, &ct->tuple,
+								shared_generation);
 		break;					/* assume only one match */
 	}
 
@@ -1581,6 +1773,7 @@ SearchCatCacheList(CatCache *cache,
 		 * individually.)
 		 */
 		dlist_move_head(&cache->cc_lists, &cl->cache_elem);
+		CatCacheTouchList(cl);
 
 		/* Bump the list's refcount and return it */
 		ResourceOwnerEnlargeCatCacheListRefs(CurrentResourceOwner);
@@ -1752,6 +1945,8 @@ SearchCatCacheList(CatCache *cache,
 		cl->members[i++] = ct = (CatCTup *) lfirst(ctlist_item);
 		Assert(ct->c_list == NULL);
 		ct->c_list = cl;
+		/* from now on, the member is evicted with the list */
+		dlist_delete(&ct->lru_elem);
 		/* release the temporary refcount on the member */
 		Assert(ct->refcount > 0);
 		ct->refcount--;
@@ -1762,11 +1957,19 @@ SearchCatCacheList(CatCache *cache,
 	Assert(i == nmembers);
 
 	dlist_push_head(&cache->cc_lists, &cl->cache_elem);
+	cl->lastaccess = ++CacheHdr->ch_clock;
+	dlist_push_head(&CacheHdr->ch_lru_lists, &cl->lru_elem);
+	CacheHdr->ch_nbytes += CatCListSize(cache, cl);
 
 	/* Finally, bump the list's refcount and return it */
 	cl->refcount++;
 	ResourceOwnerRememberCatCacheListRef(CurrentResourceOwner, cl);
 
+	/* Now that it's safe from eviction, make room if needed */
+	if (max_catcache_memory > 0 &&
+		CacheHdr->ch_nbytes > (Size) max_catcache_memory * 1024)
+		CatCacheEvict(NULL);
+
 	CACHE_elog(DEBUG2, "SearchCatCacheList(%s): made list of %d members",
 			   cache->cc_relname, nmembers);
 
@@ -1890,9 +2093,17 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
 	ct->hash_value = hashValue;
 
 	dlist_push_head(&cache->cc_bucket[hashIndex], &ct->cache_elem);
+	ct->lastaccess = ++CacheHdr->ch_clock;
+	dlist_push_head(&CacheHdr->ch_lru, &ct->lru_elem);
 
 	cache->cc_ntup++;
 	CacheHdr->ch_ntup++;
+	CacheHdr->ch_nbytes += CatCTupSize(cache, ct);
+
+	/* Make room if needed, without removing the new entry */
+	if (max_catcache_memory > 0 &&
+		CacheHdr->ch_nbytes > (Size) max_catcache_memory * 1024)
+		CatCacheEvict(ct);
 
 	/*
 	 * If the hash table has become too full, enlarge the buckets array. Quite
@@ -1969,6 +2180,52 @@ CatCacheCopyKeys(TupleDesc tupdesc, int nkeys, int *attnos,
 
 }
 
+/*
+ * Helper routine that computes the memory used by keys copied with
+ * CatCacheCopyKeys.
+ */
+static Size
+CatCacheKeysSize(TupleDesc tupdesc, int nkeys, int *attnos, Datum *keys)
+{
+	Size		size = 0;
+	int			i;
+
+	for (i = 0; i < nkeys; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, attnos[i] - 1);
+
+		if (!att->attbyval)
+			size += GetMemoryChunkSpace(DatumGetPointer(keys[i]));
+	}
+
+	return size;
+}
+
+/*
+ * Memory used by a cache entry, including its tuple or its keys
+ */
+static Size
+CatCTupSize(CatCache *cache, CatCTup *ct)
+{
+	Size		size = GetMemoryChunkSpace(ct);
+
+	if (ct->negative)
+		size += CatCacheKeysSize(cache->cc_tupdesc, cache->cc_nkeys,
+								 cache->cc_keyno, ct->keys);
+	return size;
+}
+
+/*
+ * Memory used by a list, not counting its members
+ */
+static Size
+CatCListSize(CatCache *cache, CatCList *cl)
+{
+	return GetMemoryChunkSpace(cl) +
+		CatCacheKeysSize(cache->cc_tupdesc, cl->nkeys, cache->cc_keyno,
+						 cl->keys);
+}
+
 /*
  *	PrepareToInvalidateCacheTuple()
  *
@@ -114,6 +114,8 @@
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/relmapper.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -667,6 +669,65 @@ InvalidateSystemCaches(void)
 }
 
 
+/*
+ *		InvalidateSystemCachesSummarized
+ *
+ *		Like InvalidateSystemCaches, but only for the catalog caches and the
+ *		relations that the messages summarized for us might have concerned.
+ *
+ *		We call this when the shared-inval queue overflowed, but the messages
+ *		we lost could be summarized.
+ */
+static void
+InvalidateSystemCachesSummarized(const SharedInvalidationSummary *summary)
+{
+	int			cacheId;
+	int			i;
+	bool		anyrel = false;
+
+	StaticAssertStmt(SysCacheSize <= SINVAL_SUMMARY_CATCACHES,
+					 "too many catalog caches for sinval summaries");
+
+	InvalidateCatalogSnapshot();
+
+	for (cacheId = 0; cacheId < SysCacheSize; cacheId++)
+	{
+		if (!SharedInvalSummaryHasCatcache(summary, cacheId))
+			continue;
+
+		SysCacheReset(cacheId);
+		CallSyscacheCallbacks(cacheId, 0);
+	}
+
+	RelationCacheInvalidateSummarized(summary);
+
+	if (summary->smgr)
+		smgrcloseall();
+
+	/*
+	 * We can't tell the relcache callbacks which relations were concerned,
+	 * so tell them all were.
+	 */
+	for (i = 0; i < SINVAL_SUMMARY_FILTER_BITS / 64; i++)
+	{
+		if (summary->relations[i] != 0)
+		{
+			anyrel = true;
+			break;
+		}
+	}
+	if (anyrel)
+	{
+		for (i = 0; i < relcache_callback_count; i++)
+		{
+			struct RELCACHECALLBACK *ccitem = relcache_callback_list + i;
+
+			ccitem->function(ccitem->arg, InvalidOid);
+		}
+	}
+}
+
+
 /* ----------------------------------------------------------------
  *					  public functions
  * ----------------------------------------------------------------
@@ -684,6 +745,7 @@ void
 AcceptInvalidationMessages(void)
 {
 	ReceiveSharedInvalidMessages(LocalExecuteInvalidationMessage,
+								 InvalidateSystemCachesSummarized,
 								 InvalidateSystemCaches);
 
 	/*
@@ -918,6 +980,12 @@ ProcessCommittedInvalidationMessages(SharedInvalidationMessage *msgs,
 		}
 	}
 
+	/* see AtEOXact_Inval */
+	if (shared_catcache_size > 0)
+		SharedCatCacheInvalidate(msgs, nmsgs);
+	if (shared_plan_cache_size > 0)
+		SharedPlanCacheInvalidate(msgs, nmsgs);
+
 	SendSharedInvalidMessages(msgs, nmsgs);
 
 	if (RelcacheInitFileInval)
@@ -971,6 +1039,18 @@ AtEOXact_Inval(bool isCommit)
 		AppendInvalidationMessages(&transInvalInfo->PriorCmdInvalidMsgs,
 								   &transInvalInfo->CurrentCmdInvalidMsgs);
 
+		/*
+		 * Shared catalog cache entries and plans must be gone before our
+		 * locks are released, so it falls to us to remove those depending on
+		 * what we changed.
+		 */
+		if (shared_catcache_size > 0)
+			ProcessInvalidationMessagesMulti(&transInvalInfo->PriorCmdInvalidMsgs,
+											 SharedCatCacheInvalidate);
+		if (shared_plan_cache_size > 0)
+			ProcessInvalidationMessagesMulti(&transInvalInfo->PriorCmdInvalidMsgs,
+											 SharedPlanCacheInvalidate);
+
 		ProcessInvalidationMessagesMulti(&transInvalInfo->PriorCmdInvalidMsgs,
 										 SendSharedInvalidMessages);
 
@@ -58,6 +58,7 @@
 
 #include "access/transam.h"
 #include "catalog/namespace.h"
+#include "executor/execPartition.h"
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
@@ -71,6 +72,7 @@
 #include "utils/memutils.h"
 #include "utils/resowner_private.h"
 #include "utils/rls.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -99,14 +101,19 @@ static dlist_head cached_expression_list = DLIST_STATIC_INIT(cached_expression_l
 static void ReleaseGenericPlan(CachedPlanSource *plansource);
 static List *RevalidateCachedQuery(CachedPlanSource *plansource,
 								   QueryEnvironment *queryEnv);
-static bool CheckCachedPlan(CachedPlanSource *plansource);
+static bool CheckCachedPlan(CachedPlanSource *plansource,
+							ParamListInfo boundParams);
 static CachedPlan *BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 								   ParamListInfo boundParams, QueryEnvironment *queryEnv);
 static bool choose_custom_plan(CachedPlanSource *plansource,
 							   ParamListInfo boundParams);
 static double cached_plan_cost(CachedPlan *plan, bool include_planner);
 static Query *QueryListGetPrimaryStmt(List *stmts);
-static void AcquireExecutorLocks(List *stmt_list, bool acquire);
+static void AcquireExecutorLocks(List *stmt_list, bool acquire,
+								 List *skip_relids);
+static List *GetPrunableRelids(List *stmt_list);
+static List *AcquirePrunedExecutorLocks(List *stmt_list, List *prunable_relids,
+										ParamListInfo boundParams);
 static void AcquirePlannerLocks(List *stmt_list, bool acquire);
 static void ScanQueryForLocks(Query *parsetree, bool acquire);
 static bool ScanQueryWalker(Node *node, bool *acquire);
@@ -790,9 +797,14 @@ RevalidateCachedQuery(CachedPlanSource *plansource,
  *
  * On a "true" return, we have acquired the locks needed to run the plan.
  * (We must do this for the "true" result to be race-condition-free.)
+ *
+ * boundParams are the Param values the plan is about to be executed with,
+ * or NULL if unknown.  When available, we use them to perform initial
+ * partition pruning before locking the plan's leaf partitions, so that only
+ * the partitions that survive it get locked.
  */
 static bool
-CheckCachedPlan(CachedPlanSource *plansource)
+CheckCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams)
 {
 	CachedPlan *plan = plansource->gplan;
 
@@ -820,13 +832,29 @@ CheckCachedPlan(CachedPlanSource *plansource)
 	 */
 	if (plan->is_valid)
 	{
+		List	   *unlocked_relids = NIL;
+
 		/*
 		 * Plan must have positive refcount because it is referenced by
 		 * plansource; so no need to fear it disappears under us here.
 		 */
 		Assert(plan->refcount > 0);
 
-		AcquireExecutorLocks(plan->stmt_list, true);
+		/*
+		 * Leaf partitions that initial pruning might remove are locked only
+		 * once we know the pruning result.  Performing the pruning steps
+		 * requires the partitioned tables to be locked and the plan to still
+		 * be valid, so lock everything else and recheck validity first.
+		 */
+		if (boundParams)
+			unlocked_relids = GetPrunableRelids(plan->stmt_list);
+
+		AcquireExecutorLocks(plan->stmt_list, true, unlocked_relids);
+
+		if (unlocked_relids != NIL && plan->is_valid)
+			unlocked_relids = AcquirePrunedExecutorLocks(plan->stmt_list,
+														 unlocked_relids,
+														 boundParams);
 
 		/*
 		 * If plan was transient, check to see if TransactionXmin has
@@ -848,7 +876,7 @@ CheckCachedPlan(CachedPlanSource *plansource)
 		}
 
 		/* Oops, the race case happened.  Release useless locks. */
-		AcquireExecutorLocks(plan->stmt_list, false);
+		AcquireExecutorLocks(plan->stmt_list, false, unlocked_relids);
 	}
 
 	/*
@@ -883,6 +911,8 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	List	   *plist;
 	bool		snapshot_set;
 	bool		is_transient;
+	bool		use_shared_cache;
+	uint64		shared_generation = 0;
 	MemoryContext plan_context;
 	MemoryContext oldcxt = CurrentMemoryContext;
 	ListCell   *lc;
@@ -930,10 +960,38 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	}
 
 	/*
-	 * Generate the plan.
+	 * Generic plans may be shared with other backends.  If one was, we need
+	 * to lock the relations it uses that the query tree doesn't, such as
+	 * partitions, like the planner would have, and recheck it.
+	 */
+	use_shared_cache = (shared_plan_cache_size > 0 &&
+						boundParams == NULL && queryEnv == NULL);
+	plist = NIL;
+	if (use_shared_cache)
+	{
+		plist = SharedPlanCacheFetch(plansource, &shared_generation);
+		if (plist != NIL)
+		{
+			AcquireExecutorLocks(plist, true, NIL);
+			if (!SharedPlanCacheCheck(&shared_generation))
+			{
+				AcquireExecutorLocks(plist, false, NIL);
+				plist = NIL;
+			}
+		}
+	}
+
+	/*
+	 * Generate the plan, if we didn't get one.
 	 */
-	plist = pg_plan_queries(qlist, plansource->query_string,
-							plansource->cursor_options, boundParams);
+	if (plist == NIL)
+	{
+		plist = pg_plan_queries(qlist, plansource->query_string,
+								plansource->cursor_options, boundParams);
+
+		if (use_shared_cache)
+			SharedPlanCacheStore(plansource, plist, shared_generation);
+	}
 
 	/* Release snapshot if we got one */
 	if (snapshot_set)
@@ -1160,7 +1218,7 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 
 	if (!customplan)
 	{
-		if (CheckCachedPlan(plansource))
+		if (CheckCachedPlan(plansource, boundParams))
 		{
 			/* We want a generic plan, and we already have a valid one */
 			plan = plansource->gplan;
@@ -1738,16 +1796,26 @@ QueryListGetPrimaryStmt(List *stmts)
 /*
  * AcquireExecutorLocks: acquire locks needed for execution of a cached plan;
  * or release them if acquire is false.
+ *
+ * If skip_relids isn't NIL, it holds a Bitmapset for each statement of
+ * stmt_list, containing the RT indexes of relations to leave alone.
  */
 static void
-AcquireExecutorLocks(List *stmt_list, bool acquire)
+AcquireExecutorLocks(List *stmt_list, bool acquire, List *skip_relids)
 {
 	ListCell   *lc1;
+	int			stmtno = 0;
 
 	foreach(lc1, stmt_list)
 	{
 		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc1);
+		Bitmapset  *skip = NULL;
 		ListCell   *lc2;
+		int			rti;
+
+		if (skip_relids != NIL)
+			skip = (Bitmapset *) list_nth(skip_relids, stmtno);
+		stmtno++;
 
 		if (plannedstmt->commandType == CMD_UTILITY)
 		{
@@ -1765,11 +1833,14 @@ AcquireExecutorLocks(List *stmt_list, bool acquire)
 			continue;
 		}
 
+		rti = 0;
 		foreach(lc2, plannedstmt->rtable)
 		{
 			RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc2);
 
-			if (rte->rtekind != RTE_RELATION)
+			rti++;
+
+			if (rte->rtekind != RTE_RELATION || bms_is_member(rti, skip))
 				continue;
 
 			/*
@@ -1786,6 +1857,92 @@ AcquireExecutorLocks(List *stmt_list, bool acquire)
 	}
 }
 
+/*
+ * GetPrunableRelids: collect the leaf partitions of a cached plan that
+ * initial partition pruning might let us leave unlocked.
+ *
+ * Returns a List holding each statement's prunableRelids, or NIL if there
+ * are none at all.
+ */
+static List *
+GetPrunableRelids(List *stmt_list)
+{
+	List	   *result = NIL;
+	bool		found = false;
+	ListCell   *lc;
+
+	foreach(lc, stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+
+		if (!bms_is_empty(plannedstmt->prunableRelids))
+			found = true;
+		result = lappend(result, plannedstmt->prunableRelids);
+	}
+
+	if (!found)
+	{
+		list_free(result);
+		return NIL;
+	}
+	return result;
+}
+
+/*
+ * AcquirePrunedExecutorLocks: perform initial partition pruning for a cached
+ * plan whose other relations are already locked, and lock the prunable leaf
+ * partitions that survive it.
+ *
+ * prunable_relids is the result of GetPrunableRelids.  Returns a List of
+ * the same shape holding the relations that were pruned, and so left
+ * unlocked.
+ */
+static List *
+AcquirePrunedExecutorLocks(List *stmt_list, List *prunable_relids,
+						   ParamListInfo boundParams)
+{
+	List	   *result = NIL;
+	bool		snapshot_set = false;
+	ListCell   *lc1;
+	ListCell   *lc2;
+
+	/* The pruning expressions might need a snapshot */
+	if (!ActiveSnapshotSet())
+	{
+		PushActiveSnapshot(GetTransactionSnapshot());
+		snapshot_set = true;
+	}
+
+	forboth(lc1, stmt_list, lc2, prunable_relids)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc1);
+		Bitmapset  *prunable = (Bitmapset *) lfirst(lc2);
+		Bitmapset  *pruned = NULL;
+		int			rti;
+
+		if (!bms_is_empty(prunable))
+			pruned = ExecGetLockPrunedRelids(plannedstmt, boundParams);
+
+		rti = -1;
+		while ((rti = bms_next_member(prunable, rti)) >= 0)
+		{
+			RangeTblEntry *rte;
+
+			if (bms_is_member(rti, pruned))
+				continue;
+			rte = rt_fetch(rti, plannedstmt->rtable);
+			LockRelationOid(rte->relid, rte->rellockmode);
+		}
+
+		result = lappend(result, pruned);
+	}
+
+	if (snapshot_set)
+		PopActiveSnapshot();
+
+	return result;
+}
+
 /*
  * AcquirePlannerLocks: acquire locks needed for planning of a querytree list;
  * or release them if acquire is false.
@@ -27,6 +27,7 @@
 #include "postgres.h"
 
 #include <sys/file.h>
+#include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 
@@ -66,6 +67,7 @@
 #include "catalog/schemapg.h"
 #include "catalog/storage.h"
 #include "commands/policy.h"
+#include "common/hashfn.h"
 #include "commands/trigger.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
@@ -74,6 +76,7 @@
 #include "rewrite/rewriteDefine.h"
 #include "rewrite/rowsecurity.h"
 #include "storage/lmgr.h"
+#include "storage/sinval.h"
 #include "storage/smgr.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
@@ -125,10 +128,39 @@ static const FormData_pg_attribute Desc_pg_subscription[Natts_pg_subscription] =
 typedef struct relidcacheent
 {
 	Oid			reloid;
+	char		status;			/* hash status */
 	Relation	reldesc;
 } RelIdCacheEnt;
 
-static HTAB *RelationIdCache;
+/*
+ * The relcache is looked up for every relation access, so it's indexed by
+ * a simplehash table rather than a dynahash one.  Note that entries can move
+ * around when other entries are inserted or deleted, so pointers to them
+ * must not be held across such operations; nothing keeps them anyway, since
+ * entries only point to the Relation, which doesn't move.
+ */
+#define SH_PREFIX		relidcache
+#define SH_ELEMENT_TYPE RelIdCacheEnt
+#define SH_KEY_TYPE		Oid
+#define SH_KEY			reloid
+#define SH_HASH_KEY(tb, key) murmurhash32(key)
+#define SH_EQUAL(tb, a, b) ((a) == (b))
+#define SH_SCOPE		static inline
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
+static relidcache_hash *RelationIdCache;
+
+/*
+ * All relcache entries are also kept in a list, most recently used first,
+ * from which entries are evicted at transaction end when there are more
+ * than max_relcache_entries of them.
+ */
+static dlist_head RelationLRUList = DLIST_STATIC_INIT(RelationLRUList);
+static int	RelationCacheEntries = 0;
+
+int			max_relcache_entries = 0;
 
 /*
  * This flag is false until we have prepared the critical relcache entries
@@ -154,7 +186,7 @@ static long relcacheInvalsReceived = 0L;
  * eoxact_list[] stores the OIDs of relations that (might) need AtEOXact
  * cleanup work.  This list intentionally has limited size; if it overflows,
  * we fall back to scanning the whole hashtable.  There is no value in a very
- * large list because (1) at some point, a hash_seq_search scan is faster than
+ * large list because (1) at some point, a hashtable scan is faster than
  * retail lookups, and (2) the value of this is to reduce EOXact work for
  * short transactions, which can't have dirtied all that many tables anyway.
  * EOXactListAdd() does not bother to prevent duplicate list entries, so the
@@ -188,15 +220,14 @@ static int	EOXactTupleDescArrayLen = 0;
 #define RelationCacheInsert(RELATION, replace_allowed)	\
 do { \
 	RelIdCacheEnt *hentry; bool found; \
-	hentry = (RelIdCacheEnt *) hash_search(RelationIdCache, \
-										   (void *) &((RELATION)->rd_id), \
-										   HASH_ENTER, &found); \
+	hentry = relidcache_insert(RelationIdCache, (RELATION)->rd_id, &found); \
 	if (found) \
 	{ \
 		/* see comments in RelationBuildDesc and RelationBuildLocalRelation */ \
 		Relation _old_rel = hentry->reldesc; \
 		Assert(replace_allowed); \
 		hentry->reldesc = (RELATION); \
+		dlist_delete(&_old_rel->rd_lru_elem); \
 		if (RelationHasReferenceCountZero(_old_rel)) \
 			RelationDestroyRelation(_old_rel, false); \
 		else if (!IsBootstrapProcessingMode()) \
@@ -204,15 +235,17 @@ do { \
 				 RelationGetRelationName(_old_rel)); \
 	} \
 	else \
+	{ \
 		hentry->reldesc = (RELATION); \
+		RelationCacheEntries++; \
+	} \
+	dlist_push_head(&RelationLRUList, &(RELATION)->rd_lru_elem); \
 } while(0)
 
 #define RelationIdCacheLookup(ID, RELATION) \
 do { \
 	RelIdCacheEnt *hentry; \
-	hentry = (RelIdCacheEnt *) hash_search(RelationIdCache, \
-										   (void *) &(ID), \
-										   HASH_FIND, NULL); \
+	hentry = relidcache_lookup(RelationIdCache, (ID)); \
 	if (hentry) \
 		RELATION = hentry->reldesc; \
 	else \
@@ -221,13 +254,14 @@ do { \
 
 #define RelationCacheDelete(RELATION) \
 do { \
-	RelIdCacheEnt *hentry; \
-	hentry = (RelIdCacheEnt *) hash_search(RelationIdCache, \
-										   (void *) &((RELATION)->rd_id), \
-										   HASH_REMOVE, NULL); \
-	if (hentry == NULL) \
+	if (!relidcache_delete(RelationIdCache, (RELATION)->rd_id)) \
 		elog(WARNING, "failed to delete relcache entry for OID %u", \
 			 (RELATION)->rd_id); \
+	else \
+	{ \
+		dlist_delete(&(RELATION)->rd_lru_elem); \
+		RelationCacheEntries--; \
+	} \
 } while(0)
 
 
@@ -258,6 +292,7 @@ static void RelationClearRelation(Relation relation, bool rebuild);
 static void RelationReloadIndexInfo(Relation relation);
 static void RelationReloadNailed(Relation relation);
 static void RelationFlushRelation(Relation relation);
+static void RelationCacheEvict(void);
 static void RememberToFreeTupleDescAtEOX(TupleDesc td);
 #ifdef USE_ASSERT_CHECKING
 static void AssertPendingSyncConsistency(Relation relation);
@@ -267,6 +302,7 @@ static void AtEOSubXact_cleanup(Relation relation, bool isCommit,
 								SubTransactionId mySubid, SubTransactionId parentSubid);
 static bool load_relcache_init_file(bool shared);
 static void write_relcache_init_file(bool shared);
+static bool read_item(char **pos, const char *end, void *data, Size len);
 static void write_item(const void *data, Size len, FILE *fp);
 
 static void formrdesc(const char *relationName, Oid relationReltype,
@@ -2016,6 +2052,7 @@ RelationIdGetRelation(Oid relationId)
 		}
 
 		RelationIncrementReferenceCount(rd);
+		dlist_move_head(&RelationLRUList, &rd->rd_lru_elem);
 		/* revalidate cache entry if necessary */
 		if (!rd->rd_isvalid)
 		{
@@ -2373,6 +2410,8 @@ RelationDestroyRelation(Relation relation, bool remember_tupdesc)
 	list_free_deep(relation->rd_fkeylist);
 	list_free(relation->rd_indexlist);
 	bms_free(relation->rd_indexattr);
+	bms_free(relation->rd_hotblockingattr);
+	bms_free(relation->rd_summarizedattr);
 	bms_free(relation->rd_keyattr);
 	bms_free(relation->rd_pkattr);
 	bms_free(relation->rd_idattr);
@@ -2619,6 +2658,8 @@ RelationClearRelation(Relation relation, bool rebuild)
 		SWAPFIELD(SMgrRelation, rd_smgr);
 		/* rd_refcnt must be preserved */
 		SWAPFIELD(int, rd_refcnt);
+		/* and so must our place in the LRU list */
+		SWAPFIELD(dlist_node, rd_lru_elem);
 		/* isnailed shouldn't change */
 		Assert(newrel->rd_isnailed == relation->rd_isnailed);
 		/* creation sub-XIDs must be preserved */
@@ -2805,13 +2846,13 @@ RelationCacheInvalidateEntry(Oid relationId)
  *
  *	 We do this in two phases: the first pass deletes deletable items, and
  *	 the second one rebuilds the rebuildable items.  This is essential for
- *	 safety, because hash_seq_search only copes with concurrent deletion of
+ *	 safety, because a hashtable scan only copes with concurrent deletion of
  *	 the element it is currently visiting.  If a second SI overflow were to
  *	 occur while we are walking the table, resulting in recursive entry to
  *	 this routine, we could crash because the inner invocation blows away
  *	 the entry next to be visited by the outer scan.  But this way is OK,
  *	 because (a) during the first pass we won't process any more SI messages,
- *	 so hash_seq_search will complete safely; (b) during the second pass we
+ *	 so the hashtable scan will complete safely; (b) during the second pass we
  *	 only hold onto pointers to nondeletable entries.
  *
  *	 The two-phase approach also makes it easy to update relfilenodes for
@@ -2823,7 +2864,7 @@ RelationCacheInvalidateEntry(Oid relationId)
 void
 RelationCacheInvalidate(void)
 {
-	HASH_SEQ_STATUS status;
+	relidcache_iterator status;
 	RelIdCacheEnt *idhentry;
 	Relation	relation;
 	List	   *rebuildFirstList = NIL;
@@ -2836,9 +2877,9 @@ RelationCacheInvalidate(void)
 	RelationMapInvalidateAll();
 
 	/* Phase 1 */
-	hash_seq_init(&status, RelationIdCache);
+	relidcache_start_iterate(RelationIdCache, &status);
 
-	while ((idhentry = (RelIdCacheEnt *) hash_seq_search(&status)) != NULL)
+	while ((idhentry = relidcache_iterate(RelationIdCache, &status)) != NULL)
 	{
 		relation = idhentry->reldesc;
 
@@ -2917,6 +2958,37 @@ RelationCacheInvalidate(void)
 	list_free(rebuildList);
 }
 
+/*
+ * RelationCacheInvalidateSummarized
+ *	 Invalidate the relcache entries that SI messages we lost might have
+ *	 concerned, as far as the summary of those messages tells.
+ *
+ *	 The summary only has a Bloom filter of the relation OIDs, so this will
+ *	 also invalidate some entries that were not concerned.  We collect the
+ *	 OIDs first, since invalidating entries may process further messages and
+ *	 modify the hash table.
+ */
+void
+RelationCacheInvalidateSummarized(const SharedInvalidationSummary *summary)
+{
+	relidcache_iterator status;
+	RelIdCacheEnt *idhentry;
+	List	   *relids = NIL;
+	ListCell   *l;
+
+	relidcache_start_iterate(RelationIdCache, &status);
+	while ((idhentry = relidcache_iterate(RelationIdCache, &status)) != NULL)
+	{
+		if (SharedInvalSummaryHasRelation(summary, idhentry->reloid))
+			relids = lappend_oid(relids, idhentry->reloid);
+	}
+
+	foreach(l, relids)
+		RelationCacheInvalidateEntry(lfirst_oid(l));
+
+	list_free(relids);
+}
+
 /*
  * RelationCloseSmgrByOid - close a relcache entry's smgr link
  *
@@ -2991,6 +3063,7 @@ void
 AssertPendingSyncs_RelationCache(void)
 {
 	HASH_SEQ_STATUS status;
+	relidcache_iterator iter;
 	LOCALLOCK  *locallock;
 	Relation   *rels;
 	int			maxrels;
@@ -3032,8 +3105,8 @@ AssertPendingSyncs_RelationCache(void)
 		rels[nrels++] = r;
 	}
 
-	hash_seq_init(&status, RelationIdCache);
-	while ((idhentry = (RelIdCacheEnt *) hash_seq_search(&status)) != NULL)
+	relidcache_start_iterate(RelationIdCache, &iter);
+	while ((idhentry = relidcache_iterate(RelationIdCache, &iter)) != NULL)
 		AssertPendingSyncConsistency(idhentry->reldesc);
 
 	for (i = 0; i < nrels; i++)
@@ -3061,13 +3134,13 @@ AssertPendingSyncs_RelationCache(void)
 void
 AtEOXact_RelationCache(bool isCommit)
 {
-	HASH_SEQ_STATUS status;
+	relidcache_iterator status;
 	RelIdCacheEnt *idhentry;
 	int			i;
 
 	/*
 	 * Unless the eoxact_list[] overflowed, we only need to examine the rels
-	 * listed in it.  Otherwise fall back on a hash_seq_search scan.
+	 * listed in it.  Otherwise fall back on a scan of the hashtable.
 	 *
 	 * For simplicity, eoxact_list[] entries are not deleted till end of
 	 * top-level transaction, even though we could remove them at
@@ -3078,8 +3151,8 @@ AtEOXact_RelationCache(bool isCommit)
 	 */
 	if (eoxact_list_overflowed)
 	{
-		hash_seq_init(&status, RelationIdCache);
-		while ((idhentry = (RelIdCacheEnt *) hash_seq_search(&status)) != NULL)
+		relidcache_start_iterate(RelationIdCache, &status);
+		while ((idhentry = relidcache_iterate(RelationIdCache, &status)) != NULL)
 		{
 			AtEOXact_cleanup(idhentry->reldesc, isCommit);
 		}
@@ -3088,10 +3161,7 @@ AtEOXact_RelationCache(bool isCommit)
 	{
 		for (i = 0; i < eoxact_list_len; i++)
 		{
-			idhentry = (RelIdCacheEnt *) hash_search(RelationIdCache,
-													 (void *) &eoxact_list[i],
-													 HASH_FIND,
-													 NULL);
+			idhentry = relidcache_lookup(RelationIdCache, eoxact_list[i]);
 			if (idhentry != NULL)
 				AtEOXact_cleanup(idhentry->reldesc, isCommit);
 		}
@@ -3111,6 +3181,45 @@ AtEOXact_RelationCache(bool isCommit)
 	eoxact_list_overflowed = false;
 	NextEOXactTupleDescNum = 0;
 	EOXactTupleDescArrayLen = 0;
+
+	if (max_relcache_entries > 0 &&
+		RelationCacheEntries > max_relcache_entries)
+		RelationCacheEvict();
+}
+
+/*
+ * RelationCacheEvict
+ *
+ *	Remove the least recently used relcache entries, until there are no
+ *	more than max_relcache_entries left or no more can be removed.
+ *
+ * This is done at main-transaction end, when nothing but nailed relations
+ * should be referenced, and entries no longer depend on the transaction.
+ * Entries are evicted the same way RelationFlushRelation gets rid of
+ * unreferenced ones.
+ */
+static void
+RelationCacheEvict(void)
+{
+	dlist_node *cur = RelationLRUList.head.prev;
+
+	while (RelationCacheEntries > max_relcache_entries &&
+		   cur != &RelationLRUList.head)
+	{
+		Relation	relation = dlist_container(RelationData, rd_lru_elem, cur);
+
+		/* get the next one first, as we may remove this one */
+		cur = cur->prev;
+
+		if (relation->rd_isnailed ||
+			!RelationHasReferenceCountZero(relation) ||
+			relation->rd_createSubid != InvalidSubTransactionId ||
+			relation->rd_firstRelfilenodeSubid != InvalidSubTransactionId ||
+			relation->rd_droppedSubid != InvalidSubTransactionId)
+			continue;
+
+		RelationClearRelation(relation, false);
+	}
 }
 
 /*
@@ -3207,19 +3316,19 @@ void
 AtEOSubXact_RelationCache(bool isCommit, SubTransactionId mySubid,
 						  SubTransactionId parentSubid)
 {
-	HASH_SEQ_STATUS status;
+	relidcache_iterator status;
 	RelIdCacheEnt *idhentry;
 	int			i;
 
 	/*
 	 * Unless the eoxact_list[] overflowed, we only need to examine the rels
-	 * listed in it.  Otherwise fall back on a hash_seq_search scan.  Same
+	 * listed in it.  Otherwise fall back on a scan of the hashtable.  Same
 	 * logic as in AtEOXact_RelationCache.
 	 */
 	if (eoxact_list_overflowed)
 	{
-		hash_seq_init(&status, RelationIdCache);
-		while ((idhentry = (RelIdCacheEnt *) hash_seq_search(&status)) != NULL)
+		relidcache_start_iterate(RelationIdCache, &status);
+		while ((idhentry = relidcache_iterate(RelationIdCache, &status)) != NULL)
 		{
 			AtEOSubXact_cleanup(idhentry->reldesc, isCommit,
 								mySubid, parentSubid);
@@ -3229,10 +3338,7 @@ AtEOSubXact_RelationCache(bool isCommit, SubTransactionId mySubid,
 	{
 		for (i = 0; i < eoxact_list_len; i++)
 		{
-			idhentry = (RelIdCacheEnt *) hash_search(RelationIdCache,
-													 (void *) &eoxact_list[i],
-													 HASH_FIND,
-													 NULL);
+			idhentry = relidcache_lookup(RelationIdCache, eoxact_list[i]);
 			if (idhentry != NULL)
 				AtEOSubXact_cleanup(idhentry->reldesc, isCommit,
 									mySubid, parentSubid);
@@ -3756,8 +3862,6 @@ RelationAssumeNewRelfilenode(Relation relation)
 void
 RelationCacheInitialize(void)
 {
-	HASHCTL		ctl;
-
 	/*
 	 * make sure cache memory context exists
 	 */
@@ -3767,11 +3871,8 @@ RelationCacheInitialize(void)
 	/*
 	 * create hashtable that indexes the relcache
 	 */
-	MemSet(&ctl, 0, sizeof(ctl));
-	ctl.keysize = sizeof(Oid);
-	ctl.entrysize = sizeof(RelIdCacheEnt);
-	RelationIdCache = hash_create("Relcache by OID", INITRELCACHESIZE,
-								  &ctl, HASH_ELEM | HASH_BLOBS);
+	RelationIdCache = relidcache_create(CacheMemoryContext, INITRELCACHESIZE,
+										NULL);
 
 	/*
 	 * relation mapper needs to be initialized too
@@ -3852,7 +3953,7 @@ RelationCacheInitializePhase2(void)
 void
 RelationCacheInitializePhase3(void)
 {
-	HASH_SEQ_STATUS status;
+	relidcache_iterator status;
 	RelIdCacheEnt *idhentry;
 	MemoryContext oldcxt;
 	bool		needNewCacheFile = !criticalSharedRelcachesBuilt;
@@ -3984,15 +4085,16 @@ RelationCacheInitializePhase3(void)
 	 *
 	 * Whenever we access the catalogs to read data, there is a possibility of
 	 * a shared-inval cache flush causing relcache entries to be removed.
-	 * Since hash_seq_search only guarantees to still work after the *current*
-	 * entry is removed, it's unsafe to continue the hashtable scan afterward.
+	 * Since a hashtable scan only guarantees to still work after the *current*
+	 * entry is removed, and building other entries moves entries around too,
+	 * it's unsafe to continue the hashtable scan afterward.
 	 * We handle this by restarting the scan from scratch after each access.
 	 * This is theoretically O(N^2), but the number of entries that actually
 	 * need to be fixed is small enough that it doesn't matter.
 	 */
-	hash_seq_init(&status, RelationIdCache);
+	relidcache_start_iterate(RelationIdCache, &status);
 
-	while ((idhentry = (RelIdCacheEnt *) hash_seq_search(&status)) != NULL)
+	while ((idhentry = relidcache_iterate(RelationIdCache, &status)) != NULL)
 	{
 		Relation	relation = idhentry->reldesc;
 		bool		restart = false;
@@ -4104,8 +4206,7 @@ RelationCacheInitializePhase3(void)
 		/* Now, restart the hashtable scan if needed */
 		if (restart)
 		{
-			hash_seq_term(&status);
-			hash_seq_init(&status, RelationIdCache);
+			relidcache_start_iterate(RelationIdCache, &status);
 		}
 	}
 
@@ -4918,8 +5019,12 @@ RelationGetIndexPredicate(Relation relation)
  * predicates.)
  *
  * Depending on attrKind, a bitmap covering the attnums for all index columns,
- * for all potential foreign key columns, or for all columns in the configured
- * replica identity index is returned.
+ * for the columns whose modification prevents a HOT update, for the columns
+ * indexed only by summarizing indexes (like BRIN), for all potential foreign
+ * key columns, or for all columns in the configured replica identity index is
+ * returned.  Columns used in the predicates of summarizing indexes count as
+ * HOT-blocking, since an update of one can move a tuple into or out of the
+ * index.
  *
  * Attribute numbers are offset by FirstLowInvalidHeapAttributeNumber so that
  * we can include system attributes (e.g., OID) in the bitmap representation.
@@ -4937,6 +5042,8 @@ Bitmapset *
 RelationGetIndexAttrBitmap(Relation relation, IndexAttrBitmapKind attrKind)
 {
 	Bitmapset  *indexattrs;		/* indexed columns */
+	Bitmapset  *hotblockingattrs;	/* columns with HOT blocking indexes */
+	Bitmapset  *summarizedattrs;	/* columns with summarizing indexes */
 	Bitmapset  *uindexattrs;	/* columns in unique indexes */
 	Bitmapset  *pkindexattrs;	/* columns in the primary index */
 	Bitmapset  *idindexattrs;	/* columns in the replica identity */
@@ -4954,6 +5061,10 @@ RelationGetIndexAttrBitmap(Relation relation, IndexAttrBitmapKind attrKind)
 		{
 			case INDEX_ATTR_BITMAP_ALL:
 				return bms_copy(relation->rd_indexattr);
+			case INDEX_ATTR_BITMAP_HOT_BLOCKING:
+				return bms_copy(relation->rd_hotblockingattr);
+			case INDEX_ATTR_BITMAP_SUMMARIZED:
+				return bms_copy(relation->rd_summarizedattr);
 			case INDEX_ATTR_BITMAP_KEY:
 				return bms_copy(relation->rd_keyattr);
 			case INDEX_ATTR_BITMAP_PRIMARY_KEY:
@@ -5000,6 +5111,8 @@ restart:
 	 * won't be returned at all by RelationGetIndexList.
 	 */
 	indexattrs = NULL;
+	hotblockingattrs = NULL;
+	summarizedattrs = NULL;
 	uindexattrs = NULL;
 	pkindexattrs = NULL;
 	idindexattrs = NULL;
@@ -5015,6 +5128,7 @@ restart:
 		bool		isKey;		/* candidate key */
 		bool		isPK;		/* primary key */
 		bool		isIDKey;	/* replica identity index */
+		Bitmapset **attrs;
 
 		indexDesc = index_open(indexOid, AccessShareLock);
 
@@ -5052,6 +5166,15 @@ restart:
 		/* Is this index the configured (or default) replica identity? */
 		isIDKey = (indexOid == relreplindex);
 
+		/*
+		 * Changes to the columns of a summarizing index don't prevent a HOT
+		 * update; collect them separately.
+		 */
+		if (indexDesc->rd_indam->amsummarizing)
+			attrs = &summarizedattrs;
+		else
+			attrs = &hotblockingattrs;
+
 		/* Collect simple attribute references */
 		for (i = 0; i < indexDesc->rd_index->indnatts; i++)
 		{
@@ -5069,6 +5192,8 @@ restart:
 			{
 				indexattrs = bms_add_member(indexattrs,
 											attrnum - FirstLowInvalidHeapAttributeNumber);
+				*attrs = bms_add_member(*attrs,
+										attrnum - FirstLowInvalidHeapAttributeNumber);
 
 				if (isKey && i < indexDesc->rd_index->indnkeyatts)
 					uindexattrs = bms_add_member(uindexattrs,
@@ -5086,9 +5211,11 @@ restart:
 
 		/* Collect all attributes used in expressions, too */
 		pull_varattnos(indexExpressions, 1, &indexattrs);
+		pull_varattnos(indexExpressions, 1, attrs);
 
 		/* Collect all attributes in the index predicate, too */
 		pull_varattnos(indexPredicate, 1, &indexattrs);
+		pull_varattnos(indexPredicate, 1, &hotblockingattrs);
 
 		index_close(indexDesc, AccessShareLock);
 	}
@@ -5117,6 +5244,8 @@ restart:
 		bms_free(pkindexattrs);
 		bms_free(idindexattrs);
 		bms_free(indexattrs);
+		bms_free(hotblockingattrs);
+		bms_free(summarizedattrs);
 
 		goto restart;
 	}
@@ -5124,6 +5253,10 @@ restart:
 	/* Don't leak the old values of these bitmaps, if any */
 	bms_free(relation->rd_indexattr);
 	relation->rd_indexattr = NULL;
+	bms_free(relation->rd_hotblockingattr);
+	relation->rd_hotblockingattr = NULL;
+	bms_free(relation->rd_summarizedattr);
+	relation->rd_summarizedattr = NULL;
 	bms_free(relation->rd_keyattr);
 	relation->rd_keyattr = NULL;
 	bms_free(relation->rd_pkattr);
@@ -5142,6 +5275,8 @@ restart:
 	relation->rd_keyattr = bms_copy(uindexattrs);
 	relation->rd_pkattr = bms_copy(pkindexattrs);
 	relation->rd_idattr = bms_copy(idindexattrs);
+	relation->rd_hotblockingattr = bms_copy(hotblockingattrs);
+	relation->rd_summarizedattr = bms_copy(summarizedattrs);
 	relation->rd_indexattr = bms_copy(indexattrs);
 	MemoryContextSwitchTo(oldcxt);
 
@@ -5150,6 +5285,10 @@ restart:
 	{
 		case INDEX_ATTR_BITMAP_ALL:
 			return indexattrs;
+		case INDEX_ATTR_BITMAP_HOT_BLOCKING:
+			return hotblockingattrs;
+		case INDEX_ATTR_BITMAP_SUMMARIZED:
+			return summarizedattrs;
 		case INDEX_ATTR_BITMAP_KEY:
 			return uindexattrs;
 		case INDEX_ATTR_BITMAP_PRIMARY_KEY:
@@ -5607,8 +5746,12 @@ errtableconstraint(Relation rel, const char *conname)
 static bool
 load_relcache_init_file(bool shared)
 {
-	FILE	   *fp;
+	int			fd;
+	struct stat st;
 	char		initfilename[MAXPGPATH];
+	char	   *buf;
+	char	   *pos;
+	char	   *end;
 	Relation   *rels;
 	int			relno,
 				num_rels,
@@ -5625,10 +5768,31 @@ load_relcache_init_file(bool shared)
 		snprintf(initfilename, sizeof(initfilename), "%s/%s",
 				 DatabasePath, RELCACHE_INIT_FILENAME);
 
-	fp = AllocateFile(initfilename, PG_BINARY_R);
-	if (fp == NULL)
+	fd = OpenTransientFile(initfilename, O_RDONLY | PG_BINARY);
+	if (fd < 0)
 		return false;
 
+	/*
+	 * Slurp the whole file into memory with a single read, rather than
+	 * reading it item by item; it holds a few hundred entries, most of them
+	 * consisting of many small items.
+	 */
+	if (fstat(fd, &st) < 0 || st.st_size > MaxAllocSize)
+	{
+		CloseTransientFile(fd);
+		return false;
+	}
+	buf = palloc(st.st_size);
+	if (read(fd, buf, st.st_size) != st.st_size)
+	{
+		pfree(buf);
+		CloseTransientFile(fd);
+		return false;
+	}
+	CloseTransientFile(fd);
+	pos = buf;
+	end = buf + st.st_size;
+
 	/*
 	 * Read the index relcache entries from the file.  Note we will not enter
 	 * any of them into the cache if the read fails partway through; this
@@ -5640,7 +5804,7 @@ load_relcache_init_file(bool shared)
 	nailed_rels = nailed_indexes = 0;
 
 	/* check for correct magic number (compatible version) */
-	if (fread(&magic, 1, sizeof(magic), fp) != sizeof(magic))
+	if (!read_item(&pos, end, &magic, sizeof(magic)))
 		goto read_failed;
 	if (magic != RELCACHE_INIT_FILEMAGIC)
 		goto read_failed;
@@ -5648,19 +5812,15 @@ load_relcache_init_file(bool shared)
 	for (relno = 0;; relno++)
 	{
 		Size		len;
-		size_t		nread;
 		Relation	rel;
 		Form_pg_class relform;
 		bool		has_not_null;
 
 		/* first read the relation descriptor length */
-		nread = fread(&len, 1, sizeof(len), fp);
-		if (nread != sizeof(len))
-		{
-			if (nread == 0)
-				break;			/* end of file */
+		if (pos == end)
+			break;				/* end of file */
+		if (!read_item(&pos, end, &len, sizeof(len)))
 			goto read_failed;
-		}
 
 		/* safety check for incompatible relcache layout */
 		if (len != sizeof(RelationData))
@@ -5676,15 +5836,15 @@ load_relcache_init_file(bool shared)
 		rel = rels[num_rels++] = (Relation) palloc(len);
 
 		/* then, read the Relation structure */
-		if (fread(rel, 1, len, fp) != len)
+		if (!read_item(&pos, end, rel, len))
 			goto read_failed;
 
 		/* next read the relation tuple form */
-		if (fread(&len, 1, sizeof(len), fp) != sizeof(len))
+		if (!read_item(&pos, end, &len, sizeof(len)))
 			goto read_failed;
 
 		relform = (Form_pg_class) palloc(len);
-		if (fread(relform, 1, len, fp) != len)
+		if (!read_item(&pos, end, relform, len))
 			goto read_failed;
 
 		rel->rd_rel = relform;
@@ -5702,23 +5862,23 @@ load_relcache_init_file(bool shared)
 		{
 			Form_pg_attribute attr = TupleDescAttr(rel->rd_att, i);
 
-			if (fread(&len, 1, sizeof(len), fp) != sizeof(len))
+			if (!read_item(&pos, end, &len, sizeof(len)))
 				goto read_failed;
 			if (len != ATTRIBUTE_FIXED_PART_SIZE)
 				goto read_failed;
-			if (fread(attr, 1, len, fp) != len)
+			if (!read_item(&pos, end, attr, len))
 				goto read_failed;
 
 			has_not_null |= attr->attnotnull;
 		}
 
 		/* next read the access method specific field */
-		if (fread(&len, 1, sizeof(len), fp) != sizeof(len))
+		if (!read_item(&pos, end, &len, sizeof(len)))
 			goto read_failed;
 		if (len > 0)
 		{
 			rel->rd_options = palloc(len);
-			if (fread(rel->rd_options, 1, len, fp) != len)
+			if (!read_item(&pos, end, rel->rd_options, len))
 				goto read_failed;
 			if (len != VARSIZE(rel->rd_options))
 				goto read_failed;	/* sanity check */
@@ -5756,11 +5916,11 @@ load_relcache_init_file(bool shared)
 				nailed_indexes++;
 
 			/* next, read the pg_index tuple */
-			if (fread(&len, 1, sizeof(len), fp) != sizeof(len))
+			if (!read_item(&pos, end, &len, sizeof(len)))
 				goto read_failed;
 
 			rel->rd_indextuple = (HeapTuple) palloc(len);
-			if (fread(rel->rd_indextuple, 1, len, fp) != len)
+			if (!read_item(&pos, end, rel->rd_indextuple, len))
 				goto read_failed;
 
 			/* Fix up internal pointers in the tuple -- see heap_copytuple */
@@ -5787,50 +5947,50 @@ load_relcache_init_file(bool shared)
 			InitIndexAmRoutine(rel);
 
 			/* next, read the vector of opfamily OIDs */
-			if (fread(&len, 1, sizeof(len), fp) != sizeof(len))
+			if (!read_item(&pos, end, &len, sizeof(len)))
 				goto read_failed;
 
 			opfamily = (Oid *) MemoryContextAlloc(indexcxt, len);
-			if (fread(opfamily, 1, len, fp) != len)
+			if (!read_item(&pos, end, opfamily, len))
 				goto read_failed;
 
 			rel->rd_opfamily = opfamily;
 
 			/* next, read the vector of opcintype OIDs */
-			if (fread(&len, 1, sizeof(len), fp) != sizeof(len))
+			if (!read_item(&pos, end, &len, sizeof(len)))
 				goto read_failed;
 
 			opcintype = (Oid *) MemoryContextAlloc(indexcxt, len);
-			if (fread(opcintype, 1, len, fp) != len)
+			if (!read_item(&pos, end, opcintype, len))
 				goto read_failed;
 
 			rel->rd_opcintype = opcintype;
 
 			/* next, read the vector of support procedure OIDs */
-			if (fread(&len, 1, sizeof(len), fp) != sizeof(len))
+			if (!read_item(&pos, end, &len, sizeof(len)))
 				goto read_failed;
 			support = (RegProcedure *) MemoryContextAlloc(indexcxt, len);
-			if (fread(support, 1, len, fp) != len)
+			if (!read_item(&pos, end, support, len))
 				goto read_failed;
 
 			rel->rd_support = support;
 
 			/* next, read the vector of collation OIDs */
-			if (fread(&len, 1, sizeof(len), fp) != sizeof(len))
+			if (!read_item(&pos, end, &len, sizeof(len)))
 				goto read_failed;
 
 			indcollation = (Oid *) MemoryContextAlloc(indexcxt, len);
-			if (fread(indcollation, 1, len, fp) != len)
+			if (!read_item(&pos, end, indcollation, len))
 				goto read_failed;
 
 			rel->rd_indcollation = indcollation;
 
 			/* finally, read the vector of indoption values */
-			if (fread(&len, 1, sizeof(len), fp) != sizeof(len))
+			if (!read_item(&pos, end, &len, sizeof(len)))
 				goto read_failed;
 
 			indoption = (int16 *) MemoryContextAlloc(indexcxt, len);
-			if (fread(indoption, 1, len, fp) != len)
+			if (!read_item(&pos, end, indoption, len))
 				goto read_failed;
 
 			rel->rd_indoption = indoption;
@@ -5841,13 +6001,13 @@ load_relcache_init_file(bool shared)
 
 			for (i = 0; i < relform->relnatts; i++)
 			{
-				if (fread(&len, 1, sizeof(len), fp) != sizeof(len))
+				if (!read_item(&pos, end, &len, sizeof(len)))
 					goto read_failed;
 
 				if (len > 0)
 				{
 					rel->rd_opcoptions[i] = (bytea *) MemoryContextAlloc(indexcxt, len);
-					if (fread(rel->rd_opcoptions[i], 1, len, fp) != len)
+					if (!read_item(&pos, end, rel->rd_opcoptions[i], len))
 						goto read_failed;
 				}
 			}
@@ -5922,6 +6082,8 @@ load_relcache_init_file(bool shared)
 		rel->rd_pkindex = InvalidOid;
 		rel->rd_replidindex = InvalidOid;
 		rel->rd_indexattr = NULL;
+		rel->rd_hotblockingattr = NULL;
+		rel->rd_summarizedattr = NULL;
 		rel->rd_keyattr = NULL;
 		rel->rd_pkattr = NULL;
 		rel->rd_idattr = NULL;
@@ -5996,7 +6158,7 @@ load_relcache_init_file(bool shared)
 	}
 
 	pfree(rels);
-	FreeFile(fp);
+	pfree(buf);
 
 	if (shared)
 		criticalSharedRelcachesBuilt = true;
@@ -6011,7 +6173,7 @@ load_relcache_init_file(bool shared)
 	 */
 read_failed:
 	pfree(rels);
-	FreeFile(fp);
+	pfree(buf);
 
 	return false;
 }
@@ -6027,7 +6189,7 @@ write_relcache_init_file(bool shared)
 	char		tempfilename[MAXPGPATH];
 	char		finalfilename[MAXPGPATH];
 	int			magic;
-	HASH_SEQ_STATUS status;
+	relidcache_iterator status;
 	RelIdCacheEnt *idhentry;
 	int			i;
 
@@ -6086,9 +6248,9 @@ write_relcache_init_file(bool shared)
 	/*
 	 * Write all the appropriate reldescs (in no particular order).
 	 */
-	hash_seq_init(&status, RelationIdCache);
+	relidcache_start_iterate(RelationIdCache, &status);
 
-	while ((idhentry = (RelIdCacheEnt *) hash_seq_search(&status)) != NULL)
+	while ((idhentry = relidcache_iterate(RelationIdCache, &status)) != NULL)
 	{
 		Relation	rel = idhentry->reldesc;
 		Form_pg_class relform = rel->rd_rel;
@@ -6227,6 +6389,20 @@ write_relcache_init_file(bool shared)
 	LWLockRelease(RelCacheInitLock);
 }
 
+/*
+ * copy the next "len" bytes of an init file read into memory to "data", and
+ * advance "pos" past them; returns false if there aren't that many left
+ */
+static bool
+read_item(char **pos, const char *end, void *data, Size len)
+{
+	if ((Size) (end - *pos) < len)
+		return false;
+	memcpy(data, *pos, len);
+	*pos += len;
+	return true;
+}
+
 /* write a chunk of data preceded by its length */
 static void
 write_item(const void *data, Size len, FILE *fp)
@@ -0,0 +1,630 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.c
+ *	  Catalog cache entries shared between backends
+ *
+ * Every backend fills its own catalog caches, so each new connection has to
+ * search the catalogs again for the same pg_class, pg_attribute, pg_proc,
+ * etc. rows that other backends already have cached.  With many short-lived
+ * or pooled connections, that costs a lot of catalog index scans and memory.
+ * When shared_catcache_size is set, the tuples loaded into the local caches
+ * are also stored in a DSA area carved out of the main shared memory
+ * segment, and a backend that misses in its local cache looks there before
+ * searching the catalog.  The local caches stay as they are and keep
+ * serving most lookups; this is only a second level behind them.
+ *
+ * Entries are keyed by database (InvalidOid for shared catalogs), cache ID
+ * and the hash value of the search keys, and hold all tuples found under
+ * that hash value; catcache.c compares the keys of fetched tuples just as
+ * it does for its own entries.  Only the results of exact-match searches
+ * are shared: list searches and negative entries stay local, as their
+ * validity depends on the absence of tuples, which invalidation messages
+ * don't tell us about reliably enough.
+ *
+ * Shared entries are removed by the backend that commits the catalog
+ * changes they depend on: AtEOXact_Inval hands us the invalidation messages
+ * before sending them to other backends, and catcache messages identify
+ * exactly the entries to remove.  Each such commit also advances a
+ * generation counter, and a backend only stores a tuple if the counter
+ * hasn't moved since it looked for it, so that a tuple read with a snapshot
+ * older than a committed change is not stored after the change has removed
+ * its predecessor.  Transactions that have an XID may have changed the
+ * catalogs themselves, and logical decoding looks at them as of the past,
+ * so neither fetches nor stores shared entries.
+ *
+ * When the area or the hash table is full, the least recently used entries
+ * are evicted in batches to make room.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedcatcache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/xact.h"
+#include "miscadmin.h"
+#include "port/atomics.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/dsa.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/sharedcatcache.h"
+#include "utils/snapmgr.h"
+
+/* GUC variable */
+int			shared_catcache_size = 0;
+
+/* assumed average size of an entry, used to size the hash table */
+#define SCC_AVERAGE_ENTRY_SIZE	256
+
+/* tuples bigger than this fraction of the area are not stored */
+#define SCC_MAX_ENTRY_FRACTION	64
+
+/* fraction of the entries evicted at a time when room is needed */
+#define SCC_EVICT_FRACTION		8
+
+typedef struct SharedCatCacheKey
+{
+	Oid			dbid;			/* InvalidOid for shared catalogs */
+	int			cacheId;
+	uint32		hashValue;
+} SharedCatCacheKey;
+
+/*
+ * The entry's data is a single DSA chunk containing ntuples tuples, each
+ * one a SharedCatTuple followed by the tuple's t_len bytes of data, padded
+ * to a MAXALIGN boundary.
+ */
+typedef struct SharedCatCacheEntry
+{
+	SharedCatCacheKey key;		/* hash key --- must be first */
+	Oid			reloid;			/* catalog the tuples belong to */
+	dsa_pointer data;
+	Size		size;			/* size of the data */
+	int			ntuples;
+	pg_atomic_uint64 last_used; /* value of SharedCatCacheCtl->clock */
+} SharedCatCacheEntry;
+
+typedef struct SharedCatTuple
+{
+	uint32		t_len;
+	ItemPointerData t_self;
+	Oid			t_tableOid;
+} SharedCatTuple;
+
+#define SCC_TUPLE_SIZE(len) \
+	(MAXALIGN(sizeof(SharedCatTuple)) + MAXALIGN(len))
+
+/*
+ * SharedCatCacheLock protects the hash table, the contents of the area and
+ * the generation counter.  The clock is advanced and entries' last_used set
+ * while holding it only in shared mode.
+ */
+typedef struct SharedCatCacheCtl
+{
+	uint64		generation;
+	int			num_entries;
+	pg_atomic_uint64 clock;
+	char		area[FLEXIBLE_ARRAY_MEMBER];	/* in-place DSA area */
+} SharedCatCacheCtl;
+
+static SharedCatCacheCtl *SharedCatCache = NULL;
+static HTAB *SharedCatCacheHash = NULL;
+static dsa_area *SharedCatCacheArea = NULL;
+
+static Size SharedCatCacheAreaSize(void);
+static int	SharedCatCacheMaxEntries(void);
+static void compute_key(CatCache *cache, uint32 hashValue,
+						SharedCatCacheKey *key);
+static void attach_area(void);
+static void remove_entry(SharedCatCacheEntry *entry);
+static bool evict_entries(void);
+
+/*
+ * Size of the DSA area
+ */
+static Size
+SharedCatCacheAreaSize(void)
+{
+	return Max(mul_size(shared_catcache_size, 1024), dsa_minimum_size());
+}
+
+/*
+ * Number of entries the hash table is sized for
+ */
+static int
+SharedCatCacheMaxEntries(void)
+{
+	return Max(SharedCatCacheAreaSize() / SCC_AVERAGE_ENTRY_SIZE, 256);
+}
+
+/*
+ * Estimate space needed for the shared catalog cache
+ */
+Size
+SharedCatCacheShmemSize(void)
+{
+	Size		size;
+
+	if (shared_catcache_size == 0)
+		return 0;
+
+	size = add_size(offsetof(SharedCatCacheCtl, area),
+					SharedCatCacheAreaSize());
+	size = MAXALIGN(size);
+	size = add_size(size, hash_estimate_size(SharedCatCacheMaxEntries(),
+											 sizeof(SharedCatCacheEntry)));
+	return size;
+}
+
+/*
+ * Allocate and initialize the shared catalog cache
+ */
+void
+SharedCatCacheShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+	int			max_entries;
+
+	if (shared_catcache_size == 0)
+		return;
+
+	SharedCatCache = (SharedCatCacheCtl *)
+		ShmemInitStruct("Shared Catalog Cache",
+						add_size(offsetof(SharedCatCacheCtl, area),
+								 SharedCatCacheAreaSize()),
+						&found);
+
+	if (!found)
+	{
+		dsa_area   *area;
+
+		SharedCatCache->generation = 0;
+		SharedCatCache->num_entries = 0;
+		pg_atomic_init_u64(&SharedCatCache->clock, 0);
+
+		/* as in SharedPlanCacheShmemInit */
+		area = dsa_create_in_place(SharedCatCache->area,
+								   SharedCatCacheAreaSize(),
+								   LWTRANCHE_SHARED_CATCACHE_DSA, NULL);
+		dsa_set_size_limit(area, SharedCatCacheAreaSize());
+		dsa_pin(area);
+		dsa_detach(area);
+	}
+
+	max_entries = SharedCatCacheMaxEntries();
+	info.keysize = sizeof(SharedCatCacheKey);
+	info.entrysize = sizeof(SharedCatCacheEntry);
+
+	SharedCatCacheHash = ShmemInitHash("Shared Catalog Cache Hash",
+									   max_entries, max_entries,
+									   &info,
+									   HASH_ELEM | HASH_BLOBS);
+}
+
+/*
+ * Attach to the DSA area for the rest of this backend's life
+ */
+static void
+attach_area(void)
+{
+	MemoryContext oldcxt;
+
+	if (SharedCatCacheArea != NULL)
+		return;
+
+	oldcxt = MemoryContextSwitchTo(TopMemoryContext);
+	SharedCatCacheArea = dsa_attach_in_place(SharedCatCache->area, NULL);
+	dsa_pin_mapping(SharedCatCacheArea);
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * SharedCatCacheUsable
+ *		Can this backend fetch and store shared entries, right now?
+ */
+bool
+SharedCatCacheUsable(void)
+{
+	if (SharedCatCache == NULL ||
+		!IsUnderPostmaster ||
+		!IsNormalProcessingMode())
+		return false;
+
+	/* we might be looking at catalog changes that others can't see yet */
+	if (TransactionIdIsValid(GetTopTransactionIdIfAny()))
+		return false;
+
+	/* logical decoding looks at the catalogs as they were in the past */
+	if (HistoricSnapshotActive())
+		return false;
+
+	return true;
+}
+
+/*
+ * Compute the hash key for a search of the given cache
+ */
+static void
+compute_key(CatCache *cache, uint32 hashValue, SharedCatCacheKey *key)
+{
+	MemSet(key, 0, sizeof(SharedCatCacheKey));
+	key->dbid = cache->cc_relisshared ? InvalidOid : MyDatabaseId;
+	key->cacheId = cache->id;
+	key->hashValue = hashValue;
+}
+
+/*
+ * SharedCatCacheFetch
+ *		Look for shared tuples with the given hash value
+ *
+ * Returns a list of tuples, copied into the current memory context, whose
+ * search keys have the given hash value; it is up to the caller to check
+ * which of them, if any, match its keys.  If there is none, the caller
+ * should search the catalog with a snapshot taken after this call, and
+ * pass what it finds, together with *generation, to SharedCatCacheStore.
+ *
+ * The caller must have checked SharedCatCacheUsable().
+ */
+List *
+SharedCatCacheFetch(CatCache *cache, uint32 hashValue, uint64 *generation)
+{
+	SharedCatCacheKey key;
+	SharedCatCacheEntry *entry;
+	List	   *result = NIL;
+
+	Assert(SharedCatCacheUsable());
+
+	attach_area();
+	compute_key(cache, hashValue, &key);
+
+	LWLockAcquire(SharedCatCacheLock, LW_SHARED);
+
+	*generation = SharedCatCache->generation;
+
+	entry = (SharedCatCacheEntry *) hash_search(SharedCatCacheHash, &key,
+												HASH_FIND, NULL);
+
+	if (entry != NULL)
+	{
+		char	   *data = dsa_get_address(SharedCatCacheArea, entry->data);
+		int			i;
+
+		for (i = 0; i < entry->ntuples; i++)
+		{
+			SharedCatTuple stup;
+			HeapTuple	tuple;
+
+			memcpy(&stup, data, sizeof(SharedCatTuple));
+			data += MAXALIGN(sizeof(SharedCatTuple));
+
+			/* build a tuple in one palloc, as heap_copytuple does */
+			tuple = (HeapTuple) palloc(HEAPTUPLESIZE + stup.t_len);
+			tuple->t_len = stup.t_len;
+			tuple->t_self = stup.t_self;
+			tuple->t_tableOid = stup.t_tableOid;
+			tuple->t_data = (HeapTupleHeader) ((char *) tuple + HEAPTUPLESIZE);
+			memcpy(tuple->t_data, data, stup.t_len);
+			data += MAXALIGN(stup.t_len);
+
+			result = lappend(result, tuple);
+		}
+
+		pg_atomic_write_u64(&entry->last_used,
+							pg_atomic_add_fetch_u64(&SharedCatCache->clock, 1));
+	}
+
+	LWLockRelease(SharedCatCacheLock);
+
+	return result;
+}
+
+/*
+ * SharedCatCacheStore
+ *		Offer a tuple just read from the catalog to other backends
+ *
+ * generation is the value SharedCatCacheFetch returned before the catalog
+ * was searched.  The tuple must not have any toasted fields.  It is
+ * silently not stored if it's too big or no room can be made for it.
+ */
+void
+SharedCatCacheStore(CatCache *cache, uint32 hashValue, HeapTuple tuple,
+					uint64 generation)
+{
+	SharedCatCacheKey key;
+	SharedCatCacheEntry *entry;
+	SharedCatTuple stup;
+	Size		old_size = 0;
+	Size		size;
+	dsa_pointer dp = InvalidDsaPointer;
+	char	   *data;
+	bool		found;
+
+	Assert(!HeapTupleHasExternal(tuple));
+
+	if (!SharedCatCacheUsable())
+		return;
+
+	if (SCC_TUPLE_SIZE(tuple->t_len) >
+		SharedCatCacheAreaSize() / SCC_MAX_ENTRY_FRACTION)
+		return;
+
+	attach_area();
+	compute_key(cache, hashValue, &key);
+
+	LWLockAcquire(SharedCatCacheLock, LW_EXCLUSIVE);
+
+	/*
+	 * If catalog changes were committed since the caller started, the tuple
+	 * might already be outdated, and we can't tell, so forget it.
+	 */
+	if (SharedCatCache->generation != generation)
+	{
+		LWLockRelease(SharedCatCacheLock);
+		return;
+	}
+
+	/*
+	 * There might be an entry for other tuples with the same hash value
+	 * already.  Unless somebody else already stored this very tuple, we add
+	 * it to them.
+	 */
+	entry = (SharedCatCacheEntry *) hash_search(SharedCatCacheHash, &key,
+												HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		int			i;
+
+		data = dsa_get_address(SharedCatCacheArea, entry->data);
+		for (i = 0; i < entry->ntuples; i++)
+		{
+			memcpy(&stup, data, sizeof(SharedCatTuple));
+			if (ItemPointerEquals(&stup.t_self, &tuple->t_self))
+			{
+				LWLockRelease(SharedCatCacheLock);
+				return;
+			}
+			data += SCC_TUPLE_SIZE(stup.t_len);
+		}
+		old_size = entry->size;
+	}
+
+	size = old_size + SCC_TUPLE_SIZE(tuple->t_len);
+
+	/* Make room if needed */
+	while ((entry == NULL &&
+			SharedCatCache->num_entries >= SharedCatCacheMaxEntries()) ||
+		   !DsaPointerIsValid(dp = dsa_allocate_extended(SharedCatCacheArea,
+														 size,
+														 DSA_ALLOC_NO_OOM)))
+	{
+		/*
+		 * Evicting might remove the entry we're about to extend, so give up
+		 * on its other tuples first.
+		 */
+		if (entry != NULL)
+		{
+			remove_entry(entry);
+			entry = NULL;
+			old_size = 0;
+			size = SCC_TUPLE_SIZE(tuple->t_len);
+			continue;
+		}
+
+		if (!evict_entries())
+			break;
+	}
+
+	if (!DsaPointerIsValid(dp))
+	{
+		LWLockRelease(SharedCatCacheLock);
+		return;
+	}
+
+	if (entry == NULL)
+	{
+		entry = (SharedCatCacheEntry *) hash_search(SharedCatCacheHash, &key,
+													HASH_ENTER_NULL, &found);
+		if (entry == NULL)
+		{
+			dsa_free(SharedCatCacheArea, dp);
+			LWLockRelease(SharedCatCacheLock);
+			return;
+		}
+		Assert(!found);
+
+		entry->reloid = cache->cc_reloid;
+		entry->data = InvalidDsaPointer;
+		entry->size = 0;
+		entry->ntuples = 0;
+		pg_atomic_init_u64(&entry->last_used, 0);
+		SharedCatCache->num_entries++;
+	}
+
+	data = dsa_get_address(SharedCatCacheArea, dp);
+	if (DsaPointerIsValid(entry->data))
+	{
+		memcpy(data, dsa_get_address(SharedCatCacheArea, entry->data),
+			   entry->size);
+		dsa_free(SharedCatCacheArea, entry->data);
+	}
+
+	stup.t_len = tuple->t_len;
+	stup.t_self = tuple->t_self;
+	stup.t_tableOid = tuple->t_tableOid;
+	memcpy(data + entry->size, &stup, sizeof(SharedCatTuple));
+	memcpy(data + entry->size + MAXALIGN(sizeof(SharedCatTuple)),
+		   tuple->t_data, tuple->t_len);
+
+	entry->data = dp;
+	entry->size = size;
+	entry->ntuples++;
+	pg_atomic_write_u64(&entry->last_used,
+						pg_atomic_add_fetch_u64(&SharedCatCache->clock, 1));
+
+	LWLockRelease(SharedCatCacheLock);
+}
+
+/*
+ * Remove an entry; caller must hold SharedCatCacheLock exclusively
+ */
+static void
+remove_entry(SharedCatCacheEntry *entry)
+{
+	if (DsaPointerIsValid(entry->data))
+		dsa_free(SharedCatCacheArea, entry->data);
+	hash_search(SharedCatCacheHash, &entry->key, HASH_REMOVE, NULL);
+	SharedCatCache->num_entries--;
+}
+
+/*
+ * Evict the least recently used entries; caller must hold SharedCatCacheLock
+ * exclusively.  Returns false if there were none.
+ *
+ * There can be many more entries than in the shared plan cache, so rather
+ * than scanning them all for each one to evict, we evict in one pass the
+ * entries that were not used during the last so many ticks of the clock.
+ * As each tick marks one entry as used, at least 1/SCC_EVICT_FRACTION of
+ * the entries go.
+ */
+static bool
+evict_entries(void)
+{
+	HASH_SEQ_STATUS status;
+	SharedCatCacheEntry *entry;
+	uint64		clock;
+	uint64		keep;
+	uint64		threshold;
+	int			nevicted = 0;
+
+	if (SharedCatCache->num_entries == 0)
+		return false;
+
+	clock = pg_atomic_read_u64(&SharedCatCache->clock);
+	keep = SharedCatCache->num_entries -
+		Max(SharedCatCache->num_entries / SCC_EVICT_FRACTION, 1);
+	threshold = (clock > keep) ? clock - keep : 0;
+
+	hash_seq_init(&status, SharedCatCacheHash);
+	while ((entry = (SharedCatCacheEntry *) hash_seq_search(&status)) != NULL)
+	{
+		/* removing the current entry is allowed during a seq scan */
+		if (pg_atomic_read_u64(&entry->last_used) <= threshold)
+		{
+			remove_entry(entry);
+			nevicted++;
+		}
+	}
+
+	return nevicted > 0;
+}
+
+/*
+ * SharedCatCacheInvalidate
+ *		Remove the shared entries affected by committed catalog changes
+ *
+ * Called by AtEOXact_Inval with the messages it's about to send, before the
+ * committing transaction releases its locks, and by the startup process
+ * with the messages of transactions replayed in hot standby.
+ */
+void
+SharedCatCacheInvalidate(const SharedInvalidationMessage *msgs, int n)
+{
+	bool		relevant = false;
+	int			i;
+
+	if (SharedCatCache == NULL)
+		return;
+
+	for (i = 0; i < n; i++)
+	{
+		if (msgs[i].id >= 0 || msgs[i].id == SHAREDINVALCATALOG_ID)
+		{
+			relevant = true;
+			break;
+		}
+	}
+	if (!relevant)
+		return;
+
+	attach_area();
+
+	LWLockAcquire(SharedCatCacheLock, LW_EXCLUSIVE);
+
+	SharedCatCache->generation++;
+
+	for (i = 0; i < n && SharedCatCache->num_entries > 0; i++)
+	{
+		const SharedInvalidationMessage *msg = &msgs[i];
+
+		if (msg->id >= 0)
+		{
+			SharedCatCacheKey key;
+			SharedCatCacheEntry *entry;
+
+			MemSet(&key, 0, sizeof(SharedCatCacheKey));
+			key.dbid = msg->cc.dbId;
+			key.cacheId = msg->cc.id;
+			key.hashValue = msg->cc.hashValue;
+
+			entry = (SharedCatCacheEntry *) hash_search(SharedCatCacheHash,
+														&key, HASH_FIND,
+														NULL);
+			if (entry != NULL)
+				remove_entry(entry);
+		}
+		else if (msg->id == SHAREDINVALCATALOG_ID)
+		{
+			HASH_SEQ_STATUS status;
+			SharedCatCacheEntry *entry;
+
+			/* this is rare, see CacheInvalidateCatalog */
+			hash_seq_init(&status, SharedCatCacheHash);
+			while ((entry = (SharedCatCacheEntry *) hash_seq_search(&status)) != NULL)
+			{
+				if (entry->reloid == msg->cat.catId &&
+					entry->key.dbid == msg->cat.dbId)
+					remove_entry(entry);
+			}
+		}
+	}
+
+	LWLockRelease(SharedCatCacheLock);
+}
+
+/*
+ * SharedCatCacheDropDatabase
+ *		Remove the shared entries of a database being dropped
+ *
+ * Its OID might be reused later, by a database with different catalogs.
+ */
+void
+SharedCatCacheDropDatabase(Oid dbid)
+{
+	HASH_SEQ_STATUS status;
+	SharedCatCacheEntry *entry;
+
+	if (SharedCatCache == NULL)
+		return;
+
+	attach_area();
+
+	LWLockAcquire(SharedCatCacheLock, LW_EXCLUSIVE);
+
+	hash_seq_init(&status, SharedCatCacheHash);
+	while ((entry = (SharedCatCacheEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (entry->key.dbid == dbid)
+			remove_entry(entry);
+	}
+
+	LWLockRelease(SharedCatCacheLock);
+}
@@ -0,0 +1,665 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.c
+ *	  Generic plans shared between backends
+ *
+ * Every backend keeps its own CachedPlanSources and CachedPlans, so when
+ * many pooled connections prepare the same statements, each of them plans
+ * every statement again.  When shared_plan_cache_size is set, the generic
+ * plans built for saved CachedPlanSources are also stored, in nodeToString()
+ * form, in a DSA area carved out of the main shared memory segment, and a
+ * backend about to build a generic plan first looks for one there.
+ *
+ * Entries are keyed by a hash of the query text, the search path in effect
+ * (including any temp namespace), the current user, the database, the
+ * parameter types and the cursor options; the query text itself is stored
+ * too and compared on lookup.  Only plans that don't depend on anything
+ * else are shared: plan sources using parser hooks (as PL/pgSQL's do) or a
+ * query environment, plans whose rewrite depended on row level security,
+ * transient plans, utility statements and plans using temporary tables are
+ * never stored.  Planner settings are not part of the key, so a backend may
+ * get a plan that was made with different ones.
+ *
+ * Only the planning is shared: each backend still parses and analyzes its
+ * own statements, and a fetched plan is deserialized into an ordinary
+ * backend-local CachedPlan, since the executor needs a private copy of the
+ * plan tree anyway.  From then on, the usual invalidation callbacks in
+ * plancache.c take care of it.
+ *
+ * Shared entries are removed by the backend that commits the catalog
+ * changes they depend on: AtEOXact_Inval hands us the invalidation messages
+ * before sending them to other backends, and we remove the entries whose
+ * relation OIDs or PlanInvalItems match, much as PlanCacheRelCallback and
+ * friends do for local plans.  Each such commit
+ * also advances a generation counter, and a backend only stores a plan if
+ * the counter hasn't moved since it started looking for one, so that plans
+ * made with catalog contents older than a committed change are not stored
+ * after the change has removed their predecessors.  Transactions that have
+ * an XID may have changed the catalogs themselves, so they neither fetch
+ * nor store shared plans.
+ *
+ * When the area or the hash table is full, the least recently used entries
+ * are evicted to make room.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedplancache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/xact.h"
+#include "catalog/namespace.h"
+#include "catalog/pg_class.h"
+#include "common/hashfn.h"
+#include "miscadmin.h"
+#include "nodes/plannodes.h"
+#include "port/atomics.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/dsa.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/sharedplancache.h"
+#include "utils/syscache.h"
+
+/* GUC variable */
+int			shared_plan_cache_size = 0;
+
+/* assumed average size of an entry, used to size the hash table */
+#define SPC_AVERAGE_ENTRY_SIZE	4096
+
+/* plans bigger than this fraction of the area are not stored */
+#define SPC_MAX_ENTRY_FRACTION	8
+
+typedef struct SharedPlanKey
+{
+	Oid			dbid;
+	Oid			userid;
+	int			cursor_options;
+	int			num_params;
+	uint64		query_hash;		/* hash of the query text */
+	uint64		search_path_hash;	/* hash of the namespace OIDs */
+	uint64		params_hash;	/* hash of the parameter type OIDs */
+} SharedPlanKey;
+
+/*
+ * The entry's data is a single DSA chunk containing, in this order, nrelids
+ * relation OIDs, nitems SharedPlanInvalItems, the NUL-terminated query text
+ * and the NUL-terminated nodeToString() output of the statement list.
+ */
+typedef struct SharedPlanEntry
+{
+	SharedPlanKey key;			/* hash key --- must be first */
+	dsa_pointer data;
+	int			nrelids;
+	int			nitems;
+	Size		query_len;		/* strlen() of the query text */
+	pg_atomic_uint64 last_used; /* value of SharedPlanCacheCtl->clock */
+} SharedPlanEntry;
+
+typedef struct SharedPlanInvalItem
+{
+	int			cacheId;
+	uint32		hashValue;
+} SharedPlanInvalItem;
+
+/*
+ * SharedPlanCacheLock protects the hash table, the contents of the area and
+ * the generation counter.  The clock is advanced and entries' last_used set
+ * while holding it only in shared mode.
+ */
+typedef struct SharedPlanCacheCtl
+{
+	uint64		generation;
+	int			num_entries;
+	pg_atomic_uint64 clock;
+	char		area[FLEXIBLE_ARRAY_MEMBER];	/* in-place DSA area */
+} SharedPlanCacheCtl;
+
+static SharedPlanCacheCtl *SharedPlanCache = NULL;
+static HTAB *SharedPlanHash = NULL;
+static dsa_area *SharedPlanArea = NULL;
+
+static Size SharedPlanAreaSize(void);
+static int	SharedPlanMaxEntries(void);
+static bool plansource_is_shareable(CachedPlanSource *plansource);
+static void compute_key(CachedPlanSource *plansource, SharedPlanKey *key);
+static void attach_area(void);
+static void remove_entry(SharedPlanEntry *entry);
+static bool evict_entry(void);
+static bool entry_matches_messages(SharedPlanEntry *entry,
+								   const SharedInvalidationMessage *msgs,
+								   int n);
+
+/*
+ * Size of the DSA area
+ */
+static Size
+SharedPlanAreaSize(void)
+{
+	return Max(mul_size(shared_plan_cache_size, 1024), dsa_minimum_size());
+}
+
+/*
+ * Number of entries the hash table is sized for
+ */
+static int
+SharedPlanMaxEntries(void)
+{
+	return Max(SharedPlanAreaSize() / SPC_AVERAGE_ENTRY_SIZE, 64);
+}
+
+/*
+ * Estimate space needed for the shared plan cache
+ */
+Size
+SharedPlanCacheShmemSize(void)
+{
+	Size		size;
+
+	if (shared_plan_cache_size == 0)
+		return 0;
+
+	size = add_size(offsetof(SharedPlanCacheCtl, area), SharedPlanAreaSize());
+	size = MAXALIGN(size);
+	size = add_size(size, hash_estimate_size(SharedPlanMaxEntries(),
+											 sizeof(SharedPlanEntry)));
+	return size;
+}
+
+/*
+ * Allocate and initialize the shared plan cache
+ */
+void
+SharedPlanCacheShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+	int			max_entries;
+
+	if (shared_plan_cache_size == 0)
+		return;
+
+	SharedPlanCache = (SharedPlanCacheCtl *)
+		ShmemInitStruct("Shared Plan Cache",
+						add_size(offsetof(SharedPlanCacheCtl, area),
+								 SharedPlanAreaSize()),
+						&found);
+
+	if (!found)
+	{
+		dsa_area   *area;
+
+		SharedPlanCache->generation = 0;
+		SharedPlanCache->num_entries = 0;
+		pg_atomic_init_u64(&SharedPlanCache->clock, 0);
+
+		/*
+		 * Create the area, and keep it from ever growing beyond the space
+		 * we just reserved for it.  Backends attach to it when they first
+		 * need it; our handle is of no further use.
+		 */
+		area = dsa_create_in_place(SharedPlanCache->area, SharedPlanAreaSize(),
+								   LWTRANCHE_SHARED_PLAN_CACHE_DSA, NULL);
+		dsa_set_size_limit(area, SharedPlanAreaSize());
+		dsa_pin(area);
+		dsa_detach(area);
+	}
+
+	max_entries = SharedPlanMaxEntries();
+	info.keysize = sizeof(SharedPlanKey);
+	info.entrysize = sizeof(SharedPlanEntry);
+
+	SharedPlanHash = ShmemInitHash("Shared Plan Cache Hash",
+								   max_entries, max_entries,
+								   &info,
+								   HASH_ELEM | HASH_BLOBS);
+}
+
+/*
+ * Attach to the DSA area for the rest of this backend's life
+ */
+static void
+attach_area(void)
+{
+	MemoryContext oldcxt;
+
+	if (SharedPlanArea != NULL)
+		return;
+
+	oldcxt = MemoryContextSwitchTo(TopMemoryContext);
+	SharedPlanArea = dsa_attach_in_place(SharedPlanCache->area, NULL);
+	dsa_pin_mapping(SharedPlanArea);
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * Can generic plans for this plan source be shared at all, right now?
+ */
+static bool
+plansource_is_shareable(CachedPlanSource *plansource)
+{
+	if (SharedPlanCache == NULL)
+		return false;
+
+	if (!plansource->is_saved || plansource->is_oneshot ||
+		plansource->raw_parse_tree == NULL ||
+		plansource->query_string == NULL ||
+		plansource->parserSetup != NULL ||
+		plansource->dependsOnRLS)
+		return false;
+
+	/* we might be looking at catalog changes that others can't see yet */
+	if (TransactionIdIsValid(GetTopTransactionIdIfAny()))
+		return false;
+
+	return true;
+}
+
+/*
+ * Compute the hash key for a plan source in the current environment
+ */
+static void
+compute_key(CachedPlanSource *plansource, SharedPlanKey *key)
+{
+	List	   *search_path;
+	Oid		   *namespaces;
+	int			nnamespaces;
+	ListCell   *lc;
+	int			i;
+
+	MemSet(key, 0, sizeof(SharedPlanKey));
+	key->dbid = MyDatabaseId;
+	key->userid = GetUserId();
+	key->cursor_options = plansource->cursor_options;
+	key->num_params = plansource->num_params;
+	key->query_hash =
+		hash_bytes_extended((const unsigned char *) plansource->query_string,
+							strlen(plansource->query_string), 0);
+	if (plansource->num_params > 0)
+		key->params_hash =
+			hash_bytes_extended((const unsigned char *) plansource->param_types,
+								plansource->num_params * sizeof(Oid), 0);
+
+	/* this includes the temp namespace, if we have one */
+	search_path = fetch_search_path(true);
+	nnamespaces = list_length(search_path);
+	namespaces = (Oid *) palloc(Max(nnamespaces, 1) * sizeof(Oid));
+	i = 0;
+	foreach(lc, search_path)
+		namespaces[i++] = lfirst_oid(lc);
+	key->search_path_hash =
+		hash_bytes_extended((const unsigned char *) namespaces,
+							nnamespaces * sizeof(Oid), 0);
+	pfree(namespaces);
+	list_free(search_path);
+}
+
+/*
+ * SharedPlanCacheFetch
+ *		Look for a shared generic plan for the plan source
+ *
+ * Returns a freshly deserialized statement list in the current memory
+ * context, or NIL if there is none.  In the latter case, the caller should
+ * build the plan and pass it, together with *generation, to
+ * SharedPlanCacheStore.
+ */
+List *
+SharedPlanCacheFetch(CachedPlanSource *plansource, uint64 *generation)
+{
+	SharedPlanKey key;
+	SharedPlanEntry *entry;
+	char	   *plan_string = NULL;
+
+	*generation = 0;
+
+	if (!plansource_is_shareable(plansource))
+		return NIL;
+
+	attach_area();
+	compute_key(plansource, &key);
+
+	LWLockAcquire(SharedPlanCacheLock, LW_SHARED);
+
+	*generation = SharedPlanCache->generation;
+
+	entry = (SharedPlanEntry *) hash_search(SharedPlanHash, &key,
+											HASH_FIND, NULL);
+
+	if (entry != NULL)
+	{
+		char	   *data = dsa_get_address(SharedPlanArea, entry->data);
+		char	   *query_string;
+
+		query_string = data + entry->nrelids * sizeof(Oid) +
+			entry->nitems * sizeof(SharedPlanInvalItem);
+
+		/* guard against hash collisions on the query text */
+		if (strcmp(query_string, plansource->query_string) == 0)
+		{
+			plan_string = pstrdup(query_string + entry->query_len + 1);
+			pg_atomic_write_u64(&entry->last_used,
+								pg_atomic_add_fetch_u64(&SharedPlanCache->clock, 1));
+		}
+	}
+
+	LWLockRelease(SharedPlanCacheLock);
+
+	if (plan_string == NULL)
+		return NIL;
+
+	return (List *) stringToNode(plan_string);
+}
+
+/*
+ * SharedPlanCacheCheck
+ *		Recheck a fetched plan after locking the relations it uses
+ *
+ * A fetched plan can scan relations, such as partitions, that the plan
+ * source's query tree doesn't mention and that the caller therefore only
+ * locks after the fetch.  If catalog changes were committed meanwhile, the
+ * plan might be outdated, and we return false; *generation is then updated
+ * for the plan the caller is about to build instead.
+ */
+bool
+SharedPlanCacheCheck(uint64 *generation)
+{
+	bool		result;
+
+	LWLockAcquire(SharedPlanCacheLock, LW_SHARED);
+	result = (SharedPlanCache->generation == *generation);
+	*generation = SharedPlanCache->generation;
+	LWLockRelease(SharedPlanCacheLock);
+
+	return result;
+}
+
+/*
+ * SharedPlanCacheStore
+ *		Offer a newly built generic plan to other backends
+ *
+ * generation is the value SharedPlanCacheFetch returned before the plan
+ * was built.  The plan is silently not stored if it can't be shared or no
+ * room can be made for it.
+ */
+void
+SharedPlanCacheStore(CachedPlanSource *plansource, List *stmt_list,
+					 uint64 generation)
+{
+	SharedPlanKey key;
+	SharedPlanEntry *entry;
+	List	   *relids = NIL;
+	List	   *items = NIL;
+	char	   *plan_string;
+	Size		query_len;
+	Size		plan_len;
+	Size		size;
+	dsa_pointer dp = InvalidDsaPointer;
+	char	   *data;
+	ListCell   *lc;
+	bool		found;
+
+	if (!plansource_is_shareable(plansource))
+		return;
+
+	foreach(lc, stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+		ListCell   *lc2;
+
+		/* utility statements can't all be passed through nodeToString() */
+		if (plannedstmt->commandType == CMD_UTILITY ||
+			plannedstmt->transientPlan)
+			return;
+
+		foreach(lc2, plannedstmt->relationOids)
+		{
+			Oid			relid = lfirst_oid(lc2);
+
+			/* temp tables with this name are different in other sessions */
+			if (get_rel_persistence(relid) == RELPERSISTENCE_TEMP)
+				return;
+			relids = list_append_unique_oid(relids, relid);
+		}
+		items = list_concat(items, plannedstmt->invalItems);
+	}
+
+	query_len = strlen(plansource->query_string);
+	plan_string = nodeToString(stmt_list);
+	plan_len = strlen(plan_string);
+	size = list_length(relids) * sizeof(Oid) +
+		list_length(items) * sizeof(SharedPlanInvalItem) +
+		query_len + 1 + plan_len + 1;
+	if (size > SharedPlanAreaSize() / SPC_MAX_ENTRY_FRACTION)
+		return;
+
+	attach_area();
+	compute_key(plansource, &key);
+
+	LWLockAcquire(SharedPlanCacheLock, LW_EXCLUSIVE);
+
+	/*
+	 * If catalog changes were committed since the caller started, its plan
+	 * might already be outdated, and we can't tell, so forget it.  Also, if
+	 * somebody else got there first, we're done.
+	 */
+	if (SharedPlanCache->generation != generation ||
+		hash_search(SharedPlanHash, &key, HASH_FIND, NULL) != NULL)
+	{
+		LWLockRelease(SharedPlanCacheLock);
+		return;
+	}
+
+	/* Make room if needed */
+	while (SharedPlanCache->num_entries >= SharedPlanMaxEntries() ||
+		   !DsaPointerIsValid(dp = dsa_allocate_extended(SharedPlanArea, size,
+														 DSA_ALLOC_NO_OOM)))
+	{
+		if (!evict_entry())
+			break;
+	}
+
+	if (!DsaPointerIsValid(dp))
+	{
+		LWLockRelease(SharedPlanCacheLock);
+		return;
+	}
+
+	entry = (SharedPlanEntry *) hash_search(SharedPlanHash, &key,
+											HASH_ENTER_NULL, &found);
+	if (entry == NULL)
+	{
+		dsa_free(SharedPlanArea, dp);
+		LWLockRelease(SharedPlanCacheLock);
+		return;
+	}
+	Assert(!found);
+
+	data = dsa_get_address(SharedPlanArea, dp);
+	foreach(lc, relids)
+	{
+		*(Oid *) data = lfirst_oid(lc);
+		data += sizeof(Oid);
+	}
+	foreach(lc, items)
+	{
+		PlanInvalItem *item = lfirst_node(PlanInvalItem, lc);
+		SharedPlanInvalItem sitem;
+
+		sitem.cacheId = item->cacheId;
+		sitem.hashValue = item->hashValue;
+		memcpy(data, &sitem, sizeof(SharedPlanInvalItem));
+		data += sizeof(SharedPlanInvalItem);
+	}
+	memcpy(data, plansource->query_string, query_len + 1);
+	data += query_len + 1;
+	memcpy(data, plan_string, plan_len + 1);
+
+	entry->data = dp;
+	entry->nrelids = list_length(relids);
+	entry->nitems = list_length(items);
+	entry->query_len = query_len;
+	pg_atomic_init_u64(&entry->last_used,
+					   pg_atomic_add_fetch_u64(&SharedPlanCache->clock, 1));
+	SharedPlanCache->num_entries++;
+
+	LWLockRelease(SharedPlanCacheLock);
+
+	pfree(plan_string);
+	list_free(relids);
+	list_free(items);
+}
+
+/*
+ * Remove an entry; caller must hold SharedPlanCacheLock exclusively
+ */
+static void
+remove_entry(SharedPlanEntry *entry)
+{
+	dsa_free(SharedPlanArea, entry->data);
+	hash_search(SharedPlanHash, &entry->key, HASH_REMOVE, NULL);
+	SharedPlanCache->num_entries--;
+}
+
+/*
+ * Evict the least recently used entry; caller must hold SharedPlanCacheLock
+ * exclusively.  Returns false if there was none.
+ */
+static bool
+evict_entry(void)
+{
+	HASH_SEQ_STATUS status;
+	SharedPlanEntry *entry;
+	SharedPlanEntry *victim = NULL;
+	uint64		victim_used = PG_UINT64_MAX;
+
+	hash_seq_init(&status, SharedPlanHash);
+	while ((entry = (SharedPlanEntry *) hash_seq_search(&status)) != NULL)
+	{
+		uint64		used = pg_atomic_read_u64(&entry->last_used);
+
+		if (used < victim_used)
+		{
+			victim = entry;
+			victim_used = used;
+		}
+	}
+
+	if (victim == NULL)
+		return false;
+
+	remove_entry(victim);
+	return true;
+}
+
+/*
+ * Does any of the invalidation messages affect the entry?
+ *
+ * This must cover everything plancache.c's invalidation callbacks react to.
+ */
+static bool
+entry_matches_messages(SharedPlanEntry *entry,
+					   const SharedInvalidationMessage *msgs, int n)
+{
+	char	   *data = dsa_get_address(SharedPlanArea, entry->data);
+	Oid		   *relids = (Oid *) data;
+	SharedPlanInvalItem *items;
+	int			i,
+				j;
+
+	items = (SharedPlanInvalItem *) (data + entry->nrelids * sizeof(Oid));
+
+	for (i = 0; i < n; i++)
+	{
+		const SharedInvalidationMessage *msg = &msgs[i];
+
+		if (msg->id >= 0)
+		{
+			if (msg->cc.dbId != entry->key.dbid && msg->cc.dbId != InvalidOid)
+				continue;
+
+			/* see PlanCacheSysCallback */
+			if (msg->cc.id == NAMESPACEOID ||
+				msg->cc.id == OPEROID ||
+				msg->cc.id == AMOPOPID ||
+				msg->cc.id == FOREIGNSERVEROID ||
+				msg->cc.id == FOREIGNDATAWRAPPEROID)
+				return true;
+
+			for (j = 0; j < entry->nitems; j++)
+			{
+				SharedPlanInvalItem item;
+
+				memcpy(&item, &items[j], sizeof(SharedPlanInvalItem));
+				if (item.cacheId == msg->cc.id &&
+					(msg->cc.hashValue == 0 ||
+					 item.hashValue == msg->cc.hashValue))
+					return true;
+			}
+		}
+		else if (msg->id == SHAREDINVALCATALOG_ID)
+		{
+			if (msg->cat.dbId == entry->key.dbid ||
+				msg->cat.dbId == InvalidOid)
+				return true;
+		}
+		else if (msg->id == SHAREDINVALRELCACHE_ID)
+		{
+			if (msg->rc.dbId != entry->key.dbid && msg->rc.dbId != InvalidOid)
+				continue;
+
+			if (msg->rc.relId == InvalidOid)
+				return true;
+
+			for (j = 0; j < entry->nrelids; j++)
+			{
+				if (relids[j] == msg->rc.relId)
+					return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/*
+ * SharedPlanCacheInvalidate
+ *		Remove the shared plans affected by committed catalog changes
+ *
+ * Called by AtEOXact_Inval with the messages it's about to send, before the
+ * committing transaction releases its locks.
+ */
+void
+SharedPlanCacheInvalidate(const SharedInvalidationMessage *msgs, int n)
+{
+	HASH_SEQ_STATUS status;
+	SharedPlanEntry *entry;
+
+	if (SharedPlanCache == NULL)
+		return;
+
+	attach_area();
+
+	LWLockAcquire(SharedPlanCacheLock, LW_EXCLUSIVE);
+
+	SharedPlanCache->generation++;
+
+	if (SharedPlanCache->num_entries > 0)
+	{
+		hash_seq_init(&status, SharedPlanHash);
+		while ((entry = (SharedPlanEntry *) hash_seq_search(&status)) != NULL)
+		{
+			/* removing the current entry is allowed during a seq scan */
+			if (entry_matches_messages(entry, msgs, n))
+				remove_entry(entry);
+		}
+	}
+
+	LWLockRelease(SharedPlanCacheLock);
+}
@@ -1458,6 +1458,26 @@ SysCacheInvalidate(int cacheId, uint32 hashValue)
 	CatCacheInvalidate(SysCache[cacheId], hashValue);
 }
 
+/*
+ * SysCacheReset
+ *
+ *	Remove all entries from the specified cache.
+ *
+ *	This routine is only quasi-public: it should only be used by inval.c.
+ */
+void
+SysCacheReset(int cacheId)
+{
+	if (cacheId < 0 || cacheId >= SysCacheSize)
+		elog(ERROR, "invalid cache ID: %d", cacheId);
+
+	/* if this cache isn't initialized yet, no need to do anything */
+	if (!PointerIsValid(SysCache[cacheId]))
+		return;
+
+	ResetCatalogCache(SysCache[cacheId]);
+}
+
 /*
  * Certain relations that do not have system caches send snapshot invalidation
  * messages in lieu of catcache messages.  This is for the benefit of
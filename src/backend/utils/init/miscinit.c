@@ -117,9 +117,7 @@ InitPostmasterChild(void)
 	on_exit_reset();
 
 	/* Initialize process-local latch support */
-	InitializeLatchSupport();
-	MyLatch = &LocalLatchData;
-	InitLatch(MyLatch);
+	InitProcessLocalLatch();
 	InitializeLatchWaitSet();
 
 	/*
@@ -150,9 +148,7 @@ InitStandaloneProcess(const char *argv0)
 	InitProcessGlobals();
 
 	/* Initialize process-local latch support */
-	InitializeLatchSupport();
-	MyLatch = &LocalLatchData;
-	InitLatch(MyLatch);
+	InitProcessLocalLatch();
 	InitializeLatchWaitSet();
 
 	/* Compute paths, no postmaster to inherit from */
@@ -167,6 +163,20 @@ InitStandaloneProcess(const char *argv0)
 		get_pkglib_path(my_exec_path, pkglib_path);
 }
 
+/*
+ * Initialize latch support, and make MyLatch point to a process-local latch
+ *
+ * In a postmaster child, this replaces the latch and self-pipe inherited
+ * from the postmaster.
+ */
+void
+InitProcessLocalLatch(void)
+{
+	InitializeLatchSupport();
+	MyLatch = &LocalLatchData;
+	InitLatch(MyLatch);
+}
+
 void
 SwitchToSharedLatch(void)
 {
@@ -176,7 +186,8 @@ SwitchToSharedLatch(void)
 	MyLatch = &MyProc->procLatch;
 
 	if (FeBeWaitSet)
-		ModifyWaitEvent(FeBeWaitSet, 1, WL_LATCH_SET, MyLatch);
+		ModifyWaitEvent(FeBeWaitSet, FeBeWaitSetLatchPos, WL_LATCH_SET,
+						MyLatch);
 
 	/*
 	 * Set the shared latch as the local one might have been set. This
@@ -195,7 +206,8 @@ SwitchBackToLocalLatch(void)
 	MyLatch = &LocalLatchData;
 
 	if (FeBeWaitSet)
-		ModifyWaitEvent(FeBeWaitSet, 1, WL_LATCH_SET, MyLatch);
+		ModifyWaitEvent(FeBeWaitSet, FeBeWaitSetLatchPos, WL_LATCH_SET,
+						MyLatch);
 
 	SetLatch(MyLatch);
 }
@@ -246,6 +258,9 @@ GetBackendTypeDesc(BackendType backendType)
 		case B_STATS_COLLECTOR:
 			backendDesc = "stats collector";
 			break;
+		case B_PROXY:
+			backendDesc = "connection proxy";
+			break;
 		case B_LOGGER:
 			backendDesc = "logger";
 			break;
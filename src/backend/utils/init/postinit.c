@@ -68,6 +68,8 @@ static HeapTuple GetDatabaseTuple(const char *dbname);
 static HeapTuple GetDatabaseTupleByOid(Oid dboid);
 static void PerformAuthentication(Port *port);
 static void CheckMyDatabase(const char *name, bool am_superuser, bool override_allow_connections);
+static void AttachToDatabase(const char *dbname, bool bootstrap);
+static const char *PreforkConnectDatabase(const char *dbname);
 static void InitCommunication(void);
 static void ShutdownPostgres(int code, Datum arg);
 static void StatementTimeoutHandler(void);
@@ -429,6 +431,165 @@ CheckMyDatabase(const char *name, bool am_superuser, bool override_allow_connect
 
 
 
+/*
+ * AttachToDatabase -- advertise that we are using the database whose
+ *		MyDatabaseId and MyDatabaseTableSpace have been set up, and make sure
+ *		it is there
+ */
+static void
+AttachToDatabase(const char *dbname, bool bootstrap)
+{
+	char	   *fullpath;
+
+	/*
+	 * Now, take a writer's lock on the database we are trying to connect to.
+	 * If there is a concurrently running DROP DATABASE on that database, this
+	 * will block us until it finishes (and has committed its update of
+	 * pg_database).
+	 *
+	 * Note that the lock is not held long, only until the end of this startup
+	 * transaction.  This is OK since we will advertise our use of the
+	 * database in the ProcArray before dropping the lock (in fact, that's the
+	 * next thing to do).  Anyone trying a DROP DATABASE after this point will
+	 * see us in the array once they have the lock.  Ordering is important for
+	 * this because we don't want to advertise ourselves as being in this
+	 * database until we have the lock; otherwise we create what amounts to a
+	 * deadlock with CountOtherDBBackends().
+	 *
+	 * Note: use of RowExclusiveLock here is reasonable because we envision
+	 * our session as being a concurrent writer of the database.  If we had a
+	 * way of declaring a session as being guaranteed-read-only, we could use
+	 * AccessShareLock for such sessions and thereby not conflict against
+	 * CREATE DATABASE.
+	 */
+	if (!bootstrap)
+		LockSharedObject(DatabaseRelationId, MyDatabaseId, 0,
+						 RowExclusiveLock);
+
+	/*
+	 * Now we can mark our PGPROC entry with the database ID.
+	 *
+	 * We assume this is an atomic store so no lock is needed; though actually
+	 * things would work fine even if it weren't atomic.  Anyone searching the
+	 * ProcArray for this database's ID should hold the database lock, so they
+	 * would not be executing concurrently with this store.  A process looking
+	 * for another database's ID could in theory see a chance match if it read
+	 * a partially-updated databaseId value; but as long as all such searches
+	 * wait and retry, as in CountOtherDBBackends(), they will certainly see
+	 * the correct value on their next try.
+	 */
+	MyProc->databaseId = MyDatabaseId;
+
+	/*
+	 * We established a catalog snapshot while reading pg_authid and/or
+	 * pg_database; but until we have set up MyDatabaseId, we won't react to
+	 * incoming sinval messages for unshared catalogs, so we won't realize it
+	 * if the snapshot has been invalidated.  Assume it's no good anymore.
+	 */
+	InvalidateCatalogSnapshot();
+
+	/*
+	 * Recheck pg_database to make sure the target database hasn't gone away.
+	 * If there was a concurrent DROP DATABASE, this ensures we will die
+	 * cleanly without creating a mess.
+	 */
+	if (!bootstrap)
+	{
+		HeapTuple	tuple;
+
+		tuple = GetDatabaseTuple(dbname);
+		if (!HeapTupleIsValid(tuple) ||
+			MyDatabaseId != ((Form_pg_database) GETSTRUCT(tuple))->oid ||
+			MyDatabaseTableSpace != ((Form_pg_database) GETSTRUCT(tuple))->dattablespace)
+			ereport(FATAL,
+					(errcode(ERRCODE_UNDEFINED_DATABASE),
+					 errmsg("database \"%s\" does not exist", dbname),
+					 errdetail("It seems to have just been dropped or renamed.")));
+	}
+
+	/*
+	 * Now we should be able to access the database directory safely. Verify
+	 * it's there and looks reasonable.
+	 */
+	fullpath = GetDatabasePath(MyDatabaseId, MyDatabaseTableSpace);
+
+	if (!bootstrap)
+	{
+		if (access(fullpath, F_OK) == -1)
+		{
+			if (errno == ENOENT)
+				ereport(FATAL,
+						(errcode(ERRCODE_UNDEFINED_DATABASE),
+						 errmsg("database \"%s\" does not exist",
+								dbname),
+						 errdetail("The database subdirectory \"%s\" is missing.",
+								   fullpath)));
+			else
+				ereport(FATAL,
+						(errcode_for_file_access(),
+						 errmsg("could not access directory \"%s\": %m",
+								fullpath)));
+		}
+
+		ValidatePgVersion(fullpath);
+	}
+
+	SetDatabasePath(fullpath);
+}
+
+/*
+ * PreforkConnectDatabase -- connect a pre-forked backend to its database,
+ *		then wait for a client
+ *
+ * A pre-forked backend does everything InitPostgres() does after client
+ * authentication that does not depend on the user, notably loading the
+ * relcache, before the postmaster hands it a client connection.  Returns the
+ * user name the client asked for, with a new startup transaction started.
+ *
+ * While waiting, the backend is connected to the database like any other, so
+ * DROP DATABASE and the like have to make it exit; see CountOtherDBBackends().
+ */
+static const char *
+PreforkConnectDatabase(const char *dbname)
+{
+	HeapTuple	tuple;
+	Form_pg_database dbform;
+
+	tuple = GetDatabaseTuple(dbname);
+	if (!HeapTupleIsValid(tuple))
+		ereport(FATAL,
+				(errcode(ERRCODE_UNDEFINED_DATABASE),
+				 errmsg("database \"%s\" does not exist", dbname)));
+	dbform = (Form_pg_database) GETSTRUCT(tuple);
+	MyDatabaseId = dbform->oid;
+	MyDatabaseTableSpace = dbform->dattablespace;
+
+	AttachToDatabase(dbname, false);
+
+	RelationCacheInitializePhase3();
+	initialize_acl();
+
+	/* Don't hold on to a snapshot while waiting */
+	CommitTransactionCommand();
+	InvalidateCatalogSnapshotConditionally();
+
+	PreforkAwaitClient(dbname);
+
+	/* Count as a regular connection from now on */
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+	MyProc->vacuumFlags &= ~PROC_IS_PREFORKED;
+	ProcGlobal->vacuumFlags[MyProc->pgxactoff] = MyProc->vacuumFlags;
+	LWLockRelease(ProcArrayLock);
+
+	SetCurrentStatementStartTimestamp();
+	StartTransactionCommand();
+	XactIsoLevel = XACT_READ_COMMITTED;
+	(void) GetTransactionSnapshot();
+
+	return MyProcPort->user_name;
+}
+
+
 /* --------------------------------
  *		InitCommunication
  *
@@ -536,6 +697,29 @@ InitializeMaxBackends(void)
 		elog(ERROR, "too many backends configured");
 }
 
+/*
+ * Initialize the number of fast-path lock groups from config options.
+ *
+ * Each group holds FP_LOCK_SLOTS_PER_GROUP relation locks.  We use enough
+ * groups for a backend to hold max_locks_per_transaction locks on the fast
+ * path, rounded up to a power of two so that a relation's group can be
+ * computed with a mask, and capped at FP_LOCK_GROUPS_PER_BACKEND_MAX.
+ *
+ * Like InitializeMaxBackends(), this must be called before shared memory size
+ * is determined, and the value is passed down to EXEC_BACKEND subprocesses
+ * via BackendParameters.
+ */
+void
+InitializeFastPathLocks(void)
+{
+	Assert(FastPathLockGroupsPerBackend == 0);
+
+	FastPathLockGroupsPerBackend = 1;
+	while (FastPathLockGroupsPerBackend < FP_LOCK_GROUPS_PER_BACKEND_MAX &&
+		   FastPathLockSlotsPerBackend() < max_locks_per_xact)
+		FastPathLockGroupsPerBackend *= 2;
+}
+
 /*
  * Early initialization of a backend (either standalone or under postmaster).
  * This happens even before InitPostgres.
@@ -592,7 +776,6 @@ InitPostgres(const char *in_dbname, Oid dboid, const char *username,
 {
 	bool		bootstrap = IsBootstrapProcessingMode();
 	bool		am_superuser;
-	char	   *fullpath;
 	char		dbname[NAMEDATALEN];
 
 	elog(DEBUG3, "InitPostgres");
@@ -671,6 +854,12 @@ InitPostgres(const char *in_dbname, Oid dboid, const char *username,
 		CurrentResourceOwner = NULL;
 
 		on_shmem_exit(ShutdownXLOG, 0);
+
+		/*
+		 * ShutdownXLOG runs after dynamic shared memory is detached, too late
+		 * to save the table statistics.  Do that beforehand.
+		 */
+		before_shmem_exit(pgstat_tables_shutdown_hook, 0);
 	}
 
 	/*
@@ -783,6 +972,8 @@ InitPostgres(const char *in_dbname, Oid dboid, const char *username,
 	else
 	{
 		/* normal multiuser case */
+		if (IsPreforkedBackend)
+			username = PreforkConnectDatabase(in_dbname);
 		Assert(MyProcPort != NULL);
 		PerformAuthentication(MyProcPort);
 		InitializeSessionUserId(username, useroid);
@@ -880,6 +1071,11 @@ InitPostgres(const char *in_dbname, Oid dboid, const char *username,
 		MyDatabaseId = TemplateDbOid;
 		MyDatabaseTableSpace = DEFAULTTABLESPACE_OID;
 	}
+	else if (IsPreforkedBackend)
+	{
+		/* connected already, see PreforkConnectDatabase() */
+		strlcpy(dbname, in_dbname, sizeof(dbname));
+	}
 	else if (in_dbname != NULL)
 	{
 		HeapTuple	tuple;
@@ -932,112 +1128,22 @@ InitPostgres(const char *in_dbname, Oid dboid, const char *username,
 		return;
 	}
 
-	/*
-	 * Now, take a writer's lock on the database we are trying to connect to.
-	 * If there is a concurrently running DROP DATABASE on that database, this
-	 * will block us until it finishes (and has committed its update of
-	 * pg_database).
-	 *
-	 * Note that the lock is not held long, only until the end of this startup
-	 * transaction.  This is OK since we will advertise our use of the
-	 * database in the ProcArray before dropping the lock (in fact, that's the
-	 * next thing to do).  Anyone trying a DROP DATABASE after this point will
-	 * see us in the array once they have the lock.  Ordering is important for
-	 * this because we don't want to advertise ourselves as being in this
-	 * database until we have the lock; otherwise we create what amounts to a
-	 * deadlock with CountOtherDBBackends().
-	 *
-	 * Note: use of RowExclusiveLock here is reasonable because we envision
-	 * our session as being a concurrent writer of the database.  If we had a
-	 * way of declaring a session as being guaranteed-read-only, we could use
-	 * AccessShareLock for such sessions and thereby not conflict against
-	 * CREATE DATABASE.
-	 */
-	if (!bootstrap)
-		LockSharedObject(DatabaseRelationId, MyDatabaseId, 0,
-						 RowExclusiveLock);
-
-	/*
-	 * Now we can mark our PGPROC entry with the database ID.
-	 *
-	 * We assume this is an atomic store so no lock is needed; though actually
-	 * things would work fine even if it weren't atomic.  Anyone searching the
-	 * ProcArray for this database's ID should hold the database lock, so they
-	 * would not be executing concurrently with this store.  A process looking
-	 * for another database's ID could in theory see a chance match if it read
-	 * a partially-updated databaseId value; but as long as all such searches
-	 * wait and retry, as in CountOtherDBBackends(), they will certainly see
-	 * the correct value on their next try.
-	 */
-	MyProc->databaseId = MyDatabaseId;
-
-	/*
-	 * We established a catalog snapshot while reading pg_authid and/or
-	 * pg_database; but until we have set up MyDatabaseId, we won't react to
-	 * incoming sinval messages for unshared catalogs, so we won't realize it
-	 * if the snapshot has been invalidated.  Assume it's no good anymore.
-	 */
-	InvalidateCatalogSnapshot();
-
-	/*
-	 * Recheck pg_database to make sure the target database hasn't gone away.
-	 * If there was a concurrent DROP DATABASE, this ensures we will die
-	 * cleanly without creating a mess.
-	 */
-	if (!bootstrap)
+	if (!IsPreforkedBackend)
 	{
-		HeapTuple	tuple;
-
-		tuple = GetDatabaseTuple(dbname);
-		if (!HeapTupleIsValid(tuple) ||
-			MyDatabaseId != ((Form_pg_database) GETSTRUCT(tuple))->oid ||
-			MyDatabaseTableSpace != ((Form_pg_database) GETSTRUCT(tuple))->dattablespace)
-			ereport(FATAL,
-					(errcode(ERRCODE_UNDEFINED_DATABASE),
-					 errmsg("database \"%s\" does not exist", dbname),
-					 errdetail("It seems to have just been dropped or renamed.")));
-	}
-
-	/*
-	 * Now we should be able to access the database directory safely. Verify
-	 * it's there and looks reasonable.
-	 */
-	fullpath = GetDatabasePath(MyDatabaseId, MyDatabaseTableSpace);
+		AttachToDatabase(dbname, bootstrap);
 
-	if (!bootstrap)
-	{
-		if (access(fullpath, F_OK) == -1)
-		{
-			if (errno == ENOENT)
-				ereport(FATAL,
-						(errcode(ERRCODE_UNDEFINED_DATABASE),
-						 errmsg("database \"%s\" does not exist",
-								dbname),
-						 errdetail("The database subdirectory \"%s\" is missing.",
-								   fullpath)));
-			else
-				ereport(FATAL,
-						(errcode_for_file_access(),
-						 errmsg("could not access directory \"%s\": %m",
-								fullpath)));
-		}
+		/*
+		 * It's now possible to do real access to the system catalogs.
+		 *
+		 * Load relcache entries for the system catalogs.  This must create at
+		 * least the minimum set of "nailed-in" cache entries.
+		 */
+		RelationCacheInitializePhase3();
 
-		ValidatePgVersion(fullpath);
+		/* set up ACL framework (so CheckMyDatabase can check permissions) */
+		initialize_acl();
 	}
 
-	SetDatabasePath(fullpath);
-
-	/*
-	 * It's now possible to do real access to the system catalogs.
-	 *
-	 * Load relcache entries for the system catalogs.  This must create at
-	 * least the minimum set of "nailed-in" cache entries.
-	 */
-	RelationCacheInitializePhase3();
-
-	/* set up ACL framework (so CheckMyDatabase can check permissions) */
-	initialize_acl();
-
 	/*
 	 * Re-read the pg_database row for our database, check permissions and set
 	 * up database-specific GUC settings.  We can't do this until all the
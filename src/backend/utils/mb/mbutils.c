@@ -1470,6 +1470,40 @@ pg_verify_mbstr(int encoding, const char *mbstr, int len, bool noError)
  * If a problem is found, return -1 when noError is
  * true; when noError is false, ereport() a descriptive message.
  */
+/*
+ * Number of bytes is_valid_ascii() checks at a time.
+ */
+#define ASCII_CHUNK_LEN (2 * sizeof(uint64))
+
+/*
+ * Are the ASCII_CHUNK_LEN bytes at s all ASCII-subset characters, and none of
+ * them zero?
+ *
+ * This works on whole words at a time: a byte has its high bit set if the
+ * OR of the words has it, and for bytes without the high bit, adding 0x7F
+ * sets it in every byte except a zero one, without carrying into the next
+ * byte.
+ */
+static inline bool
+is_valid_ascii(const char *s)
+{
+	uint64		chunk1,
+				chunk2;
+	uint64		highbits,
+				nonzero;
+
+	memcpy(&chunk1, s, sizeof(uint64));
+	memcpy(&chunk2, s + sizeof(uint64), sizeof(uint64));
+
+	highbits = chunk1 | chunk2;
+	nonzero = (chunk1 + UINT64CONST(0x7f7f7f7f7f7f7f7f)) &
+		(chunk2 + UINT64CONST(0x7f7f7f7f7f7f7f7f));
+
+	return (highbits & UINT64CONST(0x8080808080808080)) == 0 &&
+		(nonzero & UINT64CONST(0x8080808080808080)) ==
+		UINT64CONST(0x8080808080808080);
+}
+
 int
 pg_verify_mbstr_len(int encoding, const char *mbstr, int len, bool noError)
 {
@@ -1501,6 +1535,15 @@ pg_verify_mbstr_len(int encoding, const char *mbstr, int len, bool noError)
 	{
 		int			l;
 
+		/* fast path for runs of ASCII-subset characters */
+		if (len >= ASCII_CHUNK_LEN && is_valid_ascii(mbstr))
+		{
+			mb_len += ASCII_CHUNK_LEN;
+			mbstr += ASCII_CHUNK_LEN;
+			len -= ASCII_CHUNK_LEN;
+			continue;
+		}
+
 		/* fast path for ASCII-subset characters */
 		if (!IS_HIGHBIT_SET(*mbstr))
 		{
@@ -31,22 +31,31 @@
 
 #include "access/commit_ts.h"
 #include "access/gin.h"
+#include "access/parallel.h"
 #include "access/rmgr.h"
+#include "access/slru.h"
 #include "access/tableam.h"
+#include "access/toast_compression.h"
 #include "access/transam.h"
 #include "access/twophase.h"
 #include "access/xact.h"
 #include "access/xlog_internal.h"
+#include "access/xlogparallel.h"
+#include "access/xlogprefetch.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_authid.h"
 #include "catalog/storage.h"
 #include "commands/async.h"
+#include "commands/explain_progress.h"
 #include "commands/prepare.h"
+#include "commands/sequence.h"
 #include "commands/trigger.h"
 #include "commands/user.h"
 #include "commands/vacuum.h"
 #include "commands/variable.h"
+#include "common/stream_compression.h"
 #include "common/string.h"
+#include "executor/executor.h"
 #include "funcapi.h"
 #include "jit/jit.h"
 #include "libpq/auth.h"
@@ -63,31 +72,40 @@
 #include "parser/parser.h"
 #include "parser/scansup.h"
 #include "pgstat.h"
+#include "regex/regex.h"
 #include "postmaster/autovacuum.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
 #include "postmaster/syslogger.h"
 #include "postmaster/walwriter.h"
+#include "replication/fanout.h"
 #include "replication/logicallauncher.h"
 #include "replication/reorderbuffer.h"
 #include "replication/slot.h"
 #include "replication/syncrep.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
+#include "storage/buf_stats.h"
+#include "storage/buffile.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/dsm_impl.h"
 #include "storage/fd.h"
 #include "storage/large_object.h"
 #include "storage/pg_shmem.h"
 #include "storage/predicate.h"
 #include "storage/proc.h"
+#include "storage/relsize.h"
+#include "storage/sinvaladt.h"
 #include "storage/standby.h"
 #include "tcop/tcopprot.h"
 #include "tsearch/ts_cache.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/bytea.h"
+#include "utils/catcache.h"
 #include "utils/float.h"
 #include "utils/guc_tables.h"
 #include "utils/memutils.h"
@@ -97,6 +115,8 @@
 #include "utils/portal.h"
 #include "utils/ps_status.h"
 #include "utils/rls.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/tzparser.h"
 #include "utils/varlena.h"
@@ -125,6 +145,7 @@
 extern bool Log_disconnections;
 extern int	CommitDelay;
 extern int	CommitSiblings;
+extern bool adaptive_commit_delay;
 extern char *default_tablespace;
 extern char *temp_tablespaces;
 extern bool ignore_checksum_failure;
@@ -166,6 +187,10 @@ static void assign_log_destination(const char *newval, void *extra);
 static bool check_wal_consistency_checking(char **newval, void **extra,
 										   GucSource source);
 static void assign_wal_consistency_checking(const char *newval, void *extra);
+static bool check_io_direct(char **newval, void **extra, GucSource source);
+static void assign_io_direct(const char *newval, void *extra);
+static bool check_prefork_databases(char **newval, void **extra,
+									GucSource source);
 
 #ifdef HAVE_SYSLOG
 static int	syslog_facility = LOG_LOCAL0;
@@ -199,8 +224,11 @@ static bool check_max_worker_processes(int *newval, void **extra, GucSource sour
 static bool check_autovacuum_max_workers(int *newval, void **extra, GucSource source);
 static bool check_max_wal_senders(int *newval, void **extra, GucSource source);
 static bool check_autovacuum_work_mem(int *newval, void **extra, GucSource source);
+static bool check_vacuum_buffer_usage_limit(int *newval, void **extra,
+											GucSource source);
 static bool check_effective_io_concurrency(int *newval, void **extra, GucSource source);
 static bool check_maintenance_io_concurrency(int *newval, void **extra, GucSource source);
+static bool check_recovery_prefetch(bool *newval, void **extra, GucSource source);
 static bool check_huge_page_size(int *newval, void **extra, GucSource source);
 static void assign_pgstat_temp_directory(const char *newval, void *extra);
 static bool check_application_name(char **newval, void **extra, GucSource source);
@@ -323,6 +351,14 @@ static const struct config_enum_entry isolation_level_options[] = {
 	{NULL, 0}
 };
 
+static const struct config_enum_entry default_toast_compression_options[] = {
+	{"pglz", TOAST_PGLZ_COMPRESSION, false},
+#ifdef USE_LZ4
+	{"lz4", TOAST_LZ4_COMPRESSION, false},
+#endif
+	{NULL, 0, false}
+};
+
 static const struct config_enum_entry session_replication_role_options[] = {
 	{"origin", SESSION_REPLICATION_ROLE_ORIGIN, false},
 	{"replica", SESSION_REPLICATION_ROLE_REPLICA, false},
@@ -485,6 +521,72 @@ const struct config_enum_entry ssl_protocol_versions_info[] = {
 StaticAssertDecl(lengthof(ssl_protocol_versions_info) == (PG_TLS1_3_VERSION + 2),
 				 "array length mismatch");
 
+/*
+ * Although only "on", "off", "pglz", "lz4" and "zstd" are documented, we
+ * accept all the likely variants of "on" and "off".
+ */
+static const struct config_enum_entry wal_compression_options[] = {
+	{"pglz", WAL_COMPRESSION_PGLZ, false},
+#ifdef USE_LZ4
+	{"lz4", WAL_COMPRESSION_LZ4, false},
+#endif
+#ifdef USE_ZSTD
+	{"zstd", WAL_COMPRESSION_ZSTD, false},
+#endif
+	{"on", WAL_COMPRESSION_PGLZ, false},
+	{"off", WAL_COMPRESSION_NONE, false},
+	{"true", WAL_COMPRESSION_PGLZ, true},
+	{"yes", WAL_COMPRESSION_PGLZ, true},
+	{"false", WAL_COMPRESSION_NONE, true},
+	{"no", WAL_COMPRESSION_NONE, true},
+	{"1", WAL_COMPRESSION_PGLZ, true},
+	{"0", WAL_COMPRESSION_NONE, true},
+	{NULL, 0, false}
+};
+
+static const struct config_enum_entry wal_receiver_compression_options[] = {
+	{"off", STREAM_COMPRESSION_NONE, false},
+#ifdef HAVE_LIBZ
+	{"gzip", STREAM_COMPRESSION_GZIP, false},
+#endif
+#ifdef USE_LZ4
+	{"lz4", STREAM_COMPRESSION_LZ4, false},
+#endif
+#ifdef USE_ZSTD
+	{"zstd", STREAM_COMPRESSION_ZSTD, false},
+#endif
+	{"none", STREAM_COMPRESSION_NONE, true},
+	{NULL, 0, false}
+};
+
+static const struct config_enum_entry logical_decoding_spill_compression_options[] = {
+	{"off", SPILL_COMPRESSION_NONE, false},
+	{"pglz", SPILL_COMPRESSION_PGLZ, false},
+#ifdef USE_LZ4
+	{"lz4", SPILL_COMPRESSION_LZ4, false},
+#endif
+	{NULL, 0, false}
+};
+
+static const struct config_enum_entry temp_file_compression_options[] = {
+	{"off", TEMP_FILE_COMPRESSION_NONE, false},
+	{"pglz", TEMP_FILE_COMPRESSION_PGLZ, false},
+#ifdef USE_LZ4
+	{"lz4", TEMP_FILE_COMPRESSION_LZ4, false},
+#endif
+	{NULL, 0, false}
+};
+
+static const struct config_enum_entry shared_memory_numa_options[] = {
+	{"off", SHMEM_NUMA_OFF, false},
+	{"interleave", SHMEM_NUMA_INTERLEAVE, false},
+	{"bind", SHMEM_NUMA_BIND, false},
+	{"false", SHMEM_NUMA_OFF, true},
+	{"no", SHMEM_NUMA_OFF, true},
+	{"0", SHMEM_NUMA_OFF, true},
+	{NULL, 0, false}
+};
+
 static struct config_enum_entry shared_memory_options[] = {
 #ifndef WIN32
 	{"sysv", SHMEM_TYPE_SYSV, false},
@@ -581,6 +683,8 @@ int			ssl_renegotiation_limit;
  */
 int			huge_pages;
 int			huge_page_size;
+int			shared_memory_numa;
+char	   *shared_memory_numa_nodes;
 
 /*
  * These variables are all dummies that don't do anything, except in some
@@ -705,6 +809,8 @@ const char *const config_group_names[] =
 	gettext_noop("Write-Ahead Log / Checkpoints"),
 	/* WAL_ARCHIVING */
 	gettext_noop("Write-Ahead Log / Archiving"),
+	/* WAL_RECOVERY */
+	gettext_noop("Write-Ahead Log / Recovery"),
 	/* WAL_ARCHIVE_RECOVERY */
 	gettext_noop("Write-Ahead Log / Archive Recovery"),
 	/* WAL_RECOVERY_TARGET */
@@ -1016,6 +1122,16 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_resultcache", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of result caching."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_resultcache,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_nestloop", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of nested-loop join plans."),
@@ -1046,6 +1162,16 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_hashjoin_bloom_filter", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of bloom filters to skip outer rows of hash joins."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_hashjoin_bloom_filter,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_gathermerge", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of gather merge plans."),
@@ -1086,6 +1212,16 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_async_append", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of async append plans."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_async_append,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_parallel_hash", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of parallel hash plans."),
@@ -1096,6 +1232,76 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_parallel_hashagg", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel hash aggregation that finalizes groups in the workers."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_parallel_hashagg,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_parallel_insert", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel plans in which the workers insert the rows of INSERT ... SELECT."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_parallel_insert,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_parallel_material", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of materialization shared by all the participants of a parallel join."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_parallel_material,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_parallel_nonpartial_agg", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel plans that aggregate whole groups in the workers when partial aggregation is not possible."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_parallel_nonpartial_agg,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_parallel_sort", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel sort plans that merge the participants' runs in one of them."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_parallel_sort,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_parallel_temp_scan", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel workers to scan temporary tables."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_parallel_temp_scan,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_parallel_window", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel window function plans that repartition the rows by the partitioning columns."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_parallel_window,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_partition_pruning", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables plan-time and run-time partition pruning."),
@@ -1139,6 +1345,25 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		check_bonjour, NULL, NULL
 	},
+	{
+		{"protocol_compression", PGC_SIGHUP, CONN_AUTH_SETTINGS,
+			gettext_noop("Allows clients to request compression of the protocol stream."),
+			NULL
+		},
+		&protocol_compression,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"defer_sync_flush", PGC_USERSET, CLIENT_CONN_OTHER,
+			gettext_noop("Defers flushing output at Sync while more client messages are buffered."),
+			gettext_noop("This lets pipelining clients receive the replies to "
+						 "several Sync messages in fewer, larger network writes.")
+		},
+		&defer_sync_flush,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"track_commit_timestamp", PGC_POSTMASTER, REPLICATION,
 			gettext_noop("Collects transaction commit time."),
@@ -1259,16 +1484,6 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
-	{
-		{"wal_compression", PGC_SUSET, WAL_SETTINGS,
-			gettext_noop("Compresses full-page writes written in WAL file."),
-			NULL
-		},
-		&wal_compression,
-		false,
-		NULL, NULL, NULL
-	},
-
 	{
 		{"wal_init_zero", PGC_SUSET, WAL_SETTINGS,
 			gettext_noop("Writes zeroes to new WAL files before first use."),
@@ -1289,6 +1504,18 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"adaptive_commit_delay", PGC_SUSET, WAL_SETTINGS,
+			gettext_noop("Adapts the delay before flushing WAL at commit to the "
+						 "observed flush time and commit rate."),
+			gettext_noop("commit_delay, if set, limits the delay, and "
+						 "commit_siblings is ignored.")
+		},
+		&adaptive_commit_delay,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"log_checkpoints", PGC_SIGHUP, LOGGING_WHAT,
 			gettext_noop("Logs each checkpoint."),
@@ -1482,6 +1709,33 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"track_buffer_usage", PGC_SUSET, STATS_COLLECTOR,
+			gettext_noop("Collects statistics on shared buffer usage per relation and access strategy."),
+			NULL
+		},
+		&track_buffer_usage,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"track_wait_timing", PGC_SUSET, STATS_COLLECTOR,
+			gettext_noop("Collects timing statistics for wait events."),
+			NULL
+		},
+		&track_wait_timing,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"track_plan_progress", PGC_SUSET, STATS_COLLECTOR,
+			gettext_noop("Collects row counts of plan nodes while queries run."),
+			gettext_noop("They are shown by pg_get_backend_query_plan().")
+		},
+		&track_plan_progress,
+		false,
+		NULL, NULL, NULL
+	},
 
 	{
 		{"update_process_title", PGC_SUSET, PROCESS_TITLE,
@@ -1834,6 +2088,16 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"recovery_prefetch", PGC_SIGHUP, WAL_RECOVERY,
+			gettext_noop("Prefetches referenced blocks during recovery."),
+			gettext_noop("Read ahead of the current replay position to find uncached blocks.")
+		},
+		&recovery_prefetch,
+		false,
+		check_recovery_prefetch, NULL, NULL
+	},
+
 	{
 		{"hot_standby_feedback", PGC_SIGHUP, REPLICATION_STANDBY,
 			gettext_noop("Allows feedback from a hot standby to the primary that will avoid query conflicts."),
@@ -2018,6 +2282,28 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"jit_cache_deforming", PGC_USERSET, DEVELOPER_OPTIONS,
+			gettext_noop("Allow reusing JIT compiled tuple deforming code for the rest of the session."),
+			NULL,
+			GUC_NOT_IN_SAMPLE
+		},
+		&jit_cache_deforming,
+		true,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"jit_fuse_scans", PGC_USERSET, DEVELOPER_OPTIONS,
+			gettext_noop("Allow JIT compiling the qual and projection of a scan as one expression."),
+			NULL,
+			GUC_NOT_IN_SAMPLE
+		},
+		&jit_fuse_scans,
+		true,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"data_sync_retry", PGC_POSTMASTER, ERROR_HANDLING_OPTIONS,
 			gettext_noop("Whether to continue running after a failure to sync data files."),
@@ -2036,6 +2322,16 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"lwlock_handoff", PGC_POSTMASTER, LOCK_MANAGEMENT,
+			gettext_noop("Hands heavily contended lightweight locks over to waiting processes in arrival order."),
+			NULL
+		},
+		&lwlock_handoff,
+		false,
+		NULL, NULL, NULL
+	},
+
 	/* End-of-list marker */
 	{
 		{NULL, 0, 0, NULL, NULL}, NULL, false, NULL, NULL, NULL
@@ -2076,6 +2372,17 @@ static struct config_int ConfigureNamesInt[] =
 		100, 1, 10000,
 		NULL, NULL, NULL
 	},
+	{
+		{"executor_batch_size", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the number of tuples passed at once between "
+						 "executor nodes that support batches."),
+			gettext_noop("A value of 1 passes all tuples one at a time."),
+			GUC_EXPLAIN
+		},
+		&executor_batch_size,
+		64, 1, 1024,
+		NULL, NULL, NULL
+	},
 	{
 		{"from_collapse_limit", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("Sets the FROM-list size beyond which subqueries "
@@ -2102,6 +2409,18 @@ static struct config_int ConfigureNamesInt[] =
 		8, 1, INT_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"join_search_block_size", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the number of FROM items beyond which join orders are searched iteratively."),
+			gettext_noop("The planner then searches exhaustively for the best "
+						 "join of up to this many items at a time. "
+						 "Zero disables iterative search."),
+			GUC_EXPLAIN
+		},
+		&join_search_block_size,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
 	{
 		{"geqo_threshold", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("Sets the threshold of FROM items beyond which GEQO is used."),
@@ -2257,6 +2576,83 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"commit_timestamp_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the commit timestamp cache."),
+			gettext_noop("0 means use a fraction of \"shared_buffers\"."),
+			GUC_UNIT_BLOCKS
+		},
+		&commit_timestamp_buffers,
+		0, 0, SLRU_MAX_ALLOWED_BUFFERS,
+		check_commit_ts_buffers, NULL, NULL
+	},
+
+	{
+		{"multixact_member_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the MultiXact member cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&multixact_member_buffers,
+		32, 16, SLRU_MAX_ALLOWED_BUFFERS,
+		check_multixact_member_buffers, NULL, NULL
+	},
+
+	{
+		{"multixact_offset_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the MultiXact offset cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&multixact_offset_buffers,
+		16, 16, SLRU_MAX_ALLOWED_BUFFERS,
+		check_multixact_offset_buffers, NULL, NULL
+	},
+
+	{
+		{"notify_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the LISTEN/NOTIFY message cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&notify_buffers,
+		16, 16, SLRU_MAX_ALLOWED_BUFFERS,
+		check_notify_buffers, NULL, NULL
+	},
+
+	{
+		{"serializable_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the serializable transaction cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&serializable_buffers,
+		32, 16, SLRU_MAX_ALLOWED_BUFFERS,
+		check_serial_buffers, NULL, NULL
+	},
+
+	{
+		{"subtransaction_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the subtransaction cache."),
+			gettext_noop("0 means use a fraction of \"shared_buffers\"."),
+			GUC_UNIT_BLOCKS
+		},
+		&subtransaction_buffers,
+		0, 0, SLRU_MAX_ALLOWED_BUFFERS,
+		check_subtransaction_buffers, NULL, NULL
+	},
+
+	{
+		{"transaction_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the transaction status cache."),
+			gettext_noop("0 means use a fraction of \"shared_buffers\"."),
+			GUC_UNIT_BLOCKS
+		},
+		&transaction_buffers,
+		0, 0, SLRU_MAX_ALLOWED_BUFFERS,
+		check_transaction_buffers, NULL, NULL
+	},
+
 	{
 		{"temp_buffers", PGC_USERSET, RESOURCES_MEM,
 			gettext_noop("Sets the maximum number of temporary buffers used by each session."),
@@ -2268,6 +2664,58 @@ static struct config_int ConfigureNamesInt[] =
 		check_temp_buffers, NULL, NULL
 	},
 
+	{
+		{"shared_plan_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the amount of shared memory used to share generic plans between sessions."),
+			gettext_noop("Zero disables sharing plans."),
+			GUC_UNIT_KB
+		},
+		&shared_plan_cache_size,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_catcache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the amount of shared memory used to share catalog cache entries between sessions."),
+			gettext_noop("Zero disables sharing catalog cache entries."),
+			GUC_UNIT_KB
+		},
+		&shared_catcache_size,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"sinval_queue_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of messages the shared cache invalidation queue can hold."),
+			gettext_noop("The value is rounded up to a power of 2.")
+		},
+		&sinval_queue_size,
+		4096, 1024, 1024 * 1024,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"relsize_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of relations whose size is cached in shared memory."),
+			gettext_noop("Zero disables the cache.")
+		},
+		&relsize_cache_size,
+		10000, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"sequence_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of sequences whose values are handed out from shared memory."),
+			gettext_noop("Zero disables the cache.")
+		},
+		&sequence_cache_size,
+		0, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"port", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
 			gettext_noop("Sets the TCP port the server listens on."),
@@ -2278,6 +2726,47 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"connection_proxies", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the number of connection proxy processes."),
+			gettext_noop("Connection proxies share backends between clients "
+						 "connecting to proxy_port.  Zero disables them.")
+		},
+		&ConnectionProxies,
+		0, 0, 64,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"proxy_port", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the TCP port the connection proxies listen on."),
+			NULL
+		},
+		&ProxyPortNumber,
+		6543, 1, 65535,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"session_pool_size", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the maximum number of backends a connection proxy shares between the clients of one user and database."),
+			NULL
+		},
+		&SessionPoolSize,
+		10, 1, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"prefork_backends", PGC_SIGHUP, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the number of backends kept ready for connections to each database in prefork_databases."),
+			NULL
+		},
+		&PreforkBackends,
+		0, 0, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"unix_socket_permissions", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
 			gettext_noop("Sets the access permissions of the Unix-domain socket."),
@@ -2323,38 +2812,80 @@ static struct config_int ConfigureNamesInt[] =
 	},
 
 	{
-		{"work_mem", PGC_USERSET, RESOURCES_MEM,
-			gettext_noop("Sets the maximum memory to be used for query workspaces."),
-			gettext_noop("This much memory can be used by each internal "
-						 "sort operation and hash table before switching to "
-						 "temporary disk files."),
-			GUC_UNIT_KB | GUC_EXPLAIN
+		{"work_mem", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory to be used for query workspaces."),
+			gettext_noop("This much memory can be used by each internal "
+						 "sort operation and hash table before switching to "
+						 "temporary disk files."),
+			GUC_UNIT_KB | GUC_EXPLAIN
+		},
+		&work_mem,
+		4096, 64, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"maintenance_work_mem", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory to be used for maintenance operations."),
+			gettext_noop("This includes operations such as VACUUM and CREATE INDEX."),
+			GUC_UNIT_KB
+		},
+		&maintenance_work_mem,
+		65536, 1024, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"logical_decoding_work_mem", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory to be used for logical decoding."),
+			gettext_noop("This much memory can be used by each internal "
+						 "reorder buffer before spilling to disk."),
+			GUC_UNIT_KB
+		},
+		&logical_decoding_work_mem,
+		65536, 64, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"max_backend_memory", PGC_SUSET, RESOURCES_MEM,
+			gettext_noop("Limits the memory allocated by the memory contexts of each process."),
+			gettext_noop("0 means no limit."),
+			GUC_UNIT_MB
+		},
+		&max_backend_memory,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"max_catcache_memory", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory to be used by the system catalog caches of each session."),
+			gettext_noop("Least recently used entries are evicted beyond it. 0 means no limit."),
+			GUC_UNIT_KB
 		},
-		&work_mem,
-		4096, 64, MAX_KILOBYTES,
+		&max_catcache_memory,
+		0, 0, MAX_KILOBYTES,
 		NULL, NULL, NULL
 	},
 
 	{
-		{"maintenance_work_mem", PGC_USERSET, RESOURCES_MEM,
-			gettext_noop("Sets the maximum memory to be used for maintenance operations."),
-			gettext_noop("This includes operations such as VACUUM and CREATE INDEX."),
-			GUC_UNIT_KB
+		{"max_relcache_entries", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum number of relation cache entries kept by each session across transactions."),
+			gettext_noop("Least recently used entries are evicted beyond it. 0 means no limit.")
 		},
-		&maintenance_work_mem,
-		65536, 1024, MAX_KILOBYTES,
+		&max_relcache_entries,
+		0, 0, INT_MAX,
 		NULL, NULL, NULL
 	},
 
 	{
-		{"logical_decoding_work_mem", PGC_USERSET, RESOURCES_MEM,
-			gettext_noop("Sets the maximum memory to be used for logical decoding."),
-			gettext_noop("This much memory can be used by each internal "
-						 "reorder buffer before spilling to disk."),
-			GUC_UNIT_KB
+		{"regex_cache_size", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum number of compiled regular expressions kept by each session."),
+			NULL
 		},
-		&logical_decoding_work_mem,
-		65536, 64, MAX_KILOBYTES,
+		&regex_cache_size,
+		64, 1, 10000,
 		NULL, NULL, NULL
 	},
 
@@ -2554,6 +3085,26 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"vacuum_failsafe_age", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Age at which VACUUM should trigger failsafe to avoid a wraparound outage."),
+			NULL
+		},
+		&vacuum_failsafe_age,
+		1600000000, 0, 2100000000,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"vacuum_multixact_failsafe_age", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Multixact age at which VACUUM should trigger failsafe to avoid a wraparound outage."),
+			NULL
+		},
+		&vacuum_multixact_failsafe_age,
+		1600000000, 0, 2100000000,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"vacuum_defer_cleanup_age", PGC_SIGHUP, REPLICATION_PRIMARY,
 			gettext_noop("Number of transactions by which VACUUM and HOT cleanup should be deferred, if any."),
@@ -2696,6 +3247,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"checkpoint_cold_buffer_age", PGC_SIGHUP, WAL_CHECKPOINTS,
+			gettext_noop("Sets the time after its last modification when the checkpointer writes out a dirty buffer between checkpoints."),
+			gettext_noop("Zero leaves all writes to checkpoints and the background writer."),
+			GUC_UNIT_S
+		},
+		&CheckPointColdBufferAge,
+		0, 0, 86400,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"checkpoint_flush_after", PGC_SIGHUP, WAL_CHECKPOINTS,
 			gettext_noop("Number of pages after which previously performed writes are flushed to disk."),
@@ -2718,6 +3280,39 @@ static struct config_int ConfigureNamesInt[] =
 		check_wal_buffers, NULL, NULL
 	},
 
+	{
+		{"wal_receiver_relay_buffers", PGC_POSTMASTER, REPLICATION_STANDBY,
+			gettext_noop("Sets the number of buffers in shared memory for WAL relayed to cascading standbys."),
+			NULL,
+			GUC_UNIT_XBLOCKS
+		},
+		&wal_receiver_relay_buffers,
+		256, 0, (INT_MAX / XLOG_BLCKSZ),
+		NULL, NULL, NULL
+	},
+
+	{
+		{"wal_insert_locks", PGC_POSTMASTER, WAL_SETTINGS,
+			gettext_noop("Sets the number of locks that allow WAL to be inserted concurrently."),
+			gettext_noop("-1 chooses a value based on the number of CPUs.")
+		},
+		&NumXLogInsertLocks,
+		-1, -1, 1024,
+		check_wal_insert_locks, NULL, NULL
+	},
+
+	{
+		{"double_write_buffers", PGC_POSTMASTER, WAL_SETTINGS,
+			gettext_noop("Sets the number of slots in the double-write file."),
+			gettext_noop("Pages are written to the double-write file before their "
+						 "relation, to protect against partial page writes instead "
+						 "of full-page images in WAL.  0 disables the double-write file.")
+		},
+		&double_write_buffers,
+		0, 0, 65536,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_writer_delay", PGC_SIGHUP, WAL_SETTINGS,
 			gettext_noop("Time between WAL flushes performed in the WAL writer."),
@@ -2772,6 +3367,28 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"max_logical_decoding_fanout_groups", PGC_POSTMASTER, REPLICATION_SENDING,
+			gettext_noop("Sets the maximum number of groups of WAL senders sharing decoded changes."),
+			gettext_noop("Logical WAL senders using the same output plugin with the same "
+						 "options decode WAL only once per group.")
+		},
+		&max_logical_decoding_fanout_groups,
+		0, 0, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"logical_decoding_fanout_buffer_size", PGC_POSTMASTER, REPLICATION_SENDING,
+			gettext_noop("Sets the size of the buffer of decoded changes of each fan-out group."),
+			NULL,
+			GUC_UNIT_KB
+		},
+		&logical_decoding_fanout_buffer_size,
+		16384, 64, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"max_slot_wal_keep_size", PGC_SIGHUP, REPLICATION_SENDING,
 			gettext_noop("Sets the maximum WAL size that can be reserved by replication slots."),
@@ -2941,6 +3558,27 @@ static struct config_int ConfigureNamesInt[] =
 		check_effective_io_concurrency, NULL, NULL
 	},
 
+	{
+		{"recovery_prefetch_distance", PGC_SIGHUP, WAL_RECOVERY,
+			gettext_noop("Sets how far ahead of replay WAL is read to prefetch referenced blocks."),
+			NULL,
+			GUC_UNIT_BYTE
+		},
+		&recovery_prefetch_distance,
+		256 * 1024, XLOG_BLCKSZ, 1024 * 1024 * 1024,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"recovery_parallel_workers", PGC_POSTMASTER, WAL_RECOVERY,
+			gettext_noop("Sets the number of background workers that replay WAL records alongside the startup process."),
+			gettext_noop("Zero replays all WAL records in the startup process.")
+		},
+		&recovery_parallel_workers,
+		0, 0, MAX_PARALLEL_REDO_WORKERS,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"maintenance_io_concurrency",
 			PGC_USERSET,
@@ -3006,6 +3644,18 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"max_parallel_apply_workers_per_subscription",
+			PGC_SIGHUP,
+			REPLICATION_SUBSCRIBERS,
+			gettext_noop("Maximum number of parallel apply workers per subscription."),
+			NULL,
+		},
+		&max_parallel_apply_workers_per_subscription,
+		0, 0, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"log_rotation_age", PGC_SIGHUP, LOGGING_WHERE,
 			gettext_noop("Automatic log file rotation will occur after N minutes."),
@@ -3220,6 +3870,38 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"parallel_worker_pool_size", PGC_SIGHUP, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Sets the maximum number of idle parallel workers kept for reuse."),
+			NULL
+		},
+		&parallel_worker_pool_size,
+		0, 0, MAX_PARALLEL_WORKER_LIMIT,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"parallel_worker_idle_timeout", PGC_SIGHUP, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Sets the time an idle parallel worker is kept for reuse before it exits."),
+			NULL,
+			GUC_UNIT_MS
+		},
+		&parallel_worker_idle_timeout,
+		60000, 1, INT_MAX,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"vacuum_buffer_usage_limit", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum size of the buffer ring used by VACUUM and ANALYZE."),
+			gettext_noop("0 means not to use a buffer ring."),
+			GUC_UNIT_KB
+		},
+		&VacuumBufferUsageLimit,
+		2048, 0, MAX_BAS_VAC_RING_SIZE_KB,
+		check_vacuum_buffer_usage_limit, NULL, NULL
+	},
+
 	{
 		{"autovacuum_work_mem", PGC_SIGHUP, RESOURCES_MEM,
 			gettext_noop("Sets the maximum memory to be used by each autovacuum worker process."),
@@ -3926,6 +4608,17 @@ static struct config_string ConfigureNamesString[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"prefork_databases", PGC_SIGHUP, CONN_AUTH_SETTINGS,
+			gettext_noop("Lists the databases to keep pre-forked backends ready for."),
+			NULL,
+			GUC_LIST_INPUT | GUC_LIST_QUOTE
+		},
+		&PreforkDatabases,
+		"",
+		check_prefork_databases, NULL, NULL
+	},
+
 	/* See main.c about why defaults for LC_foo are not all alike */
 
 	{
@@ -4184,6 +4877,16 @@ static struct config_string ConfigureNamesString[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"shared_memory_numa_nodes", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the NUMA nodes the main shared memory region is placed on."),
+			gettext_noop("An empty string selects all nodes that have memory.")
+		},
+		&shared_memory_numa_nodes,
+		"",
+		NULL, NULL, NULL
+	},
+
 	{
 		{"listen_addresses", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
 			gettext_noop("Sets the host name or IP address(es) to listen to."),
@@ -4426,6 +5129,17 @@ static struct config_string ConfigureNamesString[] =
 		check_wal_consistency_checking, assign_wal_consistency_checking, NULL
 	},
 
+	{
+		{"io_direct", PGC_POSTMASTER, RESOURCES_DISK,
+			gettext_noop("Use direct I/O for the given kinds of files."),
+			gettext_noop("Valid values are combinations of \"data\" and \"wal\"."),
+			GUC_LIST_INPUT
+		},
+		&io_direct_string,
+		"",
+		check_io_direct, assign_io_direct, NULL
+	},
+
 	{
 		{"jit_provider", PGC_POSTMASTER, CLIENT_CONN_PRELOAD,
 			gettext_noop("JIT provider to use."),
@@ -4500,6 +5214,17 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"default_toast_compression", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Sets the default compression method for compressible values."),
+			NULL
+		},
+		&default_toast_compression,
+		TOAST_PGLZ_COMPRESSION,
+		default_toast_compression_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"default_transaction_isolation", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Sets the transaction isolation level of each new transaction."),
@@ -4685,6 +5410,46 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"logical_decoding_spill_compression", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Compresses changes spilled to disk by logical decoding with specified method."),
+			NULL
+		},
+		&logical_decoding_spill_compression,
+		SPILL_COMPRESSION_NONE, logical_decoding_spill_compression_options,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"temp_file_compression", PGC_USERSET, RESOURCES_DISK,
+			gettext_noop("Compresses sort and hash temporary files with specified method."),
+			NULL
+		},
+		&temp_file_compression,
+		TEMP_FILE_COMPRESSION_NONE, temp_file_compression_options,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"wal_compression", PGC_SUSET, WAL_SETTINGS,
+			gettext_noop("Compresses full-page writes written in WAL file with specified method."),
+			NULL
+		},
+		&wal_compression,
+		WAL_COMPRESSION_NONE, wal_compression_options,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"wal_receiver_compression", PGC_SIGHUP, REPLICATION_STANDBY,
+			gettext_noop("Asks the sending server to compress streamed WAL with specified method."),
+			NULL
+		},
+		&wal_receiver_compression,
+		STREAM_COMPRESSION_NONE, wal_receiver_compression_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_sync_method", PGC_SIGHUP, WAL_SETTINGS,
 			gettext_noop("Selects the method used for forcing WAL updates to disk."),
@@ -4726,6 +5491,16 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"shared_memory_numa", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the NUMA memory policy of the main shared memory region."),
+			NULL
+		},
+		&shared_memory_numa,
+		SHMEM_NUMA_OFF, shared_memory_numa_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"force_parallel_mode", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("Forces use of parallel query facilities."),
@@ -8363,6 +9138,8 @@ ExecSetVariableStmt(VariableSetStmt *stmt, bool isTopLevel)
 		case VAR_SET_CURRENT:
 			if (stmt->is_local)
 				WarnNoTransactionBlock(isTopLevel, "SET LOCAL");
+			else
+				MarkSessionUnpoolable("session parameters");
 			(void) set_config_option(stmt->name,
 									 ExtractSetVariableArgs(stmt),
 									 (superuser() ? PGC_SUSET : PGC_USERSET),
@@ -8406,6 +9183,8 @@ ExecSetVariableStmt(VariableSetStmt *stmt, bool isTopLevel)
 			{
 				ListCell   *head;
 
+				MarkSessionUnpoolable("session parameters");
+
 				foreach(head, stmt->args)
 				{
 					DefElem    *item = (DefElem *) lfirst(head);
@@ -8448,6 +9227,8 @@ ExecSetVariableStmt(VariableSetStmt *stmt, bool isTopLevel)
 		case VAR_RESET:
 			if (strcmp(stmt->name, "transaction_isolation") == 0)
 				WarnNoTransactionBlock(isTopLevel, "RESET TRANSACTION");
+			else if (!stmt->is_local)
+				MarkSessionUnpoolable("session parameters");
 
 			(void) set_config_option(stmt->name,
 									 NULL,
@@ -8535,6 +9316,9 @@ set_config_by_name(PG_FUNCTION_ARGS)
 	else
 		is_local = PG_GETARG_BOOL(2);
 
+	if (!is_local)
+		MarkSessionUnpoolable("session parameters");
+
 	/* Note SET DEFAULT (argstring == NULL) is equivalent to RESET */
 	(void) set_config_option(name,
 							 value,
@@ -11193,6 +11977,88 @@ assign_wal_consistency_checking(const char *newval, void *extra)
 	wal_consistency_checking = (bool *) extra;
 }
 
+static bool
+check_io_direct(char **newval, void **extra, GucSource source)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *l;
+	int			flags = 0;
+	int		   *myextra;
+
+	/* Need a modifiable copy of string */
+	rawstring = pstrdup(*newval);
+
+	/* Parse string into list of identifiers */
+	if (!SplitIdentifierString(rawstring, ',', &elemlist))
+	{
+		/* syntax error in list */
+		GUC_check_errdetail("List syntax is invalid.");
+		pfree(rawstring);
+		list_free(elemlist);
+		return false;
+	}
+
+	foreach(l, elemlist)
+	{
+		char	   *tok = (char *) lfirst(l);
+
+		if (pg_strcasecmp(tok, "data") == 0)
+			flags |= IO_DIRECT_DATA;
+		else if (pg_strcasecmp(tok, "wal") == 0)
+			flags |= IO_DIRECT_WAL;
+		else
+		{
+			GUC_check_errdetail("Unrecognized key word: \"%s\".", tok);
+			pfree(rawstring);
+			list_free(elemlist);
+			return false;
+		}
+	}
+
+	pfree(rawstring);
+	list_free(elemlist);
+
+	if (flags != 0 && PG_O_DIRECT == 0)
+	{
+		GUC_check_errdetail("Direct I/O is not supported on this platform.");
+		return false;
+	}
+
+	myextra = (int *) guc_malloc(ERROR, sizeof(int));
+	*myextra = flags;
+	*extra = (void *) myextra;
+
+	return true;
+}
+
+static void
+assign_io_direct(const char *newval, void *extra)
+{
+	io_direct_flags = *((int *) extra);
+}
+
+static bool
+check_prefork_databases(char **newval, void **extra, GucSource source)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	bool		result;
+
+	/* Need a modifiable copy of string */
+	rawstring = pstrdup(*newval);
+
+	/* Parse string into list of identifiers */
+	result = SplitIdentifierString(rawstring, ',', &elemlist);
+	if (!result)
+		GUC_check_errdetail("List syntax is invalid.");
+
+	pfree(rawstring);
+	list_free(elemlist);
+
+	return result;
+}
+
 static bool
 check_log_destination(char **newval, void **extra, GucSource source)
 {
@@ -11559,6 +12425,18 @@ check_autovacuum_work_mem(int *newval, void **extra, GucSource source)
 	return true;
 }
 
+static bool
+check_vacuum_buffer_usage_limit(int *newval, void **extra, GucSource source)
+{
+	/* Value 0 means not to use a buffer ring at all */
+	if (*newval == 0 || *newval >= MIN_BAS_VAC_RING_SIZE_KB)
+		return true;
+
+	GUC_check_errdetail("\"vacuum_buffer_usage_limit\" must be 0 or between %d kB and %d kB.",
+						MIN_BAS_VAC_RING_SIZE_KB, MAX_BAS_VAC_RING_SIZE_KB);
+	return false;
+}
+
 static bool
 check_max_worker_processes(int *newval, void **extra, GucSource source)
 {
@@ -11594,6 +12472,19 @@ check_maintenance_io_concurrency(int *newval, void **extra, GucSource source)
 	return true;
 }
 
+static bool
+check_recovery_prefetch(bool *newval, void **extra, GucSource source)
+{
+#ifndef USE_PREFETCH
+	if (*newval)
+	{
+		GUC_check_errdetail("recovery_prefetch must be set to off on platforms that lack posix_fadvise().");
+		return false;
+	}
+#endif							/* USE_PREFETCH */
+	return true;
+}
+
 static bool
 check_huge_page_size(int *newval, void **extra, GucSource source)
 {
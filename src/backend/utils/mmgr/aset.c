@@ -538,6 +538,7 @@ AllocSetContextCreateInternal(MemoryContext parent,
 						name);
 
 	((MemoryContext) set)->mem_allocated = firstBlockSize;
+	*my_allocated_bytes += firstBlockSize;
 
 	return (MemoryContext) set;
 }
@@ -600,6 +601,7 @@ AllocSetReset(MemoryContext context)
 		{
 			/* Normal case, release the block */
 			context->mem_allocated -= block->endptr - ((char *) block);
+			*my_allocated_bytes -= block->endptr - ((char *) block);
 
 #ifdef CLOBBER_FREED_MEMORY
 			wipe_mem(block, block->freeptr - ((char *) block));
@@ -666,6 +668,7 @@ AllocSetDelete(MemoryContext context)
 				freelist->num_free--;
 
 				/* All that remains is to free the header/initial block */
+				*my_allocated_bytes -= oldset->keeper->endptr - ((char *) oldset);
 				free(oldset);
 			}
 			Assert(freelist->num_free == 0);
@@ -685,7 +688,10 @@ AllocSetDelete(MemoryContext context)
 		AllocBlock	next = block->next;
 
 		if (block != set->keeper)
+		{
 			context->mem_allocated -= block->endptr - ((char *) block);
+			*my_allocated_bytes -= block->endptr - ((char *) block);
+		}
 
 #ifdef CLOBBER_FREED_MEMORY
 		wipe_mem(block, block->freeptr - ((char *) block));
@@ -700,6 +706,7 @@ AllocSetDelete(MemoryContext context)
 	Assert(context->mem_allocated == keepersize);
 
 	/* Finally, free the context header, including the keeper block */
+	*my_allocated_bytes -= context->mem_allocated;
 	free(set);
 }
 
@@ -736,11 +743,14 @@ AllocSetAlloc(MemoryContext context, Size size)
 	{
 		chunk_size = MAXALIGN(size);
 		blksize = chunk_size + ALLOC_BLOCKHDRSZ + ALLOC_CHUNKHDRSZ;
+		if (MemoryLimitExceeded(blksize))
+			return NULL;
 		block = (AllocBlock) malloc(blksize);
 		if (block == NULL)
 			return NULL;
 
 		context->mem_allocated += blksize;
+		*my_allocated_bytes += blksize;
 
 		block->aset = set;
 		block->freeptr = block->endptr = ((char *) block) + blksize;
@@ -915,6 +925,17 @@ AllocSetAlloc(MemoryContext context, Size size)
 		while (blksize < required_size)
 			blksize <<= 1;
 
+		/*
+		 * If a block that big would take the backend past its memory limit,
+		 * make do with one just big enough for the request.
+		 */
+		if (MemoryLimitExceeded(blksize))
+		{
+			blksize = required_size;
+			if (MemoryLimitExceeded(blksize))
+				return NULL;
+		}
+
 		/* Try to allocate it */
 		block = (AllocBlock) malloc(blksize);
 
@@ -934,6 +955,7 @@ AllocSetAlloc(MemoryContext context, Size size)
 			return NULL;
 
 		context->mem_allocated += blksize;
+		*my_allocated_bytes += blksize;
 
 		block->aset = set;
 		block->freeptr = ((char *) block) + ALLOC_BLOCKHDRSZ;
@@ -1033,6 +1055,7 @@ AllocSetFree(MemoryContext context, void *pointer)
 			block->next->prev = block->prev;
 
 		context->mem_allocated -= block->endptr - ((char *) block);
+		*my_allocated_bytes -= block->endptr - ((char *) block);
 
 #ifdef CLOBBER_FREED_MEMORY
 		wipe_mem(block, block->freeptr - ((char *) block));
@@ -1126,7 +1149,11 @@ AllocSetRealloc(MemoryContext context, void *pointer, Size size)
 		blksize = chksize + ALLOC_BLOCKHDRSZ + ALLOC_CHUNKHDRSZ;
 		oldblksize = block->endptr - ((char *) block);
 
-		block = (AllocBlock) realloc(block, blksize);
+		if (blksize > oldblksize &&
+			MemoryLimitExceeded(blksize - oldblksize))
+			block = NULL;
+		else
+			block = (AllocBlock) realloc(block, blksize);
 		if (block == NULL)
 		{
 			/* Disallow external access to private part of chunk header. */
@@ -1137,6 +1164,8 @@ AllocSetRealloc(MemoryContext context, void *pointer, Size size)
 		/* updated separately, not to underflow when (oldblksize > blksize) */
 		context->mem_allocated -= oldblksize;
 		context->mem_allocated += blksize;
+		*my_allocated_bytes -= oldblksize;
+		*my_allocated_bytes += blksize;
 
 		block->freeptr = block->endptr = ((char *) block) + blksize;
 
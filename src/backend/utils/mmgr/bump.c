@@ -0,0 +1,680 @@
+/*-------------------------------------------------------------------------
+ *
+ * bump.c
+ *	  Bump allocator definitions.
+ *
+ * Bump is a MemoryContext implementation designed for memory usages which
+ * require allocating a large number of chunks, none of which ever need to be
+ * pfree'd or realloc'd.
+ *
+ * Portions Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/mmgr/bump.c
+ *
+ *
+ *	Bump is best suited to cases where a large number of short-lived chunks
+ *	are allocated and then all released at once by resetting or deleting the
+ *	context, such as tuples being collected for a sort.  Allocation just
+ *	carves the next piece off the current block, and the space needed for
+ *	each chunk is only its payload, rounded up to MAXALIGN, plus the pointer
+ *	to the owning context.
+ *
+ *	All the other memory context implementations need more bookkeeping in the
+ *	chunk header so that they can handle pfree and repalloc.  Bump keeps none,
+ *	so pfree, repalloc and GetMemoryChunkSpace are not supported, and raise
+ *	an error.  The context link itself can't be omitted, because pfree() and
+ *	friends have no other way to find out what kind of context a chunk
+ *	belongs to; with it, calling one of those by mistake gives a clean error
+ *	rather than a crash.
+ *
+ *	Like aset.c, the first block is allocated together with the context
+ *	header and kept over resets, and the size of further blocks doubles up to
+ *	maxBlockSize.  Chunks too large for a fraction of maxBlockSize get a
+ *	dedicated block.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "lib/ilist.h"
+#include "utils/memdebug.h"
+#include "utils/memutils.h"
+
+
+#define Bump_BLOCKHDRSZ		MAXALIGN(sizeof(BumpBlock))
+#define Bump_CHUNKHDRSZ		sizeof(BumpChunk)
+
+/*
+ * Chunks larger than 1/Bump_CHUNK_FRACTION of maxBlockSize are allocated in
+ * dedicated blocks, so that a stream of large requests doesn't waste too much
+ * space at the end of blocks.
+ */
+#define Bump_CHUNK_FRACTION	8
+
+typedef struct BumpBlock BumpBlock; /* forward reference */
+typedef struct BumpChunk BumpChunk;
+
+/*
+ * BumpContext is a memory context that only ever hands out new chunks; the
+ * memory is only released by resetting or deleting the whole context.
+ */
+typedef struct BumpContext
+{
+	MemoryContextData header;	/* Standard memory-context fields */
+
+	/* Bump context parameters */
+	Size		initBlockSize;	/* initial block size */
+	Size		maxBlockSize;	/* maximum block size */
+	Size		nextBlockSize;	/* next block size to allocate */
+	Size		allocChunkLimit;	/* effective chunk size limit */
+
+	BumpBlock  *keeper;			/* keep this block over resets */
+	dlist_head	blocks;			/* list of blocks, current block first */
+} BumpContext;
+
+/*
+ * BumpBlock
+ *		BumpBlock is the unit of memory that is obtained by bump.c from
+ *		malloc().  It contains one or more BumpChunks, which are the units
+ *		requested by palloc().
+ *
+ *		BumpBlock is the header data for a block --- the usable space within
+ *		the block begins at the next alignment boundary.
+ */
+struct BumpBlock
+{
+	dlist_node	node;			/* doubly-linked list of blocks */
+	char	   *freeptr;		/* start of free space in this block */
+	char	   *endptr;			/* end of space in this block */
+};
+
+/*
+ * BumpChunk
+ *		The prefix of each piece of memory in a BumpBlock
+ *
+ * In a normal build, the header is just the "context" link, which must be
+ * immediately adjacent to the payload area (cf. GetMemoryChunkContext).
+ * When debugging memory usage, we also store the chunk and requested sizes,
+ * so that BumpCheck can walk the chunks and verify the sentinels.  As in
+ * generation.c, padding is added before the context link when needed to keep
+ * sizeof(BumpChunk) maxaligned.
+ */
+struct BumpChunk
+{
+#ifdef MEMORY_CONTEXT_CHECKING
+	/* usable space in the chunk, and the size that was actually requested */
+	Size		size;
+	Size		requested_size;
+
+#define BUMPCHUNK_RAWSIZE  (SIZEOF_SIZE_T * 2 + SIZEOF_VOID_P)
+#else
+#define BUMPCHUNK_RAWSIZE  (SIZEOF_VOID_P)
+#endif							/* MEMORY_CONTEXT_CHECKING */
+
+	/* ensure proper alignment by adding padding if needed */
+#if (BUMPCHUNK_RAWSIZE % MAXIMUM_ALIGNOF) != 0
+	char		padding[MAXIMUM_ALIGNOF - BUMPCHUNK_RAWSIZE % MAXIMUM_ALIGNOF];
+#endif
+
+	BumpContext *context;		/* owning context */
+	/* there must not be any padding to reach a MAXALIGN boundary here! */
+};
+
+/*
+ * Only the "context" field should be accessed outside this module.
+ * We keep the rest of an allocated chunk's header marked NOACCESS when using
+ * valgrind.
+ */
+#define BUMPCHUNK_PRIVATE_LEN	offsetof(BumpChunk, context)
+
+/*
+ * BumpIsValid
+ *		True iff set is valid bump context.
+ */
+#define BumpIsValid(set) PointerIsValid(set)
+
+#define BumpPointerGetChunk(ptr) \
+	((BumpChunk *)(((char *)(ptr)) - Bump_CHUNKHDRSZ))
+#define BumpChunkGetPointer(chk) \
+	((void *)(((char *)(chk)) + Bump_CHUNKHDRSZ))
+
+#define BumpBlockIsEmpty(block) \
+	((block)->freeptr == ((char *) (block)) + Bump_BLOCKHDRSZ)
+
+/*
+ * These functions implement the MemoryContext API for Bump contexts.
+ */
+static void *BumpAlloc(MemoryContext context, Size size);
+static void BumpFree(MemoryContext context, void *pointer);
+static void *BumpRealloc(MemoryContext context, void *pointer, Size size);
+static void BumpReset(MemoryContext context);
+static void BumpDelete(MemoryContext context);
+static Size BumpGetChunkSpace(MemoryContext context, void *pointer);
+static bool BumpIsEmpty(MemoryContext context);
+static void BumpStats(MemoryContext context,
+					  MemoryStatsPrintFunc printfunc, void *passthru,
+					  MemoryContextCounters *totals);
+
+#ifdef MEMORY_CONTEXT_CHECKING
+static void BumpCheck(MemoryContext context);
+#endif
+
+/*
+ * This is the virtual function table for Bump contexts.
+ */
+static const MemoryContextMethods BumpMethods = {
+	BumpAlloc,
+	BumpFree,
+	BumpRealloc,
+	BumpReset,
+	BumpDelete,
+	BumpGetChunkSpace,
+	BumpIsEmpty,
+	BumpStats
+#ifdef MEMORY_CONTEXT_CHECKING
+	,BumpCheck
+#endif
+};
+
+
+/*
+ * Public routines
+ */
+
+
+/*
+ * BumpContextCreate
+ *		Create a new Bump context.
+ *
+ * parent: parent context, or NULL if top-level context
+ * name: name of context (must be statically allocated)
+ * minContextSize: minimum context size
+ * initBlockSize: initial allocation block size
+ * maxBlockSize: maximum allocation block size
+ *
+ * The parameters have the same meaning as for AllocSetContextCreate, so the
+ * ALLOCSET_*_SIZES macros can be used.
+ */
+MemoryContext
+BumpContextCreate(MemoryContext parent,
+				  const char *name,
+				  Size minContextSize,
+				  Size initBlockSize,
+				  Size maxBlockSize)
+{
+	Size		firstBlockSize;
+	BumpContext *set;
+	BumpBlock  *block;
+
+	/* Assert we padded BumpChunk properly */
+	StaticAssertStmt(Bump_CHUNKHDRSZ == MAXALIGN(Bump_CHUNKHDRSZ),
+					 "sizeof(BumpChunk) is not maxaligned");
+	StaticAssertStmt(offsetof(BumpChunk, context) + sizeof(MemoryContext) ==
+					 Bump_CHUNKHDRSZ,
+					 "padding calculation in BumpChunk is wrong");
+
+	/*
+	 * First, validate allocation parameters.  As in aset.c, Asserts seem
+	 * sufficient because nobody varies their parameters at runtime.
+	 */
+	Assert(initBlockSize == MAXALIGN(initBlockSize) &&
+		   initBlockSize >= 1024);
+	Assert(maxBlockSize == MAXALIGN(maxBlockSize) &&
+		   maxBlockSize >= initBlockSize &&
+		   AllocHugeSizeIsValid(maxBlockSize)); /* must be safe to double */
+	Assert(minContextSize == 0 ||
+		   (minContextSize == MAXALIGN(minContextSize) &&
+			minContextSize >= 1024 &&
+			minContextSize <= maxBlockSize));
+
+	/* Determine size of initial block */
+	firstBlockSize = MAXALIGN(sizeof(BumpContext)) +
+		Bump_BLOCKHDRSZ + Bump_CHUNKHDRSZ;
+	if (minContextSize != 0)
+		firstBlockSize = Max(firstBlockSize, minContextSize);
+	else
+		firstBlockSize = Max(firstBlockSize, initBlockSize);
+
+	/*
+	 * Allocate the initial block.  Unlike other blocks, it starts with the
+	 * context header and its block header follows that.
+	 */
+	set = (BumpContext *) malloc(firstBlockSize);
+	if (set == NULL)
+	{
+		if (TopMemoryContext)
+			MemoryContextStats(TopMemoryContext);
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while creating memory context \"%s\".",
+						   name)));
+	}
+
+	/*
+	 * Avoid writing code that can fail between here and MemoryContextCreate;
+	 * we'd leak the header/initial block if we ereport in this stretch.
+	 */
+
+	/* Fill in the initial block's block header */
+	block = (BumpBlock *) (((char *) set) + MAXALIGN(sizeof(BumpContext)));
+	block->freeptr = ((char *) block) + Bump_BLOCKHDRSZ;
+	block->endptr = ((char *) set) + firstBlockSize;
+
+	/* Mark unallocated space NOACCESS; leave the block header alone. */
+	VALGRIND_MAKE_MEM_NOACCESS(block->freeptr, block->endptr - block->freeptr);
+
+	/* Fill in Bump-specific header fields */
+	set->initBlockSize = initBlockSize;
+	set->maxBlockSize = maxBlockSize;
+	set->nextBlockSize = initBlockSize;
+	set->allocChunkLimit = maxBlockSize / Bump_CHUNK_FRACTION;
+	set->keeper = block;
+	dlist_init(&set->blocks);
+	dlist_push_head(&set->blocks, &block->node);
+
+	/* Finally, do the type-independent part of context creation */
+	MemoryContextCreate((MemoryContext) set,
+						T_BumpContext,
+						&BumpMethods,
+						parent,
+						name);
+
+	((MemoryContext) set)->mem_allocated = firstBlockSize;
+	*my_allocated_bytes += firstBlockSize;
+
+	return (MemoryContext) set;
+}
+
+/*
+ * BumpReset
+ *		Frees all memory which is allocated in the given set.
+ *
+ * All blocks except the keeper block are returned to malloc(), and the
+ * keeper block is emptied.
+ */
+static void
+BumpReset(MemoryContext context)
+{
+	BumpContext *set = (BumpContext *) context;
+	dlist_mutable_iter miter;
+
+	AssertArg(BumpIsValid(set));
+
+#ifdef MEMORY_CONTEXT_CHECKING
+	/* Check for corruption and leaks before freeing */
+	BumpCheck(context);
+#endif
+
+	dlist_foreach_modify(miter, &set->blocks)
+	{
+		BumpBlock  *block = dlist_container(BumpBlock, node, miter.cur);
+
+		if (block == set->keeper)
+		{
+			/* Reset the block, but don't return it to malloc */
+			char	   *datastart = ((char *) block) + Bump_BLOCKHDRSZ;
+
+#ifdef CLOBBER_FREED_MEMORY
+			wipe_mem(datastart, block->freeptr - datastart);
+#else
+			/* wipe_mem() would have done this */
+			VALGRIND_MAKE_MEM_NOACCESS(datastart, block->freeptr - datastart);
+#endif
+			block->freeptr = datastart;
+		}
+		else
+		{
+			Size		blksize = block->endptr - ((char *) block);
+
+			dlist_delete(miter.cur);
+
+			context->mem_allocated -= blksize;
+			*my_allocated_bytes -= blksize;
+
+#ifdef CLOBBER_FREED_MEMORY
+			wipe_mem(block, blksize);
+#endif
+
+			free(block);
+		}
+	}
+
+	/* Reset block size allocation sequence, too */
+	set->nextBlockSize = set->initBlockSize;
+
+	/* The keeper block is now the only block, and the current one */
+	Assert(dlist_head_node(&set->blocks) == &set->keeper->node);
+	Assert(!dlist_has_next(&set->blocks, &set->keeper->node));
+}
+
+/*
+ * BumpDelete
+ *		Free all memory which is allocated in the given context.
+ */
+static void
+BumpDelete(MemoryContext context)
+{
+	/* Reset to release all the BumpBlocks except the keeper */
+	BumpReset(context);
+	/* And free the context header and keeper block */
+	*my_allocated_bytes -= context->mem_allocated;
+	free(context);
+}
+
+/*
+ * BumpAlloc
+ *		Returns pointer to allocated memory of given size or NULL if
+ *		request could not be completed; memory is added to the set.
+ *
+ * No request may exceed:
+ *		MAXALIGN_DOWN(SIZE_MAX) - Bump_BLOCKHDRSZ - Bump_CHUNKHDRSZ
+ * All callers use a much-lower limit.
+ *
+ * Note: when using valgrind, it doesn't matter how the returned allocation
+ * is marked, as mcxt.c will set it to UNDEFINED.
+ */
+static void *
+BumpAlloc(MemoryContext context, Size size)
+{
+	BumpContext *set = (BumpContext *) context;
+	BumpBlock  *block;
+	BumpChunk  *chunk;
+	Size		chunk_size = MAXALIGN(size);
+	Size		required_size = chunk_size + Bump_CHUNKHDRSZ;
+
+	/* is it an over-sized chunk? if yes, allocate special block */
+	if (chunk_size > set->allocChunkLimit)
+	{
+		Size		blksize = required_size + Bump_BLOCKHDRSZ;
+
+		if (MemoryLimitExceeded(blksize))
+			return NULL;
+		block = (BumpBlock *) malloc(blksize);
+		if (block == NULL)
+			return NULL;
+
+		context->mem_allocated += blksize;
+		*my_allocated_bytes += blksize;
+
+		/* the block is completely full */
+		block->freeptr = block->endptr = ((char *) block) + blksize;
+
+		/*
+		 * Add the block to the tail of the list, so that the current block
+		 * remains the one at the head.
+		 */
+		dlist_push_tail(&set->blocks, &block->node);
+
+		chunk = (BumpChunk *) (((char *) block) + Bump_BLOCKHDRSZ);
+	}
+	else
+	{
+		/*
+		 * Not an over-sized chunk. Is there enough space in the current
+		 * block?  If not, allocate a new "regular" block.  The space left at
+		 * the end of the old block is simply wasted; with chunks no larger
+		 * than allocChunkLimit, that is never a large fraction of it.
+		 */
+		block = dlist_head_element(BumpBlock, node, &set->blocks);
+
+		if ((Size) (block->endptr - block->freeptr) < required_size)
+		{
+			Size		blksize;
+
+			/*
+			 * The first such block has size initBlockSize, and we double the
+			 * space in each succeeding block, but not more than
+			 * maxBlockSize.
+			 */
+			blksize = set->nextBlockSize;
+			set->nextBlockSize <<= 1;
+			if (set->nextBlockSize > set->maxBlockSize)
+				set->nextBlockSize = set->maxBlockSize;
+
+			/* If initBlockSize is for some reason too small, enlarge it */
+			while (blksize < required_size + Bump_BLOCKHDRSZ)
+				blksize <<= 1;
+
+			/* As in aset.c, shrink the block if near the memory limit */
+			if (MemoryLimitExceeded(blksize))
+			{
+				blksize = required_size + Bump_BLOCKHDRSZ;
+				if (MemoryLimitExceeded(blksize))
+					return NULL;
+			}
+
+			block = (BumpBlock *) malloc(blksize);
+			if (block == NULL)
+				return NULL;
+
+			context->mem_allocated += blksize;
+			*my_allocated_bytes += blksize;
+
+			block->freeptr = ((char *) block) + Bump_BLOCKHDRSZ;
+			block->endptr = ((char *) block) + blksize;
+
+			/* Mark unallocated space NOACCESS. */
+			VALGRIND_MAKE_MEM_NOACCESS(block->freeptr,
+									   blksize - Bump_BLOCKHDRSZ);
+
+			/* make it the current allocation block */
+			dlist_push_head(&set->blocks, &block->node);
+		}
+
+		/* we're supposed to have a block with enough free space now */
+		Assert((Size) (block->endptr - block->freeptr) >= required_size);
+
+		chunk = (BumpChunk *) block->freeptr;
+
+		/* Prepare to initialize the chunk header. */
+		VALGRIND_MAKE_MEM_UNDEFINED(chunk, Bump_CHUNKHDRSZ);
+
+		block->freeptr += required_size;
+		Assert(block->freeptr <= block->endptr);
+	}
+
+	chunk->context = set;
+
+#ifdef MEMORY_CONTEXT_CHECKING
+	chunk->size = chunk_size;
+	chunk->requested_size = size;
+	/* set mark to catch clobber of "unused" space */
+	if (size < chunk_size)
+		set_sentinel(BumpChunkGetPointer(chunk), size);
+#endif
+#ifdef RANDOMIZE_ALLOCATED_MEMORY
+	/* fill the allocated space with junk */
+	randomize_mem((char *) BumpChunkGetPointer(chunk), size);
+#endif
+
+	/* Ensure any padding bytes are marked NOACCESS. */
+	VALGRIND_MAKE_MEM_NOACCESS((char *) BumpChunkGetPointer(chunk) + size,
+							   chunk_size - size);
+
+	/* Disallow external access to private part of chunk header. */
+	VALGRIND_MAKE_MEM_NOACCESS(chunk, BUMPCHUNK_PRIVATE_LEN);
+
+	return BumpChunkGetPointer(chunk);
+}
+
+/*
+ * BumpFree
+ *		Unsupported.
+ */
+static void
+BumpFree(MemoryContext context, void *pointer)
+{
+	elog(ERROR, "%s is not supported by the bump memory allocator", "pfree");
+}
+
+/*
+ * BumpRealloc
+ *		Unsupported.
+ */
+static void *
+BumpRealloc(MemoryContext context, void *pointer, Size size)
+{
+	elog(ERROR, "%s is not supported by the bump memory allocator", "realloc");
+	return NULL;				/* keep compiler quiet */
+}
+
+/*
+ * BumpGetChunkSpace
+ *		Unsupported, as the chunk header doesn't record the size.
+ */
+static Size
+BumpGetChunkSpace(MemoryContext context, void *pointer)
+{
+	elog(ERROR, "%s is not supported by the bump memory allocator",
+		 "GetMemoryChunkSpace");
+	return 0;					/* keep compiler quiet */
+}
+
+/*
+ * BumpIsEmpty
+ *		Is a BumpContext empty of any allocated space?
+ */
+static bool
+BumpIsEmpty(MemoryContext context)
+{
+	BumpContext *set = (BumpContext *) context;
+	dlist_iter	iter;
+
+	dlist_foreach(iter, &set->blocks)
+	{
+		BumpBlock  *block = dlist_container(BumpBlock, node, iter.cur);
+
+		if (!BumpBlockIsEmpty(block))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * BumpStats
+ *		Compute stats about memory consumption of a Bump context.
+ *
+ * printfunc: if not NULL, pass a human-readable stats string to this.
+ * passthru: pass this pointer through to printfunc.
+ * totals: if not NULL, add stats about this context into *totals.
+ *
+ * The number of chunks is not tracked, and there are never any free chunks;
+ * freespace is the unused space at the end of the blocks.
+ */
+static void
+BumpStats(MemoryContext context,
+		  MemoryStatsPrintFunc printfunc, void *passthru,
+		  MemoryContextCounters *totals)
+{
+	BumpContext *set = (BumpContext *) context;
+	Size		nblocks = 0;
+	Size		totalspace;
+	Size		freespace = 0;
+	dlist_iter	iter;
+
+	/* Include context header in totalspace */
+	totalspace = MAXALIGN(sizeof(BumpContext));
+
+	dlist_foreach(iter, &set->blocks)
+	{
+		BumpBlock  *block = dlist_container(BumpBlock, node, iter.cur);
+
+		nblocks++;
+		totalspace += block->endptr - ((char *) block);
+		freespace += block->endptr - block->freeptr;
+	}
+
+	if (printfunc)
+	{
+		char		stats_string[200];
+
+		snprintf(stats_string, sizeof(stats_string),
+				 "%zu total in %zd blocks; %zu free; %zu used",
+				 totalspace, nblocks, freespace, totalspace - freespace);
+		printfunc(context, passthru, stats_string);
+	}
+
+	if (totals)
+	{
+		totals->nblocks += nblocks;
+		totals->totalspace += totalspace;
+		totals->freespace += freespace;
+	}
+}
+
+
+#ifdef MEMORY_CONTEXT_CHECKING
+
+/*
+ * BumpCheck
+ *		Walk through chunks and check consistency of memory.
+ *
+ * NOTE: report errors as WARNING, *not* ERROR or FATAL.  Otherwise you'll
+ * find yourself in an infinite loop when trouble occurs, because this
+ * routine will be entered again when elog cleanup tries to release memory!
+ */
+static void
+BumpCheck(MemoryContext context)
+{
+	BumpContext *bump = (BumpContext *) context;
+	const char *name = context->name;
+	dlist_iter	iter;
+	Size		total_allocated = 0;
+
+	/* walk all blocks in this context */
+	dlist_foreach(iter, &bump->blocks)
+	{
+		BumpBlock  *block = dlist_container(BumpBlock, node, iter.cur);
+		char	   *ptr;
+
+		if (block == bump->keeper)
+			total_allocated += block->endptr - ((char *) bump);
+		else
+			total_allocated += block->endptr - ((char *) block);
+
+		/* Now walk through the chunks */
+		ptr = ((char *) block) + Bump_BLOCKHDRSZ;
+
+		while (ptr < block->freeptr)
+		{
+			BumpChunk  *chunk = (BumpChunk *) ptr;
+
+			/* Allow access to private part of chunk header. */
+			VALGRIND_MAKE_MEM_DEFINED(chunk, BUMPCHUNK_PRIVATE_LEN);
+
+			/* move to the next chunk */
+			ptr += (chunk->size + Bump_CHUNKHDRSZ);
+
+			if (chunk->context != bump)
+				elog(WARNING, "problem in Bump %s: bogus context link in block %p, chunk %p",
+					 name, block, chunk);
+
+			/* now make sure the chunk size is correct */
+			if (chunk->size < chunk->requested_size ||
+				chunk->size != MAXALIGN(chunk->size))
+				elog(WARNING, "problem in Bump %s: bogus chunk size in block %p, chunk %p",
+					 name, block, chunk);
+
+			/* check sentinel */
+			if (chunk->requested_size < chunk->size &&
+				!sentinel_ok(chunk, Bump_CHUNKHDRSZ + chunk->requested_size))
+				elog(WARNING, "problem in Bump %s: detected write past chunk end in block %p, chunk %p",
+					 name, block, chunk);
+
+			/* Disallow external access to private part of chunk header. */
+			VALGRIND_MAKE_MEM_NOACCESS(chunk, BUMPCHUNK_PRIVATE_LEN);
+		}
+
+		if (ptr != block->freeptr)
+			elog(WARNING, "problem in Bump %s: chunks overrun free space in block %p",
+				 name, block);
+	}
+
+	Assert(total_allocated == context->mem_allocated);
+}
+
+#endif							/* MEMORY_CONTEXT_CHECKING */
@@ -282,6 +282,7 @@ GenerationReset(MemoryContext context)
 		dlist_delete(miter.cur);
 
 		context->mem_allocated -= block->blksize;
+		*my_allocated_bytes -= block->blksize;
 
 #ifdef CLOBBER_FREED_MEMORY
 		wipe_mem(block, block->blksize);
@@ -334,11 +335,14 @@ GenerationAlloc(MemoryContext context, Size size)
 	{
 		Size		blksize = chunk_size + Generation_BLOCKHDRSZ + Generation_CHUNKHDRSZ;
 
+		if (MemoryLimitExceeded(blksize))
+			return NULL;
 		block = (GenerationBlock *) malloc(blksize);
 		if (block == NULL)
 			return NULL;
 
 		context->mem_allocated += blksize;
+		*my_allocated_bytes += blksize;
 
 		/* block with a single (used) chunk */
 		block->blksize = blksize;
@@ -388,12 +392,15 @@ GenerationAlloc(MemoryContext context, Size size)
 	{
 		Size		blksize = set->blockSize;
 
+		if (MemoryLimitExceeded(blksize))
+			return NULL;
 		block = (GenerationBlock *) malloc(blksize);
 
 		if (block == NULL)
 			return NULL;
 
 		context->mem_allocated += blksize;
+		*my_allocated_bytes += blksize;
 
 		block->blksize = blksize;
 		block->nchunks = 0;
@@ -509,6 +516,7 @@ GenerationFree(MemoryContext context, void *pointer)
 		set->block = NULL;
 
 	context->mem_allocated -= block->blksize;
+	*my_allocated_bytes -= block->blksize;
 	free(block);
 }
 
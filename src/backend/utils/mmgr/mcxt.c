@@ -23,6 +23,7 @@
 
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
+#include "storage/ipc.h"
 #include "utils/memdebug.h"
 #include "utils/memutils.h"
 
@@ -52,6 +53,18 @@ MemoryContext CurTransactionContext = NULL;
 /* This is a transient link to the active portal's memory context: */
 MemoryContext PortalContext = NULL;
 
+/*
+ * Total memory obtained from malloc() by all memory contexts of this
+ * process, as reflected by their mem_allocated.  Once the backend has a
+ * status entry in shared memory, the counter is kept there instead, so that
+ * pg_stat_activity can show it; see SetAllocatedBytesCounter().
+ */
+static uint64 local_allocated_bytes = 0;
+uint64	   *my_allocated_bytes = &local_allocated_bytes;
+
+/* GUC variable: limit on my_allocated_bytes, in megabytes, or 0 for none */
+int			max_backend_memory = 0;
+
 static void MemoryContextCallResetCallbacks(MemoryContext context);
 static void MemoryContextStatsInternal(MemoryContext context, int level,
 									   bool print, int max_children,
@@ -487,6 +500,50 @@ MemoryContextMemAllocated(MemoryContext context, bool recurse)
 	return total;
 }
 
+/*
+ * SetAllocatedBytesCounter
+ *		Keep the process's count of allocated bytes in *counter from now on,
+ *		or in process-local storage if counter is NULL.
+ *
+ * The current count is carried over.  pgstat.c uses this to move the counter
+ * into the backend's status entry, and back out when the entry is released.
+ */
+void
+SetAllocatedBytesCounter(uint64 *counter)
+{
+	if (counter == NULL)
+		counter = &local_allocated_bytes;
+
+	*counter = *my_allocated_bytes;
+	my_allocated_bytes = counter;
+}
+
+/*
+ * MemoryLimitExceededSlow
+ *		Would obtaining another "size" bytes from malloc() take the process
+ *		past max_backend_memory?
+ *
+ * This is the out-of-line part of MemoryLimitExceeded(), reached only when a
+ * limit is set.  The limit is not enforced in the postmaster or a standalone
+ * backend, nor where failing would do more harm than the allocation: inside
+ * critical sections, where the error would be promoted to PANIC, while an
+ * error is being reported, and during process exit.
+ */
+bool
+MemoryLimitExceededSlow(Size size)
+{
+	uint64		limit = (uint64) max_backend_memory * 1024 * 1024;
+
+	if (*my_allocated_bytes + size <= limit)
+		return false;
+
+	if (!IsUnderPostmaster || CritSectionCount > 0 ||
+		CurrentMemoryContext == ErrorContext || proc_exit_inprogress)
+		return false;
+
+	return true;
+}
+
 /*
  * MemoryContextStats
  *		Print statistics about the named context and all its descendants.
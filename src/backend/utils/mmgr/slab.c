@@ -308,6 +308,7 @@ SlabReset(MemoryContext context)
 			free(block);
 			slab->nblocks--;
 			context->mem_allocated -= slab->blockSize;
+			*my_allocated_bytes -= slab->blockSize;
 		}
 	}
 
@@ -362,6 +363,8 @@ SlabAlloc(MemoryContext context, Size size)
 	 */
 	if (slab->minFreeChunks == 0)
 	{
+		if (MemoryLimitExceeded(slab->blockSize))
+			return NULL;
 		block = (SlabBlock *) malloc(slab->blockSize);
 
 		if (block == NULL)
@@ -393,6 +396,7 @@ SlabAlloc(MemoryContext context, Size size)
 		slab->minFreeChunks = slab->chunksPerBlock;
 		slab->nblocks += 1;
 		context->mem_allocated += slab->blockSize;
+		*my_allocated_bytes += slab->blockSize;
 	}
 
 	/* grab the block from the freelist (even the new block is there) */
@@ -560,6 +564,7 @@ SlabFree(MemoryContext context, void *pointer)
 		free(block);
 		slab->nblocks--;
 		context->mem_allocated -= slab->blockSize;
+		*my_allocated_bytes -= slab->blockSize;
 	}
 	else
 		dlist_push_head(&slab->freelist[block->nfree], &block->node);
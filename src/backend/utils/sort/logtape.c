@@ -67,6 +67,17 @@
  * There will always be the same number of runs as input tapes, and the same
  * number of input tapes as participants (worker Tuplesortstates).
  *
+ * When temp_file_compression is set, a serial tape set compresses each block
+ * as it's written.  The underlying file is then divided into chunks of
+ * BLCKSZ / LTS_CHUNKS_PER_BLOCK bytes, and each logical block is stored in
+ * an extent of as many whole chunks as it needs; blockMap[] gives the extent
+ * of each logical block.  Logical block numbers are allocated and recycled
+ * as usual, and so are extents: when a block is released or rewritten, its
+ * extent is put on a free list for its size, and new extents are taken from
+ * there if possible, or else from the end of the file.  Shared tape sets
+ * (parallel sorts) are not compressed, since the leader addresses worker
+ * tapes by physical block number.
+ *
  * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -80,6 +91,7 @@
 
 #include <fcntl.h>
 
+#include "common/pg_lzcompress.h"
 #include "storage/buffile.h"
 #include "utils/builtins.h"
 #include "utils/logtape.h"
@@ -176,6 +188,18 @@ typedef struct LogicalTape
 	int			prealloc_size;	/* number of elements list can hold */
 } LogicalTape;
 
+/*
+ * Compressed tape sets store each block in an extent of whole chunks.
+ */
+#define LTS_CHUNKS_PER_BLOCK	8
+#define LTS_CHUNK_SIZE			(BLCKSZ / LTS_CHUNKS_PER_BLOCK)
+
+typedef struct LtsBlockExtent
+{
+	long		chunk;			/* first chunk, or -1 if not stored */
+	int32		size;			/* # of bytes stored, BLCKSZ if uncompressed */
+} LtsBlockExtent;
+
 /*
  * This data structure represents a set of related "logical tapes" sharing
  * space in a single underlying file.  (But that "file" may be multiple files
@@ -213,6 +237,20 @@ struct LogicalTapeSet
 	long		nFreeBlocks;	/* # of currently free blocks */
 	Size		freeBlocksLen;	/* current allocated length of freeBlocks[] */
 
+	/*
+	 * Block compression state; compression is TEMP_FILE_COMPRESSION_NONE if
+	 * blocks are stored as is.  Free extents are kept in LIFO lists indexed
+	 * by their number of chunks, minus one.
+	 */
+	int			compression;
+	char	   *cbuffer;		/* workspace for compressing a block */
+	LtsBlockExtent *blockMap;	/* extent of each logical block */
+	long		blockMapLen;	/* current allocated length of blockMap[] */
+	long		nChunks;		/* # of chunks in underlying file */
+	long	   *freeExtents[LTS_CHUNKS_PER_BLOCK];
+	long		nFreeExtents[LTS_CHUNKS_PER_BLOCK];
+	long		freeExtentsLen[LTS_CHUNKS_PER_BLOCK];
+
 	/* The array of logical tapes. */
 	int			nTapes;			/* # of logical tapes in set */
 	LogicalTape *tapes;			/* has nTapes nentries */
@@ -220,6 +258,12 @@ struct LogicalTapeSet
 
 static void ltsWriteBlock(LogicalTapeSet *lts, long blocknum, void *buffer);
 static void ltsReadBlock(LogicalTapeSet *lts, long blocknum, void *buffer);
+static void ltsSeekChunk(LogicalTapeSet *lts, long chunk);
+static void ltsWriteCompressedBlock(LogicalTapeSet *lts, long blocknum,
+									void *buffer);
+static void ltsReadCompressedBlock(LogicalTapeSet *lts, long blocknum,
+								   void *buffer);
+static void ltsReleaseExtent(LogicalTapeSet *lts, long blocknum);
 static long ltsGetFreeBlock(LogicalTapeSet *lts);
 static long ltsGetPreallocBlock(LogicalTapeSet *lts, LogicalTape *lt);
 static void ltsReleaseBlock(LogicalTapeSet *lts, long blocknum);
@@ -237,6 +281,12 @@ static void ltsInitReadBuffer(LogicalTapeSet *lts, LogicalTape *lt);
 static void
 ltsWriteBlock(LogicalTapeSet *lts, long blocknum, void *buffer)
 {
+	if (lts->compression != TEMP_FILE_COMPRESSION_NONE)
+	{
+		ltsWriteCompressedBlock(lts, blocknum, buffer);
+		return;
+	}
+
 	/*
 	 * BufFile does not support "holes", so if we're about to write a block
 	 * that's past the current end of file, fill the space between the current
@@ -287,6 +337,12 @@ ltsReadBlock(LogicalTapeSet *lts, long blocknum, void *buffer)
 {
 	size_t		nread;
 
+	if (lts->compression != TEMP_FILE_COMPRESSION_NONE)
+	{
+		ltsReadCompressedBlock(lts, blocknum, buffer);
+		return;
+	}
+
 	if (BufFileSeekBlock(lts->pfile, blocknum) != 0)
 		ereport(ERROR,
 				(errcode_for_file_access(),
@@ -300,6 +356,138 @@ ltsReadBlock(LogicalTapeSet *lts, long blocknum, void *buffer)
 						blocknum, nread, (size_t) BLCKSZ)));
 }
 
+/*
+ * Position the underlying file at the start of the given chunk.
+ */
+static void
+ltsSeekChunk(LogicalTapeSet *lts, long chunk)
+{
+	long		blocknum = chunk / LTS_CHUNKS_PER_BLOCK;
+
+	if (BufFileSeekBlock(lts->pfile, blocknum) != 0 ||
+		BufFileSeek(lts->pfile, 0,
+					(chunk % LTS_CHUNKS_PER_BLOCK) * LTS_CHUNK_SIZE,
+					SEEK_CUR) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not seek to block %ld of temporary file",
+						blocknum)));
+}
+
+/*
+ * Compress a block and write it to a free extent of the underlying file.
+ *
+ * Any extent the block was previously stored in is recycled first.
+ */
+static void
+ltsWriteCompressedBlock(LogicalTapeSet *lts, long blocknum, void *buffer)
+{
+	LtsBlockExtent *extent;
+	char	   *data;
+	int32		size;
+	int			nchunks;
+	long		chunk;
+
+	/* Enlarge blockMap array if needed */
+	if (blocknum >= lts->blockMapLen)
+	{
+		long		newlen = Max(lts->blockMapLen * 2, blocknum + 1);
+
+		lts->blockMap = (LtsBlockExtent *)
+			repalloc_huge(lts->blockMap, newlen * sizeof(LtsBlockExtent));
+		while (lts->blockMapLen < newlen)
+			lts->blockMap[lts->blockMapLen++].chunk = -1L;
+	}
+	extent = &lts->blockMap[blocknum];
+	if (extent->chunk >= 0)
+		ltsReleaseExtent(lts, blocknum);
+
+	size = BufFileCompress(lts->compression, buffer, BLCKSZ, lts->cbuffer);
+	if (size >= 0)
+	{
+		data = lts->cbuffer;
+		nchunks = (size + LTS_CHUNK_SIZE - 1) / LTS_CHUNK_SIZE;
+		/* Zero the padding of the last chunk, which is written too */
+		MemSet(data + size, 0, nchunks * LTS_CHUNK_SIZE - size);
+	}
+	else
+	{
+		data = buffer;
+		size = BLCKSZ;
+		nchunks = LTS_CHUNKS_PER_BLOCK;
+	}
+
+	/* Reuse the most recently freed extent of the same size, if any */
+	if (lts->nFreeExtents[nchunks - 1] > 0)
+		chunk = lts->freeExtents[nchunks - 1][--lts->nFreeExtents[nchunks - 1]];
+	else
+	{
+		chunk = lts->nChunks;
+		lts->nChunks += nchunks;
+	}
+
+	ltsSeekChunk(lts, chunk);
+	BufFileWrite(lts->pfile, data, nchunks * LTS_CHUNK_SIZE);
+
+	extent->chunk = chunk;
+	extent->size = size;
+}
+
+/*
+ * Read a block stored by ltsWriteCompressedBlock(), and decompress it.
+ */
+static void
+ltsReadCompressedBlock(LogicalTapeSet *lts, long blocknum, void *buffer)
+{
+	LtsBlockExtent *extent;
+	char	   *data;
+	size_t		nread;
+
+	if (blocknum >= lts->blockMapLen || lts->blockMap[blocknum].chunk < 0)
+		elog(ERROR, "block %ld of temporary file was never written", blocknum);
+	extent = &lts->blockMap[blocknum];
+
+	data = (extent->size == BLCKSZ) ? buffer : lts->cbuffer;
+	ltsSeekChunk(lts, extent->chunk);
+	nread = BufFileRead(lts->pfile, data, extent->size);
+	if (nread != extent->size)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read block %ld of temporary file: read only %zu of %zu bytes",
+						blocknum, nread, (size_t) extent->size)));
+
+	if (extent->size != BLCKSZ)
+		BufFileDecompress(lts->compression, lts->cbuffer, extent->size,
+						  buffer, BLCKSZ);
+}
+
+/*
+ * Put the extent a logical block is stored in on the free list for its size.
+ */
+static void
+ltsReleaseExtent(LogicalTapeSet *lts, long blocknum)
+{
+	LtsBlockExtent *extent = &lts->blockMap[blocknum];
+	int			i;
+
+	i = (extent->size + LTS_CHUNK_SIZE - 1) / LTS_CHUNK_SIZE - 1;
+	if (lts->nFreeExtents[i] >= lts->freeExtentsLen[i])
+	{
+		/* If the free list becomes very large, just leak this extent */
+		if (lts->freeExtentsLen[i] * 2 * sizeof(long) > MaxAllocSize)
+		{
+			extent->chunk = -1L;
+			return;
+		}
+		lts->freeExtentsLen[i] *= 2;
+		lts->freeExtents[i] = (long *)
+			repalloc(lts->freeExtents[i],
+					 lts->freeExtentsLen[i] * sizeof(long));
+	}
+	lts->freeExtents[i][lts->nFreeExtents[i]++] = extent->chunk;
+	extent->chunk = -1L;
+}
+
 /*
  * Read as many blocks as we can into the per-tape buffer.
  *
@@ -482,6 +670,10 @@ ltsReleaseBlock(LogicalTapeSet *lts, long blocknum)
 	if (lts->forgetFreeSpace)
 		return;
 
+	if (lts->compression != TEMP_FILE_COMPRESSION_NONE &&
+		blocknum < lts->blockMapLen && lts->blockMap[blocknum].chunk >= 0)
+		ltsReleaseExtent(lts, blocknum);
+
 	/*
 	 * Enlarge freeBlocks array if full.
 	 */
@@ -689,6 +881,11 @@ LogicalTapeSetCreate(int ntapes, TapeShare *shared, SharedFileSet *fileset,
 	lts->freeBlocksLen = 32;	/* reasonable initial guess */
 	lts->freeBlocks = (long *) palloc(lts->freeBlocksLen * sizeof(long));
 	lts->nFreeBlocks = 0;
+	lts->compression = TEMP_FILE_COMPRESSION_NONE;
+	lts->cbuffer = NULL;
+	lts->blockMap = NULL;
+	lts->blockMapLen = 0;
+	lts->nChunks = 0;
 	lts->nTapes = ntapes;
 	lts->tapes = (LogicalTape *) palloc(ntapes * sizeof(LogicalTape));
 
@@ -713,8 +910,28 @@ LogicalTapeSetCreate(int ntapes, TapeShare *shared, SharedFileSet *fileset,
 		lts->pfile = BufFileCreateShared(fileset, filename);
 	}
 	else
+	{
 		lts->pfile = BufFileCreateTemp(false);
 
+		if (temp_file_compression != TEMP_FILE_COMPRESSION_NONE)
+		{
+			lts->compression = temp_file_compression;
+			lts->cbuffer = palloc(PGLZ_MAX_OUTPUT(BLCKSZ));
+			lts->blockMapLen = 32;
+			lts->blockMap = (LtsBlockExtent *)
+				palloc(lts->blockMapLen * sizeof(LtsBlockExtent));
+			for (i = 0; i < lts->blockMapLen; i++)
+				lts->blockMap[i].chunk = -1L;
+			for (i = 0; i < LTS_CHUNKS_PER_BLOCK; i++)
+			{
+				lts->freeExtentsLen[i] = 32;
+				lts->freeExtents[i] = (long *)
+					palloc(lts->freeExtentsLen[i] * sizeof(long));
+				lts->nFreeExtents[i] = 0;
+			}
+		}
+	}
+
 	return lts;
 }
 
@@ -736,6 +953,13 @@ LogicalTapeSetClose(LogicalTapeSet *lts)
 	}
 	pfree(lts->tapes);
 	pfree(lts->freeBlocks);
+	if (lts->compression != TEMP_FILE_COMPRESSION_NONE)
+	{
+		pfree(lts->cbuffer);
+		pfree(lts->blockMap);
+		for (i = 0; i < LTS_CHUNKS_PER_BLOCK; i++)
+			pfree(lts->freeExtents[i]);
+	}
 	pfree(lts);
 }
 
@@ -1052,6 +1276,9 @@ LogicalTapeFreeze(LogicalTapeSet *lts, int tapenum, TapeShare *share)
 	lt->writing = false;
 	lt->frozen = true;
 
+	/* Shared tape sets are never compressed */
+	Assert(share == NULL || lts->compression == TEMP_FILE_COMPRESSION_NONE);
+
 	/*
 	 * The seek and backspace functions assume a single block read buffer.
 	 * That's OK with current usage.  A larger buffer is helpful to make the
@@ -1256,5 +1483,7 @@ LogicalTapeTell(LogicalTapeSet *lts, int tapenum,
 long
 LogicalTapeSetBlocks(LogicalTapeSet *lts)
 {
+	if (lts->compression != TEMP_FILE_COMPRESSION_NONE)
+		return (lts->nChunks + LTS_CHUNKS_PER_BLOCK - 1) / LTS_CHUNKS_PER_BLOCK;
 	return lts->nBlocksAllocated - lts->nHoleBlocks;
 }
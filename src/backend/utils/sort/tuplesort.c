@@ -135,6 +135,16 @@
 #define INITIAL_MEMTUPSIZE Max(1024, \
 	ALLOCSET_SEPARATE_THRESHOLD / sizeof(SortTuple) + 1)
 
+/*
+ * In-memory sorts of at least RADIX_SORT_THRESHOLD tuples on a leading
+ * integer key use a radix sort instead of quicksort; for fewer tuples the
+ * bucket bookkeeping of each pass costs more than the comparisons it saves.
+ * Partitions of fewer than RADIX_SORT_INSERTION_THRESHOLD tuples are
+ * finished with an insertion sort.
+ */
+#define RADIX_SORT_THRESHOLD			1024
+#define RADIX_SORT_INSERTION_THRESHOLD	32
+
 /* GUC variables */
 #ifdef TRACE_SORT
 bool		trace_sort = false;
@@ -261,6 +271,7 @@ struct Tuplesortstate
 								 * persists across multiple batches */
 	MemoryContext sortcontext;	/* memory context holding most sort data */
 	MemoryContext tuplecontext; /* sub-context of sortcontext for tuple data */
+	int64		tupleMem;		/* space used by tuples in tuplecontext */
 	LogicalTapeSet *tapeset;	/* logtape.c object for tapes in a temp file */
 
 	/*
@@ -590,6 +601,9 @@ struct Sharedsort
  * a lot better than what we were doing before 7.3.  As of 9.6, a
  * separate memory context is used for caller passed tuples.  Resetting
  * it at certain key increments significantly ameliorates fragmentation.
+ * Unless the sort is bounded, that context is a bump context, which packs
+ * the tuples densely but can't free them individually or report the space
+ * used by one; see use_tuple_memory().
  * Note that this places a responsibility on copytup routines to use the
  * correct memory context for these tuples (and to not use the reset
  * context for anything whose lifetime needs to span multiple external
@@ -624,6 +638,8 @@ static void dumptuples(Tuplesortstate *state, bool alltuples);
 static void make_bounded_heap(Tuplesortstate *state);
 static void sort_bounded_heap(Tuplesortstate *state);
 static void tuplesort_sort_memtuples(Tuplesortstate *state);
+static bool tuplesort_can_radix_sort(Tuplesortstate *state);
+static void tuplesort_radix_sort(Tuplesortstate *state);
 static void tuplesort_heap_insert(Tuplesortstate *state, SortTuple *tuple);
 static void tuplesort_heap_replace_top(Tuplesortstate *state, SortTuple *tuple);
 static void tuplesort_heap_delete_top(Tuplesortstate *state);
@@ -666,6 +682,7 @@ static void worker_freeze_result_tape(Tuplesortstate *state);
 static void worker_nomergeruns(Tuplesortstate *state);
 static void leader_takeover_tapes(Tuplesortstate *state);
 static void free_sort_tuple(Tuplesortstate *state, SortTuple *stup);
+static void use_tuple_memory(Tuplesortstate *state, void *tuple, Size len);
 static void tuplesort_free(Tuplesortstate *state);
 static void tuplesort_updatemax(Tuplesortstate *state);
 
@@ -678,6 +695,158 @@ static void tuplesort_updatemax(Tuplesortstate *state);
  */
 #include "qsort_tuple.c"
 
+/*
+ * Radix sort for SortTuple objects.
+ *
+ * When the leading sort key is a pass-by-value integer compared by one of
+ * the generic comparators in sortsupport.h, datum1 of each non-NULL tuple can
+ * be mapped to an unsigned integer whose natural order is the sort order, and
+ * the tuples can be sorted on that with an MSD radix sort, one byte at a
+ * time, without calling any comparator.  The two kinds of key get their own
+ * copy of the sort, so that the key mapping is compiled into its loops.
+ */
+static void radix_sort_int32(SortTuple *begin, int n, int shift, bool reverse);
+#if SIZEOF_DATUM >= 8
+static void radix_sort_signed(SortTuple *begin, int n, int shift, bool reverse);
+#endif
+
+static pg_attribute_always_inline uint64
+radix_sort_key(Datum datum, bool int32key, bool reverse)
+{
+	uint64		key;
+
+	/* flip the sign bit, so that negative values come before positive ones */
+	if (int32key)
+		key = (uint32) DatumGetInt32(datum) ^ UINT64CONST(0x80000000);
+	else
+		key = (uint64) datum ^ (UINT64CONST(1) << 63);
+
+	/* descending order is ascending order of the complement */
+	if (reverse)
+		key ^= int32key ? UINT64CONST(0xFFFFFFFF) : ~UINT64CONST(0);
+
+	return key;
+}
+
+/*
+ * Sort the n tuples at begin, all of whose keys agree above the byte at
+ * 'shift'.  Tuples are distributed into 256 buckets on that byte in place
+ * (an "American flag sort"), and each bucket is then sorted on the next
+ * byte.  Small partitions are insertion sorted on the whole key instead.
+ */
+static pg_attribute_always_inline void
+radix_sort_tuple(SortTuple *begin, int n, int shift, bool int32key,
+				 bool reverse)
+{
+	int			counts[256];
+	int			next[256];
+	int			end[256];
+	int			total;
+	int			b;
+
+	for (;;)
+	{
+		if (n < RADIX_SORT_INSERTION_THRESHOLD)
+		{
+			for (SortTuple *pm = begin + 1; pm < begin + n; pm++)
+			{
+				SortTuple	tmp = *pm;
+				uint64		key = radix_sort_key(tmp.datum1, int32key, reverse);
+				SortTuple  *pl = pm;
+
+				while (pl > begin &&
+					   radix_sort_key((pl - 1)->datum1, int32key, reverse) > key)
+				{
+					*pl = *(pl - 1);
+					pl--;
+				}
+				*pl = tmp;
+			}
+			return;
+		}
+
+		memset(counts, 0, sizeof(counts));
+		for (int i = 0; i < n; i++)
+			counts[(radix_sort_key(begin[i].datum1, int32key, reverse) >> shift) & 0xFF]++;
+
+		/*
+		 * If all the keys share this byte, there's nothing to distribute;
+		 * just go on to the next one.
+		 */
+		if (counts[(radix_sort_key(begin[0].datum1, int32key, reverse) >> shift) & 0xFF] < n)
+			break;
+		if (shift == 0)
+			return;
+		shift -= 8;
+	}
+
+	total = 0;
+	for (b = 0; b < 256; b++)
+	{
+		next[b] = total;
+		total += counts[b];
+		end[b] = total;
+	}
+
+	/*
+	 * Move each tuple directly to the next free slot of its bucket, picking
+	 * up the tuple it displaces, until the one that belongs in the current
+	 * slot turns up.
+	 */
+	for (b = 0; b < 256; b++)
+	{
+		while (next[b] < end[b])
+		{
+			SortTuple	tmp = begin[next[b]];
+			int			digit;
+
+			digit = (radix_sort_key(tmp.datum1, int32key, reverse) >> shift) & 0xFF;
+			while (digit != b)
+			{
+				SortTuple	displaced = begin[next[digit]];
+
+				begin[next[digit]++] = tmp;
+				tmp = displaced;
+				digit = (radix_sort_key(tmp.datum1, int32key, reverse) >> shift) & 0xFF;
+			}
+			begin[next[b]++] = tmp;
+		}
+	}
+
+	if (shift == 0)
+		return;
+
+	for (b = 0; b < 256; b++)
+	{
+		if (counts[b] < 2)
+			continue;
+#if SIZEOF_DATUM >= 8
+		if (!int32key)
+		{
+			radix_sort_signed(begin + end[b] - counts[b], counts[b],
+							  shift - 8, reverse);
+			continue;
+		}
+#endif
+		radix_sort_int32(begin + end[b] - counts[b], counts[b],
+						 shift - 8, reverse);
+	}
+}
+
+static void
+radix_sort_int32(SortTuple *begin, int n, int shift, bool reverse)
+{
+	radix_sort_tuple(begin, n, shift, true, reverse);
+}
+
+#if SIZEOF_DATUM >= 8
+static void
+radix_sort_signed(SortTuple *begin, int n, int shift, bool reverse)
+{
+	radix_sort_tuple(begin, n, shift, false, reverse);
+}
+#endif
+
 
 /*
  *		tuplesort_begin_xxx
@@ -825,16 +994,22 @@ tuplesort_begin_batch(Tuplesortstate *state)
 	 * fragmentation. Note that the memtuples array of SortTuples is allocated
 	 * in the parent context, not this context, because there is no need to
 	 * free memtuples early.
+	 *
+	 * The tuples are only ever released all at once, by resetting the
+	 * context, so a bump context is used to avoid the per-chunk overhead of
+	 * an AllocSet.  tuplesort_set_bound() replaces it, as bounded sorts do
+	 * free individual tuples.
 	 */
-	state->tuplecontext = AllocSetContextCreate(state->sortcontext,
-												"Caller tuples",
-												ALLOCSET_DEFAULT_SIZES);
+	state->tuplecontext = BumpContextCreate(state->sortcontext,
+											"Caller tuples",
+											ALLOCSET_DEFAULT_SIZES);
 
 	state->status = TSS_INITIAL;
 	state->bounded = false;
 	state->boundUsed = false;
 
 	state->availMem = state->allowedMem;
+	state->tupleMem = 0;
 
 	state->tapeset = NULL;
 
@@ -1121,6 +1296,64 @@ tuplesort_begin_index_btree(Relation heapRel,
 	return state;
 }
 
+Tuplesortstate *
+tuplesort_begin_index_gist(Relation heapRel,
+						   Relation indexRel,
+						   int workMem,
+						   SortCoordinate coordinate,
+						   bool randomAccess)
+{
+	Tuplesortstate *state = tuplesort_begin_common(workMem, coordinate,
+												   randomAccess);
+	MemoryContext oldcontext;
+	int			i;
+
+	oldcontext = MemoryContextSwitchTo(state->maincontext);
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG,
+			 "begin index sort: workMem = %d, randomAccess = %c",
+			 workMem, randomAccess ? 't' : 'f');
+#endif
+
+	state->nKeys = IndexRelationGetNumberOfKeyAttributes(indexRel);
+
+	/* the comparison is the same as for btree, only the comparators differ */
+	state->comparetup = comparetup_index_btree;
+	state->copytup = copytup_index;
+	state->writetup = writetup_index;
+	state->readtup = readtup_index;
+	state->abbrevNext = 10;
+
+	state->heapRel = heapRel;
+	state->indexRel = indexRel;
+
+	/* Prepare SortSupport data for each column */
+	state->sortKeys = (SortSupport) palloc0(state->nKeys *
+											sizeof(SortSupportData));
+
+	for (i = 0; i < state->nKeys; i++)
+	{
+		SortSupport sortKey = state->sortKeys + i;
+
+		sortKey->ssup_cxt = CurrentMemoryContext;
+		sortKey->ssup_collation = indexRel->rd_indcollation[i];
+		sortKey->ssup_nulls_first = false;
+		sortKey->ssup_attno = i + 1;
+		/* Convey if abbreviation optimization is applicable in principle */
+		sortKey->abbreviate = (i == 0);
+
+		AssertState(sortKey->ssup_attno != 0);
+
+		PrepareSortSupportFromGistIndexRel(indexRel, sortKey);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
 Tuplesortstate *
 tuplesort_begin_index_hash(Relation heapRel,
 						   Relation indexRel,
@@ -1278,6 +1511,16 @@ tuplesort_set_bound(Tuplesortstate *state, int64 bound)
 	if (bound > (int64) (INT_MAX / 2))
 		return;
 
+	/*
+	 * A bounded sort discards tuples one at a time as better ones arrive,
+	 * which the bump context used for caller tuples doesn't allow.  Switch to
+	 * an AllocSet.  No tuples have been loaded yet, so nothing is lost.
+	 */
+	MemoryContextDelete(state->tuplecontext);
+	state->tuplecontext = AllocSetContextCreate(state->sortcontext,
+												"Caller tuples",
+												ALLOCSET_DEFAULT_SIZES);
+
 	state->bounded = true;
 	state->bound = (int) bound;
 
@@ -1652,22 +1895,27 @@ tuplesort_putindextuplevalues(Tuplesortstate *state, Relation rel,
 							  ItemPointer self, Datum *values,
 							  bool *isnull)
 {
-	MemoryContext oldcontext = MemoryContextSwitchTo(state->tuplecontext);
+	MemoryContext oldcontext;
 	SortTuple	stup;
 	Datum		original;
 	IndexTuple	tuple;
 
-	stup.tuple = index_form_tuple(RelationGetDescr(rel), values, isnull);
+	/*
+	 * Build the tuple in tuplecontext, but do any detoasting in the caller's
+	 * context, as tuplecontext may not allow pfree'ing the working copies.
+	 */
+	stup.tuple = index_form_tuple_context(RelationGetDescr(rel), values,
+										  isnull, state->tuplecontext);
 	tuple = ((IndexTuple) stup.tuple);
 	tuple->t_tid = *self;
-	USEMEM(state, GetMemoryChunkSpace(stup.tuple));
+	use_tuple_memory(state, tuple, IndexTupleSize(tuple));
 	/* set up first-column key value */
 	original = index_getattr(tuple,
 							 1,
 							 RelationGetDescr(state->indexRel),
 							 &stup.isnull1);
 
-	MemoryContextSwitchTo(state->sortcontext);
+	oldcontext = MemoryContextSwitchTo(state->sortcontext);
 
 	if (!state->sortKeys || !state->sortKeys->abbrev_converter || stup.isnull1)
 	{
@@ -1760,7 +2008,8 @@ tuplesort_putdatum(Tuplesortstate *state, Datum val, bool isNull)
 
 		stup.isnull1 = false;
 		stup.tuple = DatumGetPointer(original);
-		USEMEM(state, GetMemoryChunkSpace(stup.tuple));
+		use_tuple_memory(state, stup.tuple,
+						 datumGetSize(original, false, state->datumTypeLen));
 		MemoryContextSwitchTo(state->sortcontext);
 
 		if (!state->sortKeys->abbrev_converter)
@@ -3171,13 +3420,15 @@ dumptuples(Tuplesortstate *state, bool alltuples)
 	}
 
 	/*
-	 * Reset tuple memory.  We've freed all of the tuples that we previously
-	 * allocated.  It's important to avoid fragmentation when there is a stark
-	 * change in the sizes of incoming tuples.  Fragmentation due to
-	 * AllocSetFree's bucketing by size class might be particularly bad if
-	 * this step wasn't taken.
+	 * Reset tuple memory.  All of the tuples that we previously allocated
+	 * have been written out, and this is where their space is released.  In
+	 * a bounded sort, where tuplecontext is an AllocSet, it's also important
+	 * to avoid fragmentation when there is a stark change in the sizes of
+	 * incoming tuples.
 	 */
 	MemoryContextReset(state->tuplecontext);
+	FREEMEM(state, state->tupleMem);
+	state->tupleMem = 0;
 
 	markrunend(state, state->tp_tapenum[state->destTape]);
 	state->tp_runs[state->destTape]++;
@@ -3482,8 +3733,12 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 
 	if (state->memtupcount > 1)
 	{
+		/* Can we avoid comparisons altogether? */
+		if (state->memtupcount >= RADIX_SORT_THRESHOLD &&
+			tuplesort_can_radix_sort(state))
+			tuplesort_radix_sort(state);
 		/* Can we use the single-key sort function? */
-		if (state->onlyKey != NULL)
+		else if (state->onlyKey != NULL)
 			qsort_ssup(state->memtuples, state->memtupcount,
 					   state->onlyKey);
 		else
@@ -3494,6 +3749,120 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 	}
 }
 
+/*
+ * Can the memtuples be sorted with tuplesort_radix_sort()?
+ *
+ * That needs a leading key compared as a plain integer by one of the generic
+ * comparators, with datum1 holding the key itself rather than an abbreviated
+ * key, and a comparetup routine that does nothing more with tuples whose
+ * leading keys are equal than compare their remaining keys.  In particular,
+ * a unique btree build has to see equal tuples compared to complain.
+ */
+static bool
+tuplesort_can_radix_sort(Tuplesortstate *state)
+{
+	SortSupport ssup = state->sortKeys;
+
+	if (ssup == NULL || ssup->abbrev_converter != NULL)
+		return false;
+
+	if (ssup->comparator != ssup_datum_int32_cmp
+#if SIZEOF_DATUM >= 8
+		&& ssup->comparator != ssup_datum_signed_cmp
+#endif
+		)
+		return false;
+
+	if (state->comparetup == comparetup_heap ||
+		state->comparetup == comparetup_datum)
+		return true;
+	if (state->comparetup == comparetup_index_btree && !state->enforceUnique)
+		return true;
+
+	return false;
+}
+
+/*
+ * Sort all memtuples with a radix sort on the leading key.
+ *
+ * NULLs have no place in the radix order, so they are first moved to the end
+ * of the array where the sort order wants them.  If there is more to the
+ * sort order than the leading key, runs of tuples with equal leading keys are
+ * then sorted with qsort_tuple().
+ */
+static void
+tuplesort_radix_sort(Tuplesortstate *state)
+{
+	SortSupport ssup = state->sortKeys;
+	SortTuple  *memtuples = state->memtuples;
+	int			memtupcount = state->memtupcount;
+	bool		int32key = (ssup->comparator == ssup_datum_int32_cmp);
+	bool		reverse = ssup->ssup_reverse;
+	SortTuple  *notnull;
+	SortTuple  *nulls;
+	int			nnotnull;
+	int			lo;
+	int			hi;
+
+	lo = 0;
+	hi = memtupcount;
+	while (lo < hi)
+	{
+		if (memtuples[lo].isnull1 == ssup->ssup_nulls_first)
+			lo++;
+		else
+		{
+			SortTuple	tmp = memtuples[--hi];
+
+			memtuples[hi] = memtuples[lo];
+			memtuples[lo] = tmp;
+		}
+	}
+
+	if (ssup->ssup_nulls_first)
+	{
+		nulls = memtuples;
+		notnull = memtuples + lo;
+		nnotnull = memtupcount - lo;
+	}
+	else
+	{
+		notnull = memtuples;
+		nulls = memtuples + lo;
+		nnotnull = lo;
+	}
+
+	if (nnotnull > 1)
+	{
+#if SIZEOF_DATUM >= 8
+		if (!int32key)
+			radix_sort_signed(notnull, nnotnull, 56, reverse);
+		else
+#endif
+			radix_sort_int32(notnull, nnotnull, 24, reverse);
+	}
+
+	/* With a single key, tuples with equal keys are in order already */
+	if (state->onlyKey != NULL)
+		return;
+
+	if (memtupcount - nnotnull > 1)
+		qsort_tuple(nulls, memtupcount - nnotnull, state->comparetup, state);
+
+	for (int i = 0; i < nnotnull;)
+	{
+		uint64		key = radix_sort_key(notnull[i].datum1, int32key, reverse);
+		int			j = i + 1;
+
+		while (j < nnotnull &&
+			   radix_sort_key(notnull[j].datum1, int32key, reverse) == key)
+			j++;
+		if (j - i > 1)
+			qsort_tuple(notnull + i, j - i, state->comparetup, state);
+		i = j;
+	}
+}
+
 /*
  * Insert a new tuple into an empty or existing heap, maintaining the
  * heap invariant.  Caller is responsible for ensuring there's room.
@@ -3753,7 +4122,7 @@ copytup_heap(Tuplesortstate *state, SortTuple *stup, void *tup)
 	/* copy the tuple into sort storage */
 	tuple = ExecCopySlotMinimalTuple(slot);
 	stup->tuple = (void *) tuple;
-	USEMEM(state, GetMemoryChunkSpace(tuple));
+	use_tuple_memory(state, tuple, tuple->t_len);
 	/* set up first-column key value */
 	htup.t_len = tuple->t_len + MINIMAL_TUPLE_OFFSET;
 	htup.t_data = (HeapTupleHeader) ((char *) tuple - MINIMAL_TUPLE_OFFSET);
@@ -3834,12 +4203,6 @@ writetup_heap(Tuplesortstate *state, int tapenum, SortTuple *stup)
 	if (state->randomAccess)	/* need trailing length word? */
 		LogicalTapeWrite(state->tapeset, tapenum,
 						 (void *) &tuplen, sizeof(tuplen));
-
-	if (!state->slabAllocatorUsed)
-	{
-		FREEMEM(state, GetMemoryChunkSpace(tuple));
-		heap_free_minimal_tuple(tuple);
-	}
 }
 
 static void
@@ -3995,7 +4358,7 @@ copytup_cluster(Tuplesortstate *state, SortTuple *stup, void *tup)
 	/* copy the tuple into sort storage */
 	tuple = heap_copytuple(tuple);
 	stup->tuple = (void *) tuple;
-	USEMEM(state, GetMemoryChunkSpace(tuple));
+	use_tuple_memory(state, tuple, HEAPTUPLESIZE + tuple->t_len);
 
 	MemoryContextSwitchTo(oldcontext);
 
@@ -4074,12 +4437,6 @@ writetup_cluster(Tuplesortstate *state, int tapenum, SortTuple *stup)
 	if (state->randomAccess)	/* need trailing length word? */
 		LogicalTapeWrite(state->tapeset, tapenum,
 						 &tuplen, sizeof(tuplen));
-
-	if (!state->slabAllocatorUsed)
-	{
-		FREEMEM(state, GetMemoryChunkSpace(tuple));
-		heap_freetuple(tuple);
-	}
 }
 
 static void
@@ -4329,12 +4686,6 @@ writetup_index(Tuplesortstate *state, int tapenum, SortTuple *stup)
 	if (state->randomAccess)	/* need trailing length word? */
 		LogicalTapeWrite(state->tapeset, tapenum,
 						 (void *) &tuplen, sizeof(tuplen));
-
-	if (!state->slabAllocatorUsed)
-	{
-		FREEMEM(state, GetMemoryChunkSpace(tuple));
-		pfree(tuple);
-	}
 }
 
 static void
@@ -4422,12 +4773,6 @@ writetup_datum(Tuplesortstate *state, int tapenum, SortTuple *stup)
 	if (state->randomAccess)	/* need trailing length word? */
 		LogicalTapeWrite(state->tapeset, tapenum,
 						 (void *) &writtenlen, sizeof(writtenlen));
-
-	if (!state->slabAllocatorUsed && stup->tuple)
-	{
-		FREEMEM(state, GetMemoryChunkSpace(stup->tuple));
-		pfree(stup->tuple);
-	}
 }
 
 static void
@@ -4516,6 +4861,30 @@ tuplesort_initialize_shared(Sharedsort *shared, int nWorkers, dsm_segment *seg)
 	}
 }
 
+/*
+ * tuplesort_reinitialize_shared - reset shared tuplesort state for reuse
+ *
+ * Must be called from leader process, once all the tuplesortstates of the
+ * previous sort have been ended, before another set of workers is launched.
+ * The temporary files of the previous sort are deleted.
+ */
+void
+tuplesort_reinitialize_shared(Sharedsort *shared)
+{
+	int			i;
+
+	SharedFileSetDeleteAll(&shared->fileset);
+
+	SpinLockAcquire(&shared->mutex);
+	shared->currentWorker = 0;
+	shared->workersFinished = 0;
+	for (i = 0; i < shared->nTapes; i++)
+	{
+		shared->tapes[i].firstblocknumber = 0L;
+	}
+	SpinLockRelease(&shared->mutex);
+}
+
 /*
  * tuplesort_attach_shared - attach to shared tuplesort state
  *
@@ -4696,6 +5065,35 @@ leader_takeover_tapes(Tuplesortstate *state)
 static void
 free_sort_tuple(Tuplesortstate *state, SortTuple *stup)
 {
-	FREEMEM(state, GetMemoryChunkSpace(stup->tuple));
+	Size		space = GetMemoryChunkSpace(stup->tuple);
+
+	/* only bounded sorts get here, so tuplecontext is an AllocSet */
+	Assert(state->bounded);
+
+	FREEMEM(state, space);
+	state->tupleMem -= space;
 	pfree(stup->tuple);
 }
+
+/*
+ * Account for a tuple just copied into tuplecontext.  "len" is the size that
+ * was requested for it.
+ *
+ * A bump context can't report the space used by a chunk, so except in
+ * bounded sorts we count the length rounded up to MAXALIGN, plus the link to
+ * the owning context that precedes every chunk.  The space is given back all
+ * at once by dumptuples(), when the context is reset.
+ */
+static void
+use_tuple_memory(Tuplesortstate *state, void *tuple, Size len)
+{
+	Size		space;
+
+	if (state->bounded)
+		space = GetMemoryChunkSpace(tuple);
+	else
+		space = MAXALIGN(len) + sizeof(MemoryContext);
+
+	USEMEM(state, space);
+	state->tupleMem += space;
+}
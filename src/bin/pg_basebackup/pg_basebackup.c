@@ -25,6 +25,12 @@
 #ifdef HAVE_LIBZ
 #include <zlib.h>
 #endif
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "access/xlog_internal.h"
 #include "common/file_perm.h"
@@ -88,6 +94,33 @@ typedef struct UnpackTarState
 	FILE	   *file;
 } UnpackTarState;
 
+/*
+ * State for decompressing a tar stream compressed by the server, and feeding
+ * it to the unpacker in the pieces it expects: each header block separately,
+ * then the file contents, then the padding in one piece.
+ */
+typedef struct DecompressTarState
+{
+	UnpackTarState *unpack;
+	char	   *outbuf;
+	char		block[TAR_BLOCK_SIZE];	/* partial header or padding */
+	size_t		blocklen;
+	pgoff_t		data_left;		/* file contents yet to pass on */
+	int			padding;		/* padding following the file contents */
+	bool		end_of_archive;
+#ifdef HAVE_LIBZ
+	z_stream	zstream;
+#endif
+#ifdef USE_LZ4
+	LZ4F_decompressionContext_t lz4_ctx;
+#endif
+#ifdef USE_ZSTD
+	ZSTD_DStream *zstd_ctx;
+#endif
+} DecompressTarState;
+
+#define DECOMPRESS_BUFSIZE	65536
+
 typedef struct WriteManifestState
 {
 	char		filename[MAXPGPATH];
@@ -113,6 +146,11 @@ typedef void (*WriteDataCallback) (size_t nbytes, char *buf,
  */
 #define MINIMUM_VERSION_FOR_MANIFESTS	130000
 
+/*
+ * Server-side compression of the tar streams is supported from version 14.
+ */
+#define MINIMUM_VERSION_FOR_SERVER_COMPRESSION	140000
+
 /*
  * Different ways to include WAL
  */
@@ -143,6 +181,8 @@ static int	standby_message_timeout = 10 * 1000;	/* 10 sec = default */
 static pg_time_t last_progress_report = 0;
 static int32 maxrate = 0;		/* no limit by default */
 static char *replication_slot = NULL;
+static StreamCompressionMethod stream_compression = STREAM_COMPRESSION_NONE;
+static StreamCompressionMethod server_compression = STREAM_COMPRESSION_NONE;
 static bool temp_replication_slot = true;
 static bool create_slot = false;
 static bool no_slot = false;
@@ -196,6 +236,10 @@ static void ReceiveTarCopyChunk(size_t r, char *copybuf, void *callback_data);
 static void ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum);
 static void ReceiveTarAndUnpackCopyChunk(size_t r, char *copybuf,
 										 void *callback_data);
+static void ReceiveCompressedTarChunk(size_t r, char *copybuf,
+									  void *callback_data);
+static void UnpackDecompressedData(DecompressTarState *state, char *buf,
+								   size_t len);
 static void ReceiveBackupManifest(PGconn *conn);
 static void ReceiveBackupManifestChunk(size_t r, char *copybuf,
 									   void *callback_data);
@@ -394,6 +438,8 @@ usage(void)
 			 "                         include required WAL files with specified method\n"));
 	printf(_("  -z, --gzip             compress tar output\n"));
 	printf(_("  -Z, --compress=0-9     compress tar output with given compression level\n"));
+	printf(_("      --server-compression=METHOD\n"
+			 "                         have the server compress the backup with METHOD\n"));
 	printf(_("\nGeneral options:\n"));
 	printf(_("  -c, --checkpoint=fast|spread\n"
 			 "                         set fast or spread checkpointing\n"));
@@ -414,6 +460,8 @@ usage(void)
 	printf(_("      --no-slot          prevent creation of temporary replication slot\n"));
 	printf(_("      --no-verify-checksums\n"
 			 "                         do not verify checksums\n"));
+	printf(_("      --stream-compression=METHOD\n"
+			 "                         ask the server to compress streamed WAL with METHOD\n"));
 	printf(_("  -?, --help             show this help, then exit\n"));
 	printf(_("\nConnection options:\n"));
 	printf(_("  -d, --dbname=CONNSTR   connection string\n"));
@@ -551,6 +599,7 @@ LogStreamerMain(logstreamer_param *param)
 	stream.mark_done = true;
 	stream.partial_suffix = NULL;
 	stream.replication_slot = replication_slot;
+	stream.compression = stream_compression;
 
 	if (format == 'p')
 		stream.walmethod = CreateWalDirectoryMethod(param->xlog, 0,
@@ -1031,7 +1080,9 @@ writeTarData(WriteTarState *state, char *buf, int r)
  * enabled, the data will be compressed while written to the file.
  *
  * The file will be named base.tar[.gz] if it's for the main data directory
- * or <tablespaceoid>.tar[.gz] if it's for another tablespace.
+ * or <tablespaceoid>.tar[.gz] if it's for another tablespace.  If the server
+ * compressed the tar file, it is stored as-is, with the extension of the
+ * compression method.
  *
  * No attempt to inspect or validate the contents of the file is done.
  */
@@ -1050,7 +1101,33 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 	if (PQserverVersion(conn) >= MINIMUM_VERSION_FOR_RECOVERY_GUC)
 		state.is_recovery_guc_supported = true;
 
-	if (state.basetablespace)
+	if (server_compression != STREAM_COMPRESSION_NONE)
+	{
+		const char *ext = "gz";
+
+		if (server_compression == STREAM_COMPRESSION_LZ4)
+			ext = "lz4";
+		else if (server_compression == STREAM_COMPRESSION_ZSTD)
+			ext = "zst";
+
+		if (strcmp(basedir, "-") == 0)
+		{
+#ifdef WIN32
+			_setmode(fileno(stdout), _O_BINARY);
+#endif
+			state.tarfile = stdout;
+			strcpy(state.filename, "-");
+		}
+		else
+		{
+			snprintf(state.filename, sizeof(state.filename), "%s/%s.tar.%s",
+					 basedir,
+					 state.basetablespace ? "base" : PQgetvalue(res, rownum, 0),
+					 ext);
+			state.tarfile = fopen(state.filename, "wb");
+		}
+	}
+	else if (state.basetablespace)
 	{
 		/*
 		 * Base tablespaces
@@ -1256,8 +1333,12 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 		termPQExpBuffer(&buf);
 	}
 
-	/* 2 * TAR_BLOCK_SIZE bytes empty data at end of file */
-	writeTarData(&state, zerobuf, sizeof(zerobuf));
+	/*
+	 * 2 * TAR_BLOCK_SIZE bytes empty data at end of file.  A compressed
+	 * stream from the server already includes them.
+	 */
+	if (server_compression == STREAM_COMPRESSION_NONE)
+		writeTarData(&state, zerobuf, sizeof(zerobuf));
 
 #ifdef HAVE_LIBZ
 	if (state.ztarfile != NULL)
@@ -1528,7 +1609,84 @@ ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum)
 				get_tablespace_mapping(PQgetvalue(res, rownum, 1)),
 				sizeof(state.current_path));
 
-	ReceiveCopyData(conn, ReceiveTarAndUnpackCopyChunk, &state);
+	if (server_compression != STREAM_COMPRESSION_NONE)
+	{
+		DecompressTarState dstate;
+
+		memset(&dstate, 0, sizeof(dstate));
+		dstate.unpack = &state;
+		dstate.outbuf = pg_malloc(DECOMPRESS_BUFSIZE);
+
+		switch (server_compression)
+		{
+#ifdef HAVE_LIBZ
+			case STREAM_COMPRESSION_GZIP:
+				/* add 32 to the window bits to accept a gzip header */
+				if (inflateInit2(&dstate.zstream, MAX_WBITS + 32) != Z_OK)
+				{
+					pg_log_error("could not initialize compression library");
+					exit(1);
+				}
+				break;
+#endif
+#ifdef USE_LZ4
+			case STREAM_COMPRESSION_LZ4:
+				if (LZ4F_isError(LZ4F_createDecompressionContext(&dstate.lz4_ctx,
+																 LZ4F_VERSION)))
+				{
+					pg_log_error("could not initialize compression library");
+					exit(1);
+				}
+				break;
+#endif
+#ifdef USE_ZSTD
+			case STREAM_COMPRESSION_ZSTD:
+				dstate.zstd_ctx = ZSTD_createDStream();
+				if (dstate.zstd_ctx == NULL)
+				{
+					pg_log_error("could not initialize compression library");
+					exit(1);
+				}
+				break;
+#endif
+			default:
+				/* rejected when parsing the options */
+				Assert(false);
+				break;
+		}
+
+		ReceiveCopyData(conn, ReceiveCompressedTarChunk, &dstate);
+
+		switch (server_compression)
+		{
+#ifdef HAVE_LIBZ
+			case STREAM_COMPRESSION_GZIP:
+				inflateEnd(&dstate.zstream);
+				break;
+#endif
+#ifdef USE_LZ4
+			case STREAM_COMPRESSION_LZ4:
+				LZ4F_freeDecompressionContext(dstate.lz4_ctx);
+				break;
+#endif
+#ifdef USE_ZSTD
+			case STREAM_COMPRESSION_ZSTD:
+				ZSTD_freeDStream(dstate.zstd_ctx);
+				break;
+#endif
+			default:
+				break;
+		}
+		pg_free(dstate.outbuf);
+
+		if (!dstate.end_of_archive)
+		{
+			pg_log_error("COPY stream ended before end of compressed archive");
+			exit(1);
+		}
+	}
+	else
+		ReceiveCopyData(conn, ReceiveTarAndUnpackCopyChunk, &state);
 
 
 	if (state.file)
@@ -1731,6 +1889,163 @@ ReceiveTarAndUnpackCopyChunk(size_t r, char *copybuf, void *callback_data)
 	}							/* continuing data in existing file */
 }
 
+/*
+ * Receive one chunk of a tar stream compressed by the server, decompress it
+ * and unpack the result.
+ */
+static void
+ReceiveCompressedTarChunk(size_t r, char *copybuf, void *callback_data)
+{
+	DecompressTarState *state = callback_data;
+
+	switch (server_compression)
+	{
+#ifdef HAVE_LIBZ
+		case STREAM_COMPRESSION_GZIP:
+			{
+				int			rc;
+
+				state->zstream.next_in = (Bytef *) copybuf;
+				state->zstream.avail_in = r;
+				do
+				{
+					state->zstream.next_out = (Bytef *) state->outbuf;
+					state->zstream.avail_out = DECOMPRESS_BUFSIZE;
+					rc = inflate(&state->zstream, Z_NO_FLUSH);
+					if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR)
+					{
+						pg_log_error("could not decompress data: %s",
+									 state->zstream.msg ? state->zstream.msg : "unknown error");
+						exit(1);
+					}
+					UnpackDecompressedData(state, state->outbuf,
+										   DECOMPRESS_BUFSIZE - state->zstream.avail_out);
+				} while (rc != Z_STREAM_END &&
+						 (state->zstream.avail_in > 0 ||
+						  state->zstream.avail_out == 0));
+			}
+			break;
+#endif
+#ifdef USE_LZ4
+		case STREAM_COMPRESSION_LZ4:
+			{
+				size_t		outlen;
+
+				do
+				{
+					size_t		inlen = r;
+					size_t		rc;
+
+					outlen = DECOMPRESS_BUFSIZE;
+					rc = LZ4F_decompress(state->lz4_ctx, state->outbuf, &outlen,
+										 copybuf, &inlen, NULL);
+					if (LZ4F_isError(rc))
+					{
+						pg_log_error("could not decompress data: %s",
+									 LZ4F_getErrorName(rc));
+						exit(1);
+					}
+					UnpackDecompressedData(state, state->outbuf, outlen);
+					copybuf += inlen;
+					r -= inlen;
+				} while (r > 0 || outlen == DECOMPRESS_BUFSIZE);
+			}
+			break;
+#endif
+#ifdef USE_ZSTD
+		case STREAM_COMPRESSION_ZSTD:
+			{
+				ZSTD_inBuffer input = {copybuf, r, 0};
+				ZSTD_outBuffer output;
+
+				do
+				{
+					size_t		rc;
+
+					output.dst = state->outbuf;
+					output.size = DECOMPRESS_BUFSIZE;
+					output.pos = 0;
+					rc = ZSTD_decompressStream(state->zstd_ctx, &output, &input);
+					if (ZSTD_isError(rc))
+					{
+						pg_log_error("could not decompress data: %s",
+									 ZSTD_getErrorName(rc));
+						exit(1);
+					}
+					UnpackDecompressedData(state, state->outbuf, output.pos);
+				} while (input.pos < input.size || output.pos == output.size);
+			}
+			break;
+#endif
+		default:
+			Assert(false);
+			break;
+	}
+}
+
+/*
+ * Pass decompressed tar data on to the unpacker.
+ *
+ * ReceiveTarAndUnpackCopyChunk() relies on the framing of the uncompressed
+ * stream sent by the server, so recreate it: every header block is passed
+ * on by itself, followed by the file contents, and then the padding in a
+ * single piece.  The end-of-archive blocks are not passed on at all.
+ */
+static void
+UnpackDecompressedData(DecompressTarState *state, char *buf, size_t len)
+{
+	while (len > 0 && !state->end_of_archive)
+	{
+		size_t		target;
+		size_t		n;
+
+		if (state->data_left > 0)
+		{
+			n = Min(len, state->data_left);
+			ReceiveTarAndUnpackCopyChunk(n, buf, state->unpack);
+			state->data_left -= n;
+			buf += n;
+			len -= n;
+			continue;
+		}
+
+		/* Collect the padding of the previous file, or the next header */
+		target = state->padding > 0 ? state->padding : TAR_BLOCK_SIZE;
+		n = Min(len, target - state->blocklen);
+		memcpy(state->block + state->blocklen, buf, n);
+		state->blocklen += n;
+		buf += n;
+		len -= n;
+		if (state->blocklen < target)
+			break;
+		state->blocklen = 0;
+
+		if (state->padding > 0)
+		{
+			ReceiveTarAndUnpackCopyChunk(target, state->block, state->unpack);
+			state->padding = 0;
+			continue;
+		}
+
+		/* An all-zeroes header block marks the end of the archive */
+		for (n = 0; n < TAR_BLOCK_SIZE; n++)
+		{
+			if (state->block[n] != '\0')
+				break;
+		}
+		if (n == TAR_BLOCK_SIZE)
+		{
+			state->end_of_archive = true;
+			break;
+		}
+
+		ReceiveTarAndUnpackCopyChunk(TAR_BLOCK_SIZE, state->block,
+									 state->unpack);
+		state->data_left = read_tar_number(&state->block[124], 12);
+		state->padding = tarPaddingBytesRequired(state->data_left);
+	}
+}
+
 /*
  * Receive the backup manifest file and write it out to a file.
  */
@@ -1805,6 +2120,7 @@ BaseBackup(void)
 	char	   *maxrate_clause = NULL;
 	char	   *manifest_clause = NULL;
 	char	   *manifest_checksums_clause = "";
+	char	   *compression_clause = "";
 	int			i;
 	char		xlogstart[64];
 	char		xlogend[64];
@@ -1847,6 +2163,14 @@ BaseBackup(void)
 		exit(1);
 	}
 
+	if (server_compression != STREAM_COMPRESSION_NONE &&
+		serverVersion < MINIMUM_VERSION_FOR_SERVER_COMPRESSION)
+	{
+		pg_log_error("server-side compression is not supported by server version %s",
+					 PQparameterStatus(conn, "server_version"));
+		exit(1);
+	}
+
 	/*
 	 * Build contents of configuration file if requested
 	 */
@@ -1878,6 +2202,10 @@ BaseBackup(void)
 												 manifest_checksums);
 	}
 
+	if (server_compression != STREAM_COMPRESSION_NONE)
+		compression_clause = psprintf("COMPRESSION '%s'",
+									  stream_compression_method_name(server_compression));
+
 	if (verbose)
 		pg_log_info("initiating base backup, waiting for checkpoint to complete");
 
@@ -1891,7 +2219,7 @@ BaseBackup(void)
 	}
 
 	basebkp =
-		psprintf("BASE_BACKUP LABEL '%s' %s %s %s %s %s %s %s %s %s",
+		psprintf("BASE_BACKUP LABEL '%s' %s %s %s %s %s %s %s %s %s %s",
 				 escaped_label,
 				 estimatesize ? "PROGRESS" : "",
 				 includewal == FETCH_WAL ? "WAL" : "",
@@ -1901,7 +2229,8 @@ BaseBackup(void)
 				 format == 't' ? "TABLESPACE_MAP" : "",
 				 verify_checksums ? "" : "NOVERIFY_CHECKSUMS",
 				 manifest_clause ? manifest_clause : "",
-				 manifest_checksums_clause);
+				 manifest_checksums_clause,
+				 compression_clause);
 
 	if (PQsendQuery(conn, basebkp) == 0)
 	{
@@ -2257,6 +2586,8 @@ main(int argc, char **argv)
 		{"no-manifest", no_argument, NULL, 5},
 		{"manifest-force-encode", no_argument, NULL, 6},
 		{"manifest-checksums", required_argument, NULL, 7},
+		{"stream-compression", required_argument, NULL, 8},
+		{"server-compression", required_argument, NULL, 9},
 		{NULL, 0, NULL, 0}
 	};
 	int			c;
@@ -2437,6 +2768,26 @@ main(int argc, char **argv)
 			case 7:
 				manifest_checksums = pg_strdup(optarg);
 				break;
+			case 8:
+				if (!parse_stream_compression_method(optarg, &stream_compression))
+				{
+					pg_log_error("invalid stream compression method \"%s\"", optarg);
+					exit(1);
+				}
+				if (!stream_compression_supported(stream_compression))
+				{
+					pg_log_error("stream compression method \"%s\" is not supported by this build",
+								 optarg);
+					exit(1);
+				}
+				break;
+			case 9:
+				if (!parse_stream_compression_method(optarg, &server_compression))
+				{
+					pg_log_error("invalid compression method \"%s\"", optarg);
+					exit(1);
+				}
+				break;
 			default:
 
 				/*
@@ -2482,6 +2833,44 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (server_compression != STREAM_COMPRESSION_NONE)
+	{
+		if (compresslevel != 0)
+		{
+			pg_log_error("%s and %s are incompatible options",
+						 "--compress", "--server-compression");
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+
+		/*
+		 * In tar mode the compressed archives are stored as they come, so
+		 * nothing can be added to them.  In plain mode, we have to be able
+		 * to decompress them.
+		 */
+		if (format == 't' && writerecoveryconf)
+		{
+			pg_log_error("cannot write recovery configuration into a tar file compressed by the server");
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+		if (format == 't' && manifest && strcmp(basedir, "-") == 0)
+		{
+			pg_log_error("cannot include the backup manifest in a tar file compressed by the server");
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+		if (format == 'p' && !stream_compression_supported(server_compression))
+		{
+			pg_log_error("compression method \"%s\" is not supported by this build",
+						 stream_compression_method_name(server_compression));
+			exit(1);
+		}
+	}
+
 	if (format == 't' && includewal == STREAM_WAL && strcmp(basedir, "-") == 0)
 	{
 		pg_log_error("cannot stream write-ahead logs in tar mode to stdout");
@@ -2498,6 +2887,15 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (stream_compression != STREAM_COMPRESSION_NONE &&
+		includewal != STREAM_WAL)
+	{
+		pg_log_error("stream compression can only be used with WAL streaming");
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+				progname);
+		exit(1);
+	}
+
 	if (no_slot)
 	{
 		if (replication_slot)
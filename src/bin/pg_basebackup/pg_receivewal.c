@@ -43,6 +43,7 @@ static bool do_drop_slot = false;
 static bool do_sync = true;
 static bool synchronous = false;
 static char *replication_slot = NULL;
+static StreamCompressionMethod stream_compression = STREAM_COMPRESSION_NONE;
 static XLogRecPtr endpos = InvalidXLogRecPtr;
 
 
@@ -87,6 +88,8 @@ usage(void)
 	printf(_("  -s, --status-interval=SECS\n"
 			 "                         time between status packets sent to server (default: %d)\n"), (standby_message_timeout / 1000));
 	printf(_("  -S, --slot=SLOTNAME    replication slot to use\n"));
+	printf(_("      --stream-compression=METHOD\n"
+			 "                         ask the server to compress the stream with METHOD\n"));
 	printf(_("      --synchronous      flush write-ahead log immediately after writing\n"));
 	printf(_("  -v, --verbose          output verbose messages\n"));
 	printf(_("  -V, --version          output version information, then exit\n"));
@@ -433,6 +436,7 @@ StreamLog(void)
 												stream.do_sync);
 	stream.partial_suffix = ".partial";
 	stream.replication_slot = replication_slot;
+	stream.compression = stream_compression;
 
 	ReceiveXlogStream(conn, &stream);
 
@@ -489,6 +493,7 @@ main(int argc, char **argv)
 		{"if-not-exists", no_argument, NULL, 3},
 		{"synchronous", no_argument, NULL, 4},
 		{"no-sync", no_argument, NULL, 5},
+		{"stream-compression", required_argument, NULL, 6},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -597,6 +602,19 @@ main(int argc, char **argv)
 			case 5:
 				do_sync = false;
 				break;
+			case 6:
+				if (!parse_stream_compression_method(optarg, &stream_compression))
+				{
+					pg_log_error("invalid stream compression method \"%s\"", optarg);
+					exit(1);
+				}
+				if (!stream_compression_supported(stream_compression))
+				{
+					pg_log_error("stream compression method \"%s\" is not supported by this build",
+								 optarg);
+					exit(1);
+				}
+				break;
 			default:
 
 				/*
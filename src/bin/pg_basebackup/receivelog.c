@@ -24,6 +24,7 @@
 #include "common/file_utils.h"
 #include "common/logging.h"
 #include "libpq-fe.h"
+#include "port/pg_bswap.h"
 #include "receivelog.h"
 #include "streamutil.h"
 
@@ -35,6 +36,11 @@ static XLogRecPtr lastFlushPosition = InvalidXLogRecPtr;
 
 static bool still_sending = true;	/* feedback still needs to be sent? */
 
+/* decompression of the stream, and the buffer for decompressed WAL */
+static StreamCompressor *decompressor = NULL;
+static char *decompressbuf = NULL;
+static int	decompressbuf_size = 0;
+
 static PGresult *HandleCopyStream(PGconn *conn, StreamCtl *stream,
 								  XLogRecPtr *stoppos);
 static int	CopyStreamPoll(PGconn *conn, long timeout_ms, pgsocket stop_socket);
@@ -430,6 +436,9 @@ CheckServerVersionForStreaming(PGconn *conn)
  * If 'synchronous' is true, the received WAL is flushed as soon as written,
  * otherwise only when the WAL file is closed.
  *
+ * If 'compression' is not STREAM_COMPRESSION_NONE, the server is asked to
+ * compress the WAL it sends with that method.
+ *
  * Note: The WAL location *must* be at a log segment start!
  */
 bool
@@ -437,6 +446,7 @@ ReceiveXlogStream(PGconn *conn, StreamCtl *stream)
 {
 	char		query[128];
 	char		slotcmd[128];
+	char		compressioncmd[32];
 	PGresult   *res;
 	XLogRecPtr	stoppos;
 
@@ -447,6 +457,20 @@ ReceiveXlogStream(PGconn *conn, StreamCtl *stream)
 	if (!CheckServerVersionForStreaming(conn))
 		return false;
 
+	if (stream->compression != STREAM_COMPRESSION_NONE)
+	{
+		if (PQserverVersion(conn) < MINIMUM_VERSION_FOR_STREAM_COMPRESSION)
+		{
+			pg_log_error("stream compression is not supported by server version %s",
+						 PQparameterStatus(conn, "server_version"));
+			return false;
+		}
+		snprintf(compressioncmd, sizeof(compressioncmd), " COMPRESSION '%s'",
+				 stream_compression_method_name(stream->compression));
+	}
+	else
+		compressioncmd[0] = 0;
+
 	/*
 	 * Decide whether we want to report the flush position. If we report the
 	 * flush position, the primary will know what WAL we'll possibly
@@ -558,23 +582,40 @@ ReceiveXlogStream(PGconn *conn, StreamCtl *stream)
 		if (stream->stream_stop(stream->startpos, stream->timeline, false))
 			return true;
 
+		/* Each stream is compressed independently of the previous ones */
+		if (stream->compression != STREAM_COMPRESSION_NONE)
+		{
+			decompressor = stream_compressor_create(stream->compression, true);
+			if (decompressor == NULL)
+			{
+				pg_log_error("could not initialize %s decompression",
+							 stream_compression_method_name(stream->compression));
+				return false;
+			}
+		}
+
 		/* Initiate the replication stream at specified location */
-		snprintf(query, sizeof(query), "START_REPLICATION %s%X/%X TIMELINE %u",
+		snprintf(query, sizeof(query), "START_REPLICATION %s%X/%X TIMELINE %u%s",
 				 slotcmd,
 				 (uint32) (stream->startpos >> 32), (uint32) stream->startpos,
-				 stream->timeline);
+				 stream->timeline, compressioncmd);
 		res = PQexec(conn, query);
 		if (PQresultStatus(res) != PGRES_COPY_BOTH)
 		{
 			pg_log_error("could not send replication command \"%s\": %s",
 						 "START_REPLICATION", PQresultErrorMessage(res));
 			PQclear(res);
-			return false;
+			goto error;
 		}
 		PQclear(res);
 
 		/* Stream the WAL */
 		res = HandleCopyStream(conn, stream, &stoppos);
+		if (decompressor != NULL)
+		{
+			stream_compressor_free(decompressor);
+			decompressor = NULL;
+		}
 		if (res == NULL)
 			goto error;
 
@@ -671,6 +712,11 @@ ReceiveXlogStream(PGconn *conn, StreamCtl *stream)
 	}
 
 error:
+	if (decompressor != NULL)
+	{
+		stream_compressor_free(decompressor);
+		decompressor = NULL;
+	}
 	if (walfile != NULL && stream->walmethod->close(walfile, CLOSE_NO_RENAME) != 0)
 		pg_log_error("could not close file \"%s\": %s",
 					 current_walfile_name, stream->walmethod->getlasterror());
@@ -816,7 +862,8 @@ HandleCopyStream(PGconn *conn, StreamCtl *stream,
 										 &last_status))
 					goto error;
 			}
-			else if (copybuf[0] == 'w')
+			else if (copybuf[0] == 'w' ||
+					 (copybuf[0] == 'z' && decompressor != NULL))
 			{
 				if (!ProcessXLogDataMsg(conn, stream, copybuf, r, &blockpos))
 					goto error;
@@ -1029,7 +1076,7 @@ ProcessKeepaliveMsg(PGconn *conn, StreamCtl *stream, char *copybuf, int len,
 }
 
 /*
- * Process XLogData message.
+ * Process XLogData message, or a CompressedXLogData message.
  */
 static bool
 ProcessXLogDataMsg(PGconn *conn, StreamCtl *stream, char *copybuf, int len,
@@ -1039,6 +1086,7 @@ ProcessXLogDataMsg(PGconn *conn, StreamCtl *stream, char *copybuf, int len,
 	int			bytes_left;
 	int			bytes_written;
 	int			hdr_len;
+	char	   *data;
 
 	/*
 	 * Once we've decided we don't want to receive any more, just ignore any
@@ -1052,10 +1100,12 @@ ProcessXLogDataMsg(PGconn *conn, StreamCtl *stream, char *copybuf, int len,
 	 * message. We only need the WAL location field (dataStart), the rest of
 	 * the header is ignored.
 	 */
-	hdr_len = 1;				/* msgtype 'w' */
+	hdr_len = 1;				/* msgtype 'w' or 'z' */
 	hdr_len += 8;				/* dataStart */
 	hdr_len += 8;				/* walEnd */
 	hdr_len += 8;				/* sendTime */
+	if (copybuf[0] == 'z')
+		hdr_len += 4;			/* rawLen */
 	if (len < hdr_len)
 	{
 		pg_log_error("streaming header too small: %d", len);
@@ -1063,6 +1113,37 @@ ProcessXLogDataMsg(PGconn *conn, StreamCtl *stream, char *copybuf, int len,
 	}
 	*blockpos = fe_recvint64(&copybuf[1]);
 
+	if (copybuf[0] == 'z')
+	{
+		uint32		rawlen;
+
+		memcpy(&rawlen, &copybuf[hdr_len - 4], sizeof(rawlen));
+		bytes_left = pg_ntoh32(rawlen);
+		if (bytes_left < 0)
+		{
+			pg_log_error("invalid uncompressed size in streaming header: %d",
+						 bytes_left);
+			return false;
+		}
+		if (bytes_left > decompressbuf_size)
+		{
+			decompressbuf = pg_realloc(decompressbuf, bytes_left);
+			decompressbuf_size = bytes_left;
+		}
+		if (!stream_decompress(decompressor, copybuf + hdr_len, len - hdr_len,
+							   decompressbuf, bytes_left))
+		{
+			pg_log_error("could not decompress WAL data received from server");
+			return false;
+		}
+		data = decompressbuf;
+	}
+	else
+	{
+		bytes_left = len - hdr_len;
+		data = copybuf + hdr_len;
+	}
+
 	/* Extract WAL location for this block */
 	xlogoff = XLogSegmentOffset(*blockpos, WalSegSz);
 
@@ -1091,7 +1172,6 @@ ProcessXLogDataMsg(PGconn *conn, StreamCtl *stream, char *copybuf, int len,
 		}
 	}
 
-	bytes_left = len - hdr_len;
 	bytes_written = 0;
 
 	while (bytes_left)
@@ -1116,7 +1196,7 @@ ProcessXLogDataMsg(PGconn *conn, StreamCtl *stream, char *copybuf, int len,
 			}
 		}
 
-		if (stream->walmethod->write(walfile, copybuf + hdr_len + bytes_written,
+		if (stream->walmethod->write(walfile, data + bytes_written,
 									 bytes_to_write) != bytes_to_write)
 		{
 			pg_log_error("could not write %u bytes to WAL file \"%s\": %s",
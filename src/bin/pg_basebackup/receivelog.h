@@ -13,9 +13,15 @@
 #define RECEIVELOG_H
 
 #include "access/xlogdefs.h"
+#include "common/stream_compression.h"
 #include "libpq-fe.h"
 #include "walmethods.h"
 
+/*
+ * The first server version that can compress the stream it sends.
+ */
+#define MINIMUM_VERSION_FOR_STREAM_COMPRESSION	140000
+
 /*
  * Called before trying to read more data or when a segment is
  * finished. Return true to stop streaming.
@@ -46,6 +52,8 @@ typedef struct StreamCtl
 	WalWriteMethod *walmethod;	/* How to write the WAL */
 	char	   *partial_suffix; /* Suffix appended to partially received files */
 	char	   *replication_slot;	/* Replication slot to use, or NULL */
+	StreamCompressionMethod compression;	/* Ask the server to compress the
+											 * stream with this method */
 } StreamCtl;
 
 
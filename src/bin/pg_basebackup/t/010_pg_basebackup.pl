@@ -6,7 +6,7 @@ use File::Basename qw(basename dirname);
 use File::Path qw(rmtree);
 use PostgresNode;
 use TestLib;
-use Test::More tests => 109;
+use Test::More tests => 123;
 
 program_help_ok('pg_basebackup');
 program_version_ok('pg_basebackup');
@@ -177,6 +177,55 @@ $node->command_ok([ 'pg_basebackup', '-D', "$tempdir/tarbackup", '-Ft' ],
 ok(-f "$tempdir/tarbackup/base.tar", 'backup tar was created');
 rmtree("$tempdir/tarbackup");
 
+$node->command_fails(
+	[
+		'pg_basebackup', '-D', "$tempdir/backup_foo",
+		'--server-compression=foo'
+	],
+	'pg_basebackup fails with invalid server compression method');
+$node->command_fails(
+	[
+		'pg_basebackup', '-D', "$tempdir/backup_foo", '-Ft', '-R',
+		'--server-compression=gzip'
+	],
+	'pg_basebackup fails with -R and server compression in tar mode');
+
+# Server compression with each method, with the library it needs, and the
+# suffix of the archives it produces
+foreach my $compression (
+	[ 'gzip', 'HAVE_LIBZ', 'gz' ],
+	[ 'lz4',  'USE_LZ4',   'lz4' ],
+	[ 'zstd', 'USE_ZSTD',  'zst' ])
+{
+	my ($method, $symbol, $suffix) = @$compression;
+
+  SKIP:
+	{
+		skip "postgres was not built with $method support", 4
+		  if (!check_pg_config("#define $symbol 1"));
+
+		$node->command_ok(
+			[
+				'pg_basebackup', '-D', "$tempdir/tarbackup_$method", '-Ft',
+				"--server-compression=$method"
+			],
+			"tar format with server compression $method");
+		ok(-f "$tempdir/tarbackup_$method/base.tar.$suffix",
+			"compressed backup tar was created with $method");
+		rmtree("$tempdir/tarbackup_$method");
+
+		$node->command_ok(
+			[
+				'pg_basebackup', '-D', "$tempdir/backup_$method",
+				"--server-compression=$method"
+			],
+			"plain format with server compression $method");
+		ok(-f "$tempdir/backup_$method/PG_VERSION",
+			"backup was unpacked with $method");
+		rmtree("$tempdir/backup_$method");
+	}
+}
+
 $node->command_fails(
 	[ 'pg_basebackup', '-D', "$tempdir/backup_foo", '-Fp', "-T=/foo" ],
 	'-T with empty old directory fails');
@@ -2,7 +2,7 @@ use strict;
 use warnings;
 use TestLib;
 use PostgresNode;
-use Test::More tests => 19;
+use Test::More tests => 22;
 
 program_help_ok('pg_receivewal');
 program_version_ok('pg_receivewal');
@@ -30,6 +30,9 @@ $primary->command_fails(
 $primary->command_fails(
 	[ 'pg_receivewal', '-D', $stream_dir, '--synchronous', '--no-sync' ],
 	'failure if --synchronous specified with --no-sync');
+$primary->command_fails(
+	[ 'pg_receivewal', '-D', $stream_dir, '--stream-compression=foo' ],
+	'failure if --stream-compression specifies an unknown method');
 
 # Slot creation and drop
 my $slot_name = 'test';
@@ -72,3 +75,33 @@ SKIP:
 	ok(check_mode_recursive($stream_dir, 0700, 0600),
 		"check stream dir permissions");
 }
+
+# Stream some more WAL, asking the server to compress it
+SKIP:
+{
+	skip "postgres was not built with zlib support", 2
+	  if (!check_pg_config("#define HAVE_LIBZ 1"));
+
+	my $switchlsn =
+	  $primary->safe_psql('postgres', 'SELECT pg_switch_wal();');
+	$nextlsn =
+	  $primary->safe_psql('postgres', 'SELECT pg_current_wal_insert_lsn();');
+	chomp($nextlsn);
+	$primary->psql('postgres',
+		'INSERT INTO test_table VALUES (generate_series(101,1100));');
+
+	$primary->command_ok(
+		[
+			'pg_receivewal', '-D', $stream_dir, '--verbose',
+			'--endpos', $nextlsn, '--stream-compression=gzip', '--no-loop'
+		],
+		'streaming some WAL with --stream-compression');
+
+	# The segment completed by the switch above, streamed compressed,
+	# matches the server's copy
+	my $walfile = $primary->safe_psql('postgres',
+		"SELECT pg_walfile_name('$switchlsn')");
+	is(slurp_file("$stream_dir/$walfile"),
+		slurp_file($primary->data_dir . "/pg_wal/$walfile"),
+		'WAL streamed with compression matches the server');
+}
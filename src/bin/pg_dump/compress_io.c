@@ -11,9 +11,10 @@
  * provides more flexibility, using callbacks to read/write data from the
  * underlying stream. The second API is a wrapper around fopen/gzopen and
  * friends, providing an interface similar to those, but abstracts away
- * the possible compression. Both APIs use libz for the compression, but
- * the second API uses gzip headers, so the resulting files can be easily
- * manipulated with the gzip utility.
+ * the possible compression. Both APIs can use libz, LZ4 or Zstandard for
+ * the compression.  The second API writes gzip files and LZ4 and Zstandard
+ * frames, so the resulting files can be easily manipulated with the gzip,
+ * lz4 and zstd utilities.
  *
  * Compressor API
  * --------------
@@ -41,10 +42,10 @@
  *	libz's gzopen() APIs. It allows you to use the same functions for
  *	compressed and uncompressed streams. cfopen_read() first tries to open
  *	the file with given name, and if it fails, it tries to open the same
- *	file with the .gz suffix. cfopen_write() opens a file for writing, an
- *	extra argument specifies if the file should be compressed, and adds the
- *	.gz suffix to the filename if so. This allows you to easily handle both
- *	compressed and uncompressed files.
+ *	file with the .gz, .lz4 and .zst suffixes. cfopen_write() opens a file
+ *	for writing, an extra argument specifies if and how the file should be
+ *	compressed, and adds the matching suffix to the filename if so. This
+ *	allows you to easily handle both compressed and uncompressed files.
  *
  * IDENTIFICATION
  *	   src/bin/pg_dump/compress_io.c
@@ -53,9 +54,23 @@
  */
 #include "postgres_fe.h"
 
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "compress_io.h"
 #include "pg_backup_utils.h"
 
+#ifdef USE_LZ4
+/* older versions of lz4frame.h don't define this */
+#ifndef LZ4F_HEADER_SIZE_MAX
+#define LZ4F_HEADER_SIZE_MAX	19
+#endif
+#endif
+
 /*----------------------
  * Compressor API
  *----------------------
@@ -72,6 +87,16 @@ struct CompressorState
 	char	   *zlibOut;
 	size_t		zlibOutSize;
 #endif
+#ifdef USE_LZ4
+	LZ4F_compressionContext_t lz4ctx;
+#endif
+#ifdef USE_ZSTD
+	ZSTD_CCtx  *zstdctx;
+#endif
+	/* output buffer for LZ4 and Zstandard */
+	char	   *comprOut;
+	size_t		comprOutSize;
+	size_t		comprOutLen;	/* bytes waiting to be written */
 };
 
 static void ParseCompressionOption(int compression, CompressionAlgorithm *alg,
@@ -88,6 +113,24 @@ static void WriteDataToArchiveZlib(ArchiveHandle *AH, CompressorState *cs,
 static void EndCompressorZlib(ArchiveHandle *AH, CompressorState *cs);
 #endif
 
+/* Routines that support LZ4 compressed data I/O */
+#ifdef USE_LZ4
+static void InitCompressorLZ4(CompressorState *cs, int level);
+static void ReadDataFromArchiveLZ4(ArchiveHandle *AH, ReadFunc readF);
+static void WriteDataToArchiveLZ4(ArchiveHandle *AH, CompressorState *cs,
+								  const char *data, size_t dLen);
+static void EndCompressorLZ4(ArchiveHandle *AH, CompressorState *cs);
+#endif
+
+/* Routines that support Zstandard compressed data I/O */
+#ifdef USE_ZSTD
+static void InitCompressorZstd(CompressorState *cs, int level);
+static void ReadDataFromArchiveZstd(ArchiveHandle *AH, ReadFunc readF);
+static void WriteDataToArchiveZstd(ArchiveHandle *AH, CompressorState *cs,
+								   const char *data, size_t dLen);
+static void EndCompressorZstd(ArchiveHandle *AH, CompressorState *cs);
+#endif
+
 /* Routines that support uncompressed data I/O */
 static void ReadDataFromArchiveNone(ArchiveHandle *AH, ReadFunc readF);
 static void WriteDataToArchiveNone(ArchiveHandle *AH, CompressorState *cs,
@@ -95,12 +138,32 @@ static void WriteDataToArchiveNone(ArchiveHandle *AH, CompressorState *cs,
 
 /*
  * Interprets a numeric 'compression' value. The algorithm implied by the
- * value (zlib or none at the moment), is returned in *alg, and the
- * zlib compression level in *level.
+ * value is returned in *alg, and the compression level in *level.
  */
 static void
 ParseCompressionOption(int compression, CompressionAlgorithm *alg, int *level)
 {
+	if (compression > 0 && (compression & COMPRESSION_METHOD_MASK) != 0)
+	{
+		switch (compression & COMPRESSION_METHOD_MASK)
+		{
+			case COMPRESSION_LZ4:
+				*alg = COMPR_ALG_LZ4;
+				break;
+			case COMPRESSION_ZSTD:
+				*alg = COMPR_ALG_ZSTD;
+				break;
+			default:
+				fatal("invalid compression code: %d", compression);
+				*alg = COMPR_ALG_NONE;	/* keep compiler quiet */
+				break;
+		}
+
+		if (level)
+			*level = compression & COMPRESSION_LEVEL_MASK;
+		return;
+	}
+
 	if (compression == Z_DEFAULT_COMPRESSION ||
 		(compression > 0 && compression <= 9))
 		*alg = COMPR_ALG_LIBZ;
@@ -119,6 +182,64 @@ ParseCompressionOption(int compression, CompressionAlgorithm *alg, int *level)
 
 /* Public interface routines */
 
+/* Is the given compression supported by this build? */
+bool
+CompressionSupported(int compression)
+{
+	CompressionAlgorithm alg;
+
+	ParseCompressionOption(compression, &alg, NULL);
+
+	switch (alg)
+	{
+		case COMPR_ALG_NONE:
+			return true;
+		case COMPR_ALG_LIBZ:
+#ifdef HAVE_LIBZ
+			return true;
+#else
+			return false;
+#endif
+		case COMPR_ALG_LZ4:
+#ifdef USE_LZ4
+			return true;
+#else
+			return false;
+#endif
+		case COMPR_ALG_ZSTD:
+#ifdef USE_ZSTD
+			return true;
+#else
+			return false;
+#endif
+	}
+
+	return false;				/* keep compiler quiet */
+}
+
+/* File name suffix of files compressed with the given compression */
+const char *
+CompressionSuffix(int compression)
+{
+	CompressionAlgorithm alg;
+
+	ParseCompressionOption(compression, &alg, NULL);
+
+	switch (alg)
+	{
+		case COMPR_ALG_NONE:
+			return "";
+		case COMPR_ALG_LIBZ:
+			return ".gz";
+		case COMPR_ALG_LZ4:
+			return ".lz4";
+		case COMPR_ALG_ZSTD:
+			return ".zst";
+	}
+
+	return "";					/* keep compiler quiet */
+}
+
 /* Allocate a new compressor */
 CompressorState *
 AllocateCompressor(int compression, WriteFunc writeF)
@@ -133,6 +254,14 @@ AllocateCompressor(int compression, WriteFunc writeF)
 	if (alg == COMPR_ALG_LIBZ)
 		fatal("not built with zlib support");
 #endif
+#ifndef USE_LZ4
+	if (alg == COMPR_ALG_LZ4)
+		fatal("not built with LZ4 support");
+#endif
+#ifndef USE_ZSTD
+	if (alg == COMPR_ALG_ZSTD)
+		fatal("not built with Zstandard support");
+#endif
 
 	cs = (CompressorState *) pg_malloc0(sizeof(CompressorState));
 	cs->writeF = writeF;
@@ -145,6 +274,14 @@ AllocateCompressor(int compression, WriteFunc writeF)
 	if (alg == COMPR_ALG_LIBZ)
 		InitCompressorZlib(cs, level);
 #endif
+#ifdef USE_LZ4
+	if (alg == COMPR_ALG_LZ4)
+		InitCompressorLZ4(cs, level);
+#endif
+#ifdef USE_ZSTD
+	if (alg == COMPR_ALG_ZSTD)
+		InitCompressorZstd(cs, level);
+#endif
 
 	return cs;
 }
@@ -168,6 +305,22 @@ ReadDataFromArchive(ArchiveHandle *AH, int compression, ReadFunc readF)
 		ReadDataFromArchiveZlib(AH, readF);
 #else
 		fatal("not built with zlib support");
+#endif
+	}
+	if (alg == COMPR_ALG_LZ4)
+	{
+#ifdef USE_LZ4
+		ReadDataFromArchiveLZ4(AH, readF);
+#else
+		fatal("not built with LZ4 support");
+#endif
+	}
+	if (alg == COMPR_ALG_ZSTD)
+	{
+#ifdef USE_ZSTD
+		ReadDataFromArchiveZstd(AH, readF);
+#else
+		fatal("not built with Zstandard support");
 #endif
 	}
 }
@@ -186,6 +339,20 @@ WriteDataToArchive(ArchiveHandle *AH, CompressorState *cs,
 			WriteDataToArchiveZlib(AH, cs, data, dLen);
 #else
 			fatal("not built with zlib support");
+#endif
+			break;
+		case COMPR_ALG_LZ4:
+#ifdef USE_LZ4
+			WriteDataToArchiveLZ4(AH, cs, data, dLen);
+#else
+			fatal("not built with LZ4 support");
+#endif
+			break;
+		case COMPR_ALG_ZSTD:
+#ifdef USE_ZSTD
+			WriteDataToArchiveZstd(AH, cs, data, dLen);
+#else
+			fatal("not built with Zstandard support");
 #endif
 			break;
 		case COMPR_ALG_NONE:
@@ -203,6 +370,14 @@ EndCompressor(ArchiveHandle *AH, CompressorState *cs)
 #ifdef HAVE_LIBZ
 	if (cs->comprAlg == COMPR_ALG_LIBZ)
 		EndCompressorZlib(AH, cs);
+#endif
+#ifdef USE_LZ4
+	if (cs->comprAlg == COMPR_ALG_LZ4)
+		EndCompressorLZ4(AH, cs);
+#endif
+#ifdef USE_ZSTD
+	if (cs->comprAlg == COMPR_ALG_ZSTD)
+		EndCompressorZstd(AH, cs);
 #endif
 	free(cs);
 }
@@ -376,6 +551,259 @@ ReadDataFromArchiveZlib(ArchiveHandle *AH, ReadFunc readF)
 }
 #endif							/* HAVE_LIBZ */
 
+#ifdef USE_LZ4
+/*
+ * Functions for LZ4 compressed output, in the LZ4 frame format.
+ */
+
+static void
+InitCompressorLZ4(CompressorState *cs, int level)
+{
+	LZ4F_preferences_t prefs;
+	size_t		status;
+
+	memset(&prefs, 0, sizeof(prefs));
+	prefs.compressionLevel = level;
+
+	status = LZ4F_createCompressionContext(&cs->lz4ctx, LZ4F_VERSION);
+	if (LZ4F_isError(status))
+		fatal("could not initialize compression library: %s",
+			  LZ4F_getErrorName(status));
+
+	cs->comprOutSize = LZ4F_HEADER_SIZE_MAX +
+		LZ4F_compressBound(COMPR_IN_SIZE, &prefs);
+	cs->comprOut = pg_malloc(cs->comprOutSize);
+
+	/*
+	 * The frame header goes out with the first compressed data, as we have
+	 * no ArchiveHandle to write it with here.
+	 */
+	status = LZ4F_compressBegin(cs->lz4ctx, cs->comprOut, cs->comprOutSize,
+								&prefs);
+	if (LZ4F_isError(status))
+		fatal("could not compress data: %s", LZ4F_getErrorName(status));
+	cs->comprOutLen = status;
+}
+
+static void
+WriteDataToArchiveLZ4(ArchiveHandle *AH, CompressorState *cs,
+					  const char *data, size_t dLen)
+{
+	while (dLen > 0)
+	{
+		size_t		chunk = Min(dLen, COMPR_IN_SIZE);
+		size_t		status;
+
+		status = LZ4F_compressUpdate(cs->lz4ctx,
+									 cs->comprOut + cs->comprOutLen,
+									 cs->comprOutSize - cs->comprOutLen,
+									 data, chunk, NULL);
+		if (LZ4F_isError(status))
+			fatal("could not compress data: %s", LZ4F_getErrorName(status));
+		cs->comprOutLen += status;
+
+		/* avoid zero-length chunks, the EOF marker in the custom format */
+		if (cs->comprOutLen > 0)
+		{
+			cs->writeF(AH, cs->comprOut, cs->comprOutLen);
+			cs->comprOutLen = 0;
+		}
+
+		data += chunk;
+		dLen -= chunk;
+	}
+}
+
+static void
+EndCompressorLZ4(ArchiveHandle *AH, CompressorState *cs)
+{
+	size_t		status;
+
+	status = LZ4F_compressEnd(cs->lz4ctx,
+							  cs->comprOut + cs->comprOutLen,
+							  cs->comprOutSize - cs->comprOutLen,
+							  NULL);
+	if (LZ4F_isError(status))
+		fatal("could not compress data: %s", LZ4F_getErrorName(status));
+	cs->comprOutLen += status;
+
+	if (cs->comprOutLen > 0)
+		cs->writeF(AH, cs->comprOut, cs->comprOutLen);
+
+	LZ4F_freeCompressionContext(cs->lz4ctx);
+	free(cs->comprOut);
+}
+
+static void
+ReadDataFromArchiveLZ4(ArchiveHandle *AH, ReadFunc readF)
+{
+	LZ4F_decompressionContext_t ctx;
+	size_t		status;
+	size_t		cnt;
+	char	   *buf;
+	size_t		buflen;
+	char	   *out;
+
+	status = LZ4F_createDecompressionContext(&ctx, LZ4F_VERSION);
+	if (LZ4F_isError(status))
+		fatal("could not initialize compression library: %s",
+			  LZ4F_getErrorName(status));
+
+	buf = pg_malloc(COMPR_IN_SIZE);
+	buflen = COMPR_IN_SIZE;
+
+	out = pg_malloc(COMPR_IN_SIZE + 1);
+
+	while ((cnt = readF(AH, &buf, &buflen)))
+	{
+		char	   *in = buf;
+		size_t		outlen;
+
+		/* keep going while there is input, or output didn't fit */
+		do
+		{
+			size_t		inlen = cnt;
+
+			outlen = COMPR_IN_SIZE;
+			status = LZ4F_decompress(ctx, out, &outlen, in, &inlen, NULL);
+			if (LZ4F_isError(status))
+				fatal("could not uncompress data: %s",
+					  LZ4F_getErrorName(status));
+			in += inlen;
+			cnt -= inlen;
+
+			out[outlen] = '\0';
+			ahwrite(out, 1, outlen, AH);
+		} while (cnt > 0 || outlen == COMPR_IN_SIZE);
+	}
+
+	LZ4F_freeDecompressionContext(ctx);
+	free(buf);
+	free(out);
+}
+#endif							/* USE_LZ4 */
+
+#ifdef USE_ZSTD
+/*
+ * Functions for Zstandard compressed output.
+ */
+
+static void
+InitCompressorZstd(CompressorState *cs, int level)
+{
+	cs->zstdctx = ZSTD_createCCtx();
+	if (cs->zstdctx == NULL)
+		fatal("could not initialize compression library");
+
+	if (level != 0)
+	{
+		size_t		status;
+
+		status = ZSTD_CCtx_setParameter(cs->zstdctx,
+										ZSTD_c_compressionLevel, level);
+		if (ZSTD_isError(status))
+			fatal("could not set compression level %d: %s",
+				  level, ZSTD_getErrorName(status));
+	}
+
+	cs->comprOutSize = ZSTD_CStreamOutSize();
+	cs->comprOut = pg_malloc(cs->comprOutSize);
+}
+
+static void
+WriteDataToArchiveZstd(ArchiveHandle *AH, CompressorState *cs,
+					   const char *data, size_t dLen)
+{
+	ZSTD_inBuffer in = {data, dLen, 0};
+
+	while (in.pos < in.size)
+	{
+		ZSTD_outBuffer out = {cs->comprOut, cs->comprOutSize, 0};
+		size_t		status;
+
+		status = ZSTD_compressStream2(cs->zstdctx, &out, &in,
+									  ZSTD_e_continue);
+		if (ZSTD_isError(status))
+			fatal("could not compress data: %s", ZSTD_getErrorName(status));
+
+		/* avoid zero-length chunks, the EOF marker in the custom format */
+		if (out.pos > 0)
+			cs->writeF(AH, cs->comprOut, out.pos);
+	}
+}
+
+static void
+EndCompressorZstd(ArchiveHandle *AH, CompressorState *cs)
+{
+	size_t		remaining;
+
+	do
+	{
+		ZSTD_inBuffer in = {NULL, 0, 0};
+		ZSTD_outBuffer out = {cs->comprOut, cs->comprOutSize, 0};
+
+		remaining = ZSTD_compressStream2(cs->zstdctx, &out, &in, ZSTD_e_end);
+		if (ZSTD_isError(remaining))
+			fatal("could not compress data: %s",
+				  ZSTD_getErrorName(remaining));
+
+		if (out.pos > 0)
+			cs->writeF(AH, cs->comprOut, out.pos);
+	} while (remaining != 0);
+
+	ZSTD_freeCCtx(cs->zstdctx);
+	free(cs->comprOut);
+}
+
+static void
+ReadDataFromArchiveZstd(ArchiveHandle *AH, ReadFunc readF)
+{
+	ZSTD_DCtx  *ctx;
+	size_t		cnt;
+	char	   *buf;
+	size_t		buflen;
+	char	   *out;
+	size_t		outsize = ZSTD_DStreamOutSize();
+
+	ctx = ZSTD_createDCtx();
+	if (ctx == NULL)
+		fatal("could not initialize compression library");
+
+	buf = pg_malloc(COMPR_IN_SIZE);
+	buflen = COMPR_IN_SIZE;
+
+	out = pg_malloc(outsize + 1);
+
+	while ((cnt = readF(AH, &buf, &buflen)))
+	{
+		ZSTD_inBuffer in = {buf, cnt, 0};
+		ZSTD_outBuffer outbuf;
+
+		/* keep going while there is input, or output didn't fit */
+		do
+		{
+			size_t		status;
+
+			outbuf.dst = out;
+			outbuf.size = outsize;
+			outbuf.pos = 0;
+
+			status = ZSTD_decompressStream(ctx, &outbuf, &in);
+			if (ZSTD_isError(status))
+				fatal("could not uncompress data: %s",
+					  ZSTD_getErrorName(status));
+
+			out[outbuf.pos] = '\0';
+			ahwrite(out, 1, outbuf.pos, AH);
+		} while (in.pos < in.size || outbuf.pos == outbuf.size);
+	}
+
+	ZSTD_freeDCtx(ctx);
+	free(buf);
+	free(out);
+}
+#endif							/* USE_ZSTD */
+
 
 /*
  * Functions for uncompressed output.
@@ -415,18 +843,53 @@ WriteDataToArchiveNone(ArchiveHandle *AH, CompressorState *cs,
 /*
  * cfp represents an open stream, wrapping the underlying FILE or gzFile
  * pointer. This is opaque to the callers.
+ *
+ * LZ4 and Zstandard streams are (de)compressed here, in buffers, and read
+ * from or written to uncompressedfp.
  */
 struct cfp
 {
 	FILE	   *uncompressedfp;
 #ifdef HAVE_LIBZ
 	gzFile		compressedfp;
+#endif
+	CompressionAlgorithm alg;
+
+	/* state of LZ4 and Zstandard streams */
+	bool		writing;		/* opened for writing? */
+	bool		eof;			/* reached end of uncompressedfp? */
+	char	   *inBuf;			/* compressed data read from file */
+	size_t		inSize;
+	size_t		inPos;
+	size_t		inLen;
+	char	   *outBuf;			/* decompressed data to be returned, or
+								 * compressed data to be written */
+	size_t		outSize;
+	size_t		outPos;
+	size_t		outLen;
+#ifdef USE_LZ4
+	LZ4F_compressionContext_t lz4c;
+	LZ4F_decompressionContext_t lz4d;
+#endif
+#ifdef USE_ZSTD
+	ZSTD_CCtx  *zstdc;
+	ZSTD_DCtx  *zstdd;
 #endif
 };
 
-#ifdef HAVE_LIBZ
 static int	hasSuffix(const char *filename, const char *suffix);
-#endif
+static void cfopen_framed(cfp *fp, const char *mode, int level);
+static bool cfread_fill(cfp *fp);
+static int	cfread_framed(void *ptr, int size, cfp *fp);
+static int	cfwrite_framed(const void *ptr, int size, cfp *fp);
+static int	cfclose_framed(cfp *fp);
+
+/* the compressions cfopen_read() looks for */
+static const int cfp_compressions[] = {
+	Z_DEFAULT_COMPRESSION,
+	COMPRESSION_LZ4,
+	COMPRESSION_ZSTD
+};
 
 /* free() without changing errno; useful in several places below */
 static void
@@ -442,9 +905,10 @@ free_keep_errno(void *p)
  * Open a file for reading. 'path' is the file to open, and 'mode' should
  * be either "r" or "rb".
  *
- * If the file at 'path' does not exist, we append the ".gz" suffix (if 'path'
- * doesn't already have it) and try again. So if you pass "foo" as 'path',
- * this will open either "foo" or "foo.gz".
+ * If the file at 'path' does not exist, we append the ".gz", ".lz4" and
+ * ".zst" suffixes (if 'path' doesn't already have one) and try again, as far
+ * as the compression is supported by this build. So if you pass "foo" as
+ * 'path', this will open either "foo" or "foo.gz", and so on.
  *
  * On failure, return NULL with an error code in errno.
  */
@@ -452,24 +916,27 @@ cfp *
 cfopen_read(const char *path, const char *mode)
 {
 	cfp		   *fp;
+	int			i;
 
-#ifdef HAVE_LIBZ
-	if (hasSuffix(path, ".gz"))
-		fp = cfopen(path, mode, 1);
-	else
-#endif
+	for (i = 0; i < lengthof(cfp_compressions); i++)
 	{
-		fp = cfopen(path, mode, 0);
-#ifdef HAVE_LIBZ
-		if (fp == NULL)
-		{
-			char	   *fname;
+		if (CompressionSupported(cfp_compressions[i]) &&
+			hasSuffix(path, CompressionSuffix(cfp_compressions[i])))
+			return cfopen(path, mode, cfp_compressions[i]);
+	}
 
-			fname = psprintf("%s.gz", path);
-			fp = cfopen(fname, mode, 1);
-			free_keep_errno(fname);
-		}
-#endif
+	fp = cfopen(path, mode, 0);
+
+	for (i = 0; fp == NULL && i < lengthof(cfp_compressions); i++)
+	{
+		char	   *fname;
+
+		if (!CompressionSupported(cfp_compressions[i]))
+			continue;
+
+		fname = psprintf("%s%s", path, CompressionSuffix(cfp_compressions[i]));
+		fp = cfopen(fname, mode, cfp_compressions[i]);
+		free_keep_errno(fname);
 	}
 	return fp;
 }
@@ -479,9 +946,10 @@ cfopen_read(const char *path, const char *mode)
  * be a filemode as accepted by fopen() and gzopen() that indicates writing
  * ("w", "wb", "a", or "ab").
  *
- * If 'compression' is non-zero, a gzip compressed stream is opened, and
- * 'compression' indicates the compression level used. The ".gz" suffix
- * is automatically added to 'path' in that case.
+ * If 'compression' is non-zero, a compressed stream is opened, and
+ * 'compression' indicates the compression method and level used. The
+ * suffix of the method, like ".gz", is automatically added to 'path' in
+ * that case.
  *
  * On failure, return NULL with an error code in errno.
  */
@@ -494,32 +962,33 @@ cfopen_write(const char *path, const char *mode, int compression)
 		fp = cfopen(path, mode, 0);
 	else
 	{
-#ifdef HAVE_LIBZ
 		char	   *fname;
 
-		fname = psprintf("%s.gz", path);
+		fname = psprintf("%s%s", path, CompressionSuffix(compression));
 		fp = cfopen(fname, mode, compression);
 		free_keep_errno(fname);
-#else
-		fatal("not built with zlib support");
-		fp = NULL;				/* keep compiler quiet */
-#endif
 	}
 	return fp;
 }
 
 /*
  * Opens file 'path' in 'mode'. If 'compression' is non-zero, the file
- * is opened with libz gzopen(), otherwise with plain fopen().
+ * is opened with libz gzopen(), or as an LZ4 or Zstandard stream, otherwise
+ * with plain fopen().
  *
  * On failure, return NULL with an error code in errno.
  */
 cfp *
 cfopen(const char *path, const char *mode, int compression)
 {
-	cfp		   *fp = pg_malloc(sizeof(cfp));
+	cfp		   *fp = pg_malloc0(sizeof(cfp));
+	CompressionAlgorithm alg;
+	int			level;
 
-	if (compression != 0)
+	ParseCompressionOption(compression, &alg, &level);
+	fp->alg = alg;
+
+	if (alg == COMPR_ALG_LIBZ)
 	{
 #ifdef HAVE_LIBZ
 		if (compression != Z_DEFAULT_COMPRESSION)
@@ -549,15 +1018,23 @@ cfopen(const char *path, const char *mode, int compression)
 	}
 	else
 	{
-#ifdef HAVE_LIBZ
-		fp->compressedfp = NULL;
+#ifndef USE_LZ4
+		if (alg == COMPR_ALG_LZ4)
+			fatal("not built with LZ4 support");
+#endif
+#ifndef USE_ZSTD
+		if (alg == COMPR_ALG_ZSTD)
+			fatal("not built with Zstandard support");
 #endif
+
 		fp->uncompressedfp = fopen(path, mode);
 		if (fp->uncompressedfp == NULL)
 		{
 			free_keep_errno(fp);
 			fp = NULL;
 		}
+		else if (alg != COMPR_ALG_NONE)
+			cfopen_framed(fp, mode, level);
 	}
 
 	return fp;
@@ -572,6 +1049,9 @@ cfread(void *ptr, int size, cfp *fp)
 	if (size == 0)
 		return 0;
 
+	if (fp->alg == COMPR_ALG_LZ4 || fp->alg == COMPR_ALG_ZSTD)
+		return cfread_framed(ptr, size, fp);
+
 #ifdef HAVE_LIBZ
 	if (fp->compressedfp)
 	{
@@ -598,6 +1078,9 @@ cfread(void *ptr, int size, cfp *fp)
 int
 cfwrite(const void *ptr, int size, cfp *fp)
 {
+	if (fp->alg == COMPR_ALG_LZ4 || fp->alg == COMPR_ALG_ZSTD)
+		return cfwrite_framed(ptr, size, fp);
+
 #ifdef HAVE_LIBZ
 	if (fp->compressedfp)
 		return gzwrite(fp->compressedfp, ptr, size);
@@ -611,6 +1094,15 @@ cfgetc(cfp *fp)
 {
 	int			ret;
 
+	if (fp->alg == COMPR_ALG_LZ4 || fp->alg == COMPR_ALG_ZSTD)
+	{
+		unsigned char c;
+
+		if (cfread_framed(&c, 1, fp) != 1)
+			fatal("could not read from input file: end of file");
+		return c;
+	}
+
 #ifdef HAVE_LIBZ
 	if (fp->compressedfp)
 	{
@@ -637,6 +1129,27 @@ cfgetc(cfp *fp)
 char *
 cfgets(cfp *fp, char *buf, int len)
 {
+	if (fp->alg == COMPR_ALG_LZ4 || fp->alg == COMPR_ALG_ZSTD)
+	{
+		int			i = 0;
+
+		while (i < len - 1)
+		{
+			char		c;
+
+			if (fp->outPos == fp->outLen && !cfread_fill(fp))
+				break;
+			c = fp->outBuf[fp->outPos++];
+			buf[i++] = c;
+			if (c == '\n')
+				break;
+		}
+		if (i == 0)
+			return NULL;
+		buf[i] = '\0';
+		return buf;
+	}
+
 #ifdef HAVE_LIBZ
 	if (fp->compressedfp)
 		return gzgets(fp->compressedfp, buf, len);
@@ -655,6 +1168,9 @@ cfclose(cfp *fp)
 		errno = EBADF;
 		return EOF;
 	}
+	if (fp->alg == COMPR_ALG_LZ4 || fp->alg == COMPR_ALG_ZSTD)
+		result = cfclose_framed(fp);
+	else
 #ifdef HAVE_LIBZ
 	if (fp->compressedfp)
 	{
@@ -675,6 +1191,9 @@ cfclose(cfp *fp)
 int
 cfeof(cfp *fp)
 {
+	if (fp->alg == COMPR_ALG_LZ4 || fp->alg == COMPR_ALG_ZSTD)
+		return fp->eof && fp->inPos == fp->inLen && fp->outPos == fp->outLen;
+
 #ifdef HAVE_LIBZ
 	if (fp->compressedfp)
 		return gzeof(fp->compressedfp);
@@ -699,7 +1218,6 @@ get_cfp_error(cfp *fp)
 	return strerror(errno);
 }
 
-#ifdef HAVE_LIBZ
 static int
 hasSuffix(const char *filename, const char *suffix)
 {
@@ -714,4 +1232,310 @@ hasSuffix(const char *filename, const char *suffix)
 				  suffixlen) == 0;
 }
 
+/*
+ * Set up the (de)compression of an LZ4 or Zstandard stream.
+ */
+static void
+cfopen_framed(cfp *fp, const char *mode, int level)
+{
+	fp->writing = (mode[0] == 'w' || mode[0] == 'a');
+
+	if (fp->writing)
+	{
+#ifdef USE_LZ4
+		if (fp->alg == COMPR_ALG_LZ4)
+		{
+			LZ4F_preferences_t prefs;
+			size_t		status;
+
+			memset(&prefs, 0, sizeof(prefs));
+			prefs.compressionLevel = level;
+
+			status = LZ4F_createCompressionContext(&fp->lz4c, LZ4F_VERSION);
+			if (LZ4F_isError(status))
+				fatal("could not initialize compression library: %s",
+					  LZ4F_getErrorName(status));
+
+			fp->outSize = LZ4F_HEADER_SIZE_MAX +
+				LZ4F_compressBound(COMPR_IN_SIZE, &prefs);
+			fp->outBuf = pg_malloc(fp->outSize);
+
+			/* the frame header is written along with the first data */
+			status = LZ4F_compressBegin(fp->lz4c, fp->outBuf, fp->outSize,
+										&prefs);
+			if (LZ4F_isError(status))
+				fatal("could not compress data: %s",
+					  LZ4F_getErrorName(status));
+			fp->outLen = status;
+		}
+#endif
+#ifdef USE_ZSTD
+		if (fp->alg == COMPR_ALG_ZSTD)
+		{
+			fp->zstdc = ZSTD_createCCtx();
+			if (fp->zstdc == NULL)
+				fatal("could not initialize compression library");
+			if (level != 0)
+			{
+				size_t		status;
+
+				status = ZSTD_CCtx_setParameter(fp->zstdc,
+												ZSTD_c_compressionLevel,
+												level);
+				if (ZSTD_isError(status))
+					fatal("could not set compression level %d: %s",
+						  level, ZSTD_getErrorName(status));
+			}
+
+			fp->outSize = ZSTD_CStreamOutSize();
+			fp->outBuf = pg_malloc(fp->outSize);
+		}
 #endif
+	}
+	else
+	{
+		fp->inSize = COMPR_IN_SIZE;
+		fp->inBuf = pg_malloc(fp->inSize);
+		fp->outSize = COMPR_IN_SIZE;
+		fp->outBuf = pg_malloc(fp->outSize);
+
+#ifdef USE_LZ4
+		if (fp->alg == COMPR_ALG_LZ4)
+		{
+			size_t		status;
+
+			status = LZ4F_createDecompressionContext(&fp->lz4d, LZ4F_VERSION);
+			if (LZ4F_isError(status))
+				fatal("could not initialize compression library: %s",
+					  LZ4F_getErrorName(status));
+		}
+#endif
+#ifdef USE_ZSTD
+		if (fp->alg == COMPR_ALG_ZSTD)
+		{
+			fp->zstdd = ZSTD_createDCtx();
+			if (fp->zstdd == NULL)
+				fatal("could not initialize compression library");
+		}
+#endif
+	}
+}
+
+/*
+ * Decompress more data of an LZ4 or Zstandard stream into outBuf.  Returns
+ * false at the end of the stream.
+ */
+static bool
+cfread_fill(cfp *fp)
+{
+	fp->outPos = fp->outLen = 0;
+
+	for (;;)
+	{
+		if (fp->inPos == fp->inLen && !fp->eof)
+		{
+			fp->inLen = fread(fp->inBuf, 1, fp->inSize, fp->uncompressedfp);
+			fp->inPos = 0;
+			if (fp->inLen == 0)
+			{
+				if (ferror(fp->uncompressedfp))
+					READ_ERROR_EXIT(fp->uncompressedfp);
+				fp->eof = true;
+			}
+		}
+
+#ifdef USE_LZ4
+		if (fp->alg == COMPR_ALG_LZ4)
+		{
+			size_t		inlen = fp->inLen - fp->inPos;
+			size_t		outlen = fp->outSize;
+			size_t		status;
+
+			status = LZ4F_decompress(fp->lz4d, fp->outBuf, &outlen,
+									 fp->inBuf + fp->inPos, &inlen, NULL);
+			if (LZ4F_isError(status))
+				fatal("could not uncompress data: %s",
+					  LZ4F_getErrorName(status));
+			fp->inPos += inlen;
+			fp->outLen = outlen;
+		}
+#endif
+#ifdef USE_ZSTD
+		if (fp->alg == COMPR_ALG_ZSTD)
+		{
+			ZSTD_inBuffer in = {fp->inBuf, fp->inLen, fp->inPos};
+			ZSTD_outBuffer out = {fp->outBuf, fp->outSize, 0};
+			size_t		status;
+
+			status = ZSTD_decompressStream(fp->zstdd, &out, &in);
+			if (ZSTD_isError(status))
+				fatal("could not uncompress data: %s",
+					  ZSTD_getErrorName(status));
+			fp->inPos = in.pos;
+			fp->outLen = out.pos;
+		}
+#endif
+
+		if (fp->outLen > 0)
+			return true;
+		if (fp->eof && fp->inPos == fp->inLen)
+			return false;
+	}
+}
+
+static int
+cfread_framed(void *ptr, int size, cfp *fp)
+{
+	char	   *dst = ptr;
+	int			done = 0;
+
+	while (done < size)
+	{
+		size_t		n;
+
+		if (fp->outPos == fp->outLen && !cfread_fill(fp))
+			break;
+
+		n = Min((size_t) (size - done), fp->outLen - fp->outPos);
+		memcpy(dst + done, fp->outBuf + fp->outPos, n);
+		fp->outPos += n;
+		done += n;
+	}
+
+	return done;
+}
+
+static int
+cfwrite_framed(const void *ptr, int size, cfp *fp)
+{
+	const char *data = ptr;
+	size_t		remaining = size;
+
+	while (remaining > 0)
+	{
+		size_t		chunk = Min(remaining, COMPR_IN_SIZE);
+
+#ifdef USE_LZ4
+		if (fp->alg == COMPR_ALG_LZ4)
+		{
+			size_t		status;
+
+			status = LZ4F_compressUpdate(fp->lz4c,
+										 fp->outBuf + fp->outLen,
+										 fp->outSize - fp->outLen,
+										 data, chunk, NULL);
+			if (LZ4F_isError(status))
+				fatal("could not compress data: %s",
+					  LZ4F_getErrorName(status));
+			fp->outLen += status;
+
+			if (fp->outLen > 0 &&
+				fwrite(fp->outBuf, 1, fp->outLen, fp->uncompressedfp) != fp->outLen)
+				return 0;
+			fp->outLen = 0;
+		}
+#endif
+#ifdef USE_ZSTD
+		if (fp->alg == COMPR_ALG_ZSTD)
+		{
+			ZSTD_inBuffer in = {data, chunk, 0};
+
+			while (in.pos < in.size)
+			{
+				ZSTD_outBuffer out = {fp->outBuf, fp->outSize, 0};
+				size_t		status;
+
+				status = ZSTD_compressStream2(fp->zstdc, &out, &in,
+											  ZSTD_e_continue);
+				if (ZSTD_isError(status))
+					fatal("could not compress data: %s",
+						  ZSTD_getErrorName(status));
+
+				if (out.pos > 0 &&
+					fwrite(fp->outBuf, 1, out.pos, fp->uncompressedfp) != out.pos)
+					return 0;
+			}
+		}
+#endif
+
+		data += chunk;
+		remaining -= chunk;
+	}
+
+	return size;
+}
+
+/*
+ * Finish an LZ4 or Zstandard stream, if writing, and close the file.
+ */
+static int
+cfclose_framed(cfp *fp)
+{
+	int			result = 0;
+
+	if (fp->writing)
+	{
+#ifdef USE_LZ4
+		if (fp->alg == COMPR_ALG_LZ4)
+		{
+			size_t		status;
+
+			status = LZ4F_compressEnd(fp->lz4c,
+									  fp->outBuf + fp->outLen,
+									  fp->outSize - fp->outLen,
+									  NULL);
+			if (LZ4F_isError(status))
+				fatal("could not compress data: %s",
+					  LZ4F_getErrorName(status));
+			fp->outLen += status;
+
+			if (fwrite(fp->outBuf, 1, fp->outLen, fp->uncompressedfp) != fp->outLen)
+				result = EOF;
+		}
+#endif
+#ifdef USE_ZSTD
+		if (fp->alg == COMPR_ALG_ZSTD)
+		{
+			size_t		remaining;
+
+			do
+			{
+				ZSTD_inBuffer in = {NULL, 0, 0};
+				ZSTD_outBuffer out = {fp->outBuf, fp->outSize, 0};
+
+				remaining = ZSTD_compressStream2(fp->zstdc, &out, &in,
+												 ZSTD_e_end);
+				if (ZSTD_isError(remaining))
+					fatal("could not compress data: %s",
+						  ZSTD_getErrorName(remaining));
+
+				if (fwrite(fp->outBuf, 1, out.pos, fp->uncompressedfp) != out.pos)
+					result = EOF;
+			} while (remaining != 0 && result == 0);
+		}
+#endif
+	}
+
+#ifdef USE_LZ4
+	if (fp->lz4c)
+		LZ4F_freeCompressionContext(fp->lz4c);
+	if (fp->lz4d)
+		LZ4F_freeDecompressionContext(fp->lz4d);
+#endif
+#ifdef USE_ZSTD
+	if (fp->zstdc)
+		ZSTD_freeCCtx(fp->zstdc);
+	if (fp->zstdd)
+		ZSTD_freeDCtx(fp->zstdd);
+#endif
+	if (fp->inBuf)
+		free(fp->inBuf);
+	if (fp->outBuf)
+		free(fp->outBuf);
+
+	if (fclose(fp->uncompressedfp) != 0)
+		result = EOF;
+	fp->uncompressedfp = NULL;
+
+	return result;
+}
@@ -21,12 +21,29 @@
 #define ZLIB_OUT_SIZE	4096
 #define ZLIB_IN_SIZE	4096
 
+/* Size of the chunks fed to LZ4 and Zstandard at a time */
+#define COMPR_IN_SIZE	(64 * 1024)
+
 typedef enum
 {
 	COMPR_ALG_NONE,
-	COMPR_ALG_LIBZ
+	COMPR_ALG_LIBZ,
+	COMPR_ALG_LZ4,
+	COMPR_ALG_ZSTD
 } CompressionAlgorithm;
 
+/*
+ * The compression of an archive is described by a single int, as stored in
+ * its header.  0 means no compression.  For gzip, it is the compression
+ * level, 1-9, or Z_DEFAULT_COMPRESSION (-1).  For the other methods, one of
+ * the flags below is combined with the level, 0 meaning the library's
+ * default level.
+ */
+#define COMPRESSION_LZ4			0x10000
+#define COMPRESSION_ZSTD		0x20000
+#define COMPRESSION_METHOD_MASK	0xF0000
+#define COMPRESSION_LEVEL_MASK	0x0FFFF
+
 /* Prototype for callback function to WriteDataToArchive() */
 typedef void (*WriteFunc) (ArchiveHandle *AH, const char *buf, size_t len);
 
@@ -46,6 +63,9 @@ typedef size_t (*ReadFunc) (ArchiveHandle *AH, char **buf, size_t *buflen);
 /* struct definition appears in compress_io.c */
 typedef struct CompressorState CompressorState;
 
+extern bool CompressionSupported(int compression);
+extern const char *CompressionSuffix(int compression);
+
 extern CompressorState *AllocateCompressor(int compression, WriteFunc writeF);
 extern void ReadDataFromArchive(ArchiveHandle *AH, int compression,
 								ReadFunc readF);
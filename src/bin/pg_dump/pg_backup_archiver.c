@@ -30,6 +30,7 @@
 #include <io.h>
 #endif
 
+#include "compress_io.h"
 #include "dumputils.h"
 #include "fe_utils/string_utils.h"
 #include "libpq/libpq-fs.h"
@@ -56,7 +57,8 @@ typedef struct _outputContext
  * tes[] is sized large enough that we can't overrun it.
  * The valid entries are indexed first_te .. last_te inclusive.
  * We periodically sort the array to bring larger-by-dataLength entries to
- * the front; "sorted" is true if the valid entries are known sorted.
+ * the front (counting for TABLE DATA items the POST_DATA work waiting for
+ * them); "sorted" is true if the valid entries are known sorted.
  */
 typedef struct _parallelReadyList
 {
@@ -77,6 +79,7 @@ static char *sanitize_line(const char *str, bool want_hyphen);
 static void _doSetFixedOutputState(ArchiveHandle *AH);
 static void _doSetSessionAuth(ArchiveHandle *AH, const char *user);
 static void _reconnectToDB(ArchiveHandle *AH, const char *dbname);
+static void end_restore_txn(ArchiveHandle *AH);
 static void _becomeUser(ArchiveHandle *AH, const char *user);
 static void _becomeOwner(ArchiveHandle *AH, TocEntry *te);
 static void _selectOutputSchema(ArchiveHandle *AH, const char *schemaName);
@@ -375,8 +378,7 @@ RestoreArchive(Archive *AHX)
 	/*
 	 * Make sure we won't need (de)compression we haven't got
 	 */
-#ifndef HAVE_LIBZ
-	if (AH->compression != 0 && AH->PrintTocDataPtr != NULL)
+	if (!CompressionSupported(AH->compression) && AH->PrintTocDataPtr != NULL)
 	{
 		for (te = AH->toc->next; te != AH->toc; te = te->next)
 		{
@@ -384,7 +386,6 @@ RestoreArchive(Archive *AHX)
 				fatal("cannot restore from compressed archive (compression not supported in this installation)");
 		}
 	}
-#endif
 
 	/*
 	 * Prepare index arrays, so we can assume we have them throughout restore.
@@ -716,6 +717,8 @@ RestoreArchive(Archive *AHX)
 		}
 	}
 
+	end_restore_txn(AH);
+
 	if (ropt->single_txn)
 	{
 		if (AH->connection)
@@ -758,6 +761,24 @@ restore_toc_entry(ArchiveHandle *AH, TocEntry *te, bool is_parallel)
 
 	AH->currentTE = te;
 
+	/*
+	 * With --transaction-size, group the entries of a non-parallel restore
+	 * into transactions, saving a commit per object.  Parallel workers must
+	 * commit each entry, so that the entries depending on it can go ahead in
+	 * other sessions.  CREATE DATABASE can't run in a transaction block.
+	 */
+	if (ropt->txn_size > 0 && !is_parallel && AH->connection)
+	{
+		if (strcmp(te->desc, "DATABASE") == 0)
+			end_restore_txn(AH);
+		else if (!AH->txnActive)
+		{
+			StartTransaction(&AH->public);
+			AH->txnActive = true;
+			AH->txnCount = 0;
+		}
+	}
+
 	/* Dump any relevant dump warnings to stderr */
 	if (!ropt->suppressDumpWarnings && strcmp(te->desc, "WARNING") == 0)
 	{
@@ -840,6 +861,7 @@ restore_toc_entry(ArchiveHandle *AH, TocEntry *te, bool is_parallel)
 			/* Abandon struct, but keep its buffer until process exit. */
 
 			pg_log_info("connecting to new database \"%s\"", te->tag);
+			end_restore_txn(AH);
 			_reconnectToDB(AH, te->tag);
 			ropt->dbname = connstr.data;
 		}
@@ -896,9 +918,11 @@ restore_toc_entry(ArchiveHandle *AH, TocEntry *te, bool is_parallel)
 					 * precede it with a TRUNCATE.  If archiving is not on
 					 * this prevents WAL-logging the COPY.  This obtains a
 					 * speedup similar to that from using single_txn mode in
-					 * non-parallel restores.
+					 * non-parallel restores.  Not if the table's data was
+					 * dumped in chunks, though, as the TRUNCATE would wipe
+					 * out the chunks loaded concurrently.
 					 */
-					if (is_parallel && te->created)
+					if (is_parallel && te->created && !te->dataChunk)
 					{
 						/*
 						 * Parallel restore is always talking directly to a
@@ -939,7 +963,7 @@ restore_toc_entry(ArchiveHandle *AH, TocEntry *te, bool is_parallel)
 					AH->outputKind = OUTPUT_SQLCMDS;
 
 					/* close out the transaction started above */
-					if (is_parallel && te->created)
+					if (is_parallel && te->created && !te->dataChunk)
 						CommitTransaction(&AH->public);
 
 					_enableTriggersIfNecessary(AH, te);
@@ -957,6 +981,9 @@ restore_toc_entry(ArchiveHandle *AH, TocEntry *te, bool is_parallel)
 	if (AH->public.n_errors > 0 && status == WORKER_OK)
 		status = WORKER_IGNORED_ERRORS;
 
+	if (AH->txnActive && ++AH->txnCount >= ropt->txn_size)
+		end_restore_txn(AH);
+
 	return status;
 }
 
@@ -1107,6 +1134,7 @@ ArchiveEntry(Archive *AHX, CatalogId catalogId, DumpId dumpId,
 
 	newToc->formatData = NULL;
 	newToc->dataLength = 0;
+	newToc->postDataLength = 0;
 
 	if (AH->ArchiveEntryPtr != NULL)
 		AH->ArchiveEntryPtr(AH, newToc);
@@ -1256,7 +1284,7 @@ StartRestoreBlobs(ArchiveHandle *AH)
 {
 	RestoreOptions *ropt = AH->public.ropt;
 
-	if (!ropt->single_txn)
+	if (!ropt->single_txn && !AH->txnActive)
 	{
 		if (AH->connection)
 			StartTransaction(&AH->public);
@@ -1275,7 +1303,7 @@ EndRestoreBlobs(ArchiveHandle *AH)
 {
 	RestoreOptions *ropt = AH->public.ropt;
 
-	if (!ropt->single_txn)
+	if (!ropt->single_txn && !AH->txnActive)
 	{
 		if (AH->connection)
 			CommitTransaction(&AH->public);
@@ -1850,7 +1878,10 @@ buildTocEntryArrays(ArchiveHandle *AH)
 		 * tableDataId provides the TABLE DATA item's dump ID for each TABLE
 		 * TOC entry that has a DATA item.  We compute this by reversing the
 		 * TABLE DATA item's dependency, knowing that a TABLE DATA item has
-		 * just one dependency and it is the TABLE item.
+		 * just one dependency and it is the TABLE item.  If the data of the
+		 * table was dumped in chunks, there are several TABLE DATA items for
+		 * it; tableDataId points to the first, and the others are chained
+		 * from it through nextDataChunk.
 		 */
 		if (strcmp(te->desc, "TABLE DATA") == 0 && te->nDeps > 0)
 		{
@@ -1864,7 +1895,17 @@ buildTocEntryArrays(ArchiveHandle *AH)
 			if (tableId <= 0 || tableId > maxDumpId)
 				fatal("bad table dumpId for TABLE DATA item");
 
-			AH->tableDataId[tableId] = te->dumpId;
+			if (AH->tableDataId[tableId] != 0)
+			{
+				TocEntry   *first = AH->tocsByDumpId[AH->tableDataId[tableId]];
+
+				first->dataChunk = true;
+				te->dataChunk = true;
+				te->nextDataChunk = first->nextDataChunk;
+				first->nextDataChunk = te;
+			}
+			else
+				AH->tableDataId[tableId] = te->dumpId;
 		}
 	}
 }
@@ -2691,6 +2732,7 @@ ReadToc(ArchiveHandle *AH)
 			te->nDeps = 0;
 		}
 		te->dataLength = 0;
+		te->postDataLength = 0;
 
 		if (AH->ReadExtraTocPtr)
 			AH->ReadExtraTocPtr(AH, te);
@@ -3260,6 +3302,20 @@ _reconnectToDB(ArchiveHandle *AH, const char *dbname)
 	_doSetFixedOutputState(AH);
 }
 
+/*
+ * Commit the transaction that restore_toc_entry() opened for --transaction-size,
+ * if any.
+ */
+static void
+end_restore_txn(ArchiveHandle *AH)
+{
+	if (AH->txnActive)
+	{
+		CommitTransaction(&AH->public);
+		AH->txnActive = false;
+	}
+}
+
 /*
  * Become the specified user, and update state to avoid redundant commands
  *
@@ -3845,10 +3901,8 @@ ReadHead(ArchiveHandle *AH)
 	else
 		AH->compression = Z_DEFAULT_COMPRESSION;
 
-#ifndef HAVE_LIBZ
-	if (AH->compression != 0)
+	if (!CompressionSupported(AH->compression))
 		pg_log_warning("archive is compressed, but this installation does not support compression -- no data will be available");
-#endif
 
 	if (AH->version >= K_VERS_1_4)
 	{
@@ -4012,8 +4066,9 @@ restore_toc_entries_prefork(ArchiveHandle *AH, TocEntry *pending_list)
 	/*
 	 * Now close parent connection in prep for parallel steps.  We do this
 	 * mainly to ensure that we don't exceed the specified number of parallel
-	 * connections.
+	 * connections.  The workers must see what we restored, so commit first.
 	 */
+	end_restore_txn(AH);
 	DisconnectDatabase(&AH->public);
 
 	/* blow away any transient state from the old connection */
@@ -4323,11 +4378,17 @@ TocEntrySizeCompare(const void *p1, const void *p2)
 {
 	const TocEntry *te1 = *(const TocEntry *const *) p1;
 	const TocEntry *te2 = *(const TocEntry *const *) p2;
+	pgoff_t		len1 = te1->dataLength + te1->postDataLength;
+	pgoff_t		len2 = te2->dataLength + te2->postDataLength;
 
-	/* Sort by decreasing dataLength */
-	if (te1->dataLength > te2->dataLength)
+	/*
+	 * Sort by decreasing dataLength, including the work that can only start
+	 * after the item.  That way the load of a table with many indexes starts
+	 * early, and its index builds can overlap with loading the other tables.
+	 */
+	if (len1 > len2)
 		return -1;
-	if (te1->dataLength < te2->dataLength)
+	if (len1 < len2)
 		return 1;
 
 	/* For equal dataLengths, sort by dumpId, just to be stable */
@@ -4625,13 +4686,18 @@ fix_dependencies(ArchiveHandle *AH)
 
 /*
  * Change dependencies on table items to depend on table data items instead,
- * but only in POST_DATA items.
+ * but only in POST_DATA items.  If the table's data was dumped in chunks,
+ * the item is made to depend on all of them.
  *
  * Also, for any item having such dependency(s), set its dataLength to the
  * largest dataLength of the table data items it depends on.  This ensures
  * that parallel restore will prioritize larger jobs (index builds, FK
  * constraint checks, etc) over smaller ones, avoiding situations where we
  * end a restore with only one active job working on a large table.
+ *
+ * Conversely, add that dataLength to the postDataLength of each table data
+ * item it depends on, so that the tables with the most work queued behind
+ * their data are loaded first.
  */
 static void
 repoint_table_dependencies(ArchiveHandle *AH)
@@ -4652,13 +4718,38 @@ repoint_table_dependencies(ArchiveHandle *AH)
 			{
 				DumpId		tabledataid = AH->tableDataId[olddep];
 				TocEntry   *tabledatate = AH->tocsByDumpId[tabledataid];
+				TocEntry   *chunkte;
 
 				te->dependencies[i] = tabledataid;
 				te->dataLength = Max(te->dataLength, tabledatate->dataLength);
 				pg_log_debug("transferring dependency %d -> %d to %d",
 							 te->dumpId, olddep, tabledataid);
+
+				/*
+				 * Append the other chunks; when the loop reaches them, they
+				 * are left alone, being TABLE DATA items themselves.
+				 */
+				for (chunkte = tabledatate->nextDataChunk; chunkte != NULL;
+					 chunkte = chunkte->nextDataChunk)
+				{
+					te->dependencies = (DumpId *)
+						pg_realloc(te->dependencies,
+								   (te->nDeps + 1) * sizeof(DumpId));
+					te->dependencies[te->nDeps++] = chunkte->dumpId;
+					te->depCount++;
+					te->dataLength = Max(te->dataLength, chunkte->dataLength);
+				}
 			}
 		}
+
+		for (i = 0; i < te->nDeps; i++)
+		{
+			DumpId		depid = te->dependencies[i];
+
+			if (depid <= AH->maxDumpId && AH->tocsByDumpId[depid] != NULL &&
+				strcmp(AH->tocsByDumpId[depid]->desc, "TABLE DATA") == 0)
+				AH->tocsByDumpId[depid]->postDataLength += te->dataLength;
+		}
 	}
 }
 
@@ -4776,9 +4867,11 @@ mark_create_done(ArchiveHandle *AH, TocEntry *te)
 {
 	if (AH->tableDataId[te->dumpId] != 0)
 	{
-		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
+		TocEntry   *ted;
 
-		ted->created = true;
+		for (ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
+			 ted != NULL; ted = ted->nextDataChunk)
+			ted->created = true;
 	}
 }
 
@@ -4794,9 +4887,11 @@ inhibit_data_for_failed_table(ArchiveHandle *AH, TocEntry *te)
 
 	if (AH->tableDataId[te->dumpId] != 0)
 	{
-		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
+		TocEntry   *ted;
 
-		ted->reqs = 0;
+		for (ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
+			 ted != NULL; ted = ted->nextDataChunk)
+			ted->reqs = 0;
 	}
 }
 
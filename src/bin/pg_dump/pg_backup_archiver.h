@@ -93,10 +93,12 @@ typedef z_stream *z_streamp;
 #define K_VERS_1_13 MAKE_ARCHIVE_VERSION(1, 13, 0)	/* change search_path
 													 * behavior */
 #define K_VERS_1_14 MAKE_ARCHIVE_VERSION(1, 14, 0)	/* add tableam */
+#define K_VERS_1_15 MAKE_ARCHIVE_VERSION(1, 15, 0)	/* add LZ4 and zstd
+													 * compression */
 
 /* Current archive version number (the format we can output) */
 #define K_VERS_MAJOR 1
-#define K_VERS_MINOR 14
+#define K_VERS_MINOR 15
 #define K_VERS_REV 0
 #define K_VERS_SELF MAKE_ARCHIVE_VERSION(K_VERS_MAJOR, K_VERS_MINOR, K_VERS_REV)
 
@@ -319,6 +321,9 @@ struct _archiveHandle
 	int			writingBlob;	/* Flag */
 	int			blobCount;		/* # of blobs restored */
 
+	bool		txnActive;		/* in a --transaction-size transaction? */
+	int			txnCount;		/* # of TOC entries restored in it */
+
 	char	   *fSpec;			/* Archive File Spec */
 	FILE	   *FH;				/* General purpose file handle */
 	void	   *OF;
@@ -387,8 +392,12 @@ struct _tocEntry
 
 	/* working state while dumping/restoring */
 	pgoff_t		dataLength;		/* item's data size; 0 if none or unknown */
+	pgoff_t		postDataLength; /* estimated size of POST_DATA items waiting
+								 * for this item */
 	teReqs		reqs;			/* do we need schema and/or data of object */
 	bool		created;		/* set for DATA member if TABLE was created */
+	bool		dataChunk;		/* DATA member is one of several for TABLE */
+	struct _tocEntry *nextDataChunk;	/* next DATA member for same TABLE */
 
 	/* working state (needed only for parallel restore) */
 	struct _tocEntry *pending_prev; /* list links for pending-items list; */
@@ -7,7 +7,8 @@
  *	Large objects (BLOBs) are stored in separate files named "blob_<uid>.dat",
  *	and there's a plain-text TOC file for them called "blobs.toc". If
  *	compression is used, each data file is individually compressed and the
- *	".gz" suffix is added to the filenames. The TOC files are never
+ *	".gz", ".lz4" or ".zst" suffix is added to the filenames, depending on the
+ *	compression method. The TOC files are never
  *	compressed by pg_dump, however they are accepted with the .gz suffix too,
  *	in case the user has manually compressed them with 'gzip'.
  *
@@ -770,7 +771,9 @@ _PrepParallelRestore(ArchiveHandle *AH)
 		else
 		{
 			/* It might be compressed */
-			strlcat(fname, ".gz", sizeof(fname));
+			const char *suffix = CompressionSuffix(AH->compression);
+
+			strlcat(fname, suffix[0] != '\0' ? suffix : ".gz", sizeof(fname));
 			if (stat(fname, &st) == 0)
 				te->dataLength = st.st_size;
 		}
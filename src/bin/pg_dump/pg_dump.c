@@ -53,6 +53,8 @@
 #include "catalog/pg_trigger_d.h"
 #include "catalog/pg_type_d.h"
 #include "common/connect.h"
+#include "common/stream_compression.h"
+#include "compress_io.h"
 #include "dumputils.h"
 #include "fe_utils/string_utils.h"
 #include "getopt_long.h"
@@ -159,6 +161,8 @@ static void expand_table_name_patterns(Archive *fout,
 									   bool strict_names);
 static NamespaceInfo *findNamespace(Archive *fout, Oid nsoid);
 static void dumpTableData(Archive *fout, TableDataInfo *tdinfo);
+static int	getTableDataChunks(Archive *fout, TableDataInfo *tdinfo,
+							   TableDataInfo **chunks);
 static void refreshMatViewData(Archive *fout, TableDataInfo *tdinfo);
 static void guessConstraintInheritance(TableInfo *tblinfo, int numTables);
 static void dumpComment(Archive *fout, const char *type, const char *name,
@@ -314,9 +318,12 @@ main(int argc, char **argv)
 	const char *dumpsnapshot = NULL;
 	char	   *use_role = NULL;
 	long		rowsPerInsert;
+	long		tableChunkSize;
 	int			numWorkers = 1;
 	trivalue	prompt_password = TRI_DEFAULT;
 	int			compressLevel = -1;
+	bool		compressLevelInvalid = false;
+	StreamCompressionMethod compressMethod = STREAM_COMPRESSION_GZIP;
 	int			plainText = 0;
 	ArchiveFormat archiveFormat = archUnknown;
 	ArchiveMode archiveMode;
@@ -381,12 +388,15 @@ main(int argc, char **argv)
 		{"no-publications", no_argument, &dopt.no_publications, 1},
 		{"no-security-labels", no_argument, &dopt.no_security_labels, 1},
 		{"no-synchronized-snapshots", no_argument, &dopt.no_synchronized_snapshots, 1},
+		{"no-toast-compression", no_argument, &dopt.no_toast_compression, 1},
 		{"no-unlogged-table-data", no_argument, &dopt.no_unlogged_table_data, 1},
 		{"no-subscriptions", no_argument, &dopt.no_subscriptions, 1},
 		{"no-sync", no_argument, NULL, 7},
 		{"on-conflict-do-nothing", no_argument, &dopt.do_nothing, 1},
 		{"rows-per-insert", required_argument, NULL, 10},
 		{"include-foreign-data", required_argument, NULL, 11},
+		{"table-chunk-size", required_argument, NULL, 12},
+		{"compression-method", required_argument, NULL, 13},
 
 		{NULL, 0, NULL, 0}
 	};
@@ -528,12 +538,10 @@ main(int argc, char **argv)
 				break;
 
 			case 'Z':			/* Compression Level */
+				/* range depends on --compression-method, checked below */
 				compressLevel = atoi(optarg);
-				if (compressLevel < 0 || compressLevel > 9)
-				{
-					pg_log_error("compression level must be in range 0..9");
-					exit_nicely(1);
-				}
+				if (compressLevel < 0)
+					compressLevelInvalid = true;
 				break;
 
 			case 0:
@@ -604,6 +612,29 @@ main(int argc, char **argv)
 										  optarg);
 				break;
 
+			case 12:			/* table chunk size */
+				errno = 0;
+				tableChunkSize = strtol(optarg, &endptr, 10);
+
+				if (endptr == optarg || *endptr != '\0' ||
+					tableChunkSize <= 0 || tableChunkSize > INT_MAX ||
+					errno == ERANGE)
+				{
+					pg_log_error("table-chunk-size must be in range %d..%d",
+								 1, INT_MAX);
+					exit_nicely(1);
+				}
+				dopt.table_chunk_size = (int) tableChunkSize;
+				break;
+
+			case 13:			/* compression method */
+				if (!parse_stream_compression_method(optarg, &compressMethod))
+				{
+					pg_log_error("invalid compression method \"%s\"", optarg);
+					exit_nicely(1);
+				}
+				break;
+
 			default:
 				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
 				exit_nicely(1);
@@ -674,22 +705,57 @@ main(int argc, char **argv)
 	if (archiveFormat == archNull)
 		plainText = 1;
 
-	/* Custom and directory formats are compressed by default, others not */
-	if (compressLevel == -1)
+	if (compressMethod == STREAM_COMPRESSION_LZ4 ||
+		compressMethod == STREAM_COMPRESSION_ZSTD)
 	{
+		int			maxLevel = (compressMethod == STREAM_COMPRESSION_LZ4) ? 12 : 22;
+
+		/* only the custom and directory formats compress with these */
+		if (archiveFormat != archCustom && archiveFormat != archDirectory)
+			fatal("compression method \"%s\" is only supported by the custom and directory formats",
+				  stream_compression_method_name(compressMethod));
+
+		if (!stream_compression_supported(compressMethod))
+			fatal("compression method \"%s\" is not supported by this build",
+				  stream_compression_method_name(compressMethod));
+
+		if (compressLevelInvalid || compressLevel > maxLevel)
+			fatal("compression level must be in range 0..%d for compression method \"%s\"",
+				  maxLevel, stream_compression_method_name(compressMethod));
+
+		/* -Z0 still means no compression; otherwise, 0 is the default level */
+		if (compressLevel != 0)
+			compressLevel = ((compressMethod == STREAM_COMPRESSION_LZ4) ?
+							 COMPRESSION_LZ4 : COMPRESSION_ZSTD) |
+				Max(compressLevel, 0);
+	}
+	else if (compressMethod == STREAM_COMPRESSION_NONE)
+		compressLevel = 0;
+	else
+	{
+		if (compressLevelInvalid || compressLevel > 9)
+		{
+			pg_log_error("compression level must be in range 0..9");
+			exit_nicely(1);
+		}
+
+		/* Custom and directory formats are compressed by default, others not */
+		if (compressLevel == -1)
+		{
 #ifdef HAVE_LIBZ
-		if (archiveFormat == archCustom || archiveFormat == archDirectory)
-			compressLevel = Z_DEFAULT_COMPRESSION;
-		else
+			if (archiveFormat == archCustom || archiveFormat == archDirectory)
+				compressLevel = Z_DEFAULT_COMPRESSION;
+			else
 #endif
-			compressLevel = 0;
-	}
+				compressLevel = 0;
+		}
 
 #ifndef HAVE_LIBZ
-	if (compressLevel != 0)
-		pg_log_warning("requested compression not available in this installation -- archive will be uncompressed");
-	compressLevel = 0;
+		if (compressLevel != 0)
+			pg_log_warning("requested compression not available in this installation -- archive will be uncompressed");
+		compressLevel = 0;
 #endif
+	}
 
 	/*
 	 * If emitting an archive format, we always want to emit a DATABASE item,
@@ -994,7 +1060,9 @@ help(const char *progname)
 	printf(_("  -j, --jobs=NUM               use this many parallel jobs to dump\n"));
 	printf(_("  -v, --verbose                verbose mode\n"));
 	printf(_("  -V, --version                output version information, then exit\n"));
-	printf(_("  -Z, --compress=0-9           compression level for compressed formats\n"));
+	printf(_("  -Z, --compress=0-22          compression level for compressed formats\n"));
+	printf(_("  --compression-method=METHOD  compression method: gzip (default), lz4, zstd,\n"
+			 "                               or none\n"));
 	printf(_("  --lock-wait-timeout=TIMEOUT  fail after waiting TIMEOUT for a table lock\n"));
 	printf(_("  --no-sync                    do not wait for changes to be written safely to disk\n"));
 	printf(_("  -?, --help                   show this help, then exit\n"));
@@ -1035,6 +1103,7 @@ help(const char *progname)
 	printf(_("  --no-subscriptions           do not dump subscriptions\n"));
 	printf(_("  --no-synchronized-snapshots  do not use synchronized snapshots in parallel jobs\n"));
 	printf(_("  --no-tablespaces             do not dump tablespace assignments\n"));
+	printf(_("  --no-toast-compression       do not dump TOAST compression methods\n"));
 	printf(_("  --no-unlogged-table-data     do not dump unlogged table data\n"));
 	printf(_("  --on-conflict-do-nothing     add ON CONFLICT DO NOTHING to INSERT commands\n"));
 	printf(_("  --quote-all-identifiers      quote all identifiers, even if not key words\n"));
@@ -1044,6 +1113,8 @@ help(const char *progname)
 	printf(_("  --snapshot=SNAPSHOT          use given snapshot for the dump\n"));
 	printf(_("  --strict-names               require table and/or schema include patterns to\n"
 			 "                               match at least one entity each\n"));
+	printf(_("  --table-chunk-size=MB        split data of larger tables into chunks of MB\n"
+			 "                               megabytes, to be dumped and restored in parallel\n"));
 	printf(_("  --use-set-session-authorization\n"
 			 "                               use SET SESSION AUTHORIZATION commands instead of\n"
 			 "                               ALTER OWNER commands to set ownership\n"));
@@ -2297,35 +2368,168 @@ dumpTableData(Archive *fout, TableDataInfo *tdinfo)
 	if (tdinfo->dobj.dump & DUMP_COMPONENT_DATA)
 	{
 		TocEntry   *te;
-
-		te = ArchiveEntry(fout, tdinfo->dobj.catId, tdinfo->dobj.dumpId,
-						  ARCHIVE_OPTS(.tag = tbinfo->dobj.name,
-									   .namespace = tbinfo->dobj.namespace->dobj.name,
-									   .owner = tbinfo->rolname,
-									   .description = "TABLE DATA",
-									   .section = SECTION_DATA,
-									   .copyStmt = copyStmt,
-									   .deps = &(tbinfo->dobj.dumpId),
-									   .nDeps = 1,
-									   .dumpFn = dumpFn,
-									   .dumpArg = tdinfo));
+		TableDataInfo *chunks;
+		int			nchunks;
+		int			i;
 
 		/*
-		 * Set the TocEntry's dataLength in case we are doing a parallel dump
-		 * and want to order dump jobs by table size.  We choose to measure
-		 * dataLength in table pages during dump, so no scaling is needed.
-		 * However, relpages is declared as "integer" in pg_class, and hence
-		 * also in TableInfo, but it's really BlockNumber a/k/a unsigned int.
-		 * Cast so that we get the right interpretation of table sizes
-		 * exceeding INT_MAX pages.
+		 * A large table may be split into chunks, each getting a TABLE DATA
+		 * item of its own, so that parallel dump and restore can work on
+		 * them at the same time.  The first chunk uses the dump ID of the
+		 * TableDataInfo; the others get new ones.
 		 */
-		te->dataLength = (BlockNumber) tbinfo->relpages;
+		nchunks = getTableDataChunks(fout, tdinfo, &chunks);
+		if (nchunks == 0)
+		{
+			nchunks = 1;
+			chunks = tdinfo;
+		}
+
+		for (i = 0; i < nchunks; i++)
+		{
+			te = ArchiveEntry(fout, tdinfo->dobj.catId,
+							  i == 0 ? tdinfo->dobj.dumpId : createDumpId(),
+							  ARCHIVE_OPTS(.tag = tbinfo->dobj.name,
+										   .namespace = tbinfo->dobj.namespace->dobj.name,
+										   .owner = tbinfo->rolname,
+										   .description = "TABLE DATA",
+										   .section = SECTION_DATA,
+										   .copyStmt = copyStmt,
+										   .deps = &(tbinfo->dobj.dumpId),
+										   .nDeps = 1,
+										   .dumpFn = dumpFn,
+										   .dumpArg = &chunks[i]));
+
+			/*
+			 * Set the TocEntry's dataLength in case we are doing a parallel
+			 * dump and want to order dump jobs by table size.  We choose to
+			 * measure dataLength in table pages during dump, so no scaling is
+			 * needed.  However, relpages is declared as "integer" in
+			 * pg_class, and hence also in TableInfo, but it's really
+			 * BlockNumber a/k/a unsigned int.  Cast so that we get the right
+			 * interpretation of table sizes exceeding INT_MAX pages.
+			 */
+			te->dataLength = (BlockNumber) tbinfo->relpages / nchunks;
+		}
 	}
 
 	destroyPQExpBuffer(copyBuf);
 	destroyPQExpBuffer(clistBuf);
 }
 
+/*
+ * getTableDataChunks -
+ *	  work out how to split the data of a table for --table-chunk-size
+ *
+ * Tables are split on ranges of their primary key, if it has a single
+ * column, taking the range boundaries from the histogram ANALYZE collected
+ * for that column so that the chunks get about the same number of rows.
+ * Returns the number of chunks, and sets *chunks to an array of copies of
+ * tdinfo whose filter conditions select the rows of each chunk.  Returns 0
+ * if the table is not to be split.
+ */
+static int
+getTableDataChunks(Archive *fout, TableDataInfo *tdinfo,
+				   TableDataInfo **chunks)
+{
+	DumpOptions *dopt = fout->dopt;
+	TableInfo  *tbinfo = tdinfo->tdtable;
+	BlockNumber relpages = (BlockNumber) tbinfo->relpages;
+	BlockNumber chunkpages;
+	PQExpBuffer q;
+	PGresult   *res;
+	int			ntups;
+	int			nchunks;
+	int			i;
+	char	   *colname;
+	const char *prevbound = NULL;
+
+	/* pg_index.indnkeyatts appeared in v11 */
+	if (dopt->table_chunk_size == 0 || fout->remoteVersion < 110000 ||
+		tbinfo->relkind != RELKIND_RELATION || tdinfo->filtercond != NULL)
+		return 0;
+
+	chunkpages = Max(((uint64) dopt->table_chunk_size * 1024 * 1024) / BLCKSZ, 1);
+	if (relpages <= chunkpages)
+		return 0;
+
+	q = createPQExpBuffer();
+	appendPQExpBufferStr(q,
+						 "SELECT a.attname, b.bound "
+						 "FROM pg_catalog.pg_index i "
+						 "JOIN pg_catalog.pg_attribute a "
+						 "ON (a.attrelid = i.indrelid AND a.attnum = i.indkey[0]) "
+						 "JOIN pg_catalog.pg_stats s "
+						 "ON (s.attname = a.attname AND NOT s.inherited "
+						 "AND s.schemaname = ");
+	appendStringLiteralAH(q, tbinfo->dobj.namespace->dobj.name, fout);
+	appendPQExpBufferStr(q, " AND s.tablename = ");
+	appendStringLiteralAH(q, tbinfo->dobj.name, fout);
+	appendPQExpBuffer(q,
+					  "), "
+					  "LATERAL pg_catalog.unnest(s.histogram_bounds::pg_catalog.text::pg_catalog.text[]) "
+					  "WITH ORDINALITY AS b(bound, n) "
+					  "WHERE i.indrelid = '%u'::pg_catalog.oid "
+					  "AND i.indisprimary AND i.indnkeyatts = 1 "
+					  "ORDER BY b.n",
+					  tbinfo->dobj.catId.oid);
+
+	res = ExecuteSqlQuery(fout, q->data, PGRES_TUPLES_OK);
+	ntups = PQntuples(res);
+
+	/*
+	 * Each chunk needs a boundary of its own, besides the first and last
+	 * histogram entries, which are the extremes of the sample.
+	 */
+	nchunks = Min((relpages + chunkpages - 1) / chunkpages, ntups - 1);
+	if (nchunks < 2)
+	{
+		PQclear(res);
+		destroyPQExpBuffer(q);
+		return 0;
+	}
+
+	pg_log_info("splitting contents of table \"%s.%s\" into %d chunks",
+				tbinfo->dobj.namespace->dobj.name, tbinfo->dobj.name,
+				nchunks);
+
+	colname = pg_strdup(fmtId(PQgetvalue(res, 0, 0)));
+	*chunks = (TableDataInfo *) pg_malloc(nchunks * sizeof(TableDataInfo));
+
+	for (i = 0; i < nchunks; i++)
+	{
+		const char *bound = NULL;
+
+		if (i < nchunks - 1)
+			bound = PQgetvalue(res, (int) ((int64) (i + 1) * (ntups - 1) / nchunks), 1);
+
+		resetPQExpBuffer(q);
+		appendPQExpBufferStr(q, "WHERE ");
+		if (prevbound)
+		{
+			appendPQExpBuffer(q, "%s >= ", colname);
+			appendStringLiteralAH(q, prevbound, fout);
+		}
+		if (prevbound && bound)
+			appendPQExpBufferStr(q, " AND ");
+		if (bound)
+		{
+			appendPQExpBuffer(q, "%s < ", colname);
+			appendStringLiteralAH(q, bound, fout);
+		}
+
+		(*chunks)[i] = *tdinfo;
+		(*chunks)[i].filtercond = pg_strdup(q->data);
+		prevbound = bound;
+	}
+
+	free(colname);
+	PQclear(res);
+	destroyPQExpBuffer(q);
+
+	return nchunks;
+}
+
 /*
  * refreshMatViewData -
  *	  load or refresh the contents of a single materialized view
@@ -4053,6 +4257,8 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 	int			i_tableoid;
 	int			i_oid;
 	int			i_pubname;
+	int			i_pubrattrs;
+	int			i_pubrelqual;
 	int			i,
 				j,
 				ntups;
@@ -4087,12 +4293,25 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 		resetPQExpBuffer(query);
 
 		/* Get the publication membership for the table. */
-		appendPQExpBuffer(query,
-						  "SELECT pr.tableoid, pr.oid, p.pubname "
-						  "FROM pg_publication_rel pr, pg_publication p "
-						  "WHERE pr.prrelid = '%u'"
-						  "  AND p.oid = pr.prpubid",
-						  tbinfo->dobj.catId.oid);
+		if (fout->remoteVersion >= 140000)
+			appendPQExpBuffer(query,
+							  "SELECT pr.tableoid, pr.oid, p.pubname, "
+							  "(SELECT pg_catalog.string_agg(pg_catalog.quote_ident(a.attname), ', ' ORDER BY a.attnum) "
+							  " FROM pg_catalog.pg_attribute a "
+							  " WHERE a.attrelid = pr.prrelid AND a.attnum = ANY(pr.prattrs)) AS pubrattrs, "
+							  "pg_catalog.pg_get_expr(pr.prqual, pr.prrelid) AS pubrelqual "
+							  "FROM pg_publication_rel pr, pg_publication p "
+							  "WHERE pr.prrelid = '%u'"
+							  "  AND p.oid = pr.prpubid",
+							  tbinfo->dobj.catId.oid);
+		else
+			appendPQExpBuffer(query,
+							  "SELECT pr.tableoid, pr.oid, p.pubname, "
+							  "NULL AS pubrattrs, NULL AS pubrelqual "
+							  "FROM pg_publication_rel pr, pg_publication p "
+							  "WHERE pr.prrelid = '%u'"
+							  "  AND p.oid = pr.prpubid",
+							  tbinfo->dobj.catId.oid);
 		res = ExecuteSqlQuery(fout, query->data, PGRES_TUPLES_OK);
 
 		ntups = PQntuples(res);
@@ -4109,6 +4328,8 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 		i_tableoid = PQfnumber(res, "tableoid");
 		i_oid = PQfnumber(res, "oid");
 		i_pubname = PQfnumber(res, "pubname");
+		i_pubrattrs = PQfnumber(res, "pubrattrs");
+		i_pubrelqual = PQfnumber(res, "pubrelqual");
 
 		pubrinfo = pg_malloc(ntups * sizeof(PublicationRelInfo));
 
@@ -4123,6 +4344,14 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 			pubrinfo[j].dobj.name = tbinfo->dobj.name;
 			pubrinfo[j].pubname = pg_strdup(PQgetvalue(res, j, i_pubname));
 			pubrinfo[j].pubtable = tbinfo;
+			if (PQgetisnull(res, j, i_pubrattrs))
+				pubrinfo[j].pubrattrs = NULL;
+			else
+				pubrinfo[j].pubrattrs = pg_strdup(PQgetvalue(res, j, i_pubrattrs));
+			if (PQgetisnull(res, j, i_pubrelqual))
+				pubrinfo[j].pubrelqual = NULL;
+			else
+				pubrinfo[j].pubrelqual = pg_strdup(PQgetvalue(res, j, i_pubrelqual));
 
 			/* Decide whether we want to dump it */
 			selectDumpablePublicationTable(&(pubrinfo[j].dobj), fout);
@@ -4152,8 +4381,13 @@ dumpPublicationTable(Archive *fout, PublicationRelInfo *pubrinfo)
 
 	appendPQExpBuffer(query, "ALTER PUBLICATION %s ADD TABLE ONLY",
 					  fmtId(pubrinfo->pubname));
-	appendPQExpBuffer(query, " %s;\n",
+	appendPQExpBuffer(query, " %s",
 					  fmtQualifiedDumpable(tbinfo));
+	if (pubrinfo->pubrattrs)
+		appendPQExpBuffer(query, " (%s)", pubrinfo->pubrattrs);
+	if (pubrinfo->pubrelqual)
+		appendPQExpBuffer(query, " WHERE (%s)", pubrinfo->pubrelqual);
+	appendPQExpBufferStr(query, ";\n");
 
 	/*
 	 * There is no point in creating drop query as the drop is done by table
@@ -8555,10 +8789,17 @@ getTableAttrs(Archive *fout, TableInfo *tblinfo, int numTables)
 
 		if (fout->remoteVersion >= 120000)
 			appendPQExpBufferStr(q,
-								 "a.attgenerated\n");
+								 "a.attgenerated,\n");
+		else
+			appendPQExpBufferStr(q,
+								 "'' AS attgenerated,\n");
+
+		if (fout->remoteVersion >= 140000)
+			appendPQExpBufferStr(q,
+								 "a.attcompression AS attcompression\n");
 		else
 			appendPQExpBufferStr(q,
-								 "'' AS attgenerated\n");
+								 "'' AS attcompression\n");
 
 		/* need left join here to not fail on dropped columns ... */
 		appendPQExpBuffer(q,
@@ -8582,6 +8823,7 @@ getTableAttrs(Archive *fout, TableInfo *tblinfo, int numTables)
 		tbinfo->typstorage = (char *) pg_malloc(ntups * sizeof(char));
 		tbinfo->attidentity = (char *) pg_malloc(ntups * sizeof(char));
 		tbinfo->attgenerated = (char *) pg_malloc(ntups * sizeof(char));
+		tbinfo->attcompression = (char *) pg_malloc(ntups * sizeof(char));
 		tbinfo->attisdropped = (bool *) pg_malloc(ntups * sizeof(bool));
 		tbinfo->attlen = (int *) pg_malloc(ntups * sizeof(int));
 		tbinfo->attalign = (char *) pg_malloc(ntups * sizeof(char));
@@ -8608,6 +8850,7 @@ getTableAttrs(Archive *fout, TableInfo *tblinfo, int numTables)
 			tbinfo->typstorage[j] = *(PQgetvalue(res, j, PQfnumber(res, "typstorage")));
 			tbinfo->attidentity[j] = *(PQgetvalue(res, j, PQfnumber(res, "attidentity")));
 			tbinfo->attgenerated[j] = *(PQgetvalue(res, j, PQfnumber(res, "attgenerated")));
+			tbinfo->attcompression[j] = *(PQgetvalue(res, j, PQfnumber(res, "attcompression")));
 			tbinfo->needs_override = tbinfo->needs_override || (tbinfo->attidentity[j] == ATTRIBUTE_IDENTITY_ALWAYS);
 			tbinfo->attisdropped[j] = (PQgetvalue(res, j, PQfnumber(res, "attisdropped"))[0] == 't');
 			tbinfo->attlen[j] = atoi(PQgetvalue(res, j, PQfnumber(res, "attlen")));
@@ -16139,6 +16382,33 @@ dumpTableSchema(Archive *fout, TableInfo *tbinfo)
 									  storage);
 			}
 
+			/*
+			 * Dump per-column compression, if it's been set.
+			 */
+			if (!dopt->no_toast_compression)
+			{
+				const char *cmname;
+
+				switch (tbinfo->attcompression[j])
+				{
+					case 'p':
+						cmname = "pglz";
+						break;
+					case 'l':
+						cmname = "lz4";
+						break;
+					default:
+						cmname = NULL;
+						break;
+				}
+
+				if (cmname != NULL)
+					appendPQExpBuffer(q, "ALTER %sTABLE ONLY %s ALTER COLUMN %s SET COMPRESSION %s;\n",
+									  foreign, qualrelname,
+									  fmtId(tbinfo->attnames[j]),
+									  cmname);
+			}
+
 			/*
 			 * Dump per-column attributes.
 			 */
@@ -309,6 +309,7 @@ typedef struct _tableInfo
 	bool	   *attisdropped;	/* true if attr is dropped; don't dump it */
 	char	   *attidentity;
 	char	   *attgenerated;
+	char	   *attcompression; /* per-attribute compression method */
 	int		   *attlen;			/* attribute length, used by binary_upgrade */
 	char	   *attalign;		/* attribute align, used by binary_upgrade */
 	bool	   *attislocal;		/* true if attr has local definition */
@@ -614,6 +615,8 @@ typedef struct _PublicationRelInfo
 	DumpableObject dobj;
 	TableInfo  *pubtable;
 	char	   *pubname;
+	char	   *pubrattrs;		/* column list, or NULL if all columns */
+	char	   *pubrelqual;		/* row filter, or NULL if all rows */
 } PublicationRelInfo;
 
 /*
@@ -114,6 +114,7 @@ main(int argc, char **argv)
 		{"no-tablespaces", no_argument, &outputNoTablespaces, 1},
 		{"role", required_argument, NULL, 2},
 		{"section", required_argument, NULL, 3},
+		{"transaction-size", required_argument, NULL, 4},
 		{"strict-names", no_argument, &strict_names, 1},
 		{"use-set-session-authorization", no_argument, &use_setsessauth, 1},
 		{"no-comments", no_argument, &no_comments, 1},
@@ -280,6 +281,16 @@ main(int argc, char **argv)
 				set_dump_section(optarg, &(opts->dumpSections));
 				break;
 
+			case 4:				/* commit every N TOC entries */
+				opts->txn_size = atoi(optarg);
+				if (opts->txn_size <= 0)
+				{
+					pg_log_error("transaction size must be greater than zero");
+					exit_nicely(1);
+				}
+				opts->exit_on_error = true;
+				break;
+
 			default:
 				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
 				exit_nicely(1);
@@ -360,6 +371,12 @@ main(int argc, char **argv)
 	}
 #endif
 
+	if (opts->single_txn && opts->txn_size > 0)
+	{
+		pg_log_error("options -1/--single-transaction and --transaction-size cannot be used together");
+		exit_nicely(1);
+	}
+
 	/* Can't do single-txn mode with multiple connections */
 	if (opts->single_txn && numWorkers > 1)
 	{
@@ -503,6 +520,7 @@ usage(const char *progname)
 	printf(_("  --section=SECTION            restore named section (pre-data, data, or post-data)\n"));
 	printf(_("  --strict-names               require table and/or schema include patterns to\n"
 			 "                               match at least one entity each\n"));
+	printf(_("  --transaction-size=N         commit after every N objects\n"));
 	printf(_("  --use-set-session-authorization\n"
 			 "                               use SET SESSION AUTHORIZATION commands instead of\n"
 			 "                               ALTER OWNER commands to set ownership\n"));
@@ -342,6 +342,47 @@ my %pgdump_runs = (
 		],
 	},);
 
+# Add a custom and a directory format run for each compression method,
+# checked against the same set of tests as the defaults.  Methods that
+# depend on a library this build was configured without are skipped.
+my %compression_methods = (
+	gzip => check_pg_config("#define HAVE_LIBZ 1"),
+	lz4  => check_pg_config("#define USE_LZ4 1"),
+	zstd => check_pg_config("#define USE_ZSTD 1"),);
+
+foreach my $method (sort keys %compression_methods)
+{
+	next if !$compression_methods{$method};
+
+	$pgdump_runs{"compression_${method}_custom"} = {
+		test_key => 'defaults',
+		dump_cmd => [
+			'pg_dump', '-Fc', "--compression-method=$method",
+			"--file=$tempdir/compression_${method}_custom.dump",
+			'--no-sync', 'postgres',
+		],
+		restore_cmd => [
+			'pg_restore', '-Fc',
+			"--file=$tempdir/compression_${method}_custom.sql",
+			"$tempdir/compression_${method}_custom.dump",
+		],
+	};
+
+	$pgdump_runs{"compression_${method}_dir"} = {
+		test_key => 'defaults',
+		dump_cmd => [
+			'pg_dump', '-Fd', "--compression-method=$method",
+			"--file=$tempdir/compression_${method}_dir",
+			'--no-sync', 'postgres',
+		],
+		restore_cmd => [
+			'pg_restore', '-Fd',
+			"--file=$tempdir/compression_${method}_dir.sql",
+			"$tempdir/compression_${method}_dir",
+		],
+	};
+}
+
 ###############################################################
 # Definition of the tests to run.
 #
@@ -3332,8 +3373,9 @@ if ($collation_check_stderr !~ /ERROR: /)
 $node->psql('postgres', 'create database regress_pg_dump_test;');
 
 # Start with number of command_fails_like()*2 tests below (each
-# command_fails_like is actually 2 tests)
-my $num_tests = 12;
+# command_fails_like is actually 2 tests), plus the --table-chunk-size tests
+# at the end
+my $num_tests = 12 + 6;
 
 foreach my $run (sort keys %pgdump_runs)
 {
@@ -3567,6 +3609,52 @@ foreach my $run (sort keys %pgdump_runs)
 	}
 }
 
+#########################################
+# Test --table-chunk-size: dump a table larger than a chunk in parallel,
+# restore it in parallel into another database, and check that every row
+# arrived exactly once.
+
+$node->safe_psql('postgres',
+	'create database regress_pg_dump_chunks; create database regress_pg_restore_chunks;'
+);
+$node->safe_psql(
+	'regress_pg_dump_chunks', q{
+create table big (a int primary key, b text);
+insert into big select g, repeat(md5(g::text), 3) from generate_series(1, 20000) g;
+analyze big;
+});
+
+$node->command_checks_all(
+	[
+		'pg_dump',                  '-Fd',
+		"--file=$tempdir/chunks",   '--jobs=2',
+		'--table-chunk-size=1',     '--verbose',
+		'--no-sync',                'regress_pg_dump_chunks',
+	],
+	0,
+	[qr/^$/],
+	[qr/splitting contents of table "public.big" into \d+ chunks/],
+	'table-chunk-size: pg_dump splits the table');
+
+my ($toc, $toc_stderr) =
+  run_command([ 'pg_restore', '--list', "$tempdir/chunks" ]);
+my $ndataitems = () = $toc =~ /TABLE DATA public big /g;
+cmp_ok($ndataitems, '>', 1,
+	'table-chunk-size: table data is in several archive items');
+
+$node->command_ok(
+	[
+		'pg_restore', '--jobs=2',
+		'--dbname=regress_pg_restore_chunks', "$tempdir/chunks",
+	],
+	'table-chunk-size: pg_restore runs');
+
+my $chunk_query =
+  q{select count(*), count(distinct a), md5(string_agg(a || b, ',' order by a)) from big};
+is( $node->safe_psql('regress_pg_restore_chunks', $chunk_query),
+	$node->safe_psql('regress_pg_dump_chunks',    $chunk_query),
+	'table-chunk-size: restored table has the same rows');
+
 #########################################
 # Stop the database instance, which will be removed at the end of the tests.
 
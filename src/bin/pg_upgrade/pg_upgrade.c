@@ -48,6 +48,14 @@
 #include "fe_utils/string_utils.h"
 #include "pg_upgrade.h"
 
+/*
+ * Number of objects pg_restore creates per transaction.  Committing each
+ * object separately dominates the restore time of schemas with very many
+ * objects, in particular large objects; but all locks are held until commit,
+ * and the lock table is shared by the concurrent restores.
+ */
+#define RESTORE_TRANSACTION_SIZE 1000
+
 static void prepare_new_cluster(void);
 static void prepare_new_globals(void);
 static void create_new_objects(void);
@@ -317,9 +325,24 @@ static void
 create_new_objects(void)
 {
 	int			dbnum;
+	bool		parallel_dbs;
+	int			txn_size;
 
 	prep_status("Restoring database schemas in the new cluster\n");
 
+	/*
+	 * With at least as many databases as jobs, restore several databases
+	 * concurrently.  Otherwise restore one database at a time, using
+	 * pg_restore's parallel mode, so that a cluster with one big database can
+	 * still use all jobs; there, only the leader batches objects into
+	 * transactions.  (The template1 database doesn't count, see below.)
+	 */
+	parallel_dbs = (user_opts.jobs <= 1 ||
+					old_cluster.dbarr.ndbs - 1 >= user_opts.jobs);
+	txn_size = RESTORE_TRANSACTION_SIZE;
+	if (parallel_dbs && user_opts.jobs > 1)
+		txn_size = Max(RESTORE_TRANSACTION_SIZE / user_opts.jobs, 1);
+
 	/*
 	 * We cannot process the template1 database concurrently with others,
 	 * because when it's transiently dropped, connection attempts would fail.
@@ -352,10 +375,12 @@ create_new_objects(void)
 				  true,
 				  true,
 				  "\"%s/pg_restore\" %s %s --exit-on-error --verbose "
+				  "--transaction-size=%d "
 				  "--dbname postgres \"%s\"",
 				  new_cluster.bindir,
 				  cluster_conn_opts(&new_cluster),
 				  create_opts,
+				  RESTORE_TRANSACTION_SIZE,
 				  sql_file_name);
 
 		break;					/* done once we've processed template1 */
@@ -386,14 +411,31 @@ create_new_objects(void)
 		else
 			create_opts = "--create";
 
-		parallel_exec_prog(log_file_name,
-						   NULL,
-						   "\"%s/pg_restore\" %s %s --exit-on-error --verbose "
-						   "--dbname template1 \"%s\"",
-						   new_cluster.bindir,
-						   cluster_conn_opts(&new_cluster),
-						   create_opts,
-						   sql_file_name);
+		if (parallel_dbs)
+			parallel_exec_prog(log_file_name,
+							   NULL,
+							   "\"%s/pg_restore\" %s %s --exit-on-error --verbose "
+							   "--transaction-size=%d "
+							   "--dbname template1 \"%s\"",
+							   new_cluster.bindir,
+							   cluster_conn_opts(&new_cluster),
+							   create_opts,
+							   txn_size,
+							   sql_file_name);
+		else
+			exec_prog(log_file_name,
+					  NULL,
+					  true,
+					  true,
+					  "\"%s/pg_restore\" %s %s --exit-on-error --verbose "
+					  "--transaction-size=%d --jobs=%d "
+					  "--dbname template1 \"%s\"",
+					  new_cluster.bindir,
+					  cluster_conn_opts(&new_cluster),
+					  create_opts,
+					  txn_size,
+					  user_opts.jobs,
+					  sql_file_name);
 	}
 
 	/* reap all children */
@@ -17,6 +17,14 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 
+/*
+ * Parallel verification uses threads, where pthreads are available.
+ */
+#if defined(ENABLE_THREAD_SAFETY) && !defined(WIN32)
+#include <pthread.h>
+#define USE_PARALLEL_VERIFY 1
+#endif
+
 #include "common/hashfn.h"
 #include "common/logging.h"
 #include "fe_utils/simple_list.h"
@@ -108,8 +116,39 @@ typedef struct verifier_context
 	SimpleStringList ignore_list;
 	bool		exit_on_error;
 	bool		saw_any_error;
+	int			jobs;
 } verifier_context;
 
+/*
+ * With --jobs, the checksum verification and WAL parsing are split into
+ * tasks like this, handed out to the worker threads in order.  Each task is
+ * either a file whose checksum is to be verified, or a WAL range to parse.
+ */
+typedef struct verify_task
+{
+	manifest_file *file;
+	manifest_wal_range *wal_range;
+} verify_task;
+
+#ifdef USE_PARALLEL_VERIFY
+/*
+ * State shared by the worker threads.
+ */
+typedef struct parallel_verify_state
+{
+	verifier_context *context;
+	char	   *pg_waldump_path;
+	char	   *wal_directory;
+	verify_task *tasks;
+	int			ntasks;
+	int			next_task;		/* protected by task_lock */
+	pthread_mutex_t task_lock;
+} parallel_verify_state;
+
+/* Serializes the reporting of errors by the worker threads. */
+static pthread_mutex_t report_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 static void parse_manifest_file(char *manifest_path,
 								manifest_files_hash **ht_p,
 								manifest_wal_range **first_wal_range_p);
@@ -139,6 +178,20 @@ static void parse_required_wal(verifier_context *context,
 							   char *pg_waldump_path,
 							   char *wal_directory,
 							   manifest_wal_range *first_wal_range);
+static void parse_wal_range(verifier_context *context,
+							char *pg_waldump_path, char *wal_directory,
+							manifest_wal_range *range);
+static bool needs_checksum_verification(verifier_context *context,
+										manifest_file *m);
+#ifdef USE_PARALLEL_VERIFY
+static void verify_backup_parallel(verifier_context *context,
+								   bool skip_checksums,
+								   char *pg_waldump_path,
+								   char *wal_directory,
+								   manifest_wal_range *first_wal_range);
+static void *verify_worker_main(void *arg);
+static int	compare_files_by_size(const void *a, const void *b);
+#endif
 
 static void report_backup_error(verifier_context *context,
 								const char *pg_restrict fmt,...)
@@ -160,6 +213,7 @@ main(int argc, char **argv)
 	static struct option long_options[] = {
 		{"exit-on-error", no_argument, NULL, 'e'},
 		{"ignore", required_argument, NULL, 'i'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"manifest-path", required_argument, NULL, 'm'},
 		{"no-parse-wal", no_argument, NULL, 'n'},
 		{"quiet", no_argument, NULL, 'q'},
@@ -183,6 +237,7 @@ main(int argc, char **argv)
 	progname = get_progname(argv[0]);
 
 	memset(&context, 0, sizeof(context));
+	context.jobs = 1;
 
 	if (argc > 1)
 	{
@@ -219,7 +274,7 @@ main(int argc, char **argv)
 	simple_string_list_append(&context.ignore_list, "recovery.signal");
 	simple_string_list_append(&context.ignore_list, "standby.signal");
 
-	while ((c = getopt_long(argc, argv, "ei:m:nqsw:", long_options, NULL)) != -1)
+	while ((c = getopt_long(argc, argv, "ei:j:m:nqsw:", long_options, NULL)) != -1)
 	{
 		switch (c)
 		{
@@ -234,6 +289,22 @@ main(int argc, char **argv)
 					simple_string_list_append(&context.ignore_list, arg);
 					break;
 				}
+			case 'j':
+				context.jobs = atoi(optarg);
+				if (context.jobs <= 0)
+				{
+					pg_log_fatal("invalid number of parallel jobs: \"%s\"",
+								 optarg);
+					exit(1);
+				}
+#ifndef USE_PARALLEL_VERIFY
+				if (context.jobs != 1)
+				{
+					pg_log_fatal("parallel verification is not supported on this platform; use -j1");
+					exit(1);
+				}
+#endif
+				break;
 			case 'm':
 				manifest_path = pstrdup(optarg);
 				canonicalize_path(manifest_path);
@@ -338,20 +409,33 @@ main(int argc, char **argv)
 	 */
 	report_extra_backup_files(&context);
 
+#ifdef USE_PARALLEL_VERIFY
 	/*
-	 * Now do the expensive work of verifying file checksums, unless we were
-	 * told to skip it.
+	 * With several jobs, the expensive work of verifying file checksums and
+	 * parsing WAL is done by worker threads, all at the same time.
 	 */
-	if (!skip_checksums)
-		verify_backup_checksums(&context);
+	if (context.jobs > 1)
+		verify_backup_parallel(&context, skip_checksums,
+							   no_parse_wal ? NULL : pg_waldump_path,
+							   wal_directory, first_wal_range);
+	else
+#endif
+	{
+		/*
+		 * Now do the expensive work of verifying file checksums, unless we
+		 * were told to skip it.
+		 */
+		if (!skip_checksums)
+			verify_backup_checksums(&context);
 
-	/*
-	 * Try to parse the required ranges of WAL records, unless we were told
-	 * not to do so.
-	 */
-	if (!no_parse_wal)
-		parse_required_wal(&context, pg_waldump_path,
-						   wal_directory, first_wal_range);
+		/*
+		 * Try to parse the required ranges of WAL records, unless we were
+		 * told not to do so.
+		 */
+		if (!no_parse_wal)
+			parse_required_wal(&context, pg_waldump_path,
+							   wal_directory, first_wal_range);
+	}
 
 	/*
 	 * If everything looks OK, tell the user this, unless we were asked to
@@ -683,8 +767,7 @@ verify_backup_checksums(verifier_context *context)
 	manifest_files_start_iterate(context->ht, &it);
 	while ((m = manifest_files_iterate(context->ht, &it)) != NULL)
 	{
-		if (m->matched && !m->bad && m->checksum_type != CHECKSUM_TYPE_NONE &&
-			!should_ignore_relpath(context, m->pathname))
+		if (needs_checksum_verification(context, m))
 		{
 			char	   *fullpath;
 
@@ -701,6 +784,16 @@ verify_backup_checksums(verifier_context *context)
 	}
 }
 
+/*
+ * Does the checksum of this hash table entry need to be verified?
+ */
+static bool
+needs_checksum_verification(verifier_context *context, manifest_file *m)
+{
+	return m->matched && !m->bad && m->checksum_type != CHECKSUM_TYPE_NONE &&
+		!should_ignore_relpath(context, m->pathname);
+}
+
 /*
  * Verify the checksum of a single file.
  */
@@ -791,23 +884,168 @@ parse_required_wal(verifier_context *context, char *pg_waldump_path,
 
 	while (this_wal_range != NULL)
 	{
-		char	   *pg_waldump_cmd;
-
-		pg_waldump_cmd = psprintf("\"%s\" --quiet --path=\"%s\" --timeline=%u --start=%X/%X --end=%X/%X\n",
-								  pg_waldump_path, wal_directory, this_wal_range->tli,
-								  (uint32) (this_wal_range->start_lsn >> 32),
-								  (uint32) this_wal_range->start_lsn,
-								  (uint32) (this_wal_range->end_lsn >> 32),
-								  (uint32) this_wal_range->end_lsn);
-		if (system(pg_waldump_cmd) != 0)
-			report_backup_error(context,
-								"WAL parsing failed for timeline %u",
-								this_wal_range->tli);
-
+		parse_wal_range(context, pg_waldump_path, wal_directory,
+						this_wal_range);
 		this_wal_range = this_wal_range->next;
 	}
 }
 
+/*
+ * Parse one range of WAL records using pg_waldump.
+ */
+static void
+parse_wal_range(verifier_context *context, char *pg_waldump_path,
+				char *wal_directory, manifest_wal_range *range)
+{
+	char	   *pg_waldump_cmd;
+
+	pg_waldump_cmd = psprintf("\"%s\" --quiet --path=\"%s\" --timeline=%u --start=%X/%X --end=%X/%X\n",
+							  pg_waldump_path, wal_directory, range->tli,
+							  (uint32) (range->start_lsn >> 32),
+							  (uint32) range->start_lsn,
+							  (uint32) (range->end_lsn >> 32),
+							  (uint32) range->end_lsn);
+	if (system(pg_waldump_cmd) != 0)
+		report_backup_error(context,
+							"WAL parsing failed for timeline %u",
+							range->tli);
+	pfree(pg_waldump_cmd);
+}
+
+#ifdef USE_PARALLEL_VERIFY
+/*
+ * Verify file checksums and parse the required WAL using context->jobs
+ * worker threads.
+ *
+ * The WAL ranges are handed out first, so that pg_waldump runs alongside the
+ * checksum verification rather than after it.  The files follow, largest
+ * first, so that no worker is left with a big file at the very end.
+ * pg_waldump_path is NULL if WAL is not to be parsed.
+ */
+static void
+verify_backup_parallel(verifier_context *context, bool skip_checksums,
+					   char *pg_waldump_path, char *wal_directory,
+					   manifest_wal_range *first_wal_range)
+{
+	parallel_verify_state state;
+	pthread_t  *threads;
+	manifest_wal_range *range;
+	int			nranges = 0;
+	int			i;
+
+	if (pg_waldump_path != NULL)
+	{
+		for (range = first_wal_range; range != NULL; range = range->next)
+			nranges++;
+	}
+
+	state.context = context;
+	state.pg_waldump_path = pg_waldump_path;
+	state.wal_directory = wal_directory;
+	state.tasks = pg_malloc0(sizeof(verify_task) *
+							 (nranges + context->ht->members));
+	state.ntasks = 0;
+	state.next_task = 0;
+	pthread_mutex_init(&state.task_lock, NULL);
+
+	/* Build the list of tasks. */
+	if (pg_waldump_path != NULL)
+	{
+		for (range = first_wal_range; range != NULL; range = range->next)
+			state.tasks[state.ntasks++].wal_range = range;
+	}
+	if (!skip_checksums)
+	{
+		manifest_files_iterator it;
+		manifest_file *m;
+		int			nfiles = 0;
+		verify_task *files = &state.tasks[state.ntasks];
+
+		manifest_files_start_iterate(context->ht, &it);
+		while ((m = manifest_files_iterate(context->ht, &it)) != NULL)
+		{
+			if (needs_checksum_verification(context, m))
+				files[nfiles++].file = m;
+		}
+		qsort(files, nfiles, sizeof(verify_task), compare_files_by_size);
+		state.ntasks += nfiles;
+	}
+
+	/* Start the workers, and wait for them to run out of tasks. */
+	threads = pg_malloc(sizeof(pthread_t) * context->jobs);
+	for (i = 0; i < context->jobs; i++)
+	{
+		int			err = pthread_create(&threads[i], NULL,
+										 verify_worker_main, &state);
+
+		if (err != 0)
+			report_fatal_error("could not create thread: %s", strerror(err));
+	}
+	for (i = 0; i < context->jobs; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_mutex_destroy(&state.task_lock);
+	pg_free(threads);
+	pg_free(state.tasks);
+}
+
+/*
+ * Main loop of a worker thread: keep taking the next task off the list
+ * until there are none left.
+ */
+static void *
+verify_worker_main(void *arg)
+{
+	parallel_verify_state *state = arg;
+	verifier_context *context = state->context;
+
+	for (;;)
+	{
+		verify_task *task;
+
+		pthread_mutex_lock(&state->task_lock);
+		if (state->next_task >= state->ntasks)
+		{
+			pthread_mutex_unlock(&state->task_lock);
+			break;
+		}
+		task = &state->tasks[state->next_task++];
+		pthread_mutex_unlock(&state->task_lock);
+
+		if (task->wal_range != NULL)
+			parse_wal_range(context, state->pg_waldump_path,
+							state->wal_directory, task->wal_range);
+		else
+		{
+			char	   *fullpath;
+
+			fullpath = psprintf("%s/%s", context->backup_directory,
+								task->file->pathname);
+			verify_file_checksum(context, task->file, fullpath);
+			pfree(fullpath);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * qsort comparator for file tasks, sorting larger files first.
+ */
+static int
+compare_files_by_size(const void *a, const void *b)
+{
+	const manifest_file *fa = ((const verify_task *) a)->file;
+	const manifest_file *fb = ((const verify_task *) b)->file;
+
+	if (fa->size > fb->size)
+		return -1;
+	if (fa->size < fb->size)
+		return 1;
+	return strcmp(fa->pathname, fb->pathname);
+}
+#endif							/* USE_PARALLEL_VERIFY */
+
 /*
  * Report a problem with the backup.
  *
@@ -819,6 +1057,13 @@ report_backup_error(verifier_context *context, const char *pg_restrict fmt,...)
 {
 	va_list		ap;
 
+#ifdef USE_PARALLEL_VERIFY
+	int			save_errno = errno;
+
+	pthread_mutex_lock(&report_lock);
+	errno = save_errno;
+#endif
+
 	va_start(ap, fmt);
 	pg_log_generic_v(PG_LOG_ERROR, gettext(fmt), ap);
 	va_end(ap);
@@ -826,6 +1071,10 @@ report_backup_error(verifier_context *context, const char *pg_restrict fmt,...)
 	context->saw_any_error = true;
 	if (context->exit_on_error)
 		exit(1);
+
+#ifdef USE_PARALLEL_VERIFY
+	pthread_mutex_unlock(&report_lock);
+#endif
 }
 
 /*
@@ -892,6 +1141,7 @@ usage(void)
 	printf(_("Options:\n"));
 	printf(_("  -e, --exit-on-error         exit immediately on error\n"));
 	printf(_("  -i, --ignore=RELATIVE_PATH  ignore indicated path\n"));
+	printf(_("  -j, --jobs=NUM              use this many parallel jobs to verify\n"));
 	printf(_("  -m, --manifest-path=PATH    use specified path for manifest\n"));
 	printf(_("  -n, --no-parse-wal          do not try to parse WAL files\n"));
 	printf(_("  -q, --quiet                 do not print any output, except for errors\n"));
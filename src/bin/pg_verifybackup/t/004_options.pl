@@ -7,7 +7,7 @@ use Config;
 use File::Path qw(rmtree);
 use PostgresNode;
 use TestLib;
-use Test::More tests => 25;
+use Test::More tests => 27;
 
 # Start up the server and take a backup.
 my $primary = get_new_node('primary');
@@ -26,6 +26,18 @@ ok($result, "-q succeeds: exit code 0");
 is($stdout, '', "-q succeeds: no stdout");
 is($stderr, '', "-q succeeds: no stderr");
 
+# Verify that parallel verification succeeds too.
+SKIP:
+{
+	skip "parallel verification is not supported on Windows", 1
+	  if ($windows_os);
+
+	command_like(
+		[ 'pg_verifybackup', '-j', '4', $backup_path ],
+		qr/backup successfully verified/,
+		'-j succeeds');
+}
+
 # Corrupt the PG_VERSION file.
 my $version_pathname = "$backup_path/PG_VERSION";
 my $version_contents = slurp_file($version_pathname);
@@ -39,6 +51,18 @@ command_fails_like(
 	qr/checksum mismatch for file \"PG_VERSION\"/,
 	'-q checksum mismatch');
 
+# Parallel verification finds the problem as well.
+SKIP:
+{
+	skip "parallel verification is not supported on Windows", 1
+	  if ($windows_os);
+
+	command_fails_like(
+		[ 'pg_verifybackup', '-j', '4', $backup_path ],
+		qr/checksum mismatch for file \"PG_VERSION\"/,
+		'-j checksum mismatch');
+}
+
 # Since we didn't change the length of the file, verification should succeed
 # if we ignore checksums. Check that we get the right message, too.
 command_like(
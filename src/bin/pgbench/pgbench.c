@@ -64,6 +64,7 @@
 #include "getopt_long.h"
 #include "libpq-fe.h"
 #include "pgbench.h"
+#include "port/pg_bitutils.h"
 #include "portability/instr_time.h"
 
 #ifndef M_PI
@@ -208,6 +209,13 @@ static const char *PARTITION_METHOD[] = {"none", "range", "hash"};
 /* random seed used to initialize base_random_sequence */
 int64		random_seed = -1;
 
+/*
+ * Maximum number of SQL commands queued in a batch (between \startbatch and
+ * \endbatch) before a sync is forced and the pending results are collected.
+ * 0 is the default and means no limit.
+ */
+int			batch_depth = 0;
+
 /*
  * end of configurable parameters
  *********************************************************************/
@@ -237,6 +245,7 @@ int			nclients = 1;		/* number of clients */
 int			nthreads = 1;		/* number of threads */
 bool		is_connect;			/* establish connection for each transaction */
 bool		report_per_command; /* report per-command latencies */
+bool		latency_percentiles = false;	/* report latency percentiles */
 int			main_pid;			/* main process id used in log filename */
 
 char	   *pghost = "";
@@ -270,6 +279,20 @@ typedef struct
 #define MAX_SCRIPTS		128		/* max number of SQL scripts allowed */
 #define SHELL_COMMAND_SIZE	256 /* maximum size allowed for shell command */
 
+/*
+ * Latencies are also counted in a histogram, for percentiles.  Values, in
+ * microseconds, below LATENCY_HIST_SUB_BUCKETS get a bucket each; above, each
+ * power of two range is divided into LATENCY_HIST_SUB_BUCKETS / 2 buckets,
+ * bounding the error of a percentile to about 3%.  Values of
+ * 2^LATENCY_HIST_MAX_BITS microseconds (about 12 days) and above all go to
+ * the last bucket.
+ */
+#define LATENCY_HIST_SUB_BITS	6
+#define LATENCY_HIST_SUB_BUCKETS	(1 << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_MAX_BITS	40
+#define LATENCY_HIST_BUCKETS \
+	((LATENCY_HIST_MAX_BITS - LATENCY_HIST_SUB_BITS + 2) * (LATENCY_HIST_SUB_BUCKETS / 2))
+
 /*
  * Simple data structure to keep stats about something.
  *
@@ -283,6 +306,8 @@ typedef struct SimpleStats
 	double		max;			/* the maximum seen */
 	double		sum;			/* sum of values */
 	double		sum2;			/* sum of squared values */
+	int64		hist[LATENCY_HIST_BUCKETS]; /* histogram of values, if
+											 * latency_percentiles */
 } SimpleStats;
 
 /*
@@ -297,6 +322,7 @@ typedef struct StatsData
 								 * and --latency-limit */
 	SimpleStats latency;
 	SimpleStats lag;
+	SimpleStats batch;			/* latency of \startbatch ... \endbatch */
 } StatsData;
 
 /*
@@ -422,6 +448,10 @@ typedef struct
 	instr_time	txn_begin;		/* used for measuring schedule lag times */
 	instr_time	stmt_begin;		/* used for measuring statement latencies */
 
+	/* batch mode state */
+	instr_time	batch_begin;	/* used for measuring batch latencies */
+	int			batch_queued;	/* commands queued since the last sync */
+
 	bool		prepared[MAX_SCRIPTS];	/* whether client prepared the script */
 
 	/* per client collected stats */
@@ -484,7 +514,9 @@ typedef enum MetaCommand
 	META_IF,					/* \if */
 	META_ELIF,					/* \elif */
 	META_ELSE,					/* \else */
-	META_ENDIF					/* \endif */
+	META_ENDIF,					/* \endif */
+	META_STARTBATCH,			/* \startbatch */
+	META_ENDBATCH				/* \endbatch */
 } MetaCommand;
 
 typedef enum QueryMode
@@ -516,7 +548,7 @@ static const char *QUERYMODE[] = {"simple", "extended", "prepared"};
  *				variable name that receives the value.
  * aset			do gset on all possible queries of a combined query (\;).
  * expr			Parsed expression, if needed.
- * stats		Time spent in this command.
+ * stats		Time spent in this command, in microseconds.
  */
 typedef struct Command
 {
@@ -670,6 +702,8 @@ usage(void)
 		   "  -T, --time=NUM           duration of benchmark test in seconds\n"
 		   "  -v, --vacuum-all         vacuum all four standard tables before tests\n"
 		   "  --aggregate-interval=NUM aggregate data over NUM seconds\n"
+		   "  --batch-depth=NUM        sync a batch after NUM queued commands\n"
+		   "  --latency-percentiles    report latency percentiles\n"
 		   "  --log-prefix=PREFIX      prefix for transaction time log file\n"
 		   "                           (default: \"pgbench_log\")\n"
 		   "  --progress-timestamp     use Unix epoch timestamps for progress\n"
@@ -1070,6 +1104,43 @@ initSimpleStats(SimpleStats *ss)
 	memset(ss, 0, sizeof(SimpleStats));
 }
 
+/*
+ * Return the histogram bucket for a value, in microseconds.
+ */
+static int
+histBucket(double val)
+{
+	uint64		v;
+	int			e;
+
+	if (val < LATENCY_HIST_SUB_BUCKETS)
+		return (val > 0) ? (int) val : 0;
+	if (val >= (double) (UINT64CONST(1) << LATENCY_HIST_MAX_BITS))
+		return LATENCY_HIST_BUCKETS - 1;
+
+	v = (uint64) val;
+	e = pg_leftmost_one_pos64(v);
+	return (e - LATENCY_HIST_SUB_BITS + 1) * (LATENCY_HIST_SUB_BUCKETS / 2) +
+		(int) (v >> (e - LATENCY_HIST_SUB_BITS + 1));
+}
+
+/*
+ * Return the largest value, in microseconds, counted in a histogram bucket.
+ */
+static double
+histBucketValue(int bucket)
+{
+	int			shift;
+	uint64		sub;
+
+	if (bucket < LATENCY_HIST_SUB_BUCKETS)
+		return bucket;
+
+	shift = bucket / (LATENCY_HIST_SUB_BUCKETS / 2) - 1;
+	sub = bucket % (LATENCY_HIST_SUB_BUCKETS / 2) + LATENCY_HIST_SUB_BUCKETS / 2;
+	return (double) (((sub + 1) << shift) - 1);
+}
+
 /*
  * Accumulate one value into a SimpleStats struct.
  */
@@ -1083,6 +1154,8 @@ addToSimpleStats(SimpleStats *ss, double val)
 	ss->count++;
 	ss->sum += val;
 	ss->sum2 += val * val;
+	if (latency_percentiles)
+		ss->hist[histBucket(val)]++;
 }
 
 /*
@@ -1098,6 +1171,40 @@ mergeSimpleStats(SimpleStats *acc, SimpleStats *ss)
 	acc->count += ss->count;
 	acc->sum += ss->sum;
 	acc->sum2 += ss->sum2;
+	if (latency_percentiles)
+	{
+		for (int i = 0; i < LATENCY_HIST_BUCKETS; i++)
+			acc->hist[i] += ss->hist[i];
+	}
+}
+
+/*
+ * Return the given percentile, in microseconds, of the values accumulated in
+ * a SimpleStats struct since the earlier state "prev" (NULL to include all
+ * values).  This is the largest value counted in the histogram bucket the
+ * percentile falls into, so it overestimates by up to the bucket width.
+ */
+static double
+getPercentile(SimpleStats *ss, SimpleStats *prev, double percentile)
+{
+	int64		count = ss->count - (prev ? prev->count : 0);
+	int64		rank;
+	int64		seen = 0;
+
+	if (count <= 0)
+		return 0.0;
+
+	rank = (int64) ceil(percentile / 100.0 * count);
+	if (rank < 1)
+		rank = 1;
+
+	for (int i = 0; i < LATENCY_HIST_BUCKETS; i++)
+	{
+		seen += ss->hist[i] - (prev ? prev->hist[i] : 0);
+		if (seen >= rank)
+			return Min(histBucketValue(i), ss->max);
+	}
+	return ss->max;
 }
 
 /*
@@ -1112,6 +1219,7 @@ initStats(StatsData *sd, time_t start_time)
 	sd->skipped = 0;
 	initSimpleStats(&sd->latency);
 	initSimpleStats(&sd->lag);
+	initSimpleStats(&sd->batch);
 }
 
 /*
@@ -2494,6 +2602,10 @@ getMetaCommand(const char *cmd)
 		mc = META_GSET;
 	else if (pg_strcasecmp(cmd, "aset") == 0)
 		mc = META_ASET;
+	else if (pg_strcasecmp(cmd, "startbatch") == 0)
+		mc = META_STARTBATCH;
+	else if (pg_strcasecmp(cmd, "endbatch") == 0)
+		mc = META_ENDBATCH;
 	else
 		mc = META_NONE;
 	return mc;
@@ -2637,6 +2749,38 @@ chooseScript(TState *thread)
 	return i - 1;
 }
 
+/*
+ * Prepare all the SQL commands of the client's current script, if not done
+ * already.  This uses synchronous calls, so it must not be called while the
+ * connection is in batch mode.
+ */
+static void
+prepareCommands(CState *st)
+{
+	Command   **commands = sql_script[st->use_file].commands;
+
+	if (st->prepared[st->use_file])
+		return;
+
+	Assert(PQbatchStatus(st->con) == PQBATCH_MODE_OFF);
+
+	for (int j = 0; commands[j] != NULL; j++)
+	{
+		PGresult   *res;
+		char		name[MAX_PREPARE_NAME];
+
+		if (commands[j]->type != SQL_COMMAND)
+			continue;
+		preparedStatementName(name, st->use_file, j);
+		res = PQprepare(st->con, name,
+						commands[j]->argv[0], commands[j]->argc - 1, NULL);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			pg_log_error("%s", PQerrorMessage(st->con));
+		PQclear(res);
+	}
+	st->prepared[st->use_file] = true;
+}
+
 /* Send a SQL command, using the chosen querymode */
 static bool
 sendCommand(CState *st, Command *command)
@@ -2670,27 +2814,8 @@ sendCommand(CState *st, Command *command)
 		char		name[MAX_PREPARE_NAME];
 		const char *params[MAX_ARGS];
 
-		if (!st->prepared[st->use_file])
-		{
-			int			j;
-			Command   **commands = sql_script[st->use_file].commands;
-
-			for (j = 0; commands[j] != NULL; j++)
-			{
-				PGresult   *res;
-				char		name[MAX_PREPARE_NAME];
-
-				if (commands[j]->type != SQL_COMMAND)
-					continue;
-				preparedStatementName(name, st->use_file, j);
-				res = PQprepare(st->con, name,
-								commands[j]->argv[0], commands[j]->argc - 1, NULL);
-				if (PQresultStatus(res) != PGRES_COMMAND_OK)
-					pg_log_error("%s", PQerrorMessage(st->con));
-				PQclear(res);
-			}
-			st->prepared[st->use_file] = true;
-		}
+		/* in batch mode, this was already done by \startbatch */
+		prepareCommands(st);
 
 		getQueryParams(st, command, params);
 		preparedStatementName(name, st->use_file, st->command);
@@ -2836,6 +2961,74 @@ error:
 	return false;
 }
 
+/*
+ * Process the results of a batch of commands, after its sync was sent.
+ *
+ * Results are consumed as far as the input received so far allows.  Returns
+ * 1 once the end of the batch has been reached, 0 if more input is needed,
+ * and -1 if any command of the batch failed.  On failure, the remaining
+ * results of the batch are discarded before returning.
+ */
+static int
+readBatchResponse(CState *st)
+{
+	PGresult   *res;
+	bool		failed = false;
+
+	for (;;)
+	{
+		if (!failed && PQisBusy(st->con))
+			return 0;			/* don't have the whole result yet */
+
+		res = PQgetResult(st->con);
+		if (res == NULL)
+		{
+			/* current command is done, move on to the next one */
+			if (!PQbatchProcessQueue(st->con))
+			{
+				pg_log_error("client %d script %d command %d: batch ended without a sync result",
+							 st->id, st->use_file, st->command);
+				st->ecnt++;
+				return -1;
+			}
+			continue;
+		}
+
+		switch (PQresultStatus(res))
+		{
+			case PGRES_COMMAND_OK:
+			case PGRES_EMPTY_QUERY:
+			case PGRES_TUPLES_OK:
+				break;
+
+			case PGRES_BATCH_END:
+				PQclear(res);
+				st->batch_queued = 0;
+				if (failed)
+				{
+					st->ecnt++;
+					return -1;
+				}
+				return 1;
+
+			case PGRES_BATCH_ABORTED:
+				/* an earlier command of this batch failed, already reported */
+				Assert(failed);
+				break;
+
+			default:
+				/* anything else is unexpected */
+				pg_log_error("client %d script %d aborted in batch at command %d: %s",
+							 st->id, st->use_file, st->command,
+							 PQerrorMessage(st->con));
+				failed = true;
+				break;
+		}
+
+		PQclear(res);
+	}
+}
+
 /*
  * Parse the argument to a \sleep command, and return the requested amount
  * of delay, in microseconds.  Returns true on success, false on error.
@@ -3045,7 +3238,13 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 				/* Transition to script end processing if done */
 				if (command == NULL)
 				{
-					st->state = CSTATE_END_TX;
+					if (PQbatchStatus(st->con) != PQBATCH_MODE_OFF)
+					{
+						commandFailed(st, "batch", "end of script reached within a batch");
+						st->state = CSTATE_ABORTED;
+					}
+					else
+						st->state = CSTATE_END_TX;
 					break;
 				}
 
@@ -3059,13 +3258,36 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 				/* Execute the command */
 				if (command->type == SQL_COMMAND)
 				{
-					if (!sendCommand(st, command))
+					if (PQbatchStatus(st->con) != PQBATCH_MODE_OFF &&
+						command->varprefix != NULL)
+					{
+						commandFailed(st, "SQL", "\\gset and \\aset are not allowed in a batch");
+						st->state = CSTATE_ABORTED;
+					}
+					else if (!sendCommand(st, command))
 					{
 						commandFailed(st, "SQL", "SQL command send failed");
 						st->state = CSTATE_ABORTED;
 					}
-					else
+					else if (PQbatchStatus(st->con) == PQBATCH_MODE_OFF)
 						st->state = CSTATE_WAIT_RESULT;
+					else if (batch_depth > 0 &&
+							 ++st->batch_queued >= batch_depth)
+					{
+						/* queue is full, sync and wait for the results */
+						if (!PQbatchSendQueue(st->con))
+						{
+							commandFailed(st, "SQL", "batch sync failed");
+							st->state = CSTATE_ABORTED;
+						}
+						else
+							st->state = CSTATE_WAIT_RESULT;
+					}
+					else
+					{
+						/* results are collected when the batch is synced */
+						st->state = CSTATE_END_COMMAND;
+					}
 				}
 				else if (command->type == META_COMMAND)
 				{
@@ -3073,6 +3295,7 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 					 * Possible state changes when executing meta commands:
 					 * - on errors CSTATE_ABORTED
 					 * - on sleep CSTATE_SLEEP
+					 * - on \endbatch CSTATE_WAIT_RESULT
 					 * - else CSTATE_END_COMMAND
 					 */
 					st->state = executeMetaCommand(st, &now);
@@ -3198,6 +3421,40 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 					st->state = CSTATE_ABORTED;
 					break;
 				}
+
+				/* in a batch, collect all the results up to the sync */
+				if (PQbatchStatus(st->con) != PQBATCH_MODE_OFF)
+				{
+					int			rc = readBatchResponse(st);
+
+					if (rc == 0)
+						return; /* don't have the whole batch yet */
+					if (rc < 0)
+					{
+						st->state = CSTATE_ABORTED;
+						break;
+					}
+
+					command = sql_script[st->use_file].commands[st->command];
+					if (command->type == META_COMMAND &&
+						command->meta == META_ENDBATCH)
+					{
+						if (!PQexitBatchMode(st->con))
+						{
+							commandFailed(st, "endbatch", "could not exit batch mode");
+							st->state = CSTATE_ABORTED;
+							break;
+						}
+
+						INSTR_TIME_SET_CURRENT_LAZY(now);
+						addToSimpleStats(&thread->stats.batch,
+										 INSTR_TIME_GET_MICROSEC(now) -
+										 INSTR_TIME_GET_MICROSEC(st->batch_begin));
+					}
+					st->state = CSTATE_END_COMMAND;
+					break;
+				}
+
 				if (PQisBusy(st->con))
 					return;		/* don't have the whole result yet */
 
@@ -3243,8 +3500,8 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 					command = sql_script[st->use_file].commands[st->command];
 					/* XXX could use a mutex here, but we choose not to */
 					addToSimpleStats(&command->stats,
-									 INSTR_TIME_GET_DOUBLE(now) -
-									 INSTR_TIME_GET_DOUBLE(st->stmt_begin));
+									 (double) INSTR_TIME_GET_MICROSEC(now) -
+									 (double) INSTR_TIME_GET_MICROSEC(st->stmt_begin));
 				}
 
 				/* Go ahead with next command, to be executed or skipped */
@@ -3449,6 +3706,51 @@ executeMetaCommand(CState *st, instr_time *now)
 			return CSTATE_ABORTED;
 		}
 	}
+	else if (command->meta == META_STARTBATCH)
+	{
+		if (querymode == QUERY_SIMPLE)
+		{
+			commandFailed(st, "startbatch", "cannot use batch mode with the simple query protocol");
+			return CSTATE_ABORTED;
+		}
+
+		if (PQbatchStatus(st->con) != PQBATCH_MODE_OFF)
+		{
+			commandFailed(st, "startbatch", "already in batch mode");
+			return CSTATE_ABORTED;
+		}
+
+		/* statements cannot be prepared synchronously once in a batch */
+		if (querymode == QUERY_PREPARED)
+			prepareCommands(st);
+
+		if (!PQenterBatchMode(st->con))
+		{
+			commandFailed(st, "startbatch", "failed to enter batch mode");
+			return CSTATE_ABORTED;
+		}
+
+		st->batch_queued = 0;
+		INSTR_TIME_SET_CURRENT_LAZY(*now);
+		st->batch_begin = *now;
+	}
+	else if (command->meta == META_ENDBATCH)
+	{
+		if (PQbatchStatus(st->con) == PQBATCH_MODE_OFF)
+		{
+			commandFailed(st, "endbatch", "not in batch mode");
+			return CSTATE_ABORTED;
+		}
+
+		if (!PQbatchSendQueue(st->con))
+		{
+			commandFailed(st, "endbatch", "failed to send the batch");
+			return CSTATE_ABORTED;
+		}
+
+		/* collect the results; \endbatch is complete once they are all in */
+		return CSTATE_WAIT_RESULT;
+	}
 
 	/*
 	 * executing the expression or shell command might have taken a
@@ -3554,7 +3856,8 @@ processXactStats(TState *thread, CState *st, instr_time *now,
 {
 	double		latency = 0.0,
 				lag = 0.0;
-	bool		thread_details = progress || throttle_delay || latency_limit,
+	bool		thread_details = progress || throttle_delay || latency_limit ||
+		latency_percentiles,
 				detailed = thread_details || use_log || per_script_stats;
 
 	if (detailed && !skipped)
@@ -4677,7 +4980,9 @@ process_backslash_command(PsqlScanState sstate, const char *source)
 			syntax_error(source, lineno, my_command->first_line, my_command->argv[0],
 						 "missing command", NULL, -1);
 	}
-	else if (my_command->meta == META_ELSE || my_command->meta == META_ENDIF)
+	else if (my_command->meta == META_ELSE || my_command->meta == META_ENDIF ||
+			 my_command->meta == META_STARTBATCH ||
+			 my_command->meta == META_ENDBATCH)
 	{
 		if (my_command->argc != 1)
 			syntax_error(source, lineno, my_command->first_line, my_command->argv[0],
@@ -5120,6 +5425,7 @@ printProgressReport(TState *threads, int64 test_start, int64 now,
 	{
 		mergeSimpleStats(&cur.latency, &threads[i].stats.latency);
 		mergeSimpleStats(&cur.lag, &threads[i].stats.lag);
+		mergeSimpleStats(&cur.batch, &threads[i].stats.batch);
 		cur.cnt += threads[i].stats.cnt;
 		cur.skipped += threads[i].stats.skipped;
 	}
@@ -5163,6 +5469,13 @@ printProgressReport(TState *threads, int64 test_start, int64 now,
 			"progress: %s, %.1f tps, lat %.3f ms stddev %.3f",
 			tbuf, tps, latency, stdev);
 
+	if (latency_percentiles && ntx > 0)
+		fprintf(stderr, " p50 %.3f p99 %.3f p99.9 %.3f max %.3f",
+				0.001 * getPercentile(&cur.latency, &last->latency, 50.0),
+				0.001 * getPercentile(&cur.latency, &last->latency, 99.0),
+				0.001 * getPercentile(&cur.latency, &last->latency, 99.9),
+				0.001 * getPercentile(&cur.latency, &last->latency, 100.0));
+
 	if (throttle_delay)
 	{
 		fprintf(stderr, ", lag %.3f ms", lag);
@@ -5170,6 +5483,10 @@ printProgressReport(TState *threads, int64 test_start, int64 now,
 			fprintf(stderr, ", " INT64_FORMAT " skipped",
 					cur.skipped - last->skipped);
 	}
+	if (cur.batch.count > last->batch.count)
+		fprintf(stderr, ", batch lat %.3f ms",
+				0.001 * (cur.batch.sum - last->batch.sum) /
+				(cur.batch.count - last->batch.count));
 	fprintf(stderr, "\n");
 
 	*last = cur;
@@ -5186,6 +5503,13 @@ printSimpleStats(const char *prefix, SimpleStats *ss)
 
 		printf("%s average = %.3f ms\n", prefix, 0.001 * latency);
 		printf("%s stddev = %.3f ms\n", prefix, 0.001 * stddev);
+		if (latency_percentiles)
+			printf("%s percentiles: p50 = %.3f ms, p99 = %.3f ms, p99.9 = %.3f ms, max = %.3f ms\n",
+				   prefix,
+				   0.001 * getPercentile(ss, NULL, 50.0),
+				   0.001 * getPercentile(ss, NULL, 99.0),
+				   0.001 * getPercentile(ss, NULL, 99.9),
+				   0.001 * ss->max);
 	}
 }
 
@@ -5244,7 +5568,7 @@ printResults(StatsData *total, instr_time total_time,
 			   latency_limit / 1000.0, latency_late, ntx,
 			   (ntx > 0) ? 100.0 * latency_late / ntx : 0.0);
 
-	if (throttle_delay || progress || latency_limit)
+	if (throttle_delay || progress || latency_limit || latency_percentiles)
 		printSimpleStats("latency", &total->latency);
 	else
 	{
@@ -5265,6 +5589,13 @@ printResults(StatsData *total, instr_time total_time,
 			   0.001 * total->lag.sum / total->cnt, 0.001 * total->lag.max);
 	}
 
+	/* report batch latency, if any \startbatch ... \endbatch was run */
+	if (total->batch.count > 0)
+	{
+		printf("number of batches: " INT64_FORMAT "\n", total->batch.count);
+		printSimpleStats("batch latency", &total->batch);
+	}
+
 	printf("tps = %f (including connections establishing)\n", tps_include);
 	printf("tps = %f (excluding connections establishing)\n", tps_exclude);
 
@@ -5303,9 +5634,13 @@ printResults(StatsData *total, instr_time total_time,
 				Command   **commands;
 
 				if (per_script_stats)
-					printf(" - statement latencies in milliseconds:\n");
+					printf(" - statement latencies in milliseconds%s:\n",
+						   latency_percentiles ?
+						   " (average, p50, p99, p99.9, max)" : "");
 				else
-					printf("statement latencies in milliseconds:\n");
+					printf("statement latencies in milliseconds%s:\n",
+						   latency_percentiles ?
+						   " (average, p50, p99, p99.9, max)" : "");
 
 				for (commands = sql_script[i].commands;
 					 *commands != NULL;
@@ -5313,10 +5648,16 @@ printResults(StatsData *total, instr_time total_time,
 				{
 					SimpleStats *cstats = &(*commands)->stats;
 
-					printf("   %11.3f  %s\n",
+					printf("   %11.3f",
 						   (cstats->count > 0) ?
-						   1000.0 * cstats->sum / cstats->count : 0.0,
-						   (*commands)->first_line);
+						   0.001 * cstats->sum / cstats->count : 0.0);
+					if (latency_percentiles)
+						printf(" %11.3f %11.3f %11.3f %11.3f",
+							   0.001 * getPercentile(cstats, NULL, 50.0),
+							   0.001 * getPercentile(cstats, NULL, 99.0),
+							   0.001 * getPercentile(cstats, NULL, 99.9),
+							   0.001 * cstats->max);
+					printf("  %s\n", (*commands)->first_line);
 				}
 			}
 		}
@@ -5422,6 +5763,8 @@ main(int argc, char **argv)
 		{"show-script", required_argument, NULL, 10},
 		{"partitions", required_argument, NULL, 11},
 		{"partition-method", required_argument, NULL, 12},
+		{"batch-depth", required_argument, NULL, 13},
+		{"latency-percentiles", no_argument, NULL, 14},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -5795,6 +6138,19 @@ main(int argc, char **argv)
 					exit(1);
 				}
 				break;
+			case 13:			/* batch-depth */
+				benchmarking_option_set = true;
+				batch_depth = atoi(optarg);
+				if (batch_depth < 0)
+				{
+					pg_log_fatal("invalid batch depth: \"%s\"", optarg);
+					exit(1);
+				}
+				break;
+			case 14:			/* latency-percentiles */
+				benchmarking_option_set = true;
+				latency_percentiles = true;
+				break;
 			default:
 				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
 				exit(1);
@@ -6196,6 +6552,7 @@ main(int argc, char **argv)
 		/* aggregate thread level stats */
 		mergeSimpleStats(&stats.latency, &thread->stats.latency);
 		mergeSimpleStats(&stats.lag, &thread->stats.lag);
+		mergeSimpleStats(&stats.batch, &thread->stats.batch);
 		stats.cnt += thread->stats.cnt;
 		stats.skipped += thread->stats.skipped;
 		latency_late += thread->latency_late;
@@ -189,6 +189,20 @@ pgbench(
 	],
 	'pgbench select only');
 
+# Latency percentiles, overall and per statement
+pgbench(
+	'-t 100 -c 2 -b se -n -r --latency-percentiles',
+	0,
+	[
+		qr{processed: 200/200},
+		qr{latency average = \d+\.\d{3} ms},
+		qr{latency percentiles: p50 = \d+\.\d{3} ms, p99 = \d+\.\d{3} ms, p99\.9 = \d+\.\d{3} ms, max = \d+\.\d{3} ms},
+		qr{statement latencies in milliseconds \(average, p50, p99, p99\.9, max\):},
+		qr{^(\s+\d+\.\d{3}){5}\s+SELECT abalance}m
+	],
+	[qr{^$}],
+	'pgbench latency percentiles');
+
 # check if threads are supported
 my $nthreads = 2;
 
@@ -755,6 +769,52 @@ pgbench(
 }
 	});
 
+# working \startbatch
+pgbench(
+	'-t 10 -n -M extended', 0,
+	[ qr{type: .*/001_pgbench_batch}, qr{processed: 10/10}, qr{number of batches: 10\b}, qr{batch latency average} ],
+	[qr{^$}],
+	'pgbench batch',
+	{
+		'001_pgbench_batch' => q{
+-- test startbatch
+\startbatch
+} . "select 1;\n" x 10 . q{
+\endbatch
+}
+	});
+
+# batch synced every few commands with --batch-depth
+pgbench(
+	'-t 10 -n -M prepared --batch-depth=3', 0,
+	[ qr{type: .*/001_pgbench_batch_depth}, qr{processed: 10/10} ],
+	[qr{^$}],
+	'pgbench batch with batch depth',
+	{
+		'001_pgbench_batch_depth' => q{
+-- test startbatch with a depth limit
+\startbatch
+} . "select 1;\n" x 10 . q{
+\endbatch
+}
+	});
+
+# an error in a batch aborts the client
+pgbench(
+	'-t 1 -n -M extended', 2,
+	[ qr{type: .*/001_pgbench_batch_error}, qr{processed: 0/1} ],
+	[qr{aborted in batch at command}],
+	'pgbench batch with error',
+	{
+		'001_pgbench_batch_error' => q{
+\startbatch
+select 1;
+select 1/0;
+select 1;
+\endbatch
+}
+	});
+
 # trigger many expression errors
 my @errors = (
 
@@ -991,6 +1051,39 @@ SELECT LEAST(} . join(', ', (':i') x 256) . q{)}
 		2,
 		[qr{error storing into variable bad name!}],
 		q{SELECT 1 AS "bad name!" \gset}
+	],
+
+	# BATCH
+	[
+		'batch without endbatch',                        2,
+		[qr{end of script reached within a batch}], q{\startbatch
+SELECT 1;}
+	],
+	[
+		'endbatch without startbatch', 2,
+		[qr{not in batch mode}],       q{\endbatch}
+	],
+	[
+		'startbatch within batch', 2,
+		[qr{already in batch mode}], q{\startbatch
+\startbatch}
+	],
+	[
+		'gset in batch',                                    2,
+		[qr{gset and \\aset are not allowed in a batch}], q{\startbatch
+SELECT 1 AS i \gset
+\endbatch}
+	],
+	[
+		'batch simple protocol',
+		2,
+		[qr{cannot use batch mode with the simple query protocol}],
+		q{\startbatch
+\endbatch}, 1
+	],
+	[
+		'startbatch too many arguments', 1,
+		[qr{unexpected argument}],       q{\startbatch 1}
 	],);
 
 for my $e (@errors)
@@ -134,6 +134,10 @@ my @options = (
 	],
 	[ 'init vs run', '-i -S',    [qr{cannot be used in initialization}] ],
 	[ 'run vs init', '-S -F 90', [qr{cannot be used in benchmarking}] ],
+	[
+		'latency percentiles vs init', '-i --latency-percentiles',
+		[qr{cannot be used in initialization}]
+	],
 	[ 'ambiguous builtin', '-b s', [qr{ambiguous}] ],
 	[
 		'--progress-timestamp => --progress', '--progress-timestamp',
@@ -82,6 +82,7 @@ static backslashResult exec_command_else(PsqlScanState scan_state, ConditionalSt
 static backslashResult exec_command_endif(PsqlScanState scan_state, ConditionalStack cstack,
 										  PQExpBuffer query_buf);
 static backslashResult exec_command_encoding(PsqlScanState scan_state, bool active_branch);
+static backslashResult exec_command_endpipeline(PsqlScanState scan_state, bool active_branch);
 static backslashResult exec_command_errverbose(PsqlScanState scan_state, bool active_branch);
 static backslashResult exec_command_f(PsqlScanState scan_state, bool active_branch);
 static backslashResult exec_command_g(PsqlScanState scan_state, bool active_branch,
@@ -119,6 +120,7 @@ static backslashResult exec_command_setenv(PsqlScanState scan_state, bool active
 										   const char *cmd);
 static backslashResult exec_command_sf_sv(PsqlScanState scan_state, bool active_branch,
 										  const char *cmd, bool is_func);
+static backslashResult exec_command_startpipeline(PsqlScanState scan_state, bool active_branch);
 static backslashResult exec_command_t(PsqlScanState scan_state, bool active_branch);
 static backslashResult exec_command_T(PsqlScanState scan_state, bool active_branch);
 static backslashResult exec_command_timing(PsqlScanState scan_state, bool active_branch);
@@ -333,6 +335,8 @@ exec_command(const char *cmd,
 		status = exec_command_endif(scan_state, cstack, query_buf);
 	else if (strcmp(cmd, "encoding") == 0)
 		status = exec_command_encoding(scan_state, active_branch);
+	else if (strcmp(cmd, "endpipeline") == 0)
+		status = exec_command_endpipeline(scan_state, active_branch);
 	else if (strcmp(cmd, "errverbose") == 0)
 		status = exec_command_errverbose(scan_state, active_branch);
 	else if (strcmp(cmd, "f") == 0)
@@ -384,6 +388,8 @@ exec_command(const char *cmd,
 		status = exec_command_sf_sv(scan_state, active_branch, cmd, true);
 	else if (strcmp(cmd, "sv") == 0 || strcmp(cmd, "sv+") == 0)
 		status = exec_command_sf_sv(scan_state, active_branch, cmd, false);
+	else if (strcmp(cmd, "startpipeline") == 0)
+		status = exec_command_startpipeline(scan_state, active_branch);
 	else if (strcmp(cmd, "t") == 0)
 		status = exec_command_t(scan_state, active_branch);
 	else if (strcmp(cmd, "T") == 0)
@@ -1231,6 +1237,28 @@ exec_command_encoding(PsqlScanState scan_state, bool active_branch)
 	return PSQL_CMD_SKIP_LINE;
 }
 
+/*
+ * \endpipeline -- send pipelined queries and process their results
+ */
+static backslashResult
+exec_command_endpipeline(PsqlScanState scan_state, bool active_branch)
+{
+	bool		success = true;
+
+	if (active_branch)
+	{
+		if (!pset.db || PQbatchStatus(pset.db) == PQBATCH_MODE_OFF)
+		{
+			pg_log_error("\\endpipeline: not in pipeline mode");
+			success = false;
+		}
+		else
+			success = EndPipeline();
+	}
+
+	return success ? PSQL_CMD_SKIP_LINE : PSQL_CMD_ERROR;
+}
+
 /*
  * \errverbose -- display verbose message from last failed query
  */
@@ -2422,6 +2450,41 @@ exec_command_sf_sv(PsqlScanState scan_state, bool active_branch,
 	return status;
 }
 
+/*
+ * \startpipeline -- queue subsequent queries without waiting for results
+ */
+static backslashResult
+exec_command_startpipeline(PsqlScanState scan_state, bool active_branch)
+{
+	bool		success = true;
+
+	if (active_branch)
+	{
+		if (!pset.db)
+		{
+			pg_log_error("You are currently not connected to a database.");
+			success = false;
+		}
+		else if (PQbatchStatus(pset.db) != PQBATCH_MODE_OFF)
+		{
+			pg_log_error("\\startpipeline: already in pipeline mode");
+			success = false;
+		}
+		else if (!PQenterBatchMode(pset.db))
+		{
+			pg_log_info("%s", PQerrorMessage(pset.db));
+			success = false;
+		}
+		else
+		{
+			pset.pipeline_processed = 0;
+			pset.pipeline_busy = false;
+		}
+	}
+
+	return success ? PSQL_CMD_SKIP_LINE : PSQL_CMD_ERROR;
+}
+
 /*
  * \t -- turn off table headers and row count
  */
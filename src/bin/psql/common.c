@@ -31,6 +31,8 @@
 
 static bool DescribeQuery(const char *query, double *elapsed_msec);
 static bool ExecQueryUsingCursor(const char *query, double *elapsed_msec);
+static bool SendQueryInPipeline(const char *query);
+static bool ProcessPipelineResults(bool wait);
 static bool command_no_begin(const char *query);
 static bool is_select_command(const char *query);
 
@@ -1223,6 +1225,13 @@ SendQuery(const char *query)
 		fflush(pset.logfile);
 	}
 
+	/* In pipeline mode, just queue the query; see \startpipeline */
+	if (PQbatchStatus(pset.db) != PQBATCH_MODE_OFF)
+	{
+		OK = SendQueryInPipeline(query);
+		goto sendquery_cleanup;
+	}
+
 	SetCancelConn(pset.db);
 
 	transaction_status = PQtransactionStatus(pset.db);
@@ -1445,6 +1454,178 @@ sendquery_cleanup:
 }
 
 
+/*
+ * SendQueryInPipeline: queue a query while the connection is in pipeline mode
+ *
+ * The query is sent with the extended protocol and not waited for; its
+ * results are processed whenever they happen to be available, and at the
+ * latest by EndPipeline().  Autocommit, ON_ERROR_ROLLBACK, FETCH_COUNT and
+ * timing do not apply, and the \g variants that need the result at hand
+ * are rejected.
+ *
+ * Returns true if the query was queued and no error has been reported so
+ * far for the queries before it.
+ */
+static bool
+SendQueryInPipeline(const char *query)
+{
+	if (pset.gfname || pset.gsavepopt || pset.gset_prefix ||
+		pset.gdesc_flag || pset.gexec_flag || pset.crosstab_flag)
+	{
+		pg_log_error("query result options are not supported in pipeline mode");
+		return false;
+	}
+
+	if (!PQsendQueryParams(pset.db, query, 0, NULL, NULL, NULL, NULL, 0))
+	{
+		pg_log_info("%s", PQerrorMessage(pset.db));
+		CheckConnection();
+		return false;
+	}
+
+	/*
+	 * Collect whatever results have already arrived, so that the server is
+	 * not left blocked on sending them while we keep queuing queries.
+	 */
+	return ProcessPipelineResults(false);
+}
+
+
+/*
+ * ProcessPipelineResult: handle one result read in pipeline mode
+ *
+ * Returns true for a successful result, false for an error, including a
+ * query that was skipped because an earlier one in the pipeline failed.
+ */
+static bool
+ProcessPipelineResult(PGresult *result)
+{
+	bool		OK;
+
+	switch (PQresultStatus(result))
+	{
+		case PGRES_BATCH_END:
+			/* end of a pipeline synchronization point, nothing to show */
+			PQclear(result);
+			return true;
+
+		case PGRES_BATCH_ABORTED:
+			pset.pipeline_processed++;
+			pg_log_error("query %d of pipeline was skipped because of an earlier error",
+						 pset.pipeline_processed);
+			PQclear(result);
+			return false;
+
+		case PGRES_COPY_IN:
+		case PGRES_COPY_OUT:
+			pset.pipeline_processed++;
+			pg_log_error("COPY is not supported in pipeline mode");
+			PQclear(result);
+			return false;
+
+		default:
+			break;
+	}
+
+	pset.pipeline_processed++;
+	OK = AcceptResult(result);
+	if (OK)
+		OK = PrintQueryResults(result);
+	SetResultVariables(result, OK);
+	ClearOrSaveResult(result);
+
+	return OK;
+}
+
+
+/*
+ * ProcessPipelineResults: handle the results of queued queries, in order
+ *
+ * If wait is false, only results that can be read without blocking are
+ * handled.  Otherwise, we keep reading until every query queued so far,
+ * which must by then have been followed by a sync, has been processed.
+ *
+ * Returns true if all results handled were successful.
+ */
+static bool
+ProcessPipelineResults(bool wait)
+{
+	bool		OK = true;
+
+	for (;;)
+	{
+		PGresult   *result;
+
+		if (!pset.pipeline_busy)
+		{
+			/* move on to the next queued query, if there is one */
+			if (!PQbatchProcessQueue(pset.db))
+				break;
+			pset.pipeline_busy = true;
+		}
+
+		if (!wait)
+		{
+			if (!PQconsumeInput(pset.db))
+			{
+				pg_log_info("%s", PQerrorMessage(pset.db));
+				CheckConnection();
+				return false;
+			}
+			if (PQisBusy(pset.db))
+				break;
+		}
+
+		result = PQgetResult(pset.db);
+		if (result == NULL)
+		{
+			/* done with this query */
+			pset.pipeline_busy = false;
+			continue;
+		}
+
+		if (!ProcessPipelineResult(result))
+			OK = false;
+	}
+
+	return OK;
+}
+
+
+/*
+ * EndPipeline: send a sync for the queries queued since \startpipeline,
+ * process all of their results and leave pipeline mode
+ *
+ * Returns true if every query in the pipeline succeeded.
+ */
+bool
+EndPipeline(void)
+{
+	bool		OK;
+
+	if (!PQbatchSendQueue(pset.db))
+	{
+		pg_log_info("%s", PQerrorMessage(pset.db));
+		CheckConnection();
+		return false;
+	}
+
+	SetCancelConn(pset.db);
+	OK = ProcessPipelineResults(true);
+	ResetCancelConn();
+
+	if (!PQexitBatchMode(pset.db))
+	{
+		pg_log_info("%s", PQerrorMessage(pset.db));
+		OK = false;
+	}
+
+	PrintNotifications();
+
+	return OK;
+}
+
+
 /*
  * DescribeQuery: describe the result columns of a query, without executing it
  *
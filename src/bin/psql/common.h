@@ -32,6 +32,7 @@ extern PGresult *PSQLexec(const char *query);
 extern int	PSQLexecWatch(const char *query, const printQueryOpt *opt);
 
 extern bool SendQuery(const char *query);
+extern bool EndPipeline(void);
 
 extern bool is_superuser(void);
 extern bool standard_strings(void);
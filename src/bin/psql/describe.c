@@ -2834,19 +2834,41 @@ describeOneTableDetails(const char *schemaname,
 		}
 
 		/* print any publications */
-		if (pset.sversion >= 100000)
+		if (pset.sversion >= 140000)
+		{
+			printfPQExpBuffer(&buf,
+							  "SELECT pubname,\n"
+							  "       (SELECT pg_catalog.string_agg(pg_catalog.quote_ident(a.attname), ', ' ORDER BY a.attnum)\n"
+							  "        FROM pg_catalog.pg_attribute a\n"
+							  "        WHERE a.attrelid = pr.prrelid AND a.attnum = ANY(pr.prattrs)),\n"
+							  "       pg_catalog.pg_get_expr(pr.prqual, pr.prrelid)\n"
+							  "FROM pg_catalog.pg_publication p\n"
+							  "JOIN pg_catalog.pg_publication_rel pr ON p.oid = pr.prpubid\n"
+							  "WHERE pr.prrelid = '%s'\n"
+							  "UNION ALL\n"
+							  "SELECT pubname, NULL, NULL\n"
+							  "FROM pg_catalog.pg_publication p\n"
+							  "WHERE p.puballtables AND pg_catalog.pg_relation_is_publishable('%s')\n"
+							  "ORDER BY 1;",
+							  oid, oid);
+		}
+		else if (pset.sversion >= 100000)
 		{
 			printfPQExpBuffer(&buf,
-							  "SELECT pubname\n"
+							  "SELECT pubname, NULL, NULL\n"
 							  "FROM pg_catalog.pg_publication p\n"
 							  "JOIN pg_catalog.pg_publication_rel pr ON p.oid = pr.prpubid\n"
 							  "WHERE pr.prrelid = '%s'\n"
 							  "UNION ALL\n"
-							  "SELECT pubname\n"
+							  "SELECT pubname, NULL, NULL\n"
 							  "FROM pg_catalog.pg_publication p\n"
 							  "WHERE p.puballtables AND pg_catalog.pg_relation_is_publishable('%s')\n"
 							  "ORDER BY 1;",
 							  oid, oid);
+		}
+
+		if (pset.sversion >= 100000)
+		{
 
 			result = PSQLexec(buf.data);
 			if (!result)
@@ -2863,6 +2885,14 @@ describeOneTableDetails(const char *schemaname,
 				printfPQExpBuffer(&buf, "    \"%s\"",
 								  PQgetvalue(result, i, 0));
 
+				/* column list and row filter, if any */
+				if (!PQgetisnull(result, i, 1))
+					appendPQExpBuffer(&buf, " (%s)",
+									  PQgetvalue(result, i, 1));
+				if (!PQgetisnull(result, i, 2))
+					appendPQExpBuffer(&buf, " WHERE %s",
+									  PQgetvalue(result, i, 2));
+
 				printTableAddFooter(&cont, buf.data);
 			}
 			PQclear(result);
@@ -5903,8 +5933,18 @@ describePublications(const char *pattern)
 		if (!puballtables)
 		{
 			printfPQExpBuffer(&buf,
-							  "SELECT n.nspname, c.relname\n"
-							  "FROM pg_catalog.pg_class c,\n"
+							  "SELECT n.nspname, c.relname");
+			if (pset.sversion >= 140000)
+				appendPQExpBufferStr(&buf,
+									 ",\n"
+									 "       (SELECT pg_catalog.string_agg(pg_catalog.quote_ident(a.attname), ', ' ORDER BY a.attnum)\n"
+									 "        FROM pg_catalog.pg_attribute a\n"
+									 "        WHERE a.attrelid = c.oid AND a.attnum = ANY(pr.prattrs)),\n"
+									 "       pg_catalog.pg_get_expr(pr.prqual, c.oid)");
+			else
+				appendPQExpBufferStr(&buf, ", NULL, NULL");
+			appendPQExpBuffer(&buf,
+							  "\nFROM pg_catalog.pg_class c,\n"
 							  "     pg_catalog.pg_namespace n,\n"
 							  "     pg_catalog.pg_publication_rel pr\n"
 							  "WHERE c.relnamespace = n.oid\n"
@@ -5932,6 +5972,12 @@ describePublications(const char *pattern)
 				printfPQExpBuffer(&buf, "    \"%s.%s\"",
 								  PQgetvalue(tabres, j, 0),
 								  PQgetvalue(tabres, j, 1));
+				if (!PQgetisnull(tabres, j, 2))
+					appendPQExpBuffer(&buf, " (%s)",
+									  PQgetvalue(tabres, j, 2));
+				if (!PQgetisnull(tabres, j, 3))
+					appendPQExpBuffer(&buf, " WHERE %s",
+									  PQgetvalue(tabres, j, 3));
 
 				printTableAddFooter(&cont, buf.data);
 			}
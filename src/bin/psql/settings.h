@@ -99,6 +99,9 @@ typedef struct _psqlSettings
 	bool		crosstab_flag;	/* one-shot request to crosstab results */
 	char	   *ctv_args[4];	/* \crosstabview arguments */
 
+	int			pipeline_processed; /* # of pipelined queries handled so far */
+	bool		pipeline_busy;	/* currently reading a queued query's results */
+
 	bool		notty;			/* stdin or stdout is not a tty (as determined
 								 * on startup) */
 	enum trivalue getPassword;	/* prompt the user for a username and password */
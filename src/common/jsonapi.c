@@ -680,6 +680,7 @@ json_lex_string(JsonLexContext *lex)
 	char	   *s;
 	int			len;
 	int			hi_surrogate = -1;
+	char	   *end = lex->input + lex->input_length;
 
 	if (lex->strval != NULL)
 		resetStringInfo(lex->strval);
@@ -863,14 +864,28 @@ json_lex_string(JsonLexContext *lex)
 			}
 
 		}
-		else if (lex->strval != NULL)
+		else
 		{
+			char	   *p = s;
+
 			if (hi_surrogate != -1)
 				return JSON_UNICODE_LOW_SURROGATE;
 
-			appendStringInfoChar(lex->strval, *s);
-		}
+			/*
+			 * Skip to the next byte that needs special handling, so that we
+			 * copy whole runs of ordinary characters at once.
+			 */
+			while (p < end && *p != '\\' && *p != '"' &&
+				   (unsigned char) *p >= 32)
+				p++;
 
+			if (lex->strval != NULL)
+				appendBinaryStringInfo(lex->strval, s, p - s);
+
+			/* the loop increments s and len, so stop just short of p */
+			len += p - s - 1;
+			s = p - 1;
+		}
 	}
 
 	if (hi_surrogate != -1)
@@ -60,6 +60,18 @@
 
 #include "common/sha2.h"
 
+/*
+ * On x86-64, SHA-256 blocks are processed with the SHA extensions (SHA-NI)
+ * when the CPU has them.  As with our CRC code, the instructions are only
+ * enabled for the functions using them, and the implementation is picked at
+ * runtime by checking the CPU's features.
+ */
+#if defined(__x86_64__) && defined(__GNUC__) && defined(HAVE__GET_CPUID)
+#define USE_SHA_NI_WITH_RUNTIME_CHECK
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 /*
  * UNROLLED TRANSFORM LOOP NOTE:
  * You can define SHA2_UNROLL_TRANSFORM to use the unrolled transform
@@ -147,6 +159,8 @@
  */
 static void SHA512_Last(pg_sha512_ctx *context);
 static void SHA256_Transform(pg_sha256_ctx *context, const uint8 *data);
+static void SHA256_Transform_blocks(pg_sha256_ctx *context, const uint8 *data,
+									size_t nblocks);
 static void SHA512_Transform(pg_sha512_ctx *context, const uint8 *data);
 
 /*** SHA-XYZ INITIAL HASH VALUES AND CONSTANTS ************************/
@@ -461,6 +475,174 @@ SHA256_Transform(pg_sha256_ctx *context, const uint8 *data)
 }
 #endif							/* SHA2_UNROLL_TRANSFORM */
 
+/*
+ * Process 'nblocks' consecutive 64-byte blocks of input.  Handing over all
+ * complete blocks at once lets the SHA-NI variant keep the state in
+ * registers across them.
+ */
+static void
+SHA256_Transform_blocks_default(pg_sha256_ctx *context, const uint8 *data,
+								size_t nblocks)
+{
+	while (nblocks-- > 0)
+	{
+		SHA256_Transform(context, data);
+		data += PG_SHA256_BLOCK_LENGTH;
+	}
+}
+
+#ifdef USE_SHA_NI_WITH_RUNTIME_CHECK
+
+/*
+ * Four rounds using the message words in 'w' and the round constants
+ * starting at 'k'.  Each sha256rnds2 does two rounds, taking its two
+ * message+constant words from the low half of its third operand.
+ */
+#define SHA256_NI_ROUNDS4(w, k) \
+do { \
+	__m128i		wk = _mm_add_epi32((w), \
+								   _mm_loadu_si128((const __m128i *) (k))); \
+	state1 = _mm_sha256rnds2_epu32(state1, state0, wk); \
+	wk = _mm_shuffle_epi32(wk, 0x0E); \
+	state0 = _mm_sha256rnds2_epu32(state0, state1, wk); \
+} while (0)
+
+__attribute__((target("sha,sse4.1")))
+static void
+SHA256_Transform_blocks_sha_ni(pg_sha256_ctx *context, const uint8 *data,
+							   size_t nblocks)
+{
+	const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+										 0x0405060700010203ULL);
+	__m128i		state0,
+				state1,
+				tmp;
+
+	/*
+	 * The rounds instruction wants the working variables as ABEF and CDGH,
+	 * rather than the ABCD and EFGH in which we keep them.
+	 */
+	tmp = _mm_loadu_si128((const __m128i *) &context->state[0]);
+	state1 = _mm_loadu_si128((const __m128i *) &context->state[4]);
+	tmp = _mm_shuffle_epi32(tmp, 0xB1); /* CDAB */
+	state1 = _mm_shuffle_epi32(state1, 0x1B);	/* EFGH */
+	state0 = _mm_alignr_epi8(tmp, state1, 8);	/* ABEF */
+	state1 = _mm_blend_epi16(state1, tmp, 0xF0);	/* CDGH */
+
+	while (nblocks-- > 0)
+	{
+		__m128i		abef_save = state0;
+		__m128i		cdgh_save = state1;
+		__m128i		m0,
+					m1,
+					m2,
+					m3;
+		int			j;
+
+		/* Rounds 0 to 15 use the message words as they come */
+		m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 0)), bswap);
+		m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 16)), bswap);
+		m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 32)), bswap);
+		m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 48)), bswap);
+
+		SHA256_NI_ROUNDS4(m0, &K256[0]);
+		SHA256_NI_ROUNDS4(m1, &K256[4]);
+		SHA256_NI_ROUNDS4(m2, &K256[8]);
+		SHA256_NI_ROUNDS4(m3, &K256[12]);
+
+		/* The remaining rounds expand the message, four words at a time */
+		for (j = 16; j < 64; j += 4)
+		{
+			__m128i		w;
+
+			w = _mm_sha256msg1_epu32(m0, m1);
+			w = _mm_add_epi32(w, _mm_alignr_epi8(m3, m2, 4));
+			w = _mm_sha256msg2_epu32(w, m3);
+
+			SHA256_NI_ROUNDS4(w, &K256[j]);
+
+			m0 = m1;
+			m1 = m2;
+			m2 = m3;
+			m3 = w;
+		}
+
+		/* Compute the current intermediate hash value */
+		state0 = _mm_add_epi32(state0, abef_save);
+		state1 = _mm_add_epi32(state1, cdgh_save);
+
+		data += PG_SHA256_BLOCK_LENGTH;
+	}
+
+	/* Back to ABCD and EFGH */
+	tmp = _mm_shuffle_epi32(state0, 0x1B);	/* FEBA */
+	state1 = _mm_shuffle_epi32(state1, 0xB1);	/* DCHG */
+	state0 = _mm_blend_epi16(tmp, state1, 0xF0);	/* DCBA */
+	state1 = _mm_alignr_epi8(state1, tmp, 8);	/* ABEF */
+	_mm_storeu_si128((__m128i *) &context->state[0], state0);
+	_mm_storeu_si128((__m128i *) &context->state[4], state1);
+}
+
+/*
+ * Does the CPU support the SHA extensions, and SSE 4.1 used alongside them?
+ */
+static bool
+pg_sha256_sha_ni_available(void)
+{
+	unsigned int exx[4] = {0, 0, 0, 0};
+
+	if (__get_cpuid_max(0, NULL) < 7)
+		return false;
+
+	__get_cpuid(1, &exx[0], &exx[1], &exx[2], &exx[3]);
+	if ((exx[2] & (1 << 19)) == 0)	/* SSE 4.1 */
+		return false;
+
+	__cpuid_count(7, 0, exx[0], exx[1], exx[2], exx[3]);
+	return (exx[1] & (1 << 29)) != 0;	/* SHA */
+}
+
+static void SHA256_Transform_blocks_choose(pg_sha256_ctx *context,
+										   const uint8 *data, size_t nblocks);
+
+static void (*SHA256_Transform_blocks_impl) (pg_sha256_ctx *context,
+											 const uint8 *data, size_t nblocks) =
+SHA256_Transform_blocks_choose;
+
+/*
+ * This gets called on the first call.  It replaces the function pointer so
+ * that subsequent calls are routed directly to the chosen implementation.
+ */
+static void
+SHA256_Transform_blocks_choose(pg_sha256_ctx *context, const uint8 *data,
+							   size_t nblocks)
+{
+	if (pg_sha256_sha_ni_available())
+		SHA256_Transform_blocks_impl = SHA256_Transform_blocks_sha_ni;
+	else
+		SHA256_Transform_blocks_impl = SHA256_Transform_blocks_default;
+
+	SHA256_Transform_blocks_impl(context, data, nblocks);
+}
+
+static void
+SHA256_Transform_blocks(pg_sha256_ctx *context, const uint8 *data,
+						size_t nblocks)
+{
+	SHA256_Transform_blocks_impl(context, data, nblocks);
+}
+
+#else							/* !USE_SHA_NI_WITH_RUNTIME_CHECK */
+
+static void
+SHA256_Transform_blocks(pg_sha256_ctx *context, const uint8 *data,
+						size_t nblocks)
+{
+	SHA256_Transform_blocks_default(context, data, nblocks);
+}
+
+#endif							/* USE_SHA_NI_WITH_RUNTIME_CHECK */
+
 void
 pg_sha256_update(pg_sha256_ctx *context, const uint8 *data, size_t len)
 {
@@ -484,7 +666,7 @@ pg_sha256_update(pg_sha256_ctx *context, const uint8 *data, size_t len)
 			context->bitcount += freespace << 3;
 			len -= freespace;
 			data += freespace;
-			SHA256_Transform(context, context->buffer);
+			SHA256_Transform_blocks(context, context->buffer, 1);
 		}
 		else
 		{
@@ -496,13 +678,15 @@ pg_sha256_update(pg_sha256_ctx *context, const uint8 *data, size_t len)
 			return;
 		}
 	}
-	while (len >= PG_SHA256_BLOCK_LENGTH)
+	if (len >= PG_SHA256_BLOCK_LENGTH)
 	{
 		/* Process as many complete blocks as we can */
-		SHA256_Transform(context, data);
-		context->bitcount += PG_SHA256_BLOCK_LENGTH << 3;
-		len -= PG_SHA256_BLOCK_LENGTH;
-		data += PG_SHA256_BLOCK_LENGTH;
+		size_t		nblocks = len / PG_SHA256_BLOCK_LENGTH;
+
+		SHA256_Transform_blocks(context, data, nblocks);
+		context->bitcount += (uint64) nblocks * PG_SHA256_BLOCK_LENGTH << 3;
+		len -= nblocks * PG_SHA256_BLOCK_LENGTH;
+		data += nblocks * PG_SHA256_BLOCK_LENGTH;
 	}
 	if (len > 0)
 	{
@@ -541,7 +725,7 @@ SHA256_Last(pg_sha256_ctx *context)
 				memset(&context->buffer[usedspace], 0, PG_SHA256_BLOCK_LENGTH - usedspace);
 			}
 			/* Do second-to-last transform: */
-			SHA256_Transform(context, context->buffer);
+			SHA256_Transform_blocks(context, context->buffer, 1);
 
 			/* And set-up for the last transform: */
 			memset(context->buffer, 0, PG_SHA256_SHORT_BLOCK_LENGTH);
@@ -559,7 +743,7 @@ SHA256_Last(pg_sha256_ctx *context)
 	*(uint64 *) &context->buffer[PG_SHA256_SHORT_BLOCK_LENGTH] = context->bitcount;
 
 	/* Final transform: */
-	SHA256_Transform(context, context->buffer);
+	SHA256_Transform_blocks(context, context->buffer, 1);
 }
 
 void
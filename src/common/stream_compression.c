@@ -0,0 +1,517 @@
+/*-------------------------------------------------------------------------
+ *
+ * stream_compression.c
+ *	  Compression of protocol streams
+ *
+ * A compressor compresses a series of chunks of data, each of which can be
+ * decompressed as soon as it has been received, but the compression of a
+ * chunk makes use of the data in earlier chunks of the same stream.  That
+ * works much better for WAL than compressing each chunk on its own.  The
+ * decompressing side has to see every chunk, in order, and be told the
+ * uncompressed size of each.
+ *
+ * Portions Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/common/stream_compression.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef FRONTEND
+#include "postgres.h"
+#else
+#include "postgres_fe.h"
+#endif
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "common/stream_compression.h"
+
+/*
+ * In backend, we will use palloc/pfree.  In frontend, use malloc, and
+ * return NULL on out-of-memory, as libpq must not exit.
+ */
+#ifndef FRONTEND
+#define ALLOC(size) palloc(size)
+#define FREE(size) pfree(size)
+#else
+#define ALLOC(size) malloc(size)
+#define FREE(size) free(size)
+#endif
+
+/* LZ4 can refer back to at most this much earlier data */
+#define LZ4_DICT_SIZE	(64 * 1024)
+
+/*
+ * Upper limit of a zstd frame header, which the first flushed chunk of a
+ * stream carries on top of ZSTD_compressBound().  ZSTD_FRAMEHEADERSIZE_MAX
+ * is only exposed with ZSTD_STATIC_LINKING_ONLY, so keep our own copy.
+ */
+#define ZSTD_STREAM_HEADER_SIZE	18
+
+struct StreamCompressor
+{
+	StreamCompressionMethod method;
+	bool		decompress;
+
+#ifdef HAVE_LIBZ
+	z_stream	zs;
+#endif
+#ifdef USE_LZ4
+	LZ4_stream_t *lz4_stream;	/* compression only */
+	char	   *lz4_dict;		/* last data compressed or decompressed */
+	int			lz4_dictlen;
+#endif
+#ifdef USE_ZSTD
+	ZSTD_CCtx  *zstd_cctx;
+	ZSTD_DCtx  *zstd_dctx;
+#endif
+};
+
+static const struct
+{
+	const char *name;
+	StreamCompressionMethod method;
+}			stream_compression_methods[] =
+{
+	{"none", STREAM_COMPRESSION_NONE},
+	{"gzip", STREAM_COMPRESSION_GZIP},
+	{"lz4", STREAM_COMPRESSION_LZ4},
+	{"zstd", STREAM_COMPRESSION_ZSTD}
+};
+
+/*
+ * Look up a compression method by name.  Returns false if there's no such
+ * method; whether it's supported by this build is another matter.
+ */
+bool
+parse_stream_compression_method(const char *name,
+								StreamCompressionMethod *method)
+{
+	int			i;
+
+	for (i = 0; i < lengthof(stream_compression_methods); i++)
+	{
+		if (pg_strcasecmp(name, stream_compression_methods[i].name) == 0)
+		{
+			*method = stream_compression_methods[i].method;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const char *
+stream_compression_method_name(StreamCompressionMethod method)
+{
+	int			i;
+
+	for (i = 0; i < lengthof(stream_compression_methods); i++)
+	{
+		if (stream_compression_methods[i].method == method)
+			return stream_compression_methods[i].name;
+	}
+
+	return "???";
+}
+
+bool
+stream_compression_supported(StreamCompressionMethod method)
+{
+	switch (method)
+	{
+		case STREAM_COMPRESSION_NONE:
+			return true;
+		case STREAM_COMPRESSION_GZIP:
+#ifdef HAVE_LIBZ
+			return true;
+#else
+			return false;
+#endif
+		case STREAM_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			return true;
+#else
+			return false;
+#endif
+		case STREAM_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			return true;
+#else
+			return false;
+#endif
+	}
+
+	return false;
+}
+
+/*
+ * Set up the compression or decompression of a stream.  Returns NULL if the
+ * method isn't supported, or the library failed to initialize.
+ */
+StreamCompressor *
+stream_compressor_create(StreamCompressionMethod method, bool decompress)
+{
+	StreamCompressor *sc;
+
+	if (method == STREAM_COMPRESSION_NONE ||
+		!stream_compression_supported(method))
+		return NULL;
+
+	sc = ALLOC(sizeof(StreamCompressor));
+	if (sc == NULL)
+		return NULL;
+	memset(sc, 0, sizeof(StreamCompressor));
+	sc->method = method;
+	sc->decompress = decompress;
+
+	switch (method)
+	{
+		case STREAM_COMPRESSION_NONE:
+			break;
+
+		case STREAM_COMPRESSION_GZIP:
+#ifdef HAVE_LIBZ
+			{
+				int			ret;
+
+				/* raw deflate, the chunks are framed by the protocol */
+				if (decompress)
+					ret = inflateInit2(&sc->zs, -MAX_WBITS);
+				else
+					ret = deflateInit2(&sc->zs, Z_BEST_SPEED, Z_DEFLATED,
+									   -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+				if (ret != Z_OK)
+				{
+					FREE(sc);
+					return NULL;
+				}
+			}
+#endif
+			break;
+
+		case STREAM_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			if (!decompress)
+			{
+				sc->lz4_stream = LZ4_createStream();
+				if (sc->lz4_stream == NULL)
+				{
+					FREE(sc);
+					return NULL;
+				}
+			}
+			sc->lz4_dict = ALLOC(LZ4_DICT_SIZE);
+			if (sc->lz4_dict == NULL)
+			{
+				if (sc->lz4_stream != NULL)
+					LZ4_freeStream(sc->lz4_stream);
+				FREE(sc);
+				return NULL;
+			}
+			sc->lz4_dictlen = 0;
+#endif
+			break;
+
+		case STREAM_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			if (decompress)
+				sc->zstd_dctx = ZSTD_createDCtx();
+			else
+			{
+				sc->zstd_cctx = ZSTD_createCCtx();
+				if (sc->zstd_cctx != NULL)
+					ZSTD_CCtx_setParameter(sc->zstd_cctx,
+										   ZSTD_c_compressionLevel, 1);
+			}
+			if (sc->zstd_cctx == NULL && sc->zstd_dctx == NULL)
+			{
+				FREE(sc);
+				return NULL;
+			}
+#endif
+			break;
+	}
+
+	return sc;
+}
+
+void
+stream_compressor_free(StreamCompressor *sc)
+{
+	switch (sc->method)
+	{
+		case STREAM_COMPRESSION_NONE:
+			break;
+
+		case STREAM_COMPRESSION_GZIP:
+#ifdef HAVE_LIBZ
+			if (sc->decompress)
+				inflateEnd(&sc->zs);
+			else
+				deflateEnd(&sc->zs);
+#endif
+			break;
+
+		case STREAM_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			if (sc->lz4_stream != NULL)
+				LZ4_freeStream(sc->lz4_stream);
+			FREE(sc->lz4_dict);
+#endif
+			break;
+
+		case STREAM_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			if (sc->zstd_cctx != NULL)
+				ZSTD_freeCCtx(sc->zstd_cctx);
+			if (sc->zstd_dctx != NULL)
+				ZSTD_freeDCtx(sc->zstd_dctx);
+#endif
+			break;
+	}
+
+	FREE(sc);
+}
+
+/*
+ * Size of the buffer stream_compress() needs for a chunk of len bytes.
+ */
+size_t
+stream_compress_bound(StreamCompressor *sc, size_t len)
+{
+	switch (sc->method)
+	{
+		case STREAM_COMPRESSION_NONE:
+			break;
+
+		case STREAM_COMPRESSION_GZIP:
+#ifdef HAVE_LIBZ
+			/* plus the empty block of the flush */
+			return deflateBound(&sc->zs, len) + 16;
+#endif
+			break;
+
+		case STREAM_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			return LZ4_COMPRESSBOUND(len);
+#endif
+			break;
+
+		case STREAM_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			/* plus the frame header, on the first chunk */
+			return ZSTD_compressBound(len) + ZSTD_STREAM_HEADER_SIZE;
+#endif
+			break;
+	}
+
+	return len;
+}
+
+/*
+ * Compress the next chunk of the stream into dst, which must have room for
+ * stream_compress_bound() bytes.  Returns the compressed size, or -1 on
+ * failure.  The chunk must be passed to stream_decompress() as a whole.
+ */
+int
+stream_compress(StreamCompressor *sc, const char *src, size_t srclen,
+				char *dst, size_t dstlen)
+{
+	Assert(!sc->decompress);
+
+	switch (sc->method)
+	{
+		case STREAM_COMPRESSION_NONE:
+			break;
+
+		case STREAM_COMPRESSION_GZIP:
+#ifdef HAVE_LIBZ
+			sc->zs.next_in = (Bytef *) src;
+			sc->zs.avail_in = srclen;
+			sc->zs.next_out = (Bytef *) dst;
+			sc->zs.avail_out = dstlen;
+
+			/* a sync flush makes everything so far decompressible */
+			if (deflate(&sc->zs, Z_SYNC_FLUSH) != Z_OK ||
+				sc->zs.avail_in != 0 || sc->zs.avail_out == 0)
+				return -1;
+
+			return dstlen - sc->zs.avail_out;
+#endif
+			break;
+
+		case STREAM_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			{
+				int			len;
+
+				len = LZ4_compress_fast_continue(sc->lz4_stream, src, dst,
+												 srclen, dstlen, 1);
+				if (len <= 0)
+					return -1;
+
+				/*
+				 * The source of the next chunk won't be at the same place,
+				 * so keep the tail of what we compressed so far.
+				 */
+				sc->lz4_dictlen = LZ4_saveDict(sc->lz4_stream, sc->lz4_dict,
+											   LZ4_DICT_SIZE);
+				return len;
+			}
+#endif
+			break;
+
+		case STREAM_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				ZSTD_inBuffer in = {src, srclen, 0};
+				ZSTD_outBuffer out = {dst, dstlen, 0};
+
+				for (;;)
+				{
+					size_t		remaining;
+
+					remaining = ZSTD_compressStream2(sc->zstd_cctx, &out, &in,
+													 ZSTD_e_flush);
+					if (ZSTD_isError(remaining))
+						return -1;
+					if (remaining == 0)
+						break;
+					if (out.pos == out.size)
+						return -1;
+				}
+
+				return out.pos;
+			}
+#endif
+			break;
+	}
+
+	return -1;
+}
+
+/*
+ * Decompress the next chunk of the stream into dst, which is expected to
+ * receive exactly rawlen bytes.  Returns false if the data is corrupt.
+ */
+bool
+stream_decompress(StreamCompressor *sc, const char *src, size_t srclen,
+				  char *dst, size_t rawlen)
+{
+	Assert(sc->decompress);
+
+	switch (sc->method)
+	{
+		case STREAM_COMPRESSION_NONE:
+			break;
+
+		case STREAM_COMPRESSION_GZIP:
+#ifdef HAVE_LIBZ
+			{
+				int			ret;
+
+				sc->zs.next_in = (Bytef *) src;
+				sc->zs.avail_in = srclen;
+				sc->zs.next_out = (Bytef *) dst;
+				sc->zs.avail_out = rawlen;
+
+				ret = inflate(&sc->zs, Z_SYNC_FLUSH);
+				if (ret != Z_OK && ret != Z_BUF_ERROR)
+					return false;
+
+				/*
+				 * With the output full, inflate() may not have consumed the
+				 * empty block ending the chunk yet.  It mustn't produce any
+				 * more output.
+				 */
+				if (sc->zs.avail_out == 0 && sc->zs.avail_in != 0)
+				{
+					char		scratch[1];
+
+					sc->zs.next_out = (Bytef *) scratch;
+					sc->zs.avail_out = sizeof(scratch);
+					ret = inflate(&sc->zs, Z_SYNC_FLUSH);
+					if ((ret != Z_OK && ret != Z_BUF_ERROR) ||
+						sc->zs.avail_out != sizeof(scratch))
+						return false;
+					sc->zs.avail_out = 0;
+				}
+
+				return sc->zs.avail_in == 0 && sc->zs.avail_out == 0;
+			}
+#endif
+			break;
+
+		case STREAM_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			{
+				int			len;
+
+				len = LZ4_decompress_safe_usingDict(src, dst, srclen, rawlen,
+													sc->lz4_dict,
+													sc->lz4_dictlen);
+				if (len < 0 || (size_t) len != rawlen)
+					return false;
+
+				/* keep the same tail of the stream as the compressing side */
+				if (rawlen >= LZ4_DICT_SIZE)
+				{
+					memcpy(sc->lz4_dict, dst + rawlen - LZ4_DICT_SIZE,
+						   LZ4_DICT_SIZE);
+					sc->lz4_dictlen = LZ4_DICT_SIZE;
+				}
+				else
+				{
+					int			keep = Min(sc->lz4_dictlen,
+										   LZ4_DICT_SIZE - (int) rawlen);
+
+					memmove(sc->lz4_dict,
+							sc->lz4_dict + sc->lz4_dictlen - keep, keep);
+					memcpy(sc->lz4_dict + keep, dst, rawlen);
+					sc->lz4_dictlen = keep + rawlen;
+				}
+
+				return true;
+			}
+#endif
+			break;
+
+		case STREAM_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				ZSTD_inBuffer in = {src, srclen, 0};
+				ZSTD_outBuffer out = {dst, rawlen, 0};
+
+				while (in.pos < in.size)
+				{
+					size_t		in_pos = in.pos;
+					size_t		out_pos = out.pos;
+					size_t		ret;
+
+					ret = ZSTD_decompressStream(sc->zstd_dctx, &out, &in);
+					if (ZSTD_isError(ret))
+						return false;
+					if (in.pos == in_pos && out.pos == out_pos)
+						return false;
+				}
+
+				return out.pos == rawlen;
+			}
+#endif
+			break;
+	}
+
+	return false;
+}
@@ -144,6 +144,11 @@ extern bool index_insert(Relation indexRelation,
 						 Relation heapRelation,
 						 IndexUniqueCheck checkUnique,
 						 struct IndexInfo *indexInfo);
+extern void index_insert_multi(Relation indexRelation,
+							   Datum **values, bool **isnull,
+							   ItemPointer heap_t_ctids, int ntuples,
+							   Relation heapRelation,
+							   struct IndexInfo *indexInfo);
 
 extern IndexScanDesc index_beginscan(Relation heapRelation,
 									 Relation indexRelation,
@@ -169,6 +174,7 @@ extern ItemPointer index_getnext_tid(IndexScanDesc scan,
 									 ScanDirection direction);
 struct TupleTableSlot;
 extern bool index_fetch_heap(IndexScanDesc scan, struct TupleTableSlot *slot);
+extern void index_prefetch_heap(IndexScanDesc scan, ItemPointer tid);
 extern bool index_getnext_slot(IndexScanDesc scan, ScanDirection direction,
 							   struct TupleTableSlot *slot);
 extern int64 index_getbitmap(IndexScanDesc scan, TIDBitmap *bitmap);
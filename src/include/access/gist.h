@@ -37,7 +37,9 @@
 #define GIST_DISTANCE_PROC				8
 #define GIST_FETCH_PROC					9
 #define GIST_OPTIONS_PROC				10
-#define GISTNProcs						10
+#define GIST_SORTSUPPORT_PROC			11
+#define GIST_BATCH_DISTANCE_PROC		12
+#define GISTNProcs						12
 
 /*
  * Page opaque data in a GiST index page.
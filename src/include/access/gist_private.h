@@ -92,6 +92,7 @@ typedef struct GISTSTATE
 	FmgrInfo	equalFn[INDEX_MAX_KEYS];
 	FmgrInfo	distanceFn[INDEX_MAX_KEYS];
 	FmgrInfo	fetchFn[INDEX_MAX_KEYS];
+	FmgrInfo	batchDistanceFn[INDEX_MAX_KEYS];
 
 	/* Collations to pass to the support functions */
 	Oid			supportCollation[INDEX_MAX_KEYS];
@@ -148,6 +149,29 @@ typedef struct GISTSearchItem
 	(offsetof(GISTSearchItem, distances) + \
 	 sizeof(IndexOrderByDistance) * (n_distances))
 
+/*
+ * Workspace for an ordered scan that computes the distances of all the
+ * matching tuples on a page at once, with the opclasses' batch distance
+ * functions.  See gistScanPage.
+ */
+typedef struct GISTBatchDistanceState
+{
+	FmgrInfo   *fns;			/* batch distance function per ORDER BY key */
+
+	/* matching tuples on the current page */
+	int			nmatches;
+	OffsetNumber matches[MaxIndexTuplesPerPage];
+	bool		recheck[MaxIndexTuplesPerPage];
+	bool		recheckDistances[MaxIndexTuplesPerPage];
+	IndexOrderByDistance *distances;	/* numberOfOrderBys per match */
+
+	/* arguments of one call of a batch distance function */
+	GISTENTRY	entries[MaxIndexTuplesPerPage];
+	int			entryMatch[MaxIndexTuplesPerPage];	/* index into matches */
+	float8		entryDistances[MaxIndexTuplesPerPage];
+	bool		entryRecheck[MaxIndexTuplesPerPage];
+} GISTBatchDistanceState;
+
 /*
  * GISTScanOpaqueData: private state for a scan of a GiST index
  */
@@ -163,6 +187,7 @@ typedef struct GISTScanOpaqueData
 
 	/* pre-allocated workspace arrays */
 	IndexOrderByDistance *distances;	/* output area for gistindex_keytest */
+	GISTBatchDistanceState *batch;	/* NULL unless batching distances */
 
 	/* info about killed items if any (killedItems is NULL if never used) */
 	OffsetNumber *killedItems;	/* offset numbers of killed items */
@@ -501,12 +526,16 @@ extern IndexTuple gistgetadjusted(Relation r,
 								  GISTSTATE *giststate);
 extern IndexTuple gistFormTuple(GISTSTATE *giststate,
 								Relation r, Datum *attdata, bool *isnull, bool isleaf);
+extern void gistCompressValues(GISTSTATE *giststate, Relation r,
+							   Datum *attdata, bool *isnull, bool isleaf,
+							   Datum *compatt);
 
 extern OffsetNumber gistchoose(Relation r, Page p,
 							   IndexTuple it,
 							   GISTSTATE *giststate);
 
 extern void GISTInitBuffer(Buffer b, uint32 f);
+extern void gistinitpage(Page page, uint32 f);
 extern void gistdentryinit(GISTSTATE *giststate, int nkey, GISTENTRY *e,
 						   Datum k, Relation r, Page pg, OffsetNumber o,
 						   bool l, bool isNull);
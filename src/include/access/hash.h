@@ -155,9 +155,15 @@ typedef struct HashScanPosData
  */
 typedef struct HashScanOpaqueData
 {
-	/* Hash value of the scan key, ie, the hash key we seek */
+	/* Hash value of the first scan key, ie, the hash key we seek */
 	uint32		hashso_sk_hash;
 
+	/* Hash values of all the scan keys, one per entry of scan->keyData */
+	uint32	   *hashso_key_hashes;
+
+	/* Is this scan checking uniqueness, rather than run for a query? */
+	bool		hashso_unique_check;
+
 	/* remember the buffer associated with primary bucket */
 	Buffer		hashso_bucket_buf;
 
@@ -388,6 +394,10 @@ extern void hashadjustmembers(Oid opfamilyoid,
 
 /* hashinsert.c */
 extern void _hash_doinsert(Relation rel, IndexTuple itup, Relation heapRel);
+extern bool _hash_doinsert_unique(Relation rel, IndexTuple itup,
+								  Datum *values, bool *isnull,
+								  Relation heapRel, struct IndexInfo *indexInfo,
+								  IndexUniqueCheck checkUnique);
 extern OffsetNumber _hash_pgaddtup(Relation rel, Buffer buf,
 								   Size itemsize, IndexTuple itup);
 extern void _hash_pgaddmultitup(Relation rel, Buffer buf, IndexTuple *itups,
@@ -451,8 +461,9 @@ extern void _h_indexbuild(HSpool *hspool, Relation heapRel);
 
 /* hashutil.c */
 extern bool _hash_checkqual(IndexScanDesc scan, IndexTuple itup);
-extern uint32 _hash_datum2hashkey(Relation rel, Datum key);
-extern uint32 _hash_datum2hashkey_type(Relation rel, Datum key, Oid keytype);
+extern uint32 _hash_datum2hashkey(Relation rel, AttrNumber attno, Datum key);
+extern uint32 _hash_datum2hashkey_type(Relation rel, AttrNumber attno,
+									   Datum key, Oid keytype);
 extern Bucket _hash_hashkey2bucket(uint32 hashkey, uint32 maxbucket,
 								   uint32 highmask, uint32 lowmask);
 extern uint32 _hash_spareindex(uint32 num_bucket);
@@ -35,8 +35,11 @@
 #define HEAP_INSERT_FROZEN		TABLE_INSERT_FROZEN
 #define HEAP_INSERT_NO_LOGICAL	TABLE_INSERT_NO_LOGICAL
 #define HEAP_INSERT_SPECULATIVE 0x0010
+#define HEAP_INSERT_PARALLEL	TABLE_INSERT_PARALLEL
+#define HEAP_INSERT_BULK_WRITE	TABLE_INSERT_BULK_WRITE
 
 typedef struct BulkInsertStateData *BulkInsertState;
+struct ReadAheadState;
 struct TupleTableSlot;
 
 #define MaxLockTupleMode	LockTupleExclusive
@@ -63,6 +66,18 @@ typedef struct HeapScanDescData
 	/* rs_numblocks is usually InvalidBlockNumber, meaning "scan whole rel" */
 	BufferAccessStrategy rs_strategy;	/* access strategy for reads */
 
+	/* prefetching for non-parallel seqscans, or NULL; see heapgetpage */
+	struct ReadAheadState *rs_readahead;
+	BlockNumber rs_ra_next;		/* next block to predict */
+	BlockNumber rs_ra_remaining;	/* # of blocks left to predict */
+
+	/* pages read along with rs_cbuf by non-parallel seqscans; see heapgetpage */
+	Buffer	   *rs_batch;		/* pinned buffers, or NULL if not batching */
+	int			rs_batch_max;	/* allocated length of rs_batch */
+	int			rs_nbatch;		/* # of valid entries in rs_batch */
+	int			rs_batch_next;	/* next entry to hand out */
+	BlockNumber rs_batch_start; /* page held by rs_batch[0] */
+
 	HeapTupleData rs_ctup;		/* current tuple in scan, if any */
 
 	/* these fields only used in page-at-a-time mode and for bitmap scans */
@@ -148,7 +163,8 @@ extern void heap_abort_speculative(Relation relation, ItemPointer tid);
 extern TM_Result heap_update(Relation relation, ItemPointer otid,
 							 HeapTuple newtup,
 							 CommandId cid, Snapshot crosscheck, bool wait,
-							 struct TM_FailureData *tmfd, LockTupleMode *lockmode);
+							 struct TM_FailureData *tmfd, LockTupleMode *lockmode,
+							 TU_UpdateIndexes *update_indexes);
 extern TM_Result heap_lock_tuple(Relation relation, HeapTuple tuple,
 								 CommandId cid, LockTupleMode mode, LockWaitPolicy wait_policy,
 								 bool follow_update,
@@ -191,6 +207,9 @@ struct VacuumParams;
 extern void heap_vacuum_rel(Relation onerel,
 							struct VacuumParams *params, BufferAccessStrategy bstrategy);
 extern void parallel_vacuum_main(dsm_segment *seg, shm_toc *toc);
+extern BlockNumber heap_vacuum_set_visible(Relation onerel, BlockNumber start,
+										   BlockNumber nblocks,
+										   BufferAccessStrategy bstrategy);
 
 /* in heap/heapam_visibility.c */
 extern bool HeapTupleSatisfiesVisibility(HeapTuple stup, Snapshot snapshot,
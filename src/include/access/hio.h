@@ -24,12 +24,22 @@
  * If current_buf isn't InvalidBuffer, then we are holding an extra pin
  * on that buffer.
  *
+ * With HEAP_INSERT_BULK_WRITE, tuples are instead put on pages in
+ * bulk_pages, which start at block bulk_nextblk of bulk_rel and haven't
+ * been written out yet; see RelationPutHeapTupleBulk.
+ *
  * "typedef struct BulkInsertStateData *BulkInsertState" is in heapam.h
  */
+#define HEAP_BULK_WRITE_PAGES	32	/* max # of pages in bulk_pages */
+
 typedef struct BulkInsertStateData
 {
 	BufferAccessStrategy strategy;	/* our BULKWRITE strategy object */
 	Buffer		current_buf;	/* current insertion target page */
+	Relation	bulk_rel;		/* relation being bulk written, or NULL */
+	BlockNumber bulk_nextblk;	/* block number of bulk_pages[0] */
+	int			bulk_npages;	/* # of pages in bulk_pages */
+	PGAlignedBlock *bulk_pages; /* HEAP_BULK_WRITE_PAGES pages */
 } BulkInsertStateData;
 
 
@@ -39,5 +49,9 @@ extern Buffer RelationGetBufferForTuple(Relation relation, Size len,
 										Buffer otherBuffer, int options,
 										BulkInsertStateData *bistate,
 										Buffer *vmbuffer, Buffer *vmbuffer_other);
+extern void RelationPutHeapTupleBulk(Relation relation,
+									 BulkInsertStateData *bistate,
+									 HeapTuple tuple);
+extern void RelationFlushBulkPages(BulkInsertStateData *bistate);
 
 #endif							/* HIO_H */
@@ -853,6 +853,7 @@ typedef struct BTScanPosData
 	int			firstItem;		/* first valid index in items[] */
 	int			lastItem;		/* last valid index in items[] */
 	int			itemIndex;		/* current index in items[] */
+	int			prefetchItem;	/* last item whose heap page was prefetched */
 
 	BTScanPosItem items[MaxTIDsPerBTreePage];	/* MUST BE LAST */
 } BTScanPosData;
@@ -901,6 +902,33 @@ typedef struct BTArrayKeyInfo
 	Datum	   *elem_values;	/* array of num_elems Datums */
 } BTArrayKeyInfo;
 
+/*
+ * State of a skip scan.  A scan with keys on the second index column but
+ * none on the first is done as a series of primitive index scans, one for
+ * each distinct value of the first column, with an added "=" key on it.
+ * That key can be replaced by a ">=" or "<=" key on the current value, so
+ * that the last primitive scan covers the rest of the index, once skipping
+ * doesn't look worthwhile anymore.
+ */
+typedef struct BTSkipKeyInfo
+{
+	int16		attlen;			/* first column's storage properties */
+	bool		attbyval;
+	FmgrInfo	eq_proc;		/* first column's "=" operator function */
+	FmgrInfo	ge_proc;		/* ">=" function, or fn_oid InvalidOid */
+	FmgrInfo	le_proc;		/* "<=" function, or fn_oid InvalidOid */
+	bool		cur_valid;		/* is there a current value? */
+	bool		cur_isnull;		/* current value of the first column */
+	Datum		cur_value;
+	StrategyNumber cur_strategy;	/* strategy of the added key */
+	bool		mark_valid;		/* same as of the last btmarkpos */
+	bool		mark_isnull;
+	Datum		mark_value;
+	StrategyNumber mark_strategy;
+	BlockNumber last_blkno;		/* leaf page the current value was found on */
+	int			nsamepage;		/* successive values found on that page */
+} BTSkipKeyInfo;
+
 typedef struct BTScanOpaqueData
 {
 	/* these fields are set by _bt_preprocess_keys(): */
@@ -915,7 +943,16 @@ typedef struct BTScanOpaqueData
 	int			arrayKeyCount;	/* count indicating number of array scan keys
 								 * processed */
 	BTArrayKeyInfo *arrayKeys;	/* info about each equality-type array key */
-	MemoryContext arrayContext; /* scan-lifespan context for array data */
+	MemoryContext arrayContext; /* scan-lifespan context for array and skip
+								 * key data */
+
+	/* workspace for skip scans */
+	ScanKey		skipKeyData;	/* skip key, then a copy of scan->keyData */
+	BTSkipKeyInfo *skipKey;		/* skip scan state, or NULL if not one */
+
+	/* leaf page hint for the next primitive scan's descent */
+	BlockNumber lastLeafBlock;	/* last leaf page read, if valid */
+	int			hintMisses;		/* consecutive times it was the wrong page */
 
 	/* info about killed items if any (killedItems is NULL if never used) */
 	int		   *killedItems;	/* currPos.items indexes of killed items */
@@ -997,6 +1034,9 @@ extern bool btinsert(Relation rel, Datum *values, bool *isnull,
 					 ItemPointer ht_ctid, Relation heapRel,
 					 IndexUniqueCheck checkUnique,
 					 struct IndexInfo *indexInfo);
+extern void btinsertmulti(Relation rel, Datum **values, bool **isnull,
+						  ItemPointer ht_ctids, int ntuples, Relation heapRel,
+						  struct IndexInfo *indexInfo);
 extern IndexScanDesc btbeginscan(Relation rel, int nkeys, int norderbys);
 extern Size btestimateparallelscan(void);
 extern void btinitparallelscan(void *target);
@@ -1045,6 +1085,8 @@ extern IndexTuple _bt_swap_posting(IndexTuple newitem, IndexTuple oposting,
  */
 extern bool _bt_doinsert(Relation rel, IndexTuple itup,
 						 IndexUniqueCheck checkUnique, Relation heapRel);
+extern void _bt_doinsert_multi(Relation rel, IndexTuple *itups, int nitups,
+							   Relation heapRel);
 extern void _bt_finish_split(Relation rel, Buffer lbuf, BTStack stack);
 extern Buffer _bt_getstackbuf(Relation rel, BTStack stack, BlockNumber child);
 
@@ -1101,6 +1143,8 @@ extern bool _bt_first(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_next(IndexScanDesc scan, ScanDirection dir);
 extern Buffer _bt_get_endpoint(Relation rel, uint32 level, bool rightmost,
 							   Snapshot snapshot);
+extern bool _bt_skip_findnext(IndexScanDesc scan, ScanDirection dir,
+							  Datum *value, bool *isnull, BlockNumber *blkno);
 
 /*
  * prototypes for functions in nbtutils.c
@@ -1112,6 +1156,11 @@ extern void _bt_start_array_keys(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_advance_array_keys(IndexScanDesc scan, ScanDirection dir);
 extern void _bt_mark_array_keys(IndexScanDesc scan);
 extern void _bt_restore_array_keys(IndexScanDesc scan);
+extern void _bt_preprocess_skip_key(IndexScanDesc scan);
+extern bool _bt_start_skip_key(IndexScanDesc scan, ScanDirection dir);
+extern bool _bt_advance_skip_key(IndexScanDesc scan, ScanDirection dir);
+extern void _bt_mark_skip_key(IndexScanDesc scan);
+extern void _bt_restore_skip_key(IndexScanDesc scan);
 extern void _bt_preprocess_keys(IndexScanDesc scan);
 extern bool _bt_checkkeys(IndexScanDesc scan, IndexTuple tuple,
 						  int tupnatts, ScanDirection dir, bool *continuescan);
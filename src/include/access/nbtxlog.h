@@ -41,6 +41,8 @@
 										 * FSM */
 #define XLOG_BTREE_META_CLEANUP	0xE0	/* update cleanup-related data in the
 										 * metapage */
+#define XLOG_BTREE_INSERT_MULTI	0xF0	/* add several index tuples to a leaf
+										 * page without split */
 
 /*
  * All that we need to regenerate the meta-data page
@@ -86,6 +88,26 @@ typedef struct xl_btree_insert
 
 #define SizeOfBtreeInsert	(offsetof(xl_btree_insert, offnum) + sizeof(OffsetNumber))
 
+/*
+ * This is what we need to know about a batch of tuples inserted into a leaf
+ * page at once by _bt_doinsert_multi, without a split.  None of them
+ * overlaps with a posting list.
+ *
+ * Backup Blk 0: leaf page
+ *
+ * The block data contains the new tuples, followed by an array of their
+ * offset numbers.  Both are in the order in which the tuples must be added
+ * to the page, each offset number accounting for the tuples added before it.
+ */
+typedef struct xl_btree_insert_multi
+{
+	uint16		ntuples;
+
+	/* NEW TUPLES AND THEIR OFFSET NUMBERS FOLLOW IN BLOCK 0 DATA */
+} xl_btree_insert_multi;
+
+#define SizeOfBtreeInsertMulti	(offsetof(xl_btree_insert_multi, ntuples) + sizeof(uint16))
+
 /*
  * On insert with split, we save all the items going into the right sibling
  * so that we can restore it completely from the log record.  This way takes
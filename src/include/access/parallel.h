@@ -27,6 +27,8 @@ typedef struct ParallelWorkerInfo
 	BackgroundWorkerHandle *bgwhandle;
 	shm_mq_handle *error_mqh;
 	int32		pid;
+	int			pool_slot;		/* slot of a pooled worker, or -1 */
+	uint64		pool_generation;	/* generation of that slot */
 } ParallelWorkerInfo;
 
 typedef struct ParallelContext
@@ -58,6 +60,10 @@ extern volatile bool ParallelMessagePending;
 extern PGDLLIMPORT int ParallelWorkerNumber;
 extern PGDLLIMPORT bool InitializingParallelWorker;
 
+/* GUC variables */
+extern int	parallel_worker_pool_size;
+extern int	parallel_worker_idle_timeout;
+
 #define		IsParallelWorker()		(ParallelWorkerNumber >= 0)
 
 extern ParallelContext *CreateParallelContext(const char *library_name,
@@ -79,4 +85,7 @@ extern void ParallelWorkerReportLastRecEnd(XLogRecPtr last_xlog_end);
 
 extern void ParallelWorkerMain(Datum main_arg);
 
+extern Size ParallelWorkerPoolShmemSize(void);
+extern void ParallelWorkerPoolShmemInit(void);
+
 #endif							/* PARALLEL_H */
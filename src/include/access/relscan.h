@@ -146,6 +146,11 @@ typedef struct IndexScanDescData
 									 * further results */
 	IndexFetchTableData *xs_heapfetch;
 
+	/* heap prefetching state, see index_prefetch_heap() */
+	int			xs_prefetch_distance;	/* how many TIDs to look ahead */
+	int			xs_prefetch_maximum;	/* limit for distance */
+	BlockNumber xs_prefetch_block;	/* last heap block prefetched */
+
 	bool		xs_recheck;		/* T means scan keys must be rechecked */
 
 	/*
@@ -14,6 +14,7 @@
 #define SLRU_H
 
 #include "access/xlogdefs.h"
+#include "port/atomics.h"
 #include "storage/lwlock.h"
 
 
@@ -32,6 +33,21 @@
  */
 #define SLRU_PAGES_PER_SEGMENT	32
 
+/*
+ * The buffer slots of an SLRU are divided into banks of SLRU_BANK_SIZE slots.
+ * A given page can only be held by a slot of one bank, chosen by the page
+ * number, so that looking a page up and choosing a victim slot only needs to
+ * examine that bank.  Each bank has its own lock, see SimpleLruGetBankLock().
+ */
+#define SLRU_BANK_BITSHIFT		4
+#define SLRU_BANK_SIZE			(1 << SLRU_BANK_BITSHIFT)
+
+/*
+ * Upper limit for the number of buffers of any SLRU, which keeps the
+ * per-buffer arrays comfortably within int range.
+ */
+#define SLRU_MAX_ALLOWED_BUFFERS ((1024 * 1024 * 1024) / BLCKSZ)
+
 /*
  * Page status codes.  Note that these do not include the "dirty" bit.
  * page_dirty can be true only in the VALID or WRITE_IN_PROGRESS states;
@@ -51,8 +67,6 @@ typedef enum
  */
 typedef struct SlruSharedData
 {
-	LWLock	   *ControlLock;
-
 	/* Number of buffers managed by this SLRU structure */
 	int			num_slots;
 
@@ -65,8 +79,17 @@ typedef struct SlruSharedData
 	bool	   *page_dirty;
 	int		   *page_number;
 	int		   *page_lru_count;
+
+	/* The buffer_locks protects the I/O on each buffer slot */
 	LWLockPadded *buffer_locks;
 
+	/*
+	 * Locks to protect the in memory buffer slot access in SLRU bank.  The
+	 * bank lock of a page must be held to examine or modify the state of any
+	 * slot of the page's bank.
+	 */
+	LWLockPadded *bank_locks;
+
 	/*
 	 * Optional array of WAL flush LSNs associated with entries in the SLRU
 	 * pages.  If not zero/NULL, we must flush WAL before writing pages (true
@@ -79,22 +102,25 @@ typedef struct SlruSharedData
 	int			lsn_groups_per_page;
 
 	/*----------
-	 * We mark a page "most recently used" by setting
-	 *		page_lru_count[slotno] = ++cur_lru_count;
-	 * The oldest page is therefore the one with the highest value of
-	 *		cur_lru_count - page_lru_count[slotno]
+	 * Each bank keeps its own LRU clock.  We mark a page "most recently used"
+	 * by setting
+	 *		page_lru_count[slotno] = ++bank_cur_lru_count[bankno];
+	 * The oldest page in the bank is therefore the one with the highest value
+	 * of
+	 *		bank_cur_lru_count[bankno] - page_lru_count[slotno]
 	 * The counts will eventually wrap around, but this calculation still
 	 * works as long as no page's age exceeds INT_MAX counts.
 	 *----------
 	 */
-	int			cur_lru_count;
+	int		   *bank_cur_lru_count;
 
 	/*
 	 * latest_page_number is the page number of the current end of the log;
 	 * this is not critical data, since we use it only to avoid swapping out
-	 * the latest page.
+	 * the latest page.  It is updated without holding any bank lock, so it
+	 * is kept in an atomic variable.
 	 */
-	int			latest_page_number;
+	pg_atomic_uint32 latest_page_number;
 
 	/* SLRU's index for statistics purposes (might not be unique) */
 	int			slru_stats_idx;
@@ -123,6 +149,9 @@ typedef struct SlruCtlData
 	 */
 	bool		(*PagePrecedes) (int, int);
 
+	/* Number of banks in this SLRU, set during SimpleLruInit */
+	int			nbanks;
+
 	/*
 	 * Dir is set during SimpleLruInit and does not change thereafter. Since
 	 * it's always the same, it doesn't need to be in shared memory.
@@ -132,10 +161,44 @@ typedef struct SlruCtlData
 
 typedef SlruCtlData *SlruCtl;
 
+/*
+ * Get the bank lock protecting the buffer slots that can hold the given page.
+ */
+static inline LWLock *
+SimpleLruGetBankLock(SlruCtl ctl, int pageno)
+{
+	int			bankno = (uint32) pageno % ctl->nbanks;
+
+	return &(ctl->shared->bank_locks[bankno].lock);
+}
+
+/* Bank number of the given buffer slot */
+static inline int
+SlruSlotGetBankNumber(int slotno)
+{
+	return slotno >> SLRU_BANK_BITSHIFT;
+}
+
+/* Read or advance the latest page number of an SLRU */
+static inline int
+SimpleLruGetLatestPage(SlruCtl ctl)
+{
+	return (int) pg_atomic_read_u32(&ctl->shared->latest_page_number);
+}
+
+static inline void
+SimpleLruSetLatestPage(SlruCtl ctl, int pageno)
+{
+	pg_atomic_write_u32(&ctl->shared->latest_page_number, (uint32) pageno);
+}
+
 
 extern Size SimpleLruShmemSize(int nslots, int nlsns);
+extern int	SimpleLruAutotuneBuffers(int divisor, int max);
+extern bool check_slru_buffers(const char *name, int *newval);
 extern void SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
-						  LWLock *ctllock, const char *subdir, int tranche_id);
+						  const char *subdir, int buffer_tranche_id,
+						  int bank_tranche_id);
 extern int	SimpleLruZeroPage(SlruCtl ctl, int pageno);
 extern int	SimpleLruReadPage(SlruCtl ctl, int pageno, bool write_ok,
 							  TransactionId xid);
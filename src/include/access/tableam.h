@@ -32,6 +32,7 @@ extern char *default_table_access_method;
 extern bool synchronize_seqscans;
 
 
+struct Bitmapset;
 struct BulkInsertStateData;
 struct IndexInfo;
 struct SampleScanState;
@@ -128,11 +129,30 @@ typedef struct TM_FailureData
 	bool		traversed;
 } TM_FailureData;
 
+/*
+ * Result codes for table_tuple_update(), telling the caller which indexes
+ * need new entries for the new tuple version.
+ */
+typedef enum TU_UpdateIndexes
+{
+	/* No indexed columns were updated (incl. TID addressing of tuple) */
+	TU_None,
+
+	/* A non-summarizing indexed column was updated, or the TID has changed */
+	TU_All,
+
+	/* Only summarized columns were updated, TID is unchanged */
+	TU_Summarizing
+} TU_UpdateIndexes;
+
 /* "options" flag bits for table_tuple_insert */
 /* TABLE_INSERT_SKIP_WAL was 0x0001; RelationNeedsWAL() now governs */
 #define TABLE_INSERT_SKIP_FSM		0x0002
 #define TABLE_INSERT_FROZEN			0x0004
 #define TABLE_INSERT_NO_LOGICAL		0x0008
+/* 0x0010 is reserved for HEAP_INSERT_SPECULATIVE */
+#define TABLE_INSERT_PARALLEL		0x0020
+#define TABLE_INSERT_BULK_WRITE		0x0040
 
 /* flag bits for table_tuple_lock */
 /* Follow tuples whose update is in progress if lock modes don't conflict  */
@@ -225,6 +245,22 @@ typedef struct TableAmRoutine
 									 ScanDirection direction,
 									 TupleTableSlot *slot);
 
+	/*
+	 * Tell the scan that only the attributes in `attrs` will be looked at in
+	 * the tuples it returns, so that the others may be left NULL.  The set
+	 * uses the same offset as pull_varattnos(), i.e. attribute numbers minus
+	 * FirstLowInvalidHeapAttributeNumber; system attributes in it can be
+	 * ignored.  Called, if at all, before the first scan_getnextslot(), and
+	 * stays in effect across rescans.
+	 *
+	 * This is useful for AMs that store columns separately and can avoid
+	 * reading the others altogether.
+	 *
+	 * Optional callback.
+	 */
+	void		(*scan_set_projection) (TableScanDesc scan,
+										struct Bitmapset *attrs);
+
 
 	/* ------------------------------------------------------------------------
 	 * Parallel table scan related functions.
@@ -396,7 +432,7 @@ typedef struct TableAmRoutine
 								 bool wait,
 								 TM_FailureData *tmfd,
 								 LockTupleMode *lockmode,
-								 bool *update_indexes);
+								 TU_UpdateIndexes *update_indexes);
 
 	/* see table_tuple_lock() for reference about parameters */
 	TM_Result	(*tuple_lock) (Relation rel,
@@ -916,6 +952,26 @@ table_scan_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableS
 	return sscan->rs_rd->rd_tableam->scan_getnextslot(sscan, direction, slot);
 }
 
+/*
+ * Does the AM of `rel` want to know which columns a scan needs?
+ */
+static inline bool
+table_scan_supports_projection(Relation rel)
+{
+	return rel->rd_tableam->scan_set_projection != NULL;
+}
+
+/*
+ * Tell `scan` which columns will be looked at in the returned tuples; see
+ * the scan_set_projection callback.  A no-op for AMs that don't care.
+ */
+static inline void
+table_scan_set_projection(TableScanDesc scan, struct Bitmapset *attrs)
+{
+	if (scan->rs_rd->rd_tableam->scan_set_projection != NULL)
+		scan->rs_rd->rd_tableam->scan_set_projection(scan, attrs);
+}
+
 
 /* ----------------------------------------------------------------------------
  * Parallel table scan related functions.
@@ -1163,6 +1219,17 @@ table_compute_xid_horizon_for_tuples(Relation rel,
  * where RelationIsLogicallyLogged(relation) is not yet accurate for the new
  * relation.
  *
+ * TABLE_INSERT_PARALLEL allows the insertion to happen in a parallel worker.
+ * The caller is responsible for making sure that nothing the insertion does,
+ * such as firing triggers or evaluating expressions, is unsafe there; see
+ * parallel COPY FROM.
+ *
+ * TABLE_INSERT_BULK_WRITE allows the AM to build new pages in private memory
+ * and write them out directly, bypassing shared buffers, if the relfilenode
+ * was created in the current transaction.  The inserted tuples may then not
+ * be readable through their TIDs before the BulkInsertState is freed, so the
+ * caller must not have any indexes or triggers to maintain.
+ *
  * Note that most of these options will be applied when inserting into the
  * heap's TOAST table, too, if the tuple requires any out-of-line data.
  *
@@ -1290,8 +1357,9 @@ table_tuple_delete(Relation rel, ItemPointer tid, CommandId cid,
  * Output parameters:
  *	tmfd - filled in failure cases (see below)
  *	lockmode - filled with lock mode acquired on tuple
- *  update_indexes - in success cases this is set to true if new index entries
- *		are required for this tuple
+ *	update_indexes - in success cases this is set to TU_All if new entries
+ *		are required in all indexes for this tuple, TU_Summarizing if they're
+ *		required only in summarizing indexes, and TU_None if none are needed
  *
  * Normal, successful return value is TM_Ok, which means we did actually
  * update it.  Failure return codes are TM_SelfModified, TM_Updated, and
@@ -1311,7 +1379,7 @@ static inline TM_Result
 table_tuple_update(Relation rel, ItemPointer otid, TupleTableSlot *slot,
 				   CommandId cid, Snapshot snapshot, Snapshot crosscheck,
 				   bool wait, TM_FailureData *tmfd, LockTupleMode *lockmode,
-				   bool *update_indexes)
+				   TU_UpdateIndexes *update_indexes)
 {
 	return rel->rd_tableam->tuple_update(rel, otid, slot,
 										 cid, snapshot, crosscheck,
@@ -1834,7 +1902,7 @@ extern void simple_table_tuple_delete(Relation rel, ItemPointer tid,
 									  Snapshot snapshot);
 extern void simple_table_tuple_update(Relation rel, ItemPointer otid,
 									  TupleTableSlot *slot, Snapshot snapshot,
-									  bool *update_indexes);
+									  TU_UpdateIndexes *update_indexes);
 
 
 /* ----------------------------------------------------------------------------
@@ -0,0 +1,30 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogparallel.h
+ *		Declarations for parallel WAL replay.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/include/access/xlogparallel.h
+ *-------------------------------------------------------------------------
+ */
+#ifndef XLOGPARALLEL_H
+#define XLOGPARALLEL_H
+
+#include "access/xlogreader.h"
+
+/* upper limit for recovery_parallel_workers */
+#define MAX_PARALLEL_REDO_WORKERS	64
+
+/* GUCs */
+extern int	recovery_parallel_workers;
+
+extern bool ParallelRedoDispatch(XLogReaderState *record);
+extern void ParallelRedoWaitForWorkers(void);
+extern void ParallelRedoFinish(void);
+
+extern void ParallelRedoWorkerMain(Datum main_arg);
+
+#endif
@@ -206,6 +206,17 @@
 #define unlikely(x) ((x) != 0)
 #endif
 
+/*
+ * pg_prefetch_mem(addr) asks the CPU to start fetching the cache line
+ * containing addr, so that a later access to it is less likely to stall.
+ * It's only a hint: it has no visible effect, and addr needn't be valid.
+ */
+#if __GNUC__ >= 3
+#define pg_prefetch_mem(addr)	__builtin_prefetch(addr)
+#else
+#define pg_prefetch_mem(addr)	((void) (addr))
+#endif
+
 /*
  * CppAsString
  *		Convert the argument to a string, using the C preprocessor.
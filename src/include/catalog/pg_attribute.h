@@ -121,6 +121,13 @@ CATALOG(pg_attribute,1249,AttributeRelationId) BKI_BOOTSTRAP BKI_ROWTYPE_OID(75,
 	 */
 	char		attalign;
 
+	/*
+	 * Compression method for compressible attributes, one of the
+	 * TOAST_*_COMPRESSION constants, or '\0' to use the current
+	 * default_toast_compression.
+	 */
+	char		attcompression BKI_DEFAULT('\0');
+
 	/* This flag represents the "NOT NULL" constraint */
 	bool		attnotnull;
 
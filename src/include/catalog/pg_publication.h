@@ -80,6 +80,17 @@ typedef struct Publication
 	PublicationActions pubactions;
 } Publication;
 
+/*
+ * A relation being added to a publication, along with its column list and
+ * its (already transformed) row filter.
+ */
+typedef struct PublicationRelInfo
+{
+	Relation	relation;
+	Node	   *whereClause;	/* row filter, or NULL */
+	List	   *columns;		/* List of String column names, or NIL */
+} PublicationRelInfo;
+
 extern Publication *GetPublication(Oid pubid);
 extern Publication *GetPublicationByName(const char *pubname, bool missing_ok);
 extern List *GetRelationPublications(Oid relid);
@@ -105,7 +116,8 @@ extern List *GetAllTablesPublications(void);
 extern List *GetAllTablesPublicationRelations(bool pubviaroot);
 
 extern bool is_publishable_relation(Relation rel);
-extern ObjectAddress publication_add_relation(Oid pubid, Relation targetrel,
+extern ObjectAddress publication_add_relation(Oid pubid,
+											  PublicationRelInfo *pri,
 											  bool if_not_exists);
 
 extern Oid	get_publication_oid(const char *pubname, bool missing_ok);
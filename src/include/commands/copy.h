@@ -17,6 +17,8 @@
 #include "nodes/execnodes.h"
 #include "nodes/parsenodes.h"
 #include "parser/parse_node.h"
+#include "storage/dsm.h"
+#include "storage/shm_toc.h"
 #include "tcop/dest.h"
 
 /* CopyStateData is private in commands/copy.c */
@@ -31,6 +33,7 @@ extern void ProcessCopyOptions(ParseState *pstate, CopyState cstate, bool is_fro
 extern CopyState BeginCopyFrom(ParseState *pstate, Relation rel, const char *filename,
 							   bool is_program, copy_data_source_cb data_source_cb, List *attnamelist, List *options);
 extern void EndCopyFrom(CopyState cstate);
+extern bool CopyFromSetRange(CopyState cstate, off_t start, off_t end);
 extern bool NextCopyFrom(CopyState cstate, ExprContext *econtext,
 						 Datum *values, bool *nulls);
 extern bool NextCopyFromRawFields(CopyState cstate,
@@ -38,6 +41,8 @@ extern bool NextCopyFromRawFields(CopyState cstate,
 extern void CopyFromErrorCallback(void *arg);
 
 extern uint64 CopyFrom(CopyState cstate);
+extern void ParallelCopyMain(dsm_segment *seg, shm_toc *toc);
+extern void ParallelCopyToMain(dsm_segment *seg, shm_toc *toc);
 
 extern DestReceiver *CreateCopyDestReceiver(void);
 
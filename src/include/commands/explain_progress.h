@@ -0,0 +1,30 @@
+/*-------------------------------------------------------------------------
+ *
+ * explain_progress.h
+ *	  Inspecting the plan of a query running in another backend
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/commands/explain_progress.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXPLAIN_PROGRESS_H
+#define EXPLAIN_PROGRESS_H
+
+#include "executor/execdesc.h"
+
+/* GUC variable */
+extern bool track_plan_progress;
+
+extern volatile bool PlanProgressPending;
+
+extern Size PlanProgressShmemSize(void);
+extern void PlanProgressShmemInit(void);
+
+extern void HandlePlanProgressInterrupt(void);
+extern void ProcessPlanProgressInterrupt(void);
+extern void AtEndOfActiveQuery(QueryDesc *queryDesc);
+
+#endif							/* EXPLAIN_PROGRESS_H */
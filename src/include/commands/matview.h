@@ -30,4 +30,7 @@ extern DestReceiver *CreateTransientRelDestReceiver(Oid oid);
 
 extern bool MatViewIncrementalMaintenanceIsEnabled(void);
 
+extern void CheckIncrementalMatViewQuery(Query *query);
+extern void CreateIncrementalMatViewTriggers(Oid matviewOid, Query *query);
+
 #endif							/* MATVIEW_H */
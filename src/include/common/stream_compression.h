@@ -0,0 +1,39 @@
+/*-------------------------------------------------------------------------
+ *
+ * stream_compression.h
+ *	  Compression of protocol streams
+ *
+ * Portions Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * src/include/common/stream_compression.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef STREAM_COMPRESSION_H
+#define STREAM_COMPRESSION_H
+
+typedef enum StreamCompressionMethod
+{
+	STREAM_COMPRESSION_NONE,
+	STREAM_COMPRESSION_GZIP,
+	STREAM_COMPRESSION_LZ4,
+	STREAM_COMPRESSION_ZSTD
+} StreamCompressionMethod;
+
+typedef struct StreamCompressor StreamCompressor;
+
+extern bool parse_stream_compression_method(const char *name,
+											StreamCompressionMethod *method);
+extern const char *stream_compression_method_name(StreamCompressionMethod method);
+extern bool stream_compression_supported(StreamCompressionMethod method);
+
+extern StreamCompressor *stream_compressor_create(StreamCompressionMethod method,
+												  bool decompress);
+extern void stream_compressor_free(StreamCompressor *sc);
+extern size_t stream_compress_bound(StreamCompressor *sc, size_t len);
+extern int	stream_compress(StreamCompressor *sc, const char *src, size_t srclen,
+							char *dst, size_t dstlen);
+extern bool stream_decompress(StreamCompressor *sc, const char *src,
+							  size_t srclen, char *dst, size_t rawlen);
+
+#endif							/* STREAM_COMPRESSION_H */
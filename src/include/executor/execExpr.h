@@ -84,10 +84,13 @@ typedef enum ExprEvalOp
 	/*
 	 * Evaluate function call (including OpExprs etc).  For speed, we
 	 * distinguish in the opcode whether the function is strict and/or
-	 * requires usage stats tracking.
+	 * requires usage stats tracking, and for strict functions, whether they
+	 * have one or two arguments, the overwhelmingly common cases (operators).
 	 */
 	EEOP_FUNCEXPR,
 	EEOP_FUNCEXPR_STRICT,
+	EEOP_FUNCEXPR_STRICT_1,
+	EEOP_FUNCEXPR_STRICT_2,
 	EEOP_FUNCEXPR_FUSAGE,
 	EEOP_FUNCEXPR_STRICT_FUSAGE,
 
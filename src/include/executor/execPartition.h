@@ -152,5 +152,7 @@ extern PartitionPruneState *ExecCreatePartitionPruneState(PlanState *planstate,
 extern Bitmapset *ExecFindMatchingSubPlans(PartitionPruneState *prunestate);
 extern Bitmapset *ExecFindInitialMatchingSubPlans(PartitionPruneState *prunestate,
 												  int nsubplans);
+extern Bitmapset *ExecGetLockPrunedRelids(PlannedStmt *plannedstmt,
+										  ParamListInfo params);
 
 #endif							/* EXECPARTITION_H */
@@ -84,6 +84,9 @@ extern PGDLLIMPORT ExecutorEnd_hook_type ExecutorEnd_hook;
 typedef bool (*ExecutorCheckPerms_hook_type) (List *, bool);
 extern PGDLLIMPORT ExecutorCheckPerms_hook_type ExecutorCheckPerms_hook;
 
+/* The outermost query being run by ExecutorRun(), if any */
+extern PGDLLIMPORT QueryDesc *ActiveQueryDesc;
+
 
 /*
  * prototypes from functions in execAmi.c
@@ -246,6 +249,71 @@ ExecProcNode(PlanState *node)
 }
 #endif
 
+/* ----------------------------------------------------------------
+ *		ExecProcNodeBatch
+ *
+ *		Execute the given node to return a(nother) batch of tuples.  The node
+ *		must support the batch protocol, see ExecCanFetchBatches().
+ * ----------------------------------------------------------------
+ */
+#ifndef FRONTEND
+static inline TupleBatch *
+ExecProcNodeBatch(PlanState *node)
+{
+	Assert(node->ExecProcNodeBatch != NULL);
+
+	if (node->chgParam != NULL) /* something changed? */
+		ExecReScan(node);		/* let ReScan handle this */
+
+	return node->ExecProcNodeBatch(node);
+}
+#endif
+
+/*
+ * ExecCanFetchBatches - can the parent of "node" fetch its tuples in
+ * batches?  We don't when the node is instrumented, so that EXPLAIN ANALYZE
+ * reports the same per-node numbers either way.
+ */
+#ifndef FRONTEND
+static inline bool
+ExecCanFetchBatches(PlanState *node)
+{
+	return node->ExecProcNodeBatch != NULL && node->instrument == NULL;
+}
+#endif
+
+/* ----------------------------------------------------------------
+ *		ExecProcNodeFromBatch
+ *
+ *		Return the next tuple of the given node, fetching it a batch at a
+ *		time.  *batch is the caller's cursor into the current batch; it must
+ *		be initialized to NULL, and reset to NULL when the node is rescanned.
+ *		Returns NULL if there are no more tuples.  The returned slot stays
+ *		valid until the next batch is fetched.
+ * ----------------------------------------------------------------
+ */
+#ifndef FRONTEND
+static inline TupleTableSlot *
+ExecProcNodeFromBatch(PlanState *node, TupleBatch **batch)
+{
+	TupleBatch *cur = *batch;
+
+	if (cur == NULL || cur->next >= cur->nselected)
+	{
+		/* once the node reported the end of its tuples, stay there */
+		if (cur != NULL && cur->nselected == 0)
+			return NULL;
+
+		cur = *batch = ExecProcNodeBatch(node);
+		cur->next = 0;
+		if (cur->nselected == 0)
+			return NULL;
+	}
+
+	return cur->slots[cur->selection[cur->next++]];
+}
+#endif
+
 /*
  * prototypes from functions in execExpr.c
  */
@@ -268,6 +336,12 @@ extern ProjectionInfo *ExecBuildProjectionInfo(List *targetList,
 											   TupleTableSlot *slot,
 											   PlanState *parent,
 											   TupleDesc inputDesc);
+extern ProjectionInfo *ExecBuildQualProjectionInfo(List *qual,
+												   List *targetList,
+												   ExprContext *econtext,
+												   TupleTableSlot *slot,
+												   PlanState *parent,
+												   TupleDesc inputDesc);
 extern ExprState *ExecPrepareExpr(Expr *node, EState *estate);
 extern ExprState *ExecPrepareQual(List *qual, EState *estate);
 extern ExprState *ExecPrepareCheck(List *qual, EState *estate);
@@ -355,6 +429,38 @@ ExecProject(ProjectionInfo *projInfo)
 
 	return slot;
 }
+
+/*
+ * ExecQualAndProject
+ *
+ * Evaluate a projection built together with a qual by
+ * ExecBuildQualProjectionInfo.  If the qual is satisfied, the projected row
+ * is stored into the result slot and the slot is returned; otherwise the
+ * result slot is left empty and NULL is returned.
+ */
+static inline TupleTableSlot *
+ExecQualAndProject(ProjectionInfo *projInfo)
+{
+	ExprContext *econtext = projInfo->pi_exprContext;
+	ExprState  *state = &projInfo->pi_state;
+	TupleTableSlot *slot = state->resultslot;
+	Datum		ret;
+	bool		isnull;
+
+	ExecClearTuple(slot);
+
+	/* the scalar result says whether the qual was satisfied */
+	ret = ExecEvalExprSwitchContext(state, econtext, &isnull);
+
+	Assert(!isnull);
+	if (!DatumGetBool(ret))
+		return NULL;
+
+	slot->tts_flags &= ~TTS_FLAG_EMPTY;
+	slot->tts_nvalid = slot->tts_tupleDescriptor->natts;
+
+	return slot;
+}
 #endif
 
 /*
@@ -424,6 +530,30 @@ extern Datum ExecMakeFunctionResultSet(SetExprState *fcache,
 									   bool *isNull,
 									   ExprDoneCond *isDone);
 
+/*
+ * prototypes from functions in execBatch.c
+ */
+extern PGDLLIMPORT int executor_batch_size;
+
+extern bool ExecPlanCanProduceBatches(Plan *plan);
+extern TupleBatch *ExecInitTupleBatch(EState *estate, TupleDesc tupdesc,
+									  const TupleTableSlotOps *tts_ops);
+extern void ExecClearTupleBatch(TupleBatch *batch, int from);
+extern void ExecQualBatch(ExprState *qual, ExprContext *econtext,
+						  TupleTableSlot **econtext_slot, TupleBatch *batch);
+extern void ExecProjectBatch(ProjectionInfo *projInfo,
+							 TupleTableSlot **econtext_slot,
+							 TupleBatch *input, TupleBatch *result);
+
+/*
+ * prototypes from functions in execExprVector.c
+ */
+typedef struct VectorQualState VectorQualState;
+
+extern VectorQualState *ExecInitVectorQual(List *qual, PlanState *parent);
+extern void ExecVectorQual(VectorQualState *vqstate, ExprContext *econtext,
+						   TupleTableSlot **econtext_slot, TupleBatch *batch);
+
 /*
  * prototypes from functions in execScan.c
  */
@@ -432,8 +562,15 @@ typedef bool (*ExecScanRecheckMtd) (ScanState *node, TupleTableSlot *slot);
 
 extern TupleTableSlot *ExecScan(ScanState *node, ExecScanAccessMtd accessMtd,
 								ExecScanRecheckMtd recheckMtd);
+typedef int (*ExecScanBatchAccessMtd) (ScanState *node, TupleBatch *batch);
+
+extern TupleBatch *ExecScanBatch(ScanState *node,
+								 ExecScanBatchAccessMtd batchAccessMtd,
+								 ExecScanAccessMtd accessMtd,
+								 ExecScanRecheckMtd recheckMtd);
 extern void ExecAssignScanProjectionInfo(ScanState *node);
 extern void ExecAssignScanProjectionInfoWithVarno(ScanState *node, Index varno);
+extern void ExecAssignScanQualProjectionInfo(ScanState *node, List *qual);
 extern void ExecScanReScan(ScanState *node);
 
 /*
@@ -527,6 +664,10 @@ extern void ExecAssignProjectionInfo(PlanState *planstate,
 									 TupleDesc inputDesc);
 extern void ExecConditionalAssignProjectionInfo(PlanState *planstate,
 												TupleDesc inputDesc, Index varno);
+extern ProjectionInfo *ExecConditionalAssignQualProjectionInfo(PlanState *planstate,
+															   TupleDesc inputDesc,
+															   Index varno,
+															   List *qual);
 extern void ExecFreeExprContext(PlanState *planstate);
 extern void ExecAssignScanType(ScanState *scanstate, TupleDesc tupDesc);
 extern void ExecCreateScanSlotFromOuterPlan(EState *estate,
@@ -574,7 +715,10 @@ extern TupleTableSlot *ExecGetReturningSlot(EState *estate, ResultRelInfo *relIn
 extern void ExecOpenIndices(ResultRelInfo *resultRelInfo, bool speculative);
 extern void ExecCloseIndices(ResultRelInfo *resultRelInfo);
 extern List *ExecInsertIndexTuples(TupleTableSlot *slot, EState *estate, bool noDupErr,
-								   bool *specConflict, List *arbiterIndexes);
+								   bool *specConflict, List *arbiterIndexes,
+								   bool skipMultiInsert, bool onlySummarizing);
+extern void ExecInsertIndexTuplesMulti(TupleTableSlot **slots, int nslots,
+									   EState *estate);
 extern bool ExecCheckIndexConstraints(TupleTableSlot *slot, EState *estate,
 									  ItemPointer conflictTid, List *arbiterIndexes);
 extern void check_exclusion_constraint(Relation heap, Relation index,
@@ -80,6 +80,18 @@ typedef struct HashJoinTupleData
 #define HJTUPLE_MINTUPLE(hjtup)  \
 	((MinimalTuple) ((char *) (hjtup) + HJTUPLE_OVERHEAD))
 
+/*
+ * Each bucket of a private (not Parallel Hash) hash table has a 16-bit tag
+ * summarizing the hash values of its tuples: each tuple sets the bit chosen
+ * by the top bits of its hash value.  The bucket number comes from the
+ * bottom bits and the batch number from the ones just above, so the tag bit
+ * is independent of both unless there are very many buckets and batches.
+ */
+#define HJ_BUCKET_TAG(hashvalue)	((uint16) (1 << ((hashvalue) >> 28)))
+
+/* Space per bucket of a private hash table: list head plus tag */
+#define HJ_BUCKET_BYTES		(sizeof(HashJoinTuple) + sizeof(uint16))
+
 /*
  * If the outer relation's distribution is sufficiently nonuniform, we attempt
  * to optimize the join by treating the hash values corresponding to the outer
@@ -110,6 +122,15 @@ typedef struct HashSkewBucket
 #define SKEW_HASH_MEM_PERCENT  2
 #define SKEW_MIN_OUTER_FRACTION  0.01
 
+/*
+ * The bloom filter collected for the outer scan, if any, is limited to
+ * BLOOM_HASH_MEM_PERCENT of the total memory allowed for the join, and
+ * counted in the hash table's spaceUsed.  It's never made smaller than
+ * BLOOM_MIN_SIZE_KB though.
+ */
+#define BLOOM_HASH_MEM_PERCENT	10
+#define BLOOM_MIN_SIZE_KB		8
+
 /*
  * To reduce palloc overhead, the HashJoinTuples for the current batch are
  * packed in 32kB buffers instead of pallocing each tuple individually.
@@ -299,6 +320,15 @@ typedef struct HashJoinTableData
 		dsa_pointer_atomic *shared;
 	}			buckets;
 
+	/*
+	 * bucketTags[i] is the tag of the i'th bucket of a private hash table
+	 * (see HJ_BUCKET_TAG).  A probe whose bit isn't set can give up on the
+	 * bucket without following its list.  The tags are allocated along with
+	 * the unshared bucket array; a quarter of its size, they're more likely
+	 * to stay in cache.
+	 */
+	uint16	   *bucketTags;
+
 	bool		keepNulls;		/* true to store unmatchable NULL tuples */
 
 	bool		skewEnabled;	/* are we using skew optimization? */
@@ -329,6 +359,28 @@ typedef struct HashJoinTableData
 	BufFile   **innerBatchFile; /* buffered virtual temp file per batch */
 	BufFile   **outerBatchFile; /* buffered virtual temp file per batch */
 
+	/*
+	 * A batch that doesn't fit in memory, but can't be split any further
+	 * (typically because its tuples all have the same hash value), is
+	 * processed in fragments, like a block nested loop join: the inner
+	 * tuples that don't fit are written to innerFragmentFile, and once the
+	 * batch's outer tuples have been probed against the hash table, it is
+	 * reloaded from there and the outer tuples are read again.  Batch 0's
+	 * outer tuples come from the outer plan, so they're saved in
+	 * outerFragmentFile for its later fragments.  outerMatched[] has a bit
+	 * for each outer tuple of the batch, in the order they're read, set once
+	 * it has found a match in some fragment; outerTupleNo is the number of
+	 * the current outer tuple, or -1 if its matches needn't be tracked.
+	 */
+	BufFile    *innerFragmentFile;	/* inner tuples of the next fragment */
+	BufFile    *outerFragmentFile;	/* batch 0's outer tuples */
+	int			curfragment;	/* current fragment #; 0 in 1st pass */
+	bool		fragmented;		/* has any batch needed fragments? */
+	bits8	   *outerMatched;	/* match bits of the batch's outer tuples */
+	long		outerMatchedLen;	/* allocated length of outerMatched[] */
+	long		nOuterTuples;	/* # of outer tuples read in this fragment */
+	long		outerTupleNo;	/* number of current outer tuple, or -1 */
+
 	/*
 	 * Info about the datatype-specific hash functions for the datatypes being
 	 * hashed. These are arrays of the same length as the number of hash join
@@ -344,10 +396,18 @@ typedef struct HashJoinTableData
 	Size		spacePeak;		/* peak space used */
 	Size		spaceUsedSkew;	/* skew hash table's current space usage */
 	Size		spaceAllowedSkew;	/* upper limit for skew hashtable */
+	Size		spaceUsedBloom; /* bloom filter's space, also in spaceUsed */
 
 	MemoryContext hashCxt;		/* context for whole-hash-join storage */
 	MemoryContext batchCxt;		/* context for this-batch-only storage */
 
+	/*
+	 * Bloom filter of the hash values of all inner tuples, for the outer
+	 * scan to check its rows against; allocated in hashCxt.  NULL unless
+	 * the planner pushed a filter down into the outer scan.
+	 */
+	struct bloom_filter *bloomfilter;
+
 	/* used for dense allocation of tuples (into linked chunks) */
 	HashMemoryChunk chunks;		/* one list for the whole batch */
 
@@ -46,21 +46,40 @@ typedef enum InstrumentOption
 	INSTRUMENT_BUFFERS = 1 << 1,	/* needs buffer usage */
 	INSTRUMENT_ROWS = 1 << 2,	/* needs row count */
 	INSTRUMENT_WAL = 1 << 3,	/* needs WAL usage */
-	INSTRUMENT_ALL = PG_INT32_MAX
+	INSTRUMENT_ALL = (1 << 16) - 1	/* all of the above, without sampling */
 } InstrumentOption;
 
+/*
+ * With INSTRUMENT_TIMER, a node can time only every Nth call rather than all
+ * of them, and extrapolate its total time from those, which makes timing
+ * much cheaper for nodes returning many tuples.  N is kept in the upper bits
+ * of instrument_options, so that it reaches parallel workers along with the
+ * flags; 0 or 1 means to time every call.
+ */
+#define INSTRUMENT_SAMPLE_SHIFT		16
+#define INSTRUMENT_SAMPLE_MAX		(PG_INT32_MAX >> INSTRUMENT_SAMPLE_SHIFT)
+#define INSTRUMENT_SAMPLE(interval) \
+	((int) (interval) << INSTRUMENT_SAMPLE_SHIFT)
+#define INSTRUMENT_SAMPLE_INTERVAL(instrument_options) \
+	(((instrument_options) >> INSTRUMENT_SAMPLE_SHIFT) & INSTRUMENT_SAMPLE_MAX)
+
 typedef struct Instrumentation
 {
 	/* Parameters set at node creation: */
 	bool		need_timer;		/* true if we need timer data */
 	bool		need_bufusage;	/* true if we need buffer usage data */
 	bool		need_walusage;	/* true if we need WAL usage data */
+	int			sample_interval;	/* time every Nth call, if > 1 */
 	/* Info about current plan cycle: */
 	bool		running;		/* true if we've completed first tuple */
 	instr_time	starttime;		/* start time of current iteration of node */
 	instr_time	counter;		/* accumulated runtime for this node */
 	double		firsttuple;		/* time for first tuple of this cycle */
 	double		tuplecount;		/* # of tuples emitted so far this cycle */
+	int			sample_countdown;	/* # of calls to skip before next timed
+									 * one */
+	double		ncalls;			/* # of calls this cycle, if sampling */
+	double		nsampled;		/* # of timed calls this cycle, if sampling */
 	BufferUsage bufusage_start; /* buffer usage at start */
 	WalUsage	walusage_start; /* WAL usage at start */
 	/* Accumulated statistics across all completed cycles: */
@@ -88,6 +107,7 @@ extern Instrumentation *InstrAlloc(int n, int instrument_options);
 extern void InstrInit(Instrumentation *instr, int instrument_options);
 extern void InstrStartNode(Instrumentation *instr);
 extern void InstrStopNode(Instrumentation *instr, double nTuples);
+extern void InstrUpdateTupleCount(Instrumentation *instr, double nTuples);
 extern void InstrEndLoop(Instrumentation *instr);
 extern void InstrAggNode(Instrumentation *dst, Instrumentation *add);
 extern void InstrStartParallelQuery(void);
@@ -137,6 +137,13 @@ typedef struct AggStatePerTransData
 	TupleTableSlot *uniqslot;	/* used for multi-column DISTINCT */
 	TupleDesc	sortdesc;		/* descriptor of input tuples */
 
+	/*
+	 * Input column of the aggregate (0 if it has no arguments), when the
+	 * transition can be advanced a batch of input tuples at a time; see
+	 * advance_aggregates_batch().
+	 */
+	AttrNumber	batchInputAttno;
+
 	/*
 	 * These values are working state that is initialized at the start of an
 	 * input tuple group and updated for each input tuple.
@@ -26,6 +26,8 @@ extern void ExecReScanHash(HashState *node);
 
 extern HashJoinTable ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 										 bool keepNulls);
+extern void ExecHashTableCreateBloomFilter(HashJoinTable hashtable,
+										   double ntuples);
 extern void ExecParallelHashTableAlloc(HashJoinTable hashtable,
 									   int batchno);
 extern void ExecHashTableDestroy(HashJoinTable hashtable);
@@ -86,6 +86,8 @@ extern bool jit_dump_bitcode;
 extern bool jit_expressions;
 extern bool jit_profiling_support;
 extern bool jit_tuple_deforming;
+extern bool jit_cache_deforming;
+extern bool jit_fuse_scans;
 extern double jit_above_cost;
 extern double jit_inline_above_cost;
 extern double jit_optimize_above_cost;
@@ -132,6 +132,13 @@ typedef struct Port
 	char	   *remote_port;	/* text rep of remote port */
 	CAC_state	canAcceptConnections;	/* postmaster connection status */
 
+	/*
+	 * Set if the connection comes from a connection proxy, see proxy.c.  raddr
+	 * is then the address of the proxy's client.
+	 */
+	bool		proxied;
+	bool		proxy_trusted;	/* proxy vouches for the client */
+
 	/*
 	 * Information that needs to be saved from the startup packet and passed
 	 * into backend execution.  "char *" fields are NULL if not set.
@@ -205,4 +205,17 @@ typedef struct CancelRequestPacket
 #define NEGOTIATE_SSL_CODE PG_PROTOCOL(1234,5679)
 #define NEGOTIATE_GSS_CODE PG_PROTOCOL(1234,5680)
 
+
+/*
+ * A client can ask for the rest of the session to be compressed with the
+ * _pq_.compression startup parameter.  If the server agrees, everything that
+ * follows its CompressionAck message is sent in chunks, in both directions.
+ * Each chunk has a header of two uint32s in network byte order: the length
+ * of the compressed data that follows, at most PQ_COMPRESSION_MAX_COMPRESSED,
+ * and its length uncompressed, at most PQ_COMPRESSION_CHUNK_SIZE.
+ */
+#define PQ_COMPRESSION_HEADER_SIZE		8
+#define PQ_COMPRESSION_CHUNK_SIZE		8192
+#define PQ_COMPRESSION_MAX_COMPRESSED	(2 * PQ_COMPRESSION_CHUNK_SIZE)
+
 #endif							/* PQCOMM_H */
@@ -17,6 +17,7 @@
 #include "access/tupconvert.h"
 #include "executor/instrument.h"
 #include "fmgr.h"
+#include "lib/ilist.h"
 #include "lib/pairingheap.h"
 #include "nodes/params.h"
 #include "nodes/plannodes.h"
@@ -447,6 +448,13 @@ typedef struct ResultRelInfo
 	/* true when modifying foreign table directly */
 	bool		ri_usesFdwDirectModify;
 
+	/* batch insert stuff */
+	int			ri_NumSlots;	/* number of slots in the array */
+	int			ri_NumSlotsInitialized; /* number of initialized slots */
+	int			ri_BatchSize;	/* max slots inserted in a single batch */
+	TupleTableSlot **ri_Slots;	/* input tuples for batch insert */
+	TupleTableSlot **ri_PlanSlots;
+
 	/* list of WithCheckOption's to be checked */
 	List	   *ri_WithCheckOptions;
 
@@ -704,6 +712,7 @@ typedef struct TupleHashTableData
 	MemoryContext tablecxt;		/* memory context containing table */
 	MemoryContext tempcxt;		/* context for function evaluations */
 	Size		entrysize;		/* actual size to make each hash entry */
+	Size		additionalsize; /* MAXALIGN'd size of each entry's user data */
 	TupleTableSlot *tableslot;	/* slot for referencing table entries */
 	/* The following fields are set transiently for each table search: */
 	TupleTableSlot *inputslot;	/* current input tuple's slot */
@@ -933,6 +942,37 @@ typedef struct DomainConstraintState
  */
 typedef TupleTableSlot *(*ExecProcNodeMtd) (struct PlanState *pstate);
 
+/* ----------------
+ *	 TupleBatch
+ *
+ * A group of tuples passed between executor nodes that support the batch
+ * protocol (see execBatch.c).  slots[0 .. nvalid-1] hold the tuples
+ * produced; selection[0 .. nselected-1] are the indexes, in ascending order,
+ * of those that passed the node's qual.  A batch with nselected == 0 means
+ * that there are no more tuples.  "next" is a cursor for consumers that
+ * hand the tuples out one by one.
+ * ----------------
+ */
+typedef struct TupleBatch
+{
+	int			maxslots;		/* allocated length of slots[] */
+	int			nvalid;			/* # of slots holding a tuple */
+	int			nselected;		/* # of entries in selection[] */
+	int			next;			/* consumer's position in selection[] */
+	uint16	   *selection;		/* indexes of the qualifying slots */
+	TupleTableSlot **slots;
+} TupleBatch;
+
+/* ----------------
+ *	 ExecProcNodeBatchMtd
+ *
+ * This is the method called by ExecProcNodeBatch to return the next batch
+ * of tuples from an executor node.  Nodes that don't support the batch
+ * protocol leave it NULL.
+ * ----------------
+ */
+typedef TupleBatch *(*ExecProcNodeBatchMtd) (struct PlanState *pstate);
+
 /* ----------------
  *		PlanState node
  *
@@ -953,6 +993,8 @@ typedef struct PlanState
 	ExecProcNodeMtd ExecProcNode;	/* function to return next tuple */
 	ExecProcNodeMtd ExecProcNodeReal;	/* actual function, if above is a
 										 * wrapper */
+	ExecProcNodeBatchMtd ExecProcNodeBatch; /* function to return next
+											 * batch, or NULL */
 
 	Instrumentation *instrument;	/* Optional runtime stats for this node */
 	WorkerInstrumentation *worker_instrument;	/* per-worker instrumentation */
@@ -985,6 +1027,7 @@ typedef struct PlanState
 	TupleTableSlot *ps_ResultTupleSlot; /* slot for my result tuples */
 	ExprContext *ps_ExprContext;	/* node's expression-evaluation context */
 	ProjectionInfo *ps_ProjInfo;	/* info for doing tuple projection */
+	TupleBatch *ps_ResultBatch; /* batch of my result tuples, if any */
 
 	/*
 	 * Scanslot's descriptor if known. This is a bit of a hack, but otherwise
@@ -1028,6 +1071,8 @@ typedef struct PlanState
 	bool		outeropsset;
 	bool		inneropsset;
 	bool		resultopsset;
+
+	bool		async_capable;	/* true if node is async-capable */
 } PlanState;
 
 /* ----------------
@@ -1199,16 +1244,36 @@ typedef struct ModifyTableState
 	TupleConversionMap **mt_per_subplan_tupconv_maps;
 } ModifyTableState;
 
+/* ----------------
+ * AsyncRequest
+ *
+ * State for an asynchronous tuple request.
+ * ----------------
+ */
+typedef struct AsyncRequest
+{
+	struct PlanState *requestor;	/* Node that wants a tuple */
+	struct PlanState *requestee;	/* Node from which a tuple is wanted */
+	int			request_index;	/* Scratch space for requestor */
+	bool		callback_pending;	/* Callback is needed */
+	bool		request_complete;	/* Request complete, result valid */
+	TupleTableSlot *result;		/* Result (NULL or an empty slot if no more
+								 * tuples) */
+} AsyncRequest;
+
 /* ----------------
  *	 AppendState information
  *
  *		nplans				how many plans are in the array
- *		whichplan			which plan is being executed (0 .. n-1), or a
- *							special negative value. See nodeAppend.c.
+ *		whichplan			which synchronous plan is being executed (0 ..
+ *							n-1), or a special negative value. See
+ *							nodeAppend.c.
  *		prune_state			details required to allow partitions to be
  *							eliminated from the scan, or NULL if not possible.
- *		valid_subplans		for runtime pruning, valid appendplans indexes to
- *							scan.
+ *		valid_subplans		for runtime pruning, valid synchronous
+ *							appendplans indexes to scan.
+ *		valid_asyncplans	for runtime pruning, valid asynchronous
+ *							appendplans indexes to scan.
  * ----------------
  */
 
@@ -1224,12 +1289,26 @@ struct AppendState
 	PlanState **appendplans;	/* array of PlanStates for my inputs */
 	int			as_nplans;
 	int			as_whichplan;
+	bool		as_begun;		/* false means need to initialize */
+	Bitmapset  *as_asyncplans;	/* asynchronous plans indexes */
+	int			as_nasyncplans; /* # of asynchronous plans */
+	AsyncRequest **as_asyncrequests;	/* array of AsyncRequests */
+	TupleTableSlot **as_asyncresults;	/* unreturned results of async plans */
+	int			as_nasyncresults;	/* # of valid entries in as_asyncresults */
+	bool		as_syncdone;	/* true if all synchronous plans done in
+								 * asynchronous mode, else false */
+	int			as_nasyncremain;	/* # of remaining asynchronous plans */
+	Bitmapset  *as_needrequest; /* asynchronous plans needing a new request */
+	struct WaitEventSet *as_eventset;	/* WaitEventSet used to configure file
+										 * descriptor wait events */
 	int			as_first_partial_plan;	/* Index of 'appendplans' containing
 										 * the first partial plan */
 	ParallelAppendState *as_pstate; /* parallel coordination info */
 	Size		pstate_len;		/* size of parallel coordination info */
 	struct PartitionPruneState *as_prune_state;
+	bool		as_valid_subplans_identified;	/* is as_valid_subplans valid? */
 	Bitmapset  *as_valid_subplans;
+	Bitmapset  *as_valid_asyncplans;	/* valid asynchronous plans indexes */
 	bool		(*choose_next_subplan) (AppendState *);
 };
 
@@ -1327,6 +1406,12 @@ typedef struct BitmapOrState
  *		currentRelation    relation being scanned (NULL if none)
  *		currentScanDesc    current scan descriptor for scan (NULL if none)
  *		ScanTupleSlot	   pointer to slot in tuple table holding scan tuple
+ *		ScanBatch		   batch of scan tuples, when producing batches
+ *		ScanBatchDone	   true once a batch came back short, i.e. the scan
+ *						   has reached its end (reset by rescans)
+ *		VectorQual		   vectorized form of the qual, for batches
+ *		QualProjInfo	   qual and projection built as one expression, if
+ *						   they are (see ExecAssignScanQualProjectionInfo)
  * ----------------
  */
 typedef struct ScanState
@@ -1335,6 +1420,10 @@ typedef struct ScanState
 	Relation	ss_currentRelation;
 	struct TableScanDescData *ss_currentScanDesc;
 	TupleTableSlot *ss_ScanTupleSlot;
+	TupleBatch *ss_ScanBatch;
+	bool		ss_ScanBatchDone;
+	struct VectorQualState *ss_VectorQual;
+	ProjectionInfo *ss_QualProjInfo;
 } ScanState;
 
 /* ----------------
@@ -1345,6 +1434,24 @@ typedef struct SeqScanState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 	Size		pscan_len;		/* size of parallel heap scan descriptor */
+
+	/*
+	 * Bloom filter pushed down by the hash join above us.  hashfilter is set
+	 * by the join once it has built its hash table, or attached to the copy
+	 * in shared memory when we're a parallel worker; it's NULL whenever
+	 * there's no filter to apply.
+	 */
+	struct bloom_filter *hashfilter;
+	FmgrInfo   *hashfilter_functions;	/* outer hash function per key */
+	bool	   *hashfilter_strict;	/* is each join operator strict? */
+	struct SharedHashFilter *shared_hashfilter; /* copy in DSM, or NULL */
+
+	/*
+	 * Columns we need from the table, to pass to table AMs that can make use
+	 * of that; see table_scan_set_projection().
+	 */
+	bool		project_scan;	/* is scan_attrs valid? */
+	Bitmapset  *scan_attrs;		/* as returned by pull_varattnos() */
 } SeqScanState;
 
 /* ----------------
@@ -1460,6 +1567,8 @@ typedef struct IndexScanState
  *		TableSlot		   slot for holding tuples fetched from the table
  *		VMBuffer		   buffer in use for visibility map testing, if any
  *		PscanLen		   size of parallel index-only scan descriptor
+ *		HeapFetches		   number of tuples that had to be fetched from the heap
+ *		LastHeapFetchBlock heap block of the most recent such fetch
  * ----------------
  */
 typedef struct IndexOnlyScanState
@@ -1479,6 +1588,8 @@ typedef struct IndexOnlyScanState
 	TupleTableSlot *ioss_TableSlot;
 	Buffer		ioss_VMBuffer;
 	Size		ioss_PscanLen;
+	uint64		ioss_HeapFetches;
+	BlockNumber ioss_LastHeapFetchBlock;
 } IndexOnlyScanState;
 
 /* ----------------
@@ -1932,6 +2043,14 @@ typedef struct MergeJoinState
  *		hj_JoinState			current state of ExecHashJoin state machine
  *		hj_MatchedOuter			true if found a join match for current outer
  *		hj_OuterNotEmpty		true if outer relation known not empty
+ *		hj_OuterTupleBatchMode	true if outer tuples are fetched in batches
+ *		hj_OuterTupleBatch		current batch of outer tuples, if any
+ *		hj_FilterScan			outer scan to push our bloom filter into,
+ *								or NULL
+ *		hj_OuterBatchHashed		true if the hash values of the rest of the
+ *								current outer batch have been computed
+ *		hj_OuterBatchHashValues	those hash values, by position in the batch
+ *		hj_OuterBatchHashValid	false where the tuple can't match (NULL key)
  * ----------------
  */
 
@@ -1959,6 +2078,12 @@ typedef struct HashJoinState
 	int			hj_JoinState;
 	bool		hj_MatchedOuter;
 	bool		hj_OuterNotEmpty;
+	bool		hj_OuterTupleBatchMode;
+	TupleBatch *hj_OuterTupleBatch;
+	struct SeqScanState *hj_FilterScan;
+	bool		hj_OuterBatchHashed;
+	uint32	   *hj_OuterBatchHashValues;
+	bool	   *hj_OuterBatchHashValid;
 } HashJoinState;
 
 
@@ -1982,8 +2107,82 @@ typedef struct MaterialState
 	int			eflags;			/* capability flags to pass to tuplestore */
 	bool		eof_underlying; /* reached end of underlying plan? */
 	Tuplestorestate *tuplestorestate;
+	struct ParallelMaterialState *pstate;	/* shared state of a Parallel
+											 * Materialize */
+	struct ParallelMaterialReader *preader; /* our reading position in it */
 } MaterialState;
 
+struct ResultCacheEntry;
+struct ResultCacheTuple;
+struct ResultCacheKey;
+
+/* ----------------
+ *	 Instrumentation information for Result Cache
+ * ----------------
+ */
+typedef struct ResultCacheInstrumentation
+{
+	uint64		cache_hits;		/* number of rescans where we've found the
+								 * scan parameters values to be cached */
+	uint64		cache_misses;	/* number of rescans where we've not found the
+								 * scan parameters values to be cached */
+	uint64		cache_evictions;	/* number of cache entries removed due to
+									 * the need to free memory */
+	uint64		cache_overflows;	/* number of times we've had to bypass the
+									 * cache when filling it due to not being
+									 * able to free enough space to store the
+									 * current scan's tuples */
+	uint64		mem_peak;		/* peak memory usage in bytes */
+} ResultCacheInstrumentation;
+
+/* ----------------
+ *	 Shared memory container for per-worker resultcache information
+ * ----------------
+ */
+typedef struct SharedResultCacheInfo
+{
+	int			num_workers;
+	ResultCacheInstrumentation sinstrument[FLEXIBLE_ARRAY_MEMBER];
+} SharedResultCacheInfo;
+
+/* ----------------
+ *	 ResultCacheState information
+ *
+ *		resultcache nodes are used to cache recent and commonly seen results
+ *		from a parameterized scan.
+ * ----------------
+ */
+typedef struct ResultCacheState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	int			rc_status;		/* value of ExecResultCache state machine */
+	int			nkeys;			/* number of cache keys */
+	struct resultcache_hash *hashtable; /* hash table for cache entries */
+	TupleDesc	hashkeydesc;	/* tuple descriptor for cache keys */
+	TupleTableSlot *tableslot;	/* min tuple slot for existing cache entries */
+	TupleTableSlot *probeslot;	/* virtual slot used for hash lookups */
+	ExprState  *cache_eq_expr;	/* Compare exec params to hash key */
+	ExprState **param_exprs;	/* exprs containing the parameters to this
+								 * node */
+	FmgrInfo   *hashfunctions;	/* lookup data for hash funcs nkeys in size */
+	Oid		   *collations;		/* collation for comparisons nkeys in size */
+	Bitmapset  *keyparamids;	/* IDs of the Params used in param_exprs */
+	uint64		mem_used;		/* bytes of memory used by cache */
+	uint64		mem_limit;		/* memory limit in bytes for the cache */
+	MemoryContext tableContext; /* memory context to store cache data */
+	dlist_head	lru_list;		/* least recently used entry list */
+	struct ResultCacheTuple *last_tuple;	/* Used to point to the last tuple
+											 * returned during a cache hit and
+											 * the tuple we last stored when
+											 * populating the cache. */
+	struct ResultCacheEntry *entry; /* the entry that 'last_tuple' belongs to
+									 * or NULL if 'last_tuple' is NULL. */
+	bool		singlerow;		/* true if the cache entry is to be marked as
+								 * complete after caching the first tuple. */
+	ResultCacheInstrumentation stats;	/* execution statistics */
+	SharedResultCacheInfo *shared_info; /* statistics for parallel workers */
+} ResultCacheState;
+
 
 /* ----------------
  *	 When performing sorting by multiple keys, it's possible that the input
@@ -2025,6 +2224,7 @@ typedef struct SortState
 	void	   *tuplesortstate; /* private state of tuplesort.c */
 	bool		am_worker;		/* are we a worker? */
 	SharedSortInfo *shared_info;	/* one entry per worker */
+	struct ParallelSortState *pstate;	/* shared state of a Parallel Sort */
 } SortState;
 
 /* ----------------
@@ -2188,6 +2388,7 @@ typedef struct AggState
 	bool		table_filled;	/* hash table filled yet? */
 	int			num_hashes;
 	MemoryContext hash_metacxt; /* memory for hash table itself */
+	MemoryContext hash_tablecxt;	/* memory for hash table entries */
 	struct HashTapeInfo *hash_tapeinfo; /* metadata for spill tapes */
 	struct HashAggSpill *hash_spills;	/* HashAggSpill for each grouping set,
 										 * exists only during first pass */
@@ -2218,6 +2419,12 @@ typedef struct AggState
 										 * ->hash_pergroup */
 	ProjectionInfo *combinedproj;	/* projection machinery */
 	SharedAggInfo *shared_info; /* one entry per worker */
+
+	/* support for fetching input tuples in batches: */
+	bool		input_batch_mode;	/* fetch input tuples in batches? */
+	TupleBatch *input_batch;	/* current batch of input tuples, if any */
+	bool		input_batch_trans;	/* advance transitions by batches? */
+	int			input_batch_natts;	/* # of input columns they need */
 } AggState;
 
 /* ----------------
@@ -2428,6 +2635,31 @@ typedef struct HashState
 	struct ParallelHashJoinState *parallel_state;
 } HashState;
 
+/* ----------------
+ *	 RepartitionState information
+ *
+ *		hashfunctions	   hash functions for the partition key columns
+ *		pstate			   shared state, in a parallel query
+ *		accessors		   one for each shared partition
+ *		written			   have we written out our subplan's tuples yet?
+ *		curpartition	   partition being returned, or -1
+ *		done			   have we returned all our partitions?
+ * ----------------
+ */
+struct ParallelRepartitionState;
+struct SharedTuplestoreAccessor;
+
+typedef struct RepartitionState
+{
+	PlanState	ps;				/* its first field is NodeTag */
+	FmgrInfo   *hashfunctions;
+	struct ParallelRepartitionState *pstate;
+	struct SharedTuplestoreAccessor **accessors;
+	bool		written;
+	int			curpartition;
+	bool		done;
+} RepartitionState;
+
 /* ----------------
  *	 SetOpState information
  *
@@ -73,6 +73,7 @@ typedef enum NodeTag
 	T_MergeJoin,
 	T_HashJoin,
 	T_Material,
+	T_ResultCache,
 	T_Sort,
 	T_IncrementalSort,
 	T_Group,
@@ -82,6 +83,7 @@ typedef enum NodeTag
 	T_Gather,
 	T_GatherMerge,
 	T_Hash,
+	T_Repartition,
 	T_SetOp,
 	T_LockRows,
 	T_Limit,
@@ -130,6 +132,7 @@ typedef enum NodeTag
 	T_MergeJoinState,
 	T_HashJoinState,
 	T_MaterialState,
+	T_ResultCacheState,
 	T_SortState,
 	T_IncrementalSortState,
 	T_GroupState,
@@ -139,6 +142,7 @@ typedef enum NodeTag
 	T_GatherState,
 	T_GatherMergeState,
 	T_HashState,
+	T_RepartitionState,
 	T_SetOpState,
 	T_LockRowsState,
 	T_LimitState,
@@ -241,9 +245,11 @@ typedef enum NodeTag
 	T_MergeAppendPath,
 	T_GroupResultPath,
 	T_MaterialPath,
+	T_ResultCachePath,
 	T_UniquePath,
 	T_GatherPath,
 	T_GatherMergePath,
+	T_RepartitionPath,
 	T_ProjectionPath,
 	T_ProjectSetPath,
 	T_SortPath,
@@ -283,6 +289,7 @@ typedef enum NodeTag
 	T_AllocSetContext,
 	T_SlabContext,
 	T_GenerationContext,
+	T_BumpContext,
 
 	/*
 	 * TAGS FOR VALUE NODES (value.h)
@@ -481,6 +488,7 @@ typedef enum NodeTag
 	T_PartitionRangeDatum,
 	T_PartitionCmd,
 	T_VacuumRelation,
+	T_PublicationTable,
 
 	/*
 	 * TAGS FOR REPLICATION GRAMMAR PARSE NODES (replnodes.h)
@@ -124,6 +124,10 @@ typedef struct PlannerGlobal
 
 	List	   *appendRelations;	/* "flat" list of AppendRelInfos */
 
+	List	   *partPruneInfos; /* lock-time prunable PartitionPruneInfos */
+
+	Bitmapset  *prunableRelids; /* RT indexes of leaves those might prune */
+
 	List	   *relationOids;	/* OIDs of relations the plan depends on */
 
 	List	   *invalItems;		/* other dependencies, as PlanInvalItems */
@@ -362,6 +366,9 @@ struct PlannerInfo
 
 	/* Does this query modify any partition key columns? */
 	bool		partColsUpdated;
+
+	/* pg_statistic slots already looked up; see get_vardata_attstatsslot */
+	struct HTAB *stats_slot_cache;
 };
 
 
@@ -600,6 +607,7 @@ typedef struct PartitionSchemeData *PartitionScheme;
  *		partbounds_merged - true if partition bounds are merged ones
  *		partition_qual - Partition constraint if not the root
  *		part_rels - RelOptInfos for each partition
+ *		live_parts - Indexes of the non-NULL entries of part_rels
  *		all_partrels - Relids set of all partition relids
  *		partexprs, nullable_partexprs - Partition key expressions
  *		partitioned_child_rels - RT indexes of unpruned partitions of
@@ -749,6 +757,8 @@ typedef struct RelOptInfo
 	List	   *partition_qual; /* Partition constraint, if not the root */
 	struct RelOptInfo **part_rels;	/* Array of RelOptInfos of partitions,
 									 * stored in the same order as bounds */
+	Bitmapset  *live_parts;		/* Indexes into part_rels[] of the
+								 * partitions that survived pruning */
 	Relids		all_partrels;	/* Relids set of all partition relids */
 	List	  **partexprs;		/* Non-nullable partition key expressions */
 	List	  **nullable_partexprs; /* Nullable partition key expressions */
@@ -1456,6 +1466,26 @@ typedef struct MaterialPath
 	Path	   *subpath;
 } MaterialPath;
 
+/*
+ * ResultCachePath represents a ResultCache plan node, i.e., a cache of the
+ * output of a parameterized subpath, keyed on the values of its parameters.
+ * This is used for the inner side of nested loops that are expected to be
+ * rescanned repeatedly with the same parameter values.
+ */
+typedef struct ResultCachePath
+{
+	Path		path;
+	Path	   *subpath;		/* path whose output is cached */
+	List	   *hash_operators; /* hash operators for each key */
+	List	   *param_exprs;	/* cache keys */
+	bool		singlerow;		/* true if a cache entry is complete after
+								 * caching its first tuple */
+	double		calls;			/* expected number of rescans */
+	uint32		est_entries;	/* maximum number of entries the planner
+								 * expects to fit in the cache, or 0 if
+								 * unknown */
+} ResultCachePath;
+
 /*
  * UniquePath represents elimination of distinct rows from the output of
  * its subpath.
@@ -1508,6 +1538,18 @@ typedef struct GatherMergePath
 	int			num_workers;	/* number of workers sought to help */
 } GatherMergePath;
 
+/*
+ * RepartitionPath represents redistributing the rows of a partial path
+ * among the workers by hashing the grouping columns, so that the rows of
+ * each group all go to the same worker.
+ */
+typedef struct RepartitionPath
+{
+	Path		path;
+	Path	   *subpath;		/* path for each worker */
+	List	   *groupClause;	/* a list of SortGroupClause's */
+} RepartitionPath;
+
 
 /*
  * All join-type paths share these fields.
@@ -83,6 +83,12 @@ typedef struct PlannedStmt
 
 	List	   *rowMarks;		/* a list of PlanRowMark's */
 
+	/* PartitionPruneInfos whose initial pruning may be done before locking */
+	List	   *partPruneInfos;
+
+	/* RT indexes of leaf partitions that those might prune */
+	Bitmapset  *prunableRelids;
+
 	List	   *relationOids;	/* OIDs of relations the plan depends on */
 
 	List	   *invalItems;		/* other dependencies, as PlanInvalItems */
@@ -135,6 +141,11 @@ typedef struct Plan
 	bool		parallel_aware; /* engage parallel-aware logic? */
 	bool		parallel_safe;	/* OK to use as part of parallel plan? */
 
+	/*
+	 * information needed for asynchronous execution
+	 */
+	bool		async_capable;	/* engage asynchronous-capable logic? */
+
 	/*
 	 * Common structural data for all Plan types.
 	 */
@@ -253,6 +264,7 @@ typedef struct Append
 	Plan		plan;
 	Bitmapset  *apprelids;		/* RTIs of appendrel(s) formed by this node */
 	List	   *appendplans;
+	int			nasyncplans;	/* # of asynchronous plans */
 
 	/*
 	 * All 'appendplans' preceding this index are non-partial plans. All
@@ -347,9 +359,21 @@ typedef struct Scan
 
 /* ----------------
  *		sequential scan node
+ *
+ * If the scan is the outer input of a hash join, possibly through a Gather,
+ * the join may push down a bloom filter of its inner join keys; the scan
+ * then drops rows whose join key columns, hashed the way the join hashes
+ * its outer keys, aren't in the filter.  numHashFilterCols is 0 otherwise.
  * ----------------
  */
-typedef Scan SeqScan;
+typedef struct SeqScan
+{
+	Scan		scan;
+	int			numHashFilterCols;	/* number of outer join key columns */
+	AttrNumber *hashFilterColIdx;	/* their attribute numbers */
+	Oid		   *hashFilterOperators;	/* hash join operators */
+	Oid		   *hashFilterCollations;
+} SeqScan;
 
 /* ----------------
  *		table sample scan node
@@ -760,6 +784,30 @@ typedef struct Material
 	Plan		plan;
 } Material;
 
+/* ----------------
+ *		result cache node
+ *
+ * Caches the tuples returned by its subplan for each distinct set of values
+ * of param_exprs, so that rescans with previously seen parameter values can
+ * return the cached tuples rather than running the subplan again.
+ * ----------------
+ */
+typedef struct ResultCache
+{
+	Plan		plan;
+
+	int			numKeys;		/* size of the two arrays below */
+
+	Oid		   *hashOperators;	/* hash operators for each key */
+	Oid		   *collations;		/* collations for each key */
+	List	   *param_exprs;	/* cache keys, in terms of outer Params */
+	bool		singlerow;		/* true if a cache entry is complete after
+								 * its first tuple is stored */
+	uint32		est_entries;	/* maximum number of entries the planner
+								 * expects to fit in the cache, or 0 if
+								 * unknown */
+} ResultCache;
+
 /* ----------------
  *		sort node
  * ----------------
@@ -935,6 +983,26 @@ typedef struct Hash
 	double		rows_total;		/* estimate total rows if parallel_aware */
 } Hash;
 
+/* ----------------
+ *		repartition node
+ *
+ * In a parallel query, each participant writes all the tuples of its
+ * subplan into one of a set of shared partitions, chosen by hashing the
+ * partition key columns, and then returns the tuples of the partitions it
+ * claims, so that all the tuples with equal keys come out of the same
+ * participant.  Used below a Finalize Aggregate, to finalize the groups in
+ * parallel.
+ * ----------------
+ */
+typedef struct Repartition
+{
+	Plan		plan;
+	int			numCols;		/* number of partition key columns */
+	AttrNumber *partColIdx;		/* their indexes in the target list */
+	Oid		   *partOperators;	/* equality operators to hash them for */
+	Oid		   *partCollations;
+} Repartition;
+
 /* ----------------
  *		setop node
  * ----------------
@@ -1114,12 +1182,19 @@ typedef struct PlanRowMark
  * other_subplans		Indexes of any subplans that are not accounted for
  *						by any of the PartitionedRelPruneInfo nodes in
  *						"prune_infos".  These subplans must not be pruned.
+ * subplan_rtis			Integer List holding, for each subplan, the RT index
+ *						of the leaf partition it scans, or 0 if it's not a
+ *						plain leaf partition scan.  This is NIL unless the
+ *						initial pruning steps are deterministic given the
+ *						statement's Params, in which case the plan cache may
+ *						perform them before locking the leaf partitions.
  */
 typedef struct PartitionPruneInfo
 {
 	NodeTag		type;
 	List	   *prune_infos;
 	Bitmapset  *other_subplans;
+	List	   *subplan_rtis;
 } PartitionPruneInfo;
 
 /*
@@ -83,6 +83,7 @@ typedef struct StartReplicationCmd
 	char	   *slotname;
 	TimeLineID	timeline;
 	XLogRecPtr	startpoint;
+	char	   *compression;	/* stream compression method, or NULL */
 	List	   *options;
 } StartReplicationCmd;
 
@@ -57,14 +57,24 @@ extern PGDLLIMPORT bool enable_incremental_sort;
 extern PGDLLIMPORT bool enable_hashagg;
 extern PGDLLIMPORT bool enable_nestloop;
 extern PGDLLIMPORT bool enable_material;
+extern PGDLLIMPORT bool enable_resultcache;
 extern PGDLLIMPORT bool enable_mergejoin;
 extern PGDLLIMPORT bool enable_hashjoin;
+extern PGDLLIMPORT bool enable_hashjoin_bloom_filter;
 extern PGDLLIMPORT bool enable_gathermerge;
 extern PGDLLIMPORT bool enable_partitionwise_join;
 extern PGDLLIMPORT bool enable_partitionwise_aggregate;
 extern PGDLLIMPORT bool enable_parallel_append;
 extern PGDLLIMPORT bool enable_parallel_hash;
+extern PGDLLIMPORT bool enable_parallel_hashagg;
+extern PGDLLIMPORT bool enable_parallel_insert;
+extern PGDLLIMPORT bool enable_parallel_material;
+extern PGDLLIMPORT bool enable_parallel_nonpartial_agg;
+extern PGDLLIMPORT bool enable_parallel_sort;
+extern PGDLLIMPORT bool enable_parallel_temp_scan;
+extern PGDLLIMPORT bool enable_parallel_window;
 extern PGDLLIMPORT bool enable_partition_pruning;
+extern PGDLLIMPORT bool enable_async_append;
 extern PGDLLIMPORT int constraint_exclusion;
 
 extern double index_pages_fetched(double tuples_fetched, BlockNumber pages,
@@ -102,6 +112,11 @@ extern void cost_sort(Path *path, PlannerInfo *root,
 					  List *pathkeys, Cost input_cost, double tuples, int width,
 					  Cost comparison_cost, int sort_mem,
 					  double limit_tuples);
+extern void cost_parallel_material(Path *path, Cost input_cost,
+								   double tuples, int width);
+extern void cost_parallel_sort(Path *path, PlannerInfo *root,
+							   List *pathkeys, Cost input_cost, double tuples,
+							   int width, Cost comparison_cost, int sort_mem);
 extern void cost_incremental_sort(Path *path,
 								  PlannerInfo *root, List *pathkeys, int presorted_keys,
 								  Cost input_startup_cost, Cost input_total_cost,
@@ -112,6 +127,9 @@ extern void cost_merge_append(Path *path, PlannerInfo *root,
 							  List *pathkeys, int n_streams,
 							  Cost input_startup_cost, Cost input_total_cost,
 							  double tuples);
+extern void cost_repartition(Path *path, int numCols,
+							 Cost input_startup_cost, Cost input_total_cost,
+							 double tuples, int width);
 extern void cost_material(Path *path,
 						  Cost input_startup_cost, Cost input_total_cost,
 						  double tuples, int width);
@@ -79,6 +79,15 @@ extern GroupResultPath *create_group_result_path(PlannerInfo *root,
 												 PathTarget *target,
 												 List *havingqual);
 extern MaterialPath *create_material_path(RelOptInfo *rel, Path *subpath);
+extern MaterialPath *create_parallel_material_path(RelOptInfo *rel,
+												   Path *subpath);
+extern ResultCachePath *create_resultcache_path(PlannerInfo *root,
+												RelOptInfo *rel,
+												Path *subpath,
+												List *param_exprs,
+												List *hash_operators,
+												bool singlerow,
+												double calls);
 extern UniquePath *create_unique_path(PlannerInfo *root, RelOptInfo *rel,
 									  Path *subpath, SpecialJoinInfo *sjinfo);
 extern GatherPath *create_gather_path(PlannerInfo *root,
@@ -91,6 +100,10 @@ extern GatherMergePath *create_gather_merge_path(PlannerInfo *root,
 												 List *pathkeys,
 												 Relids required_outer,
 												 double *rows);
+extern RepartitionPath *create_repartition_path(PlannerInfo *root,
+												RelOptInfo *rel,
+												Path *subpath,
+												List *groupClause);
 extern SubqueryScanPath *create_subqueryscan_path(PlannerInfo *root,
 												  RelOptInfo *rel, Path *subpath,
 												  List *pathkeys, Relids required_outer);
@@ -195,6 +208,10 @@ extern SortPath *create_sort_path(PlannerInfo *root,
 								  Path *subpath,
 								  List *pathkeys,
 								  double limit_tuples);
+extern SortPath *create_parallel_sort_path(PlannerInfo *root,
+										   RelOptInfo *rel,
+										   Path *subpath,
+										   List *pathkeys);
 extern GroupPath *create_group_path(PlannerInfo *root,
 									RelOptInfo *rel,
 									Path *subpath,
@@ -259,6 +259,14 @@
  */
 #define PG_CACHE_LINE_SIZE		128
 
+/*
+ * Assumed alignment requirement for direct I/O.  4K corresponds to common
+ * sector and memory page size.  Buffers used for reading or writing files
+ * opened with direct I/O (see io_direct) should be aligned to this, or they
+ * are copied through a suitably aligned buffer by fd.c.
+ */
+#define PG_IO_ALIGN_SIZE		4096
+
 /*
  *------------------------------------------------------------------------
  * The following symbols are for enabling debugging code, not for
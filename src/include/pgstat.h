@@ -49,16 +49,13 @@ typedef enum StatMsgType
 {
 	PGSTAT_MTYPE_DUMMY,
 	PGSTAT_MTYPE_INQUIRY,
-	PGSTAT_MTYPE_TABSTAT,
-	PGSTAT_MTYPE_TABPURGE,
+	PGSTAT_MTYPE_DBSTAT,
 	PGSTAT_MTYPE_DROPDB,
 	PGSTAT_MTYPE_RESETCOUNTER,
 	PGSTAT_MTYPE_RESETSHAREDCOUNTER,
 	PGSTAT_MTYPE_RESETSINGLECOUNTER,
 	PGSTAT_MTYPE_RESETSLRUCOUNTER,
 	PGSTAT_MTYPE_AUTOVAC_START,
-	PGSTAT_MTYPE_VACUUM,
-	PGSTAT_MTYPE_ANALYZE,
 	PGSTAT_MTYPE_ARCHIVER,
 	PGSTAT_MTYPE_BGWRITER,
 	PGSTAT_MTYPE_SLRU,
@@ -81,8 +78,8 @@ typedef int64 PgStat_Counter;
  *
  * This struct should contain only actual event counters, because we memcmp
  * it against zeroes to detect whether there are any counts to transmit.
- * It is a component of PgStat_TableStatus (within-backend state) and
- * PgStat_TableEntry (the transmitted message format).
+ * It is a component of PgStat_TableStatus (within-backend state), and is
+ * added to the shared PgStat_StatTabEntry by pgstat_tables_add_counts().
  *
  * Note: for a table, tuples_returned is the number of tuples successfully
  * fetched by heap_getnext, while tuples_fetched is the number of tuples
@@ -91,6 +88,10 @@ typedef int64 PgStat_Counter;
  * the index AM, while tuples_fetched is the number of tuples successfully
  * fetched by heap_fetch under the control of simple indexscans for this index.
  *
+ * For a table, ios_heap_fetches and ios_heap_fetches_avoided count the tuples
+ * returned by index-only scans that did and did not have to visit the heap,
+ * because the visibility map did not or did say the page was all-visible.
+ *
  * tuples_inserted/updated/deleted/hot_updated count attempted actions,
  * regardless of whether the transaction committed.  delta_live_tuples,
  * delta_dead_tuples, and changed_tuples are set depending on commit or abort.
@@ -104,6 +105,9 @@ typedef struct PgStat_TableCounts
 	PgStat_Counter t_tuples_returned;
 	PgStat_Counter t_tuples_fetched;
 
+	PgStat_Counter t_ios_heap_fetches;
+	PgStat_Counter t_ios_heap_fetches_avoided;
+
 	PgStat_Counter t_tuples_inserted;
 	PgStat_Counter t_tuples_updated;
 	PgStat_Counter t_tuples_deleted;
@@ -249,53 +253,28 @@ typedef struct PgStat_MsgInquiry
 
 
 /* ----------
- * PgStat_TableEntry			Per-table info in a MsgTabstat
+ * PgStat_MsgDbstat				Sent by the backend to report transactions,
+ *								block I/O times and the database-wide
+ *								totals of its table access counts.  The
+ *								per-table counts are kept in shared memory.
  * ----------
  */
-typedef struct PgStat_TableEntry
-{
-	Oid			t_id;
-	PgStat_TableCounts t_counts;
-} PgStat_TableEntry;
-
-/* ----------
- * PgStat_MsgTabstat			Sent by the backend to report table
- *								and buffer access statistics.
- * ----------
- */
-#define PGSTAT_NUM_TABENTRIES  \
-	((PGSTAT_MSG_PAYLOAD - sizeof(Oid) - 3 * sizeof(int) - 2 * sizeof(PgStat_Counter))	\
-	 / sizeof(PgStat_TableEntry))
-
-typedef struct PgStat_MsgTabstat
+typedef struct PgStat_MsgDbstat
 {
 	PgStat_MsgHdr m_hdr;
 	Oid			m_databaseid;
-	int			m_nentries;
 	int			m_xact_commit;
 	int			m_xact_rollback;
 	PgStat_Counter m_block_read_time;	/* times in microseconds */
 	PgStat_Counter m_block_write_time;
-	PgStat_TableEntry m_entry[PGSTAT_NUM_TABENTRIES];
-} PgStat_MsgTabstat;
-
-
-/* ----------
- * PgStat_MsgTabpurge			Sent by the backend to tell the collector
- *								about dead tables.
- * ----------
- */
-#define PGSTAT_NUM_TABPURGE  \
-	((PGSTAT_MSG_PAYLOAD - sizeof(Oid) - sizeof(int))  \
-	 / sizeof(Oid))
-
-typedef struct PgStat_MsgTabpurge
-{
-	PgStat_MsgHdr m_hdr;
-	Oid			m_databaseid;
-	int			m_nentries;
-	Oid			m_tableid[PGSTAT_NUM_TABPURGE];
-} PgStat_MsgTabpurge;
+	PgStat_Counter m_tuples_returned;
+	PgStat_Counter m_tuples_fetched;
+	PgStat_Counter m_tuples_inserted;
+	PgStat_Counter m_tuples_updated;
+	PgStat_Counter m_tuples_deleted;
+	PgStat_Counter m_blocks_fetched;
+	PgStat_Counter m_blocks_hit;
+} PgStat_MsgDbstat;
 
 
 /* ----------
@@ -369,41 +348,6 @@ typedef struct PgStat_MsgAutovacStart
 } PgStat_MsgAutovacStart;
 
 
-/* ----------
- * PgStat_MsgVacuum				Sent by the backend or autovacuum daemon
- *								after VACUUM
- * ----------
- */
-typedef struct PgStat_MsgVacuum
-{
-	PgStat_MsgHdr m_hdr;
-	Oid			m_databaseid;
-	Oid			m_tableoid;
-	bool		m_autovacuum;
-	TimestampTz m_vacuumtime;
-	PgStat_Counter m_live_tuples;
-	PgStat_Counter m_dead_tuples;
-} PgStat_MsgVacuum;
-
-
-/* ----------
- * PgStat_MsgAnalyze			Sent by the backend or autovacuum daemon
- *								after ANALYZE
- * ----------
- */
-typedef struct PgStat_MsgAnalyze
-{
-	PgStat_MsgHdr m_hdr;
-	Oid			m_databaseid;
-	Oid			m_tableoid;
-	bool		m_autovacuum;
-	bool		m_resetcounter;
-	TimestampTz m_analyzetime;
-	PgStat_Counter m_live_tuples;
-	PgStat_Counter m_dead_tuples;
-} PgStat_MsgAnalyze;
-
-
 /* ----------
  * PgStat_MsgArchiver			Sent by the archiver to update statistics.
  * ----------
@@ -584,16 +528,13 @@ typedef union PgStat_Msg
 	PgStat_MsgHdr msg_hdr;
 	PgStat_MsgDummy msg_dummy;
 	PgStat_MsgInquiry msg_inquiry;
-	PgStat_MsgTabstat msg_tabstat;
-	PgStat_MsgTabpurge msg_tabpurge;
+	PgStat_MsgDbstat msg_dbstat;
 	PgStat_MsgDropdb msg_dropdb;
 	PgStat_MsgResetcounter msg_resetcounter;
 	PgStat_MsgResetsharedcounter msg_resetsharedcounter;
 	PgStat_MsgResetsinglecounter msg_resetsinglecounter;
 	PgStat_MsgResetslrucounter msg_resetslrucounter;
 	PgStat_MsgAutovacStart msg_autovacuum_start;
-	PgStat_MsgVacuum msg_vacuum;
-	PgStat_MsgAnalyze msg_analyze;
 	PgStat_MsgArchiver msg_archiver;
 	PgStat_MsgBgWriter msg_bgwriter;
 	PgStat_MsgSLRU msg_slru;
@@ -614,7 +555,7 @@ typedef union PgStat_Msg
  * ------------------------------------------------------------
  */
 
-#define PGSTAT_FILE_FORMAT_ID	0x01A5BC9D
+#define PGSTAT_FILE_FORMAT_ID	0x01A5BC9F
 
 /* ----------
  * PgStat_StatDBEntry			The collector's data per database
@@ -650,16 +591,16 @@ typedef struct PgStat_StatDBEntry
 	TimestampTz stats_timestamp;	/* time of db stats file update */
 
 	/*
-	 * tables and functions must be last in the struct, because we don't write
-	 * the pointers out to the stats file.
+	 * functions must be last in the struct, because we don't write the
+	 * pointer out to the stats file.
 	 */
-	HTAB	   *tables;
 	HTAB	   *functions;
 } PgStat_StatDBEntry;
 
 
 /* ----------
- * PgStat_StatTabEntry			The collector's data per table (or index)
+ * PgStat_StatTabEntry			The data per table (or index), kept in
+ *								shared memory by pgstat_tables.c
  * ----------
  */
 typedef struct PgStat_StatTabEntry
@@ -671,6 +612,9 @@ typedef struct PgStat_StatTabEntry
 	PgStat_Counter tuples_returned;
 	PgStat_Counter tuples_fetched;
 
+	PgStat_Counter ios_heap_fetches;
+	PgStat_Counter ios_heap_fetches_avoided;
+
 	PgStat_Counter tuples_inserted;
 	PgStat_Counter tuples_updated;
 	PgStat_Counter tuples_deleted;
@@ -808,6 +752,8 @@ typedef enum
 	WAIT_EVENT_CHECKPOINTER_MAIN,
 	WAIT_EVENT_LOGICAL_APPLY_MAIN,
 	WAIT_EVENT_LOGICAL_LAUNCHER_MAIN,
+	WAIT_EVENT_LOGICAL_PARALLEL_APPLY_MAIN,
+	WAIT_EVENT_PARALLEL_WORKER_IDLE,
 	WAIT_EVENT_PGSTAT_MAIN,
 	WAIT_EVENT_RECOVERY_WAL_STREAM,
 	WAIT_EVENT_SYSLOGGER_MAIN,
@@ -831,6 +777,7 @@ typedef enum
 	WAIT_EVENT_GSS_OPEN_SERVER,
 	WAIT_EVENT_LIBPQWALRECEIVER_CONNECT,
 	WAIT_EVENT_LIBPQWALRECEIVER_RECEIVE,
+	WAIT_EVENT_PREFORK_HANDOFF,
 	WAIT_EVENT_SSL_OPEN_SERVER,
 	WAIT_EVENT_WAL_RECEIVER_WAIT_START,
 	WAIT_EVENT_WAL_SENDER_WAIT_WAL,
@@ -846,12 +793,14 @@ typedef enum
  */
 typedef enum
 {
-	WAIT_EVENT_BACKUP_WAIT_WAL_ARCHIVE = PG_WAIT_IPC,
+	WAIT_EVENT_APPEND_READY = PG_WAIT_IPC,
+	WAIT_EVENT_BACKUP_WAIT_WAL_ARCHIVE,
 	WAIT_EVENT_BGWORKER_SHUTDOWN,
 	WAIT_EVENT_BGWORKER_STARTUP,
 	WAIT_EVENT_BTREE_PAGE,
 	WAIT_EVENT_CHECKPOINT_DONE,
 	WAIT_EVENT_CHECKPOINT_START,
+	WAIT_EVENT_DOUBLE_WRITE_SLOT,
 	WAIT_EVENT_EXECUTE_GATHER,
 	WAIT_EVENT_HASH_BATCH_ALLOCATE,
 	WAIT_EVENT_HASH_BATCH_ELECT,
@@ -868,6 +817,7 @@ typedef enum
 	WAIT_EVENT_HASH_GROW_BUCKETS_ALLOCATE,
 	WAIT_EVENT_HASH_GROW_BUCKETS_ELECT,
 	WAIT_EVENT_HASH_GROW_BUCKETS_REINSERT,
+	WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE,
 	WAIT_EVENT_LOGICAL_SYNC_DATA,
 	WAIT_EVENT_LOGICAL_SYNC_STATE_CHANGE,
 	WAIT_EVENT_MQ_INTERNAL,
@@ -877,12 +827,17 @@ typedef enum
 	WAIT_EVENT_PARALLEL_BITMAP_SCAN,
 	WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN,
 	WAIT_EVENT_PARALLEL_FINISH,
+	WAIT_EVENT_PARALLEL_MATERIAL,
+	WAIT_EVENT_PARALLEL_SORT,
+	WAIT_EVENT_PLAN_PROGRESS,
 	WAIT_EVENT_PROCARRAY_GROUP_UPDATE,
 	WAIT_EVENT_PROC_SIGNAL_BARRIER,
 	WAIT_EVENT_PROMOTE,
 	WAIT_EVENT_RECOVERY_CONFLICT_SNAPSHOT,
 	WAIT_EVENT_RECOVERY_CONFLICT_TABLESPACE,
+	WAIT_EVENT_RECOVERY_PARALLEL_REDO,
 	WAIT_EVENT_RECOVERY_PAUSE,
+	WAIT_EVENT_REPARTITION_WRITE,
 	WAIT_EVENT_REPLICATION_ORIGIN_DROP,
 	WAIT_EVENT_REPLICATION_SLOT_DROP,
 	WAIT_EVENT_SAFE_SNAPSHOT,
@@ -932,6 +887,9 @@ typedef enum
 	WAIT_EVENT_DATA_FILE_SYNC,
 	WAIT_EVENT_DATA_FILE_TRUNCATE,
 	WAIT_EVENT_DATA_FILE_WRITE,
+	WAIT_EVENT_DOUBLE_WRITE_READ,
+	WAIT_EVENT_DOUBLE_WRITE_SYNC,
+	WAIT_EVENT_DOUBLE_WRITE_WRITE,
 	WAIT_EVENT_DSM_FILL_ZERO_WRITE,
 	WAIT_EVENT_LOCK_FILE_ADDTODATADIR_READ,
 	WAIT_EVENT_LOCK_FILE_ADDTODATADIR_SYNC,
@@ -985,6 +943,43 @@ typedef enum
 	WAIT_EVENT_WAL_WRITE
 } WaitEventIO;
 
+/* ----------
+ * Wait event timing
+ *
+ * With track_wait_timing enabled, every process counts the waits it has done
+ * per wait event, along with their total duration and a histogram of their
+ * durations.  Histogram bucket 0 counts waits shorter than 1 usec, bucket i
+ * waits of at least 2^(i-1) and less than 2^i usec, and the last bucket all
+ * longer waits.  The counters are kept in shared memory, in one
+ * PgStat_BackendWaitStats per PgBackendStatus slot; a process has room for
+ * PGSTAT_WAIT_EVENT_SLOTS distinct wait events, and doesn't count any
+ * further ones.
+ * ----------
+ */
+#define PGSTAT_WAIT_EVENT_SLOTS		32
+#define PGSTAT_WAIT_HIST_BUCKETS	24
+
+typedef struct PgStat_WaitEventCounts
+{
+	uint32		wait_event_info;	/* 0 if the slot is unused */
+	uint64		calls;
+	uint64		total_time;		/* in microseconds */
+	uint64		histogram[PGSTAT_WAIT_HIST_BUCKETS];
+} PgStat_WaitEventCounts;
+
+typedef struct PgStat_BackendWaitStats
+{
+	/*
+	 * Only the owning process writes its entry, bumping changecount before
+	 * and after, like st_changecount in PgBackendStatus.
+	 */
+	int			st_changecount;
+
+	int			procpid;		/* 0 if the entry is unused */
+	Oid			userid;
+	PgStat_WaitEventCounts events[PGSTAT_WAIT_EVENT_SLOTS];
+} PgStat_BackendWaitStats;
+
 /* ----------
  * Command type for progress reporting purposes
  * ----------
@@ -1136,6 +1131,15 @@ typedef struct PgBackendStatus
 	ProgressCommandType st_progress_command;
 	Oid			st_progress_command_target;
 	int64		st_progress_param[PGSTAT_NUM_PROGRESS_PARAM];
+
+	/*
+	 * Memory obtained by the backend's memory contexts, in bytes.  This is
+	 * where the backend keeps its my_allocated_bytes counter, updating it in
+	 * place on every change without following the st_changecount protocol,
+	 * so readers may see a value that is slightly out of date (or, on
+	 * platforms where 8-byte stores are not atomic, torn).
+	 */
+	uint64		st_allocated_bytes;
 } PgBackendStatus;
 
 /*
@@ -1199,6 +1203,18 @@ typedef struct PgBackendStatus
 	 ((before_changecount) & 1) == 0)
 
 
+/* ----------
+ * Total number of backends including auxiliary
+ *
+ * We reserve a slot for each possible BackendId, plus one for each
+ * possible auxiliary process type.  (This scheme assumes there is not
+ * more than one of any auxiliary process type at a time.) MaxBackends
+ * includes autovacuum workers and background workers as well.
+ * ----------
+ */
+#define NumBackendStatSlots (MaxBackends + NUM_AUXPROCTYPES)
+
+
 /* ----------
  * LocalPgBackendStatus
  *
@@ -1244,6 +1260,57 @@ typedef struct PgStat_FunctionCallUsage
 } PgStat_FunctionCallUsage;
 
 
+/* ----------
+ * I/O statistics
+ *
+ * Reads, writes, extensions and fsyncs of relation data, as well as shared
+ * and local buffer hits, evictions and reuses of strategy ring buffers, are
+ * counted by backend type, by the kind of object (a permanent or unlogged
+ * relation in shared buffers, or a temporary relation in local buffers),
+ * and by the context the I/O happens in (ordinary access, or one of the
+ * buffer access strategies).  With track_io_timing, the time spent in
+ * reads, writes, extensions and fsyncs is measured, too.  See pgstat_io.c.
+ * ----------
+ */
+typedef enum IOObject
+{
+	IOOBJECT_RELATION,
+	IOOBJECT_TEMP_RELATION
+} IOObject;
+
+#define IOOBJECT_NUM_TYPES (IOOBJECT_TEMP_RELATION + 1)
+
+typedef enum IOContext
+{
+	IOCONTEXT_NORMAL,
+	IOCONTEXT_BULKREAD,
+	IOCONTEXT_BULKWRITE,
+	IOCONTEXT_VACUUM
+} IOContext;
+
+#define IOCONTEXT_NUM_TYPES (IOCONTEXT_VACUUM + 1)
+
+typedef enum IOOp
+{
+	IOOP_READ,
+	IOOP_WRITE,
+	IOOP_EXTEND,
+	IOOP_FSYNC,
+	IOOP_HIT,
+	IOOP_EVICT,
+	IOOP_REUSE
+} IOOp;
+
+#define IOOP_NUM_TYPES (IOOP_REUSE + 1)
+
+typedef struct PgStat_IOStats
+{
+	PgStat_Counter counts[BACKEND_NUM_TYPES][IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES][IOOP_NUM_TYPES];
+	PgStat_Counter times[BACKEND_NUM_TYPES][IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES][IOOP_NUM_TYPES];	/* in microseconds */
+	TimestampTz stat_reset_timestamp;
+} PgStat_IOStats;
+
+
 /* ----------
  * GUC parameters
  * ----------
@@ -1252,6 +1319,7 @@ extern PGDLLIMPORT bool pgstat_track_activities;
 extern PGDLLIMPORT bool pgstat_track_counts;
 extern PGDLLIMPORT int pgstat_track_functions;
 extern PGDLLIMPORT int pgstat_track_activity_query_size;
+extern PGDLLIMPORT bool track_wait_timing;
 extern char *pgstat_stat_directory;
 extern char *pgstat_stat_tmpname;
 extern char *pgstat_stat_filename;
@@ -1339,6 +1407,20 @@ extern void pgstat_initstats(Relation rel);
 
 extern char *pgstat_clip_activity(const char *raw_activity);
 
+/* ----------
+ * Functions in pgstat_wait.c
+ * ----------
+ */
+extern PGDLLIMPORT bool pgstat_wait_timing_active;
+
+extern Size WaitStatsShmemSize(void);
+extern void WaitStatsShmemInit(void);
+extern void pgstat_wait_initialize(int slot);
+extern void pgstat_wait_bestart(Oid userid);
+extern void pgstat_wait_timing_start(uint32 wait_event_info);
+extern void pgstat_wait_timing_end(void);
+extern bool pgstat_fetch_wait_stats(int slot, PgStat_BackendWaitStats *result);
+
 /* ----------
  * pgstat_report_wait_start() -
  *
@@ -1359,6 +1441,9 @@ pgstat_report_wait_start(uint32 wait_event_info)
 {
 	volatile PGPROC *proc = MyProc;
 
+	if (unlikely(track_wait_timing))
+		pgstat_wait_timing_start(wait_event_info);
+
 	if (!pgstat_track_activities || !proc)
 		return;
 
@@ -1383,6 +1468,10 @@ pgstat_report_wait_end(void)
 {
 	volatile PGPROC *proc = MyProc;
 
+	/* Checked instead of the GUC, which may have changed since the start */
+	if (unlikely(pgstat_wait_timing_active))
+		pgstat_wait_timing_end();
+
 	if (!pgstat_track_activities || !proc)
 		return;
 
@@ -1410,6 +1499,16 @@ pgstat_report_wait_end(void)
 		if ((rel)->pgstat_info != NULL)								\
 			(rel)->pgstat_info->t_counts.t_tuples_fetched++;		\
 	} while (0)
+#define pgstat_count_ios_heap_fetch(rel)							\
+	do {															\
+		if ((rel)->pgstat_info != NULL)								\
+			(rel)->pgstat_info->t_counts.t_ios_heap_fetches++;		\
+	} while (0)
+#define pgstat_count_ios_heap_fetch_avoided(rel)					\
+	do {															\
+		if ((rel)->pgstat_info != NULL)								\
+			(rel)->pgstat_info->t_counts.t_ios_heap_fetches_avoided++; \
+	} while (0)
 #define pgstat_count_index_scan(rel)								\
 	do {															\
 		if ((rel)->pgstat_info != NULL)								\
@@ -1486,4 +1585,52 @@ extern void pgstat_count_slru_truncate(int slru_idx);
 extern const char *pgstat_slru_name(int slru_idx);
 extern int	pgstat_slru_index(const char *name);
 
+/* ----------
+ * Functions in pgstat_tables.c
+ * ----------
+ */
+extern Size PgStatTablesShmemSize(void);
+extern void PgStatTablesShmemInit(void);
+
+extern void pgstat_tables_add_counts(Oid dbid, Oid tableid,
+									 const PgStat_TableCounts *counts);
+extern void pgstat_tables_report_vacuum(Oid dbid, Oid tableid, bool autovacuum,
+										TimestampTz vacuumtime,
+										PgStat_Counter livetuples,
+										PgStat_Counter deadtuples);
+extern void pgstat_tables_report_analyze(Oid dbid, Oid tableid, bool autovacuum,
+										 TimestampTz analyzetime,
+										 PgStat_Counter livetuples,
+										 PgStat_Counter deadtuples,
+										 bool resetcounter);
+extern bool pgstat_tables_fetch(Oid dbid, Oid tableid,
+								PgStat_StatTabEntry *result);
+extern void pgstat_tables_reset(Oid dbid, Oid tableid);
+extern void pgstat_tables_drop_database(Oid dbid);
+extern void pgstat_tables_purge(HTAB *dbids, Oid dbid, HTAB *relids);
+extern void pgstat_tables_write(void);
+extern void pgstat_tables_shutdown_hook(int code, Datum arg);
+extern void pgstat_tables_restore(void);
+extern void pgstat_tables_discard(void);
+
+/* ----------
+ * Functions in pgstat_io.c
+ * ----------
+ */
+extern Size IOStatsShmemSize(void);
+extern void IOStatsShmemInit(void);
+
+extern void pgstat_count_io_op_n(IOObject io_object, IOContext io_context,
+								 IOOp io_op, uint32 cnt);
+extern void pgstat_count_io_time(IOObject io_object, IOContext io_context,
+								 IOOp io_op, instr_time io_time);
+extern void pgstat_flush_io(bool force);
+extern void pgstat_fetch_io(PgStat_IOStats *result);
+extern void pgstat_reset_io(void);
+extern const char *pgstat_get_io_object_name(IOObject io_object);
+extern const char *pgstat_get_io_context_name(IOContext io_context);
+
+#define pgstat_count_io_op(io_object, io_context, io_op) \
+	pgstat_count_io_op_n(io_object, io_context, io_op, 1)
+
 #endif							/* PGSTAT_H */
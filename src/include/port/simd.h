@@ -0,0 +1,149 @@
+/*-------------------------------------------------------------------------
+ *
+ * simd.h
+ *	  Support for platform-specific vector operations.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/port/simd.h
+ *
+ * NOTES
+ * - Only the instruction sets that every compiler for the platform enables
+ *	 by default are used, namely SSE2 on x86-64 and Advanced SIMD (Neon) on
+ *	 AArch64, so no runtime checks are needed.
+ * - On other platforms USE_NO_SIMD is defined and none of the functions are
+ *	 available; callers are expected to keep a scalar path for that case,
+ *	 which they need anyway for the tail of their input.
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SIMD_H
+#define SIMD_H
+
+#if (defined(__x86_64__) || defined(_M_AMD64))
+/*
+ * SSE2 instructions are part of the spec for the 64-bit x86 ISA.  We assume
+ * that compilers targeting this architecture understand SSE2 intrinsics.
+ */
+#include <emmintrin.h>
+#define USE_SSE2
+typedef __m128i Vector8;
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+/*
+ * We use the Neon instructions if the compiler provides access to them (as
+ * indicated by __ARM_NEON) and we are on aarch64.  While Neon support is
+ * technically optional for aarch64, it appears that all available 64-bit
+ * hardware does have it.
+ */
+#include <arm_neon.h>
+#define USE_NEON
+typedef uint8x16_t Vector8;
+
+#else
+#define USE_NO_SIMD
+#endif
+
+#ifndef USE_NO_SIMD
+
+/*
+ * Load a chunk of memory into the given vector.  No alignment is required.
+ */
+static inline void
+vector8_load(Vector8 *v, const uint8 *s)
+{
+#if defined(USE_SSE2)
+	*v = _mm_loadu_si128((const __m128i *) s);
+#elif defined(USE_NEON)
+	*v = vld1q_u8(s);
+#endif
+}
+
+/*
+ * Create a vector with all elements set to the same value.
+ */
+static inline Vector8
+vector8_broadcast(const uint8 c)
+{
+#if defined(USE_SSE2)
+	return _mm_set1_epi8(c);
+#elif defined(USE_NEON)
+	return vdupq_n_u8(c);
+#endif
+}
+
+/*
+ * Return a vector with all bits set in each lane where the corresponding
+ * lanes in the inputs are equal, and all bits clear elsewhere.
+ */
+static inline Vector8
+vector8_eq(const Vector8 v1, const Vector8 v2)
+{
+#if defined(USE_SSE2)
+	return _mm_cmpeq_epi8(v1, v2);
+#elif defined(USE_NEON)
+	return vceqq_u8(v1, v2);
+#endif
+}
+
+/*
+ * Return the bitwise AND of the inputs.
+ */
+static inline Vector8
+vector8_and(const Vector8 v1, const Vector8 v2)
+{
+#if defined(USE_SSE2)
+	return _mm_and_si128(v1, v2);
+#elif defined(USE_NEON)
+	return vandq_u8(v1, v2);
+#endif
+}
+
+/*
+ * Return the bitwise OR of the inputs.
+ */
+static inline Vector8
+vector8_or(const Vector8 v1, const Vector8 v2)
+{
+#if defined(USE_SSE2)
+	return _mm_or_si128(v1, v2);
+#elif defined(USE_NEON)
+	return vorrq_u8(v1, v2);
+#endif
+}
+
+/*
+ * Return a bitmask formed from the high bit of each lane, with bit i taken
+ * from lane i; so the lowest set bit is the first lane that has it set.
+ */
+static inline uint32
+vector8_highbit_mask(const Vector8 v)
+{
+#if defined(USE_SSE2)
+	return (uint32) _mm_movemask_epi8(v);
+#elif defined(USE_NEON)
+	/*
+	 * Neon has no single instruction for this.  Isolate the high bit of each
+	 * lane as the lane's bit number within its half of the vector, then
+	 * interleave the two halves into 16-bit lanes and add them up.
+	 */
+	static const uint8 mask[16] = {
+		1 << 0, 1 << 1, 1 << 2, 1 << 3,
+		1 << 4, 1 << 5, 1 << 6, 1 << 7,
+		1 << 0, 1 << 1, 1 << 2, 1 << 3,
+		1 << 4, 1 << 5, 1 << 6, 1 << 7,
+	};
+	uint8x16_t	masked;
+	uint8x16_t	maskedhi;
+
+	masked = vandq_u8(vld1q_u8(mask),
+					  vreinterpretq_u8_s8(vshrq_n_s8(vreinterpretq_s8_u8(v), 7)));
+	maskedhi = vextq_u8(masked, masked, 8);
+	return (uint32) vaddvq_u16(vreinterpretq_u16_u8(vzip1q_u8(masked, maskedhi)));
+#endif
+}
+
+#endif							/* ! USE_NO_SIMD */
+
+#endif							/* SIMD_H */
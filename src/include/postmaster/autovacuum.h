@@ -22,9 +22,14 @@
  */
 typedef enum
 {
-	AVW_BRINSummarizeRange
+	AVW_BRINSummarizeRange,
+	AVW_HeapSetVisible,
+	AVW_GinCleanPendingList
 } AutoVacuumWorkItemType;
 
+/* number of heap pages an AVW_HeapSetVisible request covers */
+#define AVW_SET_VISIBLE_PAGES	1024
+
 
 /* GUC variables */
 extern bool autovacuum_start_daemon;
@@ -29,6 +29,8 @@ extern bool log_hostname;
 extern bool enable_bonjour;
 extern char *bonjour_name;
 extern bool restart_after_crash;
+extern int	PreforkBackends;
+extern char *PreforkDatabases;
 
 #ifdef WIN32
 extern HANDLE PostmasterHandle;
@@ -54,6 +56,8 @@ extern int	MaxLivePostmasterChildren(void);
 
 extern bool PostmasterMarkPIDForWorkerNotify(int);
 
+extern void PreforkAwaitClient(const char *dbname);
+
 #ifdef EXEC_BACKEND
 extern pid_t postmaster_forkexec(int argc, char *argv[]);
 extern void SubPostmasterMain(int argc, char *argv[]) pg_attribute_noreturn();
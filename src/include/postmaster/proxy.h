@@ -0,0 +1,96 @@
+/*-------------------------------------------------------------------------
+ *
+ * proxy.h
+ *	  Exports from postmaster/proxy.c.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/postmaster/proxy.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _PROXY_H
+#define _PROXY_H
+
+#include "libpq/libpq-be.h"
+#include "libpq/pqcomm.h"
+
+/* GUC variables */
+extern int	ConnectionProxies;
+extern int	ProxyPortNumber;
+extern int	SessionPoolSize;
+
+/*
+ * A connection proxy starts a backend by connecting to one of the
+ * postmaster's Unix-domain sockets, and sending this packet ahead of the
+ * client's startup packet.  It tells the backend the address of the client
+ * the proxy serves, for logging and for matching pg_hba.conf entries.
+ *
+ * The secret, chosen by the postmaster at startup and inherited by the
+ * proxies, keeps other local processes from making up client addresses.
+ * PROXY_REQUEST_TRUSTED marks a backend started to grow a session pool,
+ * whose user and database a client has already authenticated for through
+ * another backend; it skips the authentication exchange.
+ *
+ * Only the request code is in network byte order, as with a startup packet;
+ * the rest is only ever exchanged between processes on the same machine.
+ */
+#define PROXY_REQUEST_CODE PG_PROTOCOL(1234,5681)
+
+#define PROXY_SECRET_LEN	32
+
+#define PROXY_REQUEST_TRUSTED	0x0001
+
+typedef struct ProxyRequestPacket
+{
+	MsgType		proxyRequestCode;	/* code to identify a proxy request */
+	uint32		flags;			/* PROXY_REQUEST_* flags */
+	char		secret[PROXY_SECRET_LEN];
+	SockAddr	raddr;			/* address of the proxy's client */
+} ProxyRequestPacket;
+
+/*
+ * Name of the parameter through which a backend started by a proxy reports
+ * whether its session holds state that prevents sharing it with other
+ * clients.  It is consumed by the proxy, never seen by clients.
+ */
+#define PROXY_SESSION_STATE_PARAM	"pool_session_state"
+
+/* Activity counters of one connection proxy, for pg_stat_proxies */
+typedef struct ProxyStats
+{
+	/*
+	 * Only the proxy itself writes to its entry, following the st_changecount
+	 * protocol of PgBackendStatus; see pgstat.h.
+	 */
+	int			st_changecount;
+
+	int			pid;			/* 0 if the proxy is not running */
+	int			n_clients;		/* client connections */
+	int			n_pools;		/* session pools */
+	int			n_backends;		/* backends, including starting ones */
+	int			n_idle_backends;	/* backends in a pool, ready for use */
+	int			n_dedicated_backends;	/* backends tied to one client */
+	int			n_waiting_clients;	/* clients waiting for a backend */
+	int64		n_transactions; /* transactions run through the proxy */
+} ProxyStats;
+
+/* Functions called from postmaster */
+extern void ProxyInitListen(const char *socketdir);
+extern void ProxyCloseListen(void);
+extern int	ProxyStart(int id);
+extern bool ProcessProxyRequest(Port *port, void *pkt, int len);
+extern void ProxyForgetSecret(void);
+
+/* Functions called from backends started by a proxy */
+extern void MarkSessionUnpoolable(const char *reason);
+extern void ResetSessionPoolability(void);
+extern void ReportSessionPoolability(void);
+
+/* Shared memory and monitoring */
+extern Size ProxyShmemSize(void);
+extern void ProxyShmemInit(void);
+extern bool ProxyFetchStats(int id, ProxyStats *result);
+
+#endif							/* _PROXY_H */
@@ -0,0 +1,56 @@
+/*-------------------------------------------------------------------------
+ *
+ * fanout.h
+ *	  Exports for sharing decoded changes between walsenders.
+ *
+ * Portions Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * src/include/replication/fanout.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef FANOUT_H
+#define FANOUT_H
+
+#include "access/xlogdefs.h"
+#include "nodes/pg_list.h"
+
+/* What the current walsender does in its decoding fan-out group */
+typedef enum DecodeFanoutRole
+{
+	DECODE_FANOUT_NONE,			/* not in a group, decoding on our own */
+	DECODE_FANOUT_LEADER,		/* decoding for the whole group */
+	DECODE_FANOUT_JOINING,		/* decoding on our own until we can join */
+	DECODE_FANOUT_MEMBER		/* sending what the leader decoded */
+} DecodeFanoutRole;
+
+typedef enum DecodeFanoutReadResult
+{
+	DECODE_FANOUT_READ_DATA,	/* got messages to send */
+	DECODE_FANOUT_READ_EMPTY,	/* nothing new from the leader */
+	DECODE_FANOUT_READ_LOST		/* have to decode on our own again */
+} DecodeFanoutReadResult;
+
+extern int	max_logical_decoding_fanout_groups;
+extern int	logical_decoding_fanout_buffer_size;
+
+extern DecodeFanoutRole MyDecodeFanoutRole;
+
+extern Size DecodeFanoutShmemSize(void);
+extern void DecodeFanoutShmemInit(void);
+
+extern void DecodeFanoutAttach(List *options, XLogRecPtr start_lsn);
+extern void DecodeFanoutDetach(void);
+
+extern void DecodeFanoutWrite(const char *data, Size len);
+extern bool DecodeFanoutPublish(XLogRecPtr endptr, bool consistent);
+extern void DecodeFanoutSetMarker(XLogRecPtr endptr);
+
+extern bool DecodeFanoutTryJoin(XLogRecPtr endptr, bool consistent,
+								bool *wait);
+extern DecodeFanoutReadResult DecodeFanoutRead(char **data, Size *len,
+											   XLogRecPtr *endptr);
+
+extern void DecodeFanoutSyncSlot(void);
+
+#endif							/* FANOUT_H */
@@ -24,6 +24,8 @@ typedef struct LogicalRepRelMapEntry
 	Relation	localrel;		/* relcache entry */
 	AttrMap    *attrmap;		/* map of local attributes to remote ones */
 	bool		updatable;		/* Can apply updates/deletes? */
+	bool		parallel_safe;	/* Can apply in parallel apply workers? */
+	Bitmapset  *parallel_keys;	/* replica identity columns, if parallel_safe */
 
 	/* Sync state. */
 	char		state;
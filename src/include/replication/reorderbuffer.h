@@ -18,6 +18,15 @@
 #include "utils/timestamp.h"
 
 extern PGDLLIMPORT int logical_decoding_work_mem;
+extern PGDLLIMPORT int logical_decoding_spill_compression;
+
+/* Compression methods for changes spilled to disk */
+typedef enum ReorderBufferSpillCompression
+{
+	SPILL_COMPRESSION_NONE,
+	SPILL_COMPRESSION_PGLZ,
+	SPILL_COMPRESSION_LZ4
+} ReorderBufferSpillCompression;
 
 /* an individual tuple, stored in one chunk of memory */
 typedef struct ReorderBufferTupleBuf
@@ -523,6 +532,11 @@ struct ReorderBuffer
 	char	   *outbuf;
 	Size		outbufsize;
 
+	/* block of changes being spilled to or restored from disk */
+	char	   *spillbuf;
+	Size		spillbufsize;
+	Size		spilllen;
+
 	/* memory accounting */
 	Size		size;
 };
@@ -27,6 +27,8 @@
 extern int	wal_receiver_status_interval;
 extern int	wal_receiver_timeout;
 extern bool hot_standby_feedback;
+extern int	wal_receiver_compression;
+extern int	wal_receiver_relay_buffers;
 
 /*
  * MAXCONNINFO: maximum size of a connection string.
@@ -156,6 +158,13 @@ typedef struct
 	 * store semantics, so use sig_atomic_t.
 	 */
 	sig_atomic_t force_reply;	/* used as a bool */
+
+	/*
+	 * Timeline of the WAL in the relay buffers, and how far it's been copied
+	 * there; see WalRcvRelayWrite().
+	 */
+	pg_atomic_uint32 relayTLI;
+	pg_atomic_uint64 relayUpto;
 } WalRcvData;
 
 extern WalRcvData *WalRcv;
@@ -172,6 +181,8 @@ typedef struct
 		struct
 		{
 			TimeLineID	startpointTLI;	/* Starting timeline */
+			const char *compression;	/* Stream compression method, or
+										 * NULL */
 		}			physical;
 		struct
 		{
@@ -461,5 +472,9 @@ extern XLogRecPtr GetWalRcvWriteRecPtr(void);
 extern int	GetReplicationApplyDelay(void);
 extern int	GetReplicationTransferLatency(void);
 extern void WalRcvForceReply(void);
+extern void WalRcvRelayReset(TimeLineID tli);
+extern void WalRcvRelayWrite(const char *buf, Size nbytes, XLogRecPtr recptr);
+extern Size WalRcvRelayRead(char *buf, XLogRecPtr startptr, Size count,
+							TimeLineID tli);
 
 #endif							/* _WALRECEIVER_H */
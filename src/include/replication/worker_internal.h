@@ -17,6 +17,9 @@
 #include "access/xlogdefs.h"
 #include "catalog/pg_subscription.h"
 #include "datatype/timestamp.h"
+#include "lib/stringinfo.h"
+#include "storage/condition_variable.h"
+#include "storage/dsm.h"
 #include "storage/lock.h"
 #include "storage/spin.h"
 
@@ -56,11 +59,30 @@ typedef struct LogicalRepWorker
 	TimestampTz last_recv_time;
 	XLogRecPtr	reply_lsn;
 	TimestampTz reply_time;
+
+	/*
+	 * Used for parallel apply.  A parallel apply worker records the PID and
+	 * slot of the apply worker it belongs to; leader_pid is 0 in all other
+	 * workers.  An apply worker that uses parallel apply workers publishes
+	 * in its own slot the last transaction they have committed, and the
+	 * remote and local end of that commit.  Those fields are protected by
+	 * relmutex, and pa_cv is signaled whenever they or the set of parallel
+	 * apply workers change.
+	 */
+	pid_t		leader_pid;
+	int			leader_slot;
+	uint64		pa_committed_seq;
+	XLogRecPtr	pa_remote_end;
+	XLogRecPtr	pa_local_end;
+	ConditionVariable pa_cv;
 } LogicalRepWorker;
 
 /* Main memory context for apply worker. Permanent during worker lifetime. */
 extern MemoryContext ApplyContext;
 
+/* Memory context reset after each protocol message. */
+extern MemoryContext ApplyMessageContext;
+
 /* libpqreceiver connection */
 extern struct WalReceiverConn *wrconn;
 
@@ -74,19 +96,39 @@ extern void logicalrep_worker_attach(int slot);
 extern LogicalRepWorker *logicalrep_worker_find(Oid subid, Oid relid,
 												bool only_running);
 extern List *logicalrep_workers_find(Oid subid, bool only_running);
-extern void logicalrep_worker_launch(Oid dbid, Oid subid, const char *subname,
-									 Oid userid, Oid relid);
+extern bool logicalrep_worker_launch(Oid dbid, Oid subid, const char *subname,
+									 Oid userid, Oid relid,
+									 dsm_handle subworker_dsm);
 extern void logicalrep_worker_stop(Oid subid, Oid relid);
 extern void logicalrep_worker_stop_at_commit(Oid subid, Oid relid);
 extern void logicalrep_worker_wakeup(Oid subid, Oid relid);
 extern void logicalrep_worker_wakeup_ptr(LogicalRepWorker *worker);
 
+extern LogicalRepWorker *logicalrep_worker_leader(void);
+
 extern int	logicalrep_sync_worker_count(Oid subid);
+extern int	logicalrep_pa_worker_count(Oid subid);
+extern void logicalrep_pa_workers_wait_for_exit(Oid subid);
 
 extern char *LogicalRepSyncTableStart(XLogRecPtr *origin_startpos);
 void		process_syncing_tables(XLogRecPtr current_lsn);
 void		invalidate_syncing_table_states(Datum arg, int cacheid,
 											uint32 hashvalue);
+extern bool AllTablesyncsReady(void);
+
+extern void InitializeApplyWorker(void);
+extern void apply_dispatch(StringInfo s);
+extern void maybe_reread_subscription(void);
+extern void store_flush_position(XLogRecPtr remote_lsn, XLogRecPtr local_lsn);
+
+/* Parallel apply, in the leader apply worker */
+extern bool pa_handle_message(StringInfo s);
+extern bool pa_have_inflight(void);
+extern void pa_report_progress(void);
+
+/* Parallel apply, in a parallel apply worker */
+extern void pa_wait_for_turn(void);
+extern void pa_commit_done(XLogRecPtr remote_end, XLogRecPtr local_end);
 
 static inline bool
 am_tablesync_worker(void)
@@ -94,4 +136,12 @@ am_tablesync_worker(void)
 	return OidIsValid(MyLogicalRepWorker->relid);
 }
 
+#define isParallelApplyWorker(worker) ((worker)->leader_pid != 0)
+
+static inline bool
+am_parallel_apply_worker(void)
+{
+	return isParallelApplyWorker(MyLogicalRepWorker);
+}
+
 #endif							/* WORKER_INTERNAL_H */
@@ -32,11 +32,23 @@
 
 typedef struct BufFile BufFile;
 
+/* Compression methods for temporary files */
+typedef enum TempFileCompression
+{
+	TEMP_FILE_COMPRESSION_NONE,
+	TEMP_FILE_COMPRESSION_PGLZ,
+	TEMP_FILE_COMPRESSION_LZ4
+} TempFileCompression;
+
+/* GUC variables */
+extern int	temp_file_compression;
+
 /*
  * prototypes for functions in buffile.c
  */
 
 extern BufFile *BufFileCreateTemp(bool interXact);
+extern BufFile *BufFileCreateCompressTemp(bool interXact);
 extern void BufFileClose(BufFile *file);
 extern size_t BufFileRead(BufFile *file, void *ptr, size_t size);
 extern void BufFileWrite(BufFile *file, void *ptr, size_t size);
@@ -45,6 +57,10 @@ extern void BufFileTell(BufFile *file, int *fileno, off_t *offset);
 extern int	BufFileSeekBlock(BufFile *file, long blknum);
 extern int64 BufFileSize(BufFile *file);
 extern long BufFileAppend(BufFile *target, BufFile *source);
+extern int32 BufFileCompress(int method, const char *src, int32 len,
+							 char *dest);
+extern void BufFileDecompress(int method, const char *src, int32 len,
+							  char *dest, int32 rawlen);
 
 extern BufFile *BufFileCreateShared(SharedFileSet *fileset, const char *name);
 extern void BufFileExportShared(BufFile *file);
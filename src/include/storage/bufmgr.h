@@ -23,6 +23,10 @@
 
 typedef void *Block;
 
+/* Limits for vacuum_buffer_usage_limit and VACUUM (BUFFER_USAGE_LIMIT), in kB */
+#define MIN_BAS_VAC_RING_SIZE_KB 128
+#define MAX_BAS_VAC_RING_SIZE_KB (16 * 1024 * 1024)
+
 /* Possible arguments for GetAccessStrategy() */
 typedef enum BufferAccessStrategyType
 {
@@ -55,6 +59,9 @@ typedef struct PrefetchBufferResult
 	bool		initiated_io;	/* If true, a miss resulting in async I/O */
 } PrefetchBufferResult;
 
+/* Maximum number of blocks ReadBuffers() reads with one call */
+#define MAX_BUFFERS_PER_READ	16
+
 /* forward declared, to avoid having to expose buf_internals.h here */
 struct WritebackContext;
 
@@ -180,6 +187,9 @@ extern Buffer ReadBuffer(Relation reln, BlockNumber blockNum);
 extern Buffer ReadBufferExtended(Relation reln, ForkNumber forkNum,
 								 BlockNumber blockNum, ReadBufferMode mode,
 								 BufferAccessStrategy strategy);
+extern void ReadBuffers(Relation reln, ForkNumber forkNum,
+						BlockNumber blockNum, int nblocks, Buffer *buffers,
+						BufferAccessStrategy strategy);
 extern Buffer ReadBufferWithoutRelcache(RelFileNode rnode,
 										ForkNumber forkNum, BlockNumber blockNum,
 										ReadBufferMode mode, BufferAccessStrategy strategy);
@@ -235,13 +245,21 @@ extern void AbortBufferIO(void);
 
 extern void BufmgrCommit(void);
 extern bool BgBufferSync(struct WritebackContext *wb_context);
+extern int	BufferSyncCold(XLogRecPtr horizon, int nscan);
 
 extern void AtProcExit_LocalBuffers(void);
+extern void ShareLocalBuffers(void);
+extern void UnshareLocalBuffers(void);
+extern void UseSharedLocalBuffers(void);
+extern bool LocalBuffersShared(void);
 
 extern void TestForOldSnapshot_impl(Snapshot snapshot, Relation relation);
 
 /* in freelist.c */
 extern BufferAccessStrategy GetAccessStrategy(BufferAccessStrategyType btype);
+extern BufferAccessStrategy GetAccessStrategyWithSize(BufferAccessStrategyType btype,
+													  int ring_size_kb);
+extern BufferAccessStrategyType GetAccessStrategyType(BufferAccessStrategy strategy);
 extern void FreeAccessStrategy(BufferAccessStrategy strategy);
 
 
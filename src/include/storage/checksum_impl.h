@@ -98,10 +98,21 @@
  * to unroll the inner loop to avoid loop overhead and minimize register
  * spilling. For less sophisticated compilers it might be beneficial to
  * manually unroll the inner loop.
+ *
+ * On x86-64, unless we're compiling for AVX2 anyway, we compile the block
+ * checksum code a second time for AVX2, whose 256bit registers hold all 32
+ * partial checksums in four of them, and pick the variant to use at runtime
+ * by checking the CPU's features, like our CRC code does for SSE 4.2.
  */
 
 #include "storage/bufpage.h"
 
+#if defined(__x86_64__) && defined(__GNUC__) && defined(HAVE__GET_CPUID) && \
+	!defined(__AVX2__)
+#define USE_AVX2_CHECKSUM_WITH_RUNTIME_CHECK
+#include <cpuid.h>
+#endif
+
 /* number of checksums to calculate in parallel */
 #define N_SUMS 32
 /* prime multiplier of FNV-1a hash */
@@ -141,9 +152,12 @@ do { \
 /*
  * Block checksum algorithm.  The page must be adequately aligned
  * (at least on 4-byte boundary).
+ *
+ * This is always inlined into its callers below, so that each gets compiled
+ * for the instruction set it targets.
  */
-static uint32
-pg_checksum_block(const PGChecksummablePage *page)
+static pg_attribute_always_inline uint32
+pg_checksum_block_internal(const PGChecksummablePage *page)
 {
 	uint32		sums[N_SUMS];
 	uint32		result = 0;
@@ -173,6 +187,78 @@ pg_checksum_block(const PGChecksummablePage *page)
 	return result;
 }
 
+#ifdef USE_AVX2_CHECKSUM_WITH_RUNTIME_CHECK
+
+static uint32
+pg_checksum_block_default(const PGChecksummablePage *page)
+{
+	return pg_checksum_block_internal(page);
+}
+
+__attribute__((target("avx2")))
+static uint32
+pg_checksum_block_avx2(const PGChecksummablePage *page)
+{
+	return pg_checksum_block_internal(page);
+}
+
+/*
+ * Does the CPU support AVX2, and does the OS save the 256bit registers on
+ * context switches?
+ */
+static bool
+pg_checksum_avx2_available(void)
+{
+	unsigned int exx[4] = {0, 0, 0, 0};
+	uint32		xcr0_lo,
+				xcr0_hi;
+
+	if (__get_cpuid_max(0, NULL) < 7)
+		return false;
+
+	__get_cpuid(1, &exx[0], &exx[1], &exx[2], &exx[3]);
+	if ((exx[2] & (1 << 27)) == 0)	/* OSXSAVE */
+		return false;
+
+	/* XCR0 must have the SSE and AVX state bits set */
+	__asm__ __volatile__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+	if ((xcr0_lo & 0x06) != 0x06)
+		return false;
+
+	__cpuid_count(7, 0, exx[0], exx[1], exx[2], exx[3]);
+	return (exx[1] & (1 << 5)) != 0;	/* AVX2 */
+}
+
+static uint32 pg_checksum_block_choose(const PGChecksummablePage *page);
+
+static uint32 (*pg_checksum_block) (const PGChecksummablePage *page) =
+pg_checksum_block_choose;
+
+/*
+ * This gets called on the first call.  It replaces the function pointer so
+ * that subsequent calls are routed directly to the chosen implementation.
+ */
+static uint32
+pg_checksum_block_choose(const PGChecksummablePage *page)
+{
+	if (pg_checksum_avx2_available())
+		pg_checksum_block = pg_checksum_block_avx2;
+	else
+		pg_checksum_block = pg_checksum_block_default;
+
+	return pg_checksum_block(page);
+}
+
+#else							/* !USE_AVX2_CHECKSUM_WITH_RUNTIME_CHECK */
+
+static uint32
+pg_checksum_block(const PGChecksummablePage *page)
+{
+	return pg_checksum_block_internal(page);
+}
+
+#endif							/* USE_AVX2_CHECKSUM_WITH_RUNTIME_CHECK */
+
 /*
  * Compute the checksum for a Postgres page.
  *
@@ -0,0 +1,47 @@
+/*-------------------------------------------------------------------------
+ *
+ * doublewrite.h
+ *	  Torn page protection by writing pages to a double-write file first.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/doublewrite.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef DOUBLEWRITE_H
+#define DOUBLEWRITE_H
+
+#include "common/relpath.h"
+#include "storage/block.h"
+#include "storage/relfilenode.h"
+
+/* Name of the double-write file, and its path relative to the data dir */
+#define DOUBLE_WRITE_FILENAME	"pg_dblwrite"
+#define DOUBLE_WRITE_FILE		"global/" DOUBLE_WRITE_FILENAME
+
+/* GUC variables */
+extern int	double_write_buffers;
+
+extern Size DoubleWriteShmemSize(void);
+extern void DoubleWriteShmemInit(void);
+
+extern void DoubleWriteRecover(void);
+extern void DoubleWriteInitFile(void);
+
+extern bool DoubleWriteActive(void);
+extern int	DoubleWriteBegin(RelFileNode rnode, ForkNumber forknum,
+							 BlockNumber blkno, char *page);
+extern void DoubleWriteEnd(int slotno);
+extern void DoubleWriteAbort(void);
+
+extern void DoubleWriteCheckpointStart(void);
+extern void DoubleWriteCheckpointDone(void);
+
+extern void DoubleWriteForget(RelFileNode rnode, ForkNumber forknum,
+							  BlockNumber firstblock);
+extern void DoubleWriteForgetDatabase(Oid dbid);
+
+#endif							/* DOUBLEWRITE_H */
@@ -18,6 +18,7 @@
 #error "lwlock.h may not be included from frontend code"
 #endif
 
+#include "datatype/timestamp.h"
 #include "port/atomics.h"
 #include "storage/proclist_types.h"
 
@@ -141,6 +142,9 @@ typedef enum LWLockMode
 extern bool Trace_lwlocks;
 #endif
 
+/* GUC variables */
+extern bool lwlock_handoff;
+
 extern bool LWLockAcquire(LWLock *lock, LWLockMode mode);
 extern bool LWLockConditionalAcquire(LWLock *lock, LWLockMode mode);
 extern bool LWLockAcquireOrWait(LWLock *lock, LWLockMode mode);
@@ -218,6 +222,20 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_SHARED_TIDBITMAP,
 	LWTRANCHE_PARALLEL_APPEND,
 	LWTRANCHE_PER_XACT_PREDICATE_LIST,
+	LWTRANCHE_RELATION_EXTENSION,
+	LWTRANCHE_XACT_SLRU,
+	LWTRANCHE_COMMITTS_SLRU,
+	LWTRANCHE_SUBTRANS_SLRU,
+	LWTRANCHE_MULTIXACTOFFSET_SLRU,
+	LWTRANCHE_MULTIXACTMEMBER_SLRU,
+	LWTRANCHE_NOTIFY_SLRU,
+	LWTRANCHE_SERIAL_SLRU,
+	LWTRANCHE_SHARED_PLAN_CACHE_DSA,
+	LWTRANCHE_TABLE_STATS_DSA,
+	LWTRANCHE_TABLE_STATS_HASH,
+	LWTRANCHE_SHARED_CATCACHE_DSA,
+	LWTRANCHE_RELSIZE_CACHE,
+	LWTRANCHE_SEQUENCE_CACHE,
 	LWTRANCHE_FIRST_USER_DEFINED
 }			BuiltinTrancheIds;
 
@@ -228,4 +246,23 @@ typedef enum BuiltinTrancheIds
  */
 typedef LWLock *LWLockId;
 
+/*
+ * Contention statistics of an individual LWLock or built-in tranche, as
+ * shown in pg_stat_lwlocks.  Tranches of extensions are not tracked.
+ */
+#define NUM_LWLOCK_STATS_ENTRIES	LWTRANCHE_FIRST_USER_DEFINED
+
+typedef struct LWLockStatsEntry
+{
+	uint64		acquire_count;	/* successful acquisitions */
+	uint64		wait_count;		/* number of times a process slept */
+	uint64		wait_time;		/* time spent sleeping, in microseconds */
+} LWLockStatsEntry;
+
+extern Size LWLockStatsShmemSize(void);
+extern void LWLockStatsShmemInit(void);
+extern void LWLockStatsFlush(bool force);
+extern TimestampTz LWLockStatsFetch(LWLockStatsEntry *result);
+extern void LWLockStatsReset(void);
+
 #endif							/* LWLOCK_H */
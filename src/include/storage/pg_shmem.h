@@ -45,6 +45,8 @@ typedef struct PGShmemHeader	/* standard header for all Postgres shmem */
 extern int	shared_memory_type;
 extern int	huge_pages;
 extern int	huge_page_size;
+extern int	shared_memory_numa;
+extern char *shared_memory_numa_nodes;
 
 /* Possible values for huge_pages */
 typedef enum
@@ -54,6 +56,17 @@ typedef enum
 	HUGE_PAGES_TRY
 }			HugePagesType;
 
+/* Possible values for shared_memory_numa */
+typedef enum
+{
+	SHMEM_NUMA_OFF,
+	SHMEM_NUMA_INTERLEAVE,
+	SHMEM_NUMA_BIND
+}			ShmemNumaType;
+
+/* highest NUMA node number we can handle, plus one */
+#define PG_SHMEM_MAX_NUMA_NODES 64
+
 /* Possible values for shared_memory_type */
 typedef enum
 {
@@ -87,5 +100,7 @@ extern PGShmemHeader *PGSharedMemoryCreate(Size size,
 										   PGShmemHeader **shim);
 extern bool PGSharedMemoryIsInUse(unsigned long id1, unsigned long id2);
 extern void PGSharedMemoryDetach(void);
+extern bool PGSharedMemoryNumaUsage(void *addr, Size size, Size *node_bytes,
+									Size *unplaced_bytes);
 
 #endif							/* PG_SHMEM_H */
@@ -58,9 +58,11 @@ extern bool CheckPostmasterSignal(PMSignalReason reason);
 extern int	AssignPostmasterChildSlot(void);
 extern bool ReleasePostmasterChildSlot(int slot);
 extern bool IsPostmasterChildWalSender(int slot);
+extern bool IsPostmasterChildPreforkReady(int slot);
 extern void MarkPostmasterChildActive(void);
 extern void MarkPostmasterChildInactive(void);
 extern void MarkPostmasterChildWalSender(void);
+extern void MarkPostmasterChildPreforkReady(bool ready);
 extern bool PostmasterIsAliveInternal(void);
 extern void PostmasterDeathSignalInit(void);
 
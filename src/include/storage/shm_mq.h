@@ -25,7 +25,10 @@ typedef struct shm_mq shm_mq;
 struct shm_mq_handle;
 typedef struct shm_mq_handle shm_mq_handle;
 
-/* Descriptors for a single write spanning multiple locations. */
+/*
+ * Descriptors for a single write spanning multiple locations, or for the
+ * messages returned by shm_mq_receive_many.
+ */
 typedef struct
 {
 	const char *data;
@@ -70,11 +73,20 @@ extern shm_mq *shm_mq_get_queue(shm_mq_handle *mqh);
 
 /* Send or receive messages. */
 extern shm_mq_result shm_mq_send(shm_mq_handle *mqh,
-								 Size nbytes, const void *data, bool nowait);
+								 Size nbytes, const void *data, bool nowait,
+								 bool force_flush);
 extern shm_mq_result shm_mq_sendv(shm_mq_handle *mqh,
-								  shm_mq_iovec *iov, int iovcnt, bool nowait);
+								  shm_mq_iovec *iov, int iovcnt, bool nowait,
+								  bool force_flush);
+extern shm_mq_result shm_mq_flush(shm_mq_handle *mqh);
 extern shm_mq_result shm_mq_receive(shm_mq_handle *mqh,
 									Size *nbytesp, void **datap, bool nowait);
+extern shm_mq_result shm_mq_receive_many(shm_mq_handle *mqh,
+										 shm_mq_iovec *msgs, int maxmsgs,
+										 int *nmsgs, bool nowait);
+
+/* Check whether the receiver has caught up with what was sent. */
+extern bool shm_mq_is_drained(shm_mq_handle *mqh);
 
 /* Wait for our counterparty to attach to the queue. */
 extern shm_mq_result shm_mq_wait_for_attach(shm_mq_handle *mqh);
@@ -121,6 +121,25 @@ typedef union
 	SharedInvalSnapshotMsg sn;
 } SharedInvalidationMessage;
 
+/*
+ * When a backend falls so far behind that messages it hasn't read yet must
+ * make room in the queue, they are summarized for it instead, as long as
+ * they are of the kinds that can be: catcache messages are reduced to the
+ * caches they concern, relcache messages to a Bloom filter of relation OIDs,
+ * and smgr messages to a flag.  Messages for other databases are dropped.
+ * On receipt, the backend resets only what the summary covers; any other
+ * lost message forces a full reset.
+ */
+#define SINVAL_SUMMARY_CATCACHES	128
+#define SINVAL_SUMMARY_FILTER_BITS	4096
+
+typedef struct SharedInvalidationSummary
+{
+	bool		smgr;			/* smgr messages were lost */
+	uint64		catcaches[SINVAL_SUMMARY_CATCACHES / 64];	/* cache IDs */
+	uint64		relations[SINVAL_SUMMARY_FILTER_BITS / 64]; /* relation OIDs */
+} SharedInvalidationSummary;
+
 
 /* Counter of messages processed; don't worry about overflow. */
 extern uint64 SharedInvalidMessageCounter;
@@ -130,8 +149,16 @@ extern volatile sig_atomic_t catchupInterruptPending;
 extern void SendSharedInvalidMessages(const SharedInvalidationMessage *msgs,
 									  int n);
 extern void ReceiveSharedInvalidMessages(void (*invalFunction) (SharedInvalidationMessage *msg),
+										 void (*summaryFunction) (const SharedInvalidationSummary *summary),
 										 void (*resetFunction) (void));
 
+extern void SharedInvalSummaryAddRelation(SharedInvalidationSummary *summary,
+										  Oid relid);
+extern bool SharedInvalSummaryHasRelation(const SharedInvalidationSummary *summary,
+										  Oid relid);
+extern bool SharedInvalSummaryHasCatcache(const SharedInvalidationSummary *summary,
+										  int cacheId);
+
 /* signal handler for catchup events (PROCSIG_CATCHUP_INTERRUPT) */
 extern void HandleCatchupInterrupt(void);
 
@@ -25,6 +25,13 @@
 #include "storage/lock.h"
 #include "storage/sinval.h"
 
+/* GUC variable */
+extern int	sinval_queue_size;
+
+/* special results of SIGetDataEntries */
+#define SI_GET_RESET		(-1)
+#define SI_GET_SUMMARY		(-2)
+
 /*
  * prototypes for functions in sinvaladt.c
  */
@@ -35,7 +42,8 @@ extern PGPROC *BackendIdGetProc(int backendID);
 extern void BackendIdGetTransactionIds(int backendID, TransactionId *xid, TransactionId *xmin);
 
 extern void SIInsertDataEntries(const SharedInvalidationMessage *data, int n);
-extern int	SIGetDataEntries(SharedInvalidationMessage *data, int datasize);
+extern int	SIGetDataEntries(SharedInvalidationMessage *data, int datasize,
+							 SharedInvalidationSummary *summary);
 extern void SICleanupQueue(bool callerHasWriteLock, int minFree);
 
 extern LocalTransactionId GetNextLocalTransactionId(void);
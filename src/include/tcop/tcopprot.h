@@ -42,6 +42,8 @@ typedef enum
 
 extern PGDLLIMPORT int log_statement;
 
+extern PGDLLIMPORT bool defer_sync_flush;
+
 extern List *pg_parse_query(const char *query_string);
 extern List *pg_analyze_and_rewrite(RawStmt *parsetree,
 									const char *query_string,
@@ -103,6 +103,14 @@ typedef struct catctup
 	 */
 	dlist_node	cache_elem;		/* list member of per-bucket list */
 
+	/*
+	 * Unless it's a member of a CatCList, each tuple is also a member of a
+	 * dlist of all caches' tuples, in LRU order, from which entries are
+	 * evicted when the caches use more than max_catcache_memory.
+	 */
+	dlist_node	lru_elem;		/* list member of global LRU list */
+	uint64		lastaccess;		/* value of ch_clock when last used */
+
 	/*
 	 * A tuple marked "dead" must not be returned by subsequent searches.
 	 * However, it won't be physically deleted from the cache until its
@@ -163,6 +171,10 @@ typedef struct catclist
 
 	dlist_node	cache_elem;		/* list member of per-catcache list */
 
+	/* Lists have their own LRU list; their members are evicted with them */
+	dlist_node	lru_elem;		/* list member of global LRU list */
+	uint64		lastaccess;		/* value of ch_clock when last used */
+
 	/*
 	 * Lookup keys for the entry, with the first nkeys elements being valid.
 	 * All by-reference are separately allocated.
@@ -183,8 +195,15 @@ typedef struct catcacheheader
 {
 	slist_head	ch_caches;		/* head of list of CatCache structs */
 	int			ch_ntup;		/* # of tuples in all caches */
+	Size		ch_nbytes;		/* memory used by tuples and lists */
+	uint64		ch_clock;		/* advanced whenever an entry is used */
+	dlist_head	ch_lru;			/* tuples not in lists, most recent first */
+	dlist_head	ch_lru_lists;	/* lists, most recent first */
 } CatCacheHeader;
 
+/* GUC variable, in kB; zero means no limit */
+extern int	max_catcache_memory;
+
 
 /* this extern duplicates utils/memutils.h... */
 extern PGDLLIMPORT MemoryContext CacheMemoryContext;
@@ -217,6 +236,7 @@ extern CatCList *SearchCatCacheList(CatCache *cache, int nkeys,
 									Datum v3);
 extern void ReleaseCatCacheList(CatCList *list);
 
+extern void ResetCatalogCache(CatCache *cache);
 extern void ResetCatalogCaches(void);
 extern void CatalogCacheFlushCatalog(Oid catId);
 extern void CatCacheInvalidate(CatCache *cache, uint32 hashValue);
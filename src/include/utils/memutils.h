@@ -144,6 +144,29 @@ extern void MemoryContextCreate(MemoryContext node,
 								MemoryContext parent,
 								const char *name);
 
+/*
+ * Backend-wide memory accounting.  Context-type-specific code must keep
+ * *my_allocated_bytes in step with the mem_allocated of each context, and
+ * must fail the request, as if malloc() had, when MemoryLimitExceeded()
+ * says that obtaining more memory would take the backend past
+ * max_backend_memory.
+ */
+extern PGDLLIMPORT uint64 *my_allocated_bytes;
+extern PGDLLIMPORT int max_backend_memory;
+
+extern void SetAllocatedBytesCounter(uint64 *counter);
+extern bool MemoryLimitExceededSlow(Size size);
+
+#ifndef FRONTEND
+static inline bool
+MemoryLimitExceeded(Size size)
+{
+	if (likely(max_backend_memory == 0))
+		return false;
+	return MemoryLimitExceededSlow(size);
+}
+#endif
+
 
 /*
  * Memory-context-type-specific functions
@@ -182,6 +205,13 @@ extern MemoryContext GenerationContextCreate(MemoryContext parent,
 											 const char *name,
 											 Size blockSize);
 
+/* bump.c */
+extern MemoryContext BumpContextCreate(MemoryContext parent,
+									   const char *name,
+									   Size minContextSize,
+									   Size initBlockSize,
+									   Size maxBlockSize);
+
 /*
  * Recommended default alloc parameters, suitable for "ordinary" contexts
  * that might hold quite a lot of data.
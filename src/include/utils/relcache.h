@@ -57,6 +57,8 @@ extern bytea **RelationGetIndexAttOptions(Relation relation, bool copy);
 typedef enum IndexAttrBitmapKind
 {
 	INDEX_ATTR_BITMAP_ALL,
+	INDEX_ATTR_BITMAP_HOT_BLOCKING,
+	INDEX_ATTR_BITMAP_SUMMARIZED,
 	INDEX_ATTR_BITMAP_KEY,
 	INDEX_ATTR_BITMAP_PRIMARY_KEY,
 	INDEX_ATTR_BITMAP_IDENTITY_KEY
@@ -123,6 +125,9 @@ extern void RelationCacheInvalidateEntry(Oid relationId);
 
 extern void RelationCacheInvalidate(void);
 
+struct SharedInvalidationSummary;
+extern void RelationCacheInvalidateSummarized(const struct SharedInvalidationSummary *summary);
+
 extern void RelationCloseSmgrByOid(Oid relationId);
 
 #ifdef USE_ASSERT_CHECKING
@@ -142,6 +147,9 @@ extern void RelationCacheInitFilePreInvalidate(void);
 extern void RelationCacheInitFilePostInvalidate(void);
 extern void RelationCacheInitFileRemove(void);
 
+/* GUC variable; zero means no limit */
+extern int	max_relcache_entries;
+
 /* should be used only by relcache.c and catcache.c */
 extern bool criticalRelcachesBuilt;
 
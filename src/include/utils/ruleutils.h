@@ -21,6 +21,8 @@ struct Plan;					/* avoid including plannodes.h here */
 struct PlannedStmt;
 
 
+extern char *pg_get_querydef(Query *query, bool pretty);
+
 extern char *pg_get_indexdef_string(Oid indexrelid);
 extern char *pg_get_indexdef_columns(Oid indexrelid, bool pretty);
 
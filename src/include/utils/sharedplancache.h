@@ -0,0 +1,38 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.h
+ *	  Generic plans shared between backends
+ *
+ * When shared_plan_cache_size is set, backends put the generic plans they
+ * build for saved CachedPlanSources into shared memory, and other backends
+ * preparing the same statement reuse them instead of planning it again; see
+ * sharedplancache.c.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedplancache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDPLANCACHE_H
+#define SHAREDPLANCACHE_H
+
+#include "storage/sinval.h"
+#include "utils/plancache.h"
+
+/* GUC variable, in kB; zero disables the shared plan cache */
+extern int	shared_plan_cache_size;
+
+extern Size SharedPlanCacheShmemSize(void);
+extern void SharedPlanCacheShmemInit(void);
+
+extern List *SharedPlanCacheFetch(CachedPlanSource *plansource,
+								  uint64 *generation);
+extern bool SharedPlanCacheCheck(uint64 *generation);
+extern void SharedPlanCacheStore(CachedPlanSource *plansource,
+								 List *stmt_list, uint64 generation);
+extern void SharedPlanCacheInvalidate(const SharedInvalidationMessage *msgs,
+									  int n);
+
+#endif							/* SHAREDPLANCACHE_H */
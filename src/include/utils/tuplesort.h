@@ -210,6 +210,10 @@ extern Tuplesortstate *tuplesort_begin_index_btree(Relation heapRel,
 												   bool enforceUnique,
 												   int workMem, SortCoordinate coordinate,
 												   bool randomAccess);
+extern Tuplesortstate *tuplesort_begin_index_gist(Relation heapRel,
+												  Relation indexRel,
+												  int workMem, SortCoordinate coordinate,
+												  bool randomAccess);
 extern Tuplesortstate *tuplesort_begin_index_hash(Relation heapRel,
 												  Relation indexRel,
 												  uint32 high_mask,
@@ -261,6 +265,7 @@ extern int	tuplesort_merge_order(int64 allowedMem);
 extern Size tuplesort_estimate_shared(int nworkers);
 extern void tuplesort_initialize_shared(Sharedsort *shared, int nWorkers,
 										dsm_segment *seg);
+extern void tuplesort_reinitialize_shared(Sharedsort *shared);
 extern void tuplesort_attach_shared(Sharedsort *shared, dsm_segment *seg);
 
 /*
@@ -198,6 +198,43 @@ ECPGsetcommit(int lineno, const char *mode, const char *connection_name)
 	return true;
 }
 
+/*
+ * Turn pipelined execution on or off.  While it is on, statements without
+ * output variables are queued using the libpq batch API, and their results
+ * are only checked at the next sync point: a statement with output
+ * variables, a transaction command, or turning the mode off again.
+ */
+bool
+ECPGsetpipeline(int lineno, const char *mode, const char *connection_name)
+{
+	struct connection *con = ecpg_get_connection(connection_name);
+
+	if (!ecpg_init(con, connection_name, lineno))
+		return false;
+
+	ecpg_log("ECPGsetpipeline on line %d: action \"%s\"; connection \"%s\"\n", lineno, mode, con->name);
+
+	if (!con->pipeline && strncmp(mode, "on", strlen("on")) == 0)
+	{
+		con->pipeline_xact = (PQtransactionStatus(con->connection) != PQTRANS_IDLE);
+		if (!PQenterBatchMode(con->connection))
+			return ecpg_check_PQresult(NULL, lineno, con->connection, ECPG_COMPAT_PGSQL);
+		con->pipeline = true;
+	}
+	else if (con->pipeline && strncmp(mode, "off", strlen("off")) == 0)
+	{
+		bool		ok;
+
+		ok = ecpg_pipeline_sync(con, lineno, ECPG_COMPAT_PGSQL, NULL);
+		con->pipeline = false;
+		if (!PQexitBatchMode(con->connection))
+			return ok ? ecpg_check_PQresult(NULL, lineno, con->connection, ECPG_COMPAT_PGSQL) : false;
+		return ok;
+	}
+
+	return true;
+}
+
 bool
 ECPGsetconn(int lineno, const char *connection_name)
 {
@@ -674,6 +711,8 @@ ECPGconnect(int lineno, int c, const char *name, const char *user, const char *p
 #endif
 
 	this->autocommit = autocommit;
+	this->pipeline = false;
+	this->pipeline_xact = false;
 
 	PQsetNoticeReceiver(this->connection, &ECPGnoticeReceiver, (void *) this);
 
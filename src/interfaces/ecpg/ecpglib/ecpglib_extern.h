@@ -103,6 +103,8 @@ struct connection
 	char	   *name;
 	PGconn	   *connection;
 	bool		autocommit;
+	bool		pipeline;		/* statements are queued in libpq batch mode */
+	bool		pipeline_xact;	/* transaction open as of the queued commands */
 	struct ECPGtype_information_cache *cache_head;
 	struct prepared_statement *prep_stmts;
 	struct connection *next;
@@ -196,6 +198,9 @@ bool		ecpg_do_prologue(int, const int, const int, const char *, const bool,
 bool		ecpg_build_params(struct statement *);
 bool		ecpg_autostart_transaction(struct statement *stmt);
 bool		ecpg_execute(struct statement *stmt);
+bool		ecpg_pipeline_queue(struct connection *con, int lineno, const char *query);
+bool		ecpg_pipeline_sync(struct connection *con, int lineno,
+							   enum COMPAT_MODE compat, PGresult **last_result);
 bool		ecpg_process_output(struct statement *, bool);
 void		ecpg_do_epilogue(struct statement *);
 bool		ecpg_do(const int, const int, const int, const char *, const bool,
@@ -1584,6 +1584,26 @@ ecpg_build_params(struct statement *stmt)
 bool
 ecpg_autostart_transaction(struct statement *stmt)
 {
+	struct connection *con = stmt->connection;
+
+	/*
+	 * libpq doesn't report the transaction status in batch mode, so go by
+	 * what ecpg_pipeline_sync() found and the BEGINs queued since then.
+	 */
+	if (con->pipeline)
+	{
+		if (!con->autocommit && !con->pipeline_xact)
+		{
+			if (!ecpg_pipeline_queue(con, stmt->lineno, "begin transaction"))
+			{
+				ecpg_free_params(stmt, false);
+				return false;
+			}
+			con->pipeline_xact = true;
+		}
+		return true;
+	}
+
 	if (PQtransactionStatus(stmt->connection->connection) == PQTRANS_IDLE && !stmt->connection->autocommit)
 	{
 		stmt->results = PQexec(stmt->connection->connection, "begin transaction");
@@ -1654,6 +1674,131 @@ ecpg_execute(struct statement *stmt)
 	return true;
 }
 
+/*
+ * ecpg_pipeline_queue
+ *		Queue a parameterless command on a connection in pipeline mode.
+ */
+bool
+ecpg_pipeline_queue(struct connection *con, int lineno, const char *query)
+{
+	ecpg_log("ecpg_pipeline_queue on line %d: query: %s; on connection %s\n", lineno, query, con->name);
+	if (!PQsendQueryParams(con->connection, query, 0, NULL, NULL, NULL, NULL, 0))
+		return ecpg_check_PQresult(NULL, lineno, con->connection, ECPG_COMPAT_PGSQL);
+	return true;
+}
+
+/*
+ * ecpg_pipeline_sync
+ *		Send a sync for the commands queued in pipeline mode and collect
+ *		their results.
+ *
+ * The first error among them is raised as usual, but with the line number of
+ * the sync point; the server skips the commands queued after it.  If
+ * last_result is not NULL, the result of the last command is returned there
+ * rather than cleared.
+ */
+bool
+ecpg_pipeline_sync(struct connection *con, int lineno, enum COMPAT_MODE compat,
+				   PGresult **last_result)
+{
+	PGconn	   *conn = con->connection;
+	bool		ok = true;
+
+	ecpg_log("ecpg_pipeline_sync on line %d: connection %s\n", lineno, con->name);
+
+	if (last_result)
+		*last_result = NULL;
+
+	if (!PQbatchSendQueue(conn))
+		return ecpg_check_PQresult(NULL, lineno, conn, compat);
+
+	while (PQbatchProcessQueue(conn))
+	{
+		PGresult   *res;
+
+		while ((res = PQgetResult(conn)) != NULL)
+		{
+			ExecStatusType status = PQresultStatus(res);
+
+			if (status == PGRES_BATCH_END || status == PGRES_BATCH_ABORTED)
+				PQclear(res);
+			else if (!ok)
+				PQclear(res);
+			else if (!ecpg_check_PQresult(res, lineno, conn, compat))
+				ok = false;
+			else if (last_result)
+			{
+				if (*last_result)
+					PQclear(*last_result);
+				*last_result = res;
+			}
+			else
+				PQclear(res);
+		}
+	}
+
+	if (!ok && last_result && *last_result)
+	{
+		PQclear(*last_result);
+		*last_result = NULL;
+	}
+
+	/*
+	 * The transaction status is only reported outside batch mode, so leave
+	 * it for a moment to learn whether a transaction is still open.
+	 */
+	if (!PQexitBatchMode(conn))
+		return ok ? ecpg_check_PQresult(NULL, lineno, conn, compat) : false;
+	con->pipeline_xact = (PQtransactionStatus(conn) != PQTRANS_IDLE);
+	if (!PQenterBatchMode(conn))
+		return ok ? ecpg_check_PQresult(NULL, lineno, conn, compat) : false;
+
+	return ok;
+}
+
+/*
+ * ecpg_pipeline_execute
+ *		Queue the SQL statement on a connection in pipeline mode.
+ *
+ * A statement with output variables needs its result right away, so it is
+ * followed by a sync, and stmt->results is set.  Otherwise any error is
+ * reported at the next sync point and stmt->results is left NULL.
+ */
+static bool
+ecpg_pipeline_execute(struct statement *stmt)
+{
+	PGconn	   *conn = stmt->connection->connection;
+	int			sent;
+
+	ecpg_log("ecpg_pipeline_execute on line %d: query: %s; with %d parameter(s) on connection %s\n", stmt->lineno, stmt->command, stmt->nparams, stmt->connection->name);
+	if (stmt->statement_type == ECPGst_execute)
+		sent = PQsendQueryPrepared(conn,
+								   stmt->name,
+								   stmt->nparams,
+								   (const char *const *) stmt->paramvalues,
+								   (const int *) stmt->paramlengths,
+								   (const int *) stmt->paramformats,
+								   0);
+	else
+		sent = PQsendQueryParams(conn,
+								 stmt->command, stmt->nparams, NULL,
+								 (const char *const *) stmt->paramvalues,
+								 (const int *) stmt->paramlengths,
+								 (const int *) stmt->paramformats,
+								 0);
+
+	ecpg_free_params(stmt, true);
+
+	if (!sent)
+		return ecpg_check_PQresult(NULL, stmt->lineno, conn, stmt->compat);
+
+	if (stmt->outlist == NULL)
+		return true;
+
+	return ecpg_pipeline_sync(stmt->connection, stmt->lineno, stmt->compat,
+							  &stmt->results);
+}
+
 /*-------
  * ecpg_process_output
  *
@@ -2265,11 +2410,28 @@ ecpg_do(const int lineno, const int compat, const int force_indicator, const cha
 	if (!ecpg_autostart_transaction(stmt))
 		goto fail;
 
-	if (!ecpg_execute(stmt))
-		goto fail;
+	/*
+	 * In pipeline mode, statements are queued without waiting for their
+	 * results, except for PREPARE, which still needs the synchronous path
+	 * (and so fails until pipeline mode is turned off).
+	 */
+	if (stmt->connection->pipeline &&
+		stmt->statement_type != ECPGst_prepare)
+	{
+		if (!ecpg_pipeline_execute(stmt))
+			goto fail;
 
-	if (!ecpg_process_output(stmt, true))
-		goto fail;
+		if (stmt->results && !ecpg_process_output(stmt, true))
+			goto fail;
+	}
+	else
+	{
+		if (!ecpg_execute(stmt))
+			goto fail;
+
+		if (!ecpg_process_output(stmt, true))
+			goto fail;
+	}
 
 	ecpg_do_epilogue(stmt);
 	return true;
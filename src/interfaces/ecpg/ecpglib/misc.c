@@ -205,6 +205,46 @@ ECPGtrans(int lineno, const char *connection_name, const char *transaction)
 
 	ecpg_log("ECPGtrans on line %d: action \"%s\"; connection \"%s\"\n", lineno, transaction, con ? con->name : "null");
 
+	/*
+	 * In pipeline mode, queue the same commands as below and make this a
+	 * sync point.  libpq doesn't report the transaction status in batch mode,
+	 * so go by con->pipeline_xact instead.
+	 */
+	if (con && con->connection && con->pipeline)
+	{
+		bool		ok;
+
+		if (!con->autocommit && !con->pipeline_xact &&
+			strncmp(transaction, "begin", 5) != 0 &&
+			strncmp(transaction, "start", 5) != 0 &&
+			strncmp(transaction, "commit prepared", 15) != 0 &&
+			strncmp(transaction, "rollback prepared", 17) != 0)
+		{
+			if (!ecpg_pipeline_queue(con, lineno, "begin transaction"))
+				return false;
+		}
+
+		if (!ecpg_pipeline_queue(con, lineno, transaction))
+			return false;
+		ok = ecpg_pipeline_sync(con, lineno, ECPG_COMPAT_PGSQL, NULL);
+
+		/*
+		 * If an error in an earlier command made the server skip a COMMIT
+		 * or ROLLBACK, the aborted transaction is still open.  Roll it back,
+		 * as the skipped command would have done.
+		 */
+		if (!ok && con->pipeline_xact &&
+			(strncmp(transaction, "commit", 6) == 0 ||
+			 strncmp(transaction, "rollback", 8) == 0) &&
+			strncmp(transaction, "commit prepared", 15) != 0 &&
+			strncmp(transaction, "rollback prepared", 17) != 0 &&
+			strncmp(transaction, "rollback to", 11) != 0 &&
+			ecpg_pipeline_queue(con, lineno, "rollback"))
+			(void) ecpg_pipeline_sync(con, lineno, ECPG_COMPAT_PGSQL, NULL);
+
+		return ok;
+	}
+
 	/* if we have no connection we just simulate the command */
 	if (con && con->connection)
 	{
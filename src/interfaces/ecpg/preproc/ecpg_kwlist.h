@@ -50,6 +50,7 @@ PG_KEYWORD("nullable", SQL_NULLABLE)
 PG_KEYWORD("octet_length", SQL_OCTET_LENGTH)
 PG_KEYWORD("open", SQL_OPEN)
 PG_KEYWORD("output", SQL_OUTPUT)
+PG_KEYWORD("pipeline", SQL_PIPELINE)
 PG_KEYWORD("reference", SQL_REFERENCE)
 PG_KEYWORD("returned_length", SQL_RETURNED_LENGTH)
 PG_KEYWORD("returned_octet_length", SQL_RETURNED_OCTET_LENGTH)
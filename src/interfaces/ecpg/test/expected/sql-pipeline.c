@@ -0,0 +1,228 @@
+/* Processed by ecpg (regression mode) */
+/* These include files are added by the preprocessor */
+#include <ecpglib.h>
+#include <ecpgerrno.h>
+#include <sqlca.h>
+/* End of automatic include section */
+#define ECPGdebug(X,Y) ECPGdebug((X)+100,(Y))
+
+#line 1 "pipeline.pgc"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#line 1 "regression.h"
+
+
+
+
+
+
+#line 5 "pipeline.pgc"
+
+
+int main() {
+  /* exec sql begin declare section */
+	   
+  
+#line 9 "pipeline.pgc"
+ int i , count , sum ;
+/* exec sql end declare section */
+#line 10 "pipeline.pgc"
+
+
+  ECPGdebug(1, stderr);
+  { ECPGconnect(__LINE__, 0, "ecpg1_regression" , NULL, NULL , NULL, 0); }
+#line 13 "pipeline.pgc"
+
+
+  /* exec sql whenever sql_warning  sqlprint ; */
+#line 15 "pipeline.pgc"
+
+  /* exec sql whenever sqlerror  sqlprint ; */
+#line 16 "pipeline.pgc"
+
+
+  { ECPGdo(__LINE__, 0, 1, NULL, 0, ECPGst_normal, "create table pipeline_test ( a int )", ECPGt_EOIT, ECPGt_EORT);
+#line 18 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 18 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 18 "pipeline.pgc"
+
+  { ECPGtrans(__LINE__, NULL, "commit");
+#line 19 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 19 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 19 "pipeline.pgc"
+
+
+  { ECPGsetpipeline(__LINE__, "on", NULL);
+#line 21 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 21 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 21 "pipeline.pgc"
+
+
+  /* these are queued without waiting for their results */
+  for (i = 1; i <= 3; i++)
+    { ECPGdo(__LINE__, 0, 1, NULL, 0, ECPGst_normal, "insert into pipeline_test values ( $1  )", 
+	ECPGt_int,&(i),(long)1,(long)1,sizeof(int), 
+	ECPGt_NO_INDICATOR, NULL , 0L, 0L, 0L, ECPGt_EOIT, ECPGt_EORT);
+#line 25 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 25 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 25 "pipeline.pgc"
+
+
+  /* output host variables make this a sync point */
+  { ECPGdo(__LINE__, 0, 1, NULL, 0, ECPGst_normal, "select count ( * ) , sum ( a ) from pipeline_test", ECPGt_EOIT, 
+	ECPGt_int,&(count),(long)1,(long)1,sizeof(int), 
+	ECPGt_NO_INDICATOR, NULL , 0L, 0L, 0L, 
+	ECPGt_int,&(sum),(long)1,(long)1,sizeof(int), 
+	ECPGt_NO_INDICATOR, NULL , 0L, 0L, 0L, ECPGt_EORT);
+#line 28 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 28 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 28 "pipeline.pgc"
+
+  printf("in pipeline: count %d sum %d\n", count, sum);
+
+  { ECPGtrans(__LINE__, NULL, "commit");
+#line 31 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 31 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 31 "pipeline.pgc"
+
+
+  /* an error in a queued statement is reported at the next sync point,
+     and the transaction it was part of is rolled back */
+  { ECPGdo(__LINE__, 0, 1, NULL, 0, ECPGst_normal, "insert into pipeline_test values ( 4 )", ECPGt_EOIT, ECPGt_EORT);
+#line 35 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 35 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 35 "pipeline.pgc"
+
+  { ECPGdo(__LINE__, 0, 1, NULL, 0, ECPGst_normal, "insert into pipeline_test values ( 1 / 0 )", ECPGt_EOIT, ECPGt_EORT);
+#line 36 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 36 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 36 "pipeline.pgc"
+
+  { ECPGdo(__LINE__, 0, 1, NULL, 0, ECPGst_normal, "insert into pipeline_test values ( 5 )", ECPGt_EOIT, ECPGt_EORT);
+#line 37 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 37 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 37 "pipeline.pgc"
+
+  { ECPGtrans(__LINE__, NULL, "commit");
+#line 38 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 38 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 38 "pipeline.pgc"
+
+
+  /* statements queued before turning it off are synced then */
+  { ECPGdo(__LINE__, 0, 1, NULL, 0, ECPGst_normal, "insert into pipeline_test values ( 6 )", ECPGt_EOIT, ECPGt_EORT);
+#line 41 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 41 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 41 "pipeline.pgc"
+
+  { ECPGsetpipeline(__LINE__, "off", NULL);
+#line 42 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 42 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 42 "pipeline.pgc"
+
+  { ECPGtrans(__LINE__, NULL, "commit");
+#line 43 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 43 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 43 "pipeline.pgc"
+
+
+  { ECPGdo(__LINE__, 0, 1, NULL, 0, ECPGst_normal, "select count ( * ) , sum ( a ) from pipeline_test", ECPGt_EOIT, 
+	ECPGt_int,&(count),(long)1,(long)1,sizeof(int), 
+	ECPGt_NO_INDICATOR, NULL , 0L, 0L, 0L, 
+	ECPGt_int,&(sum),(long)1,(long)1,sizeof(int), 
+	ECPGt_NO_INDICATOR, NULL , 0L, 0L, 0L, ECPGt_EORT);
+#line 45 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 45 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 45 "pipeline.pgc"
+
+  printf("after pipeline: count %d sum %d\n", count, sum);
+
+  { ECPGdo(__LINE__, 0, 1, NULL, 0, ECPGst_normal, "drop table pipeline_test", ECPGt_EOIT, ECPGt_EORT);
+#line 48 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 48 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 48 "pipeline.pgc"
+
+  { ECPGtrans(__LINE__, NULL, "commit");
+#line 49 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 49 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 49 "pipeline.pgc"
+
+  { ECPGdisconnect(__LINE__, "ALL");
+#line 50 "pipeline.pgc"
+
+if (sqlca.sqlwarn[0] == 'W') sqlprint();
+#line 50 "pipeline.pgc"
+
+if (sqlca.sqlcode < 0) sqlprint();}
+#line 50 "pipeline.pgc"
+
+
+  return 0;
+}
@@ -0,0 +1,432 @@
+/*-------------------------------------------------------------------------
+ *
+ * fe-compress.c
+ *	  The front-end (client) implementation of protocol compression
+ *
+ * If the compression connection option asks for it and the server agrees,
+ * by answering the startup packet with a CompressionAck message, all the
+ * rest of the session is exchanged in compressed chunks; see
+ * PQ_COMPRESSION_CHUNK_SIZE.  The compression sits on top of SSL or GSSAPI
+ * encryption, if any, in pqsecure_read() and pqsecure_write().
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/interfaces/libpq/fe-compress.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres_fe.h"
+
+#include "libpq-fe.h"
+#include "libpq-int.h"
+#include "port/pg_bswap.h"
+
+/* Methods to request when the compression option is "on", best first */
+static const StreamCompressionMethod default_methods[] =
+{
+	STREAM_COMPRESSION_ZSTD,
+	STREAM_COMPRESSION_LZ4,
+	STREAM_COMPRESSION_GZIP
+};
+
+#define PQ_ZBUFFER_SIZE (PQ_COMPRESSION_HEADER_SIZE + PQ_COMPRESSION_MAX_COMPRESSED)
+
+
+/*
+ * Check the compression connection option, and set conn->compression_offer
+ * to the list of methods to request, or NULL if compression is off.
+ *
+ * The option is "off" (or empty), "on" for all methods this build of libpq
+ * supports, or a comma-separated list of methods in order of preference.
+ *
+ * Returns false with a message in conn->errorMessage if the option is
+ * invalid or out of memory.
+ */
+bool
+pqcompress_parse_option(PGconn *conn)
+{
+	PQExpBufferData offer;
+	const char *value = conn->compression;
+
+	free(conn->compression_offer);
+	conn->compression_offer = NULL;
+
+	if (value == NULL || value[0] == '\0' || strcmp(value, "off") == 0)
+		return true;
+
+	initPQExpBuffer(&offer);
+
+	if (strcmp(value, "on") == 0)
+	{
+		int			i;
+
+		for (i = 0; i < lengthof(default_methods); i++)
+		{
+			if (!stream_compression_supported(default_methods[i]))
+				continue;
+			if (offer.len > 0)
+				appendPQExpBufferChar(&offer, ',');
+			appendPQExpBufferStr(&offer,
+								 stream_compression_method_name(default_methods[i]));
+		}
+	}
+	else
+	{
+		const char *p = value;
+
+		while (*p)
+		{
+			char		name[32];
+			size_t		namelen;
+			StreamCompressionMethod method;
+
+			while (*p == ' ')
+				p++;
+			namelen = strcspn(p, ", ");
+			if (namelen >= sizeof(name))
+				namelen = sizeof(name) - 1;
+			memcpy(name, p, namelen);
+			name[namelen] = '\0';
+
+			if (!parse_stream_compression_method(name, &method) ||
+				method == STREAM_COMPRESSION_NONE)
+			{
+				printfPQExpBuffer(&conn->errorMessage,
+								  libpq_gettext("invalid %s value: \"%s\"\n"),
+								  "compression", value);
+				termPQExpBuffer(&offer);
+				return false;
+			}
+			if (!stream_compression_supported(method))
+			{
+				printfPQExpBuffer(&conn->errorMessage,
+								  libpq_gettext("compression method \"%s\" is not supported by this build\n"),
+								  name);
+				termPQExpBuffer(&offer);
+				return false;
+			}
+
+			if (offer.len > 0)
+				appendPQExpBufferChar(&offer, ',');
+			appendPQExpBufferStr(&offer, stream_compression_method_name(method));
+
+			p += strcspn(p, ",");
+			if (*p == ',')
+				p++;
+		}
+	}
+
+	if (PQExpBufferBroken(&offer))
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("out of memory\n"));
+		termPQExpBuffer(&offer);
+		return false;
+	}
+
+	/* Nothing to offer if the build supports no compression method */
+	if (offer.len > 0)
+		conn->compression_offer = offer.data;
+	else
+		termPQExpBuffer(&offer);
+
+	return true;
+}
+
+/*
+ * Start compressing, as requested by the server in a CompressionAck message
+ * naming the method to use.
+ *
+ * The data we have already read past the CompressionAck message, from
+ * conn->inCursor to conn->inEnd, is compressed, so it's moved out of the
+ * input buffer into ours.
+ *
+ * Returns false with a message in conn->errorMessage on failure.
+ */
+bool
+pqcompress_start(PGconn *conn, const char *name)
+{
+	StreamCompressionMethod method;
+	int			leftover = conn->inEnd - conn->inCursor;
+
+	Assert(conn->compressor == NULL);
+
+	if (conn->compression_offer == NULL ||
+		!parse_stream_compression_method(name, &method) ||
+		method == STREAM_COMPRESSION_NONE ||
+		!stream_compression_supported(method))
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("server requested unsupported compression method \"%s\"\n"),
+						  name);
+		return false;
+	}
+
+	conn->compressor = stream_compressor_create(method, false);
+	conn->decompressor = stream_compressor_create(method, true);
+	conn->z_RecvSize = Max(PQ_ZBUFFER_SIZE, leftover);
+	conn->z_SendBuffer = malloc(PQ_ZBUFFER_SIZE);
+	conn->z_RecvBuffer = malloc(conn->z_RecvSize);
+	conn->z_ResultBuffer = malloc(PQ_COMPRESSION_CHUNK_SIZE);
+	if (conn->compressor == NULL || conn->decompressor == NULL ||
+		conn->z_SendBuffer == NULL || conn->z_RecvBuffer == NULL ||
+		conn->z_ResultBuffer == NULL)
+	{
+		pqcompress_close(conn);
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("could not initialize %s compression\n"),
+						  stream_compression_method_name(method));
+		return false;
+	}
+	Assert(stream_compress_bound(conn->compressor, PQ_COMPRESSION_CHUNK_SIZE) <=
+		   PQ_COMPRESSION_MAX_COMPRESSED);
+
+	conn->z_SendLength = conn->z_SendNext = conn->z_SendConsumed = 0;
+	conn->z_ResultLength = conn->z_ResultNext = 0;
+
+	memcpy(conn->z_RecvBuffer, conn->inBuffer + conn->inCursor, leftover);
+	conn->z_RecvLength = leftover;
+	conn->inEnd = conn->inCursor;
+
+	return true;
+}
+
+/*
+ * Release the compression state of a connection.
+ */
+void
+pqcompress_close(PGconn *conn)
+{
+	if (conn->compressor)
+		stream_compressor_free(conn->compressor);
+	conn->compressor = NULL;
+	if (conn->decompressor)
+		stream_compressor_free(conn->decompressor);
+	conn->decompressor = NULL;
+	if (conn->z_SendBuffer)
+		free(conn->z_SendBuffer);
+	conn->z_SendBuffer = NULL;
+	if (conn->z_RecvBuffer)
+		free(conn->z_RecvBuffer);
+	conn->z_RecvBuffer = NULL;
+	if (conn->z_ResultBuffer)
+		free(conn->z_ResultBuffer);
+	conn->z_ResultBuffer = NULL;
+	conn->z_SendLength = conn->z_SendNext = conn->z_SendConsumed = 0;
+	conn->z_RecvSize = conn->z_RecvLength = 0;
+	conn->z_ResultLength = conn->z_ResultNext = 0;
+}
+
+/*
+ * Is there data already received that pqcompress_read() can return without
+ * reading from the socket?
+ */
+bool
+pqcompress_read_pending(PGconn *conn)
+{
+	uint32		zlen;
+
+	if (conn->z_ResultNext < conn->z_ResultLength)
+		return true;
+	if (conn->z_RecvLength < PQ_COMPRESSION_HEADER_SIZE)
+		return false;
+
+	memcpy(&zlen, conn->z_RecvBuffer, 4);
+	zlen = pg_ntoh32(zlen);
+	return conn->z_RecvLength >= PQ_COMPRESSION_HEADER_SIZE + zlen;
+}
+
+/*
+ * Attempt to write len bytes of data from ptr to a compressed connection.
+ *
+ * This works like pg_GSS_write(): a positive return value only counts source
+ * bytes whose compressed chunks have been transmitted entirely, and the
+ * amount of source data in the chunk partly transmitted is remembered in
+ * conn->z_SendConsumed.  On a retry, the caller must pass that data again.
+ *
+ * On failure, returns -1 with errno set appropriately.  If the errno
+ * indicates a non-retryable error, a message is put into conn->errorMessage.
+ */
+ssize_t
+pqcompress_write(PGconn *conn, const void *ptr, size_t len)
+{
+	size_t		bytes_sent = 0;
+	size_t		bytes_to_compress;
+	size_t		bytes_compressed;
+
+	if (len < conn->z_SendConsumed)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  "compression caller failed to retransmit all data needing to be retried\n");
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* Discount whatever source data we already compressed. */
+	bytes_to_compress = len - conn->z_SendConsumed;
+	bytes_compressed = conn->z_SendConsumed;
+
+	while (bytes_to_compress || conn->z_SendLength)
+	{
+		size_t		rawlen;
+		int			zlen;
+		uint32		n32;
+
+		/* Send what's left of the last chunk compressed, if anything */
+		if (conn->z_SendLength)
+		{
+			ssize_t		ret;
+			ssize_t		amount = conn->z_SendLength - conn->z_SendNext;
+
+			ret = pqsecure_transport_write(conn,
+										   conn->z_SendBuffer + conn->z_SendNext,
+										   amount);
+			if (ret <= 0)
+			{
+				/* as in pg_GSS_write(), report what we did send, if any */
+				if (bytes_sent)
+					return bytes_sent;
+				return ret;
+			}
+
+			if (ret != amount)
+			{
+				conn->z_SendNext += ret;
+				continue;
+			}
+
+			bytes_sent += conn->z_SendConsumed;
+			conn->z_SendLength = conn->z_SendNext = conn->z_SendConsumed = 0;
+		}
+
+		if (!bytes_to_compress)
+			break;
+
+		/*
+		 * Compress the next chunk.  Any failure here is a hard failure, so we
+		 * return -1 even if bytes_sent > 0.
+		 */
+		rawlen = Min(bytes_to_compress, PQ_COMPRESSION_CHUNK_SIZE);
+		zlen = stream_compress(conn->compressor, (const char *) ptr + bytes_compressed,
+							   rawlen,
+							   conn->z_SendBuffer + PQ_COMPRESSION_HEADER_SIZE,
+							   PQ_COMPRESSION_MAX_COMPRESSED);
+		if (zlen < 0)
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("could not compress data to send to server\n"));
+			errno = EIO;		/* for lack of a better idea */
+			return -1;
+		}
+
+		n32 = pg_hton32((uint32) zlen);
+		memcpy(conn->z_SendBuffer, &n32, 4);
+		n32 = pg_hton32((uint32) rawlen);
+		memcpy(conn->z_SendBuffer + 4, &n32, 4);
+		conn->z_SendLength = PQ_COMPRESSION_HEADER_SIZE + zlen;
+
+		bytes_compressed += rawlen;
+		bytes_to_compress -= rawlen;
+		conn->z_SendConsumed += rawlen;
+	}
+
+	Assert(bytes_sent == len);
+
+	return bytes_sent;
+}
+
+/*
+ * Read up to len bytes of data into ptr from a compressed connection.
+ *
+ * Like pg_GSS_read(), we read no more than the rest of the current chunk
+ * from the transport, so that nothing is left buffered there when we return.
+ *
+ * Returns the number of data bytes read, or on failure, returns -1
+ * with errno set appropriately.  If the errno indicates a non-retryable
+ * error, a message is put into conn->errorMessage.  For retryable errors,
+ * caller should call again once the socket is ready.
+ */
+ssize_t
+pqcompress_read(PGconn *conn, void *ptr, size_t len)
+{
+	for (;;)
+	{
+		ssize_t		ret;
+		uint32		zlen;
+		uint32		rawlen;
+		size_t		needed;
+
+		/* Return data from the last chunk decompressed, if any is left */
+		if (conn->z_ResultNext < conn->z_ResultLength)
+		{
+			size_t		bytes_to_copy;
+
+			bytes_to_copy = Min(len, conn->z_ResultLength - conn->z_ResultNext);
+			memcpy(ptr, conn->z_ResultBuffer + conn->z_ResultNext, bytes_to_copy);
+			conn->z_ResultNext += bytes_to_copy;
+			return bytes_to_copy;
+		}
+
+		/* Collect the chunk header if we haven't already */
+		if (conn->z_RecvLength < PQ_COMPRESSION_HEADER_SIZE)
+			needed = PQ_COMPRESSION_HEADER_SIZE;
+		else
+		{
+			memcpy(&zlen, conn->z_RecvBuffer, 4);
+			zlen = pg_ntoh32(zlen);
+			memcpy(&rawlen, conn->z_RecvBuffer + 4, 4);
+			rawlen = pg_ntoh32(rawlen);
+
+			if (zlen == 0 || zlen > PQ_COMPRESSION_MAX_COMPRESSED ||
+				rawlen == 0 || rawlen > PQ_COMPRESSION_CHUNK_SIZE)
+			{
+				printfPQExpBuffer(&conn->errorMessage,
+								  libpq_gettext("invalid compressed data chunk sent by the server\n"));
+				errno = EIO;	/* for lack of a better idea */
+				return -1;
+			}
+
+			needed = PQ_COMPRESSION_HEADER_SIZE + zlen;
+
+			/* Decompress the chunk, once we have all of it */
+			if (conn->z_RecvLength >= needed)
+			{
+				if (!stream_decompress(conn->decompressor,
+									   conn->z_RecvBuffer + PQ_COMPRESSION_HEADER_SIZE,
+									   zlen, conn->z_ResultBuffer, rawlen))
+				{
+					printfPQExpBuffer(&conn->errorMessage,
+									  libpq_gettext("could not decompress data sent by the server\n"));
+					errno = EIO;	/* for lack of a better idea */
+					return -1;
+				}
+				conn->z_ResultLength = rawlen;
+				conn->z_ResultNext = 0;
+
+				conn->z_RecvLength -= needed;
+				memmove(conn->z_RecvBuffer, conn->z_RecvBuffer + needed,
+						conn->z_RecvLength);
+				continue;
+			}
+		}
+
+		/* Read the rest of the header or chunk */
+		ret = pqsecure_transport_read(conn,
+									  conn->z_RecvBuffer + conn->z_RecvLength,
+									  needed - conn->z_RecvLength);
+		/* If ret <= 0, the transport already set the correct errno */
+		if (ret <= 0)
+			return ret;
+		conn->z_RecvLength += ret;
+
+		/* If we still don't have all of it, return to the caller */
+		if (conn->z_RecvLength < needed)
+		{
+			errno = EWOULDBLOCK;
+			return -1;
+		}
+	}
+}
@@ -128,6 +128,7 @@ static int	ldapServiceLookup(const char *purl, PQconninfoOption *options,
 #define DefaultChannelBinding	"disable"
 #endif
 #define DefaultTargetSessionAttrs	"any"
+#define DefaultLoadBalanceHosts	"disable"
 #ifdef USE_SSL
 #define DefaultSSLMode "prefer"
 #else
@@ -351,9 +352,22 @@ static const internalPQconninfoOption PQconninfoOptions[] = {
 
 	{"target_session_attrs", "PGTARGETSESSIONATTRS",
 		DefaultTargetSessionAttrs, NULL,
-		"Target-Session-Attrs", "", 11, /* sizeof("read-write") = 11 */
+		"Target-Session-Attrs", "", 15, /* sizeof("prefer-standby") = 15 */
 	offsetof(struct pg_conn, target_session_attrs)},
 
+	{"load_balance_hosts", "PGLOADBALANCEHOSTS",
+		DefaultLoadBalanceHosts, NULL,
+		"Load-Balance-Hosts", "", 12,	/* sizeof("round-robin") = 12 */
+	offsetof(struct pg_conn, load_balance_hosts)},
+
+	{"host_weights", "PGHOSTWEIGHTS", NULL, NULL,
+		"Host-Weights", "", 20,
+	offsetof(struct pg_conn, host_weights)},
+
+	{"compression", "PGCOMPRESSION", "off", NULL,
+		"Compression", "", 16,
+	offsetof(struct pg_conn, compression)},
+
 	/* Terminating entry --- MUST BE LAST */
 	{NULL, NULL, NULL, NULL,
 	NULL, NULL, 0}
@@ -383,6 +397,11 @@ static const char short_uri_designator[] = "postgres://";
 
 static bool connectOptions1(PGconn *conn, const char *conninfo);
 static bool connectOptions2(PGconn *conn);
+static void orderHosts(PGconn *conn);
+static void getDisplayedServer(PGconn *conn, const char **host,
+							   const char **port);
+static bool parse_int_param(const char *value, int *result, PGconn *conn,
+							const char *context);
 static int	connectDBStart(PGconn *conn);
 static int	connectDBComplete(PGconn *conn);
 static PGPing internal_ping(PGconn *conn);
@@ -472,6 +491,9 @@ pqDropConnection(PGconn *conn, bool flushInput)
 	/* Always discard any unsent data */
 	conn->outCount = 0;
 
+	/* Free compression state */
+	pqcompress_close(conn);
+
 	/* Free authentication/encryption state */
 #ifdef ENABLE_GSS
 	{
@@ -1113,6 +1135,8 @@ connectOptions2(PGconn *conn)
 	{
 		pg_conn_host *ch = &conn->connhost[i];
 
+		ch->weight = 1;
+
 		if (ch->hostaddr != NULL && ch->hostaddr[0] != '\0')
 			ch->type = CHT_HOST_ADDRESS;
 		else if (ch->host != NULL && ch->host[0] != '\0')
@@ -1186,6 +1210,55 @@ connectOptions2(PGconn *conn)
 		}
 	}
 
+	/*
+	 * Likewise for the load balancing weights, except that they are only
+	 * remembered as numbers.
+	 */
+	if (conn->host_weights != NULL && conn->host_weights[0] != '\0')
+	{
+		char	   *s = conn->host_weights;
+		bool		more = true;
+
+		for (i = 0; i < conn->nconnhost && more; i++)
+		{
+			char	   *weight = parse_comma_separated_list(&s, &more);
+
+			if (weight == NULL)
+				goto oom_error;
+			if (!parse_int_param(weight, &conn->connhost[i].weight, conn,
+								 "host_weights"))
+			{
+				free(weight);
+				conn->status = CONNECTION_BAD;
+				return false;
+			}
+			free(weight);
+			if (conn->connhost[i].weight <= 0)
+			{
+				conn->status = CONNECTION_BAD;
+				printfPQExpBuffer(&conn->errorMessage,
+								  libpq_gettext("invalid %s value: \"%d\"\n"),
+								  "host_weights", conn->connhost[i].weight);
+				return false;
+			}
+		}
+
+		/* As for ports, a single weight applies to every host */
+		if (i == 1 && !more)
+		{
+			for (i = 1; i < conn->nconnhost; i++)
+				conn->connhost[i].weight = conn->connhost[0].weight;
+		}
+		else if (more || i != conn->nconnhost)
+		{
+			conn->status = CONNECTION_BAD;
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("could not match %d host weights to %d hosts\n"),
+							  count_comma_separated_elems(conn->host_weights), conn->nconnhost);
+			return false;
+		}
+	}
+
 	/*
 	 * If user name was not given, fetch it.  (Most likely, the fetch will
 	 * fail, since the only way we get here is if pg_fe_getauthname() failed
@@ -1419,22 +1492,67 @@ connectOptions2(PGconn *conn)
 	}
 
 	/*
-	 * Validate target_session_attrs option.
+	 * Validate target_session_attrs option, and remember its meaning.
 	 */
+	conn->target_server_type = SERVER_TYPE_ANY;
 	if (conn->target_session_attrs)
 	{
-		if (strcmp(conn->target_session_attrs, "any") != 0
-			&& strcmp(conn->target_session_attrs, "read-write") != 0)
+		if (strcmp(conn->target_session_attrs, "any") == 0)
+			conn->target_server_type = SERVER_TYPE_ANY;
+		else if (strcmp(conn->target_session_attrs, "read-write") == 0)
+			conn->target_server_type = SERVER_TYPE_READ_WRITE;
+		else if (strcmp(conn->target_session_attrs, "read-only") == 0)
+			conn->target_server_type = SERVER_TYPE_READ_ONLY;
+		else if (strcmp(conn->target_session_attrs, "primary") == 0)
+			conn->target_server_type = SERVER_TYPE_PRIMARY;
+		else if (strcmp(conn->target_session_attrs, "standby") == 0)
+			conn->target_server_type = SERVER_TYPE_STANDBY;
+		else if (strcmp(conn->target_session_attrs, "prefer-standby") == 0)
+			conn->target_server_type = SERVER_TYPE_PREFER_STANDBY;
+		else
 		{
 			conn->status = CONNECTION_BAD;
 			printfPQExpBuffer(&conn->errorMessage,
 							  libpq_gettext("invalid %s value: \"%s\"\n"),
-							  "target_settion_attrs",
+							  "target_session_attrs",
 							  conn->target_session_attrs);
 			return false;
 		}
 	}
 
+	/*
+	 * Validate load_balance_hosts option, and order the hosts accordingly.
+	 */
+	conn->load_balance_type = LOAD_BALANCE_DISABLE;
+	if (conn->load_balance_hosts)
+	{
+		if (strcmp(conn->load_balance_hosts, "disable") == 0)
+			conn->load_balance_type = LOAD_BALANCE_DISABLE;
+		else if (strcmp(conn->load_balance_hosts, "random") == 0)
+			conn->load_balance_type = LOAD_BALANCE_RANDOM;
+		else if (strcmp(conn->load_balance_hosts, "round-robin") == 0)
+			conn->load_balance_type = LOAD_BALANCE_ROUND_ROBIN;
+		else
+		{
+			conn->status = CONNECTION_BAD;
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("invalid %s value: \"%s\"\n"),
+							  "load_balance_hosts",
+							  conn->load_balance_hosts);
+			return false;
+		}
+	}
+	orderHosts(conn);
+
+	/*
+	 * Validate compression option, and work out which methods to request.
+	 */
+	if (!pqcompress_parse_option(conn))
+	{
+		conn->status = CONNECTION_BAD;
+		return false;
+	}
+
 	/*
 	 * Only if we get this far is it appropriate to try to connect. (We need a
 	 * state flag, rather than just the boolean result of this function, in
@@ -1451,6 +1569,113 @@ oom_error:
 	return false;
 }
 
+/*
+ * Reorder conn->connhost[] according to load_balance_hosts.
+ *
+ * With "random", the hosts are put in a random order in which each host's
+ * chance to come before the others is proportional to its weight.  With
+ * "round-robin", the list is rotated to start at the next host for each new
+ * connection made by this process, each host starting as many times in a
+ * row as its weight.  Either way, the remaining hosts are still tried if
+ * the first one fails.  The order is kept across PQreset().
+ */
+static void
+orderHosts(PGconn *conn)
+{
+	static unsigned long round_robin_counter = 0;
+	static bool round_robin_started = false;
+	unsigned short seed[3];
+	struct timeval tv;
+	int			total_weight = 0;
+	int			i;
+
+	if (conn->load_balance_type == LOAD_BALANCE_DISABLE ||
+		conn->nconnhost <= 1)
+		return;
+
+	for (i = 0; i < conn->nconnhost; i++)
+		total_weight += conn->connhost[i].weight;
+
+	/*
+	 * Seed a private generator, rather than disturbing the application's use
+	 * of random().  Mixing in the PGconn's address keeps connections opened
+	 * in the same microsecond apart.
+	 */
+	gettimeofday(&tv, NULL);
+	seed[0] = (unsigned short) (tv.tv_usec ^ getpid());
+	seed[1] = (unsigned short) (tv.tv_sec ^ (tv.tv_usec >> 16));
+	seed[2] = (unsigned short) ((uintptr_t) conn >> 4);
+
+	if (conn->load_balance_type == LOAD_BALANCE_RANDOM)
+	{
+		/*
+		 * Fill each position in turn with one of the remaining hosts, picked
+		 * with a probability proportional to its weight.
+		 */
+		for (i = 0; i < conn->nconnhost - 1; i++)
+		{
+			double		pick = pg_erand48(seed) * total_weight;
+			int			j;
+
+			for (j = i; j < conn->nconnhost - 1; j++)
+			{
+				pick -= conn->connhost[j].weight;
+				if (pick < 0)
+					break;
+			}
+
+			if (j != i)
+			{
+				pg_conn_host tmp = conn->connhost[i];
+
+				conn->connhost[i] = conn->connhost[j];
+				conn->connhost[j] = tmp;
+			}
+			total_weight -= conn->connhost[i].weight;
+		}
+	}
+	else
+	{
+		pg_conn_host *rotated;
+		unsigned long turn;
+		int			first;
+
+		/*
+		 * The counter is shared by all threads of the process.  It starts at
+		 * a random point, so that many short-lived clients making a single
+		 * connection each don't all start at the first host.
+		 */
+		pglock_thread();
+		if (!round_robin_started)
+		{
+			round_robin_counter = (unsigned long) (pg_erand48(seed) * total_weight);
+			round_robin_started = true;
+		}
+		turn = round_robin_counter++;
+		pgunlock_thread();
+
+		turn %= total_weight;
+		for (first = 0; first < conn->nconnhost - 1; first++)
+		{
+			if (turn < conn->connhost[first].weight)
+				break;
+			turn -= conn->connhost[first].weight;
+		}
+
+		if (first == 0)
+			return;
+
+		/* If we can't get the memory, just keep the listed order */
+		rotated = (pg_conn_host *) malloc(conn->nconnhost * sizeof(pg_conn_host));
+		if (rotated == NULL)
+			return;
+		for (i = 0; i < conn->nconnhost; i++)
+			rotated[i] = conn->connhost[(first + i) % conn->nconnhost];
+		free(conn->connhost);
+		conn->connhost = rotated;
+	}
+}
+
 /*
  *		PQconndefaults
  *
@@ -1688,6 +1913,25 @@ getHostaddr(PGconn *conn, char *host_addr, int host_addr_len)
 		host_addr[0] = '\0';
 }
 
+/* ----------
+ * getDisplayedServer -
+ * get the host and port of the current connection attempt, for messages
+ * ----------
+ */
+static void
+getDisplayedServer(PGconn *conn, const char **host, const char **port)
+{
+	pg_conn_host *ch = &conn->connhost[conn->whichhost];
+
+	if (ch->type == CHT_HOST_ADDRESS)
+		*host = ch->hostaddr;
+	else
+		*host = ch->host;
+	*port = ch->port;
+	if (*port == NULL || (*port)[0] == '\0')
+		*port = DEF_PGPORT_STR;
+}
+
 /* ----------
  * connectFailureMessage -
  * create a friendly error message on connection failure.
@@ -1728,13 +1972,7 @@ connectFailureMessage(PGconn *conn, int errorno)
 		getHostaddr(conn, host_addr, NI_MAXHOST);
 
 		/* To which host and port were we actually connecting? */
-		if (conn->connhost[conn->whichhost].type == CHT_HOST_ADDRESS)
-			displayed_host = conn->connhost[conn->whichhost].hostaddr;
-		else
-			displayed_host = conn->connhost[conn->whichhost].host;
-		displayed_port = conn->connhost[conn->whichhost].port;
-		if (displayed_port == NULL || displayed_port[0] == '\0')
-			displayed_port = DEF_PGPORT_STR;
+		getDisplayedServer(conn, &displayed_host, &displayed_port);
 
 		/*
 		 * If the user did not supply an IP address using 'hostaddr', and
@@ -2070,6 +2308,10 @@ connectDBStart(PGconn *conn)
 	conn->try_next_host = true;
 	conn->status = CONNECTION_NEEDED;
 
+	/* Also reset the target server type, which may have been relaxed */
+	if (conn->target_server_type == SERVER_TYPE_PREFER_STANDBY_PASS2)
+		conn->target_server_type = SERVER_TYPE_PREFER_STANDBY;
+
 	/*
 	 * The code for processing CONNECTION_NEEDED state is in PQconnectPoll(),
 	 * so that it can easily be re-executed if needed again during the
@@ -2371,7 +2613,18 @@ keep_going:						/* We will come back to here until there is
 		int			ret;
 		char		portstr[MAXPGPATH];
 
-		if (conn->whichhost + 1 >= conn->nconnhost)
+		if (conn->whichhost + 1 < conn->nconnhost)
+			conn->whichhost++;
+		else if (conn->target_server_type == SERVER_TYPE_PREFER_STANDBY)
+		{
+			/*
+			 * None of the hosts is a standby, so go through them again,
+			 * accepting any server this time.
+			 */
+			conn->target_server_type = SERVER_TYPE_PREFER_STANDBY_PASS2;
+			conn->whichhost = 0;
+		}
+		else
 		{
 			/*
 			 * Oops, no more hosts.  An appropriate error message is already
@@ -2379,7 +2632,6 @@ keep_going:						/* We will come back to here until there is
 			 */
 			goto error_return;
 		}
-		conn->whichhost++;
 
 		/* Drop any address info for previous host */
 		release_conn_addrinfo(conn);
@@ -2582,7 +2834,8 @@ keep_going:						/* We will come back to here until there is
 						 * IPv6 but kernel only accepts one family.
 						 */
 						if (addr_cur->ai_next != NULL ||
-							conn->whichhost + 1 < conn->nconnhost)
+							conn->whichhost + 1 < conn->nconnhost ||
+							conn->target_server_type == SERVER_TYPE_PREFER_STANDBY)
 						{
 							conn->try_next_addr = true;
 							goto keep_going;
@@ -3251,10 +3504,14 @@ keep_going:						/* We will come back to here until there is
 
 				/*
 				 * Validate message type: we expect only an authentication
-				 * request or an error here.  Anything else probably means
+				 * request or an error here, or the answer to our request for
+				 * compression if we made one.  Anything else probably means
 				 * it's not Postgres on the other end at all.
 				 */
-				if (!(beresp == 'R' || beresp == 'E'))
+				if (!(beresp == 'R' || beresp == 'E' ||
+					  (conn->compression_offer != NULL &&
+					   conn->compressor == NULL &&
+					   (beresp == 'z' || beresp == 'v'))))
 				{
 					appendPQExpBuffer(&conn->errorMessage,
 									  libpq_gettext("expected authentication request from server, but received %c\n"),
@@ -3293,6 +3550,14 @@ keep_going:						/* We will come back to here until there is
 					goto error_return;
 				}
 
+				if ((beresp == 'z' || beresp == 'v') &&
+					(msgLength < 5 || msgLength > 2000))
+				{
+					appendPQExpBuffer(&conn->errorMessage,
+									  libpq_gettext("invalid response to compression request from server\n"));
+					goto error_return;
+				}
+
 				if (beresp == 'E' && (msgLength < 8 || msgLength > 30000))
 				{
 					/* Handle error from a pre-3.0 server */
@@ -3347,6 +3612,47 @@ keep_going:						/* We will come back to here until there is
 					return PGRES_POLLING_READING;
 				}
 
+				/*
+				 * The server agreed to compress the rest of the session, with
+				 * the method named in the CompressionAck message.
+				 */
+				if (beresp == 'z')
+				{
+					if (pqGets(&conn->workBuffer, conn) ||
+						conn->inCursor != conn->inStart + 5 + msgLength)
+					{
+						appendPQExpBuffer(&conn->errorMessage,
+										  libpq_gettext("invalid response to compression request from server\n"));
+						goto error_return;
+					}
+					conn->inStart = conn->inCursor;
+
+					if (!pqcompress_start(conn, conn->workBuffer.data))
+						goto error_return;
+
+					/*
+					 * Decompress whatever came after the CompressionAck
+					 * already, as the socket may not become readable again.
+					 */
+					while (pqcompress_read_pending(conn))
+					{
+						if (pqReadData(conn) < 0)
+							goto error_return;
+					}
+					goto keep_going;
+				}
+
+				/*
+				 * A server that doesn't know about protocol compression lists
+				 * our request in a NegotiateProtocolVersion message.  Carry on
+				 * without it.
+				 */
+				if (beresp == 'v')
+				{
+					conn->inStart = conn->inCursor + msgLength;
+					goto keep_going;
+				}
+
 				/* Handle errors. */
 				if (beresp == 'E')
 				{
@@ -3586,16 +3892,60 @@ keep_going:						/* We will come back to here until there is
 
 		case CONNECTION_CHECK_TARGET:
 			{
-				/*
-				 * If a read-write connection is required, see if we have one.
-				 *
-				 * Servers before 7.4 lack the transaction_read_only GUC, but
-				 * by the same token they don't have any read-only mode, so we
-				 * may just skip the test in that case.
-				 */
-				if (conn->sversion >= 70400 &&
-					conn->target_session_attrs != NULL &&
-					strcmp(conn->target_session_attrs, "read-write") == 0)
+				const char *query = NULL;
+				const char *reject = NULL;
+
+				switch (conn->target_server_type)
+				{
+					case SERVER_TYPE_READ_WRITE:
+					case SERVER_TYPE_READ_ONLY:
+
+						/*
+						 * Servers before 7.4 lack the transaction_read_only
+						 * GUC, but by the same token they don't have any
+						 * read-only mode, so we may just skip the test in
+						 * that case.
+						 */
+						if (conn->sversion >= 70400)
+							query = "SHOW transaction_read_only";
+						else if (conn->target_server_type == SERVER_TYPE_READ_ONLY)
+							reject = libpq_gettext("could not make a read-only "
+												   "connection to server "
+												   "\"%s:%s\"\n");
+						break;
+					case SERVER_TYPE_PRIMARY:
+					case SERVER_TYPE_STANDBY:
+					case SERVER_TYPE_PREFER_STANDBY:
+
+						/* Likewise, there is no hot standby before 9.0 */
+						if (conn->sversion >= 90000)
+							query = "SELECT pg_catalog.pg_is_in_recovery()";
+						else if (conn->target_server_type != SERVER_TYPE_PRIMARY)
+							reject = libpq_gettext("server \"%s:%s\" is not "
+												   "in hot standby mode\n");
+						break;
+					default:
+						/* Any server will do */
+						break;
+				}
+
+				if (reject)
+				{
+					const char *displayed_host;
+					const char *displayed_port;
+
+					getDisplayedServer(conn, &displayed_host, &displayed_port);
+					appendPQExpBuffer(&conn->errorMessage, reject,
+									  displayed_host, displayed_port);
+
+					/* Close connection politely, and try the next host. */
+					conn->status = CONNECTION_OK;
+					sendTerminateConn(conn);
+					conn->try_next_host = true;
+					goto keep_going;
+				}
+
+				if (query)
 				{
 					/*
 					 * Save existing error messages across the PQsendQuery
@@ -3608,8 +3958,7 @@ keep_going:						/* We will come back to here until there is
 						goto error_return;
 
 					conn->status = CONNECTION_OK;
-					if (!PQsendQuery(conn,
-									 "SHOW transaction_read_only"))
+					if (!PQsendQuery(conn, query))
 					{
 						restoreErrorMessage(conn, &savedMessage);
 						goto error_return;
@@ -3694,6 +4043,15 @@ keep_going:						/* We will come back to here until there is
 			{
 				const char *displayed_host;
 				const char *displayed_port;
+				bool		check_read_only;
+				const char *query;
+
+				/* We sent one of the queries of CONNECTION_CHECK_TARGET */
+				check_read_only =
+					(conn->target_server_type == SERVER_TYPE_READ_WRITE ||
+					 conn->target_server_type == SERVER_TYPE_READ_ONLY);
+				query = check_read_only ? "SHOW transaction_read_only" :
+					"SELECT pg_catalog.pg_is_in_recovery()";
 
 				if (!saveErrorMessage(conn, &savedMessage))
 					goto error_return;
@@ -3716,28 +4074,47 @@ keep_going:						/* We will come back to here until there is
 				if (res && (PQresultStatus(res) == PGRES_TUPLES_OK) &&
 					PQntuples(res) == 1)
 				{
-					char	   *val;
+					char	   *val = PQgetvalue(res, 0, 0);
+					const char *reject = NULL;
 
-					val = PQgetvalue(res, 0, 0);
-					if (strncmp(val, "on", 2) == 0)
+					if (check_read_only)
+					{
+						bool		read_only = (strncmp(val, "on", 2) == 0);
+
+						if (read_only &&
+							conn->target_server_type == SERVER_TYPE_READ_WRITE)
+							reject = libpq_gettext("could not make a writable "
+												   "connection to server "
+												   "\"%s:%s\"\n");
+						else if (!read_only &&
+								 conn->target_server_type == SERVER_TYPE_READ_ONLY)
+							reject = libpq_gettext("could not make a read-only "
+												   "connection to server "
+												   "\"%s:%s\"\n");
+					}
+					else
 					{
-						/* Not writable; fail this connection. */
+						bool		in_recovery = (val[0] == 't');
+
+						if (in_recovery &&
+							conn->target_server_type == SERVER_TYPE_PRIMARY)
+							reject = libpq_gettext("server \"%s:%s\" is in "
+												   "hot standby mode\n");
+						else if (!in_recovery &&
+								 conn->target_server_type != SERVER_TYPE_PRIMARY)
+							reject = libpq_gettext("server \"%s:%s\" is not "
+												   "in hot standby mode\n");
+					}
+
+					if (reject)
+					{
+						/* Wrong kind of server; fail this connection. */
 						PQclear(res);
 						restoreErrorMessage(conn, &savedMessage);
 
 						/* Append error report to conn->errorMessage. */
-						if (conn->connhost[conn->whichhost].type == CHT_HOST_ADDRESS)
-							displayed_host = conn->connhost[conn->whichhost].hostaddr;
-						else
-							displayed_host = conn->connhost[conn->whichhost].host;
-						displayed_port = conn->connhost[conn->whichhost].port;
-						if (displayed_port == NULL || displayed_port[0] == '\0')
-							displayed_port = DEF_PGPORT_STR;
-
-						appendPQExpBuffer(&conn->errorMessage,
-										  libpq_gettext("could not make a writable "
-														"connection to server "
-														"\"%s:%s\"\n"),
+						getDisplayedServer(conn, &displayed_host, &displayed_port);
+						appendPQExpBuffer(&conn->errorMessage, reject,
 										  displayed_host, displayed_port);
 
 						/* Close connection politely. */
@@ -3752,7 +4129,7 @@ keep_going:						/* We will come back to here until there is
 						goto keep_going;
 					}
 
-					/* Session is read-write, so we're good. */
+					/* Session is of the requested kind, so we're good. */
 					PQclear(res);
 					termPQExpBuffer(&savedMessage);
 
@@ -3765,25 +4142,19 @@ keep_going:						/* We will come back to here until there is
 				}
 
 				/*
-				 * Something went wrong with "SHOW transaction_read_only". We
-				 * should try next addresses.
+				 * Something went wrong with the query.  We should try next
+				 * addresses.
 				 */
 				if (res)
 					PQclear(res);
 				restoreErrorMessage(conn, &savedMessage);
 
 				/* Append error report to conn->errorMessage. */
-				if (conn->connhost[conn->whichhost].type == CHT_HOST_ADDRESS)
-					displayed_host = conn->connhost[conn->whichhost].hostaddr;
-				else
-					displayed_host = conn->connhost[conn->whichhost].host;
-				displayed_port = conn->connhost[conn->whichhost].port;
-				if (displayed_port == NULL || displayed_port[0] == '\0')
-					displayed_port = DEF_PGPORT_STR;
+				getDisplayedServer(conn, &displayed_host, &displayed_port);
 				appendPQExpBuffer(&conn->errorMessage,
-								  libpq_gettext("test \"SHOW transaction_read_only\" failed "
+								  libpq_gettext("test \"%s\" failed "
 												"on server \"%s:%s\"\n"),
-								  displayed_host, displayed_port);
+								  query, displayed_host, displayed_port);
 
 				/* Close connection politely. */
 				conn->status = CONNECTION_OK;
@@ -4092,6 +4463,7 @@ freePGconn(PGconn *conn)
 	/* Note that conn->Pfdebug is not ours to close or free */
 	if (conn->last_query)
 		free(conn->last_query);
+	pqFreeRecycledResults(conn);
 	if (conn->write_err_msg)
 		free(conn->write_err_msg);
 	if (conn->inBuffer)
@@ -4102,6 +4474,14 @@ freePGconn(PGconn *conn)
 		free(conn->rowBuf);
 	if (conn->target_session_attrs)
 		free(conn->target_session_attrs);
+	if (conn->load_balance_hosts)
+		free(conn->load_balance_hosts);
+	if (conn->host_weights)
+		free(conn->host_weights);
+	if (conn->compression)
+		free(conn->compression);
+	if (conn->compression_offer)
+		free(conn->compression_offer);
 	termPQExpBuffer(&conn->errorMessage);
 	termPQExpBuffer(&conn->workBuffer);
 
@@ -75,6 +75,7 @@ static int	check_field_number(const PGresult *res, int field_num);
 static PGcommandQueueEntry *PQmakePipelinedCommand(PGconn *conn);
 static void PQappendPipelinedCommand(PGconn *conn, PGcommandQueueEntry * entry);
 static void PQrecyclePipelinedCommand(PGconn *conn, PGcommandQueueEntry * entry);
+static void pqSaveQueryText(char **buf, size_t *bufsize, const char *query);
 static int pqBatchFlush(PGconn *conn);
 
 /* ----------------
@@ -135,6 +136,20 @@ static int pqBatchFlush(PGconn *conn);
 #define PGRESULT_BLOCK_OVERHEAD		Max(sizeof(PGresult_data), PGRESULT_ALIGN_BOUNDARY)
 #define PGRESULT_SEP_ALLOC_THRESHOLD	(PGRESULT_DATA_BLOCKSIZE / 2)
 
+/*
+ * Limits on the storage kept for reuse by PQrecycleResult: the number of
+ * PGresults kept per connection, and the largest tuple pointer array kept
+ * with each (the size of the array pqAddTuple starts with).
+ */
+#define PGRESULT_RECYCLE_MAX		16
+#define PGRESULT_RECYCLE_TUPARRSIZE	128
+
+/*
+ * Query text buffers of recycled command queue entries are reused for the
+ * next command queued in them, unless they are bigger than this.
+ */
+#define QUERY_TEXT_REUSE_LIMIT		8192
+
 
 /*
  * PQmakeEmptyPGresult
@@ -147,15 +162,29 @@ PQmakeEmptyPGresult(PGconn *conn, ExecStatusType status)
 {
 	PGresult   *result;
 
-	result = (PGresult *) malloc(sizeof(PGresult));
-	if (!result)
-		return NULL;
+	/*
+	 * Use a PGresult handed back by PQrecycleResult if there is one; it comes
+	 * with its tuple pointer array and a data block, if it had those.
+	 */
+	if (conn && conn->result_recycle)
+	{
+		result = conn->result_recycle;
+		conn->result_recycle = result->nextRecycled;
+		conn->nresult_recycle--;
+	}
+	else
+	{
+		result = (PGresult *) malloc(sizeof(PGresult));
+		if (!result)
+			return NULL;
+		result->tuples = NULL;
+		result->tupArrSize = 0;
+		result->curBlock = NULL;
+	}
 
 	result->ntups = 0;
 	result->numAttributes = 0;
 	result->attDescs = NULL;
-	result->tuples = NULL;
-	result->tupArrSize = 0;
 	result->numParameters = 0;
 	result->paramDescs = NULL;
 	result->resultStatus = status;
@@ -167,10 +196,21 @@ PQmakeEmptyPGresult(PGconn *conn, ExecStatusType status)
 	result->errFields = NULL;
 	result->errQuery = NULL;
 	result->null_field[0] = '\0';
-	result->curBlock = NULL;
-	result->curOffset = 0;
-	result->spaceLeft = 0;
-	result->memorySize = sizeof(PGresult);
+	result->memorySize = sizeof(PGresult) +
+		result->tupArrSize * sizeof(PGresAttValue *);
+	if (result->curBlock)
+	{
+		/* a recycled block is empty, except for the overhead pointer */
+		result->curOffset = sizeof(PGresult_data);
+		result->spaceLeft = PGRESULT_DATA_BLOCKSIZE - sizeof(PGresult_data);
+		result->memorySize += PGRESULT_DATA_BLOCKSIZE;
+	}
+	else
+	{
+		result->curOffset = 0;
+		result->spaceLeft = 0;
+	}
+	result->nextRecycled = NULL;
 
 	if (conn)
 	{
@@ -692,18 +732,15 @@ pqCatenateResultError(PGresult *res, const char *msg)
 }
 
 /*
- * PQclear -
- *	  free's the memory associated with a PGresult
+ * pqResultDestroyEvents -
+ *	  send RESULTDESTROY to the event procs of a PGresult, and free its
+ *	  copy of the events
  */
-void
-PQclear(PGresult *res)
+static void
+pqResultDestroyEvents(PGresult *res)
 {
-	PGresult_data *block;
 	int			i;
 
-	if (!res)
-		return;
-
 	for (i = 0; i < res->nEvents; i++)
 	{
 		/* only send DESTROY to successfully-initialized event procs */
@@ -720,6 +757,23 @@ PQclear(PGresult *res)
 
 	if (res->events)
 		free(res->events);
+	res->events = NULL;
+	res->nEvents = 0;
+}
+
+/*
+ * PQclear -
+ *	  free's the memory associated with a PGresult
+ */
+void
+PQclear(PGresult *res)
+{
+	PGresult_data *block;
+
+	if (!res)
+		return;
+
+	pqResultDestroyEvents(res);
 
 	/* Free all the subsidiary blocks */
 	while ((block = res->curBlock) != NULL)
@@ -737,14 +791,91 @@ PQclear(PGresult *res)
 	res->tuples = NULL;
 	res->paramDescs = NULL;
 	res->errFields = NULL;
-	res->events = NULL;
-	res->nEvents = 0;
 	/* res->curBlock was zeroed out earlier */
 
 	/* Free the PGresult structure itself */
 	free(res);
 }
 
+/*
+ * PQrecycleResult -
+ *	  like PQclear, but hand the storage of the PGresult back to conn, to be
+ *	  reused by the next PGresult made for it
+ *
+ * The PGresult struct is kept, along with its tuple pointer array and its
+ * most recent data block if those are of the standard size, so that a small
+ * result can be built again without calling malloc.  If conn is NULL or
+ * already holds enough recycled PGresults, this is just PQclear.
+ */
+void
+PQrecycleResult(PGconn *conn, PGresult *res)
+{
+	PGresult_data *keep = NULL;
+	PGresult_data *block;
+
+	if (!res)
+		return;
+	if (!conn || conn->nresult_recycle >= PGRESULT_RECYCLE_MAX)
+	{
+		PQclear(res);
+		return;
+	}
+
+	pqResultDestroyEvents(res);
+
+	/*
+	 * The current block is a standard-size one unless curOffset is zero,
+	 * which only happens when the first object of the PGresult was big
+	 * enough to get a block of its own.  Free all the other blocks.
+	 */
+	if (res->curBlock && res->curOffset > 0)
+	{
+		keep = res->curBlock;
+		res->curBlock = keep->next;
+	}
+	while ((block = res->curBlock) != NULL)
+	{
+		res->curBlock = block->next;
+		free(block);
+	}
+	if (keep)
+		keep->next = NULL;
+	res->curBlock = keep;
+
+	if (res->tuples && res->tupArrSize != PGRESULT_RECYCLE_TUPARRSIZE)
+	{
+		free(res->tuples);
+		res->tuples = NULL;
+		res->tupArrSize = 0;
+	}
+
+	/* zero out the pointer fields to catch programming errors */
+	res->attDescs = NULL;
+	res->paramDescs = NULL;
+	res->errFields = NULL;
+
+	res->nextRecycled = conn->result_recycle;
+	conn->result_recycle = res;
+	conn->nresult_recycle++;
+}
+
+/*
+ * pqFreeRecycledResults -
+ *	  free the PGresults kept by PQrecycleResult for a connection
+ */
+void
+pqFreeRecycledResults(PGconn *conn)
+{
+	PGresult   *res;
+
+	while ((res = conn->result_recycle) != NULL)
+	{
+		conn->result_recycle = res->nextRecycled;
+		PQclear(res);
+	}
+	conn->nresult_recycle = 0;
+}
+
 /*
  * Handy subroutine to deallocate any partially constructed async result.
  *
@@ -1132,6 +1263,9 @@ pqSaveParameterStatus(PGconn *conn, const char *name, const char *value)
  * stashing the previous result in conn->next_result so that it becomes
  * active again after pqPrepareAsyncResult().  This allows the result metadata
  * (column descriptions) to be carried forward to each result row.
+ *
+ * If a row callback has been set, the row is passed to it without being
+ * copied anywhere; the column values still point into the input buffer.
  */
 int
 pqRowProcessor(PGconn *conn, const char **errmsgp)
@@ -1142,6 +1276,14 @@ pqRowProcessor(PGconn *conn, const char **errmsgp)
 	PGresAttValue *tup;
 	int			i;
 
+	if (conn->rowCallback)
+	{
+		if (conn->rowCallback(res, columns, conn->rowCallbackArg) > 0)
+			return 1;
+		*errmsgp = libpq_gettext("row callback requested termination of query");
+		return 0;
+	}
+
 	/*
 	 * In single-row mode, make a new PGresult that will hold just this one
 	 * row; the original conn->result is left unchanged so that it can be used
@@ -1269,10 +1411,7 @@ PQsendQuery(PGconn *conn, const char *query)
 	conn->queryclass = PGQUERY_SIMPLE;
 
 	/* and remember the query text too, if possible */
-	/* if insufficient memory, last_query just winds up NULL */
-	if (conn->last_query)
-		free(conn->last_query);
-	conn->last_query = strdup(query);
+	pqSaveQueryText(&conn->last_query, &conn->last_query_size, query);
 
 	/*
 	 * Give the data a push.  In nonblock mode, don't complain if we're unable
@@ -1313,7 +1452,7 @@ PQsendQueryParams(PGconn *conn,
 						  libpq_gettext("command string is a null pointer\n"));
 		return 0;
 	}
-	if (nParams < 0 || nParams > 65535)
+	if (nParams < 0 || nParams > PQ_QUERY_PARAM_MAX_LIMIT)
 	{
 		printfPQExpBuffer(&conn->errorMessage,
 						  libpq_gettext("number of parameters must be between 0 and 65535\n"));
@@ -1345,6 +1484,7 @@ PQsendPrepare(PGconn *conn,
 {
 	PGcommandQueueEntry *pipeCmd = NULL;
 	char	  **last_query;
+	size_t	   *last_query_size;
 	PGQueryClass *queryclass;
 
 	if (!PQsendQueryStart(conn))
@@ -1363,7 +1503,7 @@ PQsendPrepare(PGconn *conn,
 						  libpq_gettext("command string is a null pointer\n"));
 		return 0;
 	}
-	if (nParams < 0 || nParams > 65535)
+	if (nParams < 0 || nParams > PQ_QUERY_PARAM_MAX_LIMIT)
 	{
 		printfPQExpBuffer(&conn->errorMessage,
 						  libpq_gettext("number of parameters must be between 0 and 65535\n"));
@@ -1412,6 +1552,7 @@ PQsendPrepare(PGconn *conn,
 			goto sendFailed;
 
 		last_query = &conn->last_query;
+		last_query_size = &conn->last_query_size;
 		queryclass = &conn->queryclass;
 	}
 	else
@@ -1422,6 +1563,7 @@ PQsendPrepare(PGconn *conn,
 			return 0;                       /* error msg already set */
 
 		last_query = &pipeCmd->query;
+		last_query_size = &pipeCmd->query_size;
 		queryclass = &pipeCmd->queryclass;
 	}
 
@@ -1429,10 +1571,7 @@ PQsendPrepare(PGconn *conn,
 	*queryclass = PGQUERY_PREPARE;
 
 	/* and remember the query text too, if possible */
-	/* if insufficient memory, last_query just winds up NULL */
-	if (*last_query)
-		free(*last_query);
-	*last_query = strdup(query);
+	pqSaveQueryText(last_query, last_query_size, query);
 
 	/*
 	 * Give the data a push.  In nonblock mode, don't complain if we're unable
@@ -1478,7 +1617,7 @@ PQsendQueryPrepared(PGconn *conn,
 						  libpq_gettext("statement name is a null pointer\n"));
 		return 0;
 	}
-	if (nParams < 0 || nParams > 65535)
+	if (nParams < 0 || nParams > PQ_QUERY_PARAM_MAX_LIMIT)
 	{
 		printfPQExpBuffer(&conn->errorMessage,
 						  libpq_gettext("number of parameters must be between 0 and 65535\n"));
@@ -1496,6 +1635,38 @@ PQsendQueryPrepared(PGconn *conn,
 						   resultFormat);
 }
 
+/*
+ * pqSaveQueryText
+ *	Remember the text of a query in *buf, reusing the buffer of *bufsize bytes
+ *	it points to if it's big enough and not oversized.  If query is NULL, or
+ *	if there's insufficient memory, *buf just winds up NULL.
+ */
+static void
+pqSaveQueryText(char **buf, size_t *bufsize, const char *query)
+{
+	size_t		len = 0;
+
+	if (query)
+	{
+		len = strlen(query) + 1;
+		if (*buf && len <= *bufsize && *bufsize <= QUERY_TEXT_REUSE_LIMIT)
+		{
+			memcpy(*buf, query, len);
+			return;
+		}
+	}
+
+	if (*buf)
+		free(*buf);
+	*buf = query ? malloc(len) : NULL;
+	*bufsize = 0;
+	if (*buf)
+	{
+		memcpy(*buf, query, len);
+		*bufsize = len;
+	}
+}
+
 /*
  * PQmakePipelinedCommand
  *	Get a new command queue entry, allocating it if required. Doesn't add it to
@@ -1519,14 +1690,16 @@ PQmakePipelinedCommand(PGconn *conn)
 							  libpq_gettext("out of memory\n"));
 			return NULL;
 		}
+		entry->query = NULL;
+		entry->query_size = 0;
 	}
 	else
 	{
+		/* keep its query buffer, for pqSaveQueryText to reuse */
 		entry = conn->cmd_queue_recycle;
 		conn->cmd_queue_recycle = entry->next;
 	}
 	entry->next = NULL;
-	entry->query = NULL;
 
 	return entry;
 }
@@ -1550,6 +1723,7 @@ PQappendPipelinedCommand(PGconn *conn, PGcommandQueueEntry * entry)
  * PQrecyclePipelinedCommand
  *	Push a command queue entry onto the freelist. It must be an entry
  *	with null next pointer and not referenced by any other entry's next pointer.
+ *	Its query buffer, if any, goes with it.
  */
 static void
 PQrecyclePipelinedCommand(PGconn *conn, PGcommandQueueEntry * entry)
@@ -1561,8 +1735,6 @@ PQrecyclePipelinedCommand(PGconn *conn, PGcommandQueueEntry * entry)
 		fprintf(stderr, libpq_gettext("tried to recycle non-dangling command queue entry"));
 		abort();
 	}
-	if (entry->query)
-		free(entry->query);
 
 	entry->next = conn->cmd_queue_recycle;
 	conn->cmd_queue_recycle = entry;
@@ -1638,8 +1810,10 @@ PQsendQueryStart(PGconn *conn)
 		 */
 		pqClearAsyncResult(conn);
 
-		/* reset single-row processing mode */
+		/* reset single-row processing mode and row callback */
 		conn->singleRowMode = false;
+		conn->rowCallback = NULL;
+		conn->rowCallbackArg = NULL;
 
 	}
 	/* ready to send command message */
@@ -1667,6 +1841,7 @@ PQsendQueryGuts(PGconn *conn,
 	int			i;
 	PGcommandQueueEntry *pipeCmd = NULL;
 	char	  **last_query;
+	size_t	   *last_query_size;
 	PGQueryClass *queryclass;
 
 
@@ -1686,11 +1861,13 @@ PQsendQueryGuts(PGconn *conn,
 			return 0;			/* error msg already set */
 
 		last_query = &pipeCmd->query;
+		last_query_size = &pipeCmd->query_size;
 		queryclass = &pipeCmd->queryclass;
 	}
 	else
 	{
 		last_query = &conn->last_query;
+		last_query_size = &conn->last_query_size;
 		queryclass = &conn->queryclass;
 	}
 
@@ -1819,13 +1996,7 @@ PQsendQueryGuts(PGconn *conn,
 	*queryclass = PGQUERY_EXTENDED;
 
 	/* and remember the query text too, if possible */
-	/* if insufficient memory, last_query just winds up NULL */
-	if (*last_query)
-		free(*last_query);
-	if (command)
-		*last_query = strdup(command);
-	else
-		*last_query = NULL;
+	pqSaveQueryText(last_query, last_query_size, command);
 
 	/*
 	 * Give the data a push.  In nonblock mode, don't complain if we're unable
@@ -1866,12 +2037,42 @@ PQsetSingleRowMode(PGconn *conn)
 		return 0;
 	if (conn->result)
 		return 0;
+	if (conn->rowCallback)
+		return 0;
 
 	/* OK, set flag */
 	conn->singleRowMode = true;
 	return 1;
 }
 
+/*
+ * Select row callback processing mode
+ *
+ * Each row of the current query's result is passed to the callback as it
+ * arrives, instead of being stored in a PGresult.  The same restrictions as
+ * for PQsetSingleRowMode apply; the two modes are mutually exclusive.
+ */
+int
+PQsetRowCallback(PGconn *conn, PQrowCallback callback, void *arg)
+{
+	if (!conn || !callback)
+		return 0;
+	if (conn->asyncStatus != PGASYNC_BUSY)
+		return 0;
+	if (conn->queryclass != PGQUERY_SIMPLE &&
+		conn->queryclass != PGQUERY_EXTENDED)
+		return 0;
+	if (conn->result)
+		return 0;
+	if (conn->singleRowMode)
+		return 0;
+
+	/* OK, remember the callback */
+	conn->rowCallback = callback;
+	conn->rowCallbackArg = arg;
+	return 1;
+}
+
 /*
  * Consume any available input from the backend
  * 0 return: some kind of trouble
@@ -2186,12 +2387,25 @@ PQbatchProcessQueue(PGconn *conn)
 	/* Initialize async result-accumulation state */
 	pqClearAsyncResult(conn);
 
-	/* reset single-row processing mode */
+	/* reset single-row processing mode and row callback */
 	conn->singleRowMode = false;
+	conn->rowCallback = NULL;
+	conn->rowCallbackArg = NULL;
+
 
+	/*
+	 * Swap query buffers with the entry, rather than copying the text, so
+	 * that both buffers are kept for reuse.
+	 */
+	{
+		char	   *query = conn->last_query;
+		size_t		query_size = conn->last_query_size;
 
-	conn->last_query = next_query->query;
-	next_query->query = NULL;
+		conn->last_query = next_query->query;
+		conn->last_query_size = next_query->query_size;
+		next_query->query = query;
+		next_query->query_size = query_size;
+	}
 	conn->queryclass = next_query->queryclass;
 
 	PQrecyclePipelinedCommand(conn, next_query);
@@ -2757,11 +2971,10 @@ PQsendDescribe(PGconn *conn, char desc_type, const char *desc_target)
 	*queryclass = PGQUERY_DESCRIBE;
 
 	/* reset last-query string (not relevant now) */
-	if (conn->last_query && conn->batch_status != PQBATCH_MODE_OFF)
-	{
-		free(conn->last_query);
-		conn->last_query = NULL;
-	}
+	if (pipeCmd)
+		pqSaveQueryText(&pipeCmd->query, &pipeCmd->query_size, NULL);
+	else
+		pqSaveQueryText(&conn->last_query, &conn->last_query_size, NULL);
 
 	/*
 	 * Give the data a push.  In nonblock mode, don't complain if we're unable
@@ -1105,6 +1105,10 @@ pqSocketCheck(PGconn *conn, int forRead, int forWrite, time_t end_time)
 	}
 #endif
 
+	/* Check for data the decompression has received already */
+	if (forRead && conn->decompressor && pqcompress_read_pending(conn))
+		return 1;
+
 	/* We will retry as long as we get EINTR */
 	do
 		result = pqSocketPoll(conn->sock, forRead, forWrite, end_time);
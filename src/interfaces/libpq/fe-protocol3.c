@@ -2212,6 +2212,10 @@ build_startup_packet(const PGconn *conn, char *packet,
 		}
 	}
 
+	/* Ask for protocol compression, if wanted */
+	if (conn->compression_offer)
+		ADD_STARTUP_OPTION("_pq_.compression", conn->compression_offer);
+
 	/* Add trailing terminator */
 	if (packet)
 		packet[packet_len] = '\0';
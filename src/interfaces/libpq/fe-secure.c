@@ -211,6 +211,18 @@ pqsecure_close(PGconn *conn)
  */
 ssize_t
 pqsecure_read(PGconn *conn, void *ptr, size_t len)
+{
+	if (conn->decompressor)
+		return pqcompress_read(conn, ptr, len);
+
+	return pqsecure_transport_read(conn, ptr, len);
+}
+
+/*
+ *	Read data from a secure connection, bypassing any protocol compression.
+ */
+ssize_t
+pqsecure_transport_read(PGconn *conn, void *ptr, size_t len)
 {
 	ssize_t		n;
 
@@ -294,6 +306,18 @@ pqsecure_raw_read(PGconn *conn, void *ptr, size_t len)
  */
 ssize_t
 pqsecure_write(PGconn *conn, const void *ptr, size_t len)
+{
+	if (conn->compressor)
+		return pqcompress_write(conn, ptr, len);
+
+	return pqsecure_transport_write(conn, ptr, len);
+}
+
+/*
+ *	Write data to a secure connection, bypassing any protocol compression.
+ */
+ssize_t
+pqsecure_transport_write(PGconn *conn, const void *ptr, size_t len)
 {
 	ssize_t		n;
 
@@ -40,6 +40,9 @@ extern "C"
 #define PG_COPYRES_EVENTS		  0x04
 #define PG_COPYRES_NOTICEHOOKS	  0x08
 
+/* Maximum number of parameters of a single query */
+#define PQ_QUERY_PARAM_MAX_LIMIT	65535
+
 /* Application-visible enum types */
 
 /*
@@ -67,8 +70,8 @@ typedef enum
 	CONNECTION_SETENV,			/* Negotiating environment. */
 	CONNECTION_SSL_STARTUP,		/* Negotiating SSL. */
 	CONNECTION_NEEDED,			/* Internal state: connect() needed */
-	CONNECTION_CHECK_WRITABLE,	/* Check if we could make a writable
-								 * connection. */
+	CONNECTION_CHECK_WRITABLE,	/* Check if the session is read-only, or
+								 * the server in hot standby. */
 	CONNECTION_CONSUME,			/* Wait for any pending message and consume
 								 * them. */
 	CONNECTION_GSS_STARTUP,		/* Negotiating GSSAPI. */
@@ -188,6 +191,21 @@ typedef struct pgNotify
 	struct pgNotify *next;		/* list link */
 } PGnotify;
 
+/* PGdataValue represents a data field value being passed to a row callback.
+ * It could be either text or binary data; text data is not zero-terminated.
+ * A SQL NULL is represented by len < 0; then value is still valid but there
+ * are no data bytes there.
+ */
+typedef struct pgDataValue
+{
+	int			len;			/* data length in bytes, or <0 if NULL */
+	const char *value;			/* data value, without zero-termination */
+} PGdataValue;
+
+/* Function type for row callbacks, see PQsetRowCallback() */
+typedef int (*PQrowCallback) (const PGresult *res, const PGdataValue *columns,
+							  void *arg);
+
 /* Function types for notice-handling callbacks */
 typedef void (*PQnoticeReceiver) (void *arg, const PGresult *res);
 typedef void (*PQnoticeProcessor) (void *arg, const char *message);
@@ -447,6 +465,7 @@ extern int	PQsendQueryPrepared(PGconn *conn,
 								const int *paramFormats,
 								int resultFormat);
 extern int	PQsetSingleRowMode(PGconn *conn);
+extern int	PQsetRowCallback(PGconn *conn, PQrowCallback callback, void *arg);
 extern PGresult *PQgetResult(PGconn *conn);
 
 /* Routines for managing an asynchronous query */
@@ -536,6 +555,7 @@ extern int	PQsendDescribePortal(PGconn *conn, const char *portal);
 
 /* Delete a PGresult */
 extern void PQclear(PGresult *res);
+extern void PQrecycleResult(PGconn *conn, PGresult *res);
 
 /* For freeing other alloc'd results, such as PGnotify structs */
 extern void PQfreemem(void *ptr);
@@ -39,6 +39,7 @@
 
 /* include stuff common to fe and be */
 #include "getaddrinfo.h"
+#include "common/stream_compression.h"
 #include "libpq/pqcomm.h"
 /* include stuff found in fe only */
 #include "pqexpbuffer.h"
@@ -210,6 +211,8 @@ struct pg_result
 	int			spaceLeft;		/* number of free bytes remaining in block */
 
 	size_t		memorySize;		/* total space allocated for this PGresult */
+
+	struct pg_result *nextRecycled; /* list link in conn->result_recycle */
 };
 
 /* PGAsyncStatusType defines the state of the query-execution state machine */
@@ -288,17 +291,6 @@ typedef struct pgLobjfuncs
 	Oid			fn_lo_write;	/* OID of backend function LOwrite		*/
 } PGlobjfuncs;
 
-/* PGdataValue represents a data field value being passed to a row processor.
- * It could be either text or binary data; text data is not zero-terminated.
- * A SQL NULL is represented by len < 0; then value is still valid but there
- * are no data bytes there.
- */
-typedef struct pgDataValue
-{
-	int			len;			/* data length in bytes, or <0 if NULL */
-	const char *value;			/* data value, without zero-termination */
-} PGdataValue;
-
 /* Host address type enum for struct pg_conn_host */
 typedef enum pg_conn_host_type
 {
@@ -313,16 +305,39 @@ typedef enum pg_conn_host_type
  * Note that entries in this list are reused by being zeroed and appended to
  * the tail when popped off the head. The entry with null next pointer is not
  * the end of the list of expected commands, that's the tail pointer in
- * pg_conn.
+ * pg_conn.  A recycled entry keeps its query buffer, to be overwritten by the
+ * text of the next command queued with it.
  */
 typedef struct pgCommandQueueEntry
 {
 	PGQueryClass queryclass;	/* Query type; PGQUERY_SYNC for sync msg */
 	char	   *query;			/* SQL command, or NULL if unknown */
+	size_t		query_size;		/* allocated size of query, if not NULL */
 	struct pgCommandQueueEntry *next;
 }	PGcommandQueueEntry;
 
 
+/* Target server type, parsed from target_session_attrs */
+typedef enum
+{
+	SERVER_TYPE_ANY = 0,		/* Any server (default) */
+	SERVER_TYPE_READ_WRITE,		/* Read-write session */
+	SERVER_TYPE_READ_ONLY,		/* Read-only session */
+	SERVER_TYPE_PRIMARY,		/* Server not in hot standby */
+	SERVER_TYPE_STANDBY,		/* Server in hot standby */
+	SERVER_TYPE_PREFER_STANDBY, /* Prefer a server in hot standby */
+	SERVER_TYPE_PREFER_STANDBY_PASS2	/* Second pass of prefer-standby:
+										 * any server will do */
+} PGTargetServerType;
+
+/* Order in which to try the hosts, parsed from load_balance_hosts */
+typedef enum
+{
+	LOAD_BALANCE_DISABLE = 0,	/* In the order listed (default) */
+	LOAD_BALANCE_RANDOM,		/* Random order, weighted */
+	LOAD_BALANCE_ROUND_ROBIN	/* Start at the next host each time */
+} PGLoadBalanceType;
+
 /*
  * pg_conn_host stores all information about each of possibly several hosts
  * mentioned in the connection string.  Most fields are derived by splitting
@@ -334,6 +349,7 @@ typedef struct pg_conn_host
 	char	   *host;			/* host name or socket path */
 	char	   *hostaddr;		/* host numeric IP address */
 	char	   *port;			/* port number (always provided) */
+	int			weight;			/* load balancing weight, at least 1 */
 	char	   *password;		/* password for this host, read from the
 								 * password file; NULL if not sought or not
 								 * found in password file. */
@@ -392,8 +408,16 @@ struct pg_conn
 	char	   *ssl_min_protocol_version;	/* minimum TLS protocol version */
 	char	   *ssl_max_protocol_version;	/* maximum TLS protocol version */
 
-	/* Type of connection to make.  Possible values: any, read-write. */
+	/*
+	 * Type of connection to make.  Possible values: any, read-write,
+	 * read-only, primary, standby, prefer-standby.
+	 */
 	char	   *target_session_attrs;
+	char	   *load_balance_hosts; /* disable, random or round-robin */
+	char	   *host_weights;	/* comma-separated load balancing weights */
+
+	char	   *compression;	/* compression methods to request, "on" or
+								 * "off" */
 
 	/* Optional file to write trace info to */
 	FILE	   *Pfdebug;
@@ -412,12 +436,15 @@ struct pg_conn
 	PGTransactionStatusType xactStatus; /* never changes to ACTIVE */
 	PGQueryClass queryclass;
 	char	   *last_query;		/* last SQL command, or NULL if unknown */
+	size_t		last_query_size;	/* allocated size of last_query */
 	char		last_sqlstate[6];	/* last reported SQLSTATE */
 	bool		options_valid;	/* true if OK to attempt connection */
 	bool		nonblocking;	/* whether this connection is using nonblock
 								 * sending semantics */
 	PQBatchStatus batch_status; /* Batch(pipelining) mode status of connection */
 	bool		singleRowMode;	/* return current query result row-by-row? */
+	PQrowCallback rowCallback;	/* hand rows of current query to callback? */
+	void	   *rowCallbackArg; /* argument to pass to rowCallback */
 	char		copy_is_binary; /* 1 = copy binary, 0 = copy text */
 	int			copy_already_done;	/* # bytes already returned in COPY OUT */
 	PGnotify   *notifyHead;		/* oldest unreported Notify msg */
@@ -427,6 +454,8 @@ struct pg_conn
 	int			nconnhost;		/* # of hosts named in conn string */
 	int			whichhost;		/* host we're currently trying/connected to */
 	pg_conn_host *connhost;		/* details about each named host */
+	PGTargetServerType target_server_type;	/* parsed target_session_attrs */
+	PGLoadBalanceType load_balance_type;	/* parsed load_balance_hosts */
 	char	   *connip;			/* IP address for current network connection */
 
 	/*
@@ -439,6 +468,10 @@ struct pg_conn
 	PGcommandQueueEntry *cmd_queue_tail;
 	PGcommandQueueEntry *cmd_queue_recycle;
 
+	/* PGresults handed back by PQrecycleResult, for PQmakeEmptyPGresult */
+	PGresult   *result_recycle;
+	int			nresult_recycle;	/* # of PGresults in that list */
+
 	/* Connection data */
 	pgsocket	sock;			/* FD for socket, PGINVALID_SOCKET if
 								 * unconnected */
@@ -547,6 +580,24 @@ struct pg_conn
 								 * results into our output buffer */
 #endif
 
+	/* Protocol compression state --- see fe-compress.c */
+	char	   *compression_offer;	/* methods to request, NULL for none */
+	StreamCompressor *compressor;	/* NULL unless compression is in use */
+	StreamCompressor *decompressor;
+	char	   *z_SendBuffer;	/* Compressed data waiting to be sent */
+	int			z_SendLength;	/* End of data available in z_SendBuffer */
+	int			z_SendNext;		/* Next index to send a byte from
+								 * z_SendBuffer */
+	int			z_SendConsumed; /* Number of *uncompressed* bytes consumed
+								 * for current contents of z_SendBuffer */
+	char	   *z_RecvBuffer;	/* Received, compressed data */
+	int			z_RecvSize;		/* Allocated size of z_RecvBuffer */
+	int			z_RecvLength;	/* End of data available in z_RecvBuffer */
+	char	   *z_ResultBuffer; /* Decompression of a chunk of z_RecvBuffer */
+	int			z_ResultLength; /* End of data available in z_ResultBuffer */
+	int			z_ResultNext;	/* Next index to read a byte from
+								 * z_ResultBuffer */
+
 #ifdef ENABLE_SSPI
 	CredHandle *sspicred;		/* SSPI credentials handle */
 	CtxtHandle *sspictx;		/* SSPI context */
@@ -637,6 +688,7 @@ extern void pqCatenateResultError(PGresult *res, const char *msg);
 extern void *pqResultAlloc(PGresult *res, size_t nBytes, bool isBinary);
 extern char *pqResultStrdup(PGresult *res, const char *str);
 extern void pqClearAsyncResult(PGconn *conn);
+extern void pqFreeRecycledResults(PGconn *conn);
 extern void pqSaveErrorResult(PGconn *conn);
 extern PGresult *pqPrepareAsyncResult(PGconn *conn);
 extern void pqInternalNotice(const PGNoticeHooks *hooks, const char *fmt,...) pg_attribute_printf(2, 3);
@@ -715,6 +767,8 @@ extern PostgresPollingStatusType pqsecure_open_client(PGconn *);
 extern void pqsecure_close(PGconn *);
 extern ssize_t pqsecure_read(PGconn *, void *ptr, size_t len);
 extern ssize_t pqsecure_write(PGconn *, const void *ptr, size_t len);
+extern ssize_t pqsecure_transport_read(PGconn *, void *ptr, size_t len);
+extern ssize_t pqsecure_transport_write(PGconn *, const void *ptr, size_t len);
 extern ssize_t pqsecure_raw_read(PGconn *, void *ptr, size_t len);
 extern ssize_t pqsecure_raw_write(PGconn *, const void *ptr, size_t len);
 
@@ -724,6 +778,15 @@ extern void pq_reset_sigpipe(sigset_t *osigset, bool sigpipe_pending,
 							 bool got_epipe);
 #endif
 
+/* === in fe-compress.c === */
+
+extern bool pqcompress_parse_option(PGconn *conn);
+extern bool pqcompress_start(PGconn *conn, const char *name);
+extern void pqcompress_close(PGconn *conn);
+extern bool pqcompress_read_pending(PGconn *conn);
+extern ssize_t pqcompress_read(PGconn *conn, void *ptr, size_t len);
+extern ssize_t pqcompress_write(PGconn *conn, const void *ptr, size_t len);
+
 /* === SSL === */
 
 /*
@@ -65,18 +65,20 @@
  * individual econtexts so that we can clean up correctly at subxact exit.
  *
  * This arrangement is a bit tedious to maintain, but it's worth the trouble
- * so that we don't have to re-prepare simple expressions on each trip through
- * a function.  (We assume the case to optimize is many repetitions of a
- * function within a transaction.)
+ * so that we don't have to set up a new EState on each trip through a
+ * function.  (We assume the case to optimize is many repetitions of a
+ * function within a transaction.)  The expression state trees themselves
+ * are not kept in the EState: each simple expression keeps its tree in a
+ * memory context of its own, belonging to the function, so that it can be
+ * re-used across transactions; see exec_eval_simple_expr.
  *
- * However, there's no value in trying to amortize simple expression setup
- * across multiple executions of a DO block (inline code block), since there
- * can never be any.  If we use the shared EState for a DO block, the expr
- * state trees are effectively leaked till end of transaction, and that can
- * add up if the user keeps on submitting DO blocks.  Therefore, each DO block
- * has its own simple-expression EState, which is cleaned up at exit from
- * plpgsql_inline_handler().  DO blocks still use the simple_econtext_stack,
- * though, so that subxact abort cleanup does the right thing.
+ * However, there's no value in sharing the EState with a DO block (inline
+ * code block), since any per-query memory it leaks would stay around till
+ * end of transaction, and that can add up if the user keeps on submitting
+ * DO blocks.  Therefore, each DO block has its own simple-expression EState,
+ * which is cleaned up at exit from plpgsql_inline_handler().  DO blocks still
+ * use the simple_econtext_stack, though, so that subxact abort cleanup does
+ * the right thing.
  *
  * (However, if a DO block executes COMMIT or ROLLBACK, then exec_stmt_commit
  * or exec_stmt_rollback will unlink it from the DO's simple-expression EState
@@ -6136,7 +6138,17 @@ loop_exit:
  * or add enough bookkeeping to be doubtful wins anyway.)  Another case that
  * is covered by the expr_simple_in_use test is where a previous execution
  * of the tree was aborted by an error: the tree may contain bogus state
- * so we dare not re-use it.
+ * so we dare not re-use it.  Once that transaction is over, we throw the
+ * tree away and build a new one.
+ *
+ * The execution tree is kept in a memory context of its own that lives as
+ * long as the function, so that it can be re-used in later transactions as
+ * long as the cached plan it was built from remains valid.  Building it
+ * afresh in each transaction was a noticeable part of the cost of
+ * functions that are called once per short transaction.  Nothing in the
+ * tree depends on the transaction or on the calling estate: PL/pgSQL
+ * parameters are fetched through the ParamListInfo of the ExprContext we
+ * evaluate it in, see plpgsql_param_compile.
  *
  * It is possible that we'd need to replan a simple expression; for example,
  * someone might redefine a SQL function that had been inlined into the simple
@@ -6169,11 +6181,17 @@ exec_eval_simple_expr(PLpgSQL_execstate *estate,
 		return false;
 
 	/*
-	 * If expression is in use in current xact, don't touch it.
+	 * If expression is in use in current xact, don't touch it.  If it was
+	 * left marked busy by an earlier xact, its evaluation failed; forget
+	 * the tree, since it may contain bogus state.
 	 */
-	if (unlikely(expr->expr_simple_in_use) &&
-		expr->expr_simple_lxid == curlxid)
-		return false;
+	if (unlikely(expr->expr_simple_in_use))
+	{
+		if (expr->expr_simple_lxid == curlxid)
+			return false;
+		expr->expr_simple_state = NULL;
+		expr->expr_simple_in_use = false;
+	}
 
 	/*
 	 * Check to see if the cached plan has been invalidated.  If not, and this
@@ -6284,18 +6302,25 @@ exec_eval_simple_expr(PLpgSQL_execstate *estate,
 	econtext->ecxt_param_list_info = paramLI;
 
 	/*
-	 * Prepare the expression for execution, if it's not been done already in
-	 * the current transaction.  (This will be forced to happen if we called
-	 * exec_save_simple_expr above.)
+	 * Prepare the expression for execution, if it's not been done already.
+	 * (This will be forced to happen if we called exec_save_simple_expr
+	 * above.)  Any previous execution tree is thrown away along with the
+	 * contents of its memory context.
 	 */
-	if (unlikely(expr->expr_simple_lxid != curlxid))
+	if (unlikely(expr->expr_simple_state == NULL))
 	{
-		oldcontext = MemoryContextSwitchTo(estate->simple_eval_estate->es_query_cxt);
+		if (expr->expr_simple_cxt == NULL)
+			expr->expr_simple_cxt =
+				AllocSetContextCreate(expr->func->fn_cxt,
+									  "PL/pgSQL simple expression",
+									  ALLOCSET_SMALL_SIZES);
+		else
+			MemoryContextReset(expr->expr_simple_cxt);
+
+		oldcontext = MemoryContextSwitchTo(expr->expr_simple_cxt);
 		expr->expr_simple_state =
 			ExecInitExprWithParams(expr->expr_simple_expr,
 								   econtext->ecxt_param_list_info);
-		expr->expr_simple_in_use = false;
-		expr->expr_simple_lxid = curlxid;
 		MemoryContextSwitchTo(oldcontext);
 	}
 
@@ -6323,6 +6348,7 @@ exec_eval_simple_expr(PLpgSQL_execstate *estate,
 	 * Mark expression as busy for the duration of the ExecEvalExpr call.
 	 */
 	expr->expr_simple_in_use = true;
+	expr->expr_simple_lxid = curlxid;
 
 	/*
 	 * Finally we can call the executor to evaluate the expression
@@ -8237,8 +8263,9 @@ exec_save_simple_expr(PLpgSQL_expr *expr, CachedPlan *cplan)
 	}
 
 	/*
-	 * Save the simple expression, and initialize state to "not valid in
-	 * current transaction".
+	 * Save the simple expression, and initialize state to "not prepared".
+	 * Any execution tree built from a previous version of the plan will be
+	 * discarded when the new one is built.
 	 */
 	expr->expr_simple_expr = tle_expr;
 	expr->expr_simple_state = NULL;
@@ -246,12 +246,16 @@ typedef struct PLpgSQL_expr
 	LocalTransactionId expr_simple_plan_lxid;
 
 	/*
-	 * if expr is simple AND prepared in current transaction,
-	 * expr_simple_state and expr_simple_in_use are valid. Test validity by
-	 * seeing if expr_simple_lxid matches current LXID.  (If not,
-	 * expr_simple_state probably points at garbage!)
+	 * if expr is simple AND prepared, expr_simple_state is the execution
+	 * tree for the current expr_simple_expr, allocated in expr_simple_cxt.
+	 * It survives across transactions, and is rebuilt whenever the plan
+	 * changes.  expr_simple_in_use is true while the tree is being evaluated;
+	 * expr_simple_lxid is the LXID of the last evaluation, which tells
+	 * whether a busy tree is in use by the current transaction or was
+	 * abandoned by an error in an earlier one.
 	 */
 	ExprState  *expr_simple_state;	/* eval tree for expr_simple_expr */
+	MemoryContext expr_simple_cxt;	/* context holding expr_simple_state */
 	bool		expr_simple_in_use; /* true if eval tree is active */
 	LocalTransactionId expr_simple_lxid;
 } PLpgSQL_expr;
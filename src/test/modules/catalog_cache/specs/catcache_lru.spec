@@ -0,0 +1,76 @@
+# Test that catalog cache and relcache entries evicted to stay within
+# max_catcache_memory and max_relcache_entries are reloaded correctly,
+# including after concurrent changes to the catalogs
+#
+# The bounds are so tight that s1 evicts nearly all unreferenced entries
+# as it goes, and "s1churn" looks up many more objects than fit.
+
+setup
+{
+    CREATE FUNCTION lru_f() RETURNS int LANGUAGE sql AS 'SELECT 1';
+    CREATE TABLE lru_t (a int);
+    INSERT INTO lru_t VALUES (1);
+    DO $$
+    BEGIN
+        FOR i IN 1 .. 20 LOOP
+            EXECUTE format('CREATE TABLE lru_t%s (a int)', i);
+        END LOOP;
+    END
+    $$;
+}
+
+teardown
+{
+    DROP FUNCTION lru_f();
+    DROP FUNCTION IF EXISTS lru_f(int);
+    DROP TABLE lru_t;
+    DO $$
+    BEGIN
+        FOR i IN 1 .. 20 LOOP
+            EXECUTE format('DROP TABLE lru_t%s', i);
+        END LOOP;
+    END
+    $$;
+}
+
+session "s1"
+setup
+{
+    SET max_catcache_memory = '1kB';
+    SET max_relcache_entries = 1;
+}
+step "s1f"       { SELECT lru_f(); }
+step "s1fint"    { SELECT lru_f(1); }
+step "s1a"       { SELECT a FROM lru_t; }
+step "s1b"       { SELECT b FROM lru_t; }
+step "s1churn"
+{
+    DO $$
+    DECLARE
+        n int;
+    BEGIN
+        FOR i IN 1 .. 20 LOOP
+            EXECUTE format('SELECT count(*) FROM lru_t%s', i) INTO n;
+        END LOOP;
+    END
+    $$;
+    SELECT count(pg_get_function_identity_arguments(oid)) > 0 AS churned
+    FROM pg_proc;
+}
+step "s1begin"   { BEGIN; }
+step "s1commit"  { COMMIT; }
+
+session "s2"
+step "s2replace" { CREATE OR REPLACE FUNCTION lru_f() RETURNS int LANGUAGE sql AS 'SELECT 2'; }
+step "s2overload" { CREATE FUNCTION lru_f(int) RETURNS int LANGUAGE sql AS 'SELECT $1 + 10'; }
+step "s2rename"  { ALTER TABLE lru_t RENAME a TO b; }
+
+# Evicted entries are reloaded, and reflect changes made meanwhile
+permutation "s1f" "s1churn" "s1f" "s2replace" "s1churn" "s1f"
+permutation "s1a" "s1churn" "s2rename" "s1a" "s1b" "s1churn" "s1b"
+
+# Evicted lists of overloaded functions are rebuilt as well
+permutation "s1f" "s1churn" "s2overload" "s1fint" "s1churn" "s1fint" "s1f"
+
+# Entries used by the current transaction are evicted only once unused
+permutation "s1begin" "s1a" "s1f" "s1churn" "s1a" "s1f" "s2replace" "s1f" "s1commit" "s1churn" "s1f"
@@ -0,0 +1,50 @@
+# Test that catalog cache entries shared between sessions don't outlive
+# concurrent changes to the catalogs
+#
+# s1 and s3 look up the same function and table.  s3 only does so at the
+# points noted, so its lookups are served from the shared cache if s1 has
+# already stored the entries there.  The objects are created afresh for each
+# permutation, so s3 has no local entries for them at first.
+
+setup
+{
+    CREATE FUNCTION scc_f() RETURNS int LANGUAGE sql AS 'SELECT 1';
+    CREATE TABLE scc_t (a int);
+    INSERT INTO scc_t VALUES (1);
+}
+
+teardown
+{
+    DROP FUNCTION IF EXISTS scc_f();
+    DROP TABLE scc_t;
+}
+
+session "s1"
+step "s1f"       { SELECT scc_f(); }
+step "s1a"       { SELECT a FROM scc_t; }
+step "s1b"       { SELECT b FROM scc_t; }
+
+session "s2"
+step "s2begin"   { BEGIN; }
+step "s2replace" { CREATE OR REPLACE FUNCTION scc_f() RETURNS int LANGUAGE sql AS 'SELECT 2'; }
+step "s2drop"    { DROP FUNCTION scc_f(); }
+step "s2rename"  { ALTER TABLE scc_t RENAME a TO b; }
+step "s2commit"  { COMMIT; }
+step "s2rollback" { ROLLBACK; }
+
+session "s3"
+step "s3f"       { SELECT scc_f(); }
+step "s3a"       { SELECT a FROM scc_t; }
+step "s3b"       { SELECT b FROM scc_t; }
+
+# A committed change replaces the shared entries
+permutation "s1f" "s2replace" "s3f" "s1f"
+permutation "s1f" "s3f" "s2drop" "s3f" "s1f"
+permutation "s1a" "s2rename" "s3a" "s3b" "s1b"
+
+# Entries read while a change is in progress are not used after it commits
+permutation "s1f" "s2begin" "s2replace" "s1f" "s3f" "s2commit" "s3f" "s1f"
+permutation "s1f" "s2begin" "s2replace" "s1f" "s3f" "s2rollback" "s3f" "s1f"
+
+# Table lookups wait for a concurrent ALTER TABLE, and then see its outcome
+permutation "s1a" "s2begin" "s2rename" "s3a" "s2commit" "s3b" "s1a" "s1b"
@@ -0,0 +1,68 @@
+# Test that a session which falls behind on the shared invalidation queue
+# sees the changes made meanwhile, whether the messages it missed were
+# summarized or it had to reset its caches
+#
+# catalog_cache.conf makes the queue hold only 1024 messages.  "s2bulk"
+# creates enough tables to overflow it many times over, after "s2change"
+# changed objects that s1 has cached.  s1 either sits idle meanwhile, or
+# waits on s3's advisory lock, so that it can't even process catchup
+# interrupts.
+
+setup
+{
+    CREATE FUNCTION sq_f() RETURNS int LANGUAGE sql AS 'SELECT 1';
+    CREATE TABLE sq_t (a int);
+    INSERT INTO sq_t VALUES (1);
+}
+
+teardown
+{
+    DROP FUNCTION sq_f();
+    DROP TABLE sq_t;
+    DO $$
+    BEGIN
+        FOR i IN 1 .. 100 LOOP
+            EXECUTE format('DROP TABLE IF EXISTS sq_m%s', i);
+        END LOOP;
+    END
+    $$;
+}
+
+session "s1"
+step "s1f"       { SELECT sq_f(); }
+step "s1a"       { SELECT a FROM sq_t; }
+step "s1b"       { SELECT b FROM sq_t; }
+step "s1m"       { SELECT count(*) FROM sq_m1, sq_m100; }
+step "s1wait"    { SELECT pg_advisory_lock(1); }
+step "s1unlock"  { SELECT pg_advisory_unlock(1); }
+
+session "s2"
+step "s2change"
+{
+    CREATE OR REPLACE FUNCTION sq_f() RETURNS int LANGUAGE sql AS 'SELECT 2';
+    ALTER TABLE sq_t RENAME a TO b;
+}
+step "s2catalog" { VACUUM FULL pg_proc; }
+step "s2bulk"
+{
+    DO $$
+    BEGIN
+        FOR i IN 1 .. 100 LOOP
+            EXECUTE format('CREATE TABLE sq_m%s (a int, b int, c text)', i);
+        END LOOP;
+    END
+    $$;
+}
+
+session "s3"
+step "s3lock"    { SELECT pg_advisory_lock(1); }
+step "s3unlock"  { SELECT pg_advisory_unlock(1); }
+
+# s1 stays idle while the queue overflows
+permutation "s1f" "s1a" "s2change" "s2bulk" "s1f" "s1a" "s1b" "s1m"
+
+# s1 is stuck in a query, so that the messages it missed are summarized
+permutation "s1f" "s1a" "s3lock" "s1wait" "s2change" "s2bulk" "s3unlock" "s1f" "s1a" "s1b" "s1m" "s1unlock"
+
+# A message that can't be summarized forces a reset of all caches instead
+permutation "s1f" "s1a" "s3lock" "s1wait" "s2change" "s2catalog" "s2bulk" "s3unlock" "s1f" "s1a" "s1b" "s1m" "s1unlock"
@@ -0,0 +1,42 @@
+# Test that sessions drawing values from the shared sequence cache see
+# changes that other sessions make to the sequence
+
+setup
+{
+    CREATE SEQUENCE seq1;
+}
+
+teardown
+{
+    DROP SEQUENCE seq1;
+}
+
+session "s1"
+step "s1nv"      { SELECT nextval('seq1'); }
+step "s1setval"  { SELECT setval('seq1', 100); }
+step "s1restart" { ALTER SEQUENCE seq1 RESTART WITH 500; }
+step "s1discard" { DISCARD SEQUENCES; }
+
+session "s2"
+step "s2nv"      { SELECT nextval('seq1'); }
+step "s2begin"   { BEGIN; }
+step "s2alter"   { ALTER SEQUENCE seq1 INCREMENT BY 10; }
+step "s2commit"  { COMMIT; }
+step "s2rollback" { ROLLBACK; }
+
+# Both sessions take their values from the same range
+permutation "s1nv" "s2nv" "s1nv" "s2nv"
+
+# setval() in one session is seen by the other one's next nextval()
+permutation "s1nv" "s2nv" "s1setval" "s2nv" "s1nv"
+
+# So is ALTER SEQUENCE
+permutation "s1nv" "s2nv" "s1restart" "s2nv" "s1nv"
+
+# DISCARD SEQUENCES doesn't give back the shared range
+permutation "s1nv" "s2nv" "s1discard" "s1nv" "s2nv"
+
+# nextval() waits for a concurrent ALTER SEQUENCE, and then sees its
+# outcome
+permutation "s1nv" "s2begin" "s2alter" "s1nv" "s2commit" "s2nv"
+permutation "s1nv" "s2begin" "s2alter" "s1nv" "s2rollback" "s2nv"
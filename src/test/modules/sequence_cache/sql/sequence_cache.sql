@@ -0,0 +1,88 @@
+--
+-- Test the shared sequence cache.  sequence_cache.conf enables it.
+--
+
+CREATE SEQUENCE seqc;
+SELECT nextval('seqc') FROM generate_series(1, 3);
+SELECT currval('seqc'), lastval();
+
+-- The sequence shows the end of the range reserved for the cache
+SELECT last_value, is_called FROM seqc;
+
+-- setval() drops the cached range, so the next value follows it
+SELECT setval('seqc', 100);
+SELECT nextval('seqc');
+SELECT setval('seqc', 200, false);
+SELECT nextval('seqc');
+
+-- So does ALTER SEQUENCE.  As with CACHE, the rest of the reserved range is
+-- lost.  A rolled back ALTER SEQUENCE leaves the old state.
+ALTER SEQUENCE seqc RESTART WITH 1000;
+SELECT nextval('seqc');
+ALTER SEQUENCE seqc INCREMENT BY 10;
+SELECT nextval('seqc'), nextval('seqc');
+BEGIN;
+ALTER SEQUENCE seqc RESTART WITH 5000;
+SELECT nextval('seqc');
+ROLLBACK;
+SELECT nextval('seqc');
+
+-- DISCARD SEQUENCES only forgets the session's own state
+DISCARD SEQUENCES;
+SELECT currval('seqc');
+SELECT nextval('seqc');
+
+-- Descending sequences
+CREATE SEQUENCE seqd INCREMENT BY -2 MAXVALUE 10 START WITH 10;
+SELECT nextval('seqd') FROM generate_series(1, 3);
+
+-- Sequences with a CACHE setting take that many values at a time
+CREATE SEQUENCE seqf CACHE 10;
+SELECT nextval('seqf') FROM generate_series(1, 12);
+SELECT last_value FROM seqf;
+
+-- Near the end of a sequence, nextval() takes the regular path, which
+-- raises the usual errors and handles CYCLE
+CREATE SEQUENCE seqe MAXVALUE 5;
+SELECT nextval('seqe') FROM generate_series(1, 5);
+SELECT nextval('seqe');
+ALTER SEQUENCE seqe CYCLE;
+SELECT nextval('seqe');
+
+-- TRUNCATE ... RESTART IDENTITY restarts a cached identity sequence
+CREATE TABLE seqt (a int GENERATED ALWAYS AS IDENTITY, b int);
+INSERT INTO seqt (b) VALUES (1), (2);
+TRUNCATE seqt RESTART IDENTITY;
+INSERT INTO seqt (b) VALUES (3), (4);
+SELECT * FROM seqt;
+
+-- A dropped and recreated sequence starts afresh
+DROP SEQUENCE seqc;
+CREATE SEQUENCE seqc;
+SELECT nextval('seqc');
+
+-- Sequences that don't fit in the cache work as usual
+DO $$
+BEGIN
+	FOR i IN 1 .. 50 LOOP
+		EXECUTE format('CREATE SEQUENCE seqm%s', i);
+	END LOOP;
+END
+$$;
+SELECT count(*) FROM generate_series(1, 50) i,
+  LATERAL (SELECT array_agg(v) AS vals
+		   FROM (SELECT nextval(format('seqm%s', i)::regclass) AS v
+				 FROM generate_series(1, 3)) s) a
+WHERE vals = '{1,2,3}';
+SELECT count(*) FROM generate_series(1, 50) i
+WHERE nextval(format('seqm%s', i)::regclass) = 4;
+
+DROP TABLE seqt;
+DROP SEQUENCE seqc, seqd, seqe, seqf;
+DO $$
+BEGIN
+	FOR i IN 1 .. 50 LOOP
+		EXECUTE format('DROP SEQUENCE seqm%s', i);
+	END LOOP;
+END
+$$;
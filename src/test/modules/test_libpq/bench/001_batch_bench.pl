@@ -0,0 +1,213 @@
+# Compare synchronous, asynchronous and batch execution through a proxy
+# that adds artificial network latency.
+#
+# Not run by "make check"; use "make bench".  The following environment
+# variables control the runs:
+#
+#   PG_BENCH_LATENCY_MS  one-way delay added by the proxy (default 5, 0 to
+#                        connect to the server directly)
+#   PG_BENCH_QUERIES     queries per run (default 200)
+#   PG_BENCH_DEPTHS      batch queue depths (default 1,10,100,1000)
+#   PG_BENCH_SIZES       payload sizes in bytes (default 16,1024,8192)
+use strict;
+use warnings;
+
+use Config;
+use IO::Select;
+use IO::Socket::INET;
+use IO::Socket::UNIX;
+use IPC::Run;
+use POSIX ();
+use PostgresNode;
+use TestLib;
+use Test::More;
+use Time::HiRes ();
+use Cwd;
+
+my $latency_ms = $ENV{PG_BENCH_LATENCY_MS} // 5;
+my $nqueries   = $ENV{PG_BENCH_QUERIES}    // 200;
+my $depths     = $ENV{PG_BENCH_DEPTHS}     // '1,10,100,1000';
+my $sizes      = $ENV{PG_BENCH_SIZES}      // '16,1024,8192';
+
+my @sizes = split /,/, $sizes;
+plan tests => 1 + ($latency_ms > 0 ? scalar(@sizes) : 0);
+
+# Write all of $data to $fh, returning false if the peer went away.
+sub write_all
+{
+	my ($fh, $data) = @_;
+
+	while (length($data) > 0)
+	{
+		my $n = syswrite($fh, $data);
+		return 0 unless $n;
+		substr($data, 0, $n, '');
+	}
+	return 1;
+}
+
+sub connect_to_node
+{
+	my ($node) = @_;
+	my $server;
+
+	if ($PostgresNode::use_tcp)
+	{
+		$server = IO::Socket::INET->new(
+			PeerAddr => $node->host,
+			PeerPort => $node->port,
+			Proto    => 'tcp');
+	}
+	else
+	{
+		$server = IO::Socket::UNIX->new(
+			Peer => $node->host . '/.s.PGSQL.' . $node->port);
+	}
+	die "could not connect to server: $!" unless $server;
+	return $server;
+}
+
+# Relay data between the two sockets, holding back everything read from
+# either side for $delay seconds before passing it on, much like a netem
+# qdisc would.  Returns when either side closes the connection.
+sub relay
+{
+	my ($client, $server, $delay) = @_;
+	my %peer  = ($client => $server, $server => $client);
+	my %queue = ($client => [], $server => []);
+	my $select = IO::Select->new($client, $server);
+
+	while (1)
+	{
+		my $now = Time::HiRes::time();
+		my $timeout;
+
+		foreach my $src ($client, $server)
+		{
+			my $q = $queue{$src};
+
+			while (@$q && $q->[0][0] <= $now)
+			{
+				my $chunk = shift @$q;
+				return unless write_all($peer{$src}, $chunk->[1]);
+			}
+			if (@$q)
+			{
+				my $wait = $q->[0][0] - $now;
+				$timeout = $wait if !defined $timeout || $wait < $timeout;
+			}
+		}
+
+		foreach my $fh ($select->can_read($timeout))
+		{
+			my $buf;
+			my $n = sysread($fh, $buf, 65536);
+
+			if (!$n)
+			{
+				# pass on whatever is still in flight, then give up
+				foreach my $src ($client, $server)
+				{
+					write_all($peer{$src}, $_->[1]) foreach @{ $queue{$src} };
+				}
+				return;
+			}
+			push @{ $queue{$fh} }, [ Time::HiRes::time() + $delay, $buf ];
+		}
+	}
+}
+
+# Start a proxy process listening on $port, returning its PID.  Each
+# accepted connection is relayed to $node by a child of its own.  The
+# children leave with POSIX::_exit so that they don't run the END blocks
+# that shut down the test's server.
+sub start_latency_proxy
+{
+	my ($node, $port, $delay_ms) = @_;
+
+	my $listener = IO::Socket::INET->new(
+		LocalAddr => '127.0.0.1',
+		LocalPort => $port,
+		Proto     => 'tcp',
+		Listen    => 5,
+		ReuseAddr => 1) or die "could not listen on port $port: $!";
+
+	my $pid = fork();
+	die "fork failed: $!" unless defined $pid;
+	if ($pid > 0)
+	{
+		close($listener);
+		return $pid;
+	}
+
+	$SIG{PIPE} = 'IGNORE';
+	while (my $client = $listener->accept)
+	{
+		my $child = fork();
+		POSIX::_exit(1) unless defined $child;
+		if ($child == 0)
+		{
+			close($listener);
+			relay($client, connect_to_node($node), $delay_ms / 1000.0);
+			POSIX::_exit(0);
+		}
+		close($client);
+	}
+	POSIX::_exit(0);
+}
+
+my $node = get_new_node('main');
+$node->init;
+$node->start;
+
+my $connstr = $node->connstr('postgres');
+my $proxy_pid;
+if ($latency_ms > 0)
+{
+	my $proxy_port = get_free_port();
+	$proxy_pid = start_latency_proxy($node, $proxy_port, $latency_ms);
+	$connstr = "host=127.0.0.1 port=$proxy_port dbname=postgres";
+}
+
+$ENV{PATH} = "$ENV{PATH}:" . getcwd();
+my ($stdout, $stderr);
+my $result = IPC::Run::run [
+	'testlibpqbench', '-d', $connstr, '-n', $nqueries,
+	'-q', $depths, '-s', $sizes
+  ],
+  '>', \$stdout, '2>', \$stderr;
+ok($result, "testlibpqbench with ${latency_ms}ms latency");
+diag($stderr) if $stderr;
+
+# Report the results, and remember the elapsed times for the checks below.
+my %elapsed;
+foreach my $line (split /\n/, $stdout)
+{
+	my %run = map { split /=/, $_, 2 } split / /, $line;
+	next unless defined $run{mode};
+	note($line);
+	$elapsed{ $run{mode} }{ $run{size} }{ $run{depth} } = $run{elapsed_ms};
+}
+
+# With a latency in place, the deepest batch must beat one round trip per
+# query by a wide margin; anything else points at a broken batch path.
+if ($latency_ms > 0)
+{
+	my @depths = sort { $a <=> $b } split /,/, $depths;
+	my $depth = $depths[-1];
+
+	foreach my $size (@sizes)
+	{
+		my $sync  = $elapsed{sync}{$size}{1};
+		my $batch = $elapsed{batch}{$size}{$depth};
+		ok( defined $sync && defined $batch && $batch < $sync / 2,
+			"batch depth $depth faster than sync for size $size");
+	}
+}
+
+if ($proxy_pid)
+{
+	kill 'TERM', $proxy_pid;
+	waitpid($proxy_pid, 0);
+}
+$node->stop('fast');
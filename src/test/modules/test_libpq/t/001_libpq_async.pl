@@ -4,7 +4,7 @@ use warnings;
 use Config;
 use PostgresNode;
 use TestLib;
-use Test::More tests => 6;
+use Test::More tests => 9;
 use Cwd;
 
 my $node = get_new_node('main');
@@ -15,7 +15,7 @@ my $port = $node->port;
 
 my $numrows = 10000;
 my @tests =
-  qw(disallowed_in_batch simple_batch multi_batch batch_abort timings singlerowmode);
+  qw(disallowed_in_batch simple_batch multi_batch batch_abort timings singlerowmode rowcallback recycle deferred_flush);
 $ENV{PATH} = "$ENV{PATH}:" . getcwd();
 for my $testname (@tests)
 {
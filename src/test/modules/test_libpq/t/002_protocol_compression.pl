@@ -0,0 +1,105 @@
+# Test compression of the frontend/backend protocol
+use strict;
+use warnings;
+
+use PostgresNode;
+use TestLib;
+use Test::More;
+
+my @methods;
+push @methods, 'zstd' if check_pg_config("#define USE_ZSTD 1");
+push @methods, 'lz4'  if check_pg_config("#define USE_LZ4 1");
+push @methods, 'gzip' if check_pg_config("#define HAVE_LIBZ 1");
+
+if (@methods)
+{
+	plan tests => 7 + 2 * @methods;
+}
+else
+{
+	plan skip_all => 'no compression method supported by this build';
+}
+
+my $node = get_new_node('main');
+$node->init;
+$node->append_conf('postgresql.conf', 'log_connections = on');
+$node->start;
+
+my $tempdir = TestLib::tempdir;
+
+# Big enough to span many compressed chunks in both directions
+$node->safe_psql(
+	'postgres', q{
+create table src (a int, b text);
+insert into src select g, repeat(md5(g::text), g % 50) from generate_series(1, 50000) g;
+create table dst (like src);
+});
+
+my $query = q{select count(*), sum(a), md5(string_agg(b, ',' order by a))};
+my $expected = $node->safe_psql('postgres', "$query from src");
+my $bigquery = q{select repeat(md5(g::text), 1000) from generate_series(1, 200) g};
+my $expected_big = $node->safe_psql('postgres', $bigquery);
+
+# Run a query in a session asking for the given compression, and return its
+# output and the compression method the server logged for it, if any
+sub query_compressed
+{
+	my ($compression, $sql) = @_;
+	local $ENV{PGCOMPRESSION} = $compression;
+
+	my $logstart = -s $node->logfile;
+	my $result = $node->safe_psql('postgres', $sql);
+	my $log = substr(slurp_file($node->logfile), $logstart);
+	my ($method) = $log =~ /connection compressed: method=(\w+)/;
+	return ($result, $method);
+}
+
+# Off by default
+my ($result, $method) = query_compressed('on', $bigquery);
+is($result, $expected_big, 'query works with compression refused');
+is($method, undef, 'server does not compress by default');
+
+$node->append_conf('postgresql.conf', 'protocol_compression = on');
+$node->reload;
+
+($result, $method) = query_compressed('off', $bigquery);
+is($method, undef, 'no compression unless the client asks for it');
+
+# "on" picks the first method both sides support
+($result, $method) = query_compressed('on', $bigquery);
+is($method, $methods[0], 'compression "on" chooses the preferred method');
+
+foreach my $m (@methods)
+{
+	($result, $method) = query_compressed($m, $bigquery);
+	is($method, $m, "$m negotiated");
+	is($result, $expected_big, "large result intact with $m");
+}
+
+# The client's order of preference wins
+($result, $method) = query_compressed(join(',', reverse @methods), 'select 1');
+is($method, $methods[-1], 'client order of preference is followed');
+
+# Round trip a table through COPY TO STDOUT and COPY FROM STDIN
+{
+	local $ENV{PGCOMPRESSION} = 'on';
+	my $file = "$tempdir/src.copy";
+
+	$node->safe_psql('postgres', "\\copy src to '$file'");
+	$node->safe_psql('postgres', "\\copy dst from '$file'");
+}
+is($node->safe_psql('postgres', "$query from dst"),
+	$expected, 'table intact after a compressed COPY round trip');
+
+# An unknown method is refused by libpq before connecting
+{
+	local $ENV{PGCOMPRESSION} = 'nosuchmethod';
+	my ($stdout, $stderr);
+	$node->psql(
+		'postgres', 'select 1',
+		stdout => \$stdout,
+		stderr => \$stderr);
+	like($stderr, qr/invalid compression value/, 'unknown method refused');
+}
+
+$node->stop;
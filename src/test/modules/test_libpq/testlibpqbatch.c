@@ -32,6 +32,9 @@ static void batch_insert_sequential(PGconn *conn, int n_rows);
 static void batch_insert_copy(PGconn *conn, int n_rows);
 static void test_batch_abort(PGconn *conn);
 static void test_singlerowmode(PGconn *conn);
+static void test_rowcallback(PGconn *conn);
+static void test_recycle(PGconn *conn);
+static void test_deferred_flush(PGconn *conn);
 static const Oid INT4OID = 23;
 
 static const char *const drop_table_sql
@@ -828,7 +831,7 @@ static void
 usage_exit(const char *progname)
 {
 	fprintf(stderr, "Usage: %s ['connstring' [number_of_rows [test_to_run]]]\n", progname);
-	fprintf(stderr, "  tests: all|disallowed_in_batch|simple_batch|multi_batch|batch_abort|timings|singlerowmode\n");
+	fprintf(stderr, "  tests: all|disallowed_in_batch|simple_batch|multi_batch|batch_abort|timings|singlerowmode|rowcallback|recycle|deferred_flush\n");
 	exit(1);
 }
 
@@ -902,6 +905,367 @@ fail:
 	exit_nicely(conn);
 
 }
+
+/* Row callback state for test_rowcallback */
+typedef struct
+{
+	int			nrows;
+	long		sum;
+	int			stop_after;
+} RowCallbackState;
+
+static int
+sum_rows_callback(const PGresult *res, const PGdataValue *columns, void *arg)
+{
+	RowCallbackState *state = (RowCallbackState *) arg;
+	char		buf[MAXINTLEN];
+
+	if (PQnfields(res) != 1 || columns[0].len < 0 ||
+		columns[0].len >= MAXINTLEN)
+		return 0;
+
+	/* values are not zero-terminated */
+	memcpy(buf, columns[0].value, columns[0].len);
+	buf[columns[0].len] = '\0';
+	state->sum += atol(buf);
+	state->nrows++;
+
+	if (state->stop_after > 0 && state->nrows >= state->stop_after)
+		return 0;
+	return 1;
+}
+
+static void
+test_rowcallback(PGconn *conn)
+{
+	PGresult   *res = NULL;
+	RowCallbackState state[2];
+	int			i;
+
+	fprintf(stderr, "row callback... ");
+
+	memset(state, 0, sizeof(state));
+
+	/* two queries in one batch, each streamed through the callback */
+	EXPECT(PQenterBatchMode(conn), "failed to enter batch mode: %s\n",
+		   PQerrorMessage(conn));
+	for (i = 0; i < 2; i++)
+	{
+		EXPECT(PQsendQueryParams(conn, "SELECT generate_series(1, 1000)",
+								 0, NULL, NULL, NULL, NULL, 0),
+			   "dispatching SELECT failed: %s\n", PQerrorMessage(conn));
+	}
+	EXPECT(PQbatchSendQueue(conn), "Ending a batch failed: %s\n",
+		   PQerrorMessage(conn));
+
+	for (i = 0; i < 2; i++)
+	{
+		EXPECT(PQbatchProcessQueue(conn),
+			   "PQbatchProcessQueue() failed for query %d\n", i);
+		EXPECT(PQsetRowCallback(conn, sum_rows_callback, &state[i]),
+			   "PQsetRowCallback() failed for query %d\n", i);
+		EXPECT(!PQsetSingleRowMode(conn),
+			   "PQsetSingleRowMode() succeeded with a row callback set\n");
+
+		res = PQgetResult(conn);
+		EXPECT(res != NULL, "got NULL result for query %d\n", i);
+		EXPECT(PQresultStatus(res) == PGRES_TUPLES_OK,
+			   "Unexpected result code %s for query %d: %s\n",
+			   PQresStatus(PQresultStatus(res)), i, PQerrorMessage(conn));
+		EXPECT(PQntuples(res) == 0,
+			   "Expected no stored tuples, got %d\n", PQntuples(res));
+		EXPECT(state[i].nrows == 1000 && state[i].sum == 500500,
+			   "callback saw %d rows with sum %ld for query %d\n",
+			   state[i].nrows, state[i].sum, i);
+		PQclear(res);
+		res = NULL;
+
+		EXPECT(PQgetResult(conn) == NULL,
+			   "expected NULL result after query %d\n", i);
+	}
+
+	EXPECT(PQbatchProcessQueue(conn), "PQbatchProcessQueue() for sync failed\n");
+	res = PQgetResult(conn);
+	EXPECT(res != NULL && PQresultStatus(res) == PGRES_BATCH_END,
+		   "Expected PGRES_BATCH_END\n");
+	PQclear(res);
+	res = NULL;
+	EXPECT(PQexitBatchMode(conn), "exiting batch mode failed: %s\n",
+		   PQerrorMessage(conn));
+
+	/* a callback returning 0 terminates the query with an error */
+	memset(state, 0, sizeof(state));
+	state[0].stop_after = 10;
+	EXPECT(PQsendQuery(conn, "SELECT generate_series(1, 1000)"),
+		   "dispatching SELECT failed: %s\n", PQerrorMessage(conn));
+	EXPECT(PQsetRowCallback(conn, sum_rows_callback, &state[0]),
+		   "PQsetRowCallback() failed\n");
+	res = PQgetResult(conn);
+	EXPECT(res != NULL && PQresultStatus(res) == PGRES_FATAL_ERROR,
+		   "Expected PGRES_FATAL_ERROR from aborting callback\n");
+	EXPECT(state[0].nrows == 10, "callback called %d times, expected 10\n",
+		   state[0].nrows);
+	PQclear(res);
+	res = NULL;
+	while ((res = PQgetResult(conn)) != NULL)
+		PQclear(res);
+
+	fprintf(stderr, "ok\n");
+	return;
+
+fail:
+	PQclear(res);
+	exit_nicely(conn);
+}
+
+/*
+ * Run batches whose results are handed back with PQrecycleResult, checking
+ * that results built in recycled storage, and the query text kept in
+ * recycled command queue entries, are not mixed up with earlier ones.
+ */
+static void
+test_recycle(PGconn *conn)
+{
+	static const char *const queries[] = {
+		"SELECT 'first query of a batch, with a rather long text'::text",
+		"SELECT generate_series(1, 200)",
+		"SELECT 'short'::text"
+	};
+	PGresult   *res = NULL;
+	int			round;
+	int			i;
+
+	fprintf(stderr, "recycle... ");
+
+	EXPECT(PQenterBatchMode(conn), "failed to enter batch mode: %s\n",
+		   PQerrorMessage(conn));
+
+	for (round = 0; round < 3; round++)
+	{
+		for (i = 0; i < lengthof(queries); i++)
+		{
+			/* send the queries in a different order each round */
+			const char *query = queries[(i + round) % lengthof(queries)];
+
+			EXPECT(PQsendQueryParams(conn, query, 0, NULL, NULL, NULL, NULL, 0),
+				   "dispatching query failed: %s\n", PQerrorMessage(conn));
+		}
+		EXPECT(PQbatchSendQueue(conn), "Ending a batch failed: %s\n",
+			   PQerrorMessage(conn));
+
+		for (i = 0; i < lengthof(queries); i++)
+		{
+			int			q = (i + round) % lengthof(queries);
+
+			EXPECT(PQbatchProcessQueue(conn),
+				   "PQbatchProcessQueue() failed for query %d\n", i);
+			res = PQgetResult(conn);
+			EXPECT(res != NULL && PQresultStatus(res) == PGRES_TUPLES_OK,
+				   "Unexpected result for query %d: %s\n", i,
+				   PQerrorMessage(conn));
+			if (q == 1)
+			{
+				EXPECT(PQntuples(res) == 200 &&
+					   strcmp(PQgetvalue(res, 199, 0), "200") == 0,
+					   "wrong result from generate_series: %d rows\n",
+					   PQntuples(res));
+			}
+			else
+			{
+				EXPECT(PQntuples(res) == 1 &&
+					   strcmp(PQgetvalue(res, 0, 0),
+							  q == 0 ? "first query of a batch, with a rather long text" : "short") == 0,
+					   "wrong result \"%s\" for query %d\n",
+					   PQgetvalue(res, 0, 0), i);
+			}
+			PQrecycleResult(conn, res);
+			res = NULL;
+			EXPECT(PQgetResult(conn) == NULL,
+				   "expected NULL result after query %d\n", i);
+		}
+
+		EXPECT(PQbatchProcessQueue(conn), "PQbatchProcessQueue() for sync failed\n");
+		res = PQgetResult(conn);
+		EXPECT(res != NULL && PQresultStatus(res) == PGRES_BATCH_END,
+			   "Expected PGRES_BATCH_END\n");
+		PQrecycleResult(conn, res);
+		res = NULL;
+	}
+
+	/*
+	 * The error for a failing query quotes the query text, which must come
+	 * from its own entry, not from a longer one queued through it earlier.
+	 */
+	EXPECT(PQsendQueryParams(conn, "SELECT no_such_column", 0, NULL, NULL,
+							 NULL, NULL, 0),
+		   "dispatching query failed: %s\n", PQerrorMessage(conn));
+	EXPECT(PQbatchSendQueue(conn), "Ending a batch failed: %s\n",
+		   PQerrorMessage(conn));
+	EXPECT(PQbatchProcessQueue(conn), "PQbatchProcessQueue() failed\n");
+	res = PQgetResult(conn);
+	EXPECT(res != NULL && PQresultStatus(res) == PGRES_FATAL_ERROR,
+		   "Expected PGRES_FATAL_ERROR\n");
+	EXPECT(strstr(PQresultErrorMessage(res),
+				  "LINE 1: SELECT no_such_column\n") != NULL,
+		   "unexpected error message: %s", PQresultErrorMessage(res));
+	PQrecycleResult(conn, res);
+	res = NULL;
+	EXPECT(PQgetResult(conn) == NULL, "expected NULL result after error\n");
+	EXPECT(PQbatchProcessQueue(conn), "PQbatchProcessQueue() for sync failed\n");
+	res = PQgetResult(conn);
+	EXPECT(res != NULL && PQresultStatus(res) == PGRES_BATCH_END,
+		   "Expected PGRES_BATCH_END\n");
+	PQclear(res);
+	res = NULL;
+
+	EXPECT(PQexitBatchMode(conn), "exiting batch mode failed: %s\n",
+		   PQerrorMessage(conn));
+
+	fprintf(stderr, "ok\n");
+	return;
+
+fail:
+	PQclear(res);
+	exit_nicely(conn);
+}
+
+/*
+ * Run batches with defer_sync_flush on.  The server then holds back the
+ * replies to a Sync while more messages are waiting in its input buffer, but
+ * it must still send them all once it runs out of input, including when the
+ * messages after a Sync are a query whose own Sync the client hasn't sent.
+ */
+static void
+test_deferred_flush(PGconn *conn)
+{
+	PGresult   *res = NULL;
+	char		param[16];
+	const char *params[1] = {param};
+	Oid			param_oids[1] = {INT4OID};
+	int			nbatches = 10;
+	int			i;
+	int			sock;
+	fd_set		input_mask;
+	struct timeval timeout;
+
+	fprintf(stderr, "deferred flush... ");
+
+	res = PQexec(conn, "SET defer_sync_flush = on");
+	EXPECT(PQresultStatus(res) == PGRES_COMMAND_OK,
+		   "failed to set defer_sync_flush: %s\n", PQerrorMessage(conn));
+	PQclear(res);
+	res = NULL;
+
+	EXPECT(PQenterBatchMode(conn), "failed to enter batch mode: %s\n",
+		   PQerrorMessage(conn));
+
+	/* Queue several batches back to back, and only then read the results */
+	for (i = 0; i < nbatches; i++)
+	{
+		snprintf(param, sizeof(param), "%d", i);
+		EXPECT(PQsendQueryParams(conn, "SELECT $1", 1, param_oids, params,
+								 NULL, NULL, 0),
+			   "dispatching query %d failed: %s\n", i, PQerrorMessage(conn));
+		EXPECT(PQbatchSendQueue(conn), "Ending batch %d failed: %s\n", i,
+			   PQerrorMessage(conn));
+	}
+
+	for (i = 0; i < nbatches; i++)
+	{
+		snprintf(param, sizeof(param), "%d", i);
+		EXPECT(PQbatchProcessQueue(conn), "PQbatchProcessQueue() failed at batch %d\n", i);
+		res = PQgetResult(conn);
+		EXPECT(res != NULL && PQresultStatus(res) == PGRES_TUPLES_OK,
+			   "Expected PGRES_TUPLES_OK for batch %d: %s\n", i,
+			   PQerrorMessage(conn));
+		EXPECT(strcmp(PQgetvalue(res, 0, 0), param) == 0,
+			   "expected %s from batch %d, got %s\n", param, i,
+			   PQgetvalue(res, 0, 0));
+		PQclear(res);
+		res = NULL;
+		EXPECT(PQgetResult(conn) == NULL,
+			   "expected NULL result after query %d\n", i);
+
+		EXPECT(PQbatchProcessQueue(conn), "PQbatchProcessQueue() for sync %d failed\n", i);
+		res = PQgetResult(conn);
+		EXPECT(res != NULL && PQresultStatus(res) == PGRES_BATCH_END,
+			   "Expected PGRES_BATCH_END for batch %d\n", i);
+		PQclear(res);
+		res = NULL;
+	}
+
+	/*
+	 * Now send a batch, and a query behind it without ending its batch, and
+	 * wait for the results of the first batch.  Wait with a timeout, so that
+	 * a server that never flushes them makes us fail rather than hang.
+	 */
+	EXPECT(PQsendQueryParams(conn, "SELECT $1", 1, param_oids, params,
+							 NULL, NULL, 0),
+		   "dispatching first query failed: %s\n", PQerrorMessage(conn));
+	EXPECT(PQbatchSendQueue(conn), "Ending batch failed: %s\n",
+		   PQerrorMessage(conn));
+	EXPECT(PQsendQueryParams(conn, "SELECT $1", 1, param_oids, params,
+							 NULL, NULL, 0),
+		   "dispatching second query failed: %s\n", PQerrorMessage(conn));
+	EXPECT(PQflush(conn) == 0, "PQflush failed: %s\n", PQerrorMessage(conn));
+
+	sock = PQsocket(conn);
+	FD_ZERO(&input_mask);
+	FD_SET(sock, &input_mask);
+	timeout.tv_sec = 60;
+	timeout.tv_usec = 0;
+	EXPECT(select(sock + 1, &input_mask, NULL, NULL, &timeout) > 0,
+		   "no reply to the sync within 60 seconds\n");
+
+	EXPECT(PQbatchProcessQueue(conn), "PQbatchProcessQueue() failed at first query\n");
+	res = PQgetResult(conn);
+	EXPECT(res != NULL && PQresultStatus(res) == PGRES_TUPLES_OK,
+		   "Expected PGRES_TUPLES_OK for first query: %s\n",
+		   PQerrorMessage(conn));
+	PQclear(res);
+	res = NULL;
+	EXPECT(PQgetResult(conn) == NULL, "expected NULL result after first query\n");
+	EXPECT(PQbatchProcessQueue(conn), "PQbatchProcessQueue() for sync failed\n");
+	res = PQgetResult(conn);
+	EXPECT(res != NULL && PQresultStatus(res) == PGRES_BATCH_END,
+		   "Expected PGRES_BATCH_END\n");
+	PQclear(res);
+	res = NULL;
+
+	/* End the second batch, and read its results as well */
+	EXPECT(PQbatchSendQueue(conn), "Ending second batch failed: %s\n",
+		   PQerrorMessage(conn));
+	EXPECT(PQbatchProcessQueue(conn), "PQbatchProcessQueue() failed at second query\n");
+	res = PQgetResult(conn);
+	EXPECT(res != NULL && PQresultStatus(res) == PGRES_TUPLES_OK,
+		   "Expected PGRES_TUPLES_OK for second query: %s\n",
+		   PQerrorMessage(conn));
+	PQclear(res);
+	res = NULL;
+	EXPECT(PQgetResult(conn) == NULL, "expected NULL result after second query\n");
+	EXPECT(PQbatchProcessQueue(conn), "PQbatchProcessQueue() for second sync failed\n");
+	res = PQgetResult(conn);
+	EXPECT(res != NULL && PQresultStatus(res) == PGRES_BATCH_END,
+		   "Expected PGRES_BATCH_END for second batch\n");
+	PQclear(res);
+	res = NULL;
+
+	EXPECT(PQexitBatchMode(conn), "exiting batch mode failed: %s\n",
+		   PQerrorMessage(conn));
+
+	res = PQexec(conn, "RESET defer_sync_flush");
+	EXPECT(PQresultStatus(res) == PGRES_COMMAND_OK,
+		   "failed to reset defer_sync_flush: %s\n", PQerrorMessage(conn));
+	PQclear(res);
+
+	fprintf(stderr, "ok\n");
+	return;
+
+fail:
+	PQclear(res);
+	exit_nicely(conn);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -914,7 +1278,10 @@ main(int argc, char **argv)
 				run_multi_batch = 1,
 				run_batch_abort = 1,
 				run_timings = 1,
-				run_singlerowmode = 1;
+				run_singlerowmode = 1,
+				run_rowcallback = 1,
+				run_recycle = 1,
+				run_deferred_flush = 1;
 
 	/*
 	 * If the user supplies a parameter on the command line, use it as the
@@ -935,6 +1302,9 @@ main(int argc, char **argv)
 			run_batch_abort = 0;
 			run_timings = 0;
 			run_singlerowmode = 0;
+			run_rowcallback = 0;
+			run_recycle = 0;
+			run_deferred_flush = 0;
 			if (strcmp(argv[3], "disallowed_in_batch") == 0)
 				run_disallowed_in_batch = 1;
 			else if (strcmp(argv[3], "simple_batch") == 0)
@@ -947,6 +1317,12 @@ main(int argc, char **argv)
 				run_timings = 1;
 			else if (strcmp(argv[3], "singlerowmode") == 0)
 				run_singlerowmode = 1;
+			else if (strcmp(argv[3], "rowcallback") == 0)
+				run_rowcallback = 1;
+			else if (strcmp(argv[3], "recycle") == 0)
+				run_recycle = 1;
+			else if (strcmp(argv[3], "deferred_flush") == 0)
+				run_deferred_flush = 1;
 			else
 			{
 				fprintf(stderr, "%s is not a recognized test name\n", argv[3]);
@@ -1006,6 +1382,16 @@ main(int argc, char **argv)
 
 	if(run_singlerowmode)
 		test_singlerowmode(conn);
+
+	if (run_rowcallback)
+		test_rowcallback(conn);
+
+	if (run_recycle)
+		test_recycle(conn);
+
+	if (run_deferred_flush)
+		test_deferred_flush(conn);
+
 	/* close the connection to the database and cleanup */
 	PQfinish(conn);
 
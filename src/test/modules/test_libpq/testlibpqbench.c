@@ -0,0 +1,399 @@
+/*
+ * src/test/modules/test_libpq/testlibpqbench.c
+ *
+ *
+ * testlibpqbench.c
+ *		Throughput benchmark for synchronous, asynchronous and batch
+ *		query execution
+ *
+ * Every query sends a text parameter of the given payload size and gets
+ * it echoed back, so that both directions of the batch code path in libpq
+ * are exercised.  In batch mode, the queue depth is the number of queries
+ * sent ahead of each synchronization point before any result is read.
+ *
+ * One line of key=value pairs is printed on stdout per run, for use by
+ * bench/001_batch_bench.pl.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include "c.h"
+#include "libpq-fe.h"
+#include "portability/instr_time.h"
+
+#define MAX_LIST_ITEMS 32
+
+static const char *const echo_sql = "SELECT $1::text";
+
+static void bench_fail(PGconn *conn, const char *fmt,...) pg_attribute_printf(2, 3);
+static int	parse_int_list(const char *str, int *items);
+static bool parse_modes(const char *str, bool *sync, bool *async, bool *batch);
+static void check_echo_result(PGconn *conn, PGresult *res, int payload_size);
+static double run_sync(PGconn *conn, int nqueries, const char *payload,
+					   int payload_size);
+static double run_async(PGconn *conn, int nqueries, const char *payload,
+						int payload_size);
+static double run_batch(PGconn *conn, int nqueries, int depth,
+						const char *payload, int payload_size);
+
+static void
+bench_fail(PGconn *conn, const char *fmt,...)
+{
+	va_list		args;
+
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+
+	PQfinish(conn);
+	exit(1);
+}
+
+static void
+usage_exit(const char *progname)
+{
+	fprintf(stderr, "Usage: %s [-d connstring] [-n queries] [-q depths] [-s sizes] [-m modes]\n", progname);
+	fprintf(stderr, "  depths and sizes are comma-separated lists of positive integers\n");
+	fprintf(stderr, "  modes: comma-separated list of sync, async and batch\n");
+	exit(1);
+}
+
+/*
+ * Parse a comma-separated list of positive integers into items[], returning
+ * the number of items, or -1 if the list is malformed.
+ */
+static int
+parse_int_list(const char *str, int *items)
+{
+	int			n = 0;
+
+	while (*str)
+	{
+		char	   *end;
+		long		val;
+
+		errno = 0;
+		val = strtol(str, &end, 10);
+		if (errno || end == str || val <= 0 || val > INT_MAX ||
+			n >= MAX_LIST_ITEMS)
+			return -1;
+		items[n++] = (int) val;
+
+		if (*end == ',')
+			end++;
+		else if (*end != '\0')
+			return -1;
+		str = end;
+	}
+
+	return n > 0 ? n : -1;
+}
+
+/*
+ * Parse a comma-separated list of mode names.  Returns false if an unknown
+ * name is found.
+ */
+static bool
+parse_modes(const char *str, bool *sync, bool *async, bool *batch)
+{
+	*sync = *async = *batch = false;
+
+	while (*str)
+	{
+		size_t		len = strcspn(str, ",");
+
+		if (len == 4 && strncmp(str, "sync", len) == 0)
+			*sync = true;
+		else if (len == 5 && strncmp(str, "async", len) == 0)
+			*async = true;
+		else if (len == 5 && strncmp(str, "batch", len) == 0)
+			*batch = true;
+		else
+			return false;
+
+		str += len;
+		if (*str == ',')
+			str++;
+	}
+
+	return *sync || *async || *batch;
+}
+
+static void
+check_echo_result(PGconn *conn, PGresult *res, int payload_size)
+{
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		bench_fail(conn, "query failed with %s: %s\n",
+				   PQresStatus(PQresultStatus(res)), PQerrorMessage(conn));
+	if (PQntuples(res) != 1 || PQgetlength(res, 0, 0) != payload_size)
+		bench_fail(conn, "unexpected result: %d rows, %d bytes\n",
+				   PQntuples(res),
+				   PQntuples(res) > 0 ? PQgetlength(res, 0, 0) : 0);
+}
+
+/*
+ * One PQexecPrepared call per query.
+ */
+static double
+run_sync(PGconn *conn, int nqueries, const char *payload, int payload_size)
+{
+	instr_time	start_time,
+				end_time;
+	int			i;
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	for (i = 0; i < nqueries; i++)
+	{
+		PGresult   *res;
+
+		res = PQexecPrepared(conn, "bench_echo", 1, &payload, NULL, NULL, 0);
+		check_echo_result(conn, res, payload_size);
+		PQclear(res);
+	}
+
+	INSTR_TIME_SET_CURRENT(end_time);
+	INSTR_TIME_SUBTRACT(end_time, start_time);
+
+	return INSTR_TIME_GET_MILLISEC(end_time);
+}
+
+/*
+ * PQsendQueryPrepared followed by PQgetResult until NULL, one query at a
+ * time, as an event-driven client without batching would do.
+ */
+static double
+run_async(PGconn *conn, int nqueries, const char *payload, int payload_size)
+{
+	instr_time	start_time,
+				end_time;
+	int			i;
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	for (i = 0; i < nqueries; i++)
+	{
+		PGresult   *res;
+		int			nresults = 0;
+
+		if (!PQsendQueryPrepared(conn, "bench_echo", 1, &payload,
+								 NULL, NULL, 0))
+			bench_fail(conn, "dispatching query failed: %s\n",
+					   PQerrorMessage(conn));
+
+		while ((res = PQgetResult(conn)) != NULL)
+		{
+			check_echo_result(conn, res, payload_size);
+			PQclear(res);
+			nresults++;
+		}
+		if (nresults != 1)
+			bench_fail(conn, "expected 1 result, got %d\n", nresults);
+	}
+
+	INSTR_TIME_SET_CURRENT(end_time);
+	INSTR_TIME_SUBTRACT(end_time, start_time);
+
+	return INSTR_TIME_GET_MILLISEC(end_time);
+}
+
+/*
+ * Groups of "depth" queries, each group followed by a batch sync, with the
+ * results of a group read only after the whole group has been sent.
+ */
+static double
+run_batch(PGconn *conn, int nqueries, int depth, const char *payload,
+		  int payload_size)
+{
+	instr_time	start_time,
+				end_time;
+	int			sent = 0;
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	if (!PQenterBatchMode(conn))
+		bench_fail(conn, "failed to enter batch mode: %s\n",
+				   PQerrorMessage(conn));
+
+	while (sent < nqueries)
+	{
+		int			group = Min(depth, nqueries - sent);
+		int			i;
+		PGresult   *res;
+
+		for (i = 0; i < group; i++)
+		{
+			if (!PQsendQueryPrepared(conn, "bench_echo", 1, &payload,
+									 NULL, NULL, 0))
+				bench_fail(conn, "dispatching query failed: %s\n",
+						   PQerrorMessage(conn));
+		}
+		if (!PQbatchSendQueue(conn))
+			bench_fail(conn, "ending batch failed: %s\n",
+					   PQerrorMessage(conn));
+		sent += group;
+
+		for (i = 0; i < group; i++)
+		{
+			if (!PQbatchProcessQueue(conn))
+				bench_fail(conn, "PQbatchProcessQueue() failed: %s\n",
+						   PQerrorMessage(conn));
+			res = PQgetResult(conn);
+			if (res == NULL)
+				bench_fail(conn, "missing result: %s\n", PQerrorMessage(conn));
+			check_echo_result(conn, res, payload_size);
+			PQclear(res);
+			if (PQgetResult(conn) != NULL)
+				bench_fail(conn, "unexpected extra result\n");
+		}
+
+		/* and the sync */
+		if (!PQbatchProcessQueue(conn))
+			bench_fail(conn, "PQbatchProcessQueue() failed at sync: %s\n",
+					   PQerrorMessage(conn));
+		res = PQgetResult(conn);
+		if (res == NULL || PQresultStatus(res) != PGRES_BATCH_END)
+			bench_fail(conn, "expected PGRES_BATCH_END: %s\n",
+					   PQerrorMessage(conn));
+		PQclear(res);
+		if (PQgetResult(conn) != NULL)
+			bench_fail(conn, "unexpected result after sync\n");
+	}
+
+	if (!PQexitBatchMode(conn))
+		bench_fail(conn, "exiting batch mode failed: %s\n",
+				   PQerrorMessage(conn));
+
+	INSTR_TIME_SET_CURRENT(end_time);
+	INSTR_TIME_SUBTRACT(end_time, start_time);
+
+	return INSTR_TIME_GET_MILLISEC(end_time);
+}
+
+static void
+report(const char *mode, int depth, int size, int nqueries, double elapsed)
+{
+	printf("mode=%s depth=%d size=%d queries=%d elapsed_ms=%.3f qps=%.1f\n",
+		   mode, depth, size, nqueries, elapsed,
+		   elapsed > 0 ? nqueries * 1000.0 / elapsed : 0.0);
+	fflush(stdout);
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *conninfo = "dbname = postgres";
+	PGconn	   *conn;
+	PGresult   *res;
+	int			nqueries = 1000;
+	int			depths[MAX_LIST_ITEMS] = {1, 10, 100, 1000};
+	int			ndepths = 4;
+	int			sizes[MAX_LIST_ITEMS] = {16, 1024, 8192};
+	int			nsizes = 3;
+	bool		run_sync_mode = true,
+				run_async_mode = true,
+				run_batch_mode = true;
+	int			i,
+				j;
+
+	for (i = 1; i < argc; i++)
+	{
+		const char *opt = argv[i];
+		const char *val;
+
+		if (opt[0] != '-' || opt[1] == '\0' || opt[2] != '\0' || i + 1 >= argc)
+			usage_exit(argv[0]);
+		val = argv[++i];
+
+		switch (opt[1])
+		{
+			case 'd':
+				conninfo = val;
+				break;
+			case 'n':
+				nqueries = atoi(val);
+				if (nqueries <= 0)
+				{
+					fprintf(stderr, "number of queries must be positive\n");
+					usage_exit(argv[0]);
+				}
+				break;
+			case 'q':
+				ndepths = parse_int_list(val, depths);
+				if (ndepths < 0)
+				{
+					fprintf(stderr, "invalid list of queue depths: \"%s\"\n", val);
+					usage_exit(argv[0]);
+				}
+				break;
+			case 's':
+				nsizes = parse_int_list(val, sizes);
+				if (nsizes < 0)
+				{
+					fprintf(stderr, "invalid list of payload sizes: \"%s\"\n", val);
+					usage_exit(argv[0]);
+				}
+				break;
+			case 'm':
+				if (!parse_modes(val, &run_sync_mode, &run_async_mode,
+								 &run_batch_mode))
+				{
+					fprintf(stderr, "invalid list of modes: \"%s\"\n", val);
+					usage_exit(argv[0]);
+				}
+				break;
+			default:
+				usage_exit(argv[0]);
+		}
+	}
+
+	/* Make a connection to the database */
+	conn = PQconnectdb(conninfo);
+
+	/* Check to see that the backend connection was successfully made */
+	if (PQstatus(conn) != CONNECTION_OK)
+		bench_fail(conn, "Connection to database failed: %s\n",
+				   PQerrorMessage(conn));
+
+	res = PQprepare(conn, "bench_echo", echo_sql, 1, NULL);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		bench_fail(conn, "prepare failed: %s\n", PQerrorMessage(conn));
+	PQclear(res);
+
+	for (j = 0; j < nsizes; j++)
+	{
+		char	   *payload = malloc(sizes[j] + 1);
+
+		if (payload == NULL)
+			bench_fail(conn, "out of memory\n");
+		memset(payload, 'x', sizes[j]);
+		payload[sizes[j]] = '\0';
+
+		if (run_sync_mode)
+			report("sync", 1, sizes[j], nqueries,
+				   run_sync(conn, nqueries, payload, sizes[j]));
+
+		if (run_async_mode)
+			report("async", 1, sizes[j], nqueries,
+				   run_async(conn, nqueries, payload, sizes[j]));
+
+		if (run_batch_mode)
+		{
+			for (i = 0; i < ndepths; i++)
+				report("batch", depths[i], sizes[j], nqueries,
+					   run_batch(conn, nqueries, depths[i], payload, sizes[j]));
+		}
+
+		free(payload);
+	}
+
+	/* close the connection to the database and cleanup */
+	PQfinish(conn);
+
+	return 0;
+}
@@ -0,0 +1,19 @@
+CREATE EXTENSION test_microbench;
+
+-- The timings vary from run to run, so only check the shape of the results.
+SELECT benchmark, variant, ops, elapsed_ms >= 0 AS timed
+  FROM bench_simplehash(1000);
+SELECT benchmark, variant, ops, elapsed_ms >= 0 AS timed
+  FROM bench_dshash(1000);
+SELECT benchmark, variant, ops, elapsed_ms >= 0 AS timed
+  FROM unnest(ARRAY['int4', 'int8', 'float8', 'text', 'text_c']) k,
+       LATERAL bench_tuplesort(1000, k);
+SELECT benchmark, variant, ops, elapsed_ms >= 0 AS timed
+  FROM bench_shm_mq(100, 10000, 4096);
+SELECT benchmark, variant, ops, elapsed_ms >= 0 AS timed
+  FROM bench_expression('$1 * 2 + 1', 1000);
+
+-- Errors
+SELECT * FROM bench_tuplesort(1000, 'box');
+SELECT * FROM bench_expression('1 FROM pg_class', 1000);
+SELECT * FROM bench_simplehash(0);
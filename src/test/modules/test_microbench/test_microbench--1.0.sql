@@ -0,0 +1,63 @@
+/* src/test/modules/test_microbench/test_microbench--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_microbench" to load this file. \quit
+
+CREATE FUNCTION bench_simplehash(nkeys int4,
+	OUT benchmark text, OUT variant text, OUT ops int8,
+	OUT elapsed_ms float8, OUT ns_per_op float8)
+RETURNS SETOF record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION bench_dshash(nkeys int4,
+	OUT benchmark text, OUT variant text, OUT ops int8,
+	OUT elapsed_ms float8, OUT ns_per_op float8)
+RETURNS SETOF record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION bench_tuplesort(nrows int4, keytype text,
+	OUT benchmark text, OUT variant text, OUT ops int8,
+	OUT elapsed_ms float8, OUT ns_per_op float8)
+RETURNS SETOF record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION bench_shm_mq(nmessages int4, message_size int4,
+	queue_size int4,
+	OUT benchmark text, OUT variant text, OUT ops int8,
+	OUT elapsed_ms float8, OUT ns_per_op float8)
+RETURNS SETOF record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION bench_expression(expr text, nrows int4,
+	OUT benchmark text, OUT variant text, OUT ops int8,
+	OUT elapsed_ms float8, OUT ns_per_op float8)
+RETURNS SETOF record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+-- The standard workloads, used by "make benchmark".  scale multiplies the
+-- number of operations of each.
+CREATE FUNCTION bench_standard(scale int4 DEFAULT 1,
+	OUT benchmark text, OUT variant text, OUT ops int8,
+	OUT elapsed_ms float8, OUT ns_per_op float8)
+RETURNS SETOF record STRICT
+LANGUAGE sql
+AS $$
+SELECT * FROM bench_simplehash(1000000 * scale)
+UNION ALL
+SELECT * FROM bench_dshash(1000000 * scale)
+UNION ALL
+SELECT s.* FROM unnest(ARRAY['int4', 'int8', 'float8', 'text', 'text_c']) k,
+	LATERAL bench_tuplesort(1000000 * scale, k) s
+UNION ALL
+SELECT s.* FROM unnest(ARRAY[64, 1024, 65536]) m,
+	LATERAL bench_shm_mq((100000000 * scale) / m, m, 65536) s
+UNION ALL
+SELECT s.* FROM unnest(ARRAY['$1 + 1',
+							 '$1 * 2 + $1 / 3 - 7',
+							 '$1 > 100 AND $1 < 1000000',
+							 'CASE WHEN $1 % 3 = 0 THEN 1 WHEN $1 % 3 = 1 THEN 2 ELSE 3 END',
+							 'sqrt($1::float8) * ln($1::float8 + 1)',
+							 'length($1::text)',
+							 '$1 IN (1, 10, 100, 1000, 10000, 100000)']) e,
+	LATERAL bench_expression(e, 10000000 * scale) s
+$$;
@@ -0,0 +1,683 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_microbench.c
+ *		Micro-benchmarks for core data structures and executor primitives.
+ *
+ * Each benchmark function runs a fixed workload on one piece of backend
+ * infrastructure and returns one row per measured phase, with the number of
+ * operations performed and the elapsed time.  The workloads use a fixed
+ * pseudo-random sequence, so that they are the same on every run and every
+ * build.
+ *
+ * Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_microbench/test_microbench.c
+ *
+ * -------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "catalog/pg_collation.h"
+#include "catalog/pg_type.h"
+#include "common/hashfn.h"
+#include "executor/executor.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "lib/dshash.h"
+#include "miscadmin.h"
+#include "nodes/params.h"
+#include "nodes/parsenodes.h"
+#include "optimizer/optimizer.h"
+#include "parser/parse_collate.h"
+#include "parser/parse_expr.h"
+#include "parser/parse_node.h"
+#include "parser/parse_param.h"
+#include "portability/instr_time.h"
+#include "storage/dsm.h"
+#include "storage/lwlock.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/dsa.h"
+#include "utils/memutils.h"
+#include "utils/tuplesort.h"
+#include "utils/tuplestore.h"
+#include "utils/typcache.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(bench_simplehash);
+PG_FUNCTION_INFO_V1(bench_dshash);
+PG_FUNCTION_INFO_V1(bench_tuplesort);
+PG_FUNCTION_INFO_V1(bench_shm_mq);
+PG_FUNCTION_INFO_V1(bench_expression);
+
+/* Seeds of the key sequences; the lookups that miss use the second one */
+#define BENCH_SEED			UINT64CONST(0x5DEECE66D)
+#define BENCH_MISS_SEED		UINT64CONST(0x2545F4914F6CDD1D)
+
+/* Number of columns of the result rows */
+#define BENCH_RESULT_COLS	5
+
+/*
+ * State of a benchmark function, which returns its rows in a tuplestore.
+ */
+typedef struct BenchState
+{
+	const char *benchmark;		/* name of the benchmark */
+	Tuplestorestate *tupstore;
+	TupleDesc	tupdesc;
+	instr_time	start;			/* start of the current phase */
+} BenchState;
+
+/* The simplehash instantiation benchmarked */
+typedef struct BenchHashEntry
+{
+	uint64		key;
+	uint64		value;
+	char		status;
+} BenchHashEntry;
+
+#define SH_PREFIX benchhash
+#define SH_ELEMENT_TYPE BenchHashEntry
+#define SH_KEY_TYPE uint64
+#define SH_KEY key
+#define SH_HASH_KEY(tb, key) murmurhash32((uint32) ((key) ^ ((key) >> 32)))
+#define SH_EQUAL(tb, a, b) ((a) == (b))
+#define SH_SCOPE static inline
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
+/* The dshash entries benchmarked */
+typedef struct BenchDshashEntry
+{
+	uint64		key;
+	uint64		value;
+} BenchDshashEntry;
+
+/*
+ * Return the next value of a splitmix64 sequence.  Unlike random(), this
+ * gives the same sequence on every platform.
+ */
+static inline uint64
+bench_next(uint64 *state)
+{
+	uint64		z;
+
+	*state += UINT64CONST(0x9E3779B97F4A7C15);
+	z = *state;
+	z = (z ^ (z >> 30)) * UINT64CONST(0xBF58476D1CE4E5B9);
+	z = (z ^ (z >> 27)) * UINT64CONST(0x94D049BB133111EB);
+	return z ^ (z >> 31);
+}
+
+/*
+ * Set up to return rows from a benchmark function.
+ */
+static void
+bench_begin(BenchState *bench, FunctionCallInfo fcinfo, const char *benchmark)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	MemoryContext oldcontext;
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+
+	if (get_call_result_type(fcinfo, NULL, &bench->tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+	bench->tupstore = tuplestore_begin_heap(true, false, work_mem);
+	bench->benchmark = benchmark;
+
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = bench->tupstore;
+	rsinfo->setDesc = bench->tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Start timing a phase of the benchmark.
+ */
+static inline void
+bench_start(BenchState *bench)
+{
+	INSTR_TIME_SET_CURRENT(bench->start);
+}
+
+/*
+ * Stop timing a phase of the benchmark, and report it as a result row.
+ */
+static void
+bench_stop(BenchState *bench, const char *variant, int64 ops)
+{
+	instr_time	elapsed;
+	double		ms;
+	Datum		values[BENCH_RESULT_COLS];
+	bool		nulls[BENCH_RESULT_COLS];
+
+	INSTR_TIME_SET_CURRENT(elapsed);
+	INSTR_TIME_SUBTRACT(elapsed, bench->start);
+	ms = INSTR_TIME_GET_MILLISEC(elapsed);
+
+	memset(nulls, 0, sizeof(nulls));
+	values[0] = CStringGetTextDatum(bench->benchmark);
+	values[1] = CStringGetTextDatum(variant);
+	values[2] = Int64GetDatum(ops);
+	values[3] = Float8GetDatum(ms);
+	if (ops > 0)
+		values[4] = Float8GetDatum(ms * 1000000.0 / ops);
+	else
+		nulls[4] = true;
+
+	tuplestore_putvalues(bench->tupstore, bench->tupdesc, values, nulls);
+}
+
+static void
+check_count(const char *name, int32 count)
+{
+	if (count <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("%s must be positive", name)));
+}
+
+/*
+ * bench_simplehash(nkeys)
+ *
+ * Insert nkeys random 64-bit keys into a simplehash table, which starts out
+ * empty so that it is grown along the way, then look them all up, look up
+ * as many keys that are not there, and delete them all.
+ */
+Datum
+bench_simplehash(PG_FUNCTION_ARGS)
+{
+	int32		nkeys = PG_GETARG_INT32(0);
+	BenchState	bench;
+	MemoryContext cxt;
+	MemoryContext oldcxt;
+	benchhash_hash *hash;
+	uint64		seed;
+	uint64		sum = 0;
+	bool		found;
+	int32		i;
+
+	check_count("nkeys", nkeys);
+	bench_begin(&bench, fcinfo, "simplehash");
+
+	cxt = AllocSetContextCreate(CurrentMemoryContext,
+								"simplehash benchmark",
+								ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(cxt);
+
+	hash = benchhash_create(cxt, 8, NULL);
+
+	bench_start(&bench);
+	seed = BENCH_SEED;
+	for (i = 0; i < nkeys; i++)
+	{
+		BenchHashEntry *entry;
+
+		entry = benchhash_insert(hash, bench_next(&seed), &found);
+		entry->value = i;
+	}
+	bench_stop(&bench, "insert", nkeys);
+
+	bench_start(&bench);
+	seed = BENCH_SEED;
+	for (i = 0; i < nkeys; i++)
+	{
+		BenchHashEntry *entry = benchhash_lookup(hash, bench_next(&seed));
+
+		if (entry == NULL)
+			elog(ERROR, "simplehash lookup failed");
+		sum += entry->value;
+	}
+	bench_stop(&bench, "lookup", nkeys);
+
+	bench_start(&bench);
+	seed = BENCH_MISS_SEED;
+	for (i = 0; i < nkeys; i++)
+	{
+		if (benchhash_lookup(hash, bench_next(&seed)) != NULL)
+			sum++;
+	}
+	bench_stop(&bench, "lookup_miss", nkeys);
+
+	bench_start(&bench);
+	seed = BENCH_SEED;
+	for (i = 0; i < nkeys; i++)
+	{
+		if (!benchhash_delete(hash, bench_next(&seed)))
+			elog(ERROR, "simplehash delete failed");
+	}
+	bench_stop(&bench, "delete", nkeys);
+
+	/* keep the compiler from optimizing the lookups away */
+	if (sum == PG_UINT64_MAX)
+		elog(NOTICE, "unexpected checksum");
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(cxt);
+
+	return (Datum) 0;
+}
+
+/*
+ * bench_dshash(nkeys)
+ *
+ * The same workload as bench_simplehash, on a dshash table in a DSA area
+ * created for the purpose.  It runs in a single backend, so it measures the
+ * cost of the partition locks without any contention.
+ */
+Datum
+bench_dshash(PG_FUNCTION_ARGS)
+{
+	int32		nkeys = PG_GETARG_INT32(0);
+	BenchState	bench;
+	int			tranche_id;
+	dsa_area   *area;
+	dshash_table *hash;
+	dshash_parameters params;
+	uint64		seed;
+	uint64		sum = 0;
+	bool		found;
+	int32		i;
+
+	check_count("nkeys", nkeys);
+	bench_begin(&bench, fcinfo, "dshash");
+
+	tranche_id = LWLockNewTrancheId();
+	LWLockRegisterTranche(tranche_id, "test_microbench");
+
+	params.key_size = sizeof(uint64);
+	params.entry_size = sizeof(BenchDshashEntry);
+	params.compare_function = dshash_memcmp;
+	params.hash_function = dshash_memhash;
+	params.tranche_id = tranche_id;
+
+	area = dsa_create(tranche_id);
+	hash = dshash_create(area, &params, NULL);
+
+	bench_start(&bench);
+	seed = BENCH_SEED;
+	for (i = 0; i < nkeys; i++)
+	{
+		uint64		key = bench_next(&seed);
+		BenchDshashEntry *entry;
+
+		entry = dshash_find_or_insert(hash, &key, &found);
+		entry->value = i;
+		dshash_release_lock(hash, entry);
+	}
+	bench_stop(&bench, "insert", nkeys);
+
+	bench_start(&bench);
+	seed = BENCH_SEED;
+	for (i = 0; i < nkeys; i++)
+	{
+		uint64		key = bench_next(&seed);
+		BenchDshashEntry *entry;
+
+		entry = dshash_find(hash, &key, false);
+		if (entry == NULL)
+			elog(ERROR, "dshash lookup failed");
+		sum += entry->value;
+		dshash_release_lock(hash, entry);
+	}
+	bench_stop(&bench, "lookup", nkeys);
+
+	bench_start(&bench);
+	seed = BENCH_MISS_SEED;
+	for (i = 0; i < nkeys; i++)
+	{
+		uint64		key = bench_next(&seed);
+		BenchDshashEntry *entry;
+
+		entry = dshash_find(hash, &key, false);
+		if (entry != NULL)
+		{
+			sum++;
+			dshash_release_lock(hash, entry);
+		}
+	}
+	bench_stop(&bench, "lookup_miss", nkeys);
+
+	bench_start(&bench);
+	seed = BENCH_SEED;
+	for (i = 0; i < nkeys; i++)
+	{
+		uint64		key = bench_next(&seed);
+
+		if (!dshash_delete_key(hash, &key))
+			elog(ERROR, "dshash delete failed");
+	}
+	bench_stop(&bench, "delete", nkeys);
+
+	/* keep the compiler from optimizing the lookups away */
+	if (sum == PG_UINT64_MAX)
+		elog(NOTICE, "unexpected checksum");
+
+	dshash_destroy(hash);
+	dsa_detach(area);
+
+	return (Datum) 0;
+}
+
+/*
+ * bench_tuplesort(nrows, keytype)
+ *
+ * Sort nrows random datums of the given kind with a datum tuplesort, using
+ * work_mem.  The key types are int4, int8, float8, text (in the database's
+ * default collation) and text_c (in the "C" collation).  The generation of
+ * the input is not timed; loading the sort, sorting, and reading back the
+ * results are timed together.
+ */
+Datum
+bench_tuplesort(PG_FUNCTION_ARGS)
+{
+	int32		nrows = PG_GETARG_INT32(0);
+	char	   *keytype = text_to_cstring(PG_GETARG_TEXT_PP(1));
+	BenchState	bench;
+	Oid			typid;
+	Oid			collation = InvalidOid;
+	TypeCacheEntry *typentry;
+	MemoryContext cxt;
+	MemoryContext oldcxt;
+	Tuplesortstate *sortstate;
+	Datum	   *input;
+	Datum		val;
+	bool		isnull;
+	uint64		seed = BENCH_SEED;
+	int64		nread = 0;
+	int32		i;
+
+	check_count("nrows", nrows);
+
+	if (strcmp(keytype, "int4") == 0)
+		typid = INT4OID;
+	else if (strcmp(keytype, "int8") == 0)
+		typid = INT8OID;
+	else if (strcmp(keytype, "float8") == 0)
+		typid = FLOAT8OID;
+	else if (strcmp(keytype, "text") == 0)
+	{
+		typid = TEXTOID;
+		collation = DEFAULT_COLLATION_OID;
+	}
+	else if (strcmp(keytype, "text_c") == 0)
+	{
+		typid = TEXTOID;
+		collation = C_COLLATION_OID;
+	}
+	else
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("unrecognized key type \"%s\"", keytype),
+				 errhint("Valid key types are \"int4\", \"int8\", \"float8\", \"text\" and \"text_c\".")));
+
+	bench_begin(&bench, fcinfo, "tuplesort");
+
+	typentry = lookup_type_cache(typid, TYPECACHE_LT_OPR);
+
+	cxt = AllocSetContextCreate(CurrentMemoryContext,
+								"tuplesort benchmark",
+								ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(cxt);
+
+	input = palloc_extended(sizeof(Datum) * nrows, MCXT_ALLOC_HUGE);
+	for (i = 0; i < nrows; i++)
+	{
+		uint64		r = bench_next(&seed);
+
+		switch (typid)
+		{
+			case INT4OID:
+				input[i] = Int32GetDatum((int32) r);
+				break;
+			case INT8OID:
+				input[i] = Int64GetDatum((int64) r);
+				break;
+			case FLOAT8OID:
+				input[i] = Float8GetDatum((double) (r >> 11) / (double) (UINT64CONST(1) << 53));
+				break;
+			default:
+				{
+					char		buf[32];
+
+					/* strings with a common prefix, like many real keys */
+					snprintf(buf, sizeof(buf), "key-" UINT64_FORMAT, r);
+					input[i] = CStringGetTextDatum(buf);
+					break;
+				}
+		}
+	}
+
+	bench_start(&bench);
+	sortstate = tuplesort_begin_datum(typid, typentry->lt_opr, collation,
+									  false, work_mem, NULL, false);
+	for (i = 0; i < nrows; i++)
+		tuplesort_putdatum(sortstate, input[i], false);
+	tuplesort_performsort(sortstate);
+	while (tuplesort_getdatum(sortstate, true, &val, &isnull, NULL))
+		nread++;
+	tuplesort_end(sortstate);
+	bench_stop(&bench, keytype, nrows);
+
+	if (nread != nrows)
+		elog(ERROR, "tuplesort returned " INT64_FORMAT " rows, expected %d",
+			 nread, nrows);
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(cxt);
+
+	return (Datum) 0;
+}
+
+/*
+ * bench_shm_mq(nmessages, message_size, queue_size)
+ *
+ * Pass nmessages messages of message_size bytes through a shm_mq of
+ * queue_size bytes in a dynamic shared memory segment.  The backend is both
+ * the sender and the receiver, alternately filling and draining the queue
+ * without waiting, so this measures the cost of copying data through the
+ * ring buffer, not that of waking up another process.
+ *
+ * This is done twice: once flushing and receiving every message by itself,
+ * and once in batches, with shm_mq_flush() and shm_mq_receive_many().
+ */
+Datum
+bench_shm_mq(PG_FUNCTION_ARGS)
+{
+	int32		nmessages = PG_GETARG_INT32(0);
+	int32		message_size = PG_GETARG_INT32(1);
+	int32		queue_size = PG_GETARG_INT32(2);
+	BenchState	bench;
+	char	   *message;
+	int			batched;
+
+	check_count("nmessages", nmessages);
+	check_count("message_size", message_size);
+	if (queue_size < (int32) shm_mq_minimum_size)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("queue size must be at least %zu bytes",
+						shm_mq_minimum_size)));
+
+	bench_begin(&bench, fcinfo, "shm_mq");
+
+	message = palloc(message_size);
+	memset(message, 'x', message_size);
+
+	for (batched = 0; batched <= 1; batched++)
+	{
+		dsm_segment *seg;
+		shm_mq	   *mq;
+		shm_mq_handle *sendh;
+		shm_mq_handle *recvh;
+		int32		nsent = 0;
+		int32		nreceived = 0;
+
+		seg = dsm_create(queue_size, 0);
+		mq = shm_mq_create(dsm_segment_address(seg), queue_size);
+		shm_mq_set_sender(mq, MyProc);
+		shm_mq_set_receiver(mq, MyProc);
+		sendh = shm_mq_attach(mq, seg, NULL);
+		recvh = shm_mq_attach(mq, seg, NULL);
+
+		bench_start(&bench);
+		while (nreceived < nmessages)
+		{
+			shm_mq_result res;
+
+			CHECK_FOR_INTERRUPTS();
+
+			/* Send until the queue is full */
+			while (nsent < nmessages)
+			{
+				res = shm_mq_send(sendh, message_size, message, true,
+								  !batched);
+				if (res == SHM_MQ_WOULD_BLOCK)
+					break;
+				if (res != SHM_MQ_SUCCESS)
+					elog(ERROR, "could not send message");
+				nsent++;
+			}
+			if (batched && shm_mq_flush(sendh) != SHM_MQ_SUCCESS)
+				elog(ERROR, "could not send message");
+
+			/* Then receive until it is empty */
+			for (;;)
+			{
+				shm_mq_iovec msgs[16];
+				int			nmsgs;
+				int			i;
+
+				if (batched)
+					res = shm_mq_receive_many(recvh, msgs, lengthof(msgs),
+											  &nmsgs, true);
+				else
+				{
+					void	   *data;
+
+					res = shm_mq_receive(recvh, &msgs[0].len, &data, true);
+					msgs[0].data = data;
+					nmsgs = 1;
+				}
+				if (res == SHM_MQ_WOULD_BLOCK)
+					break;
+				if (res != SHM_MQ_SUCCESS)
+					elog(ERROR, "could not receive message");
+				for (i = 0; i < nmsgs; i++)
+				{
+					if (msgs[i].len != message_size)
+						elog(ERROR, "could not receive message");
+				}
+				nreceived += nmsgs;
+			}
+		}
+		bench_stop(&bench,
+				   psprintf(batched ? "%d bytes, batched" : "%d bytes",
+							message_size),
+				   nmessages);
+
+		/* We set our own latch on every flush; don't leave it set */
+		ResetLatch(MyLatch);
+
+		shm_mq_detach(sendh);
+		shm_mq_detach(recvh);
+		dsm_detach(seg);
+	}
+
+	return (Datum) 0;
+}
+
+/*
+ * bench_expression(expr, nrows)
+ *
+ * Compile an expression, in which $1 is a bigint, and evaluate it nrows
+ * times with $1 going from 1 to nrows.  Only the evaluation is timed, which
+ * isolates the cost of the expression evaluation machinery (ExecInterpExpr,
+ * or the JIT-compiled code) from that of the rest of the executor.
+ */
+Datum
+bench_expression(PG_FUNCTION_ARGS)
+{
+	char	   *exprsrc = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	int32		nrows = PG_GETARG_INT32(1);
+	BenchState	bench;
+	List	   *raw_parsetree_list;
+	RawStmt    *rawstmt;
+	SelectStmt *stmt;
+	ResTarget  *target;
+	ParseState *pstate;
+	Oid			paramtype = INT8OID;
+	Oid		   *paramtypes = &paramtype;
+	Node	   *expr;
+	ExprState  *exprstate;
+	ExprContext *econtext;
+	ParamListInfo params;
+	int32		i;
+
+	check_count("nrows", nrows);
+	bench_begin(&bench, fcinfo, "expression");
+
+	/* Parse "SELECT expr", and check that that's all we got */
+	raw_parsetree_list = pg_parse_query(psprintf("SELECT %s", exprsrc));
+	if (list_length(raw_parsetree_list) != 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid expression \"%s\"", exprsrc)));
+	rawstmt = linitial_node(RawStmt, raw_parsetree_list);
+	stmt = (SelectStmt *) rawstmt->stmt;
+	if (!IsA(stmt, SelectStmt) || list_length(stmt->targetList) != 1 ||
+		stmt->fromClause != NIL || stmt->whereClause != NULL ||
+		stmt->op != SETOP_NONE)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid expression \"%s\"", exprsrc)));
+	target = linitial_node(ResTarget, stmt->targetList);
+
+	/* Transform and plan it, like a query's target list entry */
+	pstate = make_parsestate(NULL);
+	pstate->p_sourcetext = exprsrc;
+	parse_fixed_parameters(pstate, paramtypes, 1);
+	expr = transformExpr(pstate, target->val, EXPR_KIND_SELECT_TARGET);
+	assign_expr_collations(pstate, expr);
+	free_parsestate(pstate);
+	expr = (Node *) expression_planner((Expr *) expr);
+
+	params = makeParamList(1);
+	params->params[0].ptype = INT8OID;
+	params->params[0].pflags = PARAM_FLAG_CONST;
+	params->params[0].isnull = false;
+
+	econtext = CreateStandaloneExprContext();
+	econtext->ecxt_param_list_info = params;
+	exprstate = ExecInitExpr((Expr *) expr, NULL);
+
+	bench_start(&bench);
+	for (i = 1; i <= nrows; i++)
+	{
+		bool		isnull;
+
+		params->params[0].value = Int64GetDatum((int64) i);
+		(void) ExecEvalExprSwitchContext(exprstate, econtext, &isnull);
+		ResetExprContext(econtext);
+	}
+	bench_stop(&bench, exprsrc, nrows);
+
+	FreeExprContext(econtext, true);
+
+	return (Datum) 0;
+}
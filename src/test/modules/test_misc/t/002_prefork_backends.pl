@@ -0,0 +1,134 @@
+# Test pools of pre-forked backends
+
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More;
+use Time::HiRes qw(usleep);
+
+if ($windows_os)
+{
+	plan skip_all => 'pre-forked backends are not supported on Windows';
+}
+else
+{
+	plan tests => 9;
+}
+
+# Initialize a test cluster with a pool of one backend for "postgres".  The
+# pool doesn't take up the slots reserved for superusers, so it can't be
+# refilled while two sessions are open.
+my $node = get_new_node('primary');
+$node->init();
+$node->append_conf(
+	'postgresql.conf', qq(
+max_connections = 4
+superuser_reserved_connections = 2
+prefork_backends = 1
+prefork_databases = 'postgres'
+log_min_messages = debug2
+));
+$node->start;
+
+# Has the postmaster logged handing a connection to this backend?
+sub handed_off
+{
+	my $pid = shift;
+	my $log = slurp_file($node->logfile);
+
+	return $log =~ /passed connection to pre-forked backend, pid=$pid /;
+}
+
+# Connect to "postgres" until a pre-forked backend serves the connection, as
+# the pool may not be ready yet.  Returns that backend's PID and the database
+# it is connected to.
+sub connect_through_pool
+{
+	for (my $i = 0; $i < 180 * 10; $i++)
+	{
+		my ($pid, $dbname) = split /\|/,
+		  $node->safe_psql('postgres',
+			'SELECT pg_backend_pid(), current_database()');
+		return ($pid, $dbname) if handed_off($pid);
+		usleep(100_000);
+	}
+	die "no connection was passed to a pre-forked backend";
+}
+
+# Start a session that stays open, and return its harness and backend PID
+sub start_session
+{
+	my ($dbname, $appname) = @_;
+	my $h = IPC::Run::start(
+		[
+			'psql', '-XAtq', '-d',
+			$node->connstr($dbname) . " application_name=$appname",
+			'-c', 'SELECT pg_sleep(600)'
+		]);
+
+	$node->poll_query_until('template1',
+		"SELECT count(*) = 1 FROM pg_stat_activity WHERE application_name = '$appname'"
+	) or die "timed out waiting for session $appname";
+	my $pid = $node->safe_psql('template1',
+		"SELECT pid FROM pg_stat_activity WHERE application_name = '$appname'");
+	return ($h, $pid);
+}
+
+# Start a session on "postgres" that a pre-forked backend serves, retrying
+# while the pool isn't ready yet
+sub start_pooled_session
+{
+	my $appname = shift;
+
+	for (my $i = 0; $i < 180 * 10; $i++)
+	{
+		my ($h, $pid) = start_session('postgres', $appname);
+		return ($h, $pid) if handed_off($pid);
+
+		$node->safe_psql('template1', "SELECT pg_terminate_backend($pid)");
+		$h->finish;
+		$node->poll_query_until('template1',
+			"SELECT count(*) = 0 FROM pg_stat_activity WHERE pid = $pid")
+		  or die "timed out waiting for session $appname to exit";
+		usleep(100_000);
+	}
+	die "no session was passed to a pre-forked backend";
+}
+
+# A connection to the pooled database is served from the pool, and works
+# like any other
+my ($pid, $dbname) = connect_through_pool();
+ok($pid, 'connection passed to a pre-forked backend');
+is($dbname, 'postgres', 'pre-forked backend connected to its database');
+
+# The pool is refilled after use
+my ($pid2) = connect_through_pool();
+isnt($pid2, $pid, 'pool refilled with a new backend');
+
+# Connections to other databases are not affected
+$pid = $node->safe_psql('template1', 'SELECT pg_backend_pid()');
+ok($pid, 'connection to a database without a pool');
+ok(!handed_off($pid), 'connection to a database without a pool is forked');
+
+# Hold two sessions from the pool open, so the pool is empty and can't be
+# refilled; the next connection gets a backend forked for it instead
+my ($h1, $pid_s1) = start_pooled_session('session1');
+my ($h2, $pid_s2) = start_pooled_session('session2');
+ok(handed_off($pid_s1) && handed_off($pid_s2),
+	'both open sessions served by pre-forked backends');
+
+$pid = $node->safe_psql('postgres', 'SELECT pg_backend_pid()');
+ok($pid, 'connection with an empty pool');
+ok(!handed_off($pid), 'connection with an empty pool is forked');
+
+# Once the sessions end, the pool is refilled and serves connections again
+$node->safe_psql('template1',
+	"SELECT pg_terminate_backend(pid) FROM pg_stat_activity WHERE application_name IN ('session1', 'session2')"
+);
+$h1->finish;
+$h2->finish;
+($pid) = connect_through_pool();
+ok($pid, 'pool serves connections again once sessions end');
+
+$node->stop;
@@ -0,0 +1,119 @@
+# Test the shared cache of relation sizes, including when it is full
+
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 6;
+
+# The cache holds far fewer relations than the test uses, so most of them
+# don't fit once it's full
+my $node = get_new_node('primary');
+$node->init();
+$node->append_conf(
+	'postgresql.conf', qq(
+relsize_cache_size = 16
+autovacuum = off
+));
+$node->start;
+
+my $ntables = 100;
+
+# Count the tables whose sequential scan doesn't see exactly the given number
+# of rows.  The scan stops at the size smgrnblocks() reports, cached or not.
+$node->safe_psql(
+	'postgres', qq{
+create function wrong_counts(expected int) returns int
+language plpgsql as \$\$
+declare
+	n int;
+	wrong int := 0;
+begin
+	for i in 1 .. $ntables loop
+		execute format('select count(*) from t%s', i) into n;
+		if n <> expected then
+			wrong := wrong + 1;
+		end if;
+	end loop;
+	return wrong;
+end
+\$\$;});
+
+sub check_counts
+{
+	my ($expected, $name) = @_;
+
+	is($node->safe_psql('postgres', "select wrong_counts($expected)"),
+		'0', $name);
+	return;
+}
+
+# Create many tables spanning a few blocks each, in separate transactions so
+# that the sizes are recorded both on extension and on lookup
+for my $i (1 .. $ntables)
+{
+	$node->safe_psql('postgres',
+		"create table t$i (a int, b text); insert into t$i select g, repeat('x', 100) from generate_series(1, 500) g;"
+	);
+}
+check_counts(500, 'all rows seen after filling the cache');
+
+# Extend every table from another session; the next scans must see the new
+# blocks whether or not the size is cached
+$node->safe_psql(
+	'postgres', qq{
+do \$\$
+begin
+	for i in 1 .. $ntables loop
+		execute format('insert into t%s select g, repeat(''x'', 100) from generate_series(501, 1000) g', i);
+	end loop;
+end
+\$\$;});
+check_counts(1000, 'all rows seen after extending every table');
+
+# Shrink the tables by truncation, both by VACUUM and by TRUNCATE, and grow
+# them again
+$node->safe_psql(
+	'postgres', qq{
+do \$\$
+begin
+	for i in 1 .. $ntables loop
+		execute format('delete from t%s where a > 100', i);
+	end loop;
+end
+\$\$;});
+$node->safe_psql('postgres', 'vacuum');
+check_counts(100, 'all rows seen after VACUUM truncated every table');
+
+$node->safe_psql(
+	'postgres', qq{
+do \$\$
+begin
+	for i in 1 .. $ntables loop
+		execute format('truncate t%s', i);
+		execute format('insert into t%s select g, repeat(''x'', 100) from generate_series(1, 300) g', i);
+	end loop;
+end
+\$\$;});
+check_counts(300, 'all rows seen after TRUNCATE and refilling every table');
+
+# Dropping tables frees up entries for new ones
+$node->safe_psql(
+	'postgres', qq{
+do \$\$
+begin
+	for i in 1 .. $ntables loop
+		execute format('drop table t%s', i);
+		execute format('create table t%s (a int, b text)', i);
+		execute format('insert into t%s select g, repeat(''x'', 100) from generate_series(1, 200) g', i);
+	end loop;
+end
+\$\$;});
+check_counts(200, 'all rows seen after dropping and recreating every table');
+
+# The cache never takes more than its share of shared memory, so running
+# out of room in it must not have raised any error
+my $log = slurp_file($node->logfile);
+unlike($log, qr/out of shared memory/, 'no shared memory errors');
+
+$node->stop;
@@ -0,0 +1,88 @@
+# Test parallel replay of WAL records on a standby.
+#
+# Records changing single blocks of tables and B-tree indexes are replayed
+# by parallel redo workers, everything else by the startup process once the
+# workers have caught up.  Check that a standby replaying a mix of both ends
+# up with the same data as the primary, before and after it is promoted.
+use strict;
+use warnings;
+
+use PostgresNode;
+use TestLib;
+use Test::More tests => 4;
+
+my $node_primary = get_new_node('primary');
+$node_primary->init(allows_streaming => 1);
+$node_primary->append_conf('postgresql.conf', 'autovacuum = off');
+$node_primary->start;
+
+$node_primary->backup('primary_backup');
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_primary, 'primary_backup',
+	has_streaming => 1);
+$node_standby->append_conf(
+	'postgresql.conf', qq{
+recovery_parallel_workers = 4
+max_worker_processes = 8
+log_min_messages = debug1
+});
+$node_standby->start;
+
+# A few tables with indexes, so that records go to different workers,
+# with updates across pages, page splits, truncation and dropped tables in
+# between for the startup process to replay.
+$node_primary->safe_psql(
+	'postgres', qq{
+create table t1 (a int primary key, b text);
+create table t2 (a int primary key, b text);
+create table t3 (a int, b text);
+create index on t3 (b);
+insert into t1 select g, repeat('x', 100) from generate_series(1, 10000) g;
+insert into t2 select g, md5(g::text) from generate_series(1, 10000) g;
+insert into t3 select g % 100, md5(g::text) from generate_series(1, 10000) g;
+update t1 set b = repeat('y', 200) where a % 3 = 0;
+delete from t2 where a % 5 = 0;
+vacuum t2;
+delete from t3 where a > 50;
+vacuum t3;
+create table t4 as select * from t1;
+drop table t4;
+insert into t3 select g % 100, md5(g::text) from generate_series(1, 5000) g;
+});
+
+$node_primary->wait_for_catchup($node_standby, 'replay',
+	$node_primary->lsn('insert'));
+
+my $query =
+  q{select (select sum(hashtext(t1::text)) from t1),
+		   (select sum(hashtext(t2::text)) from t2),
+		   (select sum(hashtext(t3::text)) from t3),
+		   (select count(*) from t3 where b > '8')};
+my $expected = $node_primary->safe_psql('postgres', $query);
+
+is($node_standby->safe_psql('postgres', $query),
+	$expected, 'standby has the same data as the primary');
+
+# The workers don't connect to a database, so they don't show up in
+# pg_stat_activity
+like(
+	slurp_file($node_standby->logfile),
+	qr/starting background worker process "parallel redo worker 3"/,
+	'parallel redo workers were started');
+
+# Index scans on the standby must find the same rows as sequential scans
+is( $node_standby->safe_psql(
+		'postgres', q{
+set enable_seqscan = off;
+select count(*) from t3 where b > '8';}),
+	$node_standby->safe_psql(
+		'postgres', q{
+set enable_indexscan = off; set enable_bitmapscan = off;
+select count(*) from t3 where b > '8';}),
+	'index and heap agree on the standby');
+
+$node_standby->promote;
+$node_standby->safe_psql('postgres',
+	"insert into t1 select g, 'z' from generate_series(10001, 10100) g");
+is( $node_standby->safe_psql('postgres', 'select count(*) from t1'),
+	'10100', 'promoted standby accepts writes');
@@ -0,0 +1,101 @@
+# Test queries on a hot standby while parallel redo workers replay WAL.
+#
+# Index entries must never be found before the heap tuples they point to
+# have been replayed, and the visibility map bits of their pages cleared.
+# Otherwise an index-only scan on the standby would count rows that a
+# sequential scan with the same snapshot doesn't see.
+use strict;
+use warnings;
+
+use PostgresNode;
+use TestLib;
+use Test::More tests => 4;
+
+my $node_primary = get_new_node('primary');
+$node_primary->init(allows_streaming => 1);
+$node_primary->append_conf('postgresql.conf', 'autovacuum = off');
+$node_primary->start;
+
+$node_primary->safe_psql(
+	'postgres', qq{
+create table t (a int, b int);
+create index on t (b);
+insert into t select g, g from generate_series(1, 10000) g;
+vacuum t;
+});
+
+$node_primary->backup('primary_backup');
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_primary, 'primary_backup',
+	has_streaming => 1);
+$node_standby->append_conf(
+	'postgresql.conf', qq{
+hot_standby = on
+recovery_parallel_workers = 4
+max_worker_processes = 8
+});
+$node_standby->start;
+$node_primary->wait_for_catchup($node_standby, 'replay',
+	$node_primary->lsn('insert'));
+
+# Counting the rows with an index-only scan and a sequential scan in one
+# snapshot must give the same result
+my $check = q{
+begin isolation level repeatable read;
+set local enable_seqscan = off;
+set local enable_bitmapscan = off;
+select count(*) from t where b > 0;
+set local enable_seqscan = on;
+set local enable_indexscan = off;
+set local enable_indexonlyscan = off;
+select count(*) from t where b > 0;
+commit;
+};
+
+like(
+	$node_standby->safe_psql(
+		'postgres', q{
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+explain (costs off) select count(*) from t where b > 0;}),
+	qr/Index Only Scan/,
+	'standby uses an index-only scan');
+
+# Insert rows on the primary, vacuuming now and then so that the visibility
+# map bits are set again, while the standby runs the check
+my $load = '';
+for my $i (1 .. 200)
+{
+	$load .=
+	  "insert into t select g, g from generate_series(1, 200) g;\n";
+	$load .= "vacuum t;\n" if $i % 10 == 0;
+}
+my ($load_out, $load_err);
+my $load_h = IPC::Run::start(
+	[ 'psql', '-XAtq', '-d', $node_primary->connstr('postgres'), '-f', '-' ],
+	'<', \$load, '>', \$load_out, '2>', \$load_err);
+
+my $mismatches = 0;
+my $checks     = 0;
+for my $i (1 .. 100)
+{
+	my @counts = split /\n/, $node_standby->safe_psql('postgres', $check);
+	$checks++;
+	$mismatches++ if $counts[0] ne $counts[1];
+}
+
+$load_h->finish;
+is($mismatches, 0,
+	"index-only and sequential scans agree during replay ($checks checks)");
+
+$node_primary->wait_for_catchup($node_standby, 'replay',
+	$node_primary->lsn('insert'));
+
+my $query = q{select count(*), sum(a), sum(b) from t};
+is($node_standby->safe_psql('postgres', $query),
+	$node_primary->safe_psql('postgres', $query),
+	'standby has the same data as the primary');
+
+# Everything has been replayed, so both scans must see all rows
+my @counts = split /\n/, $node_standby->safe_psql('postgres', $check);
+is_deeply(\@counts, [ 50000, 50000 ], 'scans agree after replay');
@@ -0,0 +1,214 @@
+# Test torn page protection by the double-write file.
+#
+# A server crashes in the middle of a checkpoint, and the pages the
+# checkpoint had written are then torn on disk, as an operating system
+# crash might have left them.  Crash recovery must restore them from the
+# double-write file, since with wal_level = minimal the WAL has no full-page
+# images to repair them with.  With a higher wal_level, full-page images
+# must still be written.
+use strict;
+use warnings;
+
+use PostgresNode;
+use TestLib;
+use Test::More tests => 7;
+
+# Layout of a slot of the double-write file, see doublewrite.c
+my $dw_header_size = 512;
+my $blcksz;
+
+# Return the sequence numbers of the newest copies of main fork pages in the
+# double-write file of a node that are above $minseq, as a hash keyed by
+# "dbnode/relnode/blkno"
+sub dw_copies
+{
+	my ($node, $minseq) = @_;
+	my $slotsz = $dw_header_size + $blcksz;
+	my %copies;
+
+	open my $fh, '<', $node->data_dir . '/global/pg_dblwrite'
+	  or die "could not open double-write file: $!";
+	binmode $fh;
+	my $slot;
+	while (read($fh, $slot, $slotsz) == $slotsz)
+	{
+		my ($magic, $crc, $seq, $spc, $db, $rel, $fork, $blkno) =
+		  unpack('L L Q L L L l L', $slot);
+		next if $magic != 0x44575031 || $seq <= $minseq || $fork != 0;
+
+		my $key = "$db/$rel/$blkno";
+		$copies{$key} = $seq
+		  unless defined $copies{$key} && $copies{$key} > $seq;
+	}
+	close $fh;
+	return \%copies;
+}
+
+# Highest sequence number used in the double-write file so far
+sub dw_maxseq
+{
+	my $node   = shift;
+	my $maxseq = 0;
+
+	foreach my $seq (values %{ dw_copies($node, 0) })
+	{
+		$maxseq = $seq if $seq > $maxseq;
+	}
+	return $maxseq;
+}
+
+# Data checksums make sure that a torn page can't go unnoticed
+my $node = get_new_node('primary');
+$node->init(extra => ['--data-checksums']);
+$node->append_conf(
+	'postgresql.conf', qq{
+wal_level = minimal
+max_wal_senders = 0
+double_write_buffers = 1024
+full_page_writes = on
+autovacuum = off
+log_checkpoints = on
+checkpoint_timeout = 1h
+checkpoint_completion_target = 0.9
+min_wal_size = 32MB
+max_wal_size = 32MB
+});
+$node->start;
+$blcksz = $node->safe_psql('postgres', 'show block_size');
+
+$node->safe_psql(
+	'postgres', q{
+create table t (a int, b text);
+insert into t select g, repeat('x', 200) from generate_series(1, 10000) g;
+checkpoint;
+});
+my $relpath = $node->safe_psql('postgres', q{select pg_relation_filepath('t')});
+
+# Count the full-page images that updating every row of t writes.  With
+# checksums, hint bit updates are logged in full regardless, so leave out
+# those.
+sub count_fpis
+{
+	my $node  = shift;
+	my $start = $node->lsn('insert');
+	$node->safe_psql('postgres', q{update t set a = a + 1});
+	my $end = $node->lsn('insert');
+	my ($stdout, $stderr) = run_command(
+		[
+			'pg_waldump', '--path', $node->data_dir . '/pg_wal',
+			'--start', $start, '--end', $end
+		]);
+	return scalar(grep { /FPW/ && !/FPI_FOR_HINT/ } split /\n/, $stdout);
+}
+
+is(count_fpis($node), 0, 'no full-page images with wal_level = minimal');
+
+# Copies written so far are of pages that the last checkpoint synced.  Set
+# the hint bits of t before that, as with checksums they're WAL-logged with
+# full-page images, which could repair torn pages just the same.  Also start
+# on a new WAL segment, so that dirtying t doesn't reach the next one.
+$node->safe_psql('postgres', 'select count(*) from t');
+$node->safe_psql('postgres', 'select pg_switch_wal()');
+$node->safe_psql('postgres', 'checkpoint');
+my $minseq = dw_maxseq($node);
+
+# Dirty the pages of t again, and start a checkpoint by switching to a new
+# WAL segment.  With no more WAL written, it proceeds slowly, as there is
+# plenty of time left until checkpoint_timeout.
+my $oldblocks = $node->safe_psql('postgres',
+	q{select pg_relation_size('t') / current_setting('block_size')::int});
+my $logstart = -s $node->logfile;
+$node->safe_psql('postgres', q{update t set b = repeat('y', 200)});
+$node->safe_psql('postgres', 'select pg_switch_wal()');
+
+# Return what the server has logged since we dirtied the pages
+sub log_since_update
+{
+	return substr(slurp_file($node->logfile), $logstart);
+}
+
+my $started = 0;
+for (my $i = 0; $i < 180 * 10; $i++)
+{
+	if (log_since_update() =~ /checkpoint starting: wal/)
+	{
+		$started = 1;
+		last;
+	}
+	select(undef, undef, undef, 0.1);
+}
+ok($started, 'checkpoint started');
+
+# Return the blocks of t copied to the double-write file since $minseq that
+# existed before the update.  Redo initializes the blocks that the update
+# added from scratch, so tearing those would prove nothing.
+sub old_blocks_copied
+{
+	my @blocks;
+
+	foreach my $key (keys %{ dw_copies($node, $minseq) })
+	{
+		my ($db, $rel, $blkno) = split m{/}, $key;
+		push @blocks, $blkno
+		  if "base/$db/$rel" eq $relpath && $blkno < $oldblocks;
+	}
+	return @blocks;
+}
+
+# Wait for the checkpoint to have written some of them
+for (my $i = 0; $i < 180 * 10; $i++)
+{
+	last if old_blocks_copied() >= 10;
+	select(undef, undef, undef, 0.1);
+}
+
+my $query = q{select count(*), sum(a), md5(string_agg(b, ',' order by a)) from t};
+my $expected = $node->safe_psql('postgres', $query);
+
+$node->stop('immediate');
+unlike(log_since_update(), qr/checkpoint complete/,
+	'crashed before the checkpoint completed');
+
+# Tear those pages: keep the first half of what was written, and overwrite
+# the rest
+my $torn = 0;
+foreach my $blkno (old_blocks_copied())
+{
+	my $half = $blcksz / 2;
+	my $path = $node->data_dir . "/$relpath";
+
+	open my $fh, '+<', $path or die "could not open $path: $!";
+	binmode $fh;
+	sysseek($fh, $blkno * $blcksz + $half, 0)
+	  or die "could not seek in $path: $!";
+	syswrite($fh, "\xAA" x $half) == $half
+	  or die "could not write to $path: $!";
+	close $fh;
+	$torn++;
+}
+ok($torn >= 10, 'tore pages of t written by the checkpoint');
+
+$node->start;
+like(
+	slurp_file($node->logfile),
+	qr/restored \d+ pages? from the double-write file/,
+	'torn pages restored from the double-write file');
+is($node->safe_psql('postgres', $query),
+	$expected, 'data intact after crash recovery');
+
+$node->stop;
+
+# With wal_level = replica, full-page images are written regardless
+my $node_replica = get_new_node('replica');
+$node_replica->init(allows_streaming => 1);
+$node_replica->append_conf('postgresql.conf', 'double_write_buffers = 64');
+$node_replica->start;
+$node_replica->safe_psql(
+	'postgres', q{
+create table t (a int, b text);
+insert into t select g, repeat('x', 200) from generate_series(1, 1000) g;
+checkpoint;
+});
+cmp_ok(count_fpis($node_replica), '>', 0,
+	'full-page images with wal_level = replica');
+$node_replica->stop;
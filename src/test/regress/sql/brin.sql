@@ -470,3 +470,22 @@ VACUUM ANALYZE brin_test;
 EXPLAIN (COSTS OFF) SELECT * FROM brin_test WHERE a = 1;
 -- Ensure brin index is not used when values are not correlated
 EXPLAIN (COSTS OFF) SELECT * FROM brin_test WHERE b = 1;
+
+-- Test that updating a column indexed only by BRIN can be a HOT update,
+-- and that the BRIN summary still covers the new value
+CREATE TABLE brin_hot (
+  id  integer PRIMARY KEY,
+  val integer NOT NULL
+) WITH (autovacuum_enabled = off, fillfactor = 70);
+INSERT INTO brin_hot SELECT *, 0 FROM generate_series(1, 235);
+CREATE INDEX val_brin ON brin_hot USING brin (val);
+BEGIN;
+UPDATE brin_hot SET val = -3 WHERE id = 42;
+SELECT pg_stat_get_xact_tuples_hot_updated('brin_hot'::regclass);
+SET LOCAL enable_seqscan = off;
+SELECT id FROM brin_hot WHERE val = -3;
+-- but changing an indexed column still prevents HOT
+UPDATE brin_hot SET id = -42 WHERE id = 42;
+SELECT pg_stat_get_xact_tuples_hot_updated('brin_hot'::regclass);
+COMMIT;
+DROP TABLE brin_hot;
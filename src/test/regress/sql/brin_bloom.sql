@@ -0,0 +1,194 @@
+CREATE TABLE brintest_bloom (int2col smallint,
+	int4col integer,
+	int8col bigint,
+	textcol text,
+	bpcharcol character,
+	uuidcol uuid,
+	datecol date,
+	timestampcol timestamp without time zone,
+	numericcol numeric,
+	float8col double precision
+) WITH (fillfactor=10, autovacuum_enabled=off);
+
+-- the values are not correlated with their position in the table
+INSERT INTO brintest_bloom SELECT
+	((i * 7919) % 10000) % 1000,
+	(i * 7919) % 10000,
+	((i * 7919) % 10000) * 1000000007::int8,
+	md5((i % 500)::text),
+	substr(md5((i % 500)::text), 1, 1)::bpchar,
+	md5(i::text)::uuid,
+	date '2020-01-01' + (i * 31) % 365,
+	timestamp '2020-01-01' + ((i * 7919) % 10000) * interval '1 minute',
+	((i * 7919) % 10000) / 100.0,
+	((i * 7919) % 10000)::float8 / 4
+FROM generate_series(1, 10000) i;
+
+-- throw in some NULL's
+INSERT INTO brintest_bloom (int4col) SELECT NULL::int4 FROM generate_series(1, 100);
+
+CREATE INDEX brinidx_bloom ON brintest_bloom USING brin (
+	int2col int2_bloom_ops,
+	int4col int4_bloom_ops,
+	int8col int8_bloom_ops(false_positive_rate = 0.05),
+	textcol text_bloom_ops,
+	bpcharcol bpchar_bloom_ops,
+	uuidcol uuid_bloom_ops(n_distinct_per_range = 20),
+	datecol date_bloom_ops,
+	timestampcol timestamp_bloom_ops,
+	numericcol numeric_bloom_ops,
+	float8col float8_bloom_ops
+) WITH (pages_per_range = 1);
+
+CREATE TABLE brinopers_bloom (colname name, typ text,
+	op text[], value text[], matches int[],
+	check (cardinality(op) = cardinality(value)),
+	check (cardinality(op) = cardinality(matches)));
+
+INSERT INTO brinopers_bloom VALUES
+	('int2col', 'int2',
+	 '{=, =, IS, IS NOT}',
+	 '{17, 999, NULL, NULL}',
+	 '{10, 10, 100, 10000}'),
+	('int4col', 'int4',
+	 '{=, =}',
+	 '{17, 9999}',
+	 '{1, 1}'),
+	('int8col', 'int8',
+	 '{=, =}',
+	 '{17000000119, 9998000069986}',
+	 '{1, 1}'),
+	('textcol', 'text',
+	 '{=, =}',
+	 '{a1d0c6e83f027327d8461063f4ac58a6, 3cf166c6b73f030b4f67eeaeba301103}',
+	 '{20, 20}'),
+	('bpcharcol', 'bpchar',
+	 '{=}',
+	 '{a}',
+	 '{640}'),
+	('uuidcol', 'uuid',
+	 '{=, IS}',
+	 '{fe7ecc4d-e28b-2c83-c016-b5c6c2acd826, NULL}',
+	 '{1, 100}'),
+	('datecol', 'date',
+	 '{=}',
+	 '{2020-04-10}',
+	 '{28}'),
+	('timestampcol', 'timestamp',
+	 '{=, =}',
+	 '{2020-01-01 00:17:00, 2020-01-07 22:39:00}',
+	 '{1, 1}'),
+	('numericcol', 'numeric',
+	 '{=, =}',
+	 '{0.17, 99.99}',
+	 '{1, 1}'),
+	('float8col', 'float8',
+	 '{=}',
+	 '{4.25}',
+	 '{1}');
+
+DO $x$
+DECLARE
+	r record;
+	r2 record;
+	cond text;
+	idx_ctids tid[];
+	ss_ctids tid[];
+	count int;
+	plan_ok bool;
+	plan_line text;
+BEGIN
+	FOR r IN SELECT colname, oper, typ, value[ordinality], matches[ordinality] FROM brinopers_bloom, unnest(op) WITH ORDINALITY AS oper LOOP
+
+		-- prepare the condition
+		IF r.value IS NULL THEN
+			cond := format('%I %s %L', r.colname, r.oper, r.value);
+		ELSE
+			cond := format('%I %s %L::%s', r.colname, r.oper, r.value, r.typ);
+		END IF;
+
+		-- run the query using the brin index
+		SET enable_seqscan = 0;
+		SET enable_bitmapscan = 1;
+
+		plan_ok := false;
+		FOR plan_line IN EXECUTE format($y$EXPLAIN SELECT array_agg(ctid) FROM brintest_bloom WHERE %s $y$, cond) LOOP
+			IF plan_line LIKE '%Bitmap Heap Scan on brintest_bloom%' THEN
+				plan_ok := true;
+			END IF;
+		END LOOP;
+		IF NOT plan_ok THEN
+			RAISE WARNING 'did not get bitmap indexscan plan for %', r;
+		END IF;
+
+		EXECUTE format($y$SELECT array_agg(ctid) FROM brintest_bloom WHERE %s $y$, cond)
+			INTO idx_ctids;
+
+		-- run the query using a seqscan
+		SET enable_seqscan = 1;
+		SET enable_bitmapscan = 0;
+
+		plan_ok := false;
+		FOR plan_line IN EXECUTE format($y$EXPLAIN SELECT array_agg(ctid) FROM brintest_bloom WHERE %s $y$, cond) LOOP
+			IF plan_line LIKE '%Seq Scan on brintest_bloom%' THEN
+				plan_ok := true;
+			END IF;
+		END LOOP;
+		IF NOT plan_ok THEN
+			RAISE WARNING 'did not get seqscan plan for %', r;
+		END IF;
+
+		EXECUTE format($y$SELECT array_agg(ctid) FROM brintest_bloom WHERE %s $y$, cond)
+			INTO ss_ctids;
+
+		-- make sure both return the same results
+		count := array_length(idx_ctids, 1);
+
+		IF NOT (count = array_length(ss_ctids, 1) AND
+				idx_ctids @> ss_ctids AND
+				idx_ctids <@ ss_ctids) THEN
+			-- report the results of each scan to make the differences obvious
+			RAISE WARNING 'something not right in %: count %', r, count;
+			SET enable_seqscan = 1;
+			SET enable_bitmapscan = 0;
+			FOR r2 IN EXECUTE 'SELECT ' || r.colname || ' FROM brintest_bloom WHERE ' || cond LOOP
+				RAISE NOTICE 'seqscan: %', r2;
+			END LOOP;
+
+			SET enable_seqscan = 0;
+			SET enable_bitmapscan = 1;
+			FOR r2 IN EXECUTE 'SELECT ' || r.colname || ' FROM brintest_bloom WHERE ' || cond LOOP
+				RAISE NOTICE 'bitmapscan: %', r2;
+			END LOOP;
+		END IF;
+
+		-- make sure we found expected number of matches
+		IF count != r.matches THEN RAISE WARNING 'unexpected number of results % for %', count, r; END IF;
+	END LOOP;
+END;
+$x$;
+
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+-- summarize new values, and make sure we still find them
+INSERT INTO brintest_bloom (int4col, textcol, uuidcol)
+	VALUES (12345, 'new value', '01234567-89ab-cdef-0123-456789abcdef');
+VACUUM brintest_bloom;  -- force a summarization cycle in brinidx_bloom
+SET enable_seqscan = 0;
+SELECT count(*) FROM brintest_bloom WHERE int4col = 12345;
+SELECT count(*) FROM brintest_bloom WHERE textcol = 'new value';
+SELECT count(*) FROM brintest_bloom WHERE uuidcol = '01234567-89ab-cdef-0123-456789abcdef';
+RESET enable_seqscan;
+
+-- only equality is supported
+EXPLAIN (COSTS OFF) SELECT * FROM brintest_bloom WHERE int4col < 17;
+
+-- invalid options
+CREATE INDEX ON brintest_bloom USING brin (int4col int4_bloom_ops(false_positive_rate = 0.5));
+CREATE INDEX ON brintest_bloom USING brin (int4col int4_bloom_ops(n_distinct_per_range = -2));
+-- the filter must fit on a page
+CREATE INDEX ON brintest_bloom USING brin (int4col int4_bloom_ops(n_distinct_per_range = 100000, false_positive_rate = 0.0001));
+
+DROP TABLE brintest_bloom;
+DROP TABLE brinopers_bloom;
@@ -0,0 +1,234 @@
+CREATE TABLE brintest_multi (int2col smallint,
+	int4col integer,
+	int8col bigint,
+	float4col real,
+	float8col double precision,
+	numericcol numeric,
+	datecol date,
+	timestampcol timestamp without time zone,
+	timestamptzcol timestamp with time zone,
+	timecol time without time zone,
+	intervalcol interval,
+	uuidcol uuid,
+	lsncol pg_lsn,
+	oidcol oid
+) WITH (fillfactor=10, autovacuum_enabled=off);
+
+-- mostly correlated values, with outliers that a plain minmax index can't
+-- deal with
+INSERT INTO brintest_multi SELECT
+	i / 2,
+	k,
+	k * 1000003::int8,
+	(i % 1000)::real / 8,
+	k::float8 / 4,
+	k / 100.0,
+	date '2000-01-01' + k / 10,
+	timestamp '2000-01-01' + k * interval '1 minute',
+	timestamptz '2000-01-01 00:00:00+00' + k * interval '1 second',
+	time '00:00' + (i % 1440) * interval '1 minute',
+	k * interval '1 second',
+	format('%s-0000-0000-0000-000000000000', to_char(k, 'FM00000000'))::uuid,
+	format('0/%s', to_hex(k))::pg_lsn,
+	k::oid
+FROM generate_series(1, 10000) i,
+	LATERAL (SELECT CASE WHEN i % 100 = 0 THEN 100000 + i ELSE i END AS k) x;
+
+-- throw in some NULL's
+INSERT INTO brintest_multi (int2col) SELECT NULL::int2 FROM generate_series(1, 100);
+
+CREATE INDEX brinidx_multi ON brintest_multi USING brin (
+	int2col int2_minmax_multi_ops,
+	int4col int4_minmax_multi_ops(values_per_range = 8),
+	int8col int8_minmax_multi_ops,
+	float4col float4_minmax_multi_ops,
+	float8col float8_minmax_multi_ops,
+	numericcol numeric_minmax_multi_ops,
+	datecol date_minmax_multi_ops,
+	timestampcol timestamp_minmax_multi_ops,
+	timestamptzcol timestamptz_minmax_multi_ops,
+	timecol time_minmax_multi_ops,
+	intervalcol interval_minmax_multi_ops,
+	uuidcol uuid_minmax_multi_ops,
+	lsncol pg_lsn_minmax_multi_ops,
+	oidcol oid_minmax_multi_ops
+) WITH (pages_per_range = 4);
+
+CREATE TABLE brinopers_multi (colname name, typ text,
+	op text[], value text[], matches int[],
+	check (cardinality(op) = cardinality(value)),
+	check (cardinality(op) = cardinality(matches)));
+
+INSERT INTO brinopers_multi VALUES
+	('int2col', 'int2',
+	 '{<, <=, =, >=, >}',
+	 '{100, 100, 2500, 4900, 4900}',
+	 '{199, 201, 2, 201, 199}'),
+	('int2col', 'int4',
+	 '{<, <=, =, >=, >}',
+	 '{100, 100, 2500, 4900, 4900}',
+	 '{199, 201, 2, 201, 199}'),
+	('int4col', 'int4',
+	 '{<, <=, =, >=, >, =, IS, IS NOT}',
+	 '{50, 50, 5001, 9990, 9990, 100500, NULL, NULL}',
+	 '{49, 50, 1, 110, 109, 1, 100, 10000}'),
+	('int4col', 'int8',
+	 '{<, <=, =, >=, >}',
+	 '{50, 50, 5001, 9990, 9990}',
+	 '{49, 50, 1, 110, 109}'),
+	('int8col', 'int8',
+	 '{<, <=, =, >=, >}',
+	 '{50000150, 5000015000, 5001015003, 9990029970, 100300300900}',
+	 '{49, 4950, 1, 110, 97}'),
+	('float4col', 'float4',
+	 '{<, <=, =, >=, >}',
+	 '{1, 1, 62.5, 100, 124}',
+	 '{80, 90, 10, 2000, 70}'),
+	('float8col', 'float8',
+	 '{<, <=, =, >=, >}',
+	 '{12.5, 12.5, 1250.25, 2497.5, 2497.5}',
+	 '{49, 50, 1, 110, 109}'),
+	('numericcol', 'numeric',
+	 '{<, <=, =, >=, >}',
+	 '{0.50, 0.50, 50.01, 99.90, 99.90}',
+	 '{49, 50, 1, 110, 109}'),
+	('datecol', 'date',
+	 '{<, <=, =, >=, >}',
+	 '{2000-01-06, 2000-01-06, 2001-05-15, 2002-09-26, 2002-09-26}',
+	 '{49, 59, 9, 110, 100}'),
+	('timestampcol', 'timestamp',
+	 '{<, <=, =, >=, >}',
+	 '{"2000-01-01 00:50:00", "2000-01-01 00:50:00", "2000-01-04 11:21:00", "2000-01-07 22:30:00", "2000-01-07 22:30:00"}',
+	 '{49, 50, 1, 110, 109}'),
+	('timestamptzcol', 'timestamptz',
+	 '{<, <=, =, >=, >}',
+	 '{"2000-01-01 00:00:50+00", "2000-01-01 00:00:50+00", "2000-01-01 01:23:21+00", "2000-01-01 02:46:30+00", "2000-01-01 02:46:30+00"}',
+	 '{49, 50, 1, 110, 109}'),
+	('timecol', 'time',
+	 '{<, <=, =, >=, >}',
+	 '{01:00:00, 01:00:00, 10:00:00, 23:20:00, 23:20:00}',
+	 '{419, 426, 7, 240, 234}'),
+	('intervalcol', 'interval',
+	 '{<, <=, =, >=, >}',
+	 '{"50 seconds", "50 seconds", "5001 seconds", "9990 seconds", "9990 seconds"}',
+	 '{49, 50, 1, 110, 109}'),
+	('uuidcol', 'uuid',
+	 '{<, <=, =, >=, >}',
+	 '{00000050-0000-0000-0000-000000000000, 00000050-0000-0000-0000-000000000000, 00005001-0000-0000-0000-000000000000, 00009990-0000-0000-0000-000000000000, 00009990-0000-0000-0000-000000000000}',
+	 '{49, 50, 1, 110, 109}'),
+	('lsncol', 'pg_lsn',
+	 '{<, <=, =, >=, >}',
+	 '{0/32, 0/32, 0/1389, 0/2706, 0/2706}',
+	 '{49, 50, 1, 110, 109}'),
+	('oidcol', 'oid',
+	 '{<, <=, =, >=, >}',
+	 '{50, 50, 5001, 9990, 9990}',
+	 '{49, 50, 1, 110, 109}'),
+	('datecol', 'timestamp',
+	 '{=}',
+	 '{"2001-05-15 00:00:00"}',
+	 '{9}');
+
+DO $x$
+DECLARE
+	r record;
+	r2 record;
+	cond text;
+	idx_ctids tid[];
+	ss_ctids tid[];
+	count int;
+	plan_ok bool;
+	plan_line text;
+BEGIN
+	FOR r IN SELECT colname, oper, typ, value[ordinality], matches[ordinality] FROM brinopers_multi, unnest(op) WITH ORDINALITY AS oper LOOP
+
+		-- prepare the condition
+		IF r.value IS NULL THEN
+			cond := format('%I %s %L', r.colname, r.oper, r.value);
+		ELSE
+			cond := format('%I %s %L::%s', r.colname, r.oper, r.value, r.typ);
+		END IF;
+
+		-- run the query using the brin index
+		SET enable_seqscan = 0;
+		SET enable_bitmapscan = 1;
+
+		plan_ok := false;
+		FOR plan_line IN EXECUTE format($y$EXPLAIN SELECT array_agg(ctid) FROM brintest_multi WHERE %s $y$, cond) LOOP
+			IF plan_line LIKE '%Bitmap Heap Scan on brintest_multi%' THEN
+				plan_ok := true;
+			END IF;
+		END LOOP;
+		IF NOT plan_ok THEN
+			RAISE WARNING 'did not get bitmap indexscan plan for %', r;
+		END IF;
+
+		EXECUTE format($y$SELECT array_agg(ctid) FROM brintest_multi WHERE %s $y$, cond)
+			INTO idx_ctids;
+
+		-- run the query using a seqscan
+		SET enable_seqscan = 1;
+		SET enable_bitmapscan = 0;
+
+		plan_ok := false;
+		FOR plan_line IN EXECUTE format($y$EXPLAIN SELECT array_agg(ctid) FROM brintest_multi WHERE %s $y$, cond) LOOP
+			IF plan_line LIKE '%Seq Scan on brintest_multi%' THEN
+				plan_ok := true;
+			END IF;
+		END LOOP;
+		IF NOT plan_ok THEN
+			RAISE WARNING 'did not get seqscan plan for %', r;
+		END IF;
+
+		EXECUTE format($y$SELECT array_agg(ctid) FROM brintest_multi WHERE %s $y$, cond)
+			INTO ss_ctids;
+
+		-- make sure both return the same results
+		count := array_length(idx_ctids, 1);
+
+		IF NOT (count = array_length(ss_ctids, 1) AND
+				idx_ctids @> ss_ctids AND
+				idx_ctids <@ ss_ctids) THEN
+			-- report the results of each scan to make the differences obvious
+			RAISE WARNING 'something not right in %: count %', r, count;
+			SET enable_seqscan = 1;
+			SET enable_bitmapscan = 0;
+			FOR r2 IN EXECUTE 'SELECT ' || r.colname || ' FROM brintest_multi WHERE ' || cond LOOP
+				RAISE NOTICE 'seqscan: %', r2;
+			END LOOP;
+
+			SET enable_seqscan = 0;
+			SET enable_bitmapscan = 1;
+			FOR r2 IN EXECUTE 'SELECT ' || r.colname || ' FROM brintest_multi WHERE ' || cond LOOP
+				RAISE NOTICE 'bitmapscan: %', r2;
+			END LOOP;
+		END IF;
+
+		-- make sure we found expected number of matches
+		IF count != r.matches THEN RAISE WARNING 'unexpected number of results % for %', count, r; END IF;
+	END LOOP;
+END;
+$x$;
+
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+-- summarize ranges again, merging the new values into the existing intervals
+INSERT INTO brintest_multi (int4col, numericcol, uuidcol)
+	SELECT -i, -i, format('%s-0000-0000-0000-000000000000', to_char(200000 + i, 'FM00000000'))::uuid
+	FROM generate_series(1, 10) i;
+VACUUM brintest_multi;  -- force a summarization cycle in brinidx_multi
+SELECT brin_desummarize_range('brinidx_multi', 0);
+SELECT brin_summarize_range('brinidx_multi', 0);
+SET enable_seqscan = 0;
+SELECT count(*) FROM brintest_multi WHERE int4col = -5;
+SELECT count(*) FROM brintest_multi WHERE int4col BETWEEN 99 AND 101;
+SELECT count(*) FROM brintest_multi WHERE numericcol < 0;
+SELECT count(*) FROM brintest_multi WHERE uuidcol > '00200005-0000-0000-0000-000000000000';
+RESET enable_seqscan;
+
+-- invalid options
+CREATE INDEX ON brintest_multi USING brin (int4col int4_minmax_multi_ops(values_per_range = 7));
+
+DROP TABLE brintest_multi;
+DROP TABLE brinopers_multi;
@@ -191,3 +191,27 @@ INSERT INTO delete_test_table SELECT i, 1, 2, 3 FROM generate_series(1,1000) i;
 
 -- Test unsupported btree opclass parameters
 create index on btree_tall_tbl (id int4_ops(foo=1));
+
+--
+-- Test skip scans, on an index without keys on its first column
+--
+create table btree_skip (a int, b int);
+insert into btree_skip select i % 10, i from generate_series(1, 10000) i;
+insert into btree_skip select null, i from generate_series(1, 100) i;
+create index btree_skip_a_b on btree_skip (a, b);
+vacuum analyze btree_skip;
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+explain (costs off)
+select a, b from btree_skip where b between 95 and 105 order by a, b;
+select a, b from btree_skip where b between 95 and 105 order by a, b;
+select a, b from btree_skip where b between 95 and 105 order by a desc, b desc;
+select count(*) from btree_skip where b is null;
+-- many distinct values in the first column: skipping is given up on
+drop index btree_skip_a_b;
+create index btree_skip_b_a on btree_skip (b, a);
+select count(*), min(b), max(b) from btree_skip where a = 3;
+select count(*), min(b), max(b) from btree_skip where a is null;
+reset enable_seqscan;
+reset enable_bitmapscan;
+drop table btree_skip;
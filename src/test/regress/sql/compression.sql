@@ -0,0 +1,35 @@
+-- test per-column compression methods
+CREATE TABLE cmdata(f1 text COMPRESSION pglz, f2 text, f3 int);
+SELECT attname, attcompression FROM pg_attribute
+  WHERE attrelid = 'cmdata'::regclass AND attnum > 0 ORDER BY attnum;
+
+INSERT INTO cmdata VALUES (repeat('1234567890', 1000), repeat('1234567890', 1000), 1);
+INSERT INTO cmdata VALUES ('short', 'short', 2);
+SELECT f3, pg_column_compression(f1) AS f1, pg_column_compression(f2) AS f2,
+  pg_column_compression(f3) AS f3 FROM cmdata ORDER BY 1;
+SELECT length(f1), substr(f1, 5, 10) FROM cmdata WHERE f3 = 1;
+
+-- only types that can be compressed can have a method
+ALTER TABLE cmdata ALTER COLUMN f3 SET COMPRESSION pglz;
+CREATE TABLE cmdata2 (f1 int COMPRESSION pglz);
+ALTER TABLE cmdata ALTER COLUMN f1 SET COMPRESSION nonexistent;
+
+-- back to the default, and the method is kept by inheritance
+ALTER TABLE cmdata ALTER COLUMN f1 SET COMPRESSION default;
+CREATE TABLE cmparent (f1 text COMPRESSION pglz);
+CREATE TABLE cmchild () INHERITS (cmparent);
+SELECT attrelid::regclass, attname, attcompression FROM pg_attribute
+  WHERE attrelid IN ('cmdata'::regclass, 'cmchild'::regclass) AND attname = 'f1'
+  ORDER BY 1;
+ALTER TABLE cmparent ALTER COLUMN f1 SET COMPRESSION default;
+SELECT attcompression FROM pg_attribute
+  WHERE attrelid = 'cmchild'::regclass AND attname = 'f1';
+
+-- changing to a type that can't be compressed forgets the method
+ALTER TABLE cmchild NO INHERIT cmparent;
+ALTER TABLE cmchild ALTER COLUMN f1 SET COMPRESSION pglz;
+ALTER TABLE cmchild ALTER COLUMN f1 TYPE int USING length(f1);
+SELECT attcompression FROM pg_attribute
+  WHERE attrelid = 'cmchild'::regclass AND attname = 'f1';
+
+DROP TABLE cmdata, cmparent, cmchild;
@@ -440,6 +440,72 @@ test1
 SELECT * FROM instead_of_insert_tbl;
 COMMIT;
 
+-- COPY into plain btree indexes, which get their tuples in batches
+CREATE TABLE copy_btree (a int, b text);
+CREATE INDEX copy_btree_a ON copy_btree (a);
+CREATE INDEX copy_btree_b ON copy_btree (b DESC NULLS LAST, a);
+INSERT INTO copy_btree SELECT g % 500, 'x' || g FROM generate_series(1, 2000) g;
+COPY copy_btree FROM stdin;
+250	y1
+7	\N
+\N	y2
+499	y3
+250	y4
+0	x1
+\N	\N
+1000	y5
+\.
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*) FROM copy_btree WHERE a = 250;
+SELECT count(*) FROM copy_btree WHERE a IS NULL;
+SELECT count(*) FROM copy_btree WHERE b IS NULL;
+SELECT array_agg(a) = '{1000,250,499,NULL,250}' AS ok
+  FROM (SELECT a FROM copy_btree WHERE b >= 'y' ORDER BY b DESC) s;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE copy_btree;
+
+-- COPY FROM with parallel workers
+CREATE TABLE copy_parallel (a int PRIMARY KEY, b text CHECK (b <> ''), c int DEFAULT 42);
+COPY copy_parallel (a, b) FROM stdin WITH (FORMAT csv, HEADER, PARALLEL 2);
+a,b
+1,one
+2,"two
+lines"
+3,"three, with a comma"
+4,
+\.
+COPY copy_parallel FROM stdin WITH (PARALLEL 2) WHERE a % 2 = 0;
+5	five	5
+6	six	6
+7	seven	7
+8	\N	\N
+\.
+SELECT a, length(b), c FROM copy_parallel ORDER BY a;
+-- a nextval() default isn't parallel safe, so this is done serially
+CREATE TABLE copy_parallel_serial (id serial, v text);
+COPY copy_parallel_serial (v) FROM stdin WITH (PARALLEL 4);
+x
+y
+\.
+SELECT * FROM copy_parallel_serial ORDER BY id;
+COPY copy_parallel_serial TO stdout WITH (FORMAT csv, HEADER, FORCE_QUOTE (v), PARALLEL 2);
+COPY copy_parallel FROM stdin WITH (FORMAT binary, PARALLEL 2);
+COPY copy_parallel FROM stdin WITH (PARALLEL 0);
+DROP TABLE copy_parallel, copy_parallel_serial;
+
+-- long fields, so that the vectorized scanning finds specials mid-vector
+CREATE TEMP TABLE copy_long (a text, b text);
+COPY copy_long FROM stdin;
+abcdefghijklmnopqrstuvwxyz0123456789\x41\\xyz	0123456789abcdefghijklmnopqrstuvwxyz
+\.
+COPY copy_long FROM stdin CSV;
+"abcdefghijklmnopqrstuvwxyz ""quoted"" 0123456789","abcdefghijklmnopqrstuvwxyz,0123456789"
+\.
+SELECT * FROM copy_long;
+DROP TABLE copy_long;
+
 -- clean up
 DROP TABLE forcetest;
 DROP TABLE vistest;
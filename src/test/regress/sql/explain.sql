@@ -56,6 +56,9 @@ $$;
 select explain_filter('explain select * from int8_tbl i8');
 select explain_filter('explain (analyze) select * from int8_tbl i8');
 select explain_filter('explain (analyze, verbose) select * from int8_tbl i8');
+select explain_filter('explain (analyze, timing_sample 2) select * from int8_tbl i8');
+explain (analyze, timing off, timing_sample 2) select * from int8_tbl i8;
+explain (analyze, timing_sample 0) select 1;
 select explain_filter('explain (analyze, buffers, format text) select * from int8_tbl i8');
 select explain_filter('explain (analyze, buffers, format json) select * from int8_tbl i8');
 select explain_filter('explain (analyze, buffers, format xml) select * from int8_tbl i8');
@@ -105,3 +108,9 @@ select jsonb_pretty(
 );
 
 rollback;
+
+-- Plan of a running query, with the row counts so far
+set track_plan_progress = on;
+select explain_filter('select regexp_split_to_table(pg_get_backend_query_plan(pg_backend_pid()), e''\n'')');
+reset track_plan_progress;
+select pg_get_backend_query_plan(0);
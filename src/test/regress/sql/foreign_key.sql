@@ -1738,3 +1738,15 @@ DELETE FROM fkpart9.pk WHERE a=35;
 SELECT * FROM fkpart9.pk;
 SELECT * FROM fkpart9.fk;
 DROP SCHEMA fkpart9 CASCADE;
+
+-- FK checks that look up the PK index directly: key columns listed in
+-- another order than the index's, and cross-type comparisons
+CREATE TABLE fkprobe_pk (a int, b text, c int8, PRIMARY KEY (c, a, b));
+CREATE TABLE fkprobe_fk (x varchar, y int2, z int4,
+  FOREIGN KEY (y, x, z) REFERENCES fkprobe_pk (a, b, c));
+INSERT INTO fkprobe_pk VALUES (1, 'one', 10), (2, 'two', 20);
+INSERT INTO fkprobe_fk VALUES ('one', 1, 10), ('two', 2, 20), (NULL, 3, 30);
+INSERT INTO fkprobe_fk VALUES ('one', 1, 20);
+UPDATE fkprobe_fk SET x = 'three' WHERE y = 2;
+UPDATE fkprobe_pk SET a = 3 WHERE a = 2;
+DROP TABLE fkprobe_fk, fkprobe_pk;
@@ -163,3 +163,21 @@ reset enable_seqscan;
 reset enable_bitmapscan;
 
 drop table t_gin_test_tbl;
+
+-- Test parallel build
+create table gin_par_tbl(i int4[]) with (parallel_workers = 2);
+insert into gin_par_tbl
+  select array[1, g % 100, g] from generate_series(1, 20000) g;
+set max_parallel_maintenance_workers = 2;
+set maintenance_work_mem = '128MB';
+create index gin_par_idx on gin_par_tbl using gin (i);
+reset max_parallel_maintenance_workers;
+reset maintenance_work_mem;
+
+set enable_seqscan = off;
+select count(*) from gin_par_tbl where i @> array[1];
+select count(*) from gin_par_tbl where i @> array[42];
+select count(*) from gin_par_tbl where i @> array[19999];
+reset enable_seqscan;
+
+drop table gin_par_tbl;
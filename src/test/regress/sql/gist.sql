@@ -142,6 +142,19 @@ and p <@ box(point(5,5), point(6, 6));
 
 drop index gist_tbl_multi_index;
 
+-- Test sorted build, and compare with buffering build
+create index gist_tbl_point_index on gist_tbl using gist (p);
+create index gist_tbl_box_index on gist_tbl using gist (b);
+select count(*) from gist_tbl where p <@ box(point(1,1), point(100,100));
+select count(*) from gist_tbl where b <@ box(point(10,10), point(20,20));
+drop index gist_tbl_point_index, gist_tbl_box_index;
+
+create index gist_tbl_point_index on gist_tbl using gist (p) with (buffering = on);
+create index gist_tbl_box_index on gist_tbl using gist (b) with (buffering = on);
+select count(*) from gist_tbl where p <@ box(point(1,1), point(100,100));
+select count(*) from gist_tbl where b <@ box(point(10,10), point(20,20));
+drop index gist_tbl_point_index, gist_tbl_box_index;
+
 -- Clean up
 reset enable_seqscan;
 reset enable_bitmapscan;
@@ -202,3 +202,65 @@ CREATE INDEX hash_f8_index2 ON hash_f8_heap USING hash (random float8_ops)
 	WITH (fillfactor=9);
 CREATE INDEX hash_f8_index2 ON hash_f8_heap USING hash (random float8_ops)
 	WITH (fillfactor=101);
+
+-- Multicolumn index.  Only the first column's hash picks the bucket, so it
+-- must be constrained; the other columns' hashes are checked in the index.
+CREATE TABLE hash_multi_heap (a int, b text, c int);
+INSERT INTO hash_multi_heap
+	SELECT i % 100, 'b' || (i % 7), i FROM generate_series(1, 1000) i;
+INSERT INTO hash_multi_heap VALUES (42, NULL, 0), (NULL, 'b3', 0);
+CREATE INDEX hash_multi_index ON hash_multi_heap USING hash (a, b);
+SET enable_seqscan = OFF;
+SET enable_bitmapscan = OFF;
+EXPLAIN (COSTS OFF)
+SELECT c FROM hash_multi_heap WHERE a = 42 AND b = 'b3';
+SELECT c FROM hash_multi_heap WHERE a = 42 AND b = 'b3';
+SELECT count(*) FROM hash_multi_heap WHERE a = 42;
+EXPLAIN (COSTS OFF)
+SELECT count(*) FROM hash_multi_heap WHERE b = 'b3';
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE hash_multi_heap;
+
+-- Unique indexes and constraints.
+CREATE TABLE hash_unique_heap (id int, name text);
+INSERT INTO hash_unique_heap SELECT i, 'name ' || i FROM generate_series(1, 100) i;
+ALTER TABLE hash_unique_heap ADD PRIMARY KEY USING hash (id);
+SELECT pg_get_constraintdef(oid) FROM pg_constraint
+	WHERE conrelid = 'hash_unique_heap'::regclass;
+INSERT INTO hash_unique_heap VALUES (42, 'duplicate');
+INSERT INTO hash_unique_heap VALUES (NULL, 'null');
+DELETE FROM hash_unique_heap WHERE id = 42;
+INSERT INTO hash_unique_heap VALUES (42, 'again');
+INSERT INTO hash_unique_heap VALUES (42, 'conflict')
+	ON CONFLICT (id) DO UPDATE SET name = excluded.name;
+INSERT INTO hash_unique_heap VALUES (43, 'ignored') ON CONFLICT DO NOTHING;
+SELECT * FROM hash_unique_heap WHERE id IN (42, 43) ORDER BY id;
+UPDATE hash_unique_heap SET id = id + 1000;
+SELECT count(*), min(id), max(id) FROM hash_unique_heap;
+
+-- A hash unique index can back a foreign key.
+CREATE TABLE hash_fk_heap (ref int REFERENCES hash_unique_heap);
+INSERT INTO hash_fk_heap VALUES (1001);
+INSERT INTO hash_fk_heap VALUES (1);
+DROP TABLE hash_fk_heap;
+
+-- Multicolumn unique index; rows with a null in either column never conflict.
+CREATE TABLE hash_unique2_heap (a int, b text);
+INSERT INTO hash_unique2_heap VALUES (1, 'x'), (1, 'y'), (2, 'x'), (1, NULL), (1, NULL);
+CREATE UNIQUE INDEX hash_unique2_index ON hash_unique2_heap USING hash (a, b);
+INSERT INTO hash_unique2_heap VALUES (2, 'y'), (NULL, 'x'), (NULL, 'x'), (2, NULL);
+INSERT INTO hash_unique2_heap VALUES (2, 'x');
+INSERT INTO hash_unique2_heap VALUES (1, 'x');
+DROP INDEX hash_unique2_index;
+CREATE UNIQUE INDEX hash_unique2_index ON hash_unique2_heap USING hash (a, b);
+DROP TABLE hash_unique2_heap;
+
+DROP TABLE hash_unique_heap;
+
+-- Building a unique index over duplicate values fails.
+CREATE TABLE hash_unique_dup_heap (id int);
+INSERT INTO hash_unique_dup_heap VALUES (1), (2), (3), (11);
+CREATE UNIQUE INDEX hash_unique_dup_index ON hash_unique_dup_heap
+	USING hash ((id % 10));
+DROP TABLE hash_unique_dup_heap;
@@ -0,0 +1,66 @@
+-- Perform tests on the bloom filters hash joins push down into their
+-- outer seq scans.
+
+-- The memory usage of the Hash node can vary between machines.  Let's just
+-- replace the number with an 'N'.
+create function explain_bloom(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, summary off, timing off) %s',
+            query)
+    loop
+        ln := regexp_replace(ln, 'Memory Usage: \d+', 'Memory Usage: N');
+        return next ln;
+    end loop;
+end;
+$$;
+
+CREATE TABLE bloom_outer (a int, b int);
+INSERT INTO bloom_outer SELECT i, i % 10 FROM generate_series(1, 20000) i;
+INSERT INTO bloom_outer VALUES (NULL, 0);
+CREATE TABLE bloom_inner (a int);
+INSERT INTO bloom_inner SELECT i * 5 FROM generate_series(1, 2000) i;
+CREATE TABLE bloom_tiny (a int);
+INSERT INTO bloom_tiny SELECT i * 10 FROM generate_series(1, 100) i;
+ANALYZE bloom_outer;
+ANALYZE bloom_inner;
+ANALYZE bloom_tiny;
+
+SET max_parallel_workers_per_gather TO 0;
+
+-- Only the outer rows with a join partner should reach the join.
+SELECT explain_bloom('
+SELECT count(*) FROM bloom_outer o JOIN bloom_inner i ON o.a = i.a;');
+
+SELECT count(*) FROM bloom_outer o JOIN bloom_inner i ON o.a = i.a;
+
+-- The filter is checked before the scan's own quals, which only see the
+-- rows it lets through.
+SELECT explain_bloom('
+SELECT count(*) FROM bloom_outer o JOIN bloom_inner i ON o.a = i.a
+WHERE o.b = 0;');
+
+-- Semi joins can use the filter, as well.
+SELECT count(*) FROM bloom_outer o
+WHERE o.a IN (SELECT a FROM bloom_inner);
+
+-- No filter for an inner side this small.
+SELECT explain_bloom('
+SELECT count(*) FROM bloom_outer o JOIN bloom_tiny t ON o.a = t.a;');
+
+-- Check that no filter is pushed down when disabled.
+SET enable_hashjoin_bloom_filter TO off;
+SELECT explain_bloom('
+SELECT count(*) FROM bloom_outer o JOIN bloom_inner i ON o.a = i.a;');
+
+RESET enable_hashjoin_bloom_filter;
+RESET max_parallel_workers_per_gather;
+
+DROP TABLE bloom_outer;
+DROP TABLE bloom_inner;
+DROP TABLE bloom_tiny;
+DROP FUNCTION explain_bloom(text);
@@ -604,3 +604,23 @@ alter table returningwrtest2 drop c;
 alter table returningwrtest attach partition returningwrtest2 for values in (2);
 insert into returningwrtest values (2, 'foo') returning returningwrtest;
 drop table returningwrtest;
+
+-- check routing of runs of rows that go to the same partition
+create table rp_cache (a int) partition by range (a);
+create table rp_cache_1 partition of rp_cache for values from (1) to (100);
+create table rp_cache_2 partition of rp_cache for values from (100) to (200);
+create table rp_cache_3 partition of rp_cache for values from (300) to (400);
+create table rp_cache_def partition of rp_cache default;
+insert into rp_cache select i from generate_series(1, 399) i;
+insert into rp_cache select 150 from generate_series(1, 20);
+insert into rp_cache values (0), (99), (100), (299), (300);
+select tableoid::regclass, count(*), min(a), max(a) from rp_cache group by 1 order by 1;
+drop table rp_cache;
+create table lp_cache (a text) partition by list (a);
+create table lp_cache_ab partition of lp_cache for values in ('a', 'b');
+create table lp_cache_null partition of lp_cache for values in (null);
+create table lp_cache_def partition of lp_cache default;
+insert into lp_cache select 'a' from generate_series(1, 20);
+insert into lp_cache values ('b'), (null), ('c'), ('a');
+select tableoid::regclass, count(*) from lp_cache group by 1 order by 1;
+drop table lp_cache;
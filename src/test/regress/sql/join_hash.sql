@@ -233,10 +233,12 @@ $$);
 rollback to settings;
 
 -- The "ugly" case: increasing the number of batches during execution
--- doesn't help, so stop trying to fit in work_mem and hope for the
--- best; in this case we plan for 1 batch, increases just once and
--- then stop increasing because that didn't help at all, so we blow
--- right through the work_mem budget and hope for the best...
+-- doesn't help, because the tuples all have the same hash value.  A
+-- parallel-oblivious hash join notices that, sticks to 1 batch and
+-- processes it in work_mem-sized fragments instead; Parallel Hash
+-- increases nbatch just once and then stops increasing because that
+-- didn't help at all, so it blows right through the work_mem budget
+-- and hopes for the best...
 
 -- non-parallel
 savepoint settings;
@@ -249,6 +251,13 @@ select * from hash_join_batches(
 $$
   select count(*) from simple r join extremely_skewed s using (id);
 $$);
+-- outer tuples are read once per fragment, but must be joined once
+select count(*) from simple r left join extremely_skewed s using (id);
+select count(*) from simple r full join extremely_skewed s using (id);
+select count(*) from simple r
+  where exists (select 1 from extremely_skewed s where s.id = r.id);
+select count(*) from simple r
+  where not exists (select 1 from extremely_skewed s where s.id = r.id);
 rollback to settings;
 
 -- parallel with parallel-oblivious hash join
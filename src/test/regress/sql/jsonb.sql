@@ -1280,3 +1280,22 @@ select '12345.0000000000000000000000000000000000000000000005'::jsonb::float8;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int2;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int4;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int8;
+
+-- key lookups in compressed or toasted values only fetch what they need
+CREATE TABLE test_jsonb_toast (id int, j jsonb, k jsonb);
+ALTER TABLE test_jsonb_toast ALTER COLUMN k SET STORAGE external;
+INSERT INTO test_jsonb_toast SELECT 1, o, o FROM
+  (SELECT jsonb_build_object('a', 1, 'bb', repeat('x', 10000),
+                             'ccc', jsonb_build_object('d', repeat('y', 5000)),
+                             'dddd', 'last') AS o) s;
+INSERT INTO test_jsonb_toast SELECT 2, o, o FROM
+  (SELECT jsonb_build_array('a', repeat('x', 10000)) AS o) s;
+SELECT id, j -> 'a' AS a, length(j ->> 'bb') AS bb,
+  length(j -> 'ccc' ->> 'd') AS d, j ->> 'dddd' AS dddd, j -> 'e' AS e,
+  j ? 'ccc' AS has_ccc, j ? 'a' AS has_a
+  FROM test_jsonb_toast ORDER BY id;
+SELECT id, k -> 'a' AS a, length(k ->> 'bb') AS bb,
+  length(k -> 'ccc' ->> 'd') AS d, k ->> 'dddd' AS dddd, k -> 'e' AS e,
+  k ? 'ccc' AS has_ccc, k ? 'a' AS has_a
+  FROM test_jsonb_toast ORDER BY id;
+DROP TABLE test_jsonb_toast;
@@ -236,3 +236,47 @@ SELECT mvtest_func();
 SELECT * FROM mvtest1;
 SELECT * FROM mvtest2;
 ROLLBACK;
+
+-- incremental maintenance
+CREATE TABLE mvtest_ivm_s (sid int, name text);
+CREATE TABLE mvtest_ivm_o (id int, sid int, amt int);
+INSERT INTO mvtest_ivm_s VALUES (1, 'a'), (2, 'b'), (3, NULL);
+INSERT INTO mvtest_ivm_o VALUES (1, 1, 10), (2, 1, 10), (3, 2, 20), (4, 3, 30);
+CREATE MATERIALIZED VIEW mvtest_ivm_join WITH (incremental = true) AS
+  SELECT s.name, o.amt FROM mvtest_ivm_s s JOIN mvtest_ivm_o o ON s.sid = o.sid;
+CREATE MATERIALIZED VIEW mvtest_ivm_agg WITH (incremental = true) AS
+  SELECT s.name, count(*) AS n, sum(o.amt) AS total
+    FROM mvtest_ivm_s s, mvtest_ivm_o o WHERE s.sid = o.sid
+    GROUP BY s.name HAVING sum(o.amt) < 100;
+CREATE MATERIALIZED VIEW mvtest_ivm_total WITH (incremental = true) AS
+  SELECT count(*) AS n, sum(amt) AS total FROM mvtest_ivm_o;
+CREATE MATERIALIZED VIEW mvtest_ivm_nodata WITH (incremental = true) AS
+  SELECT sid, amt FROM mvtest_ivm_o WHERE amt > 50 WITH NO DATA;
+INSERT INTO mvtest_ivm_o VALUES (5, 2, 25), (6, 3, 30), (7, 4, 40);
+DELETE FROM mvtest_ivm_o WHERE id = 1;
+UPDATE mvtest_ivm_o SET amt = amt + 50 WHERE sid = 3;
+UPDATE mvtest_ivm_s SET name = 'c' WHERE sid = 2;
+INSERT INTO mvtest_ivm_s VALUES (4, 'a');
+REFRESH MATERIALIZED VIEW mvtest_ivm_nodata;
+UPDATE mvtest_ivm_o SET amt = 60 WHERE id = 7;
+SELECT * FROM mvtest_ivm_join ORDER BY name, amt;
+SELECT * FROM mvtest_ivm_agg ORDER BY name;
+SELECT * FROM mvtest_ivm_total;
+SELECT * FROM mvtest_ivm_nodata ORDER BY sid, amt;
+TRUNCATE mvtest_ivm_o;
+SELECT count(*) FROM mvtest_ivm_join;
+SELECT * FROM mvtest_ivm_total;
+-- unsupported queries
+CREATE MATERIALIZED VIEW mvtest_ivm_bad WITH (incremental = true) AS
+  SELECT s.name FROM mvtest_ivm_s s LEFT JOIN mvtest_ivm_o o ON s.sid = o.sid;
+CREATE MATERIALIZED VIEW mvtest_ivm_bad WITH (incremental = true) AS
+  SELECT a.amt FROM mvtest_ivm_o a, mvtest_ivm_o b WHERE a.id = b.id;
+CREATE MATERIALIZED VIEW mvtest_ivm_bad WITH (incremental = true) AS
+  SELECT sid, random() FROM mvtest_ivm_o;
+CREATE TABLE mvtest_ivm_bad WITH (incremental = true) AS SELECT 1 AS x;
+ALTER MATERIALIZED VIEW mvtest_ivm_join SET (incremental = false);
+-- the triggers go away with the matviews
+DROP MATERIALIZED VIEW mvtest_ivm_join, mvtest_ivm_agg, mvtest_ivm_total,
+  mvtest_ivm_nodata;
+INSERT INTO mvtest_ivm_o VALUES (8, 1, 5);
+DROP TABLE mvtest_ivm_s, mvtest_ivm_o;
@@ -504,6 +504,7 @@ create index ab_a3_b3_a_idx on ab_a3_b3 (a);
 
 set enable_hashjoin = 0;
 set enable_mergejoin = 0;
+set enable_resultcache = 0;
 
 select explain_parallel_append('select avg(ab.a) from ab inner join lprt_a a on ab.a = a.a where a.a in(0, 0, 1)');
 
@@ -522,6 +523,7 @@ select explain_parallel_append('select avg(ab.a) from ab inner join lprt_a a on
 
 reset enable_hashjoin;
 reset enable_mergejoin;
+reset enable_resultcache;
 reset parallel_setup_cost;
 reset parallel_tuple_cost;
 reset min_parallel_table_scan_size;
@@ -1126,3 +1128,24 @@ explain (costs off) select * from hp_contradict_test where a === 1 and b === 1 a
 drop table hp_contradict_test;
 drop operator class part_test_int4_ops2 using hash;
 drop operator ===(int4, int4);
+
+--
+-- Check that the plan cache performs initial pruning of a generic plan
+-- before locking its partitions, and doesn't lock the pruned ones
+--
+create table lockprune (a int) partition by list (a);
+create table lockprune1 partition of lockprune for values in (1);
+create table lockprune2 partition of lockprune for values in (2);
+set plan_cache_mode = force_generic_plan;
+prepare lockprune_q (int) as select * from lockprune where a = $1;
+execute lockprune_q (1);
+begin;
+execute lockprune_q (1);
+select relation::regclass, mode from pg_locks
+  where locktype = 'relation' and pid = pg_backend_pid() and
+    relation::regclass::text like 'lockprune%'
+  order by relation::regclass::text;
+commit;
+deallocate lockprune_q;
+reset plan_cache_mode;
+drop table lockprune;
@@ -1207,3 +1207,14 @@ drop role regress_partitioning_role;
 \dAo * pg_catalog.jsonb_path_ops
 \dAp+ btree float_ops
 \dAp * pg_catalog.uuid_ops
+
+-- pipeline mode
+\startpipeline
+SELECT 1 AS one;
+SELECT 1/0;
+SELECT 2 AS two;
+\endpipeline
+\endpipeline
+\startpipeline
+SELECT 3 AS three \gset
+\endpipeline
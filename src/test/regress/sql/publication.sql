@@ -93,6 +93,41 @@ ALTER PUBLICATION testpub_forparted SET (publish_via_partition_root = true);
 DROP TABLE testpub_parted1;
 DROP PUBLICATION testpub_forparted, testpub_forparted1;
 
+-- row filters and column lists
+CREATE TABLE testpub_rf_tbl1 (a int PRIMARY KEY, b text, c text);
+CREATE TABLE testpub_rf_tbl2 (x int, y int);
+CREATE FUNCTION testpub_rf_func(int) RETURNS bool IMMUTABLE
+    LANGUAGE sql AS 'SELECT $1 > 0';
+SET client_min_messages = 'ERROR';
+CREATE PUBLICATION testpub_rf FOR TABLE testpub_rf_tbl1 (a, b) WHERE (a > 10), testpub_rf_tbl2 WHERE (y < 5) WITH (publish = insert);
+RESET client_min_messages;
+\dRp+ testpub_rf
+-- fail - not a simple expression
+ALTER PUBLICATION testpub_rf ADD TABLE testpub_tbl1 WHERE (id < random());
+ALTER PUBLICATION testpub_rf ADD TABLE testpub_tbl1 WHERE (id IN (SELECT 1));
+ALTER PUBLICATION testpub_rf ADD TABLE testpub_tbl1 WHERE (sum(id) > 1);
+ALTER PUBLICATION testpub_rf ADD TABLE testpub_tbl1 WHERE (testpub_rf_func(id));
+-- fail - bad column lists
+ALTER PUBLICATION testpub_rf ADD TABLE testpub_tbl1 (id, foo);
+ALTER PUBLICATION testpub_rf ADD TABLE testpub_tbl1 (id, id);
+-- fail - testpub_default publishes updates and deletes, so the replica
+-- identity must be published and is all the row filter may use
+ALTER PUBLICATION testpub_default ADD TABLE testpub_rf_tbl1 (b, c);
+ALTER PUBLICATION testpub_default ADD TABLE testpub_rf_tbl1 WHERE (b = 'x');
+ALTER PUBLICATION testpub_default ADD TABLE testpub_rf_tbl1 (a, c) WHERE (a > 0);
+ALTER PUBLICATION testpub_default DROP TABLE testpub_rf_tbl1;
+-- fail - nothing to filter when dropping
+ALTER PUBLICATION testpub_rf DROP TABLE testpub_rf_tbl2 WHERE (y < 5);
+-- fail - the publication depends on the column
+ALTER TABLE testpub_rf_tbl2 DROP COLUMN y;
+ALTER TABLE testpub_rf_tbl2 ALTER COLUMN y TYPE bigint;
+-- replaces the column list and row filters
+ALTER PUBLICATION testpub_rf SET TABLE testpub_rf_tbl1, testpub_rf_tbl2 WHERE (x > 0);
+\dRp+ testpub_rf
+DROP PUBLICATION testpub_rf;
+DROP TABLE testpub_rf_tbl1, testpub_rf_tbl2;
+DROP FUNCTION testpub_rf_func(int);
+
 -- fail - view
 CREATE PUBLICATION testpub_fortbl FOR TABLE testpub_view;
 SET client_min_messages = 'ERROR';
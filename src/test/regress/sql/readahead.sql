@@ -0,0 +1,72 @@
+--
+-- Test prefetching ahead of sequential scans and VACUUM
+--
+
+-- Read ahead as far as possible, if the platform allows prefetching; the
+-- results must be the same either way
+DO $$
+BEGIN
+  SET effective_io_concurrency = 64;
+  SET maintenance_io_concurrency = 64;
+EXCEPTION WHEN invalid_parameter_value THEN
+END $$;
+
+-- A temporary table much larger than temp_buffers is read back from the
+-- kernel, so that prefetches do initiate I/O and the distance grows
+SET temp_buffers = 100;
+SET max_parallel_workers_per_gather = 0;
+
+CREATE TABLE ra_t (a int, b text) WITH (autovacuum_enabled = off);
+INSERT INTO ra_t SELECT g, md5(g::text) FROM generate_series(1, 20000) g;
+CREATE TEMP TABLE ra_temp (a int, b text);
+INSERT INTO ra_temp SELECT g, md5(g::text) FROM generate_series(1, 50000) g;
+
+SELECT count(*), sum(a), count(DISTINCT b) FROM ra_t;
+SELECT count(*), sum(a), count(DISTINCT b) FROM ra_temp;
+
+-- Scans that stop early, and rescans
+SELECT a FROM ra_t WHERE a % 5000 = 0 LIMIT 2;
+SELECT x, (SELECT a FROM ra_temp WHERE a >= x * 10000 LIMIT 1)
+FROM generate_series(1, 5) x;
+
+-- Changing direction
+BEGIN;
+DECLARE c SCROLL CURSOR FOR SELECT a FROM ra_temp;
+FETCH 2 FROM c;
+MOVE FORWARD 30000 IN c;
+FETCH BACKWARD 2 FROM c;
+MOVE BACKWARD 20000 IN c;
+FETCH FORWARD 2 FROM c;
+FETCH LAST FROM c;
+FETCH BACKWARD 2 FROM c;
+COMMIT;
+
+-- VACUUM predicts the pages that the visibility map doesn't let it skip
+DELETE FROM ra_t WHERE a % 10 = 0;
+VACUUM ra_t;
+UPDATE ra_t SET b = upper(b) WHERE a % 1000 = 1;
+DELETE FROM ra_t WHERE a BETWEEN 5000 AND 5999;
+VACUUM ra_t;
+SELECT count(*), sum(a), count(*) FILTER (WHERE b = upper(b)) FROM ra_t;
+VACUUM (DISABLE_PAGE_SKIPPING) ra_t;
+SELECT count(*), sum(a) FROM ra_t;
+
+DELETE FROM ra_temp WHERE a % 3 = 0;
+VACUUM ra_temp;
+SELECT count(*), sum(a) FROM ra_temp;
+
+-- New rows go into the space freed up, and all are seen
+INSERT INTO ra_t SELECT g, md5(g::text) FROM generate_series(5000, 5999) g;
+SELECT count(*), sum(a) FROM ra_t;
+
+-- Without read-ahead, the results are the same
+SET effective_io_concurrency = 0;
+SET maintenance_io_concurrency = 0;
+SELECT count(*), sum(a) FROM ra_t;
+SELECT count(*), sum(a) FROM ra_temp;
+VACUUM ra_temp;
+
+RESET effective_io_concurrency;
+RESET maintenance_io_concurrency;
+RESET max_parallel_workers_per_gather;
+DROP TABLE ra_t, ra_temp;
@@ -262,3 +262,20 @@ create table list_parted_tbl1 partition of list_parted_tbl
   for values in (1) partition by list(b);
 explain (costs off) select * from list_parted_tbl;
 drop table list_parted_tbl;
+
+-- Scans that filter and project have their qual built into the projection
+-- when expressions are to be JIT compiled; check both ways give the same.
+create temp table qualproj (a int, b text);
+insert into qualproj
+  select g, case when g % 4 = 0 then null else 'r' || g end
+  from generate_series(1, 10) g;
+set jit = on;
+set jit_above_cost = 0;
+select a * 10 as a10, upper(b) as ub from qualproj where a % 2 = 0 and b > 'r1';
+select * from qualproj where b is null;
+set jit_fuse_scans = off;
+select a * 10 as a10, upper(b) as ub from qualproj where a % 2 = 0 and b > 'r1';
+reset jit_fuse_scans;
+reset jit_above_cost;
+reset jit;
+drop table qualproj;
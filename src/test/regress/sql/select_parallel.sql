@@ -94,6 +94,63 @@ select length(stringu1) from tenk1 group by length(stringu1);
 explain (costs off)
 	select stringu1, count(*) from tenk1 group by stringu1 order by stringu1;
 
+-- test finalizing hashed aggregation in the workers; with free tuple
+-- transfer, gathering the partial groups always looks cheaper
+set enable_parallel_hashagg = on;
+set parallel_tuple_cost = 0.1;
+explain (costs off)
+	select stringu1, count(*) from tenk1 group by stringu1;
+select count(*), sum(c) from
+  (select stringu1, count(*) c from tenk1 group by stringu1) ss;
+set parallel_tuple_cost = 0;
+reset enable_parallel_hashagg;
+
+-- test merging the sorted runs of all participants in one of them
+set enable_parallel_sort = on;
+set enable_gathermerge = off;
+explain (costs off)
+	select unique1 from tenk1 order by ten desc, unique1;
+select md5(string_agg(unique1::text, ',')) from
+  (select unique1 from tenk1 order by ten desc, unique1) ss;
+reset enable_gathermerge;
+reset enable_parallel_sort;
+
+-- test sharing the inner side of parallel nested loop and merge joins
+set enable_parallel_material = on;
+set enable_hashjoin = off;
+set enable_mergejoin = off;
+select count(*) from tenk1 a join tenk2 b on a.hundred = b.hundred
+  where a.unique1 < 1000 and b.unique1 < 1000;
+reset enable_mergejoin;
+set enable_nestloop = off;
+set enable_parallel_sort = on;
+select count(*) from tenk1 a join tenk2 b on a.hundred = b.hundred
+  where a.unique1 < 1000 and b.unique1 < 1000;
+reset enable_parallel_sort;
+reset enable_nestloop;
+reset enable_hashjoin;
+reset enable_parallel_material;
+
+-- test computing window functions in the workers, by partition
+set enable_parallel_window = on;
+select sum(rn), sum(s) from
+  (select row_number() over (partition by ten order by unique1) rn,
+          sum(unique1) over (partition by ten) s
+   from tenk1) ss;
+reset enable_parallel_window;
+
+-- test aggregating whole groups in the workers, when the aggregation can't
+-- be split into partial and final steps
+set enable_parallel_nonpartial_agg = on;
+select count(*), sum(c), sum(p) from
+  (select ten, count(distinct hundred) c,
+          percentile_disc(0.5) within group (order by unique1) p
+   from tenk1 group by ten) ss;
+select count(*), sum(s) from
+  (select ten, four, sum(unique1) s from tenk1
+   group by ten, rollup (four)) ss;
+reset enable_parallel_nonpartial_agg;
+
 -- test that parallel plan for aggregates is not selected when
 -- target list contains parallel restricted clause.
 explain (costs off)
@@ -453,3 +510,41 @@ SELECT 1 FROM tenk1_vw_sec
   WHERE (SELECT sum(f1) FROM int4_tbl WHERE f1 < unique1) < 100;
 
 rollback;
+
+-- parallel INSERT ... SELECT; the target must not be new in the transaction
+create table parallel_insert_tbl (unique1 int primary key, ten int);
+begin isolation level repeatable read;
+set local parallel_setup_cost=0;
+set local parallel_tuple_cost=0;
+set local min_parallel_table_scan_size=0;
+set local max_parallel_workers_per_gather=4;
+set local enable_parallel_insert=on;
+explain (costs off)
+  insert into parallel_insert_tbl select unique1, ten from tenk1;
+insert into parallel_insert_tbl select unique1, ten from tenk1;
+select count(*), sum(ten) from parallel_insert_tbl;
+-- not if the workers would have to check a parallel restricted constraint
+alter table parallel_insert_tbl add check (sp_parallel_restricted(ten) < 10);
+explain (costs off)
+  insert into parallel_insert_tbl select unique1, ten from tenk1;
+rollback;
+drop table parallel_insert_tbl;
+
+-- parallel scans of temporary tables
+create temp table parallel_temp_tbl as select unique1, ten from tenk1;
+begin;
+set local parallel_setup_cost=0;
+set local parallel_tuple_cost=0;
+set local min_parallel_table_scan_size=0;
+set local max_parallel_workers_per_gather=4;
+explain (costs off)
+  select count(*) from parallel_temp_tbl;
+set local enable_parallel_temp_scan=on;
+explain (costs off)
+  select count(*) from parallel_temp_tbl;
+select count(*), sum(ten) from parallel_temp_tbl;
+-- the workers must see changes that were still in the leader's buffers
+update parallel_temp_tbl set ten = ten + 1 where unique1 < 100;
+select count(*), sum(ten) from parallel_temp_tbl;
+rollback;
+drop table parallel_temp_tbl;
@@ -17,6 +17,10 @@ select count(*) >= 0 as ok from pg_available_extensions;
 select name, ident, parent, level, total_bytes >= free_bytes
   from pg_backend_memory_contexts where level = 0;
 
+-- Our own memory contexts must be accounted for in pg_stat_activity
+select allocated_bytes > 0 as ok from pg_stat_activity
+  where pid = pg_backend_pid();
+
 -- At introduction, pg_config had 23 entries; it may grow
 select count(*) > 20 as ok from pg_config;
 
@@ -37,6 +41,67 @@ select count(*) = 0 as ok from pg_prepared_statements;
 -- See also prepared_xacts.sql
 select count(*) >= 0 as ok from pg_prepared_xacts;
 
+-- There is one row per buffer access strategy
+select count(*) = 4 as ok from pg_stat_buffer_strategies;
+
+-- Our own catalog reads have surely been counted by now
+select count(*) > 0 as ok from pg_stat_buffer_relations
+  where datid = (select oid from pg_database where datname = current_database());
+
+-- There is always exactly one row
+select count(*) = 1 as ok from pg_stat_prefetch_recovery;
+
+-- Committing a transaction flushes WAL, and the histograms have 16 buckets
+select flushes > 0 as ok,
+       cardinality(group_size_histogram) = 16 as ok,
+       cardinality(flush_time_histogram) = 16 as ok
+  from pg_stat_group_commit;
+
+-- Waits are timed with track_wait_timing on, and counted in the histogram
+set track_wait_timing = on;
+select pg_sleep(0.01);
+reset track_wait_timing;
+select calls >= 1 as ok, total_time >= 10 as ok,
+       cardinality(histogram) = 24 as ok,
+       (select sum(h) from unnest(histogram) h) = calls as ok
+  from pg_stat_wait_events
+  where pid = pg_backend_pid() and wait_event = 'PgSleep';
+
+-- There is one row per backend type, object and context, and client backends
+-- have done some I/O by now
+select count(*) = 4 as ok, sum(hits) > 0 as ok, bool_and(op_bytes = 8192) as ok
+  from pg_stat_io
+  where backend_type = 'client backend' and object = 'relation';
+select pg_stat_reset_shared('io');
+select stats_reset > now() - interval '1 minute' as ok
+  from pg_stat_io limit 1;
+
+-- ProcArrayLock is taken for every snapshot, and unused lock numbers are
+-- left out
+select acquires > 0 as ok
+  from pg_stat_lwlocks where name = 'ProcArray';
+select count(*) as unassigned from pg_stat_lwlocks where name like '<%';
+select pg_stat_reset_shared('lwlock');
+select stats_reset > now() - interval '1 minute' as ok
+  from pg_stat_lwlocks limit 1;
+
+-- pg_shmem_numa covers all of every named allocation, and some unused
+-- memory.  Reading it raises an error where the platform can't tell on
+-- which NUMA nodes shared memory is, so skip the checks there.
+create function shmem_numa_ok() returns bool language plpgsql as $$
+begin
+  return (select count(*) > 0 from pg_shmem_numa where name is null) and
+    (select count(*) > 0 and bool_and(n.size = a.allocated_size)
+       from (select name, sum(size) as size from pg_shmem_numa
+               where name is not null group by name) n
+       join pg_shmem_allocations a using (name)) and
+    (select bool_and(size > 0) from pg_shmem_numa);
+exception when feature_not_supported then
+  return true;
+end $$;
+select shmem_numa_ok() as ok;
+drop function shmem_numa_ok();
+
 -- This is to record the prevailing planner enable_foo settings during
 -- a regression test run.
 select name, setting from pg_settings where name like 'enable%';
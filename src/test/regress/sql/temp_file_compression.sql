@@ -0,0 +1,87 @@
+--
+-- Test compression of temporary files
+--
+
+CREATE TABLE tfc (a int, b text);
+INSERT INTO tfc SELECT g, md5(g::text) FROM generate_series(1, 20000) g;
+ANALYZE tfc;
+
+-- Make sure that sorts, hash aggregation and hash joins all spill to disk,
+-- in this process
+SET work_mem = '64kB';
+SET max_parallel_workers_per_gather = 0;
+SET enable_sort = off;
+SET enable_mergejoin = off;
+SET enable_nestloop = off;
+
+-- Does the plan of the given query spill to disk?
+CREATE FUNCTION tfc_spills(query text) RETURNS bool
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    ln text;
+BEGIN
+    FOR ln IN
+        EXECUTE 'EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF) ' || query
+    LOOP
+        IF ln ~ 'Sort Method: external' OR ln ~ 'Batches: ([2-9]|\d\d+)' THEN
+            RETURN true;
+        END IF;
+    END LOOP;
+    RETURN false;
+END;
+$$;
+
+CREATE FUNCTION tfc_result(query text) RETURNS text
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    result text;
+BEGIN
+    EXECUTE query INTO result;
+    RETURN result;
+END;
+$$;
+
+CREATE TEMP TABLE tfc_queries (q text, sql text);
+INSERT INTO tfc_queries VALUES
+  ('sort', $$SELECT md5(string_agg(b, ',')) FROM (SELECT b FROM tfc ORDER BY b) s$$),
+  ('hashagg', $$SELECT count(*) || ' ' || sum(n) FROM (SELECT b, count(*) AS n FROM tfc GROUP BY b) s$$),
+  ('hashjoin', $$SELECT count(*) || ' ' || sum(length(t1.b || t2.b)) FROM tfc t1 JOIN tfc t2 USING (a)$$);
+
+SET temp_file_compression = off;
+CREATE TEMP TABLE tfc_off AS
+  SELECT q, tfc_spills(sql) AS spills, tfc_result(sql) AS result FROM tfc_queries;
+SELECT q, spills FROM tfc_off ORDER BY q;
+
+-- Compressed temporary files give the same results
+SET temp_file_compression = pglz;
+SELECT q, tfc_spills(sql) AS spills, tfc_result(sql) = o.result AS same_result
+FROM tfc_queries JOIN tfc_off o USING (q) ORDER BY q;
+
+-- Including with random access to the sorted data
+BEGIN;
+DECLARE c SCROLL CURSOR FOR SELECT a, b FROM tfc ORDER BY b;
+FETCH ABSOLUTE 15000 FROM c;
+FETCH BACKWARD 2 FROM c;
+FETCH ABSOLUTE 10 FROM c;
+FETCH LAST FROM c;
+COMMIT;
+SET temp_file_compression = off;
+BEGIN;
+DECLARE c SCROLL CURSOR FOR SELECT a, b FROM tfc ORDER BY b;
+FETCH ABSOLUTE 15000 FROM c;
+FETCH BACKWARD 2 FROM c;
+FETCH ABSOLUTE 10 FROM c;
+FETCH LAST FROM c;
+COMMIT;
+
+RESET temp_file_compression;
+RESET work_mem;
+RESET max_parallel_workers_per_gather;
+RESET enable_sort;
+RESET enable_mergejoin;
+RESET enable_nestloop;
+DROP FUNCTION tfc_spills(text);
+DROP FUNCTION tfc_result(text);
+DROP TABLE tfc;
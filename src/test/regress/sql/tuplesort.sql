@@ -296,3 +296,37 @@ EXPLAIN (COSTS OFF) :qry;
 :qry;
 
 COMMIT;
+
+----
+-- test radix sort of integer leading keys
+----
+
+CREATE TEMP TABLE radix_sort_ints AS
+    SELECT g.i AS id,
+        (g.i * 7919) % 2003 - 1000 AS i4,
+        ((g.i * 104729) % 20011 - 10000)::int8 * 1000000007 AS i8
+    FROM generate_series(1, 5000) g(i);
+INSERT INTO radix_sort_ints VALUES (5001, NULL, NULL), (5002, NULL, NULL);
+
+-- multi-key sort, ties on the leading key resolved by the second one
+SELECT count(*) FROM (
+    SELECT i4, id, lag(i4) OVER w AS prev_i4, lag(id) OVER w AS prev_id,
+        row_number() OVER w AS rn
+    FROM radix_sort_ints WINDOW w AS (ORDER BY i4, id)) s
+  WHERE (prev_i4, prev_id) > (i4, id)
+    OR (rn > 1 AND prev_i4 IS NULL AND i4 IS NOT NULL);
+SELECT i4, id FROM radix_sort_ints ORDER BY i4 DESC NULLS FIRST, id OFFSET 4995;
+
+-- single-key sorts
+SELECT count(*) FROM (
+    SELECT i8, lag(i8) OVER (ORDER BY i8 DESC) AS prev FROM radix_sort_ints) s
+  WHERE prev < i8;
+SELECT i8, id FROM radix_sort_ints ORDER BY i8 NULLS FIRST OFFSET 4997;
+
+-- btree build
+CREATE INDEX radix_sort_ints_i4_idx ON radix_sort_ints (i4, id);
+BEGIN;
+SET LOCAL enable_seqscan = off;
+SET LOCAL enable_bitmapscan = off;
+SELECT i4, id FROM radix_sort_ints WHERE i4 < -997 ORDER BY i4, id;
+COMMIT;
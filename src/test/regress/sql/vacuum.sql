@@ -101,11 +101,29 @@ VACUUM (PARALLEL 2, INDEX_CLEANUP FALSE) pvactst;
 VACUUM (PARALLEL 2, FULL TRUE) pvactst; -- error, cannot use both PARALLEL and FULL
 VACUUM (PARALLEL) pvactst; -- error, cannot use PARALLEL option without parallel degree
 
+-- ANALYZE computes column statistics in parallel
+ANALYZE (PARALLEL 2) pvactst;
+SELECT attname, null_frac, n_distinct FROM pg_stats
+  WHERE tablename = 'pvactst' ORDER BY attname;
+ANALYZE (PARALLEL 0) pvactst;
+
 -- Test different combinations of parallel and full options for temporary tables
 CREATE TEMPORARY TABLE tmp (a int PRIMARY KEY);
 CREATE INDEX tmp_idx1 ON tmp (a);
 VACUUM (PARALLEL 1, FULL FALSE) tmp; -- parallel vacuum disabled for temp tables
 VACUUM (PARALLEL 0, FULL TRUE) tmp; -- can specify parallel disabled (even though that's implied by FULL)
+-- BUFFER_USAGE_LIMIT option
+VACUUM (BUFFER_USAGE_LIMIT '512kB') tmp;
+VACUUM (BUFFER_USAGE_LIMIT 0) tmp;
+ANALYZE (BUFFER_USAGE_LIMIT '16MB') tmp;
+VACUUM (BUFFER_USAGE_LIMIT 0, FULL) tmp;
+VACUUM (BUFFER_USAGE_LIMIT 64) tmp; -- error, too small
+VACUUM (BUFFER_USAGE_LIMIT 'foo') tmp; -- error
+VACUUM (BUFFER_USAGE_LIMIT '512kB', FULL) tmp; -- error
+SET vacuum_buffer_usage_limit = 64; -- error
+SET vacuum_buffer_usage_limit = '1MB';
+VACUUM tmp;
+RESET vacuum_buffer_usage_limit;
 RESET min_parallel_index_scan_size;
 DROP TABLE pvactst;
 
@@ -4,7 +4,7 @@ use strict;
 use warnings;
 use PostgresNode;
 use TestLib;
-use Test::More tests => 5;
+use Test::More tests => 7;
 
 # Create and initialize a publisher node
 my $node_publisher = get_new_node('publisher');
@@ -130,5 +130,37 @@ is( $result, '{1,2,3}|{42,1.2,1.3}|
 {2,3,1}|{1.2,1.3,1.1}|{two,three,one}
 {3,1,2}|{42,1.1,1.2}|', 'check replicated data on subscriber');
 
+# The initial copy of new tables is done in binary if the column types
+# match, and in text otherwise
+$node_publisher->safe_psql(
+	'postgres', qq(
+	CREATE TABLE public.test_copy (a INTEGER PRIMARY KEY, b NUMERIC[], c TEXT);
+	CREATE TABLE public.test_copy_text (a INTEGER PRIMARY KEY, b TEXT);
+	INSERT INTO public.test_copy VALUES (1, '{1.1, 1.2}', 'one'), (2, NULL, 'two');
+	INSERT INTO public.test_copy_text VALUES (1, 'one'), (2, 'two');
+	));
+$node_subscriber->safe_psql(
+	'postgres', qq(
+	CREATE TABLE public.test_copy (a INTEGER PRIMARY KEY, b NUMERIC[], c TEXT);
+	CREATE TABLE public.test_copy_text (a BIGINT PRIMARY KEY, b VARCHAR);
+	ALTER SUBSCRIPTION tsub REFRESH PUBLICATION;
+	));
+
+$node_subscriber->poll_query_until('postgres',
+	"SELECT count(1) = 0 FROM pg_subscription_rel WHERE srsubstate NOT IN ('s', 'r');"
+) or die "Timed out while waiting for subscriber to synchronize data";
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT a, b, c FROM test_copy ORDER BY a");
+
+is( $result, '1|{1.1,1.2}|one
+2||two', 'check data copied in binary on subscriber');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT a, b FROM test_copy_text ORDER BY a");
+
+is( $result, '1|one
+2|two', 'check data copied in text on subscriber');
+
 $node_subscriber->stop('fast');
 $node_publisher->stop('fast');
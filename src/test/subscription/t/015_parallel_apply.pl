@@ -0,0 +1,93 @@
+# Test applying transactions with parallel apply workers
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 4;
+
+# Create and initialize a publisher node
+my $node_publisher = get_new_node('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->start;
+
+# Create and initialize subscriber node
+my $node_subscriber = get_new_node('subscriber');
+$node_subscriber->init(allows_streaming => 'logical');
+$node_subscriber->append_conf('postgresql.conf',
+	"max_parallel_apply_workers_per_subscription = 2");
+$node_subscriber->start;
+
+# tab_pa qualifies for parallel apply, tab_uniq has another unique index
+my $ddl = qq(
+	CREATE TABLE tab_pa (a int PRIMARY KEY, b int);
+	CREATE TABLE tab_uniq (a int PRIMARY KEY, b int UNIQUE););
+
+$node_publisher->safe_psql('postgres', $ddl);
+$node_subscriber->safe_psql('postgres', $ddl);
+
+# Configure logical replication
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR ALL TABLES");
+
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+$node_subscriber->safe_psql('postgres',
+	"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr' PUBLICATION tap_pub"
+);
+
+# Wait for initial table sync to finish
+$node_publisher->wait_for_catchup('tap_sub');
+$node_subscriber->poll_query_until('postgres',
+	"SELECT count(1) = 0 FROM pg_subscription_rel WHERE srsubstate NOT IN ('s', 'r');"
+) or die "Timed out while waiting for subscriber to synchronize data";
+
+# Many small transactions, most of them changing rows of earlier ones
+$node_publisher->safe_psql(
+	'postgres', qq(
+	DO \$\$
+	BEGIN
+		FOR i IN 1..200 LOOP
+			INSERT INTO tab_pa VALUES (i, 0);
+			COMMIT;
+			UPDATE tab_pa SET b = b + 1 WHERE a = i / 2 + 1;
+			COMMIT;
+			IF i % 3 = 0 THEN
+				DELETE FROM tab_pa WHERE a = i - 1;
+				COMMIT;
+			END IF;
+		END LOOP;
+	END
+	\$\$;));
+
+$node_publisher->wait_for_catchup('tap_sub');
+
+my $query = "SELECT count(*), sum(a), sum(b) FROM tab_pa";
+is( $node_subscriber->safe_psql('postgres', $query),
+	$node_publisher->safe_psql('postgres', $query),
+	'transactions applied in parallel match the publisher');
+
+$node_subscriber->poll_query_until('postgres',
+	"SELECT count(*) > 0 FROM pg_stat_activity WHERE backend_type = 'logical replication parallel apply worker'"
+) or die "Timed out while waiting for a parallel apply worker";
+pass('parallel apply workers were started');
+
+# Transactions that have to be applied serially are kept in order with the
+# parallel ones
+$node_publisher->safe_psql(
+	'postgres', qq(
+	INSERT INTO tab_uniq SELECT i, i FROM generate_series(1, 10) i;
+	UPDATE tab_uniq SET b = b + 10;
+	INSERT INTO tab_pa VALUES (1000, 0);
+	TRUNCATE tab_pa;
+	INSERT INTO tab_pa VALUES (1, 1);));
+
+$node_publisher->wait_for_catchup('tap_sub');
+
+is( $node_subscriber->safe_psql('postgres',
+		"SELECT count(*), sum(b) FROM tab_uniq"),
+	'10|155',
+	'transactions with other unique indexes are applied');
+is($node_subscriber->safe_psql('postgres', "SELECT * FROM tab_pa"),
+	'1|1', 'truncate is applied in order');
+
+$node_subscriber->stop('fast');
+$node_publisher->stop('fast');
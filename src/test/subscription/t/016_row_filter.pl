@@ -0,0 +1,77 @@
+# Test publication row filters and column lists
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 4;
+
+# Create and initialize a publisher node
+my $node_publisher = get_new_node('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->start;
+
+# Create and initialize subscriber node
+my $node_subscriber = get_new_node('subscriber');
+$node_subscriber->init(allows_streaming => 'logical');
+$node_subscriber->start;
+
+my $ddl = qq(
+	CREATE TABLE tab_rf (a int PRIMARY KEY, b text, c int);
+	CREATE TABLE tab_cols (a int PRIMARY KEY, b int, c int););
+
+$node_publisher->safe_psql('postgres', $ddl);
+$node_subscriber->safe_psql('postgres', $ddl);
+
+$node_publisher->safe_psql(
+	'postgres', qq(
+	INSERT INTO tab_rf SELECT i, 'v' || i, i FROM generate_series(1, 20) i;
+	INSERT INTO tab_cols VALUES (1, 1, 1);));
+
+# Configure logical replication
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE tab_rf WHERE (a > 10), tab_cols (a, b)"
+);
+
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+$node_subscriber->safe_psql('postgres',
+	"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr' PUBLICATION tap_pub"
+);
+
+# Wait for initial table sync to finish
+$node_publisher->wait_for_catchup('tap_sub');
+$node_subscriber->poll_query_until('postgres',
+	"SELECT count(1) = 0 FROM pg_subscription_rel WHERE srsubstate NOT IN ('s', 'r');"
+) or die "Timed out while waiting for subscriber to synchronize data";
+
+is( $node_subscriber->safe_psql('postgres',
+		"SELECT count(*), min(a), max(a) FROM tab_rf"),
+	'10|11|20',
+	'initial sync copies only the rows matching the row filter');
+is($node_subscriber->safe_psql('postgres', "SELECT * FROM tab_cols"),
+	'1|1|', 'initial sync copies only the listed columns');
+
+# Rows moving into or out of the filtered set are inserted or deleted
+$node_publisher->safe_psql(
+	'postgres', qq(
+	INSERT INTO tab_rf VALUES (5, 'v5', 5), (25, 'v25', 25);
+	UPDATE tab_rf SET a = 105 WHERE a = 5;
+	UPDATE tab_rf SET a = 3 WHERE a = 12;
+	DELETE FROM tab_rf WHERE a = 15;
+	UPDATE tab_rf SET b = 'x' WHERE a = 20;
+	INSERT INTO tab_cols VALUES (2, 2, 2);
+	UPDATE tab_cols SET b = 5, c = 10 WHERE a = 1;));
+
+$node_publisher->wait_for_catchup('tap_sub');
+
+is( $node_subscriber->safe_psql('postgres',
+		"SELECT count(*), sum(a), string_agg(b, ',' ORDER BY a) FILTER (WHERE a IN (20, 105)) FROM tab_rf"
+	),
+	'10|258|x,v5',
+	'changes are filtered by the row filter');
+is( $node_subscriber->safe_psql('postgres',
+		"SELECT * FROM tab_cols ORDER BY a"),
+	"1|5|\n2|2|",
+	'changes carry only the listed columns');
+
+$node_subscriber->stop('fast');
+$node_publisher->stop('fast');
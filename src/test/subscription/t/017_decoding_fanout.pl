@@ -0,0 +1,100 @@
+# Test walsenders sharing decoded changes through a fan-out group
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 4;
+
+# Create and initialize a publisher node
+my $node_publisher = get_new_node('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->append_conf(
+	'postgresql.conf', qq(
+max_logical_decoding_fanout_groups = 2
+log_min_messages = debug1));
+$node_publisher->start;
+
+# Create and initialize subscriber node, with two subscriptions to the same
+# publication in different databases
+my $node_subscriber = get_new_node('subscriber');
+$node_subscriber->init(allows_streaming => 'logical');
+$node_subscriber->start;
+$node_subscriber->safe_psql('postgres', "CREATE DATABASE db2");
+
+my $ddl = "CREATE TABLE tab_fo (a int PRIMARY KEY, b text)";
+$node_publisher->safe_psql('postgres', $ddl);
+$node_subscriber->safe_psql('postgres', $ddl);
+$node_subscriber->safe_psql('db2',      $ddl);
+
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE tab_fo");
+
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+$node_subscriber->safe_psql('postgres',
+	"CREATE SUBSCRIPTION tap_sub1 CONNECTION '$publisher_connstr' PUBLICATION tap_pub"
+);
+$node_subscriber->safe_psql('db2',
+	"CREATE SUBSCRIPTION tap_sub2 CONNECTION '$publisher_connstr' PUBLICATION tap_pub"
+);
+
+# Wait for initial table sync to finish
+my $synced_query =
+  "SELECT count(1) = 0 FROM pg_subscription_rel WHERE srsubstate NOT IN ('s', 'r');";
+foreach my $db ('postgres', 'db2')
+{
+	$node_subscriber->poll_query_until($db, $synced_query)
+	  or die "Timed out while waiting for subscriber to synchronize data";
+}
+
+# Keep changing data until one walsender has joined the other's group
+my $joined = 0;
+my $i      = 0;
+while (!$joined && $i < 60)
+{
+	$i++;
+	$node_publisher->safe_psql('postgres',
+		"INSERT INTO tab_fo VALUES ($i, 'row $i')");
+	$node_publisher->wait_for_catchup('tap_sub1');
+	$node_publisher->wait_for_catchup('tap_sub2');
+	$joined = slurp_file($node_publisher->logfile) =~
+	  qr/walsender joined logical decoding fan-out group/;
+}
+ok($joined, 'walsender joined a decoding fan-out group');
+
+# Changes sent by the group's leader and by its member match
+$node_publisher->safe_psql(
+	'postgres', qq(
+	INSERT INTO tab_fo SELECT i, 'row ' || i FROM generate_series(100, 199) i;
+	UPDATE tab_fo SET b = b || ' updated' WHERE a % 2 = 0;
+	DELETE FROM tab_fo WHERE a % 10 = 0;
+	ALTER TABLE tab_fo ADD COLUMN c int;));
+$node_subscriber->safe_psql('postgres', "ALTER TABLE tab_fo ADD COLUMN c int");
+$node_subscriber->safe_psql('db2',      "ALTER TABLE tab_fo ADD COLUMN c int");
+$node_publisher->safe_psql('postgres', "UPDATE tab_fo SET c = a WHERE a > 150");
+
+$node_publisher->wait_for_catchup('tap_sub1');
+$node_publisher->wait_for_catchup('tap_sub2');
+
+my $query = "SELECT count(*), sum(a), sum(c), md5(string_agg(b, ',' ORDER BY a)) FROM tab_fo";
+my $expected = $node_publisher->safe_psql('postgres', $query);
+is($node_subscriber->safe_psql('postgres', $query),
+	$expected, 'first subscription matches the publisher');
+is($node_subscriber->safe_psql('db2', $query),
+	$expected, 'second subscription matches the publisher');
+
+# When one of the walsenders goes away, the other one goes on on its own
+$node_subscriber->safe_psql('postgres', "ALTER SUBSCRIPTION tap_sub1 DISABLE");
+$node_publisher->poll_query_until('postgres',
+	"SELECT count(*) = 0 FROM pg_stat_replication WHERE application_name = 'tap_sub1'"
+) or die "Timed out while waiting for the walsender to exit";
+
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO tab_fo SELECT i, 'row ' || i, i FROM generate_series(200, 249) i");
+$node_publisher->wait_for_catchup('tap_sub2');
+
+is( $node_subscriber->safe_psql('db2', $query),
+	$node_publisher->safe_psql('postgres', $query),
+	'remaining subscription keeps replicating');
+
+$node_subscriber->stop('fast');
+$node_publisher->stop('fast');
@@ -0,0 +1,31 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_user_mapping_d.h
+ *    Macro definitions for pg_user_mapping
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * NOTES
+ *  ******************************
+ *  *** DO NOT EDIT THIS FILE! ***
+ *  ******************************
+ *
+ *  It has been GENERATED by src/backend/catalog/genbki.pl
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PG_USER_MAPPING_D_H
+#define PG_USER_MAPPING_D_H
+
+#define UserMappingRelationId 1418
+
+#define Anum_pg_user_mapping_oid 1
+#define Anum_pg_user_mapping_umuser 2
+#define Anum_pg_user_mapping_umserver 3
+#define Anum_pg_user_mapping_umoptions 4
+
+#define Natts_pg_user_mapping 4
+
+
+#endif							/* PG_USER_MAPPING_D_H */
@@ -0,0 +1,32 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeMaterial.h
+ *
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/executor/nodeMaterial.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef NODEMATERIAL_H
+#define NODEMATERIAL_H
+
+#include "access/parallel.h"
+#include "nodes/execnodes.h"
+
+extern MaterialState *ExecInitMaterial(Material *node, EState *estate, int eflags);
+extern void ExecEndMaterial(MaterialState *node);
+extern void ExecMaterialMarkPos(MaterialState *node);
+extern void ExecMaterialRestrPos(MaterialState *node);
+extern void ExecReScanMaterial(MaterialState *node);
+
+extern void ExecMaterialEstimate(MaterialState *node, ParallelContext *pcxt);
+extern void ExecMaterialInitializeDSM(MaterialState *node, ParallelContext *pcxt);
+extern void ExecMaterialReInitializeDSM(MaterialState *node, ParallelContext *pcxt);
+extern void ExecMaterialInitializeWorker(MaterialState *node,
+										 ParallelWorkerContext *pwcxt);
+
+#endif							/* NODEMATERIAL_H */
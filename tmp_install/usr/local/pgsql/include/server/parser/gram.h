@@ -0,0 +1,611 @@
+/* A Bison parser, made by GNU Bison 3.8.2.  */
+
+/* Bison interface for Yacc-like parsers in C
+
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* As a special exception, you may create a larger work that contains
+   part or all of the Bison parser skeleton and distribute that work
+   under terms of your choice, so long as that work isn't itself a
+   parser generator using the skeleton or a modified version thereof
+   as a parser skeleton.  Alternatively, if you modify or redistribute
+   the parser skeleton itself, you may (at your option) remove this
+   special exception, which will cause the skeleton and the resulting
+   Bison output files to be licensed under the GNU General Public
+   License without this special exception.
+
+   This special exception was added by the Free Software Foundation in
+   version 2.2 of Bison.  */
+
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+#ifndef YY_BASE_YY_GRAM_H_INCLUDED
+# define YY_BASE_YY_GRAM_H_INCLUDED
+/* Debug traces.  */
+#ifndef YYDEBUG
+# define YYDEBUG 0
+#endif
+#if YYDEBUG
+extern int base_yydebug;
+#endif
+
+/* Token kinds.  */
+#ifndef YYTOKENTYPE
+# define YYTOKENTYPE
+  enum yytokentype
+  {
+    YYEMPTY = -2,
+    YYEOF = 0,                     /* "end of file"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    IDENT = 258,                   /* IDENT  */
+    UIDENT = 259,                  /* UIDENT  */
+    FCONST = 260,                  /* FCONST  */
+    SCONST = 261,                  /* SCONST  */
+    USCONST = 262,                 /* USCONST  */
+    BCONST = 263,                  /* BCONST  */
+    XCONST = 264,                  /* XCONST  */
+    Op = 265,                      /* Op  */
+    ICONST = 266,                  /* ICONST  */
+    PARAM = 267,                   /* PARAM  */
+    TYPECAST = 268,                /* TYPECAST  */
+    DOT_DOT = 269,                 /* DOT_DOT  */
+    COLON_EQUALS = 270,            /* COLON_EQUALS  */
+    EQUALS_GREATER = 271,          /* EQUALS_GREATER  */
+    LESS_EQUALS = 272,             /* LESS_EQUALS  */
+    GREATER_EQUALS = 273,          /* GREATER_EQUALS  */
+    NOT_EQUALS = 274,              /* NOT_EQUALS  */
+    ABORT_P = 275,                 /* ABORT_P  */
+    ABSOLUTE_P = 276,              /* ABSOLUTE_P  */
+    ACCESS = 277,                  /* ACCESS  */
+    ACTION = 278,                  /* ACTION  */
+    ADD_P = 279,                   /* ADD_P  */
+    ADMIN = 280,                   /* ADMIN  */
+    AFTER = 281,                   /* AFTER  */
+    AGGREGATE = 282,               /* AGGREGATE  */
+    ALL = 283,                     /* ALL  */
+    ALSO = 284,                    /* ALSO  */
+    ALTER = 285,                   /* ALTER  */
+    ALWAYS = 286,                  /* ALWAYS  */
+    ANALYSE = 287,                 /* ANALYSE  */
+    ANALYZE = 288,                 /* ANALYZE  */
+    AND = 289,                     /* AND  */
+    ANY = 290,                     /* ANY  */
+    ARRAY = 291,                   /* ARRAY  */
+    AS = 292,                      /* AS  */
+    ASC = 293,                     /* ASC  */
+    ASSERTION = 294,               /* ASSERTION  */
+    ASSIGNMENT = 295,              /* ASSIGNMENT  */
+    ASYMMETRIC = 296,              /* ASYMMETRIC  */
+    AT = 297,                      /* AT  */
+    ATTACH = 298,                  /* ATTACH  */
+    ATTRIBUTE = 299,               /* ATTRIBUTE  */
+    AUTHORIZATION = 300,           /* AUTHORIZATION  */
+    BACKWARD = 301,                /* BACKWARD  */
+    BEFORE = 302,                  /* BEFORE  */
+    BEGIN_P = 303,                 /* BEGIN_P  */
+    BETWEEN = 304,                 /* BETWEEN  */
+    BIGINT = 305,                  /* BIGINT  */
+    BINARY = 306,                  /* BINARY  */
+    BIT = 307,                     /* BIT  */
+    BOOLEAN_P = 308,               /* BOOLEAN_P  */
+    BOTH = 309,                    /* BOTH  */
+    BY = 310,                      /* BY  */
+    CACHE = 311,                   /* CACHE  */
+    CALL = 312,                    /* CALL  */
+    CALLED = 313,                  /* CALLED  */
+    CASCADE = 314,                 /* CASCADE  */
+    CASCADED = 315,                /* CASCADED  */
+    CASE = 316,                    /* CASE  */
+    CAST = 317,                    /* CAST  */
+    CATALOG_P = 318,               /* CATALOG_P  */
+    CHAIN = 319,                   /* CHAIN  */
+    CHAR_P = 320,                  /* CHAR_P  */
+    CHARACTER = 321,               /* CHARACTER  */
+    CHARACTERISTICS = 322,         /* CHARACTERISTICS  */
+    CHECK = 323,                   /* CHECK  */
+    CHECKPOINT = 324,              /* CHECKPOINT  */
+    CLASS = 325,                   /* CLASS  */
+    CLOSE = 326,                   /* CLOSE  */
+    CLUSTER = 327,                 /* CLUSTER  */
+    COALESCE = 328,                /* COALESCE  */
+    COLLATE = 329,                 /* COLLATE  */
+    COLLATION = 330,               /* COLLATION  */
+    COLUMN = 331,                  /* COLUMN  */
+    COLUMNS = 332,                 /* COLUMNS  */
+    COMMENT = 333,                 /* COMMENT  */
+    COMMENTS = 334,                /* COMMENTS  */
+    COMMIT = 335,                  /* COMMIT  */
+    COMMITTED = 336,               /* COMMITTED  */
+    COMPRESSION = 337,             /* COMPRESSION  */
+    CONCURRENTLY = 338,            /* CONCURRENTLY  */
+    CONFIGURATION = 339,           /* CONFIGURATION  */
+    CONFLICT = 340,                /* CONFLICT  */
+    CONNECTION = 341,              /* CONNECTION  */
+    CONSTRAINT = 342,              /* CONSTRAINT  */
+    CONSTRAINTS = 343,             /* CONSTRAINTS  */
+    CONTENT_P = 344,               /* CONTENT_P  */
+    CONTINUE_P = 345,              /* CONTINUE_P  */
+    CONVERSION_P = 346,            /* CONVERSION_P  */
+    COPY = 347,                    /* COPY  */
+    COST = 348,                    /* COST  */
+    CREATE = 349,                  /* CREATE  */
+    CROSS = 350,                   /* CROSS  */
+    CSV = 351,                     /* CSV  */
+    CUBE = 352,                    /* CUBE  */
+    CURRENT_P = 353,               /* CURRENT_P  */
+    CURRENT_CATALOG = 354,         /* CURRENT_CATALOG  */
+    CURRENT_DATE = 355,            /* CURRENT_DATE  */
+    CURRENT_ROLE = 356,            /* CURRENT_ROLE  */
+    CURRENT_SCHEMA = 357,          /* CURRENT_SCHEMA  */
+    CURRENT_TIME = 358,            /* CURRENT_TIME  */
+    CURRENT_TIMESTAMP = 359,       /* CURRENT_TIMESTAMP  */
+    CURRENT_USER = 360,            /* CURRENT_USER  */
+    CURSOR = 361,                  /* CURSOR  */
+    CYCLE = 362,                   /* CYCLE  */
+    DATA_P = 363,                  /* DATA_P  */
+    DATABASE = 364,                /* DATABASE  */
+    DAY_P = 365,                   /* DAY_P  */
+    DEALLOCATE = 366,              /* DEALLOCATE  */
+    DEC = 367,                     /* DEC  */
+    DECIMAL_P = 368,               /* DECIMAL_P  */
+    DECLARE = 369,                 /* DECLARE  */
+    DEFAULT = 370,                 /* DEFAULT  */
+    DEFAULTS = 371,                /* DEFAULTS  */
+    DEFERRABLE = 372,              /* DEFERRABLE  */
+    DEFERRED = 373,                /* DEFERRED  */
+    DEFINER = 374,                 /* DEFINER  */
+    DELETE_P = 375,                /* DELETE_P  */
+    DELIMITER = 376,               /* DELIMITER  */
+    DELIMITERS = 377,              /* DELIMITERS  */
+    DEPENDS = 378,                 /* DEPENDS  */
+    DESC = 379,                    /* DESC  */
+    DETACH = 380,                  /* DETACH  */
+    DICTIONARY = 381,              /* DICTIONARY  */
+    DISABLE_P = 382,               /* DISABLE_P  */
+    DISCARD = 383,                 /* DISCARD  */
+    DISTINCT = 384,                /* DISTINCT  */
+    DO = 385,                      /* DO  */
+    DOCUMENT_P = 386,              /* DOCUMENT_P  */
+    DOMAIN_P = 387,                /* DOMAIN_P  */
+    DOUBLE_P = 388,                /* DOUBLE_P  */
+    DROP = 389,                    /* DROP  */
+    EACH = 390,                    /* EACH  */
+    ELSE = 391,                    /* ELSE  */
+    ENABLE_P = 392,                /* ENABLE_P  */
+    ENCODING = 393,                /* ENCODING  */
+    ENCRYPTED = 394,               /* ENCRYPTED  */
+    END_P = 395,                   /* END_P  */
+    ENUM_P = 396,                  /* ENUM_P  */
+    ESCAPE = 397,                  /* ESCAPE  */
+    EVENT = 398,                   /* EVENT  */
+    EXCEPT = 399,                  /* EXCEPT  */
+    EXCLUDE = 400,                 /* EXCLUDE  */
+    EXCLUDING = 401,               /* EXCLUDING  */
+    EXCLUSIVE = 402,               /* EXCLUSIVE  */
+    EXECUTE = 403,                 /* EXECUTE  */
+    EXISTS = 404,                  /* EXISTS  */
+    EXPLAIN = 405,                 /* EXPLAIN  */
+    EXPRESSION = 406,              /* EXPRESSION  */
+    EXTENSION = 407,               /* EXTENSION  */
+    EXTERNAL = 408,                /* EXTERNAL  */
+    EXTRACT = 409,                 /* EXTRACT  */
+    FALSE_P = 410,                 /* FALSE_P  */
+    FAMILY = 411,                  /* FAMILY  */
+    FETCH = 412,                   /* FETCH  */
+    FILTER = 413,                  /* FILTER  */
+    FIRST_P = 414,                 /* FIRST_P  */
+    FLOAT_P = 415,                 /* FLOAT_P  */
+    FOLLOWING = 416,               /* FOLLOWING  */
+    FOR = 417,                     /* FOR  */
+    FORCE = 418,                   /* FORCE  */
+    FOREIGN = 419,                 /* FOREIGN  */
+    FORWARD = 420,                 /* FORWARD  */
+    FREEZE = 421,                  /* FREEZE  */
+    FROM = 422,                    /* FROM  */
+    FULL = 423,                    /* FULL  */
+    FUNCTION = 424,                /* FUNCTION  */
+    FUNCTIONS = 425,               /* FUNCTIONS  */
+    GENERATED = 426,               /* GENERATED  */
+    GLOBAL = 427,                  /* GLOBAL  */
+    GRANT = 428,                   /* GRANT  */
+    GRANTED = 429,                 /* GRANTED  */
+    GREATEST = 430,                /* GREATEST  */
+    GROUP_P = 431,                 /* GROUP_P  */
+    GROUPING = 432,                /* GROUPING  */
+    GROUPS = 433,                  /* GROUPS  */
+    HANDLER = 434,                 /* HANDLER  */
+    HAVING = 435,                  /* HAVING  */
+    HEADER_P = 436,                /* HEADER_P  */
+    HOLD = 437,                    /* HOLD  */
+    HOUR_P = 438,                  /* HOUR_P  */
+    IDENTITY_P = 439,              /* IDENTITY_P  */
+    IF_P = 440,                    /* IF_P  */
+    ILIKE = 441,                   /* ILIKE  */
+    IMMEDIATE = 442,               /* IMMEDIATE  */
+    IMMUTABLE = 443,               /* IMMUTABLE  */
+    IMPLICIT_P = 444,              /* IMPLICIT_P  */
+    IMPORT_P = 445,                /* IMPORT_P  */
+    IN_P = 446,                    /* IN_P  */
+    INCLUDE = 447,                 /* INCLUDE  */
+    INCLUDING = 448,               /* INCLUDING  */
+    INCREMENT = 449,               /* INCREMENT  */
+    INDEX = 450,                   /* INDEX  */
+    INDEXES = 451,                 /* INDEXES  */
+    INHERIT = 452,                 /* INHERIT  */
+    INHERITS = 453,                /* INHERITS  */
+    INITIALLY = 454,               /* INITIALLY  */
+    INLINE_P = 455,                /* INLINE_P  */
+    INNER_P = 456,                 /* INNER_P  */
+    INOUT = 457,                   /* INOUT  */
+    INPUT_P = 458,                 /* INPUT_P  */
+    INSENSITIVE = 459,             /* INSENSITIVE  */
+    INSERT = 460,                  /* INSERT  */
+    INSTEAD = 461,                 /* INSTEAD  */
+    INT_P = 462,                   /* INT_P  */
+    INTEGER = 463,                 /* INTEGER  */
+    INTERSECT = 464,               /* INTERSECT  */
+    INTERVAL = 465,                /* INTERVAL  */
+    INTO = 466,                    /* INTO  */
+    INVOKER = 467,                 /* INVOKER  */
+    IS = 468,                      /* IS  */
+    ISNULL = 469,                  /* ISNULL  */
+    ISOLATION = 470,               /* ISOLATION  */
+    JOIN = 471,                    /* JOIN  */
+    KEY = 472,                     /* KEY  */
+    LABEL = 473,                   /* LABEL  */
+    LANGUAGE = 474,                /* LANGUAGE  */
+    LARGE_P = 475,                 /* LARGE_P  */
+    LAST_P = 476,                  /* LAST_P  */
+    LATERAL_P = 477,               /* LATERAL_P  */
+    LEADING = 478,                 /* LEADING  */
+    LEAKPROOF = 479,               /* LEAKPROOF  */
+    LEAST = 480,                   /* LEAST  */
+    LEFT = 481,                    /* LEFT  */
+    LEVEL = 482,                   /* LEVEL  */
+    LIKE = 483,                    /* LIKE  */
+    LIMIT = 484,                   /* LIMIT  */
+    LISTEN = 485,                  /* LISTEN  */
+    LOAD = 486,                    /* LOAD  */
+    LOCAL = 487,                   /* LOCAL  */
+    LOCALTIME = 488,               /* LOCALTIME  */
+    LOCALTIMESTAMP = 489,          /* LOCALTIMESTAMP  */
+    LOCATION = 490,                /* LOCATION  */
+    LOCK_P = 491,                  /* LOCK_P  */
+    LOCKED = 492,                  /* LOCKED  */
+    LOGGED = 493,                  /* LOGGED  */
+    MAPPING = 494,                 /* MAPPING  */
+    MATCH = 495,                   /* MATCH  */
+    MATERIALIZED = 496,            /* MATERIALIZED  */
+    MAXVALUE = 497,                /* MAXVALUE  */
+    METHOD = 498,                  /* METHOD  */
+    MINUTE_P = 499,                /* MINUTE_P  */
+    MINVALUE = 500,                /* MINVALUE  */
+    MODE = 501,                    /* MODE  */
+    MONTH_P = 502,                 /* MONTH_P  */
+    MOVE = 503,                    /* MOVE  */
+    NAME_P = 504,                  /* NAME_P  */
+    NAMES = 505,                   /* NAMES  */
+    NATIONAL = 506,                /* NATIONAL  */
+    NATURAL = 507,                 /* NATURAL  */
+    NCHAR = 508,                   /* NCHAR  */
+    NEW = 509,                     /* NEW  */
+    NEXT = 510,                    /* NEXT  */
+    NFC = 511,                     /* NFC  */
+    NFD = 512,                     /* NFD  */
+    NFKC = 513,                    /* NFKC  */
+    NFKD = 514,                    /* NFKD  */
+    NO = 515,                      /* NO  */
+    NONE = 516,                    /* NONE  */
+    NORMALIZE = 517,               /* NORMALIZE  */
+    NORMALIZED = 518,              /* NORMALIZED  */
+    NOT = 519,                     /* NOT  */
+    NOTHING = 520,                 /* NOTHING  */
+    NOTIFY = 521,                  /* NOTIFY  */
+    NOTNULL = 522,                 /* NOTNULL  */
+    NOWAIT = 523,                  /* NOWAIT  */
+    NULL_P = 524,                  /* NULL_P  */
+    NULLIF = 525,                  /* NULLIF  */
+    NULLS_P = 526,                 /* NULLS_P  */
+    NUMERIC = 527,                 /* NUMERIC  */
+    OBJECT_P = 528,                /* OBJECT_P  */
+    OF = 529,                      /* OF  */
+    OFF = 530,                     /* OFF  */
+    OFFSET = 531,                  /* OFFSET  */
+    OIDS = 532,                    /* OIDS  */
+    OLD = 533,                     /* OLD  */
+    ON = 534,                      /* ON  */
+    ONLY = 535,                    /* ONLY  */
+    OPERATOR = 536,                /* OPERATOR  */
+    OPTION = 537,                  /* OPTION  */
+    OPTIONS = 538,                 /* OPTIONS  */
+    OR = 539,                      /* OR  */
+    ORDER = 540,                   /* ORDER  */
+    ORDINALITY = 541,              /* ORDINALITY  */
+    OTHERS = 542,                  /* OTHERS  */
+    OUT_P = 543,                   /* OUT_P  */
+    OUTER_P = 544,                 /* OUTER_P  */
+    OVER = 545,                    /* OVER  */
+    OVERLAPS = 546,                /* OVERLAPS  */
+    OVERLAY = 547,                 /* OVERLAY  */
+    OVERRIDING = 548,              /* OVERRIDING  */
+    OWNED = 549,                   /* OWNED  */
+    OWNER = 550,                   /* OWNER  */
+    PARALLEL = 551,                /* PARALLEL  */
+    PARSER = 552,                  /* PARSER  */
+    PARTIAL = 553,                 /* PARTIAL  */
+    PARTITION = 554,               /* PARTITION  */
+    PASSING = 555,                 /* PASSING  */
+    PASSWORD = 556,                /* PASSWORD  */
+    PLACING = 557,                 /* PLACING  */
+    PLANS = 558,                   /* PLANS  */
+    POLICY = 559,                  /* POLICY  */
+    POSITION = 560,                /* POSITION  */
+    PRECEDING = 561,               /* PRECEDING  */
+    PRECISION = 562,               /* PRECISION  */
+    PRESERVE = 563,                /* PRESERVE  */
+    PREPARE = 564,                 /* PREPARE  */
+    PREPARED = 565,                /* PREPARED  */
+    PRIMARY = 566,                 /* PRIMARY  */
+    PRIOR = 567,                   /* PRIOR  */
+    PRIVILEGES = 568,              /* PRIVILEGES  */
+    PROCEDURAL = 569,              /* PROCEDURAL  */
+    PROCEDURE = 570,               /* PROCEDURE  */
+    PROCEDURES = 571,              /* PROCEDURES  */
+    PROGRAM = 572,                 /* PROGRAM  */
+    PUBLICATION = 573,             /* PUBLICATION  */
+    QUOTE = 574,                   /* QUOTE  */
+    RANGE = 575,                   /* RANGE  */
+    READ = 576,                    /* READ  */
+    REAL = 577,                    /* REAL  */
+    REASSIGN = 578,                /* REASSIGN  */
+    RECHECK = 579,                 /* RECHECK  */
+    RECURSIVE = 580,               /* RECURSIVE  */
+    REF = 581,                     /* REF  */
+    REFERENCES = 582,              /* REFERENCES  */
+    REFERENCING = 583,             /* REFERENCING  */
+    REFRESH = 584,                 /* REFRESH  */
+    REINDEX = 585,                 /* REINDEX  */
+    RELATIVE_P = 586,              /* RELATIVE_P  */
+    RELEASE = 587,                 /* RELEASE  */
+    RENAME = 588,                  /* RENAME  */
+    REPEATABLE = 589,              /* REPEATABLE  */
+    REPLACE = 590,                 /* REPLACE  */
+    REPLICA = 591,                 /* REPLICA  */
+    RESET = 592,                   /* RESET  */
+    RESTART = 593,                 /* RESTART  */
+    RESTRICT = 594,                /* RESTRICT  */
+    RETURNING = 595,               /* RETURNING  */
+    RETURNS = 596,                 /* RETURNS  */
+    REVOKE = 597,                  /* REVOKE  */
+    RIGHT = 598,                   /* RIGHT  */
+    ROLE = 599,                    /* ROLE  */
+    ROLLBACK = 600,                /* ROLLBACK  */
+    ROLLUP = 601,                  /* ROLLUP  */
+    ROUTINE = 602,                 /* ROUTINE  */
+    ROUTINES = 603,                /* ROUTINES  */
+    ROW = 604,                     /* ROW  */
+    ROWS = 605,                    /* ROWS  */
+    RULE = 606,                    /* RULE  */
+    SAVEPOINT = 607,               /* SAVEPOINT  */
+    SCHEMA = 608,                  /* SCHEMA  */
+    SCHEMAS = 609,                 /* SCHEMAS  */
+    SCROLL = 610,                  /* SCROLL  */
+    SEARCH = 611,                  /* SEARCH  */
+    SECOND_P = 612,                /* SECOND_P  */
+    SECURITY = 613,                /* SECURITY  */
+    SELECT = 614,                  /* SELECT  */
+    SEQUENCE = 615,                /* SEQUENCE  */
+    SEQUENCES = 616,               /* SEQUENCES  */
+    SERIALIZABLE = 617,            /* SERIALIZABLE  */
+    SERVER = 618,                  /* SERVER  */
+    SESSION = 619,                 /* SESSION  */
+    SESSION_USER = 620,            /* SESSION_USER  */
+    SET = 621,                     /* SET  */
+    SETS = 622,                    /* SETS  */
+    SETOF = 623,                   /* SETOF  */
+    SHARE = 624,                   /* SHARE  */
+    SHOW = 625,                    /* SHOW  */
+    SIMILAR = 626,                 /* SIMILAR  */
+    SIMPLE = 627,                  /* SIMPLE  */
+    SKIP = 628,                    /* SKIP  */
+    SMALLINT = 629,                /* SMALLINT  */
+    SNAPSHOT = 630,                /* SNAPSHOT  */
+    SOME = 631,                    /* SOME  */
+    SQL_P = 632,                   /* SQL_P  */
+    STABLE = 633,                  /* STABLE  */
+    STANDALONE_P = 634,            /* STANDALONE_P  */
+    START = 635,                   /* START  */
+    STATEMENT = 636,               /* STATEMENT  */
+    STATISTICS = 637,              /* STATISTICS  */
+    STDIN = 638,                   /* STDIN  */
+    STDOUT = 639,                  /* STDOUT  */
+    STORAGE = 640,                 /* STORAGE  */
+    STORED = 641,                  /* STORED  */
+    STRICT_P = 642,                /* STRICT_P  */
+    STRIP_P = 643,                 /* STRIP_P  */
+    SUBSCRIPTION = 644,            /* SUBSCRIPTION  */
+    SUBSTRING = 645,               /* SUBSTRING  */
+    SUPPORT = 646,                 /* SUPPORT  */
+    SYMMETRIC = 647,               /* SYMMETRIC  */
+    SYSID = 648,                   /* SYSID  */
+    SYSTEM_P = 649,                /* SYSTEM_P  */
+    TABLE = 650,                   /* TABLE  */
+    TABLES = 651,                  /* TABLES  */
+    TABLESAMPLE = 652,             /* TABLESAMPLE  */
+    TABLESPACE = 653,              /* TABLESPACE  */
+    TEMP = 654,                    /* TEMP  */
+    TEMPLATE = 655,                /* TEMPLATE  */
+    TEMPORARY = 656,               /* TEMPORARY  */
+    TEXT_P = 657,                  /* TEXT_P  */
+    THEN = 658,                    /* THEN  */
+    TIES = 659,                    /* TIES  */
+    TIME = 660,                    /* TIME  */
+    TIMESTAMP = 661,               /* TIMESTAMP  */
+    TO = 662,                      /* TO  */
+    TRAILING = 663,                /* TRAILING  */
+    TRANSACTION = 664,             /* TRANSACTION  */
+    TRANSFORM = 665,               /* TRANSFORM  */
+    TREAT = 666,                   /* TREAT  */
+    TRIGGER = 667,                 /* TRIGGER  */
+    TRIM = 668,                    /* TRIM  */
+    TRUE_P = 669,                  /* TRUE_P  */
+    TRUNCATE = 670,                /* TRUNCATE  */
+    TRUSTED = 671,                 /* TRUSTED  */
+    TYPE_P = 672,                  /* TYPE_P  */
+    TYPES_P = 673,                 /* TYPES_P  */
+    UESCAPE = 674,                 /* UESCAPE  */
+    UNBOUNDED = 675,               /* UNBOUNDED  */
+    UNCOMMITTED = 676,             /* UNCOMMITTED  */
+    UNENCRYPTED = 677,             /* UNENCRYPTED  */
+    UNION = 678,                   /* UNION  */
+    UNIQUE = 679,                  /* UNIQUE  */
+    UNKNOWN = 680,                 /* UNKNOWN  */
+    UNLISTEN = 681,                /* UNLISTEN  */
+    UNLOGGED = 682,                /* UNLOGGED  */
+    UNTIL = 683,                   /* UNTIL  */
+    UPDATE = 684,                  /* UPDATE  */
+    USER = 685,                    /* USER  */
+    USING = 686,                   /* USING  */
+    VACUUM = 687,                  /* VACUUM  */
+    VALID = 688,                   /* VALID  */
+    VALIDATE = 689,                /* VALIDATE  */
+    VALIDATOR = 690,               /* VALIDATOR  */
+    VALUE_P = 691,                 /* VALUE_P  */
+    VALUES = 692,                  /* VALUES  */
+    VARCHAR = 693,                 /* VARCHAR  */
+    VARIADIC = 694,                /* VARIADIC  */
+    VARYING = 695,                 /* VARYING  */
+    VERBOSE = 696,                 /* VERBOSE  */
+    VERSION_P = 697,               /* VERSION_P  */
+    VIEW = 698,                    /* VIEW  */
+    VIEWS = 699,                   /* VIEWS  */
+    VOLATILE = 700,                /* VOLATILE  */
+    WHEN = 701,                    /* WHEN  */
+    WHERE = 702,                   /* WHERE  */
+    WHITESPACE_P = 703,            /* WHITESPACE_P  */
+    WINDOW = 704,                  /* WINDOW  */
+    WITH = 705,                    /* WITH  */
+    WITHIN = 706,                  /* WITHIN  */
+    WITHOUT = 707,                 /* WITHOUT  */
+    WORK = 708,                    /* WORK  */
+    WRAPPER = 709,                 /* WRAPPER  */
+    WRITE = 710,                   /* WRITE  */
+    XML_P = 711,                   /* XML_P  */
+    XMLATTRIBUTES = 712,           /* XMLATTRIBUTES  */
+    XMLCONCAT = 713,               /* XMLCONCAT  */
+    XMLELEMENT = 714,              /* XMLELEMENT  */
+    XMLEXISTS = 715,               /* XMLEXISTS  */
+    XMLFOREST = 716,               /* XMLFOREST  */
+    XMLNAMESPACES = 717,           /* XMLNAMESPACES  */
+    XMLPARSE = 718,                /* XMLPARSE  */
+    XMLPI = 719,                   /* XMLPI  */
+    XMLROOT = 720,                 /* XMLROOT  */
+    XMLSERIALIZE = 721,            /* XMLSERIALIZE  */
+    XMLTABLE = 722,                /* XMLTABLE  */
+    YEAR_P = 723,                  /* YEAR_P  */
+    YES_P = 724,                   /* YES_P  */
+    ZONE = 725,                    /* ZONE  */
+    NOT_LA = 726,                  /* NOT_LA  */
+    NULLS_LA = 727,                /* NULLS_LA  */
+    WITH_LA = 728,                 /* WITH_LA  */
+    POSTFIXOP = 729,               /* POSTFIXOP  */
+    UMINUS = 730                   /* UMINUS  */
+  };
+  typedef enum yytokentype yytoken_kind_t;
+#endif
+
+/* Value type.  */
+#if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
+union YYSTYPE
+{
+#line 211 "gram.y"
+
+	core_YYSTYPE		core_yystype;
+	/* these fields must match core_YYSTYPE: */
+	int					ival;
+	char				*str;
+	const char			*keyword;
+
+	char				chr;
+	bool				boolean;
+	JoinType			jtype;
+	DropBehavior		dbehavior;
+	OnCommitAction		oncommit;
+	List				*list;
+	Node				*node;
+	Value				*value;
+	ObjectType			objtype;
+	TypeName			*typnam;
+	FunctionParameter   *fun_param;
+	FunctionParameterMode fun_param_mode;
+	ObjectWithArgs		*objwithargs;
+	DefElem				*defelt;
+	SortBy				*sortby;
+	WindowDef			*windef;
+	JoinExpr			*jexpr;
+	IndexElem			*ielem;
+	Alias				*alias;
+	RangeVar			*range;
+	IntoClause			*into;
+	WithClause			*with;
+	InferClause			*infer;
+	OnConflictClause	*onconflict;
+	A_Indices			*aind;
+	ResTarget			*target;
+	struct PrivTarget	*privtarget;
+	AccessPriv			*accesspriv;
+	struct ImportQual	*importqual;
+	InsertStmt			*istmt;
+	VariableSetStmt		*vsetstmt;
+	PartitionElem		*partelem;
+	PartitionSpec		*partspec;
+	PartitionBoundSpec	*partboundspec;
+	RoleSpec			*rolespec;
+	struct SelectLimit	*selectlimit;
+
+#line 584 "gram.h"
+
+};
+typedef union YYSTYPE YYSTYPE;
+# define YYSTYPE_IS_TRIVIAL 1
+# define YYSTYPE_IS_DECLARED 1
+#endif
+
+/* Location type.  */
+#if ! defined YYLTYPE && ! defined YYLTYPE_IS_DECLARED
+typedef struct YYLTYPE YYLTYPE;
+struct YYLTYPE
+{
+  int first_line;
+  int first_column;
+  int last_line;
+  int last_column;
+};
+# define YYLTYPE_IS_DECLARED 1
+# define YYLTYPE_IS_TRIVIAL 1
+#endif
+
+
+
+
+int base_yyparse (core_yyscan_t yyscanner);
+
+
+#endif /* !YY_BASE_YY_GRAM_H_INCLUDED  */
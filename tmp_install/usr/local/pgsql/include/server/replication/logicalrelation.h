@@ -0,0 +1,47 @@
+/*-------------------------------------------------------------------------
+ *
+ * logicalrelation.h
+ *	  Relation definitions for logical replication relation mapping.
+ *
+ * Portions Copyright (c) 2016-2020, PostgreSQL Global Development Group
+ *
+ * src/include/replication/logicalrelation.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef LOGICALRELATION_H
+#define LOGICALRELATION_H
+
+#include "access/attmap.h"
+#include "replication/logicalproto.h"
+
+typedef struct LogicalRepRelMapEntry
+{
+	LogicalRepRelation remoterel;	/* key is remoterel.remoteid */
+
+	/* Mapping to local relation, filled as needed. */
+	Oid			localreloid;	/* local relation id */
+	Relation	localrel;		/* relcache entry */
+	AttrMap    *attrmap;		/* map of local attributes to remote ones */
+	bool		updatable;		/* Can apply updates/deletes? */
+	bool		parallel_safe;	/* Can apply in parallel apply workers? */
+	Bitmapset  *parallel_keys;	/* replica identity columns, if parallel_safe */
+
+	/* Sync state. */
+	char		state;
+	XLogRecPtr	statelsn;
+} LogicalRepRelMapEntry;
+
+extern void logicalrep_relmap_update(LogicalRepRelation *remoterel);
+
+extern LogicalRepRelMapEntry *logicalrep_rel_open(LogicalRepRelId remoteid,
+												  LOCKMODE lockmode);
+extern LogicalRepRelMapEntry *logicalrep_partition_open(LogicalRepRelMapEntry *root,
+														Relation partrel, AttrMap *map);
+extern void logicalrep_rel_close(LogicalRepRelMapEntry *rel,
+								 LOCKMODE lockmode);
+
+extern void logicalrep_typmap_update(LogicalRepTyp *remotetyp);
+extern char *logicalrep_typmap_gettypname(Oid remoteid);
+
+#endif							/* LOGICALRELATION_H */
@@ -0,0 +1,82 @@
+/*-------------------------------------------------------------------------
+ *
+ * buf_stats.h
+ *	  Shared buffer usage counters, per relation and per access strategy
+ *
+ * Backends count buffer hits, reads, evictions, dirtied buffers and writes
+ * locally and add them to counters in shared memory from time to time; see
+ * buf_stats.c.  The counters are shown by the pg_stat_buffer_relations and
+ * pg_stat_buffer_strategies views.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/buf_stats.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef BUF_STATS_H
+#define BUF_STATS_H
+
+#include "storage/bufmgr.h"
+#include "storage/relfilenode.h"
+#include "utils/timestamp.h"
+
+typedef enum BufferStatsCounter
+{
+	BUFSTATS_HIT,				/* found in shared buffers */
+	BUFSTATS_READ,				/* read into shared buffers */
+	BUFSTATS_EVICTED,			/* evicted to make room for another block */
+	BUFSTATS_DIRTIED,			/* clean buffer dirtied */
+	BUFSTATS_WRITTEN_BACKEND,	/* written by a backend or other process */
+	BUFSTATS_WRITTEN_BGWRITER,	/* written by the background writer */
+	BUFSTATS_WRITTEN_CHECKPOINTER,	/* written by the checkpointer */
+} BufferStatsCounter;
+
+#define BUFSTATS_NUM_COUNTERS		(BUFSTATS_WRITTEN_CHECKPOINTER + 1)
+#define BUFSTATS_NUM_STRATEGIES		(BAS_VACUUM + 1)
+
+/* counters of one relation, as returned by BufferStatsGetRelations */
+typedef struct BufferStatsRelation
+{
+	RelFileNode rnode;			/* all zeroes for relations that didn't fit */
+	uint64		counts[BUFSTATS_NUM_COUNTERS];
+} BufferStatsRelation;
+
+/* GUC variable */
+extern PGDLLIMPORT bool track_buffer_usage;
+
+extern Size BufferStatsShmemSize(void);
+extern void BufferStatsShmemInit(void);
+
+extern void BufferStatsCountRelation(const RelFileNode *rnode,
+									 BufferStatsCounter counter);
+extern void BufferStatsCountStrategy(BufferAccessStrategy strategy,
+									 BufferStatsCounter counter);
+extern void BufferStatsFlush(bool force);
+
+extern BufferStatsRelation *BufferStatsGetRelations(int *nrels);
+extern void BufferStatsGetStrategies(uint64 counts[BUFSTATS_NUM_STRATEGIES][BUFSTATS_NUM_COUNTERS]);
+extern TimestampTz BufferStatsGetResetTimestamp(void);
+extern void BufferStatsReset(void);
+
+/*
+ * Count an access to a shared buffer of the given relation, and optionally
+ * also for the given strategy.  These check track_buffer_usage first, so
+ * that the counting costs next to nothing when it is off.
+ */
+#define pgstat_count_buffer_usage(rnode, counter) \
+	do { \
+		if (track_buffer_usage) \
+			BufferStatsCountRelation(rnode, counter); \
+	} while (0)
+#define pgstat_count_buffer_usage_strategy(rnode, strategy, counter) \
+	do { \
+		if (track_buffer_usage) \
+		{ \
+			BufferStatsCountRelation(rnode, counter); \
+			BufferStatsCountStrategy(strategy, counter); \
+		} \
+	} while (0)
+
+#endif							/* BUF_STATS_H */
@@ -0,0 +1,31 @@
+/*-------------------------------------------------------------------------
+ *
+ * extension_lock.h
+ *	  Relation extension locks
+ *
+ * The relation extension lock interlocks the addition of pages to a
+ * relation.  It is implemented with a fixed set of LWLocks outside the
+ * heavyweight lock manager; see extension_lock.c.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/extension_lock.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXTENSION_LOCK_H
+#define EXTENSION_LOCK_H
+
+/* number of LWLocks the relation extension locks are spread over */
+#define N_RELEXTLOCK_ENTS 1024
+
+extern Size RelExtLockShmemSize(void);
+extern void InitRelExtLocks(void);
+
+extern bool RelExtLockAcquire(Oid dbid, Oid relid, bool conditional);
+extern void RelExtLockRelease(Oid dbid, Oid relid);
+extern int	RelExtLockWaiterCount(Oid dbid, Oid relid);
+extern bool RelExtLockHeldByMe(void);
+
+#endif							/* EXTENSION_LOCK_H */
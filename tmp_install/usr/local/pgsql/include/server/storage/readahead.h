@@ -0,0 +1,40 @@
+/*-------------------------------------------------------------------------
+ *
+ * readahead.h
+ *	  Prefetching of the blocks a scan is about to read.
+ *
+ * A ReadAheadState keeps up to a given number of prefetch requests in flight
+ * ahead of a scan that reads the blocks of one relation fork in an order a
+ * callback can predict.  See readahead.c for details.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/readahead.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include "common/relpath.h"
+#include "storage/block.h"
+#include "utils/relcache.h"
+
+/*
+ * Returns the next block the scan is going to read, or InvalidBlockNumber
+ * if there are no more.
+ */
+typedef BlockNumber (*ReadAheadCallback) (void *callback_arg);
+
+typedef struct ReadAheadState ReadAheadState;
+
+extern ReadAheadState *ReadAheadBegin(Relation rel, ForkNumber forknum,
+									  int max_distance,
+									  ReadAheadCallback callback,
+									  void *callback_arg);
+extern void ReadAheadAdvance(ReadAheadState *ra, BlockNumber blkno);
+extern void ReadAheadReset(ReadAheadState *ra);
+extern void ReadAheadEnd(ReadAheadState *ra);
+
+#endif							/* READAHEAD_H */
@@ -0,0 +1,35 @@
+/*-------------------------------------------------------------------------
+ *
+ * relsize.h
+ *	  Shared cache of relation fork sizes.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/relsize.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef RELSIZE_H
+#define RELSIZE_H
+
+#include "common/relpath.h"
+#include "storage/block.h"
+#include "storage/relfilenode.h"
+
+/* GUC variables */
+extern int	relsize_cache_size;
+
+extern Size RelSizeCacheShmemSize(void);
+extern void RelSizeCacheShmemInit(void);
+
+extern BlockNumber RelSizeCacheLookup(RelFileNode rnode, ForkNumber forknum);
+extern void RelSizeCacheRecord(RelFileNode rnode, ForkNumber forknum,
+							   BlockNumber nblocks);
+extern void RelSizeCacheTruncate(RelFileNode rnode, ForkNumber forknum,
+								 BlockNumber nblocks);
+extern void RelSizeCacheForget(RelFileNode rnode);
+extern void RelSizeCacheForgetDatabase(Oid dbid);
+
+#endif							/* RELSIZE_H */
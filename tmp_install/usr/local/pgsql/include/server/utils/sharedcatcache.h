@@ -0,0 +1,40 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.h
+ *	  Catalog cache entries shared between backends
+ *
+ * When shared_catcache_size is set, the tuples backends load into their
+ * catalog caches are also put into shared memory, so that other backends
+ * missing them in their own caches needn't search the catalogs again; see
+ * sharedcatcache.c.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedcatcache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDCATCACHE_H
+#define SHAREDCATCACHE_H
+
+#include "access/htup.h"
+#include "storage/sinval.h"
+#include "utils/catcache.h"
+
+/* GUC variable, in kB; zero disables the shared catalog cache */
+extern int	shared_catcache_size;
+
+extern Size SharedCatCacheShmemSize(void);
+extern void SharedCatCacheShmemInit(void);
+
+extern bool SharedCatCacheUsable(void);
+extern List *SharedCatCacheFetch(CatCache *cache, uint32 hashValue,
+								 uint64 *generation);
+extern void SharedCatCacheStore(CatCache *cache, uint32 hashValue,
+								HeapTuple tuple, uint64 generation);
+extern void SharedCatCacheInvalidate(const SharedInvalidationMessage *msgs,
+									 int n);
+extern void SharedCatCacheDropDatabase(Oid dbid);
+
+#endif							/* SHAREDCATCACHE_H */